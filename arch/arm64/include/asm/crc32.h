@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef __ASM_CRC32_H
+#define __ASM_CRC32_H
+
+#include <linux/types.h>
+
+/*
+ * Same semantics as crc32_le() and __crc32c_le(): no pre or post
+ * inversion is done here.
+ */
+u32 __pure crc32_le_arm64(u32 crc, const u8 *p, size_t len);
+u32 __pure crc32c_le_arm64(u32 crc, const u8 *p, size_t len);
+
+#endif	/* __ASM_CRC32_H */
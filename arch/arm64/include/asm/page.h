@@ -40,6 +40,8 @@ extern void __cpu_clear_user_page(void *p, unsigned long user);
 extern void __cpu_copy_user_page(void *to, const void *from,
 				 unsigned long user);
 extern void copy_page(void *to, const void *from);
+extern void __copy_page_ldp(void *to, const void *from);
+extern void __copy_page_a53(void *to, const void *from);
 extern void clear_page(void *to);
 
 #define clear_user_page(addr,vaddr,pg)  __cpu_clear_user_page(addr, vaddr)
@@ -37,6 +37,9 @@ extern __kernel_size_t strnlen(const char *, __kernel_size_t);
 #define __HAVE_ARCH_MEMCPY
 extern void *memcpy(void *, const void *, __kernel_size_t);
 extern void *__memcpy(void *, const void *, __kernel_size_t);
+/* memcpy variants; __memcpy_a53 only takes n >= 512 */
+extern void *__memcpy_ldp(void *, const void *, __kernel_size_t);
+extern void *__memcpy_a53(void *, const void *, __kernel_size_t);
 
 #define __HAVE_ARCH_MEMMOVE
 extern void *memmove(void *, const void *, __kernel_size_t);
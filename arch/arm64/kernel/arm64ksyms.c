@@ -60,6 +60,14 @@ EXPORT_SYMBOL(__memmove);
 EXPORT_SYMBOL(memchr);
 EXPORT_SYMBOL(memcmp);
 
+#if IS_ENABLED(CONFIG_ARM64_COPY_BENCH)
+	/* individual variants, for the copy benchmark */
+EXPORT_SYMBOL(__memcpy_ldp);
+EXPORT_SYMBOL(__memcpy_a53);
+EXPORT_SYMBOL(__copy_page_ldp);
+EXPORT_SYMBOL(__copy_page_a53);
+#endif
+
 	/* atomic bitops */
 EXPORT_SYMBOL(set_bit);
 EXPORT_SYMBOL(test_and_set_bit);
@@ -763,6 +763,28 @@ static bool has_no_hw_prefetch(const struct arm64_cpu_capabilities *entry, int _
 		MIDR_CPU_VAR_REV(1, MIDR_REVISION_MASK));
 }
 
+/*
+ * The string and page copy routines switch to their prefetching variants
+ * only when every CPU is an in-order Cortex-A53. Those variants are still
+ * correct on any other core, so a late CPU is never refused for lacking
+ * this, it just runs them a little slower.
+ */
+static bool has_a53_tuned_copy(const struct arm64_cpu_capabilities *entry,
+			       int scope)
+{
+	int cpu;
+
+	if (scope == SCOPE_LOCAL_CPU)
+		return true;
+
+	for_each_online_cpu(cpu)
+		if ((per_cpu(cpu_data, cpu).reg_midr & MIDR_CPU_MODEL_MASK) !=
+		    MIDR_CORTEX_A53)
+			return false;
+
+	return true;
+}
+
 static bool runs_at_el2(const struct arm64_cpu_capabilities *entry, int __unused)
 {
 	return is_kernel_in_hyp_mode();
@@ -940,6 +962,12 @@ static const struct arm64_cpu_capabilities arm64_features[] = {
 		.type = ARM64_CPUCAP_SYSTEM_FEATURE,
 		.matches = has_no_hw_prefetch,
 	},
+	{
+		.desc = "Cortex-A53 tuned memcpy/copy_page",
+		.capability = ARM64_HAS_A53_TUNED_COPY,
+		.type = ARM64_CPUCAP_SYSTEM_FEATURE,
+		.matches = has_a53_tuned_copy,
+	},
 #ifdef CONFIG_ARM64_UAO
 	{
 		.desc = "User Access Override",
@@ -19,9 +19,11 @@
 
 #include <linux/cpu.h>
 #include <linux/cpu_pm.h>
+#include <linux/debugfs.h>
 #include <linux/kernel.h>
 #include <linux/init.h>
 #include <linux/sched.h>
+#include <linux/seq_file.h>
 #include <linux/signal.h>
 #include <linux/hardirq.h>
 
@@ -87,9 +89,29 @@
  * - the task gets preempted after kernel_neon_end() is called; as we have not
  *   returned from the 2nd syscall yet, TIF_FOREIGN_FPSTATE is still set so
  *   whatever is in the FPSIMD registers is not saved to memory, but discarded.
+ *
+ * A kernel mode NEON section in task context that only needs some of the
+ * registers (kernel_neon_begin_partial() with fewer than 32) does not give
+ * up the registers at all while 'current's userland state is live in them:
+ * it saves just the registers it clobbers and reloads them in
+ * kernel_neon_end(). fpsimd_last_state and TIF_FOREIGN_FPSTATE are left
+ * alone, so neither the full save nor the restore on return to userland
+ * happens.
  */
 static DEFINE_PER_CPU(struct fpsimd_state *, fpsimd_last_state);
 
+/*
+ * How often the FPSIMD state actually had to move, and how often the
+ * tracking above avoided it; see <debugfs>/fpsimd_stats.
+ */
+struct fpsimd_stats {
+	u64 switch_loads_avoided;
+	u64 user_restores;
+	u64 neon_full_saves;
+	u64 neon_kept_user_state;
+};
+static DEFINE_PER_CPU(struct fpsimd_stats, fpsimd_stats);
+
 /*
  * Trapped FP/ASIMD access.
  */
@@ -147,10 +169,11 @@ void fpsimd_thread_switch(struct task_struct *next)
 		struct fpsimd_state *st = &next->thread.fpsimd_state;
 
 		if (__this_cpu_read(fpsimd_last_state) == st
-		    && st->cpu == smp_processor_id())
+		    && st->cpu == smp_processor_id()) {
 			clear_ti_thread_flag(task_thread_info(next),
 					     TIF_FOREIGN_FPSTATE);
-		else
+			__this_cpu_inc(fpsimd_stats.switch_loads_avoided);
+		} else
 			set_ti_thread_flag(task_thread_info(next),
 					   TIF_FOREIGN_FPSTATE);
 	}
@@ -191,6 +214,7 @@ void fpsimd_restore_current_state(void)
 		fpsimd_load_state(st);
 		this_cpu_write(fpsimd_last_state, st);
 		st->cpu = smp_processor_id();
+		__this_cpu_inc(fpsimd_stats.user_restores);
 	}
 	preempt_enable();
 }
@@ -225,6 +249,8 @@ void fpsimd_flush_task_state(struct task_struct *t)
 
 static DEFINE_PER_CPU(struct fpsimd_partial_state, hardirq_fpsimdstate);
 static DEFINE_PER_CPU(struct fpsimd_partial_state, softirq_fpsimdstate);
+static DEFINE_PER_CPU(struct fpsimd_partial_state, task_fpsimdstate);
+static DEFINE_PER_CPU(bool, task_fpsimdstate_live);
 
 /*
  * Kernel-side NEON support functions
@@ -238,16 +264,35 @@ void kernel_neon_begin_partial(u32 num_regs)
 		BUG_ON(num_regs > 32);
 		fpsimd_save_partial_state(s, roundup(num_regs, 2));
 	} else {
+		preempt_disable();
+
+		/*
+		 * If only part of the registers is needed and they hold our
+		 * own userland state, preserve just that part and keep the
+		 * registers owned by 'current'.
+		 */
+		if (num_regs < 32 && current->mm &&
+		    !test_thread_flag(TIF_FOREIGN_FPSTATE)) {
+			struct fpsimd_partial_state *s =
+				this_cpu_ptr(&task_fpsimdstate);
+
+			fpsimd_save_partial_state(s, roundup(num_regs, 2));
+			__this_cpu_write(task_fpsimdstate_live, true);
+			__this_cpu_inc(fpsimd_stats.neon_kept_user_state);
+			return;
+		}
+
 		/*
 		 * Save the userland FPSIMD state if we have one and if we
 		 * haven't done so already. Clear fpsimd_last_state to indicate
 		 * that there is no longer userland FPSIMD state in the
 		 * registers.
 		 */
-		preempt_disable();
 		if (current->mm &&
-		    !test_and_set_thread_flag(TIF_FOREIGN_FPSTATE))
+		    !test_and_set_thread_flag(TIF_FOREIGN_FPSTATE)) {
 			fpsimd_save_state(&current->thread.fpsimd_state);
+			__this_cpu_inc(fpsimd_stats.neon_full_saves);
+		}
 		this_cpu_write(fpsimd_last_state, NULL);
 	}
 }
@@ -260,6 +305,10 @@ void kernel_neon_end(void)
 			in_irq() ? &hardirq_fpsimdstate : &softirq_fpsimdstate);
 		fpsimd_load_partial_state(s);
 	} else {
+		if (__this_cpu_read(task_fpsimdstate_live)) {
+			fpsimd_load_partial_state(this_cpu_ptr(&task_fpsimdstate));
+			__this_cpu_write(task_fpsimdstate_live, false);
+		}
 		preempt_enable();
 	}
 }
@@ -318,6 +367,50 @@ static inline void fpsimd_hotplug_init(void)
 static inline void fpsimd_hotplug_init(void) { }
 #endif
 
+#ifdef CONFIG_DEBUG_FS
+static int fpsimd_stats_show(struct seq_file *m, void *v)
+{
+	struct fpsimd_stats sum = { 0 }, *st;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		st = per_cpu_ptr(&fpsimd_stats, cpu);
+		sum.switch_loads_avoided += st->switch_loads_avoided;
+		sum.user_restores += st->user_restores;
+		sum.neon_full_saves += st->neon_full_saves;
+		sum.neon_kept_user_state += st->neon_kept_user_state;
+	}
+
+	seq_printf(m, "switch_loads_avoided: %llu\n", sum.switch_loads_avoided);
+	seq_printf(m, "user_restores: %llu\n", sum.user_restores);
+	seq_printf(m, "neon_full_saves: %llu\n", sum.neon_full_saves);
+	seq_printf(m, "neon_kept_user_state: %llu\n",
+		   sum.neon_kept_user_state);
+
+	return 0;
+}
+
+static int fpsimd_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, fpsimd_stats_show, NULL);
+}
+
+static const struct file_operations fpsimd_stats_fops = {
+	.open		= fpsimd_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static inline void fpsimd_debugfs_init(void)
+{
+	debugfs_create_file("fpsimd_stats", 0444, NULL, NULL,
+			    &fpsimd_stats_fops);
+}
+#else
+static inline void fpsimd_debugfs_init(void) { }
+#endif
+
 /*
  * FP/SIMD support code initialisation.
  */
@@ -326,6 +419,7 @@ static int __init fpsimd_init(void)
 	if (elf_hwcap & HWCAP_FP) {
 		fpsimd_pm_init();
 		fpsimd_hotplug_init();
+		fpsimd_debugfs_init();
 	} else {
 		pr_notice("Floating-point is not implemented\n");
 	}
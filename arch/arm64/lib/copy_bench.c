@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Bandwidth of the arm64 memcpy, memset and copy_page variants.
+ *
+ * Loading the module times each implementation for a range of sizes and
+ * prints MB/s to the kernel log; "memcpy" and "copy_page" are the
+ * routines the alternatives picked for this system. The module stays
+ * loaded so the run can be repeated with a write to its "run" parameter.
+ */
+
+#define pr_fmt(fmt) "copy_bench: " fmt
+
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/sizes.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+#include <asm/cpufeature.h>
+#include <asm/page.h>
+
+#define COPY_BENCH_BUF_SIZE	SZ_4M
+/* Bytes moved per measurement, so small sizes run long enough to time */
+#define COPY_BENCH_TOTAL	SZ_64M
+#define COPY_BENCH_A53_MIN	512
+
+static const size_t copy_bench_sizes[] = {
+	64, 256, SZ_1K, SZ_4K, SZ_16K, SZ_64K, SZ_256K, SZ_1M, SZ_4M,
+};
+
+struct copy_bench_impl {
+	const char *name;
+	void *(*fn)(void *dst, const void *src, size_t len);
+	size_t min_len;
+};
+
+static void *copy_bench_memset(void *dst, const void *src, size_t len)
+{
+	return memset(dst, 0x5a, len);
+}
+
+static void *copy_bench_memzero(void *dst, const void *src, size_t len)
+{
+	return memset(dst, 0, len);
+}
+
+static const struct copy_bench_impl copy_bench_impls[] = {
+	{ "memcpy",	__memcpy,		0 },
+	{ "memcpy_ldp",	__memcpy_ldp,		0 },
+	{ "memcpy_a53",	__memcpy_a53,		COPY_BENCH_A53_MIN },
+	{ "memset",	copy_bench_memset,	0 },
+	{ "memzero",	copy_bench_memzero,	0 },
+};
+
+static void *copy_bench_dst, *copy_bench_src;
+static DEFINE_MUTEX(copy_bench_lock);
+
+/* MB/s for @bytes moved in @ns */
+static u64 copy_bench_mbps(u64 bytes, u64 ns)
+{
+	return ns ? div64_u64(bytes * NSEC_PER_SEC, ns) >> 20 : 0;
+}
+
+static void copy_bench_sizes_run(const struct copy_bench_impl *impl)
+{
+	size_t len, off;
+	u64 start, ns, iters, i;
+	int s;
+
+	for (s = 0; s < ARRAY_SIZE(copy_bench_sizes); s++) {
+		len = copy_bench_sizes[s];
+		if (len < impl->min_len)
+			continue;
+
+		iters = COPY_BENCH_TOTAL / len;
+		off = 0;
+		start = ktime_get_ns();
+		for (i = 0; i < iters; i++) {
+			impl->fn(copy_bench_dst + off, copy_bench_src + off,
+				 len);
+			/* Walk the buffer so large sizes miss the caches */
+			off += len;
+			if (off + len > COPY_BENCH_BUF_SIZE)
+				off = 0;
+		}
+		ns = ktime_get_ns() - start;
+		pr_info("%-12s %8zu bytes: %6llu MB/s\n", impl->name, len,
+			copy_bench_mbps((u64)iters * len, ns));
+		cond_resched();
+	}
+}
+
+static void copy_bench_pages_run(const char *name,
+				 void (*fn)(void *to, const void *from))
+{
+	u64 start, ns, iters, i;
+	size_t off = 0;
+
+	iters = COPY_BENCH_TOTAL / PAGE_SIZE;
+	start = ktime_get_ns();
+	for (i = 0; i < iters; i++) {
+		fn(copy_bench_dst + off, copy_bench_src + off);
+		off = (off + PAGE_SIZE) % COPY_BENCH_BUF_SIZE;
+	}
+	ns = ktime_get_ns() - start;
+	pr_info("%-12s %8lu bytes: %6llu MB/s\n", name, PAGE_SIZE,
+		copy_bench_mbps((u64)iters * PAGE_SIZE, ns));
+}
+
+static void copy_bench_run(void)
+{
+	int i;
+
+	pr_info("Cortex-A53 tuned copies %s\n",
+		cpus_have_cap(ARM64_HAS_A53_TUNED_COPY) ? "in use" :
+							  "not in use");
+
+	for (i = 0; i < ARRAY_SIZE(copy_bench_impls); i++)
+		copy_bench_sizes_run(&copy_bench_impls[i]);
+
+	copy_bench_pages_run("copy_page", copy_page);
+	copy_bench_pages_run("copy_page_ldp", __copy_page_ldp);
+	copy_bench_pages_run("copy_page_a53", __copy_page_a53);
+}
+
+static int copy_bench_set_run(const char *val, const struct kernel_param *kp)
+{
+	mutex_lock(&copy_bench_lock);
+	copy_bench_run();
+	mutex_unlock(&copy_bench_lock);
+
+	return 0;
+}
+
+static const struct kernel_param_ops copy_bench_run_ops = {
+	.set = copy_bench_set_run,
+};
+module_param_cb(run, &copy_bench_run_ops, NULL, 0200);
+MODULE_PARM_DESC(run, "Write anything to repeat the benchmark");
+
+static int __init copy_bench_init(void)
+{
+	/* vmalloc keeps page alignment, which copy_page needs */
+	copy_bench_src = vmalloc(COPY_BENCH_BUF_SIZE);
+	copy_bench_dst = vmalloc(COPY_BENCH_BUF_SIZE);
+	if (!copy_bench_src || !copy_bench_dst) {
+		vfree(copy_bench_src);
+		vfree(copy_bench_dst);
+		return -ENOMEM;
+	}
+	memset(copy_bench_src, 0xa5, COPY_BENCH_BUF_SIZE);
+	memset(copy_bench_dst, 0, COPY_BENCH_BUF_SIZE);
+
+	copy_bench_run();
+
+	return 0;
+}
+module_init(copy_bench_init);
+
+static void __exit copy_bench_exit(void)
+{
+	vfree(copy_bench_src);
+	vfree(copy_bench_dst);
+}
+module_exit(copy_bench_exit);
+
+MODULE_DESCRIPTION("arm64 memcpy/memset/copy_page bandwidth benchmark");
+MODULE_LICENSE("GPL v2");
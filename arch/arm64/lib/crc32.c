@@ -0,0 +1,99 @@
+/*
+ * CRC32 and CRC32C using the optional ARMv8 CRC instructions
+ *
+ * CRC32 loop taken from Ed Nevill's Hadoop CRC patch, by way of the
+ * crc32-arm64 crypto driver. Inline assembly is used instead of
+ * intrinsics in order to be backwards compatible with older compilers.
+ *
+ * Copyright (C) 2014 Linaro Ltd <yazen.ghannam@linaro.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/crc32.h>
+#include <linux/export.h>
+#include <linux/unaligned/access_ok.h>
+#include <asm/crc32.h>
+#include <asm/hwcap.h>
+
+#define CRC32X(crc, value) __asm__("crc32x %w[c], %w[c], %x[v]":[c]"+r"(crc):[v]"r"(value))
+#define CRC32W(crc, value) __asm__("crc32w %w[c], %w[c], %w[v]":[c]"+r"(crc):[v]"r"(value))
+#define CRC32H(crc, value) __asm__("crc32h %w[c], %w[c], %w[v]":[c]"+r"(crc):[v]"r"(value))
+#define CRC32B(crc, value) __asm__("crc32b %w[c], %w[c], %w[v]":[c]"+r"(crc):[v]"r"(value))
+#define CRC32CX(crc, value) __asm__("crc32cx %w[c], %w[c], %x[v]":[c]"+r"(crc):[v]"r"(value))
+#define CRC32CW(crc, value) __asm__("crc32cw %w[c], %w[c], %w[v]":[c]"+r"(crc):[v]"r"(value))
+#define CRC32CH(crc, value) __asm__("crc32ch %w[c], %w[c], %w[v]":[c]"+r"(crc):[v]"r"(value))
+#define CRC32CB(crc, value) __asm__("crc32cb %w[c], %w[c], %w[v]":[c]"+r"(crc):[v]"r"(value))
+
+static u32 crc32_le_hw(u32 crc, const u8 *p, size_t len)
+{
+	s64 length = len;
+
+	while ((length -= sizeof(u64)) >= 0) {
+		CRC32X(crc, get_unaligned_le64(p));
+		p += sizeof(u64);
+	}
+
+	/* The following is more efficient than the straight loop */
+	if (length & sizeof(u32)) {
+		CRC32W(crc, get_unaligned_le32(p));
+		p += sizeof(u32);
+	}
+	if (length & sizeof(u16)) {
+		CRC32H(crc, get_unaligned_le16(p));
+		p += sizeof(u16);
+	}
+	if (length & sizeof(u8))
+		CRC32B(crc, *p);
+
+	return crc;
+}
+
+static u32 crc32c_le_hw(u32 crc, const u8 *p, size_t len)
+{
+	s64 length = len;
+
+	while ((length -= sizeof(u64)) >= 0) {
+		CRC32CX(crc, get_unaligned_le64(p));
+		p += sizeof(u64);
+	}
+
+	/* The following is more efficient than the straight loop */
+	if (length & sizeof(u32)) {
+		CRC32CW(crc, get_unaligned_le32(p));
+		p += sizeof(u32);
+	}
+	if (length & sizeof(u16)) {
+		CRC32CH(crc, get_unaligned_le16(p));
+		p += sizeof(u16);
+	}
+	if (length & sizeof(u8))
+		CRC32CB(crc, *p);
+
+	return crc;
+}
+
+/*
+ * Callable from any context, including by code that cannot go through a
+ * crypto_shash; without the CRC instructions these fall back to the
+ * table driven lib/crc32.c versions.
+ */
+u32 __pure crc32_le_arm64(u32 crc, const u8 *p, size_t len)
+{
+	if (unlikely(!(elf_hwcap & HWCAP_CRC32)))
+		return crc32_le(crc, p, len);
+
+	return crc32_le_hw(crc, p, len);
+}
+EXPORT_SYMBOL(crc32_le_arm64);
+
+u32 __pure crc32c_le_arm64(u32 crc, const u8 *p, size_t len)
+{
+	if (unlikely(!(elf_hwcap & HWCAP_CRC32)))
+		return __crc32c_le(crc, p, len);
+
+	return crc32c_le_hw(crc, p, len);
+}
+EXPORT_SYMBOL(crc32c_le_arm64);
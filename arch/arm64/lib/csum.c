@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/compiler.h>
+#include <linux/kernel.h>
+#include <asm/checksum.h>
+#include <asm/unaligned.h>
+
+/*
+ * Add one 64-bit word to a 128-bit accumulator. The compiler turns this
+ * into an ADDS/ADC pair, and the carries only need folding once at the
+ * end, so a whole packet is summed without an end-around carry per word.
+ */
+static __always_inline __uint128_t csum_acc(__uint128_t sum, u64 data)
+{
+	return sum + data;
+}
+
+static inline unsigned int csum_fold64(__uint128_t acc)
+{
+	u64 sum = (u64)acc;
+	u64 hi = (u64)(acc >> 64);
+	u32 sum32;
+
+	sum += hi;
+	sum += sum < hi;
+	sum32 = (u32)sum + (u32)(sum >> 32);
+	sum32 += sum32 < (u32)sum;
+	sum32 = (sum32 & 0xffff) + (sum32 >> 16);
+	sum32 = (sum32 & 0xffff) + (sum32 >> 16);
+
+	return sum32;
+}
+
+/*
+ * 16-bit one's complement sum of @len bytes, in the byte order of memory.
+ * Unaligned loads are cheap on arm64, and summing little-endian 64-bit
+ * words and folding them is the same as summing the 16-bit words they
+ * contain, so the buffer is walked from @buff as is, whatever its
+ * alignment. The lib/checksum.c csum_partial() and ip_compute_csum()
+ * wrappers end up here.
+ */
+unsigned int do_csum(const unsigned char *buff, int len)
+{
+	__uint128_t acc0 = 0, acc1 = 0;
+
+	if (unlikely(len <= 0))
+		return 0;
+
+	while (len >= 64) {
+		acc0 = csum_acc(acc0, get_unaligned((const u64 *)buff));
+		acc1 = csum_acc(acc1, get_unaligned((const u64 *)(buff + 8)));
+		acc0 = csum_acc(acc0, get_unaligned((const u64 *)(buff + 16)));
+		acc1 = csum_acc(acc1, get_unaligned((const u64 *)(buff + 24)));
+		acc0 = csum_acc(acc0, get_unaligned((const u64 *)(buff + 32)));
+		acc1 = csum_acc(acc1, get_unaligned((const u64 *)(buff + 40)));
+		acc0 = csum_acc(acc0, get_unaligned((const u64 *)(buff + 48)));
+		acc1 = csum_acc(acc1, get_unaligned((const u64 *)(buff + 56)));
+		buff += 64;
+		len -= 64;
+	}
+
+	while (len >= 8) {
+		acc0 = csum_acc(acc0, get_unaligned((const u64 *)buff));
+		buff += 8;
+		len -= 8;
+	}
+
+	/* The tail starts at an even offset, so a last odd byte is a low byte */
+	if (len & 4) {
+		acc1 = csum_acc(acc1, get_unaligned((const u32 *)buff));
+		buff += 4;
+	}
+	if (len & 2) {
+		acc1 = csum_acc(acc1, get_unaligned((const u16 *)buff));
+		buff += 2;
+	}
+	if (len & 1)
+		acc1 = csum_acc(acc1, *buff);
+
+	/* @len is an int, so neither accumulator gets anywhere near 2^127 */
+	return csum_fold64(acc0 + acc1);
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Checks the arm64 checksum and CRC routines against portable versions
+ * and prints the bandwidth of both for a few packet and block sizes.
+ * Loading fails with -EINVAL if any result differs.
+ */
+
+#define pr_fmt(fmt) "csum_bench: " fmt
+
+#include <linux/crc32.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+#include <net/checksum.h>
+#include <asm/crc32.h>
+#include <asm/unaligned.h>
+
+#define CSUM_BENCH_BUF_SIZE	(SZ_64K + 8)
+#define CSUM_BENCH_TOTAL	SZ_16M
+
+static const int csum_bench_sizes[] = { 20, 40, 64, 576, 1500, SZ_4K, SZ_64K };
+
+static u8 *csum_bench_buf;
+
+/* 32 bits at a time with an end-around carry, as lib/checksum.c does */
+static __wsum csum_bench_ref(const u8 *buf, int len, __wsum wsum)
+{
+	u64 sum = (__force u32)wsum;
+	int i;
+
+	for (i = 0; i + 4 <= len; i += 4)
+		sum += get_unaligned((const u32 *)(buf + i));
+	if (len & 2) {
+		sum += get_unaligned((const u16 *)(buf + i));
+		i += 2;
+	}
+	if (len & 1)
+		sum += buf[i];
+
+	while (sum >> 32)
+		sum = (sum & 0xffffffff) + (sum >> 32);
+
+	return (__force __wsum)sum;
+}
+
+static int csum_bench_verify(void)
+{
+	int off, len, i;
+	u32 seed, a, b;
+
+	for (i = 0; i < 2000; i++) {
+		off = prandom_u32_max(8);
+		len = prandom_u32_max(SZ_4K);
+		seed = prandom_u32();
+
+		a = csum_fold(csum_partial(csum_bench_buf + off, len,
+					   (__force __wsum)seed));
+		b = csum_fold(csum_bench_ref(csum_bench_buf + off, len,
+					     (__force __wsum)seed));
+		/* 0x0000 and 0xffff are both one's complement zero */
+		if (a % 0xffff != b % 0xffff) {
+			pr_err("csum mismatch off %d len %d: %04x != %04x\n",
+			       off, len, a, b);
+			return -EINVAL;
+		}
+
+		a = crc32_le_arm64(seed, csum_bench_buf + off, len);
+		b = crc32_le(seed, csum_bench_buf + off, len);
+		if (a != b) {
+			pr_err("crc32 mismatch off %d len %d\n", off, len);
+			return -EINVAL;
+		}
+
+		a = crc32c_le_arm64(seed, csum_bench_buf + off, len);
+		b = __crc32c_le(seed, csum_bench_buf + off, len);
+		if (a != b) {
+			pr_err("crc32c mismatch off %d len %d\n", off, len);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static u64 csum_bench_mbps(u64 bytes, u64 ns)
+{
+	return ns ? div64_u64(bytes * NSEC_PER_SEC, ns) >> 20 : 0;
+}
+
+#define CSUM_BENCH_TIME(name, len, expr)				\
+do {									\
+	u64 _i, _iters = CSUM_BENCH_TOTAL / (len);			\
+	u64 _start = ktime_get_ns();					\
+	volatile u32 _sink;						\
+									\
+	for (_i = 0; _i < _iters; _i++)					\
+		_sink = (__force u32)(expr);				\
+	(void)_sink;							\
+	pr_info("%-10s %6d bytes: %6llu MB/s\n", name, len,		\
+		csum_bench_mbps(_iters * (len), ktime_get_ns() - _start)); \
+} while (0)
+
+static void csum_bench_run(void)
+{
+	const u8 *p = csum_bench_buf;
+	int i, len;
+
+	for (i = 0; i < ARRAY_SIZE(csum_bench_sizes); i++) {
+		len = csum_bench_sizes[i];
+		CSUM_BENCH_TIME("csum", len, csum_partial(p, len, 0));
+		CSUM_BENCH_TIME("csum_ref", len, csum_bench_ref(p, len, 0));
+		CSUM_BENCH_TIME("crc32", len, crc32_le_arm64(~0, p, len));
+		CSUM_BENCH_TIME("crc32_ref", len, crc32_le(~0, p, len));
+		CSUM_BENCH_TIME("crc32c", len, crc32c_le_arm64(~0, p, len));
+		CSUM_BENCH_TIME("crc32c_ref", len, __crc32c_le(~0, p, len));
+		cond_resched();
+	}
+}
+
+static int __init csum_bench_init(void)
+{
+	int ret;
+
+	csum_bench_buf = kmalloc(CSUM_BENCH_BUF_SIZE, GFP_KERNEL);
+	if (!csum_bench_buf)
+		return -ENOMEM;
+	prandom_bytes(csum_bench_buf, CSUM_BENCH_BUF_SIZE);
+
+	ret = csum_bench_verify();
+	if (!ret)
+		csum_bench_run();
+
+	kfree(csum_bench_buf);
+
+	return ret;
+}
+module_init(csum_bench_init);
+
+static void __exit csum_bench_exit(void)
+{
+}
+module_exit(csum_bench_exit);
+
+MODULE_DESCRIPTION("arm64 checksum and CRC32 benchmark");
+MODULE_LICENSE("GPL v2");
@@ -20,6 +20,9 @@
 
 #include <linux/bpf.h>
 #include <linux/filter.h>
+#include <linux/hashtable.h>
+#include <linux/jhash.h>
+#include <linux/mutex.h>
 #include <linux/printk.h>
 #include <linux/skbuff.h>
 #include <linux/slab.h>
@@ -76,23 +79,6 @@ static inline void emit(const u32 insn, struct jit_ctx *ctx)
 	ctx->idx++;
 }
 
-static inline void emit_a64_mov_i64(const int reg, const u64 val,
-				    struct jit_ctx *ctx)
-{
-	u64 tmp = val;
-	int shift = 0;
-
-	emit(A64_MOVZ(1, reg, tmp & 0xffff, shift), ctx);
-	tmp >>= 16;
-	shift += 16;
-	while (tmp) {
-		if (tmp & 0xffff)
-			emit(A64_MOVK(1, reg, tmp & 0xffff, shift), ctx);
-		tmp >>= 16;
-		shift += 16;
-	}
-}
-
 static inline void emit_a64_mov_i(const int is64, const int reg,
 				  const s32 val, struct jit_ctx *ctx)
 {
@@ -113,6 +99,48 @@ static inline void emit_a64_mov_i(const int is64, const int reg,
 	}
 }
 
+/* Number of 16-bit blocks of @val that aren't all zeros (or all ones) */
+static int i64_i16_blocks(const u64 val, bool inverse)
+{
+	const u16 fill = inverse ? 0xffff : 0x0000;
+
+	return (((val >>  0) & 0xffff) != fill) +
+	       (((val >> 16) & 0xffff) != fill) +
+	       (((val >> 32) & 0xffff) != fill) +
+	       (((val >> 48) & 0xffff) != fill);
+}
+
+/*
+ * Values that fit in 32 bits use the W form, which zero extends. Others
+ * start from MOVN when more blocks are all ones than all zeros, which
+ * covers kernel addresses, and only patch the remaining blocks.
+ */
+static inline void emit_a64_mov_i64(const int reg, const u64 val,
+				    struct jit_ctx *ctx)
+{
+	bool inverse;
+	int shift;
+
+	if (!(val >> 32)) {
+		emit_a64_mov_i(0, reg, (u32)val, ctx);
+		return;
+	}
+
+	inverse = i64_i16_blocks(val, true) < i64_i16_blocks(val, false);
+	/* ~val is 0 for all ones, which a single MOVN at shift 0 loads */
+	shift = max(round_down(fls64(inverse ? ~val : val) - 1, 16), 0);
+	if (inverse)
+		emit(A64_MOVN(1, reg, (~val >> shift) & 0xffff, shift), ctx);
+	else
+		emit(A64_MOVZ(1, reg, (val >> shift) & 0xffff, shift), ctx);
+
+	for (shift -= 16; shift >= 0; shift -= 16) {
+		if (((val >> shift) & 0xffff) != (inverse ? 0xffff : 0x0000))
+			emit(A64_MOVK(1, reg, (val >> shift) & 0xffff, shift),
+			     ctx);
+	}
+}
+
 static inline int bpf2a64_offset(int bpf_to, int bpf_from,
 				 const struct jit_ctx *ctx)
 {
@@ -818,24 +846,158 @@ void bpf_jit_compile(struct bpf_prog *prog)
 	/* Nothing to do here. We support Internal BPF. */
 }
 
+/*
+ * Images are shared between programs with the same instructions, such as
+ * socket filters that are attached again and again. The image only
+ * depends on the instructions: helper and map addresses are already
+ * resolved into them and the stack layout is fixed. Entries are keyed by
+ * the instructions before blinding, so an identical program skips the
+ * blinding as well, and blinded and plain images are kept apart so a
+ * program that needs blinding never runs a plain one. A lookup compares
+ * all instructions, not just the hash.
+ */
+struct jit_cache_entry {
+	struct hlist_node node;
+	struct hlist_node image_node;
+	u32 hash;
+	bool blinded;
+	unsigned int users;
+	struct bpf_binary_header *header;
+	void *image;
+	u32 len;
+	struct bpf_insn insns[];
+};
+
+#define JIT_CACHE_BITS 6
+
+static DEFINE_HASHTABLE(jit_cache, JIT_CACHE_BITS);
+static DEFINE_HASHTABLE(jit_cache_images, JIT_CACHE_BITS);
+static DEFINE_MUTEX(jit_cache_lock);
+
+static u32 jit_cache_hash(const struct bpf_prog *prog)
+{
+	return jhash2((const u32 *)prog->insnsi,
+		      prog->len * sizeof(struct bpf_insn) / sizeof(u32),
+		      prog->len);
+}
+
+/* Point @prog at a cached image, the cache lock must be held */
+static bool jit_cache_get(struct bpf_prog *prog, u32 hash, bool blinded)
+{
+	struct jit_cache_entry *e;
+
+	hash_for_each_possible(jit_cache, e, node, hash) {
+		if (e->hash != hash || e->blinded != blinded ||
+		    e->len != prog->len ||
+		    memcmp(e->insns, prog->insnsi,
+			   prog->len * sizeof(struct bpf_insn)))
+			continue;
+
+		e->users++;
+		prog->bpf_func = e->image;
+		prog->jited = 1;
+		return true;
+	}
+
+	return false;
+}
+
+/* Take a copy of the instructions until the image has been built */
+static struct jit_cache_entry *jit_cache_alloc(const struct bpf_prog *prog,
+					       u32 hash, bool blinded)
+{
+	struct jit_cache_entry *e;
+
+	e = kmalloc(sizeof(*e) + prog->len * sizeof(struct bpf_insn),
+		    GFP_KERNEL);
+	if (e == NULL)
+		return NULL;
+
+	e->hash = hash;
+	e->blinded = blinded;
+	e->users = 1;
+	e->len = prog->len;
+	memcpy(e->insns, prog->insnsi, prog->len * sizeof(struct bpf_insn));
+
+	return e;
+}
+
+static void jit_cache_add(struct jit_cache_entry *e,
+			  struct bpf_binary_header *header, void *image)
+{
+	e->header = header;
+	e->image = image;
+	hash_add(jit_cache, &e->node, e->hash);
+	hash_add(jit_cache_images, &e->image_node, (unsigned long)header);
+}
+
+/*
+ * Drop a program's reference to its image. Returns true while other
+ * programs still run the image, the caller frees it otherwise.
+ */
+static bool jit_cache_put(struct bpf_binary_header *header)
+{
+	struct jit_cache_entry *e;
+	bool shared = false;
+
+	mutex_lock(&jit_cache_lock);
+	hash_for_each_possible(jit_cache_images, e, image_node,
+			       (unsigned long)header) {
+		if (e->header != header)
+			continue;
+
+		if (--e->users) {
+			shared = true;
+		} else {
+			hash_del(&e->node);
+			hash_del(&e->image_node);
+			kfree(e);
+		}
+		break;
+	}
+	mutex_unlock(&jit_cache_lock);
+
+	return shared;
+}
+
 struct bpf_prog *bpf_int_jit_compile(struct bpf_prog *prog)
 {
 	struct bpf_prog *tmp, *orig_prog = prog;
-	struct bpf_binary_header *header;
+	struct bpf_binary_header *header = NULL;
+	struct jit_cache_entry *entry;
 	bool tmp_blinded = false;
+	bool blind;
 	struct jit_ctx ctx;
 	int image_size;
 	u8 *image_ptr;
+	u32 hash;
 
 	if (!bpf_jit_enable)
 		return orig_prog;
 
+	/*
+	 * Look the original instructions up first, so an identical program
+	 * doesn't pay for blinding its constants again. The lock is held
+	 * across the build so two identical programs don't both build.
+	 */
+	blind = bpf_jit_blinding_enabled();
+	hash = jit_cache_hash(prog);
+	mutex_lock(&jit_cache_lock);
+	if (jit_cache_get(prog, hash, blind)) {
+		mutex_unlock(&jit_cache_lock);
+		return prog;
+	}
+	entry = jit_cache_alloc(prog, hash, blind);
+
 	tmp = bpf_jit_blind_constants(prog);
 	/* If blinding was requested and we failed during blinding,
 	 * we must fall back to the interpreter.
 	 */
-	if (IS_ERR(tmp))
+	if (IS_ERR(tmp)) {
+		mutex_unlock(&jit_cache_lock);
+		kfree(entry);
 		return orig_prog;
+	}
 	if (tmp != prog) {
 		tmp_blinded = true;
 		prog = tmp;
@@ -913,6 +1075,11 @@ struct bpf_prog *bpf_int_jit_compile(struct bpf_prog *prog)
 	if (tmp_blinded)
 		bpf_jit_prog_release_other(prog, prog == orig_prog ?
 					   tmp : orig_prog);
+	if (prog->jited && entry)
+		jit_cache_add(entry, header, prog->bpf_func);
+	else
+		kfree(entry);
+	mutex_unlock(&jit_cache_lock);
 	return prog;
 }
 
@@ -924,6 +1091,9 @@ void bpf_jit_free(struct bpf_prog *prog)
 	if (!prog->jited)
 		goto free_filter;
 
+	if (jit_cache_put(header))
+		goto free_filter;
+
 	set_memory_rw(addr, header->pages);
 	bpf_jit_binary_free(header);
 
@@ -75,6 +75,7 @@ static void blkg_free(struct blkcg_gq *blkg)
 	if (blkg->blkcg != &blkcg_root)
 		blk_exit_rl(&blkg->rl);
 
+	free_percpu(blkg->lat_stat);
 	blkg_rwstat_exit(&blkg->stat_ios);
 	blkg_rwstat_exit(&blkg->stat_bytes);
 	kfree(blkg);
@@ -103,6 +104,10 @@ static struct blkcg_gq *blkg_alloc(struct blkcg *blkcg, struct request_queue *q,
 	    blkg_rwstat_init(&blkg->stat_ios, gfp_mask))
 		goto err_free;
 
+	blkg->lat_stat = alloc_percpu_gfp(struct blkg_lat_stat, gfp_mask);
+	if (!blkg->lat_stat)
+		goto err_free;
+
 	blkg->q = q;
 	INIT_LIST_HEAD(&blkg->q_node);
 	blkg->blkcg = blkcg;
@@ -450,8 +455,13 @@ static int blkcg_reset_stats(struct cgroup_subsys_state *css,
 	 * anyway.  If you get hit by a race, retry.
 	 */
 	hlist_for_each_entry(blkg, &blkcg->blkg_list, blkcg_node) {
+		int cpu;
+
 		blkg_rwstat_reset(&blkg->stat_bytes);
 		blkg_rwstat_reset(&blkg->stat_ios);
+		for_each_possible_cpu(cpu)
+			memset(per_cpu_ptr(blkg->lat_stat, cpu), 0,
+			       sizeof(struct blkg_lat_stat));
 
 		for (i = 0; i < BLKCG_MAX_POLS; i++) {
 			struct blkcg_policy *pol = blkcg_policy[i];
@@ -906,12 +916,119 @@ static int blkcg_print_stat(struct seq_file *sf, void *v)
 	return 0;
 }
 
+static const char *blkg_lat_op_names[BLKG_LAT_NR_OPS] = {
+	[BLKG_LAT_READ]		= "read",
+	[BLKG_LAT_WRITE]	= "write",
+	[BLKG_LAT_DISCARD]	= "discard",
+	[BLKG_LAT_FLUSH]	= "flush",
+};
+
+static void blkg_lat_sum(struct blkcg_gq *blkg, struct blkg_lat_stat *sum)
+{
+	int cpu, op, i;
+
+	memset(sum, 0, sizeof(*sum));
+	for_each_possible_cpu(cpu) {
+		struct blkg_lat_stat *s = per_cpu_ptr(blkg->lat_stat, cpu);
+
+		for (op = 0; op < BLKG_LAT_NR_OPS; op++)
+			for (i = 0; i < BLKG_LAT_BUCKETS; i++)
+				sum->bucket[op][i] += s->bucket[op][i];
+	}
+}
+
+/* upper bound in usecs of the bucket holding the @pct'th percentile */
+static u64 blkg_lat_pct(const u64 *bucket, u64 total, unsigned int pct)
+{
+	u64 want = div_u64(total * pct + 99, 100), seen = 0;
+	int i;
+
+	for (i = 0; i < BLKG_LAT_BUCKETS - 1; i++) {
+		seen += bucket[i];
+		if (seen >= want)
+			break;
+	}
+	return (2ULL << i) - 1;
+}
+
+/*
+ * io_latency: per device and op, the number of completed requests and the
+ * p50/p90/p99 latency in usecs.  io_latency_hist: the raw buckets.
+ */
+static int blkcg_print_lat(struct seq_file *sf, bool hist)
+{
+	struct blkcg *blkcg = css_to_blkcg(seq_css(sf));
+	struct blkg_lat_stat *sum;
+	struct blkcg_gq *blkg;
+	int op, i;
+
+	sum = kmalloc(sizeof(*sum), GFP_KERNEL);
+	if (!sum)
+		return -ENOMEM;
+
+	rcu_read_lock();
+
+	hlist_for_each_entry_rcu(blkg, &blkcg->blkg_list, blkcg_node) {
+		const char *dname = blkg_dev_name(blkg);
+
+		if (!dname)
+			continue;
+
+		blkg_lat_sum(blkg, sum);
+
+		for (op = 0; op < BLKG_LAT_NR_OPS; op++) {
+			const u64 *bucket = sum->bucket[op];
+			u64 total = 0;
+
+			for (i = 0; i < BLKG_LAT_BUCKETS; i++)
+				total += bucket[i];
+			if (!total)
+				continue;
+
+			seq_printf(sf, "%s %s", dname, blkg_lat_op_names[op]);
+			if (hist) {
+				for (i = 0; i < BLKG_LAT_BUCKETS; i++)
+					seq_printf(sf, " %llu", bucket[i]);
+				seq_putc(sf, '\n');
+			} else {
+				seq_printf(sf, " ios=%llu p50=%llu p90=%llu p99=%llu\n",
+					   total,
+					   blkg_lat_pct(bucket, total, 50),
+					   blkg_lat_pct(bucket, total, 90),
+					   blkg_lat_pct(bucket, total, 99));
+			}
+		}
+	}
+
+	rcu_read_unlock();
+	kfree(sum);
+	return 0;
+}
+
+static int blkcg_print_lat_summary(struct seq_file *sf, void *v)
+{
+	return blkcg_print_lat(sf, false);
+}
+
+static int blkcg_print_lat_hist(struct seq_file *sf, void *v)
+{
+	return blkcg_print_lat(sf, true);
+}
+
 static struct cftype blkcg_files[] = {
 	{
 		.name = "stat",
 		.flags = CFTYPE_NOT_ON_ROOT,
 		.seq_show = blkcg_print_stat,
 	},
+	{
+		.name = "io_latency",
+		.seq_show = blkcg_print_lat_summary,
+	},
+	{
+		.name = "io_latency_hist",
+		.seq_show = blkcg_print_lat_hist,
+	},
 	{ }	/* terminate */
 };
 
@@ -920,6 +1037,14 @@ static struct cftype blkcg_legacy_files[] = {
 		.name = "reset_stats",
 		.write_u64 = blkcg_reset_stats,
 	},
+	{
+		.name = "io_latency",
+		.seq_show = blkcg_print_lat_summary,
+	},
+	{
+		.name = "io_latency_hist",
+		.seq_show = blkcg_print_lat_hist,
+	},
 	{ }	/* terminate */
 };
 
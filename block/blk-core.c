@@ -533,6 +533,10 @@ void blk_cleanup_queue(struct request_queue *q)
 {
 	spinlock_t *lock = q->queue_lock;
 
+	/* pending discards are only advisory, drop them */
+	if (q->discard_q)
+		blk_cleanup_discard_queue(q);
+
 	/* mark @q DYING, no new request or merges will be allowed afterwards */
 	mutex_lock(&q->sysfs_lock);
 	blk_set_queue_dying(q);
@@ -836,6 +840,14 @@ blk_init_allocated_queue(struct request_queue *q, request_fn_proc *rfn,
 	if (blk_init_rl(&q->root_rl, q, GFP_KERNEL))
 		goto fail;
 
+	q->discard_q = blk_alloc_discard_queue(q);
+	if (!q->discard_q)
+		goto fail;
+
+	q->plug_stat = alloc_percpu(struct blk_plug_stat);
+	if (!q->plug_stat)
+		goto fail;
+
 	INIT_WORK(&q->timeout_work, blk_timeout_work);
 	q->request_fn		= rfn;
 	q->prep_rq_fn		= NULL;
@@ -867,6 +879,10 @@ blk_init_allocated_queue(struct request_queue *q, request_fn_proc *rfn,
 	return q;
 
 fail:
+	free_percpu(q->plug_stat);
+	q->plug_stat = NULL;
+	kfree(q->discard_q);
+	q->discard_q = NULL;
 	blk_free_flush_queue(q->fq);
 	q->fq = NULL;
 	return NULL;
@@ -1686,6 +1702,9 @@ static blk_qc_t blk_queue_bio(struct request_queue *q, struct bio *bio)
 		return BLK_QC_T_NONE;
 	}
 
+	if (q->discard_q)
+		blk_discard_note_bio(q, bio);
+
 	if (bio->bi_opf & (REQ_PREFLUSH | REQ_FUA)) {
 		spin_lock_irq(q->queue_lock);
 		where = ELEVATOR_INSERT_FLUSH;
@@ -1704,6 +1723,17 @@ static blk_qc_t blk_queue_bio(struct request_queue *q, struct bio *bio)
 
 	spin_lock_irq(q->queue_lock);
 
+	/*
+	 * A plug that already holds requests for @q gets sorted and
+	 * insert-merged as a whole when it is flushed, which also catches
+	 * back merges with requests already queued.  Don't search the
+	 * elevator under the queue lock for each of its bios as well.
+	 */
+	if (request_count) {
+		this_cpu_inc(q->plug_stat->lookups_skipped);
+		goto get_rq;
+	}
+
 	el_ret = elv_merge(q, &req, bio);
 	if (el_ret == ELEVATOR_BACK_MERGE) {
 		if (bio_attempt_back_merge(q, req, bio)) {
@@ -2767,6 +2797,7 @@ void blk_finish_request(struct request *req, int error)
 	if (req->cmd_flags & REQ_DONTPREP)
 		blk_unprep_request(req);
 
+	blkg_account_io_latency(req);
 	blk_account_io_done(req);
 
 	if (req->end_io)
@@ -3236,6 +3267,11 @@ static void queue_unplugged(struct request_queue *q, unsigned int depth,
 {
 	trace_block_unplug(q, depth, !from_schedule);
 
+	if (q->plug_stat) {
+		this_cpu_inc(q->plug_stat->flushes);
+		this_cpu_add(q->plug_stat->requests, depth);
+	}
+
 	if (from_schedule)
 		blk_run_queue_async(q);
 	else
@@ -6,6 +6,8 @@
 #include <linux/bio.h>
 #include <linux/blkdev.h>
 #include <linux/scatterlist.h>
+#include <linux/rbtree.h>
+#include <linux/workqueue.h>
 
 #include "blk.h"
 
@@ -119,6 +121,348 @@ int __blkdev_issue_discard(struct block_device *bdev, sector_t sector,
 }
 EXPORT_SYMBOL(__blkdev_issue_discard);
 
+struct blk_discard_range {
+	struct rb_node		node;
+	sector_t		start;
+	sector_t		end;
+};
+
+#define BLK_DISCARD_IDLE_MS	1000
+#define BLK_DISCARD_SLICE_MS	100
+
+static inline struct blk_discard_range *rb_to_discard(struct rb_node *node)
+{
+	return node ? rb_entry(node, struct blk_discard_range, node) : NULL;
+}
+
+/* last range starting at or before @sector */
+static struct blk_discard_range *blk_discard_prev(struct blk_discard_queue *dq,
+						  sector_t sector)
+{
+	struct rb_node *node = dq->ranges.rb_node;
+	struct blk_discard_range *r, *prev = NULL;
+
+	while (node) {
+		r = rb_to_discard(node);
+		if (r->start <= sector) {
+			prev = r;
+			node = node->rb_right;
+		} else {
+			node = node->rb_left;
+		}
+	}
+	return prev;
+}
+
+/* first range ending after @sector */
+static struct blk_discard_range *blk_discard_first(struct blk_discard_queue *dq,
+						   sector_t sector)
+{
+	struct blk_discard_range *r = blk_discard_prev(dq, sector);
+
+	if (r && r->end > sector)
+		return r;
+	return r ? rb_to_discard(rb_next(&r->node)) :
+		   rb_to_discard(rb_first(&dq->ranges));
+}
+
+static void blk_discard_link(struct blk_discard_queue *dq,
+			     struct blk_discard_range *r)
+{
+	struct rb_node **p = &dq->ranges.rb_node, *parent = NULL;
+
+	while (*p) {
+		parent = *p;
+		if (r->start < rb_to_discard(parent)->start)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+	rb_link_node(&r->node, parent, p);
+	rb_insert_color(&r->node, &dq->ranges);
+}
+
+static void blk_discard_erase(struct blk_discard_queue *dq,
+			      struct blk_discard_range *r)
+{
+	rb_erase(&r->node, &dq->ranges);
+	kfree(r);
+}
+
+/*
+ * Add [@start, @end) keeping the ranges sorted and disjoint, folding in
+ * every range it overlaps or touches.  Returns @new if it wasn't needed.
+ */
+static struct blk_discard_range *blk_discard_insert(struct blk_discard_queue *dq,
+		sector_t start, sector_t end, struct blk_discard_range *new)
+{
+	struct blk_discard_range *r, *next;
+	bool merged = false;
+
+	r = blk_discard_prev(dq, start);
+	if (r && r->end >= start) {
+		r->end = max(r->end, end);
+		merged = true;
+	} else {
+		r = new;
+		new = NULL;
+		r->start = start;
+		r->end = end;
+		blk_discard_link(dq, r);
+	}
+
+	while ((next = rb_to_discard(rb_next(&r->node))) &&
+	       next->start <= r->end) {
+		r->end = max(r->end, next->end);
+		blk_discard_erase(dq, next);
+		merged = true;
+	}
+
+	if (merged)
+		dq->merged_sectors += end - start;
+	return new;
+}
+
+/*
+ * Remove [@start, @end) from the pending ranges.  Only called when the
+ * sectors are about to be written, so if a split can't get memory the
+ * tail is simply dropped - not discarding is always safe.
+ */
+static void blk_discard_cancel(struct blk_discard_queue *dq, sector_t start,
+			       sector_t end)
+{
+	struct blk_discard_range *r, *next, *tail;
+
+	for (r = blk_discard_first(dq, start); r && r->start < end; r = next) {
+		next = rb_to_discard(rb_next(&r->node));
+
+		if (r->start < start && r->end > end) {
+			tail = kmalloc(sizeof(*tail), GFP_ATOMIC);
+			if (tail) {
+				tail->start = end;
+				tail->end = r->end;
+				dq->cancelled_sectors += end - start;
+			} else {
+				dq->cancelled_sectors += r->end - start;
+			}
+			r->end = start;
+			if (tail)
+				blk_discard_link(dq, tail);
+			break;
+		}
+
+		if (r->start < start) {
+			dq->cancelled_sectors += r->end - start;
+			r->end = start;
+		} else if (r->end > end) {
+			dq->cancelled_sectors += end - r->start;
+			r->start = end;
+		} else {
+			dq->cancelled_sectors += r->end - r->start;
+			blk_discard_erase(dq, r);
+		}
+	}
+}
+
+static bool blk_discard_issuing(struct blk_discard_queue *dq, sector_t start,
+				sector_t end)
+{
+	unsigned long flags;
+	bool ret;
+
+	spin_lock_irqsave(&dq->lock, flags);
+	ret = dq->issuing_start < end && start < dq->issuing_end;
+	spin_unlock_irqrestore(&dq->lock, flags);
+	return ret;
+}
+
+/**
+ * blk_discard_note_bio - let the discard queue see a bio
+ * @q:		request queue the bio is submitted to
+ * @bio:	the bio, already remapped to the whole disk
+ *
+ * Any bio restarts the idle period.  A write also takes its sectors out
+ * of the pending discards, and waits if they are being discarded right
+ * now, so a deferred discard never lands on data written after it was
+ * queued.
+ */
+void blk_discard_note_bio(struct request_queue *q, struct bio *bio)
+{
+	struct blk_discard_queue *dq = q->discard_q;
+	sector_t start, end;
+	unsigned long flags;
+	bool wait;
+
+	if (bio_op(bio) == REQ_OP_DISCARD || bio_op(bio) == REQ_OP_SECURE_ERASE)
+		return;
+
+	if (READ_ONCE(dq->last_io) != jiffies)
+		WRITE_ONCE(dq->last_io, jiffies);
+
+	if (bio_data_dir(bio) != WRITE || !bio_sectors(bio))
+		return;
+	if (RB_EMPTY_ROOT(&dq->ranges) &&
+	    READ_ONCE(dq->issuing_start) == READ_ONCE(dq->issuing_end))
+		return;
+
+	start = bio->bi_iter.bi_sector;
+	end = bio_end_sector(bio);
+
+	spin_lock_irqsave(&dq->lock, flags);
+	blk_discard_cancel(dq, start, end);
+	wait = dq->issuing_start < end && start < dq->issuing_end;
+	spin_unlock_irqrestore(&dq->lock, flags);
+
+	if (wait)
+		wait_event(dq->wait, !blk_discard_issuing(dq, start, end));
+}
+
+static void blk_discard_work(struct work_struct *work)
+{
+	struct blk_discard_queue *dq = container_of(to_delayed_work(work),
+					struct blk_discard_queue, work);
+	unsigned long idle = msecs_to_jiffies(dq->idle_ms);
+	unsigned long since = jiffies - READ_ONCE(dq->last_io);
+	struct block_device *bdev = dq->bdev;
+	struct blk_discard_range *r;
+	sector_t start, len, budget;
+	unsigned int max_sects;
+
+	if (since < idle) {
+		queue_delayed_work(system_long_wq, &dq->work, idle - since);
+		return;
+	}
+
+	bdgrab(bdev);
+	if (blkdev_get(bdev, FMODE_WRITE, NULL)) {
+		/* the disk is gone, so are the blocks we wanted to discard */
+		spin_lock_irq(&dq->lock);
+		while ((r = rb_to_discard(rb_first(&dq->ranges))))
+			blk_discard_erase(dq, r);
+		spin_unlock_irq(&dq->lock);
+		return;
+	}
+
+	max_sects = max(bdev_get_queue(bdev)->limits.max_discard_sectors, 1U);
+	budget = dq->max_kbps ?
+		max_t(sector_t, (sector_t)dq->max_kbps * 2 *
+				BLK_DISCARD_SLICE_MS / MSEC_PER_SEC, 1) :
+		(sector_t)-1;
+
+	while (budget) {
+		spin_lock_irq(&dq->lock);
+		r = rb_to_discard(rb_first(&dq->ranges));
+		if (!r) {
+			spin_unlock_irq(&dq->lock);
+			break;
+		}
+		start = r->start;
+		len = min3(r->end - r->start, (sector_t)max_sects, budget);
+		r->start += len;
+		if (r->start == r->end)
+			blk_discard_erase(dq, r);
+		dq->issuing_start = start;
+		dq->issuing_end = start + len;
+		spin_unlock_irq(&dq->lock);
+
+		blkdev_issue_discard(bdev, start, len, GFP_NOIO, 0);
+
+		spin_lock_irq(&dq->lock);
+		dq->issued_sectors += len;
+		dq->issuing_start = dq->issuing_end = 0;
+		spin_unlock_irq(&dq->lock);
+		wake_up_all(&dq->wait);
+
+		budget -= len;
+		if (jiffies - READ_ONCE(dq->last_io) < idle)
+			break;
+	}
+
+	blkdev_put(bdev, FMODE_WRITE);
+
+	if (!RB_EMPTY_ROOT(&dq->ranges))
+		queue_delayed_work(system_long_wq, &dq->work,
+				   msecs_to_jiffies(BLK_DISCARD_SLICE_MS));
+}
+
+/*
+ * Queue a discard for blk_discard_work().  Returns -EAGAIN when the
+ * caller should issue it synchronously instead.
+ */
+static int blk_queue_discard_async(struct block_device *bdev, sector_t sector,
+				   sector_t nr_sects, gfp_t gfp_mask)
+{
+	struct request_queue *q = bdev_get_queue(bdev);
+	struct blk_discard_queue *dq = q ? q->discard_q : NULL;
+	struct block_device *whole = bdev->bd_contains;
+	struct blk_discard_range *new;
+	sector_t bs_mask;
+
+	if (!dq || !READ_ONCE(dq->enabled) || !blk_queue_discard(q))
+		return -EAGAIN;
+	bs_mask = (bdev_logical_block_size(bdev) >> 9) - 1;
+	if (!nr_sects || ((sector | nr_sects) & bs_mask))
+		return -EAGAIN;
+
+	new = kmalloc(sizeof(*new), gfp_mask);
+	if (!new)
+		return -EAGAIN;
+
+	sector += get_start_sect(bdev);
+
+	spin_lock_irq(&dq->lock);
+	if (!dq->bdev)
+		dq->bdev = bdgrab(whole);
+	if (dq->bdev != whole) {
+		spin_unlock_irq(&dq->lock);
+		kfree(new);
+		return -EAGAIN;
+	}
+	new = blk_discard_insert(dq, sector, sector + nr_sects, new);
+	dq->queued_sectors += nr_sects;
+	spin_unlock_irq(&dq->lock);
+
+	kfree(new);
+	queue_delayed_work(system_long_wq, &dq->work,
+			   msecs_to_jiffies(dq->idle_ms));
+	return 0;
+}
+
+struct blk_discard_queue *blk_alloc_discard_queue(struct request_queue *q)
+{
+	struct blk_discard_queue *dq;
+
+	dq = kzalloc_node(sizeof(*dq), GFP_KERNEL, q->node);
+	if (!dq)
+		return NULL;
+
+	spin_lock_init(&dq->lock);
+	dq->ranges = RB_ROOT;
+	init_waitqueue_head(&dq->wait);
+	INIT_DELAYED_WORK(&dq->work, blk_discard_work);
+	dq->idle_ms = BLK_DISCARD_IDLE_MS;
+	return dq;
+}
+
+void blk_cleanup_discard_queue(struct request_queue *q)
+{
+	struct blk_discard_queue *dq = q->discard_q;
+	struct blk_discard_range *r;
+
+	WRITE_ONCE(dq->enabled, false);
+	cancel_delayed_work_sync(&dq->work);
+
+	spin_lock_irq(&dq->lock);
+	while ((r = rb_to_discard(rb_first(&dq->ranges))))
+		blk_discard_erase(dq, r);
+	spin_unlock_irq(&dq->lock);
+
+	if (dq->bdev) {
+		bdput(dq->bdev);
+		dq->bdev = NULL;
+	}
+}
+
 /**
  * blkdev_issue_discard - queue a discard
  * @bdev:	blockdev to issue discard for
@@ -128,7 +472,9 @@ EXPORT_SYMBOL(__blkdev_issue_discard);
  * @flags:	BLKDEV_IFL_* flags to control behaviour
  *
  * Description:
- *    Issue a discard request for the sectors in question.
+ *    Issue a discard request for the sectors in question.  With
+ *    BLKDEV_DISCARD_ASYNC, and discard_async enabled on the queue, the
+ *    discard is only queued and goes out once the device is idle.
  */
 int blkdev_issue_discard(struct block_device *bdev, sector_t sector,
 		sector_t nr_sects, gfp_t gfp_mask, unsigned long flags)
@@ -137,6 +483,11 @@ int blkdev_issue_discard(struct block_device *bdev, sector_t sector,
 	struct blk_plug plug;
 	int ret;
 
+	if ((flags & BLKDEV_DISCARD_ASYNC) &&
+	    !(flags & (BLKDEV_DISCARD_SECURE | BLKDEV_DISCARD_ZERO)) &&
+	    !blk_queue_discard_async(bdev, sector, nr_sects, gfp_mask))
+		return 0;
+
 	blk_start_plug(&plug);
 	ret = __blkdev_issue_discard(bdev, sector, nr_sects, gfp_mask, flags,
 			&bio);
@@ -181,6 +181,96 @@ static ssize_t queue_discard_max_store(struct request_queue *q,
 	return ret;
 }
 
+#define QUEUE_DISCARD_Q_FUNCS(name, field, min)				\
+static ssize_t queue_discard_##name##_show(struct request_queue *q,	\
+					   char *page)			\
+{									\
+	if (!q->discard_q)						\
+		return -EOPNOTSUPP;					\
+	return queue_var_show(q->discard_q->field, page);		\
+}									\
+									\
+static ssize_t queue_discard_##name##_store(struct request_queue *q,	\
+					    const char *page, size_t count) \
+{									\
+	unsigned long val;						\
+	ssize_t ret;							\
+									\
+	if (!q->discard_q)						\
+		return -EOPNOTSUPP;					\
+	ret = queue_var_store(&val, page, count);			\
+	if (ret < 0)							\
+		return ret;						\
+	q->discard_q->field = max_t(unsigned long, val, min);		\
+	return ret;							\
+}
+QUEUE_DISCARD_Q_FUNCS(idle_ms, idle_ms, 1)
+QUEUE_DISCARD_Q_FUNCS(max_kbps, max_kbps, 0)
+#undef QUEUE_DISCARD_Q_FUNCS
+
+static ssize_t queue_discard_async_show(struct request_queue *q, char *page)
+{
+	if (!q->discard_q)
+		return -EOPNOTSUPP;
+	return queue_var_show(q->discard_q->enabled, page);
+}
+
+static ssize_t queue_discard_async_store(struct request_queue *q,
+					 const char *page, size_t count)
+{
+	unsigned long val;
+	ssize_t ret;
+
+	if (!q->discard_q)
+		return -EOPNOTSUPP;
+	ret = queue_var_store(&val, page, count);
+	if (ret < 0)
+		return ret;
+	WRITE_ONCE(q->discard_q->enabled, !!val);
+	return ret;
+}
+
+static ssize_t queue_discard_stat_show(struct request_queue *q, char *page)
+{
+	struct blk_discard_queue *dq = q->discard_q;
+	u64 queued, merged, issued, cancelled;
+
+	if (!dq)
+		return -EOPNOTSUPP;
+
+	spin_lock_irq(&dq->lock);
+	queued = dq->queued_sectors;
+	merged = dq->merged_sectors;
+	issued = dq->issued_sectors;
+	cancelled = dq->cancelled_sectors;
+	spin_unlock_irq(&dq->lock);
+
+	return sprintf(page, "queued %llu merged %llu issued %llu cancelled %llu\n",
+		       queued, merged, issued, cancelled);
+}
+
+static ssize_t queue_plug_stat_show(struct request_queue *q, char *page)
+{
+	struct blk_plug_stat sum = { 0 };
+	int cpu;
+
+	if (!q->plug_stat)
+		return -EOPNOTSUPP;
+
+	for_each_possible_cpu(cpu) {
+		struct blk_plug_stat *s = per_cpu_ptr(q->plug_stat, cpu);
+
+		sum.flushes += s->flushes;
+		sum.requests += s->requests;
+		sum.merged += s->merged;
+		sum.lookups_skipped += s->lookups_skipped;
+	}
+
+	return sprintf(page, "flushes %lu requests %lu merged %lu lookups_skipped %lu\n",
+		       sum.flushes, sum.requests, sum.merged,
+		       sum.lookups_skipped);
+}
+
 static ssize_t queue_discard_zeroes_data_show(struct request_queue *q, char *page)
 {
 	return queue_var_show(queue_discard_zeroes_data(q), page);
@@ -464,6 +554,34 @@ static struct queue_sysfs_entry queue_discard_max_hw_entry = {
 	.show = queue_discard_max_hw_show,
 };
 
+static struct queue_sysfs_entry queue_discard_async_entry = {
+	.attr = {.name = "discard_async", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_discard_async_show,
+	.store = queue_discard_async_store,
+};
+
+static struct queue_sysfs_entry queue_discard_idle_ms_entry = {
+	.attr = {.name = "discard_idle_ms", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_discard_idle_ms_show,
+	.store = queue_discard_idle_ms_store,
+};
+
+static struct queue_sysfs_entry queue_discard_max_kbps_entry = {
+	.attr = {.name = "discard_max_kbps", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_discard_max_kbps_show,
+	.store = queue_discard_max_kbps_store,
+};
+
+static struct queue_sysfs_entry queue_discard_stat_entry = {
+	.attr = {.name = "discard_stat", .mode = S_IRUGO },
+	.show = queue_discard_stat_show,
+};
+
+static struct queue_sysfs_entry queue_plug_stat_entry = {
+	.attr = {.name = "plug_stat", .mode = S_IRUGO },
+	.show = queue_plug_stat_show,
+};
+
 static struct queue_sysfs_entry queue_discard_max_entry = {
 	.attr = {.name = "discard_max_bytes", .mode = S_IRUGO | S_IWUSR },
 	.show = queue_discard_max_show,
@@ -545,6 +663,11 @@ static struct attribute *default_attrs[] = {
 	&queue_discard_max_entry.attr,
 	&queue_discard_max_hw_entry.attr,
 	&queue_discard_zeroes_data_entry.attr,
+	&queue_discard_async_entry.attr,
+	&queue_discard_idle_ms_entry.attr,
+	&queue_discard_max_kbps_entry.attr,
+	&queue_discard_stat_entry.attr,
+	&queue_plug_stat_entry.attr,
 	&queue_write_same_max_entry.attr,
 	&queue_nonrot_entry.attr,
 	&queue_nomerges_entry.attr,
@@ -639,6 +762,8 @@ static void blk_release_queue(struct kobject *kobj)
 	}
 
 	blk_exit_rl(&q->root_rl);
+	kfree(q->discard_q);
+	free_percpu(q->plug_stat);
 
 	if (q->queue_tags)
 		__blk_queue_free_tags(q);
@@ -31,6 +31,36 @@ struct blk_flush_queue {
 	spinlock_t		mq_flush_lock;
 };
 
+/*
+ * Discards queued with BLKDEV_DISCARD_ASYNC wait here, merged by sector,
+ * until the queue has seen no other bio for idle_ms.  They are then issued
+ * at no more than max_kbps, one max_discard_sectors chunk at a time.
+ * Sectors are relative to the whole disk.
+ */
+struct blk_discard_queue {
+	spinlock_t		lock;
+	struct rb_root		ranges;
+	sector_t		issuing_start;	/* chunk in flight, empty if */
+	sector_t		issuing_end;	/* start == end */
+	wait_queue_head_t	wait;
+	struct delayed_work	work;
+	struct block_device	*bdev;
+	unsigned long		last_io;	/* jiffies of the last other bio */
+
+	bool			enabled;
+	unsigned int		idle_ms;
+	unsigned int		max_kbps;
+
+	u64			queued_sectors;
+	u64			merged_sectors;
+	u64			issued_sectors;
+	u64			cancelled_sectors;
+};
+
+struct blk_discard_queue *blk_alloc_discard_queue(struct request_queue *q);
+void blk_cleanup_discard_queue(struct request_queue *q);
+void blk_discard_note_bio(struct request_queue *q, struct bio *bio);
+
 extern struct kmem_cache *blk_requestq_cachep;
 extern struct kmem_cache *request_cachep;
 extern struct kobj_type blk_queue_ktype;
@@ -0,0 +1,527 @@
+/*
+ *  Latency i/o scheduler for single queue flash devices.
+ *
+ *  Requests are split into foreground sync, background sync and async
+ *  classes. Foreground is always served first and never waits for idling;
+ *  background requests are limited to a dispatch depth that shrinks while
+ *  foreground completions miss fg_target_lat and grows back while they
+ *  meet it. Per class latency percentiles are exported in sysfs.
+ */
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/blkdev.h>
+#include <linux/blk-cgroup.h>
+#include <linux/elevator.h>
+#include <linux/bio.h>
+#include <linux/ioprio.h>
+#include <linux/iocontext.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/init.h>
+#include <linux/compiler.h>
+
+static const int bg_expire = HZ / 2;	/* max time before a bg read is dispatched */
+static const int async_expire = 5 * HZ;	/* ditto for async writes */
+static const int fg_window = HZ / 10;	/* fg stays active this long after its last completion */
+static const int fg_target_lat = 20000;	/* us, fg completions slower than this throttle bg */
+static const int bg_max_depth = 16;	/* bg requests on the device when not throttled */
+
+enum lat_class {
+	LAT_FG,		/* sync requests from the foreground */
+	LAT_BG,		/* sync requests from background cgroups or idle ioprio */
+	LAT_ASYNC,	/* buffered writeback */
+	LAT_NR_CLASSES,
+};
+
+/*
+ * Log-linear latency histogram in microseconds: four buckets per power of
+ * two, so a percentile is reported within 25% of its real value. The last
+ * bucket collects everything above ~16s.
+ */
+#define LAT_BUCKETS	96
+
+struct lat_hist {
+	u32 bucket[LAT_BUCKETS];
+	u64 count;
+};
+
+struct lat_data {
+	struct request_queue *queue;
+
+	/*
+	 * run time data
+	 */
+	struct list_head fifo_list[LAT_NR_CLASSES];
+	unsigned int inflight[LAT_NR_CLASSES];
+	unsigned int bg_depth;		/* bg dispatch limit while fg is active */
+	unsigned long fg_last;		/* jiffies of the last fg completion */
+	bool kick_pending;		/* bg held back, rerun queue on completion */
+	unsigned long bg_throttled;	/* times bg dispatch was held back */
+	struct work_struct unplug_work;
+	struct lat_hist hist[LAT_NR_CLASSES];
+
+	/*
+	 * settings that change how the i/o scheduler behaves
+	 */
+	int fifo_expire[LAT_NR_CLASSES];
+	int fg_window;
+	int fg_target_lat;
+	int bg_max_depth;
+};
+
+static inline int lat_rq_class(struct request *rq)
+{
+	return (uintptr_t)rq->elv.priv[0];
+}
+
+static inline unsigned long lat_now_us(void)
+{
+	return (unsigned long)ktime_to_us(ktime_get());
+}
+
+/*
+ * Android keeps the foreground in the root blkio cgroup and moves
+ * background work to child groups, so anything outside the root group is
+ * background unless it asked for RT ioprio. Idle ioprio is always
+ * background.
+ */
+static bool lat_rq_is_fg(struct request *rq)
+{
+	int ioprio = req_get_ioprio(rq);
+
+	if (!ioprio_valid(ioprio) && rq->elv.icq)
+		ioprio = rq->elv.icq->ioc->ioprio;
+
+	switch (IOPRIO_PRIO_CLASS(ioprio)) {
+	case IOPRIO_CLASS_RT:
+		return true;
+	case IOPRIO_CLASS_IDLE:
+		return false;
+	}
+#ifdef CONFIG_BLK_CGROUP
+	if (rq->rl && rq->rl->blkg && rq->rl->blkg->blkcg != &blkcg_root)
+		return false;
+#endif
+	return true;
+}
+
+static int lat_classify(struct request *rq)
+{
+	if (!rq_is_sync(rq))
+		return LAT_ASYNC;
+	return lat_rq_is_fg(rq) ? LAT_FG : LAT_BG;
+}
+
+static unsigned int lat_bucket(unsigned long us)
+{
+	unsigned int msb, idx;
+
+	if (us < 4)
+		return us;
+	msb = fls_long(us) - 1;
+	idx = (msb - 1) * 4 + ((us >> (msb - 2)) & 3);
+	return min(idx, LAT_BUCKETS - 1U);
+}
+
+/* highest latency that lands in bucket @idx */
+static unsigned long lat_bucket_max(unsigned int idx)
+{
+	unsigned int msb;
+
+	if (idx < 4)
+		return idx;
+	msb = idx / 4 + 1;
+	return (((4UL + idx % 4) << (msb - 2)) + (1UL << (msb - 2))) - 1;
+}
+
+static unsigned long lat_hist_pct(struct lat_hist *h, unsigned int pct)
+{
+	u64 want, seen = 0;
+	unsigned int i;
+
+	if (!h->count)
+		return 0;
+	want = div_u64(h->count * pct + 99, 100);
+	for (i = 0; i < LAT_BUCKETS; i++) {
+		seen += h->bucket[i];
+		if (seen >= want)
+			break;
+	}
+	return lat_bucket_max(min(i, LAT_BUCKETS - 1U));
+}
+
+static bool lat_fg_active(struct lat_data *ld)
+{
+	return ld->inflight[LAT_FG] || !list_empty(&ld->fifo_list[LAT_FG]) ||
+		time_before(jiffies, ld->fg_last + ld->fg_window);
+}
+
+static bool lat_bg_allowed(struct lat_data *ld)
+{
+	unsigned int bg = ld->inflight[LAT_BG] + ld->inflight[LAT_ASYNC];
+
+	if (!lat_fg_active(ld))
+		return true;
+	return bg < min_t(unsigned int, ld->bg_depth, ld->bg_max_depth);
+}
+
+/*
+ * add rq to its class fifo
+ */
+static void lat_add_request(struct request_queue *q, struct request *rq)
+{
+	struct lat_data *ld = q->elevator->elevator_data;
+	int cls = lat_classify(rq);
+
+	rq->elv.priv[0] = (void *)(uintptr_t)cls;
+	rq->elv.priv[1] = (void *)lat_now_us();
+	rq->fifo_time = jiffies + ld->fifo_expire[cls];
+	list_add_tail(&rq->queuelist, &ld->fifo_list[cls]);
+}
+
+static int lat_allow_rq_merge(struct request_queue *q, struct request *rq,
+			      struct request *next)
+{
+	return lat_rq_class(rq) == lat_rq_class(next);
+}
+
+static void lat_merged_requests(struct request_queue *q, struct request *req,
+				struct request *next)
+{
+	/*
+	 * if next expires before rq, assign its expire time to rq
+	 * and move into next position (next will be deleted) in fifo
+	 */
+	if (!list_empty(&req->queuelist) && !list_empty(&next->queuelist)) {
+		if (time_before((unsigned long)next->fifo_time,
+				(unsigned long)req->fifo_time)) {
+			list_move(&req->queuelist, &next->queuelist);
+			req->fifo_time = next->fifo_time;
+			req->elv.priv[1] = next->elv.priv[1];
+		}
+	}
+
+	/*
+	 * kill knowledge of next, this one is a goner
+	 */
+	rq_fifo_clear(next);
+}
+
+static void lat_move_to_dispatch(struct lat_data *ld, struct request *rq)
+{
+	rq_fifo_clear(rq);
+	ld->inflight[lat_rq_class(rq)]++;
+	elv_dispatch_add_tail(rq->q, rq);
+}
+
+static struct request *lat_expired_request(struct lat_data *ld, int cls)
+{
+	struct request *rq;
+
+	if (list_empty(&ld->fifo_list[cls]))
+		return NULL;
+	rq = rq_entry_fifo(ld->fifo_list[cls].next);
+	if (time_after_eq(jiffies, (unsigned long)rq->fifo_time))
+		return rq;
+	return NULL;
+}
+
+/*
+ * Foreground first, then background within its depth. Background that
+ * has waited past its expiry goes ahead of foreground so it cannot starve,
+ * but still counts against the depth. Nothing here idles: when the only
+ * queued work is held back, the completion that frees depth reruns the
+ * queue.
+ */
+static int lat_dispatch_requests(struct request_queue *q, int force)
+{
+	struct lat_data *ld = q->elevator->elevator_data;
+	struct request *rq;
+	int cls, dispatched = 0;
+
+	if (unlikely(force)) {
+		for (cls = 0; cls < LAT_NR_CLASSES; cls++) {
+			while (!list_empty(&ld->fifo_list[cls])) {
+				rq = rq_entry_fifo(ld->fifo_list[cls].next);
+				lat_move_to_dispatch(ld, rq);
+				dispatched++;
+			}
+		}
+		return dispatched;
+	}
+
+	if (lat_bg_allowed(ld)) {
+		for (cls = LAT_BG; cls < LAT_NR_CLASSES; cls++) {
+			rq = lat_expired_request(ld, cls);
+			if (rq)
+				goto dispatch_request;
+		}
+	}
+
+	if (!list_empty(&ld->fifo_list[LAT_FG])) {
+		rq = rq_entry_fifo(ld->fifo_list[LAT_FG].next);
+		goto dispatch_request;
+	}
+
+	for (cls = LAT_BG; cls < LAT_NR_CLASSES; cls++) {
+		if (list_empty(&ld->fifo_list[cls]))
+			continue;
+		if (!lat_bg_allowed(ld)) {
+			ld->bg_throttled++;
+			ld->kick_pending = true;
+			return 0;
+		}
+		rq = rq_entry_fifo(ld->fifo_list[cls].next);
+		goto dispatch_request;
+	}
+
+	return 0;
+
+dispatch_request:
+	lat_move_to_dispatch(ld, rq);
+	return 1;
+}
+
+static void lat_completed_request(struct request_queue *q, struct request *rq)
+{
+	struct lat_data *ld = q->elevator->elevator_data;
+	struct lat_hist *h;
+	int cls = lat_rq_class(rq);
+	unsigned long us = lat_now_us() - (unsigned long)rq->elv.priv[1];
+
+	if (ld->inflight[cls])
+		ld->inflight[cls]--;
+
+	h = &ld->hist[cls];
+	h->bucket[lat_bucket(us)]++;
+	h->count++;
+
+	if (cls == LAT_FG) {
+		ld->fg_last = jiffies;
+		if (us > ld->fg_target_lat)
+			ld->bg_depth = max(ld->bg_depth / 2, 1U);
+		else if (ld->bg_depth < ld->bg_max_depth)
+			ld->bg_depth++;
+	}
+
+	if (ld->kick_pending) {
+		ld->kick_pending = false;
+		kblockd_schedule_work(&ld->unplug_work);
+	}
+}
+
+static void lat_kick_queue(struct work_struct *work)
+{
+	struct lat_data *ld = container_of(work, struct lat_data, unplug_work);
+	struct request_queue *q = ld->queue;
+
+	spin_lock_irq(q->queue_lock);
+	__blk_run_queue(q);
+	spin_unlock_irq(q->queue_lock);
+}
+
+static void lat_exit_queue(struct elevator_queue *e)
+{
+	struct lat_data *ld = e->elevator_data;
+	int cls;
+
+	cancel_work_sync(&ld->unplug_work);
+	for (cls = 0; cls < LAT_NR_CLASSES; cls++)
+		BUG_ON(!list_empty(&ld->fifo_list[cls]));
+
+	kfree(ld);
+}
+
+/*
+ * initialize elevator private data (lat_data).
+ */
+static int lat_init_queue(struct request_queue *q, struct elevator_type *e)
+{
+	struct lat_data *ld;
+	struct elevator_queue *eq;
+	int cls;
+
+	eq = elevator_alloc(q, e);
+	if (!eq)
+		return -ENOMEM;
+
+	ld = kzalloc_node(sizeof(*ld), GFP_KERNEL, q->node);
+	if (!ld) {
+		kobject_put(&eq->kobj);
+		return -ENOMEM;
+	}
+	eq->elevator_data = ld;
+
+	ld->queue = q;
+	for (cls = 0; cls < LAT_NR_CLASSES; cls++)
+		INIT_LIST_HEAD(&ld->fifo_list[cls]);
+	INIT_WORK(&ld->unplug_work, lat_kick_queue);
+	ld->fifo_expire[LAT_FG] = 0;
+	ld->fifo_expire[LAT_BG] = bg_expire;
+	ld->fifo_expire[LAT_ASYNC] = async_expire;
+	ld->fg_window = fg_window;
+	ld->fg_target_lat = fg_target_lat;
+	ld->bg_max_depth = bg_max_depth;
+	ld->bg_depth = bg_max_depth;
+	ld->fg_last = jiffies - fg_window - 1;
+
+	spin_lock_irq(q->queue_lock);
+	q->elevator = eq;
+	spin_unlock_irq(q->queue_lock);
+	return 0;
+}
+
+/*
+ * sysfs parts below
+ */
+
+static ssize_t
+lat_var_show(int var, char *page)
+{
+	return sprintf(page, "%d\n", var);
+}
+
+static ssize_t
+lat_var_store(int *var, const char *page, size_t count)
+{
+	char *p = (char *) page;
+
+	*var = simple_strtol(p, &p, 10);
+	return count;
+}
+
+#define SHOW_FUNCTION(__FUNC, __VAR, __CONV)				\
+static ssize_t __FUNC(struct elevator_queue *e, char *page)		\
+{									\
+	struct lat_data *ld = e->elevator_data;				\
+	int __data = __VAR;						\
+	if (__CONV)							\
+		__data = jiffies_to_msecs(__data);			\
+	return lat_var_show(__data, (page));				\
+}
+SHOW_FUNCTION(lat_bg_expire_show, ld->fifo_expire[LAT_BG], 1);
+SHOW_FUNCTION(lat_async_expire_show, ld->fifo_expire[LAT_ASYNC], 1);
+SHOW_FUNCTION(lat_fg_window_show, ld->fg_window, 1);
+SHOW_FUNCTION(lat_fg_target_lat_show, ld->fg_target_lat, 0);
+SHOW_FUNCTION(lat_bg_max_depth_show, ld->bg_max_depth, 0);
+SHOW_FUNCTION(lat_bg_depth_show, ld->bg_depth, 0);
+#undef SHOW_FUNCTION
+
+#define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
+static ssize_t __FUNC(struct elevator_queue *e, const char *page, size_t count)	\
+{									\
+	struct lat_data *ld = e->elevator_data;				\
+	int __data;							\
+	int ret = lat_var_store(&__data, (page), count);		\
+	if (__data < (MIN))						\
+		__data = (MIN);						\
+	else if (__data > (MAX))					\
+		__data = (MAX);						\
+	if (__CONV)							\
+		*(__PTR) = msecs_to_jiffies(__data);			\
+	else								\
+		*(__PTR) = __data;					\
+	return ret;							\
+}
+STORE_FUNCTION(lat_bg_expire_store, &ld->fifo_expire[LAT_BG], 0, INT_MAX, 1);
+STORE_FUNCTION(lat_async_expire_store, &ld->fifo_expire[LAT_ASYNC], 0, INT_MAX, 1);
+STORE_FUNCTION(lat_fg_window_store, &ld->fg_window, 0, INT_MAX, 1);
+STORE_FUNCTION(lat_fg_target_lat_store, &ld->fg_target_lat, 1, INT_MAX, 0);
+STORE_FUNCTION(lat_bg_max_depth_store, &ld->bg_max_depth, 1, BLKDEV_MAX_RQ, 0);
+#undef STORE_FUNCTION
+
+static ssize_t lat_bg_throttled_show(struct elevator_queue *e, char *page)
+{
+	struct lat_data *ld = e->elevator_data;
+
+	return sprintf(page, "%lu\n", ld->bg_throttled);
+}
+
+static ssize_t lat_hist_show(struct lat_data *ld, int cls, char *page)
+{
+	struct lat_hist *h;
+	unsigned long p50, p90, p99;
+	u64 count;
+
+	h = kmalloc(sizeof(*h), GFP_KERNEL);
+	if (!h)
+		return -ENOMEM;
+	spin_lock_irq(ld->queue->queue_lock);
+	*h = ld->hist[cls];
+	spin_unlock_irq(ld->queue->queue_lock);
+
+	count = h->count;
+	p50 = lat_hist_pct(h, 50);
+	p90 = lat_hist_pct(h, 90);
+	p99 = lat_hist_pct(h, 99);
+	kfree(h);
+
+	return sprintf(page, "count %llu p50 %lu p90 %lu p99 %lu us\n",
+		       count, p50, p90, p99);
+}
+
+#define HIST_FUNCTION(__FUNC, __CLS)					\
+static ssize_t __FUNC(struct elevator_queue *e, char *page)		\
+{									\
+	return lat_hist_show(e->elevator_data, __CLS, page);		\
+}
+HIST_FUNCTION(lat_fg_lat_show, LAT_FG);
+HIST_FUNCTION(lat_bg_lat_show, LAT_BG);
+HIST_FUNCTION(lat_async_lat_show, LAT_ASYNC);
+#undef HIST_FUNCTION
+
+#define LAT_ATTR(name) \
+	__ATTR(name, S_IRUGO|S_IWUSR, lat_##name##_show, \
+				      lat_##name##_store)
+#define LAT_ATTR_RO(name) \
+	__ATTR(name, S_IRUGO, lat_##name##_show, NULL)
+
+static struct elv_fs_entry lat_attrs[] = {
+	LAT_ATTR(bg_expire),
+	LAT_ATTR(async_expire),
+	LAT_ATTR(fg_window),
+	LAT_ATTR(fg_target_lat),
+	LAT_ATTR(bg_max_depth),
+	LAT_ATTR_RO(bg_depth),
+	LAT_ATTR_RO(bg_throttled),
+	LAT_ATTR_RO(fg_lat),
+	LAT_ATTR_RO(bg_lat),
+	LAT_ATTR_RO(async_lat),
+	__ATTR_NULL
+};
+
+static struct elevator_type iosched_latency = {
+	.ops = {
+		.elevator_allow_rq_merge_fn =	lat_allow_rq_merge,
+		.elevator_merge_req_fn =	lat_merged_requests,
+		.elevator_dispatch_fn =		lat_dispatch_requests,
+		.elevator_add_req_fn =		lat_add_request,
+		.elevator_completed_req_fn =	lat_completed_request,
+		.elevator_init_fn =		lat_init_queue,
+		.elevator_exit_fn =		lat_exit_queue,
+	},
+
+	/* only for the submitter's ioprio, no per-queue state */
+	.icq_size = sizeof(struct io_cq),
+	.icq_align = __alignof__(struct io_cq),
+	.elevator_attrs = lat_attrs,
+	.elevator_name = "latency",
+	.elevator_owner = THIS_MODULE,
+};
+
+static int __init lat_init(void)
+{
+	return elv_register(&iosched_latency);
+}
+
+static void __exit lat_exit(void)
+{
+	elv_unregister(&iosched_latency);
+}
+
+module_init(lat_init);
+module_exit(lat_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Latency targeting IO scheduler for flash");
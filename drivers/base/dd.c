@@ -25,6 +25,7 @@
 #include <linux/async.h>
 #include <linux/pm_runtime.h>
 #include <linux/pinctrl/devinfo.h>
+#include <soc/qcom/boot_stats.h>
 
 #include "base.h"
 #include "power/power.h"
@@ -517,6 +518,7 @@ EXPORT_SYMBOL_GPL(wait_for_device_probe);
  */
 int driver_probe_device(struct device_driver *drv, struct device *dev)
 {
+	ktime_t calltime;
 	int ret = 0;
 
 	if (!device_is_registered(dev))
@@ -529,7 +531,9 @@ int driver_probe_device(struct device_driver *drv, struct device *dev)
 		pm_runtime_get_sync(dev->parent);
 
 	pm_runtime_barrier(dev);
+	calltime = ktime_get();
 	ret = really_probe(dev, drv);
+	place_probe_marker(drv->name, ktime_sub(ktime_get(), calltime));
 	pm_request_idle(dev);
 
 	if (dev->parent)
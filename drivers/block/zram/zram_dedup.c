@@ -0,0 +1,261 @@
+/* Copyright (c) 2018, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <crypto/hash.h>
+#include <linux/highmem.h>
+#include <linux/rbtree.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/vmalloc.h>
+
+#include "zram_drv.h"
+
+/* One hash bucket per this many pages of disksize */
+#define ZRAM_HASH_SHIFT		10
+#define ZRAM_HASH_SIZE_MIN	(1 << 10)
+
+/* A compressed object that may be shared by several slots */
+struct zram_entry {
+	struct rb_node rb_node;
+	u32 len;
+	u32 checksum;
+	unsigned long refcount;
+	unsigned long handle;
+};
+
+struct zram_hash {
+	spinlock_t lock;
+	struct rb_root rb_root;
+};
+
+static struct kmem_cache *zram_entry_cache;
+
+int zram_dedup_cache_init(void)
+{
+	zram_entry_cache = KMEM_CACHE(zram_entry, 0);
+	if (!zram_entry_cache)
+		return -ENOMEM;
+
+	return 0;
+}
+
+void zram_dedup_cache_destroy(void)
+{
+	kmem_cache_destroy(zram_entry_cache);
+}
+
+static struct zram_hash *zram_dedup_bucket(struct zram *zram, u32 checksum)
+{
+	return &zram->hash[checksum % zram->hash_size];
+}
+
+/*
+ * crc32 goes through the crypto API so that the ARMv8 CRC32 instructions
+ * are used when the crc32-arm64 driver is available.
+ */
+u32 zram_dedup_checksum(struct zram *zram, struct page *page)
+{
+	SHASH_DESC_ON_STACK(desc, zram->hash_tfm);
+	u32 checksum = 0;
+	void *mem;
+
+	desc->tfm = zram->hash_tfm;
+	desc->flags = 0;
+
+	mem = kmap_atomic(page);
+	crypto_shash_digest(desc, mem, PAGE_SIZE, (u8 *)&checksum);
+	kunmap_atomic(mem);
+
+	return checksum;
+}
+
+static bool zram_dedup_match(struct zram *zram, struct zram_entry *entry,
+				unsigned char *mem)
+{
+	struct zcomp_strm *zstrm;
+	bool match = false;
+	void *cmem;
+
+	cmem = zs_map_object(zram->mem_pool, entry->handle, ZS_MM_RO);
+	if (entry->len == PAGE_SIZE) {
+		match = !memcmp(mem, cmem, PAGE_SIZE);
+	} else {
+		zstrm = zcomp_stream_get(zram->comp);
+		if (!zcomp_decompress(zstrm, cmem, entry->len, zstrm->buffer))
+			match = !memcmp(mem, zstrm->buffer, PAGE_SIZE);
+		zcomp_stream_put(zram->comp);
+	}
+	zs_unmap_object(zram->mem_pool, entry->handle);
+
+	return match;
+}
+
+/*
+ * Look for an object holding the same data as @page and take a reference
+ * on it. Candidates are compared under the bucket lock; the buckets are
+ * small enough that this is cheaper than pinning each candidate.
+ */
+struct zram_entry *zram_dedup_find(struct zram *zram, struct page *page,
+				u32 checksum)
+{
+	struct zram_hash *hash = zram_dedup_bucket(zram, checksum);
+	struct zram_entry *entry, *found = NULL;
+	struct rb_node *rb_node, *prev;
+	void *mem;
+
+	mem = kmap_atomic(page);
+	spin_lock(&hash->lock);
+	rb_node = hash->rb_root.rb_node;
+	while (rb_node) {
+		entry = rb_entry(rb_node, struct zram_entry, rb_node);
+		if (checksum == entry->checksum)
+			break;
+		if (checksum < entry->checksum)
+			rb_node = rb_node->rb_left;
+		else
+			rb_node = rb_node->rb_right;
+	}
+
+	/* Equal checksums are adjacent, start from the first of them */
+	while (rb_node && (prev = rb_prev(rb_node)) &&
+	       rb_entry(prev, struct zram_entry, rb_node)->checksum == checksum)
+		rb_node = prev;
+
+	for (; rb_node; rb_node = rb_next(rb_node)) {
+		entry = rb_entry(rb_node, struct zram_entry, rb_node);
+		if (entry->checksum != checksum)
+			break;
+		if (zram_dedup_match(zram, entry, mem)) {
+			entry->refcount++;
+			found = entry;
+			break;
+		}
+	}
+	spin_unlock(&hash->lock);
+	kunmap_atomic(mem);
+
+	if (found)
+		atomic64_add(found->len, &zram->stats.dup_data_size);
+
+	return found;
+}
+
+/* Make a freshly stored object available for later writes to share */
+struct zram_entry *zram_dedup_insert(struct zram *zram, unsigned long handle,
+				unsigned int len, u32 checksum)
+{
+	struct zram_hash *hash = zram_dedup_bucket(zram, checksum);
+	struct rb_node **rb_node, *parent = NULL;
+	struct zram_entry *entry, *node;
+
+	entry = kmem_cache_alloc(zram_entry_cache, GFP_NOIO | __GFP_NOWARN);
+	if (!entry)
+		return NULL;
+
+	entry->len = len;
+	entry->checksum = checksum;
+	entry->refcount = 1;
+	entry->handle = handle;
+
+	spin_lock(&hash->lock);
+	rb_node = &hash->rb_root.rb_node;
+	while (*rb_node) {
+		parent = *rb_node;
+		node = rb_entry(parent, struct zram_entry, rb_node);
+		if (checksum < node->checksum)
+			rb_node = &parent->rb_left;
+		else
+			rb_node = &parent->rb_right;
+	}
+	rb_link_node(&entry->rb_node, parent, rb_node);
+	rb_insert_color(&entry->rb_node, &hash->rb_root);
+	spin_unlock(&hash->lock);
+
+	atomic64_add(sizeof(*entry), &zram->stats.meta_data_size);
+	return entry;
+}
+
+/* Drop a slot's reference, freeing the object with the last one */
+void zram_dedup_put(struct zram *zram, struct zram_entry *entry)
+{
+	struct zram_hash *hash = zram_dedup_bucket(zram, entry->checksum);
+
+	spin_lock(&hash->lock);
+	if (--entry->refcount) {
+		spin_unlock(&hash->lock);
+		atomic64_sub(entry->len, &zram->stats.dup_data_size);
+		return;
+	}
+	rb_erase(&entry->rb_node, &hash->rb_root);
+	spin_unlock(&hash->lock);
+
+	zs_free(zram->mem_pool, entry->handle);
+	atomic64_sub(entry->len, &zram->stats.compr_data_size);
+	atomic64_sub(sizeof(*entry), &zram->stats.meta_data_size);
+	kmem_cache_free(zram_entry_cache, entry);
+}
+
+unsigned long zram_dedup_handle(struct zram_entry *entry)
+{
+	return entry->handle;
+}
+
+unsigned int zram_dedup_len(struct zram_entry *entry)
+{
+	return entry->len;
+}
+
+/* Racy, only meant as a hint */
+bool zram_dedup_shared(struct zram_entry *entry)
+{
+	return READ_ONCE(entry->refcount) > 1;
+}
+
+int zram_dedup_init(struct zram *zram, size_t num_pages)
+{
+	size_t i;
+
+	zram->hash_tfm = crypto_alloc_shash("crc32", 0, 0);
+	if (IS_ERR(zram->hash_tfm)) {
+		int err = PTR_ERR(zram->hash_tfm);
+
+		zram->hash_tfm = NULL;
+		return err;
+	}
+
+	zram->hash_size = num_pages >> ZRAM_HASH_SHIFT;
+	zram->hash_size = max_t(size_t, zram->hash_size, ZRAM_HASH_SIZE_MIN);
+	zram->hash = vzalloc(zram->hash_size * sizeof(struct zram_hash));
+	if (!zram->hash) {
+		crypto_free_shash(zram->hash_tfm);
+		zram->hash_tfm = NULL;
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < zram->hash_size; i++) {
+		spin_lock_init(&zram->hash[i].lock);
+		zram->hash[i].rb_root = RB_ROOT;
+	}
+
+	return 0;
+}
+
+void zram_dedup_fini(struct zram *zram)
+{
+	vfree(zram->hash);
+	zram->hash = NULL;
+	zram->hash_size = 0;
+
+	if (zram->hash_tfm)
+		crypto_free_shash(zram->hash_tfm);
+	zram->hash_tfm = NULL;
+}
@@ -0,0 +1,76 @@
+/* Copyright (c) 2018, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _ZRAM_DEDUP_H_
+#define _ZRAM_DEDUP_H_
+
+struct zram;
+struct zram_entry;
+
+#ifdef CONFIG_ZRAM_DEDUP
+int zram_dedup_cache_init(void);
+void zram_dedup_cache_destroy(void);
+
+u32 zram_dedup_checksum(struct zram *zram, struct page *page);
+struct zram_entry *zram_dedup_find(struct zram *zram, struct page *page,
+				u32 checksum);
+struct zram_entry *zram_dedup_insert(struct zram *zram, unsigned long handle,
+				unsigned int len, u32 checksum);
+void zram_dedup_put(struct zram *zram, struct zram_entry *entry);
+unsigned long zram_dedup_handle(struct zram_entry *entry);
+unsigned int zram_dedup_len(struct zram_entry *entry);
+bool zram_dedup_shared(struct zram_entry *entry);
+
+int zram_dedup_init(struct zram *zram, size_t num_pages);
+void zram_dedup_fini(struct zram *zram);
+#else
+static inline int zram_dedup_cache_init(void) { return 0; }
+static inline void zram_dedup_cache_destroy(void) { }
+
+static inline u32 zram_dedup_checksum(struct zram *zram, struct page *page)
+{
+	return 0;
+}
+static inline struct zram_entry *zram_dedup_find(struct zram *zram,
+				struct page *page, u32 checksum)
+{
+	return NULL;
+}
+static inline struct zram_entry *zram_dedup_insert(struct zram *zram,
+				unsigned long handle, unsigned int len,
+				u32 checksum)
+{
+	return NULL;
+}
+static inline void zram_dedup_put(struct zram *zram,
+				struct zram_entry *entry) { }
+static inline unsigned long zram_dedup_handle(struct zram_entry *entry)
+{
+	return 0;
+}
+static inline unsigned int zram_dedup_len(struct zram_entry *entry)
+{
+	return 0;
+}
+static inline bool zram_dedup_shared(struct zram_entry *entry)
+{
+	return false;
+}
+
+static inline int zram_dedup_init(struct zram *zram, size_t num_pages)
+{
+	return 0;
+}
+static inline void zram_dedup_fini(struct zram *zram) { }
+#endif
+
+#endif /* _ZRAM_DEDUP_H_ */
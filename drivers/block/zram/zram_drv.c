@@ -24,6 +24,7 @@
 #include <linux/device.h>
 #include <linux/genhd.h>
 #include <linux/highmem.h>
+#include <linux/pagemap.h>
 #include <linux/slab.h>
 #include <linux/backing-dev.h>
 #include <linux/string.h>
@@ -50,23 +51,52 @@ static unsigned int num_devices = 1;
  */
 static size_t huge_class_size;
 
+/*
+ * Workers for async write compression. The workqueue is unbound and visible
+ * in sysfs, so its cpumask can be set to keep the compression work on, say,
+ * the little cluster.
+ */
+static struct workqueue_struct *zram_async_wq;
+static struct kmem_cache *zram_async_cache;
+
+struct zram_async_req {
+	struct llist_node node;
+	struct zram *zram;
+	/* Either a whole write bio or a single page from rw_page */
+	struct bio *bio;
+	struct page *page;
+	u32 index;
+};
+
 static void zram_free_page(struct zram *zram, size_t index);
 static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 				u32 index, int offset, struct bio *bio);
+static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
+				struct bio *bio, bool partial_io);
 
 
+/*
+ * Every slot lock section is also a write section of the slot's seqcount,
+ * so lockless readers see any change made under the lock.
+ */
 static int zram_slot_trylock(struct zram *zram, u32 index)
 {
-	return bit_spin_trylock(ZRAM_LOCK, &zram->table[index].flags);
+	if (!bit_spin_trylock(ZRAM_LOCK, &zram->table[index].flags))
+		return 0;
+
+	raw_write_seqcount_begin(&zram->table_seq[index]);
+	return 1;
 }
 
 static void zram_slot_lock(struct zram *zram, u32 index)
 {
 	bit_spin_lock(ZRAM_LOCK, &zram->table[index].flags);
+	raw_write_seqcount_begin(&zram->table_seq[index]);
 }
 
 static void zram_slot_unlock(struct zram *zram, u32 index)
 {
+	raw_write_seqcount_end(&zram->table_seq[index]);
 	bit_spin_unlock(ZRAM_LOCK, &zram->table[index].flags);
 }
 
@@ -90,6 +120,11 @@ static void zram_set_handle(struct zram *zram, u32 index, unsigned long handle)
 	zram->table[index].handle = handle;
 }
 
+static inline struct zram_entry *zram_get_entry(struct zram *zram, u32 index)
+{
+	return (struct zram_entry *)zram->table[index].handle;
+}
+
 /* flag operations require table entry bit_spin_lock() being held */
 static bool zram_test_flag(struct zram *zram, u32 index,
 			enum zram_pageflags flag)
@@ -140,6 +175,43 @@ static inline bool zram_allocated(struct zram *zram, u32 index)
 			zram_test_flag(zram, index, ZRAM_WB);
 }
 
+/*
+ * Clear the idle mark and note the access time. The slot lock is only
+ * taken when the idle mark is actually set, so repeated accesses to a hot
+ * slot don't write to its table entry.
+ */
+static void zram_accessed(struct zram *zram, u32 index)
+{
+#ifdef CONFIG_ZRAM_MEMORY_TRACKING
+	/* Only informational, a racing update is harmless */
+	zram->ac_time[index] = ktime_get_boottime();
+#endif
+	if (!(READ_ONCE(zram->table[index].flags) & BIT(ZRAM_IDLE)))
+		return;
+
+	zram_slot_lock(zram, index);
+	zram_clear_flag(zram, index, ZRAM_IDLE);
+	zram_slot_unlock(zram, index);
+}
+
+/* The zsmalloc handle of a slot's object. Requires the slot lock. */
+static unsigned long zram_get_obj_handle(struct zram *zram, u32 index)
+{
+	if (zram_test_flag(zram, index, ZRAM_DEDUP))
+		return zram_dedup_handle(zram_get_entry(zram, index));
+
+	return zram_get_handle(zram, index);
+}
+
+/* The backend a slot was compressed with. Requires the slot lock. */
+static struct zcomp *zram_slot_comp(struct zram *zram, u32 index)
+{
+	if (zram_test_flag(zram, index, ZRAM_RECOMP))
+		return zram->recomp;
+
+	return zram->comp;
+}
+
 #if PAGE_SIZE != 4096
 static inline bool is_partial_io(struct bio_vec *bvec)
 {
@@ -668,6 +740,10 @@ static ssize_t writeback_store(struct device *dev,
 		goto release_init_lock;
 	}
 
+	/* Idle pages are recompressed before they are written back */
+	if (mode == IDLE_WRITEBACK)
+		flush_work(&zram->recomp_work);
+
 	page = alloc_page(GFP_KERNEL);
 	if (!page) {
 		ret = -ENOMEM;
@@ -876,12 +952,6 @@ static void zram_debugfs_destroy(void)
 	debugfs_remove_recursive(zram_debugfs_root);
 }
 
-static void zram_accessed(struct zram *zram, u32 index)
-{
-	zram_clear_flag(zram, index, ZRAM_IDLE);
-	zram->table[index].ac_time = ktime_get_boottime();
-}
-
 static ssize_t read_block_state(struct file *file, char __user *buf,
 				size_t count, loff_t *ppos)
 {
@@ -917,15 +987,16 @@ static ssize_t read_block_state(struct file *file, char __user *buf,
 		if (!zram_allocated(zram, index))
 			goto next;
 
-		ts = ktime_to_timespec64(zram->table[index].ac_time);
+		ts = ktime_to_timespec64(zram->ac_time[index]);
 		copied = snprintf(kbuf + written, count,
-			"%12zd %12lld.%06lu %c%c%c%c\n",
+			"%12zd %12lld.%06lu %c%c%c%c%c\n",
 			index, (s64)ts.tv_sec,
 			ts.tv_nsec / NSEC_PER_USEC,
 			zram_test_flag(zram, index, ZRAM_SAME) ? 's' : '.',
 			zram_test_flag(zram, index, ZRAM_WB) ? 'w' : '.',
 			zram_test_flag(zram, index, ZRAM_HUGE) ? 'h' : '.',
-			zram_test_flag(zram, index, ZRAM_IDLE) ? 'i' : '.');
+			zram_test_flag(zram, index, ZRAM_IDLE) ? 'i' : '.',
+			zram_test_flag(zram, index, ZRAM_RECOMP) ? 'r' : '.');
 
 		if (count <= copied) {
 			zram_slot_unlock(zram, index);
@@ -970,10 +1041,6 @@ static void zram_debugfs_unregister(struct zram *zram)
 #else
 static void zram_debugfs_create(void) {};
 static void zram_debugfs_destroy(void) {};
-static void zram_accessed(struct zram *zram, u32 index)
-{
-	zram_clear_flag(zram, index, ZRAM_IDLE);
-};
 static void zram_debugfs_register(struct zram *zram) {};
 static void zram_debugfs_unregister(struct zram *zram) {};
 #endif
@@ -999,6 +1066,63 @@ static ssize_t max_comp_streams_store(struct device *dev,
 	return len;
 }
 
+static ssize_t async_write_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", READ_ONCE(zram->async_write));
+}
+
+static ssize_t async_write_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool val;
+
+	if (strtobool(buf, &val))
+		return -EINVAL;
+
+	WRITE_ONCE(zram->async_write, val);
+	return len;
+}
+
+#ifdef CONFIG_ZRAM_DEDUP
+static ssize_t use_dedup_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool val;
+
+	down_read(&zram->init_lock);
+	val = zram->use_dedup;
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", (int)val);
+}
+
+static ssize_t use_dedup_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool val;
+
+	if (strtobool(buf, &val))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change dedup usage for initialized device\n");
+		return -EBUSY;
+	}
+	zram->use_dedup = val;
+	up_write(&zram->init_lock);
+
+	return len;
+}
+#endif
+
 static ssize_t comp_algorithm_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -1040,6 +1164,190 @@ static ssize_t comp_algorithm_store(struct device *dev,
 	return len;
 }
 
+static ssize_t recomp_algorithm_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	size_t sz;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	sz = zcomp_available_show(zram->recompressor, buf);
+	up_read(&zram->init_lock);
+
+	return sz;
+}
+
+static ssize_t recomp_algorithm_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	char compressor[ARRAY_SIZE(zram->recompressor)];
+	size_t sz;
+
+	strlcpy(compressor, buf, sizeof(compressor));
+	/* ignore trailing newline */
+	sz = strlen(compressor);
+	if (sz > 0 && compressor[sz - 1] == '\n')
+		compressor[sz - 1] = 0x00;
+
+	if (!zcomp_available_algorithm(compressor))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change algorithm for initialized device\n");
+		return -EBUSY;
+	}
+
+	strcpy(zram->recompressor, compressor);
+	up_write(&zram->init_lock);
+	return len;
+}
+
+/*
+ * Recompress an idle slot with the secondary backend. The old object is
+ * only replaced if the slot did not change while it was being recompressed
+ * and the new object is smaller.
+ */
+static int zram_recompress(struct zram *zram, u32 index, struct page *page)
+{
+	struct zcomp_strm *zstrm;
+	unsigned long handle, new_handle;
+	unsigned int comp_len;
+	size_t old_size;
+	void *src, *dst;
+	int ret;
+
+	zram_slot_lock(zram, index);
+	if (!zram_test_flag(zram, index, ZRAM_IDLE) ||
+	    zram_test_flag(zram, index, ZRAM_WB) ||
+	    zram_test_flag(zram, index, ZRAM_UNDER_WB) ||
+	    zram_test_flag(zram, index, ZRAM_SAME) ||
+	    zram_test_flag(zram, index, ZRAM_RECOMP) ||
+	    zram_test_flag(zram, index, ZRAM_INCOMPRESSIBLE) ||
+	    !zram_get_handle(zram, index) ||
+	    (zram_test_flag(zram, index, ZRAM_DEDUP) &&
+	     zram_dedup_shared(zram_get_entry(zram, index)))) {
+		zram_slot_unlock(zram, index);
+		return 0;
+	}
+	handle = zram_get_handle(zram, index);
+	old_size = zram_get_obj_size(zram, index);
+	zram_slot_unlock(zram, index);
+
+	ret = __zram_bvec_read(zram, page, index, NULL, false);
+	if (ret)
+		return ret;
+
+	zstrm = zcomp_stream_get(zram->recomp);
+	src = kmap_atomic(page);
+	ret = zcomp_compress(zstrm, src, &comp_len);
+	kunmap_atomic(src);
+	if (ret) {
+		zcomp_stream_put(zram->recomp);
+		return ret;
+	}
+
+	new_handle = 0;
+	if (comp_len < old_size && comp_len < huge_class_size)
+		new_handle = zs_malloc(zram->mem_pool, comp_len,
+				__GFP_KSWAPD_RECLAIM |
+				__GFP_NOWARN |
+				__GFP_HIGHMEM |
+				__GFP_MOVABLE |
+				__GFP_CMA);
+	if (new_handle) {
+		dst = zs_map_object(zram->mem_pool, new_handle, ZS_MM_WO);
+		memcpy(dst, zstrm->buffer, comp_len);
+		zs_unmap_object(zram->mem_pool, new_handle);
+	}
+	zcomp_stream_put(zram->recomp);
+
+	zram_slot_lock(zram, index);
+	if (zram_get_handle(zram, index) != handle ||
+	    !zram_test_flag(zram, index, ZRAM_IDLE)) {
+		/* Raced with a write or free, the new object is stale */
+		zram_slot_unlock(zram, index);
+		if (new_handle)
+			zs_free(zram->mem_pool, new_handle);
+		return 0;
+	}
+
+	if (!new_handle) {
+		/* Don't try this slot again until it is rewritten */
+		zram_set_flag(zram, index, ZRAM_INCOMPRESSIBLE);
+		zram_slot_unlock(zram, index);
+		return 0;
+	}
+
+	zram_free_page(zram, index);
+	zram_set_handle(zram, index, new_handle);
+	zram_set_obj_size(zram, index, comp_len);
+	zram_set_flag(zram, index, ZRAM_RECOMP);
+	/* still idle, so still a candidate for writeback */
+	zram_set_flag(zram, index, ZRAM_IDLE);
+	zram_slot_unlock(zram, index);
+
+	atomic64_inc(&zram->stats.pages_stored);
+	atomic64_add(comp_len, &zram->stats.compr_data_size);
+	atomic64_inc(&zram->stats.recomp_pages);
+	return 0;
+}
+
+static void zram_recompress_work(struct work_struct *work)
+{
+	struct zram *zram = container_of(work, struct zram, recomp_work);
+	unsigned long nr_pages, index;
+	struct page *page;
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page)
+		return;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram) || !zram->recomp)
+		goto out;
+
+	nr_pages = zram->disksize >> PAGE_SHIFT;
+	for (index = 0; index < nr_pages; index++) {
+		if (zram_recompress(zram, index, page))
+			break;
+		cond_resched();
+	}
+out:
+	up_read(&zram->init_lock);
+	__free_page(page);
+}
+
+static ssize_t recompress_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	char mode_buf[8];
+	ssize_t sz, ret = len;
+
+	sz = strscpy(mode_buf, buf, sizeof(mode_buf));
+	if (sz <= 0)
+		return -EINVAL;
+
+	/* ignore trailing newline */
+	if (mode_buf[sz - 1] == '\n')
+		mode_buf[sz - 1] = 0x00;
+
+	if (strcmp(mode_buf, "idle"))
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram) || !zram->recomp)
+		ret = -EINVAL;
+	else
+		queue_work(zram_async_wq, &zram->recomp_work);
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+
 static ssize_t compact_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
@@ -1096,7 +1404,7 @@ static ssize_t mm_stat_show(struct device *dev,
 	max_used = atomic_long_read(&zram->stats.max_used_pages);
 
 	ret = scnprintf(buf, PAGE_SIZE,
-			"%8llu %8llu %8llu %8lu %8ld %8llu %8lu %8llu\n",
+			"%8llu %8llu %8llu %8lu %8ld %8llu %8lu %8llu %8llu %8llu\n",
 			orig_size << PAGE_SHIFT,
 			(u64)atomic64_read(&zram->stats.compr_data_size),
 			mem_used << PAGE_SHIFT,
@@ -1104,7 +1412,9 @@ static ssize_t mm_stat_show(struct device *dev,
 			max_used << PAGE_SHIFT,
 			(u64)atomic64_read(&zram->stats.same_pages),
 			atomic_long_read(&pool_stats.pages_compacted),
-			(u64)atomic64_read(&zram->stats.huge_pages));
+			(u64)atomic64_read(&zram->stats.huge_pages),
+			(u64)atomic64_read(&zram->stats.dup_data_size),
+			(u64)atomic64_read(&zram->stats.meta_data_size));
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -1139,10 +1449,12 @@ static ssize_t debug_stat_show(struct device *dev,
 
 	down_read(&zram->init_lock);
 	ret = scnprintf(buf, PAGE_SIZE,
-			"version: %d\n%8llu %8llu\n",
+			"version: %d\n%8llu %8llu %8llu %8llu\n",
 			version,
 			(u64)atomic64_read(&zram->stats.writestall),
-			(u64)atomic64_read(&zram->stats.miss_free));
+			(u64)atomic64_read(&zram->stats.miss_free),
+			(u64)atomic64_read(&zram->stats.async_writes),
+			(u64)atomic64_read(&zram->stats.recomp_pages));
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -1164,7 +1476,13 @@ static void zram_meta_free(struct zram *zram, u64 disksize)
 	for (index = 0; index < num_pages; index++)
 		zram_free_page(zram, index);
 
+	if (zram_dedup_enabled(zram))
+		zram_dedup_fini(zram);
 	zs_destroy_pool(zram->mem_pool);
+#ifdef CONFIG_ZRAM_MEMORY_TRACKING
+	vfree(zram->ac_time);
+#endif
+	vfree(zram->table_seq);
 	vfree(zram->table);
 }
 
@@ -1177,15 +1495,38 @@ static bool zram_meta_alloc(struct zram *zram, u64 disksize)
 	if (!zram->table)
 		return false;
 
+	zram->table_seq = vzalloc(num_pages * sizeof(*zram->table_seq));
+	if (!zram->table_seq)
+		goto free_table;
+
+#ifdef CONFIG_ZRAM_MEMORY_TRACKING
+	zram->ac_time = vzalloc(num_pages * sizeof(*zram->ac_time));
+	if (!zram->ac_time)
+		goto free_table_seq;
+#endif
+
 	zram->mem_pool = zs_create_pool(zram->disk->disk_name);
-	if (!zram->mem_pool) {
-		vfree(zram->table);
-		return false;
+	if (!zram->mem_pool)
+		goto free_ac_time;
+
+	if (zram_dedup_enabled(zram) && zram_dedup_init(zram, num_pages)) {
+		zs_destroy_pool(zram->mem_pool);
+		goto free_ac_time;
 	}
 
 	if (!huge_class_size)
 		huge_class_size = zs_huge_class_size(zram->mem_pool);
 	return true;
+
+free_ac_time:
+#ifdef CONFIG_ZRAM_MEMORY_TRACKING
+	vfree(zram->ac_time);
+free_table_seq:
+#endif
+	vfree(zram->table_seq);
+free_table:
+	vfree(zram->table);
+	return false;
 }
 
 /*
@@ -1198,11 +1539,17 @@ static void zram_free_page(struct zram *zram, size_t index)
 	unsigned long handle;
 
 #ifdef CONFIG_ZRAM_MEMORY_TRACKING
-	zram->table[index].ac_time.tv64 = 0;
+	zram->ac_time[index].tv64 = 0;
 #endif
 	if (zram_test_flag(zram, index, ZRAM_IDLE))
 		zram_clear_flag(zram, index, ZRAM_IDLE);
 
+	zram_clear_flag(zram, index, ZRAM_INCOMPRESSIBLE);
+	if (zram_test_flag(zram, index, ZRAM_RECOMP)) {
+		zram_clear_flag(zram, index, ZRAM_RECOMP);
+		atomic64_dec(&zram->stats.recomp_pages);
+	}
+
 	if (zram_test_flag(zram, index, ZRAM_HUGE)) {
 		zram_clear_flag(zram, index, ZRAM_HUGE);
 		atomic64_dec(&zram->stats.huge_pages);
@@ -1228,6 +1575,12 @@ static void zram_free_page(struct zram *zram, size_t index)
 	if (!handle)
 		return;
 
+	if (zram_test_flag(zram, index, ZRAM_DEDUP)) {
+		zram_clear_flag(zram, index, ZRAM_DEDUP);
+		zram_dedup_put(zram, zram_get_entry(zram, index));
+		goto out;
+	}
+
 	zs_free(zram->mem_pool, handle);
 
 	atomic64_sub(zram_get_obj_size(zram, index),
@@ -1240,6 +1593,35 @@ static void zram_free_page(struct zram *zram, size_t index)
 		~(1UL << ZRAM_LOCK | 1UL << ZRAM_UNDER_WB));
 }
 
+/*
+ * Fill @page from a slot that holds no zsmalloc object, i.e. one that is
+ * unallocated or same filled, without taking the slot lock. Returns false
+ * if the slot has to be read under the lock.
+ */
+static bool zram_read_lockless(struct zram *zram, u32 index, struct page *page)
+{
+	seqcount_t *seq = &zram->table_seq[index];
+	unsigned long flags, element;
+	unsigned int start;
+	void *mem;
+
+	do {
+		start = raw_read_seqcount_begin(seq);
+		flags = READ_ONCE(zram->table[index].flags);
+		element = READ_ONCE(zram->table[index].element);
+
+		if (flags & BIT(ZRAM_WB))
+			return false;
+		if (element && !(flags & BIT(ZRAM_SAME)))
+			return false;
+	} while (read_seqcount_retry(seq, start));
+
+	mem = kmap_atomic(page);
+	zram_fill_page(mem, PAGE_SIZE, element);
+	kunmap_atomic(mem);
+	return true;
+}
+
 static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 				struct bio *bio, bool partial_io)
 {
@@ -1248,6 +1630,9 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 	unsigned int size;
 	void *src, *dst;
 
+	if (zram_read_lockless(zram, index, page))
+		return 0;
+
 	zram_slot_lock(zram, index);
 	if (zram_test_flag(zram, index, ZRAM_WB)) {
 		struct bio_vec bvec;
@@ -1275,6 +1660,7 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 		return 0;
 	}
 
+	handle = zram_get_obj_handle(zram, index);
 	size = zram_get_obj_size(zram, index);
 
 	src = zs_map_object(zram->mem_pool, handle, ZS_MM_RO);
@@ -1282,17 +1668,27 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 		dst = kmap_atomic(page);
 		memcpy(dst, src, PAGE_SIZE);
 		kunmap_atomic(dst);
+		zs_unmap_object(zram->mem_pool, handle);
+		zram_slot_unlock(zram, index);
 		ret = 0;
 	} else {
-		struct zcomp_strm *zstrm = zcomp_stream_get(zram->comp);
+		struct zcomp *comp = zram_slot_comp(zram, index);
+		struct zcomp_strm *zstrm = zcomp_stream_get(comp);
+
+		/*
+		 * Only copy the object out under the slot lock and decompress
+		 * it from the stream buffer after dropping the lock, so that
+		 * the lock is held for as short as possible.
+		 */
+		memcpy(zstrm->buffer, src, size);
+		zs_unmap_object(zram->mem_pool, handle);
+		zram_slot_unlock(zram, index);
 
 		dst = kmap_atomic(page);
-		ret = zcomp_decompress(zstrm, src, size, dst);
+		ret = zcomp_decompress(zstrm, zstrm->buffer, size, dst);
 		kunmap_atomic(dst);
-		zcomp_stream_put(zram->comp);
+		zcomp_stream_put(comp);
 	}
-	zs_unmap_object(zram->mem_pool, handle);
-	zram_slot_unlock(zram, index);
 
 	/* Should NEVER happen. Return bio error if it does. */
 	if (unlikely(ret))
@@ -1346,6 +1742,8 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	struct page *page = bvec->bv_page;
 	unsigned long element = 0;
 	enum zram_pageflags flags = 0;
+	struct zram_entry *entry = NULL;
+	u32 checksum = 0;
 
 	mem = kmap_atomic(page);
 	if (page_same_filled(mem, &element)) {
@@ -1357,6 +1755,15 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	}
 	kunmap_atomic(mem);
 
+	if (zram_dedup_enabled(zram)) {
+		checksum = zram_dedup_checksum(zram, page);
+		entry = zram_dedup_find(zram, page, checksum);
+		if (entry) {
+			comp_len = zram_dedup_len(entry);
+			goto out;
+		}
+	}
+
 compress_again:
 	zstrm = zcomp_stream_get(zram->comp);
 	src = kmap_atomic(page);
@@ -1424,6 +1831,10 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	zcomp_stream_put(zram->comp);
 	zs_unmap_object(zram->mem_pool, handle);
 	atomic64_add(comp_len, &zram->stats.compr_data_size);
+
+	/* Without an entry the object just isn't shared */
+	if (zram_dedup_enabled(zram))
+		entry = zram_dedup_insert(zram, handle, comp_len, checksum);
 out:
 	/*
 	 * Free memory associated with this sector
@@ -1440,7 +1851,11 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	if (flags) {
 		zram_set_flag(zram, index, flags);
 		zram_set_element(zram, index, element);
-	}  else {
+	} else if (entry) {
+		zram_set_flag(zram, index, ZRAM_DEDUP);
+		zram_set_handle(zram, index, (unsigned long)entry);
+		zram_set_obj_size(zram, index, comp_len);
+	} else {
 		zram_set_handle(zram, index, handle);
 		zram_set_obj_size(zram, index, comp_len);
 	}
@@ -1556,9 +1971,7 @@ static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 
 	generic_end_io_acct(rw_acct, &zram->disk->part0, start_time);
 
-	zram_slot_lock(zram, index);
 	zram_accessed(zram, index);
-	zram_slot_unlock(zram, index);
 
 	if (unlikely(ret < 0)) {
 		if (!is_write)
@@ -1612,6 +2025,94 @@ static void __zram_make_request(struct zram *zram, struct bio *bio)
 	bio_io_error(bio);
 }
 
+static void zram_async_write_page(struct zram_async_req *req)
+{
+	struct page *page = req->page;
+	struct bio_vec bv;
+
+	bv.bv_page = page;
+	bv.bv_len = PAGE_SIZE;
+	bv.bv_offset = 0;
+
+	if (unlikely(zram_bvec_rw(req->zram, &bv, req->index, 0, true,
+				  NULL) < 0)) {
+		/*
+		 * It is too late to make rw_page fail and have the caller
+		 * retry with a bio, so do what end_swap_bio_write() does and
+		 * redirty the page to have it written again.
+		 */
+		SetPageError(page);
+		set_page_dirty(page);
+		ClearPageReclaim(page);
+		pr_alert_ratelimited("Async write failed for page %u\n",
+				     req->index);
+	}
+	end_page_writeback(page);
+}
+
+static void zram_async_work(struct work_struct *work)
+{
+	struct zram_async_queue *queue = container_of(work,
+					struct zram_async_queue, work);
+	struct llist_node *list = llist_del_all(&queue->list);
+	struct zram_async_req *req, *next;
+
+	list = llist_reverse_order(list);
+	llist_for_each_entry_safe(req, next, list, node) {
+		if (req->bio)
+			__zram_make_request(req->zram, req->bio);
+		else
+			zram_async_write_page(req);
+		atomic64_inc(&req->zram->stats.async_writes);
+		kmem_cache_free(zram_async_cache, req);
+	}
+}
+
+/*
+ * Hand a write over to the async workers. Returns false if it has to be done
+ * synchronously instead.
+ */
+static bool zram_async_submit(struct zram *zram, struct bio *bio,
+			      struct page *page, u32 index)
+{
+	struct zram_async_queue *queue;
+	struct zram_async_req *req;
+
+	if (!READ_ONCE(zram->async_write))
+		return false;
+
+	/* This is usually reclaim, don't make things worse */
+	req = kmem_cache_alloc(zram_async_cache, GFP_NOWAIT | __GFP_NOWARN);
+	if (!req)
+		return false;
+
+	req->zram = zram;
+	req->bio = bio;
+	req->page = page;
+	req->index = index;
+
+	queue = get_cpu_ptr(zram->async_queue);
+	if (llist_add(&req->node, &queue->list))
+		queue_work(zram_async_wq, &queue->work);
+	put_cpu_ptr(zram->async_queue);
+
+	return true;
+}
+
+static void zram_async_init(struct zram *zram)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct zram_async_queue *queue;
+
+		queue = per_cpu_ptr(zram->async_queue, cpu);
+		init_llist_head(&queue->list);
+		INIT_WORK(&queue->work, zram_async_work);
+		queue->zram = zram;
+	}
+}
+
 /*
  * Handler function for all zram I/O requests.
  */
@@ -1625,6 +2126,10 @@ static blk_qc_t zram_make_request(struct request_queue *queue, struct bio *bio)
 		goto error;
 	}
 
+	if (op_is_write(bio_op(bio)) && bio_op(bio) != REQ_OP_DISCARD &&
+	    zram_async_submit(zram, bio, NULL, 0))
+		return BLK_QC_T_NONE;
+
 	__zram_make_request(zram, bio);
 	return BLK_QC_T_NONE;
 
@@ -1673,6 +2178,11 @@ static int zram_rw_page(struct block_device *bdev, sector_t sector,
 	bv.bv_len = PAGE_SIZE;
 	bv.bv_offset = 0;
 
+	if (is_write && zram_async_submit(zram, NULL, page, index)) {
+		ret = 1;
+		goto out;
+	}
+
 	ret = zram_bvec_rw(zram, &bv, index, offset, is_write, NULL);
 out:
 	/*
@@ -1701,9 +2211,10 @@ static int zram_rw_page(struct block_device *bdev, sector_t sector,
 
 static void zram_reset_device(struct zram *zram)
 {
-	struct zcomp *comp;
+	struct zcomp *comp, *recomp;
 	u64 disksize;
 
+	cancel_work_sync(&zram->recomp_work);
 	down_write(&zram->init_lock);
 
 	zram->limit_pages = 0;
@@ -1714,6 +2225,8 @@ static void zram_reset_device(struct zram *zram)
 	}
 
 	comp = zram->comp;
+	recomp = zram->recomp;
+	zram->recomp = NULL;
 	disksize = zram->disksize;
 	zram->disksize = 0;
 
@@ -1721,10 +2234,14 @@ static void zram_reset_device(struct zram *zram)
 	part_stat_set_all(&zram->disk->part0, 0);
 
 	up_write(&zram->init_lock);
+	/* Let queued async writes finish before the table goes away */
+	flush_workqueue(zram_async_wq);
 	/* I/O operation under all of CPU are done so let's free */
 	zram_meta_free(zram, disksize);
 	memset(&zram->stats, 0, sizeof(zram->stats));
 	zcomp_destroy(comp);
+	if (recomp)
+		zcomp_destroy(recomp);
 	reset_bdev(zram);
 }
 
@@ -1761,6 +2278,19 @@ static ssize_t disksize_store(struct device *dev,
 		goto out_free_meta;
 	}
 
+	if (zram->recompressor[0]) {
+		struct zcomp *recomp = zcomp_create(zram->recompressor);
+
+		if (IS_ERR(recomp)) {
+			pr_err("Cannot initialise %s compressing backend\n",
+					zram->recompressor);
+			zcomp_destroy(comp);
+			err = PTR_ERR(recomp);
+			goto out_free_meta;
+		}
+		zram->recomp = recomp;
+	}
+
 	zram->comp = comp;
 	zram->disksize = disksize;
 	set_capacity(zram->disk, zram->disksize >> SECTOR_SHIFT);
@@ -1852,7 +2382,13 @@ static DEVICE_ATTR_WO(mem_limit);
 static DEVICE_ATTR_WO(mem_used_max);
 static DEVICE_ATTR_WO(idle);
 static DEVICE_ATTR_RW(max_comp_streams);
+static DEVICE_ATTR_RW(async_write);
+#ifdef CONFIG_ZRAM_DEDUP
+static DEVICE_ATTR_RW(use_dedup);
+#endif
 static DEVICE_ATTR_RW(comp_algorithm);
+static DEVICE_ATTR_RW(recomp_algorithm);
+static DEVICE_ATTR_WO(recompress);
 #ifdef CONFIG_ZRAM_WRITEBACK
 static DEVICE_ATTR_RW(backing_dev);
 static DEVICE_ATTR_WO(writeback);
@@ -1869,7 +2405,13 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_mem_used_max.attr,
 	&dev_attr_idle.attr,
 	&dev_attr_max_comp_streams.attr,
+	&dev_attr_async_write.attr,
+#ifdef CONFIG_ZRAM_DEDUP
+	&dev_attr_use_dedup.attr,
+#endif
 	&dev_attr_comp_algorithm.attr,
+	&dev_attr_recomp_algorithm.attr,
+	&dev_attr_recompress.attr,
 #ifdef CONFIG_ZRAM_WRITEBACK
 	&dev_attr_backing_dev.attr,
 	&dev_attr_writeback.attr,
@@ -1908,12 +2450,20 @@ static int zram_add(void)
 	if (!zram)
 		return -ENOMEM;
 
+	zram->async_queue = alloc_percpu(struct zram_async_queue);
+	if (!zram->async_queue) {
+		ret = -ENOMEM;
+		goto out_free_dev;
+	}
+	zram_async_init(zram);
+
 	ret = idr_alloc(&zram_index_idr, zram, 0, 0, GFP_KERNEL);
 	if (ret < 0)
-		goto out_free_dev;
+		goto out_free_async;
 	device_id = ret;
 
 	init_rwsem(&zram->init_lock);
+	INIT_WORK(&zram->recomp_work, zram_recompress_work);
 #ifdef CONFIG_ZRAM_WRITEBACK
 	spin_lock_init(&zram->wb_limit_lock);
 #endif
@@ -1992,6 +2542,8 @@ static int zram_add(void)
 	blk_cleanup_queue(queue);
 out_free_idr:
 	idr_remove(&zram_index_idr, device_id);
+out_free_async:
+	free_percpu(zram->async_queue);
 out_free_dev:
 	kfree(zram);
 	return ret;
@@ -2027,6 +2579,7 @@ static int zram_remove(struct zram *zram)
 	del_gendisk(zram->disk);
 	blk_cleanup_queue(zram->disk->queue);
 	put_disk(zram->disk);
+	free_percpu(zram->async_queue);
 	kfree(zram);
 	return 0;
 }
@@ -2108,16 +2661,34 @@ static void destroy_devices(void)
 	zram_debugfs_destroy();
 	idr_destroy(&zram_index_idr);
 	unregister_blkdev(zram_major, "zram");
+	destroy_workqueue(zram_async_wq);
+	zram_dedup_cache_destroy();
+	kmem_cache_destroy(zram_async_cache);
 }
 
 static int __init zram_init(void)
 {
 	int ret;
 
+	zram_async_cache = KMEM_CACHE(zram_async_req, 0);
+	if (!zram_async_cache)
+		return -ENOMEM;
+
+	ret = zram_dedup_cache_init();
+	if (ret)
+		goto out_free_cache;
+
+	zram_async_wq = alloc_workqueue("zram_async",
+			WQ_UNBOUND | WQ_MEM_RECLAIM | WQ_SYSFS, 0);
+	if (!zram_async_wq) {
+		ret = -ENOMEM;
+		goto out_free_dedup_cache;
+	}
+
 	ret = class_register(&zram_control_class);
 	if (ret) {
 		pr_err("Unable to register zram-control class\n");
-		return ret;
+		goto out_free_wq;
 	}
 
 	zram_debugfs_create();
@@ -2125,7 +2696,8 @@ static int __init zram_init(void)
 	if (zram_major <= 0) {
 		pr_err("Unable to get major number\n");
 		class_unregister(&zram_control_class);
-		return -EBUSY;
+		ret = -EBUSY;
+		goto out_free_wq;
 	}
 
 	while (num_devices != 0) {
@@ -2142,6 +2714,14 @@ static int __init zram_init(void)
 out_error:
 	destroy_devices();
 	return ret;
+
+out_free_wq:
+	destroy_workqueue(zram_async_wq);
+out_free_dedup_cache:
+	zram_dedup_cache_destroy();
+out_free_cache:
+	kmem_cache_destroy(zram_async_cache);
+	return ret;
 }
 
 static void __exit zram_exit(void)
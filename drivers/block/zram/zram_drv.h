@@ -15,11 +15,15 @@
 #ifndef _ZRAM_DRV_H_
 #define _ZRAM_DRV_H_
 
+#include <linux/llist.h>
 #include <linux/rwsem.h>
+#include <linux/seqlock.h>
+#include <linux/workqueue.h>
 #include <linux/zsmalloc.h>
 #include <linux/crypto.h>
 
 #include "zcomp.h"
+#include "zram_dedup.h"
 
 #define SECTORS_PER_PAGE_SHIFT	(PAGE_SHIFT - SECTOR_SHIFT)
 #define SECTORS_PER_PAGE	(1 << SECTORS_PER_PAGE_SHIFT)
@@ -37,9 +41,9 @@
  * zram is mainly used for memory efficiency so we want to keep memory
  * footprint small so we can squeeze size and flags into a field.
  * The lower ZRAM_FLAG_SHIFT bits is for object size (excluding header),
- * the higher bits is for zram_pageflags.
+ * which is at most PAGE_SIZE, the higher bits is for zram_pageflags.
  */
-#define ZRAM_FLAG_SHIFT 24
+#define ZRAM_FLAG_SHIFT (PAGE_SHIFT + 1)
 
 /* Flags for zram pages (table[page_no].flags) */
 enum zram_pageflags {
@@ -50,22 +54,25 @@ enum zram_pageflags {
 	ZRAM_UNDER_WB,	/* page is under writeback */
 	ZRAM_HUGE,	/* Incompressible page */
 	ZRAM_IDLE,	/* not accessed page since last idle marking */
+	ZRAM_RECOMP,	/* page is compressed with the secondary algorithm */
+	ZRAM_INCOMPRESSIBLE, /* secondary algorithm did not do better */
+	ZRAM_DEDUP,	/* handle points to a shared struct zram_entry */
 
 	__NR_ZRAM_PAGEFLAGS,
 };
 
 /*-- Data structures */
 
-/* Allocated for each disk page */
+/*
+ * Allocated for each disk page. Kept at two words so that entries never
+ * straddle a cache line; anything else per page lives in separate arrays.
+ */
 struct zram_table_entry {
 	union {
 		unsigned long handle;
 		unsigned long element;
 	};
 	unsigned long flags;
-#ifdef CONFIG_ZRAM_MEMORY_TRACKING
-	ktime_t ac_time;
-#endif
 };
 
 struct zram_stats {
@@ -82,6 +89,10 @@ struct zram_stats {
 	atomic_long_t max_used_pages;	/* no. of maximum pages stored */
 	atomic64_t writestall;		/* no. of write slow paths */
 	atomic64_t miss_free;		/* no. of missed free */
+	atomic64_t async_writes;	/* no. of writes done asynchronously */
+	atomic64_t recomp_pages;	/* no. of pages stored recompressed */
+	atomic64_t dup_data_size;	/* compressed size saved by dedup */
+	atomic64_t meta_data_size;	/* size of dedup metadata */
 #ifdef	CONFIG_ZRAM_WRITEBACK
 	atomic64_t bd_count;		/* no. of pages in backing device */
 	atomic64_t bd_reads;		/* no. of reads from backing device */
@@ -89,10 +100,28 @@ struct zram_stats {
 #endif
 };
 
+/* Per-cpu queue of writes handed to the async compression workers */
+struct zram_async_queue {
+	struct llist_head list;
+	struct work_struct work;
+	struct zram *zram;
+};
+
 struct zram {
 	struct zram_table_entry *table;
+	/*
+	 * Per page sequence counts, bumped whenever the slot lock is held.
+	 * Lets readers of slots without a zsmalloc object skip the lock.
+	 */
+	seqcount_t *table_seq;
+#ifdef CONFIG_ZRAM_MEMORY_TRACKING
+	ktime_t *ac_time;
+#endif
 	struct zs_pool *mem_pool;
 	struct zcomp *comp;
+	/* secondary backend idle pages are recompressed with, if any */
+	struct zcomp *recomp;
+	struct work_struct recomp_work;
 	struct gendisk *disk;
 	/* Prevent concurrent execution of device init */
 	struct rw_semaphore init_lock;
@@ -108,10 +137,17 @@ struct zram {
 	 */
 	u64 disksize;	/* bytes */
 	char compressor[CRYPTO_MAX_ALG_NAME];
+	char recompressor[CRYPTO_MAX_ALG_NAME];
 	/*
 	 * zram is claimed so open request will be failed
 	 */
 	bool claim; /* Protected by bdev->bd_mutex */
+	/*
+	 * Compress writes on the async workers instead of in the context
+	 * of the caller
+	 */
+	bool async_write;
+	struct zram_async_queue __percpu *async_queue;
 	struct file *backing_dev;
 #ifdef CONFIG_ZRAM_WRITEBACK
 	spinlock_t wb_limit_lock;
@@ -125,5 +161,21 @@ struct zram {
 #ifdef CONFIG_ZRAM_MEMORY_TRACKING
 	struct dentry *debugfs_dir;
 #endif
+#ifdef CONFIG_ZRAM_DEDUP
+	/* Share objects between slots holding identical pages */
+	bool use_dedup;
+	struct zram_hash *hash;
+	size_t hash_size;
+	struct crypto_shash *hash_tfm;
+#endif
 };
+
+static inline bool zram_dedup_enabled(struct zram *zram)
+{
+#ifdef CONFIG_ZRAM_DEDUP
+	return zram->use_dedup;
+#else
+	return false;
+#endif
+}
 #endif
@@ -44,6 +44,22 @@ enum {
 	BTFM_SLIM_NUM_CODEC_DAIS
 };
 
+/* Port configuration profiles, the vendor code maps them to port settings
+ * such as the FIFO watermark
+ */
+enum {
+	BTFM_SLIM_PROFILE_DEFAULT = 0,
+	BTFM_SLIM_PROFILE_LOW_LATENCY,
+	BTFM_SLIM_PROFILE_LOW_POWER,
+	BTFM_SLIM_NUM_PROFILES
+};
+
+/* Periods up to this long pick the low latency profile, periods from
+ * BTFM_SLIM_LOW_POWER_PERIOD_US the low power one
+ */
+#define BTFM_SLIM_LOW_LATENCY_PERIOD_US	10000
+#define BTFM_SLIM_LOW_POWER_PERIOD_US	20000
+
 /* Slimbus Port defines - This should be redefined in specific device file */
 #define BTFM_SLIM_PGD_PORT_LAST				0xFF
 
@@ -70,6 +86,17 @@ struct btfmslim {
 	uint32_t num_tx_port;
 	uint32_t sample_rate;
 
+	/* Profile of the port being enabled, and the watermark level in
+	 * samples the vendor code programmed for it
+	 */
+	uint8_t profile;
+	uint8_t port_wm;
+
+	/* Per DAI, set up from hw_params and prepare */
+	uint8_t dai_profile[BTFM_SLIM_NUM_CODEC_DAIS];
+	uint32_t dai_period_us[BTFM_SLIM_NUM_CODEC_DAIS];
+	uint32_t dai_latency_us[BTFM_SLIM_NUM_CODEC_DAIS];
+
 	struct btfmslim_ch *rx_chs;
 	struct btfmslim_ch *tx_chs;
 
@@ -18,6 +18,7 @@
 #include <linux/debugfs.h>
 #include <linux/slimbus/slimbus.h>
 #include <linux/ratelimit.h>
+#include <linux/math64.h>
 #include <linux/slab.h>
 #include <sound/pcm.h>
 #include <sound/pcm_params.h>
@@ -29,6 +30,9 @@
 static int bt_soc_enable_status;
 int btfm_feedback_ch_setting;
 
+/* 0 picks the profile from the period size, else BTFM_SLIM_PROFILE_* + 1 */
+static int btfm_profile_setting;
+
 static int btfm_slim_codec_write(struct snd_soc_codec *codec, unsigned int reg,
 	unsigned int value)
 {
@@ -68,14 +72,70 @@ static int btfm_put_feedback_ch_setting(struct snd_kcontrol *kcontrol,
 	return 1;
 }
 
+static const char * const btfm_profile_text[] = {
+	"Auto", "Default", "Low latency", "Low power"
+};
+
+static SOC_ENUM_SINGLE_EXT_DECL(btfm_profile_enum, btfm_profile_text);
+
+static int btfm_get_profile_setting(struct snd_kcontrol *kcontrol,
+					struct snd_ctl_elem_value *ucontrol)
+{
+	ucontrol->value.enumerated.item[0] = btfm_profile_setting;
+	return 0;
+}
+
+static int btfm_put_profile_setting(struct snd_kcontrol *kcontrol,
+					struct snd_ctl_elem_value *ucontrol)
+{
+	if (ucontrol->value.enumerated.item[0] >= ARRAY_SIZE(btfm_profile_text))
+		return -EINVAL;
+
+	btfm_profile_setting = ucontrol->value.enumerated.item[0];
+	return 1;
+}
+
+static int btfm_latency_info(struct snd_kcontrol *kcontrol,
+					struct snd_ctl_elem_info *uinfo)
+{
+	uinfo->type = SNDRV_CTL_ELEM_TYPE_INTEGER;
+	uinfo->count = BTFM_SLIM_NUM_CODEC_DAIS;
+	uinfo->value.integer.min = 0;
+	uinfo->value.integer.max = INT_MAX;
+	return 0;
+}
+
+/* Estimated latency in usecs of each DAI, see btfm_slim_dai_prepare() */
+static int btfm_latency_get(struct snd_kcontrol *kcontrol,
+					struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_codec *codec = snd_soc_kcontrol_codec(kcontrol);
+	struct btfmslim *btfmslim = codec->dev->platform_data;
+	int i;
+
+	for (i = 0; i < BTFM_SLIM_NUM_CODEC_DAIS; i++)
+		ucontrol->value.integer.value[i] = btfmslim->dai_latency_us[i];
+	return 0;
+}
+
 static const struct snd_kcontrol_new status_controls[] = {
 	SOC_SINGLE_EXT("BT SOC status", 0, 0, 1, 0,
 			bt_soc_status_get,
 			bt_soc_status_put),
 	SOC_SINGLE_EXT("BT set feedback channel", 0, 0, 1, 0,
 			btfm_get_feedback_ch_setting,
-			btfm_put_feedback_ch_setting)
-
+			btfm_put_feedback_ch_setting),
+	SOC_ENUM_EXT("BT port profile", btfm_profile_enum,
+			btfm_get_profile_setting,
+			btfm_put_profile_setting),
+	{
+		.iface = SNDRV_CTL_ELEM_IFACE_MIXER,
+		.name = "BT port latency us",
+		.access = SNDRV_CTL_ELEM_ACCESS_READ |
+			SNDRV_CTL_ELEM_ACCESS_VOLATILE,
+		.info = btfm_latency_info,
+		.get = btfm_latency_get,
+	},
 };
 
 
@@ -155,10 +215,38 @@ static int btfm_slim_dai_hw_params(struct snd_pcm_substream *substream,
 			    struct snd_pcm_hw_params *params,
 			    struct snd_soc_dai *dai)
 {
+	struct btfmslim *btfmslim = dai->dev->platform_data;
+	uint32_t period_us;
+	uint8_t profile;
+
 	BTFMSLIM_DBG("dai->name = %s DAI-ID %x rate %d num_ch %d",
 		dai->name, dai->id, params_rate(params),
 		params_channels(params));
 
+	if (dai->id < 0 || dai->id >= BTFM_SLIM_NUM_CODEC_DAIS ||
+		!params_rate(params)) {
+		BTFMSLIM_ERR("dai->id is invalid:%d", dai->id);
+		return -EINVAL;
+	}
+
+	period_us = div_u64((u64)params_period_size(params) * USEC_PER_SEC,
+		params_rate(params));
+
+	/* Short periods are voice or gaming, long ones music playback */
+	if (btfm_profile_setting)
+		profile = btfm_profile_setting - 1;
+	else if (period_us <= BTFM_SLIM_LOW_LATENCY_PERIOD_US)
+		profile = BTFM_SLIM_PROFILE_LOW_LATENCY;
+	else if (period_us >= BTFM_SLIM_LOW_POWER_PERIOD_US)
+		profile = BTFM_SLIM_PROFILE_LOW_POWER;
+	else
+		profile = BTFM_SLIM_PROFILE_DEFAULT;
+
+	btfmslim->dai_profile[dai->id] = profile;
+	btfmslim->dai_period_us[dai->id] = period_us;
+
+	BTFMSLIM_DBG("period %u us, profile %d", period_us, profile);
+
 	return 0;
 }
 
@@ -210,11 +298,23 @@ static int btfm_slim_dai_prepare(struct snd_pcm_substream *substream,
 		return ret;
 	}
 
+	btfmslim->profile = btfmslim->dai_profile[dai->id];
+	btfmslim->port_wm = 0;
+
 	ret = btfm_slim_enable_ch(btfmslim, ch, rxport, dai->rate, grp, nchan);
 
 	/* save the enable channel status */
-	if (ret == 0)
+	if (ret == 0) {
 		bt_soc_enable_status = 1;
+
+		/* One ALSA period plus the samples the port holds before
+		 * it is serviced. Buffering in the DSP and the BT SoC
+		 * isn't visible here and comes on top.
+		 */
+		btfmslim->dai_latency_us[dai->id] =
+			btfmslim->dai_period_us[dai->id] + (dai->rate ?
+			btfmslim->port_wm * USEC_PER_SEC / dai->rate : 0);
+	}
 	return ret;
 }
 
@@ -80,11 +80,31 @@ static inline int is_fm_port(uint8_t port_num)
 		return 0;
 }
 
+/* A low watermark has the port refilled or drained after fewer samples,
+ * a high one lets the SoC batch more samples per SLIMbus service.
+ */
+static uint8_t btfm_slim_chrk_port_wm(struct btfmslim *btfmslim,
+	uint8_t port_num)
+{
+	if (is_fm_port(port_num))
+		return CHRK_SB_PGD_PORT_WM_L8;
+
+	switch (btfmslim->profile) {
+	case BTFM_SLIM_PROFILE_LOW_LATENCY:
+		return CHRK_SB_PGD_PORT_WM_L1;
+	case BTFM_SLIM_PROFILE_LOW_POWER:
+		return CHRK_SB_PGD_PORT_WM_LB;
+	default:
+		return port_num == CHRK_SB_PGD_PORT_TX_SCO ?
+			CHRK_SB_PGD_PORT_WM_L1 : CHRK_SB_PGD_PORT_WM_LB;
+	}
+}
+
 int btfm_slim_chrk_enable_port(struct btfmslim *btfmslim, uint8_t port_num,
 	uint8_t rxport, uint8_t enable)
 {
 	int ret = 0;
-	uint8_t reg_val = 0, en;
+	uint8_t reg_val = 0, en, wm;
 	uint8_t rxport_num = 0;
 	uint16_t reg;
 	uint8_t prev_reg_val = 0;
@@ -189,12 +209,17 @@ int btfm_slim_chrk_enable_port(struct btfmslim *btfmslim, uint8_t port_num,
 	else
 		en = CHRK_SB_PGD_PORT_DISABLE;
 
+	wm = btfm_slim_chrk_port_wm(btfmslim, port_num);
 	if (is_fm_port(port_num))
-		reg_val = en | CHRK_SB_PGD_PORT_WM_L8;
-	else if (port_num == CHRK_SB_PGD_PORT_TX_SCO)
-		reg_val = enable ? en | CHRK_SB_PGD_PORT_WM_L1 : en;
+		reg_val = en | wm;
 	else
-		reg_val = enable ? en | CHRK_SB_PGD_PORT_WM_LB : en;
+		reg_val = enable ? en | wm : en;
+
+	if (enable) {
+		btfmslim->port_wm = CHRK_SB_PGD_PORT_WM_LEVEL(wm);
+		BTFMSLIM_DBG("port(%d) profile(%d) watermark(%d)", port_num,
+			btfmslim->profile, btfmslim->port_wm);
+	}
 
 	if (enable && port_num == CHRK_SB_PGD_PORT_TX_SCO)
 		BTFMSLIM_INFO("programming SCO Tx with reg_val %d to reg 0x%x",
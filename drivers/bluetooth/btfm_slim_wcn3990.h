@@ -70,6 +70,7 @@
 #define CHRK_SB_PGD_PORT_WM_L3			(0x3 << 1)
 #define CHRK_SB_PGD_PORT_WM_L8			(0x8 << 1)
 #define CHRK_SB_PGD_PORT_WM_LB			(0xB << 1)
+#define CHRK_SB_PGD_PORT_WM_LEVEL(wm)		((wm) >> 1)
 
 #define CHRK_SB_PGD_PORT_RX_NUM			16
 #define CHRK_SB_PGD_PORT_TX_NUM			16
@@ -140,6 +140,48 @@ int hci_uart_tx_wakeup(struct hci_uart *hu)
 	return 0;
 }
 
+/* Copy @skb and whatever else is queued behind it into the batch buffer.
+ * The first packet that doesn't fit is left in tx_skb for the next batch.
+ */
+static void hci_uart_fill_batch(struct hci_uart *hu, struct sk_buff *skb)
+{
+	hu->tx_batch_len = 0;
+	hu->tx_batch_off = 0;
+
+	do {
+		if (hu->tx_batch_len + skb->len > HCI_UART_TX_BATCH_SIZE) {
+			hu->tx_skb = skb;
+			break;
+		}
+
+		memcpy(hu->tx_batch + hu->tx_batch_len, skb->data, skb->len);
+		hu->tx_batch_len += skb->len;
+		hu->tx_pkts++;
+
+		hci_uart_tx_complete(hu, hci_skb_pkt_type(skb));
+		kfree_skb(skb);
+	} while ((skb = hci_uart_dequeue(hu)));
+}
+
+/* Returns false if the tty took only part of the batch */
+static bool hci_uart_write_batch(struct hci_uart *hu)
+{
+	struct tty_struct *tty = hu->tty;
+	int len;
+
+	set_bit(TTY_DO_WRITE_WAKEUP, &tty->flags);
+	len = tty->ops->write(tty, hu->tx_batch + hu->tx_batch_off,
+			      hu->tx_batch_len - hu->tx_batch_off);
+	if (len <= 0)
+		return false;
+
+	hu->hdev->stat.byte_tx += len;
+	hu->tx_batch_off += len;
+	hu->tx_writes++;
+
+	return hu->tx_batch_off == hu->tx_batch_len;
+}
+
 static void hci_uart_write_work(struct work_struct *work)
 {
 	struct hci_uart *hu = container_of(work, struct hci_uart, write_work);
@@ -154,12 +196,25 @@ static void hci_uart_write_work(struct work_struct *work)
 restart:
 	clear_bit(HCI_UART_TX_WAKEUP, &hu->tx_state);
 
+	/* Finish the batch the tty didn't take in full last time */
+	if (hu->tx_batch_off < hu->tx_batch_len && !hci_uart_write_batch(hu))
+		goto out;
+
 	while ((skb = hci_uart_dequeue(hu))) {
 		int len;
 
+		/* Only a packet bigger than the buffer goes out on its own */
+		if (hu->tx_batch && skb->len <= HCI_UART_TX_BATCH_SIZE) {
+			hci_uart_fill_batch(hu, skb);
+			if (!hci_uart_write_batch(hu))
+				break;
+			continue;
+		}
+
 		set_bit(TTY_DO_WRITE_WAKEUP, &tty->flags);
 		len = tty->ops->write(tty, skb->data, skb->len);
 		hdev->stat.byte_tx += len;
+		hu->tx_writes++;
 
 		skb_pull(skb, len);
 		if (skb->len) {
@@ -167,10 +222,12 @@ static void hci_uart_write_work(struct work_struct *work)
 			break;
 		}
 
+		hu->tx_pkts++;
 		hci_uart_tx_complete(hu, hci_skb_pkt_type(skb));
 		kfree_skb(skb);
 	}
 
+out:
 	if (test_bit(HCI_UART_TX_WAKEUP, &hu->tx_state))
 		goto restart;
 
@@ -227,6 +284,8 @@ static int hci_uart_flush(struct hci_dev *hdev)
 	if (hu->tx_skb) {
 		kfree_skb(hu->tx_skb); hu->tx_skb = NULL;
 	}
+	hu->tx_batch_len = 0;
+	hu->tx_batch_off = 0;
 
 	/* Flush any pending characters in the driver and discipline. */
 	tty_ldisc_flush(tty);
@@ -469,6 +528,9 @@ static int hci_uart_tty_open(struct tty_struct *tty)
 		return -ENFILE;
 	}
 
+	/* Without the batch buffer packets are written one at a time */
+	hu->tx_batch = kmalloc(HCI_UART_TX_BATCH_SIZE, GFP_KERNEL);
+
 	tty->disc_data = hu;
 	hu->tty = tty;
 	tty->receive_room = 65536;
@@ -516,6 +578,7 @@ static void hci_uart_tty_close(struct tty_struct *tty)
 	}
 	clear_bit(HCI_UART_PROTO_SET, &hu->flags);
 
+	kfree(hu->tx_batch);
 	kfree(hu);
 }
 
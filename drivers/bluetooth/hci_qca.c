@@ -30,6 +30,7 @@
 
 #include <linux/kernel.h>
 #include <linux/debugfs.h>
+#include <linux/math64.h>
 
 #include <net/bluetooth/bluetooth.h>
 #include <net/bluetooth/hci_core.h>
@@ -75,6 +76,7 @@ enum hci_ibs_clock_state_vote {
 struct qca_data {
 	struct hci_uart *hu;
 	struct sk_buff *rx_skb;
+	struct sk_buff_head rx_q;	/* Frames of one tty receive */
 	struct sk_buff_head txq;
 	struct sk_buff_head tx_wait_q;	/* HCI_IBS wait queue	*/
 	spinlock_t hci_ibs_lock;	/* HCI_IBS state lock	*/
@@ -109,6 +111,7 @@ struct qca_data {
 	u64 rx_votes_off;
 	u64 votes_on;
 	u64 votes_off;
+	u64 open_jif;
 };
 
 static void __serial_clock_on(struct tty_struct *tty)
@@ -329,6 +332,15 @@ static void hci_ibs_tx_idle_timeout(unsigned long arg)
 
 	switch (qca->tx_ibs_state) {
 	case HCI_IBS_TX_AWAKE:
+		/* Packets still queued for the tty would only wake the
+		 * device up again, keep the vote until they are written.
+		 */
+		if (!skb_queue_empty(&qca->txq)) {
+			mod_timer(&qca->tx_idle_timer, jiffies +
+				  msecs_to_jiffies(qca->tx_idle_delay));
+			break;
+		}
+
 		/* TX_IDLE, go to SLEEP */
 		if (send_hci_ibs_cmd(HCI_IBS_SLEEP_IND, hu) < 0) {
 			BT_ERR("Failed to send SLEEP to device");
@@ -405,6 +417,7 @@ static int qca_open(struct hci_uart *hu)
 
 	skb_queue_head_init(&qca->txq);
 	skb_queue_head_init(&qca->tx_wait_q);
+	skb_queue_head_init(&qca->rx_q);
 	spin_lock_init(&qca->hci_ibs_lock);
 	qca->workqueue = alloc_ordered_workqueue("qca_wq", 0);
 	if (!qca->workqueue) {
@@ -444,6 +457,7 @@ static int qca_open(struct hci_uart *hu)
 	qca->tx_votes_off = 0;
 	qca->rx_votes_on = 0;
 	qca->rx_votes_off = 0;
+	qca->open_jif = jiffies;
 
 	hu->priv = qca;
 
@@ -463,6 +477,19 @@ static int qca_open(struct hci_uart *hu)
 	return 0;
 }
 
+static int qca_ibs_rate_get(void *data, u64 *val)
+{
+	struct qca_data *qca = data;
+	u32 secs = (jiffies - qca->open_jif) / HZ;
+
+	*val = qca->ibs_sent_slps + qca->ibs_sent_wakes +
+	       qca->ibs_recv_slps + qca->ibs_recv_wakes;
+	*val = secs ? div_u64(*val, secs) : 0;
+
+	return 0;
+}
+DEFINE_SIMPLE_ATTRIBUTE(qca_ibs_rate_fops, qca_ibs_rate_get, NULL, "%llu\n");
+
 static void qca_debugfs_init(struct hci_dev *hdev)
 {
 	struct hci_uart *hu = hci_get_drvdata(hdev);
@@ -501,6 +528,11 @@ static void qca_debugfs_init(struct hci_dev *hdev)
 	debugfs_create_u64("votes_off", mode, ibs_dir, &qca->votes_off);
 	debugfs_create_u32("vote_on_ms", mode, ibs_dir, &qca->vote_on_ms);
 	debugfs_create_u32("vote_off_ms", mode, ibs_dir, &qca->vote_off_ms);
+	debugfs_create_file("transitions_per_sec", mode, ibs_dir, qca,
+			    &qca_ibs_rate_fops);
+	/* tx_pkts / tx_writes is the number of packets per tty write */
+	debugfs_create_u64("tx_pkts", mode, ibs_dir, &hu->tx_pkts);
+	debugfs_create_u64("tx_writes", mode, ibs_dir, &hu->tx_writes);
 
 	/* read/write */
 	mode = S_IRUGO | S_IWUSR;
@@ -537,6 +569,7 @@ static int qca_close(struct hci_uart *hu)
 
 	skb_queue_purge(&qca->tx_wait_q);
 	skb_queue_purge(&qca->txq);
+	skb_queue_purge(&qca->rx_q);
 	del_timer(&qca->tx_idle_timer);
 	del_timer(&qca->wake_retrans_timer);
 	destroy_workqueue(qca->workqueue);
@@ -776,6 +809,27 @@ static int qca_ibs_wake_ack(struct hci_dev *hdev, struct sk_buff *skb)
 	return 0;
 }
 
+/* Complete frames are held until the whole tty buffer is parsed and then
+ * handed to the HCI core together, in the order they arrived.
+ */
+static int qca_recv_frame(struct hci_dev *hdev, struct sk_buff *skb)
+{
+	struct hci_uart *hu = hci_get_drvdata(hdev);
+	struct qca_data *qca = hu->priv;
+
+	__skb_queue_tail(&qca->rx_q, skb);
+	return 0;
+}
+
+static void qca_recv_flush(struct hci_uart *hu)
+{
+	struct qca_data *qca = hu->priv;
+	struct sk_buff *skb;
+
+	while ((skb = __skb_dequeue(&qca->rx_q)))
+		hci_recv_frame(hu->hdev, skb);
+}
+
 #define QCA_IBS_SLEEP_IND_EVENT \
 	.type = HCI_IBS_SLEEP_IND, \
 	.hlen = 0, \
@@ -798,9 +852,9 @@ static int qca_ibs_wake_ack(struct hci_dev *hdev, struct sk_buff *skb)
 	.maxlen = HCI_MAX_IBS_SIZE
 
 static const struct h4_recv_pkt qca_recv_pkts[] = {
-	{ H4_RECV_ACL,             .recv = hci_recv_frame    },
-	{ H4_RECV_SCO,             .recv = hci_recv_frame    },
-	{ H4_RECV_EVENT,           .recv = hci_recv_frame    },
+	{ H4_RECV_ACL,             .recv = qca_recv_frame    },
+	{ H4_RECV_SCO,             .recv = qca_recv_frame    },
+	{ H4_RECV_EVENT,           .recv = qca_recv_frame    },
 	{ QCA_IBS_WAKE_IND_EVENT,  .recv = qca_ibs_wake_ind  },
 	{ QCA_IBS_WAKE_ACK_EVENT,  .recv = qca_ibs_wake_ack  },
 	{ QCA_IBS_SLEEP_IND_EVENT, .recv = qca_ibs_sleep_ind },
@@ -815,6 +869,7 @@ static int qca_recv(struct hci_uart *hu, const void *data, int count)
 
 	qca->rx_skb = h4_recv_buf(hu->hdev, qca->rx_skb, data, count,
 				  qca_recv_pkts, ARRAY_SIZE(qca_recv_pkts));
+	qca_recv_flush(hu);
 	if (IS_ERR(qca->rx_skb)) {
 		int err = PTR_ERR(qca->rx_skb);
 		BT_ERR("%s: Frame reassembly failed (%d)", hu->hdev->name, err);
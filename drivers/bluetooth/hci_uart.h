@@ -90,6 +90,12 @@ struct hci_uart {
 	struct sk_buff		*tx_skb;
 	unsigned long		tx_state;
 
+	u8			*tx_batch;
+	unsigned int		tx_batch_len;
+	unsigned int		tx_batch_off;
+	u64			tx_pkts;
+	u64			tx_writes;
+
 	unsigned int init_speed;
 	unsigned int oper_speed;
 };
@@ -99,6 +105,11 @@ struct hci_uart {
 #define HCI_UART_REGISTERED	1
 #define HCI_UART_PROTO_READY	2
 
+/* Packets queued together are copied into one buffer of this size and
+ * handed to the tty in a single write
+ */
+#define HCI_UART_TX_BATCH_SIZE	PAGE_SIZE
+
 /* TX states  */
 #define HCI_UART_SENDING	1
 #define HCI_UART_TX_WAKEUP	2
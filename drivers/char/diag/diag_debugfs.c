@@ -30,6 +30,7 @@
 #endif
 #include "diagmem.h"
 #include "diag_dci.h"
+#include "diag_masks.h"
 #include "diag_usb.h"
 #include "diagfwd_peripheral.h"
 #include "diagfwd_smd.h"
@@ -260,6 +261,44 @@ static ssize_t diag_dbgfs_read_power(struct file *file, char __user *ubuf,
 	return ret;
 }
 
+static ssize_t diag_dbgfs_read_filter(struct file *file, char __user *ubuf,
+				      size_t count, loff_t *ppos)
+{
+	char *buf;
+	int ret = 0;
+	int i, j;
+	unsigned int buf_size;
+	unsigned long log_drop;
+	struct diag_filter_stats *stats = NULL;
+
+	buf = kzalloc(sizeof(char) * DEBUG_BUF_SIZE, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	buf_size = ksize(buf);
+	for (i = 0; i < NUM_MD_SESSIONS; i++) {
+		stats = &diag_filter_stats[i];
+		log_drop = 0;
+		for (j = 0; j < MAX_EQUIP_ID; j++)
+			log_drop += stats->log_drop[j];
+		ret += scnprintf(buf + ret, buf_size - ret,
+			"p: %d pass: %lu msg drop: %lu log drop: %lu\n",
+			i, stats->pass, stats->msg_drop, log_drop);
+		for (j = 0; j < MAX_EQUIP_ID; j++) {
+			if (!stats->log_drop[j])
+				continue;
+			ret += scnprintf(buf + ret, buf_size - ret,
+				"\tequip id %d: %lu\n", j,
+				stats->log_drop[j]);
+		}
+	}
+
+	ret = simple_read_from_buffer(ubuf, count, ppos, buf, ret);
+
+	kfree(buf);
+	return ret;
+}
+
 static ssize_t diag_dbgfs_read_table(struct file *file, char __user *ubuf,
 				     size_t count, loff_t *ppos)
 {
@@ -372,8 +411,11 @@ static ssize_t diag_dbgfs_read_mempool(struct file *file, char __user *ubuf,
 			"%-10s\t"
 			"%-5s\t"
 			"%-5s\t"
+			"%-5s\t"
+			"%-5s\t"
 			"%-5s\n",
-			"POOL", "HANDLE", "COUNT", "SIZE", "ITEMSIZE");
+			"POOL", "HANDLE", "COUNT", "SIZE", "ITEMSIZE",
+			"HWM", "FAIL");
 	bytes_in_buffer += bytes_written;
 	bytes_remaining = buf_size - bytes_in_buffer;
 
@@ -384,12 +426,16 @@ static ssize_t diag_dbgfs_read_mempool(struct file *file, char __user *ubuf,
 			"%-10p\t"
 			"%-5d\t"
 			"%-5d\t"
-			"%-5d\n",
+			"%-5d\t"
+			"%-5d\t"
+			"%-5u\n",
 			mempool->name,
 			mempool->pool,
 			mempool->count,
 			mempool->poolsize,
-			mempool->itemsize);
+			mempool->itemsize,
+			mempool->high_water,
+			mempool->fail_count);
 		bytes_in_buffer += bytes_written;
 
 		/* Check if there is room to add another table entry */
@@ -1154,6 +1200,10 @@ const struct file_operations diag_dbgfs_power_ops = {
 	.read = diag_dbgfs_read_power,
 };
 
+const struct file_operations diag_dbgfs_filter_ops = {
+	.read = diag_dbgfs_read_filter,
+};
+
 #ifdef CONFIG_IPC_LOGGING
 const struct file_operations diag_dbgfs_debug_ops = {
 	.write = diag_dbgfs_write_debug
@@ -1220,6 +1270,11 @@ int diag_debugfs_init(void)
 	if (!entry)
 		goto err;
 
+	entry = debugfs_create_file("filter", 0444, diag_dbgfs_dent, 0,
+				    &diag_dbgfs_filter_ops);
+	if (!entry)
+		goto err;
+
 #ifdef CONFIG_IPC_LOGGING
 	entry = debugfs_create_file("debug", 0444, diag_dbgfs_dent, 0,
 				    &diag_dbgfs_debug_ops);
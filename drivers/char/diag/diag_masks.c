@@ -16,9 +16,11 @@
 #include <linux/kmemleak.h>
 #include <linux/workqueue.h>
 #include <linux/uaccess.h>
+#include <asm/unaligned.h>
 #include "diagchar.h"
 #include "diagfwd_cntl.h"
 #include "diag_masks.h"
+#include "diag_dci.h"
 #include "diagfwd_peripheral.h"
 #include "diag_ipc_logging.h"
 
@@ -27,6 +29,11 @@
 
 #define DIAG_SET_FEATURE_MASK(x) (feature_bytes[(x)/8] |= (1 << (x & 0x7)))
 
+#define DIAG_LOG_PKT_CODE_OFFSET	6
+#define DIAG_EXT_MSG_CMD_CODE		0x79
+#define DIAG_EXT_MSG_SSID_OFFSET	14
+#define DIAG_EXT_MSG_MIN_LEN		20
+
 struct diag_mask_info msg_mask;
 struct diag_mask_info msg_bt_mask;
 struct diag_mask_info log_mask;
@@ -2255,6 +2262,118 @@ int diag_copy_to_user_log_mask(char __user *buf, size_t count,
 	return err ? err : total_len;
 }
 
+struct diag_filter_stats diag_filter_stats[NUM_MD_SESSIONS];
+
+static int diag_log_code_enabled(struct diag_mask_info *mask_info,
+				 uint16_t log_code)
+{
+	uint8_t equip_id = LOG_GET_EQUIP_ID(log_code);
+	uint16_t item_num = LOG_GET_ITEM_NUM(log_code);
+	struct diag_log_mask_t *mask = NULL;
+	int enabled = 1;
+
+	mutex_lock(&mask_info->lock);
+	if (mask_info->status == DIAG_CTRL_MASK_ALL_DISABLED) {
+		enabled = 0;
+	} else if (mask_info->status == DIAG_CTRL_MASK_VALID &&
+		   mask_info->ptr) {
+		mask = (struct diag_log_mask_t *)mask_info->ptr + equip_id;
+		mutex_lock(&mask->lock);
+		if (mask->equip_id == equip_id && mask->ptr &&
+		    item_num < mask->num_items_tools)
+			enabled = !!(mask->ptr[item_num / 8] &
+				     (1 << (item_num % 8)));
+		mutex_unlock(&mask->lock);
+	}
+	mutex_unlock(&mask_info->lock);
+
+	return enabled;
+}
+
+static int diag_msg_ssid_enabled(struct diag_mask_info *mask_info,
+				 uint8_t tbl_count, uint16_t ssid,
+				 uint32_t ss_mask)
+{
+	struct diag_msg_mask_t *mask = NULL;
+	int enabled = 1, i;
+
+	mutex_lock(&mask_info->lock);
+	if (mask_info->status == DIAG_CTRL_MASK_ALL_DISABLED) {
+		enabled = 0;
+	} else if (mask_info->status == DIAG_CTRL_MASK_VALID &&
+		   mask_info->ptr) {
+		mutex_lock(&driver->msg_mask_lock);
+		mask = (struct diag_msg_mask_t *)mask_info->ptr;
+		for (i = 0; i < tbl_count; i++, mask++) {
+			if (ssid < mask->ssid_first ||
+			    ssid > mask->ssid_last_tools)
+				continue;
+			mutex_lock(&mask->lock);
+			if (mask->ptr)
+				enabled = !!(mask->ptr[ssid - mask->ssid_first] &
+					     ss_mask);
+			mutex_unlock(&mask->lock);
+			break;
+		}
+		mutex_unlock(&driver->msg_mask_lock);
+	}
+	mutex_unlock(&mask_info->lock);
+
+	return enabled;
+}
+
+/*
+ * diag_masks_filter_pkt
+ *
+ * Checks a log packet or extended F3 message from a peripheral against the
+ * masks of the memory device session @info that owns the peripheral. Packets
+ * that the masks don't cover, or that can't be parsed, are always let
+ * through. Must be called with md_session_lock held.
+ *
+ * Returns 1 if the packet should be dropped, 0 otherwise.
+ */
+int diag_masks_filter_pkt(struct diag_md_session_t *info, int peripheral,
+			  const uint8_t *pkt, int len)
+{
+	struct diag_filter_stats *stats = NULL;
+	uint16_t log_code, ssid;
+	uint32_t ss_mask;
+
+	if (!info || !pkt || len <= 0 || peripheral < 0 ||
+	    peripheral >= NUM_MD_SESSIONS)
+		return 0;
+
+	stats = &diag_filter_stats[peripheral];
+	switch (*pkt) {
+	case LOG_CMD_CODE:
+		if (len < DIAG_LOG_PKT_CODE_OFFSET + sizeof(log_code) ||
+		    !info->log_mask)
+			break;
+		log_code = get_unaligned_le16(pkt + DIAG_LOG_PKT_CODE_OFFSET);
+		if (diag_log_code_enabled(info->log_mask, log_code))
+			break;
+		stats->log_drop[LOG_GET_EQUIP_ID(log_code)]++;
+		return 1;
+	case DIAG_EXT_MSG_CMD_CODE:
+		if (len < DIAG_EXT_MSG_MIN_LEN || !info->msg_mask)
+			break;
+		ssid = get_unaligned_le16(pkt + DIAG_EXT_MSG_SSID_OFFSET);
+		ss_mask = get_unaligned_le32(pkt + DIAG_EXT_MSG_SSID_OFFSET +
+					     sizeof(ssid));
+		if (diag_msg_ssid_enabled(info->msg_mask,
+					  info->msg_mask_tbl_count, ssid,
+					  ss_mask))
+			break;
+		stats->msg_drop++;
+		return 1;
+	default:
+		break;
+	}
+
+	stats->pass++;
+	return 0;
+}
+
 void diag_send_updates_peripheral(uint8_t peripheral)
 {
 	if (!driver->feature[peripheral].sent_feature_mask)
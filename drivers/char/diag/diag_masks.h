@@ -158,6 +158,15 @@ struct diag_log_mask_userspace_t {
 #define DIAG_CTRL_MASK_ALL_ENABLED	2
 #define DIAG_CTRL_MASK_VALID		3
 
+/* Packets dropped by diag_masks_filter_pkt() for a peripheral or PD */
+struct diag_filter_stats {
+	unsigned long log_drop[MAX_EQUIP_ID];
+	unsigned long msg_drop;
+	unsigned long pass;
+};
+
+extern struct diag_filter_stats diag_filter_stats[NUM_MD_SESSIONS];
+
 extern struct diag_mask_info msg_mask;
 extern struct diag_mask_info msg_bt_mask;
 extern struct diag_mask_info log_mask;
@@ -176,6 +185,8 @@ void diag_msg_mask_free(struct diag_mask_info *mask_info,
 	struct diag_md_session_t *session_info);
 void diag_event_mask_free(struct diag_mask_info *mask_info);
 int diag_process_apps_masks(unsigned char *buf, int len, int pid);
+int diag_masks_filter_pkt(struct diag_md_session_t *info, int peripheral,
+			  const uint8_t *pkt, int len);
 void diag_send_updates_peripheral(uint8_t peripheral);
 
 extern int diag_create_msg_mask_table_entry(struct diag_msg_mask_t *msg_mask,
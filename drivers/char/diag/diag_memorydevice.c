@@ -22,6 +22,8 @@
 #include <linux/delay.h>
 #include <linux/kmemleak.h>
 #include <linux/uaccess.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
 #include "diagchar.h"
 #include "diag_memorydevice.h"
 #include "diagfwd_bridge.h"
@@ -135,6 +137,147 @@ void diag_md_close_all(void)
 	diag_ws_reset(DIAG_WS_MUX);
 }
 
+#define DIAG_MD_RING_MAX	(16 * 1024 * 1024)
+
+int diag_md_ring_alloc(struct diag_md_session_t *session, uint32_t size)
+{
+	struct diag_md_ring *ring;
+
+	if (!session)
+		return -EINVAL;
+	if (session->ring)
+		return -EEXIST;
+	if (!size || size > DIAG_MD_RING_MAX)
+		return -EINVAL;
+
+	ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+	if (!ring)
+		return -ENOMEM;
+
+	ring->size = PAGE_ALIGN(size);
+	ring->base = vmalloc_user(PAGE_SIZE + ring->size);
+	if (!ring->base) {
+		kfree(ring);
+		return -ENOMEM;
+	}
+	ring->ctl = ring->base;
+	ring->data = ring->base + PAGE_SIZE;
+	ring->ctl->size = ring->size;
+	spin_lock_init(&ring->lock);
+	session->ring = ring;
+
+	return 0;
+}
+
+void diag_md_ring_free(struct diag_md_session_t *session)
+{
+	if (!session || !session->ring)
+		return;
+
+	/* Pages still mapped by the client stay around until it unmaps */
+	vfree(session->ring->base);
+	kfree(session->ring);
+	session->ring = NULL;
+}
+
+int diag_md_ring_mmap(struct diag_md_session_t *session,
+		      struct vm_area_struct *vma)
+{
+	unsigned long len = vma->vm_end - vma->vm_start;
+
+	if (!session || !session->ring)
+		return -ENODEV;
+	if (vma->vm_pgoff || len > PAGE_SIZE + session->ring->size)
+		return -EINVAL;
+
+	return remap_vmalloc_range(vma, session->ring->base, 0);
+}
+
+static uint32_t diag_md_ring_used(struct diag_md_ring *ring, uint32_t tail)
+{
+	return (ring->head >= tail) ? ring->head - tail :
+				      ring->size - tail + ring->head;
+}
+
+bool diag_md_ring_ready(struct diag_md_session_t *session)
+{
+	struct diag_md_ring *ring;
+	uint32_t tail;
+
+	if (!session || !session->ring)
+		return false;
+
+	ring = session->ring;
+	tail = READ_ONCE(ring->ctl->tail);
+	if (tail >= ring->size)
+		return false;
+
+	return diag_md_ring_used(ring, tail) >=
+		max_t(uint32_t, READ_ONCE(ring->ctl->watermark), 1);
+}
+
+/*
+ * Copy one packet into the session's ring. Only the driver moves head, so
+ * the value shared with the client is never read back; the client's tail is
+ * sampled once and sanity checked.
+ */
+static int diag_md_ring_write(struct diag_md_ring *ring, uint32_t proc,
+			      unsigned char *buf, int len, bool *wake)
+{
+	struct diag_md_ring_rec *rec;
+	uint32_t tail, used, need, to_end;
+	unsigned long flags;
+
+	*wake = false;
+	spin_lock_irqsave(&ring->lock, flags);
+	tail = READ_ONCE(ring->ctl->tail) & ~3U;
+	if (tail >= ring->size) {
+		spin_unlock_irqrestore(&ring->lock, flags);
+		return -EINVAL;
+	}
+
+	used = diag_md_ring_used(ring, tail);
+	need = sizeof(*rec) + ALIGN(len, 4);
+	to_end = ring->size - ring->head;
+	if (to_end < need)
+		need += to_end;
+
+	/* Keep one word free so that a full ring doesn't look empty */
+	if (used + need + 4 > ring->size) {
+		ring->ctl->dropped++;
+		spin_unlock_irqrestore(&ring->lock, flags);
+		return -ENOMEM;
+	}
+
+	if (to_end < sizeof(*rec) + ALIGN(len, 4)) {
+		if (to_end >= sizeof(*rec)) {
+			rec = (struct diag_md_ring_rec *)(ring->data +
+							  ring->head);
+			rec->proc = proc;
+			rec->len = DIAG_MD_RING_PAD;
+		}
+		ring->head = 0;
+	}
+
+	rec = (struct diag_md_ring_rec *)(ring->data + ring->head);
+	rec->proc = proc;
+	rec->len = len;
+	memcpy(rec + 1, buf, len);
+	ring->head += sizeof(*rec) + ALIGN(len, 4);
+	if (ring->head >= ring->size)
+		ring->head = 0;
+
+	/* Packet contents must be visible before the new head */
+	smp_wmb();
+	WRITE_ONCE(ring->ctl->head, ring->head);
+
+	used += need;
+	*wake = used >= max_t(uint32_t, READ_ONCE(ring->ctl->watermark), 1);
+	spin_unlock_irqrestore(&ring->lock, flags);
+
+	return 0;
+}
+
 int diag_md_write(int id, unsigned char *buf, int len, int ctx)
 {
 	int i, peripheral, pid = 0;
@@ -167,6 +310,25 @@ int diag_md_write(int id, unsigned char *buf, int len, int ctx)
 		return -EINVAL;
 	}
 
+	if (session_info->ring) {
+		bool wake;
+		int err;
+
+		err = diag_md_ring_write(session_info->ring,
+					 id ? diag_get_remote(id) : 0, buf, len,
+					 &wake);
+		mutex_unlock(&driver->md_session_lock);
+		if (err)
+			return err;
+		/* The packet lives in the ring now, hand the buffer back */
+		if (ch->ops && ch->ops->write_done)
+			ch->ops->write_done(buf, len, ctx,
+					    DIAG_MEMORY_DEVICE_MODE);
+		if (wake)
+			wake_up_interruptible(&driver->wait_q);
+		return 0;
+	}
+
 	spin_lock_irqsave(&ch->lock, flags);
 	for (i = 0; i < ch->num_tbl_entries && !found; i++) {
 		if (ch->tbl[i].buf != buf)
@@ -44,6 +44,17 @@ struct diag_md_info {
 	struct diag_mux_ops *ops;
 };
 
+struct vm_area_struct;
+
+struct diag_md_ring {
+	void *base;
+	struct diag_md_ring_ctl *ctl;
+	unsigned char *data;
+	uint32_t size;
+	uint32_t head;
+	spinlock_t lock;
+};
+
 extern struct diag_md_info diag_md[NUM_DIAG_MD_DEV];
 
 int diag_md_init(void);
@@ -57,4 +68,9 @@ int diag_md_close_peripheral(int id, uint8_t peripheral);
 int diag_md_write(int id, unsigned char *buf, int len, int ctx);
 int diag_md_copy_to_user(char __user *buf, int *pret, size_t buf_size,
 			 struct diag_md_session_t *info);
+int diag_md_ring_alloc(struct diag_md_session_t *session, uint32_t size);
+void diag_md_ring_free(struct diag_md_session_t *session);
+int diag_md_ring_mmap(struct diag_md_session_t *session,
+		      struct vm_area_struct *vma);
+bool diag_md_ring_ready(struct diag_md_session_t *session);
 #endif
@@ -22,6 +22,7 @@
 #include <linux/sched.h>
 #include <linux/ratelimit.h>
 #include <linux/timer.h>
+#include <linux/poll.h>
 #include <linux/sched.h>
 #ifdef CONFIG_DIAG_OVER_USB
 #include <linux/usb/usbdiag.h>
@@ -1322,6 +1323,7 @@ static void diag_md_session_exit(void)
 			diag_event_mask_free(session_info->event_mask);
 			kfree(session_info->event_mask);
 			session_info->event_mask = NULL;
+			diag_md_ring_free(session_info);
 			kfree(session_info);
 			session_info = NULL;
 			driver->md_session_map[i] = NULL;
@@ -1462,6 +1464,7 @@ static void diag_md_session_close(int pid)
 	kfree(session_info->event_mask);
 	session_info->event_mask = NULL;
 	del_timer(&session_info->hdlc_reset_timer);
+	diag_md_ring_free(session_info);
 
 	for (i = 0; i < NUM_MD_SESSIONS && !found; i++) {
 		if (driver->md_session_map[i] != NULL)
@@ -2448,6 +2451,18 @@ static int diag_ioctl_query_pd_logging(struct diag_logging_mode_param_t *param)
 	return ret;
 }
 
+static int diag_ioctl_md_ring_alloc(unsigned long ioarg)
+{
+	int err;
+
+	mutex_lock(&driver->md_session_lock);
+	err = diag_md_ring_alloc(diag_md_session_get_pid(current->tgid),
+				 (uint32_t)ioarg);
+	mutex_unlock(&driver->md_session_lock);
+
+	return err;
+}
+
 static void diag_ioctl_query_session_pid(struct diag_query_pid_t *param)
 {
 	int prev_pid = 0, test_pid = 0, i = 0, count = 0;
@@ -2796,6 +2811,9 @@ long diagchar_compat_ioctl(struct file *filp,
 		else
 			result = 0;
 		break;
+	case DIAG_IOCTL_MD_RING_ALLOC:
+		result = diag_ioctl_md_ring_alloc(ioarg);
+		break;
 	}
 	return result;
 }
@@ -2946,6 +2964,9 @@ long diagchar_ioctl(struct file *filp,
 		else
 			result = 0;
 		break;
+	case DIAG_IOCTL_MD_RING_ALLOC:
+		result = diag_ioctl_md_ring_alloc(ioarg);
+		break;
 	}
 	return result;
 }
@@ -4103,6 +4124,40 @@ static int diag_real_time_info_init(void)
 	return 0;
 }
 
+static int diagchar_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	int err;
+
+	mutex_lock(&driver->md_session_lock);
+	err = diag_md_ring_mmap(diag_md_session_get_pid(current->tgid), vma);
+	mutex_unlock(&driver->md_session_lock);
+
+	return err;
+}
+
+static unsigned int diagchar_poll(struct file *file, poll_table *wait)
+{
+	unsigned int mask = 0;
+	int i;
+
+	poll_wait(file, &driver->wait_q, wait);
+
+	mutex_lock(&driver->diagchar_mutex);
+	for (i = 0; i < driver->num_clients; i++) {
+		if (driver->client_map[i].pid == current->tgid &&
+		    atomic_read(&driver->data_ready_notif[i]) > 0)
+			mask |= POLLIN | POLLRDNORM;
+	}
+	mutex_unlock(&driver->diagchar_mutex);
+
+	mutex_lock(&driver->md_session_lock);
+	if (diag_md_ring_ready(diag_md_session_get_pid(current->tgid)))
+		mask |= POLLIN | POLLRDNORM;
+	mutex_unlock(&driver->md_session_lock);
+
+	return mask;
+}
+
 static const struct file_operations diagcharfops = {
 	.owner = THIS_MODULE,
 	.read = diagchar_read,
@@ -4111,6 +4166,8 @@ static const struct file_operations diagcharfops = {
 	.compat_ioctl = diagchar_compat_ioctl,
 #endif
 	.unlocked_ioctl = diagchar_ioctl,
+	.mmap = diagchar_mmap,
+	.poll = diagchar_poll,
 	.open = diagchar_open,
 	.release = diagchar_close
 };
@@ -4213,6 +4270,7 @@ static int __init diagchar_init(void)
 	kmemleak_not_leak(driver);
 
 	timer_in_progress = 0;
+	diag_hdlc_init();
 	diag_init_transport();
 	DIAG_LOG(DIAG_DEBUG_MUX, "Transport type set to %d\n",
 		driver->transport_set);
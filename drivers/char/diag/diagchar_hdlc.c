@@ -20,6 +20,9 @@
 #include <linux/uaccess.h>
 #include <linux/ratelimit.h>
 #include <linux/crc-ccitt.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <asm/unaligned.h>
 #include "diagchar_hdlc.h"
 #include "diagchar.h"
 
@@ -31,6 +34,58 @@ MODULE_LICENSE("GPL v2");
 #define CRC_16_L_STEP(xx_crc, xx_c) \
 	crc_ccitt_byte(xx_crc, xx_c)
 
+#define HDLC_HAS_ZERO(v) \
+	(((v) - REPEAT_BYTE(0x01)) & ~(v) & REPEAT_BYTE(0x80))
+
+/*
+ * crc_ccitt_table extended to slice-by-4: diag_crc_slice[k][x] is the CRC
+ * of byte x followed by k + 1 zero bytes. Filled in by diag_hdlc_init().
+ */
+static uint16_t diag_crc_slice[3][256] __read_mostly;
+
+static uint16_t diag_crc_ccitt(uint16_t crc, const uint8_t *buf, size_t len)
+{
+	uint32_t v;
+
+	while (len >= 4) {
+		v = crc ^ get_unaligned_le32(buf);
+		crc = diag_crc_slice[2][v & 0xFF] ^
+		      diag_crc_slice[1][(v >> 8) & 0xFF] ^
+		      diag_crc_slice[0][(v >> 16) & 0xFF] ^
+		      crc_ccitt_table[v >> 24];
+		buf += 4;
+		len -= 4;
+	}
+
+	return crc_ccitt(crc, buf, len);
+}
+
+/*
+ * Return the number of leading bytes in buf, up to len, that need no
+ * escaping. Whole words are checked for CONTROL_CHAR and ESC_CHAR at once.
+ */
+static size_t diag_hdlc_span(const uint8_t *buf, size_t len)
+{
+	const uint8_t *p = buf;
+	unsigned long v;
+
+	while (len >= sizeof(unsigned long)) {
+		v = get_unaligned((const unsigned long *)p);
+		if (HDLC_HAS_ZERO(v ^ REPEAT_BYTE(CONTROL_CHAR)) ||
+		    HDLC_HAS_ZERO(v ^ REPEAT_BYTE(ESC_CHAR)))
+			break;
+		p += sizeof(unsigned long);
+		len -= sizeof(unsigned long);
+	}
+
+	while (len && *p != CONTROL_CHAR && *p != ESC_CHAR) {
+		p++;
+		len--;
+	}
+
+	return p - buf;
+}
+
 void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 		      struct diag_hdlc_dest_type *enc)
 {
@@ -42,6 +97,7 @@ void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 	unsigned char src_byte = 0;
 	enum diag_send_state_enum_type state;
 	unsigned int used = 0;
+	size_t span;
 
 	if (!src_desc || !enc)
 		return;
@@ -69,27 +125,29 @@ void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 		 * of 2 dest bytes for an escaped byte
 		 */
 		while (src <= src_last && dest <= dest_last) {
+			/* Copy the run of bytes that need no escaping */
+			span = diag_hdlc_span(src, min(src_last - src,
+						       dest_last - dest) + 1);
+			if (span) {
+				memcpy(dest, src, span);
+				crc = diag_crc_ccitt(crc, src, span);
+				src += span;
+				dest += span;
+				used += span;
+				continue;
+			}
 
 			src_byte = *src++;
-			if ((src_byte == CONTROL_CHAR) ||
-			    (src_byte == ESC_CHAR)) {
-				/* If the escape character is not the
-				 * last byte
-				 */
-				if (dest != dest_last) {
-					crc = CRC_16_L_STEP(crc, src_byte);
-					*dest++ = ESC_CHAR;
-					used++;
-					*dest++ = src_byte ^ ESC_MASK;
-					used++;
-				} else {
-					src--;
-					break;
-				}
-			} else {
+			/* If the escape character is not the last byte */
+			if (dest != dest_last) {
 				crc = CRC_16_L_STEP(crc, src_byte);
-				*dest++ = src_byte;
+				*dest++ = ESC_CHAR;
+				used++;
+				*dest++ = src_byte ^ ESC_MASK;
 				used++;
+			} else {
+				src--;
+				break;
 			}
 		}
 
@@ -157,6 +215,7 @@ int diag_hdlc_decode(struct diag_hdlc_decode_type *hdlc)
 	unsigned int len = 0;
 	unsigned int i;
 	uint8_t src_byte;
+	size_t span;
 
 	int pkt_bnd = HDLC_INCOMPLETE;
 	int msg_start;
@@ -177,6 +236,18 @@ int diag_hdlc_decode(struct diag_hdlc_decode_type *hdlc)
 
 		for (i = 0; i < src_length; i++) {
 
+			if (!hdlc->escaping) {
+				/* Copy the run of unescaped bytes */
+				span = diag_hdlc_span(&src_ptr[i],
+						      min(src_length - i,
+							  dest_length - len));
+				memcpy(&dest_ptr[len], &src_ptr[i], span);
+				len += span;
+				i += span;
+				if (len >= dest_length || i >= src_length)
+					break;
+			}
+
 			src_byte = src_ptr[i];
 
 			if (hdlc->escaping) {
@@ -235,7 +306,7 @@ int crc_check(uint8_t *buf, uint16_t len)
 	 * Run CRC check for the original input. Skip the last 3 CRC
 	 * bytes
 	 */
-	crc = crc_ccitt(crc, buf, len-3);
+	crc = diag_crc_ccitt(crc, buf, len-3);
 	crc ^= CRC_16_L_SEED;
 
 	/* Check the computed CRC against the original CRC bytes. */
@@ -249,3 +320,233 @@ int crc_check(uint8_t *buf, uint16_t len)
 
 	return 0;
 }
+
+#ifdef DEBUG
+/* The byte at a time encoder that diag_hdlc_encode() is checked against */
+static void __init diag_hdlc_encode_ref(struct diag_send_desc_type *src_desc,
+					struct diag_hdlc_dest_type *enc)
+{
+	uint8_t *dest;
+	uint8_t *dest_last;
+	const uint8_t *src;
+	const uint8_t *src_last;
+	uint16_t crc;
+	unsigned char src_byte = 0;
+	enum diag_send_state_enum_type state;
+	unsigned int used = 0;
+
+	if (!src_desc || !enc)
+		return;
+
+	/* Copy parts to local variables. */
+	src = src_desc->pkt;
+	src_last = src_desc->last;
+	state = src_desc->state;
+	dest = enc->dest;
+	dest_last = enc->dest_last;
+
+	if (state == DIAG_STATE_START) {
+		crc = CRC_16_L_SEED;
+		state++;
+	} else {
+		/* Get a local copy of the CRC */
+		crc = enc->crc;
+	}
+
+	/* dest or dest_last may be NULL to trigger a
+	 * state transition only.
+	 */
+	if (dest && dest_last) {
+		/* This condition needs to include the possibility
+		 * of 2 dest bytes for an escaped byte
+		 */
+		while (src <= src_last && dest <= dest_last) {
+
+			src_byte = *src++;
+			if ((src_byte == CONTROL_CHAR) ||
+			    (src_byte == ESC_CHAR)) {
+				/* If the escape character is not the
+				 * last byte
+				 */
+				if (dest != dest_last) {
+					crc = CRC_16_L_STEP(crc, src_byte);
+					*dest++ = ESC_CHAR;
+					used++;
+					*dest++ = src_byte ^ ESC_MASK;
+					used++;
+				} else {
+					src--;
+					break;
+				}
+			} else {
+				crc = CRC_16_L_STEP(crc, src_byte);
+				*dest++ = src_byte;
+				used++;
+			}
+		}
+
+		if (src > src_last) {
+			if (state == DIAG_STATE_BUSY) {
+				if (src_desc->terminate) {
+					crc = ~crc;
+					state++;
+				} else {
+					/* Done with fragment */
+					state = DIAG_STATE_COMPLETE;
+				}
+			}
+
+			while (dest <= dest_last && state >= DIAG_STATE_CRC1
+					&& state < DIAG_STATE_TERM) {
+				/* Encode a byte of the CRC next */
+				src_byte = crc & 0xFF;
+
+				if ((src_byte == CONTROL_CHAR)
+				    || (src_byte == ESC_CHAR)) {
+
+					if (dest != dest_last) {
+						*dest++ = ESC_CHAR;
+						used++;
+						*dest++ = src_byte ^ ESC_MASK;
+						used++;
+						crc >>= 8;
+					} else
+						break;
+				} else {
+
+					crc >>= 8;
+					*dest++ = src_byte;
+					used++;
+				}
+				state++;
+			}
+
+			if (state == DIAG_STATE_TERM) {
+				if (dest_last >= dest) {
+					*dest++ = CONTROL_CHAR;
+					used++;
+					state++;	/* Complete */
+				}
+			}
+		}
+	}
+
+	/* Copy local variables back into the encode structure. */
+	enc->dest = dest;
+	enc->dest_last = dest_last;
+	enc->crc = crc;
+	src_desc->pkt = src;
+	src_desc->last = src_last;
+	src_desc->state = state;
+}
+
+static const unsigned int diag_hdlc_selftest_frags[] __initconst = {
+	2, 3, 7, 64, 4096
+};
+
+enum { DIAG_HDLC_SELFTEST_LEN = 1024 };
+
+static unsigned int __init diag_hdlc_selftest_encode(
+	void (*encode)(struct diag_send_desc_type *,
+		       struct diag_hdlc_dest_type *),
+	const uint8_t *pkt, unsigned int len, unsigned int frag,
+	uint8_t *out, unsigned int out_len)
+{
+	struct diag_send_desc_type send = {
+		.pkt = pkt,
+		.last = pkt + len - 1,
+		.state = DIAG_STATE_START,
+		.terminate = 1,
+	};
+	struct diag_hdlc_dest_type enc = { };
+	uint8_t *p = out, *end = out + out_len;
+
+	while (send.state != DIAG_STATE_COMPLETE && p < end) {
+		enc.dest = p;
+		enc.dest_last = min(p + frag, end) - 1;
+		encode(&send, &enc);
+		if (enc.dest == p)
+			return 0;
+		p = enc.dest;
+	}
+
+	return send.state == DIAG_STATE_COMPLETE ? p - out : 0;
+}
+
+/*
+ * Encode the same packet with diag_hdlc_encode() and the byte at a time
+ * reference for a range of destination fragment sizes, make sure that they
+ * agree and that the result decodes back to the packet with a good CRC.
+ */
+static void __init diag_hdlc_selftest(void)
+{
+	const unsigned int len = DIAG_HDLC_SELFTEST_LEN;
+	const unsigned int out_len = 2 * len + 2 * HDLC_FOOTER_LEN;
+	struct diag_hdlc_decode_type hdlc = { };
+	unsigned int i, k, frag, ref_len, fast_len;
+	uint8_t *pkt, *ref, *fast;
+	bool success = true;
+
+	pkt = kmalloc(len + 2 * out_len, GFP_KERNEL);
+	if (!pkt) {
+		pr_err("diag: hdlc self-test malloc: FAIL\n");
+		return;
+	}
+	ref = pkt + len;
+	fast = ref + out_len;
+
+	get_random_bytes(pkt, len);
+	/* Sprinkle in bytes that need escaping at random strides */
+	for (i = 0; i < len; i += 1 + (k & 0xF)) {
+		k = pkt[i];
+		pkt[i] = (k & 0x10) ? CONTROL_CHAR : ESC_CHAR;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(diag_hdlc_selftest_frags); i++) {
+		frag = diag_hdlc_selftest_frags[i];
+		ref_len = diag_hdlc_selftest_encode(diag_hdlc_encode_ref, pkt,
+						    len, frag, ref, out_len);
+		fast_len = diag_hdlc_selftest_encode(diag_hdlc_encode, pkt,
+						     len, frag, fast, out_len);
+		if (!ref_len || ref_len != fast_len ||
+		    memcmp(ref, fast, ref_len)) {
+			pr_err("diag: hdlc self-test encode %u: FAIL\n", frag);
+			success = false;
+		}
+	}
+
+	/* Decode the last encoding into the reference buffer */
+	hdlc.src_ptr = fast;
+	hdlc.src_size = fast_len;
+	hdlc.dest_ptr = ref;
+	hdlc.dest_size = out_len;
+	if (diag_hdlc_decode(&hdlc) != HDLC_COMPLETE ||
+	    hdlc.dest_idx != len + HDLC_FOOTER_LEN ||
+	    memcmp(ref, pkt, len) || crc_check(ref, hdlc.dest_idx)) {
+		pr_err("diag: hdlc self-test decode: FAIL\n");
+		success = false;
+	}
+
+	if (success)
+		pr_info("diag: hdlc self-tests: pass\n");
+	kfree(pkt);
+}
+#endif
+
+void __init diag_hdlc_init(void)
+{
+	uint16_t crc;
+	int i, k;
+
+	for (i = 0; i < 256; i++) {
+		crc = crc_ccitt_table[i];
+		for (k = 0; k < ARRAY_SIZE(diag_crc_slice); k++) {
+			crc = (crc >> 8) ^ crc_ccitt_table[crc & 0xFF];
+			diag_crc_slice[k][i] = crc;
+		}
+	}
+
+#ifdef DEBUG
+	diag_hdlc_selftest();
+#endif
+}
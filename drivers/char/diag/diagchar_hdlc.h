@@ -56,6 +56,8 @@ int diag_hdlc_decode(struct diag_hdlc_decode_type *hdlc);
 
 int crc_check(uint8_t *buf, uint16_t len);
 
+void diag_hdlc_init(void);
+
 #define ESC_CHAR     0x7D
 #define ESC_MASK     0x20
 
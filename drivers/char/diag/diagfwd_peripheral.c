@@ -19,6 +19,7 @@
 #include <linux/kmemleak.h>
 #include <linux/delay.h>
 #include <linux/atomic.h>
+#include <linux/moduleparam.h>
 #include "diagchar.h"
 #include "diagchar_hdlc.h"
 #include "diagfwd_peripheral.h"
@@ -41,6 +42,10 @@ struct data_header {
 
 static struct diagfwd_info *early_init_info[NUM_TRANSPORT];
 
+/* Drop masked off packets before they are framed for memory device sessions */
+static bool early_filter = true;
+module_param(early_filter, bool, 0644);
+
 static void diagfwd_queue_read(struct diagfwd_info *fwd_info);
 static void diagfwd_buffers_exit(struct diagfwd_info *fwd_info);
 static void diagfwd_cntl_open(struct diagfwd_info *fwd_info);
@@ -250,6 +255,61 @@ static int check_bufsize_for_encoding(struct diagfwd_buf_t *buf, uint32_t len)
 	return buf->len;
 }
 
+/*
+ * diagfwd_filter_data
+ *
+ * Drops the log packets and F3 messages that the memory device session
+ * owning the peripheral has masked off, before any HDLC or non-HDLC
+ * processing is done on them. The buffer holds data_header framed packets
+ * and is compacted in place. Anything that can't be parsed is left for the
+ * framing code to handle. Returns the remaining length.
+ */
+static int diagfwd_filter_data(struct diagfwd_info *fwd_info, int peripheral,
+			       unsigned char *buf, int len)
+{
+	struct diag_md_session_t *session_info = NULL;
+	struct data_header *header;
+	int header_size = sizeof(struct data_header);
+	int pkt_len, processed = 0, out = 0;
+
+	if (!early_filter || fwd_info->type != TYPE_DATA)
+		return len;
+
+	mutex_lock(&driver->md_session_lock);
+	session_info = diag_md_session_get_peripheral(peripheral);
+	if (!session_info) {
+		mutex_unlock(&driver->md_session_lock);
+		return len;
+	}
+
+	while (processed + header_size < len) {
+		header = (struct data_header *)(buf + processed);
+		if (header->control_char != CONTROL_CHAR ||
+		    header->version != 1)
+			break;
+		pkt_len = header_size + header->length + 1;
+		if (processed + pkt_len > len)
+			break;
+		if (!diag_masks_filter_pkt(session_info, peripheral,
+					   buf + processed + header_size,
+					   header->length)) {
+			if (out != processed)
+				memmove(buf + out, buf + processed, pkt_len);
+			out += pkt_len;
+		}
+		processed += pkt_len;
+	}
+	mutex_unlock(&driver->md_session_lock);
+
+	if (processed < len) {
+		if (out != processed)
+			memmove(buf + out, buf + processed, len - processed);
+		out += len - processed;
+	}
+
+	return out;
+}
+
 /*
  * diag_md_get_peripheral(int ctxt)
  *
@@ -356,6 +416,10 @@ static void diagfwd_data_process_done(struct diagfwd_info *fwd_info,
 
 	hdlc_disabled = driver->p_hdlc_disabled[peripheral];
 
+	len = diagfwd_filter_data(fwd_info, peripheral, buf->data_raw, len);
+	if (len <= 0)
+		goto end;
+
 	if (hdlc_disabled) {
 		/* The data is raw and and on APPS side HDLC is disabled */
 		if (!buf) {
@@ -675,6 +739,10 @@ static void diagfwd_data_read_done(struct diagfwd_info *fwd_info,
 			       fwd_info->type);
 			goto end;
 		}
+		len = diagfwd_filter_data(fwd_info, fwd_info->peripheral,
+					  buf, len);
+		if (len <= 0)
+			goto end;
 		write_len = len;
 		write_buf = buf;
 	} else {
@@ -689,6 +757,10 @@ static void diagfwd_data_read_done(struct diagfwd_info *fwd_info,
 				fwd_info->type);
 			goto end;
 		}
+		len = diagfwd_filter_data(fwd_info, fwd_info->peripheral,
+					  buf, len);
+		if (len <= 0)
+			goto end;
 		write_len = check_bufsize_for_encoding(temp_buf, len);
 		if (write_len <= 0) {
 			pr_err("diag: error in checking buf for encoding\n");
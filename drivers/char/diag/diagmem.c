@@ -19,9 +19,7 @@
 #include <linux/kmemleak.h>
 #include <linux/ratelimit.h>
 #include <linux/atomic.h>
-#include <linux/slab.h>
-#include <linux/of.h>
-#include <linux/kmemleak.h>
+#include <linux/percpu.h>
 
 #include "diagchar.h"
 #include "diagmem.h"
@@ -158,11 +156,98 @@ void diagmem_setsize(int pool_idx, int itemsize, int poolsize)
 		 diag_mempools[pool_idx].poolsize);
 }
 
+/*
+ * Take a reference against the pool limit. The count covers the buffers
+ * handed out to callers, not the ones parked in the per-CPU caches.
+ */
+static int diagmem_get_ref(struct diag_mempool_t *mempool)
+{
+	atomic_t *count = (atomic_t *)&mempool->count;
+	int val;
+
+	do {
+		val = atomic_read(count);
+		if (val >= mempool->poolsize)
+			return 0;
+	} while (atomic_cmpxchg(count, val, val + 1) != val);
+
+	if (val + 1 > READ_ONCE(mempool->high_water))
+		WRITE_ONCE(mempool->high_water, val + 1);
+
+	return 1;
+}
+
+static void *diagmem_pcp_get(struct diagmem_pcp *pcp)
+{
+	void *buf = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pcp->lock, flags);
+	if (pcp->nr > 0)
+		buf = pcp->buf[--pcp->nr];
+	spin_unlock_irqrestore(&pcp->lock, flags);
+
+	return buf;
+}
+
+static int diagmem_pcp_put(struct diagmem_pcp *pcp, void *buf)
+{
+	unsigned long flags;
+	int cached = 0;
+
+	spin_lock_irqsave(&pcp->lock, flags);
+	if (pcp->nr < DIAGMEM_PCP_CACHE_SZ) {
+		pcp->buf[pcp->nr++] = buf;
+		cached = 1;
+	}
+	spin_unlock_irqrestore(&pcp->lock, flags);
+
+	return cached;
+}
+
+/*
+ * Buffers come from this CPU's cache first and then from the shared mempool.
+ * Free buffers parked on other CPUs are only raided once the mempool itself
+ * has run dry, so that they are never lost to a burst on a single CPU.
+ */
+static void *diagmem_get_buf(struct diag_mempool_t *mempool)
+{
+	void *buf = NULL;
+	int cpu;
+
+	if (mempool->pcp)
+		buf = diagmem_pcp_get(raw_cpu_ptr(mempool->pcp));
+	if (!buf)
+		buf = mempool_alloc(mempool->pool, GFP_ATOMIC);
+	if (!buf && mempool->pcp) {
+		for_each_possible_cpu(cpu) {
+			buf = diagmem_pcp_get(per_cpu_ptr(mempool->pcp, cpu));
+			if (buf)
+				break;
+		}
+	}
+
+	return buf;
+}
+
+static void diagmem_pcp_drain(struct diag_mempool_t *mempool)
+{
+	void *buf;
+	int cpu;
+
+	if (!mempool->pcp)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		while ((buf = diagmem_pcp_get(per_cpu_ptr(mempool->pcp, cpu))))
+			mempool_free(buf, mempool->pool);
+	}
+}
+
 void *diagmem_alloc(struct diagchar_dev *driver, int size, int pool_type)
 {
 	void *buf = NULL;
 	int i = 0;
-	unsigned long flags;
 	struct diag_mempool_t *mempool = NULL;
 
 	if (!driver)
@@ -182,14 +267,15 @@ void *diagmem_alloc(struct diagchar_dev *driver, int size, int pool_type)
 					   mempool->name, size);
 			break;
 		}
-		spin_lock_irqsave(&mempool->lock, flags);
-		if (mempool->count < mempool->poolsize) {
-			atomic_add(1, (atomic_t *)&mempool->count);
-			buf = mempool_alloc(mempool->pool, GFP_ATOMIC);
-			kmemleak_not_leak(buf);
+		if (diagmem_get_ref(mempool)) {
+			buf = diagmem_get_buf(mempool);
+			if (buf)
+				kmemleak_not_leak(buf);
+			else
+				atomic_dec((atomic_t *)&mempool->count);
 		}
-		spin_unlock_irqrestore(&mempool->lock, flags);
 		if (!buf) {
+			mempool->fail_count++;
 			pr_debug_ratelimited("diag: Unable to allocate buffer from memory pool %s, size: %d/%d count: %d/%d\n",
 					     mempool->name,
 					     size, mempool->itemsize,
@@ -205,7 +291,6 @@ void *diagmem_alloc(struct diagchar_dev *driver, int size, int pool_type)
 void diagmem_free(struct diagchar_dev *driver, void *buf, int pool_type)
 {
 	int i = 0;
-	unsigned long flags;
 	struct diag_mempool_t *mempool = NULL;
 
 	if (!driver || !buf)
@@ -220,15 +305,14 @@ void diagmem_free(struct diagchar_dev *driver, void *buf, int pool_type)
 					   mempool->name);
 			break;
 		}
-		spin_lock_irqsave(&mempool->lock, flags);
-		if (mempool->count > 0 && buf) {
-			mempool_free(buf, mempool->pool);
-			atomic_add(-1, (atomic_t *)&mempool->count);
-		} else {
+		if (!atomic_add_unless((atomic_t *)&mempool->count, -1, 0)) {
 			pr_err_ratelimited("diag: Attempting to free items from %s mempool which is already empty\n",
 					   mempool->name);
+			break;
 		}
-		spin_unlock_irqrestore(&mempool->lock, flags);
+		if (!mempool->pcp ||
+		    !diagmem_pcp_put(raw_cpu_ptr(mempool->pcp), buf))
+			mempool_free(buf, mempool->pool);
 		break;
 	}
 }
@@ -236,6 +320,7 @@ void diagmem_free(struct diagchar_dev *driver, void *buf, int pool_type)
 void diagmem_init(struct diagchar_dev *driver, int index)
 {
 	struct diag_mempool_t *mempool = NULL;
+	int cpu;
 
 	if (!driver)
 		return;
@@ -265,6 +350,15 @@ void diagmem_init(struct diagchar_dev *driver, int index)
 	else
 		kmemleak_not_leak(mempool->pool);
 
+	/* The pool still works without the per-CPU caches, only slower */
+	mempool->pcp = alloc_percpu(struct diagmem_pcp);
+	if (mempool->pcp) {
+		for_each_possible_cpu(cpu)
+			spin_lock_init(&per_cpu_ptr(mempool->pcp, cpu)->lock);
+	}
+	mempool->high_water = 0;
+	mempool->fail_count = 0;
+
 	spin_lock_init(&mempool->lock);
 }
 
@@ -284,6 +378,9 @@ void diagmem_exit(struct diagchar_dev *driver, int index)
 	mempool = &diag_mempools[index];
 	spin_lock_irqsave(&mempool->lock, flags);
 	if (mempool->count == 0 && mempool->pool != NULL) {
+		diagmem_pcp_drain(mempool);
+		free_percpu(mempool->pcp);
+		mempool->pcp = NULL;
 		mempool_destroy(mempool->pool);
 		mempool->pool = NULL;
 	} else {
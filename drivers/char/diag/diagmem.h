@@ -42,15 +42,27 @@
 #define DIAG_MEMPOOL_NAME_SZ		24
 #define DIAG_MEMPOOL_GET_NAME(x)	(diag_mempools[x].name)
 
+/* Number of free buffers each CPU keeps in front of the shared mempool */
+#define DIAGMEM_PCP_CACHE_SZ		8
+
+struct diagmem_pcp {
+	spinlock_t lock;
+	int nr;
+	void *buf[DIAGMEM_PCP_CACHE_SZ];
+};
+
 struct diag_mempool_t {
 	int id;
 	char name[DIAG_MEMPOOL_NAME_SZ];
 	mempool_t *pool;
+	struct diagmem_pcp __percpu *pcp;
 	unsigned int itemsize;
 	unsigned int poolsize;
 	int count;
+	int high_water;
+	unsigned int fail_count;
 	spinlock_t lock;
-} __packed;
+};
 
 extern struct diag_mempool_t diag_mempools[NUM_MEMORY_POOLS];
 
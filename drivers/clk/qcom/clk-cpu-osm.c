@@ -718,6 +718,46 @@ osm_cpufreq_target_index(struct cpufreq_policy *policy, unsigned int index)
 	return 0;
 }
 
+/*
+ * Write the index straight to the DCVS register and let OSM move the PLL and
+ * voltage. This skips the clock framework, so it is only used for clusters
+ * whose rate changes need no voltage vote from software.
+ */
+static unsigned int
+osm_cpufreq_fast_switch(struct cpufreq_policy *policy, unsigned int target_freq)
+{
+	struct clk_osm *c = policy->driver_data;
+	struct clk_osm *parent = to_clk_osm(clk_hw_get_parent(&c->hw));
+	int index, core_num;
+
+	index = cpufreq_frequency_table_target(policy, target_freq,
+					       CPUFREQ_RELATION_L);
+	if (index < 0)
+		return 0;
+
+	core_num = parent->per_core_dcvs ? c->core_num : 0;
+	clk_osm_write_reg(parent, index,
+			DCVS_PERF_STATE_DESIRED_REG(core_num, is_sdm845v1));
+
+	/* Make sure the write goes through before proceeding */
+	clk_osm_mb(parent);
+
+	return policy->freq_table[index].frequency;
+}
+
+/* The power cluster votes MX up to turbo from set_rate, which can sleep */
+static bool osm_fast_switch_possible(struct clk_osm *parent)
+{
+	if (parent != &pwrcl_clk)
+		return true;
+
+	if (!parent->num_entries)
+		return false;
+
+	return parent->osm_table[parent->num_entries - 1].frequency <
+						parent->mx_turbo_freq;
+}
+
 static unsigned int osm_cpufreq_get(unsigned int cpu)
 {
 	struct cpufreq_policy *policy = cpufreq_cpu_get_raw(cpu);
@@ -812,6 +852,7 @@ static int osm_cpufreq_cpu_init(struct cpufreq_policy *policy)
 	}
 
 	policy->driver_data = c;
+	policy->fast_switch_possible = osm_fast_switch_possible(parent);
 	return 0;
 
 err:
@@ -837,6 +878,7 @@ static struct cpufreq_driver qcom_osm_cpufreq_driver = {
 			  CPUFREQ_HAVE_GOVERNOR_PER_POLICY,
 	.verify		= cpufreq_generic_frequency_table_verify,
 	.target_index	= osm_cpufreq_target_index,
+	.fast_switch	= osm_cpufreq_fast_switch,
 	.get		= osm_cpufreq_get,
 	.init		= osm_cpufreq_cpu_init,
 	.exit		= osm_cpufreq_cpu_exit,
@@ -31,11 +31,29 @@
 #include <linux/workqueue.h>
 #include <linux/kthread.h>
 #include <linux/slab.h>
+#include <linux/input.h>
+#include <linux/devfreq.h>
+#include <linux/of_device.h>
+#include <linux/pm_opp.h>
+#include <linux/sort.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/cpufreq_interactive.h>
 
-static DEFINE_PER_CPU(struct update_util_data, update_util);
+struct interactive_update_util {
+	struct update_util_data data;
+	int cpu;
+};
+
+static DEFINE_PER_CPU(struct interactive_update_util, update_util);
+
+/* Dynamic power of one OPP, from its voltage and dynamic-power-coefficient */
+struct interactive_energy_state {
+	unsigned int freq;		/* kHz */
+	unsigned int voltage;		/* uV */
+	unsigned int power;		/* mW */
+	unsigned int energy;		/* pJ per cycle */
+};
 
 struct cpufreq_interactive_policyinfo {
 	bool work_in_progress;
@@ -59,9 +77,14 @@ struct cpufreq_interactive_policyinfo {
 	bool reject_notification;
 	bool notif_pending;
 	unsigned long notif_cpu;
+	/* A task migrated to or from this cluster, evaluate it right away */
+	bool mig_pending;
 	int governor_enabled;
 	struct cpufreq_interactive_tunables *cached_tunables;
 	struct sched_load *sl;
+	/* Sorted by ascending frequency, NULL if there is no power model */
+	struct interactive_energy_state *energy;
+	int nenergy;
 };
 
 /* Protected by per-policy load_lock */
@@ -96,6 +119,37 @@ static unsigned int default_target_loads[] = {DEFAULT_TARGET_LOAD};
 static unsigned int default_above_hispeed_delay[] = {
 	DEFAULT_ABOVE_HISPEED_DELAY };
 
+#define MAX_BOOST_PROFILES 8
+#define BOOST_PROFILE_NAME_LEN 16
+
+/*
+ * A boost profile holds the policy at or above floor_freq for duration_us
+ * each time one of its triggers fires. Triggers are evaluated without any
+ * lock; a profile that fires again while active extends its expiry, and
+ * stacked profiles resolve to the highest floor that has not yet expired.
+ */
+struct interactive_boost_profile {
+	char name[BOOST_PROFILE_NAME_LEN];
+	unsigned int floor_freq;
+	unsigned int duration_us;
+	unsigned long triggers;
+	/* End of the current boost in ktime converted to usecs */
+	atomic64_t expiry;
+	/* Total time boosted and number of times fired */
+	atomic64_t residency_us;
+	atomic_t count;
+};
+
+static const char * const boost_trigger_names[CPUFREQ_BOOST_NR_TRIGGERS] = {
+	[CPUFREQ_BOOST_TOUCH]		= "touch",
+	[CPUFREQ_BOOST_FLING]		= "fling",
+	[CPUFREQ_BOOST_LAUNCH]		= "launch",
+	[CPUFREQ_BOOST_FB_COMMIT]	= "fb_commit",
+};
+
+/* Serializes writers of the boost profiles, readers take no lock */
+static DEFINE_MUTEX(boost_profile_lock);
+
 struct cpufreq_interactive_tunables {
 	int usage_count;
 	/* Hi speed to bump to from lo speed when load burst (default max) */
@@ -164,6 +218,26 @@ struct cpufreq_interactive_tunables {
 
 	/* Whether to enable prediction or not */
 	bool enable_prediction;
+
+	/*
+	 * Re-evaluate as soon as the scheduler reports an inter-cluster
+	 * migration and pick the frequency from the predicted demand,
+	 * instead of waiting for the next window. Needs use_sched_load.
+	 */
+	bool instant_migration_ramp;
+
+	/*
+	 * Pick the OPP with the lowest energy per cycle that keeps the load
+	 * at or below energy_latency_load, instead of using target_loads.
+	 * energy_debug logs the chosen and the cheapest OPP on each change.
+	 */
+	bool energy_aware;
+	unsigned int energy_latency_load;
+	bool energy_debug;
+
+	/* Boost profiles, protected by boost_profile_lock for writing */
+	struct interactive_boost_profile boost_profiles[MAX_BOOST_PROFILES];
+	int nboost_profiles;
 };
 
 /* For cases where we have single governor instance for system */
@@ -232,20 +306,68 @@ static void cpufreq_interactive_timer_resched(unsigned long cpu,
 	spin_unlock_irqrestore(&ppol->load_lock, flags);
 }
 
+/* Queue an evaluation of the policy on one of its online CPUs */
+static void cpufreq_interactive_kick(struct cpufreq_interactive_policyinfo *ppol)
+{
+	unsigned long flags;
+	int cpu;
+
+	cpu = cpumask_any_and(ppol->policy->cpus, cpu_online_mask);
+	if (cpu >= nr_cpu_ids)
+		return;
+
+	spin_lock_irqsave(&ppol->irq_work_lock, flags);
+	if (!ppol->work_in_progress) {
+		ppol->work_in_progress = true;
+		irq_work_queue_on(&ppol->irq_work, cpu);
+	}
+	spin_unlock_irqrestore(&ppol->irq_work_lock, flags);
+}
+
+/*
+ * The scheduler reports an inter-cluster migration on both the source and
+ * the destination CPU, which need not be the CPU we are running on.
+ */
+static void update_util_migration(struct update_util_data *data)
+{
+	int cpu = container_of(data, struct interactive_update_util,
+			       data)->cpu;
+	struct cpufreq_interactive_policyinfo *ppol = per_cpu(polinfo, cpu);
+	struct cpufreq_interactive_tunables *tunables;
+
+	if (!ppol || !down_read_trylock(&ppol->enable_sem))
+		return;
+	if (!ppol->governor_enabled)
+		goto exit;
+
+	tunables = ppol->policy->governor_data;
+	if (!tunables->instant_migration_ramp || !tunables->use_sched_load)
+		goto exit;
+
+	WRITE_ONCE(ppol->mig_pending, true);
+	cpufreq_interactive_kick(ppol);
+exit:
+	up_read(&ppol->enable_sem);
+}
+
 static void update_util_handler(struct update_util_data *data, u64 time,
 				unsigned int sched_flags)
 {
 	struct cpufreq_interactive_policyinfo *ppol;
 	unsigned long flags;
 
+	if (sched_flags & SCHED_CPUFREQ_INTERCLUSTER_MIG) {
+		update_util_migration(data);
+		return;
+	}
+
 	ppol = *this_cpu_ptr(&polinfo);
 	spin_lock_irqsave(&ppol->irq_work_lock, flags);
 	/*
 	 * The irq-work may not be allowed to be queued up right now
 	 * because work has already been queued up or is in progress.
 	 */
-	if (ppol->work_in_progress ||
-	    sched_flags & SCHED_CPUFREQ_INTERCLUSTER_MIG)
+	if (ppol->work_in_progress)
 		goto out;
 
 	ppol->work_in_progress = true;
@@ -266,12 +388,14 @@ static inline void gov_clear_update_util(struct cpufreq_policy *policy)
 
 static void gov_set_update_util(struct cpufreq_policy *policy)
 {
-	struct update_util_data *util;
+	struct interactive_update_util *util;
 	int cpu;
 
 	for_each_cpu(cpu, policy->cpus) {
 		util = &per_cpu(update_util, cpu);
-		cpufreq_add_update_util_hook(cpu, util, update_util_handler);
+		util->cpu = cpu;
+		cpufreq_add_update_util_hook(cpu, &util->data,
+					     update_util_handler);
 	}
 }
 
@@ -449,6 +573,122 @@ static unsigned int choose_freq(struct cpufreq_interactive_policyinfo *pcpu,
 	return freq;
 }
 
+static int energy_state_cmp(const void *a, const void *b)
+{
+	const struct interactive_energy_state *x = a, *y = b;
+
+	return x->freq < y->freq ? -1 : x->freq > y->freq;
+}
+
+/*
+ * Build the policy's energy table from the "dynamic-power-coefficient" of
+ * its CPU node and the OPP voltages, using the same model as cpu_cooling.
+ */
+static void energy_table_init(struct cpufreq_interactive_policyinfo *ppol)
+{
+	struct cpufreq_policy *policy = ppol->policy;
+	struct cpufreq_frequency_table *pos;
+	struct interactive_energy_state *tbl;
+	struct device_node *np;
+	struct device *cpu_dev;
+	struct dev_pm_opp *opp;
+	unsigned long hz;
+	u32 coeff = 0;
+	int n = 0, i = 0;
+
+	if (ppol->energy || !ppol->freq_table)
+		return;
+
+	cpu_dev = get_cpu_device(policy->cpu);
+	np = of_cpu_device_node_get(policy->cpu);
+	if (!cpu_dev || !np)
+		goto out;
+	if (of_property_read_u32(np, "dynamic-power-coefficient", &coeff) ||
+	    !coeff)
+		goto out;
+
+	cpufreq_for_each_valid_entry(pos, ppol->freq_table)
+		n++;
+	if (!n)
+		goto out;
+
+	tbl = kcalloc(n, sizeof(*tbl), GFP_KERNEL);
+	if (!tbl)
+		goto out;
+
+	rcu_read_lock();
+	cpufreq_for_each_valid_entry(pos, ppol->freq_table) {
+		u64 power, mv;
+
+		hz = pos->frequency * 1000UL;
+		opp = dev_pm_opp_find_freq_ceil(cpu_dev, &hz);
+		if (IS_ERR(opp))
+			break;
+
+		tbl[i].freq = pos->frequency;
+		tbl[i].voltage = dev_pm_opp_get_voltage(opp);
+		mv = tbl[i].voltage / 1000;
+		power = (u64)coeff * (pos->frequency / 1000) * mv * mv;
+		do_div(power, 1000000000);
+		tbl[i].power = power;
+		tbl[i].energy = div_u64(power * 1000000, pos->frequency);
+		i++;
+	}
+	rcu_read_unlock();
+
+	if (i != n) {
+		pr_debug("cpu%u: no OPP voltages, energy model disabled\n",
+			 policy->cpu);
+		kfree(tbl);
+		goto out;
+	}
+
+	sort(tbl, n, sizeof(*tbl), energy_state_cmp, NULL);
+	ppol->energy = tbl;
+	ppol->nenergy = n;
+out:
+	of_node_put(np);
+}
+
+/*
+ * The budget is met by any OPP at which loadadjfreq is no more than
+ * energy_latency_load busy. Among those take the one with the lowest
+ * dynamic energy per cycle, preferring the faster of two equal OPPs so
+ * that the CPU gets back to idle sooner.
+ */
+static const struct interactive_energy_state *energy_choose(
+		struct cpufreq_interactive_policyinfo *ppol,
+		unsigned int loadadjfreq)
+{
+	struct cpufreq_interactive_tunables *tunables =
+		ppol->policy->governor_data;
+	const struct interactive_energy_state *best = NULL, *st;
+	unsigned int fmin = loadadjfreq / tunables->energy_latency_load;
+	int i;
+
+	for (i = 0; i < ppol->nenergy; i++) {
+		st = &ppol->energy[i];
+		if (st->freq < fmin)
+			continue;
+		if (!best || st->energy <= best->energy)
+			best = st;
+	}
+
+	return best ? best : &ppol->energy[ppol->nenergy - 1];
+}
+
+static const struct interactive_energy_state *energy_state_of(
+		struct cpufreq_interactive_policyinfo *ppol, unsigned int freq)
+{
+	int i;
+
+	for (i = 0; i < ppol->nenergy - 1; i++)
+		if (ppol->energy[i].freq >= freq)
+			break;
+
+	return &ppol->energy[i];
+}
+
 static u64 update_load(int cpu)
 {
 	struct cpufreq_interactive_policyinfo *ppol = per_cpu(polinfo, cpu);
@@ -473,6 +713,47 @@ static u64 update_load(int cpu)
 	return now;
 }
 
+/*
+ * Account the load at the current speed before changing it. This used to be
+ * done from a transition notifier, but a registered notifier keeps the core
+ * from enabling fast switching, so it is called before every change instead.
+ */
+static void cpufreq_interactive_speed_changing(
+			struct cpufreq_interactive_policyinfo *ppol)
+{
+	unsigned long flags;
+	int cpu;
+
+	spin_lock_irqsave(&ppol->load_lock, flags);
+	for_each_cpu(cpu, ppol->policy->cpus)
+		update_load(cpu);
+	spin_unlock_irqrestore(&ppol->load_lock, flags);
+}
+
+/*
+ * Called from the update_util irq_work with enable_sem held, so the driver
+ * switches the frequency without waking up speedchange_task.
+ */
+static void cpufreq_interactive_fast_switch(
+			struct cpufreq_interactive_policyinfo *ppol, int cpu)
+{
+	struct cpufreq_policy *policy = ppol->policy;
+	unsigned int freq;
+	int i;
+
+	if (ppol->target_freq == policy->cur)
+		return;
+
+	cpufreq_interactive_speed_changing(ppol);
+	freq = cpufreq_driver_fast_switch(policy, ppol->target_freq);
+	if (freq && freq != CPUFREQ_ENTRY_INVALID) {
+		policy->cur = freq;
+		for_each_cpu(i, policy->cpus)
+			trace_cpu_frequency(freq, i);
+	}
+	trace_cpufreq_interactive_setspeed(cpu, ppol->target_freq, policy->cur);
+}
+
 static unsigned int sl_busy_to_laf(struct cpufreq_interactive_policyinfo *ppol,
 				   unsigned long busy)
 {
@@ -485,6 +766,22 @@ static unsigned int sl_busy_to_laf(struct cpufreq_interactive_policyinfo *ppol,
 	return prev_load;
 }
 
+static unsigned int boost_profile_floor(
+	struct cpufreq_interactive_tunables *tunables, u64 now)
+{
+	struct interactive_boost_profile *bp;
+	unsigned int floor = 0;
+	int i, n = READ_ONCE(tunables->nboost_profiles);
+
+	for (i = 0; i < n; i++) {
+		bp = &tunables->boost_profiles[i];
+		if ((u64)atomic64_read(&bp->expiry) > now)
+			floor = max(floor, READ_ONCE(bp->floor_freq));
+	}
+
+	return floor;
+}
+
 #define NEW_TASK_RATIO 75
 #define PRED_TOLERANCE_PCT 10
 static void cpufreq_interactive_timer(int data)
@@ -499,7 +796,7 @@ static void cpufreq_interactive_timer(int data)
 		ppol->policy->governor_data;
 	struct sched_load *sl = ppol->sl;
 	struct cpufreq_interactive_cpuinfo *pcpu;
-	unsigned int new_freq;
+	unsigned int new_freq, boost_freq;
 	unsigned int prev_laf = 0, t_prevlaf;
 	unsigned int pred_laf = 0, t_predlaf = 0;
 	unsigned int prev_chfreq, pred_chfreq, chosen_freq;
@@ -511,8 +808,10 @@ static void cpufreq_interactive_timer(int data)
 	int prev_l, pred_l = 0;
 	struct cpufreq_govinfo govinfo;
 	bool skip_hispeed_logic, skip_min_sample_time;
+	bool mig_ramp;
 	bool jump_to_max_no_ts = false;
 	bool jump_to_max = false;
+	bool profile_boosted = false;
 
 	if (!down_read_trylock(&ppol->enable_sem))
 		return;
@@ -524,9 +823,16 @@ static void cpufreq_interactive_timer(int data)
 	spin_lock_irqsave(&ppol->target_freq_lock, flags);
 	spin_lock(&ppol->load_lock);
 
-	skip_hispeed_logic =
-		tunables->ignore_hispeed_on_notif && ppol->notif_pending;
-	skip_min_sample_time = tunables->fast_ramp_down && ppol->notif_pending;
+	/*
+	 * A task that just migrated in is already reflected in the predicted
+	 * load, so go straight to the frequency its demand needs.
+	 */
+	mig_ramp = READ_ONCE(ppol->mig_pending) && tunables->use_sched_load;
+	WRITE_ONCE(ppol->mig_pending, false);
+	skip_hispeed_logic = mig_ramp ||
+		(tunables->ignore_hispeed_on_notif && ppol->notif_pending);
+	skip_min_sample_time = tunables->fast_ramp_down &&
+		(ppol->notif_pending || mig_ramp);
 	ppol->notif_pending = false;
 	now = ktime_to_us(ktime_get());
 	ppol->last_evaluated_jiffy = get_jiffies_64();
@@ -540,7 +846,7 @@ static void cpufreq_interactive_timer(int data)
 		if (tunables->use_sched_load) {
 			t_prevlaf = sl_busy_to_laf(ppol, sl[i].prev_load);
 			prev_l = t_prevlaf / ppol->target_freq;
-			if (tunables->enable_prediction) {
+			if (tunables->enable_prediction || mig_ramp) {
 				t_predlaf = sl_busy_to_laf(ppol,
 						sl[i].predicted_load);
 				pred_l = t_predlaf / ppol->target_freq;
@@ -589,8 +895,13 @@ static void cpufreq_interactive_timer(int data)
 
 	tunables->boosted = tunables->boost_val || now < tunables->boostpulse_endtime;
 
-	prev_chfreq = choose_freq(ppol, prev_laf);
-	pred_chfreq = choose_freq(ppol, pred_laf);
+	if (tunables->energy_aware && ppol->nenergy) {
+		prev_chfreq = energy_choose(ppol, prev_laf)->freq;
+		pred_chfreq = energy_choose(ppol, pred_laf)->freq;
+	} else {
+		prev_chfreq = choose_freq(ppol, prev_laf);
+		pred_chfreq = choose_freq(ppol, pred_laf);
+	}
 	chosen_freq = max(prev_chfreq, pred_chfreq);
 
 	if (prev_chfreq < ppol->policy->max && pred_chfreq >= ppol->policy->max)
@@ -625,7 +936,13 @@ static void cpufreq_interactive_timer(int data)
 	    tunables->max_freq_hysteresis)
 		new_freq = max(tunables->hispeed_freq, new_freq);
 
-	if (!skip_hispeed_logic &&
+	boost_freq = boost_profile_floor(tunables, now);
+	if (new_freq < boost_freq) {
+		new_freq = boost_freq;
+		profile_boosted = true;
+	}
+
+	if (!skip_hispeed_logic && !profile_boosted &&
 	    ppol->target_freq >= tunables->hispeed_freq &&
 	    new_freq > ppol->target_freq &&
 	    now - ppol->hispeed_validate_time <
@@ -666,11 +983,12 @@ static void cpufreq_interactive_timer(int data)
 	 * (or the indefinite boost is turned off). If policy->max is restored
 	 * for max_freq_hysteresis, don't extend the timestamp. Otherwise, it
 	 * could incorrectly extended the duration of max_freq_hysteresis by
-	 * min_sample_time.
+	 * min_sample_time. A boost profile floor is likewise not validated, so
+	 * the speed can drop as soon as the profile expires.
 	 */
 
 	if ((!tunables->boosted || new_freq > tunables->hispeed_freq)
-	    && !jump_to_max_no_ts) {
+	    && !jump_to_max_no_ts && !profile_boosted) {
 		ppol->floor_freq = new_freq;
 		ppol->floor_validate_time = now;
 	}
@@ -690,8 +1008,24 @@ static void cpufreq_interactive_timer(int data)
 	trace_cpufreq_interactive_target(max_cpu, pol_load, ppol->target_freq,
 					 ppol->policy->cur, new_freq);
 
+	if (tunables->energy_debug && ppol->nenergy) {
+		const struct interactive_energy_state *cheap, *st;
+
+		cheap = energy_choose(ppol, max(prev_laf, pred_laf));
+		st = energy_state_of(ppol, new_freq);
+		pr_info_ratelimited("cpu%lu: load %d chose %u kHz %u pJ/cyc, cheapest %u kHz %u pJ/cyc\n",
+				    max_cpu, pol_load, st->freq, st->energy,
+				    cheap->freq, cheap->energy);
+	}
+
 	ppol->target_freq = new_freq;
 	spin_unlock_irqrestore(&ppol->target_freq_lock, flags);
+
+	if (ppol->policy->fast_switch_enabled) {
+		cpufreq_interactive_fast_switch(ppol, max_cpu);
+		goto rearm;
+	}
+
 	spin_lock_irqsave(&speedchange_cpumask_lock, flags);
 	cpumask_set_cpu(max_cpu, &speedchange_cpumask);
 	spin_unlock_irqrestore(&speedchange_cpumask_lock, flags);
@@ -758,10 +1092,12 @@ static int cpufreq_interactive_speedchange_task(void *data)
 				continue;
 			}
 
-			if (ppol->target_freq != ppol->policy->cur)
+			if (ppol->target_freq != ppol->policy->cur) {
+				cpufreq_interactive_speed_changing(ppol);
 				__cpufreq_driver_target(ppol->policy,
 							ppol->target_freq,
 							CPUFREQ_RELATION_H);
+			}
 			trace_cpufreq_interactive_setspeed(cpu,
 						     ppol->target_freq,
 						     ppol->policy->cur);
@@ -814,6 +1150,156 @@ static void cpufreq_interactive_boost(struct cpufreq_interactive_tunables *tunab
 		wake_up_process(speedchange_task);
 }
 
+/* Extend the profile to now + duration, returns true if it was extended */
+static bool boost_profile_fire(struct interactive_boost_profile *bp, u64 now)
+{
+	u64 end = now + READ_ONCE(bp->duration_us);
+	s64 old, prev;
+
+	old = atomic64_read(&bp->expiry);
+	do {
+		if ((u64)old >= end)
+			return false;
+		prev = atomic64_cmpxchg(&bp->expiry, old, end);
+		if (prev == old)
+			break;
+		old = prev;
+	} while (1);
+
+	atomic64_add(end - max_t(u64, old, now), &bp->residency_us);
+	atomic_inc(&bp->count);
+	trace_cpufreq_interactive_boost(bp->name);
+	return true;
+}
+
+/**
+ * cpufreq_interactive_boost_trigger - fire the boost profiles of a trigger
+ * @trigger: the event that occurred
+ *
+ * Every policy with a profile listing @trigger has that profile extended
+ * and is re-evaluated right away on one of its CPUs if the new floor is
+ * above its current target. Safe to call from any non-NMI context.
+ */
+void cpufreq_interactive_boost_trigger(enum cpufreq_boost_trigger trigger)
+{
+	struct cpufreq_interactive_policyinfo *ppol;
+	struct cpufreq_interactive_tunables *tunables;
+	struct interactive_boost_profile *bp;
+	struct cpumask handled;
+	u64 now = ktime_to_us(ktime_get());
+	bool fired;
+	int cpu, i, n;
+
+	if (trigger >= CPUFREQ_BOOST_NR_TRIGGERS)
+		return;
+
+	cpumask_clear(&handled);
+	for_each_online_cpu(cpu) {
+		if (cpumask_test_cpu(cpu, &handled))
+			continue;
+		ppol = per_cpu(polinfo, cpu);
+		if (!ppol || !down_read_trylock(&ppol->enable_sem))
+			continue;
+		if (!ppol->governor_enabled)
+			goto next;
+
+		cpumask_or(&handled, &handled, ppol->policy->cpus);
+		tunables = ppol->policy->governor_data;
+		n = READ_ONCE(tunables->nboost_profiles);
+		fired = false;
+		for (i = 0; i < n; i++) {
+			bp = &tunables->boost_profiles[i];
+			if (test_bit(trigger, &bp->triggers) &&
+			    READ_ONCE(bp->floor_freq))
+				fired |= boost_profile_fire(bp, now);
+		}
+
+		if (fired && READ_ONCE(ppol->target_freq) <
+			     boost_profile_floor(tunables, now))
+			cpufreq_interactive_kick(ppol);
+next:
+		up_read(&ppol->enable_sem);
+	}
+}
+EXPORT_SYMBOL(cpufreq_interactive_boost_trigger);
+
+static void boost_input_event(struct input_handle *handle, unsigned int type,
+			      unsigned int code, int value)
+{
+	if ((type == EV_KEY && code == BTN_TOUCH && value) ||
+	    (type == EV_ABS && code == ABS_MT_TRACKING_ID && value != -1)) {
+		cpufreq_interactive_boost_trigger(CPUFREQ_BOOST_TOUCH);
+		devfreq_boost_kick();
+	}
+}
+
+static int boost_input_connect(struct input_handler *handler,
+			       struct input_dev *dev,
+			       const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int error;
+
+	handle = kzalloc(sizeof(*handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "cpufreq_interactive";
+
+	error = input_register_handle(handle);
+	if (error)
+		goto err2;
+
+	error = input_open_device(handle);
+	if (error)
+		goto err1;
+
+	return 0;
+err1:
+	input_unregister_handle(handle);
+err2:
+	kfree(handle);
+	return error;
+}
+
+static void boost_input_disconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+static const struct input_device_id boost_input_ids[] = {
+	/* multi-touch touchscreen */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
+			BIT_MASK(ABS_MT_POSITION_X) |
+			BIT_MASK(ABS_MT_POSITION_Y) },
+	},
+	/* touchpad */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_KEYBIT |
+			INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.keybit = { [BIT_WORD(BTN_TOUCH)] = BIT_MASK(BTN_TOUCH) },
+		.absbit = { [BIT_WORD(ABS_X)] =
+			BIT_MASK(ABS_X) | BIT_MASK(ABS_Y) },
+	},
+	{ },
+};
+
+static struct input_handler boost_input_handler = {
+	.event		= boost_input_event,
+	.connect	= boost_input_connect,
+	.disconnect	= boost_input_disconnect,
+	.name		= "cpufreq_interactive",
+	.id_table	= boost_input_ids,
+};
+
 static int load_change_callback(struct notifier_block *nb, unsigned long val,
 				void *data)
 {
@@ -872,43 +1358,6 @@ static struct notifier_block load_notifier_block = {
 	.notifier_call = load_change_callback,
 };
 
-static int cpufreq_interactive_notifier(
-	struct notifier_block *nb, unsigned long val, void *data)
-{
-	struct cpufreq_freqs *freq = data;
-	struct cpufreq_interactive_policyinfo *ppol;
-	int cpu;
-	unsigned long flags;
-
-	if (val == CPUFREQ_POSTCHANGE) {
-		ppol = per_cpu(polinfo, freq->cpu);
-		if (!ppol)
-			return 0;
-		if (!down_read_trylock(&ppol->enable_sem))
-			return 0;
-		if (!ppol->governor_enabled) {
-			up_read(&ppol->enable_sem);
-			return 0;
-		}
-
-		if (cpumask_first(ppol->policy->cpus) != freq->cpu) {
-			up_read(&ppol->enable_sem);
-			return 0;
-		}
-		spin_lock_irqsave(&ppol->load_lock, flags);
-		for_each_cpu(cpu, ppol->policy->cpus)
-			update_load(cpu);
-		spin_unlock_irqrestore(&ppol->load_lock, flags);
-
-		up_read(&ppol->enable_sem);
-	}
-	return 0;
-}
-
-static struct notifier_block cpufreq_notifier_block = {
-	.notifier_call = cpufreq_interactive_notifier,
-};
-
 static unsigned int *get_tokenized_data(const char *buf, int *num_tokens)
 {
 	const char *cp;
@@ -1081,6 +1530,9 @@ show_store_one(align_windows);
 show_store_one(ignore_hispeed_on_notif);
 show_store_one(fast_ramp_down);
 show_store_one(enable_prediction);
+show_store_one(instant_migration_ramp);
+show_store_one(energy_aware);
+show_store_one(energy_debug);
 
 static ssize_t show_go_hispeed_load(struct cpufreq_interactive_tunables
 		*tunables, char *buf)
@@ -1227,6 +1679,202 @@ static ssize_t store_boostpulse(struct cpufreq_interactive_tunables *tunables,
 	return count;
 }
 
+static ssize_t store_energy_latency_load(
+		struct cpufreq_interactive_tunables *tunables,
+		const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = kstrtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	if (!val || val > 100)
+		return -EINVAL;
+	tunables->energy_latency_load = val;
+	return count;
+}
+
+static ssize_t show_energy_latency_load(
+		struct cpufreq_interactive_tunables *tunables, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			tunables->energy_latency_load);
+}
+
+static ssize_t energy_table_dump(struct cpufreq_interactive_policyinfo *ppol,
+				 char *buf, ssize_t ret)
+{
+	int i;
+
+	if (!ppol->nenergy)
+		return ret;
+
+	ret += scnprintf(buf + ret, PAGE_SIZE - ret, "cpu%u\n",
+			 ppol->policy->cpu);
+	for (i = 0; i < ppol->nenergy; i++)
+		ret += scnprintf(buf + ret, PAGE_SIZE - ret,
+				 "%u kHz %u uV %u mW %u pJ/cyc\n",
+				 ppol->energy[i].freq, ppol->energy[i].voltage,
+				 ppol->energy[i].power, ppol->energy[i].energy);
+
+	return ret;
+}
+
+static int boost_trigger_parse(char *str, unsigned long *triggers)
+{
+	char *tok;
+	int i;
+
+	*triggers = 0;
+	while ((tok = strsep(&str, ",")) != NULL) {
+		if (!*tok)
+			continue;
+		for (i = 0; i < CPUFREQ_BOOST_NR_TRIGGERS; i++)
+			if (!strcmp(tok, boost_trigger_names[i]))
+				break;
+		if (i == CPUFREQ_BOOST_NR_TRIGGERS)
+			return -EINVAL;
+		*triggers |= BIT(i);
+	}
+
+	return 0;
+}
+
+static ssize_t show_boost_profiles(struct cpufreq_interactive_tunables
+		*tunables, char *buf)
+{
+	struct interactive_boost_profile *bp;
+	ssize_t ret = 0;
+	int i, t;
+
+	mutex_lock(&boost_profile_lock);
+	for (i = 0; i < tunables->nboost_profiles; i++) {
+		bp = &tunables->boost_profiles[i];
+		if (!bp->floor_freq)
+			continue;
+		ret += scnprintf(buf + ret, PAGE_SIZE - ret, "%s %u %u ",
+				 bp->name, bp->floor_freq,
+				 bp->duration_us / USEC_PER_MSEC);
+		for (t = 0; t < CPUFREQ_BOOST_NR_TRIGGERS; t++)
+			if (test_bit(t, &bp->triggers))
+				ret += scnprintf(buf + ret, PAGE_SIZE - ret,
+						 "%s,", boost_trigger_names[t]);
+		if (buf[ret - 1] == ',')
+			ret--;
+		ret += scnprintf(buf + ret, PAGE_SIZE - ret, "\n");
+	}
+	mutex_unlock(&boost_profile_lock);
+
+	return ret;
+}
+
+/*
+ * "<name> <floor_khz> <duration_ms> <trigger>[,<trigger>...]" adds or
+ * updates the named profile, "<name> 0" disables it.
+ */
+static ssize_t store_boost_profiles(struct cpufreq_interactive_tunables
+		*tunables, const char *buf, size_t count)
+{
+	struct interactive_boost_profile *bp = NULL, *match = NULL;
+	char name[BOOST_PROFILE_NAME_LEN], trig[64] = "";
+	unsigned int floor_freq, duration_ms = 0;
+	unsigned long triggers = 0;
+	int i, ret;
+
+	ret = sscanf(buf, "%15s %u %u %63s", name, &floor_freq, &duration_ms,
+		     trig);
+	if (ret < 2 || (floor_freq && ret != 4))
+		return -EINVAL;
+	if (floor_freq && (boost_trigger_parse(trig, &triggers) || !triggers))
+		return -EINVAL;
+
+	mutex_lock(&boost_profile_lock);
+	for (i = 0; i < tunables->nboost_profiles; i++) {
+		if (!strcmp(tunables->boost_profiles[i].name, name)) {
+			match = &tunables->boost_profiles[i];
+			break;
+		}
+		if (!bp && !tunables->boost_profiles[i].floor_freq)
+			bp = &tunables->boost_profiles[i];
+	}
+	if (match || !floor_freq)
+		bp = match;
+	else if (!bp && tunables->nboost_profiles < MAX_BOOST_PROFILES)
+		bp = &tunables->boost_profiles[tunables->nboost_profiles];
+	if (!bp) {
+		mutex_unlock(&boost_profile_lock);
+		return floor_freq ? -ENOSPC : count;
+	}
+
+	WRITE_ONCE(bp->floor_freq, 0);
+	if (strcmp(bp->name, name)) {
+		strlcpy(bp->name, name, sizeof(bp->name));
+		atomic64_set(&bp->residency_us, 0);
+		atomic_set(&bp->count, 0);
+	}
+	atomic64_set(&bp->expiry, 0);
+	WRITE_ONCE(bp->duration_us, duration_ms * USEC_PER_MSEC);
+	WRITE_ONCE(bp->triggers, triggers);
+	smp_wmb();
+	WRITE_ONCE(bp->floor_freq, floor_freq);
+	if (bp == &tunables->boost_profiles[tunables->nboost_profiles])
+		WRITE_ONCE(tunables->nboost_profiles,
+			   tunables->nboost_profiles + 1);
+	mutex_unlock(&boost_profile_lock);
+
+	return count;
+}
+
+static ssize_t show_boost_profile_stats(struct cpufreq_interactive_tunables
+		*tunables, char *buf)
+{
+	struct interactive_boost_profile *bp;
+	u64 now = ktime_to_us(ktime_get()), expiry, residency;
+	ssize_t ret = 0;
+	int i;
+
+	ret += scnprintf(buf, PAGE_SIZE, "profile count residency_ms active\n");
+	mutex_lock(&boost_profile_lock);
+	for (i = 0; i < tunables->nboost_profiles; i++) {
+		bp = &tunables->boost_profiles[i];
+		if (!bp->floor_freq)
+			continue;
+		expiry = atomic64_read(&bp->expiry);
+		residency = atomic64_read(&bp->residency_us);
+		/* Only count the part of the current boost that has elapsed */
+		if (expiry > now)
+			residency -= expiry - now;
+		ret += scnprintf(buf + ret, PAGE_SIZE - ret, "%s %d %llu %d\n",
+				 bp->name, atomic_read(&bp->count),
+				 div_u64(residency, USEC_PER_MSEC),
+				 expiry > now);
+	}
+	mutex_unlock(&boost_profile_lock);
+
+	return ret;
+}
+
+/* A hint fires the trigger for every policy, not just this one */
+static ssize_t store_boost_hint(struct cpufreq_interactive_tunables *tunables,
+				const char *buf, size_t count)
+{
+	char hint[16];
+	int i;
+
+	if (sscanf(buf, "%15s", hint) != 1)
+		return -EINVAL;
+
+	for (i = 0; i < CPUFREQ_BOOST_NR_TRIGGERS; i++)
+		if (!strcmp(hint, boost_trigger_names[i]))
+			break;
+	if (i == CPUFREQ_BOOST_NR_TRIGGERS)
+		return -EINVAL;
+
+	cpufreq_interactive_boost_trigger(i);
+	return count;
+}
+
 static ssize_t show_boostpulse_duration(struct cpufreq_interactive_tunables
 		*tunables, char *buf)
 {
@@ -1476,6 +2124,34 @@ show_store_gov_pol_sys(align_windows);
 show_store_gov_pol_sys(ignore_hispeed_on_notif);
 show_store_gov_pol_sys(fast_ramp_down);
 show_store_gov_pol_sys(enable_prediction);
+show_store_gov_pol_sys(instant_migration_ramp);
+show_store_gov_pol_sys(energy_aware);
+show_store_gov_pol_sys(energy_latency_load);
+show_store_gov_pol_sys(energy_debug);
+
+static ssize_t show_energy_table_gov_sys(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	struct cpufreq_interactive_policyinfo *ppol;
+	ssize_t ret = 0;
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		ppol = per_cpu(polinfo, cpu);
+		if (ppol && ppol->policy && cpu == ppol->policy->cpu)
+			ret = energy_table_dump(ppol, buf, ret);
+	}
+	return ret;
+}
+
+static ssize_t show_energy_table_gov_pol(struct cpufreq_policy *policy,
+		char *buf)
+{
+	return energy_table_dump(per_cpu(polinfo, policy->cpu), buf, 0);
+}
+show_store_gov_pol_sys(boost_profiles);
+show_gov_pol_sys(boost_profile_stats);
+store_gov_pol_sys(boost_hint);
 
 #define gov_sys_attr_rw(_name)						\
 static struct kobj_attribute _name##_gov_sys =				\
@@ -1506,6 +2182,11 @@ gov_sys_pol_attr_rw(align_windows);
 gov_sys_pol_attr_rw(ignore_hispeed_on_notif);
 gov_sys_pol_attr_rw(fast_ramp_down);
 gov_sys_pol_attr_rw(enable_prediction);
+gov_sys_pol_attr_rw(instant_migration_ramp);
+gov_sys_pol_attr_rw(energy_aware);
+gov_sys_pol_attr_rw(energy_latency_load);
+gov_sys_pol_attr_rw(energy_debug);
+gov_sys_pol_attr_rw(boost_profiles);
 
 static struct kobj_attribute boostpulse_gov_sys =
 	__ATTR(boostpulse, 0200, NULL, store_boostpulse_gov_sys);
@@ -1513,6 +2194,26 @@ static struct kobj_attribute boostpulse_gov_sys =
 static struct freq_attr boostpulse_gov_pol =
 	__ATTR(boostpulse, 0200, NULL, store_boostpulse_gov_pol);
 
+static struct kobj_attribute boost_profile_stats_gov_sys =
+	__ATTR(boost_profile_stats, 0444, show_boost_profile_stats_gov_sys,
+	       NULL);
+
+static struct freq_attr boost_profile_stats_gov_pol =
+	__ATTR(boost_profile_stats, 0444, show_boost_profile_stats_gov_pol,
+	       NULL);
+
+static struct kobj_attribute energy_table_gov_sys =
+	__ATTR(energy_table, 0444, show_energy_table_gov_sys, NULL);
+
+static struct freq_attr energy_table_gov_pol =
+	__ATTR(energy_table, 0444, show_energy_table_gov_pol, NULL);
+
+static struct kobj_attribute boost_hint_gov_sys =
+	__ATTR(boost_hint, 0200, NULL, store_boost_hint_gov_sys);
+
+static struct freq_attr boost_hint_gov_pol =
+	__ATTR(boost_hint, 0200, NULL, store_boost_hint_gov_pol);
+
 /* One Governor instance for entire system */
 static struct attribute *interactive_attributes_gov_sys[] = {
 	&target_loads_gov_sys.attr,
@@ -1533,6 +2234,14 @@ static struct attribute *interactive_attributes_gov_sys[] = {
 	&ignore_hispeed_on_notif_gov_sys.attr,
 	&fast_ramp_down_gov_sys.attr,
 	&enable_prediction_gov_sys.attr,
+	&instant_migration_ramp_gov_sys.attr,
+	&energy_aware_gov_sys.attr,
+	&energy_latency_load_gov_sys.attr,
+	&energy_debug_gov_sys.attr,
+	&energy_table_gov_sys.attr,
+	&boost_profiles_gov_sys.attr,
+	&boost_profile_stats_gov_sys.attr,
+	&boost_hint_gov_sys.attr,
 	NULL,
 };
 
@@ -1561,6 +2270,14 @@ static struct attribute *interactive_attributes_gov_pol[] = {
 	&ignore_hispeed_on_notif_gov_pol.attr,
 	&fast_ramp_down_gov_pol.attr,
 	&enable_prediction_gov_pol.attr,
+	&instant_migration_ramp_gov_pol.attr,
+	&energy_aware_gov_pol.attr,
+	&energy_latency_load_gov_pol.attr,
+	&energy_debug_gov_pol.attr,
+	&energy_table_gov_pol.attr,
+	&boost_profiles_gov_pol.attr,
+	&boost_profile_stats_gov_pol.attr,
+	&boost_hint_gov_pol.attr,
 	NULL,
 };
 
@@ -1600,6 +2317,7 @@ static struct cpufreq_interactive_tunables *alloc_tunable(
 	tunables->timer_rate = DEFAULT_TIMER_RATE;
 	tunables->boostpulse_duration_val = DEFAULT_MIN_SAMPLE_TIME;
 	tunables->timer_slack_val = DEFAULT_TIMER_SLACK;
+	tunables->energy_latency_load = DEFAULT_TARGET_LOAD;
 
 	spin_lock_init(&tunables->target_loads_lock);
 	spin_lock_init(&tunables->above_hispeed_delay_lock);
@@ -1673,6 +2391,7 @@ static void free_policyinfo(int cpu)
 		if (per_cpu(polinfo, j) == ppol)
 			per_cpu(polinfo, cpu) = NULL;
 	kfree(ppol->cached_tunables);
+	kfree(ppol->energy);
 	kfree(ppol->sl);
 	kfree(ppol);
 }
@@ -1711,6 +2430,8 @@ int cpufreq_interactive_init(struct cpufreq_policy *policy)
 	if (IS_ERR(ppol))
 		return PTR_ERR(ppol);
 
+	cpufreq_enable_fast_switch(policy);
+
 	if (have_governor_per_policy()) {
 		WARN_ON(tunables);
 	} else if (tunables) {
@@ -1744,9 +2465,7 @@ int cpufreq_interactive_init(struct cpufreq_policy *policy)
 		return rc;
 	}
 
-	if (!interactive_gov.usage_count++)
-		cpufreq_register_notifier(&cpufreq_notifier_block,
-				CPUFREQ_TRANSITION_NOTIFIER);
+	interactive_gov.usage_count++;
 
 	if (tunables->use_sched_load)
 		cpufreq_interactive_enable_sched_input(tunables);
@@ -1774,14 +2493,14 @@ void cpufreq_interactive_exit(struct cpufreq_policy *policy)
 
 	BUG_ON(!tunables);
 
+	cpufreq_disable_fast_switch(policy);
+
 	cpumask_andnot(&controlled_cpus, &controlled_cpus,
 		       policy->related_cpus);
 	sched_update_freq_max_load(cpu_possible_mask);
 	if (!--tunables->usage_count) {
 		/* Last policy using the governor ? */
-		if (!--interactive_gov.usage_count)
-			cpufreq_unregister_notifier(&cpufreq_notifier_block,
-					CPUFREQ_TRANSITION_NOTIFIER);
+		interactive_gov.usage_count--;
 
 		sysfs_remove_group(get_governor_parent_kobj(policy),
 				get_sysfs_attr());
@@ -1826,6 +2545,7 @@ int cpufreq_interactive_start(struct cpufreq_policy *policy)
 	ppol->min_freq = policy->min;
 	ppol->reject_notification = true;
 	ppol->notif_pending = false;
+	energy_table_init(ppol);
 	down_write(&ppol->enable_sem);
 	del_timer_sync(&ppol->policy_slack_timer);
 	ppol->last_evaluated_jiffy = get_jiffies_64();
@@ -1880,6 +2600,10 @@ void cpufreq_interactive_limits(struct cpufreq_policy *policy)
 	BUG_ON(!tunables);
 	ppol = per_cpu(polinfo, policy->cpu);
 
+	down_read(&ppol->enable_sem);
+	if (ppol->governor_enabled)
+		cpufreq_interactive_speed_changing(ppol);
+	up_read(&ppol->enable_sem);
 	__cpufreq_driver_target(policy,
 			ppol->target_freq, CPUFREQ_RELATION_L);
 
@@ -1925,6 +2649,9 @@ static int __init cpufreq_interactive_gov_init(void)
 	/* NB: wake up so the thread does not look hung to the freezer */
 	wake_up_process(speedchange_task);
 
+	if (input_register_handler(&boost_input_handler))
+		pr_warn("cpufreq_interactive: no touch boost trigger\n");
+
 	return cpufreq_register_governor(CPU_FREQ_GOV_INTERACTIVE);
 }
 
@@ -1943,6 +2670,7 @@ static void __exit cpufreq_interactive_gov_exit(void)
 {
 	int cpu;
 
+	input_unregister_handler(&boost_input_handler);
 	cpufreq_unregister_governor(CPU_FREQ_GOV_INTERACTIVE);
 	kthread_stop(speedchange_task);
 	put_task_struct(speedchange_task);
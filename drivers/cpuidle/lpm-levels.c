@@ -45,6 +45,7 @@
 #include <asm/cpuidle.h>
 #include "lpm-levels.h"
 #include <trace/events/power.h>
+#include <trace/events/irq.h>
 #if defined(CONFIG_COMMON_CLK)
 #include "../clk/clk.h"
 #elif defined(CONFIG_COMMON_CLK_MSM)
@@ -107,6 +108,69 @@ struct lpm_history {
 
 static DEFINE_PER_CPU(struct lpm_history, hist);
 
+/*
+ * Wakeup source predictor. Every IRQ that wakes a CPU from idle gets a
+ * slot with a log2 histogram of its inter-arrival times on that CPU. A
+ * source whose intervals mostly fall around their average is treated as
+ * periodic and predicted to fire again one average after its last
+ * arrival. The earliest such arrival, or the next timer if that is
+ * sooner, is the predicted residency.
+ *
+ * lpm_pred_mode 0 keeps the heuristic above in charge and only runs the
+ * histogram predictor in the shadow, 1 lets the histogram predictor
+ * choose the level. Both are scored in lpm_stats either way.
+ */
+#define LPM_PRED_SOURCES 8
+#define LPM_PRED_BUCKETS 20
+#define LPM_PRED_MIN_SAMPLES 8
+#define LPM_PRED_MAX_SAMPLES 64
+
+static uint32_t lpm_pred_mode;
+module_param_named(lpm_pred_mode, lpm_pred_mode, uint, 0664);
+
+static uint32_t lpm_pred_confidence = 75;
+module_param_named(lpm_pred_confidence, lpm_pred_confidence, uint, 0664);
+
+struct lpm_wake_source {
+	int irq;
+	uint64_t last_ns;
+	uint32_t avg_us;
+	uint32_t nsamp;
+	uint32_t bucket[LPM_PRED_BUCKETS];
+};
+
+struct lpm_wake_pred {
+	struct lpm_wake_source src[LPM_PRED_SOURCES];
+	bool wake_pending;
+	bool armed;
+	int max_level;
+	int level[LPM_PRED_NR];
+};
+
+static DEFINE_PER_CPU(struct lpm_wake_pred, wake_pred);
+
+/*
+ * Each CPU publishes its next timer and predicted wakeup (in us) when it
+ * picks a level, and every cluster above it keeps the minimum, so the
+ * last CPU gets the cluster's sleep time without walking its siblings.
+ * The cluster values pack the time with a sequence number bumped on each
+ * update. When the CPU holding the minimum wakes up the value goes stale
+ * and is rebuilt from the per-CPU slots, and the sequence number tells a
+ * rebuild that somebody published behind its back.
+ */
+#define LPM_WAKEUP_SEQ_BITS 16
+#define LPM_WAKEUP_SEQ_MASK ((1ULL << LPM_WAKEUP_SEQ_BITS) - 1)
+#define LPM_WAKEUP_NONE ((1ULL << (64 - LPM_WAKEUP_SEQ_BITS)) - 1)
+#define LPM_WAKEUP_STALE 0
+
+struct lpm_cpu_wakeup {
+	uint64_t us[LPM_WAKEUP_NR];
+};
+
+static DEFINE_PER_CPU(struct lpm_cpu_wakeup, cpu_wakeup) = {
+	.us = { LPM_WAKEUP_NONE, LPM_WAKEUP_NONE },
+};
+
 static DEFINE_PER_CPU(struct lpm_cpu*, cpu_lpm);
 static bool suspend_in_progress;
 static struct hrtimer lpm_hrtimer;
@@ -418,10 +482,162 @@ static enum hrtimer_restart clusttimer_fn(struct hrtimer *h)
 	return HRTIMER_NORESTART;
 }
 
-static void clusttimer_start(struct lpm_cluster *cluster, uint32_t time_us)
+static inline uint64_t lpm_wakeup_us(uint64_t v)
+{
+	return v >> LPM_WAKEUP_SEQ_BITS;
+}
+
+static inline uint64_t lpm_wakeup_pack(uint64_t us, uint64_t old)
+{
+	return (us << LPM_WAKEUP_SEQ_BITS) | ((old + 1) & LPM_WAKEUP_SEQ_MASK);
+}
+
+static void lpm_wakeup_min(atomic64_t *v, uint64_t us)
+{
+	uint64_t old = atomic64_read(v), new, prev;
+
+	for (;;) {
+		if (lpm_wakeup_us(old) == LPM_WAKEUP_STALE ||
+		    lpm_wakeup_us(old) <= us)
+			new = lpm_wakeup_pack(lpm_wakeup_us(old), old);
+		else
+			new = lpm_wakeup_pack(us, old);
+
+		prev = atomic64_cmpxchg(v, old, new);
+		if (prev == old)
+			break;
+		old = prev;
+	}
+}
+
+static void lpm_wakeup_rebuild(struct lpm_cluster *cluster, int type)
+{
+	atomic64_t *v = &cluster->next_wakeup[type];
+	uint64_t old = atomic64_read(v), earliest = LPM_WAKEUP_NONE;
+	int cpu;
+
+	if (lpm_wakeup_us(old) != LPM_WAKEUP_STALE)
+		return;
+
+	smp_rmb();
+	for_each_cpu(cpu, &cluster->child_cpus)
+		earliest = min(earliest,
+			       READ_ONCE(per_cpu(cpu_wakeup, cpu).us[type]));
+
+	atomic64_cmpxchg(v, old, lpm_wakeup_pack(earliest, old));
+}
+
+/* Drop the CPU's estimates, called once it is out of idle */
+static void lpm_wakeup_retract(struct lpm_cpu *cpu, int cpuid)
+{
+	struct lpm_cpu_wakeup *w = &per_cpu(cpu_wakeup, cpuid);
+	struct lpm_cluster *cluster;
+	uint64_t mine, old;
+	int type;
+
+	for (type = 0; type < LPM_WAKEUP_NR; type++) {
+		mine = w->us[type];
+		if (mine == LPM_WAKEUP_NONE)
+			continue;
+		WRITE_ONCE(w->us[type], LPM_WAKEUP_NONE);
+		smp_mb();
+
+		for (cluster = cpu->parent; cluster; cluster = cluster->parent) {
+			atomic64_t *v = &cluster->next_wakeup[type];
+
+			old = atomic64_read(v);
+			if (lpm_wakeup_us(old) != mine)
+				continue;
+			if (atomic64_cmpxchg(v, old, lpm_wakeup_pack(
+					LPM_WAKEUP_STALE, old)) == old)
+				lpm_wakeup_rebuild(cluster, type);
+		}
+	}
+}
+
+static void lpm_wakeup_publish(struct lpm_cpu *cpu, int cpuid,
+			       uint64_t timer_us, uint64_t pred_us)
+{
+	struct lpm_cpu_wakeup *w = &per_cpu(cpu_wakeup, cpuid);
+	struct lpm_cluster *cluster;
+	int type;
+
+	/* Idle entry was skipped after the last select */
+	lpm_wakeup_retract(cpu, cpuid);
+
+	WRITE_ONCE(w->us[LPM_WAKEUP_TIMER], timer_us);
+	WRITE_ONCE(w->us[LPM_WAKEUP_PRED], pred_us ? pred_us : LPM_WAKEUP_NONE);
+
+	for (cluster = cpu->parent; cluster; cluster = cluster->parent)
+		for (type = 0; type < LPM_WAKEUP_NR; type++)
+			lpm_wakeup_min(&cluster->next_wakeup[type],
+				       w->us[type]);
+}
+
+static uint64_t lpm_wakeup_read(struct lpm_cluster *cluster, int type)
+{
+	uint64_t us = lpm_wakeup_us(atomic64_read(&cluster->next_wakeup[type]));
+
+	if (us == LPM_WAKEUP_STALE) {
+		lpm_wakeup_rebuild(cluster, type);
+		us = lpm_wakeup_us(atomic64_read(&cluster->next_wakeup[type]));
+	}
+	return us;
+}
+
+/*
+ * Sleep and predicted time of the cluster from the shared estimates,
+ * false if they could not be rebuilt and the CPUs have to be walked.
+ */
+static bool lpm_cluster_wakeup(struct lpm_cluster *cluster,
+		uint32_t *sleep_us, uint32_t *pred_us)
 {
+	uint64_t now = ktime_to_us(ktime_get());
+	uint64_t timer, pred;
+
+	timer = lpm_wakeup_read(cluster, LPM_WAKEUP_TIMER);
+	pred = lpm_wakeup_read(cluster, LPM_WAKEUP_PRED);
+	if (timer == LPM_WAKEUP_STALE || pred == LPM_WAKEUP_STALE) {
+		lpm_stats_cluster_pred(cluster->stats, LPM_CLUSTER_PRED_SCAN);
+		return false;
+	}
+	lpm_stats_cluster_pred(cluster->stats, LPM_CLUSTER_PRED_SHARED);
+
+	if (timer == LPM_WAKEUP_NONE)
+		*sleep_us = ~0U;
+	else
+		*sleep_us = timer > now ? min_t(uint64_t, timer - now, ~0U) : 0;
+
+	if (lpm_prediction && cluster->lpm_prediction &&
+	    pred != LPM_WAKEUP_NONE && pred > now)
+		*pred_us = min_t(uint64_t, pred - now, ~0U);
+
+	return true;
+}
+
+/*
+ * The cluster timer only forces a fresh prediction, so it is not worth a
+ * wakeup when the cluster is due to wake up anyway before a deeper level
+ * would pay off.
+ */
+static void clusttimer_start(struct lpm_cluster *cluster, int idx)
+{
+	struct power_params *pwr_params = &cluster->levels[idx].pwr;
+	uint32_t time_us = pwr_params->max_residency + cluster->tmr_add;
 	uint64_t time_ns = time_us * NSEC_PER_USEC;
 	ktime_t clust_ktime = ns_to_ktime(time_ns);
+	uint64_t timer, now;
+
+	timer = lpm_wakeup_us(atomic64_read(
+			&cluster->next_wakeup[LPM_WAKEUP_TIMER]));
+	now = ktime_to_us(ktime_get());
+	if (timer != LPM_WAKEUP_STALE && timer != LPM_WAKEUP_NONE &&
+	    timer <= now + time_us + pwr_params->max_residency) {
+		lpm_stats_cluster_pred(cluster->stats,
+				       LPM_CLUSTER_PRED_TIMER_AVOIDED);
+		return;
+	}
+	lpm_stats_cluster_pred(cluster->stats, LPM_CLUSTER_PRED_TIMER_ARMED);
 
 	cluster->histtimer.function = clusttimer_fn;
 	hrtimer_start(&cluster->histtimer, clust_ktime,
@@ -554,6 +770,180 @@ static uint64_t lpm_cpuidle_predict(struct cpuidle_device *dev,
 	return 0;
 }
 
+static inline int lpm_pred_bucket(uint32_t us)
+{
+	return min_t(int, fls(us), LPM_PRED_BUCKETS - 1);
+}
+
+static void lpm_wake_source_sample(struct lpm_wake_source *s, uint64_t now)
+{
+	uint32_t interval_us = div_u64(now - s->last_ns, NSEC_PER_USEC);
+	int i;
+
+	/* Shared handlers of one IRQ all hit the tracepoint */
+	if (!interval_us)
+		return;
+	s->last_ns = now;
+
+	if (s->nsamp == LPM_PRED_MAX_SAMPLES) {
+		s->nsamp = 0;
+		for (i = 0; i < LPM_PRED_BUCKETS; i++) {
+			s->bucket[i] >>= 1;
+			s->nsamp += s->bucket[i];
+		}
+	}
+	s->bucket[lpm_pred_bucket(interval_us)]++;
+	s->nsamp++;
+
+	if (!s->avg_us)
+		s->avg_us = interval_us;
+	else
+		s->avg_us = s->avg_us - (s->avg_us >> 3) + (interval_us >> 3);
+}
+
+/* Runs for every IRQ, with the CPU's predictor to itself */
+static void lpm_irq_handler_entry(void *ignore, int irq,
+				  struct irqaction *action)
+{
+	struct lpm_wake_pred *pred = this_cpu_ptr(&wake_pred);
+	struct lpm_wake_source *s, *victim = &pred->src[0];
+	uint64_t now;
+	int i;
+
+	for (i = 0; i < LPM_PRED_SOURCES; i++) {
+		s = &pred->src[i];
+		if (s->irq == irq) {
+			pred->wake_pending = false;
+			lpm_wake_source_sample(s, sched_clock());
+			return;
+		}
+		if (s->last_ns < victim->last_ns)
+			victim = s;
+	}
+
+	if (!pred->wake_pending)
+		return;
+
+	/* Only sources that take the CPU out of idle are worth a slot */
+	pred->wake_pending = false;
+	now = sched_clock();
+	memset(victim, 0, sizeof(*victim));
+	victim->irq = irq;
+	victim->last_ns = now;
+}
+
+static uint32_t lpm_wake_predict(struct lpm_wake_pred *pred,
+				 uint32_t next_wakeup_us)
+{
+	uint64_t now = sched_clock();
+	uint32_t predicted = next_wakeup_us;
+	uint32_t elapsed_us, near;
+	int i, b;
+
+	for (i = 0; i < LPM_PRED_SOURCES; i++) {
+		struct lpm_wake_source *s = &pred->src[i];
+
+		if (!s->irq || s->nsamp < LPM_PRED_MIN_SAMPLES)
+			continue;
+
+		b = lpm_pred_bucket(s->avg_us);
+		near = s->bucket[b];
+		if (b)
+			near += s->bucket[b - 1];
+		if (b < LPM_PRED_BUCKETS - 1)
+			near += s->bucket[b + 1];
+		if (near * 100 < s->nsamp * lpm_pred_confidence)
+			continue;
+
+		/* Overdue sources are not periodic at the moment */
+		elapsed_us = div_u64(now - s->last_ns, NSEC_PER_USEC);
+		if (elapsed_us >= s->avg_us)
+			continue;
+
+		predicted = min(predicted, s->avg_us - elapsed_us);
+	}
+
+	return predicted;
+}
+
+/* Deepest enabled level at or below max_level that suits residency_us */
+static int lpm_pred_level(struct cpuidle_device *dev, struct lpm_cpu *cpu,
+			  int max_level, uint32_t residency_us)
+{
+	uint32_t *max_residency = get_per_cpu_max_residency(dev->cpu);
+	int i, level = 0;
+
+	for (i = 0; i <= max_level; i++) {
+		if (i && !lpm_cpu_mode_allow(dev->cpu, i, true))
+			continue;
+		level = i;
+		if (residency_us <= max_residency[i])
+			break;
+	}
+	return level;
+}
+
+/*
+ * Record what both predictors pick for this idle period and return the
+ * histogram predictor's choice together with its predicted residency.
+ */
+static int lpm_wake_pred_select(struct cpuidle_device *dev,
+		struct lpm_cpu *cpu, uint32_t latency_us,
+		uint32_t next_event_us, uint32_t next_wakeup_us,
+		int heuristic_level, uint32_t *predicted_us)
+{
+	struct lpm_wake_pred *pred = this_cpu_ptr(&wake_pred);
+	int i, max_level = 0;
+
+	for (i = 1; i < cpu->nlevels; i++) {
+		uint32_t lvl_latency_us = cpu->levels[i].pwr.latency_us;
+
+		if (!lpm_cpu_mode_allow(dev->cpu, i, true))
+			continue;
+		if (latency_us < lvl_latency_us)
+			break;
+		if (next_event_us && next_event_us < lvl_latency_us)
+			break;
+		max_level = i;
+	}
+
+	*predicted_us = lpm_wake_predict(pred, next_wakeup_us);
+	pred->max_level = max_level;
+	pred->level[LPM_PRED_HEURISTIC] = heuristic_level;
+	pred->level[LPM_PRED_HISTOGRAM] = lpm_pred_level(dev, cpu, max_level,
+							 *predicted_us);
+	pred->armed = true;
+
+	return pred->level[LPM_PRED_HISTOGRAM];
+}
+
+/*
+ * Score both predictors against the level the actual residency called
+ * for. Periods cut short by the misprediction timer say nothing about
+ * the wakeup sources and are skipped.
+ */
+static void lpm_wake_pred_account(struct cpuidle_device *dev,
+		struct lpm_cpu *cpu, bool success)
+{
+	struct lpm_wake_pred *pred = this_cpu_ptr(&wake_pred);
+	struct lpm_history *history = this_cpu_ptr(&hist);
+	int ideal;
+
+	pred->wake_pending = true;
+	if (!pred->armed)
+		return;
+	pred->armed = false;
+
+	if (!success || history->hinvalid)
+		return;
+
+	ideal = lpm_pred_level(dev, cpu, pred->max_level, dev->last_residency);
+	lpm_stats_cpu_predict(LPM_PRED_HEURISTIC,
+			      pred->level[LPM_PRED_HEURISTIC], ideal);
+	lpm_stats_cpu_predict(LPM_PRED_HISTOGRAM,
+			      pred->level[LPM_PRED_HISTOGRAM], ideal);
+}
+
 static inline void invalidate_predict_history(struct cpuidle_device *dev)
 {
 	struct lpm_history *history = &per_cpu(hist, dev->cpu);
@@ -615,14 +1005,16 @@ static int cpu_power_select(struct cpuidle_device *dev,
 	uint32_t next_event_us = 0;
 	int i, idx_restrict;
 	uint32_t lvl_latency_us = 0;
-	uint64_t predicted = 0;
+	uint64_t predicted = 0, pred_wake_us = 0;
 	uint32_t htime = 0, idx_restrict_time = 0;
 	uint32_t next_wakeup_us = (uint32_t)sleep_us;
 	uint32_t *min_residency = get_per_cpu_min_residency(dev->cpu);
 	uint32_t *max_residency = get_per_cpu_max_residency(dev->cpu);
 
-	if ((sleep_disabled && !cpu_isolated(dev->cpu)) || sleep_us < 0)
+	if ((sleep_disabled && !cpu_isolated(dev->cpu)) || sleep_us < 0) {
+		lpm_wakeup_publish(cpu, dev->cpu, ktime_to_us(ktime_get()), 0);
 		return best_level;
+	}
 
 	idx_restrict = cpu->nlevels + 1;
 
@@ -685,6 +1077,24 @@ static int cpu_power_select(struct cpuidle_device *dev,
 			break;
 	}
 
+	if (lpm_prediction && cpu->lpm_prediction && !cpu_isolated(dev->cpu)) {
+		uint32_t wake_us;
+		int level;
+
+		level = lpm_wake_pred_select(dev, cpu, latency_us,
+				next_event_us, next_wakeup_us, best_level,
+				&wake_us);
+		if (lpm_pred_mode) {
+			best_level = level;
+			modified_time_us = 0;
+			idx_restrict = cpu->nlevels + 1;
+			idx_restrict_time = 0;
+			predicted = wake_us < next_wakeup_us ? wake_us : 0;
+			pred_wake_us = predicted ?
+				ktime_to_us(ktime_get()) + predicted : 0;
+		}
+	}
+
 	if (modified_time_us)
 		msm_pm_set_timer(modified_time_us);
 
@@ -707,6 +1117,11 @@ static int cpu_power_select(struct cpuidle_device *dev,
 	}
 
 done_select:
+	if (!lpm_pred_mode && lpm_prediction && cpu->lpm_prediction)
+		pred_wake_us = per_cpu(hist, dev->cpu).stime;
+	lpm_wakeup_publish(cpu, dev->cpu, ktime_to_us(ktime_get()) + sleep_us,
+			   pred_wake_us);
+
 	trace_cpu_power_select(best_level, sleep_us, latency_us, next_event_us);
 
 	trace_cpu_pred_select(idx_restrict_time ? 2 : (predicted ? 1 : 0),
@@ -949,7 +1364,8 @@ static int cluster_select(struct lpm_cluster *cluster, bool from_idle,
 	if (!cluster)
 		return -EINVAL;
 
-	sleep_us = (uint32_t)get_cluster_sleep_time(cluster,
+	if (!from_idle || !lpm_cluster_wakeup(cluster, &sleep_us, &cpupred_us))
+		sleep_us = (uint32_t)get_cluster_sleep_time(cluster,
 						from_idle, &cpupred_us);
 
 	if (from_idle) {
@@ -1082,12 +1498,8 @@ static int cluster_configure(struct lpm_cluster *cluster, int idx,
 
 	cluster->last_level = idx;
 
-	if (predicted && (idx < (cluster->nlevels - 1))) {
-		struct power_params *pwr_params = &cluster->levels[idx].pwr;
-
-		clusttimer_start(cluster, pwr_params->max_residency +
-							cluster->tmr_add);
-	}
+	if (predicted && (idx < (cluster->nlevels - 1)))
+		clusttimer_start(cluster, idx);
 
 	return 0;
 }
@@ -1136,13 +1548,7 @@ static void cluster_prepare(struct lpm_cluster *cluster,
 					-1, ktime_to_us(ktime_get()));
 
 		if (i < 0) {
-			struct power_params *pwr_params =
-						&cluster->levels[0].pwr;
-
-			clusttimer_start(cluster,
-					pwr_params->max_residency +
-					cluster->tmr_add);
-
+			clusttimer_start(cluster, 0);
 			goto failed;
 		}
 	}
@@ -1428,6 +1834,8 @@ static int lpm_cpuidle_enter(struct cpuidle_device *dev,
 	cpu_unprepare(cpu, idx, true);
 	dev->last_residency = ktime_us_delta(ktime_get(), start);
 	update_history(dev, idx);
+	lpm_wake_pred_account(dev, cpu, success);
+	lpm_wakeup_retract(cpu, dev->cpu);
 	trace_cpu_idle_exit(idx, success);
 	if (lpm_prediction && cpu->lpm_prediction) {
 		histtimer_cancel();
@@ -1742,6 +2150,9 @@ static int lpm_probe(struct platform_device *pdev)
 
 	cluster_timer_init(lpm_root_node);
 
+	if (register_trace_irq_handler_entry(lpm_irq_handler_entry, NULL))
+		pr_info("Wakeup source prediction unavailable\n");
+
 	size = num_dbg_elements * sizeof(struct lpm_debug);
 	lpm_debug = dma_alloc_coherent(&pdev->dev, size,
 			&lpm_debug_phys, GFP_KERNEL);
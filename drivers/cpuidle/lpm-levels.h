@@ -99,6 +99,12 @@ struct cluster_history {
 	int flag;
 };
 
+enum lpm_wakeup_type {
+	LPM_WAKEUP_TIMER,
+	LPM_WAKEUP_PRED,
+	LPM_WAKEUP_NR,
+};
+
 struct lpm_cluster {
 	struct list_head list;
 	struct list_head child;
@@ -121,6 +127,11 @@ struct lpm_cluster {
 	unsigned int psci_mode_mask;
 	struct cluster_history history;
 	struct hrtimer histtimer;
+	/*
+	 * Earliest timer and predicted wakeup of the idle CPUs below this
+	 * cluster, maintained lock-free as CPUs enter and leave idle.
+	 */
+	atomic64_t next_wakeup[LPM_WAKEUP_NR];
 };
 
 struct lpm_cluster *lpm_of_parse_cluster(struct platform_device *pdev);
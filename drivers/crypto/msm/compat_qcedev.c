@@ -432,6 +432,8 @@ static unsigned int convert_cmd(unsigned int cmd)
 		return QCEDEV_IOCTL_MAP_BUF_REQ;
 	case COMPAT_QCEDEV_IOCTL_UNMAP_BUF_REQ:
 		return QCEDEV_IOCTL_UNMAP_BUF_REQ;
+	case COMPAT_QCEDEV_IOCTL_SHA_UPDATE_REG_REQ:
+		return QCEDEV_IOCTL_SHA_UPDATE_REG_REQ;
 	default:
 		return cmd;
 	}
@@ -485,6 +487,27 @@ long compat_qcedev_ioctl(struct file *file,
 		err = compat_put_qcedev_sha_op_req(data32, data);
 		return ret ? ret : err;
 	}
+	case COMPAT_QCEDEV_IOCTL_SHA_UPDATE_REG_REQ: {
+		struct compat_qcedev_sha_reg_op_req __user *data32;
+		struct qcedev_sha_reg_op_req __user *data;
+		compat_int_t fd;
+		int err;
+
+		data32 = compat_ptr(arg);
+		data = compat_alloc_user_space(sizeof(*data));
+		if (!data)
+			return -EFAULT;
+
+		err = get_user(fd, &data32->fd);
+		err |= put_user(fd, &data->fd);
+		err |= compat_get_qcedev_sha_op_req(&data32->req, &data->req);
+		if (err)
+			return err;
+
+		ret = qcedev_ioctl(file, convert_cmd(cmd), (unsigned long)data);
+		err = compat_put_qcedev_sha_op_req(&data32->req, &data->req);
+		return ret ? ret : err;
+	}
 	case COMPAT_QCEDEV_IOCTL_MAP_BUF_REQ: {
 		struct compat_qcedev_map_buf_req __user *data32;
 		struct qcedev_map_buf_req __user *data;
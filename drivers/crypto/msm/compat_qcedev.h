@@ -151,6 +151,19 @@ struct	compat_qcedev_sha_op_req {
 	enum qcedev_sha_alg_enum		alg;
 };
 
+/**
+ * struct compat_qcedev_sha_reg_op_req - Hashing request over a registered
+ * buffer
+ * @fd (IN):			ION buffer registered with
+ *				COMPAT_QCEDEV_IOCTL_MAP_BUF_REQ
+ * @req (IN/OUT):		Hashing request, the data[].offset entries
+ *				are offsets into @fd
+ */
+struct	compat_qcedev_sha_reg_op_req {
+	compat_int_t				fd;
+	struct compat_qcedev_sha_op_req		req;
+};
+
 /**
  * struct compact_qcedev_map_buf_req - Holds the mapping request information
  * fd (IN):            Array of fds.
@@ -204,5 +217,7 @@ extern long compat_qcedev_ioctl(struct file *file,
 	_IOWR(QCEDEV_IOC_MAGIC, 10, struct compat_qcedev_map_buf_req)
 #define COMPAT_QCEDEV_IOCTL_UNMAP_BUF_REQ \
 	_IOWR(QCEDEV_IOC_MAGIC, 11, struct compat_qcedev_unmap_buf_req)
+#define COMPAT_QCEDEV_IOCTL_SHA_UPDATE_REG_REQ \
+	_IOWR(QCEDEV_IOC_MAGIC, 12, struct compat_qcedev_sha_reg_op_req)
 #endif /* CONFIG_COMPAT */
 #endif /* _UAPI_COMPAT_QCEDEV__H */
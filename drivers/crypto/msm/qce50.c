@@ -74,7 +74,7 @@ static LIST_HEAD(qce50_bam_list);
 #define MAX_BUNCH_MODE_REQ 2
 /* Max number of request supported */
 #define MAX_QCE_BAM_REQ 8
-/* Interrupt flag will be set for every SET_INTR_AT_REQ request */
+/* Interrupt flag will be set for every SET_INTR_AT_REQ request by default */
 #define SET_INTR_AT_REQ			(MAX_QCE_BAM_REQ / 2)
 /* To create extra request space to hold dummy request */
 #define MAX_QCE_BAM_REQ_WITH_DUMMY_REQ	(MAX_QCE_BAM_REQ + 1)
@@ -89,6 +89,12 @@ static LIST_HEAD(qce50_bam_list);
 #define DELAY_IN_JIFFIES 5
 /* Index to point the dummy request */
 #define DUMMY_REQ_INDEX			MAX_QCE_BAM_REQ
+/*
+ * Largest bunch_depth accepted. A bunch may run one request past the
+ * cadence, and the next bunch must find a free request while the
+ * current one waits for its interrupt.
+ */
+#define MAX_BUNCH_DEPTH			(MAX_QCE_BAM_REQ - 2)
 
 #define TOTAL_IOVEC_SPACE_PER_PIPE (QCE_MAX_NUM_DSCR * sizeof(struct sps_iovec))
 
@@ -170,6 +176,18 @@ static void _sps_producer_callback(struct sps_event_notify *notify);
 static int qce_dummy_req(struct qce_device *pce_dev);
 
 static int _qce50_disp_stats;
+module_param_named(disp_stats, _qce50_disp_stats, int, 0644);
+MODULE_PARM_DESC(disp_stats, "Log engine stats when qcrypto stats are read");
+
+static unsigned int bunch_threshold = MAX_BUNCH_MODE_REQ;
+module_param(bunch_threshold, uint, 0644);
+MODULE_PARM_DESC(bunch_threshold,
+	"Outstanding requests that switch the engine to bunch mode");
+
+static unsigned int bunch_depth = SET_INTR_AT_REQ;
+module_param(bunch_depth, uint, 0644);
+MODULE_PARM_DESC(bunch_depth,
+	"Most requests completed by one interrupt in bunch mode");
 
 /* Standard initialization vector for SHA-1, source: FIPS 180-2 */
 static uint32_t  _std_init_vector_sha1[] =   {
@@ -3118,6 +3136,10 @@ void qce_get_driver_stats(void *handle)
 		pr_info("Engine %d is in INTERRUPT MODE\n", pce_dev->dev_no);
 	pr_info("Engine %d outstanding request %d\n", pce_dev->dev_no,
 			atomic_read(&pce_dev->no_of_queued_req));
+	pr_info("Engine %d bunch requests %u interrupts %u max bunch %u\n",
+			pce_dev->dev_no, pce_dev->qce_stats.no_of_bunch_reqs,
+			pce_dev->qce_stats.no_of_bunch_intrs,
+			pce_dev->qce_stats.max_bunch_len);
 }
 EXPORT_SYMBOL(qce_get_driver_stats);
 
@@ -3127,6 +3149,9 @@ void qce_clear_driver_stats(void *handle)
 
 	pce_dev->qce_stats.no_of_timeouts = 0;
 	pce_dev->qce_stats.no_of_dummy_reqs = 0;
+	pce_dev->qce_stats.no_of_bunch_reqs = 0;
+	pce_dev->qce_stats.no_of_bunch_intrs = 0;
+	pce_dev->qce_stats.max_bunch_len = 0;
 }
 EXPORT_SYMBOL(qce_clear_driver_stats);
 
@@ -4649,6 +4674,7 @@ static int select_mode(struct qce_device *pce_dev,
 	struct ce_sps_data *pce_sps_data = &preq_info->ce_sps;
 	unsigned int no_of_queued_req;
 	unsigned int cadence;
+	unsigned int depth;
 
 	if (!pce_dev->no_get_around) {
 		_qce_set_flag(&pce_sps_data->out_transfer, SPS_IOVEC_FLAG_INT);
@@ -4666,7 +4692,7 @@ static int select_mode(struct qce_device *pce_dev,
 	}
 	no_of_queued_req = atomic_inc_return(&pce_dev->no_of_queued_req);
 	if (pce_dev->mode == IN_INTERRUPT_MODE) {
-		if (no_of_queued_req >= MAX_BUNCH_MODE_REQ) {
+		if (no_of_queued_req >= max(READ_ONCE(bunch_threshold), 2U)) {
 			pce_dev->mode = IN_BUNCH_MODE;
 			pr_debug("pcedev %d mode switch to BUNCH\n",
 					pce_dev->dev_no);
@@ -4683,15 +4709,22 @@ static int select_mode(struct qce_device *pce_dev,
 		}
 	} else {
 		pce_dev->intr_cadence++;
+		pce_dev->qce_stats.no_of_bunch_reqs++;
+		depth = clamp(READ_ONCE(bunch_depth), 1U, MAX_BUNCH_DEPTH);
 		cadence = (preq_info->req_len >> 7) + 1;
-		if (cadence > SET_INTR_AT_REQ)
-			cadence = SET_INTR_AT_REQ;
+		if (cadence > depth)
+			cadence = depth;
 		if (pce_dev->intr_cadence < cadence || ((pce_dev->intr_cadence
 					== cadence) && pce_dev->cadence_flag))
 			atomic_inc(&pce_dev->bunch_cmd_seq);
 		else {
 			_qce_set_flag(&pce_sps_data->out_transfer,
 					SPS_IOVEC_FLAG_INT);
+			pce_dev->qce_stats.no_of_bunch_intrs++;
+			if (pce_dev->intr_cadence >
+					pce_dev->qce_stats.max_bunch_len)
+				pce_dev->qce_stats.max_bunch_len =
+						pce_dev->intr_cadence;
 			pce_dev->intr_cadence = 0;
 			atomic_set(&pce_dev->bunch_cmd_seq, 0);
 			atomic_set(&pce_dev->last_intr_seq, 0);
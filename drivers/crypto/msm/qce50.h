@@ -240,6 +240,9 @@ struct qce_driver_stats {
 	int no_of_dummy_reqs;
 	int current_mode;
 	int outstanding_reqs;
+	unsigned int no_of_bunch_reqs;
+	unsigned int no_of_bunch_intrs;
+	unsigned int max_bunch_len;
 };
 
 #endif /* _DRIVERS_CRYPTO_MSM_QCE50_H */
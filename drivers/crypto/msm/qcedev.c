@@ -26,6 +26,7 @@
 #include <linux/miscdevice.h>
 #include <linux/uaccess.h>
 #include <linux/debugfs.h>
+#include <linux/ktime.h>
 #include <linux/scatterlist.h>
 #include <linux/crypto.h>
 #include <linux/platform_data/qcom_crypto_device.h>
@@ -43,6 +44,14 @@
 #define CACHE_LINE_SIZE 32
 #define CE_SHA_BLOCK_SIZE SHA256_BLOCK_SIZE
 
+/*
+ * Scatterlist entries for one QCE_MAX_OPER_DATA transfer over a registered
+ * buffer: every page it spans, plus a page boundary on each side of every
+ * buffer entry and one entry for the sha trailing buffer.
+ */
+#define QCEDEV_REG_MAX_SG \
+	((QCE_MAX_OPER_DATA >> PAGE_SHIFT) + 2 * QCEDEV_MAX_BUFFERS + 1)
+
 static uint8_t  _std_init_vector_sha1_uint8[] =   {
 	0x67, 0x45, 0x23, 0x01, 0xEF, 0xCD, 0xAB, 0x89,
 	0x98, 0xBA, 0xDC, 0xFE, 0x10, 0x32, 0x54, 0x76,
@@ -223,6 +232,22 @@ static struct qcedev_control qce_dev[] = {
 #define DEBUG_MAX_FNAME  16
 #define DEBUG_MAX_RW_BUF 1024
 
+enum qcedev_xfer_mode {
+	QCEDEV_XFER_VBUF,
+	QCEDEV_XFER_REG_BUF,
+	QCEDEV_XFER_LAST,
+};
+
+static const char * const qcedev_xfer_mode_names[QCEDEV_XFER_LAST] = {
+	[QCEDEV_XFER_VBUF]	= "vbuf",
+	[QCEDEV_XFER_REG_BUF]	= "registered",
+};
+
+struct qcedev_xfer_stat {
+	u64 bytes;
+	u64 ns;
+};
+
 struct qcedev_stat {
 	u32 qcedev_dec_success;
 	u32 qcedev_dec_fail;
@@ -230,6 +255,8 @@ struct qcedev_stat {
 	u32 qcedev_enc_fail;
 	u32 qcedev_sha_success;
 	u32 qcedev_sha_fail;
+	struct qcedev_xfer_stat cipher_xfer[QCEDEV_XFER_LAST];
+	struct qcedev_xfer_stat sha_xfer[QCEDEV_XFER_LAST];
 };
 
 static struct qcedev_stat _qcedev_stat;
@@ -386,10 +413,6 @@ static int start_cipher_req(struct qcedev_control *podev)
 	/* start the command on the podev->active_command */
 	qcedev_areq = podev->active_command;
 	qcedev_areq->cipher_req.cookie = qcedev_areq->handle;
-	if (qcedev_areq->cipher_op_req.use_pmem == QCEDEV_USE_PMEM) {
-		pr_err("%s: Use of PMEM is not supported\n", __func__);
-		goto unsupported;
-	}
 	creq.pmem = NULL;
 	switch (qcedev_areq->cipher_op_req.alg) {
 	case QCEDEV_ALG_DES:
@@ -617,6 +640,13 @@ static int submit_req(struct qcedev_async_req *qcedev_areq,
 	return qcedev_areq->err;
 }
 
+static void qcedev_update_xfer_stat(struct qcedev_xfer_stat *xfer,
+				uint32_t bytes, ktime_t start)
+{
+	xfer->bytes += bytes;
+	xfer->ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
 static int qcedev_sha_init(struct qcedev_async_req *areq,
 				struct qcedev_handle *handle)
 {
@@ -1171,6 +1201,146 @@ static int qcedev_hash_final(struct qcedev_async_req *areq,
 		return qcedev_hmac_final(areq, handle);
 }
 
+/*
+ * Fill sg with len bytes of a registered buffer request starting pos bytes
+ * into it. The buf_info entries of such a request hold offsets into the
+ * registered buffer instead of user addresses.
+ */
+static int qcedev_reg_buf_fill_sg(struct qcedev_reg_buf_info *binfo,
+				struct buf_info *bufs, uint32_t entries,
+				uint32_t pos, uint32_t len,
+				struct scatterlist *sg, int nents)
+{
+	uint32_t i, seg;
+	int n = 0;
+	int rc;
+
+	for (i = 0; i < entries && len; i++) {
+		if (pos >= bufs[i].len) {
+			pos -= bufs[i].len;
+			continue;
+		}
+		if (pos > U32_MAX - bufs[i].offset)
+			return -ERANGE;
+
+		seg = min(bufs[i].len - pos, len);
+		rc = qcedev_reg_buffer_sg(binfo, bufs[i].offset + pos, seg,
+				&sg[n], nents - n);
+		if (rc < 0)
+			return rc;
+		n += rc;
+		pos = 0;
+		len -= seg;
+	}
+
+	return len ? -EINVAL : n;
+}
+
+static int qcedev_reg_sha_update(struct qcedev_async_req *qcedev_areq,
+				struct qcedev_handle *handle, int fd)
+{
+	struct qcedev_sha_op_req *sreq = &qcedev_areq->sha_op_req;
+	struct qcedev_sha_ctxt *sha_ctxt = &handle->sha_ctxt;
+	struct qcedev_reg_buf_info *binfo;
+	struct scatterlist *sg;
+	uint8_t *k_buf_src = NULL;
+	uint8_t *k_align_src = NULL;
+	uint32_t remain = sreq->data_len;
+	uint32_t pos = 0;
+	uint32_t total, nbytes, t_buf;
+	uint32_t sha_pad_len, trailing_buf_len;
+	int nents, rc;
+	int err = 0;
+
+	if (sha_ctxt->init_done == false) {
+		pr_err("%s Init was not called\n", __func__);
+		return -EINVAL;
+	}
+
+	if (remain > U32_MAX - CE_SHA_BLOCK_SIZE)
+		return -EINVAL;
+
+	binfo = qcedev_get_reg_buffer(handle, fd);
+	if (!binfo) {
+		pr_err("%s: fd %d is not registered\n", __func__, fd);
+		return -EINVAL;
+	}
+
+	sg = kmalloc_array(QCEDEV_REG_MAX_SG, sizeof(*sg), GFP_KERNEL);
+	k_buf_src = kmalloc(CE_SHA_BLOCK_SIZE + CACHE_LINE_SIZE * 2,
+				GFP_KERNEL);
+	if (!sg || !k_buf_src) {
+		err = -ENOMEM;
+		goto exit;
+	}
+	k_align_src = (uint8_t *)ALIGN(((uintptr_t)k_buf_src),
+							CACHE_LINE_SIZE);
+
+	while (!err) {
+		t_buf = sha_ctxt->trailing_buf_len;
+		total = t_buf + remain;
+		sg_init_table(sg, QCEDEV_REG_MAX_SG);
+
+		/* Less than a block left, keep it for the next update/final */
+		if (total <= CE_SHA_BLOCK_SIZE) {
+			if (remain) {
+				nents = qcedev_reg_buf_fill_sg(binfo,
+						sreq->data, sreq->entries,
+						pos, remain, sg,
+						QCEDEV_REG_MAX_SG);
+				if (nents < 0) {
+					err = nents;
+					break;
+				}
+				sg_copy_to_buffer(sg, nents,
+						&sha_ctxt->trailing_buf[t_buf],
+						remain);
+			}
+			sha_ctxt->trailing_buf_len = total;
+			break;
+		}
+
+		/* Hold the last block back, as the vbuf path does */
+		sha_pad_len = ALIGN(total, CE_SHA_BLOCK_SIZE) - total;
+		trailing_buf_len = CE_SHA_BLOCK_SIZE - sha_pad_len;
+		nbytes = min_t(uint32_t, total - trailing_buf_len,
+				QCE_MAX_OPER_DATA);
+
+		nents = 0;
+		if (t_buf) {
+			memcpy(k_align_src, &sha_ctxt->trailing_buf[0], t_buf);
+			sg_set_buf(&sg[nents++], k_align_src, t_buf);
+		}
+		rc = qcedev_reg_buf_fill_sg(binfo, sreq->data, sreq->entries,
+				pos, nbytes - t_buf, &sg[nents],
+				QCEDEV_REG_MAX_SG - nents);
+		if (rc < 0) {
+			err = rc;
+			break;
+		}
+		nents += rc;
+		sg_mark_end(&sg[nents - 1]);
+
+		qcedev_areq->sha_req.sreq.src = sg;
+		qcedev_areq->sha_req.sreq.nbytes = nbytes;
+
+		err = submit_req(qcedev_areq, handle);
+
+		sha_ctxt->last_blk = 0;
+		sha_ctxt->first_blk = 0;
+		sha_ctxt->trailing_buf_len = 0;
+		pos += nbytes - t_buf;
+		remain -= nbytes - t_buf;
+	}
+
+	qcedev_areq->sha_req.sreq.src = NULL;
+exit:
+	kzfree(k_buf_src);
+	kfree(sg);
+	qcedev_put_reg_buffer(handle, binfo);
+	return err;
+}
+
 static int qcedev_vbuf_ablk_cipher_max_xfer(struct qcedev_async_req *areq,
 				int *di, struct qcedev_handle *handle,
 				uint8_t *k_align_src)
@@ -1416,6 +1586,68 @@ static int qcedev_vbuf_ablk_cipher(struct qcedev_async_req *areq,
 
 }
 
+/*
+ * Run a cipher request in place over a buffer registered with
+ * QCEDEV_IOCTL_MAP_BUF_REQ. Unlike the vbuf path nothing is copied, the
+ * crypto engine works directly on the pages of the buffer.
+ */
+static int qcedev_reg_ablk_cipher(struct qcedev_async_req *areq,
+				struct qcedev_handle *handle)
+{
+	struct qcedev_cipher_op_req *creq = &areq->cipher_op_req;
+	struct qcedev_reg_buf_info *binfo;
+	struct scatterlist *sg;
+	uint32_t data_len = creq->data_len;
+	uint32_t pos = 0;
+	uint32_t len;
+	int nents;
+	int err = 0;
+
+	binfo = qcedev_get_reg_buffer(handle, creq->pmem.fd_src);
+	if (!binfo) {
+		pr_err("%s: fd %d is not registered\n", __func__,
+				creq->pmem.fd_src);
+		return -EINVAL;
+	}
+
+	sg = kmalloc_array(QCEDEV_REG_MAX_SG, sizeof(*sg), GFP_KERNEL);
+	if (!sg) {
+		err = -ENOMEM;
+		goto exit;
+	}
+
+	/* Address QCE_MAX_OPER_DATA at a time, the iv carries over */
+	while ((pos < data_len) && (err == 0)) {
+		len = min_t(uint32_t, data_len - pos, QCE_MAX_OPER_DATA);
+
+		sg_init_table(sg, QCEDEV_REG_MAX_SG);
+		nents = qcedev_reg_buf_fill_sg(binfo, creq->pmem.src,
+				creq->entries, pos, len, sg, QCEDEV_REG_MAX_SG);
+		if (nents < 0) {
+			err = nents;
+			break;
+		}
+		sg_mark_end(&sg[nents - 1]);
+
+		areq->cipher_req.creq.src = sg;
+		areq->cipher_req.creq.dst = sg;
+		areq->cipher_req.creq.nbytes = len;
+		areq->cipher_req.creq.info = creq->iv;
+		creq->data_len = len;
+
+		err = submit_req(areq, handle);
+		pos += len;
+	}
+
+	creq->data_len = data_len;
+	areq->cipher_req.creq.src = NULL;
+	areq->cipher_req.creq.dst = NULL;
+	kfree(sg);
+exit:
+	qcedev_put_reg_buffer(handle, binfo);
+	return err;
+}
+
 static int qcedev_check_cipher_key(struct qcedev_cipher_op_req *req,
 						struct qcedev_control *podev)
 {
@@ -1477,9 +1709,14 @@ static int qcedev_check_cipher_params(struct qcedev_cipher_op_req *req,
 	uint32_t total = 0;
 	uint32_t i;
 
+	/* Registered buffers are only ciphered in place */
 	if (req->use_pmem) {
-		pr_err("%s: Use of PMEM is not supported\n", __func__);
-		goto error;
+		if ((req->use_pmem != QCEDEV_USE_PMEM) || !req->in_place_op ||
+				req->byteoffset) {
+			pr_err("%s: Invalid registered buffer request\n",
+								__func__);
+			goto error;
+		}
 	}
 	if ((req->entries == 0) || (req->data_len == 0) ||
 			(req->entries > QCEDEV_MAX_BUFFERS)) {
@@ -1556,6 +1793,23 @@ static int qcedev_check_cipher_params(struct qcedev_cipher_op_req *req,
 			goto error;
 		}
 	}
+	if (req->use_pmem) {
+		for (i = 0, total = 0; i < req->entries; i++) {
+			if (req->pmem.src[i].len > U32_MAX - total) {
+				pr_err("%s: Integer overflow on total req src pmem length\n",
+					__func__);
+				goto error;
+			}
+			total += req->pmem.src[i].len;
+		}
+		if (total != req->data_len) {
+			pr_err("%s: Total src(%d) pmem size != data_len (%d)\n",
+				__func__, total, req->data_len);
+			goto error;
+		}
+		return 0;
+	}
+
 	/* Check for sum of all dst length is equal to data_len  */
 	for (i = 0, total = 0; i < req->entries; i++) {
 		if (!req->vbuf.dst[i].vaddr && req->vbuf.dst[i].len) {
@@ -1670,6 +1924,7 @@ static inline long qcedev_ioctl(struct file *file,
 	struct qcedev_control *podev;
 	struct qcedev_async_req *qcedev_areq;
 	struct qcedev_stat *pstat;
+	ktime_t start;
 
 	qcedev_areq = kzalloc(sizeof(struct qcedev_async_req), GFP_KERNEL);
 	if (!qcedev_areq)
@@ -1711,9 +1966,22 @@ static inline long qcedev_ioctl(struct file *file,
 			goto exit_free_qcedev_areq;
 		}
 
-		err = qcedev_vbuf_ablk_cipher(qcedev_areq, handle);
-		if (err)
-			goto exit_free_qcedev_areq;
+		start = ktime_get();
+		if (qcedev_areq->cipher_op_req.use_pmem) {
+			err = qcedev_reg_ablk_cipher(qcedev_areq, handle);
+			if (err)
+				goto exit_free_qcedev_areq;
+			qcedev_update_xfer_stat(
+				&pstat->cipher_xfer[QCEDEV_XFER_REG_BUF],
+				qcedev_areq->cipher_op_req.data_len, start);
+		} else {
+			err = qcedev_vbuf_ablk_cipher(qcedev_areq, handle);
+			if (err)
+				goto exit_free_qcedev_areq;
+			qcedev_update_xfer_stat(
+				&pstat->cipher_xfer[QCEDEV_XFER_VBUF],
+				qcedev_areq->cipher_op_req.data_len, start);
+		}
 		if (copy_to_user((void __user *)arg,
 					&qcedev_areq->cipher_op_req,
 					sizeof(struct qcedev_cipher_op_req))) {
@@ -1789,11 +2057,15 @@ static inline long qcedev_ioctl(struct file *file,
 				err = -EINVAL;
 				goto exit_free_qcedev_areq;
 			}
+			start = ktime_get();
 			err = qcedev_hash_update(qcedev_areq, handle, &sg_src);
 			if (err) {
 				mutex_unlock(&hash_access_lock);
 				goto exit_free_qcedev_areq;
 			}
+			qcedev_update_xfer_stat(
+				&pstat->sha_xfer[QCEDEV_XFER_VBUF],
+				qcedev_areq->sha_op_req.data_len, start);
 		}
 
 		if (handle->sha_ctxt.diglen > QCEDEV_MAX_SHA_DIGEST) {
@@ -1815,6 +2087,56 @@ static inline long qcedev_ioctl(struct file *file,
 		}
 		break;
 
+	case QCEDEV_IOCTL_SHA_UPDATE_REG_REQ:
+		{
+		struct qcedev_sha_reg_op_req reg_req;
+
+		if (copy_from_user(&reg_req, (void __user *)arg,
+					sizeof(struct qcedev_sha_reg_op_req))) {
+			err = -EFAULT;
+			goto exit_free_qcedev_areq;
+		}
+		memcpy(&qcedev_areq->sha_op_req, &reg_req.req,
+					sizeof(struct qcedev_sha_op_req));
+		mutex_lock(&hash_access_lock);
+		if (qcedev_check_sha_params(&qcedev_areq->sha_op_req, podev) ||
+			(qcedev_areq->sha_op_req.alg == QCEDEV_ALG_AES_CMAC)) {
+			mutex_unlock(&hash_access_lock);
+			err = -EINVAL;
+			goto exit_free_qcedev_areq;
+		}
+		qcedev_areq->op_type = QCEDEV_CRYPTO_OPER_SHA;
+
+		start = ktime_get();
+		err = qcedev_reg_sha_update(qcedev_areq, handle, reg_req.fd);
+		if (err) {
+			mutex_unlock(&hash_access_lock);
+			goto exit_free_qcedev_areq;
+		}
+		qcedev_update_xfer_stat(&pstat->sha_xfer[QCEDEV_XFER_REG_BUF],
+				qcedev_areq->sha_op_req.data_len, start);
+
+		if (handle->sha_ctxt.diglen > QCEDEV_MAX_SHA_DIGEST) {
+			pr_err("Invalid sha_ctxt.diglen %d\n",
+					handle->sha_ctxt.diglen);
+			mutex_unlock(&hash_access_lock);
+			err = -EINVAL;
+			goto exit_free_qcedev_areq;
+		}
+		memcpy(&qcedev_areq->sha_op_req.digest[0],
+				&handle->sha_ctxt.digest[0],
+				handle->sha_ctxt.diglen);
+		mutex_unlock(&hash_access_lock);
+		memcpy(&reg_req.req, &qcedev_areq->sha_op_req,
+					sizeof(struct qcedev_sha_op_req));
+		if (copy_to_user((void __user *)arg, &reg_req,
+					sizeof(struct qcedev_sha_reg_op_req))) {
+			err = -EFAULT;
+			goto exit_free_qcedev_areq;
+		}
+		}
+		break;
+
 	case QCEDEV_IOCTL_SHA_FINAL_REQ:
 
 		if (handle->sha_ctxt.init_done == false) {
@@ -2195,10 +2517,19 @@ static struct platform_driver qcedev_plat_driver = {
 	},
 };
 
+/* Bytes per microsecond is (decimal) megabytes per second */
+static u64 qcedev_xfer_mbps(struct qcedev_xfer_stat *xfer)
+{
+	if (!xfer->ns)
+		return 0;
+	return div64_u64(xfer->bytes * NSEC_PER_USEC, xfer->ns);
+}
+
 static int _disp_stats(int id)
 {
 	struct qcedev_stat *pstat;
 	int len = 0;
+	int i;
 
 	pstat = &_qcedev_stat;
 	len = scnprintf(_debug_read_buf, DEBUG_MAX_RW_BUF - 1,
@@ -2219,6 +2550,19 @@ static int _disp_stats(int id)
 			"   Encryption operation fail          : %d\n",
 					pstat->qcedev_dec_fail);
 
+	for (i = 0; i < QCEDEV_XFER_LAST; i++) {
+		len += scnprintf(_debug_read_buf + len,
+			DEBUG_MAX_RW_BUF - len - 1,
+			"   Cipher %-10s throughput       : %llu MB/s\n",
+			qcedev_xfer_mode_names[i],
+			qcedev_xfer_mbps(&pstat->cipher_xfer[i]));
+		len += scnprintf(_debug_read_buf + len,
+			DEBUG_MAX_RW_BUF - len - 1,
+			"   Hash %-10s throughput         : %llu MB/s\n",
+			qcedev_xfer_mode_names[i],
+			qcedev_xfer_mbps(&pstat->sha_xfer[i]));
+	}
+
 	return len;
 }
 
@@ -544,3 +544,94 @@ int qcedev_check_and_unmap_buffer(void *handle, int fd)
 
 	return 0;
 }
+
+/*
+ * Look up a buffer registered with QCEDEV_IOCTL_MAP_BUF_REQ and take a
+ * reference on it for the duration of a request, so that an unmap racing
+ * with the request does not tear down the mapping underneath it.
+ */
+struct qcedev_reg_buf_info *qcedev_get_reg_buffer(void *handle, int fd)
+{
+	struct qcedev_reg_buf_info *binfo = NULL, *found = NULL;
+	struct qcedev_handle *qce_hndl = handle;
+	struct dma_buf *buf;
+
+	if (!handle || fd < 0) {
+		pr_err("%s: err: invalid input arguments\n", __func__);
+		return NULL;
+	}
+
+	buf = dma_buf_get(fd);
+	if (IS_ERR_OR_NULL(buf))
+		return NULL;
+
+	mutex_lock(&qce_hndl->registeredbufs.lock);
+	list_for_each_entry(binfo, &qce_hndl->registeredbufs.list, list) {
+		if (binfo->ion_buf.mapping_info.buf == buf) {
+			atomic_inc(&binfo->ref_count);
+			found = binfo;
+			break;
+		}
+	}
+	mutex_unlock(&qce_hndl->registeredbufs.lock);
+
+	dma_buf_put(buf);
+	return found;
+}
+
+void qcedev_put_reg_buffer(void *handle, struct qcedev_reg_buf_info *binfo)
+{
+	struct qcedev_handle *qce_hndl = handle;
+
+	mutex_lock(&qce_hndl->registeredbufs.lock);
+	if (atomic_dec_and_test(&binfo->ref_count)) {
+		qcedev_unmap_buffer(qce_hndl, qce_hndl->cntl->mem_client,
+				binfo);
+		list_del(&binfo->list);
+		kfree(binfo);
+	}
+	mutex_unlock(&qce_hndl->registeredbufs.lock);
+}
+
+/*
+ * Describe len bytes at offset into a registered buffer with the pages
+ * backing its attachment, so the crypto engine works on the buffer in
+ * place. Returns the number of entries filled in sg.
+ */
+int qcedev_reg_buffer_sg(struct qcedev_reg_buf_info *binfo,
+		unsigned int offset, unsigned int len,
+		struct scatterlist *sg, int nents)
+{
+	struct dma_mapping_info *mapping_info = &binfo->ion_buf.mapping_info;
+	struct scatterlist *src;
+	unsigned int seg, off;
+	int i, n = 0;
+
+	if (offset > mapping_info->buf->size ||
+			len > mapping_info->buf->size - offset) {
+		pr_err("%s: err: range %u@%u exceeds buffer size %zu\n",
+			__func__, len, offset, mapping_info->buf->size);
+		return -ERANGE;
+	}
+
+	for_each_sg(mapping_info->table->sgl, src,
+			mapping_info->table->orig_nents, i) {
+		if (!len)
+			break;
+		if (offset >= src->length) {
+			offset -= src->length;
+			continue;
+		}
+		if (n == nents)
+			return -E2BIG;
+
+		seg = min(src->length - offset, len);
+		off = src->offset + offset;
+		sg_set_page(&sg[n++], nth_page(sg_page(src), off >> PAGE_SHIFT),
+				seg, off & ~PAGE_MASK);
+		offset = 0;
+		len -= seg;
+	}
+
+	return len ? -ERANGE : n;
+}
@@ -23,6 +23,7 @@
 #include <linux/msm_ion.h>
 #include <linux/of.h>
 #include <linux/of_platform.h>
+#include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/types.h>
 
@@ -81,6 +82,11 @@ int qcedev_check_and_map_buffer(void *qce_hndl,
 		int fd, unsigned int offset, unsigned int fd_size,
 		unsigned long long *vaddr);
 int qcedev_check_and_unmap_buffer(void *handle, int fd);
+struct qcedev_reg_buf_info *qcedev_get_reg_buffer(void *handle, int fd);
+void qcedev_put_reg_buffer(void *handle, struct qcedev_reg_buf_info *binfo);
+int qcedev_reg_buffer_sg(struct qcedev_reg_buf_info *binfo,
+		unsigned int offset, unsigned int len,
+		struct scatterlist *sg, int nents);
 
 extern struct qcedev_reg_buf_info *global_binfo_in;
 extern struct qcedev_reg_buf_info *global_binfo_out;
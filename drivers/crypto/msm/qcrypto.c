@@ -31,6 +31,9 @@
 #include <linux/sched.h>
 #include <linux/init.h>
 #include <linux/cache.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/random.h>
 #include <linux/platform_data/qcom_crypto_device.h>
 #include <linux/msm-bus.h>
 #include <linux/hardirq.h>
@@ -111,6 +114,8 @@ struct crypto_stat {
 	u64 aead_bad_msg;
 	u64 ablk_cipher_aes_enc;
 	u64 ablk_cipher_aes_dec;
+	u64 ablk_cipher_aes_sw_enc;
+	u64 ablk_cipher_aes_sw_dec;
 	u64 ablk_cipher_des_enc;
 	u64 ablk_cipher_des_dec;
 	u64 ablk_cipher_3des_enc;
@@ -125,6 +130,16 @@ struct crypto_stat {
 	u64 ahash_op_fail;
 };
 static struct crypto_stat _qcrypto_stat;
+
+static unsigned int sw_crossover;
+module_param(sw_crossover, uint, 0644);
+MODULE_PARM_DESC(sw_crossover,
+	"AES ecb/cbc/ctr requests shorter than this run on the CPU");
+
+static unsigned int sw_busy_crossover;
+module_param(sw_busy_crossover, uint, 0644);
+MODULE_PARM_DESC(sw_busy_crossover,
+	"Same as sw_crossover, while requests wait for an engine");
 static struct dentry *_debug_dent;
 static char _debug_read_buf[DEBUG_MAX_RW_BUF];
 static bool _qcrypto_init_assign;
@@ -420,7 +435,12 @@ struct qcrypto_cipher_ctx {
 
 	u8 ccm4309_nonce[QCRYPTO_CCM4309_NONCE_LEN];
 
+	/*
+	 * Software cipher for AES-192 on engines without it, and for the
+	 * requests that sw_crossover sends to the CPU.
+	 */
 	struct crypto_skcipher *cipher_aes192_fb;
+	bool sw_dispatch;		/* fallback holds the key */
 
 	struct crypto_ahash *ahash_aead_aes192_fb;
 };
@@ -1167,6 +1187,12 @@ static int _disp_stats(int id)
 	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
 			"   ABLK CIPHER AES decryption          : %llu\n",
 					pstat->ablk_cipher_aes_dec);
+	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
+			"   ABLK CIPHER AES CPU encryption      : %llu\n",
+					pstat->ablk_cipher_aes_sw_enc);
+	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
+			"   ABLK CIPHER AES CPU decryption      : %llu\n",
+					pstat->ablk_cipher_aes_sw_dec);
 
 	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
 			"   ABLK CIPHER DES encryption          : %llu\n",
@@ -1458,6 +1484,7 @@ static int _qcrypto_setkey_aes(struct crypto_ablkcipher *cipher, const u8 *key,
 		return -EINVAL;
 
 	ctx->enc_key_len = len;
+	ctx->sw_dispatch = false;
 	if (!(ctx->flags & QCRYPTO_CTX_USE_PIPE_KEY))  {
 		if (key != NULL) {
 			memcpy(ctx->enc_key, key, len);
@@ -1465,6 +1492,9 @@ static int _qcrypto_setkey_aes(struct crypto_ablkcipher *cipher, const u8 *key,
 			pr_err("%s Inavlid key pointer\n", __func__);
 			return -EINVAL;
 		}
+		if (ctx->cipher_aes192_fb)
+			ctx->sw_dispatch = !crypto_skcipher_setkey(
+					ctx->cipher_aes192_fb, key, len);
 	}
 	return 0;
 };
@@ -2481,7 +2511,33 @@ static int _qcrypto_queue_req(struct crypto_priv *cp,
 	return ret;
 }
 
-static int _qcrypto_enc_aes_192_fallback(struct ablkcipher_request *req)
+/*
+ * Short requests finish sooner on the CPU cipher behind cipher_aes192_fb,
+ * which the crypto API resolves to the ARMv8 CE instructions where present,
+ * than through BAM setup and a completion interrupt. Requests shorter than
+ * sw_crossover go there, as do those shorter than sw_busy_crossover while
+ * others wait for an engine.
+ */
+static bool _qcrypto_aes_use_sw(struct qcrypto_cipher_ctx *ctx,
+		unsigned int nbytes)
+{
+	unsigned int limit = READ_ONCE(sw_crossover);
+
+	if (!ctx->sw_dispatch || (ctx->flags &
+			(QCRYPTO_CTX_USE_HW_KEY | QCRYPTO_CTX_USE_PIPE_KEY)))
+		return false;
+	if (READ_ONCE(ctx->cp->req_queue.qlen))
+		limit = max(limit, READ_ONCE(sw_busy_crossover));
+	if (nbytes >= limit)
+		return false;
+	/* do not overtake requests of this tfm still on an engine */
+	if (!list_empty(&ctx->rsp_queue))
+		return false;
+	/* the CPU path runs in the caller, leave a contended CPU alone */
+	return !need_resched();
+}
+
+static int _qcrypto_enc_aes_fallback(struct ablkcipher_request *req)
 {
 	struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(req->base.tfm);
 	int err;
@@ -2497,7 +2553,7 @@ static int _qcrypto_enc_aes_192_fallback(struct ablkcipher_request *req)
 	return err;
 }
 
-static int _qcrypto_dec_aes_192_fallback(struct ablkcipher_request *req)
+static int _qcrypto_dec_aes_fallback(struct ablkcipher_request *req)
 {
 	struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(req->base.tfm);
 	int err;
@@ -2532,7 +2588,12 @@ static int _qcrypto_enc_aes_ecb(struct ablkcipher_request *req)
 	if ((ctx->enc_key_len == AES_KEYSIZE_192) &&
 			(!cp->ce_support.aes_key_192) &&
 				ctx->cipher_aes192_fb)
-		return _qcrypto_enc_aes_192_fallback(req);
+		return _qcrypto_enc_aes_fallback(req);
+
+	if (_qcrypto_aes_use_sw(ctx, req->nbytes)) {
+		pstat->ablk_cipher_aes_sw_enc++;
+		return _qcrypto_enc_aes_fallback(req);
+	}
 
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
@@ -2562,7 +2623,12 @@ static int _qcrypto_enc_aes_cbc(struct ablkcipher_request *req)
 	if ((ctx->enc_key_len == AES_KEYSIZE_192) &&
 			(!cp->ce_support.aes_key_192) &&
 				ctx->cipher_aes192_fb)
-		return _qcrypto_enc_aes_192_fallback(req);
+		return _qcrypto_enc_aes_fallback(req);
+
+	if (_qcrypto_aes_use_sw(ctx, req->nbytes)) {
+		pstat->ablk_cipher_aes_sw_enc++;
+		return _qcrypto_enc_aes_fallback(req);
+	}
 
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
@@ -2592,7 +2658,12 @@ static int _qcrypto_enc_aes_ctr(struct ablkcipher_request *req)
 	if ((ctx->enc_key_len == AES_KEYSIZE_192) &&
 			(!cp->ce_support.aes_key_192) &&
 				ctx->cipher_aes192_fb)
-		return _qcrypto_enc_aes_192_fallback(req);
+		return _qcrypto_enc_aes_fallback(req);
+
+	if (_qcrypto_aes_use_sw(ctx, req->nbytes)) {
+		pstat->ablk_cipher_aes_sw_enc++;
+		return _qcrypto_enc_aes_fallback(req);
+	}
 
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
@@ -2780,7 +2851,12 @@ static int _qcrypto_dec_aes_ecb(struct ablkcipher_request *req)
 	if ((ctx->enc_key_len == AES_KEYSIZE_192) &&
 			(!cp->ce_support.aes_key_192) &&
 				ctx->cipher_aes192_fb)
-		return _qcrypto_dec_aes_192_fallback(req);
+		return _qcrypto_dec_aes_fallback(req);
+
+	if (_qcrypto_aes_use_sw(ctx, req->nbytes)) {
+		pstat->ablk_cipher_aes_sw_dec++;
+		return _qcrypto_dec_aes_fallback(req);
+	}
 
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
@@ -2810,7 +2886,12 @@ static int _qcrypto_dec_aes_cbc(struct ablkcipher_request *req)
 	if ((ctx->enc_key_len == AES_KEYSIZE_192) &&
 			(!cp->ce_support.aes_key_192) &&
 				ctx->cipher_aes192_fb)
-		return _qcrypto_dec_aes_192_fallback(req);
+		return _qcrypto_dec_aes_fallback(req);
+
+	if (_qcrypto_aes_use_sw(ctx, req->nbytes)) {
+		pstat->ablk_cipher_aes_sw_dec++;
+		return _qcrypto_dec_aes_fallback(req);
+	}
 
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
@@ -2840,7 +2921,12 @@ static int _qcrypto_dec_aes_ctr(struct ablkcipher_request *req)
 	if ((ctx->enc_key_len == AES_KEYSIZE_192) &&
 			(!cp->ce_support.aes_key_192) &&
 				ctx->cipher_aes192_fb)
-		return _qcrypto_dec_aes_192_fallback(req);
+		return _qcrypto_dec_aes_fallback(req);
+
+	if (_qcrypto_aes_use_sw(ctx, req->nbytes)) {
+		pstat->ablk_cipher_aes_sw_dec++;
+		return _qcrypto_dec_aes_fallback(req);
+	}
 
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
@@ -5522,6 +5608,149 @@ static const struct file_operations _debug_stats_ops = {
 	.write =        _debug_stats_write,
 };
 
+#ifdef DEBUG
+/*
+ * Throughput of cbc(aes) through the engines, tcrypt style. Writing N to
+ * debugfs qcrypto/bench keeps batches of N requests in flight, which is
+ * what lets qce50 complete them with one interrupt per bunch.
+ */
+#define QCRYPTO_BENCH_BYTES		(4 << 20)
+#define QCRYPTO_BENCH_MAX_INFLIGHT	16
+
+static const unsigned int _qcrypto_bench_lens[] = {
+	512, 1024, 4096, 16384, 65536
+};
+
+struct qcrypto_bench {
+	struct completion done;
+	atomic_t pending;
+	int err;
+};
+
+static void _qcrypto_bench_complete(struct crypto_async_request *req,
+		int err)
+{
+	struct qcrypto_bench *bench = req->data;
+
+	if (err == -EINPROGRESS)
+		return;
+	if (err)
+		bench->err = err;
+	if (atomic_dec_and_test(&bench->pending))
+		complete(&bench->done);
+}
+
+static int _qcrypto_bench_run(struct ablkcipher_request **reqs,
+		u8 **bufs, unsigned int inflight, unsigned int len, u64 *ns,
+		u64 *bytes)
+{
+	struct scatterlist sg[QCRYPTO_BENCH_MAX_INFLIGHT];
+	u8 iv[QCRYPTO_BENCH_MAX_INFLIGHT][AES_BLOCK_SIZE];
+	struct qcrypto_bench bench;
+	unsigned int done, i;
+	u64 start;
+	int rc;
+
+	get_random_bytes(iv, sizeof(iv));
+	start = ktime_get_ns();
+	for (done = 0; done < QCRYPTO_BENCH_BYTES; done += len * inflight) {
+		init_completion(&bench.done);
+		/* one extra count so the batch cannot finish while queueing */
+		atomic_set(&bench.pending, inflight + 1);
+		bench.err = 0;
+		for (i = 0; i < inflight; i++) {
+			sg_init_one(&sg[i], bufs[i], len);
+			ablkcipher_request_set_callback(reqs[i],
+					CRYPTO_TFM_REQ_MAY_BACKLOG,
+					_qcrypto_bench_complete, &bench);
+			ablkcipher_request_set_crypt(reqs[i], &sg[i], &sg[i],
+					len, iv[i]);
+			rc = crypto_ablkcipher_encrypt(reqs[i]);
+			if (rc != -EINPROGRESS && rc != -EBUSY)
+				_qcrypto_bench_complete(&reqs[i]->base, rc);
+		}
+		if (!atomic_dec_and_test(&bench.pending))
+			wait_for_completion(&bench.done);
+		if (bench.err)
+			return bench.err;
+	}
+	*ns = ktime_get_ns() - start;
+	*bytes = done;
+	return 0;
+}
+
+static int _qcrypto_bench(unsigned int inflight)
+{
+	struct ablkcipher_request *reqs[QCRYPTO_BENCH_MAX_INFLIGHT] = {NULL};
+	u8 *bufs[QCRYPTO_BENCH_MAX_INFLIGHT] = {NULL};
+	struct crypto_ablkcipher *tfm;
+	u8 key[AES_KEYSIZE_128];
+	unsigned int i;
+	u64 ns, bytes;
+	int rc;
+
+	tfm = crypto_alloc_ablkcipher("qcrypto-cbc-aes", 0, 0);
+	if (IS_ERR(tfm))
+		return PTR_ERR(tfm);
+	get_random_bytes(key, sizeof(key));
+	rc = crypto_ablkcipher_setkey(tfm, key, sizeof(key));
+	if (rc)
+		goto out;
+
+	for (i = 0; i < inflight; i++) {
+		reqs[i] = ablkcipher_request_alloc(tfm, GFP_KERNEL);
+		bufs[i] = kzalloc(_qcrypto_bench_lens[
+				ARRAY_SIZE(_qcrypto_bench_lens) - 1],
+				GFP_KERNEL);
+		if (!reqs[i] || !bufs[i]) {
+			rc = -ENOMEM;
+			goto out;
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(_qcrypto_bench_lens); i++) {
+		rc = _qcrypto_bench_run(reqs, bufs, inflight,
+				_qcrypto_bench_lens[i], &ns, &bytes);
+		if (rc) {
+			pr_err("qcrypto bench %u bytes failed %d\n",
+					_qcrypto_bench_lens[i], rc);
+			goto out;
+		}
+		pr_info("qcrypto bench cbc(aes) %u bytes x%u: %llu MB/s\n",
+				_qcrypto_bench_lens[i], inflight,
+				div64_u64(bytes * 1000, max_t(u64, ns, 1)));
+	}
+out:
+	for (i = 0; i < inflight; i++) {
+		kfree(bufs[i]);
+		ablkcipher_request_free(reqs[i]);
+	}
+	memzero_explicit(key, sizeof(key));
+	crypto_free_ablkcipher(tfm);
+	return rc;
+}
+
+static ssize_t _debug_bench_write(struct file *file, const char __user *buf,
+			size_t count, loff_t *ppos)
+{
+	unsigned int inflight;
+	int rc;
+
+	rc = kstrtouint_from_user(buf, count, 0, &inflight);
+	if (rc)
+		return rc;
+	if (!inflight || inflight > QCRYPTO_BENCH_MAX_INFLIGHT)
+		return -EINVAL;
+	rc = _qcrypto_bench(inflight);
+	return rc ? rc : count;
+}
+
+static const struct file_operations _debug_bench_ops = {
+	.open =         simple_open,
+	.write =        _debug_bench_write,
+};
+#endif
+
 static int _qcrypto_debug_init(void)
 {
 	int rc;
@@ -5545,6 +5774,15 @@ static int _qcrypto_debug_init(void)
 		rc = PTR_ERR(dent);
 		goto err;
 	}
+#ifdef DEBUG
+	dent = debugfs_create_file("bench", 0200, _debug_dent, NULL,
+				&_debug_bench_ops);
+	if (dent == NULL) {
+		pr_err("qcrypto debugfs_create_file bench fail\n");
+		rc = -ENOMEM;
+		goto err;
+	}
+#endif
 	return 0;
 err:
 	debugfs_remove_recursive(_debug_dent);
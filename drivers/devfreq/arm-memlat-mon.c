@@ -28,6 +28,8 @@
 #include <linux/irq.h>
 #include <linux/cpu_pm.h>
 #include <linux/cpu.h>
+#include <linux/seqlock.h>
+#include <linux/timer.h>
 #include "governor.h"
 #include "governor_memlat.h"
 #include <linux/perf_event.h>
@@ -46,12 +48,31 @@ enum ev_index {
 
 struct event_data {
 	struct perf_event *pevent;
-	unsigned long prev_count;
+	u64 prev_count;
+};
+
+/*
+ * Counter values a CPU records for itself, on idle entry and from a
+ * deferrable timer while it is busy, so that sampling never has to IPI
+ * another CPU to read its counters. Only written by the owning CPU with
+ * interrupts disabled.
+ */
+struct cpu_snapshot {
+	seqcount_t seq;
+	u64 count[NUM_EVENTS];
+	ktime_t ts;
+	unsigned long gen;
+	bool idle;
 };
 
 struct cpu_pmu_stats {
 	struct event_data events[NUM_EVENTS];
 	ktime_t prev_ts;
+	struct cpu_snapshot snap;
+	unsigned long prev_gen;
+	struct timer_list timer;
+	struct cpu_grp_info *cpu_grp;
+	int cpu;
 };
 
 struct cpu_grp_info {
@@ -61,7 +82,12 @@ struct cpu_grp_info {
 	struct cpu_pmu_stats *cpustats;
 	struct memlat_hwmon hw;
 	struct notifier_block arm_memlat_cpu_notif;
+	struct notifier_block arm_memlat_idle_notif;
 	struct list_head mon_list;
+	bool running;
+	unsigned long ipis_avoided;
+	u64 sample_ns;
+	unsigned long nr_samples;
 };
 
 struct memlat_mon_spec {
@@ -77,14 +103,15 @@ struct memlat_mon_spec {
 static LIST_HEAD(memlat_mon_list);
 static DEFINE_MUTEX(list_lock);
 
+/* Default snapshot period until a governor with a polling interval attaches */
+#define DEFAULT_SNAP_MS	10
+
 static unsigned long compute_freq(struct cpu_pmu_stats *cpustats,
-						unsigned long cyc_cnt)
+					unsigned long cyc_cnt, ktime_t ts)
 {
-	ktime_t ts;
 	unsigned int diff;
 	uint64_t freq = 0;
 
-	ts = ktime_get();
 	diff = ktime_to_us(ktime_sub(ts, cpustats->prev_ts));
 	if (!diff)
 		diff = 1;
@@ -96,32 +123,150 @@ static unsigned long compute_freq(struct cpu_pmu_stats *cpustats,
 }
 
 #define MAX_COUNT_LIM 0xFFFFFFFFFFFFFFFF
-static inline unsigned long read_event(struct event_data *event)
+static inline unsigned long read_event(struct event_data *event, u64 total)
 {
 	unsigned long ev_count;
-	u64 total, enabled, running;
 
 	if (!event->pevent)
 		return 0;
 
-	total = perf_event_read_value(event->pevent, &enabled, &running);
 	ev_count = total - event->prev_count;
 	event->prev_count = total;
 	return ev_count;
 }
 
+/* Must run on the CPU that owns cpustats */
+static void take_snapshot(struct cpu_pmu_stats *cpustats, bool idle)
+{
+	struct cpu_snapshot *snap = &cpustats->snap;
+	unsigned long flags;
+	int i;
+
+	local_irq_save(flags);
+	write_seqcount_begin(&snap->seq);
+	for (i = 0; i < NUM_EVENTS; i++) {
+		if (cpustats->events[i].pevent)
+			snap->count[i] =
+				perf_event_read_local(cpustats->events[i].pevent);
+	}
+	snap->ts = ktime_get();
+	snap->gen++;
+	snap->idle = idle;
+	write_seqcount_end(&snap->seq);
+	local_irq_restore(flags);
+}
+
+static unsigned long snap_interval(struct cpu_grp_info *cpu_grp)
+{
+	struct devfreq *df = READ_ONCE(cpu_grp->hw.df);
+
+	if (df && df->profile->polling_ms)
+		return msecs_to_jiffies(df->profile->polling_ms);
+	return msecs_to_jiffies(DEFAULT_SNAP_MS);
+}
+
+/*
+ * Deferrable, so it only fires while the CPU is busy anyway. A timer that
+ * was migrated off a CPU going offline is re-armed on the next idle exit
+ * of its owner.
+ */
+static void snapshot_timer_fn(unsigned long data)
+{
+	struct cpu_pmu_stats *cpustats = (struct cpu_pmu_stats *)data;
+	struct cpu_grp_info *cpu_grp = cpustats->cpu_grp;
+
+	if (!READ_ONCE(cpu_grp->running) ||
+	    cpustats->cpu != smp_processor_id())
+		return;
+
+	take_snapshot(cpustats, false);
+	mod_timer(&cpustats->timer, jiffies + snap_interval(cpu_grp));
+}
+
+static int arm_memlat_idle_callback(struct notifier_block *nb,
+		unsigned long action, void *data)
+{
+	struct cpu_grp_info *cpu_grp = container_of(nb, struct cpu_grp_info,
+						    arm_memlat_idle_notif);
+	int cpu = smp_processor_id();
+	struct cpu_pmu_stats *cpustats;
+
+	if (!READ_ONCE(cpu_grp->running) ||
+	    !cpumask_test_cpu(cpu, &cpu_grp->inited_cpus))
+		return NOTIFY_OK;
+
+	cpustats = to_cpustats(cpu_grp, cpu);
+	switch (action) {
+	case IDLE_START:
+		/* Idle cycles are excluded, this stays exact until idle exit */
+		take_snapshot(cpustats, true);
+		break;
+	case IDLE_END:
+		if (!timer_pending(&cpustats->timer))
+			mod_timer(&cpustats->timer,
+				  jiffies + snap_interval(cpu_grp));
+		break;
+	}
+
+	return NOTIFY_OK;
+}
+
 static void read_perf_counters(int cpu, struct cpu_grp_info *cpu_grp)
 {
 	struct cpu_pmu_stats *cpustats = to_cpustats(cpu_grp, cpu);
 	struct dev_stats *devstats = to_devstats(cpu_grp, cpu);
+	struct cpu_snapshot *snap = &cpustats->snap;
 	unsigned long cyc_cnt, stall_cnt;
+	u64 count[NUM_EVENTS];
+	unsigned long gen;
+	unsigned int seq;
+	ktime_t ts;
+	bool idle;
+	int i;
 
-	devstats->inst_count = read_event(&cpustats->events[INST_IDX]);
-	devstats->mem_count = read_event(&cpustats->events[CM_IDX]);
-	cyc_cnt = read_event(&cpustats->events[CYC_IDX]);
-	devstats->freq = compute_freq(cpustats, cyc_cnt);
+	if (cpu == smp_processor_id())
+		take_snapshot(cpustats, false);
+
+	do {
+		seq = read_seqcount_begin(&snap->seq);
+		for (i = 0; i < NUM_EVENTS; i++)
+			count[i] = snap->count[i];
+		ts = snap->ts;
+		gen = snap->gen;
+		idle = snap->idle;
+	} while (read_seqcount_retry(&snap->seq, seq));
+
+	/* perf only skips the IPI for CPUs that are idle */
+	if (cpu != smp_processor_id() && !idle) {
+		for (i = 0; i < NUM_EVENTS; i++)
+			if (cpustats->events[i].pevent)
+				cpu_grp->ipis_avoided++;
+	}
+
+	if (gen == cpustats->prev_gen) {
+		/*
+		 * Idle for the whole window: skip the CPU. Busy but not
+		 * snapshotted yet: keep the previous sample.
+		 */
+		if (idle) {
+			devstats->inst_count = 0;
+			devstats->mem_count = 0;
+			devstats->freq = 0;
+			devstats->stall_pct = 0;
+		}
+		return;
+	}
+	cpustats->prev_gen = gen;
+
+	devstats->inst_count = read_event(&cpustats->events[INST_IDX],
+					  count[INST_IDX]);
+	devstats->mem_count = read_event(&cpustats->events[CM_IDX],
+					 count[CM_IDX]);
+	cyc_cnt = read_event(&cpustats->events[CYC_IDX], count[CYC_IDX]);
+	devstats->freq = compute_freq(cpustats, cyc_cnt, ts);
 	if (cpustats->events[STALL_CYC_IDX].pevent) {
-		stall_cnt = read_event(&cpustats->events[STALL_CYC_IDX]);
+		stall_cnt = read_event(&cpustats->events[STALL_CYC_IDX],
+				       count[STALL_CYC_IDX]);
 		stall_cnt = min(stall_cnt, cyc_cnt);
 		devstats->stall_pct = mult_frac(100, stall_cnt, cyc_cnt);
 	} else {
@@ -133,9 +278,15 @@ static unsigned long get_cnt(struct memlat_hwmon *hw)
 {
 	int cpu;
 	struct cpu_grp_info *cpu_grp = to_cpu_grp(hw);
+	ktime_t start = ktime_get();
 
+	preempt_disable();
 	for_each_cpu(cpu, &cpu_grp->inited_cpus)
 		read_perf_counters(cpu, cpu_grp);
+	preempt_enable();
+
+	cpu_grp->sample_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+	cpu_grp->nr_samples++;
 
 	return 0;
 }
@@ -158,6 +309,16 @@ static void stop_hwmon(struct memlat_hwmon *hw)
 	int cpu;
 	struct cpu_grp_info *cpu_grp = to_cpu_grp(hw);
 	struct dev_stats *devstats;
+	struct cpu_pmu_stats *cpustats;
+
+	/* No snapshot is taken once the notifier is gone and timers stop */
+	WRITE_ONCE(cpu_grp->running, false);
+	idle_notifier_unregister(&cpu_grp->arm_memlat_idle_notif);
+	for_each_cpu(cpu, &cpu_grp->cpus) {
+		cpustats = to_cpustats(cpu_grp, cpu);
+		del_timer_sync(&cpustats->timer);
+		cpustats->prev_gen = cpustats->snap.gen;
+	}
 
 	get_online_cpus();
 	for_each_cpu(cpu, &cpu_grp->inited_cpus) {
@@ -286,11 +447,60 @@ static int start_hwmon(struct memlat_hwmon *hw)
 		list_add_tail(&cpu_grp->mon_list, &memlat_mon_list);
 	mutex_unlock(&list_lock);
 
+	/*
+	 * CPUs that are online now start snapshotting here, CPUs that come
+	 * online later arm their timer on their first idle exit.
+	 */
+	if (!ret) {
+		WRITE_ONCE(cpu_grp->running, true);
+		for_each_cpu_and(cpu, &cpu_grp->inited_cpus, cpu_online_mask) {
+			struct cpu_pmu_stats *cpustats =
+				to_cpustats(cpu_grp, cpu);
+
+			cpustats->timer.expires = jiffies +
+				snap_interval(cpu_grp);
+			add_timer_on(&cpustats->timer, cpu);
+		}
+		idle_notifier_register(&cpu_grp->arm_memlat_idle_notif);
+	}
+
 	put_online_cpus();
 
 	return ret;
 }
 
+static ssize_t show_ipis_avoided(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct cpu_grp_info *cpu_grp = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%lu\n", cpu_grp->ipis_avoided);
+}
+static DEVICE_ATTR(ipis_avoided, 0444, show_ipis_avoided, NULL);
+
+static ssize_t show_sample_cost_ns(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct cpu_grp_info *cpu_grp = dev_get_drvdata(dev);
+	u64 cost = 0;
+
+	if (cpu_grp->nr_samples)
+		cost = div_u64(cpu_grp->sample_ns, cpu_grp->nr_samples);
+
+	return snprintf(buf, PAGE_SIZE, "%llu\n", cost);
+}
+static DEVICE_ATTR(sample_cost_ns, 0444, show_sample_cost_ns, NULL);
+
+static struct attribute *memlat_mon_attrs[] = {
+	&dev_attr_ipis_avoided.attr,
+	&dev_attr_sample_cost_ns.attr,
+	NULL,
+};
+
+static struct attribute_group memlat_mon_attr_group = {
+	.attrs = memlat_mon_attrs,
+};
+
 static int get_mask_from_dev_handle(struct platform_device *pdev,
 					cpumask_t *mask)
 {
@@ -330,6 +540,7 @@ static int arm_memlat_mon_driver_probe(struct platform_device *pdev)
 	if (!cpu_grp)
 		return -ENOMEM;
 	cpu_grp->arm_memlat_cpu_notif.notifier_call = arm_memlat_cpu_callback;
+	cpu_grp->arm_memlat_idle_notif.notifier_call = arm_memlat_idle_callback;
 	hw = &cpu_grp->hw;
 
 	hw->dev = dev;
@@ -357,8 +568,21 @@ static int arm_memlat_mon_driver_probe(struct platform_device *pdev)
 
 	cpu_grp->event_ids[CYC_IDX] = CYC_EV;
 
-	for_each_cpu(cpu, &cpu_grp->cpus)
+	for_each_cpu(cpu, &cpu_grp->cpus) {
+		struct cpu_pmu_stats *cpustats = to_cpustats(cpu_grp, cpu);
+
 		to_devstats(cpu_grp, cpu)->id = cpu;
+		cpustats->cpu = cpu;
+		cpustats->cpu_grp = cpu_grp;
+		seqcount_init(&cpustats->snap.seq);
+		setup_pinned_deferrable_timer(&cpustats->timer,
+				snapshot_timer_fn, (unsigned long)cpustats);
+	}
+
+	dev_set_drvdata(dev, cpu_grp);
+	ret = sysfs_create_group(&dev->kobj, &memlat_mon_attr_group);
+	if (ret)
+		dev_warn(dev, "Failed to create sysfs stats: %d\n", ret);
 
 	hw->start_hwmon = &start_hwmon;
 	hw->stop_hwmon = &stop_hwmon;
@@ -26,8 +26,11 @@
 #include <linux/printk.h>
 #include <linux/hrtimer.h>
 #include <linux/of.h>
+#include <linux/moduleparam.h>
 #include "governor.h"
 
+#define DEVFREQ_BOOST_DEFAULT_MS	100
+
 static struct class *devfreq_class;
 
 /*
@@ -43,6 +46,23 @@ static LIST_HEAD(devfreq_governor_list);
 static LIST_HEAD(devfreq_list);
 static DEFINE_MUTEX(devfreq_list_lock);
 
+/*
+ * Touch boost: for boost_ms after a touch, each device with a boost_freq is
+ * held at or above it. Kicks closer together than boost_min_interval_ms are
+ * dropped, since the boost they would extend is still running.
+ */
+static unsigned int boost_min_interval_ms = 50;
+module_param(boost_min_interval_ms, uint, 0644);
+static unsigned long devfreq_boost_last;
+static void devfreq_boost_fn(struct work_struct *work);
+static DECLARE_WORK(devfreq_boost_work, devfreq_boost_fn);
+
+static bool devfreq_boost_active(struct devfreq *devfreq)
+{
+	return devfreq->boost_freq &&
+	       time_before(jiffies, devfreq->boost_expiry);
+}
+
 /**
  * find_device_devfreq() - find devfreq struct using device pointer
  * @dev:	device pointer used to lookup device devfreq.
@@ -276,12 +296,17 @@ int update_devfreq(struct devfreq *devfreq)
 	 * List from the highest priority
 	 * max_freq
 	 * min_freq
+	 * boost_freq, while a touch boost is active
 	 */
 
 	if (devfreq->min_freq && freq < devfreq->min_freq) {
 		freq = devfreq->min_freq;
 		flags &= ~DEVFREQ_FLAG_LEAST_UPPER_BOUND; /* Use GLB */
 	}
+	if (devfreq_boost_active(devfreq) && freq < devfreq->boost_freq) {
+		freq = devfreq->boost_freq;
+		flags &= ~DEVFREQ_FLAG_LEAST_UPPER_BOUND; /* Use GLB */
+	}
 	if (devfreq->max_freq && freq > devfreq->max_freq) {
 		freq = devfreq->max_freq;
 		flags |= DEVFREQ_FLAG_LEAST_UPPER_BOUND; /* Use LUB */
@@ -498,6 +523,61 @@ static int devfreq_notifier_call(struct notifier_block *nb, unsigned long type,
 	return ret;
 }
 
+static void devfreq_boost_fn(struct work_struct *work)
+{
+	struct devfreq *devfreq;
+	unsigned long delay;
+
+	mutex_lock(&devfreq_list_lock);
+	list_for_each_entry(devfreq, &devfreq_list, node) {
+		mutex_lock(&devfreq->lock);
+		if (devfreq->boost_freq && devfreq->boost_ms &&
+		    !devfreq->stop_polling) {
+			delay = msecs_to_jiffies(devfreq->boost_ms);
+			devfreq->boost_expiry = jiffies + delay;
+			if (devfreq->previous_freq < devfreq->boost_freq)
+				update_devfreq(devfreq);
+			mod_delayed_work(devfreq_wq, &devfreq->boost_end, delay);
+		}
+		mutex_unlock(&devfreq->lock);
+	}
+	mutex_unlock(&devfreq_list_lock);
+}
+
+static void devfreq_boost_end_fn(struct work_struct *work)
+{
+	struct devfreq *devfreq = container_of(to_delayed_work(work),
+					       struct devfreq, boost_end);
+
+	mutex_lock(&devfreq->lock);
+	if (!devfreq_boost_active(devfreq))
+		update_devfreq(devfreq);
+	mutex_unlock(&devfreq->lock);
+}
+
+/**
+ * devfreq_boost_kick() - Raise the devices with a boost_freq for boost_ms.
+ *
+ * Called by the input boost handler on touch down. May be called from
+ * atomic context; the devices are re-evaluated from devfreq_wq.
+ */
+void devfreq_boost_kick(void)
+{
+	unsigned long now = jiffies;
+	unsigned long last = READ_ONCE(devfreq_boost_last);
+
+	if (!devfreq_wq)
+		return;
+	if (last && time_before(now, last +
+				msecs_to_jiffies(boost_min_interval_ms)))
+		return;
+	if (cmpxchg(&devfreq_boost_last, last, now) != last)
+		return;
+
+	queue_work(devfreq_wq, &devfreq_boost_work);
+}
+EXPORT_SYMBOL(devfreq_boost_kick);
+
 /**
  * _remove_devfreq() - Remove devfreq from the list and release its resources.
  * @devfreq:	the devfreq struct
@@ -508,6 +588,8 @@ static void _remove_devfreq(struct devfreq *devfreq)
 	list_del(&devfreq->node);
 	mutex_unlock(&devfreq_list_lock);
 
+	cancel_delayed_work_sync(&devfreq->boost_end);
+
 	if (devfreq->governor)
 		devfreq->governor->event_handler(devfreq,
 						 DEVFREQ_GOV_STOP, NULL);
@@ -585,6 +667,8 @@ struct devfreq *devfreq_add_device(struct device *dev,
 	devfreq->last_status.current_frequency = profile->initial_freq;
 	devfreq->data = data;
 	devfreq->nb.notifier_call = devfreq_notifier_call;
+	devfreq->boost_ms = DEVFREQ_BOOST_DEFAULT_MS;
+	INIT_DELAYED_WORK(&devfreq->boost_end, devfreq_boost_end_fn);
 
 	if (!devfreq->profile->max_state && !devfreq->profile->freq_table) {
 		mutex_unlock(&devfreq->lock);
@@ -1168,10 +1252,58 @@ static ssize_t name##_show					\
 }
 show_one(min_freq);
 show_one(max_freq);
+show_one(boost_freq);
 
 static DEVICE_ATTR_RW(min_freq);
 static DEVICE_ATTR_RW(max_freq);
 
+static ssize_t boost_freq_store(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct devfreq *df = to_devfreq(dev);
+	unsigned long value;
+	int ret;
+
+	ret = sscanf(buf, "%lu", &value);
+	if (ret != 1)
+		return -EINVAL;
+
+	mutex_lock(&df->lock);
+	df->boost_freq = value;
+	if (!value)
+		update_devfreq(df);
+	mutex_unlock(&df->lock);
+
+	return count;
+}
+static DEVICE_ATTR_RW(boost_freq);
+
+static ssize_t boost_ms_show(struct device *dev, struct device_attribute *attr,
+			     char *buf)
+{
+	return sprintf(buf, "%u\n", to_devfreq(dev)->boost_ms);
+}
+
+static ssize_t boost_ms_store(struct device *dev, struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct devfreq *df = to_devfreq(dev);
+	unsigned int value;
+	int ret;
+
+	ret = sscanf(buf, "%u", &value);
+	if (ret != 1)
+		return -EINVAL;
+
+	mutex_lock(&df->lock);
+	df->boost_ms = value;
+	mutex_unlock(&df->lock);
+
+	return count;
+}
+static DEVICE_ATTR_RW(boost_ms);
+
 static ssize_t available_frequencies_show(struct device *d,
 					  struct device_attribute *attr,
 					  char *buf)
@@ -1269,6 +1401,8 @@ static struct attribute *devfreq_attrs[] = {
 	&dev_attr_polling_interval.attr,
 	&dev_attr_min_freq.attr,
 	&dev_attr_max_freq.attr,
+	&dev_attr_boost_freq.attr,
+	&dev_attr_boost_ms.attr,
 	&dev_attr_trans_stat.attr,
 	NULL,
 };
@@ -32,6 +32,7 @@
 #include <trace/events/power.h>
 #include "governor.h"
 #include "governor_bw_hwmon.h"
+#include "governor_memlat.h"
 
 #define NUM_MBPS_ZONES		10
 struct hwmon_node {
@@ -75,6 +76,25 @@ struct hwmon_node {
 	struct devfreq_governor *gov;
 	struct attribute_group *attr_grp;
 	struct mutex mon_lock;
+
+	/* mem_vote governor state */
+	struct memlat_node *memlat;
+	unsigned int ratio_ceil;
+	unsigned int stall_floor;
+	unsigned int hint_percent;
+	unsigned int vote_down_count;
+	unsigned int vote_down_margin;
+	unsigned int vote_hold;
+	unsigned long vote_freq;
+	unsigned long vote_hold_max;
+
+	/* bw_hwmon bandwidth prediction state */
+	unsigned int predict_percent;
+	unsigned int predict_hold;
+	unsigned int predict_decay;
+	unsigned int pred_hold;
+	unsigned long pred_mbps;
+	unsigned long pred_last;
 };
 
 #define UP_WAKE 1
@@ -87,6 +107,23 @@ static DEFINE_MUTEX(list_lock);
 static int use_cnt;
 static DEFINE_MUTEX(state_lock);
 
+/* Bandwidth that GPU, display and camera are about to use */
+static unsigned long mem_vote_hints[DEVFREQ_MEM_VOTE_NR];
+static DEFINE_SPINLOCK(mem_vote_hint_lock);
+
+static unsigned long mem_vote_hint_sum(void)
+{
+	unsigned long flags, mbps = 0;
+	int i;
+
+	spin_lock_irqsave(&mem_vote_hint_lock, flags);
+	for (i = 0; i < DEVFREQ_MEM_VOTE_NR; i++)
+		mbps += mem_vote_hints[i];
+	spin_unlock_irqrestore(&mem_vote_hint_lock, flags);
+
+	return mbps;
+}
+
 #define show_attr(name) \
 static ssize_t show_##name(struct device *dev,				\
 			struct device_attribute *attr, char *buf)	\
@@ -591,6 +628,11 @@ static void stop_monitor(struct devfreq *df, bool init)
 
 }
 
+static struct attribute_group *gov_attr_group(struct devfreq *df,
+					      struct hwmon_node *node);
+static void mem_vote_start(struct devfreq *df, struct hwmon_node *node);
+static void mem_vote_stop(struct devfreq *df, struct hwmon_node *node);
+
 static int gov_start(struct devfreq *df)
 {
 	int ret = 0;
@@ -618,10 +660,12 @@ static int gov_start(struct devfreq *df)
 	node->orig_data = df->data;
 	df->data = node;
 
+	mem_vote_start(df, node);
+
 	if (start_monitor(df, true))
 		goto err_start;
 
-	ret = sysfs_create_group(&df->dev.kobj, node->attr_grp);
+	ret = sysfs_create_group(&df->dev.kobj, gov_attr_group(df, node));
 	if (ret)
 		goto err_sysfs;
 
@@ -630,6 +674,7 @@ static int gov_start(struct devfreq *df)
 err_sysfs:
 	stop_monitor(df, true);
 err_start:
+	mem_vote_stop(df, node);
 	df->data = node->orig_data;
 	node->orig_data = NULL;
 	hw->df = NULL;
@@ -642,8 +687,9 @@ static void gov_stop(struct devfreq *df)
 	struct hwmon_node *node = df->data;
 	struct bw_hwmon *hw = node->hw;
 
-	sysfs_remove_group(&df->dev.kobj, node->attr_grp);
+	sysfs_remove_group(&df->dev.kobj, gov_attr_group(df, node));
 	stop_monitor(df, true);
+	mem_vote_stop(df, node);
 	df->data = node->orig_data;
 	node->orig_data = NULL;
 	hw->df = NULL;
@@ -706,10 +752,52 @@ static int gov_resume(struct devfreq *df)
 	return start_monitor(df, false);
 }
 
+/*
+ * Use the bandwidth the clients announced as a floor for the measured one.
+ * A higher prediction takes effect right away and is held for predict_hold
+ * samples, or until the measured bandwidth reaches it. After that it decays
+ * by predict_decay percent per sample, so a prediction that traffic
+ * confirms is taken over by the measurement and one it contradicts fades.
+ */
+static void bw_hwmon_predict(struct hwmon_node *node, unsigned long meas_mbps,
+			     unsigned long *freq, unsigned long *ab)
+{
+	unsigned long pred;
+
+	pred = mem_vote_hint_sum() * node->predict_percent / 100;
+
+	if (pred > node->pred_last) {
+		node->pred_mbps = pred;
+		node->pred_hold = node->predict_hold;
+	} else {
+		if (pred < node->pred_last)
+			node->pred_mbps = min(node->pred_mbps, pred);
+
+		if (node->pred_hold && meas_mbps < node->pred_mbps) {
+			node->pred_hold--;
+		} else {
+			node->pred_hold = 0;
+			node->pred_mbps = node->pred_mbps *
+					(100 - node->predict_decay) / 100;
+		}
+	}
+	node->pred_last = pred;
+
+	if (node->pred_mbps) {
+		*freq = max(*freq, (node->pred_mbps * 100) / node->io_percent);
+		if (ab)
+			*ab = max(*ab, roundup(node->pred_mbps, node->bw_step));
+	}
+
+	trace_bw_hwmon_predict(dev_name(node->hw->df->dev.parent), pred,
+			       meas_mbps, node->pred_mbps, node->pred_hold);
+}
+
 static int devfreq_bw_hwmon_get_freq(struct devfreq *df,
 					unsigned long *freq)
 {
 	struct hwmon_node *node = df->data;
+	unsigned long meas_mbps;
 
 	/* Suspend/resume sequence */
 	if (!node->mon_started) {
@@ -718,7 +806,10 @@ static int devfreq_bw_hwmon_get_freq(struct devfreq *df,
 		return 0;
 	}
 
-	get_bw_and_set_irq(node, freq, node->dev_ab);
+	meas_mbps = get_bw_and_set_irq(node, freq, node->dev_ab);
+
+	if (node->predict_percent)
+		bw_hwmon_predict(node, meas_mbps, freq, node->dev_ab);
 
 	return 0;
 }
@@ -778,6 +869,9 @@ gov_attr(hyst_trigger_count, 0U, 90U);
 gov_attr(hyst_length, 0U, 90U);
 gov_attr(idle_mbps, 0U, 2000U);
 gov_list_attr(mbps_zones, NUM_MBPS_ZONES, 0U, UINT_MAX);
+gov_attr(predict_percent, 0U, 100U);
+gov_attr(predict_hold, 0U, 90U);
+gov_attr(predict_decay, 1U, 100U);
 
 static struct attribute *dev_attr[] = {
 	&dev_attr_guard_band_mbps.attr,
@@ -795,6 +889,9 @@ static struct attribute *dev_attr[] = {
 	&dev_attr_idle_mbps.attr,
 	&dev_attr_mbps_zones.attr,
 	&dev_attr_throttle_adj.attr,
+	&dev_attr_predict_percent.attr,
+	&dev_attr_predict_hold.attr,
+	&dev_attr_predict_decay.attr,
 	NULL,
 };
 
@@ -893,6 +990,227 @@ static struct devfreq_governor devfreq_gov_bw_hwmon = {
 	.event_handler = devfreq_bw_hwmon_ev_handler,
 };
 
+#ifdef CONFIG_DEVFREQ_GOV_MEM_VOTE
+/*
+ * mem_vote runs the BW HW monitor like bw_hwmon does, and folds the memlat
+ * vote and GPU/display hints into the same decision. The highest input wins
+ * straight away. Dropping needs vote_down_count samples in a row that are
+ * more than vote_down_margin percent below the current vote, and then goes
+ * to the highest of those samples, so one input can't undo another's vote
+ * on every other sample.
+ */
+static struct devfreq_governor devfreq_gov_mem_vote;
+
+static bool is_mem_vote(struct devfreq *df)
+{
+	return df->governor == &devfreq_gov_mem_vote;
+}
+
+static void mem_vote_start(struct devfreq *df, struct hwmon_node *node)
+{
+	if (!is_mem_vote(df))
+		return;
+
+	node->memlat = memlat_vote_attach(df);
+	if (!node->memlat)
+		dev_info(df->dev.parent, "No memlat monitor, voting on BW\n");
+	node->vote_freq = 0;
+	node->vote_hold = 0;
+	node->vote_hold_max = 0;
+}
+
+static void mem_vote_stop(struct devfreq *df, struct hwmon_node *node)
+{
+	memlat_vote_detach(node->memlat);
+	node->memlat = NULL;
+}
+
+static unsigned long mem_vote_decide(struct hwmon_node *node,
+				     unsigned long target)
+{
+	unsigned long floor;
+
+	floor = node->vote_freq * (100 - node->vote_down_margin) / 100;
+	if (target >= node->vote_freq || !node->vote_down_count) {
+		node->vote_freq = target;
+	} else if (target >= floor) {
+		/* Close enough, keep the vote and restart the down count */
+	} else {
+		node->vote_hold_max = max(node->vote_hold_max, target);
+		if (++node->vote_hold < node->vote_down_count)
+			return node->vote_freq;
+		node->vote_freq = node->vote_hold_max;
+	}
+
+	node->vote_hold = 0;
+	node->vote_hold_max = 0;
+	return node->vote_freq;
+}
+
+static int devfreq_mem_vote_get_freq(struct devfreq *df,
+					unsigned long *freq)
+{
+	struct hwmon_node *node = df->data;
+	unsigned long hints[DEVFREQ_MEM_VOTE_NR];
+	unsigned long bw_freq, lat_freq = 0, hint_mbps = 0, hint_freq;
+	unsigned long ab = 0, target, flags;
+	int i;
+
+	/* Suspend/resume sequence */
+	if (!node->mon_started) {
+		*freq = node->resume_freq;
+		*node->dev_ab = node->resume_ab;
+		return 0;
+	}
+
+	get_bw_and_set_irq(node, &bw_freq, &ab);
+
+	if (node->memlat)
+		lat_freq = memlat_vote(node->memlat, node->ratio_ceil,
+				       node->stall_floor);
+
+	spin_lock_irqsave(&mem_vote_hint_lock, flags);
+	memcpy(hints, mem_vote_hints, sizeof(hints));
+	spin_unlock_irqrestore(&mem_vote_hint_lock, flags);
+
+	for (i = 0; i < DEVFREQ_MEM_VOTE_NR; i++)
+		hint_mbps += hints[i];
+	hint_mbps = hint_mbps * node->hint_percent / 100;
+	hint_freq = (hint_mbps * 100) / node->io_percent;
+
+	target = max3(bw_freq, lat_freq, hint_freq);
+	*freq = mem_vote_decide(node, target);
+
+	if (node->dev_ab)
+		*node->dev_ab = max(ab, roundup(hint_mbps, node->bw_step));
+
+	trace_mem_vote_update(dev_name(df->dev.parent), bw_freq, lat_freq,
+			      hints[DEVFREQ_MEM_VOTE_GPU],
+			      hints[DEVFREQ_MEM_VOTE_DISPLAY], target, *freq,
+			      node->vote_hold);
+	return 0;
+}
+
+gov_attr(ratio_ceil, 1U, 10000U);
+gov_attr(stall_floor, 0U, 100U);
+gov_attr(hint_percent, 0U, 100U);
+gov_attr(vote_down_count, 0U, 90U);
+gov_attr(vote_down_margin, 0U, 90U);
+
+static struct attribute *mem_vote_attr[] = {
+	&dev_attr_guard_band_mbps.attr,
+	&dev_attr_decay_rate.attr,
+	&dev_attr_io_percent.attr,
+	&dev_attr_bw_step.attr,
+	&dev_attr_sample_ms.attr,
+	&dev_attr_up_scale.attr,
+	&dev_attr_up_thres.attr,
+	&dev_attr_down_thres.attr,
+	&dev_attr_down_count.attr,
+	&dev_attr_hist_memory.attr,
+	&dev_attr_hyst_trigger_count.attr,
+	&dev_attr_hyst_length.attr,
+	&dev_attr_idle_mbps.attr,
+	&dev_attr_mbps_zones.attr,
+	&dev_attr_throttle_adj.attr,
+	&dev_attr_ratio_ceil.attr,
+	&dev_attr_stall_floor.attr,
+	&dev_attr_hint_percent.attr,
+	&dev_attr_vote_down_count.attr,
+	&dev_attr_vote_down_margin.attr,
+	NULL,
+};
+
+static struct attribute_group mem_vote_attr_group = {
+	.name = "mem_vote",
+	.attrs = mem_vote_attr,
+};
+
+static struct devfreq_governor devfreq_gov_mem_vote = {
+	.name = "mem_vote",
+	.get_target_freq = devfreq_mem_vote_get_freq,
+	.event_handler = devfreq_bw_hwmon_ev_handler,
+};
+
+static struct attribute_group *gov_attr_group(struct devfreq *df,
+					      struct hwmon_node *node)
+{
+	return is_mem_vote(df) ? &mem_vote_attr_group : node->attr_grp;
+}
+
+static int mem_vote_add_governor(void)
+{
+	return devfreq_add_governor(&devfreq_gov_mem_vote);
+}
+#else
+static bool is_mem_vote(struct devfreq *df)
+{
+	return false;
+}
+
+static void mem_vote_start(struct devfreq *df, struct hwmon_node *node)
+{
+}
+
+static void mem_vote_stop(struct devfreq *df, struct hwmon_node *node)
+{
+}
+
+static struct attribute_group *gov_attr_group(struct devfreq *df,
+					      struct hwmon_node *node)
+{
+	return node->attr_grp;
+}
+
+static int mem_vote_add_governor(void)
+{
+	return 0;
+}
+#endif
+
+static void mem_vote_hint_work_fn(struct work_struct *work)
+{
+	struct hwmon_node *node;
+
+	mutex_lock(&list_lock);
+	list_for_each_entry(node, &hwmon_list, list) {
+		struct devfreq *df = node->hw->df;
+
+		if (df && (is_mem_vote(df) || node->predict_percent))
+			update_bw_hwmon(node->hw);
+	}
+	mutex_unlock(&list_lock);
+}
+
+static DECLARE_WORK(mem_vote_hint_work, mem_vote_hint_work_fn);
+
+/**
+ * devfreq_mem_vote_hint() - Report the DDR bandwidth a client is about to use
+ * @src:	Client reporting the bandwidth
+ * @mbps:	Average bandwidth in MBps, 0 when idle
+ *
+ * Raising a hint re-evaluates the mem_vote devices, and the bw_hwmon devices
+ * with predict_percent set, right away. A lower hint is picked up by the
+ * next sample.
+ */
+void devfreq_mem_vote_hint(enum devfreq_mem_vote_hint src, unsigned long mbps)
+{
+	unsigned long flags;
+	bool raise;
+
+	if (src >= DEVFREQ_MEM_VOTE_NR)
+		return;
+
+	spin_lock_irqsave(&mem_vote_hint_lock, flags);
+	raise = mbps > mem_vote_hints[src];
+	mem_vote_hints[src] = mbps;
+	spin_unlock_irqrestore(&mem_vote_hint_lock, flags);
+
+	if (raise)
+		schedule_work(&mem_vote_hint_work);
+}
+EXPORT_SYMBOL(devfreq_mem_vote_hint);
+
 int register_bw_hwmon(struct device *dev, struct bw_hwmon *hwmon)
 {
 	int ret = 0;
@@ -937,6 +1255,14 @@ int register_bw_hwmon(struct device *dev, struct bw_hwmon *hwmon)
 	node->hyst_length = 0;
 	node->idle_mbps = 400;
 	node->mbps_zones[0] = 0;
+	node->ratio_ceil = 10;
+	node->stall_floor = 0;
+	node->hint_percent = 100;
+	node->vote_down_count = 3;
+	node->vote_down_margin = 10;
+	node->predict_percent = 0;
+	node->predict_hold = 3;
+	node->predict_decay = 25;
 	node->hw = hwmon;
 
 	mutex_init(&node->mon_lock);
@@ -949,8 +1275,11 @@ int register_bw_hwmon(struct device *dev, struct bw_hwmon *hwmon)
 		ret = devfreq_add_governor(hwmon->gov);
 	} else {
 		mutex_lock(&state_lock);
-		if (!use_cnt)
+		if (!use_cnt) {
 			ret = devfreq_add_governor(&devfreq_gov_bw_hwmon);
+			if (!ret && mem_vote_add_governor())
+				dev_warn(dev, "mem_vote governor not added\n");
+		}
 		if (!ret)
 			use_cnt++;
 		mutex_unlock(&state_lock);
@@ -12,6 +12,7 @@
  */
 
 #include <linux/devfreq.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/msm_adreno_devfreq.h>
 #include <linux/slab.h>
@@ -27,6 +28,49 @@
 /* AB vote is in multiple of BW_STEP Mega bytes */
 #define BW_STEP                 160
 
+/*
+ * In frame mode the bus is re-evaluated on every retired frame and voted
+ * just fast enough to move the DDR traffic of the last frame before its
+ * deadline, instead of following the busy percentage of the sample window.
+ */
+static struct devfreq *gpubw_devfreq;
+static struct notifier_block gpubw_nb;
+
+static inline struct msm_busmon_extended_profile *to_bus_profile(
+		struct devfreq *df)
+{
+	return container_of(df->profile, struct msm_busmon_extended_profile,
+			profile);
+}
+
+static ssize_t frame_mode_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct devfreq *df = container_of(dev, struct devfreq, dev);
+
+	return snprintf(buf, PAGE_SIZE, "%d\n", to_bus_profile(df)->frame_mode);
+}
+
+static ssize_t frame_mode_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct devfreq *df = container_of(dev, struct devfreq, dev);
+	bool val;
+	int ret;
+
+	ret = kstrtobool(buf, &val);
+	if (ret)
+		return ret;
+
+	mutex_lock(&df->lock);
+	to_bus_profile(df)->frame_mode = val;
+	mutex_unlock(&df->lock);
+
+	return count;
+}
+
+static DEVICE_ATTR(frame_mode, 0644, frame_mode_show, frame_mode_store);
+
 static void _update_cutoff(struct devfreq_msm_adreno_tz_data *priv,
 					unsigned int norm_max)
 {
@@ -51,6 +95,45 @@ static inline int devfreq_get_freq_level(struct devfreq *devfreq,
 	return -EINVAL;
 }
 
+/*
+ * Vote the smallest AB and IB that move the DDR beats of the last frame
+ * within the time it had for them. Returns false if there is no recent
+ * frame to go by and the sample window has to be used instead.
+ */
+static bool gpubw_frame_vote(struct devfreq_msm_adreno_tz_data *priv,
+		struct msm_busmon_extended_profile *bus_profile,
+		struct xstats *b, int level)
+{
+	unsigned long mbytes, ib;
+	int act_level, want;
+
+	if (!bus_profile->frame_mode || !priv->bus.width || !b->frame_time ||
+			level < 0)
+		return false;
+
+	/* Bytes per usec are MB/s, keep the same 2^20 MB as the AB vote */
+	mbytes = div64_u64(b->frame_ram_time * priv->bus.width * 1000000ULL,
+			b->frame_time) >> 20;
+
+	/* IB is a peak rate, leave the same headroom as the window mode */
+	ib = (100 * mbytes) / TARGET;
+	for (want = 0; want < priv->bus.num - 1; want++)
+		if (priv->bus.ib[want] >= ib)
+			break;
+
+	act_level = priv->bus.index[level] + b->mod;
+	act_level = clamp_t(int, act_level, 0, priv->bus.num - 1);
+
+	if (want > act_level)
+		bus_profile->flag = DEVFREQ_FLAG_FAST_HINT;
+	else if (want < act_level)
+		bus_profile->flag = DEVFREQ_FLAG_SLOW_HINT;
+
+	bus_profile->ab_mbytes = roundup(mbytes, BW_STEP);
+
+	return true;
+}
+
 static int devfreq_gpubw_get_target(struct devfreq *df,
 				unsigned long *freq)
 {
@@ -91,6 +174,14 @@ static int devfreq_gpubw_get_target(struct devfreq *df,
 
 	level = devfreq_get_freq_level(df, stats.current_frequency);
 
+	if (gpubw_frame_vote(priv, bus_profile, &b, level)) {
+		priv->bus.total_time = 0;
+		priv->bus.gpu_time = 0;
+		priv->bus.ram_time = 0;
+		priv->bus.ram_wait = 0;
+		return result;
+	}
+
 	if (priv->bus.total_time < LONG_FLOOR)
 		return result;
 
@@ -145,6 +236,22 @@ static int devfreq_gpubw_get_target(struct devfreq *df,
 	return result;
 }
 
+static int gpubw_notify(struct notifier_block *nb, unsigned long type,
+		void *devp)
+{
+	struct devfreq *devfreq = gpubw_devfreq;
+
+	if (type != ADRENO_DEVFREQ_NOTIFY_FRAME || devfreq == NULL)
+		return NOTIFY_OK;
+
+	mutex_lock(&devfreq->lock);
+	if (to_bus_profile(devfreq)->frame_mode)
+		update_devfreq(devfreq);
+	mutex_unlock(&devfreq->lock);
+
+	return NOTIFY_OK;
+}
+
 static int gpubw_start(struct devfreq *devfreq)
 {
 	struct devfreq_msm_adreno_tz_data *priv;
@@ -185,7 +292,22 @@ static int gpubw_start(struct devfreq *devfreq)
 		priv->bus.p_up[priv->bus.num - 1] = 100;
 	_update_cutoff(priv, priv->bus.max);
 
-	return 0;
+	gpubw_devfreq = devfreq;
+	gpubw_nb.notifier_call = gpubw_notify;
+	device_create_file(&devfreq->dev, &dev_attr_frame_mode);
+
+	return kgsl_devfreq_add_notifier(devfreq->dev.parent, &gpubw_nb);
+}
+
+/*
+ * The notifier takes the devfreq lock so it has to be removed before the
+ * lock is taken to stop the governor.
+ */
+static void gpubw_stop_notify(struct devfreq *devfreq)
+{
+	kgsl_devfreq_del_notifier(devfreq->dev.parent, &gpubw_nb);
+	device_remove_file(&devfreq->dev, &dev_attr_frame_mode);
+	gpubw_devfreq = NULL;
 }
 
 static int gpubw_stop(struct devfreq *devfreq)
@@ -208,6 +330,9 @@ static int devfreq_gpubw_event_handler(struct devfreq *devfreq,
 	int result = 0;
 	unsigned long freq;
 
+	if (event == DEVFREQ_GOV_STOP)
+		gpubw_stop_notify(devfreq);
+
 	mutex_lock(&devfreq->lock);
 	freq = devfreq->previous_freq;
 	switch (event) {
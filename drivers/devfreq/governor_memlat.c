@@ -224,12 +224,12 @@ static void gov_stop(struct devfreq *df)
 	hw->df = NULL;
 }
 
-static int devfreq_memlat_get_freq(struct devfreq *df,
-					unsigned long *freq)
+static unsigned long memlat_get_vote(struct memlat_node *node,
+		unsigned int ratio_ceil, unsigned int stall_floor)
 {
 	int i, lat_dev = 0;
-	struct memlat_node *node = df->data;
 	struct memlat_hwmon *hw = node->hw;
+	struct devfreq *df = hw->df;
 	unsigned long max_freq = 0;
 	unsigned int ratio;
 
@@ -251,8 +251,8 @@ static int devfreq_memlat_get_freq(struct devfreq *df,
 					hw->core_stats[i].freq,
 					hw->core_stats[i].stall_pct, ratio);
 
-		if (ratio <= node->ratio_ceil
-		    && hw->core_stats[i].stall_pct >= node->stall_floor
+		if (ratio <= ratio_ceil
+		    && hw->core_stats[i].stall_pct >= stall_floor
 		    && hw->core_stats[i].freq > max_freq) {
 			lat_dev = i;
 			max_freq = hw->core_stats[i].freq;
@@ -273,10 +273,73 @@ static int devfreq_memlat_get_freq(struct devfreq *df,
 
 	node->already_zero = !max_freq;
 
-	*freq = max_freq;
+	return max_freq;
+}
+
+static int devfreq_memlat_get_freq(struct devfreq *df,
+					unsigned long *freq)
+{
+	struct memlat_node *node = df->data;
+
+	*freq = memlat_get_vote(node, node->ratio_ceil, node->stall_floor);
 	return 0;
 }
 
+/*
+ * Let another governor of the device this monitor targets use its memory
+ * latency vote. The caller owns the devfreq device and its sampling, so
+ * only the HW monitor is started here.
+ */
+struct memlat_node *memlat_vote_attach(struct devfreq *df)
+{
+	struct memlat_node *node = find_memlat_node(df);
+	int ret;
+
+	if (!node)
+		return NULL;
+
+	mutex_lock(&state_lock);
+	if (node->hw->df) {
+		mutex_unlock(&state_lock);
+		return NULL;
+	}
+
+	node->hw->df = df;
+	ret = node->hw->start_hwmon(node->hw);
+	if (ret) {
+		dev_err(df->dev.parent, "Unable to start HW monitor! (%d)\n",
+			ret);
+		node->hw->df = NULL;
+		node = NULL;
+	} else {
+		node->mon_started = true;
+	}
+	mutex_unlock(&state_lock);
+
+	return node;
+}
+EXPORT_SYMBOL(memlat_vote_attach);
+
+void memlat_vote_detach(struct memlat_node *node)
+{
+	if (!node)
+		return;
+
+	mutex_lock(&state_lock);
+	node->mon_started = false;
+	node->hw->stop_hwmon(node->hw);
+	node->hw->df = NULL;
+	mutex_unlock(&state_lock);
+}
+EXPORT_SYMBOL(memlat_vote_detach);
+
+unsigned long memlat_vote(struct memlat_node *node, unsigned int ratio_ceil,
+			  unsigned int stall_floor)
+{
+	return memlat_get_vote(node, ratio_ceil, stall_floor);
+}
+EXPORT_SYMBOL(memlat_vote);
+
 gov_attr(ratio_ceil, 1U, 10000U);
 gov_attr(stall_floor, 0U, 100U);
 
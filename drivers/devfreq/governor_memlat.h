@@ -72,10 +72,16 @@ struct memlat_hwmon {
 	struct core_dev_map *freq_map;
 };
 
+struct memlat_node;
+
 #ifdef CONFIG_DEVFREQ_GOV_MEMLAT
 int register_memlat(struct device *dev, struct memlat_hwmon *hw);
 int register_compute(struct device *dev, struct memlat_hwmon *hw);
 int update_memlat(struct memlat_hwmon *hw);
+struct memlat_node *memlat_vote_attach(struct devfreq *df);
+void memlat_vote_detach(struct memlat_node *node);
+unsigned long memlat_vote(struct memlat_node *node, unsigned int ratio_ceil,
+			  unsigned int stall_floor);
 #else
 static inline int register_memlat(struct device *dev,
 				  struct memlat_hwmon *hw)
@@ -91,6 +97,19 @@ static inline int update_memlat(struct memlat_hwmon *hw)
 {
 	return 0;
 }
+static inline struct memlat_node *memlat_vote_attach(struct devfreq *df)
+{
+	return NULL;
+}
+static inline void memlat_vote_detach(struct memlat_node *node)
+{
+}
+static inline unsigned long memlat_vote(struct memlat_node *node,
+					unsigned int ratio_ceil,
+					unsigned int stall_floor)
+{
+	return 0;
+}
 #endif
 
 #endif /* _GOVERNOR_BW_HWMON_H */
@@ -0,0 +1,459 @@
+/* Copyright (c) 2026, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#include <linux/errno.h>
+#include <linux/module.h>
+#include <linux/devfreq.h>
+#include <linux/math64.h>
+#include <linux/kernel.h>
+#include <linux/msm_adreno_devfreq.h>
+#include "governor.h"
+
+/*
+ * FLOOR is 5msec, don't bother re-evaluating more often than that
+ * even if frames are retiring faster.
+ */
+#define FLOOR			5000
+
+/*
+ * CEILING is 50msec. If no end of frame marker has been seen in that long
+ * the workload isn't frame based and the whole window is treated as one
+ * frame with the window as its deadline.
+ */
+#define CEILING			50000
+
+#define DEFAULT_TARGET_FPS	60
+#define DEFAULT_TARGET_LOAD	90
+
+/* AB vote is in multiple of BW_STEP Mega bytes */
+#define BW_STEP			160
+
+#define TAG "msm_adreno_frame: "
+
+/**
+ * struct adreno_frame_data - State of the frame based governor
+ * @nb: Notifier block for the KGSL devfreq events
+ * @acc: Workload accumulated since the last decision
+ * @scale_cycles: Predicted per frame work that scales with the GPU clock,
+ * in GPU cycles
+ * @mem_time: Predicted per frame time bound by DDR in usec
+ * @budget: Per frame deadline used for the last decision in usec
+ * @ram_time: DDR beats moved during the last decision window
+ * @total_time: Length of the last decision window in usec
+ * @started: True once the first (stale) sample has been discarded
+ * @target_fps: Frame rate the GPU needs to sustain
+ * @target_load: Percentage of the frame period the GPU may be busy for
+ *
+ * Only one adreno device is ever connected to this governor so the state is
+ * kept in a single static instance.
+ */
+static struct adreno_frame_data {
+	struct notifier_block nb;
+	struct msm_adreno_frame_stats acc;
+	u64 scale_cycles;
+	u64 mem_time;
+	u64 budget;
+	u64 ram_time;
+	u64 total_time;
+	bool started;
+	unsigned int target_fps;
+	unsigned int target_load;
+} frame = {
+	.target_fps = DEFAULT_TARGET_FPS,
+	.target_load = DEFAULT_TARGET_LOAD,
+};
+
+static struct msm_adreno_extended_profile *frame_gpu_profile;
+
+static ssize_t target_fps_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", frame.target_fps);
+}
+
+static ssize_t target_fps_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &val);
+	if (ret)
+		return ret;
+
+	if (val == 0 || val > 240)
+		return -EINVAL;
+
+	frame.target_fps = val;
+	return count;
+}
+
+static ssize_t target_load_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", frame.target_load);
+}
+
+static ssize_t target_load_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &val);
+	if (ret)
+		return ret;
+
+	if (val < 10 || val > 100)
+		return -EINVAL;
+
+	frame.target_load = val;
+	return count;
+}
+
+static DEVICE_ATTR(target_fps, 0644, target_fps_show, target_fps_store);
+static DEVICE_ATTR(target_load, 0644, target_load_show, target_load_store);
+
+static const struct device_attribute *adreno_frame_attr_list[] = {
+		&dev_attr_target_fps,
+		&dev_attr_target_load,
+		NULL
+};
+
+static inline int devfreq_get_freq_level(struct devfreq *devfreq,
+	unsigned long freq)
+{
+	int lev;
+
+	for (lev = 0; lev < devfreq->profile->max_state; lev++)
+		if (freq == devfreq->profile->freq_table[lev])
+			return lev;
+
+	return -EINVAL;
+}
+
+/* Rise to a heavier frame immediately, decay slowly on lighter ones */
+static inline u64 _predict(u64 old, u64 sample)
+{
+	if (sample >= old)
+		return sample;
+
+	return (old * 3 + sample) >> 2;
+}
+
+/* Predicted time in usec for a frame at @freq with @mem_time DDR bound */
+static inline u64 _frame_time(unsigned long freq, u64 mem_time)
+{
+	unsigned long mhz = max_t(unsigned long, freq / 1000000, 1);
+
+	return div64_u64(frame.scale_cycles, mhz) + mem_time;
+}
+
+static void frame_reset(void)
+{
+	memset(&frame.acc, 0, sizeof(frame.acc));
+	frame.scale_cycles = 0;
+	frame.mem_time = 0;
+	frame.budget = 0;
+}
+
+/*
+ * Split the accumulated workload into the part that scales with the GPU
+ * clock and the part that is bound by DDR, and update the prediction for the
+ * next frame. Returns false if there isn't enough data for a decision yet.
+ */
+static bool frame_update_prediction(unsigned long cur_freq)
+{
+	struct msm_adreno_frame_stats *acc = &frame.acc;
+	u64 period = USEC_PER_SEC / frame.target_fps;
+	u64 budget = div_u64(period * frame.target_load, 100);
+	unsigned long mhz = max_t(unsigned long, cur_freq / 1000000, 1);
+	u64 busy, alu, stall, mem;
+	u32 frames = acc->frames;
+
+	if (acc->total_time < FLOOR)
+		return false;
+
+	if (frames == 0) {
+		/*
+		 * Don't wait for the end of frame if the frame in flight has
+		 * already blown its deadline, otherwise fall back to the
+		 * window load once it is clear no frames are coming.
+		 */
+		if (acc->busy_time > budget)
+			frames = 1;
+		else if (acc->total_time >= CEILING) {
+			frames = 1;
+			budget = div_u64(acc->total_time * frame.target_load,
+				100);
+		} else
+			return false;
+	}
+
+	busy = div_u64(acc->busy_time, frames);
+	alu = div_u64(min(acc->alu_time, acc->busy_time), frames);
+	/* VBIF/GBIF stall cycles run on the GPU clock */
+	stall = div_u64(div_u64(acc->ram_wait, mhz), frames);
+
+	/*
+	 * Stalls that overlap with ALU work are hidden by it, only the
+	 * remainder is bound by DDR and won't shrink with a faster GPU clock.
+	 */
+	mem = busy ? div64_u64(stall * (busy - alu), busy) : 0;
+	mem = min(mem, busy);
+
+	frame.scale_cycles = _predict(frame.scale_cycles, (busy - mem) * mhz);
+	frame.mem_time = _predict(frame.mem_time, mem);
+	frame.budget = budget;
+	frame.ram_time = acc->ram_time;
+	frame.total_time = acc->total_time;
+
+	memset(acc, 0, sizeof(*acc));
+	return true;
+}
+
+static int frame_get_target_freq(struct devfreq *devfreq, unsigned long *freq)
+{
+	struct devfreq_dev_status stats;
+	struct msm_adreno_frame_stats sample;
+	int result, level;
+
+	result = devfreq->profile->get_dev_status(devfreq->dev.parent, &stats);
+	if (result) {
+		pr_err(TAG "get_status failed %d\n", result);
+		return result;
+	}
+
+	*freq = stats.current_frequency;
+
+	result = kgsl_devfreq_get_frame_stats(devfreq->dev.parent, &sample);
+	if (result) {
+		pr_err(TAG "get_frame_stats failed %d\n", result);
+		return result;
+	}
+
+	/* The first sample covers everything since the device was probed */
+	if (!frame.started) {
+		frame.started = true;
+		return 0;
+	}
+
+	frame.acc.total_time += sample.total_time;
+	frame.acc.busy_time += sample.busy_time;
+	frame.acc.alu_time += sample.alu_time;
+	frame.acc.ram_time += sample.ram_time;
+	frame.acc.ram_wait += sample.ram_wait;
+	frame.acc.frames += sample.frames;
+
+	if (!frame_update_prediction(stats.current_frequency))
+		return 0;
+
+	/* Pick the lowest level that still makes the frame deadline */
+	for (level = devfreq->profile->max_state - 1; level > 0; level--) {
+		if (_frame_time(devfreq->profile->freq_table[level],
+				frame.mem_time) <= frame.budget)
+			break;
+	}
+
+	*freq = devfreq->profile->freq_table[level];
+	return 0;
+}
+
+/*
+ * Vote the bus down while the DDR bound part of the frame still fits in the
+ * deadline at the next lower bus level, and up if the frame doesn't fit at
+ * the current one. Returns the bus device if a new vote needs to be sent.
+ */
+static struct devfreq *frame_update_bus(struct devfreq *devfreq,
+		unsigned long *freq)
+{
+	struct devfreq_msm_adreno_tz_data *priv = devfreq->data;
+	struct devfreq *bus_devfreq;
+	struct msm_busmon_extended_profile *bus_profile;
+	struct devfreq_dev_status stats;
+	struct xstats b;
+	u64 mem_time;
+	int level, act_level;
+
+	if (frame_gpu_profile == NULL || priv == NULL || priv->bus.num == 0)
+		return NULL;
+
+	bus_devfreq = frame_gpu_profile->bus_devfreq;
+	if (bus_devfreq == NULL || frame.budget == 0)
+		return NULL;
+
+	bus_profile = container_of(bus_devfreq->profile,
+			struct msm_busmon_extended_profile, profile);
+
+	*freq = devfreq->previous_freq;
+	level = devfreq_get_freq_level(devfreq, *freq);
+	if (level < 0)
+		return NULL;
+
+	stats.private_data = &b;
+	if (bus_devfreq->profile->get_dev_status(bus_devfreq->dev.parent,
+			&stats))
+		return NULL;
+
+	act_level = priv->bus.index[level] + b.mod;
+	act_level = clamp_t(int, act_level, 0, priv->bus.num - 1);
+
+	if (_frame_time(*freq, frame.mem_time) > frame.budget) {
+		if (act_level < priv->bus.num - 1)
+			bus_profile->flag = DEVFREQ_FLAG_FAST_HINT;
+	} else if (act_level > 0 && priv->bus.ib[act_level - 1]) {
+		mem_time = div64_u64(frame.mem_time * priv->bus.ib[act_level],
+			priv->bus.ib[act_level - 1]);
+
+		if (_frame_time(*freq, mem_time) <= frame.budget)
+			bus_profile->flag = DEVFREQ_FLAG_SLOW_HINT;
+	}
+
+	/* Calculate the AB vote based on bus width if defined */
+	if (priv->bus.width && frame.total_time) {
+		unsigned long norm_ab = (unsigned long)div64_u64(frame.ram_time,
+			frame.total_time);
+		unsigned long ab_mbytes =
+			(norm_ab * priv->bus.width * 1000000ULL) >> 20;
+
+		bus_profile->ab_mbytes = roundup(ab_mbytes, BW_STEP);
+	}
+
+	return bus_devfreq;
+}
+
+static int frame_notify(struct notifier_block *nb, unsigned long type,
+		void *devp)
+{
+	int result = 0;
+	struct devfreq *devfreq = devp;
+	struct devfreq *bus_devfreq = NULL;
+	unsigned long freq;
+
+	switch (type) {
+	case ADRENO_DEVFREQ_NOTIFY_FRAME:
+	case ADRENO_DEVFREQ_NOTIFY_IDLE:
+	case ADRENO_DEVFREQ_NOTIFY_RETIRE:
+		mutex_lock(&devfreq->lock);
+		result = update_devfreq(devfreq);
+		if (!result)
+			bus_devfreq = frame_update_bus(devfreq, &freq);
+		mutex_unlock(&devfreq->lock);
+
+		/* The bus vote is only applied for the current GPU freq */
+		if (bus_devfreq) {
+			mutex_lock(&bus_devfreq->lock);
+			bus_devfreq->profile->target(bus_devfreq->dev.parent,
+				&freq, 0);
+			mutex_unlock(&bus_devfreq->lock);
+		}
+		break;
+	/* ignored by this governor */
+	case ADRENO_DEVFREQ_NOTIFY_SUBMIT:
+	default:
+		break;
+	}
+	return notifier_from_errno(result);
+}
+
+static int frame_start(struct devfreq *devfreq)
+{
+	struct msm_adreno_extended_profile *gpu_profile = container_of(
+					(devfreq->profile),
+					struct msm_adreno_extended_profile,
+					profile);
+	int i;
+
+	/*
+	 * Same as msm-adreno-tz, there is only one adreno device so the
+	 * governor private data can be restored from the device profile
+	 */
+	devfreq->data = gpu_profile->private_data;
+	frame_gpu_profile = gpu_profile;
+
+	frame_reset();
+	frame.started = false;
+	frame.nb.notifier_call = frame_notify;
+
+	for (i = 0; adreno_frame_attr_list[i] != NULL; i++)
+		device_create_file(&devfreq->dev, adreno_frame_attr_list[i]);
+
+	return kgsl_devfreq_add_notifier(devfreq->dev.parent, &frame.nb);
+}
+
+static int frame_stop(struct devfreq *devfreq)
+{
+	int i;
+
+	kgsl_devfreq_del_notifier(devfreq->dev.parent, &frame.nb);
+
+	for (i = 0; adreno_frame_attr_list[i] != NULL; i++)
+		device_remove_file(&devfreq->dev, adreno_frame_attr_list[i]);
+
+	/* leaving the governor and cleaning the pointer to private data */
+	devfreq->data = NULL;
+	frame_gpu_profile = NULL;
+	return 0;
+}
+
+static int frame_handler(struct devfreq *devfreq, unsigned int event,
+		void *data)
+{
+	int result = 0;
+
+	switch (event) {
+	case DEVFREQ_GOV_START:
+		result = frame_start(devfreq);
+		break;
+
+	case DEVFREQ_GOV_STOP:
+		result = frame_stop(devfreq);
+		break;
+
+	case DEVFREQ_GOV_SUSPEND:
+		/* The next workload after a slumber is likely different */
+		frame_reset();
+		break;
+
+	case DEVFREQ_GOV_RESUME:
+	case DEVFREQ_GOV_INTERVAL:
+		/* fallthrough, this governor doesn't use polling */
+	default:
+		break;
+	}
+
+	return result;
+}
+
+static struct devfreq_governor msm_adreno_frame = {
+	.name = "msm-adreno-frame",
+	.get_target_freq = frame_get_target_freq,
+	.event_handler = frame_handler,
+};
+
+static int __init msm_adreno_frame_init(void)
+{
+	return devfreq_add_governor(&msm_adreno_frame);
+}
+subsys_initcall(msm_adreno_frame_init);
+
+static void __exit msm_adreno_frame_exit(void)
+{
+	int ret = devfreq_remove_governor(&msm_adreno_frame);
+
+	if (ret)
+		pr_err(TAG "failed to remove governor %d\n", ret);
+}
+
+module_exit(msm_adreno_frame_exit);
+
+MODULE_LICENSE("GPL v2");
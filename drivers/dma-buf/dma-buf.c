@@ -254,6 +254,81 @@ static unsigned int dma_buf_poll(struct file *file, poll_table *poll)
 	return events;
 }
 
+static int dma_buf_sync_direction(u64 flags, enum dma_data_direction *dir)
+{
+	if (flags & ~DMA_BUF_SYNC_VALID_FLAGS_MASK)
+		return -EINVAL;
+
+	switch (flags & DMA_BUF_SYNC_RW) {
+	case DMA_BUF_SYNC_READ:
+		*dir = DMA_FROM_DEVICE;
+		break;
+	case DMA_BUF_SYNC_WRITE:
+		*dir = DMA_TO_DEVICE;
+		break;
+	case DMA_BUF_SYNC_RW:
+		*dir = DMA_BIDIRECTIONAL;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static long dma_buf_ioctl_sync_partial(struct dma_buf *dmabuf,
+				       unsigned long arg)
+{
+	struct dma_buf_sync_range __user *ranges;
+	struct dma_buf_sync_partial sync;
+	struct dma_buf_sync_range range;
+	enum dma_data_direction direction;
+	bool end, partial;
+	unsigned int i;
+	int ret;
+
+	if (copy_from_user(&sync, (void __user *) arg, sizeof(sync)))
+		return -EFAULT;
+
+	ret = dma_buf_sync_direction(sync.flags, &direction);
+	if (ret)
+		return ret;
+
+	if (!sync.nr_ranges || sync.nr_ranges > DMA_BUF_SYNC_RANGES_MAX ||
+	    sync.reserved)
+		return -EINVAL;
+
+	end = sync.flags & DMA_BUF_SYNC_END;
+	partial = end ? !!dmabuf->ops->end_cpu_access_partial :
+			!!dmabuf->ops->begin_cpu_access_partial;
+
+	/* Without exporter support a single sync of the whole buffer will do */
+	if (!partial)
+		return end ? dma_buf_end_cpu_access(dmabuf, direction) :
+			     dma_buf_begin_cpu_access(dmabuf, direction);
+
+	ranges = u64_to_user_ptr(sync.ranges);
+	for (i = 0; i < sync.nr_ranges; i++) {
+		if (copy_from_user(&range, &ranges[i], sizeof(range)))
+			return -EFAULT;
+
+		if (!range.length || range.offset >= dmabuf->size ||
+		    range.length > dmabuf->size - range.offset)
+			return -EINVAL;
+
+		if (end)
+			ret = dma_buf_end_cpu_access_partial(dmabuf, direction,
+					range.offset, range.length);
+		else
+			ret = dma_buf_begin_cpu_access_partial(dmabuf,
+					direction, range.offset, range.length);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
 static long dma_buf_ioctl(struct file *file,
 			  unsigned int cmd, unsigned long arg)
 {
@@ -269,22 +344,9 @@ static long dma_buf_ioctl(struct file *file,
 		if (copy_from_user(&sync, (void __user *) arg, sizeof(sync)))
 			return -EFAULT;
 
-		if (sync.flags & ~DMA_BUF_SYNC_VALID_FLAGS_MASK)
-			return -EINVAL;
-
-		switch (sync.flags & DMA_BUF_SYNC_RW) {
-		case DMA_BUF_SYNC_READ:
-			direction = DMA_FROM_DEVICE;
-			break;
-		case DMA_BUF_SYNC_WRITE:
-			direction = DMA_TO_DEVICE;
-			break;
-		case DMA_BUF_SYNC_RW:
-			direction = DMA_BIDIRECTIONAL;
-			break;
-		default:
-			return -EINVAL;
-		}
+		ret = dma_buf_sync_direction(sync.flags, &direction);
+		if (ret)
+			return ret;
 
 		if (sync.flags & DMA_BUF_SYNC_END)
 			ret = dma_buf_end_cpu_access(dmabuf, direction);
@@ -292,6 +354,8 @@ static long dma_buf_ioctl(struct file *file,
 			ret = dma_buf_begin_cpu_access(dmabuf, direction);
 
 		return ret;
+	case DMA_BUF_IOCTL_SYNC_PARTIAL:
+		return dma_buf_ioctl_sync_partial(dmabuf, arg);
 	default:
 		return -ENOTTY;
 	}
@@ -662,6 +726,69 @@ int dma_buf_end_cpu_access(struct dma_buf *dmabuf,
 }
 EXPORT_SYMBOL_GPL(dma_buf_end_cpu_access);
 
+/**
+ * dma_buf_begin_cpu_access_partial - Must be called before accessing part of
+ * a dma_buf from the cpu. Like dma_buf_begin_cpu_access, but coherency is only
+ * guaranteed in the given byte range. Falls back to preparing the whole buffer
+ * if the exporter cannot do ranges.
+ * @dmabuf:	[in]	buffer to prepare cpu access for.
+ * @direction:	[in]	direction of cpu access.
+ * @offset:	[in]	offset of the range in bytes.
+ * @len:	[in]	length of the range in bytes.
+ *
+ * Can return negative error values, returns 0 on success.
+ */
+int dma_buf_begin_cpu_access_partial(struct dma_buf *dmabuf,
+				     enum dma_data_direction direction,
+				     unsigned int offset, unsigned int len)
+{
+	int ret = -EOPNOTSUPP;
+
+	if (WARN_ON(!dmabuf))
+		return -EINVAL;
+
+	if (dmabuf->ops->begin_cpu_access_partial)
+		ret = dmabuf->ops->begin_cpu_access_partial(dmabuf, direction,
+							    offset, len);
+	if (ret == -EOPNOTSUPP)
+		return dma_buf_begin_cpu_access(dmabuf, direction);
+
+	if (ret == 0)
+		ret = __dma_buf_begin_cpu_access(dmabuf, direction);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(dma_buf_begin_cpu_access_partial);
+
+/**
+ * dma_buf_end_cpu_access_partial - Must be called after accessing part of a
+ * dma_buf from the cpu. Like dma_buf_end_cpu_access, but only for the given
+ * byte range. Falls back to the whole buffer if the exporter cannot do ranges.
+ * @dmabuf:	[in]	buffer to complete cpu access for.
+ * @direction:	[in]	direction of cpu access.
+ * @offset:	[in]	offset of the range in bytes.
+ * @len:	[in]	length of the range in bytes.
+ *
+ * Can return negative error values, returns 0 on success.
+ */
+int dma_buf_end_cpu_access_partial(struct dma_buf *dmabuf,
+				   enum dma_data_direction direction,
+				   unsigned int offset, unsigned int len)
+{
+	int ret = -EOPNOTSUPP;
+
+	WARN_ON(!dmabuf);
+
+	if (dmabuf->ops->end_cpu_access_partial)
+		ret = dmabuf->ops->end_cpu_access_partial(dmabuf, direction,
+							  offset, len);
+	if (ret == -EOPNOTSUPP)
+		return dma_buf_end_cpu_access(dmabuf, direction);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(dma_buf_end_cpu_access_partial);
+
 /**
  * dma_buf_kmap_atomic - Map a page of the buffer object into kernel address
  * space. The same restrictions as for kmap_atomic and friends apply.
@@ -52,6 +52,14 @@ static bool fence_array_enable_signaling(struct fence *fence)
 
 	for (i = 0; i < array->num_fences; ++i) {
 		cb[i].array = array;
+
+		/* No need to take the child's lock for a fence that is done */
+		if (fence_is_signaled(array->fences[i])) {
+			if (atomic_dec_and_test(&array->num_pending))
+				return false;
+			continue;
+		}
+
 		/*
 		 * As we may report that the fence is signaled before all
 		 * callbacks are complete, we need to take an additional
@@ -15,49 +15,91 @@
  */
 
 #include <linux/debugfs.h>
+#include <linux/moduleparam.h>
+#include <linux/percpu.h>
 #include "sync_debug.h"
 
 static struct dentry *dbgfs;
 
-static LIST_HEAD(sync_timeline_list_head);
-static DEFINE_SPINLOCK(sync_timeline_list_lock);
-static LIST_HEAD(sync_file_list_head);
-static DEFINE_SPINLOCK(sync_file_list_lock);
+#ifdef CONFIG_SW_SYNC_DEBUG
 
-void sync_timeline_debug_add(struct sync_timeline *obj)
+/*
+ * The objects are kept on a list of the cpu they were created on so that
+ * creating and destroying them on different cpus doesn't bounce a global
+ * lock around. Only the debugfs reader walks all of the lists.
+ */
+struct sync_debug_list {
+	spinlock_t lock;
+	struct list_head head;
+};
+
+static DEFINE_PER_CPU(struct sync_debug_list, sync_timeline_lists);
+static DEFINE_PER_CPU(struct sync_debug_list, sync_file_lists);
+
+/* Objects created while this is off are never tracked */
+static bool sync_debug_track = true;
+module_param_named(track, sync_debug_track, bool, 0644);
+
+static int sync_debug_list_add(struct sync_debug_list __percpu *lists,
+			       struct list_head *node)
 {
+	struct sync_debug_list *list;
 	unsigned long flags;
+	int cpu;
+
+	if (!READ_ONCE(sync_debug_track)) {
+		INIT_LIST_HEAD(node);
+		return -1;
+	}
+
+	cpu = get_cpu();
+	list = per_cpu_ptr(lists, cpu);
+	spin_lock_irqsave(&list->lock, flags);
+	list_add_tail(node, &list->head);
+	spin_unlock_irqrestore(&list->lock, flags);
+	put_cpu();
 
-	spin_lock_irqsave(&sync_timeline_list_lock, flags);
-	list_add_tail(&obj->sync_timeline_list, &sync_timeline_list_head);
-	spin_unlock_irqrestore(&sync_timeline_list_lock, flags);
+	return cpu;
 }
 
-void sync_timeline_debug_remove(struct sync_timeline *obj)
+static void sync_debug_list_remove(struct sync_debug_list __percpu *lists,
+				   struct list_head *node, int cpu)
 {
+	struct sync_debug_list *list;
 	unsigned long flags;
 
-	spin_lock_irqsave(&sync_timeline_list_lock, flags);
-	list_del(&obj->sync_timeline_list);
-	spin_unlock_irqrestore(&sync_timeline_list_lock, flags);
+	if (cpu < 0)
+		return;
+
+	list = per_cpu_ptr(lists, cpu);
+	spin_lock_irqsave(&list->lock, flags);
+	list_del(node);
+	spin_unlock_irqrestore(&list->lock, flags);
 }
 
-void sync_file_debug_add(struct sync_file *sync_file)
+void sync_timeline_debug_add(struct sync_timeline *obj)
 {
-	unsigned long flags;
+	obj->debug_cpu = sync_debug_list_add(&sync_timeline_lists,
+					     &obj->sync_timeline_list);
+}
 
-	spin_lock_irqsave(&sync_file_list_lock, flags);
-	list_add_tail(&sync_file->sync_file_list, &sync_file_list_head);
-	spin_unlock_irqrestore(&sync_file_list_lock, flags);
+void sync_timeline_debug_remove(struct sync_timeline *obj)
+{
+	sync_debug_list_remove(&sync_timeline_lists,
+			       &obj->sync_timeline_list, obj->debug_cpu);
 }
 
-void sync_file_debug_remove(struct sync_file *sync_file)
+void sync_file_debug_add(struct sync_file *sync_file)
 {
-	unsigned long flags;
+	sync_file->debug_cpu = sync_debug_list_add(&sync_file_lists,
+						   &sync_file->sync_file_list);
+}
 
-	spin_lock_irqsave(&sync_file_list_lock, flags);
-	list_del(&sync_file->sync_file_list);
-	spin_unlock_irqrestore(&sync_file_list_lock, flags);
+void sync_file_debug_remove(struct sync_file *sync_file)
+{
+	sync_debug_list_remove(&sync_file_lists,
+			       &sync_file->sync_file_list,
+			       sync_file->debug_cpu);
 }
 
 static const char *sync_status_str(int status)
@@ -147,32 +189,44 @@ static void sync_print_sync_file(struct seq_file *s,
 
 static int sync_debugfs_show(struct seq_file *s, void *unused)
 {
+	struct sync_debug_list *list;
 	struct list_head *pos;
+	int cpu;
 
 	seq_puts(s, "objs:\n--------------\n");
 
-	spin_lock_irq(&sync_timeline_list_lock);
-	list_for_each(pos, &sync_timeline_list_head) {
-		struct sync_timeline *obj =
-			container_of(pos, struct sync_timeline,
-				     sync_timeline_list);
+	for_each_possible_cpu(cpu) {
+		list = per_cpu_ptr(&sync_timeline_lists, cpu);
+
+		spin_lock_irq(&list->lock);
+		list_for_each(pos, &list->head) {
+			struct sync_timeline *obj =
+				container_of(pos, struct sync_timeline,
+					     sync_timeline_list);
 
-		sync_print_obj(s, obj);
-		seq_puts(s, "\n");
+			sync_print_obj(s, obj);
+			seq_puts(s, "\n");
+		}
+		spin_unlock_irq(&list->lock);
 	}
-	spin_unlock_irq(&sync_timeline_list_lock);
 
 	seq_puts(s, "fences:\n--------------\n");
 
-	spin_lock_irq(&sync_file_list_lock);
-	list_for_each(pos, &sync_file_list_head) {
-		struct sync_file *sync_file =
-			container_of(pos, struct sync_file, sync_file_list);
+	for_each_possible_cpu(cpu) {
+		list = per_cpu_ptr(&sync_file_lists, cpu);
+
+		spin_lock_irq(&list->lock);
+		list_for_each(pos, &list->head) {
+			struct sync_file *sync_file =
+				container_of(pos, struct sync_file,
+					     sync_file_list);
 
-		sync_print_sync_file(s, sync_file);
-		seq_puts(s, "\n");
+			sync_print_sync_file(s, sync_file);
+			seq_puts(s, "\n");
+		}
+		spin_unlock_irq(&list->lock);
 	}
-	spin_unlock_irq(&sync_file_list_lock);
+
 	return 0;
 }
 
@@ -188,6 +242,27 @@ static const struct file_operations sync_info_debugfs_fops = {
 	.release        = single_release,
 };
 
+static __init int sync_debug_lists_init(void)
+{
+	struct sync_debug_list *list;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		list = per_cpu_ptr(&sync_timeline_lists, cpu);
+		spin_lock_init(&list->lock);
+		INIT_LIST_HEAD(&list->head);
+
+		list = per_cpu_ptr(&sync_file_lists, cpu);
+		spin_lock_init(&list->lock);
+		INIT_LIST_HEAD(&list->head);
+	}
+
+	return 0;
+}
+core_initcall(sync_debug_lists_init);
+
+#endif /* CONFIG_SW_SYNC_DEBUG */
+
 static __init int sync_debugfs_init(void)
 {
 	dbgfs = debugfs_create_dir("sync", NULL);
@@ -197,8 +272,10 @@ static __init int sync_debugfs_init(void)
 	 * no need to protect it against removal races. The use of
 	 * debugfs_create_file_unsafe() is actually safe here.
 	 */
+#ifdef CONFIG_SW_SYNC_DEBUG
 	debugfs_create_file_unsafe("info", 0444, dbgfs, NULL,
 				   &sync_info_debugfs_fops);
+#endif
 	debugfs_create_file_unsafe("sw_sync", 0644, dbgfs, NULL,
 				   &sw_sync_debugfs_fops);
 
@@ -206,6 +283,8 @@ static __init int sync_debugfs_init(void)
 }
 late_initcall(sync_debugfs_init);
 
+#ifdef CONFIG_SW_SYNC_DEBUG
+
 #define DUMP_CHUNK 256
 static char sync_dump_buf[64 * 1024];
 void sync_dump(void)
@@ -231,3 +310,4 @@ void sync_dump(void)
 		}
 	}
 }
+#endif
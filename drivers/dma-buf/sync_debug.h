@@ -28,7 +28,8 @@
  * @lock:		lock protecting @pt_list and @value
  * @pt_tree:		rbtree of active (unsignaled/errored) sync_pts
  * @pt_list:		list of active (unsignaled/errored) sync_pts
- * @sync_timeline_list:	membership in global sync_timeline_list
+ * @sync_timeline_list:	membership in a per-cpu sync_timeline_list
+ * @debug_cpu:		cpu whose list holds the timeline, -1 if untracked
  */
 struct sync_timeline {
 	struct kref		kref;
@@ -43,6 +44,7 @@ struct sync_timeline {
 	spinlock_t		lock;
 
 	struct list_head	sync_timeline_list;
+	int			debug_cpu;
 };
 
 static inline struct sync_timeline *fence_parent(struct fence *fence)
@@ -63,8 +65,10 @@ struct sync_pt {
 };
 
 #ifdef CONFIG_SW_SYNC
-
 extern const struct file_operations sw_sync_debugfs_fops;
+#endif
+
+#ifdef CONFIG_SW_SYNC_DEBUG
 
 void sync_timeline_debug_add(struct sync_timeline *obj);
 void sync_timeline_debug_remove(struct sync_timeline *obj);
@@ -176,47 +176,34 @@ static struct fence **get_fences(struct sync_file *sync_file, int *num_fences)
 	return &sync_file->fence;
 }
 
-static void add_fence(struct fence **fences, int *i, struct fence *fence)
+/*
+ * Keep @fence if it is still pending. With @fences NULL only count it and
+ * remember it in @last, so a merge that ends up with a single fence needs
+ * no array at all.
+ */
+static void add_fence(struct fence **fences, int *i, struct fence *fence,
+		      struct fence **last)
 {
-	fences[*i] = fence;
+	if (fence_is_signaled(fence))
+		return;
 
-	if (!fence_is_signaled(fence)) {
-		fence_get(fence);
-		(*i)++;
-	}
+	if (fences)
+		fences[*i] = fence_get(fence);
+	else
+		*last = fence;
+	(*i)++;
 }
 
-/**
- * sync_file_merge() - merge two sync_files
- * @name:	name of new fence
- * @a:		sync_file a
- * @b:		sync_file b
- *
- * Creates a new sync_file which contains copies of all the fences in both
- * @a and @b.  @a and @b remain valid, independent sync_file. Returns the
- * new merged sync_file or NULL in case of error.
+/*
+ * Walk both fence lists the way sync_file_merge() combines them: by context,
+ * keeping the later of two fences on the same context and dropping signaled
+ * ones. Returns the number of fences kept.
  */
-static struct sync_file *sync_file_merge(const char *name, struct sync_file *a,
-					 struct sync_file *b)
+static int merge_fences(struct fence **a_fences, int a_num_fences,
+			struct fence **b_fences, int b_num_fences,
+			struct fence **fences, struct fence **last)
 {
-	struct sync_file *sync_file;
-	struct fence **fences, **nfences, **a_fences, **b_fences;
-	int i, i_a, i_b, num_fences, a_num_fences, b_num_fences;
-
-	sync_file = sync_file_alloc();
-	if (!sync_file)
-		return NULL;
-
-	a_fences = get_fences(a, &a_num_fences);
-	b_fences = get_fences(b, &b_num_fences);
-	if (a_num_fences > INT_MAX - b_num_fences)
-		goto err;
-
-	num_fences = a_num_fences + b_num_fences;
-
-	fences = kcalloc(num_fences, sizeof(*fences), GFP_KERNEL);
-	if (!fences)
-		goto err;
+	int i, i_a, i_b;
 
 	/*
 	 * Assume sync_file a and b are both ordered and have no
@@ -230,18 +217,18 @@ static struct sync_file *sync_file_merge(const char *name, struct sync_file *a,
 		struct fence *pt_b = b_fences[i_b];
 
 		if (pt_a->context < pt_b->context) {
-			add_fence(fences, &i, pt_a);
+			add_fence(fences, &i, pt_a, last);
 
 			i_a++;
 		} else if (pt_a->context > pt_b->context) {
-			add_fence(fences, &i, pt_b);
+			add_fence(fences, &i, pt_b, last);
 
 			i_b++;
 		} else {
 			if (pt_a->seqno - pt_b->seqno <= INT_MAX)
-				add_fence(fences, &i, pt_a);
+				add_fence(fences, &i, pt_a, last);
 			else
-				add_fence(fences, &i, pt_b);
+				add_fence(fences, &i, pt_b, last);
 
 			i_a++;
 			i_b++;
@@ -249,28 +236,70 @@ static struct sync_file *sync_file_merge(const char *name, struct sync_file *a,
 	}
 
 	for (; i_a < a_num_fences; i_a++)
-		add_fence(fences, &i, a_fences[i_a]);
+		add_fence(fences, &i, a_fences[i_a], last);
 
 	for (; i_b < b_num_fences; i_b++)
-		add_fence(fences, &i, b_fences[i_b]);
+		add_fence(fences, &i, b_fences[i_b], last);
 
-	if (i == 0)
-		fences[i++] = fence_get(a_fences[0]);
+	return i;
+}
 
-	if (num_fences > i) {
-		nfences = krealloc(fences, i * sizeof(*fences),
-				  GFP_KERNEL);
-		if (!nfences)
-			goto err;
+/**
+ * sync_file_merge() - merge two sync_files
+ * @name:	name of new fence
+ * @a:		sync_file a
+ * @b:		sync_file b
+ *
+ * Creates a new sync_file which contains copies of all the fences in both
+ * @a and @b.  @a and @b remain valid, independent sync_file. Returns the
+ * new merged sync_file or NULL in case of error.
+ */
+static struct sync_file *sync_file_merge(const char *name, struct sync_file *a,
+					 struct sync_file *b)
+{
+	struct sync_file *sync_file;
+	struct fence **fences, **a_fences, **b_fences, *last = NULL;
+	int i, num_fences, a_num_fences, b_num_fences;
+
+	sync_file = sync_file_alloc();
+	if (!sync_file)
+		return NULL;
+
+	a_fences = get_fences(a, &a_num_fences);
+	b_fences = get_fences(b, &b_num_fences);
+	if (a_num_fences > INT_MAX - b_num_fences)
+		goto err;
 
-		fences = nfences;
+	/*
+	 * Count first. Merging with a signaled fence, or with a fence on the
+	 * same timeline, often leaves a single fence that the new sync_file
+	 * can hold directly.
+	 */
+	num_fences = merge_fences(a_fences, a_num_fences, b_fences,
+				  b_num_fences, NULL, &last);
+	if (num_fences <= 1) {
+		sync_file->fence = fence_get(last ? last : a_fences[0]);
+		goto done;
 	}
 
+	fences = kcalloc(num_fences, sizeof(*fences), GFP_KERNEL);
+	if (!fences)
+		goto err;
+
+	/* Fences only ever become signaled, so this can only keep fewer */
+	i = merge_fences(a_fences, a_num_fences, b_fences, b_num_fences,
+			 fences, NULL);
+	if (i == 0)
+		fences[i++] = fence_get(a_fences[0]);
+
 	if (sync_file_set_fence(sync_file, fences, i) < 0) {
+		for (num_fences = 0; num_fences < i; num_fences++)
+			fence_put(fences[num_fences]);
 		kfree(fences);
 		goto err;
 	}
 
+done:
 	strlcpy(sync_file->name, name, sizeof(sync_file->name));
 	return sync_file;
 
@@ -441,6 +470,127 @@ static long sync_file_ioctl_fence_info(struct sync_file *sync_file,
 	return ret;
 }
 
+#define SYNC_WAIT_MAX_FDS	256
+#define SYNC_WAIT_STACK_FDS	8
+
+static long sync_wait_any(struct fence **fences, int num_fences,
+			  signed long timeout, struct sync_wait_data *data)
+{
+	signed long ret;
+	int i;
+
+	for (;;) {
+		/* Most fences handed to a wait are done, check them for free */
+		for (i = 0; i < num_fences; i++) {
+			if (fence_is_signaled(fences[i])) {
+				data->index = i;
+				data->status = fence_get_status(fences[i]);
+				return 0;
+			}
+		}
+
+		if (!timeout)
+			return -ETIME;
+
+		ret = fence_wait_any_timeout(fences, num_fences, true, timeout);
+		if (ret < 0)
+			return ret;
+		if (ret == 0)
+			return -ETIME;
+		timeout = ret;
+	}
+}
+
+static long sync_wait_all(struct fence **fences, int num_fences,
+			  signed long timeout, struct sync_wait_data *data)
+{
+	signed long ret;
+	int i, status;
+
+	data->status = 1;
+
+	for (i = 0; i < num_fences; i++) {
+		if (!fence_is_signaled(fences[i])) {
+			if (!timeout)
+				return -ETIME;
+
+			ret = fence_wait_timeout(fences[i], true, timeout);
+			if (ret < 0)
+				return ret;
+			if (ret == 0)
+				return -ETIME;
+			timeout = ret;
+		}
+
+		status = fence_get_status(fences[i]);
+		if (status < 0 && data->status == 1)
+			data->status = status;
+	}
+
+	return 0;
+}
+
+static long sync_file_ioctl_wait(unsigned long arg)
+{
+	struct fence *stack_fences[SYNC_WAIT_STACK_FDS], **fences;
+	struct sync_wait_data data;
+	s32 __user *ufds;
+	signed long timeout;
+	int i, n = 0;
+	long ret;
+
+	if (copy_from_user(&data, (void __user *)arg, sizeof(data)))
+		return -EFAULT;
+
+	if ((data.flags & ~SYNC_WAIT_ANY) || data.pad || !data.num_fds ||
+	    data.num_fds > SYNC_WAIT_MAX_FDS)
+		return -EINVAL;
+
+	fences = stack_fences;
+	if (data.num_fds > ARRAY_SIZE(stack_fences)) {
+		fences = kcalloc(data.num_fds, sizeof(*fences), GFP_KERNEL);
+		if (!fences)
+			return -ENOMEM;
+	}
+
+	ufds = u64_to_user_ptr(data.fds);
+	for (n = 0; n < data.num_fds; n++) {
+		s32 fd;
+
+		if (get_user(fd, ufds + n)) {
+			ret = -EFAULT;
+			goto out;
+		}
+
+		fences[n] = sync_file_get_fence(fd);
+		if (!fences[n]) {
+			ret = -ENOENT;
+			goto out;
+		}
+	}
+
+	timeout = data.timeout_ms < 0 ? MAX_SCHEDULE_TIMEOUT :
+			msecs_to_jiffies(data.timeout_ms);
+	data.index = -1;
+	data.status = 0;
+
+	if (data.flags & SYNC_WAIT_ANY)
+		ret = sync_wait_any(fences, n, timeout, &data);
+	else
+		ret = sync_wait_all(fences, n, timeout, &data);
+
+	if (!ret && copy_to_user((void __user *)arg, &data, sizeof(data)))
+		ret = -EFAULT;
+
+out:
+	for (i = 0; i < n; i++)
+		fence_put(fences[i]);
+	if (fences != stack_fences)
+		kfree(fences);
+
+	return ret;
+}
+
 static long sync_file_ioctl(struct file *file, unsigned int cmd,
 			    unsigned long arg)
 {
@@ -453,6 +603,9 @@ static long sync_file_ioctl(struct file *file, unsigned int cmd,
 	case SYNC_IOC_FILE_INFO:
 		return sync_file_ioctl_fence_info(sync_file, arg);
 
+	case SYNC_IOC_WAIT:
+		return sync_file_ioctl_wait(arg);
+
 	default:
 		return -ENOTTY;
 	}
@@ -805,6 +805,15 @@
 #define A6XX_VBIF_PERF_PWR_CNT_HIGH1            0x3119
 #define A6XX_VBIF_PERF_PWR_CNT_HIGH2            0x311a
 
+/* COUNTABLE FOR CP PERFCOUNTER */
+#define A6XX_CP_BUSY_CYCLES                0x2
+
+/* COUNTABLE FOR SP PERFCOUNTER */
+#define A6XX_SP_ALU_ACTIVE_CYCLES          0x1
+
+/* COUNTABLE FOR TP PERFCOUNTER */
+#define A6XX_TP_BUSY_CYCLES                0x0
+
 /* GBIF countables */
 #define GBIF_AXI0_READ_DATA_TOTAL_BEATS    34
 #define GBIF_AXI1_READ_DATA_TOTAL_BEATS    35
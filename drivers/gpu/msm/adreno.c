@@ -1430,6 +1430,7 @@ static int adreno_probe(struct platform_device *pdev)
 	adreno_dev->perfcounter = false;
 
 	adreno_sysfs_init(adreno_dev);
+	adreno_sample_init(adreno_dev);
 
 	kgsl_pwrscale_init(&pdev->dev, CONFIG_QCOM_ADRENO_DEFAULT_GOVERNOR);
 
@@ -1523,6 +1524,7 @@ static int adreno_remove(struct platform_device *pdev)
 	if (adreno_input_handler.private)
 		input_unregister_handler(&adreno_input_handler);
 #endif
+	adreno_sample_close(adreno_dev);
 	adreno_sysfs_close(adreno_dev);
 
 	adreno_coresight_remove(adreno_dev);
@@ -1909,6 +1911,20 @@ static int _adreno_start(struct adreno_device *adreno_dev)
 		}
 	}
 
+	/* Shader ALU activity, used by frame based DCVS (same countable on A5XX) */
+	if (adreno_dev->perfctr_alu_lo == 0 &&
+		(adreno_is_a5xx(adreno_dev) || adreno_is_a6xx(adreno_dev))) {
+		ret = adreno_perfcounter_get(adreno_dev,
+			KGSL_PERFCOUNTER_GROUP_SP, A6XX_SP_ALU_ACTIVE_CYCLES,
+			&adreno_dev->perfctr_alu_lo, NULL,
+			PERFCOUNTER_FLAG_KERNEL);
+
+		if (ret) {
+			KGSL_DRV_ERR(device,
+				"Unable to get perf counters for frame DCVS\n");
+			adreno_dev->perfctr_alu_lo = 0;
+		}
+	}
 
 	if (device->pwrctrl.bus_control) {
 		/* VBIF waiting for RAM */
@@ -2015,6 +2031,8 @@ static int _adreno_start(struct adreno_device *adreno_dev)
 		}
 	}
 
+	adreno_sample_start(adreno_dev);
+
 	/* Clear the busy_data stats - we're starting over from scratch */
 	adreno_dev->busy_data.gpu_busy = 0;
 	adreno_dev->busy_data.bif_ram_cycles = 0;
@@ -2024,6 +2042,7 @@ static int _adreno_start(struct adreno_device *adreno_dev)
 	adreno_dev->busy_data.bif_starved_ram = 0;
 	adreno_dev->busy_data.bif_starved_ram_ch1 = 0;
 	adreno_dev->busy_data.num_ifpc = 0;
+	adreno_dev->busy_data.alu_busy = 0;
 
 	/* Restore performance counter registers with saved values */
 	adreno_perfcounter_restore(adreno_dev);
@@ -2926,6 +2945,7 @@ int adreno_soft_reset(struct kgsl_device *device)
 	adreno_dev->busy_data.bif_ram_cycles_write_ch1 = 0;
 	adreno_dev->busy_data.bif_starved_ram = 0;
 	adreno_dev->busy_data.bif_starved_ram_ch1 = 0;
+	adreno_dev->busy_data.alu_busy = 0;
 
 	/* Set the page table back to the default page table */
 	adreno_ringbuffer_set_global(adreno_dev, 0);
@@ -3630,6 +3650,16 @@ static void adreno_power_stats(struct kgsl_device *device,
 		stats->ram_wait = starved_ram;
 	}
 
+	if (adreno_dev->perfctr_alu_lo != 0) {
+		uint32_t alu_busy;
+
+		alu_busy = counter_delta(device, adreno_dev->perfctr_alu_lo,
+				&busy->alu_busy);
+		/* the SP counters run on the GPU core clock */
+		stats->alu_time = adreno_ticks_to_us(alu_busy,
+			kgsl_pwrctrl_active_freq(pwr));
+	}
+
 	if (adreno_dev->perfctr_ifpc_lo != 0) {
 		uint32_t num_ifpc;
 
@@ -3840,6 +3870,7 @@ static const struct kgsl_functable adreno_functable = {
 	.waittimestamp = adreno_waittimestamp,
 	.readtimestamp = adreno_readtimestamp,
 	.queue_cmds = adreno_dispatcher_queue_cmds,
+	.queue_cmds_batch = adreno_dispatcher_queue_cmds_batch,
 	.ioctl = adreno_ioctl,
 	.compat_ioctl = adreno_compat_ioctl,
 	.power_stats = adreno_power_stats,
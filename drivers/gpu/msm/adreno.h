@@ -22,6 +22,7 @@
 #include "adreno_dispatch.h"
 #include "kgsl_iommu.h"
 #include "adreno_perfcounter.h"
+#include "adreno_sample.h"
 #include <linux/stat.h>
 #include <linux/delay.h>
 #include "kgsl_gmu.h"
@@ -292,6 +293,12 @@ enum adreno_preempt_states {
  * usesgmem: enable GMEM save/restore across preemption (for 6XX)
  * count: Track the number of preemptions triggered
  * @postamble_len: Number of dwords in KMD postamble pm4 packet
+ * @trigger_time: Time in ns the last preemption was triggered
+ * @slice_pending: True if the next preemption ends a used up time slice
+ * @slice_count: Number of preemptions triggered by time slicing
+ * @done_count: Number of completed preemptions
+ * @latency_total: Sum of the trigger to completion times in ns
+ * @latency_max: Longest trigger to completion time in ns
  */
 struct adreno_preemption {
 	atomic_t state;
@@ -304,6 +311,12 @@ struct adreno_preemption {
 	bool usesgmem;
 	unsigned int count;
 	u32 postamble_len;
+	uint64_t trigger_time;
+	bool slice_pending;
+	unsigned int slice_count;
+	unsigned int done_count;
+	uint64_t latency_total;
+	uint64_t latency_max;
 };
 
 
@@ -316,6 +329,7 @@ struct adreno_busy_data {
 	unsigned int bif_starved_ram;
 	unsigned int bif_starved_ram_ch1;
 	unsigned int num_ifpc;
+	unsigned int alu_busy;
 	unsigned int throttle_cycles[ADRENO_GPMU_THROTTLE_COUNTERS];
 };
 
@@ -459,6 +473,7 @@ enum gpu_coresight_sources {
  * @ft_pf_policy: Defines the fault policy for page faults
  * @ocmem_hdl: Handle to the ocmem allocated buffer
  * @profile: Container for adreno profiler information
+ * @sample: Always-on counter sampling of command objs
  * @dispatcher: Container for adreno GPU dispatcher
  * @pwron_fixup: Command buffer to run a post-power collapse shader workaround
  * @pwron_fixup_dwords: Number of dwords in the command buffer
@@ -477,6 +492,7 @@ enum gpu_coresight_sources {
  * @starved_ram_lo_ch1: Number of cycles GBIF is stalled by DDR channel 1
  * @perfctr_pwr_lo: GPU busy cycles
  * @perfctr_ifpc_lo: IFPC count
+ * @perfctr_alu_lo: Shader ALU active cycles
  * @halt: Atomic variable to check whether the GPU is currently halted
  * @pending_irq_refcnt: Atomic variable to keep track of running IRQ handlers
  * @ctx_d_debugfs: Context debugfs node
@@ -534,6 +550,7 @@ struct adreno_device {
 	unsigned long ft_pf_policy;
 	struct ocmem_buf *ocmem_hdl;
 	struct adreno_profile profile;
+	struct adreno_sample sample;
 	struct adreno_dispatcher dispatcher;
 	struct kgsl_memdesc pwron_fixup;
 	unsigned int pwron_fixup_dwords;
@@ -547,6 +564,7 @@ struct adreno_device {
 	unsigned int starved_ram_lo_ch1;
 	unsigned int perfctr_pwr_lo;
 	unsigned int perfctr_ifpc_lo;
+	unsigned int perfctr_alu_lo;
 	atomic_t halt;
 	atomic_t pending_irq_refcnt;
 	struct dentry *ctx_d_debugfs;
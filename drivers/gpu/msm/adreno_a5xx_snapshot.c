@@ -959,11 +959,18 @@ void a5xx_snapshot(struct adreno_device *adreno_dev,
 	kgsl_snapshot_add_section(device, KGSL_SNAPSHOT_SECTION_DEBUG,
 		snapshot, a5xx_snapshot_cp_pm4, NULL);
 
-	/* Shader memory */
-	a5xx_snapshot_shader(device, snapshot);
+	/*
+	 * Shader memory and the debug bus are the slowest sections to collect
+	 * and are skipped for a fast snapshot, they can't be collected after
+	 * the GPU recovers so they are dropped rather than deferred.
+	 */
+	if (!snapshot->fast) {
+		/* Shader memory */
+		a5xx_snapshot_shader(device, snapshot);
 
-	/* Debug bus */
-	a5xx_snapshot_debugbus(device, snapshot);
+		/* Debug bus */
+		a5xx_snapshot_debugbus(device, snapshot);
+	}
 
 	/* Preemption record */
 	if (adreno_is_preemption_enabled(adreno_dev)) {
@@ -135,6 +135,7 @@ static void _a6xx_preemption_done(struct adreno_device *adreno_dev)
 	/* Clean up all the bits */
 	adreno_dev->prev_rb = adreno_dev->cur_rb;
 	adreno_dev->cur_rb = adreno_dev->next_rb;
+	adreno_dispatcher_preempt_done(adreno_dev);
 	adreno_dev->next_rb = NULL;
 
 	/* Update the wptr for the new command queue */
@@ -211,7 +212,10 @@ static void _a6xx_preemption_timer(unsigned long data)
 	queue_work(system_unbound_wq, &adreno_dev->preempt.work);
 }
 
-/* Find the highest priority active ringbuffer */
+/*
+ * Find the active ringbuffer with the earliest deadline if deadline scheduling
+ * is enabled, otherwise the highest priority active ringbuffer
+ */
 static struct adreno_ringbuffer *a6xx_next_ringbuffer(
 		struct adreno_device *adreno_dev)
 {
@@ -219,6 +223,14 @@ static struct adreno_ringbuffer *a6xx_next_ringbuffer(
 	unsigned long flags;
 	unsigned int i;
 
+	rb = adreno_dispatcher_deadline_ringbuffer(adreno_dev);
+	if (rb != NULL)
+		return rb;
+
+	rb = adreno_dispatcher_slice_ringbuffer(adreno_dev);
+	if (rb != NULL)
+		return rb;
+
 	FOR_EACH_RINGBUFFER(adreno_dev, rb, i) {
 		bool empty;
 
@@ -421,6 +433,7 @@ void a6xx_preemption_trigger(struct adreno_device *adreno_dev)
 		cntl);
 
 	adreno_set_preempt_state(adreno_dev, ADRENO_PREEMPT_TRIGGERED);
+	adreno_dispatcher_preempt_triggered(adreno_dev);
 
 	/* Trigger the preemption */
 	adreno_gmu_fenced_write(adreno_dev, ADRENO_REG_CP_PREEMPT, cntl,
@@ -468,6 +481,7 @@ void a6xx_preemption_callback(struct adreno_device *adreno_dev, int bit)
 
 	adreno_dev->prev_rb = adreno_dev->cur_rb;
 	adreno_dev->cur_rb = adreno_dev->next_rb;
+	adreno_dispatcher_preempt_done(adreno_dev);
 	adreno_dev->next_rb = NULL;
 
 	/* Update the wptr if it changed while preemption was ongoing */
@@ -1574,9 +1574,12 @@ void a6xx_snapshot(struct adreno_device *adreno_dev,
 	 * GMU and GPU snapshot. Debugbus data can be accessed
 	 * even if the gx headswitch or sptprac is off. If gx
 	 * headswitch is off, data for gx blocks will show as
-	 * 0x5c00bd00.
+	 * 0x5c00bd00. A fast snapshot skips it along with the other slow
+	 * debug sections below, they can't be collected after the GPU
+	 * recovers so they are dropped rather than deferred.
 	 */
-	a6xx_snapshot_debugbus(device, snapshot);
+	if (!snapshot->fast)
+		a6xx_snapshot_debugbus(device, snapshot);
 
 	sptprac_on = gpudev->sptprac_is_on(adreno_dev);
 
@@ -1618,9 +1621,10 @@ void a6xx_snapshot(struct adreno_device *adreno_dev,
 		0, 0x100);
 
 	 /* SQE_UCODE Cache */
-	kgsl_snapshot_indexed_registers(device, snapshot,
-		A6XX_CP_SQE_UCODE_DBG_ADDR, A6XX_CP_SQE_UCODE_DBG_DATA,
-		0, 0x6000);
+	if (!snapshot->fast)
+		kgsl_snapshot_indexed_registers(device, snapshot,
+			A6XX_CP_SQE_UCODE_DBG_ADDR, A6XX_CP_SQE_UCODE_DBG_DATA,
+			0, 0x6000);
 
 	/* CP ROQ */
 	kgsl_snapshot_add_section(device, KGSL_SNAPSHOT_SECTION_DEBUG,
@@ -1631,6 +1635,9 @@ void a6xx_snapshot(struct adreno_device *adreno_dev,
 	kgsl_snapshot_add_section(device, KGSL_SNAPSHOT_SECTION_DEBUG,
 		snapshot, a6xx_snapshot_sqe, NULL);
 
+	if (snapshot->fast)
+		return;
+
 	/* Mempool debug data */
 	a6xx_snapshot_mempool(device, snapshot);
 
@@ -122,6 +122,40 @@ static int _active_count_get(void *data, u64 *val)
 
 DEFINE_SIMPLE_ATTRIBUTE(_active_count_fops, _active_count_get, NULL, "%llu\n");
 
+static int _preempt_print(struct seq_file *s, void *unused)
+{
+	struct adreno_device *adreno_dev = s->private;
+	struct adreno_preemption *preempt = &adreno_dev->preempt;
+	struct adreno_ringbuffer *rb;
+	unsigned int i;
+
+	seq_printf(s, "triggered: %u done: %u time slice: %u\n",
+		   preempt->count, preempt->done_count, preempt->slice_count);
+	seq_printf(s, "latency: avg: %llu us max: %llu us\n",
+		   preempt->done_count ? div_u64(div_u64(preempt->latency_total,
+			preempt->done_count), NSEC_PER_USEC) : 0,
+		   div_u64(preempt->latency_max, NSEC_PER_USEC));
+
+	FOR_EACH_RINGBUFFER(adreno_dev, rb, i)
+		seq_printf(s, "rb %u: switched in: %u run time: %u ms\n",
+			   rb->id, rb->switched_in,
+			   jiffies_to_msecs(rb->run_time));
+
+	return 0;
+}
+
+static int _preempt_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, _preempt_print, inode->i_private);
+}
+
+static const struct file_operations _preempt_fops = {
+	.open = _preempt_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 typedef void (*reg_read_init_t)(struct kgsl_device *device);
 typedef void (*reg_read_fill_t)(struct kgsl_device *device, int i,
 	unsigned int *vals, int linec);
@@ -304,6 +338,22 @@ static int ctx_print(struct seq_file *s, void *unused)
 		   queued, consumed, retired,
 		   drawctxt->internal_timestamp);
 
+	seq_printf(s, "deadlines: met: %u missed: %u max late: %llu us\n",
+		   drawctxt->deadline_met, drawctxt->deadline_missed,
+		   div_u64(drawctxt->deadline_max_late, NSEC_PER_USEC));
+
+	seq_printf(s, "preempted: %u time: %u ms\n",
+		   drawctxt->slice_preempted,
+		   jiffies_to_msecs(drawctxt->slice_time));
+
+	seq_printf(s, "samples: ticks: %llu busy: %llu alu: %llu tex: %llu ram rd: %llu ram wr: %llu\n",
+		   drawctxt->sample_total[KGSL_GPU_SAMPLE_TICKS],
+		   drawctxt->sample_total[KGSL_GPU_SAMPLE_BUSY],
+		   drawctxt->sample_total[KGSL_GPU_SAMPLE_ALU],
+		   drawctxt->sample_total[KGSL_GPU_SAMPLE_TEX],
+		   drawctxt->sample_total[KGSL_GPU_SAMPLE_RAM_RD],
+		   drawctxt->sample_total[KGSL_GPU_SAMPLE_RAM_WR]);
+
 	seq_puts(s, "drawqueue:\n");
 
 	spin_lock(&drawctxt->lock);
@@ -393,4 +443,8 @@ void adreno_debugfs_init(struct adreno_device *adreno_dev)
 	if (adreno_is_a5xx(adreno_dev))
 		debugfs_create_file("isdb", 0644, device->d_debugfs,
 			device, &_isdb_fops);
+
+	if (ADRENO_FEATURE(adreno_dev, ADRENO_PREEMPTION))
+		debugfs_create_file("preempt", 0444, device->d_debugfs,
+			adreno_dev, &_preempt_fops);
 }
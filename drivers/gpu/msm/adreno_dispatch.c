@@ -41,6 +41,34 @@ unsigned int adreno_dispatch_time_slice = 25;
  */
 unsigned int adreno_disp_preempt_fair_sched;
 
+/*
+ * If set then the dispatcher services the pending context with the earliest
+ * command deadline first and preemption switches to the ringbuffer with the
+ * earliest inflight deadline. Work without a deadline keeps the priority order.
+ */
+unsigned int adreno_dispatch_deadline_sched;
+
+/*
+ * If set then a timestamp syncpoint on another context whose command already
+ * sits in a ringbuffer is turned into a CP wait on that context's memstore
+ * timestamp, so the dependent command is submitted without waiting for the
+ * CPU to see the dependency retire.
+ */
+unsigned int adreno_dispatch_gpu_wait;
+
+/*
+ * If set then a ringbuffer that has had the GPU for its quantum is preempted
+ * for the next ringbuffer with work in round robin order, and while inside
+ * its quantum it keeps the GPU even against higher priority ringbuffers.
+ * A quantum of 0 leaves that priority level to the usual priority order.
+ */
+unsigned int adreno_dispatch_preempt_slice;
+
+/* Time slice in ms of each ringbuffer priority level, highest first */
+static unsigned int _preempt_quanta[KGSL_PRIORITY_MAX_RB_LEVELS] = {
+	50, 25, 10, 10,
+};
+
 /* Number of commands that can be queued in a context before it sleeps */
 static unsigned int _context_drawqueue_size = 50;
 
@@ -269,13 +297,69 @@ static int fault_detect_read_compare(struct adreno_device *adreno_dev)
 	return ret;
 }
 
+/* Return the time slice in ms of @rb or 0 if it isn't time sliced */
+static unsigned int _rb_quantum(struct adreno_device *adreno_dev,
+		struct adreno_ringbuffer *rb)
+{
+	if (!adreno_dispatch_preempt_slice || rb == NULL ||
+		!adreno_is_preemption_enabled(adreno_dev))
+		return 0;
+
+	return READ_ONCE(_preempt_quanta[rb->id]);
+}
+
+/* Return the shortest time slice of any ringbuffer, 0 if none is sliced */
+static unsigned int _min_quantum(struct adreno_device *adreno_dev)
+{
+	struct adreno_ringbuffer *rb;
+	unsigned int i, quantum, ret = 0;
+
+	FOR_EACH_RINGBUFFER(adreno_dev, rb, i) {
+		quantum = _rb_quantum(adreno_dev, rb);
+		if (quantum && (!ret || quantum < ret))
+			ret = quantum;
+	}
+
+	return ret;
+}
+
+static bool _rb_has_work(struct adreno_ringbuffer *rb)
+{
+	unsigned long flags;
+	bool empty;
+
+	spin_lock_irqsave(&rb->preempt_lock, flags);
+	empty = adreno_rb_empty(rb);
+	spin_unlock_irqrestore(&rb->preempt_lock, flags);
+
+	return !empty;
+}
+
+/*
+ * The fault timer also hands on used up time slices so it runs at least once
+ * per quantum, hangs are still only checked every _fault_timer_interval
+ */
+static unsigned long _fault_timer_delay(struct adreno_device *adreno_dev)
+{
+	unsigned int ms = _fault_timer_interval;
+	unsigned int quantum = _min_quantum(adreno_dev);
+
+	if (quantum && quantum < ms)
+		ms = quantum;
+
+	return msecs_to_jiffies(ms);
+}
+
 static void start_fault_timer(struct adreno_device *adreno_dev)
 {
 	struct adreno_dispatcher *dispatcher = &adreno_dev->dispatcher;
 
-	if (adreno_soft_fault_detect(adreno_dev))
+	dispatcher->fault_check = jiffies +
+		msecs_to_jiffies(_fault_timer_interval);
+
+	if (adreno_soft_fault_detect(adreno_dev) || _min_quantum(adreno_dev))
 		mod_timer(&dispatcher->fault_timer,
-			jiffies + msecs_to_jiffies(_fault_timer_interval));
+			jiffies + _fault_timer_delay(adreno_dev));
 }
 
 /**
@@ -365,6 +449,52 @@ static inline void _pop_drawobj(struct adreno_context *drawctxt)
 	drawctxt->queued--;
 }
 
+static inline void _update_deadline(uint64_t *deadline, uint64_t value)
+{
+	if (value && (!*deadline || value < *deadline))
+		WRITE_ONCE(*deadline, value);
+}
+
+/* Find the earliest deadline left in the context queue - call with the lock */
+static void _drawctxt_update_deadline(struct adreno_context *drawctxt)
+{
+	uint64_t deadline = 0;
+	unsigned int i;
+
+	for (i = drawctxt->drawqueue_head; i != drawctxt->drawqueue_tail;
+			i = DRAWQUEUE_NEXT(i, ADRENO_CONTEXT_DRAWQUEUE_SIZE)) {
+		struct kgsl_drawobj *drawobj = drawctxt->drawqueue[i];
+
+		if (drawobj->type == CMDOBJ_TYPE ||
+			drawobj->type == MARKEROBJ_TYPE)
+			_update_deadline(&deadline, CMDOBJ(drawobj)->deadline);
+	}
+
+	WRITE_ONCE(drawctxt->deadline, deadline);
+}
+
+/* Called after a command left the context queue to refresh the deadline */
+static inline void _drawctxt_pop_deadline(struct adreno_context *drawctxt,
+		struct kgsl_drawobj_cmd *cmdobj)
+{
+	if (cmdobj->deadline && cmdobj->deadline == drawctxt->deadline)
+		_drawctxt_update_deadline(drawctxt);
+}
+
+/* Find the earliest deadline left inflight - call with the dispatcher mutex */
+static void _drawqueue_update_deadline(
+		struct adreno_dispatcher_drawqueue *drawqueue)
+{
+	uint64_t deadline = 0;
+	unsigned int i;
+
+	for (i = drawqueue->head; i != drawqueue->tail;
+			i = DRAWQUEUE_NEXT(i, ADRENO_DISPATCH_DRAWQUEUE_SIZE))
+		_update_deadline(&deadline, drawqueue->cmd_q[i]->deadline);
+
+	WRITE_ONCE(drawqueue->deadline, deadline);
+}
+
 static void _retire_sparseobj(struct kgsl_drawobj_sparse *sparseobj,
 				struct adreno_context *drawctxt)
 {
@@ -375,8 +505,13 @@ static void _retire_sparseobj(struct kgsl_drawobj_sparse *sparseobj,
 static int _retire_markerobj(struct kgsl_drawobj_cmd *cmdobj,
 				struct adreno_context *drawctxt)
 {
+	/* A marker behind CP waits has to retire on the GPU after them */
+	if (drawctxt->numwaits)
+		return 1;
+
 	if (_marker_expired(cmdobj)) {
 		_pop_drawobj(drawctxt);
+		_drawctxt_pop_deadline(drawctxt, cmdobj);
 		_retire_timestamp(DRAWOBJ(cmdobj));
 		return 0;
 	}
@@ -393,9 +528,109 @@ static int _retire_markerobj(struct kgsl_drawobj_cmd *cmdobj,
 	return test_bit(CMDOBJ_SKIP, &cmdobj->priv) ? 1 : -EAGAIN;
 }
 
+/*
+ * Return true if the CP can wait for @timestamp of @context ahead of the next
+ * command of @drawctxt. The dependency has to be in a ringbuffer already and
+ * that ringbuffer can't be of lower priority, otherwise the CP would stall
+ * the ringbuffer the dependency needs to get to.
+ */
+static bool _gpu_wait_allowed(struct adreno_context *drawctxt,
+		struct kgsl_context *context, unsigned int timestamp)
+{
+	struct adreno_context *other = ADRENO_CONTEXT(context);
+	unsigned int retired;
+
+	if (context == &drawctxt->base || kgsl_context_detached(context) ||
+		other->rb->id > drawctxt->rb->id)
+		return false;
+
+	if (timestamp_cmp(READ_ONCE(other->submitted_timestamp),
+			timestamp) < 0)
+		return false;
+
+	/* The CP compare is unsigned so the wait can't straddle a wrap */
+	kgsl_readtimestamp(context->device, context, KGSL_TIMESTAMP_RETIRED,
+		&retired);
+
+	return timestamp_cmp(timestamp, retired) <= 0 || timestamp > retired;
+}
+
+/*
+ * Move the pending timestamp syncpoints of @syncobj to CP waits ahead of the
+ * next command of the context. Either all of them move or none, a fence or a
+ * timestamp the CP can't wait for keeps the sync obj on the CPU path. Call
+ * with the drawctxt lock held.
+ */
+static void _syncobj_gpu_wait(struct kgsl_drawobj_sync *syncobj,
+		struct adreno_context *drawctxt)
+{
+	struct adreno_device *adreno_dev =
+		ADRENO_DEVICE(drawctxt->base.device);
+	unsigned int i, count = 0;
+
+	if (!adreno_dispatch_gpu_wait || adreno_is_a3xx(adreno_dev) ||
+		(drawctxt->base.flags & KGSL_CONTEXT_SPARSE))
+		return;
+
+	for (i = 0; i < syncobj->numsyncs; i++) {
+		struct kgsl_drawobj_sync_event *event = &syncobj->synclist[i];
+
+		if (!kgsl_drawobj_event_pending(syncobj, i))
+			continue;
+
+		if (event->type != KGSL_CMD_SYNCPOINT_TYPE_TIMESTAMP ||
+			!_gpu_wait_allowed(drawctxt, event->context,
+				event->timestamp))
+			return;
+
+		count++;
+	}
+
+	if (drawctxt->numwaits + count > KGSL_DRAWOBJ_GPU_WAITS)
+		return;
+
+	for (i = 0; i < syncobj->numsyncs; i++) {
+		unsigned int timestamp = syncobj->synclist[i].timestamp;
+		struct kgsl_context *context;
+
+		context = kgsl_drawobj_sync_take_timestamp(syncobj, i);
+		if (context == NULL)
+			continue;
+
+		/* Nothing to wait for if it retired in the meantime */
+		if (kgsl_check_timestamp(context->device, context, timestamp)) {
+			kgsl_context_put(context);
+			continue;
+		}
+
+		drawctxt->waits[drawctxt->numwaits].context = context;
+		drawctxt->waits[drawctxt->numwaits].timestamp = timestamp;
+		drawctxt->numwaits++;
+	}
+}
+
+/* Hand the CP waits taken over from sync objs to the command that follows */
+static void _drawctxt_move_waits(struct adreno_context *drawctxt,
+		struct kgsl_drawobj_cmd *cmdobj)
+{
+	unsigned int i;
+
+	for (i = 0; i < drawctxt->numwaits; i++) {
+		if (WARN_ON(cmdobj->numwaits == KGSL_DRAWOBJ_GPU_WAITS))
+			break;
+
+		cmdobj->waits[cmdobj->numwaits++] = drawctxt->waits[i];
+	}
+
+	drawctxt->numwaits = 0;
+}
+
 static int _retire_syncobj(struct kgsl_drawobj_sync *syncobj,
 				struct adreno_context *drawctxt)
 {
+	if (kgsl_drawobj_events_pending(syncobj))
+		_syncobj_gpu_wait(syncobj, drawctxt);
+
 	if (!kgsl_drawobj_events_pending(syncobj)) {
 		_pop_drawobj(drawctxt);
 		kgsl_drawobj_destroy(DRAWOBJ(syncobj));
@@ -504,6 +739,7 @@ static inline int adreno_dispatcher_requeue_cmdobj(
 
 	/* Reset the command queue head to reflect the newly requeued change */
 	drawctxt->drawqueue_head = prev;
+	_update_deadline(&drawctxt->deadline, cmdobj->deadline);
 	spin_unlock(&drawctxt->lock);
 	return 0;
 }
@@ -573,6 +809,7 @@ static int sendcmd(struct adreno_device *adreno_dev,
 	if (dispatcher->inflight == 1 &&
 			!test_bit(ADRENO_DISPATCHER_POWER, &dispatcher->priv)) {
 		/* Time to make the donuts.  Turn on the GPU */
+		kgsl_pwrctrl_predict_submit(device);
 		ret = kgsl_active_count_get(device);
 		if (ret) {
 			dispatcher->inflight--;
@@ -592,6 +829,13 @@ static int sendcmd(struct adreno_device *adreno_dev,
 			ADRENO_DRAWOBJ_PROFILE_COUNT;
 	}
 
+	if (adreno_dev->sample.enabled) {
+		set_bit(CMDOBJ_SAMPLE, &cmdobj->priv);
+		cmdobj->sample_index = adreno_dev->sample.index;
+		adreno_dev->sample.index = (adreno_dev->sample.index + 1) %
+			ADRENO_SAMPLE_COUNT;
+	}
+
 	ret = adreno_ringbuffer_submitcmd(adreno_dev, cmdobj, &time);
 
 	/*
@@ -662,10 +906,13 @@ static int sendcmd(struct adreno_device *adreno_dev,
 	mutex_unlock(&device->mutex);
 
 	cmdobj->submit_ticks = time.ticks;
+	drawobj->stage_time = kgsl_context_latency(drawobj->context,
+		KGSL_LATENCY_SUBMIT, drawobj->stage_time);
 
 	dispatch_q->cmd_q[dispatch_q->tail] = cmdobj;
 	dispatch_q->tail = (dispatch_q->tail + 1) %
 		ADRENO_DISPATCH_DRAWQUEUE_SIZE;
+	_update_deadline(&dispatch_q->deadline, cmdobj->deadline);
 
 	/*
 	 * For the first submission in any given command queue update the
@@ -825,10 +1072,12 @@ static int dispatcher_context_sendcmds(struct adreno_device *adreno_dev,
 			break;
 		}
 		_pop_drawobj(drawctxt);
+		cmdobj = CMDOBJ(drawobj);
+		_drawctxt_pop_deadline(drawctxt, cmdobj);
+		_drawctxt_move_waits(drawctxt, cmdobj);
 		spin_unlock(&drawctxt->lock);
 
 		timestamp = drawobj->timestamp;
-		cmdobj = CMDOBJ(drawobj);
 		ret = sendcmd(adreno_dev, cmdobj);
 
 		/*
@@ -874,6 +1123,36 @@ static int dispatcher_context_sendcmds(struct adreno_device *adreno_dev,
 	return ret;
 }
 
+/*
+ * Return the next context to service from the pending list. With deadline
+ * scheduling this is the context with the earliest deadline, otherwise or if
+ * no pending context has a deadline it is the highest priority one. Must be
+ * called with the plist_lock held and a non empty pending list.
+ */
+static struct adreno_context *_next_pending_context(
+		struct adreno_dispatcher *dispatcher)
+{
+	struct adreno_context *drawctxt, *next = NULL;
+	uint64_t earliest = 0;
+
+	if (adreno_dispatch_deadline_sched) {
+		plist_for_each_entry(drawctxt, &dispatcher->pending, pending) {
+			uint64_t deadline = READ_ONCE(drawctxt->deadline);
+
+			if (deadline && (!earliest || deadline < earliest)) {
+				earliest = deadline;
+				next = drawctxt;
+			}
+		}
+	}
+
+	if (next == NULL)
+		next = plist_first_entry(&dispatcher->pending,
+			struct adreno_context, pending);
+
+	return next;
+}
+
 /**
  * _adreno_dispatcher_issuecmds() - Issue commmands from pending contexts
  * @adreno_dev: Pointer to the adreno device struct
@@ -913,8 +1192,7 @@ static void _adreno_dispatcher_issuecmds(struct adreno_device *adreno_dev)
 		}
 
 		/* Get the next entry on the list */
-		drawctxt = plist_first_entry(&dispatcher->pending,
-			struct adreno_context, pending);
+		drawctxt = _next_pending_context(dispatcher);
 
 		plist_del(&drawctxt->pending, &dispatcher->pending);
 
@@ -1313,6 +1591,9 @@ static int _queue_markerobj(struct adreno_device *adreno_dev,
 	_cmdobj_set_flags(drawctxt, markerobj);
 
 	_queue_drawobj(drawctxt, drawobj);
+	_update_deadline(&drawctxt->deadline, markerobj->deadline);
+	drawobj->stage_time = kgsl_context_latency(drawobj->context,
+		KGSL_LATENCY_QUEUE, drawobj->stage_time);
 
 	return 0;
 }
@@ -1351,6 +1632,9 @@ static int _queue_cmdobj(struct adreno_device *adreno_dev,
 	_cmdobj_set_flags(drawctxt, cmdobj);
 
 	_queue_drawobj(drawctxt, drawobj);
+	_update_deadline(&drawctxt->deadline, cmdobj->deadline);
+	drawobj->stage_time = kgsl_context_latency(drawobj->context,
+		KGSL_LATENCY_QUEUE, drawobj->stage_time);
 
 	return 0;
 }
@@ -1366,52 +1650,24 @@ static void _queue_syncobj(struct adreno_context *drawctxt,
 	_queue_drawobj(drawctxt, drawobj);
 }
 
-/**
- * adreno_dispactcher_queue_cmds() - Queue a new draw object in the context
- * @dev_priv: Pointer to the device private struct
- * @context: Pointer to the kgsl draw context
+/*
+ * _queue_drawobjs() - Queue an array of draw objects in a context
+ * @adreno_dev: Pointer to the adreno device struct
+ * @drawctxt: Pointer to the adreno draw context
  * @drawobj: Pointer to the array of drawobj's being submitted
  * @count: Number of drawobj's being submitted
  * @timestamp: Pointer to the requested timestamp
  *
- * Queue a command in the context - if there isn't any room in the queue, then
- * block until there is
+ * Must be called with the drawctxt lock held and room in the context queue.
+ * Returns 0 if the objects were queued, 1 if the last object was retired
+ * through a fastpath without queueing, or a negative error code.
  */
-int adreno_dispatcher_queue_cmds(struct kgsl_device_private *dev_priv,
-		struct kgsl_context *context, struct kgsl_drawobj *drawobj[],
+static int _queue_drawobjs(struct adreno_device *adreno_dev,
+		struct adreno_context *drawctxt, struct kgsl_drawobj *drawobj[],
 		uint32_t count, uint32_t *timestamp)
-
 {
-	struct kgsl_device *device = dev_priv->device;
-	struct adreno_device *adreno_dev = ADRENO_DEVICE(device);
-	struct adreno_context *drawctxt = ADRENO_CONTEXT(context);
-	struct adreno_dispatcher_drawqueue *dispatch_q;
+	unsigned int i, user_ts = *timestamp;
 	int ret;
-	unsigned int i, user_ts;
-
-	if (!count)
-		return -EINVAL;
-
-	ret = _check_context_state(&drawctxt->base);
-	if (ret)
-		return ret;
-
-	ret = _verify_cmdobj(dev_priv, context, drawobj, count);
-	if (ret)
-		return ret;
-
-	/* wait for the suspend gate */
-	wait_for_completion(&device->halt_gate);
-
-	spin_lock(&drawctxt->lock);
-
-	ret = _check_context_state_to_queue_cmds(drawctxt);
-	if (ret) {
-		spin_unlock(&drawctxt->lock);
-		return ret;
-	}
-
-	user_ts = *timestamp;
 
 	/*
 	 * If there is only one drawobj in the array and it is of
@@ -1423,10 +1679,8 @@ int adreno_dispatcher_queue_cmds(struct kgsl_device_private *dev_priv,
 		 * User specified timestamps need to be greater than the last
 		 * issued timestamp in the context
 		 */
-		if (timestamp_cmp(drawctxt->timestamp, user_ts) >= 0) {
-			spin_unlock(&drawctxt->lock);
+		if (timestamp_cmp(drawctxt->timestamp, user_ts) >= 0)
 			return -ERANGE;
-		}
 	}
 
 	for (i = 0; i < count; i++) {
@@ -1436,22 +1690,15 @@ int adreno_dispatcher_queue_cmds(struct kgsl_device_private *dev_priv,
 			ret = _queue_markerobj(adreno_dev, drawctxt,
 					CMDOBJ(drawobj[i]),
 					timestamp, user_ts);
-			if (ret == 1) {
-				spin_unlock(&drawctxt->lock);
-				goto done;
-			} else if (ret) {
-				spin_unlock(&drawctxt->lock);
+			if (ret)
 				return ret;
-			}
 			break;
 		case CMDOBJ_TYPE:
 			ret = _queue_cmdobj(adreno_dev, drawctxt,
 						CMDOBJ(drawobj[i]),
 						timestamp, user_ts);
-			if (ret) {
-				spin_unlock(&drawctxt->lock);
+			if (ret)
 				return ret;
-			}
 			break;
 		case SYNCOBJ_TYPE:
 			_queue_syncobj(drawctxt, SYNCOBJ(drawobj[i]),
@@ -1461,23 +1708,77 @@ int adreno_dispatcher_queue_cmds(struct kgsl_device_private *dev_priv,
 			ret = _queue_sparseobj(adreno_dev, drawctxt,
 					SPARSEOBJ(drawobj[i]),
 					timestamp, user_ts);
-			if (ret == 1) {
-				spin_unlock(&drawctxt->lock);
-				_retire_sparseobj(SPARSEOBJ(drawobj[i]),
-						drawctxt);
-				return 0;
-			} else if (ret) {
-				spin_unlock(&drawctxt->lock);
+			if (ret)
 				return ret;
-			}
 			break;
 		default:
-			spin_unlock(&drawctxt->lock);
 			return -EINVAL;
 		}
 
 	}
 
+	return 0;
+}
+
+/**
+ * adreno_dispactcher_queue_cmds() - Queue a new draw object in the context
+ * @dev_priv: Pointer to the device private struct
+ * @context: Pointer to the kgsl draw context
+ * @drawobj: Pointer to the array of drawobj's being submitted
+ * @count: Number of drawobj's being submitted
+ * @timestamp: Pointer to the requested timestamp
+ *
+ * Queue a command in the context - if there isn't any room in the queue, then
+ * block until there is
+ */
+int adreno_dispatcher_queue_cmds(struct kgsl_device_private *dev_priv,
+		struct kgsl_context *context, struct kgsl_drawobj *drawobj[],
+		uint32_t count, uint32_t *timestamp)
+
+{
+	struct kgsl_device *device = dev_priv->device;
+	struct adreno_device *adreno_dev = ADRENO_DEVICE(device);
+	struct adreno_context *drawctxt = ADRENO_CONTEXT(context);
+	struct adreno_dispatcher_drawqueue *dispatch_q;
+	int ret;
+
+	if (!count)
+		return -EINVAL;
+
+	ret = _check_context_state(&drawctxt->base);
+	if (ret)
+		return ret;
+
+	ret = _verify_cmdobj(dev_priv, context, drawobj, count);
+	if (ret)
+		return ret;
+
+	/* wait for the suspend gate */
+	wait_for_completion(&device->halt_gate);
+
+	spin_lock(&drawctxt->lock);
+
+	ret = _check_context_state_to_queue_cmds(drawctxt);
+	if (ret) {
+		spin_unlock(&drawctxt->lock);
+		return ret;
+	}
+
+	ret = _queue_drawobjs(adreno_dev, drawctxt, drawobj, count, timestamp);
+	if (ret < 0) {
+		spin_unlock(&drawctxt->lock);
+		return ret;
+	} else if (ret == 1) {
+		spin_unlock(&drawctxt->lock);
+
+		if (drawobj[0]->type == SPARSEOBJ_TYPE) {
+			_retire_sparseobj(SPARSEOBJ(drawobj[0]), drawctxt);
+			return 0;
+		}
+
+		goto done;
+	}
+
 	dispatch_q = ADRENO_DRAWOBJ_DISPATCH_DRAWQUEUE(drawobj[0]);
 
 	_track_context(adreno_dev, dispatch_q, drawctxt);
@@ -1509,6 +1810,115 @@ int adreno_dispatcher_queue_cmds(struct kgsl_device_private *dev_priv,
 	return 0;
 }
 
+/**
+ * adreno_dispatcher_queue_cmds_batch() - Queue a batch of draw objects
+ * @dev_priv: Pointer to the device private struct
+ * @batch: Array of submissions, each one for a single context
+ * @count: Number of entries in @batch
+ *
+ * Queue several submissions with the same semantics as
+ * adreno_dispatcher_queue_cmds() but with less overhead: all of the entries
+ * are validated up front, consecutive entries for the same context are queued
+ * under a single hold of the drawctxt lock and the dispatcher is kicked once
+ * for the whole batch. Entries are queued in order and queueing stops at the
+ * first failure. The status of each entry is returned in its result member.
+ * Returns the number of entries that were queued.
+ */
+int adreno_dispatcher_queue_cmds_batch(struct kgsl_device_private *dev_priv,
+		struct kgsl_drawobj_batch *batch, unsigned int count)
+{
+	struct kgsl_device *device = dev_priv->device;
+	struct adreno_device *adreno_dev = ADRENO_DEVICE(device);
+	bool issue = false;
+	unsigned int i, j = 0;
+	int ret = 0;
+
+	/* Validate everything before queueing anything */
+	for (i = 0; i < count; i++) {
+		struct kgsl_drawobj_batch *entry = &batch[i];
+
+		/* Sparse objects need the single submission fastpath */
+		if (!entry->count || entry->drawobj[0]->type == SPARSEOBJ_TYPE)
+			ret = -EINVAL;
+		else
+			ret = _check_context_state(entry->context);
+
+		if (!ret)
+			ret = _verify_cmdobj(dev_priv, entry->context,
+				entry->drawobj, entry->count);
+
+		entry->result = ret;
+		if (ret)
+			break;
+	}
+
+	/* Only the valid prefix of the batch gets queued */
+	count = i;
+	if (!count)
+		return 0;
+
+	/* wait for the suspend gate */
+	wait_for_completion(&device->halt_gate);
+
+	for (i = 0; i < count; i = j) {
+		struct kgsl_context *context = batch[i].context;
+		struct adreno_context *drawctxt = ADRENO_CONTEXT(context);
+		struct adreno_dispatcher_drawqueue *dispatch_q =
+			ADRENO_DRAWOBJ_DISPATCH_DRAWQUEUE(batch[i].drawobj[0]);
+		bool track = false;
+
+		spin_lock(&drawctxt->lock);
+
+		for (j = i; j < count && batch[j].context == context; j++) {
+			ret = _check_context_state_to_queue_cmds(drawctxt);
+			if (!ret)
+				ret = _queue_drawobjs(adreno_dev, drawctxt,
+					batch[j].drawobj, batch[j].count,
+					&batch[j].timestamp);
+
+			if (ret < 0) {
+				batch[j].result = ret;
+				break;
+			}
+
+			/* A marker that retired on the fastpath isn't queued */
+			if (ret == 0)
+				track = true;
+			batch[j].result = 0;
+		}
+
+		if (track)
+			_track_context(adreno_dev, dispatch_q, drawctxt);
+
+		spin_unlock(&drawctxt->lock);
+
+		if (track) {
+			/* Add the context to the dispatcher pending list */
+			dispatcher_queue_context(adreno_dev, drawctxt);
+
+			if (dispatch_q->inflight < _context_drawobj_burst)
+				issue = true;
+		}
+
+		/* Report a previous fault on the last entry of the context */
+		if (j > i && test_and_clear_bit(ADRENO_CONTEXT_FAULT,
+				&context->priv))
+			batch[j - 1].result = -EPROTO;
+
+		if (ret < 0)
+			break;
+	}
+
+	if (device->pwrctrl.l2pc_update_queue)
+		kgsl_pwrctrl_update_l2pc(&adreno_dev->dev,
+				KGSL_L2PC_QUEUE_TIMEOUT);
+
+	if (issue)
+		adreno_dispatcher_issuecmds(adreno_dev);
+
+	return j;
+}
+
 static int _mark_context(int id, void *ptr, void *data)
 {
 	unsigned int guilty = *((unsigned int *) data);
@@ -2010,6 +2420,7 @@ static void recover_dispatch_q(struct kgsl_device *device,
 replay:
 	dispatch_q->inflight = 0;
 	dispatch_q->head = dispatch_q->tail = 0;
+	dispatch_q->deadline = 0;
 	/* Remove any pending cmdobj's that have been invalidated */
 	remove_invalidated_cmdobjs(device, replay, count);
 
@@ -2351,6 +2762,9 @@ static void retire_cmdobj(struct adreno_device *adreno_dev,
 	if (test_bit(CMDOBJ_PROFILE, &cmdobj->priv))
 		cmdobj_profile_ticks(adreno_dev, cmdobj, &start, &end);
 
+	if (test_bit(CMDOBJ_SAMPLE, &cmdobj->priv))
+		adreno_sample_retire(adreno_dev, drawctxt, cmdobj);
+
 	/*
 	 * For A3xx we still get the rptr from the CP_RB_RPTR instead of
 	 * rptr scratch out address. At this point GPU clocks turned off.
@@ -2372,6 +2786,25 @@ static void retire_cmdobj(struct adreno_device *adreno_dev,
 	drawctxt->ticks_index = (drawctxt->ticks_index + 1) %
 		SUBMIT_RETIRE_TICKS_SIZE;
 
+	kgsl_context_latency(drawobj->context, KGSL_LATENCY_RETIRE,
+		drawobj->stage_time);
+
+	/* Let frame based governors know a frame boundary has been crossed */
+	if (drawobj->flags & KGSL_DRAWOBJ_END_OF_FRAME)
+		kgsl_pwrscale_frame(KGSL_DEVICE(adreno_dev), cmdobj->deadline);
+
+	if (cmdobj->deadline) {
+		uint64_t now = ktime_get_ns();
+
+		if (now > cmdobj->deadline) {
+			drawctxt->deadline_missed++;
+			drawctxt->deadline_max_late = max_t(uint64_t,
+				drawctxt->deadline_max_late,
+				now - cmdobj->deadline);
+		} else
+			drawctxt->deadline_met++;
+	}
+
 	kgsl_drawobj_destroy(drawobj);
 }
 
@@ -2380,6 +2813,7 @@ static int adreno_dispatch_retire_drawqueue(struct adreno_device *adreno_dev,
 {
 	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
 	struct adreno_dispatcher *dispatcher = &adreno_dev->dispatcher;
+	bool deadline = false;
 	int count = 0;
 
 	while (!adreno_drawqueue_is_empty(drawqueue)) {
@@ -2391,6 +2825,9 @@ static int adreno_dispatch_retire_drawqueue(struct adreno_device *adreno_dev,
 			drawobj->timestamp))
 			break;
 
+		if (cmdobj->deadline && cmdobj->deadline == drawqueue->deadline)
+			deadline = true;
+
 		retire_cmdobj(adreno_dev, cmdobj);
 
 		dispatcher->inflight--;
@@ -2404,9 +2841,161 @@ static int adreno_dispatch_retire_drawqueue(struct adreno_device *adreno_dev,
 		count++;
 	}
 
+	if (deadline)
+		_drawqueue_update_deadline(drawqueue);
+
 	return count;
 }
 
+/**
+ * adreno_dispatcher_deadline_ringbuffer() - Find the ringbuffer with the
+ * earliest inflight deadline
+ * @adreno_dev: Pointer to the adreno device
+ *
+ * Used by the preemption code to pick the next ringbuffer when deadline
+ * scheduling is enabled. Returns NULL if deadline scheduling is off or no
+ * active ringbuffer has a command with a deadline inflight.
+ */
+struct adreno_ringbuffer *adreno_dispatcher_deadline_ringbuffer(
+		struct adreno_device *adreno_dev)
+{
+	struct adreno_ringbuffer *rb, *next = NULL;
+	uint64_t earliest = 0;
+	unsigned long flags;
+	unsigned int i;
+
+	if (!adreno_dispatch_deadline_sched)
+		return NULL;
+
+	FOR_EACH_RINGBUFFER(adreno_dev, rb, i) {
+		uint64_t deadline = READ_ONCE(rb->dispatch_q.deadline);
+		bool empty;
+
+		if (!deadline || (earliest && deadline >= earliest))
+			continue;
+
+		spin_lock_irqsave(&rb->preempt_lock, flags);
+		empty = adreno_rb_empty(rb);
+		spin_unlock_irqrestore(&rb->preempt_lock, flags);
+
+		if (empty == false) {
+			earliest = deadline;
+			next = rb;
+		}
+	}
+
+	return next;
+}
+
+/* Return true if the current ringbuffer has used up its time slice */
+static bool _slice_expired(struct adreno_device *adreno_dev)
+{
+	struct adreno_ringbuffer *cur = adreno_dev->cur_rb;
+
+	if (!_rb_quantum(adreno_dev, cur))
+		return false;
+
+	return cur->slice_expires && time_after_eq(jiffies, cur->slice_expires);
+}
+
+/**
+ * adreno_dispatcher_slice_ringbuffer() - Pick the next ringbuffer by time
+ * slice
+ * @adreno_dev: Pointer to the adreno device
+ *
+ * Used by the preemption code when picking the next ringbuffer. The current
+ * ringbuffer is kept while it has work and time left in its slice, once the
+ * slice is used up the next ringbuffer with work after it in round robin
+ * order is returned. Returns NULL if time slicing has no say, in which case
+ * the usual order applies.
+ */
+struct adreno_ringbuffer *adreno_dispatcher_slice_ringbuffer(
+		struct adreno_device *adreno_dev)
+{
+	struct adreno_ringbuffer *cur = adreno_dev->cur_rb, *rb;
+	unsigned int i;
+
+	adreno_dev->preempt.slice_pending = false;
+
+	if (!_rb_quantum(adreno_dev, cur) || !_rb_has_work(cur))
+		return NULL;
+
+	/* Start the slice of a ringbuffer that got the GPU without a switch */
+	if (!cur->slice_expires) {
+		cur->slice_start = jiffies;
+		cur->slice_expires = jiffies +
+			msecs_to_jiffies(_rb_quantum(adreno_dev, cur));
+	}
+
+	if (!_slice_expired(adreno_dev))
+		return cur;
+
+	for (i = 1; i < adreno_dev->num_ringbuffers; i++) {
+		rb = &adreno_dev->ringbuffers[(cur->id + i) %
+			adreno_dev->num_ringbuffers];
+
+		if (_rb_has_work(rb)) {
+			adreno_dev->preempt.slice_pending = true;
+			return rb;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * adreno_dispatcher_preempt_triggered() - Account a triggered preemption
+ * @adreno_dev: Pointer to the adreno device
+ *
+ * Called by the preemption code right before it triggers the switch to
+ * adreno_dev->next_rb.
+ */
+void adreno_dispatcher_preempt_triggered(struct adreno_device *adreno_dev)
+{
+	struct adreno_preemption *preempt = &adreno_dev->preempt;
+
+	preempt->trigger_time = ktime_get_ns();
+
+	if (preempt->slice_pending)
+		preempt->slice_count++;
+	preempt->slice_pending = false;
+}
+
+/**
+ * adreno_dispatcher_preempt_done() - Account a completed preemption
+ * @adreno_dev: Pointer to the adreno device
+ *
+ * Called by the preemption code once adreno_dev->cur_rb has been switched in,
+ * possibly from the interrupt handler. The time the previous ringbuffer had
+ * is charged to its active context and the new one starts its time slice.
+ */
+void adreno_dispatcher_preempt_done(struct adreno_device *adreno_dev)
+{
+	struct adreno_preemption *preempt = &adreno_dev->preempt;
+	struct adreno_ringbuffer *prev = adreno_dev->prev_rb;
+	struct adreno_ringbuffer *cur = adreno_dev->cur_rb;
+	uint64_t latency = ktime_get_ns() - preempt->trigger_time;
+
+	preempt->done_count++;
+	preempt->latency_total += latency;
+	preempt->latency_max = max(preempt->latency_max, latency);
+
+	if (prev != NULL && prev->slice_start) {
+		unsigned long ran = jiffies - prev->slice_start;
+
+		prev->run_time += ran;
+		if (prev->drawctxt_active) {
+			prev->drawctxt_active->slice_time += ran;
+			prev->drawctxt_active->slice_preempted++;
+		}
+	}
+
+	cur->switched_in++;
+	cur->slice_start = jiffies;
+	cur->slice_expires = jiffies +
+		msecs_to_jiffies(READ_ONCE(_preempt_quanta[cur->id]));
+}
+
 static void _adreno_dispatch_check_timeout(struct adreno_device *adreno_dev,
 		struct adreno_dispatcher_drawqueue *drawqueue)
 {
@@ -2602,15 +3191,24 @@ static void adreno_dispatcher_fault_timer(unsigned long data)
 	struct adreno_device *adreno_dev = (struct adreno_device *) data;
 	struct adreno_dispatcher *dispatcher = &adreno_dev->dispatcher;
 
-	/* Leave if the user decided to turn off fast hang detection */
+	/* The dispatcher work preempts a ringbuffer out of a used up slice */
+	if (_slice_expired(adreno_dev) &&
+		adreno_in_preempt_state(adreno_dev, ADRENO_PREEMPT_NONE))
+		adreno_dispatcher_schedule(KGSL_DEVICE(adreno_dev));
+
+	/* Skip the hang check if the user turned off fast hang detection */
 	if (!adreno_soft_fault_detect(adreno_dev))
-		return;
+		goto rearm;
 
 	if (adreno_gpu_fault(adreno_dev)) {
 		adreno_dispatcher_schedule(KGSL_DEVICE(adreno_dev));
 		return;
 	}
 
+	/* With time slicing the timer can run more often than the hang check */
+	if (time_before(jiffies, dispatcher->fault_check))
+		goto rearm;
+
 	/*
 	 * Read the fault registers - if it returns 0 then they haven't changed
 	 * so mark the dispatcher as faulted and schedule the work loop.
@@ -2619,10 +3217,17 @@ static void adreno_dispatcher_fault_timer(unsigned long data)
 	if (!fault_detect_read_compare(adreno_dev)) {
 		adreno_set_gpu_fault(adreno_dev, ADRENO_SOFT_FAULT);
 		adreno_dispatcher_schedule(KGSL_DEVICE(adreno_dev));
-	} else if (dispatcher->inflight > 0) {
-		mod_timer(&dispatcher->fault_timer,
-			jiffies + msecs_to_jiffies(_fault_timer_interval));
+		return;
 	}
+
+	dispatcher->fault_check = jiffies +
+		msecs_to_jiffies(_fault_timer_interval);
+
+rearm:
+	if (dispatcher->inflight > 0 && (adreno_soft_fault_detect(adreno_dev) ||
+			_min_quantum(adreno_dev)))
+		mod_timer(&dispatcher->fault_timer,
+			jiffies + _fault_timer_delay(adreno_dev));
 }
 
 /*
@@ -2729,6 +3334,14 @@ struct dispatcher_attribute {
 		.value = &(_value), \
 	}
 
+#define DISPATCHER_BOOL_ATTR(_name, _mode, _value) \
+	struct dispatcher_attribute dispatcher_attr_##_name =  { \
+		.attr = { .name = __stringify(_name), .mode = _mode }, \
+		.show = _show_uint, \
+		.store = _store_bool, \
+		.value = &(_value), \
+	}
+
 #define to_dispatcher_attr(_a) \
 	container_of((_a), struct dispatcher_attribute, attr)
 #define to_dispatcher(k) container_of(k, struct adreno_dispatcher, kobj)
@@ -2751,6 +3364,21 @@ static ssize_t _store_uint(struct adreno_dispatcher *dispatcher,
 	return size;
 }
 
+static ssize_t _store_bool(struct adreno_dispatcher *dispatcher,
+		struct dispatcher_attribute *attr,
+		const char *buf, size_t size)
+{
+	unsigned int val = 0;
+	int ret;
+
+	ret = kgsl_sysfs_store(buf, &val);
+	if (ret)
+		return ret;
+
+	*((unsigned int *) attr->value) = val ? 1 : 0;
+	return size;
+}
+
 static ssize_t _show_uint(struct adreno_dispatcher *dispatcher,
 		struct dispatcher_attribute *attr,
 		char *buf)
@@ -2759,6 +3387,40 @@ static ssize_t _show_uint(struct adreno_dispatcher *dispatcher,
 		*((unsigned int *) attr->value));
 }
 
+/* The quanta are written as one value in ms per priority level */
+static ssize_t _store_quanta(struct adreno_dispatcher *dispatcher,
+		struct dispatcher_attribute *attr,
+		const char *buf, size_t size)
+{
+	unsigned int val[KGSL_PRIORITY_MAX_RB_LEVELS];
+	int i, n, pos = 0;
+
+	for (i = 0; i < KGSL_PRIORITY_MAX_RB_LEVELS; i++) {
+		if (sscanf(buf + pos, "%u%n", &val[i], &n) != 1)
+			return -EINVAL;
+		pos += n;
+	}
+
+	for (i = 0; i < KGSL_PRIORITY_MAX_RB_LEVELS; i++)
+		WRITE_ONCE(attr->value[i], val[i]);
+
+	return size;
+}
+
+static ssize_t _show_quanta(struct adreno_dispatcher *dispatcher,
+		struct dispatcher_attribute *attr,
+		char *buf)
+{
+	int i, ret = 0;
+
+	for (i = 0; i < KGSL_PRIORITY_MAX_RB_LEVELS; i++)
+		ret += snprintf(buf + ret, PAGE_SIZE - ret, "%u%c",
+			attr->value[i],
+			i == KGSL_PRIORITY_MAX_RB_LEVELS - 1 ? '\n' : ' ');
+
+	return ret;
+}
+
 static DISPATCHER_UINT_ATTR(inflight, 0644, ADRENO_DISPATCH_DRAWQUEUE_SIZE,
 	_dispatcher_q_inflight_hi);
 
@@ -2789,6 +3451,18 @@ static DISPATCHER_UINT_ATTR(dispatch_time_slice, 0644, 0,
 	adreno_dispatch_time_slice);
 static DISPATCHER_UINT_ATTR(dispatch_starvation_time, 0644, 0,
 	adreno_dispatch_starvation_time);
+static DISPATCHER_BOOL_ATTR(deadline_sched, 0644,
+	adreno_dispatch_deadline_sched);
+static DISPATCHER_BOOL_ATTR(gpu_wait, 0644, adreno_dispatch_gpu_wait);
+static DISPATCHER_BOOL_ATTR(preempt_time_slice, 0644,
+	adreno_dispatch_preempt_slice);
+
+static struct dispatcher_attribute dispatcher_attr_preempt_quanta = {
+	.attr = { .name = "preempt_quanta", .mode = 0644 },
+	.show = _show_quanta,
+	.store = _store_quanta,
+	.value = _preempt_quanta,
+};
 
 static struct attribute *dispatcher_attrs[] = {
 	&dispatcher_attr_inflight.attr,
@@ -2803,6 +3477,10 @@ static struct attribute *dispatcher_attrs[] = {
 	&dispatcher_attr_disp_preempt_fair_sched.attr,
 	&dispatcher_attr_dispatch_time_slice.attr,
 	&dispatcher_attr_dispatch_starvation_time.attr,
+	&dispatcher_attr_deadline_sched.attr,
+	&dispatcher_attr_gpu_wait.attr,
+	&dispatcher_attr_preempt_time_slice.attr,
+	&dispatcher_attr_preempt_quanta.attr,
 	NULL,
 };
 
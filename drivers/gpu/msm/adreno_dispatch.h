@@ -18,6 +18,9 @@ extern unsigned int adreno_disp_preempt_fair_sched;
 extern unsigned int adreno_drawobj_timeout;
 extern unsigned int adreno_dispatch_starvation_time;
 extern unsigned int adreno_dispatch_time_slice;
+extern unsigned int adreno_dispatch_deadline_sched;
+extern unsigned int adreno_dispatch_gpu_wait;
+extern unsigned int adreno_dispatch_preempt_slice;
 
 /**
  * enum adreno_dispatcher_starve_timer_states - Starvation control states of
@@ -56,6 +59,7 @@ enum adreno_dispatcher_starve_timer_states {
  * @tail: Queues tail pointer
  * @active_context_count: Number of active contexts seen in this rb drawqueue
  * @expires: The jiffies value at which this drawqueue has run too long
+ * @deadline: Earliest deadline of the inflight commands, 0 if none
  */
 struct adreno_dispatcher_drawqueue {
 	struct kgsl_drawobj_cmd *cmd_q[ADRENO_DISPATCH_DRAWQUEUE_SIZE];
@@ -64,6 +68,7 @@ struct adreno_dispatcher_drawqueue {
 	unsigned int tail;
 	int active_context_count;
 	unsigned long expires;
+	uint64_t deadline;
 };
 
 /**
@@ -81,6 +86,8 @@ struct adreno_dispatcher_drawqueue {
  * @disp_preempt_fair_sched: If set then dispatcher will try to be fair to
  * starving RB's by scheduling them in and enforcing a minimum time slice
  * for every RB that is scheduled to run on the device
+ * @fault_check: The jiffies value at which the fault timer next checks for a
+ * hang
  */
 struct adreno_dispatcher {
 	struct mutex mutex;
@@ -95,6 +102,7 @@ struct adreno_dispatcher {
 	struct kobject kobj;
 	struct completion idle_gate;
 	unsigned int disp_preempt_fair_sched;
+	unsigned long fault_check;
 };
 
 enum adreno_dispatcher_flags {
@@ -115,8 +123,16 @@ void adreno_dispatcher_stop_fault_timer(struct kgsl_device *device);
 int adreno_dispatcher_queue_cmds(struct kgsl_device_private *dev_priv,
 		struct kgsl_context *context, struct kgsl_drawobj *drawobj[],
 		uint32_t count, uint32_t *timestamp);
+int adreno_dispatcher_queue_cmds_batch(struct kgsl_device_private *dev_priv,
+		struct kgsl_drawobj_batch *batch, unsigned int count);
 
 void adreno_dispatcher_schedule(struct kgsl_device *device);
+struct adreno_ringbuffer *adreno_dispatcher_deadline_ringbuffer(
+		struct adreno_device *adreno_dev);
+struct adreno_ringbuffer *adreno_dispatcher_slice_ringbuffer(
+		struct adreno_device *adreno_dev);
+void adreno_dispatcher_preempt_triggered(struct adreno_device *adreno_dev);
+void adreno_dispatcher_preempt_done(struct adreno_device *adreno_dev);
 void adreno_dispatcher_pause(struct adreno_device *adreno_dev);
 void adreno_dispatcher_queue_context(struct kgsl_device *device,
 		struct adreno_context *drawctxt);
@@ -243,6 +243,12 @@ static int drawctxt_detach_drawobjs(struct adreno_context *drawctxt,
 		struct kgsl_drawobj **list)
 {
 	int count = 0;
+	unsigned int i;
+
+	/* Drop the CP waits that no command is left to carry */
+	for (i = 0; i < drawctxt->numwaits; i++)
+		kgsl_context_put(drawctxt->waits[i].context);
+	drawctxt->numwaits = 0;
 
 	while (drawctxt->drawqueue_head != drawctxt->drawqueue_tail) {
 		struct kgsl_drawobj *drawobj =
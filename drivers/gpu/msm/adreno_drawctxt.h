@@ -53,6 +53,18 @@ struct kgsl_context;
  *		 be written.
  * @active_node: Linkage for nodes in active_list
  * @active_time: Time when this context last seen
+ * @deadline: Earliest deadline of the commands in the drawqueue, 0 if none
+ * @deadline_met: Number of commands that retired before their deadline
+ * @deadline_missed: Number of commands that retired after their deadline
+ * @deadline_max_late: Largest deadline miss on this context in ns
+ * @sample_total: Sum of the counter samples of the retired command objs
+ * @waits: Timestamps of other contexts taken over from sync objs for the CP
+ * to wait for ahead of the next command, protected by @lock
+ * @numwaits: Number of entries in @waits
+ * @slice_time: Jiffies of GPU time charged to this context when its
+ * ringbuffer was preempted
+ * @slice_preempted: Number of times the ringbuffer was preempted while this
+ * context was active on it
  */
 struct adreno_context {
 	struct kgsl_context base;
@@ -82,6 +94,16 @@ struct adreno_context {
 
 	struct list_head active_node;
 	unsigned long active_time;
+
+	uint64_t deadline;
+	unsigned int deadline_met;
+	unsigned int deadline_missed;
+	uint64_t deadline_max_late;
+	uint64_t sample_total[KGSL_GPU_SAMPLE_MAX];
+	struct kgsl_drawobj_gpu_wait waits[KGSL_DRAWOBJ_GPU_WAITS];
+	unsigned int numwaits;
+	unsigned long slice_time;
+	unsigned int slice_preempted;
 };
 
 /* Flag definitions for flag field in adreno_context */
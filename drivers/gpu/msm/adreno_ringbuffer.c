@@ -341,6 +341,10 @@ static int _adreno_ringbuffer_probe(struct adreno_device *adreno_dev,
 	kgsl_allocate_global(KGSL_DEVICE(adreno_dev), &rb->profile_desc,
 		PAGE_SIZE, KGSL_MEMFLAGS_GPUREADONLY, 0, "profile_desc");
 
+	rb->submit_cmds = kmalloc(ADRENO_RB_SUBMIT_CMDS_SIZE, GFP_KERNEL);
+	if (rb->submit_cmds == NULL)
+		return -ENOMEM;
+
 	return kgsl_allocate_global(KGSL_DEVICE(adreno_dev), &rb->buffer_desc,
 			KGSL_RB_SIZE, KGSL_MEMFLAGS_GPUREADONLY,
 			0, "ringbuffer");
@@ -388,6 +392,7 @@ static void _adreno_ringbuffer_close(struct adreno_device *adreno_dev,
 	kgsl_free_global(device, &rb->preemption_desc);
 	kgsl_free_global(device, &rb->profile_desc);
 	kgsl_free_global(device, &rb->buffer_desc);
+	kfree(rb->submit_cmds);
 	kgsl_del_event_group(&rb->events);
 	memset(rb, 0, sizeof(struct adreno_ringbuffer));
 }
@@ -794,6 +799,8 @@ adreno_ringbuffer_addcmds(struct adreno_ringbuffer *rb,
 	 */
 	rb->_wptr = rb->_wptr - (total_sizedwords - (ringcmds - start));
 
+	rb->submit_bytes += (ringcmds - start) << 2;
+
 	adreno_ringbuffer_submit(rb, time);
 
 	return 0;
@@ -920,6 +927,28 @@ static int set_user_profiling(struct adreno_device *adreno_dev,
 }
 
 /* adreno_rindbuffer_submitcmd - submit userspace IBs to the GPU */
+/*
+ * Make the CP wait until the end of pipe timestamp of another context reaches
+ * the one the command depends on. The compare is unsigned, the dispatcher
+ * only hands over waits that don't straddle a timestamp wrap.
+ */
+static unsigned int _wait_timestamp(struct adreno_device *adreno_dev,
+		unsigned int *cmds, struct kgsl_drawobj_gpu_wait *wait)
+{
+	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
+	unsigned int *start = cmds;
+
+	*cmds++ = cp_mem_packet(adreno_dev, CP_WAIT_REG_MEM, 5, 1);
+	*cmds++ = 0x15; /* Mem Space = Memory, Function = Greater or equal */
+	cmds += cp_gpuaddr(adreno_dev, cmds, MEMSTORE_ID_GPU_ADDR(device,
+		wait->context->id, eoptimestamp));
+	*cmds++ = wait->timestamp; /* ref val */
+	*cmds++ = 0xFFFFFFFF; /* mask */
+	*cmds++ = 0x10; /* poll interval */
+
+	return cmds - start;
+}
+
 int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 		struct kgsl_drawobj_cmd *cmdobj,
 		struct adreno_submit_time *time)
@@ -928,7 +957,7 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 	struct adreno_gpudev *gpudev = ADRENO_GPU_DEVICE(adreno_dev);
 	struct kgsl_drawobj *drawobj = DRAWOBJ(cmdobj);
 	struct kgsl_memobj_node *ib;
-	unsigned int numibs = 0;
+	unsigned int numibs = 0, i;
 	unsigned int *link;
 	unsigned int *cmds;
 	struct kgsl_context *context;
@@ -1015,6 +1044,9 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 	/* Each IB takes up 30 dwords in worst case */
 	dwords += (numibs * 30);
 
+	/* Each wait for another context's timestamp takes up 7 dwords */
+	dwords += (cmdobj->numwaits * 7);
+
 	if (drawobj->flags & KGSL_DRAWOBJ_PROFILING &&
 		!adreno_is_a3xx(adreno_dev) &&
 		(cmdobj->profiling_buf_entry != NULL)) {
@@ -1046,6 +1078,9 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 			dwords += 2;
 	}
 
+	if (test_bit(CMDOBJ_SAMPLE, &cmdobj->priv))
+		dwords += 2 * ADRENO_SAMPLE_DWORDS;
+
 	if (adreno_is_preemption_enabled(adreno_dev))
 		if (gpudev->preemption_yield_enable)
 			dwords += 8;
@@ -1064,7 +1099,15 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 	if (gpudev->ccu_invalidate)
 		dwords += 4;
 
-	link = kcalloc(dwords, sizeof(unsigned int), GFP_KERNEL);
+	/*
+	 * The wrapper is only staged here until addcmds copies it into the
+	 * ringbuffer, so the common case reuses the ringbuffer's buffer and
+	 * only very long IB lists need an allocation.
+	 */
+	if (dwords <= ADRENO_RB_SUBMIT_CMDS_SIZE / sizeof(unsigned int))
+		link = rb->submit_cmds;
+	else
+		link = kcalloc(dwords, sizeof(unsigned int), GFP_KERNEL);
 	if (!link) {
 		ret = -ENOMEM;
 		goto done;
@@ -1075,6 +1118,9 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 	*cmds++ = cp_packet(adreno_dev, CP_NOP, 1);
 	*cmds++ = KGSL_START_OF_IB_IDENTIFIER;
 
+	for (i = 0; i < cmdobj->numwaits; i++)
+		cmds += _wait_timestamp(adreno_dev, cmds, &cmdobj->waits[i]);
+
 	if (kernel_profiling) {
 		cmds += _get_alwayson_counter(adreno_dev, cmds,
 			adreno_dev->profile_buffer.gpuaddr +
@@ -1082,6 +1128,9 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 				started));
 	}
 
+	if (test_bit(CMDOBJ_SAMPLE, &cmdobj->priv))
+		cmds += adreno_sample_cmds(adreno_dev, cmds, cmdobj, false);
+
 	/*
 	 * Add IB1 to read the GPU ticks at the start of command obj and
 	 * write it into the appropriate command obj profiling buffer offset
@@ -1127,6 +1176,9 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 		if (gpudev->preemption_yield_enable)
 			cmds += gpudev->preemption_yield_enable(cmds);
 
+	if (test_bit(CMDOBJ_SAMPLE, &cmdobj->priv))
+		cmds += adreno_sample_cmds(adreno_dev, cmds, cmdobj, true);
+
 	if (kernel_profiling) {
 		cmds += _get_alwayson_counter(adreno_dev, cmds,
 			adreno_dev->profile_buffer.gpuaddr +
@@ -1189,13 +1241,15 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 	if (!ret) {
 		set_bit(KGSL_CONTEXT_PRIV_SUBMITTED, &context->priv);
 		cmdobj->global_ts = drawctxt->internal_timestamp;
+		rb->submit_count++;
 	}
 
 done:
 	trace_kgsl_issueibcmds(device, context->id, numibs, drawobj->timestamp,
 			drawobj->flags, ret, drawctxt->type);
 
-	kfree(link);
+	if (link != rb->submit_cmds)
+		kfree(link);
 	return ret;
 }
 
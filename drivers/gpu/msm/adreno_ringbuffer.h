@@ -34,6 +34,9 @@
  */
 #define KGSL_RB_DWORDS (KGSL_RB_SIZE >> 2)
 
+/* Size in bytes of the per ringbuffer staging buffer for user submits */
+#define ADRENO_RB_SUBMIT_CMDS_SIZE PAGE_SIZE
+
 struct kgsl_device;
 struct kgsl_device_private;
 
@@ -147,6 +150,26 @@ struct adreno_ringbuffer {
 	 * enough.
 	 */
 	u32 profile_index;
+	/**
+	 * @submit_cmds: Staging buffer for the user IB wrapper built in
+	 * adreno_ringbuffer_submitcmd() so a submit doesn't need an allocation
+	 */
+	unsigned int *submit_cmds;
+	/** @submit_count: Number of user command objects submitted */
+	u64 submit_count;
+	/** @submit_bytes: Ringbuffer bytes written, context switches included */
+	u64 submit_bytes;
+	/** @slice_start: Jiffies when the ringbuffer last got the GPU */
+	unsigned long slice_start;
+	/**
+	 * @slice_expires: Jiffies when the time slice of the ringbuffer is up,
+	 * 0 if it hasn't started one
+	 */
+	unsigned long slice_expires;
+	/** @switched_in: Number of times the ringbuffer was preempted in */
+	unsigned int switched_in;
+	/** @run_time: Jiffies the ringbuffer had the GPU before preemptions */
+	unsigned long run_time;
 };
 
 /* Returns the current ringbuffer */
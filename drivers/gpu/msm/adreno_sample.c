@@ -0,0 +1,325 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#include <linux/mm.h>
+#include <linux/sysfs.h>
+#include <linux/vmalloc.h>
+
+#include "adreno.h"
+#include "adreno_pm4types.h"
+#include "kgsl_sharedmem.h"
+
+#include "a3xx_reg.h"
+#include "a6xx_reg.h"
+
+/*
+ * Always-on counter sampling. When enabled every command obj gets a
+ * CP_REG_TO_MEM of a handful of kernel owned counters before its first IB
+ * and after its last one. On retire the deltas are added to the context
+ * totals and appended to a ring that userspace maps read-only from the
+ * gpu_samples sysfs node. The counters are read by the CP as it processes
+ * the ringbuffer, so work still in the pipe at a boundary may be charged
+ * to the neighbouring command obj, and with preemption enabled a window
+ * can include commands from another ringbuffer.
+ */
+
+/*
+ * Kernel countable for each sampled counter. The CP, SP and TP countables
+ * are the same on A5XX and A6XX.
+ */
+static bool _sample_countable(struct adreno_device *adreno_dev,
+		unsigned int counter, unsigned int *groupid,
+		unsigned int *countable)
+{
+	*groupid = KGSL_PERFCOUNTER_GROUP_VBIF;
+
+	switch (counter) {
+	case KGSL_GPU_SAMPLE_BUSY:
+		*groupid = KGSL_PERFCOUNTER_GROUP_CP;
+		*countable = A6XX_CP_BUSY_CYCLES;
+		return true;
+	case KGSL_GPU_SAMPLE_ALU:
+		*groupid = KGSL_PERFCOUNTER_GROUP_SP;
+		*countable = A6XX_SP_ALU_ACTIVE_CYCLES;
+		return true;
+	case KGSL_GPU_SAMPLE_TEX:
+		*groupid = KGSL_PERFCOUNTER_GROUP_TP;
+		*countable = A6XX_TP_BUSY_CYCLES;
+		return true;
+	case KGSL_GPU_SAMPLE_RAM_RD:
+		*countable = adreno_has_gbif(adreno_dev) ?
+			GBIF_AXI0_READ_DATA_TOTAL_BEATS : VBIF_AXI_TOTAL_BEATS;
+		return true;
+	case KGSL_GPU_SAMPLE_RAM_WR:
+		*countable = GBIF_AXI0_WRITE_DATA_TOTAL_BEATS;
+		return adreno_has_gbif(adreno_dev);
+	}
+
+	return false;
+}
+
+static void _sample_put_counters(struct adreno_device *adreno_dev)
+{
+	struct adreno_sample *sample = &adreno_dev->sample;
+	unsigned int i, groupid, countable;
+
+	for (i = KGSL_GPU_SAMPLE_BUSY; i < KGSL_GPU_SAMPLE_MAX; i++) {
+		if (sample->regs[i] &&
+			_sample_countable(adreno_dev, i, &groupid, &countable))
+			adreno_perfcounter_put(adreno_dev, groupid, countable,
+				PERFCOUNTER_FLAG_KERNEL);
+		sample->regs[i] = 0;
+	}
+
+	sample->regs[KGSL_GPU_SAMPLE_TICKS] = 0;
+	sample->wide = 0;
+}
+
+/**
+ * adreno_sample_start() - Reserve the sampled counters
+ * @adreno_dev: Pointer to an adreno device
+ *
+ * Called from the start sequence with the GPU powered so the counters can
+ * be programmed. A counter that can't be reserved is left out of the
+ * samples and reads as 0.
+ */
+void adreno_sample_start(struct adreno_device *adreno_dev)
+{
+	struct adreno_sample *sample = &adreno_dev->sample;
+	unsigned int i, groupid, countable, lo, hi;
+
+	if (!sample->enabled)
+		return;
+
+	/* For a4x and some a5x the alwayson_hi read is masked */
+	if (adreno_is_a6xx(adreno_dev)) {
+		sample->regs[KGSL_GPU_SAMPLE_TICKS] =
+			A6XX_CP_ALWAYS_ON_COUNTER_LO;
+		set_bit(KGSL_GPU_SAMPLE_TICKS, &sample->wide);
+	} else {
+		sample->regs[KGSL_GPU_SAMPLE_TICKS] = adreno_getreg(adreno_dev,
+			ADRENO_REG_RBBM_ALWAYSON_COUNTER_LO);
+		if (ADRENO_GPUREV(adreno_dev) > ADRENO_REV_A530)
+			set_bit(KGSL_GPU_SAMPLE_TICKS, &sample->wide);
+	}
+
+	for (i = KGSL_GPU_SAMPLE_BUSY; i < KGSL_GPU_SAMPLE_MAX; i++) {
+		if (sample->regs[i] ||
+			!_sample_countable(adreno_dev, i, &groupid, &countable))
+			continue;
+
+		if (adreno_perfcounter_get(adreno_dev, groupid, countable,
+				&lo, &hi, PERFCOUNTER_FLAG_KERNEL))
+			continue;
+
+		sample->regs[i] = lo;
+		if (hi == lo + 1)
+			set_bit(i, &sample->wide);
+	}
+}
+
+/**
+ * adreno_sample_set_enabled() - Turn counter sampling on or off
+ * @adreno_dev: Pointer to an adreno device
+ * @enable: True to start sampling command objs
+ *
+ * The GPU is power cycled so the counters are reserved by the next start.
+ */
+int adreno_sample_set_enabled(struct adreno_device *adreno_dev, bool enable)
+{
+	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
+	struct adreno_sample *sample = &adreno_dev->sample;
+
+	if (sample->ring == NULL)
+		return -ENODEV;
+
+	mutex_lock(&device->mutex);
+
+	if (sample->enabled != enable) {
+		kgsl_pwrctrl_change_state(device, KGSL_STATE_SUSPEND);
+		sample->enabled = enable;
+		if (!enable)
+			_sample_put_counters(adreno_dev);
+		kgsl_pwrctrl_change_state(device, KGSL_STATE_SLUMBER);
+	}
+
+	mutex_unlock(&device->mutex);
+
+	return 0;
+}
+
+/**
+ * adreno_sample_cmds() - Add the counter reads for a command obj
+ * @adreno_dev: Pointer to an adreno device
+ * @cmds: Pointer to the commands, with room for ADRENO_SAMPLE_DWORDS
+ * @cmdobj: Command obj being submitted, with CMDOBJ_SAMPLE set
+ * @end: False for the reads before the IBs, true for the ones after them
+ *
+ * Returns the number of dwords written.
+ */
+unsigned int adreno_sample_cmds(struct adreno_device *adreno_dev,
+		unsigned int *cmds, struct kgsl_drawobj_cmd *cmdobj, bool end)
+{
+	struct adreno_sample *sample = &adreno_dev->sample;
+	uint64_t gpuaddr = sample->buffer.gpuaddr +
+		cmdobj->sample_index * sizeof(struct adreno_sample_entry);
+	unsigned int *p = cmds;
+	unsigned int i;
+
+	gpuaddr += end ? offsetof(struct adreno_sample_entry, end) :
+		offsetof(struct adreno_sample_entry, start);
+
+	for (i = 0; i < KGSL_GPU_SAMPLE_MAX; i++) {
+		if (!sample->regs[i])
+			continue;
+
+		*p++ = cp_mem_packet(adreno_dev, CP_REG_TO_MEM, 2, 1);
+		if (test_bit(i, &sample->wide))
+			*p++ = sample->regs[i] | (1 << 30) | (2 << 18);
+		else
+			*p++ = sample->regs[i];
+		p += cp_gpuaddr(adreno_dev, p, gpuaddr + i * sizeof(uint64_t));
+	}
+
+	return (unsigned int)(p - cmds);
+}
+
+/**
+ * adreno_sample_retire() - Account the samples of a retired command obj
+ * @adreno_dev: Pointer to an adreno device
+ * @drawctxt: Context of the command obj
+ * @cmdobj: The retired command obj
+ */
+void adreno_sample_retire(struct adreno_device *adreno_dev,
+		struct adreno_context *drawctxt, struct kgsl_drawobj_cmd *cmdobj)
+{
+	struct adreno_sample *sample = &adreno_dev->sample;
+	struct kgsl_drawobj *drawobj = DRAWOBJ(cmdobj);
+	struct kgsl_gpu_sample_ring *ring = sample->ring;
+	struct adreno_sample_entry *entry;
+	struct kgsl_gpu_sample *out;
+	unsigned int head = ring->head;
+	unsigned int i;
+
+	entry = sample->buffer.hostptr +
+		cmdobj->sample_index * sizeof(*entry);
+	out = (struct kgsl_gpu_sample *)(ring + 1) + (head % ring->count);
+
+	/* get updated values of the counters */
+	rmb();
+
+	for (i = 0; i < KGSL_GPU_SAMPLE_MAX; i++) {
+		uint64_t delta = entry->end[i] - entry->start[i];
+
+		/* 32 bit counters wrap on their own */
+		if (!test_bit(i, &sample->wide))
+			delta = (u32) delta;
+
+		out->counters[i] = delta;
+		drawctxt->sample_total[i] += delta;
+	}
+
+	out->context_id = drawobj->context->id;
+	out->timestamp = drawobj->timestamp;
+	out->pid = pid_nr(drawobj->context->proc_priv->pid);
+	out->__pad = 0;
+	out->retired_ns = ktime_get_ns();
+
+	/* Make the sample visible before the head that covers it */
+	smp_wmb();
+	WRITE_ONCE(ring->head, head + 1);
+}
+
+static int _sample_mmap(struct file *filep, struct kobject *kobj,
+		struct bin_attribute *attr, struct vm_area_struct *vma)
+{
+	struct kgsl_device *device = kgsl_device_from_dev(kobj_to_dev(kobj));
+	struct adreno_sample *sample;
+
+	if (device == NULL)
+		return -ENODEV;
+
+	sample = &ADRENO_DEVICE(device)->sample;
+	if (sample->ring == NULL)
+		return -ENODEV;
+
+	/* Only the kernel writes the ring */
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	return remap_vmalloc_range(vma, sample->ring, vma->vm_pgoff);
+}
+
+static struct bin_attribute gpu_samples_attr = {
+	.attr.name = "gpu_samples",
+	.attr.mode = 0444,
+	.size = ADRENO_SAMPLE_RING_SIZE,
+	.mmap = _sample_mmap,
+};
+
+/**
+ * adreno_sample_init() - Allocate the counter sampling buffers
+ * @adreno_dev: Pointer to an adreno device
+ *
+ * Sampling needs 64 bit CP_REG_TO_MEM and is only offered on A5XX and
+ * A6XX. It stays off until enabled through the gpu_sample sysfs node.
+ */
+void adreno_sample_init(struct adreno_device *adreno_dev)
+{
+	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
+	struct adreno_sample *sample = &adreno_dev->sample;
+	struct kgsl_gpu_sample_ring *ring;
+
+	if (!adreno_is_a5xx(adreno_dev) && !adreno_is_a6xx(adreno_dev))
+		return;
+
+	if (kgsl_allocate_global(device, &sample->buffer,
+			ADRENO_SAMPLE_BUF_SIZE, 0, 0, "gpu_sample"))
+		return;
+
+	kgsl_sharedmem_set(device, &sample->buffer, 0, 0,
+		ADRENO_SAMPLE_BUF_SIZE);
+
+	ring = vmalloc_user(ADRENO_SAMPLE_RING_SIZE);
+	if (ring == NULL)
+		goto err;
+
+	ring->count = (ADRENO_SAMPLE_RING_SIZE - sizeof(*ring)) /
+		sizeof(struct kgsl_gpu_sample);
+	ring->sample_size = sizeof(struct kgsl_gpu_sample);
+
+	if (sysfs_create_bin_file(&device->dev->kobj, &gpu_samples_attr)) {
+		vfree(ring);
+		goto err;
+	}
+
+	sample->ring = ring;
+	return;
+
+err:
+	kgsl_free_global(device, &sample->buffer);
+}
+
+void adreno_sample_close(struct adreno_device *adreno_dev)
+{
+	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
+	struct adreno_sample *sample = &adreno_dev->sample;
+
+	if (sample->ring == NULL)
+		return;
+
+	sysfs_remove_bin_file(&device->dev->kobj, &gpu_samples_attr);
+	vfree(sample->ring);
+	sample->ring = NULL;
+	kgsl_free_global(device, &sample->buffer);
+}
@@ -0,0 +1,73 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#ifndef __ADRENO_SAMPLE_H
+#define __ADRENO_SAMPLE_H
+
+#include <linux/sizes.h>
+#include <linux/msm_kgsl.h>
+
+struct adreno_device;
+struct adreno_context;
+struct kgsl_drawobj_cmd;
+
+/**
+ * struct adreno_sample_entry - Counter snapshots the CP writes for one
+ * command obj
+ * @start: Counter values before the first IB
+ * @end: Counter values after the last IB
+ */
+struct adreno_sample_entry {
+	uint64_t start[KGSL_GPU_SAMPLE_MAX];
+	uint64_t end[KGSL_GPU_SAMPLE_MAX];
+};
+
+#define ADRENO_SAMPLE_BUF_SIZE (2 * PAGE_SIZE)
+#define ADRENO_SAMPLE_COUNT \
+	(ADRENO_SAMPLE_BUF_SIZE / sizeof(struct adreno_sample_entry))
+
+/* Size of the ring of retired samples mapped by userspace */
+#define ADRENO_SAMPLE_RING_SIZE SZ_64K
+
+/**
+ * struct adreno_sample - Always-on counter sampling state
+ * @enabled: True if command objs are being sampled
+ * @buffer: GPU buffer of struct adreno_sample_entry slots
+ * @index: Next slot in @buffer, protected by device->mutex
+ * @regs: LO register of each counter, 0 if it isn't sampled
+ * @wide: Set for counters whose HI register follows the LO one and are
+ * read as 64 bits
+ * @ring: Ring of struct kgsl_gpu_sample mapped through sysfs, written only
+ * from the dispatcher retire path
+ */
+struct adreno_sample {
+	bool enabled;
+	struct kgsl_memdesc buffer;
+	unsigned int index;
+	unsigned int regs[KGSL_GPU_SAMPLE_MAX];
+	unsigned long wide;
+	struct kgsl_gpu_sample_ring *ring;
+};
+
+/* One CP_REG_TO_MEM per counter for each of the start and the end */
+#define ADRENO_SAMPLE_DWORDS (KGSL_GPU_SAMPLE_MAX * 4)
+
+void adreno_sample_init(struct adreno_device *adreno_dev);
+void adreno_sample_close(struct adreno_device *adreno_dev);
+void adreno_sample_start(struct adreno_device *adreno_dev);
+int adreno_sample_set_enabled(struct adreno_device *adreno_dev, bool enable);
+unsigned int adreno_sample_cmds(struct adreno_device *adreno_dev,
+		unsigned int *cmds, struct kgsl_drawobj_cmd *cmdobj, bool end);
+void adreno_sample_retire(struct adreno_device *adreno_dev,
+		struct adreno_context *drawctxt, struct kgsl_drawobj_cmd *cmdobj);
+
+#endif
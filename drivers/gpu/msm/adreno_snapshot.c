@@ -211,6 +211,12 @@ static inline void parse_ib(struct kgsl_device *device,
 					gpuaddr, dwords << 2))
 		return;
 
+	/* Leave the parsing to the snapshot worker for a fast snapshot */
+	if (snapshot->fast) {
+		kgsl_snapshot_defer_ib(snapshot, process, gpuaddr, dwords);
+		return;
+	}
+
 	if (-E2BIG == adreno_ib_create_object_list(device, process,
 				gpuaddr, dwords, snapshot->ib2base,
 				&ib_obj_list))
@@ -875,15 +881,18 @@ void adreno_snapshot(struct kgsl_device *device, struct kgsl_snapshot *snapshot,
 
 	adreno_snapshot_ringbuffer(device, snapshot, adreno_dev->cur_rb);
 
-	/* Dump the prev ringbuffer */
-	if (adreno_dev->prev_rb != adreno_dev->cur_rb)
-		adreno_snapshot_ringbuffer(device, snapshot,
-			adreno_dev->prev_rb);
-
-	if ((adreno_dev->next_rb != adreno_dev->prev_rb) &&
-		 (adreno_dev->next_rb != adreno_dev->cur_rb))
-		adreno_snapshot_ringbuffer(device, snapshot,
-			adreno_dev->next_rb);
+	/* A fast snapshot only needs the ringbuffer that faulted */
+	if (!snapshot->fast) {
+		/* Dump the prev ringbuffer */
+		if (adreno_dev->prev_rb != adreno_dev->cur_rb)
+			adreno_snapshot_ringbuffer(device, snapshot,
+				adreno_dev->prev_rb);
+
+		if ((adreno_dev->next_rb != adreno_dev->prev_rb) &&
+			 (adreno_dev->next_rb != adreno_dev->cur_rb))
+			adreno_snapshot_ringbuffer(device, snapshot,
+				adreno_dev->next_rb);
+	}
 
 	/* Dump selected global buffers */
 	kgsl_snapshot_add_section(device, KGSL_SNAPSHOT_SECTION_GPU_OBJECT_V2,
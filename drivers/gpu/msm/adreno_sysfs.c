@@ -13,6 +13,7 @@
 
 #include <linux/sysfs.h>
 #include <linux/device.h>
+#include <linux/math64.h>
 
 #include "kgsl_device.h"
 #include "adreno.h"
@@ -354,6 +355,32 @@ static unsigned int _preempt_count_show(struct adreno_device *adreno_dev)
 	return preempt->count;
 }
 
+static int _gpu_sample_store(struct adreno_device *adreno_dev,
+		unsigned int val)
+{
+	return adreno_sample_set_enabled(adreno_dev, val ? true : false);
+}
+
+static unsigned int _gpu_sample_show(struct adreno_device *adreno_dev)
+{
+	return adreno_dev->sample.enabled;
+}
+
+/* Average ringbuffer bytes written per user command object */
+static unsigned int _rb_submit_bytes_show(struct adreno_device *adreno_dev)
+{
+	struct adreno_ringbuffer *rb;
+	u64 bytes = 0, count = 0;
+	int i;
+
+	FOR_EACH_RINGBUFFER(adreno_dev, rb, i) {
+		bytes += rb->submit_bytes;
+		count += rb->submit_count;
+	}
+
+	return count ? (unsigned int) div64_u64(bytes, count) : 0;
+}
+
 static unsigned int _perfcounter_show(struct adreno_device *adreno_dev)
 {
 	return adreno_dev->perfcounter;
@@ -483,7 +510,9 @@ static ADRENO_SYSFS_BOOL(hwcg);
 static ADRENO_SYSFS_BOOL(throttling);
 static ADRENO_SYSFS_BOOL(ifpc);
 static ADRENO_SYSFS_RO_U32(ifpc_count);
+static ADRENO_SYSFS_RO_U32(rb_submit_bytes);
 static ADRENO_SYSFS_BOOL(perfcounter);
+static ADRENO_SYSFS_BOOL(gpu_sample);
 
 
 
@@ -507,7 +536,9 @@ static const struct device_attribute *_attr_list[] = {
 	&adreno_attr_ifpc.attr,
 	&adreno_attr_ifpc_count.attr,
 	&adreno_attr_preempt_count.attr,
+	&adreno_attr_rb_submit_bytes.attr,
 	&adreno_attr_perfcounter.attr,
+	&adreno_attr_gpu_sample.attr,
 	NULL,
 };
 
@@ -91,6 +91,8 @@ static inline struct kgsl_pagetable *_get_memdesc_pagetable(
 }
 
 static void kgsl_mem_entry_detach_process(struct kgsl_mem_entry *entry);
+static bool _kgsl_mem_entry_detach_process(struct kgsl_mem_entry *entry,
+		bool may_defer);
 
 static const struct file_operations kgsl_fops;
 
@@ -342,18 +344,31 @@ kgsl_mem_entry_destroy(struct kref *kref)
 	/* pull out the memtype before the flags get cleared */
 	memtype = kgsl_memdesc_usermem_type(&entry->memdesc);
 
-	/* Detach from process list */
-	kgsl_mem_entry_detach_process(entry);
-
 	if (memtype != KGSL_MEM_ENTRY_KERNEL)
 		atomic_long_sub(entry->memdesc.size,
 			&kgsl_driver.stats.mapped);
 
+	/*
+	 * Detach from process list. If the MMU takes the entry to unmap it
+	 * in a batch it frees it with kgsl_mem_entry_free() afterwards.
+	 */
+	if (_kgsl_mem_entry_detach_process(entry, true))
+		return;
+
+	kgsl_mem_entry_free(entry);
+}
+EXPORT_SYMBOL(kgsl_mem_entry_destroy);
+
+/**
+ * kgsl_mem_entry_free() - Free the memory of an entry nobody refers to
+ * @entry: Entry that is detached and no longer mapped in the GPU MMU
+ */
+void kgsl_mem_entry_free(struct kgsl_mem_entry *entry)
+{
 	kgsl_sharedmem_free(&entry->memdesc);
 
 	kfree(entry);
 }
-EXPORT_SYMBOL(kgsl_mem_entry_destroy);
 
 /* Allocate a IOVA for memory objects that don't use SVM */
 static int kgsl_mem_entry_track_gpuaddr(struct kgsl_device *device,
@@ -449,13 +464,20 @@ static int kgsl_mem_entry_attach_process(struct kgsl_device *device,
 	return ret;
 }
 
-/* Detach a memory entry from a process and unmap it from the MMU */
-static void kgsl_mem_entry_detach_process(struct kgsl_mem_entry *entry)
+/*
+ * Detach a memory entry from a process and unmap it from the MMU. With
+ * @may_defer the MMU can keep the entry for a batched unmap instead, which
+ * is reported by returning true; the entry must not be touched after that.
+ */
+static bool _kgsl_mem_entry_detach_process(struct kgsl_mem_entry *entry,
+		bool may_defer)
 {
+	struct kgsl_process_private *priv;
 	unsigned int type;
+	bool deferred = false;
 
 	if (entry == NULL)
-		return;
+		return false;
 
 	/*
 	 * First remove the entry from mem_idr list
@@ -468,14 +490,28 @@ static void kgsl_mem_entry_detach_process(struct kgsl_mem_entry *entry)
 
 	type = kgsl_memdesc_usermem_type(&entry->memdesc);
 	entry->priv->stats[type].cur -= entry->memdesc.size;
+	kgsl_process_charge_mm(entry->priv, type,
+		-(long)(PAGE_ALIGN(entry->memdesc.size) >> PAGE_SHIFT));
 
 	spin_unlock(&entry->priv->mem_lock);
 
-	kgsl_mmu_put_gpuaddr(&entry->memdesc);
+	priv = entry->priv;
+	entry->priv = NULL;
 
-	kgsl_process_private_put(entry->priv);
+	if (may_defer)
+		deferred = kgsl_mmu_defer_put_gpuaddr(entry);
+	if (!deferred)
+		kgsl_mmu_put_gpuaddr(&entry->memdesc);
 
-	entry->priv = NULL;
+	/* This may drop the last reference to the pagetable */
+	kgsl_process_private_put(priv);
+
+	return deferred;
+}
+
+static void kgsl_mem_entry_detach_process(struct kgsl_mem_entry *entry)
+{
+	_kgsl_mem_entry_detach_process(entry, false);
 }
 
 /**
@@ -877,6 +913,9 @@ static void kgsl_destroy_process_private(struct kref *kref)
 	idr_destroy(&private->mem_idr);
 	idr_destroy(&private->syncsource_idr);
 
+	if (private->mm)
+		mmdrop(private->mm);
+
 	/* When using global pagetables, do not detach global pagetable */
 	if (private->pagetable->name != KGSL_MMU_GLOBAL_PT)
 		kgsl_mmu_putpagetable(private->pagetable);
@@ -966,6 +1005,10 @@ static struct kgsl_process_private *kgsl_process_private_new(
 
 		kfree(private);
 		private = ERR_PTR(err);
+	} else if (current->mm) {
+		/* Pin the mm_struct, not the address space, for the charges */
+		private->mm = current->mm;
+		atomic_inc(&private->mm->mm_count);
 	}
 
 	return private;
@@ -1717,47 +1760,27 @@ long kgsl_ioctl_submit_commands(struct kgsl_device_private *dev_priv,
 	return result;
 }
 
-long kgsl_ioctl_gpu_command(struct kgsl_device_private *dev_priv,
-		unsigned int cmd, void *data)
+static long _create_gpu_command(struct kgsl_device *device,
+		struct kgsl_context *context, struct kgsl_gpu_command *param,
+		unsigned int type, struct kgsl_drawobj *drawobj[],
+		unsigned int *count)
 {
-	struct kgsl_gpu_command *param = data;
-	struct kgsl_device *device = dev_priv->device;
-	struct kgsl_context *context;
-	struct kgsl_drawobj *drawobj[2];
-	unsigned int type;
 	long result;
-	unsigned int i = 0;
-
-	type = _process_command_input(device, param->flags, param->numcmds,
-			param->numobjs, param->numsyncs);
-	if (!type)
-		return -EINVAL;
-
-	context = kgsl_context_get_owner(dev_priv, param->context_id);
-	if (context == NULL)
-		return -EINVAL;
-
-	if (_check_context_is_sparse(context, param->flags)) {
-		kgsl_context_put(context);
-		return -EINVAL;
-	}
 
 	if (type & SYNCOBJ_TYPE) {
 		struct kgsl_drawobj_sync *syncobj =
 				kgsl_drawobj_sync_create(device, context);
 
-		if (IS_ERR(syncobj)) {
-			result = PTR_ERR(syncobj);
-			goto done;
-		}
+		if (IS_ERR(syncobj))
+			return PTR_ERR(syncobj);
 
-		drawobj[i++] = DRAWOBJ(syncobj);
+		drawobj[(*count)++] = DRAWOBJ(syncobj);
 
 		result = kgsl_drawobj_sync_add_synclist(device, syncobj,
 				to_user_ptr(param->synclist),
 				param->syncsize, param->numsyncs);
 		if (result)
-			goto done;
+			return result;
 	}
 
 	if (type & (CMDOBJ_TYPE | MARKEROBJ_TYPE)) {
@@ -1765,24 +1788,22 @@ long kgsl_ioctl_gpu_command(struct kgsl_device_private *dev_priv,
 				kgsl_drawobj_cmd_create(device,
 					context, param->flags, type);
 
-		if (IS_ERR(cmdobj)) {
-			result = PTR_ERR(cmdobj);
-			goto done;
-		}
+		if (IS_ERR(cmdobj))
+			return PTR_ERR(cmdobj);
 
-		drawobj[i++] = DRAWOBJ(cmdobj);
+		drawobj[(*count)++] = DRAWOBJ(cmdobj);
 
 		result = kgsl_drawobj_cmd_add_cmdlist(device, cmdobj,
 			to_user_ptr(param->cmdlist),
 			param->cmdsize, param->numcmds);
 		if (result)
-			goto done;
+			return result;
 
 		result = kgsl_drawobj_cmd_add_memlist(device, cmdobj,
 			to_user_ptr(param->objlist),
 			param->objsize, param->numobjs);
 		if (result)
-			goto done;
+			return result;
 
 		/* If no profiling buffer was specified, clear the flag */
 		if (cmdobj->profiling_buf_entry == NULL)
@@ -1790,6 +1811,38 @@ long kgsl_ioctl_gpu_command(struct kgsl_device_private *dev_priv,
 				~(unsigned long)KGSL_DRAWOBJ_PROFILING;
 	}
 
+	return 0;
+}
+
+long kgsl_ioctl_gpu_command(struct kgsl_device_private *dev_priv,
+		unsigned int cmd, void *data)
+{
+	struct kgsl_gpu_command *param = data;
+	struct kgsl_device *device = dev_priv->device;
+	struct kgsl_context *context;
+	struct kgsl_drawobj *drawobj[2];
+	unsigned int type;
+	long result;
+	unsigned int i = 0;
+
+	type = _process_command_input(device, param->flags, param->numcmds,
+			param->numobjs, param->numsyncs);
+	if (!type)
+		return -EINVAL;
+
+	context = kgsl_context_get_owner(dev_priv, param->context_id);
+	if (context == NULL)
+		return -EINVAL;
+
+	if (_check_context_is_sparse(context, param->flags)) {
+		kgsl_context_put(context);
+		return -EINVAL;
+	}
+
+	result = _create_gpu_command(device, context, param, type, drawobj, &i);
+	if (result)
+		goto done;
+
 	result = device->ftbl->queue_cmds(dev_priv, context, drawobj,
 				i, &param->timestamp);
 
@@ -1806,6 +1859,128 @@ long kgsl_ioctl_gpu_command(struct kgsl_device_private *dev_priv,
 	return result;
 }
 
+/* Maximum number of submissions accepted by IOCTL_KGSL_GPU_COMMAND_BATCH */
+#define KGSL_GPU_COMMAND_BATCH_MAX 32
+
+static int _queue_gpu_command_batch(struct kgsl_device_private *dev_priv,
+		struct kgsl_drawobj_batch *batch, unsigned int count)
+{
+	struct kgsl_device *device = dev_priv->device;
+	unsigned int i;
+
+	if (device->ftbl->queue_cmds_batch)
+		return device->ftbl->queue_cmds_batch(dev_priv, batch, count);
+
+	for (i = 0; i < count; i++) {
+		batch[i].result = device->ftbl->queue_cmds(dev_priv,
+			batch[i].context, batch[i].drawobj, batch[i].count,
+			&batch[i].timestamp);
+
+		if (batch[i].result && batch[i].result != -EPROTO)
+			break;
+	}
+
+	return i;
+}
+
+long kgsl_ioctl_gpu_command_batch(struct kgsl_device_private *dev_priv,
+		unsigned int cmd, void *data)
+{
+	struct kgsl_gpu_command_batch *param = data;
+	struct kgsl_device *device = dev_priv->device;
+	struct kgsl_gpu_command c;
+	struct kgsl_drawobj_batch *batch;
+	void __user *ptr = to_user_ptr(param->cmdlist);
+	unsigned int i, j, count = 0, queued = 0;
+	long result = 0;
+
+	if (param->flags || param->count == 0 ||
+		param->count > KGSL_GPU_COMMAND_BATCH_MAX)
+		return -EINVAL;
+
+	/* The timestamp is written back in place so it has to be there */
+	if (param->cmdsize < offsetofend(struct kgsl_gpu_command, timestamp))
+		return -EINVAL;
+
+	batch = kcalloc(param->count, sizeof(*batch), GFP_KERNEL);
+	if (batch == NULL)
+		return -ENOMEM;
+
+	/* Build every draw object before handing anything to the device */
+	for (count = 0; count < param->count; count++) {
+		struct kgsl_drawobj_batch *entry = &batch[count];
+		unsigned int type;
+
+		result = _copy_from_user(&c, ptr + (u64) count * param->cmdsize,
+			sizeof(c), param->cmdsize);
+		if (result)
+			break;
+
+		type = _process_command_input(device, c.flags, c.numcmds,
+				c.numobjs, c.numsyncs);
+		if (!type) {
+			result = -EINVAL;
+			break;
+		}
+
+		entry->context = kgsl_context_get_owner(dev_priv,
+			c.context_id);
+		if (entry->context == NULL) {
+			result = -EINVAL;
+			break;
+		}
+
+		entry->timestamp = c.timestamp;
+
+		if (_check_context_is_sparse(entry->context, c.flags))
+			result = -EINVAL;
+		else
+			result = _create_gpu_command(device, entry->context, &c,
+				type, entry->drawobj, &entry->count);
+
+		if (result) {
+			count++;
+			break;
+		}
+	}
+
+	/* Queue the objects that were built successfully */
+	if (result == 0)
+		queued = _queue_gpu_command_batch(dev_priv, batch, count);
+
+	for (i = 0; i < count; i++) {
+		struct kgsl_drawobj_batch *entry = &batch[i];
+		void __user *ts = ptr + (u64) i * param->cmdsize +
+			offsetof(struct kgsl_gpu_command, timestamp);
+
+		if (i < queued) {
+			if (copy_to_user(ts, &entry->timestamp,
+				sizeof(entry->timestamp)) && !result)
+				result = -EFAULT;
+
+			/* -EPROTO only reports a previous context fault */
+			if (entry->result == -EPROTO && !result)
+				result = -EPROTO;
+		} else {
+			if (i == queued && !result)
+				result = entry->result;
+
+			for (j = 0; j < entry->count; j++)
+				kgsl_drawobj_destroy(entry->drawobj[j]);
+		}
+
+		kgsl_context_put(entry->context);
+	}
+
+	/* A partial submission is a success with a shorter count */
+	if (queued < param->count && queued && result != -EFAULT)
+		result = 0;
+	param->count = queued;
+
+	kfree(batch);
+	return result;
+}
+
 long kgsl_ioctl_cmdstream_readtimestamp_ctxtid(struct kgsl_device_private
 						*dev_priv, unsigned int cmd,
 						void *data)
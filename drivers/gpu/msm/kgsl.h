@@ -269,6 +269,8 @@ struct kgsl_memdesc {
  * @dev_priv: back pointer to the device file that created this entry.
  * @metadata: String containing user specified metadata for the entry
  * @work: Work struct used to schedule a kgsl_mem_entry_put in atomic contexts
+ * @lazy_node: Node in the pagetable list of freed entries waiting for a
+ *  batched unmap
  * @bind_lock: Lock for sparse memory bindings
  * @bind_tree: RB Tree for sparse memory bindings
  */
@@ -282,6 +284,7 @@ struct kgsl_mem_entry {
 	int pending_free;
 	char metadata[KGSL_GPUOBJ_ALLOC_METADATA_MAX + 1];
 	struct work_struct work;
+	struct list_head lazy_node;
 	spinlock_t bind_lock;
 	struct rb_root bind_tree;
 	/*
@@ -309,6 +312,8 @@ typedef void (*kgsl_event_func)(struct kgsl_device *, struct kgsl_event_group *,
  * @work: Work struct for dispatching the callback
  * @result: KGSL event result type to pass to the callback
  * group: The event group this event belongs to
+ * @signalled: Time in ns when the event was signalled
+ * @fast: Run the callback from the retire path instead of the workqueue
  */
 struct kgsl_event {
 	struct kgsl_device *device;
@@ -321,6 +326,8 @@ struct kgsl_event {
 	struct work_struct work;
 	int result;
 	struct kgsl_event_group *group;
+	uint64_t signalled;
+	bool fast;
 };
 
 typedef int (*readtimestamp_func)(struct kgsl_device *, void *,
@@ -429,6 +436,8 @@ long kgsl_ioctl_gpuobj_sync(struct kgsl_device_private *dev_priv,
 					unsigned int cmd, void *data);
 long kgsl_ioctl_gpu_command(struct kgsl_device_private *dev_priv,
 				unsigned int cmd, void *data);
+long kgsl_ioctl_gpu_command_batch(struct kgsl_device_private *dev_priv,
+				unsigned int cmd, void *data);
 long kgsl_ioctl_gpuobj_set_info(struct kgsl_device_private *dev_priv,
 				unsigned int cmd, void *data);
 
@@ -448,6 +457,7 @@ long kgsl_ioctl_gpu_sparse_command(struct kgsl_device_private *dev_priv,
 					unsigned int cmd, void *data);
 
 void kgsl_mem_entry_destroy(struct kref *kref);
+void kgsl_mem_entry_free(struct kgsl_mem_entry *entry);
 
 void kgsl_get_egl_counts(struct kgsl_mem_entry *entry,
 			int *egl_surface_count, int *egl_image_count);
@@ -66,6 +66,107 @@ static int _strict_get(void *data, u64 *val)
 
 DEFINE_SIMPLE_ATTRIBUTE(_strict_fops, _strict_get, _strict_set, "%llu\n");
 
+static int _large_pages_set(void *data, u64 val)
+{
+	kgsl_sharedmem_set_large_pages(val ? true : false);
+	return 0;
+}
+
+static int _large_pages_get(void *data, u64 *val)
+{
+	*val = kgsl_sharedmem_get_large_pages();
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(_large_pages_fops, _large_pages_get, _large_pages_set,
+	"%llu\n");
+
+static int _lazy_unmap_set(void *data, u64 val)
+{
+	kgsl_iommu_set_lazy_unmap(val ? true : false);
+	return 0;
+}
+
+static int _lazy_unmap_get(void *data, u64 *val)
+{
+	*val = kgsl_iommu_get_lazy_unmap();
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(_lazy_unmap_fops, _lazy_unmap_get, _lazy_unmap_set,
+	"%llu\n");
+
+static void latency_hist_print(struct seq_file *s,
+		struct kgsl_latency_hist *hist)
+{
+	int i;
+
+	seq_printf(s, "%10s %10s %10s %10s %10s\n", "usecs",
+		"queue", "submit", "retire", "signal");
+
+	for (i = 0; i < KGSL_LATENCY_BUCKETS; i++) {
+		if (i == KGSL_LATENCY_BUCKETS - 1)
+			seq_printf(s, ">=%8lu", 1UL << (i - 1));
+		else
+			seq_printf(s, "<%9lu", 1UL << i);
+
+		seq_printf(s, " %10d %10d %10d %10d\n",
+			atomic_read(&hist->count[KGSL_LATENCY_QUEUE][i]),
+			atomic_read(&hist->count[KGSL_LATENCY_SUBMIT][i]),
+			atomic_read(&hist->count[KGSL_LATENCY_RETIRE][i]),
+			atomic_read(&hist->count[KGSL_LATENCY_SIGNAL][i]));
+	}
+}
+
+static void latency_hist_reset(struct kgsl_latency_hist *hist)
+{
+	int i, j;
+
+	for (i = 0; i < KGSL_LATENCY_STAGES; i++)
+		for (j = 0; j < KGSL_LATENCY_BUCKETS; j++)
+			atomic_set(&hist->count[i][j], 0);
+}
+
+static int latency_print(struct seq_file *s, void *unused)
+{
+	struct kgsl_device *device = s->private;
+	int i;
+
+	for (i = 0; i < KGSL_LATENCY_PRIORITIES; i++) {
+		seq_printf(s, "priority %d:\n", i);
+		latency_hist_print(s, &device->latency[i]);
+	}
+
+	return 0;
+}
+
+static int latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, latency_print, inode->i_private);
+}
+
+/* Any write resets the histograms */
+static ssize_t latency_write(struct file *file, const char __user *buf,
+		size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct kgsl_device *device = s->private;
+	int i;
+
+	for (i = 0; i < KGSL_LATENCY_PRIORITIES; i++)
+		latency_hist_reset(&device->latency[i]);
+
+	return count;
+}
+
+static const struct file_operations latency_fops = {
+	.open = latency_open,
+	.read = seq_read,
+	.write = latency_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 void kgsl_device_debugfs_init(struct kgsl_device *device)
 {
 	if (kgsl_debugfs_dir && !IS_ERR(kgsl_debugfs_dir))
@@ -85,6 +186,8 @@ void kgsl_device_debugfs_init(struct kgsl_device *device)
 				&mem_log_fops);
 	debugfs_create_file("log_level_pwr", 0644, device->d_debugfs, device,
 				&pwr_log_fops);
+	debugfs_create_file("latency", 0644, device->d_debugfs, device,
+				&latency_fops);
 }
 
 void kgsl_device_debugfs_close(struct kgsl_device *device)
@@ -368,6 +471,116 @@ static const struct file_operations process_sparse_mem_fops = {
 	.release = process_mem_release,
 };
 
+/* Call func for every context owned by the process on every device */
+static void process_for_each_context(struct kgsl_process_private *private,
+		void (*func)(struct kgsl_context *, void *), void *data)
+{
+	struct kgsl_context *context;
+	int i, id;
+
+	for (i = 0; i < KGSL_DEVICE_MAX; i++) {
+		struct kgsl_device *device = kgsl_driver.devp[i];
+
+		if (device == NULL)
+			continue;
+
+		read_lock(&device->context_lock);
+		idr_for_each_entry(&device->context_idr, context, id) {
+			if (context->proc_priv == private)
+				func(context, data);
+		}
+		read_unlock(&device->context_lock);
+	}
+}
+
+static void process_latency_context_print(struct kgsl_context *context,
+		void *data)
+{
+	struct seq_file *s = data;
+
+	seq_printf(s, "context %d priority %d:\n", context->id,
+		context->priority);
+	latency_hist_print(s, &context->latency);
+}
+
+static int process_latency_print(struct seq_file *s, void *unused)
+{
+	process_for_each_context(s->private, process_latency_context_print, s);
+	return 0;
+}
+
+static int process_latency_open(struct inode *inode, struct file *file)
+{
+	int ret;
+	pid_t pid = (pid_t) (unsigned long) inode->i_private;
+	struct kgsl_process_private *private = NULL;
+
+	private = kgsl_process_private_find(pid);
+
+	if (!private)
+		return -ENODEV;
+
+	ret = single_open(file, process_latency_print, private);
+	if (ret)
+		kgsl_process_private_put(private);
+
+	return ret;
+}
+
+static void process_latency_context_reset(struct kgsl_context *context,
+		void *data)
+{
+	latency_hist_reset(&context->latency);
+}
+
+/* Any write resets the histograms of all the process contexts */
+static ssize_t process_latency_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+
+	process_for_each_context(s->private, process_latency_context_reset,
+		NULL);
+
+	return count;
+}
+
+static int process_latency_release(struct inode *inode, struct file *file)
+{
+	struct kgsl_process_private *private =
+		((struct seq_file *)file->private_data)->private;
+
+	kgsl_process_private_put(private);
+
+	return single_release(inode, file);
+}
+
+static const struct file_operations process_latency_fops = {
+	.open = process_latency_open,
+	.read = seq_read,
+	.write = process_latency_write,
+	.llseek = seq_lseek,
+	.release = process_latency_release,
+};
+
+static int pools_print(struct seq_file *s, void *unused)
+{
+	kgsl_pool_print_stats(s);
+	return 0;
+}
+
+static int pools_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pools_print, NULL);
+}
+
+static const struct file_operations pools_fops = {
+	.open = pools_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int globals_print(struct seq_file *s, void *unused)
 {
 	kgsl_print_global_pt_entries(s);
@@ -391,6 +604,24 @@ static const struct file_operations global_fops = {
 	.release = globals_release,
 };
 
+static int lazy_unmap_stats_print(struct seq_file *s, void *unused)
+{
+	kgsl_print_lazy_unmap_stats(s);
+	return 0;
+}
+
+static int lazy_unmap_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lazy_unmap_stats_print, NULL);
+}
+
+static const struct file_operations lazy_unmap_stats_fops = {
+	.open = lazy_unmap_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 /**
  * kgsl_process_init_debugfs() - Initialize debugfs for a process
  * @private: Pointer to process private structure created for the process
@@ -440,6 +671,14 @@ void kgsl_process_init_debugfs(struct kgsl_process_private *private)
 		WARN((dentry == NULL),
 			"Unable to create 'sparse_mem' file for %s\n", name);
 
+	dentry = debugfs_create_file("latency", 0644, private->debug_root,
+		(void *) ((unsigned long) pid_nr(private->pid)),
+		&process_latency_fops);
+
+	if (IS_ERR_OR_NULL(dentry))
+		WARN((dentry == NULL),
+			"Unable to create 'latency' file for %s\n", name);
+
 }
 
 void kgsl_core_debugfs_init(void)
@@ -451,11 +690,23 @@ void kgsl_core_debugfs_init(void)
 	debugfs_create_file("globals", 0444, kgsl_debugfs_dir, NULL,
 		&global_fops);
 
+	debugfs_create_file("pools", 0444, kgsl_debugfs_dir, NULL,
+		&pools_fops);
+
+	debugfs_create_file("lazy_unmap_stats", 0444, kgsl_debugfs_dir, NULL,
+		&lazy_unmap_stats_fops);
+
 	debug_dir = debugfs_create_dir("debug", kgsl_debugfs_dir);
 
 	debugfs_create_file("strict_memory", 0644, debug_dir, NULL,
 		&_strict_fops);
 
+	debugfs_create_file("large_pages", 0644, debug_dir, NULL,
+		&_large_pages_fops);
+
+	debugfs_create_file("lazy_unmap", 0644, debug_dir, NULL,
+		&_lazy_unmap_fops);
+
 	proc_d_debugfs = debugfs_create_dir("proc", kgsl_debugfs_dir);
 }
 
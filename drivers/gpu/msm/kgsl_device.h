@@ -15,6 +15,7 @@
 
 #include <linux/slab.h>
 #include <linux/idr.h>
+#include <linux/mm.h>
 #include <linux/pm_qos.h>
 #include <linux/sched.h>
 
@@ -115,6 +116,7 @@ struct kgsl_context;
 struct kgsl_power_stats;
 struct kgsl_event;
 struct kgsl_snapshot;
+struct kgsl_drawobj_batch;
 
 struct kgsl_functable {
 	/* Mandatory functions - these functions must be implemented
@@ -195,6 +197,8 @@ struct kgsl_functable {
 	void (*stop_fault_timer)(struct kgsl_device *device);
 	void (*dispatcher_halt)(struct kgsl_device *device);
 	void (*dispatcher_unhalt)(struct kgsl_device *device);
+	int (*queue_cmds_batch)(struct kgsl_device_private *dev_priv,
+		struct kgsl_drawobj_batch *batch, unsigned int count);
 };
 
 struct kgsl_ioctl {
@@ -229,6 +233,22 @@ struct kgsl_memobj_node {
 	unsigned long priv;
 };
 
+/**
+ * struct kgsl_drawobj_batch - One submission in a batched queue_cmds call
+ * @context: Context the draw objects are submitted to
+ * @drawobj: Draw objects for the submission
+ * @count: Number of valid entries in @drawobj
+ * @timestamp: Requested timestamp in, assigned timestamp out
+ * @result: Status of the submission set by the device
+ */
+struct kgsl_drawobj_batch {
+	struct kgsl_context *context;
+	struct kgsl_drawobj *drawobj[2];
+	unsigned int count;
+	uint32_t timestamp;
+	int result;
+};
+
 /**
  * struct kgsl_sparseobj_node - Sparse object descriptor
  * @node: Local list node for the sparse cmdbatch
@@ -241,6 +261,34 @@ struct kgsl_sparseobj_node {
 	struct kgsl_sparse_binding_object obj;
 };
 
+/**
+ * enum kgsl_latency_stage - Stages of a command tracked by the latency
+ * histograms
+ * @KGSL_LATENCY_QUEUE: From creation until the command is in the context queue
+ * @KGSL_LATENCY_SUBMIT: From the context queue until it is in the ringbuffer
+ * @KGSL_LATENCY_RETIRE: From the ringbuffer until the command retires
+ * @KGSL_LATENCY_SIGNAL: From retire until the timestamp event callbacks run
+ */
+enum kgsl_latency_stage {
+	KGSL_LATENCY_QUEUE = 0,
+	KGSL_LATENCY_SUBMIT,
+	KGSL_LATENCY_RETIRE,
+	KGSL_LATENCY_SIGNAL,
+	KGSL_LATENCY_STAGES,
+};
+
+/* Bucket N counts latencies below 2^N us, the last bucket is open ended */
+#define KGSL_LATENCY_BUCKETS 24
+#define KGSL_LATENCY_PRIORITIES 16
+
+/**
+ * struct kgsl_latency_hist - log2 latency histograms for each stage
+ * @count: Number of samples per stage and bucket
+ */
+struct kgsl_latency_hist {
+	atomic_t count[KGSL_LATENCY_STAGES][KGSL_LATENCY_BUCKETS];
+};
+
 struct kgsl_device {
 	struct device *dev;
 	const char *name;
@@ -314,6 +362,8 @@ struct kgsl_device {
 	bool snapshot_crashdumper;
 	/* Use HOST side register reads to get GPU snapshot*/
 	bool snapshot_legacy;
+	/* Only capture the minimal state synchronously on a fault */
+	bool snapshot_fast;
 
 	struct kobject snapshot_kobj;
 
@@ -338,6 +388,9 @@ struct kgsl_device {
 	struct clk *l3_clk;
 	unsigned int l3_freq[MAX_L3_LEVELS];
 	unsigned int num_l3_pwrlevels;
+
+	/* Latency histograms for each context priority */
+	struct kgsl_latency_hist latency[KGSL_LATENCY_PRIORITIES];
 };
 
 #define KGSL_MMU_DEVICE(_mmu) \
@@ -401,6 +454,7 @@ struct kgsl_process_private;
  * @fault_time: time of the first gpu hang in last _context_throttle_time ms
  * @user_ctxt_record: memory descriptor used by CP to save/restore VPC data
  * across preemption
+ * @latency: Latency histograms for the commands of this context
  */
 struct kgsl_context {
 	struct kref refcount;
@@ -420,8 +474,46 @@ struct kgsl_context {
 	unsigned int fault_count;
 	unsigned long fault_time;
 	struct kgsl_mem_entry *user_ctxt_record;
+	struct kgsl_latency_hist latency;
 };
 
+static inline void kgsl_latency_hist_add(struct kgsl_latency_hist *hist,
+		enum kgsl_latency_stage stage, uint64_t ns)
+{
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+	unsigned int bucket = us ? fls64(us) : 0;
+
+	if (bucket >= KGSL_LATENCY_BUCKETS)
+		bucket = KGSL_LATENCY_BUCKETS - 1;
+
+	atomic_inc(&hist->count[stage][bucket]);
+}
+
+/**
+ * kgsl_context_latency() - Account the time spent in a command stage
+ * @context: Context that owns the command
+ * @stage: Stage that just completed
+ * @start: Time in ns when the stage started, 0 if unknown
+ *
+ * Add a sample to the histograms of the context and of its priority level.
+ * Returns the current time so the caller can use it as the start of the next
+ * stage.
+ */
+static inline uint64_t kgsl_context_latency(struct kgsl_context *context,
+		enum kgsl_latency_stage stage, uint64_t start)
+{
+	uint64_t now = ktime_get_ns();
+
+	if (start && now >= start) {
+		kgsl_latency_hist_add(&context->latency, stage, now - start);
+		kgsl_latency_hist_add(&context->device->latency[
+			context->priority % KGSL_LATENCY_PRIORITIES],
+			stage, now - start);
+	}
+
+	return now;
+}
+
 #define _context_comm(_c) \
 	(((_c) && (_c)->proc_priv) ? (_c)->proc_priv->comm : "unknown")
 
@@ -454,6 +546,7 @@ struct kgsl_context {
  * @fd_count: Counter for the number of FDs for this process
  * @ctxt_count: Count for the number of contexts for this process
  * @ctxt_count_lock: Spinlock to protect ctxt_count
+ * @mm: mm_struct charged with the memory KGSL allocates for this process
  */
 struct kgsl_process_private {
 	unsigned long priv;
@@ -476,6 +569,7 @@ struct kgsl_process_private {
 	int fd_count;
 	atomic_t ctxt_count;
 	spinlock_t ctxt_count_lock;
+	struct mm_struct *mm;
 };
 
 /**
@@ -508,6 +602,7 @@ struct kgsl_device_private {
  * @mempool_size: Size of the memory pool
  * @obj_list: List of frozen GPU buffers that are waiting to be dumped.
  * @cp_list: List of IB's to be dumped.
+ * @ib_list: List of IB's waiting to be parsed by the worker in fast mode
  * @work: worker to dump the frozen memory
  * @dump_gate: completion gate signaled by worker when it is finished.
  * @process: the process that caused the hang, if known.
@@ -515,6 +610,7 @@ struct kgsl_device_private {
  * @first_read: True until the snapshot read is started
  * @gmu_fault: Snapshot collected when GMU fault happened
  * @recovered: True if GPU was recovered after previous snapshot
+ * @fast: True if only the minimal state was captured synchronously
  */
 struct kgsl_snapshot {
 	uint64_t ib1base;
@@ -532,6 +628,7 @@ struct kgsl_snapshot {
 	size_t mempool_size;
 	struct list_head obj_list;
 	struct list_head cp_list;
+	struct list_head ib_list;
 	struct work_struct work;
 	struct completion dump_gate;
 	struct kgsl_process_private *process;
@@ -539,6 +636,7 @@ struct kgsl_snapshot {
 	bool first_read;
 	bool gmu_fault;
 	bool recovered;
+	bool fast;
 };
 
 /**
@@ -561,12 +659,25 @@ struct kgsl_snapshot_object {
 
 struct kgsl_device *kgsl_get_device(int dev_idx);
 
+/*
+ * Memory KGSL allocates itself is charged to the mm of the process, so the
+ * low memory killer sees it. Imported memory is charged by its owner.
+ */
+static inline void kgsl_process_charge_mm(struct kgsl_process_private *priv,
+	unsigned int type, long pages)
+{
+	if (type == KGSL_MEM_ENTRY_KERNEL && priv->mm != NULL)
+		add_mm_counter(priv->mm, MM_UNRECLAIMABLE, pages);
+}
+
 static inline void kgsl_process_add_stats(struct kgsl_process_private *priv,
 	unsigned int type, uint64_t size)
 {
 	priv->stats[type].cur += size;
 	if (priv->stats[type].max < priv->stats[type].cur)
 		priv->stats[type].max = priv->stats[type].cur;
+
+	kgsl_process_charge_mm(priv, type, PAGE_ALIGN(size) >> PAGE_SHIFT);
 }
 
 static inline bool kgsl_is_register_offset(struct kgsl_device *device,
@@ -750,6 +861,9 @@ bool kgsl_event_pending(struct kgsl_device *device,
 		kgsl_event_func func, void *priv);
 int kgsl_add_event(struct kgsl_device *device, struct kgsl_event_group *group,
 		unsigned int timestamp, kgsl_event_func func, void *priv);
+int kgsl_add_fast_event(struct kgsl_device *device,
+		struct kgsl_event_group *group, unsigned int timestamp,
+		kgsl_event_func func, void *priv);
 void kgsl_process_event_group(struct kgsl_device *device,
 	struct kgsl_event_group *group);
 void kgsl_flush_event_group(struct kgsl_device *device,
@@ -992,6 +1106,10 @@ struct adreno_ib_object_list;
 int kgsl_snapshot_add_ib_obj_list(struct kgsl_snapshot *snapshot,
 	struct adreno_ib_object_list *ib_obj_list);
 
+int kgsl_snapshot_defer_ib(struct kgsl_snapshot *snapshot,
+	struct kgsl_process_private *process, uint64_t gpuaddr,
+	uint64_t dwords);
+
 void kgsl_snapshot_add_section(struct kgsl_device *device, u16 id,
 	struct kgsl_snapshot *snapshot,
 	size_t (*func)(struct kgsl_device *, u8 *, size_t, void *),
@@ -233,6 +233,32 @@ static void drawobj_sync_func(struct kgsl_device *device,
 	kgsl_drawobj_put(&event->syncobj->base);
 }
 
+/**
+ * kgsl_drawobj_sync_take_timestamp() - Take over a pending timestamp syncpoint
+ * @syncobj: Pointer to the sync obj
+ * @id: Index of the syncpoint in the sync obj
+ *
+ * Cancel the CPU event of a pending timestamp syncpoint so the caller can
+ * wait for the timestamp some other way. The reference to the context of the
+ * timestamp that the syncpoint held passes to the caller. Returns the context
+ * or NULL if the syncpoint isn't a pending timestamp.
+ */
+struct kgsl_context *kgsl_drawobj_sync_take_timestamp(
+		struct kgsl_drawobj_sync *syncobj, unsigned int id)
+{
+	struct kgsl_drawobj_sync_event *event = &syncobj->synclist[id];
+
+	if (event->type != KGSL_CMD_SYNCPOINT_TYPE_TIMESTAMP ||
+		!test_and_clear_bit(id, &syncobj->pending))
+		return NULL;
+
+	/* The callback sees the cleared bit and only drops the obj ref */
+	kgsl_cancel_event(event->device, &event->context->events,
+		event->timestamp, drawobj_sync_func, event);
+
+	return event->context;
+}
+
 static inline void memobj_list_free(struct list_head *list)
 {
 	struct kgsl_memobj_node *mem, *tmpmem;
@@ -311,6 +337,11 @@ static void drawobj_destroy_sync(struct kgsl_drawobj *drawobj)
 static void drawobj_destroy_cmd(struct kgsl_drawobj *drawobj)
 {
 	struct kgsl_drawobj_cmd *cmdobj = CMDOBJ(drawobj);
+	unsigned int i;
+
+	/* Drop the contexts of the timestamps the CP waited for */
+	for (i = 0; i < cmdobj->numwaits; i++)
+		kgsl_context_put(cmdobj->waits[i].context);
 
 	/*
 	 * Release the refcount on the mem entry associated with the
@@ -694,6 +725,7 @@ static void *_drawobj_create(struct kgsl_device *device,
 
 	kref_init(&drawobj->refcount);
 
+	drawobj->stage_time = ktime_get_ns();
 	drawobj->device = device;
 	drawobj->context = context;
 	drawobj->type = type;
@@ -1093,7 +1125,9 @@ int kgsl_drawobj_cmd_add_memlist(struct kgsl_device *device,
 			return -EINVAL;
 		}
 
-		if (obj.flags & KGSL_OBJLIST_PROFILE)
+		if (obj.flags & KGSL_OBJLIST_DEADLINE)
+			cmdobj->deadline = obj.offset;
+		else if (obj.flags & KGSL_OBJLIST_PROFILE)
 			add_profiling_buffer(device, cmdobj, obj.gpuaddr,
 				obj.size, obj.id, obj.offset);
 		else {
@@ -34,6 +34,8 @@
  * @timestamp: Timestamp assigned to the command
  * @flags: flags
  * @refcount: kref structure to maintain the reference count
+ * @stage_time: Time in ns when the object entered its current stage, used for
+ * the latency histograms
  */
 struct kgsl_drawobj {
 	struct kgsl_device *device;
@@ -42,6 +44,21 @@ struct kgsl_drawobj {
 	uint32_t timestamp;
 	unsigned long flags;
 	struct kref refcount;
+	uint64_t stage_time;
+};
+
+/* Number of timestamps the CP can wait for ahead of one command */
+#define KGSL_DRAWOBJ_GPU_WAITS 4
+
+/**
+ * struct kgsl_drawobj_gpu_wait - Timestamp the CP waits for in the memstore
+ * @context: Context that owns the timestamp. The reference is held until the
+ * wait is dropped so the memstore slot can't be reused while the CP polls it
+ * @timestamp: Timestamp to wait for
+ */
+struct kgsl_drawobj_gpu_wait {
+	struct kgsl_context *context;
+	unsigned int timestamp;
 };
 
 /**
@@ -66,8 +83,13 @@ struct kgsl_drawobj {
  * for easy access
  * @profile_index: Index to store the start/stop ticks in the kernel profiling
  * buffer
+ * @sample_index: Slot for the counter samples in the adreno sample buffer
  * @submit_ticks: Variable to hold ticks at the time of
  *     command obj submit.
+ * @deadline: Target completion time in ns of CLOCK_MONOTONIC or 0 if the
+ * command doesn't have one
+ * @waits: Timestamps of other contexts the CP waits for before the IBs
+ * @numwaits: Number of entries in @waits
 
  */
 struct kgsl_drawobj_cmd {
@@ -82,7 +104,11 @@ struct kgsl_drawobj_cmd {
 	struct kgsl_mem_entry *profiling_buf_entry;
 	uint64_t profiling_buffer_gpuaddr;
 	unsigned int profile_index;
+	unsigned int sample_index;
 	uint64_t submit_ticks;
+	uint64_t deadline;
+	struct kgsl_drawobj_gpu_wait waits[KGSL_DRAWOBJ_GPU_WAITS];
+	unsigned int numwaits;
 };
 
 /**
@@ -171,12 +197,14 @@ struct kgsl_drawobj_sparse {
  * @CMDOBJ_WFI - Force wait-for-idle for the submission
  * @CMDOBJ_PROFILE - store the start / retire ticks for
  * the command obj in the profiling buffer
+ * @CMDOBJ_SAMPLE - store the always-on counter samples for the command obj
  */
 enum kgsl_drawobj_cmd_priv {
 	CMDOBJ_SKIP = 0,
 	CMDOBJ_FORCE_PREAMBLE,
 	CMDOBJ_WFI,
 	CMDOBJ_PROFILE,
+	CMDOBJ_SAMPLE,
 };
 
 struct kgsl_drawobj_cmd *kgsl_drawobj_cmd_create(struct kgsl_device *device,
@@ -217,6 +245,9 @@ void kgsl_drawobjs_cache_exit(void);
 void kgsl_dump_syncpoints(struct kgsl_device *device,
 	struct kgsl_drawobj_sync *syncobj);
 
+struct kgsl_context *kgsl_drawobj_sync_take_timestamp(
+		struct kgsl_drawobj_sync *syncobj, unsigned int id);
+
 void kgsl_drawobj_destroy(struct kgsl_drawobj *drawobj);
 
 void kgsl_drawobj_destroy_object(struct kref *kref);
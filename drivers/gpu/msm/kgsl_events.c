@@ -13,6 +13,7 @@
 
 #include <linux/slab.h>
 #include <linux/list.h>
+#include <linux/rculist.h>
 #include <linux/workqueue.h>
 #include <linux/debugfs.h>
 #include <kgsl_device.h>
@@ -27,12 +28,39 @@
 static struct kmem_cache *events_cache;
 static struct dentry *events_dentry;
 
+/*
+ * Remove the event from its group and schedule the callback. Fast events
+ * that retired are moved to the fast list instead so the caller can run them
+ * as soon as it drops the group lock.
+ */
 static inline void signal_event(struct kgsl_device *device,
-		struct kgsl_event *event, int result)
+		struct kgsl_event *event, int result, struct list_head *fast)
 {
 	list_del(&event->node);
 	event->result = result;
-	queue_work(device->events_wq, &event->work);
+	event->signalled = ktime_get_ns();
+
+	if (fast && event->fast && result == KGSL_EVENT_RETIRED)
+		list_add_tail(&event->node, fast);
+	else
+		queue_work(device->events_wq, &event->work);
+}
+
+static void _kgsl_event_fire(struct kgsl_event *event)
+{
+	int id = KGSL_CONTEXT_ID(event->context);
+
+	trace_kgsl_fire_event(id, event->timestamp, event->result,
+		jiffies - event->created, event->func);
+
+	event->func(event->device, event->group, event->priv, event->result);
+
+	if (event->context && event->result == KGSL_EVENT_RETIRED)
+		kgsl_context_latency(event->context, KGSL_LATENCY_SIGNAL,
+			event->signalled);
+
+	kgsl_context_put(event->context);
+	kmem_cache_free(events_cache, event);
 }
 
 /**
@@ -44,16 +72,36 @@ static inline void signal_event(struct kgsl_device *device,
  */
 static void _kgsl_event_worker(struct work_struct *work)
 {
-	struct kgsl_event *event = container_of(work, struct kgsl_event, work);
-	int id = KGSL_CONTEXT_ID(event->context);
+	_kgsl_event_fire(container_of(work, struct kgsl_event, work));
+}
 
-	trace_kgsl_fire_event(id, event->timestamp, event->result,
-		jiffies - event->created, event->func);
+static void _kgsl_fire_fast_events(struct list_head *fast)
+{
+	struct kgsl_event *event, *tmp;
 
-	event->func(event->device, event->group, event->priv, event->result);
+	list_for_each_entry_safe(event, tmp, fast, node) {
+		list_del(&event->node);
+		_kgsl_event_fire(event);
+	}
+}
 
-	kgsl_context_put(event->context);
-	kmem_cache_free(events_cache, event);
+/*
+ * Insert the event in timestamp order. Timestamps are almost always added in
+ * increasing order so start looking from the tail of the list.
+ */
+static void _insert_event(struct kgsl_event_group *group,
+		struct kgsl_event *event)
+{
+	struct kgsl_event *pos;
+
+	list_for_each_entry_reverse(pos, &group->events, node) {
+		if (timestamp_cmp(pos->timestamp, event->timestamp) <= 0) {
+			list_add(&event->node, &pos->node);
+			return;
+		}
+	}
+
+	list_add(&event->node, &group->events);
 }
 
 /* return true if the group needs to be processed */
@@ -79,10 +127,27 @@ static void _process_event_group(struct kgsl_device *device,
 	struct kgsl_event *event, *tmp;
 	unsigned int timestamp;
 	struct kgsl_context *context;
+	LIST_HEAD(fast);
 
 	if (group == NULL)
 		return;
 
+	/*
+	 * Most groups have nothing to do on any given retire. Peek at the list
+	 * and the retired timestamp without the lock to skip them cheaply, a
+	 * racing kgsl_add_event() checks the retired timestamp by itself.
+	 */
+	if (!flush) {
+		if (list_empty(&group->events))
+			return;
+
+		group->readtimestamp(device, group->priv,
+			KGSL_TIMESTAMP_RETIRED, &timestamp);
+
+		if (!_do_process_group(group->processed, timestamp))
+			return;
+	}
+
 	context = group->context;
 
 	/*
@@ -102,18 +167,24 @@ static void _process_event_group(struct kgsl_device *device,
 	if (!flush && _do_process_group(group->processed, timestamp) == false)
 		goto out;
 
+	/* The list is in timestamp order so stop at the first pending event */
 	list_for_each_entry_safe(event, tmp, &group->events, node) {
 		if (timestamp_cmp(event->timestamp, timestamp) <= 0)
-			signal_event(device, event, KGSL_EVENT_RETIRED);
+			signal_event(device, event, KGSL_EVENT_RETIRED, &fast);
 		else if (flush)
-			signal_event(device, event, KGSL_EVENT_CANCELLED);
-
+			signal_event(device, event, KGSL_EVENT_CANCELLED,
+				NULL);
+		else
+			break;
 	}
 
 	group->processed = timestamp;
 
 out:
 	spin_unlock(&group->lock);
+
+	_kgsl_fire_fast_events(&fast);
+
 	kgsl_context_put(context);
 }
 
@@ -158,7 +229,7 @@ void kgsl_cancel_events_timestamp(struct kgsl_device *device,
 
 	list_for_each_entry_safe(event, tmp, &group->events, node) {
 		if (timestamp_cmp(timestamp, event->timestamp) == 0)
-			signal_event(device, event, KGSL_EVENT_CANCELLED);
+			signal_event(device, event, KGSL_EVENT_CANCELLED, NULL);
 	}
 
 	spin_unlock(&group->lock);
@@ -178,7 +249,7 @@ void kgsl_cancel_events(struct kgsl_device *device,
 	spin_lock(&group->lock);
 
 	list_for_each_entry_safe(event, tmp, &group->events, node)
-		signal_event(device, event, KGSL_EVENT_CANCELLED);
+		signal_event(device, event, KGSL_EVENT_CANCELLED, NULL);
 
 	spin_unlock(&group->lock);
 }
@@ -203,7 +274,7 @@ void kgsl_cancel_event(struct kgsl_device *device,
 	list_for_each_entry_safe(event, tmp, &group->events, node) {
 		if (timestamp == event->timestamp && func == event->func &&
 			event->priv == priv)
-			signal_event(device, event, KGSL_EVENT_CANCELLED);
+			signal_event(device, event, KGSL_EVENT_CANCELLED, NULL);
 	}
 
 	spin_unlock(&group->lock);
@@ -236,16 +307,9 @@ bool kgsl_event_pending(struct kgsl_device *device,
 	spin_unlock(&group->lock);
 	return result;
 }
-/**
- * kgsl_add_event() - Add a new GPU event to a group
- * @device: Pointer to a KGSL device
- * @group: Pointer to the group to add the event to
- * @timestamp: Timestamp that the event will expire on
- * @func: Callback function for the event
- * @priv: Private data to send to the callback function
- */
-int kgsl_add_event(struct kgsl_device *device, struct kgsl_event_group *group,
-		unsigned int timestamp, kgsl_event_func func, void *priv)
+static int _kgsl_add_event(struct kgsl_device *device,
+		struct kgsl_event_group *group, unsigned int timestamp,
+		kgsl_event_func func, void *priv, bool fast)
 {
 	unsigned int queued;
 	struct kgsl_context *context = group->context;
@@ -285,6 +349,7 @@ int kgsl_add_event(struct kgsl_device *device, struct kgsl_event_group *group,
 	event->func = func;
 	event->created = jiffies;
 	event->group = group;
+	event->fast = fast;
 
 	INIT_WORK(&event->work, _kgsl_event_worker);
 
@@ -301,31 +366,76 @@ int kgsl_add_event(struct kgsl_device *device, struct kgsl_event_group *group,
 
 	if (timestamp_cmp(retired, timestamp) >= 0) {
 		event->result = KGSL_EVENT_RETIRED;
-		queue_work(device->events_wq, &event->work);
+		event->signalled = ktime_get_ns();
 		spin_unlock(&group->lock);
+
+		if (fast)
+			_kgsl_event_fire(event);
+		else
+			queue_work(device->events_wq, &event->work);
 		return 0;
 	}
 
 	/* Add the event to the group list */
-	list_add_tail(&event->node, &group->events);
+	_insert_event(group, event);
 
 	spin_unlock(&group->lock);
 
 	return 0;
 }
+
+/**
+ * kgsl_add_event() - Add a new GPU event to a group
+ * @device: Pointer to a KGSL device
+ * @group: Pointer to the group to add the event to
+ * @timestamp: Timestamp that the event will expire on
+ * @func: Callback function for the event
+ * @priv: Private data to send to the callback function
+ */
+int kgsl_add_event(struct kgsl_device *device, struct kgsl_event_group *group,
+		unsigned int timestamp, kgsl_event_func func, void *priv)
+{
+	return _kgsl_add_event(device, group, timestamp, func, priv, false);
+}
 EXPORT_SYMBOL(kgsl_add_event);
 
-static DEFINE_RWLOCK(group_lock);
+/**
+ * kgsl_add_fast_event() - Add a new GPU event that is signalled from the
+ * retire path
+ * @device: Pointer to a KGSL device
+ * @group: Pointer to the group to add the event to
+ * @timestamp: Timestamp that the event will expire on
+ * @func: Callback function for the event
+ * @priv: Private data to send to the callback function
+ *
+ * Same as kgsl_add_event() but when the timestamp retires the callback is
+ * called directly by whoever processes the group instead of from the events
+ * workqueue. The callback can be called in atomic context so it must not
+ * sleep. Cancelled events still go through the workqueue.
+ */
+int kgsl_add_fast_event(struct kgsl_device *device,
+		struct kgsl_event_group *group, unsigned int timestamp,
+		kgsl_event_func func, void *priv)
+{
+	return _kgsl_add_event(device, group, timestamp, func, priv, true);
+}
+EXPORT_SYMBOL(kgsl_add_fast_event);
+
+/*
+ * The group list is walked under RCU on every retire; additions and removals
+ * are serialized by group_lock.
+ */
+static DEFINE_SPINLOCK(group_lock);
 static LIST_HEAD(group_list);
 
 void kgsl_process_event_groups(struct kgsl_device *device)
 {
 	struct kgsl_event_group *group;
 
-	read_lock(&group_lock);
-	list_for_each_entry(group, &group_list, group)
+	rcu_read_lock();
+	list_for_each_entry_rcu(group, &group_list, group)
 		_process_event_group(device, group, false);
-	read_unlock(&group_lock);
+	rcu_read_unlock();
 }
 EXPORT_SYMBOL(kgsl_process_event_groups);
 
@@ -338,9 +448,12 @@ void kgsl_del_event_group(struct kgsl_event_group *group)
 	/* Make sure that all the events have been deleted from the list */
 	BUG_ON(!list_empty(&group->events));
 
-	write_lock(&group_lock);
-	list_del(&group->group);
-	write_unlock(&group_lock);
+	spin_lock(&group_lock);
+	list_del_rcu(&group->group);
+	spin_unlock(&group_lock);
+
+	/* Wait for anybody still processing the group before it is freed */
+	synchronize_rcu();
 }
 EXPORT_SYMBOL(kgsl_del_event_group);
 
@@ -369,9 +482,9 @@ void kgsl_add_event_group(struct kgsl_event_group *group,
 	if (name)
 		strlcpy(group->name, name, sizeof(group->name));
 
-	write_lock(&group_lock);
-	list_add_tail(&group->group, &group_list);
-	write_unlock(&group_lock);
+	spin_lock(&group_lock);
+	list_add_tail_rcu(&group->group, &group_list);
+	spin_unlock(&group_lock);
 }
 EXPORT_SYMBOL(kgsl_add_event_group);
 
@@ -406,12 +519,12 @@ static int events_debugfs_print(struct seq_file *s, void *unused)
 	seq_puts(s, "event groups:\n");
 	seq_puts(s, "--------------\n");
 
-	read_lock(&group_lock);
-	list_for_each_entry(group, &group_list, group) {
+	rcu_read_lock();
+	list_for_each_entry_rcu(group, &group_list, group) {
 		events_debugfs_print_group(s, group);
 		seq_puts(s, "\n");
 	}
-	read_unlock(&group_lock);
+	rcu_read_unlock();
 
 	return 0;
 }
@@ -22,6 +22,8 @@
 #include <linux/ratelimit.h>
 #include <linux/of_platform.h>
 #include <linux/random.h>
+#include <linux/list_sort.h>
+#include <linux/ktime.h>
 #include <soc/qcom/scm.h>
 #include <soc/qcom/secure_buffer.h>
 #include <linux/compat.h>
@@ -57,6 +59,31 @@
 static struct kgsl_mmu_pt_ops iommu_pt_ops;
 static bool need_iommu_sync;
 
+/*
+ * Freed per-process buffers are unmapped in batches: the entries queue up on
+ * their pagetable and a worker unmaps them with one sync lock hold, merging
+ * neighbouring ranges, before releasing the addresses and the memory.
+ */
+#define KGSL_IOMMU_LAZY_MAX_ENTRIES 64
+#define KGSL_IOMMU_LAZY_MAX_BYTES SZ_16M
+#define KGSL_IOMMU_LAZY_DELAY (HZ / 20)
+
+static bool lazy_unmap = true;
+
+static struct {
+	atomic_long_t batches;
+	atomic_long_t entries;
+	atomic_long_t runs;
+	atomic_long_t max_batch;
+	atomic_long_t batch_ns;
+	atomic_long_t single;
+	atomic_long_t single_ns;
+} lazy_stats;
+
+static void _iommu_lazy_flush(struct kgsl_iommu_pt *iommu_pt);
+static void _iommu_lazy_work(struct work_struct *work);
+static void _iova_cache_drain(struct kgsl_pagetable *pagetable);
+
 const unsigned int kgsl_iommu_reg_list[KGSL_IOMMU_REG_MAX] = {
 	0x0,/* SCTLR */
 	0x20,/* TTBR0 */
@@ -1055,6 +1082,11 @@ static void kgsl_iommu_destroy_pagetable(struct kgsl_pagetable *pt)
 	 */
 	WARN_ON(!list_empty(&pt->list));
 
+	/* Nothing can queue more entries now, finish the pending ones */
+	cancel_delayed_work_sync(&iommu_pt->lazy_work);
+	_iommu_lazy_flush(iommu_pt);
+	_iova_cache_drain(pt);
+
 	iommu = _IOMMU_PRIV(mmu);
 
 	if (pt->name == KGSL_MMU_SECURE_PT) {
@@ -1157,6 +1189,9 @@ _alloc_pt(struct device *dev, struct kgsl_mmu *mmu, struct kgsl_pagetable *pt)
 	pt->priv = iommu_pt;
 	pt->fault_addr = ~0ULL;
 	iommu_pt->rbtree = RB_ROOT;
+	spin_lock_init(&iommu_pt->lazy_lock);
+	INIT_LIST_HEAD(&iommu_pt->lazy_list);
+	INIT_DELAYED_WORK(&iommu_pt->lazy_work, _iommu_lazy_work);
 
 	if (MMU_FEATURE(mmu, KGSL_MMU_64BIT))
 		setup_64bit_pagetable(mmu, pt, iommu_pt);
@@ -1409,6 +1444,8 @@ static int _init_per_process_pt(struct kgsl_mmu *mmu, struct kgsl_pagetable *pt)
 
 	ret = kgsl_iommu_map_globals(pt);
 
+	iommu_pt->lazy = true;
+
 done:
 	if (ret)
 		_free_pt(ctx, pt);
@@ -1748,14 +1785,105 @@ kgsl_iommu_unmap_offset(struct kgsl_pagetable *pt,
 	return _iommu_unmap_sync_pc(pt, addr + offset, size);
 }
 
+/*
+ * Split a physically contiguous run the same way the IOMMU driver does
+ * when mapping it: always use the largest supported page size that both
+ * addresses are aligned to and that fits in the remaining length.
+ */
+static void _iommu_pgsize_run(long *count, unsigned long pgsize_bitmap,
+		uint64_t iova, phys_addr_t phys, uint64_t len)
+{
+	while (len) {
+		size_t pgsize = iommu_pgsize(pgsize_bitmap,
+				(unsigned long)(iova | phys), len);
+
+		if (pgsize >= SZ_2M)
+			count[KGSL_MMU_PGSIZE_2M] += pgsize;
+		else if (pgsize >= SZ_64K)
+			count[KGSL_MMU_PGSIZE_64K] += pgsize;
+		else
+			count[KGSL_MMU_PGSIZE_4K] += pgsize;
+
+		iova += pgsize;
+		phys += pgsize;
+		len -= pgsize;
+	}
+}
+
+/*
+ * Account how much of the memdesc the IOMMU maps with each page size.
+ * Only per-process buffers are counted, global buffers are mapped into
+ * every pagetable.
+ */
+static void _iommu_pgsize_account(struct kgsl_pagetable *pt,
+		struct kgsl_memdesc *memdesc, bool map)
+{
+	struct kgsl_iommu_pt *iommu_pt = pt->priv;
+	unsigned long pgsize_bitmap = iommu_pt->domain->pgsize_bitmap;
+	long count[KGSL_MMU_PGSIZE_MAX] = { 0 };
+	uint64_t iova = memdesc->gpuaddr;
+	unsigned int i, n;
+	int j;
+
+	if (kgsl_memdesc_is_global(memdesc) || !pgsize_bitmap ||
+		(memdesc->flags & (KGSL_MEMFLAGS_SPARSE_VIRT |
+				KGSL_MEMFLAGS_SPARSE_PHYS)))
+		return;
+
+	if (memdesc->pages != NULL) {
+		for (i = 0; i < memdesc->page_count; i += n) {
+			unsigned long pfn = page_to_pfn(memdesc->pages[i]);
+
+			for (n = 1; i + n < memdesc->page_count; n++)
+				if (page_to_pfn(memdesc->pages[i + n]) !=
+						pfn + n)
+					break;
+
+			_iommu_pgsize_run(count, pgsize_bitmap, iova,
+				PFN_PHYS(pfn), (uint64_t)n << PAGE_SHIFT);
+			iova += (uint64_t)n << PAGE_SHIFT;
+		}
+	} else if (memdesc->sgt != NULL) {
+		struct scatterlist *sg;
+
+		for_each_sg(memdesc->sgt->sgl, sg, memdesc->sgt->nents, j) {
+			_iommu_pgsize_run(count, pgsize_bitmap, iova,
+				sg_phys(sg), sg->length);
+			iova += sg->length;
+		}
+	}
+
+	for (j = 0; j < KGSL_MMU_PGSIZE_MAX; j++) {
+		if (map)
+			atomic_long_add(count[j],
+				&pt->stats.mapped_pgsize[j]);
+		else
+			atomic_long_sub(count[j],
+				&pt->stats.mapped_pgsize[j]);
+	}
+}
+
 static int
 kgsl_iommu_unmap(struct kgsl_pagetable *pt, struct kgsl_memdesc *memdesc)
 {
+	u64 start;
+	int ret;
+
 	if (memdesc->size == 0 || memdesc->gpuaddr == 0)
 		return -EINVAL;
 
-	return kgsl_iommu_unmap_offset(pt, memdesc, memdesc->gpuaddr, 0,
+	start = ktime_get_ns();
+	ret = kgsl_iommu_unmap_offset(pt, memdesc, memdesc->gpuaddr, 0,
 			kgsl_memdesc_footprint(memdesc));
+	if (!ret) {
+		atomic_long_inc(&lazy_stats.single);
+		atomic_long_add(ktime_get_ns() - start, &lazy_stats.single_ns);
+	}
+
+	if (!ret && (memdesc->priv & KGSL_MEMDESC_MAPPED))
+		_iommu_pgsize_account(pt, memdesc, false);
+
+	return ret;
 }
 
 /**
@@ -1862,6 +1990,8 @@ kgsl_iommu_map(struct kgsl_pagetable *pt,
 	ret = _iommu_map_guard_page(pt, memdesc, addr + size, flags);
 	if (ret)
 		_iommu_unmap_sync_pc(pt, addr, size);
+	else
+		_iommu_pgsize_account(pt, memdesc, true);
 
 done:
 	if (memdesc->pages != NULL)
@@ -2287,6 +2417,92 @@ static int _insert_gpuaddr(struct kgsl_pagetable *pagetable,
 	return 0;
 }
 
+/*
+ * Return the free range cache class for @memdesc, or -1 if its ranges are not
+ * cached. Only plain buffers in per-process pagetables qualify, SVM ranges
+ * follow the CPU address space and secure buffers have their own pagetable.
+ */
+static int _iova_cache_class(struct kgsl_pagetable *pagetable,
+		struct kgsl_memdesc *memdesc)
+{
+	uint64_t size = kgsl_memdesc_footprint(memdesc);
+
+	if (pagetable->name == KGSL_MMU_GLOBAL_PT ||
+		pagetable->name == KGSL_MMU_SECURE_PT ||
+		kgsl_memdesc_use_cpu_map(memdesc) ||
+		kgsl_memdesc_is_secured(memdesc))
+		return -1;
+
+	if (size == 0 || !PAGE_ALIGNED(size) ||
+		(size >> PAGE_SHIFT) > KGSL_IOMMU_IOVA_CACHE_CLASSES)
+		return -1;
+
+	return (size >> PAGE_SHIFT) - 1;
+}
+
+/* Take a cached range that fits the constraints, called with the lock held */
+static uint64_t _iova_cache_get(struct kgsl_pagetable *pagetable, int class,
+		uint64_t start, uint64_t end, uint64_t size, uint64_t align)
+{
+	struct kgsl_iommu_pt *pt = pagetable->priv;
+	unsigned int i;
+
+	if (class < 0)
+		return 0;
+
+	for (i = pt->iova_cache[class].count; i-- > 0; ) {
+		uint64_t addr = pt->iova_cache[class].addr[i];
+
+		if (addr < start || addr + size > end ||
+			!IS_ALIGNED(addr, align))
+			continue;
+
+		pt->iova_cache[class].addr[i] =
+			pt->iova_cache[class].addr[--pt->iova_cache[class].count];
+		atomic_long_inc(&pagetable->stats.iova_cache_hits);
+		return addr;
+	}
+
+	atomic_long_inc(&pagetable->stats.iova_cache_misses);
+	return 0;
+}
+
+/* Keep a freed range for reuse, called with the lock held */
+static bool _iova_cache_put(struct kgsl_pagetable *pagetable,
+		struct kgsl_memdesc *memdesc)
+{
+	struct kgsl_iommu_pt *pt = pagetable->priv;
+	uint64_t addr = memdesc->gpuaddr;
+	uint64_t size = kgsl_memdesc_footprint(memdesc);
+	int class = _iova_cache_class(pagetable, memdesc);
+
+	if (class < 0 ||
+		pt->iova_cache[class].count == KGSL_IOMMU_IOVA_CACHE_DEPTH)
+		return false;
+
+	/* A 32 bit range may overlap SVM, leave it free for a CPU address */
+	if (addr < pt->svm_end && addr + size > pt->svm_start)
+		return false;
+
+	pt->iova_cache[class].addr[pt->iova_cache[class].count++] = addr;
+	return true;
+}
+
+static void _iova_cache_drain(struct kgsl_pagetable *pagetable)
+{
+	struct kgsl_iommu_pt *pt = pagetable->priv;
+	int i;
+
+	spin_lock(&pagetable->lock);
+
+	for (i = 0; i < KGSL_IOMMU_IOVA_CACHE_CLASSES; i++)
+		while (pt->iova_cache[i].count)
+			_remove_gpuaddr(pagetable, pt->iova_cache[i].addr[
+					--pt->iova_cache[i].count]);
+
+	spin_unlock(&pagetable->lock);
+}
+
 static uint64_t _get_unmapped_area(struct kgsl_pagetable *pagetable,
 		uint64_t bottom, uint64_t top, uint64_t size,
 		uint64_t align)
@@ -2524,6 +2740,15 @@ static int kgsl_iommu_get_gpuaddr(struct kgsl_pagetable *pagetable,
 
 	spin_lock(&pagetable->lock);
 
+	/* A cached range is still in the rbtree, so it just changes owner */
+	addr = _iova_cache_get(pagetable, _iova_cache_class(pagetable, memdesc),
+			start, end, size, align);
+	if (addr) {
+		memdesc->gpuaddr = addr;
+		memdesc->pagetable = pagetable;
+		goto out;
+	}
+
 	addr = _get_unmapped_area(pagetable, start, end, size, align);
 
 	if (addr == (uint64_t) -ENOMEM) {
@@ -2554,11 +2779,219 @@ static void kgsl_iommu_put_gpuaddr(struct kgsl_memdesc *memdesc)
 
 	spin_lock(&memdesc->pagetable->lock);
 
-	_remove_gpuaddr(memdesc->pagetable, memdesc->gpuaddr);
+	if (!_iova_cache_put(memdesc->pagetable, memdesc))
+		_remove_gpuaddr(memdesc->pagetable, memdesc->gpuaddr);
 
 	spin_unlock(&memdesc->pagetable->lock);
 }
 
+void kgsl_iommu_set_lazy_unmap(bool val)
+{
+	lazy_unmap = val;
+}
+
+bool kgsl_iommu_get_lazy_unmap(void)
+{
+	return lazy_unmap;
+}
+
+void kgsl_print_lazy_unmap_stats(struct seq_file *s)
+{
+	long batches = atomic_long_read(&lazy_stats.batches);
+	long entries = atomic_long_read(&lazy_stats.entries);
+	long single = atomic_long_read(&lazy_stats.single);
+	u64 batch_ns = atomic_long_read(&lazy_stats.batch_ns);
+	u64 single_ns = atomic_long_read(&lazy_stats.single_ns);
+	u64 single_avg = single ? div64_u64(single_ns, single) : 0;
+	u64 batch_avg = entries ? div64_u64(batch_ns, entries) : 0;
+
+	seq_printf(s, "enabled: %d\n", lazy_unmap);
+	seq_printf(s, "batches: %ld\n", batches);
+	seq_printf(s, "entries: %ld\n", entries);
+	seq_printf(s, "unmap calls: %ld\n",
+		atomic_long_read(&lazy_stats.runs));
+	seq_printf(s, "average batch: %ld\n", batches ? entries / batches : 0);
+	seq_printf(s, "largest batch: %ld\n",
+		atomic_long_read(&lazy_stats.max_batch));
+	seq_printf(s, "single unmap: %llu ns\n", single_avg);
+	seq_printf(s, "batched unmap: %llu ns per entry\n", batch_avg);
+	seq_printf(s, "time saved: %llu us\n", single_avg > batch_avg ?
+		div_u64((single_avg - batch_avg) * entries, NSEC_PER_USEC) :
+		0);
+}
+
+static int _lazy_cmp(void *priv, struct list_head *a, struct list_head *b)
+{
+	struct kgsl_mem_entry *ea = list_entry(a, struct kgsl_mem_entry,
+			lazy_node);
+	struct kgsl_mem_entry *eb = list_entry(b, struct kgsl_mem_entry,
+			lazy_node);
+
+	if (ea->memdesc.gpuaddr < eb->memdesc.gpuaddr)
+		return -1;
+
+	return ea->memdesc.gpuaddr > eb->memdesc.gpuaddr;
+}
+
+/*
+ * Unmap the adjacent entries from @entry up to @end with a single call. The
+ * entries that are gone get KGSL_MEMDESC_MAPPED cleared; on a failure they
+ * all keep it, so their addresses are never handed out again.
+ */
+static void _iommu_lazy_unmap_run(struct kgsl_iommu_pt *iommu_pt,
+		struct list_head *head, struct kgsl_mem_entry *entry,
+		uint64_t end)
+{
+	uint64_t start = entry->memdesc.gpuaddr;
+	size_t unmapped;
+
+	unmapped = iommu_unmap(iommu_pt->domain, start, end - start);
+	atomic_long_inc(&lazy_stats.runs);
+
+	if (unmapped != end - start) {
+		KGSL_CORE_ERR("unmap err: 0x%016llx, 0x%llx, %zd\n",
+			start, end - start, unmapped);
+		return;
+	}
+
+	list_for_each_entry_from(entry, head, lazy_node) {
+		if (entry->memdesc.gpuaddr >= end)
+			break;
+		entry->memdesc.priv &= ~KGSL_MEMDESC_MAPPED;
+	}
+}
+
+static void _iommu_lazy_flush(struct kgsl_iommu_pt *iommu_pt)
+{
+	struct kgsl_mem_entry *entry, *tmp, *run = NULL;
+	struct kgsl_pagetable *pt;
+	LIST_HEAD(list);
+	unsigned int count;
+	uint64_t end = 0;
+	u64 start;
+	long max;
+
+	spin_lock(&iommu_pt->lazy_lock);
+	list_splice_init(&iommu_pt->lazy_list, &list);
+	count = iommu_pt->lazy_count;
+	iommu_pt->lazy_count = 0;
+	iommu_pt->lazy_bytes = 0;
+	spin_unlock(&iommu_pt->lazy_lock);
+
+	if (list_empty(&list))
+		return;
+
+	list_sort(NULL, &list, _lazy_cmp);
+	pt = list_first_entry(&list, struct kgsl_mem_entry,
+			lazy_node)->memdesc.pagetable;
+
+	start = ktime_get_ns();
+	_iommu_sync_mmu_pc(true);
+
+	list_for_each_entry(entry, &list, lazy_node) {
+		struct kgsl_memdesc *memdesc = &entry->memdesc;
+
+		if (run != NULL && memdesc->gpuaddr == end) {
+			end += kgsl_memdesc_footprint(memdesc);
+			continue;
+		}
+
+		if (run != NULL)
+			_iommu_lazy_unmap_run(iommu_pt, &list, run, end);
+
+		run = entry;
+		end = memdesc->gpuaddr + kgsl_memdesc_footprint(memdesc);
+	}
+	_iommu_lazy_unmap_run(iommu_pt, &list, run, end);
+
+	_iommu_sync_mmu_pc(false);
+	atomic_long_add(ktime_get_ns() - start, &lazy_stats.batch_ns);
+
+	list_for_each_entry_safe(entry, tmp, &list, lazy_node) {
+		struct kgsl_memdesc *memdesc = &entry->memdesc;
+
+		list_del(&entry->lazy_node);
+
+		/* Same as kgsl_mmu_put_gpuaddr(): keep the address on failure */
+		if (!(memdesc->priv & KGSL_MEMDESC_MAPPED)) {
+			_iommu_pgsize_account(pt, memdesc, false);
+			atomic_dec(&pt->stats.entries);
+			atomic_long_sub(kgsl_memdesc_footprint(memdesc),
+				&pt->stats.mapped);
+			kgsl_iommu_put_gpuaddr(memdesc);
+		}
+
+		memdesc->pagetable = NULL;
+		memdesc->gpuaddr = 0;
+
+		kgsl_mem_entry_free(entry);
+	}
+
+	atomic_long_inc(&lazy_stats.batches);
+	atomic_long_add(count, &lazy_stats.entries);
+
+	max = atomic_long_read(&lazy_stats.max_batch);
+	while (count > max) {
+		long old = atomic_long_cmpxchg(&lazy_stats.max_batch, max,
+				count);
+
+		if (old == max)
+			break;
+		max = old;
+	}
+}
+
+static void _iommu_lazy_work(struct work_struct *work)
+{
+	struct kgsl_iommu_pt *iommu_pt = container_of(to_delayed_work(work),
+			struct kgsl_iommu_pt, lazy_work);
+
+	_iommu_lazy_flush(iommu_pt);
+}
+
+/*
+ * Queue a freed entry for a batched unmap. Only plain per-process buffers
+ * qualify: globals live in every pagetable, secure and sparse buffers are
+ * mapped differently and an SVM address is also a CPU address that the
+ * process may map again straight away.
+ */
+static bool kgsl_iommu_defer_put_gpuaddr(struct kgsl_pagetable *pt,
+		struct kgsl_mem_entry *entry)
+{
+	struct kgsl_iommu_pt *iommu_pt = pt->priv;
+	struct kgsl_memdesc *memdesc = &entry->memdesc;
+	bool flush;
+
+	if (!lazy_unmap || iommu_pt == NULL || !iommu_pt->lazy)
+		return false;
+
+	if (memdesc->size == 0 || memdesc->gpuaddr == 0 ||
+		!(memdesc->priv & KGSL_MEMDESC_MAPPED) ||
+		kgsl_memdesc_is_global(memdesc) ||
+		kgsl_memdesc_is_secured(memdesc) ||
+		kgsl_memdesc_use_cpu_map(memdesc) ||
+		(memdesc->flags & (KGSL_MEMFLAGS_SPARSE_VIRT |
+				KGSL_MEMFLAGS_SPARSE_PHYS)))
+		return false;
+
+	spin_lock(&iommu_pt->lazy_lock);
+	list_add_tail(&entry->lazy_node, &iommu_pt->lazy_list);
+	iommu_pt->lazy_count++;
+	iommu_pt->lazy_bytes += kgsl_memdesc_footprint(memdesc);
+	flush = iommu_pt->lazy_count >= KGSL_IOMMU_LAZY_MAX_ENTRIES ||
+		iommu_pt->lazy_bytes >= KGSL_IOMMU_LAZY_MAX_BYTES;
+	spin_unlock(&iommu_pt->lazy_lock);
+
+	if (flush)
+		mod_delayed_work(kgsl_driver.mem_workqueue,
+			&iommu_pt->lazy_work, 0);
+	else
+		queue_delayed_work(kgsl_driver.mem_workqueue,
+			&iommu_pt->lazy_work, KGSL_IOMMU_LAZY_DELAY);
+
+	return true;
+}
+
 static int kgsl_iommu_svm_range(struct kgsl_pagetable *pagetable,
 		uint64_t *lo, uint64_t *hi, uint64_t memflags)
 {
@@ -2811,4 +3244,5 @@ static struct kgsl_mmu_pt_ops iommu_pt_ops = {
 	.mmu_map_offset = kgsl_iommu_map_offset,
 	.mmu_unmap_offset = kgsl_iommu_unmap_offset,
 	.mmu_sparse_dummy_map = kgsl_iommu_sparse_dummy_map,
+	.mmu_defer_put_gpuaddr = kgsl_iommu_defer_put_gpuaddr,
 };
@@ -17,6 +17,7 @@
 #include <linux/qcom_iommu.h>
 #endif
 #include <linux/of.h>
+#include <linux/workqueue.h>
 #include "kgsl.h"
 
 /*
@@ -146,6 +147,10 @@ struct kgsl_iommu {
 	u32 pagefault_suppression_count;
 };
 
+/* Sizes of 1 to 32 pages get a free range cache of 8 entries each */
+#define KGSL_IOMMU_IOVA_CACHE_CLASSES 32
+#define KGSL_IOMMU_IOVA_CACHE_DEPTH 8
+
 /*
  * struct kgsl_iommu_pt - Iommu pagetable structure private to kgsl driver
  * @domain: Pointer to the iommu domain that contains the iommu pagetable
@@ -160,6 +165,14 @@ struct kgsl_iommu {
  * @svm_end: End of the shared virtual memory range.
  * @svm_start: 32 bit compatible range, for old clients who lack bits
  * @svm_end: end of 32 bit compatible range
+ * @lazy: Freed buffers may be queued for a batched unmap
+ * @lazy_lock: Protects the lazy unmap list and counters
+ * @lazy_list: Freed entries waiting to be unmapped
+ * @lazy_count: Number of entries on @lazy_list
+ * @lazy_bytes: GPU address space covered by @lazy_list
+ * @lazy_work: Unmaps and frees everything on @lazy_list
+ * @iova_cache: Freed GPU address ranges kept for reuse, one stack per size
+ * in pages. The ranges stay in @rbtree so nothing else can claim them.
  */
 struct kgsl_iommu_pt {
 	struct iommu_domain *domain;
@@ -175,6 +188,18 @@ struct kgsl_iommu_pt {
 	uint64_t svm_end;
 	uint64_t compat_va_start;
 	uint64_t compat_va_end;
+
+	bool lazy;
+	spinlock_t lazy_lock;
+	struct list_head lazy_list;
+	unsigned int lazy_count;
+	uint64_t lazy_bytes;
+	struct delayed_work lazy_work;
+
+	struct {
+		uint64_t addr[KGSL_IOMMU_IOVA_CACHE_DEPTH];
+		unsigned int count;
+	} iova_cache[KGSL_IOMMU_IOVA_CACHE_CLASSES];
 };
 
 /*
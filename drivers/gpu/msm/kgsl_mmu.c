@@ -465,6 +465,28 @@ void kgsl_mmu_put_gpuaddr(struct kgsl_memdesc *memdesc)
 }
 EXPORT_SYMBOL(kgsl_mmu_put_gpuaddr);
 
+/**
+ * kgsl_mmu_defer_put_gpuaddr() - Hand a freed entry to the MMU for a batched
+ * unmap
+ * @entry: Detached entry whose memory is about to be freed
+ *
+ * Return true if the MMU took the entry. It then unmaps the range, releases
+ * the GPU address and frees the entry with kgsl_mem_entry_free() later, so
+ * the address cannot be reused and the pages stay allocated until the GPU
+ * can no longer reach them.
+ */
+bool kgsl_mmu_defer_put_gpuaddr(struct kgsl_mem_entry *entry)
+{
+	struct kgsl_pagetable *pagetable = entry->memdesc.pagetable;
+
+	if (pagetable && PT_OP_VALID(pagetable, mmu_defer_put_gpuaddr))
+		return pagetable->pt_ops->mmu_defer_put_gpuaddr(pagetable,
+				entry);
+
+	return false;
+}
+EXPORT_SYMBOL(kgsl_mmu_defer_put_gpuaddr);
+
 /**
  * kgsl_mmu_svm_range() - Return the range for SVM (if applicable)
  * @pagetable: Pagetable to query the range from
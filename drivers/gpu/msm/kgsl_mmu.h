@@ -30,12 +30,21 @@
 	(kgsl_mmu_pagetable_get_contextidr((_d)->mmu.defaultpagetable))
 
 struct kgsl_device;
+struct kgsl_mem_entry;
 
 enum kgsl_mmutype {
 	KGSL_MMU_TYPE_IOMMU = 0,
 	KGSL_MMU_TYPE_NONE
 };
 
+/* Buckets for the amount of memory mapped with each IOMMU page size */
+enum kgsl_mmu_pgsize {
+	KGSL_MMU_PGSIZE_4K = 0,
+	KGSL_MMU_PGSIZE_64K,
+	KGSL_MMU_PGSIZE_2M,
+	KGSL_MMU_PGSIZE_MAX,
+};
+
 struct kgsl_pagetable {
 	spinlock_t lock;
 	struct kref refcount;
@@ -48,6 +57,9 @@ struct kgsl_pagetable {
 		atomic_t entries;
 		atomic_long_t mapped;
 		atomic_long_t max_mapped;
+		atomic_long_t mapped_pgsize[KGSL_MMU_PGSIZE_MAX];
+		atomic_long_t iova_cache_hits;
+		atomic_long_t iova_cache_misses;
 	} stats;
 	const struct kgsl_mmu_pt_ops *pt_ops;
 	uint64_t fault_addr;
@@ -114,6 +126,8 @@ struct kgsl_mmu_pt_ops {
 	int (*mmu_sparse_dummy_map)(struct kgsl_pagetable *pt,
 			struct kgsl_memdesc *memdesc, uint64_t offset,
 			uint64_t size);
+	bool (*mmu_defer_put_gpuaddr)(struct kgsl_pagetable *pt,
+			struct kgsl_mem_entry *entry);
 };
 
 /*
@@ -182,6 +196,9 @@ int kgsl_iommu_map_global_secure_pt_entry(struct kgsl_device *device,
 void kgsl_iommu_unmap_global_secure_pt_entry(struct kgsl_device *device,
 					struct kgsl_memdesc *memdesc);
 void kgsl_print_global_pt_entries(struct seq_file *s);
+void kgsl_iommu_set_lazy_unmap(bool val);
+bool kgsl_iommu_get_lazy_unmap(void);
+void kgsl_print_lazy_unmap_stats(struct seq_file *s);
 void kgsl_mmu_putpagetable(struct kgsl_pagetable *pagetable);
 
 int kgsl_mmu_get_gpuaddr(struct kgsl_pagetable *pagetable,
@@ -191,6 +208,7 @@ int kgsl_mmu_map(struct kgsl_pagetable *pagetable,
 int kgsl_mmu_unmap(struct kgsl_pagetable *pagetable,
 		    struct kgsl_memdesc *memdesc);
 void kgsl_mmu_put_gpuaddr(struct kgsl_memdesc *memdesc);
+bool kgsl_mmu_defer_put_gpuaddr(struct kgsl_mem_entry *entry);
 unsigned int kgsl_virtaddr_to_physaddr(void *virtaddr);
 unsigned int kgsl_mmu_log_fault_addr(struct kgsl_mmu *mmu,
 		u64 ttbr0, uint64_t addr);
@@ -17,15 +17,51 @@
 #include <linux/slab.h>
 #include <linux/highmem.h>
 #include <linux/version.h>
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <soc/qcom/mem_pool.h>
 
 #include "kgsl.h"
 #include "kgsl_device.h"
 #include "kgsl_pool.h"
+#include "kgsl_debugfs.h"
 
 #define KGSL_MAX_POOLS 4
 #define KGSL_MAX_POOL_ORDER 8
 #define KGSL_MAX_RESERVED_PAGES 4096
 
+/*
+ * Upper bound on the number of 4K pages a single per-CPU magazine may
+ * cache and on the number of entries it can hold
+ */
+#define KGSL_MAGAZINE_MAX_PAGES 64
+#define KGSL_MAGAZINE_SIZE 16
+
+/**
+ * struct kgsl_pool_magazine - Per-CPU page cache in front of a pool
+ * @lock: Spinlock protecting the magazine. It is only ever taken by the
+ * owning CPU, except when the shrinker drains the magazines
+ * @count: Number of entries currently in @pages
+ * @pages: Stack of zeroed pages of the pool order
+ * @hits: Allocations served directly from the magazine
+ * @refills: Allocations that refilled the magazine from the shared pool
+ * @misses: Allocations that found neither magazine nor pool pages
+ * @drains: Frees that flushed a batch back into the shared pool
+ */
+struct kgsl_pool_magazine {
+	spinlock_t lock;
+	unsigned int count;
+	struct page *pages[KGSL_MAGAZINE_SIZE];
+	unsigned long hits;
+	unsigned long refills;
+	unsigned long misses;
+	unsigned long drains;
+};
+
 /**
  * struct kgsl_page_pool - Structure to hold information for the pool
  * @pool_order: Page order describing the size of the page
@@ -35,6 +71,13 @@
  * from system memory
  * @list_lock: Spinlock for page list in the pool
  * @page_list: List of pages held/reserved in this pool
+ * @mag_limit: Number of entries each per-CPU magazine may hold
+ * @mag_batch: Number of entries moved between magazine and pool at once
+ * @mags: Per-CPU magazines for this pool, NULL if they are disabled
+ * @watermark: Number of pages of the pool order the refill thread keeps in
+ * the pool, 0 disables the background refill
+ * @watermark_miss: Allocations that found the pool empty although a
+ * watermark is configured
  */
 struct kgsl_page_pool {
 	unsigned int pool_order;
@@ -43,11 +86,42 @@ struct kgsl_page_pool {
 	bool allocation_allowed;
 	spinlock_t list_lock;
 	struct list_head page_list;
+	unsigned int mag_limit;
+	unsigned int mag_batch;
+	struct kgsl_pool_magazine __percpu *mags;
+	u32 watermark;
+	atomic_t watermark_miss;
+};
+
+/**
+ * struct kgsl_pool_refill - State of the background pool refill thread
+ * @task: The refill kthread
+ * @wq: Wait queue the thread sleeps on until a pool drops below watermark
+ * @pending: Set when a refill has been requested
+ * @backoff: Refills are suppressed until this time after the shrinker ran
+ * @last_us: Duration of the last refill pass
+ * @max_us: Longest refill pass seen so far
+ */
+struct kgsl_pool_refill {
+	struct task_struct *task;
+	wait_queue_head_t wq;
+	atomic_t pending;
+	unsigned long backoff;
+	u64 last_us;
+	u64 max_us;
 };
 
 static struct kgsl_page_pool kgsl_pools[KGSL_MAX_POOLS];
 static int kgsl_num_pools;
 static int kgsl_pool_max_pages;
+static struct kgsl_pool_refill kgsl_pool_refill;
+
+/*
+ * When the shared page pool is available the pools keep their pages there
+ * instead of in their own page lists, so that memory freed by the GPU can
+ * be reused by other subsystems and the other way round.
+ */
+static struct mem_pool_client *kgsl_mem_pool_client;
 
 
 /* Returns KGSL pool corresponding to input page order*/
@@ -95,6 +169,11 @@ _kgsl_pool_add_page(struct kgsl_page_pool *pool, struct page *p)
 
 	_kgsl_pool_zero_page(p, pool->pool_order);
 
+	if (kgsl_mem_pool_client) {
+		mem_pool_free(kgsl_mem_pool_client, p, pool->pool_order);
+		return;
+	}
+
 	spin_lock(&pool->list_lock);
 	list_add_tail(&p->lru, &pool->page_list);
 	pool->page_count++;
@@ -107,6 +186,9 @@ _kgsl_pool_get_page(struct kgsl_page_pool *pool)
 {
 	struct page *p = NULL;
 
+	if (kgsl_mem_pool_client)
+		return mem_pool_alloc(kgsl_mem_pool_client, pool->pool_order);
+
 	spin_lock(&pool->list_lock);
 	if (pool->page_count) {
 		p = list_first_entry(&pool->page_list, struct page, lru);
@@ -118,15 +200,182 @@ _kgsl_pool_get_page(struct kgsl_page_pool *pool)
 	return p;
 }
 
+/*
+ * Move up to pool->mag_batch pages from the shared pool into the magazine.
+ * The caller must hold the magazine lock.
+ */
+static void
+_kgsl_pool_mag_refill(struct kgsl_page_pool *pool,
+		struct kgsl_pool_magazine *mag)
+{
+	struct page *p, *tmp;
+
+	if (kgsl_mem_pool_client) {
+		LIST_HEAD(batch);
+
+		mem_pool_get_list(kgsl_mem_pool_client, pool->pool_order,
+			&batch, pool->mag_batch - mag->count);
+		list_for_each_entry_safe(p, tmp, &batch, lru) {
+			list_del(&p->lru);
+			mag->pages[mag->count++] = p;
+		}
+		return;
+	}
+
+	spin_lock(&pool->list_lock);
+	while (pool->page_count && mag->count < pool->mag_batch) {
+		p = list_first_entry(&pool->page_list, struct page, lru);
+		list_del(&p->lru);
+		pool->page_count--;
+		mag->pages[mag->count++] = p;
+	}
+	spin_unlock(&pool->list_lock);
+}
+
+/*
+ * Move up to @nr entries from the top of the magazine back into the shared
+ * pool with a single acquisition of the pool lock. The caller must hold the
+ * magazine lock.
+ */
+static void
+_kgsl_pool_mag_flush(struct kgsl_page_pool *pool,
+		struct kgsl_pool_magazine *mag, unsigned int nr)
+{
+	LIST_HEAD(batch);
+	unsigned int moved = 0;
+
+	while (mag->count && moved < nr) {
+		list_add_tail(&mag->pages[--mag->count]->lru, &batch);
+		moved++;
+	}
+
+	if (!moved)
+		return;
+
+	if (kgsl_mem_pool_client) {
+		mem_pool_put_list(kgsl_mem_pool_client, pool->pool_order,
+			&batch, moved);
+		return;
+	}
+
+	spin_lock(&pool->list_lock);
+	list_splice_tail(&batch, &pool->page_list);
+	pool->page_count += moved;
+	spin_unlock(&pool->list_lock);
+}
+
+/* Returns a page from the local magazine, refilling it if needed */
+static struct page *
+_kgsl_pool_mag_get(struct kgsl_page_pool *pool)
+{
+	struct kgsl_pool_magazine *mag;
+	struct page *p = NULL;
+
+	if (pool->mags == NULL)
+		return _kgsl_pool_get_page(pool);
+
+	mag = get_cpu_ptr(pool->mags);
+	spin_lock(&mag->lock);
+
+	if (mag->count) {
+		mag->hits++;
+	} else {
+		_kgsl_pool_mag_refill(pool, mag);
+		if (mag->count)
+			mag->refills++;
+		else
+			mag->misses++;
+	}
+
+	if (mag->count)
+		p = mag->pages[--mag->count];
+
+	spin_unlock(&mag->lock);
+	put_cpu_ptr(pool->mags);
+
+	return p;
+}
+
+/* Puts an already zeroed page into the local magazine */
+static void
+_kgsl_pool_mag_put(struct kgsl_page_pool *pool, struct page *p)
+{
+	struct kgsl_pool_magazine *mag;
+
+	mag = get_cpu_ptr(pool->mags);
+	spin_lock(&mag->lock);
+
+	if (mag->count >= pool->mag_limit) {
+		_kgsl_pool_mag_flush(pool, mag, pool->mag_batch);
+		mag->drains++;
+	}
+
+	mag->pages[mag->count++] = p;
+
+	spin_unlock(&mag->lock);
+	put_cpu_ptr(pool->mags);
+}
+
+/* Return all magazine pages of the specified pool to the shared pool */
+static void
+_kgsl_pool_mag_drain(struct kgsl_page_pool *pool)
+{
+	int cpu;
+
+	if (pool->mags == NULL)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct kgsl_pool_magazine *mag = per_cpu_ptr(pool->mags, cpu);
+
+		spin_lock(&mag->lock);
+		_kgsl_pool_mag_flush(pool, mag, mag->count);
+		spin_unlock(&mag->lock);
+	}
+}
+
+/* Returns the number of magazine entries held for the specified pool */
+static int
+_kgsl_pool_mag_count(struct kgsl_page_pool *pool)
+{
+	int cpu, count = 0;
+
+	if (pool->mags == NULL)
+		return 0;
+
+	/* This is only a hint, so don't bother locking the magazines */
+	for_each_possible_cpu(cpu)
+		count += READ_ONCE(per_cpu_ptr(pool->mags, cpu)->count);
+
+	return count;
+}
+
+/* Returns the number of entries in the shared list of specified pool */
+static int
+_kgsl_pool_entries(struct kgsl_page_pool *pool)
+{
+	if (kgsl_mem_pool_client)
+		return mem_pool_count(pool->pool_order);
+
+	return READ_ONCE(pool->page_count);
+}
+
 /* Returns the number of pages in specified pool */
 static int
 kgsl_pool_size(struct kgsl_page_pool *kgsl_pool)
 {
 	int size;
 
-	spin_lock(&kgsl_pool->list_lock);
-	size = kgsl_pool->page_count * (1 << kgsl_pool->pool_order);
-	spin_unlock(&kgsl_pool->list_lock);
+	if (kgsl_mem_pool_client) {
+		size = mem_pool_count(kgsl_pool->pool_order) <<
+			kgsl_pool->pool_order;
+	} else {
+		spin_lock(&kgsl_pool->list_lock);
+		size = kgsl_pool->page_count * (1 << kgsl_pool->pool_order);
+		spin_unlock(&kgsl_pool->list_lock);
+	}
+
+	size += _kgsl_pool_mag_count(kgsl_pool) * (1 << kgsl_pool->pool_order);
 
 	return size;
 }
@@ -142,6 +391,91 @@ static int kgsl_pool_size_total(void)
 	return total;
 }
 
+/* Lockless hint whether the pool needs to be topped up */
+static bool _kgsl_pool_below_watermark(struct kgsl_page_pool *pool)
+{
+	u32 watermark = READ_ONCE(pool->watermark);
+
+	return watermark && _kgsl_pool_entries(pool) < watermark;
+}
+
+static void _kgsl_pool_kick_refill(struct kgsl_page_pool *pool)
+{
+	if (kgsl_pool_refill.task && _kgsl_pool_below_watermark(pool) &&
+			!atomic_xchg(&kgsl_pool_refill.pending, 1))
+		wake_up(&kgsl_pool_refill.wq);
+}
+
+static bool _kgsl_pool_refill_abort(void)
+{
+	if (kthread_should_stop())
+		return true;
+
+	if (time_before(jiffies, READ_ONCE(kgsl_pool_refill.backoff)))
+		return true;
+
+	return kgsl_pool_max_pages &&
+		kgsl_pool_size_total() >= kgsl_pool_max_pages;
+}
+
+/*
+ * Top up every pool to its watermark with zeroed pages. The allocations
+ * never enter direct reclaim and the pass stops as soon as the shrinker
+ * reports memory pressure.
+ */
+static void _kgsl_pool_refill_pools(void)
+{
+	ktime_t start = ktime_get();
+	bool added = false;
+	u64 elapsed;
+	int i;
+
+	for (i = 0; i < kgsl_num_pools; i++) {
+		struct kgsl_page_pool *pool = &kgsl_pools[i];
+		gfp_t gfp_mask = (kgsl_gfp_mask(pool->pool_order) |
+				__GFP_NORETRY | __GFP_NOWARN) &
+				~__GFP_DIRECT_RECLAIM;
+
+		while (_kgsl_pool_below_watermark(pool)) {
+			struct page *page;
+
+			if (_kgsl_pool_refill_abort())
+				goto out;
+
+			page = alloc_pages(gfp_mask, pool->pool_order);
+			if (page == NULL)
+				break;
+
+			_kgsl_pool_add_page(pool, page);
+			added = true;
+		}
+	}
+
+out:
+	if (added) {
+		elapsed = ktime_us_delta(ktime_get(), start);
+		kgsl_pool_refill.last_us = elapsed;
+		if (elapsed > kgsl_pool_refill.max_us)
+			kgsl_pool_refill.max_us = elapsed;
+	}
+}
+
+static int kgsl_pool_refill_thread(void *data)
+{
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(kgsl_pool_refill.wq,
+			atomic_read(&kgsl_pool_refill.pending) ||
+			kthread_should_stop());
+
+		atomic_set(&kgsl_pool_refill.pending, 0);
+		_kgsl_pool_refill_pools();
+	}
+
+	return 0;
+}
+
 /*
  * This will shrink the specified pool by num_pages or its pool_size,
  * whichever is smaller.
@@ -210,6 +544,9 @@ kgsl_pool_reduce(unsigned int target_pages, bool exit)
 		/* Round up to integral number of pages in this pool */
 		nr_removed = ALIGN(nr_removed, 1 << pool->pool_order);
 
+		/* Pages cached per-CPU are only freed from the shared pool */
+		_kgsl_pool_mag_drain(pool);
+
 		/* Remove nr_removed pages from this pool*/
 		pcount += _kgsl_pool_shrink(pool, nr_removed);
 	}
@@ -345,6 +682,19 @@ int kgsl_pool_alloc_page(int *page_size, struct page **pages,
 
 	pool = _kgsl_get_pool_from_order(order);
 	if (pool == NULL) {
+		/*
+		 * Orders above the largest pool are only requested in large
+		 * page mode. Try them directly without reclaim, and fall back
+		 * to the pools on failure.
+		 */
+		if (order > KGSL_MAX_POOL_ORDER) {
+			page = alloc_pages(kgsl_gfp_mask(order), order);
+			if (page != NULL) {
+				_kgsl_pool_zero_page(page, order);
+				goto done;
+			}
+		}
+
 		/* Retry with lower order pages */
 		if (order > 0) {
 			size = PAGE_SIZE << kgsl_pool_get_retry_order(order);
@@ -365,12 +715,16 @@ int kgsl_pool_alloc_page(int *page_size, struct page **pages,
 	}
 
 	pool_idx = kgsl_pool_idx_lookup(order);
-	page = _kgsl_pool_get_page(pool);
+	page = _kgsl_pool_mag_get(pool);
+	_kgsl_pool_kick_refill(pool);
 
 	/* Allocate a new page if not allocated from pool */
 	if (page == NULL) {
 		gfp_t gfp_mask = kgsl_gfp_mask(order);
 
+		if (pool->watermark)
+			atomic_inc(&pool->watermark_miss);
+
 		/* Only allocate non-reserved memory for certain pools */
 		if (!pool->allocation_allowed && pool_idx > 0) {
 			size = PAGE_SIZE <<
@@ -422,6 +776,13 @@ void kgsl_pool_free_page(struct page *page)
 	if (!kgsl_pool_max_pages ||
 			(kgsl_pool_size_total() < kgsl_pool_max_pages)) {
 		pool = _kgsl_get_pool_from_order(page_order);
+		if (pool != NULL && pool->mags != NULL &&
+				!WARN_ON_ONCE(page_count(page) > 1)) {
+			_kgsl_pool_zero_page(page, page_order);
+			_kgsl_pool_mag_put(pool, page);
+			return;
+		}
+
 		if (pool != NULL) {
 			_kgsl_pool_add_page(pool, page);
 			return;
@@ -457,6 +818,15 @@ static void kgsl_pool_reserve_pages(void)
 	for (i = 0; i < kgsl_num_pools; i++) {
 		struct page *page;
 
+		if (kgsl_mem_pool_client) {
+			int order = kgsl_pools[i].pool_order;
+
+			mem_pool_reserve(kgsl_mem_pool_client, order,
+				kgsl_pools[i].reserved_pages,
+				kgsl_gfp_mask(order));
+			continue;
+		}
+
 		for (j = 0; j < kgsl_pools[i].reserved_pages; j++) {
 			int order = kgsl_pools[i].pool_order;
 			gfp_t gfp_mask = kgsl_gfp_mask(order);
@@ -481,6 +851,9 @@ kgsl_pool_shrink_scan_objects(struct shrinker *shrinker,
 	/* Target pages represents new  pool size */
 	int target_pages = (nr > total_pages) ? 0 : (total_pages - nr);
 
+	/* Don't let the refill thread undo the shrinking right away */
+	WRITE_ONCE(kgsl_pool_refill.backoff, jiffies + HZ);
+
 	/* Reduce pool size to target_pages */
 	return kgsl_pool_reduce(target_pages, false);
 }
@@ -501,8 +874,66 @@ static struct shrinker kgsl_pool_shrinker = {
 	.batch = 0,
 };
 
+/*
+ * Size the per-CPU magazines so that each CPU caches a bounded amount of
+ * memory regardless of the pool order. If the per-CPU memory cannot be
+ * allocated the pool silently works without magazines.
+ */
+static void kgsl_pool_config_magazines(struct kgsl_page_pool *pool)
+{
+	int cpu;
+
+	pool->mag_limit = clamp_t(unsigned int,
+			KGSL_MAGAZINE_MAX_PAGES >> pool->pool_order,
+			1, KGSL_MAGAZINE_SIZE);
+	pool->mag_batch = max_t(unsigned int, pool->mag_limit >> 1, 1);
+
+	pool->mags = alloc_percpu(struct kgsl_pool_magazine);
+	if (pool->mags == NULL)
+		return;
+
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(pool->mags, cpu)->lock);
+}
+
+/**
+ * kgsl_pool_print_stats() - Print the pool sizes and magazine counters
+ * @s: seq_file to print into
+ */
+void kgsl_pool_print_stats(struct seq_file *s)
+{
+	int i, cpu;
+
+	seq_printf(s, "refill: last %llu us max %llu us\n",
+		kgsl_pool_refill.last_us, kgsl_pool_refill.max_us);
+
+	for (i = 0; i < kgsl_num_pools; i++) {
+		struct kgsl_page_pool *pool = &kgsl_pools[i];
+
+		seq_printf(s, "pool order %u: %d pages (%d in magazines)\n",
+			pool->pool_order, kgsl_pool_size(pool),
+			_kgsl_pool_mag_count(pool) << pool->pool_order);
+		seq_printf(s, "  watermark %u watermark misses %d\n",
+			READ_ONCE(pool->watermark),
+			atomic_read(&pool->watermark_miss));
+
+		if (pool->mags == NULL)
+			continue;
+
+		for_each_possible_cpu(cpu) {
+			struct kgsl_pool_magazine *mag =
+				per_cpu_ptr(pool->mags, cpu);
+
+			seq_printf(s,
+				"  cpu%d: count %u hits %lu refills %lu misses %lu drains %lu\n",
+				cpu, READ_ONCE(mag->count), mag->hits,
+				mag->refills, mag->misses, mag->drains);
+		}
+	}
+}
+
 static void kgsl_pool_config(unsigned int order, unsigned int reserved_pages,
-		bool allocation_allowed)
+		bool allocation_allowed, u32 watermark)
 {
 #ifdef CONFIG_ALLOC_BUFFERS_IN_4K_CHUNKS
 	if (order > 0) {
@@ -517,8 +948,11 @@ static void kgsl_pool_config(unsigned int order, unsigned int reserved_pages,
 	kgsl_pools[kgsl_num_pools].pool_order = order;
 	kgsl_pools[kgsl_num_pools].reserved_pages = reserved_pages;
 	kgsl_pools[kgsl_num_pools].allocation_allowed = allocation_allowed;
+	kgsl_pools[kgsl_num_pools].watermark = watermark;
+	atomic_set(&kgsl_pools[kgsl_num_pools].watermark_miss, 0);
 	spin_lock_init(&kgsl_pools[kgsl_num_pools].list_lock);
 	INIT_LIST_HEAD(&kgsl_pools[kgsl_num_pools].page_list);
+	kgsl_pool_config_magazines(&kgsl_pools[kgsl_num_pools]);
 	kgsl_num_pools++;
 }
 
@@ -526,6 +960,7 @@ static void kgsl_of_parse_mempools(struct device_node *node)
 {
 	struct device_node *child;
 	unsigned int page_size, reserved_pages = 0;
+	u32 watermark;
 	bool allocation_allowed;
 
 	for_each_child_of_node(node, child) {
@@ -547,8 +982,12 @@ static void kgsl_of_parse_mempools(struct device_node *node)
 		allocation_allowed = of_property_read_bool(child,
 				"qcom,mempool-allocate");
 
+		watermark = 0;
+		of_property_read_u32(child, "qcom,mempool-watermark",
+				&watermark);
+
 		kgsl_pool_config(ilog2(page_size >> PAGE_SHIFT), reserved_pages,
-				allocation_allowed);
+				allocation_allowed, watermark);
 	}
 }
 
@@ -565,25 +1004,90 @@ static void kgsl_of_get_mempools(struct device_node *parent)
 	}
 }
 
+static void kgsl_pool_init_refill(void)
+{
+	struct sched_param param = { .sched_priority = 0 };
+	struct dentry *parent = kgsl_get_debugfs_dir();
+	struct dentry *dir = NULL;
+	int i;
+
+	init_waitqueue_head(&kgsl_pool_refill.wq);
+	atomic_set(&kgsl_pool_refill.pending, 0);
+	kgsl_pool_refill.backoff = jiffies;
+
+	if (!IS_ERR_OR_NULL(parent))
+		dir = debugfs_create_dir("pool_watermarks", parent);
+
+	for (i = 0; i < kgsl_num_pools && !IS_ERR_OR_NULL(dir); i++) {
+		char name[16];
+
+		snprintf(name, sizeof(name), "order%u",
+			kgsl_pools[i].pool_order);
+		debugfs_create_u32(name, 0644, dir, &kgsl_pools[i].watermark);
+	}
+
+	kgsl_pool_refill.task = kthread_run(kgsl_pool_refill_thread, NULL,
+		"kgsl_pool_refill");
+	if (IS_ERR(kgsl_pool_refill.task)) {
+		pr_err("kgsl: unable to start the pool refill thread\n");
+		kgsl_pool_refill.task = NULL;
+		return;
+	}
+
+	sched_setscheduler(kgsl_pool_refill.task, SCHED_IDLE, &param);
+
+	/* Fill up the pools that have a watermark from the start */
+	for (i = 0; i < kgsl_num_pools; i++)
+		_kgsl_pool_kick_refill(&kgsl_pools[i]);
+}
+
 void kgsl_init_page_pools(struct platform_device *pdev)
 {
 
 	/* Get GPU mempools data and configure pools */
 	kgsl_of_get_mempools(pdev->dev.of_node);
 
+	if (kgsl_num_pools)
+		kgsl_mem_pool_client = mem_pool_client_register("kgsl");
+
 	/* Reserve the appropriate number of pages for each pool */
 	kgsl_pool_reserve_pages();
 
-	/* Initialize shrinker */
-	register_shrinker(&kgsl_pool_shrinker);
+	/* Initialize shrinker, the shared page pool reclaims on its own */
+	if (kgsl_mem_pool_client == NULL)
+		register_shrinker(&kgsl_pool_shrinker);
+
+	/* Start topping up the pools in the background */
+	kgsl_pool_init_refill();
 }
 
 void kgsl_exit_page_pools(void)
 {
-	/* Release all pages in pools, if any.*/
-	kgsl_pool_reduce(0, true);
+	int i;
+
+	if (kgsl_pool_refill.task) {
+		kthread_stop(kgsl_pool_refill.task);
+		kgsl_pool_refill.task = NULL;
+	}
 
-	/* Unregister shrinker */
-	unregister_shrinker(&kgsl_pool_shrinker);
+	if (kgsl_mem_pool_client) {
+		/* Leave the pages to the shared pool and drop reservations */
+		for (i = 0; i < kgsl_num_pools; i++)
+			_kgsl_pool_mag_drain(&kgsl_pools[i]);
+
+		mem_pool_client_unregister(kgsl_mem_pool_client);
+		kgsl_mem_pool_client = NULL;
+	} else {
+		/* Release all pages in pools, if any.*/
+		kgsl_pool_reduce(0, true);
+
+		/* Unregister shrinker */
+		unregister_shrinker(&kgsl_pool_shrinker);
+	}
+
+	for (i = 0; i < kgsl_num_pools; i++) {
+		free_percpu(kgsl_pools[i].mags);
+		kgsl_pools[i].mags = NULL;
+	}
 }
 
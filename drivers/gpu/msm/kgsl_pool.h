@@ -14,6 +14,7 @@
 #define __KGSL_POOL_H
 
 #include <linux/mm_types.h>
+#include <linux/seq_file.h>
 #include "kgsl_sharedmem.h"
 
 static inline unsigned int
@@ -41,5 +42,6 @@ int kgsl_pool_alloc_page(int *page_size, struct page **pages,
 			unsigned int pages_len, unsigned int *align);
 void kgsl_pool_free_page(struct page *p);
 bool kgsl_pool_avaialable(int size);
+void kgsl_pool_print_stats(struct seq_file *s);
 #endif /* __KGSL_POOL_H */
 
@@ -324,6 +324,7 @@ void kgsl_pwrctrl_buslevel_update(struct kgsl_device *device,
 	kgsl_bus_scale_request(device, buslevel);
 
 	kgsl_pwrctrl_vbif_update(ab);
+	devfreq_mem_vote_hint(DEVFREQ_MEM_VOTE_GPU, ab);
 }
 EXPORT_SYMBOL(kgsl_pwrctrl_buslevel_update);
 
@@ -1523,6 +1524,82 @@ static ssize_t kgsl_pwrctrl_pwrscale_show(struct device *dev,
 	return snprintf(buf, PAGE_SIZE, "%u\n", psc->enabled);
 }
 
+static ssize_t kgsl_pwrctrl_predict_store(struct device *dev,
+					   struct device_attribute *attr,
+					   const char *buf, size_t count)
+{
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+	struct kgsl_pwr_predict *pred;
+	unsigned int enable = 0;
+	int ret;
+
+	if (device == NULL)
+		return 0;
+
+	ret = kgsl_sysfs_store(buf, &enable);
+	if (ret)
+		return ret;
+
+	pred = &device->pwrctrl.predict;
+	mutex_lock(&device->mutex);
+	pred->enabled = enable;
+	pred->phase = KGSL_PREDICT_IDLE;
+	pred->interval = 0;
+	mutex_unlock(&device->mutex);
+
+	hrtimer_cancel(&pred->timer);
+
+	return count;
+}
+
+static ssize_t kgsl_pwrctrl_predict_show(struct device *dev,
+					 struct device_attribute *attr,
+					 char *buf)
+{
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+
+	if (device == NULL)
+		return 0;
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			device->pwrctrl.predict.enabled);
+}
+
+/*
+ * One line per power level: NAP wakes and their average latency, SLUMBER
+ * wakes and their average latency, predictor hits and mispredicts.
+ */
+static ssize_t kgsl_pwrctrl_wake_stats_show(struct device *dev,
+					    struct device_attribute *attr,
+					    char *buf)
+{
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+	struct kgsl_pwr_predict *pred;
+	int i, j, num_chars = 0;
+
+	if (device == NULL)
+		return 0;
+
+	pred = &device->pwrctrl.predict;
+	mutex_lock(&device->mutex);
+	for (i = 0; i < device->pwrctrl.num_pwrlevels; i++) {
+		num_chars += scnprintf(buf + num_chars, PAGE_SIZE - num_chars,
+				"%d:", i);
+		for (j = 0; j < KGSL_PREDICT_MAX; j++)
+			num_chars += scnprintf(buf + num_chars,
+				PAGE_SIZE - num_chars, " %u %llu",
+				pred->wake_cnt[i][j], pred->wake_cnt[i][j] ?
+				div_u64(pred->wake_us[i][j],
+					pred->wake_cnt[i][j]) : 0);
+		num_chars += scnprintf(buf + num_chars, PAGE_SIZE - num_chars,
+				" %u %u\n", pred->hits[i],
+				pred->mispredicts[i]);
+	}
+	mutex_unlock(&device->mutex);
+
+	return num_chars;
+}
+
 static DEVICE_ATTR(temp, 0444, kgsl_pwrctrl_temp_show, NULL);
 static DEVICE_ATTR(gpuclk, 0644, kgsl_pwrctrl_gpuclk_show,
 	kgsl_pwrctrl_gpuclk_store);
@@ -1588,6 +1665,10 @@ static DEVICE_ATTR(freq_table_mhz, 0444,
 static DEVICE_ATTR(pwrscale, 0644,
 	kgsl_pwrctrl_pwrscale_show,
 	kgsl_pwrctrl_pwrscale_store);
+static DEVICE_ATTR(predict, 0644,
+	kgsl_pwrctrl_predict_show,
+	kgsl_pwrctrl_predict_store);
+static DEVICE_ATTR(wake_stats, 0444, kgsl_pwrctrl_wake_stats_show, NULL);
 
 static const struct device_attribute *pwrctrl_attr_list[] = {
 	&dev_attr_gpuclk,
@@ -1617,6 +1698,8 @@ static const struct device_attribute *pwrctrl_attr_list[] = {
 	&dev_attr_freq_table_mhz,
 	&dev_attr_temp,
 	&dev_attr_pwrscale,
+	&dev_attr_predict,
+	&dev_attr_wake_stats,
 	NULL
 };
 
@@ -2403,6 +2486,11 @@ int kgsl_pwrctrl_init(struct kgsl_device *device)
 	setup_timer(&pwr->thermal_timer, kgsl_thermal_timer,
 			(unsigned long) device);
 
+	pwr->predict.enabled = true;
+	INIT_WORK(&pwr->predict.work, kgsl_pwrctrl_predict_work);
+	hrtimer_init(&pwr->predict.timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	pwr->predict.timer.function = kgsl_pwrctrl_predict_timer;
+
 	INIT_LIST_HEAD(&pwr->limits);
 	spin_lock_init(&pwr->limits_lock);
 	pwr->sysfs_pwr_limit = kgsl_pwr_limits_add(KGSL_DEVICE_3D0);
@@ -2435,6 +2523,9 @@ void kgsl_pwrctrl_close(struct kgsl_device *device)
 
 	KGSL_PWR_INFO(device, "close device %d\n", device->id);
 
+	hrtimer_cancel(&pwr->predict.timer);
+	cancel_work_sync(&pwr->predict.work);
+
 	pwr->power_flags = 0;
 
 	if (!IS_ERR_OR_NULL(pwr->sysfs_pwr_limit)) {
@@ -3081,6 +3172,205 @@ const char *kgsl_pwrstate_to_str(unsigned int state)
 EXPORT_SYMBOL(kgsl_pwrstate_to_str);
 
 
+/* Time the GPU went busy again at a stable cadence before it is forgotten */
+#define KGSL_PREDICT_MAX_INTERVAL_NS	(500 * NSEC_PER_MSEC)
+/* Margin around the predicted submission for pre-waking and misses */
+#define KGSL_PREDICT_SLACK_NS		(500 * NSEC_PER_USEC)
+
+/* Average wake latency from @state at @level, or a guess until measured */
+static u64 _predict_wake_ns(struct kgsl_pwr_predict *pred, unsigned int level,
+		enum kgsl_predict_state state)
+{
+	static const u64 guess_ns[KGSL_PREDICT_MAX] = {
+		[KGSL_PREDICT_NAP] = 100 * NSEC_PER_USEC,
+		[KGSL_PREDICT_SLUMBER] = 3 * NSEC_PER_MSEC,
+	};
+
+	if (!pred->wake_cnt[level][state])
+		return guess_ns[state];
+
+	return div_u64(pred->wake_us[level][state],
+			pred->wake_cnt[level][state]) * NSEC_PER_USEC;
+}
+
+static void kgsl_pwrctrl_predict_wake_done(struct kgsl_device *device,
+		unsigned int state, u64 start)
+{
+	struct kgsl_pwrctrl *pwr = &device->pwrctrl;
+	struct kgsl_pwr_predict *pred = &pwr->predict;
+	enum kgsl_predict_state idx;
+
+	if (state == KGSL_STATE_NAP)
+		idx = KGSL_PREDICT_NAP;
+	else if (state == KGSL_STATE_SLUMBER)
+		idx = KGSL_PREDICT_SLUMBER;
+	else
+		return;
+
+	pred->wake_cnt[pwr->active_pwrlevel][idx]++;
+	pred->wake_us[pwr->active_pwrlevel][idx] +=
+		div_u64(ktime_get_ns() - start, NSEC_PER_USEC);
+}
+
+/**
+ * kgsl_pwrctrl_predict_submit() - Feed a submission to the cadence predictor
+ * @device: Pointer to a KGSL device
+ *
+ * Called by the dispatcher with the device mutex held whenever it starts
+ * submitting to an idle GPU. Scores the last prediction and folds the time
+ * since the previous submission into the running interval.
+ */
+void kgsl_pwrctrl_predict_submit(struct kgsl_device *device)
+{
+	struct kgsl_pwr_predict *pred = &device->pwrctrl.predict;
+	unsigned int level = device->pwrctrl.active_pwrlevel;
+	u64 now, sample, diff;
+
+	if (!pred->enabled)
+		return;
+
+	if (pred->phase == KGSL_PREDICT_AWAKE &&
+			device->state == KGSL_STATE_ACTIVE)
+		pred->hits[level]++;
+	else if (pred->phase != KGSL_PREDICT_IDLE)
+		pred->mispredicts[level]++;
+	pred->phase = KGSL_PREDICT_IDLE;
+	hrtimer_try_to_cancel(&pred->timer);
+
+	now = ktime_get_ns();
+	sample = now - pred->last_submit;
+	pred->last_submit = now;
+
+	if (sample > KGSL_PREDICT_MAX_INTERVAL_NS) {
+		pred->interval = 0;
+	} else if (!pred->interval) {
+		pred->interval = sample;
+		pred->deviation = sample >> 1;
+	} else {
+		diff = sample > pred->interval ? sample - pred->interval :
+			pred->interval - sample;
+		pred->deviation = (pred->deviation * 3 + diff) >> 2;
+		pred->interval = (pred->interval * 7 + sample) >> 3;
+	}
+}
+
+/*
+ * Pick the state for a GPU that just went idle. Stay ACTIVE when the next
+ * submission is due sooner than a NAP round trip would pay off, SLUMBER
+ * when it is due after the idle timer would have fired anyway, and NAP in
+ * between. For NAP and SLUMBER, arm the timer so that the GPU is woken just
+ * ahead of the predicted submission. Without a stable cadence this is the
+ * old behaviour: NAP, then SLUMBER on the idle timer.
+ */
+static unsigned int kgsl_pwrctrl_predict_idle(struct kgsl_device *device)
+{
+	struct kgsl_pwrctrl *pwr = &device->pwrctrl;
+	struct kgsl_pwr_predict *pred = &pwr->predict;
+	unsigned int level = pwr->active_pwrlevel;
+	enum kgsl_predict_state state = KGSL_PREDICT_NAP;
+	u64 now, next, gap, lead;
+
+	if (!pred->enabled || !pred->interval ||
+			pred->deviation * 4 > pred->interval)
+		return KGSL_STATE_NAP;
+
+	now = ktime_get_ns();
+	next = pred->last_submit + pred->interval;
+	if (next <= now)
+		return KGSL_STATE_NAP;
+	gap = next - now;
+
+	lead = _predict_wake_ns(pred, level, KGSL_PREDICT_NAP) +
+		KGSL_PREDICT_SLACK_NS;
+	if (gap <= 2 * lead) {
+		pred->phase = KGSL_PREDICT_AWAKE;
+		hrtimer_start(&pred->timer, ns_to_ktime(gap + pred->deviation +
+			KGSL_PREDICT_SLACK_NS), HRTIMER_MODE_REL);
+		return KGSL_STATE_ACTIVE;
+	}
+
+	if (gap > jiffies_to_nsecs(pwr->interval_timeout)) {
+		state = KGSL_PREDICT_SLUMBER;
+		lead = _predict_wake_ns(pred, level, KGSL_PREDICT_SLUMBER) +
+			KGSL_PREDICT_SLACK_NS;
+	}
+
+	if (gap > lead) {
+		pred->phase = KGSL_PREDICT_ARMED;
+		hrtimer_start(&pred->timer, ns_to_ktime(gap - lead),
+			HRTIMER_MODE_REL);
+	}
+
+	return state == KGSL_PREDICT_SLUMBER ? KGSL_STATE_SLUMBER :
+		KGSL_STATE_NAP;
+}
+
+static enum hrtimer_restart kgsl_pwrctrl_predict_timer(struct hrtimer *timer)
+{
+	struct kgsl_pwr_predict *pred = container_of(timer,
+			struct kgsl_pwr_predict, timer);
+
+	kgsl_schedule_work(&pred->work);
+
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * ARMED: wake the GPU for the predicted submission, the same way a touch
+ * event does, and give the submission a window to arrive in. AWAKE: the
+ * window passed without one, so let the GPU nap again.
+ */
+static void kgsl_pwrctrl_predict_work(struct work_struct *work)
+{
+	struct kgsl_pwr_predict *pred = container_of(work,
+			struct kgsl_pwr_predict, work);
+	struct kgsl_pwrctrl *pwr = container_of(pred,
+			struct kgsl_pwrctrl, predict);
+	struct kgsl_device *device = container_of(pwr,
+			struct kgsl_device, pwrctrl);
+
+	mutex_lock(&device->mutex);
+
+	if (atomic_read(&device->active_cnt) ||
+			device->requested_state == KGSL_STATE_SUSPEND) {
+		pred->phase = KGSL_PREDICT_IDLE;
+		goto done;
+	}
+
+	switch (pred->phase) {
+	case KGSL_PREDICT_ARMED:
+		if (device->state == KGSL_STATE_NAP ||
+				device->state == KGSL_STATE_SLUMBER)
+			kgsl_pwrctrl_change_state(device, KGSL_STATE_ACTIVE);
+
+		if (device->state != KGSL_STATE_ACTIVE) {
+			pred->phase = KGSL_PREDICT_IDLE;
+			break;
+		}
+
+		pred->phase = KGSL_PREDICT_AWAKE;
+		hrtimer_start(&pred->timer, ns_to_ktime(2 * (pred->deviation +
+			KGSL_PREDICT_SLACK_NS)), HRTIMER_MODE_REL);
+		break;
+	case KGSL_PREDICT_AWAKE:
+		pred->mispredicts[pwr->active_pwrlevel]++;
+		pred->phase = KGSL_PREDICT_IDLE;
+
+		if (device->state == KGSL_STATE_ACTIVE &&
+			device->requested_state == KGSL_STATE_NONE &&
+			!(pwr->ctrl_flags & BIT(KGSL_PWRFLAGS_NAP_OFF))) {
+			kgsl_pwrctrl_request_state(device, KGSL_STATE_NAP);
+			kgsl_schedule_work(&device->idle_check_ws);
+		}
+		break;
+	default:
+		break;
+	}
+
+done:
+	mutex_unlock(&device->mutex);
+}
+
 /**
  * kgsl_active_count_get() - Increase the device active count
  * @device: Pointer to a KGSL device
@@ -3102,11 +3392,18 @@ int kgsl_active_count_get(struct kgsl_device *device)
 
 	if ((atomic_read(&device->active_cnt) == 0) &&
 		(device->state != KGSL_STATE_ACTIVE)) {
+		unsigned int state;
+		u64 start;
+
 		mutex_unlock(&device->mutex);
 		wait_for_completion(&device->hwaccess_gate);
 		mutex_lock(&device->mutex);
+		state = device->state;
+		start = ktime_get_ns();
 		device->pwrctrl.superfast = true;
 		ret = kgsl_pwrctrl_change_state(device, KGSL_STATE_ACTIVE);
+		if (ret == 0)
+			kgsl_pwrctrl_predict_wake_done(device, state, start);
 	}
 	if (ret == 0)
 		atomic_inc(&device->active_cnt);
@@ -3138,11 +3435,17 @@ void kgsl_active_count_put(struct kgsl_device *device)
 	if (atomic_dec_and_test(&device->active_cnt)) {
 		bool nap_on = !(device->pwrctrl.ctrl_flags &
 			BIT(KGSL_PWRFLAGS_NAP_OFF));
-		if (nap_on && device->state == KGSL_STATE_ACTIVE &&
-			device->requested_state == KGSL_STATE_NONE) {
-			kgsl_pwrctrl_request_state(device, KGSL_STATE_NAP);
+		bool idle = nap_on && device->state == KGSL_STATE_ACTIVE &&
+			device->requested_state == KGSL_STATE_NONE;
+		unsigned int state = KGSL_STATE_NAP;
+
+		if (idle)
+			state = kgsl_pwrctrl_predict_idle(device);
+
+		if (idle && state != KGSL_STATE_ACTIVE) {
+			kgsl_pwrctrl_request_state(device, state);
 			kgsl_schedule_work(&device->idle_check_ws);
-		} else if (!nap_on) {
+		} else if (!nap_on || idle) {
 			kgsl_pwrscale_update_stats(device);
 			kgsl_pwrscale_update(device);
 		}
@@ -13,6 +13,7 @@
 #ifndef __KGSL_PWRCTRL_H
 #define __KGSL_PWRCTRL_H
 
+#include <linux/hrtimer.h>
 #include <linux/pm_qos.h>
 
 /*****************************************************************************
@@ -121,6 +122,50 @@ struct kgsl_regulator {
 	char name[8];
 };
 
+/* Low power states the cadence predictor keeps wake statistics for */
+enum kgsl_predict_state {
+	KGSL_PREDICT_NAP,
+	KGSL_PREDICT_SLUMBER,
+	KGSL_PREDICT_MAX,
+};
+
+/* Where the predictor is in the current idle period */
+enum kgsl_predict_phase {
+	KGSL_PREDICT_IDLE,
+	KGSL_PREDICT_ARMED,
+	KGSL_PREDICT_AWAKE,
+};
+
+/**
+ * struct kgsl_pwr_predict - Submission cadence predictor
+ * @enabled: Pick the idle state from the cadence and wake the GPU early
+ * @phase: ARMED while @timer will pre-wake the GPU, AWAKE while it is
+ * kept or brought up for a predicted submission
+ * @last_submit: Time the dispatcher last went from idle to busy, in ns
+ * @interval: Running average of the time between those, in ns
+ * @deviation: Running mean deviation from @interval, in ns
+ * @timer: Fires at the pre-wake point, then at the end of the AWAKE window
+ * @work: Does what @timer asks for in process context
+ * @wake_cnt: Wakes on the submission path for each power level and state
+ * @wake_us: Total time spent in those wakes, in us
+ * @hits: Submissions that found the GPU awake as predicted
+ * @mispredicts: Submissions that came before the pre-wake, plus AWAKE
+ * windows that passed without one
+ */
+struct kgsl_pwr_predict {
+	bool enabled;
+	enum kgsl_predict_phase phase;
+	u64 last_submit;
+	u64 interval;
+	u64 deviation;
+	struct hrtimer timer;
+	struct work_struct work;
+	unsigned int wake_cnt[KGSL_MAX_PWRLEVELS][KGSL_PREDICT_MAX];
+	u64 wake_us[KGSL_MAX_PWRLEVELS][KGSL_PREDICT_MAX];
+	unsigned int hits[KGSL_MAX_PWRLEVELS];
+	unsigned int mispredicts[KGSL_MAX_PWRLEVELS];
+};
+
 /**
  * struct kgsl_pwrctrl - Power control settings for a KGSL device
  * @interrupt_num - The interrupt number for the device
@@ -172,6 +217,7 @@ struct kgsl_regulator {
  * isense_clk_indx - index of isense clock, 0 if no isense
  * isense_clk_on_level - isense clock rate is XO rate below this level.
  * tzone_names - array of thermal zone names of GPU temperature sensors
+ * @predict - submission cadence predictor for the idle state choice
  */
 
 struct kgsl_pwrctrl {
@@ -229,6 +275,7 @@ struct kgsl_pwrctrl {
 	unsigned int gpu_bimc_int_clk_freq;
 	bool gpu_bimc_interface_enabled;
 	const char *tzone_names[KGSL_MAX_TZONE_NAMES];
+	struct kgsl_pwr_predict predict;
 };
 
 int kgsl_pwrctrl_init(struct kgsl_device *device);
@@ -269,6 +316,7 @@ kgsl_pwrctrl_active_freq(struct kgsl_pwrctrl *pwr)
 
 int __must_check kgsl_active_count_get(struct kgsl_device *device);
 void kgsl_active_count_put(struct kgsl_device *device);
+void kgsl_pwrctrl_predict_submit(struct kgsl_device *device);
 int kgsl_active_count_wait(struct kgsl_device *device, int count);
 void kgsl_pwrctrl_busy_time(struct kgsl_device *device, u64 time, u64 busy);
 void kgsl_pwrctrl_set_constraint(struct kgsl_device *device,
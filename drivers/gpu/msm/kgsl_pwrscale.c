@@ -55,6 +55,7 @@ static struct kgsl_midframe_info {
 static void do_devfreq_suspend(struct work_struct *work);
 static void do_devfreq_resume(struct work_struct *work);
 static void do_devfreq_notify(struct work_struct *work);
+static void do_devfreq_frame(struct work_struct *work);
 
 /*
  * These variables are used to keep the latest data
@@ -132,6 +133,30 @@ void kgsl_pwrscale_busy(struct kgsl_device *device)
 }
 EXPORT_SYMBOL(kgsl_pwrscale_busy);
 
+/*
+ * kgsl_pwrscale_frame - notify governor that a frame has retired
+ * @device: The device
+ * @deadline: Deadline of the end of frame command in ns, 0 if it has none
+ *
+ * Called by the dispatcher when a command marked as the end of a frame
+ * retires. Frame based governors use this both to count frames and to
+ * re-evaluate the power level on the frame boundary.
+ */
+void kgsl_pwrscale_frame(struct kgsl_device *device, uint64_t deadline)
+{
+	if (!device->pwrscale.enabled)
+		return;
+
+	atomic_inc(&device->pwrscale.frames);
+	if (deadline)
+		atomic64_set(&device->pwrscale.bus_frame_deadline, deadline);
+
+	/* to call srcu_notifier_call_chain() from a kernel thread */
+	queue_work(device->pwrscale.devfreq_wq,
+		&device->pwrscale.devfreq_frame_ws);
+}
+EXPORT_SYMBOL(kgsl_pwrscale_frame);
+
 /**
  * kgsl_pwrscale_update_stats() - update device busy statistics
  * @device: The device
@@ -168,6 +193,12 @@ void kgsl_pwrscale_update_stats(struct kgsl_device *device)
 		device->pwrscale.accum_stats.busy_time += stats.busy_time;
 		device->pwrscale.accum_stats.ram_time += stats.ram_time;
 		device->pwrscale.accum_stats.ram_wait += stats.ram_wait;
+		device->pwrscale.accum_stats.alu_time += stats.alu_time;
+		psc->frame_stats.busy_time += stats.busy_time;
+		psc->frame_stats.alu_time += stats.alu_time;
+		psc->frame_stats.ram_time += stats.ram_time;
+		psc->frame_stats.ram_wait += stats.ram_wait;
+		psc->bus_frame_beats += stats.ram_time;
 		pwrctrl->clock_times[pwrctrl->active_pwrlevel] +=
 				stats.busy_time;
 	}
@@ -661,6 +692,50 @@ int kgsl_devfreq_get_dev_status(struct device *dev,
 }
 EXPORT_SYMBOL(kgsl_devfreq_get_dev_status);
 
+/*
+ * kgsl_devfreq_get_frame_stats - Get the workload statistics for frame
+ * based governors
+ * @dev: The device
+ * @stats: Filled with the statistics accumulated since the last call
+ *
+ * Unlike kgsl_devfreq_get_dev_status() the sample also carries the shader
+ * ALU time, the DDR traffic and stalls and the number of frames retired, so
+ * a governor can split the workload into the part that scales with the GPU
+ * clock and the part that is bound by the bus. This function expects the
+ * device mutex to be unlocked.
+ */
+int kgsl_devfreq_get_frame_stats(struct device *dev,
+		struct msm_adreno_frame_stats *stats)
+{
+	struct kgsl_device *device = dev_get_drvdata(dev);
+	struct kgsl_pwrscale *pwrscale;
+	ktime_t now;
+
+	if (device == NULL)
+		return -ENODEV;
+	if (stats == NULL)
+		return -EINVAL;
+
+	pwrscale = &device->pwrscale;
+
+	mutex_lock(&device->mutex);
+
+	kgsl_pwrscale_update_stats(device);
+
+	now = ktime_get();
+	*stats = pwrscale->frame_stats;
+	stats->total_time = ktime_us_delta(now, pwrscale->frame_time);
+	stats->frames = atomic_xchg(&pwrscale->frames, 0);
+
+	memset(&pwrscale->frame_stats, 0, sizeof(pwrscale->frame_stats));
+	pwrscale->frame_time = now;
+
+	mutex_unlock(&device->mutex);
+
+	return 0;
+}
+EXPORT_SYMBOL(kgsl_devfreq_get_frame_stats);
+
 /*
  * kgsl_devfreq_get_cur_freq - devfreq_dev_profile.get_cur_freq callback
  * @dev: see devfreq.h
@@ -731,6 +806,28 @@ int kgsl_devfreq_del_notifier(struct device *dev, struct notifier_block *nb)
 EXPORT_SYMBOL(kgsl_devfreq_del_notifier);
 
 
+/* Report the last complete frame to the bus governor if it is recent */
+static void _busmon_get_frame(struct kgsl_device *device, struct xstats *b)
+{
+	struct kgsl_pwrscale *psc;
+
+	b->frame_ram_time = 0;
+	b->frame_time = 0;
+
+	if (device == NULL)
+		return;
+
+	psc = &device->pwrscale;
+
+	mutex_lock(&device->mutex);
+	if (psc->bus_frame_time && ktime_us_delta(ktime_get(),
+			psc->bus_frame_stamp) < KGSL_BUS_FRAME_TIMEOUT) {
+		b->frame_ram_time = psc->bus_frame_ram_time;
+		b->frame_time = psc->bus_frame_time;
+	}
+	mutex_unlock(&device->mutex);
+}
+
 /*
  * kgsl_busmon_get_dev_status - devfreq_dev_profile.get_dev_status callback
  * @dev: see devfreq.h
@@ -754,6 +851,7 @@ int kgsl_busmon_get_dev_status(struct device *dev,
 		b->ram_time = last_b->ram_time;
 		b->ram_wait = last_b->ram_wait;
 		b->mod = last_b->mod;
+		_busmon_get_frame(dev_get_drvdata(dev), b);
 	}
 	return 0;
 }
@@ -1108,12 +1206,15 @@ int kgsl_pwrscale_init(struct device *dev, const char *governor)
 	INIT_WORK(&pwrscale->devfreq_suspend_ws, do_devfreq_suspend);
 	INIT_WORK(&pwrscale->devfreq_resume_ws, do_devfreq_resume);
 	INIT_WORK(&pwrscale->devfreq_notify_ws, do_devfreq_notify);
+	INIT_WORK(&pwrscale->devfreq_frame_ws, do_devfreq_frame);
 	if (kgsl_midframe)
 		INIT_WORK(&kgsl_midframe->timer_check_ws,
 				kgsl_pwrscale_midframe_timer_check);
 
 	pwrscale->next_governor_call = ktime_add_us(ktime_get(),
 			KGSL_GOVERNOR_CALL_INTERVAL);
+	pwrscale->frame_time = ktime_get();
+	pwrscale->bus_frame_start = pwrscale->frame_time;
 
 	/* history tracking */
 	for (i = 0; i < KGSL_PWREVENT_MAX; i++) {
@@ -1196,3 +1297,53 @@ static void do_devfreq_notify(struct work_struct *work)
 				 ADRENO_DEVFREQ_NOTIFY_RETIRE,
 				 devfreq);
 }
+
+/*
+ * Close the frame for the bus governor: the DDR beats read up to now belong
+ * to the frame that just retired. The frame had until the deadline of its
+ * last command to move them or, without a deadline, the time since the
+ * previous frame retired.
+ */
+static void kgsl_pwrscale_bus_frame(struct kgsl_device *device)
+{
+	struct kgsl_pwrscale *psc = &device->pwrscale;
+	u64 deadline, start;
+	ktime_t now;
+	s64 budget;
+
+	mutex_lock(&device->mutex);
+	kgsl_pwrscale_update_stats(device);
+
+	now = ktime_get();
+	start = ktime_to_ns(psc->bus_frame_start);
+	deadline = atomic64_xchg(&psc->bus_frame_deadline, 0);
+
+	if (deadline)
+		budget = deadline > start ?
+			div_u64(deadline - start, NSEC_PER_USEC) : 0;
+	else
+		budget = ktime_us_delta(now, psc->bus_frame_start);
+
+	psc->bus_frame_ram_time = psc->bus_frame_beats;
+	psc->bus_frame_time = max_t(s64, budget, KGSL_BUS_FRAME_MIN);
+	psc->bus_frame_stamp = now;
+	psc->bus_frame_beats = 0;
+	psc->bus_frame_start = now;
+	mutex_unlock(&device->mutex);
+}
+
+static void do_devfreq_frame(struct work_struct *work)
+{
+	struct kgsl_pwrscale *pwrscale = container_of(work,
+			struct kgsl_pwrscale, devfreq_frame_ws);
+	struct devfreq *devfreq = pwrscale->devfreqptr;
+
+	/* The bus governor reads the closed frame from the notifier */
+	if (pwrscale->bus_profile.frame_mode)
+		kgsl_pwrscale_bus_frame(container_of(pwrscale,
+				struct kgsl_device, pwrscale));
+
+	srcu_notifier_call_chain(&pwrscale->nh,
+				 ADRENO_DEVFREQ_NOTIFY_FRAME,
+				 devfreq);
+}
@@ -21,6 +21,13 @@
 /* devfreq governor call window in usec */
 #define KGSL_GOVERNOR_CALL_INTERVAL 10000
 
+/*
+ * A frame is only reported to the bus governor for this many usec after it
+ * retired and it is given at least KGSL_BUS_FRAME_MIN usec to move its data
+ */
+#define KGSL_BUS_FRAME_TIMEOUT 50000
+#define KGSL_BUS_FRAME_MIN 1000
+
 /* Power events to be tracked with history */
 #define KGSL_PWREVENT_STATE	0
 #define KGSL_PWREVENT_GPU_FREQ	1
@@ -53,6 +60,7 @@ struct kgsl_power_stats {
 	u64 busy_time;
 	u64 ram_time;
 	u64 ram_wait;
+	u64 alu_time;
 };
 
 struct kgsl_pwr_event {
@@ -85,6 +93,7 @@ struct kgsl_pwr_history {
  * @devfreq_suspend_ws - Pass device suspension to devfreq
  * @devfreq_resume_ws - Pass device resume to devfreq
  * @devfreq_notify_ws - Notify devfreq to update sampling
+ * @devfreq_frame_ws - Notify devfreq that a frame has retired
  * @next_governor_call - Timestamp after which the governor may be notified of
  * a new sample
  * @history - History of power events with timestamps and durations
@@ -96,6 +105,16 @@ struct kgsl_pwr_history {
  * ctxt aware power level jump
  * @ctxt_aware_target_pwrlevel - pwrlevel to jump on in case of ctxt aware
  * power level jump
+ * @frame_stats - Accumulated statistics for kgsl_devfreq_get_frame_stats()
+ * @frame_time - Start of the current frame_stats sample
+ * @frames - End of frame markers retired since the last frame_stats read
+ * @bus_frame_beats - DDR beats moved since the last bus frame boundary
+ * @bus_frame_start - Start of the current frame for the bus governor
+ * @bus_frame_deadline - Latest deadline in ns of the end of frame commands
+ * retired since the last bus frame boundary, 0 if none had one
+ * @bus_frame_ram_time - DDR beats moved during the last complete frame
+ * @bus_frame_time - Time in usec the last complete frame had to move them
+ * @bus_frame_stamp - When the last complete frame was closed
  */
 struct kgsl_pwrscale {
 	struct devfreq *devfreqptr;
@@ -113,6 +132,7 @@ struct kgsl_pwrscale {
 	struct work_struct devfreq_suspend_ws;
 	struct work_struct devfreq_resume_ws;
 	struct work_struct devfreq_notify_ws;
+	struct work_struct devfreq_frame_ws;
 	ktime_t next_governor_call;
 	struct kgsl_pwr_history history[KGSL_PWREVENT_MAX];
 	int popp_level;
@@ -121,6 +141,15 @@ struct kgsl_pwrscale {
 	bool ctxt_aware_enable;
 	unsigned int ctxt_aware_target_pwrlevel;
 	unsigned int ctxt_aware_busy_penalty;
+	struct msm_adreno_frame_stats frame_stats;
+	ktime_t frame_time;
+	atomic_t frames;
+	u64 bus_frame_beats;
+	ktime_t bus_frame_start;
+	atomic64_t bus_frame_deadline;
+	u64 bus_frame_ram_time;
+	u64 bus_frame_time;
+	ktime_t bus_frame_stamp;
 };
 
 int kgsl_pwrscale_init(struct device *dev, const char *governor);
@@ -129,6 +158,7 @@ void kgsl_pwrscale_close(struct kgsl_device *device);
 void kgsl_pwrscale_update(struct kgsl_device *device);
 void kgsl_pwrscale_update_stats(struct kgsl_device *device);
 void kgsl_pwrscale_busy(struct kgsl_device *device);
+void kgsl_pwrscale_frame(struct kgsl_device *device, uint64_t deadline);
 void kgsl_pwrscale_sleep(struct kgsl_device *device);
 void kgsl_pwrscale_wake(struct kgsl_device *device);
 
@@ -37,6 +37,7 @@
  */
 
 static bool sharedmem_noretry_flag;
+static bool sharedmem_large_pages_flag;
 
 static DEFINE_MUTEX(kernel_map_global_lock);
 
@@ -158,11 +159,54 @@ gpumem_unmapped_show(struct kgsl_process_private *priv, int type, char *buf)
 			priv->stats[type].cur - priv->gpumem_mapped);
 }
 
+/* The type selects the IOMMU page size bucket to show */
+static ssize_t
+gpumem_pgsize_show(struct kgsl_process_private *priv, int type, char *buf)
+{
+	struct kgsl_pagetable *pt = priv->pagetable;
+	long val = 0;
+
+	if (pt != NULL)
+		val = atomic_long_read(&pt->stats.mapped_pgsize[type]);
+
+	return scnprintf(buf, PAGE_SIZE, "%ld\n", val);
+}
+
+/* The type selects hits (0), misses (1) or the hit rate in percent (2) */
+static ssize_t
+gpuaddr_cache_show(struct kgsl_process_private *priv, int type, char *buf)
+{
+	struct kgsl_pagetable *pt = priv->pagetable;
+	long hits = 0, misses = 0;
+
+	if (pt != NULL) {
+		hits = atomic_long_read(&pt->stats.iova_cache_hits);
+		misses = atomic_long_read(&pt->stats.iova_cache_misses);
+	}
+
+	if (type == 0)
+		return scnprintf(buf, PAGE_SIZE, "%ld\n", hits);
+	if (type == 1)
+		return scnprintf(buf, PAGE_SIZE, "%ld\n", misses);
+
+	return scnprintf(buf, PAGE_SIZE, "%ld\n",
+			hits + misses ? hits * 100 / (hits + misses) : 0);
+}
+
 static struct kgsl_mem_entry_attribute debug_memstats[] = {
 	__MEM_ENTRY_ATTR(0, imported_mem, imported_mem_show),
 	__MEM_ENTRY_ATTR(0, gpumem_mapped, gpumem_mapped_show),
 	__MEM_ENTRY_ATTR(KGSL_MEM_ENTRY_KERNEL, gpumem_unmapped,
 				gpumem_unmapped_show),
+	__MEM_ENTRY_ATTR(KGSL_MMU_PGSIZE_4K, gpumem_mapped_4k,
+				gpumem_pgsize_show),
+	__MEM_ENTRY_ATTR(KGSL_MMU_PGSIZE_64K, gpumem_mapped_64k,
+				gpumem_pgsize_show),
+	__MEM_ENTRY_ATTR(KGSL_MMU_PGSIZE_2M, gpumem_mapped_2m,
+				gpumem_pgsize_show),
+	__MEM_ENTRY_ATTR(0, gpuaddr_cache_hits, gpuaddr_cache_show),
+	__MEM_ENTRY_ATTR(1, gpuaddr_cache_misses, gpuaddr_cache_show),
+	__MEM_ENTRY_ATTR(2, gpuaddr_cache_hit_rate, gpuaddr_cache_show),
 };
 
 /**
@@ -839,6 +883,17 @@ kgsl_sharedmem_page_alloc_user(struct kgsl_memdesc *memdesc,
 	if (align < ilog2(SZ_1M))
 		align = ilog2(SZ_1M);
 
+	/*
+	 * Big buffers such as render targets get a 2MB aligned GPU address
+	 * so that any 2MB pages we manage to get can be mapped with 2MB
+	 * IOMMU blocks.
+	 */
+	if (sharedmem_large_pages_flag && size >= KGSL_LARGE_PAGE_MIN_SIZE &&
+			align < ilog2(SZ_2M)) {
+		kgsl_memdesc_set_align(memdesc, ilog2(SZ_2M));
+		align = ilog2(SZ_2M);
+	}
+
 	page_size = kgsl_get_page_size(size, align);
 
 	/*
@@ -1366,3 +1421,13 @@ bool kgsl_sharedmem_get_noretry(void)
 {
 	return sharedmem_noretry_flag;
 }
+
+void kgsl_sharedmem_set_large_pages(bool val)
+{
+	sharedmem_large_pages_flag = val;
+}
+
+bool kgsl_sharedmem_get_large_pages(void)
+{
+	return sharedmem_large_pages_flag;
+}
@@ -328,6 +328,12 @@ static inline void kgsl_free_global(struct kgsl_device *device,
 void kgsl_sharedmem_set_noretry(bool val);
 bool kgsl_sharedmem_get_noretry(void);
 
+/* Buffers at least this big try to use 2MB pages in large page mode */
+#define KGSL_LARGE_PAGE_MIN_SIZE SZ_8M
+
+void kgsl_sharedmem_set_large_pages(bool val);
+bool kgsl_sharedmem_get_large_pages(void);
+
 /**
  * kgsl_alloc_sgt_from_pages() - Allocate a sg table
  *
@@ -383,7 +389,11 @@ static inline void kgsl_free_sgt(struct sg_table *sgt)
 #ifndef CONFIG_ALLOC_BUFFERS_IN_4K_CHUNKS
 static inline int kgsl_get_page_size(size_t size, unsigned int align)
 {
-	if (align >= ilog2(SZ_1M) && size >= SZ_1M &&
+	/* 2MB pages never come from the pools, they are only tried once */
+	if (align >= ilog2(SZ_2M) && size >= SZ_2M &&
+		kgsl_sharedmem_get_large_pages())
+		return SZ_2M;
+	else if (align >= ilog2(SZ_1M) && size >= SZ_1M &&
 		kgsl_pool_avaialable(SZ_1M))
 		return SZ_1M;
 	else if (align >= ilog2(SZ_64K) && size >= SZ_64K &&
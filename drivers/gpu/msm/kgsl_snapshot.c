@@ -33,6 +33,15 @@ struct kgsl_snapshot_cp_obj {
 	struct list_head node;
 };
 
+/* An IB found in the ringbuffer that is parsed after a fast snapshot */
+
+struct kgsl_snapshot_ib {
+	uint64_t gpuaddr;
+	uint64_t dwords;
+	struct kgsl_mem_entry *entry;
+	struct list_head node;
+};
+
 struct snapshot_obj_itr {
 	u8 *buf;      /* Buffer pointer to write to */
 	int pos;        /* Current position in the sequence */
@@ -613,6 +622,7 @@ void kgsl_snapshot_add_section(struct kgsl_device *device, u16 id,
 static void kgsl_free_snapshot(struct kgsl_snapshot *snapshot)
 {
 	struct kgsl_snapshot_object *obj, *tmp;
+	struct kgsl_snapshot_ib *ib, *ib_tmp;
 
 	wait_for_completion(&snapshot->dump_gate);
 
@@ -620,6 +630,11 @@ static void kgsl_free_snapshot(struct kgsl_snapshot *snapshot)
 				&snapshot->obj_list, node)
 		kgsl_snapshot_put_object(obj);
 
+	list_for_each_entry_safe(ib, ib_tmp, &snapshot->ib_list, node) {
+		kgsl_mem_entry_put(ib->entry);
+		kfree(ib);
+	}
+
 	if (snapshot->mempool)
 		vfree(snapshot->mempool);
 
@@ -682,6 +697,7 @@ void kgsl_device_snapshot(struct kgsl_device *device,
 	init_completion(&snapshot->dump_gate);
 	INIT_LIST_HEAD(&snapshot->obj_list);
 	INIT_LIST_HEAD(&snapshot->cp_list);
+	INIT_LIST_HEAD(&snapshot->ib_list);
 	INIT_WORK(&snapshot->work, kgsl_snapshot_save_frozen_objs);
 
 	snapshot->start = device->snapshot_memory.ptr;
@@ -691,6 +707,7 @@ void kgsl_device_snapshot(struct kgsl_device *device,
 	snapshot->recovered = false;
 	snapshot->first_read = true;
 	snapshot->sysfs_read = 0;
+	snapshot->fast = device->snapshot_fast;
 
 	header = (struct kgsl_snapshot_header *) snapshot->ptr;
 
@@ -738,7 +755,8 @@ void kgsl_device_snapshot(struct kgsl_device *device,
 	/*
 	 * Queue a work item that will save the IB data in snapshot into
 	 * static memory to prevent loss of data due to overwriting of
-	 * memory.
+	 * memory. For a fast snapshot this is also where the IBs get parsed,
+	 * so it runs while the GPU is already being recovered.
 	 *
 	 */
 	kgsl_schedule_work(&snapshot->work);
@@ -779,6 +797,48 @@ static void kgsl_snapshot_process_ib_obj_list(struct kgsl_snapshot *snapshot)
 	}
 }
 
+/**
+ * kgsl_snapshot_process_deferred_ibs() - Parse the IBs that were skipped
+ * while taking a fast snapshot
+ * @device: device being snapshotted
+ * @snapshot: The snapshot data
+ *
+ * Find the objects used by each IB and add them to the IB object list so
+ * they get frozen and dumped along with everything else. The memory entries
+ * were referenced when the IBs were found, but the contents are only as good
+ * as whatever userspace left in them after the GPU restarted.
+ */
+static void kgsl_snapshot_process_deferred_ibs(struct kgsl_device *device,
+		struct kgsl_snapshot *snapshot)
+{
+	struct kgsl_snapshot_ib *ib, *tmp;
+	bool max_objs = false;
+
+	list_for_each_entry_safe(ib, tmp, &snapshot->ib_list, node) {
+		struct kgsl_process_private *process = ib->entry->priv;
+		struct adreno_ib_object_list *ib_obj_list = NULL;
+
+		if (!kgsl_snapshot_have_object(snapshot, process,
+					ib->gpuaddr, ib->dwords << 2)) {
+			if (-E2BIG == adreno_ib_create_object_list(device,
+					process, ib->gpuaddr, ib->dwords,
+					snapshot->ib2base, &ib_obj_list))
+				max_objs = true;
+
+			if (ib_obj_list)
+				kgsl_snapshot_add_ib_obj_list(snapshot,
+					ib_obj_list);
+		}
+
+		list_del(&ib->node);
+		kgsl_mem_entry_put(ib->entry);
+		kfree(ib);
+	}
+
+	if (max_objs)
+		KGSL_CORE_ERR("Max objects found in IB\n");
+}
+
 #define to_snapshot_attr(a) \
 container_of(a, struct kgsl_snapshot_attribute, attr)
 
@@ -1026,6 +1086,25 @@ static ssize_t snapshot_legacy_store(struct kgsl_device *device,
 	return (ssize_t) ret < 0 ? ret : count;
 }
 
+static ssize_t snapshot_fast_show(struct kgsl_device *device, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%d\n", device->snapshot_fast);
+}
+
+static ssize_t snapshot_fast_store(struct kgsl_device *device,
+	const char *buf, size_t count)
+{
+	unsigned int val = 0;
+	int ret;
+
+	ret = kgsl_sysfs_store(buf, &val);
+
+	if (!ret && device)
+		device->snapshot_fast = (bool)val;
+
+	return (ssize_t) ret < 0 ? ret : count;
+}
+
 static struct bin_attribute snapshot_attr = {
 	.attr.name = "dump",
 	.attr.mode = 0444,
@@ -1049,6 +1128,8 @@ static SNAPSHOT_ATTR(snapshot_crashdumper, 0644, snapshot_crashdumper_show,
 	snapshot_crashdumper_store);
 static SNAPSHOT_ATTR(snapshot_legacy, 0644, snapshot_legacy_show,
 	snapshot_legacy_store);
+static SNAPSHOT_ATTR(snapshot_fast, 0644, snapshot_fast_show,
+	snapshot_fast_store);
 
 static ssize_t snapshot_sysfs_show(struct kobject *kobj,
 	struct attribute *attr, char *buf)
@@ -1132,6 +1213,8 @@ int kgsl_device_snapshot_init(struct kgsl_device *device)
 	device->prioritize_unrecoverable = true;
 	device->snapshot_crashdumper = 1;
 	device->snapshot_legacy = 0;
+	device->snapshot_fast = of_property_read_bool(device->pdev->dev.of_node,
+		"qcom,snapshot-fast");
 
 	ret = kobject_init_and_add(&device->snapshot_kobj, &ktype_snapshot,
 		&device->dev->kobj, "snapshot");
@@ -1167,6 +1250,11 @@ int kgsl_device_snapshot_init(struct kgsl_device *device)
 
 	ret  = sysfs_create_file(&device->snapshot_kobj,
 			&attr_snapshot_legacy.attr);
+	if (ret)
+		goto done;
+
+	ret  = sysfs_create_file(&device->snapshot_kobj,
+			&attr_snapshot_fast.attr);
 
 done:
 	return ret;
@@ -1221,6 +1309,44 @@ int kgsl_snapshot_add_ib_obj_list(struct kgsl_snapshot *snapshot,
 	return 0;
 }
 
+/**
+ * kgsl_snapshot_defer_ib() - Queue an IB to be parsed after a fast snapshot
+ * @snapshot: The snapshot data
+ * @process: The process that owns the IB
+ * @gpuaddr: GPU address of the IB
+ * @dwords: Size of the IB in dwords
+ *
+ * Take a reference to the memory entry containing the IB so it can be parsed
+ * by the snapshot worker once the GPU is up and running again instead of
+ * stalling the fault recovery. Returns 0 on success or a negative error code.
+ */
+int kgsl_snapshot_defer_ib(struct kgsl_snapshot *snapshot,
+	struct kgsl_process_private *process, uint64_t gpuaddr,
+	uint64_t dwords)
+{
+	struct kgsl_snapshot_ib *ib;
+	struct kgsl_mem_entry *entry;
+
+	if (process == NULL)
+		return -EINVAL;
+
+	entry = kgsl_sharedmem_find(process, gpuaddr);
+	if (entry == NULL)
+		return -EINVAL;
+
+	ib = kzalloc(sizeof(*ib), GFP_KERNEL);
+	if (ib == NULL) {
+		kgsl_mem_entry_put(entry);
+		return -ENOMEM;
+	}
+
+	ib->gpuaddr = gpuaddr;
+	ib->dwords = dwords;
+	ib->entry = entry;
+	list_add_tail(&ib->node, &snapshot->ib_list);
+	return 0;
+}
+
 static size_t _mempool_add_object(struct kgsl_snapshot *snapshot, u8 *data,
 		struct kgsl_snapshot_object *obj)
 {
@@ -1283,6 +1409,7 @@ static void kgsl_snapshot_save_frozen_objs(struct work_struct *work)
 	if (snapshot->gmu_fault)
 		goto gmu_only;
 
+	kgsl_snapshot_process_deferred_ibs(device, snapshot);
 	kgsl_snapshot_process_ib_obj_list(snapshot);
 
 	list_for_each_entry(obj, &snapshot->obj_list, node) {
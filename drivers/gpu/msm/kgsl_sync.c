@@ -142,7 +142,8 @@ static int _add_fence_event(struct kgsl_device *device,
 	event->context = context;
 	event->timestamp = timestamp;
 
-	ret = kgsl_add_event(device, &context->events, timestamp,
+	/* Signalling the fence doesn't sleep so do it from the retire path */
+	ret = kgsl_add_fast_event(device, &context->events, timestamp,
 		kgsl_sync_fence_event_cb, event);
 
 	if (ret) {
@@ -13,7 +13,10 @@
 
 #define pr_fmt(fmt) "RRADC: %s: " fmt, __func__
 
+#include <linux/iio/buffer.h>
 #include <linux/iio/iio.h>
+#include <linux/iio/trigger_consumer.h>
+#include <linux/iio/triggered_buffer.h>
 #include <linux/kernel.h>
 #include <linux/math64.h>
 #include <linux/module.h>
@@ -236,6 +239,7 @@ struct rradc_chip {
 	struct iio_chan_spec		*iio_chans;
 	unsigned int			nchannels;
 	struct rradc_chan_prop		*chan_props;
+	s32				*scan_buf;
 	struct device_node		*revid_dev_node;
 	struct pmic_revid_data		*pmic_fab_id;
 	int volt;
@@ -1054,6 +1058,38 @@ static int rradc_do_conversion(struct rradc_chip *chip,
 	return rc;
 }
 
+static int rradc_read_processed(struct rradc_chip *chip, unsigned long address,
+				int *val)
+{
+	struct rradc_chan_prop *prop;
+	u16 adc_code;
+	int rc;
+
+	if (((chip->pmic_fab_id->tp_rev
+			>= FG_RR_TP_REV_VERSION1)
+	&& (chip->pmic_fab_id->tp_rev
+			<= FG_RR_TP_REV_VERSION2))
+	|| (chip->pmic_fab_id->tp_rev
+			>= FG_RR_TP_REV_VERSION3)) {
+		if (address == RR_ADC_USBIN_I) {
+			prop = &chip->chan_props[RR_ADC_USBIN_V];
+			rc = rradc_do_conversion(chip, prop, &adc_code);
+			if (rc)
+				return rc;
+			prop->scale(chip, prop, adc_code, &chip->volt);
+		}
+	}
+
+	prop = &chip->chan_props[address];
+	rc = rradc_do_conversion(chip, prop, &adc_code);
+	if (rc)
+		return rc;
+
+	prop->scale(chip, prop, adc_code, val);
+
+	return 0;
+}
+
 static int rradc_read_raw(struct iio_dev *indio_dev,
 			 struct iio_chan_spec const *chan, int *val, int *val2,
 			 long mask)
@@ -1070,28 +1106,10 @@ static int rradc_read_raw(struct iio_dev *indio_dev,
 
 	switch (mask) {
 	case IIO_CHAN_INFO_PROCESSED:
-		if (((chip->pmic_fab_id->tp_rev
-				>= FG_RR_TP_REV_VERSION1)
-		&& (chip->pmic_fab_id->tp_rev
-				<= FG_RR_TP_REV_VERSION2))
-		|| (chip->pmic_fab_id->tp_rev
-				>= FG_RR_TP_REV_VERSION3)) {
-			if (chan->address == RR_ADC_USBIN_I) {
-				prop = &chip->chan_props[RR_ADC_USBIN_V];
-				rc = rradc_do_conversion(chip, prop, &adc_code);
-				if (rc)
-					break;
-				prop->scale(chip, prop, adc_code, &chip->volt);
-			}
-		}
-
-		prop = &chip->chan_props[chan->address];
-		rc = rradc_do_conversion(chip, prop, &adc_code);
+		rc = rradc_read_processed(chip, chan->address, val);
 		if (rc)
 			break;
 
-		prop->scale(chip, prop, adc_code, val);
-
 		return IIO_VAL_INT;
 	case IIO_CHAN_INFO_RAW:
 		prop = &chip->chan_props[chan->address];
@@ -1110,6 +1128,39 @@ static int rradc_read_raw(struct iio_dev *indio_dev,
 	return rc;
 }
 
+/*
+ * The RR ADC converts its channels round robin on its own, so a buffered
+ * scan only collects the latest result of every enabled channel and pushes
+ * them as one sample, processed like a direct read.
+ */
+static irqreturn_t rradc_trigger_handler(int irq, void *p)
+{
+	struct iio_poll_func *pf = p;
+	struct iio_dev *indio_dev = pf->indio_dev;
+	struct rradc_chip *chip = iio_priv(indio_dev);
+	unsigned int bit, i = 0;
+	int rc = 0, val;
+
+	for_each_set_bit(bit, indio_dev->active_scan_mask,
+			 indio_dev->masklength) {
+		rc = rradc_read_processed(chip, chip->iio_chans[bit].address,
+					  &val);
+		if (rc) {
+			pr_debug("Scan of channel %u failed:%d\n", bit, rc);
+			break;
+		}
+		chip->scan_buf[i++] = val;
+	}
+
+	if (!rc)
+		iio_push_to_buffers_with_timestamp(indio_dev, chip->scan_buf,
+						   iio_get_time_ns(indio_dev));
+
+	iio_trigger_notify_done(indio_dev->trig);
+
+	return IRQ_HANDLED;
+}
+
 static const struct iio_info rradc_info = {
 	.read_raw	= &rradc_read_raw,
 	.driver_module	= THIS_MODULE,
@@ -1124,11 +1175,18 @@ static int rradc_get_dt_data(struct rradc_chip *chip, struct device_node *node)
 	struct rradc_chan_prop prop;
 
 	chip->nchannels = RR_ADC_MAX;
-	chip->iio_chans = devm_kcalloc(chip->dev, chip->nchannels,
+	/* One more for the timestamp of buffered scans */
+	chip->iio_chans = devm_kcalloc(chip->dev, chip->nchannels + 1,
 				       sizeof(*chip->iio_chans), GFP_KERNEL);
 	if (!chip->iio_chans)
 		return -ENOMEM;
 
+	chip->scan_buf = devm_kzalloc(chip->dev,
+				ALIGN(chip->nchannels * sizeof(s32),
+				      sizeof(s64)) + sizeof(s64), GFP_KERNEL);
+	if (!chip->scan_buf)
+		return -ENOMEM;
+
 	chip->chan_props = devm_kcalloc(chip->dev, chip->nchannels,
 				       sizeof(*chip->chan_props), GFP_KERNEL);
 	if (!chip->chan_props)
@@ -1195,9 +1253,21 @@ static int rradc_get_dt_data(struct rradc_chip *chip, struct device_node *node)
 		iio_chan->info_mask_separate = rradc_chan->info_mask;
 		iio_chan->type = rradc_chan->type;
 		iio_chan->address = i;
+		iio_chan->scan_index = i;
+		iio_chan->scan_type.sign = 's';
+		iio_chan->scan_type.realbits = 32;
+		iio_chan->scan_type.storagebits = 32;
+		iio_chan->scan_type.endianness = IIO_CPU;
 		iio_chan++;
 	}
 
+	iio_chan->type = IIO_TIMESTAMP;
+	iio_chan->channel = -1;
+	iio_chan->scan_index = i;
+	iio_chan->scan_type.sign = 's';
+	iio_chan->scan_type.realbits = 64;
+	iio_chan->scan_type.storagebits = 64;
+
 	return 0;
 }
 
@@ -1233,7 +1303,12 @@ static int rradc_probe(struct platform_device *pdev)
 	indio_dev->modes = INDIO_DIRECT_MODE;
 	indio_dev->info = &rradc_info;
 	indio_dev->channels = chip->iio_chans;
-	indio_dev->num_channels = chip->nchannels;
+	indio_dev->num_channels = chip->nchannels + 1;
+
+	rc = devm_iio_triggered_buffer_setup(dev, indio_dev, NULL,
+					     rradc_trigger_handler, NULL);
+	if (rc)
+		return rc;
 
 	chip->usb_trig = power_supply_get_by_name("usb");
 	if (!chip->usb_trig)
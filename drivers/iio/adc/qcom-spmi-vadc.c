@@ -15,7 +15,10 @@
 #include <linux/completion.h>
 #include <linux/delay.h>
 #include <linux/err.h>
+#include <linux/iio/buffer.h>
 #include <linux/iio/iio.h>
+#include <linux/iio/trigger_consumer.h>
+#include <linux/iio/triggered_buffer.h>
 #include <linux/interrupt.h>
 #include <linux/kernel.h>
 #include <linux/math64.h>
@@ -171,6 +174,7 @@ struct vadc_channel_prop {
  * @complete: VADC result notification after interrupt is received.
  * @graph: store parameters for calibration.
  * @lock: ADC lock for access to the peripheral.
+ * @scan_buf: one buffered scan, the enabled channels and the timestamp.
  */
 struct vadc_priv {
 	struct regmap		 *regmap;
@@ -184,6 +188,7 @@ struct vadc_priv {
 	struct completion	 complete;
 	struct vadc_linear_graph graph[2];
 	struct mutex		 lock;
+	s32			 *scan_buf;
 };
 
 static const struct vadc_prescale_ratio vadc_prescale_ratios[] = {
@@ -361,24 +366,23 @@ static struct vadc_channel_prop *vadc_get_channel(struct vadc_priv *vadc,
 	return NULL;
 }
 
-static int vadc_do_conversion(struct vadc_priv *vadc,
-			      struct vadc_channel_prop *prop, u16 *data)
+/* Must be called with vadc->lock held */
+static int __vadc_do_conversion(struct vadc_priv *vadc,
+				struct vadc_channel_prop *prop, u16 *data)
 {
 	unsigned int timeout;
 	int ret;
 
-	mutex_lock(&vadc->lock);
-
 	ret = vadc_configure(vadc, prop);
 	if (ret)
-		goto unlock;
+		return ret;
 
 	if (!vadc->poll_eoc)
 		reinit_completion(&vadc->complete);
 
 	ret = vadc_set_state(vadc, true);
 	if (ret)
-		goto unlock;
+		return ret;
 
 	ret = vadc_write(vadc, VADC_CONV_REQ, VADC_CONV_REQ_SET);
 	if (ret)
@@ -407,8 +411,18 @@ static int vadc_do_conversion(struct vadc_priv *vadc,
 	vadc_set_state(vadc, false);
 	if (ret)
 		dev_err(vadc->dev, "conversion failed\n");
-unlock:
+	return ret;
+}
+
+static int vadc_do_conversion(struct vadc_priv *vadc,
+			      struct vadc_channel_prop *prop, u16 *data)
+{
+	int ret;
+
+	mutex_lock(&vadc->lock);
+	ret = __vadc_do_conversion(vadc, prop, data);
 	mutex_unlock(&vadc->lock);
+
 	return ret;
 }
 
@@ -578,6 +592,50 @@ static int vadc_read_raw(struct iio_dev *indio_dev,
 	return ret;
 }
 
+/*
+ * The VADC has no sequencer, so a buffered scan converts the enabled
+ * channels back to back under one hold of the lock and pushes them as a
+ * single sample. Each value is what a direct read of the channel returns.
+ * Direct reads stay available while the buffer runs, since the thermal
+ * and charger clients still poll individual channels.
+ */
+static irqreturn_t vadc_trigger_handler(int irq, void *p)
+{
+	struct iio_poll_func *pf = p;
+	struct iio_dev *indio_dev = pf->indio_dev;
+	struct vadc_priv *vadc = iio_priv(indio_dev);
+	const struct iio_chan_spec *chan;
+	struct vadc_channel_prop *prop;
+	unsigned int bit, i = 0;
+	u16 adc_code;
+	int ret = 0;
+
+	mutex_lock(&vadc->lock);
+	for_each_set_bit(bit, indio_dev->active_scan_mask,
+			 indio_dev->masklength) {
+		chan = &vadc->iio_chans[bit];
+		prop = &vadc->chan_props[chan->address];
+		ret = __vadc_do_conversion(vadc, prop, &adc_code);
+		if (ret)
+			break;
+
+		vadc->scan_buf[i] = vadc_calibrate(vadc, prop, adc_code);
+		if (chan->info_mask_separate & BIT(IIO_CHAN_INFO_PROCESSED))
+			vadc->scan_buf[i] = vadc->scan_buf[i] / 2 -
+					    KELVINMIL_CELSIUSMIL;
+		i++;
+	}
+	mutex_unlock(&vadc->lock);
+
+	if (!ret)
+		iio_push_to_buffers_with_timestamp(indio_dev, vadc->scan_buf,
+						   iio_get_time_ns(indio_dev));
+
+	iio_trigger_notify_done(indio_dev->trig);
+
+	return IRQ_HANDLED;
+}
+
 static int vadc_of_xlate(struct iio_dev *indio_dev,
 			 const struct of_phandle_args *iiospec)
 {
@@ -825,7 +883,8 @@ static int vadc_get_dt_data(struct vadc_priv *vadc, struct device_node *node)
 	if (!vadc->nchannels)
 		return -EINVAL;
 
-	vadc->iio_chans = devm_kcalloc(vadc->dev, vadc->nchannels,
+	/* One more for the timestamp of buffered scans */
+	vadc->iio_chans = devm_kcalloc(vadc->dev, vadc->nchannels + 1,
 				       sizeof(*vadc->iio_chans), GFP_KERNEL);
 	if (!vadc->iio_chans)
 		return -ENOMEM;
@@ -853,11 +912,29 @@ static int vadc_get_dt_data(struct vadc_priv *vadc, struct device_node *node)
 		iio_chan->info_mask_separate = vadc_chan->info_mask;
 		iio_chan->type = vadc_chan->type;
 		iio_chan->indexed = 1;
+		iio_chan->scan_index = index;
+		iio_chan->scan_type.sign = 's';
+		iio_chan->scan_type.realbits = 32;
+		iio_chan->scan_type.storagebits = 32;
+		iio_chan->scan_type.endianness = IIO_CPU;
 		iio_chan->address = index++;
 
 		iio_chan++;
 	}
 
+	iio_chan->type = IIO_TIMESTAMP;
+	iio_chan->channel = -1;
+	iio_chan->scan_index = index;
+	iio_chan->scan_type.sign = 's';
+	iio_chan->scan_type.realbits = 64;
+	iio_chan->scan_type.storagebits = 64;
+
+	vadc->scan_buf = devm_kzalloc(vadc->dev,
+				ALIGN(vadc->nchannels * sizeof(s32),
+				      sizeof(s64)) + sizeof(s64), GFP_KERNEL);
+	if (!vadc->scan_buf)
+		return -ENOMEM;
+
 	/* These channels are mandatory, they are used as reference points */
 	if (!vadc_get_channel(vadc, VADC_REF_1250MV)) {
 		dev_err(vadc->dev, "Please define 1.25V channel\n");
@@ -992,7 +1069,12 @@ static int vadc_probe(struct platform_device *pdev)
 	indio_dev->modes = INDIO_DIRECT_MODE;
 	indio_dev->info = &vadc_info;
 	indio_dev->channels = vadc->iio_chans;
-	indio_dev->num_channels = vadc->nchannels;
+	indio_dev->num_channels = vadc->nchannels + 1;
+
+	ret = devm_iio_triggered_buffer_setup(dev, indio_dev, NULL,
+					      vadc_trigger_handler, NULL);
+	if (ret)
+		return ret;
 
 	return devm_iio_device_register(dev, indio_dev);
 }
@@ -668,6 +668,7 @@ static int fts_read_touchdata(struct fts_ts_data *data)
 	memset(event, 0, sizeof(struct ts_event));
 
 	buf[0] = 0x00;
+	touch_latency_bus_start(&data->latency);
 	ret = fts_i2c_read(data->client, buf, 1, buf, (3 + FTS_ONE_TCH_LEN));
 	if (ret < 0) {
 		FTS_ERROR("%s read touchdata failed.", __func__);
@@ -683,8 +684,11 @@ static int fts_read_touchdata(struct fts_ts_data *data)
 		fts_i2c_read(data->client, buf+9, 1, buf+9,
 				(event->point_num - 1) * FTS_ONE_TCH_LEN);
 	}
+	touch_latency_bus_done(&data->latency);
 #else
+	touch_latency_bus_start(&data->latency);
 	ret = fts_i2c_read(data->client, buf, 1, buf, POINT_READ_BUF);
+	touch_latency_bus_done(&data->latency);
 	if (ret < 0) {
 		FTS_ERROR("[B]Read touchdata failed, ret: %d", ret);
 		return ret;
@@ -778,6 +782,22 @@ static void fts_report_value(struct fts_ts_data *data)
 
 }
 
+/*****************************************************************************
+ *  Name: fts_ts_hardirq
+ *  Brief: Stamp the interrupt for the latency statistics
+ *  Input:
+ *  Output:
+ *  Return:
+ *****************************************************************************/
+static irqreturn_t fts_ts_hardirq(int irq, void *dev_id)
+{
+	struct fts_ts_data *fts_ts = dev_id;
+
+	touch_latency_irq(&fts_ts->latency);
+
+	return IRQ_WAKE_THREAD;
+}
+
 /*****************************************************************************
  *  Name: fts_ts_interrupt
  *  Brief:
@@ -804,6 +824,7 @@ static irqreturn_t fts_ts_interrupt(int irq, void *dev_id)
 	if (ret == 0) {
 		mutex_lock(&fts_wq_data->report_mutex);
 		fts_report_value(fts_wq_data);
+		touch_latency_report(&fts_wq_data->latency);
 		mutex_unlock(&fts_wq_data->report_mutex);
 	}
 
@@ -1148,12 +1169,15 @@ static int fts_ts_probe(struct i2c_client *client,
 	fts_reset_proc(200);
 	fts_wait_tp_to_valid(client);
 
-	err = request_threaded_irq(client->irq, NULL, fts_ts_interrupt,
+	touch_latency_init(&data->latency, FTS_DRIVER_NAME);
+	err = request_threaded_irq(client->irq, fts_ts_hardirq,
+				fts_ts_interrupt,
 				pdata->irq_gpio_flags | IRQF_ONESHOT |
 				IRQF_TRIGGER_FALLING,
 				client->dev.driver->name, data);
 	if (err) {
 		FTS_ERROR("Request irq failed!");
+		touch_latency_release(&data->latency);
 		goto free_gpio;
 	}
 
@@ -1267,6 +1291,7 @@ static int fts_ts_remove(struct i2c_client *client)
 	unregister_early_suspend(&data->early_suspend);
 #endif
 	free_irq(client->irq, data);
+	touch_latency_release(&data->latency);
 
 	if (gpio_is_valid(data->pdata->reset_gpio))
 		gpio_free(data->pdata->reset_gpio);
@@ -36,6 +36,7 @@
 #include <linux/i2c.h>
 #include <linux/input.h>
 #include <linux/input/mt.h>
+#include <linux/input/touch_latency.h>
 #include <linux/slab.h>
 #include <linux/interrupt.h>
 #include <linux/delay.h>
@@ -160,6 +161,7 @@ struct fts_ts_data {
 	u8 fw_vendor_id;
 	int touchs;
 	int irq_disable;
+	struct touch_latency latency;
 
 #if defined(CONFIG_FB)
 	struct notifier_block fb_notif;
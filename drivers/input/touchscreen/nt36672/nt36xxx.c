@@ -26,6 +26,7 @@
 #include <linux/uaccess.h>
 #include <linux/input/mt.h>
 #include <linux/pm_wakeup.h>
+#include <linux/pm_qos.h>
 
 #include <linux/of_gpio.h>
 #include <linux/of_irq.h>
@@ -960,8 +961,30 @@ static void nvt_esd_check_func(struct work_struct *work)
 }
 #endif
 
+/*
+ * Keep the i2c master out of deep low power states while a finger is down
+ * so that every frame of a gesture gets the same short transfer time.
+ * Must be called with ts->lock held.
+ */
+static void nvt_ts_bus_qos(bool active)
+{
+	if (!active && ts->bus_qos_req.dev) {
+		dev_pm_qos_remove_request(&ts->bus_qos_req);
+		ts->bus_qos_req.dev = NULL;
+	} else if (active && !ts->bus_qos_req.dev) {
+		dev_pm_qos_add_ancestor_request(&ts->client->dev,
+						&ts->bus_qos_req,
+						DEV_PM_QOS_RESUME_LATENCY,
+						NVT_TOUCH_BUS_QOS_US);
+	}
+}
+
+/*
+ * The frame has no finger count up front and the force MSBs of the first
+ * two fingers sit at its tail, so it is always read in one transfer.
+ */
 #define POINT_DATA_LEN 65
-static void nvt_ts_work_func(struct work_struct *work)
+static void nvt_ts_report(void)
 {
 	int32_t ret = -1;
 	uint8_t point_data[POINT_DATA_LEN + 1] = {0};
@@ -980,7 +1003,9 @@ static void nvt_ts_work_func(struct work_struct *work)
 	mutex_lock(&ts->lock);
 
 
+	touch_latency_bus_start(&ts->latency);
 	ret = CTP_I2C_READ(ts->client, I2C_FW_Address, point_data, POINT_DATA_LEN + 1);
+	touch_latency_bus_done(&ts->latency);
 	if (ret < 0) {
 		NVT_ERR("CTP_I2C_READ failed.(%d)\n", ret);
 		goto XFER_ERROR;
@@ -997,7 +1022,6 @@ static void nvt_ts_work_func(struct work_struct *work)
 	if (bTouchIsAwake == 0) {
 		input_id = (uint8_t)(point_data[1] >> 3);
 		nvt_ts_wakeup_gesture_report(input_id);
-		enable_irq(ts->client->irq);
 		mutex_unlock(&ts->lock);
 		return;
 	}
@@ -1088,17 +1112,35 @@ static void nvt_ts_work_func(struct work_struct *work)
 #endif
 
 	input_sync(ts->input_dev);
+	touch_latency_report(&ts->latency);
+	nvt_ts_bus_qos(finger_cnt > 0);
 
 XFER_ERROR:
+	mutex_unlock(&ts->lock);
+}
+
+static void nvt_ts_work_func(struct work_struct *work)
+{
+	nvt_ts_report();
 	enable_irq(ts->client->irq);
+}
 
-	mutex_unlock(&ts->lock);
+#if NVT_TOUCH_THREADED_IRQ
+/*
+ * Threaded irq handlers run SCHED_FIFO and IRQF_ONESHOT keeps the line
+ * masked until the frame is read, so no workqueue hop is needed.
+ */
+static irqreturn_t nvt_ts_irq_thread(int32_t irq, void *dev_id)
+{
+	nvt_ts_report();
+
+	return IRQ_HANDLED;
 }
+#endif
 
 static irqreturn_t nvt_ts_irq_handler(int32_t irq, void *dev_id)
 {
-	disable_irq_nosync(ts->client->irq);
-
+	touch_latency_irq(&ts->latency);
 
 #if WAKEUP_GESTURE
 	if (bTouchIsAwake == 0) {
@@ -1106,9 +1148,14 @@ static irqreturn_t nvt_ts_irq_handler(int32_t irq, void *dev_id)
 	}
 #endif
 
+#if NVT_TOUCH_THREADED_IRQ
+	return IRQ_WAKE_THREAD;
+#else
+	disable_irq_nosync(ts->client->irq);
 	queue_work(nvt_wq, &ts->nvt_work);
 
 	return IRQ_HANDLED;
+#endif
 }
 
 static int8_t nvt_ts_check_chip_ver_trim(void)
@@ -1313,12 +1360,17 @@ static int32_t nvt_ts_probe(struct i2c_client *client, const struct i2c_device_i
 		goto err_input_register_device_failed;
 	}
 
+	touch_latency_init(&ts->latency, NVT_I2C_NAME);
 
 	client->irq = gpio_to_irq(ts->irq_gpio);
 	if (client->irq) {
 		NVT_LOG("int_trigger_type=%d\n", ts->int_trigger_type);
 
-#if WAKEUP_GESTURE
+#if NVT_TOUCH_THREADED_IRQ && WAKEUP_GESTURE
+		ret = request_threaded_irq(client->irq, nvt_ts_irq_handler, nvt_ts_irq_thread, ts->int_trigger_type | IRQF_ONESHOT | IRQF_NO_SUSPEND, client->name, ts);
+#elif NVT_TOUCH_THREADED_IRQ
+		ret = request_threaded_irq(client->irq, nvt_ts_irq_handler, nvt_ts_irq_thread, ts->int_trigger_type | IRQF_ONESHOT, client->name, ts);
+#elif WAKEUP_GESTURE
 		ret = request_irq(client->irq, nvt_ts_irq_handler, ts->int_trigger_type | IRQF_NO_SUSPEND, client->name, ts);
 #else
 		ret = request_irq(client->irq, nvt_ts_irq_handler, ts->int_trigger_type, client->name, ts);
@@ -1422,6 +1474,7 @@ static int32_t nvt_ts_probe(struct i2c_client *client, const struct i2c_device_i
 err_create_nvt_fwu_wq_failed:
 #endif
 err_int_request_failed:
+	touch_latency_release(&ts->latency);
 err_input_register_device_failed:
 	input_free_device(ts->input_dev);
 err_input_dev_alloc_failed:
@@ -1453,11 +1506,15 @@ static int32_t nvt_ts_remove(struct i2c_client *client)
 	unregister_early_suspend(&ts->early_suspend);
 #endif
 
-	mutex_destroy(&ts->lock);
-
 	NVT_LOG("Removing driver...\n");
 
 	free_irq(client->irq, ts);
+	touch_latency_release(&ts->latency);
+	mutex_lock(&ts->lock);
+	nvt_ts_bus_qos(false);
+	mutex_unlock(&ts->lock);
+	mutex_destroy(&ts->lock);
+
 	input_unregister_device(ts->input_dev);
 	i2c_set_clientdata(client, NULL);
 	kfree(ts);
@@ -1482,6 +1539,7 @@ static int32_t nvt_ts_suspend(struct device *dev)
 	NVT_LOG("start\n");
 
 	bTouchIsAwake = 0;
+	nvt_ts_bus_qos(false);
 
 #if NVT_TOUCH_ESD_PROTECT
 	cancel_delayed_work_sync(&nvt_esd_check_work);
@@ -1657,6 +1715,7 @@ static struct i2c_driver nvt_i2c_driver = {
 	.driver = {
 		.name	= NVT_I2C_NAME,
 		.owner	= THIS_MODULE,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 #if 0
 #ifdef CONFIG_PM
 		.pm = &nvt_ts_dev_pm_ops,
@@ -21,6 +21,7 @@
 
 #include <linux/i2c.h>
 #include <linux/input.h>
+#include <linux/input/touch_latency.h>
 #include <linux/uaccess.h>
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
@@ -77,6 +78,11 @@ extern bool NVT_gesture_func_on;
 #define NVT_TOUCH_ESD_PROTECT 1
 #define NVT_TOUCH_ESD_CHECK_PERIOD 1500
 
+/* report from a threaded irq instead of the nvt_wq work */
+#define NVT_TOUCH_THREADED_IRQ 1
+/* i2c master resume latency voted for while a finger is down, in us */
+#define NVT_TOUCH_BUS_QOS_US 100
+
 struct nvt_ts_mem_map {
 	uint32_t EVENT_BUF_ADDR;
 	uint32_t RAW_PIPE0_ADDR;
@@ -134,6 +140,8 @@ struct nvt_ts_data {
 	const struct nvt_ts_mem_map *mmap;
 	uint8_t carrier_system;
 	uint16_t nvt_pid;
+	struct dev_pm_qos_request bus_qos_req;
+	struct touch_latency latency;
 };
 
 #if NVT_TOUCH_PROC
@@ -0,0 +1,188 @@
+/*
+ * Touchscreen latency and report-rate statistics
+ *
+ * Copyright (c) 2018, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * Touch drivers stamp the interrupt, the frame read and the input_sync()
+ * of each report; the resulting histograms are exported per device in
+ * <debugfs>/touch_latency/<name>/stats. Writing to the file clears them.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/export.h>
+#include <linux/kernel.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+#include <linux/mutex.h>
+#include <linux/seq_file.h>
+#include <linux/string.h>
+#include <linux/input/touch_latency.h>
+
+/* Reports further apart than this belong to different strokes */
+#define TOUCH_LATENCY_IDLE_US	100000
+
+static struct dentry *touch_latency_root;
+static DEFINE_MUTEX(touch_latency_root_lock);
+
+static void touch_latency_add(struct touch_latency_hist *h, s64 us)
+{
+	u32 val = us < 0 ? 0 : min_t(s64, us, U32_MAX);
+	unsigned int idx = val < 2 ? 0 : ilog2(val);
+
+	h->bucket[min(idx, TOUCH_LATENCY_BUCKETS - 1)]++;
+	h->count++;
+	h->sum_us += val;
+	if (val > h->max_us)
+		h->max_us = val;
+}
+
+void touch_latency_bus_done(struct touch_latency *tl)
+{
+	ktime_t now = ktime_get();
+	unsigned long flags;
+
+	if (!ktime_to_ns(tl->bus_start))
+		return;
+
+	spin_lock_irqsave(&tl->lock, flags);
+	touch_latency_add(&tl->bus, ktime_us_delta(now, tl->bus_start));
+	spin_unlock_irqrestore(&tl->lock, flags);
+	tl->bus_start = ktime_set(0, 0);
+}
+EXPORT_SYMBOL(touch_latency_bus_done);
+
+/* Call right after input_sync() */
+void touch_latency_report(struct touch_latency *tl)
+{
+	ktime_t now = ktime_get();
+	unsigned long flags;
+	s64 gap;
+
+	spin_lock_irqsave(&tl->lock, flags);
+	if (ktime_to_ns(tl->irq_time)) {
+		touch_latency_add(&tl->irq_to_report,
+				  ktime_us_delta(now, tl->irq_time));
+		tl->irq_time = ktime_set(0, 0);
+	}
+	if (ktime_to_ns(tl->last_report)) {
+		gap = ktime_us_delta(now, tl->last_report);
+		if (gap < TOUCH_LATENCY_IDLE_US)
+			touch_latency_add(&tl->interval, gap);
+	}
+	tl->last_report = now;
+	spin_unlock_irqrestore(&tl->lock, flags);
+}
+EXPORT_SYMBOL(touch_latency_report);
+
+static void touch_latency_show_hist(struct seq_file *m, const char *name,
+				    const struct touch_latency_hist *h)
+{
+	int i;
+
+	seq_printf(m, "%s: samples %u avg_us %llu max_us %u\n", name,
+		   h->count, h->count ? div_u64(h->sum_us, h->count) : 0,
+		   h->max_us);
+	for (i = 0; i < TOUCH_LATENCY_BUCKETS; i++) {
+		if (!h->bucket[i])
+			continue;
+		if (i == TOUCH_LATENCY_BUCKETS - 1)
+			seq_printf(m, "  >=%6u us: %u\n", 1U << i,
+				   h->bucket[i]);
+		else
+			seq_printf(m, "  <%7u us: %u\n", 2U << i,
+				   h->bucket[i]);
+	}
+}
+
+static int touch_latency_show(struct seq_file *m, void *v)
+{
+	struct touch_latency *tl = m->private;
+	struct touch_latency_hist irq_to_report, interval, bus;
+	unsigned long flags;
+
+	spin_lock_irqsave(&tl->lock, flags);
+	irq_to_report = tl->irq_to_report;
+	interval = tl->interval;
+	bus = tl->bus;
+	spin_unlock_irqrestore(&tl->lock, flags);
+
+	touch_latency_show_hist(m, "irq_to_report", &irq_to_report);
+	touch_latency_show_hist(m, "report_interval", &interval);
+	touch_latency_show_hist(m, "bus_read", &bus);
+	if (interval.sum_us)
+		seq_printf(m, "report_rate_hz: %llu\n",
+			   div64_u64((u64)interval.count * USEC_PER_SEC,
+				     interval.sum_us));
+
+	return 0;
+}
+
+static int touch_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, touch_latency_show, inode->i_private);
+}
+
+static ssize_t touch_latency_write(struct file *file, const char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	struct touch_latency *tl =
+		((struct seq_file *)file->private_data)->private;
+	unsigned long flags;
+
+	spin_lock_irqsave(&tl->lock, flags);
+	memset(&tl->irq_to_report, 0, sizeof(tl->irq_to_report));
+	memset(&tl->interval, 0, sizeof(tl->interval));
+	memset(&tl->bus, 0, sizeof(tl->bus));
+	spin_unlock_irqrestore(&tl->lock, flags);
+
+	return count;
+}
+
+static const struct file_operations touch_latency_fops = {
+	.owner = THIS_MODULE,
+	.open = touch_latency_open,
+	.read = seq_read,
+	.write = touch_latency_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/**
+ * touch_latency_init - set up the statistics of one touch device
+ * @tl: state embedded in the driver data
+ * @name: debugfs directory name, unique per device
+ *
+ * Without debugfs the hooks keep working and the statistics are simply
+ * not exported.
+ */
+void touch_latency_init(struct touch_latency *tl, const char *name)
+{
+	memset(tl, 0, sizeof(*tl));
+	spin_lock_init(&tl->lock);
+
+	mutex_lock(&touch_latency_root_lock);
+	if (IS_ERR_OR_NULL(touch_latency_root))
+		touch_latency_root = debugfs_create_dir("touch_latency", NULL);
+	mutex_unlock(&touch_latency_root_lock);
+	if (IS_ERR_OR_NULL(touch_latency_root))
+		return;
+
+	tl->dir = debugfs_create_dir(name, touch_latency_root);
+	if (IS_ERR_OR_NULL(tl->dir)) {
+		tl->dir = NULL;
+		return;
+	}
+	debugfs_create_file("stats", 0644, tl->dir, tl, &touch_latency_fops);
+}
+EXPORT_SYMBOL(touch_latency_init);
+
+void touch_latency_release(struct touch_latency *tl)
+{
+	debugfs_remove_recursive(tl->dir);
+	tl->dir = NULL;
+}
+EXPORT_SYMBOL(touch_latency_release);
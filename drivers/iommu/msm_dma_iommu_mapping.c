@@ -0,0 +1,529 @@
+/* Copyright (c) 2015-2017, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/dma-buf.h>
+#include <linux/kernel.h>
+#include <linux/kref.h>
+#include <linux/list.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/rbtree.h>
+#include <linux/scatterlist.h>
+#include <linux/seq_file.h>
+#include <linux/shrinker.h>
+#include <linux/slab.h>
+
+#include <linux/msm_dma_iommu_mapping.h>
+
+/**
+ * struct msm_iommu_map - represents a mapping of a buffer for one device
+ * @lnode:	list node on the owning meta's list of mappings
+ * @dev:	device this buffer is mapped for
+ * @table:	copy of the mapped scatterlist, including the DMA addresses
+ * @nents:	number of entries passed in by the client
+ * @mapped:	number of entries dma_map_sg_attrs() returned
+ * @dir:	direction of the mapping
+ * @attrs:	attributes the buffer was mapped with
+ * @ref:	reference count, the cache holds one for lazy mappings
+ * @meta:	back pointer to the owning meta
+ */
+struct msm_iommu_map {
+	struct list_head lnode;
+	struct device *dev;
+	struct sg_table table;
+	int nents;
+	int mapped;
+	enum dma_data_direction dir;
+	unsigned long attrs;
+	struct kref ref;
+	struct msm_iommu_meta *meta;
+};
+
+/**
+ * struct msm_iommu_meta - all the mappings of a single buffer
+ * @node:	rb node on the global tree of metas, keyed by @buffer
+ * @iommu_maps:	list of mappings for this buffer
+ * @lock:	protects @iommu_maps
+ * @buffer:	the dma_buf private data (the ion_buffer) this belongs to
+ */
+struct msm_iommu_meta {
+	struct rb_node node;
+	struct list_head iommu_maps;
+	struct mutex lock;
+	void *buffer;
+};
+
+/**
+ * struct msm_iommu_map_stats - lazy mapping statistics
+ * @hits:	map calls satisfied from an existing mapping
+ * @misses:	map calls that had to create a new mapping
+ * @reclaimed:	idle mappings torn down by the shrinker
+ * @cached:	idle lazy mappings currently kept alive by the cache
+ */
+struct msm_iommu_map_stats {
+	atomic64_t hits;
+	atomic64_t misses;
+	atomic64_t reclaimed;
+	atomic_t cached;
+};
+
+static struct rb_root iommu_root;
+static DEFINE_MUTEX(msm_iommu_map_mutex);
+static struct msm_iommu_map_stats map_stats;
+
+static void msm_iommu_meta_add(struct msm_iommu_meta *meta)
+{
+	struct rb_root *root = &iommu_root;
+	struct rb_node **p = &root->rb_node;
+	struct rb_node *parent = NULL;
+	struct msm_iommu_meta *entry;
+
+	while (*p) {
+		parent = *p;
+		entry = rb_entry(parent, struct msm_iommu_meta, node);
+
+		if (meta->buffer < entry->buffer) {
+			p = &(*p)->rb_left;
+		} else if (meta->buffer > entry->buffer) {
+			p = &(*p)->rb_right;
+		} else {
+			pr_err("%s: dma_buf %p already exists\n", __func__,
+			       entry->buffer);
+			BUG();
+		}
+	}
+
+	rb_link_node(&meta->node, parent, p);
+	rb_insert_color(&meta->node, root);
+}
+
+static struct msm_iommu_meta *msm_iommu_meta_lookup(void *buffer)
+{
+	struct rb_root *root = &iommu_root;
+	struct rb_node **p = &root->rb_node;
+	struct rb_node *parent = NULL;
+	struct msm_iommu_meta *entry = NULL;
+
+	while (*p) {
+		parent = *p;
+		entry = rb_entry(parent, struct msm_iommu_meta, node);
+
+		if (buffer < entry->buffer)
+			p = &(*p)->rb_left;
+		else if (buffer > entry->buffer)
+			p = &(*p)->rb_right;
+		else
+			return entry;
+	}
+
+	return NULL;
+}
+
+static struct msm_iommu_meta *msm_iommu_meta_get(struct dma_buf *dma_buf)
+{
+	struct msm_iommu_meta *meta;
+
+	mutex_lock(&msm_iommu_map_mutex);
+	meta = msm_iommu_meta_lookup(dma_buf->priv);
+	if (!meta) {
+		meta = kzalloc(sizeof(*meta), GFP_KERNEL);
+		if (meta) {
+			INIT_LIST_HEAD(&meta->iommu_maps);
+			mutex_init(&meta->lock);
+			meta->buffer = dma_buf->priv;
+			msm_iommu_meta_add(meta);
+		}
+	}
+	mutex_unlock(&msm_iommu_map_mutex);
+
+	return meta;
+}
+
+static struct msm_iommu_map *msm_iommu_lookup(struct msm_iommu_meta *meta,
+					      struct device *dev)
+{
+	struct msm_iommu_map *entry;
+
+	list_for_each_entry(entry, &meta->iommu_maps, lnode) {
+		if (entry->dev == dev)
+			return entry;
+	}
+
+	return NULL;
+}
+
+static bool msm_iommu_map_is_lazy(struct msm_iommu_map *map)
+{
+	return !(map->attrs & DMA_ATTR_NO_DELAYED_UNMAP);
+}
+
+/* Called with the meta lock held */
+static void msm_iommu_map_release(struct kref *kref)
+{
+	struct msm_iommu_map *map = container_of(kref, struct msm_iommu_map,
+						 ref);
+
+	list_del(&map->lnode);
+	dma_unmap_sg(map->dev, map->table.sgl, map->nents, map->dir);
+	sg_free_table(&map->table);
+	kfree(map);
+}
+
+/*
+ * Drop a reference to a mapping. A lazy mapping going back to only being
+ * referenced by the cache is counted as idle, which is what the shrinker
+ * reclaims. Called with the meta lock held.
+ */
+static void msm_iommu_map_put(struct msm_iommu_map *map)
+{
+	if (kref_put(&map->ref, msm_iommu_map_release))
+		return;
+
+	if (msm_iommu_map_is_lazy(map) &&
+	    atomic_read(&map->ref.refcount) == 1)
+		atomic_inc(&map_stats.cached);
+}
+
+static void msm_iommu_map_get(struct msm_iommu_map *map)
+{
+	if (msm_iommu_map_is_lazy(map) &&
+	    atomic_read(&map->ref.refcount) == 1)
+		atomic_dec(&map_stats.cached);
+
+	kref_get(&map->ref);
+}
+
+static struct msm_iommu_map *msm_iommu_map_create(struct device *dev,
+		struct scatterlist *sg, int nents,
+		enum dma_data_direction dir, unsigned long attrs)
+{
+	struct msm_iommu_map *map;
+	struct scatterlist *s, *d;
+	int ret, i;
+
+	map = kzalloc(sizeof(*map), GFP_KERNEL);
+	if (!map)
+		return ERR_PTR(-ENOMEM);
+
+	if (sg_alloc_table(&map->table, nents, GFP_KERNEL)) {
+		kfree(map);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	ret = dma_map_sg_attrs(dev, sg, nents, dir, attrs);
+	if (ret != nents) {
+		dev_err(dev, "Mapping failed with rc(%d), expected rc(%d)\n",
+			ret, nents);
+		if (ret > 0)
+			dma_unmap_sg(dev, sg, nents, dir);
+		sg_free_table(&map->table);
+		kfree(map);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	/*
+	 * Keep our own copy of the mapped scatterlist. The one the client
+	 * passed in usually comes from dma_buf_map_attachment() and goes away
+	 * on dma_buf_unmap_attachment(), long before the lazy unmap.
+	 */
+	d = map->table.sgl;
+	for_each_sg(sg, s, nents, i) {
+		sg_set_page(d, sg_page(s), s->length, s->offset);
+		d->dma_address = s->dma_address;
+		sg_dma_len(d) = sg_dma_len(s);
+		d = sg_next(d);
+	}
+
+	map->dev = dev;
+	map->nents = nents;
+	map->mapped = ret;
+	map->dir = dir;
+	map->attrs = attrs;
+	kref_init(&map->ref);
+
+	/* The cache holds a reference on lazy mappings */
+	if (msm_iommu_map_is_lazy(map))
+		kref_get(&map->ref);
+
+	return map;
+}
+
+/* Hand the cached DMA addresses back to the client's scatterlist */
+static void msm_iommu_map_copy(struct msm_iommu_map *map,
+			       struct scatterlist *sg)
+{
+	struct scatterlist *s, *d = sg;
+	int i;
+
+	for_each_sg(map->table.sgl, s, map->nents, i) {
+		d->dma_address = s->dma_address;
+		sg_dma_len(d) = sg_dma_len(s);
+		d = sg_next(d);
+	}
+}
+
+int msm_dma_map_sg_attrs(struct device *dev, struct scatterlist *sg, int nents,
+		   enum dma_data_direction dir, struct dma_buf *dma_buf,
+		   unsigned long attrs)
+{
+	struct msm_iommu_meta *meta;
+	struct msm_iommu_map *map;
+	int ret;
+
+	if (IS_ERR_OR_NULL(dev)) {
+		pr_err("%s: dev pointer is invalid\n", __func__);
+		return -EINVAL;
+	}
+
+	if (IS_ERR_OR_NULL(sg)) {
+		pr_err("%s: sg table pointer is invalid\n", __func__);
+		return -EINVAL;
+	}
+
+	if (IS_ERR_OR_NULL(dma_buf)) {
+		pr_err("%s: dma_buf pointer is invalid\n", __func__);
+		return -EINVAL;
+	}
+
+	meta = msm_iommu_meta_get(dma_buf);
+	if (!meta)
+		return -ENOMEM;
+
+	mutex_lock(&meta->lock);
+	map = msm_iommu_lookup(meta, dev);
+	if (!map) {
+		map = msm_iommu_map_create(dev, sg, nents, dir, attrs);
+		if (IS_ERR(map)) {
+			ret = PTR_ERR(map);
+			goto out;
+		}
+		map->meta = meta;
+		list_add(&map->lnode, &meta->iommu_maps);
+		atomic64_inc(&map_stats.misses);
+		ret = nents;
+	} else if (nents == map->nents && dir == map->dir) {
+		/*
+		 * CPU cache maintenance for lazily mapped buffers is left to
+		 * the ION cache ops, as it was when the buffer was first
+		 * mapped with the mapping kept alive across unmaps.
+		 */
+		msm_iommu_map_get(map);
+		msm_iommu_map_copy(map, sg);
+		atomic64_inc(&map_stats.hits);
+		ret = nents;
+	} else {
+		dev_err(dev, "lazy iommu proxy mapping of a different part of the buffer or direction is not supported: %d/%d %d/%d\n",
+			nents, map->nents, dir, map->dir);
+		ret = -EINVAL;
+	}
+out:
+	mutex_unlock(&meta->lock);
+	return ret;
+}
+EXPORT_SYMBOL(msm_dma_map_sg_attrs);
+
+void msm_dma_unmap_sg(struct device *dev, struct scatterlist *sgl, int nents,
+		      enum dma_data_direction dir, struct dma_buf *dma_buf)
+{
+	struct msm_iommu_meta *meta;
+	struct msm_iommu_map *map;
+
+	mutex_lock(&msm_iommu_map_mutex);
+	meta = msm_iommu_meta_lookup(dma_buf->priv);
+	mutex_unlock(&msm_iommu_map_mutex);
+	if (!meta) {
+		WARN(1, "%s: (%p) was never mapped\n", __func__,
+		     dma_buf->priv);
+		return;
+	}
+
+	mutex_lock(&meta->lock);
+	map = msm_iommu_lookup(meta, dev);
+	if (!map) {
+		WARN(1, "%s: (%p) was never mapped for device %p\n", __func__,
+		     dma_buf->priv, dev);
+		goto out;
+	}
+
+	if (dir != map->dir)
+		WARN(1, "%s: (%p) dir:%d differs from original dir:%d\n",
+		     __func__, dma_buf->priv, dir, map->dir);
+
+	msm_iommu_map_put(map);
+out:
+	mutex_unlock(&meta->lock);
+}
+EXPORT_SYMBOL(msm_dma_unmap_sg);
+
+int msm_dma_unmap_all_for_dev(struct device *dev)
+{
+	struct msm_iommu_map *map, *map_next;
+	struct rb_node *node;
+	int ret = 0;
+
+	mutex_lock(&msm_iommu_map_mutex);
+	for (node = rb_first(&iommu_root); node; node = rb_next(node)) {
+		struct msm_iommu_meta *meta = rb_entry(node,
+					struct msm_iommu_meta, node);
+
+		mutex_lock(&meta->lock);
+		list_for_each_entry_safe(map, map_next, &meta->iommu_maps,
+					 lnode) {
+			if (map->dev != dev)
+				continue;
+
+			if (!msm_iommu_map_is_lazy(map) ||
+			    atomic_read(&map->ref.refcount) != 1) {
+				ret = -EINVAL;
+				continue;
+			}
+
+			atomic_dec(&map_stats.cached);
+			kref_put(&map->ref, msm_iommu_map_release);
+		}
+		mutex_unlock(&meta->lock);
+	}
+	mutex_unlock(&msm_iommu_map_mutex);
+
+	return ret;
+}
+EXPORT_SYMBOL(msm_dma_unmap_all_for_dev);
+
+/*
+ * Only to be called by ION code when a buffer is freed
+ */
+void msm_dma_buf_freed(void *buffer)
+{
+	struct msm_iommu_map *map, *map_next;
+	struct msm_iommu_meta *meta;
+
+	mutex_lock(&msm_iommu_map_mutex);
+	meta = msm_iommu_meta_lookup(buffer);
+	if (!meta) {
+		/* Already unmapped (assuming no mapping has been done since) */
+		mutex_unlock(&msm_iommu_map_mutex);
+		return;
+	}
+	rb_erase(&meta->node, &iommu_root);
+	mutex_unlock(&msm_iommu_map_mutex);
+
+	mutex_lock(&meta->lock);
+	list_for_each_entry_safe(map, map_next, &meta->iommu_maps, lnode) {
+		if (atomic_read(&map->ref.refcount) != 1)
+			pr_err("%s: Refcount for %p is %d, should be 1\n",
+			       __func__, map->dev,
+			       atomic_read(&map->ref.refcount));
+		else if (msm_iommu_map_is_lazy(map))
+			atomic_dec(&map_stats.cached);
+		list_del_init(&map->lnode);
+		dma_unmap_sg(map->dev, map->table.sgl, map->nents, map->dir);
+		sg_free_table(&map->table);
+		kfree(map);
+	}
+	mutex_unlock(&meta->lock);
+
+	kfree(meta);
+}
+EXPORT_SYMBOL(msm_dma_buf_freed);
+
+static unsigned long msm_iommu_map_shrink_count(struct shrinker *shrinker,
+						struct shrink_control *sc)
+{
+	return max(atomic_read(&map_stats.cached), 0);
+}
+
+/*
+ * Under memory pressure tear down lazy mappings nobody but the cache is
+ * using anymore, giving the IOMMU page table memory back. The next map of
+ * the buffer for that device simply creates the mapping again.
+ */
+static unsigned long msm_iommu_map_shrink_scan(struct shrinker *shrinker,
+					       struct shrink_control *sc)
+{
+	struct msm_iommu_map *map, *map_next;
+	unsigned long freed = 0;
+	struct rb_node *node;
+
+	/* Mapping allocates memory with both of these locks held */
+	if (!mutex_trylock(&msm_iommu_map_mutex))
+		return SHRINK_STOP;
+
+	for (node = rb_first(&iommu_root); node && freed < sc->nr_to_scan;
+	     node = rb_next(node)) {
+		struct msm_iommu_meta *meta = rb_entry(node,
+					struct msm_iommu_meta, node);
+
+		if (!mutex_trylock(&meta->lock))
+			continue;
+
+		list_for_each_entry_safe(map, map_next, &meta->iommu_maps,
+					 lnode) {
+			if (!msm_iommu_map_is_lazy(map) ||
+			    atomic_read(&map->ref.refcount) != 1)
+				continue;
+
+			atomic_dec(&map_stats.cached);
+			kref_put(&map->ref, msm_iommu_map_release);
+			freed++;
+		}
+		mutex_unlock(&meta->lock);
+	}
+	mutex_unlock(&msm_iommu_map_mutex);
+
+	atomic64_add(freed, &map_stats.reclaimed);
+	return freed;
+}
+
+static struct shrinker msm_iommu_map_shrinker = {
+	.count_objects = msm_iommu_map_shrink_count,
+	.scan_objects = msm_iommu_map_shrink_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
+static int msm_iommu_map_stats_show(struct seq_file *s, void *unused)
+{
+	u64 hits = atomic64_read(&map_stats.hits);
+	u64 misses = atomic64_read(&map_stats.misses);
+	u64 total = hits + misses;
+
+	seq_printf(s, "hits: %llu\n", hits);
+	seq_printf(s, "misses: %llu\n", misses);
+	seq_printf(s, "hit rate: %llu%%\n",
+		   total ? div64_u64(hits * 100, total) : 0);
+	seq_printf(s, "cached idle: %d\n", atomic_read(&map_stats.cached));
+	seq_printf(s, "reclaimed: %llu\n",
+		   atomic64_read(&map_stats.reclaimed));
+	return 0;
+}
+
+static int msm_iommu_map_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_iommu_map_stats_show, inode->i_private);
+}
+
+static const struct file_operations msm_iommu_map_stats_fops = {
+	.open = msm_iommu_map_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init msm_dma_iommu_mapping_init(void)
+{
+	register_shrinker(&msm_iommu_map_shrinker);
+	debugfs_create_file("msm_dma_iommu_mapping", 0444, NULL, NULL,
+			    &msm_iommu_map_stats_fops);
+	return 0;
+}
+late_initcall(msm_dma_iommu_mapping_init);
@@ -40,6 +40,8 @@
 #include <linux/jiffies.h>       /* Jiffies counter */
 #include <linux/qcom_tspp.h>
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
 #include <linux/of.h>
 #include <linux/of_gpio.h>
 #include <linux/string.h>
@@ -403,6 +405,13 @@ struct tspp_mem_buffer {
 	int read_index;         /* where to start reading data from */
 };
 
+/* per channel data statistics, viewable using debugfs */
+struct tspp_channel_stats {
+	u32 descriptors;        /* completed descriptors */
+	u64 bytes;              /* bytes received in completed descriptors */
+	u32 notifications;      /* notifier calls and wakeups */
+};
+
 /* this represents each char device 'channel' */
 struct tspp_channel {
 	struct tspp_device *pdev; /* can use container_of instead? */
@@ -431,6 +440,7 @@ struct tspp_channel {
 	struct dma_pool *dma_pool;
 	tspp_memfree *memfree;   /* user defined memory free function */
 	void *user_info; /* user cookie passed to memory alloc/free function */
+	struct tspp_channel_stats stats;
 };
 
 struct tspp_pid_filter_table {
@@ -498,6 +508,11 @@ struct tspp_device {
 
 	struct dentry *dent;
 	struct dentry *debugfs_regs[ARRAY_SIZE(debugfs_tspp_regs)];
+	/* statistics since stat_start, viewable using debugfs */
+	ktime_t stat_start;
+	u32 stat_irq;           /* BAM descriptor interrupts */
+	u32 stat_tlet;          /* tasklet runs */
+	u64 stat_tlet_ns;       /* time spent in the tasklet */
 };
 
 static int tspp_key_entry;
@@ -595,6 +610,7 @@ static void tspp_sps_complete_cb(struct sps_event_notify *notify)
 		return;
 
 	pdev = notify->user;
+	pdev->stat_irq++;
 	tasklet_schedule(&pdev->tlet);
 }
 
@@ -615,6 +631,7 @@ static void tspp_sps_complete_tlet(unsigned long data)
 	struct sps_iovec iovec;
 	struct tspp_channel *channel;
 	struct tspp_device *device = (struct tspp_device *)data;
+	ktime_t start = ktime_get();
 
 	spin_lock_irqsave(&device->spinlock, flags);
 
@@ -648,6 +665,8 @@ static void tspp_sps_complete_tlet(unsigned long data)
 			channel->waiting->state = TSPP_BUF_STATE_DATA;
 			channel->waiting->filled = iovec.size;
 			channel->waiting->read_index = 0;
+			channel->stats.descriptors++;
+			channel->stats.bytes += iovec.size;
 
 			if (channel->src == TSPP_SOURCE_TSIF0)
 				device->tsif[0].stat_rx++;
@@ -660,6 +679,7 @@ static void tspp_sps_complete_tlet(unsigned long data)
 
 		/* wake any waiting processes */
 		if (complete) {
+			channel->stats.notifications++;
 			wake_up_interruptible(&channel->in_queue);
 
 			/* call notifiers */
@@ -676,6 +696,8 @@ static void tspp_sps_complete_tlet(unsigned long data)
 					channel->expiration_period_ms));
 	}
 
+	device->stat_tlet++;
+	device->stat_tlet_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
 	spin_unlock_irqrestore(&device->spinlock, flags);
 }
 
@@ -1339,6 +1361,26 @@ static u32 tspp_align_buffer_size_by_mode(u32 size, enum tspp_mode mode)
 	return new_size;
 }
 
+/**
+ * tspp_get_bulk_buffer_size - largest buffer size for a channel mode.
+ *
+ * @mode: channel mode the buffers are used with
+ *
+ * Return  the largest buffer size tspp_allocate_buffers() accepts that is
+ * a whole number of packets in @mode.
+ *
+ * Full-mux reception with buffers of this size needs about 170 times
+ * fewer descriptors, and so completions to process, than one packet per
+ * buffer.
+ */
+u32 tspp_get_bulk_buffer_size(enum tspp_mode mode)
+{
+	u32 alignment = tspp_align_buffer_size_by_mode(1, mode);
+
+	return (TSPP_MAX_BUFFER_SIZE / alignment) * alignment;
+}
+EXPORT_SYMBOL(tspp_get_bulk_buffer_size);
+
 static void tspp_destroy_buffers(u32 channel_id, struct tspp_channel *channel)
 {
 	int i;
@@ -2871,6 +2913,85 @@ static void tsif_debugfs_exit(struct tspp_tsif_device *tsif_device)
 		tsif_device->debugfs_tsif_regs[i] = NULL;
 }
 
+static int tspp_stats_show(struct seq_file *s, void *unused)
+{
+	struct tspp_device *device = s->private;
+	struct tspp_channel *channel;
+	u64 elapsed_ms, bytes = 0, tlet_ns;
+	u32 irq, tlet;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&device->spinlock, flags);
+	elapsed_ms = max_t(s64, ktime_ms_delta(ktime_get(),
+				device->stat_start), 1);
+	irq = device->stat_irq;
+	tlet = device->stat_tlet;
+	tlet_ns = device->stat_tlet_ns;
+	for (i = 0; i < TSPP_NUM_CHANNELS; i++)
+		bytes += device->channels[i].stats.bytes;
+	spin_unlock_irqrestore(&device->spinlock, flags);
+
+	seq_printf(s, "elapsed: %llu ms\n", elapsed_ms);
+	seq_printf(s, "irqs: %u (%llu/s)\n", irq,
+		div64_u64((u64)irq * 1000, elapsed_ms));
+	seq_printf(s, "tasklet runs: %u, %llu us\n", tlet,
+		div64_u64(tlet_ns, NSEC_PER_USEC));
+	seq_printf(s, "rate: %llu kbps\n",
+		div64_u64(bytes * 8, elapsed_ms));
+	/* 1 Mbit is 125000 bytes */
+	seq_printf(s, "tasklet cost: %llu ns per Mbit\n",
+		bytes ? div64_u64(tlet_ns * 125000, bytes) : 0);
+
+	for (i = 0; i < TSPP_NUM_CHANNELS; i++) {
+		channel = &device->channels[i];
+		if (!channel->used)
+			continue;
+		seq_printf(s,
+			"channel %d: buffer %u, int_freq %u, descriptors %u, bytes %llu, notifications %u\n",
+			i, channel->buffer_size, channel->int_freq,
+			channel->stats.descriptors, channel->stats.bytes,
+			channel->stats.notifications);
+	}
+
+	return 0;
+}
+
+static int tspp_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tspp_stats_show, inode->i_private);
+}
+
+/* Any write restarts the statistics */
+static ssize_t tspp_stats_write(struct file *file, const char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct tspp_device *device = s->private;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&device->spinlock, flags);
+	device->stat_start = ktime_get();
+	device->stat_irq = 0;
+	device->stat_tlet = 0;
+	device->stat_tlet_ns = 0;
+	for (i = 0; i < TSPP_NUM_CHANNELS; i++)
+		memset(&device->channels[i].stats, 0,
+			sizeof(device->channels[i].stats));
+	spin_unlock_irqrestore(&device->spinlock, flags);
+
+	return count;
+}
+
+static const struct file_operations fops_tspp_stats = {
+	.open = tspp_stats_open,
+	.read = seq_read,
+	.write = tspp_stats_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static void tspp_debugfs_init(struct tspp_device *device, int instance)
 {
 	char name[10];
@@ -2890,6 +3011,10 @@ static void tspp_debugfs_init(struct tspp_device *device, int instance)
 				device->dent,
 				base + debugfs_tspp_regs[i].offset,
 				&fops_iomem_x32);
+
+		device->stat_start = ktime_get();
+		debugfs_create_file("stats", 0664, device->dent, device,
+			&fops_tspp_stats);
 	}
 }
 
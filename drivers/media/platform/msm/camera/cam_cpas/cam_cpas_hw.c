@@ -15,6 +15,8 @@
 #include <linux/of.h>
 #include <linux/msm-bus.h>
 #include <linux/pm_opp.h>
+#include <linux/devfreq.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/module.h>
 
@@ -612,11 +614,13 @@ static int cam_cpas_util_apply_client_axi_vote(
 {
 	struct cam_cpas_private_soc *soc_private =
 		(struct cam_cpas_private_soc *) cpas_hw->soc_info.soc_private;
+	struct cam_cpas *cpas_core = (struct cam_cpas *) cpas_hw->core_info;
 	struct cam_cpas_client *curr_client;
 	struct cam_cpas_client *temp_client;
 	struct cam_axi_vote req_axi_vote = *axi_vote;
 	struct cam_cpas_axi_port *axi_port = cpas_client->axi_port;
-	uint64_t camnoc_bw = 0, mnoc_bw = 0;
+	struct cam_cpas_axi_port *curr_port;
+	uint64_t camnoc_bw = 0, mnoc_bw = 0, total_bw = 0;
 	int rc = 0;
 
 	if (!axi_port) {
@@ -683,6 +687,13 @@ static int cam_cpas_util_apply_client_axi_vote(
 
 	mutex_unlock(&axi_port->lock);
 
+	/* Let the DDR governor know before the traffic shows up */
+	list_for_each_entry(curr_port, &cpas_core->axi_ports_list_head,
+		sibling_port)
+		total_bw += curr_port->consolidated_axi_vote.compressed_bw;
+	devfreq_mem_vote_hint(DEVFREQ_MEM_VOTE_CAMERA,
+		DIV_ROUND_UP_ULL(total_bw, SZ_1M));
+
 	rc = cam_cpas_util_set_camnoc_axi_clk_rate(cpas_hw);
 	if (rc)
 		CAM_ERR(CAM_CPAS, "Failed in setting axi clk rate rc=%d", rc);
@@ -50,6 +50,9 @@ static void cam_req_mgr_core_link_reset(struct cam_req_mgr_core_link *link)
 	link->sync_link_sof_skip = false;
 	link->open_req_cnt = 0;
 	link->last_flush_id = 0;
+	link->trigger_ts = ktime_set(0, 0);
+	link->ahead_hits = 0;
+	link->req.ahead_idx = -1;
 }
 
 void cam_req_mgr_handle_core_shutdown(void)
@@ -68,6 +71,29 @@ void cam_req_mgr_handle_core_shutdown(void)
 	}
 }
 
+/**
+ * __cam_req_mgr_create_link_workq()
+ *
+ * @brief : create the worker of a link, a SCHED_FIFO kthread of its own
+ *          unless link_rt_prio is 0
+ * @link  : link the worker is created for
+ * @name  : name of the worker
+ *
+ * @return: 0 for success, negative for failure
+ */
+static int __cam_req_mgr_create_link_workq(struct cam_req_mgr_core_link *link,
+	char *name)
+{
+	if (g_crm_core_dev->link_rt_prio)
+		return cam_req_mgr_workq_create_rt(name, CRM_WORKQ_NUM_TASKS,
+			&link->workq, CRM_WORKQ_USAGE_NON_IRQ,
+			g_crm_core_dev->link_rt_prio);
+
+	return cam_req_mgr_workq_create(name, CRM_WORKQ_NUM_TASKS,
+		&link->workq, CRM_WORKQ_USAGE_NON_IRQ,
+		CAM_WORKQ_FLAG_HIGH_PRIORITY | CAM_WORKQ_FLAG_SERIAL);
+}
+
 static int __cam_req_mgr_setup_payload(struct cam_req_mgr_core_workq *workq)
 {
 	int32_t                  i = 0;
@@ -458,6 +484,32 @@ static void __cam_req_mgr_check_next_req_slot(
 	}
 }
 
+/**
+ * __cam_req_mgr_update_apply_stats()
+ *
+ * @brief    : account the time from trigger notification to apply for a dev
+ * @link     : link whose trigger is being processed
+ * @dev      : device the request is about to be applied on
+ *
+ */
+static void __cam_req_mgr_update_apply_stats(
+	struct cam_req_mgr_core_link *link,
+	struct cam_req_mgr_connected_device *dev)
+{
+	struct cam_req_mgr_apply_stats *stats = &dev->stats;
+	uint64_t us;
+
+	if (!ktime_to_ns(link->trigger_ts))
+		return;
+
+	us = ktime_us_delta(ktime_get(), link->trigger_ts);
+	stats->count++;
+	stats->last = us;
+	stats->total += us;
+	if (us > stats->max)
+		stats->max = us;
+}
+
 /**
  * __cam_req_mgr_send_req()
  *
@@ -513,6 +565,7 @@ static int __cam_req_mgr_send_req(struct cam_req_mgr_core_link *link,
 				"SEND: link_hdl: %x pd %d req_id %lld",
 				link->link_hdl, pd, apply_req.request_id);
 			if (dev->ops && dev->ops->apply_req) {
+				__cam_req_mgr_update_apply_stats(link, dev);
 				rc = dev->ops->apply_req(&apply_req);
 				if (rc < 0)
 					break;
@@ -541,13 +594,14 @@ static int __cam_req_mgr_send_req(struct cam_req_mgr_core_link *link,
 }
 
 /**
- * __cam_req_mgr_check_link_is_ready()
+ * __cam_req_mgr_traverse_link()
  *
  * @brief    : traverse through all request tables and see if all devices are
  *             ready to apply request settings.
  * @link     : pointer to link whose input queue and req tbl are
  *             traversed through
  * @idx      : index within input request queue
+ * @apply_data : apply settings filled in unless validate_only is set
  * @validate_only : Whether to validate only and/or update settings
  * @self_link : To indicate whether the validation is for the given link or
  *              other sync link
@@ -555,18 +609,16 @@ static int __cam_req_mgr_send_req(struct cam_req_mgr_core_link *link,
  * @return   : 0 for success, negative for failure
  *
  */
-static int __cam_req_mgr_check_link_is_ready(struct cam_req_mgr_core_link *link,
-	int32_t idx, bool validate_only, bool self_link)
+static int __cam_req_mgr_traverse_link(struct cam_req_mgr_core_link *link,
+	int32_t idx, struct cam_req_mgr_apply *apply_data, bool validate_only,
+	bool self_link)
 {
 	int                            rc;
 	struct cam_req_mgr_traverse    traverse_data;
 	struct cam_req_mgr_req_queue  *in_q;
-	struct cam_req_mgr_apply      *apply_data;
 
 	in_q = link->req.in_q;
 
-	apply_data = link->req.apply_data;
-
 	if (validate_only == false) {
 		memset(apply_data, 0,
 		    sizeof(struct cam_req_mgr_apply) * CAM_PIPELINE_DELAY_MAX);
@@ -605,6 +657,95 @@ static int __cam_req_mgr_check_link_is_ready(struct cam_req_mgr_core_link *link,
 	return rc;
 }
 
+/**
+ * __cam_req_mgr_check_link_is_ready()
+ *
+ * @brief    : __cam_req_mgr_traverse_link() into the link's apply_data
+ *
+ */
+static int __cam_req_mgr_check_link_is_ready(struct cam_req_mgr_core_link *link,
+	int32_t idx, bool validate_only, bool self_link)
+{
+	return __cam_req_mgr_traverse_link(link, idx, link->req.apply_data,
+		validate_only, self_link);
+}
+
+/**
+ * __cam_req_mgr_can_apply_ahead()
+ *
+ * @brief    : checks that traversing the tables for idx can not change
+ *             them, i.e. all of them are ready without skip or delay
+ * @tbl      : first pd table of the link
+ * @idx      : in_q slot to be checked
+ *
+ * @return   : true if apply_data for idx can be prepared ahead
+ *
+ */
+static bool __cam_req_mgr_can_apply_ahead(struct cam_req_mgr_req_tbl *tbl,
+	int32_t idx)
+{
+	struct cam_req_mgr_tbl_slot *slot;
+
+	while (tbl) {
+		slot = &tbl->slot[idx];
+		if (slot->state != CRM_REQ_STATE_READY ||
+			slot->inject_delay > 0 || tbl->skip_traverse > 0)
+			return false;
+		__cam_req_mgr_dec_idx(&idx, tbl->pd_delta, tbl->num_slots);
+		tbl = tbl->next;
+	}
+
+	return true;
+}
+
+/**
+ * __cam_req_mgr_prepare_ahead()
+ *
+ * @brief    : once the request at rd_idx is fully applied, traverse the
+ *             tables for the next one so the following SOF only has to
+ *             send it. Called with req.lock held.
+ * @link     : link whose next request is prepared
+ *
+ */
+static void __cam_req_mgr_prepare_ahead(struct cam_req_mgr_core_link *link)
+{
+	struct cam_req_mgr_req_queue *in_q = link->req.in_q;
+	struct cam_req_mgr_slot      *slot;
+	int32_t                       idx;
+
+	if (!g_crm_core_dev->apply_ahead || link->req.ahead_idx >= 0)
+		return;
+
+	if (in_q->slot[in_q->rd_idx].status != CRM_SLOT_STATUS_REQ_APPLIED)
+		return;
+
+	spin_lock_bh(&link->link_state_spin_lock);
+	if (link->state != CAM_CRM_LINK_STATE_READY) {
+		spin_unlock_bh(&link->link_state_spin_lock);
+		return;
+	}
+	spin_unlock_bh(&link->link_state_spin_lock);
+
+	idx = in_q->rd_idx;
+	__cam_req_mgr_inc_idx(&idx, 1, in_q->num_slots);
+	slot = &in_q->slot[idx];
+	if (slot->status != CRM_SLOT_STATUS_REQ_ADDED || slot->skip_idx ||
+		slot->sync_mode == CAM_REQ_MGR_SYNC_MODE_SYNC)
+		return;
+
+	if (!__cam_req_mgr_can_apply_ahead(link->req.l_tbl, idx))
+		return;
+
+	if (__cam_req_mgr_traverse_link(link, idx, link->req.ahead_data,
+		false, true))
+		return;
+
+	link->req.ahead_idx = idx;
+	link->req.ahead_req_id = slot->req_id;
+	CAM_DBG(CAM_CRM, "link %x req %lld prepared ahead at idx %d",
+		link->link_hdl, slot->req_id, idx);
+}
+
 /**
  * __cam_req_mgr_find_slot_for_req()
  *
@@ -920,11 +1061,18 @@ static int __cam_req_mgr_process_req(struct cam_req_mgr_core_link *link,
 			goto error;
 		}
 
-		if (slot->sync_mode == CAM_REQ_MGR_SYNC_MODE_SYNC)
+		if (link->req.ahead_idx == in_q->rd_idx &&
+			link->req.ahead_req_id == slot->req_id) {
+			memcpy(link->req.apply_data, link->req.ahead_data,
+				sizeof(link->req.apply_data));
+			link->ahead_hits++;
+			rc = 0;
+		} else if (slot->sync_mode == CAM_REQ_MGR_SYNC_MODE_SYNC)
 			rc = __cam_req_mgr_process_sync_req(link, slot);
 		else
 			rc = __cam_req_mgr_check_link_is_ready(link,
 				slot->idx, false, true);
+		link->req.ahead_idx = -1;
 
 		if (rc < 0) {
 			/*
@@ -1561,6 +1709,7 @@ int cam_req_mgr_process_flush_req(void *priv, void *data)
 	trace_cam_flush_req(link, flush_info);
 
 	mutex_lock(&link->req.lock);
+	link->req.ahead_idx = -1;
 	if (flush_info->flush_type == CAM_REQ_MGR_FLUSH_TYPE_ALL) {
 		for (i = 0; i < in_q->num_slots; i++) {
 			slot = &in_q->slot[i];
@@ -1730,6 +1879,8 @@ int cam_req_mgr_process_add_req(void *priv, void *data)
 	slot = &tbl->slot[idx];
 	if (add_req->skip_before_applying > slot->inject_delay) {
 		slot->inject_delay = add_req->skip_before_applying;
+		if (idx == link->req.ahead_idx)
+			link->req.ahead_idx = -1;
 		CAM_DBG(CAM_CRM, "Req_id %llu injecting delay %u",
 			add_req->req_id, add_req->skip_before_applying);
 	}
@@ -1753,6 +1904,7 @@ int cam_req_mgr_process_add_req(void *priv, void *data)
 		CAM_DBG(CAM_REQ, "idx %d req_id %lld pd %d SLOT READY",
 			idx, add_req->req_id, tbl->pd);
 		slot->state = CRM_REQ_STATE_READY;
+		__cam_req_mgr_prepare_ahead(link);
 	}
 	mutex_unlock(&link->req.lock);
 
@@ -1838,6 +1990,7 @@ int cam_req_mgr_process_error(void *priv, void *data)
 			}
 			/* Bring processing pointer to bubbled req id */
 			__cam_req_mgr_tbl_set_all_skip_cnt(&link->req.l_tbl);
+			link->req.ahead_idx = -1;
 			in_q->rd_idx = idx;
 			in_q->slot[idx].status = CRM_SLOT_STATUS_REQ_ADDED;
 			spin_lock_bh(&link->link_state_spin_lock);
@@ -1914,7 +2067,11 @@ static int cam_req_mgr_process_trigger(void *priv, void *data)
 		__cam_req_mgr_check_next_req_slot(in_q);
 		__cam_req_mgr_inc_idx(&in_q->rd_idx, 1, in_q->num_slots);
 	}
+	link->trigger_ts = task_data->ts;
 	rc = __cam_req_mgr_process_req(link, trigger_data->trigger);
+	link->trigger_ts = ktime_set(0, 0);
+	if (!rc)
+		__cam_req_mgr_prepare_ahead(link);
 	mutex_unlock(&link->req.lock);
 
 end:
@@ -2144,6 +2301,7 @@ static int cam_req_mgr_cb_notify_trigger(
 	notify_trigger->link_hdl = trigger_data->link_hdl;
 	notify_trigger->dev_hdl = trigger_data->dev_hdl;
 	notify_trigger->trigger = trigger_data->trigger;
+	task_data->ts = ktime_get();
 	task->process_cb = &cam_req_mgr_process_trigger;
 	rc = cam_req_mgr_workq_enqueue_task(task, link, CRM_TASK_PRIORITY_0);
 
@@ -2452,7 +2610,6 @@ int cam_req_mgr_destroy_session(
 int cam_req_mgr_link(struct cam_req_mgr_link_info *link_info)
 {
 	int                                     rc = 0;
-	int                                     wq_flag = 0;
 	char                                    buf[128];
 	struct cam_create_dev_hdl               root_dev;
 	struct cam_req_mgr_core_session        *cam_session;
@@ -2528,9 +2685,7 @@ int cam_req_mgr_link(struct cam_req_mgr_link_info *link_info)
 	/* Create worker for current link */
 	snprintf(buf, sizeof(buf), "%x-%x",
 		link_info->session_hdl, link->link_hdl);
-	wq_flag = CAM_WORKQ_FLAG_HIGH_PRIORITY | CAM_WORKQ_FLAG_SERIAL;
-	rc = cam_req_mgr_workq_create(buf, CRM_WORKQ_NUM_TASKS,
-		&link->workq, CRM_WORKQ_USAGE_NON_IRQ, wq_flag);
+	rc = __cam_req_mgr_create_link_workq(link, buf);
 	if (rc < 0) {
 		CAM_ERR(CAM_CRM, "FATAL: unable to create worker");
 		__cam_req_mgr_destroy_link_info(link);
@@ -2930,6 +3085,7 @@ int cam_req_mgr_core_device_init(void)
 	CAM_DBG(CAM_CRM, "g_crm_core_dev %pK", g_crm_core_dev);
 	INIT_LIST_HEAD(&g_crm_core_dev->session_head);
 	mutex_init(&g_crm_core_dev->crm_lock);
+	g_crm_core_dev->link_rt_prio = CRM_LINK_RT_PRIO_DEFAULT;
 	cam_req_mgr_debug_register(g_crm_core_dev);
 
 	for (i = 0; i < MAXIMUM_LINKS_PER_SESSION; i++) {
@@ -13,6 +13,7 @@
 #ifndef _CAM_REQ_MGR_CORE_H_
 #define _CAM_REQ_MGR_CORE_H_
 
+#include <linux/ktime.h>
 #include <linux/spinlock.h>
 #include "cam_req_mgr_interface.h"
 #include "cam_req_mgr_core_defs.h"
@@ -32,6 +33,9 @@
 
 #define CRM_WORKQ_NUM_TASKS 60
 
+/* SCHED_FIFO priority of link workers, 0 selects a kworker pool */
+#define CRM_LINK_RT_PRIO_DEFAULT 1
+
 #define MAX_SYNC_COUNT 65535
 
 #define SYNC_LINK_SOF_CNT_MAX_LMT 1
@@ -66,6 +70,7 @@ enum crm_workq_task_type {
  * @apply_req      : contains info of which request is applied at device
  * @notify_trigger : contains notification from IFE to CRM about trigger
  * @notify_err     : contains error info happened while processing request
+ * @ts             : time the task was queued
  * -
  */
 struct crm_task_payload {
@@ -78,6 +83,7 @@ struct crm_task_payload {
 		struct cam_req_mgr_trigger_notify       notify_trigger;
 		struct cam_req_mgr_error_notify         notify_err;
 	} u;
+	ktime_t                  ts;
 };
 
 /**
@@ -247,6 +253,10 @@ struct cam_req_mgr_req_queue {
  * @l_tbl       : unique pd request tables.
  * @num_tbl     : how many unique pd value devices are present
  * @apply_data	: Holds information about request id for a request
+ * @ahead_data  : apply_data of the next request, prepared while the
+ *                current one is active
+ * @ahead_idx   : in_q slot @ahead_data was prepared for, -1 if none
+ * @ahead_req_id: request id @ahead_data was prepared for
  * @lock        : mutex lock protecting request data ops.
  */
 struct cam_req_mgr_req_data {
@@ -254,9 +264,27 @@ struct cam_req_mgr_req_data {
 	struct cam_req_mgr_req_tbl   *l_tbl;
 	int32_t                       num_tbl;
 	struct cam_req_mgr_apply      apply_data[CAM_PIPELINE_DELAY_MAX];
+	struct cam_req_mgr_apply      ahead_data[CAM_PIPELINE_DELAY_MAX];
+	int32_t                       ahead_idx;
+	int64_t                       ahead_req_id;
 	struct mutex                  lock;
 };
 
+/**
+ * struct cam_req_mgr_apply_stats
+ * - Trigger to apply latency of a device, in usec
+ * @count : number of requests applied on a trigger
+ * @last  : latency of the last apply
+ * @max   : worst latency seen
+ * @total : sum of all latencies, for the average
+ */
+struct cam_req_mgr_apply_stats {
+	uint64_t count;
+	uint64_t last;
+	uint64_t max;
+	uint64_t total;
+};
+
 /**
  * struct cam_req_mgr_connected_device
  * - Device Properties
@@ -267,6 +295,7 @@ struct cam_req_mgr_req_data {
  * @dev_info : holds dev characteristics such as pipeline delay, dev name
  * @ops      : holds func pointer to call methods on this device
  * @parent   : pvt data - like link which this dev hdl belongs to
+ * @stats    : latency from trigger notification to apply_req
  */
 struct cam_req_mgr_connected_device {
 	int32_t                         dev_hdl;
@@ -275,6 +304,7 @@ struct cam_req_mgr_connected_device {
 	struct cam_req_mgr_device_info  dev_info;
 	struct cam_req_mgr_kmd_ops     *ops;
 	void                           *parent;
+	struct cam_req_mgr_apply_stats  stats;
 };
 
 /**
@@ -313,6 +343,9 @@ struct cam_req_mgr_connected_device {
  * @open_req_cnt         : Counter to keep track of open requests that are yet
  *                         to be serviced in the kernel.
  * @last_flush_id        : Last request to flush
+ * @trigger_ts           : time of the trigger being processed, 0 outside
+ *                         of trigger processing
+ * @ahead_hits           : requests applied from prepared ahead_data
  * @is_used              : 1 if link is in use else 0
  *
  */
@@ -339,6 +372,8 @@ struct cam_req_mgr_core_link {
 	bool                                 sync_link_sof_skip;
 	int32_t                              open_req_cnt;
 	uint32_t                             last_flush_id;
+	ktime_t                              trigger_ts;
+	uint32_t                             ahead_hits;
 	atomic_t                             is_used;
 };
 
@@ -373,10 +408,15 @@ struct cam_req_mgr_core_session {
  * - Core camera request manager data struct
  * @session_head : list head holding sessions
  * @crm_lock     : mutex lock to protect session creation & destruction
+ * @link_rt_prio : SCHED_FIFO priority of workers of new links, 0 to use
+ *                 a high priority workqueue instead
+ * @apply_ahead  : prepare the next request while the current one is active
  */
 struct cam_req_mgr_core_device {
 	struct list_head             session_head;
 	struct mutex                 crm_lock;
+	u32                          link_rt_prio;
+	bool                         apply_ahead;
 };
 
 /**
@@ -10,7 +10,10 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/math64.h>
+#include <linux/seq_file.h>
 #include "cam_req_mgr_debug.h"
+#include "cam_req_mgr_workq.h"
 
 #define MAX_SESS_INFO_LINE_BUFF_LEN 256
 
@@ -117,6 +120,52 @@ static const struct file_operations session_info = {
 	.write = session_info_write,
 };
 
+static int apply_latency_show(struct seq_file *s, void *unused)
+{
+	struct cam_req_mgr_core_device *core_dev = s->private;
+	struct cam_req_mgr_core_session *session;
+	struct cam_req_mgr_core_link *link;
+	struct cam_req_mgr_connected_device *dev;
+	struct cam_req_mgr_apply_stats *stats;
+	int i, j;
+
+	mutex_lock(&core_dev->crm_lock);
+	list_for_each_entry(session, &core_dev->session_head, entry) {
+		for (i = 0; i < session->num_links; i++) {
+			link = session->links[i];
+			seq_printf(s, "link_hdl 0x%x rt %s ahead_hits %u\n",
+				link->link_hdl,
+				link->workq && link->workq->kworker ? "y" : "n",
+				link->ahead_hits);
+			for (j = 0; j < link->num_devs; j++) {
+				dev = &link->l_dev[j];
+				stats = &dev->stats;
+				seq_printf(s,
+					"  %-16s pd %d applied %llu avg %llu max %llu last %llu us\n",
+					dev->dev_info.name, dev->dev_info.p_delay,
+					stats->count, stats->count ?
+					div64_u64(stats->total, stats->count) : 0,
+					stats->max, stats->last);
+			}
+		}
+	}
+	mutex_unlock(&core_dev->crm_lock);
+
+	return 0;
+}
+
+static int apply_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, apply_latency_show, inode->i_private);
+}
+
+static const struct file_operations apply_latency = {
+	.open = apply_latency_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 int cam_req_mgr_debug_register(struct cam_req_mgr_core_device *core_dev)
 {
 	struct dentry *debugfs_root;
@@ -135,5 +184,17 @@ int cam_req_mgr_debug_register(struct cam_req_mgr_core_device *core_dev)
 		debugfs_root, core_dev, &bubble_recovery))
 		return -ENOMEM;
 
+	if (!debugfs_create_u32("link_rt_prio", 0644,
+		debugfs_root, &core_dev->link_rt_prio))
+		return -ENOMEM;
+
+	if (!debugfs_create_bool("apply_ahead", 0644,
+		debugfs_root, &core_dev->apply_ahead))
+		return -ENOMEM;
+
+	if (!debugfs_create_file("apply_latency", 0444,
+		debugfs_root, core_dev, &apply_latency))
+		return -ENOMEM;
+
 	return 0;
 }
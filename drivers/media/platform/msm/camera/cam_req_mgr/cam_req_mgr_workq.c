@@ -92,23 +92,15 @@ static int cam_req_mgr_process_task(struct crm_workq_task *task)
 }
 
 /**
- * cam_req_mgr_process_workq() - main loop handling
- * @w: workqueue task pointer
+ * __cam_req_mgr_process_workq() - main loop handling
+ * @workq: workq whose pending tasks are processed
  */
-static void cam_req_mgr_process_workq(struct work_struct *w)
+static void __cam_req_mgr_process_workq(struct cam_req_mgr_core_workq *workq)
 {
-	struct cam_req_mgr_core_workq *workq = NULL;
 	struct crm_workq_task         *task;
 	int32_t                        i = CRM_TASK_PRIORITY_0;
 	unsigned long                  flags = 0;
 
-	if (!w) {
-		CAM_ERR(CAM_CRM, "NULL task pointer can not schedule");
-		return;
-	}
-	workq = (struct cam_req_mgr_core_workq *)
-		container_of(w, struct cam_req_mgr_core_workq, work);
-
 	while (i < CRM_TASK_PRIORITY_MAX) {
 		WORKQ_ACQUIRE_LOCK(workq, flags);
 		while (!list_empty(&workq->task.process_head[i])) {
@@ -127,6 +119,31 @@ static void cam_req_mgr_process_workq(struct work_struct *w)
 	}
 }
 
+/**
+ * cam_req_mgr_process_workq() - workqueue entry point
+ * @w: workqueue task pointer
+ */
+static void cam_req_mgr_process_workq(struct work_struct *w)
+{
+	if (!w) {
+		CAM_ERR(CAM_CRM, "NULL task pointer can not schedule");
+		return;
+	}
+
+	__cam_req_mgr_process_workq(container_of(w,
+		struct cam_req_mgr_core_workq, work));
+}
+
+/**
+ * cam_req_mgr_process_kwork() - RT kthread worker entry point
+ * @w: kthread work pointer
+ */
+static void cam_req_mgr_process_kwork(struct kthread_work *w)
+{
+	__cam_req_mgr_process_workq(container_of(w,
+		struct cam_req_mgr_core_workq, kwork));
+}
+
 int cam_req_mgr_workq_enqueue_task(struct crm_workq_task *task,
 	void *priv, int32_t prio)
 {
@@ -158,7 +175,7 @@ int cam_req_mgr_workq_enqueue_task(struct crm_workq_task *task,
 		? prio : CRM_TASK_PRIORITY_0;
 
 	WORKQ_ACQUIRE_LOCK(workq, flags);
-		if (!workq->job) {
+		if (!workq->job && !workq->kworker) {
 			rc = -EINVAL;
 			WORKQ_RELEASE_LOCK(workq, flags);
 			goto end;
@@ -171,19 +188,23 @@ int cam_req_mgr_workq_enqueue_task(struct crm_workq_task *task,
 	CAM_DBG(CAM_CRM, "enq task %pK pending_cnt %d",
 		task, atomic_read(&workq->task.pending_cnt));
 
-	queue_work(workq->job, &workq->work);
+	if (workq->kworker)
+		kthread_queue_work(workq->kworker, &workq->kwork);
+	else
+		queue_work(workq->job, &workq->work);
 	WORKQ_RELEASE_LOCK(workq, flags);
 end:
 	return rc;
 }
 
-int cam_req_mgr_workq_create(char *name, int32_t num_tasks,
+static int __cam_req_mgr_workq_create(char *name, int32_t num_tasks,
 	struct cam_req_mgr_core_workq **workq, enum crm_workq_context in_irq,
-	int flags)
+	int flags, int rt_prio)
 {
 	int32_t i, wq_flags = 0, max_active_tasks = 0;
 	struct crm_workq_task  *task;
 	struct cam_req_mgr_core_workq *crm_workq = NULL;
+	struct sched_param param = { 0 };
 	char buf[128] = "crm_workq-";
 
 	if (!*workq) {
@@ -201,12 +222,26 @@ int cam_req_mgr_workq_create(char *name, int32_t num_tasks,
 			max_active_tasks = 1;
 
 		strlcat(buf, name, sizeof(buf));
-		CAM_DBG(CAM_CRM, "create workque crm_workq-%s", name);
-		crm_workq->job = alloc_workqueue(buf,
-			wq_flags, max_active_tasks, NULL);
-		if (!crm_workq->job) {
-			kfree(crm_workq);
-			return -ENOMEM;
+		CAM_DBG(CAM_CRM, "create workque crm_workq-%s rt_prio %d",
+			name, rt_prio);
+		if (rt_prio > 0) {
+			param.sched_priority = min(rt_prio, MAX_RT_PRIO - 1);
+			crm_workq->kworker = kthread_create_worker(0, "%s", buf);
+			if (IS_ERR(crm_workq->kworker)) {
+				kfree(crm_workq);
+				return -ENOMEM;
+			}
+			sched_setscheduler_nocheck(crm_workq->kworker->task,
+				SCHED_FIFO, &param);
+			kthread_init_work(&crm_workq->kwork,
+				cam_req_mgr_process_kwork);
+		} else {
+			crm_workq->job = alloc_workqueue(buf,
+				wq_flags, max_active_tasks, NULL);
+			if (!crm_workq->job) {
+				kfree(crm_workq);
+				return -ENOMEM;
+			}
 		}
 
 		/* Workq attributes initialization */
@@ -231,6 +266,10 @@ int cam_req_mgr_workq_create(char *name, int32_t num_tasks,
 			CAM_WARN(CAM_CRM, "Insufficient memory %zu",
 				sizeof(struct crm_workq_task) *
 				crm_workq->task.num_task);
+			if (crm_workq->kworker)
+				kthread_destroy_worker(crm_workq->kworker);
+			else
+				destroy_workqueue(crm_workq->job);
 			kfree(crm_workq);
 			return -ENOMEM;
 		}
@@ -250,10 +289,30 @@ int cam_req_mgr_workq_create(char *name, int32_t num_tasks,
 	return 0;
 }
 
+int cam_req_mgr_workq_create(char *name, int32_t num_tasks,
+	struct cam_req_mgr_core_workq **workq, enum crm_workq_context in_irq,
+	int flags)
+{
+	return __cam_req_mgr_workq_create(name, num_tasks, workq, in_irq,
+		flags, 0);
+}
+
+int cam_req_mgr_workq_create_rt(char *name, int32_t num_tasks,
+	struct cam_req_mgr_core_workq **workq, enum crm_workq_context in_irq,
+	int rt_prio)
+{
+	if (rt_prio <= 0)
+		return -EINVAL;
+
+	return __cam_req_mgr_workq_create(name, num_tasks, workq, in_irq,
+		0, rt_prio);
+}
+
 void cam_req_mgr_workq_destroy(struct cam_req_mgr_core_workq **crm_workq)
 {
 	unsigned long flags = 0;
 	struct workqueue_struct   *job;
+	struct kthread_worker     *kworker;
 	CAM_DBG(CAM_CRM, "destroy workque %pK", crm_workq);
 	if (*crm_workq) {
 		WORKQ_ACQUIRE_LOCK(*crm_workq, flags);
@@ -262,8 +321,14 @@ void cam_req_mgr_workq_destroy(struct cam_req_mgr_core_workq **crm_workq)
 			(*crm_workq)->job = NULL;
 			WORKQ_RELEASE_LOCK(*crm_workq, flags);
 			destroy_workqueue(job);
-		} else
+		} else if ((*crm_workq)->kworker) {
+			kworker = (*crm_workq)->kworker;
+			(*crm_workq)->kworker = NULL;
 			WORKQ_RELEASE_LOCK(*crm_workq, flags);
+			kthread_destroy_worker(kworker);
+		} else {
+			WORKQ_RELEASE_LOCK(*crm_workq, flags);
+		}
 		kfree((*crm_workq)->task.pool);
 		kfree(*crm_workq);
 		*crm_workq = NULL;
@@ -18,6 +18,7 @@
 #include<linux/init.h>
 #include<linux/sched.h>
 #include <linux/workqueue.h>
+#include <linux/kthread.h>
 #include <linux/slab.h>
 #include <linux/timer.h>
 
@@ -73,6 +74,8 @@ struct crm_workq_task {
 /** struct cam_req_mgr_core_workq
  * @work       : work token used by workqueue
  * @job        : workqueue internal job struct
+ * @kworker    : RT kthread worker used instead of @job, NULL if unused
+ * @kwork      : work token used by @kworker
  * task -
  * @lock_bh    : lock for task structs
  * @in_irq     : set true if workque can be used in irq context
@@ -86,6 +89,8 @@ struct crm_workq_task {
 struct cam_req_mgr_core_workq {
 	struct work_struct         work;
 	struct workqueue_struct   *job;
+	struct kthread_worker     *kworker;
+	struct kthread_work        kwork;
 	spinlock_t                 lock_bh;
 	uint32_t                   in_irq;
 
@@ -119,6 +124,23 @@ int cam_req_mgr_workq_create(char *name, int32_t num_tasks,
 	struct cam_req_mgr_core_workq **workq, enum crm_workq_context in_irq,
 	int flags);
 
+/**
+ * cam_req_mgr_workq_create_rt()
+ * @brief    : create a workq backed by its own SCHED_FIFO kthread
+ * @name     : Name of the workque to be allocated, it is combination
+ *             of session handle and link handle
+ * @num_task : Num_tasks to be allocated for workq
+ * @workq    : Double pointer worker
+ * @in_irq   : Set to one if workq might be used in irq context
+ * @rt_prio  : SCHED_FIFO priority of the worker thread
+ * Tasks of this workq are processed serially by a dedicated thread,
+ * so they can not be delayed behind work of other workqueues sharing
+ * a kworker pool.
+ */
+int cam_req_mgr_workq_create_rt(char *name, int32_t num_tasks,
+	struct cam_req_mgr_core_workq **workq, enum crm_workq_context in_irq,
+	int rt_prio);
+
 /**
  * cam_req_mgr_workq_destroy()
  * @brief: destroy workqueue
@@ -174,7 +174,8 @@ int cam_sync_deregister_callback(sync_callback cb_func,
 	return found ? 0 : -ENOENT;
 }
 
-int cam_sync_signal(int32_t sync_obj, uint32_t status)
+static int cam_sync_signal_obj(int32_t sync_obj, uint32_t status,
+	struct list_head *cb_list)
 {
 	struct sync_table_row *row = NULL;
 	struct sync_table_row *parent_row = NULL;
@@ -228,7 +229,7 @@ int cam_sync_signal(int32_t sync_obj, uint32_t status)
 	}
 
 	row->state = status;
-	cam_sync_util_dispatch_signaled_cb(sync_obj, status);
+	cam_sync_util_dispatch_signaled_cb(sync_obj, status, cb_list);
 
 	/* copy parent list to local and release child lock */
 	INIT_LIST_HEAD(&parents_list);
@@ -264,7 +265,8 @@ int cam_sync_signal(int32_t sync_obj, uint32_t status)
 
 		if (!parent_row->remaining)
 			cam_sync_util_dispatch_signaled_cb(
-				parent_info->sync_id, parent_row->state);
+				parent_info->sync_id, parent_row->state,
+				cb_list);
 
 		spin_unlock_bh(&sync_dev->row_spinlocks[parent_info->sync_id]);
 		list_del_init(&parent_info->list);
@@ -274,6 +276,44 @@ int cam_sync_signal(int32_t sync_obj, uint32_t status)
 	return 0;
 }
 
+int cam_sync_signal(int32_t sync_obj, uint32_t status)
+{
+	return cam_sync_signal_obj(sync_obj, status, NULL);
+}
+
+int cam_sync_signal_batch(struct cam_sync_signal *signals,
+	uint32_t num_signals)
+{
+	struct sync_cb_batch *batch;
+	int i, rc, result = 0;
+
+	if (!signals || !num_signals ||
+		num_signals > CAM_SYNC_MAX_SIGNAL_BATCH)
+		return -EINVAL;
+
+	batch = kzalloc(sizeof(*batch), GFP_ATOMIC);
+	if (!batch)
+		return -ENOMEM;
+
+	INIT_LIST_HEAD(&batch->cb_list);
+	INIT_WORK(&batch->work, cam_sync_util_cb_batch_dispatch);
+
+	/* Signal everything, report the first failure */
+	for (i = 0; i < num_signals; i++) {
+		rc = cam_sync_signal_obj(signals[i].sync_obj,
+			signals[i].sync_state, &batch->cb_list);
+		if (rc && !result)
+			result = rc;
+	}
+
+	if (list_empty(&batch->cb_list))
+		kfree(batch);
+	else
+		queue_work(sync_dev->work_queue, &batch->work);
+
+	return result;
+}
+
 int cam_sync_merge(int32_t *sync_obj, uint32_t num_objs, int32_t *merged_obj)
 {
 	int rc;
@@ -499,6 +539,49 @@ static int cam_sync_handle_signal(struct cam_private_ioctl_arg *k_ioctl)
 		sync_signal.sync_state);
 }
 
+static int cam_sync_handle_signal_batch(struct cam_private_ioctl_arg *k_ioctl)
+{
+	struct cam_sync_signal_batch sync_batch;
+	struct cam_sync_signal *signals;
+	int i, result;
+
+	if (k_ioctl->size != sizeof(struct cam_sync_signal_batch))
+		return -EINVAL;
+
+	if (!k_ioctl->ioctl_ptr)
+		return -EINVAL;
+
+	if (copy_from_user(&sync_batch,
+		u64_to_user_ptr(k_ioctl->ioctl_ptr),
+		k_ioctl->size))
+		return -EFAULT;
+
+	if (!sync_batch.num_signals ||
+		sync_batch.num_signals > CAM_SYNC_MAX_SIGNAL_BATCH)
+		return -EINVAL;
+
+	signals = kcalloc(sync_batch.num_signals, sizeof(*signals),
+		GFP_KERNEL);
+	if (!signals)
+		return -ENOMEM;
+
+	if (copy_from_user(signals,
+		u64_to_user_ptr(sync_batch.signals),
+		sizeof(*signals) * sync_batch.num_signals)) {
+		kfree(signals);
+		return -EFAULT;
+	}
+
+	/* need to get ref for UMD signaled fences */
+	for (i = 0; i < sync_batch.num_signals; i++)
+		cam_sync_get_obj_ref(signals[i].sync_obj);
+
+	result = cam_sync_signal_batch(signals, sync_batch.num_signals);
+	kfree(signals);
+
+	return result;
+}
+
 static int cam_sync_handle_merge(struct cam_private_ioctl_arg *k_ioctl)
 {
 	struct cam_sync_merge sync_merge;
@@ -763,6 +846,9 @@ static long cam_sync_dev_ioctl(struct file *filep, void *fh,
 	case CAM_SYNC_SIGNAL:
 		rc = cam_sync_handle_signal(&k_ioctl);
 		break;
+	case CAM_SYNC_SIGNAL_BATCH:
+		rc = cam_sync_handle_signal_batch(&k_ioctl);
+		break;
 	case CAM_SYNC_MERGE:
 		rc = cam_sync_handle_merge(&k_ioctl);
 		break;
@@ -38,43 +38,51 @@
 #define BUF_DEBUG_FULL 0
 #define MAX_LIST_COUNT 100
 
-static int msm_buf_check_head_sanity(struct msm_isp_bufq *bufq)
+/*
+ * Native buffers are handed to the VFE in the order they were queued. The
+ * ring only stores buffer indices, so getting the next buffer and putting
+ * one back don't depend on the number of buffers in the queue. Must be
+ * called with the bufq lock held.
+ */
+static int msm_isp_bufq_ring_push(struct msm_isp_bufq *bufq,
+	struct msm_isp_buffer *buf_info)
 {
-	int rc = 0;
-	struct list_head *prev = NULL;
-	struct list_head *next = NULL;
+	if (buf_info->in_ring ||
+		bufq->ring_tail - bufq->ring_head >= MSM_ISP_BUFQ_RING_SIZE)
+		return -EFAULT;
 
-	if (!bufq) {
-		pr_err("%s: Error! Invalid bufq\n", __func__);
-		return -EINVAL;
-	}
+	bufq->ring[bufq->ring_tail % MSM_ISP_BUFQ_RING_SIZE] =
+		buf_info->buf_idx;
+	bufq->ring_tail++;
+	buf_info->in_ring = true;
 
-	prev = bufq->head.prev;
-	next = bufq->head.next;
+	return 0;
+}
 
-	if (!prev) {
-		pr_err("%s: Error! bufq->head.prev is NULL\n", __func__);
-		return -EINVAL;
-	}
+static struct msm_isp_buffer *msm_isp_bufq_ring_peek(
+	struct msm_isp_bufq *bufq)
+{
+	if (bufq->ring_head == bufq->ring_tail)
+		return NULL;
 
-	if (!next) {
-		pr_err("%s: Error! bufq->head.next is NULL\n", __func__);
-		return -EINVAL;
-	}
+	return &bufq->bufs[bufq->ring[bufq->ring_head %
+		MSM_ISP_BUFQ_RING_SIZE]];
+}
 
-	if (prev->next != &bufq->head) {
-		pr_err("%s: Error! head prev->next is %pK should be %pK\n",
-			__func__, prev->next, &bufq->head);
-		return -EINVAL;
-	}
+static struct msm_isp_buffer *msm_isp_bufq_ring_pop(
+	struct msm_isp_bufq *bufq)
+{
+	struct msm_isp_buffer *buf_info;
 
-	if (next->prev != &bufq->head) {
-		pr_err("%s: Error! head next->prev is %pK should be %pK\n",
-			__func__, next->prev, &bufq->head);
-		return -EINVAL;
+	/* drop buffers that were dequeued by userspace while queued */
+	while ((buf_info = msm_isp_bufq_ring_peek(bufq))) {
+		bufq->ring_head++;
+		buf_info->in_ring = false;
+		if (buf_info->state == MSM_ISP_BUFFER_STATE_QUEUED)
+			return buf_info;
 	}
 
-	return rc;
+	return NULL;
 }
 
 static struct msm_isp_bufq *msm_isp_get_bufq(
@@ -162,7 +170,8 @@ static int msm_isp_free_bufq_handle(struct msm_isp_buf_mgr *buf_mgr,
 	bufq->stream_id = 0;
 	bufq->num_bufs = 0;
 	bufq->buf_type = 0;
-	INIT_LIST_HEAD(&bufq->head);
+	bufq->ring_head = 0;
+	bufq->ring_tail = 0;
 
 	return 0;
 }
@@ -455,8 +464,6 @@ static int msm_isp_get_buf_by_index(struct msm_isp_buf_mgr *buf_mgr,
 	int rc = -EINVAL;
 	unsigned long flags;
 	struct msm_isp_bufq *bufq = NULL;
-	struct msm_isp_buffer *temp_buf_info;
-	uint32_t i = 0;
 
 	bufq = msm_isp_get_bufq(buf_mgr, bufq_handle);
 	if (!bufq) {
@@ -472,19 +479,10 @@ static int msm_isp_get_buf_by_index(struct msm_isp_buf_mgr *buf_mgr,
 		return rc;
 	}
 
-	*buf_info = NULL;
-	for (i = 0; bufq->num_bufs; i++) {
-		temp_buf_info = &bufq->bufs[i];
-		if (temp_buf_info && temp_buf_info->buf_idx == buf_index) {
-			*buf_info = temp_buf_info;
-			break;
-		}
-	}
-
-	if (*buf_info) {
-		pr_debug("Found buf in isp buf mgr");
-		rc = 0;
-	}
+	/* buffers are stored by their index */
+	*buf_info = &bufq->bufs[buf_index];
+	pr_debug("Found buf in isp buf mgr");
+	rc = 0;
 	spin_unlock_irqrestore(&bufq->bufq_lock, flags);
 	return rc;
 }
@@ -528,7 +526,6 @@ static int msm_isp_get_buf(struct msm_isp_buf_mgr *buf_mgr, uint32_t id,
 {
 	int rc = -1;
 	unsigned long flags;
-	struct msm_isp_buffer *temp_buf_info = NULL;
 	struct msm_isp_bufq *bufq = NULL;
 	struct vb2_v4l2_buffer *vb2_v4l2_buf = NULL;
 
@@ -555,23 +552,7 @@ static int msm_isp_get_buf(struct msm_isp_buf_mgr *buf_mgr, uint32_t id,
 
 	switch (BUF_SRC(bufq->stream_id)) {
 	case MSM_ISP_BUFFER_SRC_NATIVE:
-		list_for_each_entry(temp_buf_info, &bufq->head, list) {
-			if (temp_buf_info->state ==
-					MSM_ISP_BUFFER_STATE_QUEUED) {
-				list_del_init(&temp_buf_info->list);
-				if (msm_buf_check_head_sanity(bufq) < 0) {
-					spin_unlock_irqrestore(
-						&bufq->bufq_lock, flags);
-					WARN(1, "%s buf_handle 0x%x buf_idx %d\n",
-						__func__,
-						bufq->bufq_handle,
-						temp_buf_info->buf_idx);
-					return -EFAULT;
-				}
-				*buf_info = temp_buf_info;
-				break;
-			}
-		}
+		*buf_info = msm_isp_bufq_ring_pop(bufq);
 		break;
 	case MSM_ISP_BUFFER_SRC_HAL:
 		if (buf_index == MSM_ISP_INVALID_BUF_INDEX)
@@ -608,8 +589,7 @@ static int msm_isp_get_buf(struct msm_isp_buf_mgr *buf_mgr, uint32_t id,
 		/* In scratch buf case we have only on buffer in queue.
 		 * We return every time same buffer.
 		 */
-		*buf_info = list_entry(bufq->head.next, typeof(**buf_info),
-				list);
+		*buf_info = msm_isp_bufq_ring_peek(bufq);
 		break;
 	default:
 		pr_err("%s: Incorrect buf source.\n", __func__);
@@ -651,19 +631,11 @@ static int msm_isp_put_buf_unsafe(struct msm_isp_buf_mgr *buf_mgr,
 	case MSM_ISP_BUFFER_STATE_PREPARED:
 	case MSM_ISP_BUFFER_STATE_DEQUEUED:
 		if (BUF_SRC(bufq->stream_id)) {
-			if (!list_empty(&buf_info->list)) {
+			if (msm_isp_bufq_ring_push(bufq, buf_info) < 0) {
 				WARN(1, "%s: buf %x/%x double add\n",
 					__func__, bufq_handle, buf_index);
 				return -EFAULT;
 			}
-			list_add_tail(&buf_info->list, &bufq->head);
-			if (msm_buf_check_head_sanity(bufq) < 0) {
-				WARN(1, "%s buf_handle 0x%x buf_idx %d\n",
-					__func__,
-					bufq->bufq_handle,
-					buf_info->buf_idx);
-				return -EFAULT;
-			}
 		} else {
 			buf_mgr->vb2_ops->put_buf(buf_info->vb2_v4l2_buf,
 				bufq->session_id, bufq->stream_id);
@@ -791,9 +763,14 @@ static int msm_isp_buf_done(struct msm_isp_buf_mgr *buf_mgr,
 #endif
 			buf_info->state = MSM_ISP_BUFFER_STATE_DISPATCHED;
 			spin_unlock_irqrestore(&bufq->bufq_lock, flags);
-			buf_mgr->vb2_ops->buf_done(buf_info->vb2_v4l2_buf,
-				bufq->session_id, bufq->stream_id,
-				frame_id, tv, output_format);
+			/* Keep the buffer for CPP/JPEG if the stream asks */
+			if (buf_mgr->vb2_ops->buf_handoff(
+				buf_info->vb2_v4l2_buf, bufq->session_id,
+				bufq->stream_id, frame_id, tv, output_format))
+				buf_mgr->vb2_ops->buf_done(
+					buf_info->vb2_v4l2_buf,
+					bufq->session_id, bufq->stream_id,
+					frame_id, tv, output_format);
 		} else {
 			spin_unlock_irqrestore(&bufq->bufq_lock, flags);
 		}
@@ -1038,7 +1015,8 @@ static int msm_isp_request_bufq(struct msm_isp_buf_mgr *buf_mgr,
 	bufq->stream_id = buf_request->stream_id;
 	bufq->num_bufs = buf_request->num_buf;
 	bufq->buf_type = buf_request->buf_type;
-	INIT_LIST_HEAD(&bufq->head);
+	bufq->ring_head = 0;
+	bufq->ring_tail = 0;
 	bufq->security_mode = buf_request->security_mode;
 
 	for (i = 0; i < buf_request->num_buf; i++) {
@@ -1050,7 +1028,6 @@ static int msm_isp_request_bufq(struct msm_isp_buf_mgr *buf_mgr,
 		bufq->bufs[i].buf_debug.put_state_last = 0;
 		bufq->bufs[i].bufq_handle = bufq->bufq_handle;
 		bufq->bufs[i].buf_idx = i;
-		INIT_LIST_HEAD(&bufq->bufs[i].list);
 	}
 
 	return 0;
@@ -14,6 +14,7 @@
 #define _MSM_ISP_BUF_H_
 
 #include <media/msmb_isp.h>
+#include <media/videobuf2-core.h>
 #include "msm_sd.h"
 
 /* Buffer type could be userspace / HAL.
@@ -35,6 +36,9 @@
 
 #define MSM_ISP_INVALID_BUF_INDEX 0xFFFFFFFF
 
+/* native buffer queue ring, holds each buffer of a bufq at most once */
+#define MSM_ISP_BUFQ_RING_SIZE VB2_MAX_FRAME
+
 struct msm_isp_buf_mgr;
 
 enum msm_isp_buffer_src_t {
@@ -103,7 +107,7 @@ struct msm_isp_buffer {
 	uint32_t is_drop_reconfig;
 
 	/*Native buffer*/
-	struct list_head list;
+	bool in_ring;
 	enum msm_isp_buffer_state state;
 
 	struct msm_isp_buffer_debug_t buf_debug;
@@ -120,8 +124,10 @@ struct msm_isp_bufq {
 	enum msm_isp_buf_type buf_type;
 	struct msm_isp_buffer *bufs;
 	spinlock_t bufq_lock;
-	/*Native buffer queue*/
-	struct list_head head;
+	/*Native buffer queue, ring of buffer indices*/
+	uint8_t ring[MSM_ISP_BUFQ_RING_SIZE];
+	uint32_t ring_head;
+	uint32_t ring_tail;
 	enum smmu_attach_mode security_mode;
 };
 
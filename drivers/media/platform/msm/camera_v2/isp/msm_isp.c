@@ -295,6 +295,10 @@ static int msm_isp_enable_debugfs(struct vfe_device *vfe_dev,
 		debugfs_base, vfe_dev, &ub_info_ops))
 		return -ENOMEM;
 
+	if (!debugfs_create_bool("bw_governor", 0644,
+		debugfs_base, &msm_isp_bw_gov_enable))
+		return -ENOMEM;
+
 	return 0;
 }
 
@@ -452,6 +452,8 @@ struct msm_vfe_axi_stream {
 	/*Based on format plane size in Q2. e.g NV12 = 1.5*/
 	uint32_t format_factor;
 	uint32_t bandwidth[MAX_VFE];
+	/* bytes written per frame, reported to the bandwidth governor */
+	uint32_t frame_bytes[MAX_VFE];
 
 	uint32_t runtime_num_burst_capture;
 	uint32_t runtime_output_format;
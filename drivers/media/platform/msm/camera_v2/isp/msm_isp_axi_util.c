@@ -1179,11 +1179,15 @@ static void msm_isp_calculate_bandwidth(
 	int bpp = 0;
 	struct vfe_device *vfe_dev;
 	struct msm_vfe_axi_shared_data *axi_data;
-	int i;
+	int i, j;
 
 	for (i = 0; i < stream_info->num_isp; i++) {
 		vfe_dev = stream_info->vfe_dev[i];
 		axi_data = &vfe_dev->axi_data;
+		stream_info->frame_bytes[i] = 0;
+		for (j = 0; j < stream_info->num_planes; j++)
+			stream_info->frame_bytes[i] +=
+				msm_isp_axi_get_plane_size(stream_info, i, j);
 		if (stream_info->stream_src < RDI_INTF_0) {
 			stream_info->bandwidth[i] =
 				(vfe_dev->vfe_clk_info[
@@ -2125,6 +2129,7 @@ static int msm_isp_process_done_buf(struct vfe_device *vfe_dev,
 	uint32_t buf_src;
 	uint8_t drop_frame = 0;
 	struct msm_isp_bufq *bufq = NULL;
+	int i;
 
 	memset(&buf_event, 0, sizeof(buf_event));
 
@@ -2133,6 +2138,12 @@ static int msm_isp_process_done_buf(struct vfe_device *vfe_dev,
 		return -EINVAL;
 	}
 
+	/* written by hardware even if software drops it below */
+	for (i = 0; i < stream_info->num_isp; i++)
+		msm_isp_bw_gov_account(
+			ISP_VFE0 + stream_info->vfe_dev[i]->pdev->id,
+			stream_info->frame_bytes[i]);
+
 	if (SRC_TO_INTF(stream_info->stream_src) >= VFE_SRC_MAX) {
 		pr_err_ratelimited("%s: Invalid stream index, put buf back to vb2 queue\n",
 			__func__);
@@ -2552,9 +2563,11 @@ static int msm_isp_update_stream_bandwidth(
 				stream_info->bandwidth[vfe_idx];
 		}
 		vfe_dev->total_bandwidth = total_bandwidth;
-		rc = msm_isp_update_bandwidth(ISP_VFE0 + vfe_dev->pdev->id,
+		rc = msm_isp_update_governed_bandwidth(
+			ISP_VFE0 + vfe_dev->pdev->id,
 			(total_bandwidth + vfe_dev->hw_info->min_ab),
-			(total_bandwidth + vfe_dev->hw_info->min_ib));
+			(total_bandwidth + vfe_dev->hw_info->min_ib),
+			vfe_dev->hw_info->min_ab);
 
 		if (rc < 0)
 			pr_err("%s: update failed rc %d stream src %d vfe dev %d\n",
@@ -13,6 +13,7 @@
 #include <linux/io.h>
 #include <media/v4l2-subdev.h>
 #include <linux/ratelimit.h>
+#include <linux/workqueue.h>
 
 #include "msm.h"
 #include "msm_isp_util.h"
@@ -30,6 +31,30 @@
 static DEFINE_MUTEX(bandwidth_mgr_mutex);
 static struct msm_isp_bandwidth_mgr isp_bandwidth_mgr;
 
+/*
+ * Bandwidth governor. The VFE ab vote is sized for the configured streams
+ * at the sensor line rate, while the frame rate actually produced is often
+ * lower. Count the bytes written per frame, and once per window lower the
+ * ab vote to the measured rate plus a guard band. The ib vote covers the
+ * line rate burst and is left alone. A new vote from stream configuration
+ * restores the full request right away.
+ */
+#define MSM_ISP_BW_GOV_WINDOW_MS 500
+#define MSM_ISP_BW_GOV_GUARD_PCT 25
+
+struct msm_isp_bw_gov_info {
+	atomic64_t bytes;
+	unsigned long start;
+	uint64_t req_ab;
+	uint64_t floor_ab;
+	bool governed;
+};
+
+bool msm_isp_bw_gov_enable = true;
+static struct msm_isp_bw_gov_info isp_bw_gov[MAX_ISP_CLIENT];
+static void msm_isp_bw_gov_work(struct work_struct *work);
+static DECLARE_DELAYED_WORK(isp_bw_gov_dwork, msm_isp_bw_gov_work);
+
 #define MSM_ISP_DUAL_VFE_MUTEX_LOCK(vfe_dev) { \
 	if (vfe_dev->is_split && vfe_dev->pdev->id == ISP_VFE0) { \
 		struct vfe_device *vfe1_dev = vfe_dev->common_data-> \
@@ -99,9 +124,60 @@ int msm_isp_init_bandwidth_mgr(struct vfe_device *vfe_dev,
 	return rc;
 }
 
-int msm_isp_update_bandwidth(enum msm_isp_hw_client client,
-	uint64_t ab, uint64_t ib)
+static void msm_isp_bw_gov_work(struct work_struct *work)
 {
+	struct msm_isp_bw_gov_info *gov;
+	struct msm_isp_bandwidth_info *client_info;
+	unsigned long now, elapsed;
+	uint64_t bytes, ab;
+	bool changed = false, governed = false;
+	int i;
+
+	mutex_lock(&bandwidth_mgr_mutex);
+	if (!isp_bandwidth_mgr.use_count || !isp_bandwidth_mgr.bus_client) {
+		mutex_unlock(&bandwidth_mgr_mutex);
+		return;
+	}
+
+	now = jiffies;
+	for (i = 0; i < MAX_ISP_CLIENT; i++) {
+		gov = &isp_bw_gov[i];
+		client_info = &isp_bandwidth_mgr.client_info[i];
+		if (!gov->governed || !client_info->active)
+			continue;
+		governed = true;
+		elapsed = now - gov->start;
+		if (elapsed < msecs_to_jiffies(MSM_ISP_BW_GOV_WINDOW_MS))
+			continue;
+
+		bytes = atomic64_xchg(&gov->bytes, 0);
+		gov->start = now;
+		/* no frames done yet, stay on the requested vote */
+		if (!msm_isp_bw_gov_enable || !bytes) {
+			ab = gov->req_ab;
+		} else {
+			ab = div_u64(bytes * HZ, elapsed);
+			ab += div_u64(ab * MSM_ISP_BW_GOV_GUARD_PCT, 100);
+			ab = clamp(ab, gov->floor_ab, gov->req_ab);
+		}
+		if (ab != client_info->ab) {
+			client_info->ab = ab;
+			changed = true;
+		}
+	}
+
+	if (changed)
+		isp_bandwidth_mgr.update_bw(&isp_bandwidth_mgr);
+	if (governed && msm_isp_bw_gov_enable)
+		schedule_delayed_work(&isp_bw_gov_dwork,
+			msecs_to_jiffies(MSM_ISP_BW_GOV_WINDOW_MS));
+	mutex_unlock(&bandwidth_mgr_mutex);
+}
+
+static int __msm_isp_update_bandwidth(enum msm_isp_hw_client client,
+	uint64_t ab, uint64_t ib, uint64_t floor_ab, bool governed)
+{
+	struct msm_isp_bw_gov_info *gov = &isp_bw_gov[client];
 	int rc;
 
 	mutex_lock(&bandwidth_mgr_mutex);
@@ -114,13 +190,45 @@ int msm_isp_update_bandwidth(enum msm_isp_hw_client client,
 		return -EINVAL;
 	}
 
+	/* restart the measurement window on every new request */
+	gov->req_ab = ab;
+	gov->floor_ab = min(floor_ab, ab);
+	gov->governed = governed && ab;
+	gov->start = jiffies;
+	atomic64_set(&gov->bytes, 0);
+
 	isp_bandwidth_mgr.client_info[client].ab = ab;
 	isp_bandwidth_mgr.client_info[client].ib = ib;
 	rc = isp_bandwidth_mgr.update_bw(&isp_bandwidth_mgr);
+	if (gov->governed && msm_isp_bw_gov_enable)
+		schedule_delayed_work(&isp_bw_gov_dwork,
+			msecs_to_jiffies(MSM_ISP_BW_GOV_WINDOW_MS));
 	mutex_unlock(&bandwidth_mgr_mutex);
 	return 0;
 }
 
+int msm_isp_update_bandwidth(enum msm_isp_hw_client client,
+	uint64_t ab, uint64_t ib)
+{
+	return __msm_isp_update_bandwidth(client, ab, ib, 0, false);
+}
+
+/*
+ * Same as msm_isp_update_bandwidth but lets the governor lower ab, down to
+ * floor_ab, based on the bytes reported with msm_isp_bw_gov_account.
+ */
+int msm_isp_update_governed_bandwidth(enum msm_isp_hw_client client,
+	uint64_t ab, uint64_t ib, uint64_t floor_ab)
+{
+	return __msm_isp_update_bandwidth(client, ab, ib, floor_ab, true);
+}
+
+void msm_isp_bw_gov_account(enum msm_isp_hw_client client, uint32_t bytes)
+{
+	if (client < MAX_ISP_CLIENT)
+		atomic64_add(bytes, &isp_bw_gov[client].bytes);
+}
+
 void msm_isp_deinit_bandwidth_mgr(enum msm_isp_hw_client client)
 {
 	if (client >= MAX_ISP_CLIENT) {
@@ -130,6 +238,7 @@ void msm_isp_deinit_bandwidth_mgr(enum msm_isp_hw_client client)
 	mutex_lock(&bandwidth_mgr_mutex);
 	memset(&isp_bandwidth_mgr.client_info[client], 0,
 			sizeof(struct msm_isp_bandwidth_info));
+	isp_bw_gov[client].governed = false;
 	if (isp_bandwidth_mgr.use_count) {
 		isp_bandwidth_mgr.use_count--;
 		if (isp_bandwidth_mgr.use_count) {
@@ -137,6 +246,9 @@ void msm_isp_deinit_bandwidth_mgr(enum msm_isp_hw_client client)
 			return;
 		}
 
+		/* the work takes bandwidth_mgr_mutex, can't sync here */
+		cancel_delayed_work(&isp_bw_gov_dwork);
+
 		if (!isp_bandwidth_mgr.bus_client) {
 			pr_err("%s:%d error: bus client invalid\n",
 				__func__, __LINE__);
@@ -35,6 +35,10 @@ int msm_isp_init_bandwidth_mgr(struct vfe_device *vfe_dev,
 			enum msm_isp_hw_client client);
 int msm_isp_update_bandwidth(enum msm_isp_hw_client client,
 			uint64_t ab, uint64_t ib);
+int msm_isp_update_governed_bandwidth(enum msm_isp_hw_client client,
+			uint64_t ab, uint64_t ib, uint64_t floor_ab);
+void msm_isp_bw_gov_account(enum msm_isp_hw_client client, uint32_t bytes);
+extern bool msm_isp_bw_gov_enable;
 void msm_isp_util_get_bandwidth_stats(struct vfe_device *vfe_dev,
 				      struct msm_isp_statistics *stats);
 void msm_isp_util_update_last_overflow_ab_ib(struct vfe_device *vfe_dev);
@@ -29,6 +29,8 @@ struct msm_jpeg_hw_buf {
 	int ion_fd;
 	uint32_t pln2_addr;
 	uint32_t pln2_len;
+	/* START to frame done, set on the session done event */
+	uint32_t session_us;
 };
 
 struct msm_jpeg_hw_pingpong {
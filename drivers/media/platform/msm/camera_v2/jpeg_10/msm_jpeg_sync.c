@@ -274,12 +274,21 @@ static int msm_jpeg_framedone_irq(struct msm_jpeg_device *pgmn_dev,
 	struct msm_jpeg_core_buf *buf_in)
 {
 	int rc = 0;
+	ktime_t now = ktime_get();
 
 	JPEG_DBG("%s:%d] Enter\n", __func__, __LINE__);
 
 	if (buf_in) {
 		buf_in->vbuf.framedone_len = buf_in->framedone_len;
 		buf_in->vbuf.type = MSM_JPEG_EVT_SESSION_DONE;
+		buf_in->session_us = ktime_us_delta(now,
+			pgmn_dev->start_time);
+		JPEG_DBG_HIGH("%s:%d] %s fetch %lld us session %u us\n",
+			__func__, __LINE__,
+			pgmn_dev->core_type == MSM_JPEG_CORE_DMA ?
+			"dma" : "encode",
+			ktime_us_delta(pgmn_dev->fetch_done_time,
+			pgmn_dev->start_time), buf_in->session_us);
 		JPEG_DBG("%s:%d] 0x%08x %d framedone_len %d\n",
 			__func__, __LINE__,
 			(int) buf_in->y_buffer_addr, buf_in->y_len,
@@ -315,6 +324,8 @@ static int msm_jpeg_evt_get(struct msm_jpeg_device *pgmn_dev,
 
 	memset(&ctrl_cmd, 0, sizeof(ctrl_cmd));
 	ctrl_cmd.type = buf_p->vbuf.type;
+	if (ctrl_cmd.type == MSM_JPEG_EVT_SESSION_DONE)
+		ctrl_cmd.len = buf_p->session_us;
 	kfree(buf_p);
 
 	if (ctrl_cmd.type == MSM_JPEG_EVT_SESSION_DONE) {
@@ -553,6 +564,7 @@ static int msm_jpeg_fe_pingpong_irq(struct msm_jpeg_device *pgmn_dev,
 		rc = -EFAULT;
 	}
 
+	pgmn_dev->fetch_done_time = ktime_get();
 	buf_out = msm_jpeg_q_out(&pgmn_dev->input_buf_q);
 
 	if (buf_out) {
@@ -947,6 +959,8 @@ static int msm_jpeg_start(struct msm_jpeg_device *pgmn_dev, void __user *arg,
 
 	JPEG_DBG_HIGH("%s:%d] START\n", __func__, __LINE__);
 	pgmn_dev->state = MSM_JPEG_EXECUTING;
+	pgmn_dev->start_time = ktime_get();
+	pgmn_dev->fetch_done_time = pgmn_dev->start_time;
 	/* ensure write is done */
 	wmb();
 	rc = hw_ioctl(pgmn_dev, arg);
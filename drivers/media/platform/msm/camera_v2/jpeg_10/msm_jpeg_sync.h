@@ -122,6 +122,10 @@ struct msm_jpeg_device {
 	enum msm_jpeg_state state;
 	enum msm_jpeg_core_type core_type;
 	enum cam_bus_client bus_client;
+
+	/* Stage timestamps of the running session */
+	ktime_t start_time;
+	ktime_t fetch_done_time;
 };
 
 int __msm_jpeg_open(struct msm_jpeg_device *pgmn_dev);
@@ -1120,6 +1120,11 @@ static int msm_jpegdma_g_ctrl(struct file *file, void *fh,
 		if (a->value < 0)
 			return -EINVAL;
 		break;
+	case V4L2_CID_JPEG_DMA_LAST_FRAME_US:
+		mutex_lock(&ctx->lock);
+		a->value = ctx->last_frame_us;
+		mutex_unlock(&ctx->lock);
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -1202,6 +1207,7 @@ static void msm_jpegdma_device_run(void *priv)
 		ctx->pending_config = 0;
 	}
 
+	ctx->run_time = ktime_get();
 	msm_jpegdma_process_buffers(ctx, src_buf, dst_buf);
 	dev_dbg(ctx->jdma_device->dev, "Jpeg v4l2 dma device run X\n");
 }
@@ -1267,6 +1273,10 @@ void msm_jpegdma_isr_processing_done(struct msm_jpegdma_device *dma)
 			}
 			complete_all(&ctx->completion);
 			ctx->plane_idx = 0;
+			ctx->last_frame_us = ktime_us_delta(ktime_get(),
+				ctx->run_time);
+			dev_dbg(ctx->jdma_device->dev, "frame done in %u us\n",
+				ctx->last_frame_us);
 
 			v4l2_m2m_buf_done(src_buf, VB2_BUF_STATE_DONE);
 			v4l2_m2m_buf_done(dst_buf, VB2_BUF_STATE_DONE);
@@ -273,6 +273,9 @@ struct jpegdma_ctx {
 
 	unsigned int plane_idx;
 	unsigned int format_idx;
+
+	ktime_t run_time;
+	unsigned int last_frame_us;
 };
 
 /*
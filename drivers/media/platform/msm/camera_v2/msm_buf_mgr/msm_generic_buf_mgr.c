@@ -94,7 +94,7 @@ static int32_t msm_buf_mngr_get_buf(struct msm_buf_mngr_device *dev,
 }
 
 static int32_t msm_buf_mngr_get_buf_by_idx(struct msm_buf_mngr_device *dev,
-	void *argp)
+	void *argp, bool handoff)
 {
 	unsigned long flags;
 	int32_t rc = 0;
@@ -112,8 +112,14 @@ static int32_t msm_buf_mngr_get_buf_by_idx(struct msm_buf_mngr_device *dev,
 	}
 
 	INIT_LIST_HEAD(&new_entry->entry);
-	new_entry->vb2_v4l2_buf = dev->vb2_ops.get_buf_by_idx(
-		buf_info->session_id, buf_info->stream_id, buf_info->index);
+	if (handoff)
+		new_entry->vb2_v4l2_buf = dev->vb2_ops.get_handoff_buf(
+			buf_info->session_id, buf_info->stream_id,
+			buf_info->index);
+	else
+		new_entry->vb2_v4l2_buf = dev->vb2_ops.get_buf_by_idx(
+			buf_info->session_id, buf_info->stream_id,
+			buf_info->index);
 	if (!new_entry->vb2_v4l2_buf) {
 		pr_debug("%s:Get buf is null\n", __func__);
 		kfree(new_entry);
@@ -139,6 +145,13 @@ static int32_t msm_buf_mngr_get_buf_by_idx(struct msm_buf_mngr_device *dev,
 	return rc;
 }
 
+static int32_t msm_buf_mngr_set_handoff(struct msm_buf_mngr_device *dev,
+	struct msm_buf_mngr_handoff_info *info)
+{
+	return dev->vb2_ops.set_handoff(info->session_id, info->stream_id,
+		info);
+}
+
 static int32_t msm_buf_mngr_buf_done(struct msm_buf_mngr_device *buf_mngr_dev,
 	struct msm_buf_mngr_info *buf_info)
 {
@@ -515,7 +528,8 @@ static int msm_cam_buf_mgr_ops(unsigned int cmd, void *argp)
 		struct msm_camera_private_ioctl_arg *k_ioctl = argp;
 
 		switch (k_ioctl->id) {
-		case MSM_CAMERA_BUF_MNGR_IOCTL_ID_GET_BUF_BY_IDX: {
+		case MSM_CAMERA_BUF_MNGR_IOCTL_ID_GET_BUF_BY_IDX:
+		case MSM_CAMERA_BUF_MNGR_IOCTL_ID_GET_HANDOFF_BUF: {
 			struct msm_buf_mngr_info *tmp = NULL;
 
 			if (!k_ioctl->ioctl_ptr)
@@ -526,7 +540,22 @@ static int msm_cam_buf_mgr_ops(unsigned int cmd, void *argp)
 			MSM_CAM_GET_IOCTL_ARG_PTR(&tmp, &k_ioctl->ioctl_ptr,
 				sizeof(tmp));
 			rc = msm_buf_mngr_get_buf_by_idx(msm_buf_mngr_dev,
-				tmp);
+				tmp, k_ioctl->id ==
+				MSM_CAMERA_BUF_MNGR_IOCTL_ID_GET_HANDOFF_BUF);
+			}
+			break;
+		case MSM_CAMERA_BUF_MNGR_IOCTL_ID_SET_HANDOFF: {
+			struct msm_buf_mngr_handoff_info *tmp = NULL;
+
+			if (!k_ioctl->ioctl_ptr)
+				return -EINVAL;
+			if (k_ioctl->size !=
+				sizeof(struct msm_buf_mngr_handoff_info))
+				return -EINVAL;
+
+			MSM_CAM_GET_IOCTL_ARG_PTR(&tmp, &k_ioctl->ioctl_ptr,
+				sizeof(tmp));
+			rc = msm_buf_mngr_set_handoff(msm_buf_mngr_dev, tmp);
 			}
 			break;
 		default:
@@ -574,7 +603,8 @@ static long msm_buf_mngr_subdev_ioctl(struct v4l2_subdev *sd,
 		ptr = arg;
 		k_ioctl = *ptr;
 		switch (k_ioctl.id) {
-		case MSM_CAMERA_BUF_MNGR_IOCTL_ID_GET_BUF_BY_IDX: {
+		case MSM_CAMERA_BUF_MNGR_IOCTL_ID_GET_BUF_BY_IDX:
+		case MSM_CAMERA_BUF_MNGR_IOCTL_ID_GET_HANDOFF_BUF: {
 			struct msm_buf_mngr_info buf_info, *tmp = NULL;
 
 			if (k_ioctl.size != sizeof(struct msm_buf_mngr_info))
@@ -595,6 +625,30 @@ static long msm_buf_mngr_subdev_ioctl(struct v4l2_subdev *sd,
 			rc = msm_cam_buf_mgr_ops(cmd, argp);
 			}
 			break;
+		case MSM_CAMERA_BUF_MNGR_IOCTL_ID_SET_HANDOFF: {
+			struct msm_buf_mngr_handoff_info info, *tmp = NULL;
+
+			if (k_ioctl.size !=
+				sizeof(struct msm_buf_mngr_handoff_info))
+				return -EINVAL;
+			if (!k_ioctl.ioctl_ptr)
+				return -EINVAL;
+			MSM_CAM_GET_IOCTL_ARG_PTR(&tmp, &k_ioctl.ioctl_ptr,
+				sizeof(tmp));
+			/* The layout is the same for compat tasks */
+			if (!is_compat_task()) {
+				if (copy_from_user(&info, tmp, sizeof(info)))
+					return -EFAULT;
+				k_ioctl.ioctl_ptr = (uintptr_t)&info;
+			}
+
+			argp = &k_ioctl;
+			rc = msm_cam_buf_mgr_ops(cmd, argp);
+			if (!rc && !is_compat_task() &&
+				copy_to_user(tmp, &info, sizeof(info)))
+				rc = -EFAULT;
+			}
+			break;
 		default:
 			pr_debug("unimplemented id %d", k_ioctl.id);
 			return -EINVAL;
@@ -698,7 +752,8 @@ static long msm_camera_buf_mgr_internal_compat_ioctl(struct file *file,
 	}
 
 	switch (k_ioctl.id) {
-	case MSM_CAMERA_BUF_MNGR_IOCTL_ID_GET_BUF_BY_IDX: {
+	case MSM_CAMERA_BUF_MNGR_IOCTL_ID_GET_BUF_BY_IDX:
+	case MSM_CAMERA_BUF_MNGR_IOCTL_ID_GET_HANDOFF_BUF: {
 		struct msm_buf_mngr_info32_t buf_info32;
 		struct msm_buf_mngr_info buf_info;
 
@@ -727,6 +782,26 @@ static long msm_camera_buf_mgr_internal_compat_ioctl(struct file *file,
 		}
 		}
 		break;
+	case MSM_CAMERA_BUF_MNGR_IOCTL_ID_SET_HANDOFF: {
+		struct msm_buf_mngr_handoff_info info;
+
+		if (k_ioctl.size != sizeof(info) || !tmp_compat_ioctl_ptr) {
+			pr_err("Invalid arg for id %d", k_ioctl.id);
+			return -EINVAL;
+		}
+		if (copy_from_user(&info, tmp_compat_ioctl_ptr, sizeof(info)))
+			return -EFAULT;
+		k_ioctl.ioctl_ptr = (__u64)&info;
+		rc = v4l2_subdev_call(sd, core, ioctl, cmd, &k_ioctl);
+		if (rc < 0) {
+			pr_err("Subdev cmd %d failed for id %d", cmd,
+				k_ioctl.id);
+			return rc;
+		}
+		if (copy_to_user(tmp_compat_ioctl_ptr, &info, sizeof(info)))
+			return -EFAULT;
+		}
+		break;
 	default:
 		pr_debug("unimplemented id %d", k_ioctl.id);
 		return -EINVAL;
@@ -68,6 +68,8 @@ struct msm_sd_req_sd {
 	struct v4l2_subdev *subdev;
 };
 
+struct msm_buf_mngr_handoff_info;
+
 struct msm_sd_req_vb2_q {
 	struct vb2_v4l2_buffer * (*get_buf)(int session_id,
 		unsigned int stream_id);
@@ -84,6 +86,13 @@ struct msm_sd_req_vb2_q {
 	int (*buf_error)(struct vb2_v4l2_buffer *vb2_v4l2_buf, int session_id,
 		unsigned int stream_id, uint32_t sequence, struct timeval *ts,
 		uint32_t reserved);
+	int (*buf_handoff)(struct vb2_v4l2_buffer *vb2_v4l2_buf,
+		int session_id, unsigned int stream_id, uint32_t sequence,
+		struct timeval *ts, uint32_t reserved);
+	struct vb2_v4l2_buffer * (*get_handoff_buf)(int session_id,
+		unsigned int stream_id, uint32_t index);
+	int (*set_handoff)(int session_id, unsigned int stream_id,
+		struct msm_buf_mngr_handoff_info *info);
 };
 
 #define MSM_SD_NOTIFY_GET_SD 0x00000001
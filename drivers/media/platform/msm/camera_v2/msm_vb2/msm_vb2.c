@@ -11,6 +11,7 @@
  */
 
 #define pr_fmt(fmt) "CAM-VB2 %s:%d " fmt, __func__, __LINE__
+#include <media/msmb_generic_buf_mgr.h>
 #include "msm_vb2.h"
 
 static int msm_vb2_queue_setup(struct vb2_queue *q,
@@ -103,6 +104,7 @@ static void msm_vb2_buf_queue(struct vb2_buffer *vb)
 	}
 
 	spin_lock_irqsave(&stream->stream_lock, flags);
+	msm_vb2->handoff = MSM_VB2_HANDOFF_NONE;
 	list_add_tail(&msm_vb2->list, &stream->queued_list);
 	spin_unlock_irqrestore(&stream->stream_lock, flags);
 	read_unlock_irqrestore(&session->stream_rwlock, rl_flags);
@@ -183,6 +185,7 @@ static void msm_vb2_stop_stream(struct vb2_queue *q)
 		vb2_buffer_done(&vb2_v4l2_buf->vb2_buf,
 			VB2_BUF_STATE_DONE);
 		msm_vb2->in_freeq = 0;
+		msm_vb2->handoff = MSM_VB2_HANDOFF_NONE;
 	}
 	spin_unlock_irqrestore(&stream->stream_lock, flags);
 	read_unlock_irqrestore(&session->stream_rwlock, rl_flags);
@@ -350,6 +353,24 @@ static struct vb2_v4l2_buffer *msm_vb2_get_buf_by_idx(int session_id,
 	return vb2_v4l2_buf;
 }
 
+/* Called with stream_lock held when a handed off buffer is returned */
+static void msm_vb2_handoff_account(struct msm_stream *stream,
+	struct msm_vb2_buffer *msm_vb2)
+{
+	uint32_t us;
+
+	if (msm_vb2->handoff == MSM_VB2_HANDOFF_CLAIMED) {
+		us = ktime_us_delta(ktime_get(), msm_vb2->handoff_time);
+		stream->handoff_cnt++;
+		stream->handoff_total_us += us;
+		stream->handoff_max_us = max(stream->handoff_max_us, us);
+		pr_debug("str_id=%d idx %d handoff to done %u us\n",
+			stream->stream_id,
+			msm_vb2->vb2_v4l2_buf.vb2_buf.index, us);
+	}
+	msm_vb2->handoff = MSM_VB2_HANDOFF_NONE;
+}
+
 static int msm_vb2_put_buf(struct vb2_v4l2_buffer *vb, int session_id,
 				unsigned int stream_id)
 {
@@ -392,6 +413,7 @@ static int msm_vb2_put_buf(struct vb2_v4l2_buffer *vb, int session_id,
 				vb2_v4l2_buf);
 		if (msm_vb2->in_freeq) {
 			msm_vb2->in_freeq = 0;
+			msm_vb2->handoff = MSM_VB2_HANDOFF_NONE;
 			rc = 0;
 		} else
 			rc = -EINVAL;
@@ -448,11 +470,16 @@ static int msm_vb2_buf_done(struct vb2_v4l2_buffer *vb, int session_id,
 				vb2_v4l2_buf);
 		/* put buf before buf done */
 		if (msm_vb2->in_freeq) {
-			vb2_v4l2_buf->sequence = sequence;
-			vb2_v4l2_buf->timecode.type = buf_type;
-			vb2_v4l2_buf->vb2_buf.timestamp =
-				((u64)ts->tv_sec * 1000000 +
-				ts->tv_usec) * 1000;
+			/* Handed off buffers keep the producer's frame info */
+			if (msm_vb2->handoff == MSM_VB2_HANDOFF_NONE) {
+				vb2_v4l2_buf->sequence = sequence;
+				vb2_v4l2_buf->timecode.type = buf_type;
+				vb2_v4l2_buf->vb2_buf.timestamp =
+					((u64)ts->tv_sec * 1000000 +
+					ts->tv_usec) * 1000;
+			} else {
+				msm_vb2_handoff_account(stream, msm_vb2);
+			}
 			vb2_buffer_done(&vb2_v4l2_buf->vb2_buf,
 				VB2_BUF_STATE_DONE);
 			msm_vb2->in_freeq = 0;
@@ -519,6 +546,7 @@ static int msm_vb2_buf_error(struct vb2_v4l2_buffer *vb, int session_id,
 			vb2_buffer_done(&vb2_v4l2_buf->vb2_buf,
 				VB2_BUF_STATE_ERROR);
 			msm_vb2->in_freeq = 0;
+			msm_vb2->handoff = MSM_VB2_HANDOFF_NONE;
 			rc = 0;
 		} else
 			rc = -EINVAL;
@@ -610,6 +638,7 @@ static int msm_vb2_flush_buf(int session_id, unsigned int stream_id)
 		/* Do buf done for all buffers*/
 		vb2_buffer_done(&vb2_v4l2_buf->vb2_buf, VB2_BUF_STATE_DONE);
 		msm_vb2->in_freeq = 0;
+		msm_vb2->handoff = MSM_VB2_HANDOFF_NONE;
 	}
 	spin_unlock_irqrestore(&stream->stream_lock, flags);
 	read_unlock_irqrestore(&session->stream_rwlock, rl_flags);
@@ -617,6 +646,157 @@ static int msm_vb2_flush_buf(int session_id, unsigned int stream_id)
 }
 
 
+/*
+ * Park a buffer the producer is done with for a kernel consumer instead of
+ * returning it to userspace. The buffer stays in_freeq so that get_buf does
+ * not hand it out again. Returns -EPERM if the stream has handoff disabled,
+ * the caller then does a normal buf_done.
+ */
+static int msm_vb2_buf_handoff(struct vb2_v4l2_buffer *vb, int session_id,
+				unsigned int stream_id, uint32_t sequence,
+				struct timeval *ts, uint32_t buf_type)
+{
+	unsigned long flags, rl_flags;
+	struct msm_vb2_buffer *msm_vb2;
+	struct msm_stream *stream;
+	struct msm_session *session;
+	int rc = -EINVAL;
+
+	if (!vb)
+		return -EINVAL;
+
+	session = msm_get_session(session_id);
+	if (IS_ERR_OR_NULL(session))
+		return -EINVAL;
+
+	read_lock_irqsave(&session->stream_rwlock, rl_flags);
+
+	stream = msm_get_stream(session, stream_id);
+	if (IS_ERR_OR_NULL(stream)) {
+		read_unlock_irqrestore(&session->stream_rwlock, rl_flags);
+		return -EINVAL;
+	}
+
+	spin_lock_irqsave(&stream->stream_lock, flags);
+	if (!stream->handoff) {
+		rc = -EPERM;
+		goto end;
+	}
+
+	list_for_each_entry(msm_vb2, &(stream->queued_list), list) {
+		if (&msm_vb2->vb2_v4l2_buf != vb)
+			continue;
+
+		if (!msm_vb2->in_freeq ||
+			msm_vb2->handoff != MSM_VB2_HANDOFF_NONE)
+			break;
+
+		vb->sequence = sequence;
+		vb->timecode.type = buf_type;
+		vb->vb2_buf.timestamp =
+			((u64)ts->tv_sec * 1000000 + ts->tv_usec) * 1000;
+		msm_vb2->handoff = MSM_VB2_HANDOFF_READY;
+		msm_vb2->handoff_time = ktime_get();
+		rc = 0;
+		break;
+	}
+	if (rc == -EINVAL)
+		pr_err("VB buffer is INVALID ses_id=%d, str_id=%d, vb=%pK\n",
+			session_id, stream_id, vb);
+end:
+	spin_unlock_irqrestore(&stream->stream_lock, flags);
+	read_unlock_irqrestore(&session->stream_rwlock, rl_flags);
+	return rc;
+}
+
+/* Claim a parked buffer, the consumer returns it with buf_done */
+static struct vb2_v4l2_buffer *msm_vb2_get_handoff_buf(int session_id,
+	unsigned int stream_id, uint32_t index)
+{
+	struct msm_stream *stream;
+	struct msm_session *session;
+	struct vb2_v4l2_buffer *vb2_v4l2_buf = NULL;
+	struct msm_vb2_buffer *msm_vb2;
+	unsigned long flags, rl_flags;
+
+	session = msm_get_session(session_id);
+	if (IS_ERR_OR_NULL(session))
+		return NULL;
+
+	read_lock_irqsave(&session->stream_rwlock, rl_flags);
+
+	stream = msm_get_stream(session, stream_id);
+	if (IS_ERR_OR_NULL(stream)) {
+		read_unlock_irqrestore(&session->stream_rwlock, rl_flags);
+		return NULL;
+	}
+
+	spin_lock_irqsave(&stream->stream_lock, flags);
+	list_for_each_entry(msm_vb2, &(stream->queued_list), list) {
+		if (msm_vb2->vb2_v4l2_buf.vb2_buf.index != index ||
+			msm_vb2->handoff != MSM_VB2_HANDOFF_READY)
+			continue;
+
+		msm_vb2->handoff = MSM_VB2_HANDOFF_CLAIMED;
+		vb2_v4l2_buf = &msm_vb2->vb2_v4l2_buf;
+		break;
+	}
+	spin_unlock_irqrestore(&stream->stream_lock, flags);
+	read_unlock_irqrestore(&session->stream_rwlock, rl_flags);
+	return vb2_v4l2_buf;
+}
+
+/*
+ * Enable or disable handoff on a stream and report the handoff to done
+ * latency since it was last enabled. Buffers still parked when handoff is
+ * disabled are returned to userspace.
+ */
+static int msm_vb2_set_handoff(int session_id, unsigned int stream_id,
+	struct msm_buf_mngr_handoff_info *info)
+{
+	struct msm_stream *stream;
+	struct msm_session *session;
+	struct msm_vb2_buffer *msm_vb2;
+	unsigned long flags, rl_flags;
+
+	session = msm_get_session(session_id);
+	if (IS_ERR_OR_NULL(session))
+		return -EINVAL;
+
+	read_lock_irqsave(&session->stream_rwlock, rl_flags);
+
+	stream = msm_get_stream(session, stream_id);
+	if (IS_ERR_OR_NULL(stream)) {
+		read_unlock_irqrestore(&session->stream_rwlock, rl_flags);
+		return -EINVAL;
+	}
+
+	spin_lock_irqsave(&stream->stream_lock, flags);
+	info->count = stream->handoff_cnt;
+	info->avg_us = stream->handoff_cnt ?
+		div_u64(stream->handoff_total_us, stream->handoff_cnt) : 0;
+	info->max_us = stream->handoff_max_us;
+
+	if (info->enable && !stream->handoff) {
+		stream->handoff_cnt = 0;
+		stream->handoff_total_us = 0;
+		stream->handoff_max_us = 0;
+	} else if (!info->enable) {
+		list_for_each_entry(msm_vb2, &(stream->queued_list), list) {
+			if (msm_vb2->handoff != MSM_VB2_HANDOFF_READY)
+				continue;
+			vb2_buffer_done(&msm_vb2->vb2_v4l2_buf.vb2_buf,
+				VB2_BUF_STATE_DONE);
+			msm_vb2->in_freeq = 0;
+			msm_vb2->handoff = MSM_VB2_HANDOFF_NONE;
+		}
+	}
+	stream->handoff = !!info->enable;
+	spin_unlock_irqrestore(&stream->stream_lock, flags);
+	read_unlock_irqrestore(&session->stream_rwlock, rl_flags);
+	return 0;
+}
+
 int msm_vb2_request_cb(struct msm_sd_req_vb2_q *req)
 {
 	if (!req) {
@@ -631,6 +811,9 @@ int msm_vb2_request_cb(struct msm_sd_req_vb2_q *req)
 	req->buf_done = msm_vb2_buf_done;
 	req->flush_buf = msm_vb2_flush_buf;
 	req->buf_error = msm_vb2_buf_error;
+	req->buf_handoff = msm_vb2_buf_handoff;
+	req->get_handoff_buf = msm_vb2_get_handoff_buf;
+	req->set_handoff = msm_vb2_set_handoff;
 	return 0;
 }
 
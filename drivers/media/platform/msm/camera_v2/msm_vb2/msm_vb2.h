@@ -31,6 +31,17 @@
 #include "msm.h"
 #include "msm_sd.h"
 
+/*
+ * A done buffer of a stream with handoff enabled is parked READY instead of
+ * being returned to userspace. A consumer claims it by index and returns it
+ * with buf_done once it has processed the frame.
+ */
+enum msm_vb2_handoff_state {
+	MSM_VB2_HANDOFF_NONE,
+	MSM_VB2_HANDOFF_READY,
+	MSM_VB2_HANDOFF_CLAIMED,
+};
+
 struct msm_vb2_buffer {
 	/*
 	 * vb2 buffer has to be first in the structure
@@ -40,6 +51,9 @@ struct msm_vb2_buffer {
 	struct vb2_v4l2_buffer vb2_v4l2_buf;
 	struct list_head list;
 	int in_freeq;
+	enum msm_vb2_handoff_state handoff;
+	/* Time the producer handed the buffer off */
+	ktime_t handoff_time;
 };
 
 struct msm_vb2_private_data {
@@ -60,6 +74,12 @@ struct msm_stream {
 	struct vb2_queue *vb2_q;
 	spinlock_t stream_lock;
 	struct list_head queued_list;
+	/* Done buffers are kept for a kernel consumer, see buf_handoff */
+	bool handoff;
+	/* Handoff to consumer buf_done latency */
+	uint32_t handoff_cnt;
+	uint64_t handoff_total_us;
+	uint32_t handoff_max_us;
 };
 
 struct vb2_ops *msm_vb2_get_q_ops(void);
@@ -1587,6 +1587,7 @@ static int cpp_close_node(struct v4l2_subdev *sd, struct v4l2_subdev_fh *fh)
 		cam_smmu_destroy_handle(cpp_dev->iommu_hdl);
 		msm_cpp_empty_list(processing_q, list_frame);
 		msm_cpp_empty_list(eventData_q, list_eventdata);
+		cpp_dev->coalesced_events = 0;
 		cpp_dev->state = CPP_STATE_OFF;
 
 		if (cpp_dev->ion_client) {
@@ -1637,18 +1638,44 @@ static int msm_cpp_buffer_ops(struct cpp_device *cpp_dev,
 	return rc;
 }
 
+static void msm_cpp_queue_frame_done_event(struct cpp_device *cpp_dev,
+	uint32_t inst_id, uint32_t num_frames)
+{
+	struct v4l2_event v4l2_evt;
+	struct msm_cpp_frame_done_event_t *done_evt;
+
+	memset(&v4l2_evt, 0, sizeof(v4l2_evt));
+	v4l2_evt.id = inst_id;
+	v4l2_evt.type = V4L2_EVENT_CPP_FRAME_DONE;
+	done_evt = (struct msm_cpp_frame_done_event_t *)v4l2_evt.u.data;
+	done_evt->num_frames = num_frames;
+	v4l2_event_queue(cpp_dev->msm_sd.sd.devnode, &v4l2_evt);
+}
+
 static int msm_cpp_notify_frame_done(struct cpp_device *cpp_dev,
 	uint8_t put_buf)
 {
-	struct v4l2_event v4l2_evt;
 	struct msm_queue_cmd *frame_qcmd = NULL;
 	struct msm_queue_cmd *event_qcmd = NULL;
 	struct msm_cpp_frame_info_t *processed_frame = NULL;
 	struct msm_device_queue *queue = &cpp_dev->processing_q;
 	struct msm_buf_mngr_info buff_mgr_info;
+	uint32_t num_events = 0;
+	unsigned long flags;
 	int rc = 0;
 
+	spin_lock_irqsave(&cpp_dev->event_coalesce_lock, flags);
 	frame_qcmd = msm_dequeue(queue, list_frame, POP_FRONT);
+	if (frame_qcmd) {
+		if (frame_qcmd->coalesce_event) {
+			cpp_dev->coalesced_events++;
+		} else {
+			num_events = cpp_dev->coalesced_events + 1;
+			cpp_dev->coalesced_events = 0;
+		}
+	}
+	spin_unlock_irqrestore(&cpp_dev->event_coalesce_lock, flags);
+
 	if (frame_qcmd) {
 		processed_frame = frame_qcmd->command;
 		do_gettimeofday(&(processed_frame->out_time));
@@ -1749,9 +1776,9 @@ static int msm_cpp_notify_frame_done(struct cpp_device *cpp_dev,
 			}
 		}
 NOTIFY_FRAME_DONE:
-		v4l2_evt.id = processed_frame->inst_id;
-		v4l2_evt.type = V4L2_EVENT_CPP_FRAME_DONE;
-		v4l2_event_queue(cpp_dev->msm_sd.sd.devnode, &v4l2_evt);
+		if (num_events)
+			msm_cpp_queue_frame_done_event(cpp_dev,
+				processed_frame->inst_id, num_events);
 	}
 	return rc;
 }
@@ -2881,6 +2908,7 @@ static int msm_cpp_cfg_frame(struct cpp_device *cpp_dev,
 
 	atomic_set(&frame_qcmd->on_heap, 1);
 	frame_qcmd->command = new_frame;
+	frame_qcmd->coalesce_event = cpp_dev->batch_coalesce;
 	rc = msm_cpp_send_frame_to_hardware(cpp_dev, frame_qcmd);
 	if (rc < 0) {
 		pr_err("%s: error cannot send frame to hardware\n", __func__);
@@ -2946,6 +2974,96 @@ static int msm_cpp_cfg(struct cpp_device *cpp_dev,
 	return rc;
 }
 
+/*
+ * Called when a batch was only partly submitted. The frames already sent
+ * are waiting for a last frame that never made it to the hardware, so
+ * either let the newest queued frame raise the event or, if they are all
+ * done already, raise it here.
+ */
+static void msm_cpp_flush_coalesced_events(struct cpp_device *cpp_dev,
+	uint32_t inst_id)
+{
+	struct msm_device_queue *queue = &cpp_dev->processing_q;
+	struct msm_queue_cmd *qcmd;
+	uint32_t num_events = 0;
+	unsigned long flags;
+
+	spin_lock_irqsave(&cpp_dev->event_coalesce_lock, flags);
+	spin_lock(&queue->lock);
+	qcmd = list_empty(&queue->list) ? NULL :
+		list_last_entry(&queue->list, struct msm_queue_cmd, list_frame);
+	if (qcmd && qcmd->coalesce_event) {
+		qcmd->coalesce_event = 0;
+	} else {
+		num_events = cpp_dev->coalesced_events;
+		cpp_dev->coalesced_events = 0;
+	}
+	spin_unlock(&queue->lock);
+	spin_unlock_irqrestore(&cpp_dev->event_coalesce_lock, flags);
+
+	if (num_events)
+		msm_cpp_queue_frame_done_event(cpp_dev, inst_id, num_events);
+}
+
+static int msm_cpp_cfg_batch(struct cpp_device *cpp_dev,
+	struct msm_camera_v4l2_ioctl_t *ioctl_ptr)
+{
+	struct msm_cpp_frame_batch_t batch;
+	struct msm_camera_v4l2_ioctl_t frame_ioctl;
+	struct msm_cpp_frame_info_t __user *u_frame;
+	uint32_t inst_id, batch_inst_id = 0;
+	uint32_t i;
+	int32_t rc = 0;
+
+	if (copy_from_user(&batch, (void __user *)ioctl_ptr->ioctl_ptr,
+			sizeof(batch))) {
+		ERR_COPY_FROM_USER();
+		return -EFAULT;
+	}
+
+	/* the whole batch has to fit in the microcontroller queue */
+	if (!batch.num_frames ||
+		batch.num_frames > MSM_CPP_MAX_BATCH_FRAMES ||
+		batch.num_frames > MAX_CPP_PROCESSING_FRAME) {
+		pr_err("%s: invalid number of frames %d\n", __func__,
+			batch.num_frames);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < batch.num_frames; i++) {
+		u_frame = (struct msm_cpp_frame_info_t __user *)
+			batch.frame_info[i];
+		if (copy_from_user(&inst_id, &u_frame->inst_id,
+				sizeof(inst_id))) {
+			ERR_COPY_FROM_USER();
+			return -EFAULT;
+		}
+		if (i && inst_id != batch_inst_id) {
+			pr_err("%s: frames of instances %x and %x in batch\n",
+				__func__, batch_inst_id, inst_id);
+			return -EINVAL;
+		}
+		batch_inst_id = inst_id;
+	}
+
+	for (i = 0; i < batch.num_frames; i++) {
+		memset(&frame_ioctl, 0, sizeof(frame_ioctl));
+		frame_ioctl.len = sizeof(struct msm_cpp_frame_info_t);
+		frame_ioctl.ioctl_ptr = (void __user *)batch.frame_info[i];
+		cpp_dev->batch_coalesce = (i < batch.num_frames - 1);
+		rc = msm_cpp_cfg(cpp_dev, &frame_ioctl);
+		if (rc < 0)
+			break;
+	}
+	cpp_dev->batch_coalesce = false;
+
+	if (rc < 0 && i)
+		msm_cpp_flush_coalesced_events(cpp_dev, batch_inst_id);
+
+	ioctl_ptr->trans_code = rc;
+	return rc;
+}
+
 static void msm_cpp_clean_queue(struct cpp_device *cpp_dev)
 {
 	struct msm_queue_cmd *frame_qcmd = NULL;
@@ -3247,6 +3365,10 @@ static long msm_cpp_subdev_ioctl(struct v4l2_subdev *sd,
 		CPP_DBG("VIDIOC_MSM_CPP_CFG\n");
 		rc = msm_cpp_cfg(cpp_dev, ioctl_ptr);
 		break;
+	case VIDIOC_MSM_CPP_CFG_BATCH:
+		CPP_DBG("VIDIOC_MSM_CPP_CFG_BATCH\n");
+		rc = msm_cpp_cfg_batch(cpp_dev, ioctl_ptr);
+		break;
 	case VIDIOC_MSM_CPP_FLUSH_QUEUE:
 		CPP_DBG("VIDIOC_MSM_CPP_FLUSH_QUEUE\n");
 		rc = msm_cpp_flush_frames(cpp_dev);
@@ -4651,6 +4773,7 @@ static int cpp_probe(struct platform_device *pdev)
 
 	msm_queue_init(&cpp_dev->eventData_q, "eventdata");
 	msm_queue_init(&cpp_dev->processing_q, "frame");
+	spin_lock_init(&cpp_dev->event_coalesce_lock);
 	INIT_LIST_HEAD(&cpp_dev->tasklet_q);
 	tasklet_init(&cpp_dev->cpp_tasklet, msm_cpp_do_tasklet,
 		(unsigned long)cpp_dev);
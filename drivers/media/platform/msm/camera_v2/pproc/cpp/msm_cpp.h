@@ -158,6 +158,7 @@ struct msm_queue_cmd {
 	struct timespec ts;
 	uint32_t error_code;
 	uint32_t trans_code;
+	uint8_t coalesce_event;
 };
 
 struct msm_device_queue {
@@ -281,6 +282,11 @@ struct cpp_device {
 	 */
 	struct msm_device_queue processing_q;
 
+	/* frame done events held back until the end of a frame batch */
+	spinlock_t event_coalesce_lock;
+	uint32_t coalesced_events;
+	bool batch_coalesce;
+
 	struct msm_cpp_buff_queue_info_t *buff_queue;
 	uint32_t num_buffq;
 	struct msm_cam_buf_mgr_req_ops buf_mgr_ops;
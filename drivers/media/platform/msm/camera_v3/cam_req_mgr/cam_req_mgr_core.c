@@ -53,6 +53,7 @@ void cam_req_mgr_core_link_reset(struct cam_req_mgr_core_link *link)
 	link->sof_timestamp = 0;
 	link->prev_sof_timestamp = 0;
 	link->num_sof_src = 0;
+	link->trigger_ts = ktime_set(0, 0);
 }
 
 void cam_req_mgr_handle_core_shutdown(void)
@@ -71,6 +72,29 @@ void cam_req_mgr_handle_core_shutdown(void)
 	}
 }
 
+/**
+ * __cam_req_mgr_create_link_workq()
+ *
+ * @brief : create the worker of a link, a SCHED_FIFO kthread of its own
+ *          unless link_rt_prio is 0
+ * @link  : link the worker is created for
+ * @name  : name of the worker
+ *
+ * @return: 0 for success, negative for failure
+ */
+static int __cam_req_mgr_create_link_workq(struct cam_req_mgr_core_link *link,
+	char *name)
+{
+	if (g_crm_core_dev->link_rt_prio)
+		return cam_req_mgr_workq_create_rt(name, CRM_WORKQ_NUM_TASKS,
+			&link->workq, CRM_WORKQ_USAGE_NON_IRQ,
+			g_crm_core_dev->link_rt_prio);
+
+	return cam_req_mgr_workq_create(name, CRM_WORKQ_NUM_TASKS,
+		&link->workq, CRM_WORKQ_USAGE_NON_IRQ,
+		CAM_WORKQ_FLAG_HIGH_PRIORITY | CAM_WORKQ_FLAG_SERIAL);
+}
+
 static int __cam_req_mgr_setup_payload(struct cam_req_mgr_core_workq *workq)
 {
 	int32_t                  i = 0;
@@ -443,6 +467,32 @@ static int __cam_req_mgr_check_next_req_slot(
 	return rc;
 }
 
+/**
+ * __cam_req_mgr_update_apply_stats()
+ *
+ * @brief    : account the time from trigger notification to apply for a dev
+ * @link     : link whose trigger is being processed
+ * @dev      : device the request is about to be applied on
+ *
+ */
+static void __cam_req_mgr_update_apply_stats(
+	struct cam_req_mgr_core_link *link,
+	struct cam_req_mgr_connected_device *dev)
+{
+	struct cam_req_mgr_apply_stats *stats = &dev->stats;
+	uint64_t us;
+
+	if (!ktime_to_ns(link->trigger_ts))
+		return;
+
+	us = ktime_us_delta(ktime_get(), link->trigger_ts);
+	stats->count++;
+	stats->last = us;
+	stats->total += us;
+	if (us > stats->max)
+		stats->max = us;
+}
+
 /**
  * __cam_req_mgr_send_req()
  *
@@ -496,6 +546,7 @@ static int __cam_req_mgr_send_req(struct cam_req_mgr_core_link *link,
 			link->req.apply_data[pd].req_id;
 		apply_req.trigger_point = trigger;
 		if (dev->ops && dev->ops->apply_req) {
+			__cam_req_mgr_update_apply_stats(link, dev);
 			rc = dev->ops->apply_req(&apply_req);
 			if (rc)
 				return rc;
@@ -548,6 +599,7 @@ static int __cam_req_mgr_send_req(struct cam_req_mgr_core_link *link,
 				"SEND: link_hdl: %x pd %d req_id %lld",
 				link->link_hdl, pd, apply_req.request_id);
 			if (dev->ops && dev->ops->apply_req) {
+				__cam_req_mgr_update_apply_stats(link, dev);
 				rc = dev->ops->apply_req(&apply_req);
 				if (rc < 0)
 					break;
@@ -2288,7 +2340,9 @@ static int cam_req_mgr_process_trigger(void *priv, void *data)
 		__cam_req_mgr_inc_idx(&in_q->rd_idx, 1, in_q->num_slots);
 	}
 
+	link->trigger_ts = task_data->ts;
 	rc = __cam_req_mgr_process_req(link, trigger_data);
+	link->trigger_ts = ktime_set(0, 0);
 
 release_lock:
 	mutex_unlock(&link->req.lock);
@@ -2538,6 +2592,7 @@ static int cam_req_mgr_cb_notify_trigger(
 	notify_trigger->dev_hdl = trigger_data->dev_hdl;
 	notify_trigger->trigger = trigger_data->trigger;
 	notify_trigger->sof_timestamp_val = trigger_data->sof_timestamp_val;
+	task_data->ts = ktime_get();
 	task->process_cb = &cam_req_mgr_process_trigger;
 	rc = cam_req_mgr_workq_enqueue_task(task, link, CRM_TASK_PRIORITY_0);
 
@@ -2879,7 +2934,6 @@ int cam_req_mgr_destroy_session(
 int cam_req_mgr_link(struct cam_req_mgr_ver_info *link_info)
 {
 	int                                     rc = 0;
-	int                                     wq_flag = 0;
 	char                                    buf[128];
 	struct cam_create_dev_hdl               root_dev;
 	struct cam_req_mgr_core_session        *cam_session;
@@ -2952,9 +3006,7 @@ int cam_req_mgr_link(struct cam_req_mgr_ver_info *link_info)
 	/* Create worker for current link */
 	snprintf(buf, sizeof(buf), "%x-%x",
 		link_info->u.link_info_v1.session_hdl, link->link_hdl);
-	wq_flag = CAM_WORKQ_FLAG_HIGH_PRIORITY | CAM_WORKQ_FLAG_SERIAL;
-	rc = cam_req_mgr_workq_create(buf, CRM_WORKQ_NUM_TASKS,
-		&link->workq, CRM_WORKQ_USAGE_NON_IRQ, wq_flag);
+	rc = __cam_req_mgr_create_link_workq(link, buf);
 	if (rc < 0) {
 		CAM_ERR(CAM_CRM, "FATAL: unable to create worker");
 		__cam_req_mgr_destroy_link_info(link);
@@ -2987,7 +3039,6 @@ int cam_req_mgr_link(struct cam_req_mgr_ver_info *link_info)
 int cam_req_mgr_link_v2(struct cam_req_mgr_ver_info *link_info)
 {
 	int                                     rc = 0;
-	int                                     wq_flag = 0;
 	char                                    buf[128];
 	struct cam_create_dev_hdl               root_dev;
 	struct cam_req_mgr_core_session        *cam_session;
@@ -3061,9 +3112,7 @@ int cam_req_mgr_link_v2(struct cam_req_mgr_ver_info *link_info)
 	/* Create worker for current link */
 	snprintf(buf, sizeof(buf), "%x-%x",
 		link_info->u.link_info_v2.session_hdl, link->link_hdl);
-	wq_flag = CAM_WORKQ_FLAG_HIGH_PRIORITY | CAM_WORKQ_FLAG_SERIAL;
-	rc = cam_req_mgr_workq_create(buf, CRM_WORKQ_NUM_TASKS,
-		&link->workq, CRM_WORKQ_USAGE_NON_IRQ, wq_flag);
+	rc = __cam_req_mgr_create_link_workq(link, buf);
 	if (rc < 0) {
 		CAM_ERR(CAM_CRM, "FATAL: unable to create worker");
 		__cam_req_mgr_destroy_link_info(link);
@@ -3564,6 +3613,7 @@ int cam_req_mgr_core_device_init(void)
 	CAM_DBG(CAM_CRM, "g_crm_core_dev %pK", g_crm_core_dev);
 	INIT_LIST_HEAD(&g_crm_core_dev->session_head);
 	mutex_init(&g_crm_core_dev->crm_lock);
+	g_crm_core_dev->link_rt_prio = CRM_LINK_RT_PRIO_DEFAULT;
 	cam_req_mgr_debug_register(g_crm_core_dev);
 
 	for (i = 0; i < MAXIMUM_LINKS_PER_SESSION; i++) {
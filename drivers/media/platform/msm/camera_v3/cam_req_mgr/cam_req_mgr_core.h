@@ -12,6 +12,7 @@
 #ifndef _CAM_REQ_MGR_CORE_H_
 #define _CAM_REQ_MGR_CORE_H_
 
+#include <linux/ktime.h>
 #include <linux/spinlock.h>
 #include "cam_req_mgr_interface.h"
 #include "cam_req_mgr_core_defs.h"
@@ -30,6 +31,9 @@
 
 #define CRM_WORKQ_NUM_TASKS 60
 
+/* SCHED_FIFO priority of link workers, 0 selects a kworker pool */
+#define CRM_LINK_RT_PRIO_DEFAULT 1
+
 #define MAX_SYNC_COUNT 65535
 
 /* Default frame rate is 30 */
@@ -71,6 +75,7 @@ enum crm_workq_task_type {
  * @apply_req      : contains info of which request is applied at device
  * @notify_trigger : contains notification from IFE to CRM about trigger
  * @notify_err     : contains error info happened while processing request
+ * @ts             : time the task was queued
  * -
  */
 struct crm_task_payload {
@@ -83,6 +88,7 @@ struct crm_task_payload {
 		struct cam_req_mgr_trigger_notify       notify_trigger;
 		struct cam_req_mgr_error_notify         notify_err;
 	} u;
+	ktime_t                  ts;
 };
 
 /**
@@ -266,6 +272,21 @@ struct cam_req_mgr_req_data {
 	struct mutex                  lock;
 };
 
+/**
+ * struct cam_req_mgr_apply_stats
+ * - Trigger to apply latency of a device, in usec
+ * @count : number of requests applied on a trigger
+ * @last  : latency of the last apply
+ * @max   : worst latency seen
+ * @total : sum of all latencies, for the average
+ */
+struct cam_req_mgr_apply_stats {
+	uint64_t count;
+	uint64_t last;
+	uint64_t max;
+	uint64_t total;
+};
+
 /**
  * struct cam_req_mgr_connected_device
  * - Device Properties
@@ -276,6 +297,7 @@ struct cam_req_mgr_req_data {
  * @dev_info : holds dev characteristics such as pipeline delay, dev name
  * @ops      : holds func pointer to call methods on this device
  * @parent   : pvt data - like link which this dev hdl belongs to
+ * @stats    : latency from trigger notification to apply_req
  */
 struct cam_req_mgr_connected_device {
 	int32_t                         dev_hdl;
@@ -284,6 +306,7 @@ struct cam_req_mgr_connected_device {
 	struct cam_req_mgr_device_info  dev_info;
 	struct cam_req_mgr_kmd_ops     *ops;
 	void                           *parent;
+	struct cam_req_mgr_apply_stats  stats;
 };
 
 /**
@@ -328,6 +351,8 @@ struct cam_req_mgr_dev_sof_evt {
  * @open_req_cnt         : Counter to keep track of open requests that are yet
  *                         to be serviced in the kernel.
  * @last_flush_id        : Last request to flush
+ * @trigger_ts           : time of the trigger being processed, 0 outside
+ *                         of trigger processing
  * @is_used              : 1 if link is in use else 0
  * @is_master            : Based on pd among links, the link with the highest pd
  *                         is assigned as master
@@ -361,6 +386,7 @@ struct cam_req_mgr_core_link {
 	bool                                 sync_link_sof_skip;
 	int32_t                              open_req_cnt;
 	uint32_t                             last_flush_id;
+	ktime_t                              trigger_ts;
 	atomic_t                             is_used;
 	bool                                 is_master;
 	bool                                 initial_skip;
@@ -403,10 +429,13 @@ struct cam_req_mgr_core_session {
  * - Core camera request manager data struct
  * @session_head : list head holding sessions
  * @crm_lock     : mutex lock to protect session creation & destruction
+ * @link_rt_prio : SCHED_FIFO priority of workers of new links, 0 to use
+ *                 a high priority workqueue instead
  */
 struct cam_req_mgr_core_device {
 	struct list_head             session_head;
 	struct mutex                 crm_lock;
+	u32                          link_rt_prio;
 };
 
 /**
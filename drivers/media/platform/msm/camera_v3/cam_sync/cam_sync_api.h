@@ -88,6 +88,22 @@ int cam_sync_deregister_callback(sync_callback cb_func,
  */
 int cam_sync_signal(int32_t sync_obj, uint32_t status);
 
+/**
+ * @brief: Signals several sync objects with one call
+ *
+ * Works like cam_sync_signal() on each entry, but the kernel callbacks of
+ * all signaled objects, including merged parents, are dispatched from a
+ * single work item instead of one each. All entries are signaled even if
+ * some fail.
+ *
+ * @param signals: Array of sync objects and the status to signal each with
+ * @param num_signals: Number of entries, at most CAM_SYNC_MAX_SIGNAL_BATCH
+ *
+ * @return Status of operation. The first error met, zero otherwise.
+ */
+int cam_sync_signal_batch(struct cam_sync_signal *signals,
+	uint32_t num_signals);
+
 /**
  * @brief: Merges multiple sync objects
  *
@@ -171,6 +171,18 @@ struct cam_signalable_info {
 	struct list_head list;
 };
 
+/**
+ * struct sync_cb_batch - Kernel callbacks of a batch of signaled objects,
+ * dispatched from a single work item
+ *
+ * @work    : Work that invokes every callback on @cb_list
+ * @cb_list : Callbacks, linked through their list member
+ */
+struct sync_cb_batch {
+	struct work_struct work;
+	struct list_head cb_list;
+};
+
 /**
  * struct sync_device - Internal struct to book keep sync driver details
  *
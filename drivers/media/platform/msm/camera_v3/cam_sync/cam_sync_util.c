@@ -304,8 +304,25 @@ void cam_sync_util_cb_dispatch(struct work_struct *cb_dispatch_work)
 	kfree(cb_info);
 }
 
+void cam_sync_util_cb_batch_dispatch(struct work_struct *work)
+{
+	struct sync_cb_batch *batch = container_of(work,
+		struct sync_cb_batch, work);
+	struct sync_callback_info *cb_info, *temp;
+
+	list_for_each_entry_safe(cb_info, temp, &batch->cb_list, list) {
+		list_del_init(&cb_info->list);
+		cb_info->callback_func(cb_info->sync_obj,
+			cb_info->status,
+			cb_info->cb_data);
+		kfree(cb_info);
+	}
+
+	kfree(batch);
+}
+
 void cam_sync_util_dispatch_signaled_cb(int32_t sync_obj,
-	uint32_t status)
+	uint32_t status, struct list_head *cb_list)
 {
 	struct sync_callback_info  *sync_cb;
 	struct sync_user_payload   *payload_info;
@@ -324,6 +341,10 @@ void cam_sync_util_dispatch_signaled_cb(int32_t sync_obj,
 	list_for_each_entry_safe(sync_cb,
 		temp_sync_cb, &signalable_row->callback_list, list) {
 		sync_cb->status = status;
+		if (cb_list) {
+			list_move_tail(&sync_cb->list, cb_list);
+			continue;
+		}
 		list_del_init(&sync_cb->list);
 		queue_work(sync_dev->work_queue,
 			&sync_cb->cb_dispatch_work);
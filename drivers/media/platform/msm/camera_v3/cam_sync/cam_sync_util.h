@@ -86,16 +86,27 @@ int cam_sync_deinit_object(struct sync_table_row *table, uint32_t idx);
  */
 void cam_sync_util_cb_dispatch(struct work_struct *cb_dispatch_work);
 
+/**
+ * @brief: Function to dispatch the kernel callbacks of a signaled batch
+ *
+ * @param work : Pointer to the work_struct of a struct sync_cb_batch
+ *
+ * @return None
+ */
+void cam_sync_util_cb_batch_dispatch(struct work_struct *work);
+
 /**
  * @brief: Function to dispatch callbacks for a signaled sync object
  *
  * @sync_obj : Sync object that is signaled
  * @status   : Status of the signaled object
+ * @cb_list  : If not NULL, kernel callbacks are moved here for the caller
+ *             to dispatch instead of getting a work item each
  *
  * @return None
  */
 void cam_sync_util_dispatch_signaled_cb(int32_t sync_obj,
-	uint32_t status);
+	uint32_t status, struct list_head *cb_list);
 
 /**
  * @brief: Function to send V4L event to user space
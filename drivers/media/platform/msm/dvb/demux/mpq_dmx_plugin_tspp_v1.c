@@ -78,6 +78,13 @@
 /* Channel timeout in msec */
 #define TSPP_CHANNEL_TIMEOUT			100
 
+/*
+ * Descriptors per notification in bulk mode. Each bulk descriptor holds
+ * 170 packets, so a 20MBit/sec stream gives about 41 notifications
+ * per second.
+ */
+#define TSPP_BULK_NOTIFICATION_SIZE		2
+
 enum mem_buffer_allocation_mode {
 	MPQ_DMX_TSPP_INTERNAL_ALLOC = 0,
 	MPQ_DMX_TSPP_CONTIGUOUS_PHYS_ALLOC = 1
@@ -91,6 +98,12 @@ static int tspp_notification_size =
 	TSPP_NOTIFICATION_SIZE(TSPP_DEFAULT_DESCRIPTOR_SIZE);
 static int tspp_channel_timeout = TSPP_CHANNEL_TIMEOUT;
 static int tspp_out_ion_heap = ION_QSECOM_HEAP_ID;
+/*
+ * When non-zero, use the largest descriptors TSPP supports and notify
+ * every 'tspp_bulk_mode' descriptors. Overrides tspp_desc_size and
+ * tspp_notification_size.
+ */
+static int tspp_bulk_mode;
 
 module_param(allocation_mode, int, 0644);
 module_param(tspp_out_buffer_size, int, 0644);
@@ -98,6 +111,7 @@ module_param(tspp_desc_size, int, 0644);
 module_param(tspp_notification_size, int, 0644);
 module_param(tspp_channel_timeout, int, 0644);
 module_param(tspp_out_ion_heap, int, 0644);
+module_param(tspp_bulk_mode, int, 0644);
 
 /* The following structure hold singleton information
  * required for dmx implementation on top of TSPP.
@@ -1034,8 +1048,14 @@ static int mpq_tspp_dmx_add_channel(struct dvb_demux_feed *feed)
 	 * Recalculate 'tspp_notification_size' and buffer count in case
 	 * 'tspp_desc_size' or 'tspp_out_buffer_size' parameters have changed.
 	 */
+	if (tspp_bulk_mode > 0) {
+		tspp_desc_size = tspp_get_bulk_buffer_size(TSPP_MODE_RAW);
+		tspp_notification_size = tspp_bulk_mode;
+	} else {
+		tspp_notification_size =
+			TSPP_NOTIFICATION_SIZE(tspp_desc_size);
+	}
 	buffer_size = tspp_desc_size;
-	tspp_notification_size = TSPP_NOTIFICATION_SIZE(tspp_desc_size);
 	mpq_dmx_tspp_info.tsif[tsif].buffer_count =
 			TSPP_BUFFER_COUNT(tspp_out_buffer_size);
 	if (mpq_dmx_tspp_info.tsif[tsif].buffer_count >
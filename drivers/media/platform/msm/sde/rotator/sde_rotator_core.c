@@ -260,17 +260,21 @@ static void sde_rotator_set_clk_rate(struct sde_rot_mgr *mgr,
 	struct clk *clk = sde_rotator_get_clk(mgr, clk_idx);
 	int ret;
 
-	if (clk) {
+	if (clk && mgr->rot_clk[clk_idx].rate == rate) {
+		SDEROT_DBG("rotator clk rate %lu already requested\n", rate);
+	} else if (clk) {
 		clk_rate = clk_round_rate(clk, rate);
 		if (IS_ERR_VALUE(clk_rate)) {
 			SDEROT_ERR("unable to round rate err=%ld\n", clk_rate);
 		} else {
 			ret = clk_set_rate(clk, clk_rate);
-			if (ret < 0)
+			if (ret < 0) {
 				SDEROT_ERR("clk_set_rate failed, err:%d\n",
 						ret);
-			else
+			} else {
 				SDEROT_DBG("rotator clk rate=%lu\n", clk_rate);
+				mgr->rot_clk[clk_idx].rate = rate;
+			}
 		}
 	} else {
 		SDEROT_ERR("rotator clk not setup properly\n");
@@ -360,8 +364,11 @@ static void sde_rotator_disable_clk(struct sde_rot_mgr *mgr, int clk_idx)
 	struct clk *clk;
 
 	clk = sde_rotator_get_clk(mgr, clk_idx);
-	if (clk)
+	if (clk) {
 		clk_disable_unprepare(clk);
+		/* recheck the hw rate on the next request */
+		mgr->rot_clk[clk_idx].rate = 0;
+	}
 }
 
 int sde_rotator_clk_ctrl(struct sde_rot_mgr *mgr, int enable)
@@ -1344,6 +1351,7 @@ static int sde_rotator_calc_perf(struct sde_rot_mgr *mgr,
 	 *        W x H / throughput / (1/fps - overhead) * fudge_factor
 	 */
 	max_fps = sde_rotator_find_max_fps(mgr);
+	perf->max_fps = max_fps;
 	perf->clk_rate = config->input.width * config->input.height;
 	perf->clk_rate = (perf->clk_rate * mgr->pixel_per_clk.denom) /
 			mgr->pixel_per_clk.numer;
@@ -2355,11 +2363,23 @@ static int sde_rotator_config_session(struct sde_rot_mgr *mgr,
 		return -EINVAL;
 	}
 
+	/*
+	 * Clients commit the same config for every frame, so skip the perf
+	 * calculation and the bus/clk revote if nothing it depends on moved.
+	 */
+	if (perf->clk_rate && !memcmp(&perf->config, config, sizeof(*config))
+			&& perf->max_fps == sde_rotator_find_max_fps(mgr)) {
+		SDEROT_DBG("session id=%u config unchanged\n",
+				config->session_id);
+		goto check_sbuf;
+	}
+
 	perf->config = *config;
 	ret = sde_rotator_calc_perf(mgr, perf);
 
 	if (ret) {
 		SDEROT_ERR("error in configuring the session %d\n", ret);
+		perf->clk_rate = 0;
 		goto done;
 	}
 
@@ -2375,6 +2395,7 @@ static int sde_rotator_config_session(struct sde_rot_mgr *mgr,
 		goto done;
 	}
 
+check_sbuf:
 	if (config->output.sbuf && mgr->sbuf_ctx != private && mgr->sbuf_ctx) {
 		SDEROT_ERR("too many sbuf sessions\n");
 		ret = -EBUSY;
@@ -221,6 +221,12 @@ struct sde_rotation_item {
 struct sde_rot_entry;
 struct sde_rot_perf;
 
+/*
+ * struct sde_rot_clk - rotator clock
+ * @clk: clock handle
+ * @clk_name: name of the clock
+ * @rate: last rate requested, so unchanged requests skip the clock driver
+ */
 struct sde_rot_clk {
 	struct clk *clk;
 	char clk_name[32];
@@ -342,6 +348,7 @@ struct sde_rot_perf {
 	int last_wb_idx; /* last known wb index, used when above count is 0 */
 	u32 rdot_limit;
 	u32 wrot_limit;
+	int max_fps; /* max fps of all sessions when clk_rate/bw were calculated */
 };
 
 /*
@@ -16,6 +16,7 @@
 #include "../msm_vidc_internal.h"
 #include "../msm_vidc_debug.h"
 #include "../vidc_hfi_api.h"
+#include "../vmem/vmem.h"
 
 static bool debug;
 module_param(debug, bool, 0644);
@@ -242,7 +243,7 @@ static void __dump(struct dump dump[], int len)
 }
 
 static unsigned long __calculate_vpe(struct vidc_bus_vote_data *d,
-		enum governor_mode gm)
+		enum governor_mode gm, int vmem_size)
 {
 	return 0;
 }
@@ -308,7 +309,7 @@ static unsigned long __calculate_vmem_plus_ab(struct vidc_bus_vote_data *d)
 
 
 static unsigned long __calculate_decoder(struct vidc_bus_vote_data *d,
-		enum governor_mode gm) {
+		enum governor_mode gm, int vmem_size) {
 	/*
 	 * XXX: Don't fool around with any of the hardcoded numbers unless you
 	 * know /exactly/ what you're doing.  Many of these numbers are
@@ -320,7 +321,6 @@ static unsigned long __calculate_decoder(struct vidc_bus_vote_data *d,
 	bool unified_dpb_opb, dpb_compression_enabled, opb_compression_enabled;
 	fp_t dpb_opb_scaling_ratio, dpb_compression_factor,
 		opb_compression_factor, qsmmu_bw_overhead_factor;
-	int vmem_size; /* in kB */
 
 	/* Derived parameters */
 	int lcu_per_frame, tnbr_per_lcu_10bpc, tnbr_per_lcu_8bpc, tnbr_per_lcu,
@@ -371,8 +371,6 @@ static unsigned long __calculate_decoder(struct vidc_bus_vote_data *d,
 	opb_compression_factor = !opb_compression_enabled ? FP_ONE :
 		__compression_ratio(__lut(width, height), opb_bpp, scenario);
 
-	vmem_size = 512; /* in kB */
-
 	/* Derived parameters setup */
 	lcu_per_frame = DIV_ROUND_UP(width, lcu_size) *
 		DIV_ROUND_UP(height, lcu_size);
@@ -626,7 +624,7 @@ static unsigned long __calculate_decoder(struct vidc_bus_vote_data *d,
 
 
 static unsigned long __calculate_encoder(struct vidc_bus_vote_data *d,
-		enum governor_mode gm)
+		enum governor_mode gm, int vmem_size)
 {
 	/*
 	 * XXX: Don't fool around with any of the hardcoded numbers unless you
@@ -636,7 +634,7 @@ static unsigned long __calculate_encoder(struct vidc_bus_vote_data *d,
 	/* Encoder Parameters */
 	enum scenario scenario, bitrate_scenario;
 	enum hal_video_codec standard;
-	int width, height, fps, vmem_size;
+	int width, height, fps;
 	enum hal_uncompressed_format dpb_color_format;
 	enum hal_uncompressed_format original_color_format;
 	bool dpb_compression_enabled, original_compression_enabled,
@@ -701,7 +699,6 @@ static unsigned long __calculate_encoder(struct vidc_bus_vote_data *d,
 
 	rotation = false;
 	cropping_or_scaling = false;
-	vmem_size = 512; /* in kB */
 
 	/* Derived Parameters */
 	lcu_size = 16;
@@ -771,8 +768,8 @@ static unsigned long __calculate_encoder(struct vidc_bus_vote_data *d,
 		lcu_size / 2 / 1024; /* XXX: CF hack */
 	bw_increase_p = fp_mult(one_frame_bw_dpb,
 			FP_INT(search_window_factor_bw_p - 1) / 3);
-	available_vmem_p = min_t(int, 3, (vmem_size - fp_int(line_buffer_size) -
-			fp_int(original_vmem_requirement)) / vmem_size_p);
+	available_vmem_p = clamp_t(int, (vmem_size - fp_int(line_buffer_size) -
+			fp_int(original_vmem_requirement)) / vmem_size_p, 0, 3);
 
 	search_window_size_vertical_b = 48;
 	search_window_factor_b = search_window_size_vertical_b * 2 / lcu_size;
@@ -783,8 +780,8 @@ static unsigned long __calculate_encoder(struct vidc_bus_vote_data *d,
 		2 / 1024;
 	bw_increase_b = fp_mult(one_frame_bw_dpb,
 			FP_INT((search_window_factor_bw_b - 1) / 3));
-	available_vmem_b = min_t(int, 6, (vmem_size - fp_int(line_buffer_size) -
-			fp_int(original_vmem_requirement)) / vmem_size_b);
+	available_vmem_b = clamp_t(int, (vmem_size - fp_int(line_buffer_size) -
+			fp_int(original_vmem_requirement)) / vmem_size_b, 0, 6);
 
 	/* Output parameters for DDR */
 	ddr.vsp_read = fp_mult(fp_div(FP_INT(bitrate), FP_INT(8)),
@@ -1031,24 +1028,51 @@ static unsigned long __calculate_encoder(struct vidc_bus_vote_data *d,
 }
 
 static unsigned long __calculate(struct vidc_bus_vote_data *d,
-		enum governor_mode gm)
+		enum governor_mode gm, int vmem_size)
 {
 	unsigned long (*calc[])(struct vidc_bus_vote_data *,
-			enum governor_mode) = {
+			enum governor_mode, int) = {
 		[HAL_VIDEO_DOMAIN_VPE] = __calculate_vpe,
 		[HAL_VIDEO_DOMAIN_ENCODER] = __calculate_encoder,
 		[HAL_VIDEO_DOMAIN_DECODER] = __calculate_decoder,
 	};
 
-	return calc[d->domain](d, gm);
+	return calc[d->domain](d, gm, vmem_size);
 }
 
+/*
+ * VMEM is handed to the firmware as one region that all the sessions share,
+ * so rather than assuming every session has all of it, give each session a
+ * share that follows its line buffer needs.  Those scale with the width, and
+ * encoders (search window) and HEVC/VP9 (larger LCUs) need more per line.
+ */
+static int __vmem_weight(struct vidc_bus_vote_data *d)
+{
+	int weight;
+
+	if (d->domain == HAL_VIDEO_DOMAIN_VPE)
+		return 0;
+
+	weight = max(d->width, BASELINE_DIMENSIONS.width);
+	if (d->domain == HAL_VIDEO_DOMAIN_ENCODER)
+		weight *= 2;
+	if (d->codec == HAL_VIDEO_CODEC_HEVC || d->codec == HAL_VIDEO_CODEC_VP9)
+		weight *= 2;
+
+	return weight;
+}
+
+/* VMEM size the firmware heuristics were measured with, in kB */
+#define DEFAULT_VMEM_SIZE 512
+
 static int __get_target_freq(struct devfreq *dev, unsigned long *freq)
 {
-	unsigned long ab_kbps = 0, c = 0;
+	unsigned long ab_kbps = 0, c = 0, ab = 0, no_vmem_ab = 0;
 	struct devfreq_dev_status stats = {0};
 	struct msm_vidc_gov_data *vidc_data = NULL;
 	struct governor *gov = NULL;
+	struct vmem_share shares[VMEM_MAX_SHARES];
+	int total_weight = 0, vmem_size = DEFAULT_VMEM_SIZE, nr_shares = 0;
 
 	if (!dev || !freq)
 		return -EINVAL;
@@ -1066,7 +1090,36 @@ static int __get_target_freq(struct devfreq *dev, unsigned long *freq)
 	}
 
 	for (c = 0; c < vidc_data->data_count; ++c)
-		ab_kbps += __calculate(&vidc_data->data[c], gov->mode);
+		total_weight += __vmem_weight(&vidc_data->data[c]);
+
+	for (c = 0; c < vidc_data->data_count; ++c) {
+		struct vidc_bus_vote_data *d = &vidc_data->data[c];
+
+		if (vidc_data->imem_size > 0 && total_weight)
+			vmem_size = mult_frac(vidc_data->imem_size / 1024,
+					__vmem_weight(d), total_weight);
+
+		ab = __calculate(d, gov->mode, vmem_size);
+		ab_kbps += ab;
+
+		if (gov->mode != GOVERNOR_DDR || vidc_data->imem_size <= 0 ||
+				d->domain == HAL_VIDEO_DOMAIN_VPE ||
+				nr_shares >= VMEM_MAX_SHARES)
+			continue;
+
+		no_vmem_ab = __calculate(d, GOVERNOR_DDR, 0);
+		shares[nr_shares++] = (struct vmem_share) {
+			.encoder = d->domain == HAL_VIDEO_DOMAIN_ENCODER,
+			.codec = d->codec,
+			.width = d->width,
+			.height = d->height,
+			.size = vmem_size,
+			.ddr_saved_kbps = no_vmem_ab > ab ? no_vmem_ab - ab : 0,
+		};
+	}
+
+	if (gov->mode == GOVERNOR_DDR && vidc_data->imem_size > 0)
+		vmem_set_shares(shares, nr_shares);
 
 	*freq = clamp(ab_kbps, dev->min_freq, dev->max_freq ?: UINT_MAX);
 exit:
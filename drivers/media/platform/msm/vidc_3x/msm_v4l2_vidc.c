@@ -653,6 +653,7 @@ static int msm_vidc_probe_vidc_device(struct platform_device *pdev)
 	}
 	call_hfi_op(core->device, core_early_release,
 		core->device->hfi_device_data);
+	msm_comm_buf_pool_init(core);
 
 	return rc;
 
@@ -737,6 +738,7 @@ static int msm_vidc_remove(struct platform_device *pdev)
 	video_unregister_device(&core->vdev[MSM_VIDC_DECODER].vdev);
 	v4l2_device_unregister(&core->v4l2_dev);
 
+	msm_comm_buf_pool_deinit(core);
 	msm_vidc_free_platform_resources(&core->resources);
 	sysfs_remove_group(&pdev->dev.kobj, &msm_vidc_core_attr_group);
 	dev_set_drvdata(&pdev->dev, NULL);
@@ -1192,6 +1192,7 @@ void *msm_vidc_open(int core_id, int session_type)
 		rc = -ENOMEM;
 		goto err_invalid_core;
 	}
+	inst->open_time = ktime_get();
 
 	pr_debug(VIDC_DBG_TAG "Opening video instance: %pK, %d\n",
 		VIDC_MSG_PRIO2STRING(VIDC_INFO), inst, session_type);
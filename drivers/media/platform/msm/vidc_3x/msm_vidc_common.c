@@ -491,7 +491,7 @@ static enum hal_uncompressed_format get_hal_uncompressed(int fourcc)
 	return format;
 }
 
-static int msm_comm_vote_bus(struct msm_vidc_core *core)
+int msm_comm_vote_bus(struct msm_vidc_core *core)
 {
 	int rc = 0, vote_data_count = 0, i = 0;
 	struct hfi_device *hdev;
@@ -3457,6 +3457,8 @@ int msm_comm_try_state(struct msm_vidc_inst *inst, int state)
 	case MSM_VIDC_START_DONE:
 		rc = wait_for_state(inst, flipped_state, MSM_VIDC_START_DONE,
 				HAL_SESSION_START_DONE);
+		if (!rc)
+			msm_comm_record_open_latency(inst);
 		if (rc || state <= get_flipped_state(inst->state, state))
 			break;
 	case MSM_VIDC_STOP:
@@ -3822,7 +3824,7 @@ int msm_comm_qbuf(struct msm_vidc_inst *inst, struct vb2_buffer *vb)
 		struct vidc_frame_data *data;
 		int count;
 	} etbs, ftbs;
-	bool defer = false, batch_mode;
+	bool defer = false, batch_mode, coalesced = false;
 	struct vb2_buf_entry *temp, *next;
 	struct vb2_v4l2_buffer *vbuf = to_vb2_v4l2_buffer(vb);
 
@@ -3981,7 +3983,39 @@ int msm_comm_qbuf(struct msm_vidc_inst *inst, struct vb2_buffer *vb)
 		}
 	}
 
-	if (!batch_mode && etbs.count) {
+	/*
+	 * Several buffers pending at once, e.g. after start or flush: hand
+	 * them over together so the firmware is interrupted only once.
+	 * Pending sequence header requests keep the one by one path since
+	 * they have to go out between the ETBs and the FTBs.
+	 */
+	if (!batch_mode && etbs.count + ftbs.count > 1 &&
+		hdev->session_queue_bufs &&
+		!atomic_read(&inst->seq_hdr_reqs)) {
+		int c = 0;
+
+		rc = call_hfi_op(hdev, session_queue_bufs, inst->session,
+				etbs.count, etbs.data, ftbs.count, ftbs.data);
+		if (rc) {
+			dprintk(VIDC_ERR,
+				"Failed to queue %d ETBs and %d FTBs\n",
+				etbs.count, ftbs.count);
+			goto err_bad_input;
+		}
+
+		for (c = 0; c < etbs.count; ++c) {
+			log_frame(inst, &etbs.data[c],
+					V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE);
+		}
+
+		for (c = 0; c < ftbs.count; ++c) {
+			log_frame(inst, &ftbs.data[c],
+					V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE);
+		}
+		coalesced = true;
+	}
+
+	if (!batch_mode && !coalesced && etbs.count) {
 		int c = 0;
 
 		for (c = 0; c < etbs.count; ++c) {
@@ -4000,7 +4034,7 @@ int msm_comm_qbuf(struct msm_vidc_inst *inst, struct vb2_buffer *vb)
 		}
 	}
 
-	if (!batch_mode && ftbs.count) {
+	if (!batch_mode && !coalesced && ftbs.count) {
 		int c = 0;
 
 		for (c = 0; atomic_read(&inst->seq_hdr_reqs) > 0; ++c) {
@@ -5174,6 +5208,221 @@ int msm_comm_kill_session(struct msm_vidc_inst *inst)
 	return rc;
 }
 
+#define BUF_POOL_TYPES (HAL_BUFFER_INTERNAL_SCRATCH | \
+		HAL_BUFFER_INTERNAL_SCRATCH_1 | HAL_BUFFER_INTERNAL_SCRATCH_2 | \
+		HAL_BUFFER_INTERNAL_PERSIST | HAL_BUFFER_INTERNAL_PERSIST_1)
+
+static inline bool is_pooled_buffer(enum hal_buffer buffer_type,
+		int map_kernel)
+{
+	return !map_kernel && (buffer_type & BUF_POOL_TYPES);
+}
+
+/* Frees pooled buffers, oldest first, until @bytes have been released */
+static u32 msm_comm_buf_pool_trim(struct msm_vidc_core *core, u32 bytes,
+		bool wait)
+{
+	struct msm_vidc_buf_pool *pool = &core->buf_pool;
+	struct internal_buf *buf, *next;
+	LIST_HEAD(victims);
+	u32 freed = 0;
+
+	if (wait)
+		mutex_lock(&pool->lock);
+	else if (!mutex_trylock(&pool->lock))
+		return 0;
+
+	list_for_each_entry_safe_reverse(buf, next, &pool->list, list) {
+		if (freed >= bytes)
+			break;
+		freed += buf->handle->size;
+		pool->size -= buf->handle->size;
+		pool->count--;
+		list_move(&buf->list, &victims);
+	}
+	mutex_unlock(&pool->lock);
+
+	list_for_each_entry_safe(buf, next, &victims, list) {
+		list_del(&buf->list);
+		msm_smem_free(pool->mem_client, buf->handle);
+		kfree(buf);
+	}
+	return freed;
+}
+
+static unsigned long msm_comm_buf_pool_count(struct shrinker *shrinker,
+		struct shrink_control *sc)
+{
+	struct msm_vidc_core *core = container_of(shrinker,
+			struct msm_vidc_core, buf_pool.shrinker);
+
+	return READ_ONCE(core->buf_pool.size) >> PAGE_SHIFT;
+}
+
+static unsigned long msm_comm_buf_pool_scan(struct shrinker *shrinker,
+		struct shrink_control *sc)
+{
+	struct msm_vidc_core *core = container_of(shrinker,
+			struct msm_vidc_core, buf_pool.shrinker);
+	u32 freed;
+
+	freed = msm_comm_buf_pool_trim(core, sc->nr_to_scan << PAGE_SHIFT,
+			false);
+	return freed ? freed >> PAGE_SHIFT : SHRINK_STOP;
+}
+
+void msm_comm_buf_pool_init(struct msm_vidc_core *core)
+{
+	struct msm_vidc_buf_pool *pool = &core->buf_pool;
+
+	mutex_init(&pool->lock);
+	INIT_LIST_HEAD(&pool->list);
+	pool->shrinker.count_objects = msm_comm_buf_pool_count;
+	pool->shrinker.scan_objects = msm_comm_buf_pool_scan;
+	pool->shrinker.seeks = DEFAULT_SEEKS;
+	if (register_shrinker(&pool->shrinker))
+		dprintk(VIDC_WARN, "Failed to register buffer pool shrinker\n");
+}
+
+void msm_comm_buf_pool_deinit(struct msm_vidc_core *core)
+{
+	struct msm_vidc_buf_pool *pool = &core->buf_pool;
+
+	unregister_shrinker(&pool->shrinker);
+	msm_comm_buf_pool_trim(core, U32_MAX, true);
+	if (pool->mem_client)
+		msm_smem_delete_client(pool->mem_client);
+	pool->mem_client = NULL;
+	mutex_destroy(&pool->lock);
+}
+
+void msm_comm_buf_pool_drain(struct msm_vidc_core *core)
+{
+	u32 freed = msm_comm_buf_pool_trim(core, U32_MAX, true);
+
+	if (freed)
+		dprintk(VIDC_DBG, "Released %u bytes of pooled buffers\n",
+			freed);
+}
+
+/*
+ * Takes the smallest pooled buffer of @buffer_type and @flags of at least
+ * @size but no more than a quarter larger, or allocates a new one from the
+ * pool's client so that it can be pooled when the session frees it.
+ */
+static struct msm_smem *msm_comm_buf_pool_get(struct msm_vidc_core *core,
+		size_t size, u32 align, u32 flags, enum hal_buffer buffer_type)
+{
+	struct msm_vidc_buf_pool *pool = &core->buf_pool;
+	struct internal_buf *buf, *match = NULL;
+	struct msm_smem *mem = NULL;
+	size_t want = ALIGN(size, SZ_4K);
+
+	align = ALIGN(align, SZ_4K);
+
+	mutex_lock(&pool->lock);
+	if (!pool->mem_client) {
+		pool->mem_client = msm_smem_new_client(SMEM_ION,
+				&core->resources, MSM_VIDC_DECODER);
+		if (!pool->mem_client) {
+			dprintk(VIDC_ERR, "Failed to create pool client\n");
+			mutex_unlock(&pool->lock);
+			return NULL;
+		}
+	}
+
+	list_for_each_entry(buf, &pool->list, list) {
+		mem = buf->handle;
+		if (mem->buffer_type != buffer_type || mem->flags != flags ||
+			mem->size < want || mem->size > want + want / 4 ||
+			!IS_ALIGNED(mem->device_addr, align))
+			continue;
+		if (!match || mem->size < match->handle->size)
+			match = buf;
+	}
+
+	if (match) {
+		list_del(&match->list);
+		mem = match->handle;
+		pool->size -= mem->size;
+		pool->count--;
+		pool->hits++;
+		kfree(match);
+	} else {
+		mem = NULL;
+		pool->misses++;
+	}
+	mutex_unlock(&pool->lock);
+
+	if (mem) {
+		dprintk(VIDC_DBG,
+			"Reusing pooled buffer: type %#x, size %u, addr %#x\n",
+			buffer_type, mem->size, mem->device_addr);
+		return mem;
+	}
+
+	return msm_smem_alloc(pool->mem_client, size, align, flags,
+			buffer_type, 0);
+}
+
+static void msm_comm_buf_pool_put(struct msm_vidc_core *core,
+		struct msm_smem *mem)
+{
+	struct msm_vidc_buf_pool *pool = &core->buf_pool;
+	u32 limit = msm_vidc_buf_pool_size * SZ_1K;
+	struct internal_buf *buf;
+	u32 excess = 0;
+
+	if (mem->size > limit)
+		goto free;
+
+	buf = kzalloc(sizeof(*buf), GFP_KERNEL);
+	if (!buf)
+		goto free;
+
+	buf->buffer_type = mem->buffer_type;
+	buf->handle = mem;
+	buf->buffer_ownership = DRIVER;
+
+	mutex_lock(&pool->lock);
+	list_add(&buf->list, &pool->list);
+	pool->size += mem->size;
+	pool->count++;
+	if (pool->size > limit)
+		excess = pool->size - limit;
+	mutex_unlock(&pool->lock);
+
+	if (excess)
+		msm_comm_buf_pool_trim(core, excess, true);
+	return;
+
+free:
+	msm_smem_free(pool->mem_client, mem);
+}
+
+void msm_comm_record_open_latency(struct msm_vidc_inst *inst)
+{
+	struct msm_vidc_buf_pool *pool;
+	u32 us;
+
+	if (!inst || !inst->core || inst->open_us)
+		return;
+
+	pool = &inst->core->buf_pool;
+	us = max_t(s64, ktime_us_delta(ktime_get(), inst->open_time), 1);
+	inst->open_us = us;
+
+	mutex_lock(&pool->lock);
+	pool->open_count++;
+	pool->open_last_us = us;
+	pool->open_max_us = max(pool->open_max_us, us);
+	pool->open_total_us += us;
+	mutex_unlock(&pool->lock);
+
+	dprintk(VIDC_PROF, "%s: session %pK took %u us from open to start\n",
+		__func__, inst, us);
+}
+
 struct msm_smem *msm_comm_smem_alloc(struct msm_vidc_inst *inst,
 			size_t size, u32 align, u32 flags,
 			enum hal_buffer buffer_type, int map_kernel)
@@ -5184,6 +5433,10 @@ struct msm_smem *msm_comm_smem_alloc(struct msm_vidc_inst *inst,
 		dprintk(VIDC_ERR, "%s: invalid inst: %pK\n", __func__, inst);
 		return NULL;
 	}
+	if (is_pooled_buffer(buffer_type, map_kernel))
+		return msm_comm_buf_pool_get(inst->core, size, align,
+				flags, buffer_type);
+
 	m = msm_smem_alloc(inst->mem_client, size, align,
 				flags, buffer_type, map_kernel);
 	return m;
@@ -5191,11 +5444,27 @@ struct msm_smem *msm_comm_smem_alloc(struct msm_vidc_inst *inst,
 
 void msm_comm_smem_free(struct msm_vidc_inst *inst, struct msm_smem *mem)
 {
+	struct msm_vidc_core *core;
+
 	if (!inst || !inst->core || !mem) {
 		dprintk(VIDC_ERR,
 			"%s: invalid params: %pK %pK\n", __func__, inst, mem);
 		return;
 	}
+	core = inst->core;
+
+	if (is_pooled_buffer(mem->buffer_type, !!mem->kvaddr)) {
+		/*
+		 * A buffer the firmware may still own after a session or
+		 * core error is not handed to another session.
+		 */
+		if (inst->state == MSM_VIDC_CORE_INVALID ||
+			core->state == VIDC_CORE_INVALID)
+			msm_smem_free(core->buf_pool.mem_client, mem);
+		else
+			msm_comm_buf_pool_put(core, mem);
+		return;
+	}
 	msm_smem_free(inst->mem_client, mem);
 }
 
@@ -5264,6 +5533,7 @@ void msm_vidc_fw_unload_handler(struct work_struct *work)
 		core->state = VIDC_CORE_UNINIT;
 		kfree(core->capabilities);
 		core->capabilities = NULL;
+		msm_comm_buf_pool_drain(core);
 	}
 	mutex_unlock(&core->lock);
 }
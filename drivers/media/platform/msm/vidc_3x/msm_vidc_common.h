@@ -48,6 +48,7 @@ int msm_comm_queue_output_buffers(struct msm_vidc_inst *inst);
 int msm_comm_qbuf(struct msm_vidc_inst *inst, struct vb2_buffer *vb);
 void msm_comm_scale_clocks_and_bus(struct msm_vidc_inst *inst);
 int msm_comm_scale_clocks(struct msm_vidc_core *core);
+int msm_comm_vote_bus(struct msm_vidc_core *core);
 int msm_comm_scale_clocks_load(struct msm_vidc_core *core,
 		int num_mbs_per_sec, enum load_calc_quirks quirks);
 void msm_comm_flush_dynamic_buffers(struct msm_vidc_inst *inst);
@@ -76,6 +77,10 @@ struct msm_smem *msm_comm_smem_alloc(struct msm_vidc_inst *inst,
 			size_t size, u32 align, u32 flags,
 			enum hal_buffer buffer_type, int map_kernel);
 void msm_comm_smem_free(struct msm_vidc_inst *inst, struct msm_smem *mem);
+void msm_comm_buf_pool_init(struct msm_vidc_core *core);
+void msm_comm_buf_pool_deinit(struct msm_vidc_core *core);
+void msm_comm_buf_pool_drain(struct msm_vidc_core *core);
+void msm_comm_record_open_latency(struct msm_vidc_inst *inst);
 int msm_comm_smem_cache_operations(struct msm_vidc_inst *inst,
 		struct msm_smem *mem, enum smem_cache_ops cache_ops);
 struct msm_smem *msm_comm_smem_user_to_kernel(struct msm_vidc_inst *inst,
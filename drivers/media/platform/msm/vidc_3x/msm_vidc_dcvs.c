@@ -61,6 +61,37 @@ static inline int msm_dcvs_count_active_instances(struct msm_vidc_core *core)
 	return active_instances;
 }
 
+/*
+ * Clocks are a core resource, so DCVS votes for the combined load of all
+ * sessions: the DCVS load of sessions running DCVS plus the nominal load
+ * of the others. Each session still runs its own buffer based DCVS state
+ * machine to pick its share. The bus is revoted as its governor depends
+ * on the core clock.
+ */
+static int msm_dcvs_scale_core_clocks(struct msm_vidc_core *core)
+{
+	struct msm_vidc_inst *inst = NULL;
+	int load = 0, rc;
+
+	mutex_lock(&core->lock);
+	list_for_each_entry(inst, &core->instances, list) {
+		if (inst->dcvs_mode)
+			load += inst->dcvs.load;
+		else
+			load += msm_comm_get_inst_load(inst,
+					LOAD_CALC_NO_QUIRKS);
+	}
+	mutex_unlock(&core->lock);
+
+	dprintk(VIDC_PROF, "DCVS: core load %d\n", load);
+
+	rc = msm_comm_scale_clocks_load(core, load, LOAD_CALC_NO_QUIRKS);
+	if (rc)
+		return rc;
+
+	return msm_comm_vote_bus(core);
+}
+
 static bool msm_dcvs_check_codec_supported(int fourcc,
 		unsigned long codecs_supported, enum session_type type)
 {
@@ -437,8 +468,7 @@ static int msm_dcvs_enc_scale_clocks(struct msm_vidc_inst *inst)
 			dcvs->prev_freq_lowered ? "Lower" : "Higher",
 			dcvs->load, total_input_buf, fw_pending_bufs);
 
-		rc = msm_comm_scale_clocks_load(core, dcvs->load,
-				LOAD_CALC_NO_QUIRKS);
+		rc = msm_dcvs_scale_core_clocks(core);
 		if (rc) {
 			dprintk(VIDC_PROF,
 				"Failed to set clock rate in FBD: %d\n", rc);
@@ -517,8 +547,7 @@ static int msm_dcvs_dec_scale_clocks(struct msm_vidc_inst *inst, bool fbd)
 			dcvs->load, total_output_buf, buffers_outside_fw,
 			dcvs->threshold_disp_buf_high, dcvs->transition_turbo);
 
-		rc = msm_comm_scale_clocks_load(core, dcvs->load,
-				LOAD_CALC_NO_QUIRKS);
+		rc = msm_dcvs_scale_core_clocks(core);
 		if (rc) {
 			dprintk(VIDC_ERR,
 				"Failed to set clock rate in FBD: %d\n", rc);
@@ -579,7 +608,6 @@ static bool msm_dcvs_check_supported(struct msm_vidc_inst *inst)
 	int num_mbs_per_frame = 0, instance_count = 0;
 	long int instance_load = 0;
 	long int dcvs_limit = 0;
-	struct msm_vidc_inst *temp = NULL;
 	struct msm_vidc_core *core;
 	struct hal_buffer_requirements *output_buf_req;
 	struct dcvs_stats *dcvs;
@@ -602,7 +630,7 @@ static bool msm_dcvs_check_supported(struct msm_vidc_inst *inst)
 	}
 	instance_count = msm_dcvs_count_active_instances(core);
 
-	if (instance_count == 1 && inst->session_type == MSM_VIDC_DECODER &&
+	if (instance_count >= 1 && inst->session_type == MSM_VIDC_DECODER &&
 		!msm_comm_turbo_session(inst)) {
 		num_mbs_per_frame = msm_dcvs_get_mbs_per_frame(inst);
 		instance_load = msm_comm_get_inst_load(inst,
@@ -630,17 +658,16 @@ static bool msm_dcvs_check_supported(struct msm_vidc_inst *inst)
 				__func__, HAL_BUFFER_OUTPUT);
 			return false;
 		}
-	} else if (instance_count == 1 &&
+	} else if (instance_count >= 1 &&
 			inst->session_type == MSM_VIDC_ENCODER &&
 			!msm_comm_turbo_session(inst)) {
 		if (!msm_dcvs_enc_check(inst))
 			return false;
 	} else {
 		/*
-		 * For multiple instance use case with 4K, clocks will be scaled
-		 * as per load in streamon, but the clocks may be scaled
-		 * down as DCVS is running for first playback instance
-		 * Rescaling the core clock for multiple instance use case
+		 * Clocks may have been scaled down by the DCVS of the other
+		 * sessions, rescale the core clock for the nominal load of
+		 * this one.
 		 */
 		if (!dcvs->is_clock_scaled) {
 			if (!msm_comm_scale_clocks(core)) {
@@ -654,17 +681,6 @@ static bool msm_dcvs_check_supported(struct msm_vidc_inst *inst)
 					__func__);
 			}
 		}
-		/*
-		 * For multiple instance use case turn OFF DCVS algorithm
-		 * immediately
-		 */
-		if (instance_count > 1) {
-			mutex_lock(&core->lock);
-			list_for_each_entry(temp, &core->instances, list)
-				temp->dcvs_mode = false;
-			mutex_unlock(&core->lock);
-		}
-
 		return false;
 	}
 
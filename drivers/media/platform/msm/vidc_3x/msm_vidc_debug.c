@@ -31,6 +31,8 @@ int msm_vidc_firmware_unload_delay = 15000;
 bool msm_vidc_thermal_mitigation_disabled = true;
 bool msm_vidc_bitrate_clock_scaling = 1;
 bool msm_vidc_debug_timeout = true;
+/* Internal buffer pool limit per core, in KB */
+int msm_vidc_buf_pool_size = 32768;
 
 #define MAX_DBG_BUF_SIZE 4096
 
@@ -111,6 +113,20 @@ static ssize_t core_info_read(struct file *file, char __user *buf,
 			completion_done(&core->completions[SYS_MSG_INDEX(i)]) ?
 			"pending" : "done");
 	}
+
+	mutex_lock(&core->buf_pool.lock);
+	cur += write_str(cur, end - cur,
+		"buffer pool: %u buffers, %u KB, %u hits, %u misses\n",
+		core->buf_pool.count, core->buf_pool.size / SZ_1K,
+		core->buf_pool.hits, core->buf_pool.misses);
+	cur += write_str(cur, end - cur,
+		"session open: %u sessions, last %u us, avg %llu us, max %u us\n",
+		core->buf_pool.open_count, core->buf_pool.open_last_us,
+		core->buf_pool.open_count ?
+		div_u64(core->buf_pool.open_total_us,
+			core->buf_pool.open_count) : 0,
+		core->buf_pool.open_max_us);
+	mutex_unlock(&core->buf_pool.lock);
 	len = simple_read_from_buffer(buf, count, ppos,
 			dbuf, cur - dbuf);
 
@@ -208,7 +224,8 @@ struct dentry *msm_vidc_debugfs_init_drv(void)
 	__debugfs_create(bool, "bitrate_clock_scaling",
 			&msm_vidc_bitrate_clock_scaling) &&
 	__debugfs_create(bool, "debug_timeout",
-			&msm_vidc_debug_timeout);
+			&msm_vidc_debug_timeout) &&
+	__debugfs_create(u32, "buf_pool_size", &msm_vidc_buf_pool_size);
 
 #undef __debugfs_create
 
@@ -357,6 +374,8 @@ static ssize_t inst_info_read(struct file *file, char __user *buf,
 	cur += write_str(cur, end - cur, "state: %d\n", inst->state);
 	cur += write_str(cur, end - cur, "secure: %d\n",
 		!!(inst->flags & VIDC_SECURE));
+	cur += write_str(cur, end - cur, "open latency: %u us\n",
+		inst->open_us);
 	cur += write_str(cur, end - cur, "-----------Formats-------------\n");
 	for (i = 0; i < MAX_PORT_NUM; i++) {
 		cur += write_str(cur, end - cur, "capability: %s\n",
@@ -69,6 +69,7 @@ extern int msm_vidc_firmware_unload_delay;
 extern bool msm_vidc_thermal_mitigation_disabled;
 extern bool msm_vidc_bitrate_clock_scaling;
 extern bool msm_vidc_debug_timeout;
+extern int msm_vidc_buf_pool_size;
 
 static inline char *VIDC_MSG_PRIO2STRING(int __level)
 {
@@ -24,6 +24,9 @@
 #include <linux/msm-bus.h>
 #include <linux/msm-bus-board.h>
 #include <linux/kref.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <linux/shrinker.h>
 #include <media/v4l2-dev.h>
 #include <media/v4l2-device.h>
 #include <media/v4l2-ioctl.h>
@@ -146,6 +149,28 @@ struct internal_buf {
 	enum buffer_owner buffer_ownership;
 };
 
+/*
+ * Scratch and persist buffers freed by closed sessions, kept allocated and
+ * mapped through @mem_client so that the next session of a compatible size
+ * skips the ION allocation and SMMU map. Trimmed by @shrinker and emptied
+ * when the firmware is unloaded. The session open latency, from
+ * msm_vidc_open() to START_DONE, is accounted here as well.
+ */
+struct msm_vidc_buf_pool {
+	struct mutex lock;
+	struct list_head list;
+	void *mem_client;
+	u32 size;
+	u32 count;
+	u32 hits;
+	u32 misses;
+	u32 open_count;
+	u32 open_last_us;
+	u32 open_max_us;
+	u64 open_total_us;
+	struct shrinker shrinker;
+};
+
 struct msm_vidc_format {
 	char name[MAX_NAME_LENGTH];
 	u8 description[32];
@@ -264,6 +289,7 @@ struct msm_vidc_core {
 	struct msm_vidc_capability *capabilities;
 	struct delayed_work fw_unload_work;
 	bool smmu_fault_handled;
+	struct msm_vidc_buf_pool buf_pool;
 };
 
 struct msm_vidc_inst {
@@ -313,6 +339,8 @@ struct msm_vidc_inst {
 	atomic_t in_flush;
 	u32 pic_struct;
 	u32 colour_space;
+	ktime_t open_time;
+	u32 open_us;
 };
 
 extern struct msm_vidc_drv *vidc_driver;
@@ -1637,6 +1637,22 @@ static int __iface_cmdq_write_relaxed(struct venus_hfi_device *device,
 	return result;
 }
 
+/*
+ * Writes into cmdq without raising an interrupt, accumulating whether one
+ * is needed so a batch of packets can be followed by a single doorbell.
+ */
+static int __iface_cmdq_write_batched(struct venus_hfi_device *device,
+		void *pkt, bool *needs_interrupt)
+{
+	bool requires_interrupt = false;
+	int rc = __iface_cmdq_write_relaxed(device, pkt, &requires_interrupt);
+
+	if (!rc && requires_interrupt)
+		*needs_interrupt = true;
+
+	return rc;
+}
+
 static int __iface_cmdq_write(struct venus_hfi_device *device, void *pkt)
 {
 	bool needs_interrupt = false;
@@ -2827,7 +2843,7 @@ static int venus_hfi_session_stop(void *session)
 }
 
 static int __session_etb(struct hal_session *session,
-		struct vidc_frame_data *input_frame, bool relaxed)
+		struct vidc_frame_data *input_frame, bool *needs_interrupt)
 {
 	int rc = 0;
 	struct venus_hfi_device *device = session->device;
@@ -2843,11 +2859,11 @@ static int __session_etb(struct hal_session *session,
 			goto err_create_pkt;
 		}
 
-		if (!relaxed)
+		if (!needs_interrupt)
 			rc = __iface_cmdq_write(session->device, &pkt);
 		else
-			rc = __iface_cmdq_write_relaxed(session->device,
-					&pkt, NULL);
+			rc = __iface_cmdq_write_batched(session->device,
+					&pkt, needs_interrupt);
 		if (rc)
 			goto err_create_pkt;
 	} else {
@@ -2862,11 +2878,11 @@ static int __session_etb(struct hal_session *session,
 			goto err_create_pkt;
 		}
 
-		if (!relaxed)
+		if (!needs_interrupt)
 			rc = __iface_cmdq_write(session->device, &pkt);
 		else
-			rc = __iface_cmdq_write_relaxed(session->device,
-					&pkt, NULL);
+			rc = __iface_cmdq_write_batched(session->device,
+					&pkt, needs_interrupt);
 		if (rc)
 			goto err_create_pkt;
 	}
@@ -2889,13 +2905,13 @@ static int venus_hfi_session_etb(void *sess,
 
 	device = session->device;
 	mutex_lock(&device->lock);
-	rc = __session_etb(session, input_frame, false);
+	rc = __session_etb(session, input_frame, NULL);
 	mutex_unlock(&device->lock);
 	return rc;
 }
 
 static int __session_ftb(struct hal_session *session,
-		struct vidc_frame_data *output_frame, bool relaxed)
+		struct vidc_frame_data *output_frame, bool *needs_interrupt)
 {
 	int rc = 0;
 	struct venus_hfi_device *device = session->device;
@@ -2908,11 +2924,11 @@ static int __session_ftb(struct hal_session *session,
 		goto err_create_pkt;
 	}
 
-	if (!relaxed)
+	if (!needs_interrupt)
 		rc = __iface_cmdq_write(session->device, &pkt);
 	else
-		rc = __iface_cmdq_write_relaxed(session->device,
-				&pkt, NULL);
+		rc = __iface_cmdq_write_batched(session->device,
+				&pkt, needs_interrupt);
 
 err_create_pkt:
 	return rc;
@@ -2932,7 +2948,7 @@ static int venus_hfi_session_ftb(void *sess,
 
 	device = session->device;
 	mutex_lock(&device->lock);
-	rc = __session_ftb(session, output_frame, false);
+	rc = __session_ftb(session, output_frame, NULL);
 	mutex_unlock(&device->lock);
 	return rc;
 }
@@ -2945,6 +2961,7 @@ static int venus_hfi_session_process_batch(void *sess,
 	struct hal_session *session = sess;
 	struct venus_hfi_device *device;
 	struct hfi_cmd_session_sync_process_packet pkt;
+	bool needs_interrupt = false;
 
 	if (!session || !session->device) {
 		dprintk(VIDC_ERR, "%s: Invalid Params\n", __func__);
@@ -2955,7 +2972,7 @@ static int venus_hfi_session_process_batch(void *sess,
 
 	mutex_lock(&device->lock);
 	for (c = 0; c < num_ftbs; ++c) {
-		rc = __session_ftb(session, &ftbs[c], true);
+		rc = __session_ftb(session, &ftbs[c], &needs_interrupt);
 		if (rc) {
 			dprintk(VIDC_ERR, "Failed to queue batched ftb: %d\n",
 					rc);
@@ -2964,7 +2981,7 @@ static int venus_hfi_session_process_batch(void *sess,
 	}
 
 	for (c = 0; c < num_etbs; ++c) {
-		rc = __session_etb(session, &etbs[c], true);
+		rc = __session_etb(session, &etbs[c], &needs_interrupt);
 		if (rc) {
 			dprintk(VIDC_ERR, "Failed to queue batched etb: %d\n",
 					rc);
@@ -2986,6 +3003,53 @@ static int venus_hfi_session_process_batch(void *sess,
 	return rc;
 }
 
+/*
+ * Queues several ETBs and FTBs back to back and raises a single interrupt
+ * towards the firmware once all of them are in the command queue, instead
+ * of one per buffer.
+ */
+static int venus_hfi_session_queue_bufs(void *sess,
+		int num_etbs, struct vidc_frame_data etbs[],
+		int num_ftbs, struct vidc_frame_data ftbs[])
+{
+	int rc = 0, c = 0;
+	struct hal_session *session = sess;
+	struct venus_hfi_device *device;
+	bool needs_interrupt = false;
+
+	if (!session || !session->device) {
+		dprintk(VIDC_ERR, "%s: Invalid Params\n", __func__);
+		return -EINVAL;
+	}
+
+	device = session->device;
+
+	mutex_lock(&device->lock);
+	for (c = 0; c < num_etbs; ++c) {
+		rc = __session_etb(session, &etbs[c], &needs_interrupt);
+		if (rc) {
+			dprintk(VIDC_ERR, "Failed to queue etb: %d\n", rc);
+			goto err_etbs_and_ftbs;
+		}
+	}
+
+	for (c = 0; c < num_ftbs; ++c) {
+		rc = __session_ftb(session, &ftbs[c], &needs_interrupt);
+		if (rc) {
+			dprintk(VIDC_ERR, "Failed to queue ftb: %d\n", rc);
+			goto err_etbs_and_ftbs;
+		}
+	}
+
+err_etbs_and_ftbs:
+	/* Let the firmware pick up whatever made it into the queue */
+	if (needs_interrupt)
+		__write_register(device, VIDC_CPU_IC_SOFTINT,
+				1 << VIDC_CPU_IC_SOFTINT_H2A_SHFT);
+	mutex_unlock(&device->lock);
+	return rc;
+}
+
 static int venus_hfi_session_parse_seq_hdr(void *sess,
 					struct vidc_seq_hdr *seq_hdr)
 {
@@ -4779,6 +4843,7 @@ static void venus_init_hfi_callbacks(struct hfi_device *hdev)
 	hdev->session_etb = venus_hfi_session_etb;
 	hdev->session_ftb = venus_hfi_session_ftb;
 	hdev->session_process_batch = venus_hfi_session_process_batch;
+	hdev->session_queue_bufs = venus_hfi_session_queue_bufs;
 	hdev->session_parse_seq_hdr = venus_hfi_session_parse_seq_hdr;
 	hdev->session_get_seq_hdr = venus_hfi_session_get_seq_hdr;
 	hdev->session_get_buf_req = venus_hfi_session_get_buf_req;
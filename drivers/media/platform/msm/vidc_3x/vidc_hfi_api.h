@@ -1511,6 +1511,9 @@ struct hfi_device {
 	int (*session_process_batch)(void *sess,
 		int num_etbs, struct vidc_frame_data etbs[],
 		int num_ftbs, struct vidc_frame_data ftbs[]);
+	int (*session_queue_bufs)(void *sess,
+		int num_etbs, struct vidc_frame_data etbs[],
+		int num_ftbs, struct vidc_frame_data ftbs[]);
 	int (*session_parse_seq_hdr)(void *sess,
 			struct vidc_seq_hdr *seq_hdr);
 	int (*session_get_seq_hdr)(void *sess,
@@ -20,6 +20,7 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/msm-bus.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
 #include <linux/regulator/consumer.h>
@@ -118,6 +119,10 @@ struct vmem {
 	} bus;
 	atomic_t alloc_count;
 	struct dentry *debugfs_root;
+	/* Per session split reported by the bus governor */
+	struct mutex shares_lock;
+	struct vmem_share shares[VMEM_MAX_SHARES];
+	int num_shares;
 };
 
 static struct vmem *vmem;
@@ -385,6 +390,52 @@ void vmem_free(phys_addr_t to_free)
 	atomic_dec(&vmem->alloc_count);
 }
 
+/**
+ * vmem_set_shares: - Records how the bus governor splits VMEM between the
+ * running sessions.  The whole of VMEM is still handed to the firmware as a
+ * single allocation, this is only used to report the split and the DDR
+ * bandwidth it is estimated to save.
+ *
+ * @shares: array of per session shares
+ * @count: number of entries in @shares
+ */
+void vmem_set_shares(const struct vmem_share *shares, int count)
+{
+	if (!vmem)
+		return;
+
+	count = min(count, VMEM_MAX_SHARES);
+
+	mutex_lock(&vmem->shares_lock);
+	memcpy(vmem->shares, shares, count * sizeof(*shares));
+	vmem->num_shares = count;
+	mutex_unlock(&vmem->shares_lock);
+}
+EXPORT_SYMBOL(vmem_set_shares);
+
+/**
+ * vmem_get_shares: - Copies out the shares last set by vmem_set_shares.
+ *
+ * @shares: array to copy the shares to
+ * @max: number of entries @shares has room for
+ *
+ * Return: the number of entries copied.
+ */
+int vmem_get_shares(struct vmem_share *shares, int max)
+{
+	int count;
+
+	if (!vmem)
+		return 0;
+
+	mutex_lock(&vmem->shares_lock);
+	count = min(max, vmem->num_shares);
+	memcpy(shares, vmem->shares, count * sizeof(*shares));
+	mutex_unlock(&vmem->shares_lock);
+
+	return count;
+}
+
 struct vmem_interrupt_cookie {
 	struct vmem *vmem;
 	struct work_struct work;
@@ -595,6 +646,8 @@ static int vmem_probe(struct platform_device *pdev)
 	if (!v)
 		return -ENOMEM;
 
+	mutex_init(&v->shares_lock);
+
 	rc = __init_resources(v, pdev);
 	if (rc) {
 		pr_err("Failed to read resources\n");
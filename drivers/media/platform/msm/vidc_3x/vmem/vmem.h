@@ -14,10 +14,33 @@
 #ifndef __VMEM_H__
 #define __VMEM_H__
 
+#include <linux/types.h>
+
+#define VMEM_MAX_SHARES 16
+
+/**
+ * struct vmem_share - VMEM share the bus governor assumes for a session
+ * @encoder: true for an encode session, false for decode
+ * @codec: enum hal_video_codec of the session
+ * @width: frame width
+ * @height: frame height
+ * @size: share of VMEM in kB
+ * @ddr_saved_kbps: estimated DDR bandwidth the share saves
+ */
+struct vmem_share {
+	bool encoder;
+	u32 codec;
+	int width, height;
+	int size;
+	unsigned long ddr_saved_kbps;
+};
+
 #ifdef CONFIG_MSM_VIDC_VMEM
 
 int vmem_allocate(size_t size, phys_addr_t *addr);
 void vmem_free(phys_addr_t to_free);
+void vmem_set_shares(const struct vmem_share *shares, int count);
+int vmem_get_shares(struct vmem_share *shares, int max);
 
 #else
 
@@ -30,6 +53,16 @@ static inline void vmem_free(phys_addr_t to_free)
 {
 }
 
+static inline void vmem_set_shares(const struct vmem_share *shares,
+		int count)
+{
+}
+
+static inline int vmem_get_shares(struct vmem_share *shares, int max)
+{
+	return 0;
+}
+
 #endif
 
 #endif /* __VMEM_H__ */
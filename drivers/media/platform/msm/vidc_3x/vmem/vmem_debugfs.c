@@ -14,6 +14,7 @@
 #include <linux/debugfs.h>
 #include <linux/fs.h>
 #include <linux/platform_device.h>
+#include <linux/seq_file.h>
 #include "vmem.h"
 
 struct vmem_debugfs_cookie {
@@ -51,6 +52,40 @@ static int __vmem_alloc_set(void *priv, u64 val)
 DEFINE_SIMPLE_ATTRIBUTE(fops_vmem_alloc, __vmem_alloc_get,
 		__vmem_alloc_set, "%llu");
 
+static int __vmem_shares_show(struct seq_file *s, void *unused)
+{
+	struct vmem_share shares[VMEM_MAX_SHARES];
+	unsigned long total_kbps = 0;
+	int c, count;
+
+	count = vmem_get_shares(shares, ARRAY_SIZE(shares));
+
+	seq_puts(s, "session  codec       width x height  share (kB)  ddr saved (kbps)\n");
+	for (c = 0; c < count; ++c) {
+		seq_printf(s, "%-8s %#-10x %6d x %-6d  %10d  %16lu\n",
+				shares[c].encoder ? "encode" : "decode",
+				shares[c].codec, shares[c].width,
+				shares[c].height, shares[c].size,
+				shares[c].ddr_saved_kbps);
+		total_kbps += shares[c].ddr_saved_kbps;
+	}
+	seq_printf(s, "total ddr saved: %lu kbps\n", total_kbps);
+
+	return 0;
+}
+
+static int __vmem_shares_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, __vmem_shares_show, inode->i_private);
+}
+
+static const struct file_operations fops_vmem_shares = {
+	.open = __vmem_shares_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 struct dentry *vmem_debugfs_init(struct platform_device *pdev)
 {
 	struct vmem_debugfs_cookie *alloc_cookie = NULL;
@@ -70,6 +105,8 @@ struct dentry *vmem_debugfs_init(struct platform_device *pdev)
 
 	debugfs_create_file("alloc", 0600, debugfs_root,
 			alloc_cookie, &fops_vmem_alloc);
+	debugfs_create_file("shares", 0400, debugfs_root,
+			NULL, &fops_vmem_shares);
 
 exit:
 	return debugfs_root;
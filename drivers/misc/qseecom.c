@@ -51,6 +51,8 @@
 #include <linux/compat.h>
 #include "compat_qseecom.h"
 #include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/seq_file.h>
 
 #define QSEECOM_DEV			"qseecom"
 #define QSEOS_VERSION_14		0x14
@@ -225,6 +227,10 @@ struct qseecom_registered_app_list {
 	bool app_blocked;
 	u32  check_block;
 	u32  blocked_on_listener_id;
+	/* command round trips, kept under registered_app_list_lock */
+	u64  cmd_cnt;
+	u64  cmd_ns_total;
+	u64  cmd_ns_max;
 };
 
 struct qseecom_registered_kclient_list {
@@ -318,6 +324,8 @@ struct qseecom_control {
 	struct task_struct *unload_app_kthread_task;
 	wait_queue_head_t unload_app_kthread_wq;
 	atomic_t unload_app_kthread_state;
+
+	struct dentry *debugfs_root;
 };
 
 struct qseecom_unload_app_pending_list {
@@ -3415,12 +3423,60 @@ int __qseecom_process_reentrancy(struct qseecom_command_scm_resp *resp,
 	}
 }
 
+/*
+ * Cache maintenance over the part of the client's shared buffer that a
+ * request uses rather than over all of it. @uaddr is in the client's view
+ * of the buffer and has already been checked against sb_length.
+ */
+static int __qseecom_sb_cache_op(struct qseecom_dev_handle *data,
+				uintptr_t uaddr, u32 len, unsigned int cmd)
+{
+	uintptr_t offset = uaddr - data->client.user_virt_sb_base;
+	int ret;
+
+	if (!len)
+		return 0;
+	ret = msm_ion_do_cache_offset_op(qseecom.ion_clnt,
+				data->client.ihandle,
+				data->client.sb_virt + offset, offset, len, cmd);
+	if (ret)
+		pr_err("cache operation failed %d\n", ret);
+	return ret;
+}
+
+static int __qseecom_sb_prepare(struct qseecom_dev_handle *data,
+				uintptr_t req_buf, u32 req_len,
+				uintptr_t resp_buf, u32 resp_len)
+{
+	int ret;
+
+	ret = __qseecom_sb_cache_op(data, req_buf, req_len,
+					ION_IOC_CLEAN_INV_CACHES);
+	if (ret)
+		return ret;
+	return __qseecom_sb_cache_op(data, resp_buf, resp_len,
+					ION_IOC_CLEAN_INV_CACHES);
+}
+
+static void __qseecom_app_account(struct qseecom_registered_app_list *ptr_app,
+				ktime_t start)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	unsigned long flags;
+
+	spin_lock_irqsave(&qseecom.registered_app_list_lock, flags);
+	ptr_app->cmd_cnt++;
+	ptr_app->cmd_ns_total += ns;
+	if (ns > ptr_app->cmd_ns_max)
+		ptr_app->cmd_ns_max = ns;
+	spin_unlock_irqrestore(&qseecom.registered_app_list_lock, flags);
+}
+
 static int __qseecom_send_cmd(struct qseecom_dev_handle *data,
 				struct qseecom_send_cmd_req *req)
 {
 	int ret = 0;
 	int ret2 = 0;
-	u32 reqd_len_sb_in = 0;
 	struct qseecom_client_send_data_ireq send_data_req = {0};
 	struct qseecom_client_send_data_64bit_ireq send_data_req_64bit = {0};
 	struct qseecom_command_scm_resp resp;
@@ -3430,8 +3486,8 @@ static int __qseecom_send_cmd(struct qseecom_dev_handle *data,
 	void *cmd_buf = NULL;
 	size_t cmd_len;
 	struct sglist_info *table = data->sglistinfo_ptr;
+	ktime_t start;
 
-	reqd_len_sb_in = req->cmd_req_len + req->resp_len;
 	/* find app_id & img_name from list */
 	spin_lock_irqsave(&qseecom.registered_app_list_lock, flags);
 	list_for_each_entry(ptr_app, &qseecom.registered_app_list_head,
@@ -3508,14 +3564,12 @@ static int __qseecom_send_cmd(struct qseecom_dev_handle *data,
 	else
 		*(uint32_t *)cmd_buf = QSEOS_CLIENT_SEND_DATA_COMMAND_WHITELIST;
 
-	ret = msm_ion_do_cache_op(qseecom.ion_clnt, data->client.ihandle,
-					data->client.sb_virt,
-					reqd_len_sb_in,
-					ION_IOC_CLEAN_INV_CACHES);
-	if (ret) {
-		pr_err("cache operation failed %d\n", ret);
+	start = ktime_get();
+	ret = __qseecom_sb_prepare(data, (uintptr_t)req->cmd_req_buf,
+				req->cmd_req_len, (uintptr_t)req->resp_buf,
+				req->resp_len);
+	if (ret)
 		return ret;
-	}
 
 	__qseecom_reentrancy_check_if_this_app_blocked(ptr_app);
 
@@ -3550,13 +3604,11 @@ static int __qseecom_send_cmd(struct qseecom_dev_handle *data,
 		}
 	}
 exit:
-	ret2 = msm_ion_do_cache_op(qseecom.ion_clnt, data->client.ihandle,
-				data->client.sb_virt, data->client.sb_length,
-				ION_IOC_INV_CACHES);
-	if (ret2) {
-		pr_err("cache operation failed %d\n", ret2);
+	ret2 = __qseecom_sb_cache_op(data, (uintptr_t)req->resp_buf,
+				req->resp_len, ION_IOC_INV_CACHES);
+	__qseecom_app_account(ptr_app, start);
+	if (ret2)
 		return ret2;
-	}
 	return ret;
 }
 
@@ -6941,12 +6993,12 @@ static int __qseecom_qteec_issue_cmd(struct qseecom_dev_handle *data,
 	unsigned long flags;
 	int ret = 0;
 	int ret2 = 0;
-	uint32_t reqd_len_sb_in = 0;
 	void *cmd_buf = NULL;
 	size_t cmd_len;
 	struct sglist_info *table = data->sglistinfo_ptr;
 	void *req_ptr = NULL;
 	void *resp_ptr = NULL;
+	ktime_t start;
 
 	ret  = __qseecom_qteec_validate_msg(data, req);
 	if (ret)
@@ -7038,15 +7090,11 @@ static int __qseecom_qteec_issue_cmd(struct qseecom_dev_handle *data,
 	else
 		*(uint32_t *)cmd_buf = cmd_id;
 
-	reqd_len_sb_in = req->req_len + req->resp_len;
-	ret = msm_ion_do_cache_op(qseecom.ion_clnt, data->client.ihandle,
-					data->client.sb_virt,
-					reqd_len_sb_in,
-					ION_IOC_CLEAN_INV_CACHES);
-	if (ret) {
-		pr_err("cache operation failed %d\n", ret);
+	start = ktime_get();
+	ret = __qseecom_sb_prepare(data, (uintptr_t)req_ptr, req->req_len,
+				(uintptr_t)resp_ptr, req->resp_len);
+	if (ret)
 		return ret;
-	}
 
 	__qseecom_reentrancy_check_if_this_app_blocked(ptr_app);
 
@@ -7081,13 +7129,11 @@ static int __qseecom_qteec_issue_cmd(struct qseecom_dev_handle *data,
 		}
 	}
 exit:
-	ret2 = msm_ion_do_cache_op(qseecom.ion_clnt, data->client.ihandle,
-				data->client.sb_virt, data->client.sb_length,
+	ret2 = __qseecom_sb_cache_op(data, (uintptr_t)resp_ptr, req->resp_len,
 				ION_IOC_INV_CACHES);
-	if (ret2) {
-		pr_err("cache operation failed %d\n", ret);
+	__qseecom_app_account(ptr_app, start);
+	if (ret2)
 		return ret2;
-	}
 
 	if ((cmd_id == QSEOS_TEE_OPEN_SESSION) ||
 			(cmd_id == QSEOS_TEE_REQUEST_CANCELLATION)) {
@@ -8885,6 +8931,47 @@ static int qseecom_check_whitelist_feature(void)
 	return version >= MAKE_WHITELIST_VERSION(1, 0, 0);
 }
 
+static int qseecom_app_stats_show(struct seq_file *s, void *unused)
+{
+	struct qseecom_registered_app_list *ptr_app;
+	unsigned long flags;
+
+	seq_puts(s, "app_id  name                            cmds       avg_us     max_us\n");
+	spin_lock_irqsave(&qseecom.registered_app_list_lock, flags);
+	list_for_each_entry(ptr_app, &qseecom.registered_app_list_head, list)
+		seq_printf(s, "%-7u %-31s %-10llu %-10llu %llu\n",
+			ptr_app->app_id, ptr_app->app_name, ptr_app->cmd_cnt,
+			ptr_app->cmd_cnt ? div64_u64(ptr_app->cmd_ns_total,
+				ptr_app->cmd_cnt * NSEC_PER_USEC) : 0,
+			div_u64(ptr_app->cmd_ns_max, NSEC_PER_USEC));
+	spin_unlock_irqrestore(&qseecom.registered_app_list_lock, flags);
+	return 0;
+}
+
+static int qseecom_app_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, qseecom_app_stats_show, NULL);
+}
+
+static const struct file_operations qseecom_app_stats_fops = {
+	.open = qseecom_app_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void qseecom_debugfs_init(void)
+{
+	qseecom.debugfs_root = debugfs_create_dir("qseecom", NULL);
+	if (IS_ERR_OR_NULL(qseecom.debugfs_root)) {
+		qseecom.debugfs_root = NULL;
+		return;
+	}
+	if (!debugfs_create_file("app_stats", 0444, qseecom.debugfs_root,
+				NULL, &qseecom_app_stats_fops))
+		pr_warn("failed to create app_stats debugfs file\n");
+}
+
 static int qseecom_probe(struct platform_device *pdev)
 {
 	int rc;
@@ -9189,6 +9276,7 @@ static int qseecom_probe(struct platform_device *pdev)
 	atomic_set(&qseecom.unload_app_kthread_state,
 						UNLOAD_APP_KT_SLEEP);
 
+	qseecom_debugfs_init();
 	atomic_set(&qseecom.qseecom_state, QSEECOM_STATE_READY);
 	return 0;
 
@@ -9240,6 +9328,8 @@ static int qseecom_remove(struct platform_device *pdev)
 	struct qseecom_ce_info_use *pce_info_use;
 
 	atomic_set(&qseecom.qseecom_state, QSEECOM_STATE_NOT_READY);
+	debugfs_remove_recursive(qseecom.debugfs_root);
+	qseecom.debugfs_root = NULL;
 	spin_lock_irqsave(&qseecom.registered_kclient_list_lock, flags);
 
 	list_for_each_entry_safe(kclient, kclient_tmp,
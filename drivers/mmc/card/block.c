@@ -441,6 +441,97 @@ num_wr_reqs_to_start_packing_store(struct device *dev,
 	return ret;
 }
 
+static ssize_t cmdq_read_prio_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+	int ret;
+
+	if (!md)
+		return -EINVAL;
+	ret = snprintf(buf, PAGE_SIZE, "%d\n", md->queue.cmdq_read_prio);
+
+	mmc_blk_put(md);
+	return ret;
+}
+
+static ssize_t cmdq_read_prio_store(struct device *dev,
+				    struct device_attribute *attr,
+				    const char *buf, size_t count)
+{
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+	bool value;
+	int ret = count;
+
+	if (!md)
+		return -EINVAL;
+
+	if (strtobool(buf, &value))
+		ret = -EINVAL;
+	else
+		md->queue.cmdq_read_prio = value;
+
+	mmc_blk_put(md);
+	return ret;
+}
+
+static const DEVICE_ATTR(cmdq_read_prio, S_IRUGO | S_IWUSR,
+	cmdq_read_prio_show, cmdq_read_prio_store);
+
+static ssize_t cmdq_latency_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	static const char * const names[MMC_CMDQ_NR_CLASS] = {
+		[MMC_CMDQ_CLASS_READ] = "read",
+		[MMC_CMDQ_CLASS_SYNC_WRITE] = "sync_write",
+		[MMC_CMDQ_CLASS_ASYNC_WRITE] = "async_write",
+		[MMC_CMDQ_CLASS_DCMD] = "dcmd",
+	};
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+	struct mmc_cmdq_class_stats stats[MMC_CMDQ_NR_CLASS];
+	unsigned long flags;
+	int i, ret = 0;
+
+	if (!md)
+		return -EINVAL;
+
+	spin_lock_irqsave(&md->queue.cmdq_stats_lock, flags);
+	memcpy(stats, md->queue.cmdq_stats, sizeof(stats));
+	spin_unlock_irqrestore(&md->queue.cmdq_stats_lock, flags);
+
+	ret += snprintf(buf, PAGE_SIZE, "%-12s %10s %10s %10s\n", "class",
+			"count", "avg_us", "max_us");
+	for (i = 0; i < MMC_CMDQ_NR_CLASS; i++)
+		ret += snprintf(buf + ret, PAGE_SIZE - ret,
+				"%-12s %10lu %10llu %10llu\n", names[i],
+				stats[i].count,
+				stats[i].count ?
+				div_u64(stats[i].total_us, stats[i].count) : 0,
+				stats[i].max_us);
+
+	mmc_blk_put(md);
+	return ret;
+}
+
+static ssize_t cmdq_latency_store(struct device *dev,
+				  struct device_attribute *attr,
+				  const char *buf, size_t count)
+{
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+
+	if (!md)
+		return -EINVAL;
+
+	/* Any write clears the stats */
+	mmc_cmdq_reset_stats(&md->queue);
+
+	mmc_blk_put(md);
+	return count;
+}
+
+static const DEVICE_ATTR(cmdq_latency, S_IRUGO | S_IWUSR,
+	cmdq_latency_show, cmdq_latency_store);
+
 #ifdef CONFIG_MMC_SIMULATE_MAX_SPEED
 
 static int max_read_speed, max_write_speed, cache_size = 4;
@@ -3146,6 +3237,7 @@ static struct mmc_cmdq_req *mmc_cmdq_prep_dcmd(
 	req->special = mqrq;
 	cmdq_req->cmdq_req_flags |= DCMD;
 	cmdq_req->mrq.cmdq_req = cmdq_req;
+	mmc_cmdq_issue_account(mq, mqrq);
 
 	return &mqrq->cmdq_req;
 }
@@ -3168,6 +3260,9 @@ static struct mmc_cmdq_req *mmc_blk_cmdq_rw_prep(
 
 	memset(&mqrq->cmdq_req, 0, sizeof(struct mmc_cmdq_req));
 
+	if (mmc_cmdq_issue_account(mq, mqrq))
+		prio = true;
+
 	cmdq_rq->tag = req->tag;
 	if (read_dir) {
 		cmdq_rq->cmdq_req_flags |= DIR;
@@ -3732,6 +3827,7 @@ void mmc_blk_cmdq_complete_rq(struct request *rq)
 					 &ctx_info->data_active_reqs));
 	if (!is_dcmd)
 		mmc_cmdq_post_req(host, cmdq_req->tag, err);
+	mmc_cmdq_complete_account(mq, mq_rq);
 	if (cmdq_req->cmdq_req_flags & DCMD) {
 		clear_bit(CMDQ_STATE_DCMD_ACTIVE, &ctx_info->curr_state);
 		blk_end_request_all(rq, err);
@@ -4558,6 +4654,12 @@ static void mmc_blk_remove_req(struct mmc_blk_data *md)
 			device_remove_file(disk_to_dev(md->disk),
 						&dev_attr_cache_size);
 #endif
+			if (md->flags & MMC_BLK_CMD_QUEUE) {
+				device_remove_file(disk_to_dev(md->disk),
+						&dev_attr_cmdq_read_prio);
+				device_remove_file(disk_to_dev(md->disk),
+						&dev_attr_cmdq_latency);
+			}
 
 			del_gendisk(md->disk);
 		}
@@ -4655,8 +4757,23 @@ static int mmc_add_disk(struct mmc_blk_data *md)
 	if (ret)
 		goto no_pack_for_random_fails;
 
+	if (md->flags & MMC_BLK_CMD_QUEUE) {
+		ret = device_create_file(disk_to_dev(md->disk),
+					 &dev_attr_cmdq_read_prio);
+		if (ret)
+			goto cmdq_read_prio_fail;
+		ret = device_create_file(disk_to_dev(md->disk),
+					 &dev_attr_cmdq_latency);
+		if (ret)
+			goto cmdq_latency_fail;
+	}
+
 	return ret;
 
+cmdq_latency_fail:
+	device_remove_file(disk_to_dev(md->disk), &dev_attr_cmdq_read_prio);
+cmdq_read_prio_fail:
+	device_remove_file(disk_to_dev(md->disk), &md->no_pack_for_random);
 no_pack_for_random_fails:
 	device_remove_file(disk_to_dev(md->disk),
 			   &md->num_wr_reqs_to_start_packing);
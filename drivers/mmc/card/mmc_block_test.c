@@ -19,7 +19,10 @@
 #include <linux/mmc/card.h>
 #include <linux/mmc/host.h>
 #include <linux/delay.h>
+#include <linux/sizes.h>
+#include <linux/sort.h>
 #include <linux/test-iosched.h>
+#include <linux/vmalloc.h>
 #include "queue.h"
 
 #define MODULE_NAME "mmc_block_test"
@@ -33,6 +36,15 @@
 #define PACKED_HDR_NUM_REQS_MASK 0x00FF0000
 #define PACKED_HDR_BITS_16_TO_29_SET 0x3FFF0000
 
+/* Benchmark group: requests kept in flight and the size of the report */
+#define BENCH_MAX_DEPTH			16
+#define BENCH_WB_DEPTH			4
+#define BENCH_WB_SIZE			SZ_256K
+#define BENCH_DEFAULT_NR_IOS		2000
+#define BENCH_WAIT_MS			10000
+#define BENCH_TIMEOUT_MS		(10 * 60 * 1000)
+#define BENCH_REPORT_SIZE		(2 * PAGE_SIZE)
+
 #define test_pr_debug(fmt, args...) pr_debug("%s: "fmt"\n", MODULE_NAME, args)
 #define test_pr_info(fmt, args...) pr_info("%s: "fmt"\n", MODULE_NAME, args)
 #define test_pr_err(fmt, args...) pr_err("%s: "fmt"\n", MODULE_NAME, args)
@@ -101,6 +113,18 @@ enum mmc_block_test_testcases {
 	TEST_PACK_MIX_PACKED_NO_PACKED_PACKED,
 	TEST_PACK_MIX_NO_PACKED_PACKED_NO_PACKED,
 	PACKING_CONTROL_MAX_TESTCASE = TEST_PACK_MIX_NO_PACKED_PACKED_NO_PACKED,
+
+	/* Start of benchmark test group */
+	BENCH_MIN_TESTCASE,
+	BENCH_RND_READ_QD1 = BENCH_MIN_TESTCASE,
+	BENCH_RND_READ_QD4,
+	BENCH_RND_READ_QD16,
+	BENCH_RND_WRITE_QD1,
+	BENCH_RND_WRITE_QD4,
+	BENCH_RND_WRITE_QD16,
+	BENCH_READ_UNDER_WRITEBACK,
+	BENCH_DISCARD,
+	BENCH_MAX_TESTCASE = BENCH_DISCARD,
 };
 
 enum mmc_block_test_group {
@@ -110,6 +134,69 @@ enum mmc_block_test_group {
 	TEST_ERR_CHECK_GROUP,
 	TEST_SEND_INVALID_GROUP,
 	TEST_PACKING_CONTROL_GROUP,
+	TEST_BENCH_GROUP,
+};
+
+/*
+ * A benchmark testcase: foreground requests of @size kept @depth deep, with
+ * sequential background writes alongside them if @writeback is set.
+ */
+struct mmc_block_bench_case {
+	const char *name;
+	int op;
+	unsigned int depth;
+	unsigned int size;
+	bool writeback;
+};
+
+static const struct mmc_block_bench_case bench_cases[] = {
+	[BENCH_RND_READ_QD1 - BENCH_MIN_TESTCASE] = {
+		"rnd read 4k qd1", REQ_OP_READ, 1, SZ_4K, false },
+	[BENCH_RND_READ_QD4 - BENCH_MIN_TESTCASE] = {
+		"rnd read 4k qd4", REQ_OP_READ, 4, SZ_4K, false },
+	[BENCH_RND_READ_QD16 - BENCH_MIN_TESTCASE] = {
+		"rnd read 4k qd16", REQ_OP_READ, 16, SZ_4K, false },
+	[BENCH_RND_WRITE_QD1 - BENCH_MIN_TESTCASE] = {
+		"rnd write 4k qd1", REQ_OP_WRITE, 1, SZ_4K, false },
+	[BENCH_RND_WRITE_QD4 - BENCH_MIN_TESTCASE] = {
+		"rnd write 4k qd4", REQ_OP_WRITE, 4, SZ_4K, false },
+	[BENCH_RND_WRITE_QD16 - BENCH_MIN_TESTCASE] = {
+		"rnd write 4k qd16", REQ_OP_WRITE, 16, SZ_4K, false },
+	[BENCH_READ_UNDER_WRITEBACK - BENCH_MIN_TESTCASE] = {
+		"rnd read 4k under writeback", REQ_OP_READ, 1, SZ_4K, true },
+	[BENCH_DISCARD - BENCH_MIN_TESTCASE] = {
+		"discard 1m", REQ_OP_DISCARD, 1, SZ_1M, false },
+};
+
+struct mmc_block_bench;
+
+/* One request slot of the benchmark */
+struct mmc_block_bench_io {
+	struct mmc_block_bench *bench;
+	void *buf;
+	ktime_t start;
+	bool busy;
+	bool background;
+};
+
+struct mmc_block_bench {
+	/* Number of measured requests per testcase, set through debugfs */
+	u32 nr_ios;
+	/* The value of nr_ios the current run was started with */
+	unsigned int nr_run;
+	spinlock_t lock;
+	wait_queue_head_t wait;
+	unsigned int inflight;
+	unsigned int bg_inflight;
+	unsigned int done;
+	unsigned int errors;
+	/* Per request latency of the current testcase, in ns */
+	u64 *lat;
+	void *wb_buf;
+	struct mmc_block_bench_io io[BENCH_MAX_DEPTH + BENCH_WB_DEPTH];
+	/* Results of the last run, returned when reading the test file */
+	char *report;
+	size_t report_len;
 };
 
 struct mmc_block_test_debug {
@@ -118,6 +205,8 @@ struct mmc_block_test_debug {
 	struct dentry *send_invalid_packed_test;
 	struct dentry *random_test_seed;
 	struct dentry *packing_control_test;
+	struct dentry *bench_test;
+	struct dentry *bench_nr_ios;
 };
 
 struct mmc_block_test_data {
@@ -149,6 +238,8 @@ struct mmc_block_test_data {
 	struct test_info test_info;
 	/* mmc block device test */
 	struct blk_dev_test_type bdt;
+	/* State of the benchmark test group */
+	struct mmc_block_bench bench;
 };
 
 static struct mmc_block_test_data *mbtd;
@@ -474,6 +565,11 @@ static char *get_test_case_str(struct test_data *td)
 		return NULL;
 	}
 
+	if (td->test_info.testcase >= BENCH_MIN_TESTCASE &&
+	    td->test_info.testcase <= BENCH_MAX_TESTCASE)
+		return (char *)bench_cases[td->test_info.testcase -
+					   BENCH_MIN_TESTCASE].name;
+
 	switch (td->test_info.testcase) {
 	case TEST_STOP_DUE_TO_FLUSH:
 		return " stop due to flush";
@@ -1902,6 +1998,433 @@ const struct file_operations write_packing_control_test_ops = {
 	.read = write_packing_control_test_read,
 };
 
+/* BENCHMARK TEST */
+static void bench_end_io(struct request *rq, int err)
+{
+	struct mmc_block_bench_io *io = rq->end_io_data;
+	struct mmc_block_bench *bench = io->bench;
+	u64 lat = ktime_to_ns(ktime_sub(ktime_get(), io->start));
+	unsigned long flags;
+
+	/* Called with the queue lock held */
+	__blk_put_request(rq->q, rq);
+
+	spin_lock_irqsave(&bench->lock, flags);
+	if (err)
+		bench->errors++;
+	if (io->background) {
+		bench->bg_inflight--;
+	} else {
+		bench->lat[bench->done++] = lat;
+		bench->inflight--;
+	}
+	io->busy = false;
+	spin_unlock_irqrestore(&bench->lock, flags);
+
+	wake_up(&bench->wait);
+}
+
+/*
+ * Requests are built the way test-iosched builds its own and inserted at
+ * the back of the dispatch queue, so they reach the driver in issue order
+ * and go through CMDQ and ICE exactly like file system requests.
+ */
+static int bench_issue(struct request_queue *q, struct mmc_block_bench_io *io,
+		       int op, sector_t sector, unsigned int size)
+{
+	struct request *rq;
+	int ret;
+
+	rq = blk_get_request(q, op == REQ_OP_READ ? READ : WRITE, GFP_KERNEL);
+	if (IS_ERR(rq))
+		return PTR_ERR(rq);
+
+	rq->cmd_type = REQ_TYPE_FS;
+	if (op == REQ_OP_DISCARD) {
+		req_set_op(rq, REQ_OP_DISCARD);
+		rq->__data_len = size;
+	} else {
+		ret = blk_rq_map_kern(q, rq, io->buf, size, GFP_KERNEL);
+		if (ret) {
+			blk_put_request(rq);
+			return ret;
+		}
+	}
+
+	rq->__sector = sector;
+	rq->end_io_data = io;
+	io->start = ktime_get();
+	blk_execute_rq_nowait(q, NULL, rq, 0, bench_end_io);
+
+	return 0;
+}
+
+static struct mmc_block_bench_io *bench_get_io(struct mmc_block_bench *bench,
+					       bool background,
+					       unsigned int depth)
+{
+	struct mmc_block_bench_io *io;
+	unsigned long flags;
+	int i, first = background ? BENCH_MAX_DEPTH : 0;
+	int last = background ? BENCH_MAX_DEPTH + BENCH_WB_DEPTH : depth;
+
+	spin_lock_irqsave(&bench->lock, flags);
+	for (i = first; i < last; i++) {
+		io = &bench->io[i];
+		if (io->busy)
+			continue;
+
+		io->busy = true;
+		io->background = background;
+		if (background)
+			bench->bg_inflight++;
+		else
+			bench->inflight++;
+		spin_unlock_irqrestore(&bench->lock, flags);
+		return io;
+	}
+	spin_unlock_irqrestore(&bench->lock, flags);
+
+	return NULL;
+}
+
+static void bench_put_io(struct mmc_block_bench *bench,
+			 struct mmc_block_bench_io *io)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&bench->lock, flags);
+	if (io->background)
+		bench->bg_inflight--;
+	else
+		bench->inflight--;
+	io->busy = false;
+	spin_unlock_irqrestore(&bench->lock, flags);
+}
+
+static bool bench_can_issue(struct mmc_block_bench *bench,
+			    const struct mmc_block_bench_case *bc,
+			    unsigned int issued)
+{
+	unsigned long flags;
+	bool ret;
+
+	spin_lock_irqsave(&bench->lock, flags);
+	ret = bench->done == issued ||
+		(issued < bench->nr_run && bench->inflight < bc->depth) ||
+		(bc->writeback && bench->bg_inflight < BENCH_WB_DEPTH);
+	spin_unlock_irqrestore(&bench->lock, flags);
+
+	return ret;
+}
+
+static int bench_cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static u64 bench_percentile(struct mmc_block_bench *bench, unsigned int pct)
+{
+	return bench->lat[div_u64((u64)(bench->done - 1) * pct, 100)];
+}
+
+static void bench_report(struct test_data *td,
+			 const struct mmc_block_bench_case *bc, u64 runtime)
+{
+	struct mmc_block_bench *bench = &mbtd->bench;
+	char line[160];
+	u64 iops;
+
+	if (!bench->done)
+		return;
+
+	sort(bench->lat, bench->done, sizeof(*bench->lat), bench_cmp_u64,
+	     NULL);
+	iops = div64_u64((u64)bench->done * NSEC_PER_SEC, runtime ?: 1);
+
+	snprintf(line, sizeof(line),
+		 "%-28s %7llu %8llu %8llu %8llu %8llu %4u\n", bc->name, iops,
+		 div_u64(bench_percentile(bench, 50), NSEC_PER_USEC),
+		 div_u64(bench_percentile(bench, 90), NSEC_PER_USEC),
+		 div_u64(bench_percentile(bench, 99), NSEC_PER_USEC),
+		 div_u64(bench->lat[bench->done - 1], NSEC_PER_USEC),
+		 bench->errors);
+	test_pr_info("%s: %s", __func__, line);
+
+	if (bench->report)
+		bench->report_len += scnprintf(bench->report +
+				bench->report_len,
+				BENCH_REPORT_SIZE - bench->report_len,
+				"%s", line);
+}
+
+static int run_bench_test(struct test_data *td)
+{
+	struct mmc_block_bench *bench = &mbtd->bench;
+	const struct mmc_block_bench_case *bc =
+		&bench_cases[td->test_info.testcase - BENCH_MIN_TESTCASE];
+	unsigned int *seed = &mbtd->random_test_seed;
+	/* Foreground requests use the first half of the test area */
+	sector_t range = (TEST_MAX_SECTOR_RANGE >> 9) / 2;
+	sector_t nr_sects = bc->size >> 9;
+	sector_t sector, wb_sector = td->start_sector + range;
+	sector_t seq_sector = td->start_sector;
+	struct mmc_block_bench_io *io;
+	unsigned int issued = 0;
+	ktime_t start;
+	int ret = 0;
+
+	bench->inflight = 0;
+	bench->bg_inflight = 0;
+	bench->done = 0;
+	bench->errors = 0;
+
+	start = ktime_get();
+	while (bench->done < bench->nr_run) {
+		if (!wait_event_timeout(bench->wait,
+					bench_can_issue(bench, bc, issued),
+					msecs_to_jiffies(BENCH_WAIT_MS))) {
+			test_pr_err("%s: timed out, %u of %u done", __func__,
+				    bench->done, issued);
+			ret = -ETIMEDOUT;
+			break;
+		}
+
+		while (bc->writeback &&
+		       (io = bench_get_io(bench, true, 0))) {
+			if (wb_sector + (BENCH_WB_SIZE >> 9) >
+			    td->start_sector + 2 * range)
+				wb_sector = td->start_sector + range;
+			ret = bench_issue(td->req_q, io, REQ_OP_WRITE,
+					  wb_sector, BENCH_WB_SIZE);
+			if (ret) {
+				bench_put_io(bench, io);
+				goto drain;
+			}
+			wb_sector += BENCH_WB_SIZE >> 9;
+		}
+
+		while (issued < bench->nr_run &&
+		       (io = bench_get_io(bench, false, bc->depth))) {
+			if (bc->op == REQ_OP_DISCARD) {
+				if (seq_sector + nr_sects >
+				    td->start_sector + range)
+					seq_sector = td->start_sector;
+				sector = seq_sector;
+				seq_sector += nr_sects;
+			} else {
+				sector = td->start_sector +
+					 (sector_t)pseudo_random_seed(seed, 0,
+						range / nr_sects) * nr_sects;
+			}
+			ret = bench_issue(td->req_q, io, bc->op, sector,
+					  bc->size);
+			if (ret) {
+				bench_put_io(bench, io);
+				goto drain;
+			}
+			issued++;
+		}
+	}
+
+drain:
+	/* Let the foreground and background requests in flight finish */
+	wait_event_timeout(bench->wait,
+			   !bench->inflight && !bench->bg_inflight,
+			   msecs_to_jiffies(BENCH_WAIT_MS));
+	if (bench->inflight || bench->bg_inflight)
+		test_pr_err("%s: %u requests did not complete", __func__,
+			    bench->inflight + bench->bg_inflight);
+
+	bench_report(td, bc, ktime_to_ns(ktime_sub(ktime_get(), start)));
+	test_iosched_mark_test_completion();
+
+	return ret;
+}
+
+static bool check_bench_completion(struct test_data *td)
+{
+	return !mbtd->bench.inflight && !mbtd->bench.bg_inflight;
+}
+
+static int check_bench_result(struct test_data *td)
+{
+	if (mbtd->bench.errors) {
+		test_pr_err("%s: %u requests failed", __func__,
+			    mbtd->bench.errors);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static int bench_alloc(struct mmc_block_bench *bench)
+{
+	int i;
+
+	bench->nr_run = bench->nr_ios;
+	bench->lat = vmalloc(bench->nr_run * sizeof(*bench->lat));
+	bench->wb_buf = kzalloc(BENCH_WB_SIZE, GFP_KERNEL);
+	if (!bench->lat || !bench->wb_buf)
+		return -ENOMEM;
+
+	for (i = 0; i < ARRAY_SIZE(bench->io); i++) {
+		bench->io[i].bench = bench;
+		bench->io[i].busy = false;
+		if (i >= BENCH_MAX_DEPTH) {
+			bench->io[i].buf = bench->wb_buf;
+			continue;
+		}
+		bench->io[i].buf = kzalloc(SZ_4K, GFP_KERNEL);
+		if (!bench->io[i].buf)
+			return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void bench_free(struct mmc_block_bench *bench)
+{
+	int i;
+
+	for (i = 0; i < BENCH_MAX_DEPTH; i++) {
+		kfree(bench->io[i].buf);
+		bench->io[i].buf = NULL;
+	}
+	kfree(bench->wb_buf);
+	bench->wb_buf = NULL;
+	vfree(bench->lat);
+	bench->lat = NULL;
+}
+
+static ssize_t bench_test_write(struct file *file,
+				const char __user *buf,
+				size_t count,
+				loff_t *ppos)
+{
+	struct mmc_block_bench *bench = &mbtd->bench;
+	struct request_queue *req_q = test_iosched_get_req_queue();
+	struct mmc_queue *mq;
+	int ret = 0;
+	int i = 0;
+	int number = -1;
+	int j = 0;
+
+	test_pr_info("%s: -- bench TEST --", __func__);
+
+	if (!req_q || !req_q->queuedata) {
+		test_pr_err("%s: NULL request queue", __func__);
+		return count;
+	}
+	mq = req_q->queuedata;
+
+	sscanf(buf, "%d", &number);
+
+	if (number <= 0)
+		number = 1;
+
+	if (!bench->nr_ios)
+		bench->nr_ios = BENCH_DEFAULT_NR_IOS;
+
+	if (!bench->report)
+		return count;
+
+	mbtd->test_group = TEST_BENCH_GROUP;
+
+	if (!mbtd->random_test_seed)
+		mbtd->random_test_seed =
+			(unsigned int)(get_jiffies_64() & 0xFFFF);
+
+	if (bench_alloc(bench)) {
+		test_pr_err("%s: failed to allocate buffers", __func__);
+		goto out;
+	}
+
+	/* Tag the results so that runs of different setups can be compared */
+	bench->report_len = scnprintf(bench->report, BENCH_REPORT_SIZE,
+			"%s: cmdq %s, ice %s, %u requests, seed %u\n"
+			"%-28s %7s %8s %8s %8s %8s %4s\n",
+			mmc_hostname(mq->card->host),
+			mmc_card_cmdq(mq->card) ? "on" : "off",
+			mq->card->host->inlinecrypt_support ? "on" : "off",
+			bench->nr_run, mbtd->random_test_seed,
+			"TESTCASE", "IOPS", "P50(us)", "P90(us)", "P99(us)",
+			"MAX(us)", "ERR");
+
+	memset(&mbtd->test_info, 0, sizeof(struct test_info));
+
+	mbtd->test_info.data = mbtd;
+	mbtd->test_info.run_test_fn = run_bench_test;
+	mbtd->test_info.check_test_completion_fn = check_bench_completion;
+	mbtd->test_info.check_test_result_fn = check_bench_result;
+	mbtd->test_info.get_test_case_str_fn = get_test_case_str;
+	mbtd->test_info.timeout_msec = BENCH_TIMEOUT_MS;
+
+	for (i = 0; i < number; ++i) {
+		test_pr_info("%s: Cycle # %d / %d", __func__, i+1, number);
+		test_pr_info("%s: ====================", __func__);
+
+		for (j = BENCH_MIN_TESTCASE; j <= BENCH_MAX_TESTCASE; j++) {
+			mbtd->test_info.testcase = j;
+			ret = test_iosched_start_test(&mbtd->test_info);
+			if (ret)
+				break;
+			/* Allow FS requests to be dispatched */
+			msleep(1000);
+		}
+	}
+
+	test_pr_info("%s: Completed all the test cases.", __func__);
+
+out:
+	bench_free(bench);
+	return count;
+}
+
+static ssize_t bench_test_read(struct file *file,
+			       char __user *buffer,
+			       size_t count,
+			       loff_t *offset)
+{
+	struct mmc_block_bench *bench = &mbtd->bench;
+	char *buf;
+	size_t len;
+	ssize_t ret;
+
+	buf = kmalloc(BENCH_REPORT_SIZE + PAGE_SIZE, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	len = scnprintf(buf, PAGE_SIZE,
+		 "\nbench_test\n"
+		 "=========\n"
+		 "Description:\n"
+		 "This test measures IOPS and latency percentiles of\n"
+		 "- Random 4K reads at queue depth 1, 4 and 16\n"
+		 "- Random 4K writes at queue depth 1, 4 and 16\n"
+		 "- Random 4K reads while sequential writes are in flight\n"
+		 "- 1M discards\n"
+		 "Write the number of cycles to run. The number of requests\n"
+		 "per testcase is set in utils/bench_nr_ios. Results are\n"
+		 "tagged with the CMDQ and ICE setup of the card.\n\n");
+	if (bench->report_len)
+		len += scnprintf(buf + len, BENCH_REPORT_SIZE, "%s",
+				 bench->report);
+
+	ret = simple_read_from_buffer(buffer, count, offset, buf, len);
+	kfree(buf);
+
+	return ret;
+}
+
+const struct file_operations bench_test_ops = {
+	.open = test_open,
+	.write = bench_test_write,
+	.read = bench_test_read,
+};
+
 static void mmc_block_test_debugfs_cleanup(void)
 {
 	debugfs_remove(mbtd->debug.random_test_seed);
@@ -1909,6 +2432,8 @@ static void mmc_block_test_debugfs_cleanup(void)
 	debugfs_remove(mbtd->debug.err_check_test);
 	debugfs_remove(mbtd->debug.send_invalid_packed_test);
 	debugfs_remove(mbtd->debug.packing_control_test);
+	debugfs_remove(mbtd->debug.bench_test);
+	debugfs_remove(mbtd->debug.bench_nr_ios);
 }
 
 static int mmc_block_test_debugfs_init(void)
@@ -1970,6 +2495,25 @@ static int mmc_block_test_debugfs_init(void)
 	if (!mbtd->debug.packing_control_test)
 		goto err_nomem;
 
+	mbtd->debug.bench_nr_ios = debugfs_create_u32(
+					"bench_nr_ios",
+					S_IRUGO | S_IWUGO,
+					utils_root,
+					&mbtd->bench.nr_ios);
+
+	if (!mbtd->debug.bench_nr_ios)
+		goto err_nomem;
+
+	mbtd->debug.bench_test = debugfs_create_file(
+					"bench_test",
+					S_IRUGO | S_IWUGO,
+					tests_root,
+					NULL,
+					&bench_test_ops);
+
+	if (!mbtd->debug.bench_test)
+		goto err_nomem;
+
 	return 0;
 
 err_nomem:
@@ -2017,6 +2561,11 @@ static int __init mmc_block_test_init(void)
 		return -ENODEV;
 	}
 
+	mbtd->bench.nr_ios = BENCH_DEFAULT_NR_IOS;
+	spin_lock_init(&mbtd->bench.lock);
+	init_waitqueue_head(&mbtd->bench.wait);
+	mbtd->bench.report = kzalloc(BENCH_REPORT_SIZE, GFP_KERNEL);
+
 	mbtd->bdt.init_fn = mmc_block_test_probe;
 	mbtd->bdt.exit_fn = mmc_block_test_remove;
 	INIT_LIST_HEAD(&mbtd->bdt.list);
@@ -2028,6 +2577,7 @@ static int __init mmc_block_test_init(void)
 static void __exit mmc_block_test_exit(void)
 {
 	test_iosched_unregister(&mbtd->bdt);
+	kfree(mbtd->bench.report);
 	kfree(mbtd);
 }
 
@@ -291,6 +291,75 @@ static void mmc_queue_setup_discard(struct request_queue *q,
 		queue_flag_set_unlocked(QUEUE_FLAG_SECERASE, q);
 }
 
+static enum mmc_cmdq_class mmc_cmdq_req_class(struct request *req)
+{
+	if (mmc_req_is_special(req))
+		return MMC_CMDQ_CLASS_DCMD;
+	if (rq_data_dir(req) == READ)
+		return MMC_CMDQ_CLASS_READ;
+	if (rq_is_sync(req))
+		return MMC_CMDQ_CLASS_SYNC_WRITE;
+	return MMC_CMDQ_CLASS_ASYNC_WRITE;
+}
+
+/**
+ * mmc_cmdq_issue_account() - note a request being issued to the CQ
+ * @mq: mmc queue
+ * @mqrq: slot of the request about to be issued
+ *
+ * Records the request class and issue time for the latency stats. Reads
+ * are the only synchronous traffic the block layer does not already
+ * prioritize, so when cmdq_read_prio is set and background writes occupy
+ * any of the task slots return true to have the read's task descriptor
+ * marked high priority, letting the device schedule it ahead of them.
+ * Called from the cmdq thread only.
+ */
+bool mmc_cmdq_issue_account(struct mmc_queue *mq, struct mmc_queue_req *mqrq)
+{
+	struct mmc_cmdq_context_info *ctx = &mq->card->host->cmdq_ctx;
+	unsigned long tag;
+
+	mqrq->cmdq_class = mmc_cmdq_req_class(mqrq->req);
+	mqrq->cmdq_issue_time = ktime_get();
+
+	if (mqrq->cmdq_class != MMC_CMDQ_CLASS_READ || !mq->cmdq_read_prio)
+		return false;
+
+	for_each_set_bit(tag, &ctx->data_active_reqs,
+			 mq->card->ext_csd.cmdq_depth - 1) {
+		if (mq->mqrq_cmdq[tag].req != mqrq->req &&
+		    mq->mqrq_cmdq[tag].cmdq_class ==
+		    MMC_CMDQ_CLASS_ASYNC_WRITE)
+			return true;
+	}
+
+	return false;
+}
+
+void mmc_cmdq_complete_account(struct mmc_queue *mq,
+			       struct mmc_queue_req *mqrq)
+{
+	struct mmc_cmdq_class_stats *stats = &mq->cmdq_stats[mqrq->cmdq_class];
+	u64 lat_us = ktime_us_delta(ktime_get(), mqrq->cmdq_issue_time);
+	unsigned long flags;
+
+	spin_lock_irqsave(&mq->cmdq_stats_lock, flags);
+	stats->count++;
+	stats->total_us += lat_us;
+	if (lat_us > stats->max_us)
+		stats->max_us = lat_us;
+	spin_unlock_irqrestore(&mq->cmdq_stats_lock, flags);
+}
+
+void mmc_cmdq_reset_stats(struct mmc_queue *mq)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&mq->cmdq_stats_lock, flags);
+	memset(mq->cmdq_stats, 0, sizeof(mq->cmdq_stats));
+	spin_unlock_irqrestore(&mq->cmdq_stats_lock, flags);
+}
+
 /**
  * mmc_blk_cmdq_setup_queue
  * @mq: mmc queue
@@ -682,6 +751,8 @@ int mmc_cmdq_init(struct mmc_queue *mq, struct mmc_card *card)
 
 	blk_queue_rq_timed_out(mq->queue, mmc_cmdq_rq_timed_out);
 	blk_queue_rq_timeout(mq->queue, 120 * HZ);
+	spin_lock_init(&mq->cmdq_stats_lock);
+	mq->cmdq_read_prio = true;
 	card->cmdq_init = true;
 
 	goto out;
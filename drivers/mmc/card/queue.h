@@ -38,6 +38,21 @@ struct mmc_packed {
 	s16			idx_failure;
 };
 
+/* Request classes used by the CQ dispatch policy and latency stats */
+enum mmc_cmdq_class {
+	MMC_CMDQ_CLASS_READ,
+	MMC_CMDQ_CLASS_SYNC_WRITE,
+	MMC_CMDQ_CLASS_ASYNC_WRITE,
+	MMC_CMDQ_CLASS_DCMD,
+	MMC_CMDQ_NR_CLASS,
+};
+
+struct mmc_cmdq_class_stats {
+	unsigned long		count;
+	u64			total_us;
+	u64			max_us;
+};
+
 struct mmc_queue_req {
 	struct request		*req;
 	struct mmc_blk_request	brq;
@@ -49,6 +64,8 @@ struct mmc_queue_req {
 	enum mmc_packed_type	cmd_type;
 	struct mmc_packed	*packed;
 	struct mmc_cmdq_req	cmdq_req;
+	enum mmc_cmdq_class	cmdq_class;
+	ktime_t			cmdq_issue_time;
 };
 
 struct mmc_queue {
@@ -79,6 +96,9 @@ struct mmc_queue {
 	struct completion	cmdq_pending_req_done;
 	struct completion	cmdq_shutdown_complete;
 	struct request		*cmdq_req_peeked;
+	bool			cmdq_read_prio;
+	spinlock_t		cmdq_stats_lock;
+	struct mmc_cmdq_class_stats cmdq_stats[MMC_CMDQ_NR_CLASS];
 	int (*err_check_fn)(struct mmc_card *, struct mmc_async_req *);
 	void (*packed_test_fn)(struct request_queue *, struct mmc_queue_req *);
 	void (*cmdq_shutdown)(struct mmc_queue *);
@@ -113,4 +133,10 @@ extern void print_mmc_packing_stats(struct mmc_card *card);
 extern int mmc_cmdq_init(struct mmc_queue *mq, struct mmc_card *card);
 extern void mmc_cmdq_clean(struct mmc_queue *mq, struct mmc_card *card);
 
+extern bool mmc_cmdq_issue_account(struct mmc_queue *mq,
+				   struct mmc_queue_req *mqrq);
+extern void mmc_cmdq_complete_account(struct mmc_queue *mq,
+				      struct mmc_queue_req *mqrq);
+extern void mmc_cmdq_reset_stats(struct mmc_queue *mq);
+
 #endif
@@ -1296,6 +1296,21 @@ static int mmc_cmdq_check_retune(struct mmc_host *host)
 	return err;
 }
 
+static void mmc_account_prep(struct mmc_host *host, ktime_t start,
+			     bool hidden)
+{
+	struct mmc_prep_stats *ps = &host->prep_stats;
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	if (hidden) {
+		ps->hidden_cnt++;
+		ps->hidden_ns += ns;
+	} else {
+		ps->exposed_cnt++;
+		ps->exposed_ns += ns;
+	}
+}
+
 static int mmc_start_cmdq_request(struct mmc_host *host,
 				   struct mmc_request *mrq)
 {
@@ -1324,7 +1339,14 @@ static int mmc_start_cmdq_request(struct mmc_host *host,
 	mmc_host_clk_hold(host);
 	mmc_cmdq_check_retune(host);
 	if (likely(host->cmdq_ops->request)) {
+		ktime_t start = ktime_get();
+		/* other tags still on the bus hide this one's preparation */
+		bool hidden = mrq->data && (host->cmdq_ctx.data_active_reqs &
+					~BIT(mrq->cmdq_req->tag));
+
 		ret = host->cmdq_ops->request(host, mrq);
+		if (mrq->data && !ret)
+			mmc_account_prep(host, start, hidden);
 	} else {
 		ret = -ENOENT;
 		pr_err("%s: %s: cmdq request host op is not available\n",
@@ -1762,10 +1784,14 @@ EXPORT_SYMBOL(mmc_is_req_done);
 static void mmc_pre_req(struct mmc_host *host, struct mmc_request *mrq,
 		 bool is_first_req)
 {
+	ktime_t start;
+
 	if (host->ops->pre_req) {
+		start = ktime_get();
 		mmc_host_clk_hold(host);
 		host->ops->pre_req(host, mrq, is_first_req);
 		mmc_host_clk_release(host);
+		mmc_account_prep(host, start, !is_first_req);
 	}
 }
 
@@ -454,6 +454,51 @@ static const struct file_operations mmc_err_stats_fops = {
 	.write	= mmc_err_stats_write,
 };
 
+static int mmc_prep_stats_show(struct seq_file *file, void *data)
+{
+	struct mmc_host *host = (struct mmc_host *)file->private;
+	struct mmc_prep_stats ps;
+	u64 total_ns;
+
+	if (!host)
+		return -EINVAL;
+
+	ps = host->prep_stats;
+	total_ns = ps.hidden_ns + ps.exposed_ns;
+
+	seq_printf(file, "# Preps overlapped with a transfer:\t %llu (%llu us)\n",
+		   ps.hidden_cnt, div_u64(ps.hidden_ns, NSEC_PER_USEC));
+	seq_printf(file, "# Preps with the bus idle:\t\t %llu (%llu us)\n",
+		   ps.exposed_cnt, div_u64(ps.exposed_ns, NSEC_PER_USEC));
+	seq_printf(file, "# Prep time hidden:\t\t\t %llu%%\n",
+		   total_ns ? div64_u64(ps.hidden_ns * 100, total_ns) : 0);
+	return 0;
+}
+
+static int mmc_prep_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mmc_prep_stats_show, inode->i_private);
+}
+
+static ssize_t mmc_prep_stats_write(struct file *filp, const char __user *ubuf,
+				   size_t cnt, loff_t *ppos)
+{
+	struct mmc_host *host = filp->f_mapping->host->i_private;
+
+	if (!host)
+		return -EINVAL;
+
+	memset(&host->prep_stats, 0, sizeof(host->prep_stats));
+
+	return cnt;
+}
+
+static const struct file_operations mmc_prep_stats_fops = {
+	.open	= mmc_prep_stats_open,
+	.read	= seq_read,
+	.write	= mmc_prep_stats_write,
+};
+
 void mmc_add_host_debugfs(struct mmc_host *host)
 {
 	struct dentry *root;
@@ -507,6 +552,10 @@ void mmc_add_host_debugfs(struct mmc_host *host)
 		&mmc_err_stats_fops))
 		goto err_node;
 
+	if (!debugfs_create_file("prep_stats", 0600, root, host,
+		&mmc_prep_stats_fops))
+		goto err_node;
+
 #ifdef CONFIG_MMC_CLKGATE
 	if (!debugfs_create_u32("clk_delay", (S_IRUSR | S_IWUSR),
 				root, &host->clk_delay))
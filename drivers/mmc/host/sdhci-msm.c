@@ -40,6 +40,7 @@
 #include <linux/msm-bus.h>
 #include <linux/pm_runtime.h>
 #include <linux/nvmem-consumer.h>
+#include <linux/thermal.h>
 #include <trace/events/mmc.h>
 
 #include "sdhci-msm.h"
@@ -1207,6 +1208,150 @@ static void sdhci_msm_set_mmc_drv_type(struct sdhci_host *host, u32 opcode,
 			drv_type);
 }
 
+static u32 sdhci_msm_tuning_crc_errs(struct mmc_host *mmc)
+{
+	return mmc->err_stats[MMC_ERR_CMD_CRC] +
+		mmc->err_stats[MMC_ERR_DAT_CRC];
+}
+
+/*
+ * Temperature band of the optional thermal zone named in DT, 0 if there is
+ * none. The zone is looked up on first use as it may register after us.
+ */
+static int sdhci_msm_tuning_temp_band(struct sdhci_msm_host *msm_host,
+				      int *band)
+{
+	struct sdhci_msm_tuning_cache *cache = &msm_host->tuning_cache;
+	struct thermal_zone_device *tz;
+	int temp, rc;
+
+	*band = 0;
+	if (!msm_host->pdata->tuning_tz_name)
+		return 0;
+
+	if (!cache->tz) {
+		tz = thermal_zone_get_zone_by_name(
+				msm_host->pdata->tuning_tz_name);
+		if (IS_ERR(tz))
+			return PTR_ERR(tz);
+		cache->tz = tz;
+	}
+
+	rc = thermal_zone_get_temp(cache->tz, &temp);
+	if (rc)
+		return rc;
+
+	*band = temp / SDHCI_MSM_TUNING_TEMP_BAND;
+	return 0;
+}
+
+static bool sdhci_msm_tuning_match(struct sdhci_host *host,
+				   struct sdhci_msm_tuning_entry *entry,
+				   int band)
+{
+	struct mmc_host *mmc = host->mmc;
+
+	return entry->valid && entry->clock == host->clock &&
+		entry->timing == mmc->ios.timing &&
+		entry->signal_voltage == mmc->ios.signal_voltage &&
+		entry->temp_band == band &&
+		!memcmp(entry->cid, mmc->card->raw_cid, sizeof(entry->cid));
+}
+
+/*
+ * Reapply the phase found by an earlier tuning at the same operating point
+ * instead of sending the CMD19/CMD21 sequence again. CRC errors since the
+ * last tuning mean that phase did not hold, so drop everything and retune.
+ */
+static int sdhci_msm_tuning_cache_apply(struct sdhci_host *host)
+{
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct sdhci_msm_host *msm_host = pltfm_host->priv;
+	struct sdhci_msm_tuning_cache *cache = &msm_host->tuning_cache;
+	struct mmc_host *mmc = host->mmc;
+	int i, band, rc;
+
+	if (!mmc->card)
+		return -ENODEV;
+
+	if (sdhci_msm_tuning_crc_errs(mmc) != cache->crc_errs) {
+		memset(cache->entry, 0, sizeof(cache->entry));
+		return -EILSEQ;
+	}
+
+	rc = sdhci_msm_tuning_temp_band(msm_host, &band);
+	if (rc)
+		return rc;
+
+	for (i = 0; i < SDHCI_MSM_TUNING_CACHE_SIZE; i++) {
+		if (sdhci_msm_tuning_match(host, &cache->entry[i], band))
+			break;
+	}
+	if (i == SDHCI_MSM_TUNING_CACHE_SIZE)
+		return -ENOENT;
+
+	rc = msm_init_cm_dll(host, DLL_INIT_NORMAL);
+	if (rc)
+		return rc;
+
+	rc = msm_config_cm_dll_phase(host, cache->entry[i].phase);
+	if (rc)
+		return rc;
+
+	msm_host->saved_tuning_phase = cache->entry[i].phase;
+	cache->avoided++;
+	pr_debug("%s: %s: reusing tuning phase %d\n", mmc_hostname(mmc),
+			__func__, cache->entry[i].phase);
+	return 0;
+}
+
+static void sdhci_msm_tuning_cache_store(struct sdhci_host *host, u8 phase)
+{
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct sdhci_msm_host *msm_host = pltfm_host->priv;
+	struct sdhci_msm_tuning_cache *cache = &msm_host->tuning_cache;
+	struct sdhci_msm_tuning_entry *entry;
+	struct mmc_host *mmc = host->mmc;
+	int i, band;
+
+	cache->full++;
+	cache->crc_errs = sdhci_msm_tuning_crc_errs(mmc);
+
+	if (!mmc->card || sdhci_msm_tuning_temp_band(msm_host, &band))
+		return;
+
+	/* Replace the entry for this operating point, else the oldest one */
+	for (i = 0; i < SDHCI_MSM_TUNING_CACHE_SIZE; i++) {
+		if (sdhci_msm_tuning_match(host, &cache->entry[i], band))
+			break;
+	}
+	if (i == SDHCI_MSM_TUNING_CACHE_SIZE) {
+		i = cache->next;
+		cache->next = (cache->next + 1) % SDHCI_MSM_TUNING_CACHE_SIZE;
+	}
+
+	entry = &cache->entry[i];
+	entry->valid = true;
+	memcpy(entry->cid, mmc->card->raw_cid, sizeof(entry->cid));
+	entry->clock = host->clock;
+	entry->timing = mmc->ios.timing;
+	entry->signal_voltage = mmc->ios.signal_voltage;
+	entry->temp_band = band;
+	entry->phase = phase;
+}
+
+static ssize_t show_tuning_stats(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct sdhci_host *host = dev_get_drvdata(dev);
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct sdhci_msm_host *msm_host = pltfm_host->priv;
+
+	return snprintf(buf, PAGE_SIZE, "full: %u avoided: %u\n",
+			msm_host->tuning_cache.full,
+			msm_host->tuning_cache.avoided);
+}
+
 int sdhci_msm_execute_tuning(struct sdhci_host *host, u32 opcode)
 {
 	unsigned long flags;
@@ -1255,6 +1400,10 @@ int sdhci_msm_execute_tuning(struct sdhci_host *host, u32 opcode)
 		goto out;
 	}
 
+	rc = sdhci_msm_tuning_cache_apply(host);
+	if (!rc)
+		goto out;
+
 	spin_lock_irqsave(&host->lock, flags);
 
 	if ((opcode == MMC_SEND_TUNING_BLOCK_HS200) &&
@@ -1421,6 +1570,7 @@ int sdhci_msm_execute_tuning(struct sdhci_host *host, u32 opcode)
 		if (rc)
 			goto kfree;
 		msm_host->saved_tuning_phase = phase;
+		sdhci_msm_tuning_cache_store(host, phase);
 		pr_debug("%s: %s: finally setting the tuning phase to %d\n",
 				mmc_hostname(mmc), __func__, phase);
 	} else {
@@ -2221,6 +2371,8 @@ struct sdhci_msm_pltfm_data *sdhci_msm_populate_pdata(struct device *dev,
 		msm_host->core_3_0v_support = true;
 
 	pdata->sdr104_wa = of_property_read_bool(np, "qcom,sdr104-wa");
+	of_property_read_string(np, "qcom,tuning-thermal-zone",
+				&pdata->tuning_tz_name);
 	msm_host->regs_restore.is_supported =
 		of_property_read_bool(np, "qcom,restore-after-cx-collapse");
 
@@ -5325,6 +5477,17 @@ static int sdhci_msm_probe(struct platform_device *pdev)
 		       mmc_hostname(host->mmc), __func__, ret);
 		device_remove_file(&pdev->dev, &msm_host->auto_cmd21_attr);
 	}
+
+	msm_host->tuning_cache.stats_attr.show = show_tuning_stats;
+	sysfs_attr_init(&msm_host->tuning_cache.stats_attr.attr);
+	msm_host->tuning_cache.stats_attr.attr.name = "tuning_stats";
+	msm_host->tuning_cache.stats_attr.attr.mode = S_IRUGO;
+	ret = device_create_file(&pdev->dev,
+				 &msm_host->tuning_cache.stats_attr);
+	if (ret)
+		pr_err("%s: %s: failed creating tuning stats attr: %d\n",
+		       mmc_hostname(host->mmc), __func__, ret);
+
 	if (sdhci_msm_is_bootdevice(&pdev->dev))
 		mmc_flush_detect_work(host->mmc);
 
@@ -5386,6 +5549,7 @@ static int sdhci_msm_remove(struct platform_device *pdev)
 		device_remove_file(&pdev->dev, &msm_host->polling);
 
 	device_remove_file(&pdev->dev, &msm_host->auto_cmd21_attr);
+	device_remove_file(&pdev->dev, &msm_host->tuning_cache.stats_attr);
 	device_remove_file(&pdev->dev, &msm_host->msm_bus_vote.max_bus_bw);
 	pm_runtime_disable(&pdev->dev);
 
@@ -161,6 +161,37 @@ struct sdhci_msm_pltfm_data {
 	bool rclk_wa;
 	u32 *bus_clk_table;
 	unsigned char bus_clk_cnt;
+	const char *tuning_tz_name;
+};
+
+/* Number of tuning results remembered across runtime suspend */
+#define SDHCI_MSM_TUNING_CACHE_SIZE	4
+/* Width of the temperature bands a tuning result is valid in, mC */
+#define SDHCI_MSM_TUNING_TEMP_BAND	10000
+
+/*
+ * Tuning phase found for one card at one clock, timing, signal voltage and
+ * temperature band.
+ */
+struct sdhci_msm_tuning_entry {
+	bool valid;
+	u32 cid[4];
+	unsigned int clock;
+	unsigned char timing;
+	unsigned char signal_voltage;
+	int temp_band;
+	u8 phase;
+};
+
+struct sdhci_msm_tuning_cache {
+	struct sdhci_msm_tuning_entry entry[SDHCI_MSM_TUNING_CACHE_SIZE];
+	unsigned int next;
+	/* CRC errors seen up to the last tuning, more mean a bad phase */
+	u32 crc_errs;
+	struct thermal_zone_device *tz;
+	unsigned int full;
+	unsigned int avoided;
+	struct device_attribute stats_attr;
 };
 
 struct sdhci_msm_bus_vote {
@@ -247,6 +278,7 @@ struct sdhci_msm_host {
 	bool tuning_done;
 	bool calibration_done;
 	u8 saved_tuning_phase;
+	struct sdhci_msm_tuning_cache tuning_cache;
 	bool en_auto_cmd21;
 	struct device_attribute auto_cmd21_attr;
 	bool is_sdiowakeup_enabled;
@@ -122,6 +122,7 @@ struct ppp {
 	spinlock_t	rlock;		/* lock for receive side 58 */
 	spinlock_t	wlock;		/* lock for transmit side 5c */
 	int		*xmit_recursion __percpu; /* xmit recursion detect */
+	unsigned long	xmit_owner;	/* PPP_XMIT_* bits */
 	int		mru;		/* max receive unit 60 */
 	unsigned int	flags;		/* control bits 64 */
 	unsigned int	xstate;		/* transmit state bits 68 */
@@ -369,6 +370,15 @@ static const int npindex_to_ethertype[NUM_NP] = {
 /*
  * Locking shorthand.
  */
+/*
+ * Bits in ppp.xmit_owner. Only one CPU at a time runs the transmit path;
+ * the others queue their packet on file.xq and set PPP_XMIT_AGAIN, so the
+ * CPU that owns the path picks it up instead of them spinning on wlock
+ * while it compresses and encrypts.
+ */
+#define PPP_XMIT_BUSY	0
+#define PPP_XMIT_AGAIN	1
+
 #define ppp_xmit_lock(ppp)	spin_lock_bh(&(ppp)->wlock)
 #define ppp_xmit_unlock(ppp)	spin_unlock_bh(&(ppp)->wlock)
 #define ppp_recv_lock(ppp)	spin_lock_bh(&(ppp)->rlock)
@@ -1430,15 +1440,15 @@ static void ppp_setup(struct net_device *dev)
  * Transmit-side routines.
  */
 
-/* Called to do any work queued up on the transmit side that can now be done */
-static void __ppp_xmit_process(struct ppp *ppp, struct sk_buff *skb)
+/* Send what file.xq holds, in order, for as long as the channels take it */
+static void ppp_xmit_drain(struct ppp *ppp)
 {
+	struct sk_buff *skb;
+
 	ppp_xmit_lock(ppp);
 	if (!ppp->closing) {
 		ppp_push(ppp);
 
-		if (skb)
-			skb_queue_tail(&ppp->file.xq, skb);
 		while (!ppp->xmit_pending &&
 		       (skb = skb_dequeue(&ppp->file.xq)))
 			ppp_send_frame(ppp, skb);
@@ -1449,11 +1459,36 @@ static void __ppp_xmit_process(struct ppp *ppp, struct sk_buff *skb)
 		else
 			netif_stop_queue(ppp->dev);
 	} else {
-		kfree_skb(skb);
+		skb_queue_purge(&ppp->file.xq);
 	}
 	ppp_xmit_unlock(ppp);
 }
 
+/* Called to do any work queued up on the transmit side that can now be done */
+static void __ppp_xmit_process(struct ppp *ppp, struct sk_buff *skb)
+{
+	if (skb)
+		skb_queue_tail(&ppp->file.xq, skb);
+
+	/* Pairs with the barrier after the owner drops PPP_XMIT_BUSY */
+	smp_mb__before_atomic();
+	set_bit(PPP_XMIT_AGAIN, &ppp->xmit_owner);
+	smp_mb__after_atomic();
+
+	while (!test_and_set_bit_lock(PPP_XMIT_BUSY, &ppp->xmit_owner)) {
+		clear_bit(PPP_XMIT_AGAIN, &ppp->xmit_owner);
+		smp_mb__after_atomic();
+
+		ppp_xmit_drain(ppp);
+
+		clear_bit_unlock(PPP_XMIT_BUSY, &ppp->xmit_owner);
+		smp_mb__after_atomic();
+		/* Another CPU queued a packet or woke a channel meanwhile */
+		if (!test_bit(PPP_XMIT_AGAIN, &ppp->xmit_owner))
+			break;
+	}
+}
+
 static void ppp_xmit_process(struct ppp *ppp, struct sk_buff *skb)
 {
 	local_bh_disable();
@@ -170,6 +170,8 @@ struct tun_file {
 	struct fasync_struct *fasync;
 	/* only used for fasnyc */
 	unsigned int flags;
+	/* read/write packet arrays, see TUNSETBATCH */
+	bool batch;
 	union {
 		u16 queue_index;
 		unsigned int ifindex;
@@ -460,6 +462,19 @@ static inline void tun_flow_save_rps_rxhash(struct tun_flow_entry *e, u32 hash)
  * different rxq no. here. If we could not get rxhash, then we would
  * hope the rxq no. may help here.
  */
+/* A multiqueue reader that pins one thread per queue can map each queue to
+ * the CPUs it runs on with xps_cpus. Flows the reader has not written to
+ * yet then stay on the CPU that sends them.
+ */
+static bool tun_xps_enabled(struct net_device *dev)
+{
+#ifdef CONFIG_XPS
+	return rcu_access_pointer(dev->xps_maps);
+#else
+	return false;
+#endif
+}
+
 static u16 tun_select_queue(struct net_device *dev, struct sk_buff *skb,
 			    void *accel_priv, select_queue_fallback_t fallback)
 {
@@ -477,6 +492,11 @@ static u16 tun_select_queue(struct net_device *dev, struct sk_buff *skb,
 		if (e) {
 			tun_flow_save_rps_rxhash(e, txq);
 			txq = e->queue_index;
+		} else if (tun_xps_enabled(dev)) {
+			/* New flows start on the queue read on this CPU */
+			txq = fallback(dev, skb);
+			while (unlikely(txq >= numqueues))
+				txq -= numqueues;
 		} else
 			/* use multiply and shift instead of expensive divide */
 			txq = ((u64)txq * numqueues) >> 32;
@@ -1368,17 +1388,59 @@ static ssize_t tun_get_user(struct tun_struct *tun, struct tun_file *tfile,
 	return total_len;
 }
 
+/* Feed every complete packet of a TUNSETBATCH array to tun_get_user(). A bad
+ * packet ends the batch; it is reported by the next write if the ones before
+ * it were accepted.
+ */
+static ssize_t tun_get_user_batch(struct tun_struct *tun,
+				  struct tun_file *tfile,
+				  struct iov_iter *from, int noblock)
+{
+	struct tun_batch_hdr hdr;
+	struct iov_iter pkt;
+	size_t done = 0, step;
+	ssize_t ret = -EINVAL;
+
+	while (iov_iter_count(from) >= sizeof(hdr)) {
+		pkt = *from;
+		if (copy_from_iter(&hdr, sizeof(hdr), &pkt) != sizeof(hdr)) {
+			ret = -EFAULT;
+			break;
+		}
+		if (!hdr.len || hdr.len > iov_iter_count(&pkt)) {
+			ret = -EINVAL;
+			break;
+		}
+		iov_iter_truncate(&pkt, hdr.len);
+
+		ret = tun_get_user(tun, tfile, NULL, &pkt, noblock);
+		if (ret < 0)
+			break;
+
+		step = min_t(size_t, sizeof(hdr) + ALIGN(hdr.len, TUN_BATCH_ALIGN),
+			     iov_iter_count(from));
+		iov_iter_advance(from, step);
+		done += step;
+	}
+
+	return done ? done : ret;
+}
+
 static ssize_t tun_chr_write_iter(struct kiocb *iocb, struct iov_iter *from)
 {
 	struct file *file = iocb->ki_filp;
 	struct tun_struct *tun = tun_get(file);
 	struct tun_file *tfile = file->private_data;
+	int noblock = file->f_flags & O_NONBLOCK;
 	ssize_t result;
 
 	if (!tun)
 		return -EBADFD;
 
-	result = tun_get_user(tun, tfile, NULL, from, file->f_flags & O_NONBLOCK);
+	if (READ_ONCE(tfile->batch))
+		result = tun_get_user_batch(tun, tfile, from, noblock);
+	else
+		result = tun_get_user(tun, tfile, NULL, from, noblock);
 
 	tun_put(tun);
 	return result;
@@ -1552,6 +1614,70 @@ static ssize_t tun_do_read(struct tun_struct *tun, struct tun_file *tfile,
 	return ret;
 }
 
+/* Bytes tun_put_user() needs for an skb of @len bytes */
+static size_t tun_put_user_len(struct tun_struct *tun, int len)
+{
+	size_t total = len;
+
+	if (tun->flags & IFF_VNET_HDR)
+		total += READ_ONCE(tun->vnet_hdr_sz);
+	if (!(tun->flags & IFF_NO_PI))
+		total += sizeof(struct tun_pi);
+
+	return total;
+}
+
+/* Fill @to with a TUNSETBATCH packet array. Only the first packet may block
+ * or be truncated; the array ends before a queued packet that does not fit.
+ */
+static ssize_t tun_do_read_batch(struct tun_struct *tun,
+				 struct tun_file *tfile,
+				 struct iov_iter *to, int noblock)
+{
+	struct tun_batch_hdr hdr;
+	struct iov_iter hdr_iter;
+	struct sk_buff *skb;
+	size_t done = 0, room, pad;
+	ssize_t ret = -EINVAL;
+	int len, err;
+
+	while (iov_iter_count(to) > sizeof(hdr)) {
+		room = iov_iter_count(to) - sizeof(hdr);
+		if (done) {
+			len = skb_array_peek_len(&tfile->tx_array);
+			if (!len || tun_put_user_len(tun, len) > room)
+				break;
+		}
+
+		skb = tun_ring_recv(tfile, noblock || done, &err);
+		if (!skb) {
+			ret = err;
+			break;
+		}
+
+		hdr_iter = *to;
+		iov_iter_advance(to, sizeof(hdr));
+		ret = tun_put_user(tun, tfile, skb, to);
+		if (unlikely(ret < 0)) {
+			kfree_skb(skb);
+			break;
+		}
+		consume_skb(skb);
+
+		hdr.len = min_t(size_t, ret, room);
+		if (copy_to_iter(&hdr, sizeof(hdr), &hdr_iter) != sizeof(hdr)) {
+			ret = -EFAULT;
+			break;
+		}
+		pad = min_t(size_t, ALIGN(hdr.len, TUN_BATCH_ALIGN) - hdr.len,
+			    iov_iter_count(to));
+		iov_iter_advance(to, pad);
+		done += sizeof(hdr) + hdr.len + pad;
+	}
+
+	return done ? done : ret;
+}
+
 static ssize_t tun_chr_read_iter(struct kiocb *iocb, struct iov_iter *to)
 {
 	struct file *file = iocb->ki_filp;
@@ -1561,7 +1687,11 @@ static ssize_t tun_chr_read_iter(struct kiocb *iocb, struct iov_iter *to)
 
 	if (!tun)
 		return -EBADFD;
-	ret = tun_do_read(tun, tfile, to, file->f_flags & O_NONBLOCK);
+	if (READ_ONCE(tfile->batch) && iov_iter_count(to))
+		ret = tun_do_read_batch(tun, tfile, to,
+					file->f_flags & O_NONBLOCK);
+	else
+		ret = tun_do_read(tun, tfile, to, file->f_flags & O_NONBLOCK);
 	ret = min_t(ssize_t, ret, len);
 	if (ret > 0)
 		iocb->ki_pos = ret;
@@ -2089,11 +2219,13 @@ static long __tun_chr_ioctl(struct file *file, unsigned int cmd,
 	int sndbuf;
 	int vnet_hdr_sz;
 	unsigned int ifindex;
+	int batch;
 	int le;
 	int ret;
 
 #ifdef CONFIG_ANDROID_PARANOID_NETWORK
-	if (cmd != TUNGETIFF && !capable(CAP_NET_ADMIN)) {
+	/* TUNSETBATCH only changes how the caller's own fd is read */
+	if (cmd != TUNGETIFF && cmd != TUNSETBATCH && !capable(CAP_NET_ADMIN)) {
 		return -EPERM;
 	}
 #endif
@@ -2113,6 +2245,13 @@ static long __tun_chr_ioctl(struct file *file, unsigned int cmd,
 				(unsigned int __user*)argp);
 	} else if (cmd == TUNSETQUEUE)
 		return tun_set_queue(file, &ifr);
+	else if (cmd == TUNSETBATCH) {
+		/* Per queue, so a queue can be switched while others run */
+		if (get_user(batch, (int __user *)argp))
+			return -EFAULT;
+		WRITE_ONCE(tfile->batch, !!batch);
+		return 0;
+	}
 
 	ret = 0;
 	rtnl_lock();
@@ -21,6 +21,7 @@
 #include <linux/pci.h>
 #include <linux/rtnetlink.h>
 #include <linux/power_supply.h>
+#include <linux/cpufreq.h>
 #include "wil6210.h"
 #include "wmi.h"
 #include "txrx.h"
@@ -1630,6 +1631,115 @@ static const struct file_operations fops_tx_latency = {
 	.llseek		= seq_lseek,
 };
 
+/*---------Rx page pool---------*/
+static int wil_rx_pool_debugfs_show(struct seq_file *s, void *data)
+{
+	struct wil6210_priv *wil = s->private;
+	struct wil_rx_pool *pool = &wil->rx_pool;
+	u64 total = pool->recycled + pool->allocated;
+
+	if (!pool->posted) {
+		seq_puts(s, "Rx page pool not in use\n");
+		return 0;
+	}
+
+	seq_printf(s, "page order: %u, cache: %u/%u\n", pool->order,
+		   pool->cache_head - pool->cache_tail, pool->cache_size);
+	seq_printf(s, "recycled: %llu\nallocated: %llu\n",
+		   pool->recycled, pool->allocated);
+	seq_printf(s, "busy: %llu\nevicted: %llu\nalloc_failed: %llu\n",
+		   pool->busy, pool->evicted, pool->alloc_failed);
+	seq_printf(s, "hit rate: %llu%%\n",
+		   total ? div64_u64(pool->recycled * 100, total) : 0);
+
+	return 0;
+}
+
+static int wil_rx_pool_seq_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wil_rx_pool_debugfs_show, inode->i_private);
+}
+
+static const struct file_operations fops_rx_pool = {
+	.open		= wil_rx_pool_seq_open,
+	.release	= single_release,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+};
+
+/*---------NAPI benchmark---------*/
+static int wil_napi_bench_debugfs_show(struct seq_file *s, void *data)
+{
+	static const char * const names[WIL_NAPI_MAX] = {"rx", "tx"};
+	struct wil6210_priv *wil = s->private;
+	int i;
+
+	seq_printf(s, "napi_bench %s, weight %d\n",
+		   wil->napi_bench ? "on" : "off", wil->napi_rx.weight);
+
+	for (i = 0; i < WIL_NAPI_MAX; i++) {
+		struct wil_napi_stats *st = &wil->napi_stats[i];
+		u64 ns_per_pkt, cycles_per_pkt = 0;
+		unsigned int khz = 0;
+
+		if (!st->pkts) {
+			seq_printf(s, "%s: no packets\n", names[i]);
+			continue;
+		}
+
+		/* cycles are estimated at the CPU's current frequency */
+		ns_per_pkt = div64_u64(st->ns, st->pkts);
+		if (cpu_online(st->cpu))
+			khz = cpufreq_quick_get(st->cpu);
+		if (khz)
+			cycles_per_pkt = div64_u64(st->ns * khz,
+						   st->pkts * USEC_PER_SEC);
+
+		seq_printf(s,
+			   "%s: cpu %d polls %llu pkts %llu pkts/poll %llu ns/pkt %llu cycles/pkt %llu (%u kHz)\n",
+			   names[i], st->cpu, st->polls, st->pkts,
+			   div64_u64(st->pkts, st->polls), ns_per_pkt,
+			   cycles_per_pkt, khz);
+	}
+
+	return 0;
+}
+
+static int wil_napi_bench_seq_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wil_napi_bench_debugfs_show,
+			   inode->i_private);
+}
+
+/* Any write clears the statistics; 0 stops collecting them */
+static ssize_t wil_napi_bench_write(struct file *file, const char __user *buf,
+				    size_t len, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct wil6210_priv *wil = s->private;
+	int val, rc;
+
+	rc = kstrtoint_from_user(buf, len, 0, &val);
+	if (rc) {
+		wil_err(wil, "Invalid argument\n");
+		return rc;
+	}
+
+	wil->napi_bench = false;
+	memset(wil->napi_stats, 0, sizeof(wil->napi_stats));
+	wil->napi_bench = !!val;
+
+	return len;
+}
+
+static const struct file_operations fops_napi_bench = {
+	.open		= wil_napi_bench_seq_open,
+	.release	= single_release,
+	.read		= seq_read,
+	.write		= wil_napi_bench_write,
+	.llseek		= seq_lseek,
+};
+
 static ssize_t wil_read_file_led_cfg(struct file *file, char __user *user_buf,
 				     size_t count, loff_t *ppos)
 {
@@ -1906,6 +2016,8 @@ static const struct {
 	{"fw_version",	0444,		&fops_fw_version},
 	{"suspend_stats",	0644,	&fops_suspend_stats},
 	{"tx_latency",	0644,		&fops_tx_latency},
+	{"rx_pool",	0444,		&fops_rx_pool},
+	{"napi_bench",	0644,		&fops_napi_bench},
 };
 
 static void wil6210_debugfs_init_files(struct wil6210_priv *wil,
@@ -268,7 +268,7 @@ static irqreturn_t wil6210_irq_rx(int irq, void *cookie)
 			if (likely(test_bit(wil_status_napi_en, wil->status))) {
 				wil_dbg_txrx(wil, "NAPI(Rx) schedule\n");
 				need_unmask = false;
-				napi_schedule(&wil->napi_rx);
+				wil6210_napi_schedule_rx(wil);
 			} else {
 				wil_err_ratelimited(
 					wil,
@@ -318,7 +318,7 @@ static irqreturn_t wil6210_irq_tx(int irq, void *cookie)
 		if (likely(test_bit(wil_status_fwready, wil->status))) {
 			wil_dbg_txrx(wil, "NAPI(Tx) schedule\n");
 			need_unmask = false;
-			napi_schedule(&wil->napi_tx);
+			wil6210_napi_schedule_tx(wil);
 		} else {
 			wil_err_ratelimited(wil, "Got Tx interrupt while in reset\n");
 		}
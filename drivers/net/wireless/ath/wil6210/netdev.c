@@ -16,6 +16,7 @@
 
 #include <linux/moduleparam.h>
 #include <linux/etherdevice.h>
+#include <linux/sched.h>
 #include "wil6210.h"
 #include "txrx.h"
 
@@ -23,6 +24,20 @@ static bool alt_ifname; /* = false; */
 module_param(alt_ifname, bool, 0444);
 MODULE_PARM_DESC(alt_ifname, " use an alternate interface name wigigN instead of wlanN");
 
+static int rx_napi_cpu = -1;
+module_param(rx_napi_cpu, int, 0444);
+MODULE_PARM_DESC(rx_napi_cpu,
+		 " CPU to reap Rx on, default - the CPU taking the interrupt");
+
+static int tx_napi_cpu = -1;
+module_param(tx_napi_cpu, int, 0444);
+MODULE_PARM_DESC(tx_napi_cpu,
+		 " CPU to complete Tx on, default - the CPU taking the interrupt");
+
+static uint napi_budget = WIL6210_NAPI_BUDGET;
+module_param(napi_budget, uint, 0444);
+MODULE_PARM_DESC(napi_budget, " NAPI poll weight, 1..64, default - 16");
+
 static int wil_open(struct net_device *ndev)
 {
 	struct wil6210_priv *wil = ndev_to_wil(ndev);
@@ -93,16 +108,58 @@ static const struct net_device_ops wil_netdev_ops = {
 	.ndo_do_ioctl		= wil_do_ioctl,
 };
 
+static void wil6210_napi_ipi(void *info)
+{
+	napi_schedule(info);
+}
+
+/* The interrupt stays masked until the poll completes, so the IPI for
+ * one NAPI instance is never sent again while it is still pending.
+ */
+static void wil6210_napi_schedule(struct wil6210_priv *wil, int id, int cpu)
+{
+	struct call_single_data *csd = &wil->napi_csd[id];
+
+	if (cpu < 0 || cpu == smp_processor_id() || !cpu_online(cpu) ||
+	    smp_call_function_single_async(cpu, csd))
+		napi_schedule(csd->info);
+}
+
+void wil6210_napi_schedule_rx(struct wil6210_priv *wil)
+{
+	wil6210_napi_schedule(wil, WIL_NAPI_RX, rx_napi_cpu);
+}
+
+void wil6210_napi_schedule_tx(struct wil6210_priv *wil)
+{
+	wil6210_napi_schedule(wil, WIL_NAPI_TX, tx_napi_cpu);
+}
+
+static void wil6210_napi_account(struct wil6210_priv *wil, int id, int done,
+				 u64 start)
+{
+	struct wil_napi_stats *stats = &wil->napi_stats[id];
+
+	stats->polls++;
+	stats->pkts += done;
+	stats->ns += local_clock() - start;
+	stats->cpu = smp_processor_id();
+}
+
 static int wil6210_netdev_poll_rx(struct napi_struct *napi, int budget)
 {
 	struct wil6210_priv *wil = container_of(napi, struct wil6210_priv,
 						napi_rx);
+	u64 start = wil->napi_bench ? local_clock() : 0;
 	int quota = budget;
 	int done;
 
 	wil_rx_handle(wil, &quota);
 	done = budget - quota;
 
+	if (start)
+		wil6210_napi_account(wil, WIL_NAPI_RX, done, start);
+
 	if (done < budget) {
 		napi_complete_done(napi, done);
 		wil6210_unmask_irq_rx(wil);
@@ -118,6 +175,7 @@ static int wil6210_netdev_poll_tx(struct napi_struct *napi, int budget)
 {
 	struct wil6210_priv *wil = container_of(napi, struct wil6210_priv,
 						napi_tx);
+	u64 start = wil->napi_bench ? local_clock() : 0;
 	int tx_done = 0;
 	uint i;
 
@@ -132,6 +190,9 @@ static int wil6210_netdev_poll_tx(struct napi_struct *napi, int budget)
 		tx_done += wil_tx_complete(wil, i);
 	}
 
+	if (start)
+		wil6210_napi_account(wil, WIL_NAPI_TX, tx_done, start);
+
 	if (tx_done < budget) {
 		napi_complete(napi);
 		wil6210_unmask_irq_tx(wil);
@@ -245,10 +306,15 @@ int wil_if_add(struct wil6210_priv *wil)
 		return rc;
 	}
 
+	napi_budget = clamp_t(uint, napi_budget, 1, NAPI_POLL_WEIGHT);
 	netif_napi_add(ndev, &wil->napi_rx, wil6210_netdev_poll_rx,
-		       WIL6210_NAPI_BUDGET);
+		       napi_budget);
 	netif_tx_napi_add(ndev, &wil->napi_tx, wil6210_netdev_poll_tx,
-			  WIL6210_NAPI_BUDGET);
+			  napi_budget);
+	wil->napi_csd[WIL_NAPI_RX].func = wil6210_napi_ipi;
+	wil->napi_csd[WIL_NAPI_RX].info = &wil->napi_rx;
+	wil->napi_csd[WIL_NAPI_TX].func = wil6210_napi_ipi;
+	wil->napi_csd[WIL_NAPI_TX].info = &wil->napi_tx;
 
 	wil_update_net_queues_bh(wil, NULL, true);
 
@@ -47,11 +47,26 @@ module_param(drop_if_ring_full, bool, 0444);
 MODULE_PARM_DESC(drop_if_ring_full,
 		 " drop Tx packets in case tx ring is full");
 
+static bool rx_recycle = true;
+module_param(rx_recycle, bool, 0444);
+MODULE_PARM_DESC(rx_recycle,
+		 " recycle pre-mapped Rx pages instead of an skb per frame, default - yes");
+
+/* Frames up to this size are copied out whole and their page reused at once */
+#define WIL_RX_COPYBREAK	(256)
+/* Otherwise this much goes to the linear part and the rest stays a fragment */
+#define WIL_RX_HDR_LEN		(128)
+
 static inline uint wil_rx_snaplen(void)
 {
 	return rx_align_2 ? 6 : 0;
 }
 
+static inline uint wil_rx_buf_sz(struct wil6210_priv *wil)
+{
+	return wil->rx_buf_len + ETH_HLEN + wil_rx_snaplen();
+}
+
 static inline int wil_vring_is_empty(struct vring *vring)
 {
 	return vring->swhead == vring->swtail;
@@ -239,6 +254,19 @@ static void wil_txdesc_unmap(struct device *dev, struct vring_tx_desc *d,
 	}
 }
 
+static void wil_rx_page_free(struct wil6210_priv *wil, struct wil_rx_page *rp)
+{
+	struct device *dev = wil_to_dev(wil);
+
+	if (!rp->page)
+		return;
+
+	dma_unmap_page(dev, rp->pa, PAGE_SIZE << wil->rx_pool.order,
+		       DMA_FROM_DEVICE);
+	put_page(rp->page);
+	rp->page = NULL;
+}
+
 static void wil_vring_free(struct wil6210_priv *wil, struct vring *vring,
 			   int tx)
 {
@@ -287,6 +315,12 @@ static void wil_vring_free(struct wil6210_priv *wil, struct vring *vring,
 					&vring->va[vring->swhead].rx;
 
 			ctx = &vring->ctx[vring->swhead];
+			if (wil->rx_pool.posted) {
+				wil_rx_page_free(wil, &wil->rx_pool.posted[
+						 vring->swhead]);
+				wil_vring_advance_head(vring, 1);
+				continue;
+			}
 			*d = *_d;
 			pa = wil_desc_addr(&d->dma.addr);
 			dmalen = le16_to_cpu(d->dma.length);
@@ -302,6 +336,23 @@ static void wil_vring_free(struct wil6210_priv *wil, struct vring *vring,
 	vring->ctx = NULL;
 }
 
+static void wil_vring_rx_desc_fill(struct vring *vring, u32 i, dma_addr_t pa,
+				   unsigned int sz)
+{
+	struct vring_rx_desc dd, *d = &dd;
+	volatile struct vring_rx_desc *_d = &vring->va[i].rx;
+
+	memset(d, 0, sizeof(*d));
+	d->dma.d0 = RX_DMA_D0_CMD_DMA_RT | RX_DMA_D0_CMD_DMA_IT;
+	wil_desc_addr_set(&d->dma.addr, pa);
+	/* ip_length don't care */
+	/* b11 don't care */
+	/* error don't care */
+	/* BIT(0) of dma status should be 0 for HW_OWNED */
+	d->dma.length = cpu_to_le16(sz);
+	*_d = *d;
+}
+
 /**
  * Allocate one skb for Rx VRING
  *
@@ -311,9 +362,7 @@ static int wil_vring_alloc_skb(struct wil6210_priv *wil, struct vring *vring,
 			       u32 i, int headroom)
 {
 	struct device *dev = wil_to_dev(wil);
-	unsigned int sz = wil->rx_buf_len + ETH_HLEN + wil_rx_snaplen();
-	struct vring_rx_desc dd, *d = &dd;
-	volatile struct vring_rx_desc *_d = &vring->va[i].rx;
+	unsigned int sz = wil_rx_buf_sz(wil);
 	dma_addr_t pa;
 	struct sk_buff *skb = dev_alloc_skb(sz + headroom);
 
@@ -329,20 +378,165 @@ static int wil_vring_alloc_skb(struct wil6210_priv *wil, struct vring *vring,
 		return -ENOMEM;
 	}
 
-	memset(d, 0, sizeof(*d));
-	d->dma.d0 = RX_DMA_D0_CMD_DMA_RT | RX_DMA_D0_CMD_DMA_IT;
-	wil_desc_addr_set(&d->dma.addr, pa);
-	/* ip_length don't care */
-	/* b11 don't care */
-	/* error don't care */
-	/* BIT(0) of dma status should be 0 for HW_OWNED */
-	d->dma.length = cpu_to_le16(sz);
-	*_d = *d;
+	wil_vring_rx_desc_fill(vring, i, pa, sz);
 	vring->ctx[i].skb = skb;
 
 	return 0;
 }
 
+/**
+ * Take a page for an Rx descriptor: the oldest one given to the stack if
+ * the stack is done with it, a newly allocated and mapped one otherwise.
+ * Only the oldest is checked; frames are mostly released in order.
+ */
+static int wil_rx_pool_get(struct wil6210_priv *wil, struct wil_rx_page *rp)
+{
+	struct wil_rx_pool *pool = &wil->rx_pool;
+	struct device *dev = wil_to_dev(wil);
+	struct wil_rx_page *c;
+	struct page *page;
+
+	if (pool->cache_head != pool->cache_tail) {
+		c = &pool->cache[pool->cache_tail & (pool->cache_size - 1)];
+		if (page_ref_count(c->page) == 1) {
+			*rp = *c;
+			pool->cache_tail++;
+			pool->recycled++;
+			dma_sync_single_for_device(dev, rp->pa, wil_rx_buf_sz(wil),
+						   DMA_FROM_DEVICE);
+			return 0;
+		}
+		pool->busy++;
+	}
+
+	page = dev_alloc_pages(pool->order);
+	if (unlikely(!page))
+		goto err;
+
+	rp->pa = dma_map_page(dev, page, 0, PAGE_SIZE << pool->order,
+			      DMA_FROM_DEVICE);
+	if (unlikely(dma_mapping_error(dev, rp->pa))) {
+		__free_pages(page, pool->order);
+		goto err;
+	}
+	rp->page = page;
+	pool->allocated++;
+
+	return 0;
+err:
+	pool->alloc_failed++;
+	return -ENOMEM;
+}
+
+/* Keep a page the stack may still hold until it can be posted again */
+static void wil_rx_pool_put(struct wil6210_priv *wil, struct wil_rx_page *rp)
+{
+	struct wil_rx_pool *pool = &wil->rx_pool;
+	u32 mask = pool->cache_size - 1;
+
+	/* pages from the emergency reserves are not kept */
+	if (unlikely(page_is_pfmemalloc(rp->page))) {
+		wil_rx_page_free(wil, rp);
+		return;
+	}
+
+	if (pool->cache_head - pool->cache_tail == pool->cache_size) {
+		wil_rx_page_free(wil, &pool->cache[pool->cache_tail++ & mask]);
+		pool->evicted++;
+	}
+	pool->cache[pool->cache_head++ & mask] = *rp;
+	rp->page = NULL;
+}
+
+static int wil_rx_pool_post(struct wil6210_priv *wil, struct vring *vring,
+			    u32 i)
+{
+	struct wil_rx_page *rp = &wil->rx_pool.posted[i];
+	int rc;
+
+	rc = wil_rx_pool_get(wil, rp);
+	if (unlikely(rc))
+		return rc;
+
+	wil_vring_rx_desc_fill(vring, i, rp->pa, wil_rx_buf_sz(wil));
+
+	return 0;
+}
+
+/**
+ * Build an skb for @len bytes received in the page of descriptor @i.
+ * Short frames are copied, longer ones get their headers copied and the
+ * rest attached as a page fragment. Either way the page moves to the cache.
+ */
+static struct sk_buff *wil_rx_pool_build_skb(struct wil6210_priv *wil, u32 i,
+					     unsigned int len)
+{
+	struct wil_rx_pool *pool = &wil->rx_pool;
+	struct wil_rx_page *rp = &pool->posted[i];
+	struct device *dev = wil_to_dev(wil);
+	unsigned int copy = len <= WIL_RX_COPYBREAK ? len : WIL_RX_HDR_LEN;
+	struct sk_buff *skb;
+
+	if (unlikely(!rp->page)) {
+		wil_err(wil, "No Rx page at [%d]\n", i);
+		return NULL;
+	}
+
+	dma_sync_single_for_cpu(dev, rp->pa, len, DMA_FROM_DEVICE);
+
+	skb = dev_alloc_skb(copy);
+	if (likely(skb)) {
+		memcpy(skb_put(skb, copy), page_address(rp->page), copy);
+		if (len > copy) {
+			get_page(rp->page);
+			skb_add_rx_frag(skb, 0, rp->page, copy, len - copy,
+					PAGE_SIZE << pool->order);
+		}
+	} else {
+		pool->alloc_failed++;
+	}
+
+	wil_rx_pool_put(wil, rp);
+
+	return skb;
+}
+
+/* Ring size is a power of 2, so the cache can be as deep as the ring */
+static int wil_rx_pool_init(struct wil6210_priv *wil, u16 size)
+{
+	struct wil_rx_pool *pool = &wil->rx_pool;
+
+	memset(pool, 0, sizeof(*pool));
+	pool->order = get_order(wil_rx_buf_sz(wil));
+	pool->cache_size = size;
+	pool->posted = kcalloc(size, sizeof(*pool->posted), GFP_KERNEL);
+	pool->cache = kcalloc(size, sizeof(*pool->cache), GFP_KERNEL);
+	if (!pool->posted || !pool->cache) {
+		kfree(pool->posted);
+		kfree(pool->cache);
+		pool->posted = NULL;
+		pool->cache = NULL;
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+/* Posted pages are released with the Rx vring, before this */
+static void wil_rx_pool_fini(struct wil6210_priv *wil)
+{
+	struct wil_rx_pool *pool = &wil->rx_pool;
+
+	while (pool->cache_head != pool->cache_tail)
+		wil_rx_page_free(wil, &pool->cache[pool->cache_tail++ &
+				 (pool->cache_size - 1)]);
+
+	kfree(pool->posted);
+	kfree(pool->cache);
+	pool->posted = NULL;
+	pool->cache = NULL;
+}
+
 /**
  * Adds radiotap header
  *
@@ -507,18 +701,28 @@ static struct sk_buff *wil_vring_reap_rx(struct wil6210_priv *wil,
 		return NULL;
 	}
 
-	skb = vring->ctx[i].skb;
-	vring->ctx[i].skb = NULL;
-	wil_vring_advance_head(vring, 1);
-	if (!skb) {
-		wil_err(wil, "No Rx skb at [%d]\n", i);
-		goto again;
+	if (wil->rx_pool.posted) {
+		/* an oversized frame is built truncated, then dropped below */
+		dmalen = le16_to_cpu(_d->dma.length);
+		skb = wil_rx_pool_build_skb(wil, i, min_t(uint, dmalen, sz));
+		wil_vring_advance_head(vring, 1);
+		if (!skb)
+			goto again;
+	} else {
+		skb = vring->ctx[i].skb;
+		vring->ctx[i].skb = NULL;
+		wil_vring_advance_head(vring, 1);
+		if (!skb) {
+			wil_err(wil, "No Rx skb at [%d]\n", i);
+			goto again;
+		}
 	}
 	d = wil_skb_rxdesc(skb);
 	*d = *_d;
 	pa = wil_desc_addr(&d->dma.addr);
 
-	dma_unmap_single(dev, pa, sz, DMA_FROM_DEVICE);
+	if (!wil->rx_pool.posted)
+		dma_unmap_single(dev, pa, sz, DMA_FROM_DEVICE);
 	dmalen = le16_to_cpu(d->dma.length);
 
 	trace_wil6210_rx(i, d);
@@ -641,7 +845,10 @@ static int wil_rx_refill(struct wil6210_priv *wil, int count)
 	for (; next_tail = wil_vring_next_tail(v),
 			(next_tail != v->swhead) && (count-- > 0);
 			v->swtail = next_tail) {
-		rc = wil_vring_alloc_skb(wil, v, v->swtail, headroom);
+		if (wil->rx_pool.posted)
+			rc = wil_rx_pool_post(wil, v, v->swtail);
+		else
+			rc = wil_vring_alloc_skb(wil, v, v->swtail, headroom);
 		if (unlikely(rc)) {
 			wil_err_ratelimited(wil, "Error %d in rx refill[%d]\n",
 					    rc, v->swtail);
@@ -881,6 +1088,13 @@ int wil_rx_init(struct wil6210_priv *wil, u16 size)
 	if (rc)
 		return rc;
 
+	/* the sniffer reads PHY info past the frame, so it keeps whole skbs */
+	if (rx_recycle && wil_to_ndev(wil)->type != ARPHRD_IEEE80211_RADIOTAP) {
+		rc = wil_rx_pool_init(wil, size);
+		if (rc)
+			goto err_free;
+	}
+
 	rc = wmi_rx_chain_add(wil, vring);
 	if (rc)
 		goto err_free;
@@ -892,6 +1106,7 @@ int wil_rx_init(struct wil6210_priv *wil, u16 size)
 	return 0;
  err_free:
 	wil_vring_free(wil, vring, 0);
+	wil_rx_pool_fini(wil);
 
 	return rc;
 }
@@ -904,6 +1119,7 @@ void wil_rx_fini(struct wil6210_priv *wil)
 
 	if (vring->va)
 		wil_vring_free(wil, vring, 0);
+	wil_rx_pool_fini(wil);
 }
 
 static inline void wil_tx_data_init(struct vring_tx_data *txdata)
@@ -447,6 +447,69 @@ struct wil_ctx {
 	u8 mapped_as;
 };
 
+/**
+ * struct wil_rx_page - Rx buffer of the recycling pool
+ * @page: page (compound if the buffer needs more than one)
+ * @pa: DMA address; the page stays mapped for as long as the pool has it
+ */
+struct wil_rx_page {
+	struct page *page;
+	dma_addr_t pa;
+};
+
+/**
+ * struct wil_rx_pool - pre-mapped Rx buffers recycled across frames
+ *
+ * Frames are passed up as skbs whose payload is a fragment of the Rx page.
+ * The page then waits in @cache, and once the stack dropped its reference
+ * it is posted again without a new allocation or DMA mapping.
+ *
+ * @posted: page behind each Rx descriptor, [vring_rx.size]
+ * @cache: pages given to the stack, oldest at @cache_tail
+ * @cache_size: entries in @cache, a power of 2
+ * @cache_head: free running producer index into @cache
+ * @cache_tail: free running consumer index into @cache
+ * @order: page order of one buffer
+ * @recycled: descriptors posted with a page from @cache
+ * @allocated: descriptors posted with a newly allocated page
+ * @busy: refills where the oldest cached page was still in use
+ * @evicted: pages unmapped because @cache was full
+ * @alloc_failed: page, mapping or skb allocations that failed
+ */
+struct wil_rx_pool {
+	struct wil_rx_page *posted;
+	struct wil_rx_page *cache;
+	u32 cache_size;
+	u32 cache_head;
+	u32 cache_tail;
+	unsigned int order;
+	u64 recycled;
+	u64 allocated;
+	u64 busy;
+	u64 evicted;
+	u64 alloc_failed;
+};
+
+/**
+ * struct wil_napi_stats - NAPI poll cost, collected in "napi_bench" mode
+ * @polls: poll calls
+ * @pkts: frames (Rx) or descriptors (Tx) completed
+ * @ns: time spent in the poll function
+ * @cpu: CPU of the last poll
+ */
+struct wil_napi_stats {
+	u64 polls;
+	u64 pkts;
+	u64 ns;
+	int cpu;
+};
+
+enum {
+	WIL_NAPI_RX,
+	WIL_NAPI_TX,
+	WIL_NAPI_MAX,
+};
+
 union vring_desc;
 
 struct vring {
@@ -754,6 +817,10 @@ struct wil6210_priv {
 	int net_queue_stopped; /* netif_tx_stop_all_queues invoked */
 	struct napi_struct napi_rx;
 	struct napi_struct napi_tx;
+	/* schedule napi_rx/napi_tx on the CPU chosen with rx/tx_napi_cpu */
+	struct call_single_data napi_csd[WIL_NAPI_MAX];
+	bool napi_bench; /* collect napi_stats */
+	struct wil_napi_stats napi_stats[WIL_NAPI_MAX];
 	/* keep alive */
 	struct list_head probe_client_pending;
 	struct mutex probe_client_mutex; /* protect @probe_client_pending */
@@ -761,6 +828,7 @@ struct wil6210_priv {
 	/* DMA related */
 	struct vring vring_rx;
 	unsigned int rx_buf_len;
+	struct wil_rx_pool rx_pool;
 	struct vring vring_tx[WIL6210_MAX_TX_RINGS];
 	struct vring_tx_data vring_tx_data[WIL6210_MAX_TX_RINGS];
 	u8 vring2cid_tid[WIL6210_MAX_TX_RINGS][2]; /* [0] - CID, [1] - TID */
@@ -1099,6 +1167,8 @@ void wil6210_unmask_irq_tx(struct wil6210_priv *wil);
 /* RX API */
 void wil_rx_handle(struct wil6210_priv *wil, int *quota);
 void wil6210_unmask_irq_rx(struct wil6210_priv *wil);
+void wil6210_napi_schedule_rx(struct wil6210_priv *wil);
+void wil6210_napi_schedule_tx(struct wil6210_priv *wil);
 
 int wil_iftype_nl2wmi(enum nl80211_iftype type);
 
@@ -303,19 +303,28 @@ int cnss_bus_call_driver_remove(struct cnss_plat_data *plat_priv)
 
 int cnss_bus_dev_powerup(struct cnss_plat_data *plat_priv)
 {
+	int ret;
+
 	if (!plat_priv)
 		return -ENODEV;
 
+	cnss_boot_phase_begin(plat_priv, CNSS_BOOT_POWER_UP);
 	switch (plat_priv->bus_type) {
 	case CNSS_BUS_PCI:
-		return cnss_pci_dev_powerup(plat_priv->bus_priv);
+		ret = cnss_pci_dev_powerup(plat_priv->bus_priv);
+		break;
 	case CNSS_BUS_USB:
-		return 0;
+		ret = 0;
+		break;
 	default:
 		cnss_pr_err("Unsupported bus type: %d\n",
 			    plat_priv->bus_type);
 		return -EINVAL;
 	}
+	if (!ret)
+		cnss_boot_phase_end(plat_priv, CNSS_BOOT_POWER_UP);
+
+	return ret;
 }
 
 int cnss_bus_dev_shutdown(struct cnss_plat_data *plat_priv)
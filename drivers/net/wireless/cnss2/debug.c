@@ -140,6 +140,83 @@ static const struct file_operations cnss_stats_fops = {
 	.llseek		= seq_lseek,
 };
 
+static int cnss_boot_timeline_show(struct seq_file *s, void *data)
+{
+	struct cnss_plat_data *plat_priv = s->private;
+	struct cnss_boot_timeline *tl = &plat_priv->boot_timeline;
+	ktime_t base = tl->begin[CNSS_BOOT_POWER_UP];
+	int i;
+
+	if (!ktime_to_ns(base)) {
+		seq_puts(s, "No boot recorded\n");
+		return 0;
+	}
+
+	seq_printf(s, "%-14s %12s %12s\n", "PHASE", "START(ms)", "TIME(ms)");
+
+	for (i = 0; i < CNSS_BOOT_PHASE_MAX; i++) {
+		seq_printf(s, "%-14s ", cnss_boot_phase_to_str(i));
+
+		if (!ktime_to_ns(tl->begin[i])) {
+			seq_puts(s, "     not run\n");
+			continue;
+		}
+
+		seq_printf(s, "%12lld ",
+			   ktime_ms_delta(tl->begin[i], base));
+
+		if (!ktime_to_ns(tl->end[i]))
+			seq_printf(s, "%12s\n", "not done");
+		else
+			seq_printf(s, "%12lld\n",
+				   ktime_ms_delta(tl->end[i], tl->begin[i]));
+	}
+
+	return 0;
+}
+
+static int cnss_boot_timeline_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cnss_boot_timeline_show, inode->i_private);
+}
+
+static const struct file_operations cnss_boot_timeline_fops = {
+	.read		= seq_read,
+	.release	= single_release,
+	.open		= cnss_boot_timeline_open,
+	.owner		= THIS_MODULE,
+	.llseek		= seq_lseek,
+};
+
+static int cnss_msi_affinity_debug_show(struct seq_file *s, void *data)
+{
+	struct cnss_plat_data *plat_priv = s->private;
+
+	if (plat_priv->bus_type != CNSS_BUS_PCI || !plat_priv->bus_priv) {
+		seq_puts(s, "MSI affinity is not supported\n");
+		return 0;
+	}
+
+	cnss_pci_msi_affinity_show(plat_priv->bus_priv, s);
+
+	return 0;
+}
+
+static int cnss_msi_affinity_debug_open(struct inode *inode,
+					struct file *file)
+{
+	return single_open(file, cnss_msi_affinity_debug_show,
+			   inode->i_private);
+}
+
+static const struct file_operations cnss_msi_affinity_debug_fops = {
+	.read		= seq_read,
+	.release	= single_release,
+	.open		= cnss_msi_affinity_debug_open,
+	.owner		= THIS_MODULE,
+	.llseek		= seq_lseek,
+};
+
 static ssize_t cnss_dev_boot_debug_write(struct file *fp,
 					 const char __user *user_buf,
 					 size_t count, loff_t *off)
@@ -557,6 +634,10 @@ static ssize_t cnss_control_params_debug_write(struct file *fp,
 		plat_priv->ctrl_params.qmi_timeout = val;
 	else if (strcmp(cmd, "bdf_type") == 0)
 		plat_priv->ctrl_params.bdf_type = val;
+	else if (strcmp(cmd, "msi_affinity_cpus") == 0)
+		plat_priv->ctrl_params.msi_affinity_cpus = val;
+	else if (strcmp(cmd, "msi_affinity_high_rate") == 0)
+		plat_priv->ctrl_params.msi_affinity_high_rate = val;
 	else
 		return -EINVAL;
 
@@ -627,12 +708,18 @@ static int cnss_control_params_debug_show(struct seq_file *s, void *data)
 	seq_puts(s, "mhi_timeout: Timeout for MHI operation in milliseconds\n");
 	seq_puts(s, "qmi_timeout: Timeout for QMI message in milliseconds\n");
 	seq_puts(s, "bdf_type: Type of board data file to be downloaded\n");
+	seq_puts(s, "msi_affinity_cpus: Mask of CPUs for CE and DP MSI, 0 for all\n");
+	seq_puts(s, "msi_affinity_high_rate: MSI per second above which big cores are used\n");
 
 	seq_puts(s, "\nCurrent value:\n");
 	cnss_show_quirks_state(s, cnss_priv);
 	seq_printf(s, "mhi_timeout: %u\n", cnss_priv->ctrl_params.mhi_timeout);
 	seq_printf(s, "qmi_timeout: %u\n", cnss_priv->ctrl_params.qmi_timeout);
 	seq_printf(s, "bdf_type: %u\n", cnss_priv->ctrl_params.bdf_type);
+	seq_printf(s, "msi_affinity_cpus: 0x%lx\n",
+		   cnss_priv->ctrl_params.msi_affinity_cpus);
+	seq_printf(s, "msi_affinity_high_rate: %u\n",
+		   cnss_priv->ctrl_params.msi_affinity_high_rate);
 
 	return 0;
 }
@@ -695,6 +782,10 @@ int cnss_debugfs_create(struct cnss_plat_data *plat_priv)
 			    &cnss_pin_connect_fops);
 	debugfs_create_file("stats", 0644, root_dentry, plat_priv,
 			    &cnss_stats_fops);
+	debugfs_create_file("boot_timeline", 0444, root_dentry, plat_priv,
+			    &cnss_boot_timeline_fops);
+	debugfs_create_file("msi_affinity", 0444, root_dentry, plat_priv,
+			    &cnss_msi_affinity_debug_fops);
 
 	cnss_create_debug_only_node(plat_priv);
 
@@ -46,6 +46,7 @@
 #endif
 #define CNSS_QMI_TIMEOUT_DEFAULT	10000
 #define CNSS_BDF_TYPE_DEFAULT		CNSS_BDF_ELF
+#define CNSS_MSI_AFFINITY_HIGH_RATE_DEFAULT	20000
 
 static struct cnss_plat_data *plat_env;
 
@@ -395,8 +396,10 @@ static int cnss_fw_mem_ready_hdlr(struct cnss_plat_data *plat_priv)
 	if (ret)
 		goto out;
 
-	if (plat_priv->device_id == QCN7605_DEVICE_ID)
+	if (plat_priv->device_id == QCN7605_DEVICE_ID) {
+		cnss_boot_phase_begin(plat_priv, CNSS_BOOT_FW_READY);
 		return 0;
+	}
 
 	ret = cnss_bus_load_m3(plat_priv);
 	if (ret)
@@ -406,6 +409,7 @@ static int cnss_fw_mem_ready_hdlr(struct cnss_plat_data *plat_priv)
 	if (ret)
 		goto out;
 
+	cnss_boot_phase_begin(plat_priv, CNSS_BOOT_FW_READY);
 	return 0;
 out:
 	return ret;
@@ -419,6 +423,7 @@ static int cnss_fw_ready_hdlr(struct cnss_plat_data *plat_priv)
 		return -ENODEV;
 
 	del_timer(&plat_priv->fw_boot_timer);
+	cnss_boot_phase_end(plat_priv, CNSS_BOOT_FW_READY);
 	set_bit(CNSS_FW_READY, &plat_priv->driver_state);
 	clear_bit(CNSS_DEV_ERR_NOTIFY, &plat_priv->driver_state);
 
@@ -434,7 +439,11 @@ static int cnss_fw_ready_hdlr(struct cnss_plat_data *plat_priv)
 		ret = cnss_wlfw_wlan_mode_send_sync(plat_priv,
 						    CNSS_CALIBRATION);
 	} else {
+		cnss_boot_phase_begin(plat_priv, CNSS_BOOT_DRIVER_PROBE);
 		ret = cnss_bus_call_driver_probe(plat_priv);
+		if (!ret)
+			cnss_boot_phase_end(plat_priv,
+					    CNSS_BOOT_DRIVER_PROBE);
 	}
 
 	if (ret && test_bit(CNSS_DEV_ERR_NOTIFY, &plat_priv->driver_state))
@@ -463,6 +472,54 @@ static int cnss_cal_update_hdlr(struct cnss_plat_data *plat_priv)
 	return 0;
 }
 
+const char *cnss_boot_phase_to_str(enum cnss_boot_phase phase)
+{
+	switch (phase) {
+	case CNSS_BOOT_POWER_UP:
+		return "POWER_UP";
+	case CNSS_BOOT_QMI_CONNECT:
+		return "QMI_CONNECT";
+	case CNSS_BOOT_FW_MEM:
+		return "FW_MEM";
+	case CNSS_BOOT_TGT_CAP:
+		return "TGT_CAP";
+	case CNSS_BOOT_REGDB:
+		return "REGDB";
+	case CNSS_BOOT_BDF:
+		return "BDF";
+	case CNSS_BOOT_M3:
+		return "M3";
+	case CNSS_BOOT_FW_READY:
+		return "FW_READY";
+	case CNSS_BOOT_DRIVER_PROBE:
+		return "DRIVER_PROBE";
+	default:
+		return "UNKNOWN";
+	}
+}
+
+/* A power up starts a new timeline, the other phases only stamp theirs */
+void cnss_boot_phase_begin(struct cnss_plat_data *plat_priv,
+			   enum cnss_boot_phase phase)
+{
+	struct cnss_boot_timeline *timeline = &plat_priv->boot_timeline;
+
+	if (phase == CNSS_BOOT_POWER_UP)
+		memset(timeline, 0, sizeof(*timeline));
+
+	timeline->begin[phase] = ktime_get();
+	timeline->end[phase] = ktime_set(0, 0);
+}
+
+void cnss_boot_phase_end(struct cnss_plat_data *plat_priv,
+			 enum cnss_boot_phase phase)
+{
+	struct cnss_boot_timeline *timeline = &plat_priv->boot_timeline;
+
+	if (ktime_to_ns(timeline->begin[phase]))
+		timeline->end[phase] = ktime_get();
+}
+
 static char *cnss_driver_event_to_str(enum cnss_driver_event_type type)
 {
 	switch (type) {
@@ -1443,10 +1500,13 @@ static void cnss_driver_event_work(struct work_struct *work)
 			ret = cnss_wlfw_server_exit(plat_priv);
 			break;
 		case CNSS_DRIVER_EVENT_REQUEST_MEM:
+			cnss_boot_phase_begin(plat_priv, CNSS_BOOT_FW_MEM);
 			ret = cnss_bus_alloc_fw_mem(plat_priv);
 			if (ret)
 				break;
 			ret = cnss_wlfw_respond_mem_send_sync(plat_priv);
+			if (!ret)
+				cnss_boot_phase_end(plat_priv, CNSS_BOOT_FW_MEM);
 			break;
 		case CNSS_DRIVER_EVENT_FW_MEM_READY:
 			ret = cnss_fw_mem_ready_hdlr(plat_priv);
@@ -1945,6 +2005,8 @@ static void cnss_init_control_params(struct cnss_plat_data *plat_priv)
 	plat_priv->ctrl_params.mhi_timeout = CNSS_MHI_TIMEOUT_DEFAULT;
 	plat_priv->ctrl_params.qmi_timeout = CNSS_QMI_TIMEOUT_DEFAULT;
 	plat_priv->ctrl_params.bdf_type = CNSS_BDF_TYPE_DEFAULT;
+	plat_priv->ctrl_params.msi_affinity_high_rate =
+		CNSS_MSI_AFFINITY_HIGH_RATE_DEFAULT;
 }
 
 static void cnss_get_wlaon_pwr_ctrl_info(struct cnss_plat_data *plat_priv)
@@ -246,6 +246,8 @@ struct cnss_control_params {
 	unsigned int mhi_timeout;
 	unsigned int qmi_timeout;
 	unsigned int bdf_type;
+	unsigned long msi_affinity_cpus;
+	unsigned int msi_affinity_high_rate;
 };
 
 enum cnss_ce_index {
@@ -264,6 +266,42 @@ enum cnss_ce_index {
 	CNSS_CE_COMMON,
 };
 
+enum cnss_boot_phase {
+	CNSS_BOOT_POWER_UP,
+	CNSS_BOOT_QMI_CONNECT,
+	CNSS_BOOT_FW_MEM,
+	CNSS_BOOT_TGT_CAP,
+	CNSS_BOOT_REGDB,
+	CNSS_BOOT_BDF,
+	CNSS_BOOT_M3,
+	CNSS_BOOT_FW_READY,
+	CNSS_BOOT_DRIVER_PROBE,
+	CNSS_BOOT_PHASE_MAX,
+};
+
+/**
+ * struct cnss_boot_timeline - When each phase of the last power up ran
+ * @begin: Start of each phase, zero if it did not run
+ * @end: End of each phase, zero if it did not finish
+ */
+struct cnss_boot_timeline {
+	ktime_t begin[CNSS_BOOT_PHASE_MAX];
+	ktime_t end[CNSS_BOOT_PHASE_MAX];
+};
+
+/* Board data files kept across WLAN on/off, see cnss_wlfw_bdf_dnld_send_sync */
+enum cnss_bdf_cache_index {
+	CNSS_BDF_CACHE_REGDB,
+	CNSS_BDF_CACHE_BOARD,
+	CNSS_BDF_CACHE_MAX,
+};
+
+struct cnss_bdf_cache {
+	char name[CNSS_FW_PATH_MAX_LEN];
+	void *data;
+	size_t size;
+};
+
 struct cnss_plat_data {
 	struct platform_device *plat_dev;
 	void *bus_priv;
@@ -319,6 +357,8 @@ struct cnss_plat_data {
 	u32 is_converged_dt;
 	struct device_node *dev_node;
 	u8 set_wlaon_pwr_ctrl;
+	struct cnss_boot_timeline boot_timeline;
+	struct cnss_bdf_cache bdf_cache[CNSS_BDF_CACHE_MAX];
 };
 
 struct cnss_plat_data *cnss_get_plat_priv(struct platform_device *plat_dev);
@@ -338,5 +378,10 @@ void cnss_unregister_ramdump(struct cnss_plat_data *plat_priv);
 void cnss_set_pin_connect_status(struct cnss_plat_data *plat_priv);
 const char *cnss_get_fw_path(struct cnss_plat_data *plat_priv);
 int cnss_dev_specific_power_on(struct cnss_plat_data *plat_priv);
+void cnss_boot_phase_begin(struct cnss_plat_data *plat_priv,
+			   enum cnss_boot_phase phase);
+void cnss_boot_phase_end(struct cnss_plat_data *plat_priv,
+			 enum cnss_boot_phase phase);
+const char *cnss_boot_phase_to_str(enum cnss_boot_phase phase);
 
 #endif /* _CNSS_MAIN_H */
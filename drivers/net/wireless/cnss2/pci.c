@@ -18,6 +18,7 @@
 #include <linux/pm_runtime.h>
 #include <linux/memblock.h>
 #include <linux/completion.h>
+#include <linux/topology.h>
 #include <soc/qcom/ramdump.h>
 
 #include "main.h"
@@ -50,6 +51,10 @@
 
 #define WAKE_MSI_NAME			"WAKE"
 
+#define CE_MSI_NAME			"CE"
+#define DP_MSI_NAME			"DP"
+#define MSI_AFFINITY_INTERVAL_MS	1000
+
 #define FW_ASSERT_TIMEOUT		5000
 #define DEV_RDDM_TIMEOUT		5000
 
@@ -2332,8 +2337,252 @@ static int cnss_pci_enable_msi(struct cnss_pci_data *pci_priv)
 	return ret;
 }
 
+static unsigned int cnss_pci_msi_irq_count(unsigned int irq)
+{
+	struct irq_desc *desc = irq_to_desc(irq);
+	unsigned int count = 0;
+	int cpu;
+
+	if (!desc || !desc->kstat_irqs)
+		return 0;
+
+	for_each_possible_cpu(cpu)
+		count += *per_cpu_ptr(desc->kstat_irqs, cpu);
+
+	return count;
+}
+
+/*
+ * Pick the online CPUs of the configured set that the vectors should use:
+ * the most efficient cluster under load, the least efficient one otherwise.
+ * Targets with a single cluster get the whole set.
+ */
+static void cnss_pci_msi_affinity_cpus(struct cnss_pci_data *pci_priv,
+				       bool big, struct cpumask *mask)
+{
+	struct cnss_plat_data *plat_priv = pci_priv->plat_priv;
+	unsigned long allowed = plat_priv->ctrl_params.msi_affinity_cpus;
+	unsigned long eff, target = 0;
+	cpumask_var_t cpus;
+	int cpu;
+
+	cpumask_clear(mask);
+	if (!zalloc_cpumask_var(&cpus, GFP_KERNEL))
+		return;
+
+	for_each_online_cpu(cpu) {
+		if (allowed && (cpu >= BITS_PER_LONG ||
+				!test_bit(cpu, &allowed)))
+			continue;
+		cpumask_set_cpu(cpu, cpus);
+
+		eff = arch_get_cpu_efficiency(cpu);
+		if (!target || (big ? eff > target : eff < target))
+			target = eff;
+	}
+
+	for_each_cpu(cpu, cpus) {
+		if (arch_get_cpu_efficiency(cpu) == target)
+			cpumask_set_cpu(cpu, mask);
+	}
+
+	free_cpumask_var(cpus);
+}
+
+/* Insertion sort of the vector indexes by rate, busiest first */
+static void cnss_pci_msi_sort_order(struct cnss_msi_affinity *aff)
+{
+	unsigned int i, j;
+	u8 idx;
+
+	for (i = 1; i < aff->nr_vectors; i++) {
+		idx = aff->order[i];
+		for (j = i; j > 0 && aff->vectors[aff->order[j - 1]].rate <
+		     aff->vectors[idx].rate; j--)
+			aff->order[j] = aff->order[j - 1];
+		aff->order[j] = idx;
+	}
+}
+
+static void cnss_pci_msi_affinity_work(struct work_struct *work)
+{
+	struct cnss_msi_affinity *aff =
+		container_of(to_delayed_work(work), struct cnss_msi_affinity,
+			     work);
+	struct cnss_pci_data *pci_priv =
+		container_of(aff, struct cnss_pci_data, msi_affinity);
+	struct cnss_plat_data *plat_priv = pci_priv->plat_priv;
+	unsigned int high_rate = plat_priv->ctrl_params.msi_affinity_high_rate;
+	struct cnss_msi_vector *vec;
+	unsigned int i, count, total = 0, elapsed;
+	cpumask_var_t mask;
+	int cpu, best;
+
+	if (!zalloc_cpumask_var(&mask, GFP_KERNEL))
+		goto resched;
+
+	mutex_lock(&aff->lock);
+
+	elapsed = jiffies_to_msecs(jiffies - aff->last_jiffies) ?: 1;
+	aff->last_jiffies = jiffies;
+
+	for (i = 0; i < aff->nr_vectors; i++) {
+		vec = &aff->vectors[i];
+		count = cnss_pci_msi_irq_count(vec->irq);
+		vec->rate = (u64)(count - vec->last_count) * MSEC_PER_SEC /
+			    elapsed;
+		vec->last_count = count;
+		total += vec->rate;
+		aff->order[i] = i;
+	}
+
+	/* Leave the big cores only well below the threshold to avoid flapping */
+	if (total >= high_rate)
+		aff->big = true;
+	else if (total < high_rate / 2)
+		aff->big = false;
+
+	cnss_pci_msi_affinity_cpus(pci_priv, aff->big, mask);
+	if (cpumask_empty(mask))
+		goto unlock;
+
+	cnss_pci_msi_sort_order(aff);
+
+	memset(aff->load, 0, nr_cpu_ids * sizeof(*aff->load));
+
+	/* Busiest vector first, each onto the least loaded CPU of the set */
+	for (i = 0; i < aff->nr_vectors; i++) {
+		vec = &aff->vectors[aff->order[i]];
+
+		best = -1;
+		for_each_cpu(cpu, mask) {
+			if (best < 0 || aff->load[cpu] < aff->load[best] ||
+			    (aff->load[cpu] == aff->load[best] &&
+			     cpu == vec->cpu))
+				best = cpu;
+		}
+
+		/* Idle vectors still count so that they are spread as well */
+		aff->load[best] += vec->rate + 1;
+		if (best == vec->cpu)
+			continue;
+
+		if (irq_set_affinity_hint(vec->irq, cpumask_of(best))) {
+			cnss_pr_dbg("Failed to move %s MSI IRQ %u to CPU %d\n",
+				    vec->user, vec->irq, best);
+			continue;
+		}
+		vec->cpu = best;
+	}
+
+unlock:
+	mutex_unlock(&aff->lock);
+	free_cpumask_var(mask);
+resched:
+	schedule_delayed_work(&aff->work,
+			      msecs_to_jiffies(MSI_AFFINITY_INTERVAL_MS));
+}
+
+static void cnss_pci_msi_affinity_init(struct cnss_pci_data *pci_priv)
+{
+	struct cnss_msi_affinity *aff = &pci_priv->msi_affinity;
+	struct cnss_msi_config *msi_config = pci_priv->msi_config;
+	struct cnss_msi_user *user;
+	struct cnss_msi_vector *vec;
+	unsigned int nr = 0;
+	int i, j;
+
+	for (i = 0; i < msi_config->total_users; i++) {
+		user = &msi_config->users[i];
+		if (!strcmp(user->name, CE_MSI_NAME) ||
+		    !strcmp(user->name, DP_MSI_NAME))
+			nr += user->num_vectors;
+	}
+
+	if (!nr || nr > U8_MAX)
+		return;
+
+	aff->vectors = kcalloc(nr, sizeof(*aff->vectors), GFP_KERNEL);
+	aff->order = kcalloc(nr, sizeof(*aff->order), GFP_KERNEL);
+	aff->load = kcalloc(nr_cpu_ids, sizeof(*aff->load), GFP_KERNEL);
+	if (!aff->vectors || !aff->order || !aff->load)
+		goto free;
+
+	for (i = 0; i < msi_config->total_users; i++) {
+		user = &msi_config->users[i];
+		if (strcmp(user->name, CE_MSI_NAME) &&
+		    strcmp(user->name, DP_MSI_NAME))
+			continue;
+
+		for (j = 0; j < user->num_vectors; j++) {
+			vec = &aff->vectors[aff->nr_vectors++];
+			vec->user = user->name;
+			vec->irq = pci_irq_vector(pci_priv->pci_dev,
+						  user->base_vector + j);
+			vec->last_count = cnss_pci_msi_irq_count(vec->irq);
+			vec->cpu = -1;
+		}
+	}
+
+	mutex_init(&aff->lock);
+	INIT_DEFERRABLE_WORK(&aff->work, cnss_pci_msi_affinity_work);
+	aff->last_jiffies = jiffies;
+	schedule_delayed_work(&aff->work, 0);
+
+	return;
+
+free:
+	kfree(aff->load);
+	kfree(aff->order);
+	kfree(aff->vectors);
+	memset(aff, 0, sizeof(*aff));
+}
+
+static void cnss_pci_msi_affinity_deinit(struct cnss_pci_data *pci_priv)
+{
+	struct cnss_msi_affinity *aff = &pci_priv->msi_affinity;
+	unsigned int i;
+
+	if (!aff->vectors)
+		return;
+
+	cancel_delayed_work_sync(&aff->work);
+
+	for (i = 0; i < aff->nr_vectors; i++)
+		irq_set_affinity_hint(aff->vectors[i].irq, NULL);
+
+	kfree(aff->load);
+	kfree(aff->order);
+	kfree(aff->vectors);
+	memset(aff, 0, sizeof(*aff));
+}
+
+void cnss_pci_msi_affinity_show(struct cnss_pci_data *pci_priv,
+				struct seq_file *s)
+{
+	struct cnss_msi_affinity *aff = &pci_priv->msi_affinity;
+	struct cnss_msi_vector *vec;
+	unsigned int i;
+
+	if (!aff->vectors) {
+		seq_puts(s, "MSI affinity is not enabled\n");
+		return;
+	}
+
+	mutex_lock(&aff->lock);
+	seq_printf(s, "Cores: %s\n", aff->big ? "big" : "little");
+	seq_printf(s, "%-6s %6s %6s %10s\n", "USER", "IRQ", "CPU", "RATE(/s)");
+	for (i = 0; i < aff->nr_vectors; i++) {
+		vec = &aff->vectors[i];
+		seq_printf(s, "%-6s %6u %6d %10u\n", vec->user, vec->irq,
+			   vec->cpu, vec->rate);
+	}
+	mutex_unlock(&aff->lock);
+}
+
 static void cnss_pci_disable_msi(struct cnss_pci_data *pci_priv)
 {
+	cnss_pci_msi_affinity_deinit(pci_priv);
 	pci_free_irq_vectors(pci_priv->pci_dev);
 }
 
@@ -3411,6 +3660,7 @@ static int cnss_pci_probe(struct pci_dev *pci_dev,
 		ret = cnss_pci_enable_msi(pci_priv);
 		if (ret)
 			goto disable_bus;
+		cnss_pci_msi_affinity_init(pci_priv);
 
 		snprintf(plat_priv->firmware_name,
 			 sizeof(plat_priv->firmware_name),
@@ -18,6 +18,7 @@
 #include <linux/mhi.h>
 #include <linux/msm_pcie.h>
 #include <linux/pci.h>
+#include <linux/seq_file.h>
 
 #include "main.h"
 
@@ -46,6 +47,44 @@ struct cnss_msi_config {
 	struct cnss_msi_user *users;
 };
 
+/**
+ * struct cnss_msi_vector - Placement of one CE or DP MSI vector
+ * @user: MSI user the vector belongs to
+ * @irq: Linux IRQ number of the vector
+ * @last_count: Interrupt count at the previous rebalance
+ * @rate: Interrupts per second over the last interval
+ * @cpu: CPU the vector was last pointed at, -1 if none yet
+ */
+struct cnss_msi_vector {
+	const char *user;
+	unsigned int irq;
+	unsigned int last_count;
+	unsigned int rate;
+	int cpu;
+};
+
+/**
+ * struct cnss_msi_affinity - Periodic CE and DP MSI vector balancing
+ * @work: Deferrable rebalance work
+ * @lock: Protects @vectors against the debugfs reader
+ * @nr_vectors: Number of entries in @vectors
+ * @vectors: Balanced vectors
+ * @order: Indexes into @vectors, sorted by rate on each rebalance
+ * @load: Per CPU sum of assigned rates, scratch for the rebalance
+ * @last_jiffies: Time of the previous rebalance
+ * @big: True if the vectors are on the big cores
+ */
+struct cnss_msi_affinity {
+	struct delayed_work work;
+	struct mutex lock;
+	unsigned int nr_vectors;
+	struct cnss_msi_vector *vectors;
+	u8 *order;
+	unsigned int *load;
+	unsigned long last_jiffies;
+	bool big;
+};
+
 struct cnss_pci_reg {
 	char *name;
 	u32 offset;
@@ -80,6 +119,7 @@ struct cnss_pci_data {
 	void __iomem *bar;
 	struct cnss_msi_config *msi_config;
 	u32 msi_ep_base_data;
+	struct cnss_msi_affinity msi_affinity;
 	struct mhi_controller *mhi_ctrl;
 	unsigned long mhi_state;
 	u32 remap_window;
@@ -162,6 +202,8 @@ int cnss_pci_unregister_driver_hdlr(struct cnss_pci_data *pci_priv);
 int cnss_pci_call_driver_modem_status(struct cnss_pci_data *pci_priv,
 				      int modem_current_status);
 void cnss_pci_pm_runtime_show_usage_count(struct cnss_pci_data *pci_priv);
+void cnss_pci_msi_affinity_show(struct cnss_pci_data *pci_priv,
+				struct seq_file *s);
 int cnss_pci_pm_runtime_get(struct cnss_pci_data *pci_priv);
 void cnss_pci_pm_runtime_get_noresume(struct cnss_pci_data *pci_priv);
 int cnss_pci_pm_runtime_put_autosuspend(struct cnss_pci_data *pci_priv);
@@ -13,6 +13,7 @@
 #include <linux/firmware.h>
 #include <linux/module.h>
 #include <linux/qmi_encdec.h>
+#include <linux/vmalloc.h>
 #include <soc/qcom/msm_qmi_interface.h>
 
 #include "bus.h"
@@ -30,6 +31,7 @@
 #define REGDB_FILE_NAME			"regdb.bin"
 #define DUMMY_BDF_FILE_NAME		"bdwlan.dmy"
 #define CE_MSI_NAME			"CE"
+#define CNSS_BDF_PIPELINE_MAX		8
 
 #ifdef CONFIG_CNSS2_DEBUG
 static unsigned int qmi_timeout = 10000;
@@ -51,6 +53,30 @@ module_param(bdf_type, uint, 0600);
 MODULE_PARM_DESC(bdf_type, "Type of board data file to be downloaded");
 #endif
 
+static bool bdf_cache = true;
+module_param(bdf_cache, bool, 0600);
+MODULE_PARM_DESC(bdf_cache, "Keep BDF and regdb in memory across power cycles");
+
+static unsigned int bdf_pipeline = 1;
+module_param(bdf_pipeline, uint, 0600);
+MODULE_PARM_DESC(bdf_pipeline, "Number of BDF segments in flight, 1 to wait for each");
+
+struct cnss_bdf_pipe;
+
+struct cnss_bdf_pipe_slot {
+	struct cnss_bdf_pipe *pipe;
+	struct wlfw_bdf_download_resp_msg_v01 resp;
+	bool busy;
+};
+
+/* Outstanding asynchronous BDF segments, see cnss_wlfw_bdf_send_pipelined */
+struct cnss_bdf_pipe {
+	wait_queue_head_t wait;
+	atomic_t outstanding;
+	int ret;
+	struct cnss_bdf_pipe_slot slot[CNSS_BDF_PIPELINE_MAX];
+};
+
 static char *cnss_qmi_mode_to_str(enum cnss_driver_mode mode)
 {
 	switch (mode) {
@@ -456,6 +482,7 @@ int cnss_wlfw_tgt_cap_send_sync(struct cnss_plat_data *plat_priv)
 
 	cnss_pr_dbg("Sending target capability message, state: 0x%lx\n",
 		    plat_priv->driver_state);
+	cnss_boot_phase_begin(plat_priv, CNSS_BOOT_TGT_CAP);
 
 	memset(&req, 0, sizeof(req));
 	memset(&resp, 0, sizeof(resp));
@@ -509,12 +536,207 @@ int cnss_wlfw_tgt_cap_send_sync(struct cnss_plat_data *plat_priv)
 		    plat_priv->fw_version_info.fw_version,
 		    plat_priv->fw_version_info.fw_build_timestamp);
 
+	cnss_boot_phase_end(plat_priv, CNSS_BOOT_TGT_CAP);
 	return 0;
 out:
 	CNSS_ASSERT(0);
 	return ret;
 }
 
+static int cnss_bdf_cache_get(struct cnss_plat_data *plat_priv,
+			      u32 bdf_type, const char *filename,
+			      const u8 **data, unsigned int *size)
+{
+	struct cnss_bdf_cache *cache;
+	const struct firmware *fw_entry;
+	int ret;
+
+	cache = &plat_priv->bdf_cache[bdf_type == CNSS_BDF_REGDB ?
+				      CNSS_BDF_CACHE_REGDB :
+				      CNSS_BDF_CACHE_BOARD];
+
+	if (cache->data && !strcmp(cache->name, filename)) {
+		cnss_pr_dbg("Using cached BDF: %s\n", filename);
+		goto out;
+	}
+
+	vfree(cache->data);
+	cache->data = NULL;
+	cache->size = 0;
+
+	if (bdf_type == CNSS_BDF_REGDB)
+		ret = request_firmware_direct(&fw_entry, filename,
+					      &plat_priv->plat_dev->dev);
+	else
+		ret = request_firmware(&fw_entry, filename,
+				       &plat_priv->plat_dev->dev);
+	if (ret)
+		return ret;
+
+	cache->data = vmalloc(fw_entry->size);
+	if (!cache->data) {
+		release_firmware(fw_entry);
+		return -ENOMEM;
+	}
+
+	memcpy(cache->data, fw_entry->data, fw_entry->size);
+	cache->size = fw_entry->size;
+	strlcpy(cache->name, filename, sizeof(cache->name));
+	release_firmware(fw_entry);
+
+out:
+	*data = cache->data;
+	*size = cache->size;
+	return 0;
+}
+
+static void cnss_bdf_cache_put(struct cnss_plat_data *plat_priv,
+			       u32 bdf_type)
+{
+	struct cnss_bdf_cache *cache;
+
+	if (bdf_cache)
+		return;
+
+	cache = &plat_priv->bdf_cache[bdf_type == CNSS_BDF_REGDB ?
+				      CNSS_BDF_CACHE_REGDB :
+				      CNSS_BDF_CACHE_BOARD];
+	vfree(cache->data);
+	cache->data = NULL;
+	cache->size = 0;
+}
+
+static void cnss_bdf_pipe_resp_cb(struct qmi_handle *handle,
+				  unsigned int msg_id, void *msg,
+				  void *resp_cb_data, int stat)
+{
+	struct cnss_bdf_pipe_slot *slot = resp_cb_data;
+	struct cnss_bdf_pipe *pipe = slot->pipe;
+	int ret = 0;
+
+	if (stat < 0)
+		ret = stat;
+	else if (slot->resp.resp.result != QMI_RESULT_SUCCESS_V01)
+		ret = slot->resp.resp.result;
+
+	if (ret) {
+		cnss_pr_err("BDF download request failed, result: %d, err: %d\n",
+			    slot->resp.resp.result, slot->resp.resp.error);
+		cmpxchg(&pipe->ret, 0, ret);
+	}
+
+	slot->busy = false;
+	smp_wmb();
+	atomic_dec(&pipe->outstanding);
+	wake_up(&pipe->wait);
+}
+
+/*
+ * Keep up to bdf_pipeline segments outstanding instead of waiting for the
+ * response of each one before encoding the next. The firmware handles the
+ * segments of one file in order so only the first error is reported.
+ */
+static int cnss_wlfw_bdf_send_pipelined(struct cnss_plat_data *plat_priv,
+					struct wlfw_bdf_download_req_msg_v01 *req,
+					struct msg_desc *req_desc,
+					struct msg_desc *resp_desc,
+					const u8 *temp, unsigned int remaining,
+					unsigned int window)
+{
+	struct cnss_bdf_pipe *pipe;
+	struct cnss_bdf_pipe_slot *slot;
+	unsigned int i;
+	long left;
+	int ret;
+
+	pipe = kzalloc(sizeof(*pipe), GFP_KERNEL);
+	if (!pipe)
+		return -ENOMEM;
+
+	init_waitqueue_head(&pipe->wait);
+	atomic_set(&pipe->outstanding, 0);
+	for (i = 0; i < window; i++)
+		pipe->slot[i].pipe = pipe;
+
+	while (remaining) {
+		left = wait_event_timeout(pipe->wait,
+					  atomic_read(&pipe->outstanding) <
+					  window || READ_ONCE(pipe->ret),
+					  msecs_to_jiffies(QMI_WLFW_TIMEOUT_MS));
+		if (!left) {
+			ret = -ETIMEDOUT;
+			goto timeout;
+		}
+
+		smp_rmb();
+		ret = READ_ONCE(pipe->ret);
+		if (ret)
+			goto drain;
+
+		for (i = 0, slot = NULL; i < window; i++) {
+			if (!pipe->slot[i].busy) {
+				slot = &pipe->slot[i];
+				break;
+			}
+		}
+		if (WARN_ON(!slot)) {
+			ret = -EBUSY;
+			goto drain;
+		}
+
+		req->total_size = remaining;
+		if (remaining > QMI_WLFW_MAX_DATA_SIZE_V01) {
+			req->data_len = QMI_WLFW_MAX_DATA_SIZE_V01;
+		} else {
+			req->data_len = remaining;
+			req->end = 1;
+		}
+		memcpy(req->data, temp, req->data_len);
+
+		memset(&slot->resp, 0, sizeof(slot->resp));
+		slot->busy = true;
+		atomic_inc(&pipe->outstanding);
+
+		/* The request is encoded before this returns, reuse it */
+		ret = qmi_send_req_nowait(plat_priv->qmi_wlfw_clnt, req_desc,
+					  req, sizeof(*req), resp_desc,
+					  &slot->resp, sizeof(slot->resp),
+					  cnss_bdf_pipe_resp_cb, slot);
+		if (ret < 0) {
+			cnss_pr_err("Failed to send BDF download request, err: %d\n",
+				    ret);
+			slot->busy = false;
+			atomic_dec(&pipe->outstanding);
+			goto drain;
+		}
+
+		remaining -= req->data_len;
+		temp += req->data_len;
+		req->seg_id++;
+	}
+
+	ret = 0;
+drain:
+	left = wait_event_timeout(pipe->wait,
+				  !atomic_read(&pipe->outstanding),
+				  msecs_to_jiffies(QMI_WLFW_TIMEOUT_MS));
+	if (!left) {
+		ret = -ETIMEDOUT;
+		goto timeout;
+	}
+
+	if (!ret)
+		ret = pipe->ret;
+	kfree(pipe);
+	return ret;
+
+timeout:
+	/* Responses may still arrive for the outstanding slots, leak pipe */
+	cnss_pr_err("Timeout waiting for BDF download responses, outstanding: %d\n",
+		    atomic_read(&pipe->outstanding));
+	return ret;
+}
+
 int cnss_wlfw_bdf_dnld_send_sync(struct cnss_plat_data *plat_priv,
 				 u32 bdf_type)
 {
@@ -522,15 +744,18 @@ int cnss_wlfw_bdf_dnld_send_sync(struct cnss_plat_data *plat_priv,
 	struct wlfw_bdf_download_resp_msg_v01 resp;
 	struct msg_desc req_desc, resp_desc;
 	char filename[CNSS_FW_PATH_MAX_LEN];
-	const struct firmware *fw_entry;
+	enum cnss_boot_phase phase;
 	const u8 *temp;
-	unsigned int remaining;
+	unsigned int remaining, window;
 	int ret = 0;
 	const char *fw_path;
 
 	cnss_pr_dbg("Sending BDF download message, state: 0x%lx\n",
 		    plat_priv->driver_state);
 
+	phase = bdf_type == CNSS_BDF_REGDB ? CNSS_BOOT_REGDB : CNSS_BOOT_BDF;
+	cnss_boot_phase_begin(plat_priv, phase);
+
 	req = kzalloc(sizeof(*req), GFP_KERNEL);
 	if (!req)
 		return -ENOMEM;
@@ -578,25 +803,18 @@ int cnss_wlfw_bdf_dnld_send_sync(struct cnss_plat_data *plat_priv,
 		remaining = CNSS_FW_PATH_MAX_LEN;
 		goto bypass_bdf;
 	default:
-		cnss_pr_err("Invalid BDF type: %d\n",
-			    plat_priv->ctrl_params.bdf_type);
+		cnss_pr_err("Invalid BDF type: %d\n", bdf_type);
 		ret = -EINVAL;
 		goto err_req_fw;
 	}
-	if (bdf_type == CNSS_BDF_REGDB)
-		ret = request_firmware_direct(&fw_entry, filename,
-					      &plat_priv->plat_dev->dev);
-	else
-		ret = request_firmware(&fw_entry, filename,
-				       &plat_priv->plat_dev->dev);
+
+	ret = cnss_bdf_cache_get(plat_priv, bdf_type, filename,
+				 &temp, &remaining);
 	if (ret) {
 		cnss_pr_err("Failed to load BDF: %s\n", filename);
 		goto err_req_fw;
 	}
 
-	temp = fw_entry->data;
-	remaining = fw_entry->size;
-
 bypass_bdf:
 	cnss_pr_dbg("Downloading BDF: %s, size: %u\n", filename, remaining);
 
@@ -610,17 +828,29 @@ int cnss_wlfw_bdf_dnld_send_sync(struct cnss_plat_data *plat_priv,
 	resp_desc.msg_id = QMI_WLFW_BDF_DOWNLOAD_RESP_V01;
 	resp_desc.ei_array = wlfw_bdf_download_resp_msg_v01_ei;
 
+	req->valid = 1;
+	req->file_id_valid = 1;
+	req->file_id = plat_priv->board_info.board_id;
+	req->total_size_valid = 1;
+	req->seg_id_valid = 1;
+	req->data_valid = 1;
+	req->end_valid = 1;
+	req->bdf_type_valid = 1;
+	req->bdf_type = plat_priv->ctrl_params.bdf_type;
+
+	window = clamp_t(unsigned int, bdf_pipeline, 1, CNSS_BDF_PIPELINE_MAX);
+	if (window > 1 &&
+	    DIV_ROUND_UP(remaining, QMI_WLFW_MAX_DATA_SIZE_V01) > 1) {
+		ret = cnss_wlfw_bdf_send_pipelined(plat_priv, req, &req_desc,
+						   &resp_desc, temp, remaining,
+						   window);
+		if (ret)
+			goto err_send;
+		remaining = 0;
+	}
+
 	while (remaining) {
-		req->valid = 1;
-		req->file_id_valid = 1;
-		req->file_id = plat_priv->board_info.board_id;
-		req->total_size_valid = 1;
 		req->total_size = remaining;
-		req->seg_id_valid = 1;
-		req->data_valid = 1;
-		req->end_valid = 1;
-		req->bdf_type_valid = 1;
-		req->bdf_type = plat_priv->ctrl_params.bdf_type;
 
 		if (remaining > QMI_WLFW_MAX_DATA_SIZE_V01) {
 			req->data_len = QMI_WLFW_MAX_DATA_SIZE_V01;
@@ -653,14 +883,15 @@ int cnss_wlfw_bdf_dnld_send_sync(struct cnss_plat_data *plat_priv,
 	}
 
 	if (bdf_type != CNSS_BDF_DUMMY)
-		release_firmware(fw_entry);
+		cnss_bdf_cache_put(plat_priv, bdf_type);
 
+	cnss_boot_phase_end(plat_priv, phase);
 	kfree(req);
 	return 0;
 
 err_send:
-	if (plat_priv->ctrl_params.bdf_type != CNSS_BDF_DUMMY)
-		release_firmware(fw_entry);
+	if (bdf_type != CNSS_BDF_DUMMY)
+		cnss_bdf_cache_put(plat_priv, bdf_type);
 err_req_fw:
 	if (bdf_type != CNSS_BDF_REGDB)
 		CNSS_ASSERT(0);
@@ -678,6 +909,7 @@ int cnss_wlfw_m3_dnld_send_sync(struct cnss_plat_data *plat_priv)
 
 	cnss_pr_dbg("Sending M3 information message, state: 0x%lx\n",
 		    plat_priv->driver_state);
+	cnss_boot_phase_begin(plat_priv, CNSS_BOOT_M3);
 
 	if (!m3_mem->pa || !m3_mem->size) {
 		cnss_pr_err("Memory for M3 is not available!\n");
@@ -718,6 +950,7 @@ int cnss_wlfw_m3_dnld_send_sync(struct cnss_plat_data *plat_priv)
 		goto out;
 	}
 
+	cnss_boot_phase_end(plat_priv, CNSS_BOOT_M3);
 	return 0;
 
 out:
@@ -1171,6 +1404,8 @@ int cnss_wlfw_server_arrive(struct cnss_plat_data *plat_priv)
 	if (!plat_priv)
 		return -ENODEV;
 
+	cnss_boot_phase_begin(plat_priv, CNSS_BOOT_QMI_CONNECT);
+
 	plat_priv->qmi_wlfw_clnt =
 		qmi_handle_create(cnss_wlfw_clnt_notifier, plat_priv);
 	if (!plat_priv->qmi_wlfw_clnt) {
@@ -1210,6 +1445,7 @@ int cnss_wlfw_server_arrive(struct cnss_plat_data *plat_priv)
 	if (ret < 0)
 		goto out;
 
+	cnss_boot_phase_end(plat_priv, CNSS_BOOT_QMI_CONNECT);
 	return 0;
 out:
 	qmi_handle_destroy(plat_priv->qmi_wlfw_clnt);
@@ -1258,8 +1494,15 @@ int cnss_qmi_init(struct cnss_plat_data *plat_priv)
 
 void cnss_qmi_deinit(struct cnss_plat_data *plat_priv)
 {
+	int i;
+
 	qmi_svc_event_notifier_unregister(WLFW_SERVICE_ID_V01,
 					  WLFW_SERVICE_VERS_V01,
 					  WLFW_SERVICE_INS_ID_V01,
 					  &plat_priv->qmi_wlfw_clnt_nb);
+
+	for (i = 0; i < CNSS_BDF_CACHE_MAX; i++) {
+		vfree(plat_priv->bdf_cache[i].data);
+		plat_priv->bdf_cache[i].data = NULL;
+	}
 }
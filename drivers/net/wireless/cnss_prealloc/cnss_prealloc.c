@@ -16,13 +16,15 @@
 #include <linux/stacktrace.h>
 #include <linux/spinlock.h>
 #include <linux/debugfs.h>
+#include <linux/hashtable.h>
+#include <linux/list.h>
+#include <linux/log2.h>
+#include <linux/percpu.h>
 #include <net/cnss_prealloc.h>
 #ifdef	CONFIG_WCNSS_SKB_PRE_ALLOC
 #include <linux/skbuff.h>
 #endif
 
-static DEFINE_SPINLOCK(alloc_lock);
-
 #ifdef CONFIG_SLUB_DEBUG
 #define WCNSS_MAX_STACK_TRACE			64
 #endif
@@ -30,12 +32,22 @@ static DEFINE_SPINLOCK(alloc_lock);
 #define PRE_ALLOC_DEBUGFS_DIR		"cnss-prealloc"
 #define PRE_ALLOC_DEBUGFS_FILE_OBJ	"status"
 
+/* Slots are grouped in power of two size classes, 8 Kb up to 128 Kb */
+#define WCNSS_PREALLOC_MIN_SHIFT	13
+#define WCNSS_PREALLOC_NR_CLASSES	5
+#define WCNSS_PREALLOC_CLASS_SIZE(c)	(1UL << (WCNSS_PREALLOC_MIN_SHIFT + (c)))
+#define WCNSS_PREALLOC_HIST_BUCKETS	4
+#define WCNSS_PREALLOC_HASH_BITS	7
+
 static struct dentry *debug_base;
 
 struct wcnss_prealloc {
 	int occupied;
+	int cls;
 	size_t size;
 	void *ptr;
+	struct list_head list;
+	struct hlist_node node;
 #ifdef CONFIG_SLUB_DEBUG
 	unsigned long stack_trace[WCNSS_MAX_STACK_TRACE];
 	struct stack_trace trace;
@@ -44,83 +56,239 @@ struct wcnss_prealloc {
 
 /* pre-alloced mem for WLAN driver */
 static struct wcnss_prealloc wcnss_allocs[] = {
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 128 * 1024, NULL},
-	{0, 128 * 1024, NULL},
+	{0, 0, 8  * 1024, NULL},
+	{0, 0, 8  * 1024, NULL},
+	{0, 0, 8  * 1024, NULL},
+	{0, 0, 8  * 1024, NULL},
+	{0, 0, 8  * 1024, NULL},
+	{0, 0, 8  * 1024, NULL},
+	{0, 0, 8  * 1024, NULL},
+	{0, 0, 8  * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 16 * 1024, NULL},
+	{0, 0, 32 * 1024, NULL},
+	{0, 0, 32 * 1024, NULL},
+	{0, 0, 32 * 1024, NULL},
+	{0, 0, 32 * 1024, NULL},
+	{0, 0, 32 * 1024, NULL},
+	{0, 0, 32 * 1024, NULL},
+	{0, 0, 32 * 1024, NULL},
+	{0, 0, 32 * 1024, NULL},
+	{0, 0, 32 * 1024, NULL},
+	{0, 0, 32 * 1024, NULL},
+	{0, 0, 64 * 1024, NULL},
+	{0, 0, 64 * 1024, NULL},
+	{0, 0, 64 * 1024, NULL},
+	{0, 0, 64 * 1024, NULL},
+	{0, 0, 128 * 1024, NULL},
+	{0, 0, 128 * 1024, NULL},
+};
+
+/**
+ * struct wcnss_prealloc_class - free slots and usage of one size class
+ * @lock: protects @free
+ * @free: slots of this class not handed out and not parked on a CPU
+ * @nr: number of slots of this class in the pool
+ * @used: number of slots of this class currently handed out
+ * @peak: highest value @used has reached
+ * @fallbacks: requests of this class served from a larger class
+ * @fails: requests of this class that found no free slot at all
+ * @hist: requests of this class, by quarter of the class size range
+ */
+struct wcnss_prealloc_class {
+	spinlock_t lock;
+	struct list_head free;
+	unsigned int nr;
+	atomic_t used;
+	unsigned int peak;
+	atomic_t fallbacks;
+	atomic_t fails;
+	atomic_t hist[WCNSS_PREALLOC_HIST_BUCKETS];
 };
 
+/* One freed slot per class is kept on the freeing CPU for its next get */
+struct wcnss_prealloc_pcp {
+	spinlock_t lock;
+	struct wcnss_prealloc *cache[WCNSS_PREALLOC_NR_CLASSES];
+};
+
+static struct wcnss_prealloc_class wcnss_classes[WCNSS_PREALLOC_NR_CLASSES];
+static DEFINE_PER_CPU(struct wcnss_prealloc_pcp, wcnss_prealloc_pcp);
+static DEFINE_HASHTABLE(wcnss_prealloc_hash, WCNSS_PREALLOC_HASH_BITS);
+static atomic_t wcnss_prealloc_oversize;
+
+static inline int wcnss_prealloc_class_of(size_t size)
+{
+	if (size <= WCNSS_PREALLOC_CLASS_SIZE(0))
+		return 0;
+	return order_base_2(size) - WCNSS_PREALLOC_MIN_SHIFT;
+}
+
+static void wcnss_prealloc_account(int cls, size_t size)
+{
+	size_t hi = WCNSS_PREALLOC_CLASS_SIZE(cls);
+	size_t lo = cls ? hi / 2 : 0;
+	int bucket;
+
+	bucket = ((size ? size - 1 : 0) - lo) * WCNSS_PREALLOC_HIST_BUCKETS /
+		 (hi - lo);
+	atomic_inc(&wcnss_classes[cls].hist[bucket]);
+}
+
+static struct wcnss_prealloc *wcnss_prealloc_take(int cls)
+{
+	struct wcnss_prealloc_class *c = &wcnss_classes[cls];
+	struct wcnss_prealloc_pcp *pcp;
+	struct wcnss_prealloc *entry;
+	unsigned long flags;
+	int cpu;
+
+	local_irq_save(flags);
+	pcp = this_cpu_ptr(&wcnss_prealloc_pcp);
+	spin_lock(&pcp->lock);
+	entry = pcp->cache[cls];
+	pcp->cache[cls] = NULL;
+	spin_unlock(&pcp->lock);
+	local_irq_restore(flags);
+	if (entry)
+		return entry;
+
+	spin_lock_irqsave(&c->lock, flags);
+	entry = list_first_entry_or_null(&c->free, struct wcnss_prealloc,
+					 list);
+	if (entry)
+		list_del(&entry->list);
+	spin_unlock_irqrestore(&c->lock, flags);
+	if (entry)
+		return entry;
+
+	/* The pool is small, so do not fail while other CPUs hold a slot */
+	for_each_possible_cpu(cpu) {
+		pcp = per_cpu_ptr(&wcnss_prealloc_pcp, cpu);
+		if (!READ_ONCE(pcp->cache[cls]))
+			continue;
+
+		spin_lock_irqsave(&pcp->lock, flags);
+		entry = pcp->cache[cls];
+		pcp->cache[cls] = NULL;
+		spin_unlock_irqrestore(&pcp->lock, flags);
+		if (entry)
+			return entry;
+	}
+
+	return NULL;
+}
+
+static void wcnss_prealloc_release(struct wcnss_prealloc *entry, bool cache)
+{
+	struct wcnss_prealloc_class *c = &wcnss_classes[entry->cls];
+	struct wcnss_prealloc_pcp *pcp;
+	unsigned long flags;
+
+	atomic_dec(&c->used);
+
+	if (cache) {
+		local_irq_save(flags);
+		pcp = this_cpu_ptr(&wcnss_prealloc_pcp);
+		spin_lock(&pcp->lock);
+		if (!pcp->cache[entry->cls]) {
+			pcp->cache[entry->cls] = entry;
+			entry = NULL;
+		}
+		spin_unlock(&pcp->lock);
+		local_irq_restore(flags);
+		if (!entry)
+			return;
+	}
+
+	spin_lock_irqsave(&c->lock, flags);
+	list_add(&entry->list, &c->free);
+	spin_unlock_irqrestore(&c->lock, flags);
+}
+
+static struct wcnss_prealloc *wcnss_prealloc_find(void *ptr)
+{
+	struct wcnss_prealloc *entry;
+
+	hash_for_each_possible(wcnss_prealloc_hash, entry, node,
+			       (unsigned long)ptr)
+		if (entry->ptr == ptr)
+			return entry;
+
+	return NULL;
+}
+
 int wcnss_prealloc_init(void)
 {
-	int i;
+	struct wcnss_prealloc_class *c;
+	int i, cpu;
+
+	for (i = 0; i < WCNSS_PREALLOC_NR_CLASSES; i++) {
+		spin_lock_init(&wcnss_classes[i].lock);
+		INIT_LIST_HEAD(&wcnss_classes[i].free);
+	}
+
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(&wcnss_prealloc_pcp, cpu)->lock);
 
 	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
 		wcnss_allocs[i].occupied = 0;
+		wcnss_allocs[i].cls =
+			wcnss_prealloc_class_of(wcnss_allocs[i].size);
+		if (WARN_ON(wcnss_allocs[i].cls >= WCNSS_PREALLOC_NR_CLASSES ||
+			    WCNSS_PREALLOC_CLASS_SIZE(wcnss_allocs[i].cls) !=
+			    wcnss_allocs[i].size))
+			return -EINVAL;
+
 		wcnss_allocs[i].ptr = kmalloc(wcnss_allocs[i].size, GFP_KERNEL);
 		if (!wcnss_allocs[i].ptr)
 			return -ENOMEM;
+
+		c = &wcnss_classes[wcnss_allocs[i].cls];
+		list_add_tail(&wcnss_allocs[i].list, &c->free);
+		c->nr++;
+		hash_add(wcnss_prealloc_hash, &wcnss_allocs[i].node,
+			 (unsigned long)wcnss_allocs[i].ptr);
 	}
 
 	return 0;
@@ -128,9 +296,20 @@ int wcnss_prealloc_init(void)
 
 void wcnss_prealloc_deinit(void)
 {
-	int i = 0;
+	int i = 0, cpu;
+
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(&wcnss_prealloc_pcp, cpu)->cache, 0,
+		       sizeof(per_cpu_ptr(&wcnss_prealloc_pcp, cpu)->cache));
+
+	for (i = 0; i < WCNSS_PREALLOC_NR_CLASSES; i++) {
+		INIT_LIST_HEAD(&wcnss_classes[i].free);
+		wcnss_classes[i].nr = 0;
+	}
 
 	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
+		if (wcnss_allocs[i].ptr)
+			hash_del(&wcnss_allocs[i].node);
 		kfree(wcnss_allocs[i].ptr);
 		wcnss_allocs[i].ptr = NULL;
 	}
@@ -156,44 +335,52 @@ void wcnss_prealloc_save_stack_trace(struct wcnss_prealloc *entry) {}
 
 void *wcnss_prealloc_get(size_t size)
 {
-	int i = 0;
-	unsigned long flags;
+	struct wcnss_prealloc *entry = NULL;
+	struct wcnss_prealloc_class *c;
+	unsigned int used;
+	int cls, i;
+
+	cls = wcnss_prealloc_class_of(size);
+	if (cls >= WCNSS_PREALLOC_NR_CLASSES) {
+		atomic_inc(&wcnss_prealloc_oversize);
+		return NULL;
+	}
+	wcnss_prealloc_account(cls, size);
 
-	spin_lock_irqsave(&alloc_lock, flags);
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		if (wcnss_allocs[i].occupied)
-			continue;
+	for (i = cls; i < WCNSS_PREALLOC_NR_CLASSES && !entry; i++)
+		entry = wcnss_prealloc_take(i);
 
-		if (wcnss_allocs[i].size >= size) {
-			/* we found the slot */
-			wcnss_allocs[i].occupied = 1;
-			spin_unlock_irqrestore(&alloc_lock, flags);
-			wcnss_prealloc_save_stack_trace(&wcnss_allocs[i]);
-			return wcnss_allocs[i].ptr;
-		}
+	if (!entry) {
+		atomic_inc(&wcnss_classes[cls].fails);
+		return NULL;
 	}
-	spin_unlock_irqrestore(&alloc_lock, flags);
+	if (entry->cls != cls)
+		atomic_inc(&wcnss_classes[cls].fallbacks);
 
-	return NULL;
+	c = &wcnss_classes[entry->cls];
+	used = atomic_inc_return(&c->used);
+	if (used > READ_ONCE(c->peak))
+		WRITE_ONCE(c->peak, used);
+
+	entry->occupied = 1;
+	wcnss_prealloc_save_stack_trace(entry);
+	return entry->ptr;
 }
 EXPORT_SYMBOL(wcnss_prealloc_get);
 
 int wcnss_prealloc_put(void *ptr)
 {
-	int i = 0;
-	unsigned long flags;
+	struct wcnss_prealloc *entry;
 
-	spin_lock_irqsave(&alloc_lock, flags);
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		if (wcnss_allocs[i].ptr == ptr) {
-			wcnss_allocs[i].occupied = 0;
-			spin_unlock_irqrestore(&alloc_lock, flags);
-			return 1;
-		}
-	}
-	spin_unlock_irqrestore(&alloc_lock, flags);
+	entry = wcnss_prealloc_find(ptr);
+	if (!entry)
+		return 0;
 
-	return 0;
+	/* A stale put of a free slot must not link it in twice */
+	if (xchg(&entry->occupied, 0))
+		wcnss_prealloc_release(entry, true);
+
+	return 1;
 }
 EXPORT_SYMBOL(wcnss_prealloc_put);
 
@@ -226,10 +413,10 @@ int wcnss_pre_alloc_reset(void)
 	int i, n = 0;
 
 	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		if (!wcnss_allocs[i].occupied)
+		if (!xchg(&wcnss_allocs[i].occupied, 0))
 			continue;
 
-		wcnss_allocs[i].occupied = 0;
+		wcnss_prealloc_release(&wcnss_allocs[i], false);
 		n++;
 	}
 
@@ -276,6 +463,19 @@ static int prealloc_memory_stats_show(struct seq_file *fp, void *data)
 	seq_printf(fp, "\nMemory Status:\nTotal Memory: %dKb\n", tsize);
 	seq_printf(fp, "Used: %dKb\nFree: %dKb\n", tused, tsize - tused);
 
+	seq_puts(fp, "\nClass(Kb)\t[Peak : Slots]\tFallback\tFail\tRequests by size quarter\n");
+	for (i = 0; i < WCNSS_PREALLOC_NR_CLASSES; i++) {
+		struct wcnss_prealloc_class *c = &wcnss_classes[i];
+
+		seq_printf(fp, "%lu Kb\t\t[%u : %u]\t%d\t\t%d\t%d %d %d %d\n",
+			   WCNSS_PREALLOC_CLASS_SIZE(i) / 1024,
+			   READ_ONCE(c->peak), c->nr,
+			   atomic_read(&c->fallbacks), atomic_read(&c->fails),
+			   atomic_read(&c->hist[0]), atomic_read(&c->hist[1]),
+			   atomic_read(&c->hist[2]), atomic_read(&c->hist[3]));
+	}
+	seq_printf(fp, "Oversize: %d\n", atomic_read(&wcnss_prealloc_oversize));
+
 	return 0;
 }
 
@@ -299,6 +499,7 @@ static int __init wcnss_pre_alloc_init(void)
 	ret = wcnss_prealloc_init();
 	if (ret) {
 		pr_err("%s: Failed to init the prealloc pool\n", __func__);
+		wcnss_prealloc_deinit();
 		return ret;
 	}
 
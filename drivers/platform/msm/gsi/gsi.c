@@ -426,6 +426,7 @@ static void gsi_ring_chan_doorbell(struct gsi_chan_ctx *ctx)
 	if (ctx->evtr && ctx->props.dir == GSI_CHAN_DIR_FROM_GSI)
 		gsi_ring_evt_doorbell(ctx->evtr);
 	ctx->ring.wp = ctx->ring.wp_local;
+	ctx->stats.doorbells++;
 
 	/* write order MUST be MSB followed by LSB */
 	val = ((ctx->ring.wp_local >> 32) &
@@ -443,6 +444,28 @@ static void gsi_ring_chan_doorbell(struct gsi_chan_ctx *ctx)
 				gsi_ctx->per.ee));
 }
 
+/*
+ * Hand an IEOB interrupt over to a client which polls its channel NAPI
+ * style: the interrupt stays masked and the channel in poll mode until the
+ * client drains the ring and moves it back to GSI_CHAN_MODE_CALLBACK.
+ */
+static void gsi_ieob_enter_poll(struct gsi_evt_ctx *ctx, int ee)
+{
+	struct gsi_chan_ctx *ch_ctx = ctx->chan;
+	unsigned long flags;
+
+	spin_lock_irqsave(&gsi_ctx->slock, flags);
+	__gsi_config_ieob_irq(ee, 1 << ctx->id, 0);
+	if (!atomic_read(&ch_ctx->poll_mode)) {
+		atomic_set(&ch_ctx->poll_mode, GSI_CHAN_MODE_POLL);
+		ch_ctx->stats.callback_to_poll++;
+	}
+	spin_unlock_irqrestore(&gsi_ctx->slock, flags);
+
+	ctx->stats.irqs++;
+	ch_ctx->props.poll_cb(ch_ctx->props.chan_user_data);
+}
+
 static void gsi_handle_ieob(int ee)
 {
 	uint32_t ch;
@@ -452,6 +475,7 @@ static void gsi_handle_ieob(int ee)
 	struct gsi_chan_xfer_notify notify;
 	unsigned long flags;
 	unsigned long cntr;
+	unsigned long processed;
 	uint32_t msk;
 
 	ch = gsi_readl(gsi_ctx->base +
@@ -477,6 +501,15 @@ static void gsi_handle_ieob(int ee)
 				continue;
 
 			BUG_ON(ctx->props.intf != GSI_EVT_CHTYPE_GPI_EV);
+
+			if (ctx->props.exclusive && ctx->chan &&
+				ctx->chan->props.poll_cb &&
+				!ctx->chan->props.common_evt_ring) {
+				gsi_ieob_enter_poll(ctx, ee);
+				continue;
+			}
+
+			processed = 0;
 			spin_lock_irqsave(&ctx->ring.slock, flags);
 check_again:
 			cntr = 0;
@@ -495,8 +528,11 @@ static void gsi_handle_ieob(int ee)
 				gsi_process_evt_re(ctx, &notify, true);
 			}
 			gsi_ring_evt_doorbell(ctx);
+			processed += cntr;
 			if (cntr != 0)
 				goto check_again;
+			ctx->stats.irqs++;
+			ctx->stats.irq_completed += processed;
 			spin_unlock_irqrestore(&ctx->ring.slock, flags);
 		}
 	}
@@ -2761,6 +2797,83 @@ int gsi_poll_channel(unsigned long chan_hdl,
 }
 EXPORT_SYMBOL(gsi_poll_channel);
 
+int gsi_poll_n_channel(unsigned long chan_hdl,
+		struct gsi_chan_xfer_notify *notify,
+		int expected_num, int *actual_num)
+{
+	struct gsi_chan_ctx *ctx;
+	struct gsi_ring_ctx *ering;
+	uint64_t rp;
+	int ee;
+	int i;
+	bool refreshed = false;
+	unsigned long flags;
+
+	if (!gsi_ctx) {
+		pr_err("%s:%d gsi context not allocated
+", __func__, __LINE__);
+		return -GSI_STATUS_NODEV;
+	}
+	ee = gsi_ctx->per.ee;
+
+	if (chan_hdl >= gsi_ctx->max_ch || !notify ||
+	    expected_num <= 0 || !actual_num) {
+		GSIERR("bad params chan_hdl=%lu notify=%p num=%d actual=%p\n",
+				chan_hdl, notify, expected_num, actual_num);
+		return -GSI_STATUS_INVALID_PARAMS;
+	}
+
+	ctx = &gsi_ctx->chan[chan_hdl];
+
+	if (ctx->props.prot != GSI_CHAN_PROT_GPI) {
+		GSIERR("op not supported for protocol %u\n", ctx->props.prot);
+		return -GSI_STATUS_UNSUPPORTED_OP;
+	}
+
+	if (!ctx->evtr) {
+		GSIERR("no event ring associated chan_hdl=%lu\n", chan_hdl);
+		return -GSI_STATUS_UNSUPPORTED_OP;
+	}
+
+	ering = &ctx->evtr->ring;
+	spin_lock_irqsave(&ering->slock, flags);
+	for (i = 0; i < expected_num; i++) {
+		if (ering->rp == ering->rp_local) {
+			if (refreshed)
+				break;
+			/* update rp once to pick up what HW wrote since */
+			rp = gsi_readl(gsi_ctx->base +
+				GSI_EE_n_EV_CH_k_CNTXT_4_OFFS(ctx->evtr->id,
+					ee));
+			rp |= ering->rp & 0xFFFFFFFF00000000;
+			ering->rp = rp;
+			refreshed = true;
+			if (ering->rp == ering->rp_local)
+				break;
+		}
+		gsi_process_evt_re(ctx->evtr, &notify[i], false);
+	}
+
+	/*
+	 * Return all the consumed elements to HW with a single doorbell. In
+	 * IEOB polling mode this is the only place where the event ring of a
+	 * TO_GSI channel gets recycled.
+	 */
+	if (i)
+		gsi_ring_evt_doorbell(ctx->evtr);
+	spin_unlock_irqrestore(&ering->slock, flags);
+
+	*actual_num = i;
+	if (!i) {
+		ctx->stats.poll_empty++;
+		return GSI_STATUS_POLL_EMPTY;
+	}
+	ctx->stats.poll_ok++;
+
+	return GSI_STATUS_SUCCESS;
+}
+EXPORT_SYMBOL(gsi_poll_n_channel);
+
 int gsi_config_channel_mode(unsigned long chan_hdl, enum gsi_chan_mode mode)
 {
 	struct gsi_chan_ctx *ctx;
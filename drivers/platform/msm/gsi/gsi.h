@@ -123,6 +123,7 @@ struct gsi_chan_stats {
 	unsigned long invalid_tre_error;
 	unsigned long poll_ok;
 	unsigned long poll_empty;
+	unsigned long doorbells;
 	struct gsi_chan_dp_stats dp;
 };
 
@@ -145,6 +146,8 @@ struct gsi_chan_ctx {
 
 struct gsi_evt_stats {
 	unsigned long completed;
+	unsigned long irqs;
+	unsigned long irq_completed;
 };
 
 struct gsi_evt_ctx {
@@ -277,9 +277,19 @@ static void gsi_dump_ch_stats(struct gsi_chan_ctx *ctx)
 		ctx->stats.invalid_tre_error);
 	PRT_STAT("poll_ok=%lu poll_empty=%lu\n",
 		ctx->stats.poll_ok, ctx->stats.poll_empty);
-	if (ctx->evtr)
+	PRT_STAT("doorbells=%lu queued_per_db=%lu\n",
+		ctx->stats.doorbells,
+		ctx->stats.doorbells ?
+			ctx->stats.queued / ctx->stats.doorbells : 0);
+	if (ctx->evtr) {
 		PRT_STAT("compl_evt=%lu\n",
 			ctx->evtr->stats.completed);
+		PRT_STAT("evt_irqs=%lu evt_per_irq=%lu\n",
+			ctx->evtr->stats.irqs,
+			ctx->evtr->stats.irqs ?
+				ctx->evtr->stats.irq_completed /
+				ctx->evtr->stats.irqs : 0);
+	}
 
 	PRT_STAT("ch_below_lo=%lu\n", ctx->stats.dp.ch_below_lo);
 	PRT_STAT("ch_below_hi=%lu\n", ctx->stats.dp.ch_below_hi);
@@ -28,6 +28,8 @@
 #include <linux/msm_ep_pcie.h>
 #include <linux/ipa_mhi.h>
 #include <linux/vmalloc.h>
+#include <linux/debugfs.h>
+#include <linux/jiffies.h>
 #include <soc/qcom/boot_stats.h>
 
 #include "mhi.h"
@@ -291,6 +293,7 @@ static int mhi_dev_send_multiple_tr_events(struct mhi_dev *mhi, int evnt_ring,
 
 	mhi_log(MHI_MSG_VERBOSE, "Flushing %d cmpl events of ch %d\n",
 			ereq->num_events, ch->ch_id);
+	ch->stats.evt_flush_count++;
 	/* add the events */
 	ereq->client_cb = mhi_dev_event_buf_completion_cb;
 	ereq->event_type = SEND_EVENT_BUFFER;
@@ -394,6 +397,39 @@ static void mhi_dev_rollback_compl_evt(struct mhi_dev_channel *ch)
 		ch->evt_buf_rp = ch->evt_buf_size - 1;
 }
 
+/*
+ * mhi_dev_evt_flush_thrshld() - Returns the completion event flush
+ * threshold of the channel, adapting it to the event rate seen in the
+ * last coalescing window.
+ *
+ * @ch -  channel the completion event is queued for
+ */
+static uint32_t mhi_dev_evt_flush_thrshld(struct mhi_dev_channel *ch)
+{
+	uint32_t max_thrshld, rate, elapsed;
+	unsigned long now = jiffies;
+
+	max_thrshld = max_t(uint32_t,
+			MHI_CMPL_EVT_FLUSH_THRSHLD(ch->evt_buf_size), 1);
+	ch->evt_window_cnt++;
+
+	if (!ch->evt_flush_thrshld) {
+		ch->evt_flush_thrshld = max_thrshld;
+		ch->evt_window_start = now;
+	} else if (time_after_eq(now, ch->evt_window_start +
+				msecs_to_jiffies(MHI_EVT_COAL_WINDOW_MS))) {
+		elapsed = max_t(uint32_t,
+				jiffies_to_msecs(now - ch->evt_window_start), 1);
+		rate = ch->evt_window_cnt * MHI_EVT_COAL_WINDOW_MS / elapsed;
+		ch->evt_flush_thrshld = clamp_t(uint32_t,
+				rate / MHI_EVT_COAL_FLUSHES, 1, max_thrshld);
+		ch->evt_window_cnt = 0;
+		ch->evt_window_start = now;
+	}
+
+	return ch->evt_flush_thrshld;
+}
+
 /*
  * mhi_dev_queue_transfer_completion() - Queues a transfer completion
  * event to the event buffer (where events are stored until they get
@@ -429,6 +465,7 @@ static int mhi_dev_queue_transfer_completion(struct mhi_req *mreq, bool *flush)
 		if (ch->evt_buf_rp == ch->evt_buf_size)
 			ch->evt_buf_rp = 0;
 		ch->curr_ereq->num_events++;
+		ch->stats.evt_count++;
 		/*
 		 * It is not necessary to flush when we need to wrap-around, if
 		 * we do have free space in the buffer upon wrap-around.
@@ -437,7 +474,8 @@ static int mhi_dev_queue_transfer_completion(struct mhi_req *mreq, bool *flush)
 		 * physical buffer end) since the buffer is circular. So we
 		 * might as well flush on wrap-around.
 		 * Also, we flush when we hit the threshold as well. The flush
-		 * threshold is based on the channel's event ring size.
+		 * threshold follows the channel's event rate, capped by its
+		 * event ring size.
 		 *
 		 * In summary, completion event buffer flush is done if
 		 *    * Client requests it (snd_cmpl was set to 1) OR
@@ -452,7 +490,7 @@ static int mhi_dev_queue_transfer_completion(struct mhi_req *mreq, bool *flush)
 		 */
 		if (ch->evt_buf_rp == 0 ||
 			ch->curr_ereq->num_events >=
-			MHI_CMPL_EVT_FLUSH_THRSHLD(ch->evt_buf_size)
+			mhi_dev_evt_flush_thrshld(ch)
 			|| mreq->snd_cmpl) {
 			if (flush)
 				*flush = true;
@@ -514,6 +552,7 @@ int mhi_transfer_host_to_device(void *dev, uint64_t host_pa, uint32_t len,
 	mhi_log(MHI_MSG_VERBOSE, "device 0x%llx <-- host 0x%llx, size %d\n",
 		(uint64_t) mhi->read_dma_handle, host_addr_pa, (int) len);
 
+	ch = mreq->client->channel;
 	if (mreq->mode == IPA_DMA_SYNC) {
 		rc = ipa_dma_sync_memcpy((u64) mhi->read_dma_handle,
 				host_addr_pa, (int) len);
@@ -522,8 +561,9 @@ int mhi_transfer_host_to_device(void *dev, uint64_t host_pa, uint32_t len,
 			return rc;
 		}
 		memcpy(dev, mhi->read_handle, len);
+		ch->stats.dma_count++;
+		ch->stats.dma_bytes += len;
 	} else if (mreq->mode == IPA_DMA_ASYNC) {
-		ch = mreq->client->channel;
 		ring = ch->ring;
 		mreq->dma = dma_map_single(&mhi->pdev->dev, dev, len,
 				DMA_FROM_DEVICE);
@@ -556,6 +596,8 @@ int mhi_transfer_host_to_device(void *dev, uint64_t host_pa, uint32_t len,
 							len, DMA_FROM_DEVICE);
 			return rc;
 		}
+		ch->stats.dma_count++;
+		ch->stats.dma_bytes += len;
 	}
 	return rc;
 }
@@ -587,12 +629,16 @@ int mhi_transfer_device_to_host(uint64_t host_addr, void *dev, uint32_t len,
 				(uint64_t) mhi->write_dma_handle,
 				host_addr_pa, (int) len);
 
+	ch = req->client->channel;
 	if (req->mode == IPA_DMA_SYNC) {
 		memcpy(mhi->write_handle, dev, len);
 		rc = ipa_dma_sync_memcpy(host_addr_pa,
 				(u64) mhi->write_dma_handle, (int) len);
+		if (!rc) {
+			ch->stats.dma_count++;
+			ch->stats.dma_bytes += len;
+		}
 	} else if (req->mode == IPA_DMA_ASYNC) {
-		ch = req->client->channel;
 		req->dma = dma_map_single(&mhi->pdev->dev, req->buf,
 				req->len, DMA_TO_DEVICE);
 
@@ -621,6 +667,8 @@ int mhi_transfer_device_to_host(uint64_t host_addr, void *dev, uint32_t len,
 				req->len, DMA_TO_DEVICE);
 			return rc;
 		}
+		ch->stats.dma_count++;
+		ch->stats.dma_bytes += len;
 		if (snd_cmpl || flush) {
 			rc = mhi_dev_flush_transfer_completion_events(mhi, ch);
 			if (rc) {
@@ -1039,6 +1087,10 @@ static int mhi_dev_send_completion_event(struct mhi_dev_channel *ch,
 
 	rc = mhi_dev_send_event(mhi,
 			mhi->ch_ctx_cache[ch->ch_id].err_indx, &compl_event);
+	if (!rc) {
+		ch->stats.evt_count++;
+		ch->stats.evt_flush_count++;
+	}
 
 	return rc;
 }
@@ -1251,6 +1303,7 @@ static void mhi_dev_process_cmd_ring(struct mhi_dev *mhi,
 		mhi->ch[ch_id].ch_id = ch_id;
 		mhi->ch[ch_id].ring = &mhi->ring[mhi->ch_ring_start + ch_id];
 		mhi->ch[ch_id].ch_type = mhi->ch_ctx_cache[ch_id].ch_type;
+		mhi->ch[ch_id].evt_flush_thrshld = 0;
 
 		/* enable DB for event ring */
 		rc = mhi_dev_mmio_enable_chdb_a7(mhi, ch_id);
@@ -3488,6 +3541,83 @@ static void mhi_dev_pcie_handle_event(struct work_struct *work)
 	}
 }
 
+#ifdef CONFIG_DEBUG_FS
+#define MHI_DEV_MAX_MSG_LEN 8192
+static struct dentry *mhi_dev_dent;
+
+static ssize_t mhi_dev_ch_stats_read(struct file *file, char __user *ubuf,
+				size_t count, loff_t *ppos)
+{
+	struct mhi_dev_channel *ch;
+	char *buf;
+	int nbytes = 0, i;
+	ssize_t ret;
+
+	buf = kzalloc(MHI_DEV_MAX_MSG_LEN, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	if (!mhi_ctx || !mhi_ctx->ch) {
+		nbytes = scnprintf(buf, MHI_DEV_MAX_MSG_LEN,
+				"Not initialized\n");
+		goto done;
+	}
+
+	nbytes += scnprintf(buf + nbytes, MHI_DEV_MAX_MSG_LEN - nbytes,
+		"%4s %10s %14s %10s %10s %8s\n", "ch", "dma", "dma bytes",
+		"events", "flushes", "thrshld");
+	for (i = 0; i < mhi_ctx->cfg.channels; i++) {
+		ch = &mhi_ctx->ch[i];
+		if (!ch->stats.dma_count && !ch->stats.evt_count)
+			continue;
+		nbytes += scnprintf(buf + nbytes,
+			MHI_DEV_MAX_MSG_LEN - nbytes,
+			"%4d %10llu %14llu %10llu %10llu %8u\n", i,
+			ch->stats.dma_count, ch->stats.dma_bytes,
+			ch->stats.evt_count, ch->stats.evt_flush_count,
+			ch->evt_flush_thrshld);
+	}
+
+done:
+	ret = simple_read_from_buffer(ubuf, count, ppos, buf, nbytes);
+	kfree(buf);
+	return ret;
+}
+
+static const struct file_operations mhi_dev_ch_stats_ops = {
+	.read = mhi_dev_ch_stats_read,
+};
+
+static void mhi_dev_debugfs_init(void)
+{
+	struct dentry *dfile;
+
+	mhi_dev_dent = debugfs_create_dir("mhi_dev", 0);
+	if (IS_ERR_OR_NULL(mhi_dev_dent)) {
+		pr_err("fail to create folder mhi_dev\n");
+		mhi_dev_dent = NULL;
+		return;
+	}
+
+	dfile = debugfs_create_file("ch_stats", 0444, mhi_dev_dent,
+			0, &mhi_dev_ch_stats_ops);
+	if (IS_ERR_OR_NULL(dfile)) {
+		pr_err("fail to create file ch_stats\n");
+		debugfs_remove_recursive(mhi_dev_dent);
+		mhi_dev_dent = NULL;
+	}
+}
+
+static void mhi_dev_debugfs_destroy(void)
+{
+	debugfs_remove_recursive(mhi_dev_dent);
+	mhi_dev_dent = NULL;
+}
+#else
+static inline void mhi_dev_debugfs_init(void) {}
+static inline void mhi_dev_debugfs_destroy(void) {}
+#endif /*CONFIG_DEBUG_FS*/
+
 static int mhi_dev_probe(struct platform_device *pdev)
 {
 	int rc = 0;
@@ -3514,6 +3644,7 @@ static int mhi_dev_probe(struct platform_device *pdev)
 
 		mhi_uci_init();
 		mhi_update_state_info(MHI_STATE_CONFIGURED);
+		mhi_dev_debugfs_init();
 	}
 
 	INIT_WORK(&mhi_ctx->pcie_event, mhi_dev_pcie_handle_event);
@@ -3554,6 +3685,7 @@ static int mhi_dev_probe(struct platform_device *pdev)
 
 static int mhi_dev_remove(struct platform_device *pdev)
 {
+	mhi_dev_debugfs_destroy();
 	platform_set_drvdata(pdev, NULL);
 
 	return 0;
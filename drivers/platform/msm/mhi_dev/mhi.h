@@ -284,6 +284,15 @@ struct mhi_config {
 /* Set flush threshold to 80% of event buf size */
 #define MHI_CMPL_EVT_FLUSH_THRSHLD(n) ((n * 8) / 10)
 
+/*
+ * The completion event flush threshold of a channel is re-evaluated every
+ * coalescing window from the number of events queued in it, aiming for
+ * MHI_EVT_COAL_FLUSHES flushes per window. A slow channel flushes every
+ * event and a busy one coalesces up to MHI_CMPL_EVT_FLUSH_THRSHLD.
+ */
+#define MHI_EVT_COAL_WINDOW_MS		10
+#define MHI_EVT_COAL_FLUSHES		4
+
 /* Possible ring element types */
 union mhi_dev_ring_element_type {
 	struct mhi_dev_cmd_ring_op			cmd_no_op;
@@ -436,6 +445,14 @@ struct event_req {
 	struct list_head	list;
 };
 
+/* Per channel counters, viewable using debugfs */
+struct mhi_dev_channel_stats {
+	u64				dma_count;
+	u64				dma_bytes;
+	u64				evt_count;
+	u64				evt_flush_count;
+};
+
 struct mhi_dev_channel {
 	struct list_head		list;
 	struct list_head		clients;
@@ -479,6 +496,11 @@ struct mhi_dev_channel {
 	uint32_t			td_size;
 	uint32_t			pend_wr_count;
 	bool				skip_td;
+	/* Adaptive completion event coalescing */
+	uint32_t			evt_flush_thrshld;
+	uint32_t			evt_window_cnt;
+	unsigned long			evt_window_start;
+	struct mhi_dev_channel_stats	stats;
 };
 
 /* Structure device for mhi dev */
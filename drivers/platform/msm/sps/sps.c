@@ -2393,6 +2393,72 @@ int sps_get_iovec(struct sps_pipe *h, struct sps_iovec *iovec)
 }
 EXPORT_SYMBOL(sps_get_iovec);
 
+/**
+ * Get a batch of processed I/O vectors (completed transfers)
+ *
+ */
+int sps_get_iovecs(struct sps_pipe *h, struct sps_iovec *iovec, u32 max_cnt,
+		   u32 *cnt)
+{
+	struct sps_pipe *pipe = h;
+	struct sps_bam *bam;
+	int result;
+
+	if (h == NULL) {
+		SPS_ERR(sps, "sps:%s:pipe is NULL.\n", __func__);
+		return SPS_ERROR;
+	} else if (iovec == NULL || cnt == NULL) {
+		SPS_ERR(sps, "sps:%s:iovec or cnt pointer is NULL.\n",
+			__func__);
+		return SPS_ERROR;
+	}
+
+	bam = sps_bam_lock(pipe);
+	if (bam == NULL) {
+		SPS_ERR(sps, "sps:%s:BAM is not found by handle.\n", __func__);
+		return SPS_ERROR;
+	}
+
+	SPS_DBG(bam, "sps:%s; BAM: %pa; pipe index:%d; max:%d.\n",
+		__func__, BAM_ID(bam), pipe->pipe_index, max_cnt);
+
+	result = sps_bam_pipe_get_iovecs(bam, pipe->pipe_index, iovec,
+					 max_cnt, cnt);
+	sps_bam_unlock(bam);
+
+	return result;
+}
+EXPORT_SYMBOL(sps_get_iovecs);
+
+/**
+ * Configure interrupt moderation of a pipe
+ *
+ */
+int sps_set_irq_moderation(struct sps_pipe *h, u32 desc_cnt, u32 usec)
+{
+	struct sps_pipe *pipe = h;
+	struct sps_bam *bam;
+	int result;
+
+	if (h == NULL) {
+		SPS_ERR(sps, "sps:%s:pipe is NULL.\n", __func__);
+		return SPS_ERROR;
+	}
+
+	bam = sps_bam_lock(pipe);
+	if (bam == NULL) {
+		SPS_ERR(sps, "sps:%s:BAM is not found by handle.\n", __func__);
+		return SPS_ERROR;
+	}
+
+	result = sps_bam_pipe_set_irq_mod(bam, pipe->pipe_index, desc_cnt,
+					  usec);
+	sps_bam_unlock(bam);
+
+	return result;
+}
+EXPORT_SYMBOL(sps_set_irq_moderation);
+
 /**
  * Perform timer control
  *
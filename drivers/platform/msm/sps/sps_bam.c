@@ -93,6 +93,9 @@ static void pipe_handler(struct sps_bam *dev,
 static void pipe_handler_eot(struct sps_bam *dev,
 			   struct sps_pipe *pipe);
 
+/* Interrupt moderation timer handler */
+static enum hrtimer_restart pipe_irq_mod_timer_fn(struct hrtimer *timer);
+
 /**
  * BAM driver initialization
  */
@@ -693,6 +696,10 @@ static void pipe_clear(struct sps_pipe *pipe)
 	pipe->desc_size = 0;
 	pipe->disconnecting = false;
 	pipe->late_eot = false;
+	pipe->irq_mod_cnt = 0;
+	pipe->irq_mod_usec = 0;
+	pipe->irq_mod_armed = false;
+	pipe->irq_mod_deferred = 0;
 	memset(&pipe->sys, 0, sizeof(pipe->sys));
 	INIT_LIST_HEAD(&pipe->sys.events_q);
 }
@@ -827,6 +834,9 @@ int sps_bam_pipe_connect(struct sps_pipe *bam_pipe,
 	/* Clear the client pipe state and hw init struct */
 	pipe_clear(bam_pipe);
 	memset(&hw_params, 0, sizeof(hw_params));
+	hrtimer_init(&bam_pipe->irq_mod_timer, CLOCK_MONOTONIC,
+		     HRTIMER_MODE_REL);
+	bam_pipe->irq_mod_timer.function = pipe_irq_mod_timer_fn;
 
 	/* Initialize the BAM state struct */
 	bam_pipe->mode = params->mode;
@@ -1105,6 +1115,7 @@ int sps_bam_pipe_disconnect(struct sps_bam *dev, u32 pipe_index)
 	/* Deallocate and reset the BAM pipe */
 	pipe = dev->pipes[pipe_index];
 	if (BAM_PIPE_IS_ASSIGNED(pipe)) {
+		hrtimer_cancel(&pipe->irq_mod_timer);
 		if ((dev->pipe_active_mask & (1UL << pipe_index))) {
 			spin_lock_irqsave(&dev->isr_lock, flags);
 			list_del(&pipe->list);
@@ -2022,6 +2033,130 @@ static void pipe_handler_eot(struct sps_bam *dev, struct sps_pipe *pipe)
 	pipe->sys.handler_eot = false;
 }
 
+/**
+ * Count the completed descriptors not yet processed by software
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe - pointer to pipe state
+ *
+ * @return number of completed descriptors
+ */
+static u32 pipe_completed_descs(struct sps_bam *dev, struct sps_pipe *pipe)
+{
+	u32 end_offset;
+	u32 offset;
+
+	end_offset = bam_pipe_get_desc_read_offset(&dev->base,
+						   pipe->pipe_index);
+	if (pipe->sys.ack_xfers && !pipe->sys.no_queue)
+		offset = pipe->sys.cache_offset;
+	else
+		offset = pipe->sys.acked_offset;
+
+	if (end_offset < offset)
+		end_offset += pipe->desc_size;
+
+	return (end_offset - offset) / sizeof(struct sps_iovec);
+}
+
+/**
+ * Service a BAM pipe's EOT/descriptor done sources
+ *
+ * The caller of this function must lock the BAM device's isr_lock.
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe - pointer to pipe state
+ *
+ * @event_id - event generated for pipes with no queue
+ *
+ */
+static void pipe_handler_xfer(struct sps_bam *dev, struct sps_pipe *pipe,
+			      enum sps_event event_id)
+{
+	pipe_handler_eot(dev, pipe);
+	if (pipe->sys.no_queue)
+		/*
+		 * EOT handler will not generate any event if there
+		 * is no queue,
+		 * so generate "empty" (no descriptor) event
+		 */
+		pipe_handler_generic(dev, pipe, event_id);
+}
+
+/**
+ * BAM pipe interrupt moderation timer
+ *
+ * Services the descriptors which completed while the pipe's interrupt was
+ * held off and unmasks the interrupt again.
+ *
+ * @timer - moderation timer of the pipe
+ *
+ * @return HRTIMER_NORESTART
+ */
+static enum hrtimer_restart pipe_irq_mod_timer_fn(struct hrtimer *timer)
+{
+	struct sps_pipe *pipe = container_of(timer, struct sps_pipe,
+					     irq_mod_timer);
+	struct sps_bam *dev = pipe->bam;
+	unsigned long flags;
+
+	spin_lock_irqsave(&dev->isr_lock, flags);
+	if (pipe->irq_mod_armed && !pipe->disconnecting) {
+		pipe->irq_mod_armed = false;
+		pipe_handler_xfer(dev, pipe,
+				  (pipe->irq_mask & SPS_O_EOT) ?
+				  SPS_EVENT_EOT : SPS_EVENT_DESC_DONE);
+		if (pipe->state & BAM_STATE_IRQ)
+			bam_pipe_set_irq(&dev->base, pipe->pipe_index,
+					 BAM_ENABLE, pipe->irq_mask,
+					 dev->props.ee);
+	}
+	spin_unlock_irqrestore(&dev->isr_lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
+/**
+ * Hold off a BAM pipe's interrupt to batch completions
+ *
+ * The pipe's interrupt is masked and the descriptors completed so far are
+ * left for the moderation timer, unless enough of them are already pending.
+ * The caller of this function must lock the BAM device's isr_lock.
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe - pointer to pipe state
+ *
+ * @return true if the completions were deferred
+ */
+static bool pipe_irq_mod_defer(struct sps_bam *dev, struct sps_pipe *pipe)
+{
+	u32 pending;
+
+	if (!pipe->irq_mod_usec ||
+	    (pipe->state & (BAM_STATE_BAM2BAM | BAM_STATE_MTI)))
+		return false;
+
+	if (pipe->irq_mod_armed)
+		return true;
+
+	pending = pipe_completed_descs(dev, pipe);
+	if (!pending || (pipe->irq_mod_cnt && pending >= pipe->irq_mod_cnt))
+		return false;
+
+	bam_pipe_set_irq(&dev->base, pipe->pipe_index, BAM_DISABLE,
+			 pipe->irq_mask, dev->props.ee);
+	pipe->irq_mod_armed = true;
+	pipe->irq_mod_deferred++;
+	hrtimer_start(&pipe->irq_mod_timer,
+		      ns_to_ktime((u64)pipe->irq_mod_usec * NSEC_PER_USEC),
+		      HRTIMER_MODE_REL);
+
+	return true;
+}
+
 /**
  * Handle a BAM pipe's interrupt sources
  *
@@ -2061,19 +2196,13 @@ static void pipe_handler(struct sps_bam *dev, struct sps_pipe *pipe)
 
 	if ((status & (SPS_O_EOT | SPS_O_DESC_DONE)) &&
 	    (pipe->state & BAM_STATE_BAM2BAM) == 0) {
-		pipe_handler_eot(dev, pipe);
-		if (pipe->sys.no_queue) {
-			/*
-			 * EOT handler will not generate any event if there
-			 * is no queue,
-			 * so generate "empty" (no descriptor) event
-			 */
+		if (!pipe_irq_mod_defer(dev, pipe)) {
 			if ((status & SPS_O_EOT))
 				event_id = SPS_EVENT_EOT;
 			else
 				event_id = SPS_EVENT_DESC_DONE;
 
-			pipe_handler_generic(dev, pipe, event_id);
+			pipe_handler_xfer(dev, pipe, event_id);
 		}
 		status &= ~(SPS_O_EOT | SPS_O_DESC_DONE);
 		if (status == 0)
@@ -2186,31 +2315,17 @@ int sps_bam_pipe_get_event(struct sps_bam *dev,
 }
 
 /**
- * Get processed I/O vector
+ * Fetch the next processed I/O vector of a pipe
+ *
+ * @return true if an I/O vector was fetched, false if there are none left
  */
-int sps_bam_pipe_get_iovec(struct sps_bam *dev, u32 pipe_index,
-			   struct sps_iovec *iovec)
+static bool pipe_fetch_iovec(struct sps_bam *dev, struct sps_pipe *pipe,
+			     struct sps_iovec *iovec)
 {
-	struct sps_pipe *pipe = dev->pipes[pipe_index];
+	u32 pipe_index = pipe->pipe_index;
 	struct sps_iovec *desc;
 	u32 read_offset;
 
-	/* Is this a valid pipe configured for get_iovec use? */
-	if (!pipe->sys.ack_xfers ||
-	    (pipe->state & BAM_STATE_BAM2BAM) != 0 ||
-	    (pipe->state & BAM_STATE_REMOTE)) {
-		return SPS_ERROR;
-	}
-
-	/* If pipe is polled and queue is enabled, perform polling operation */
-	if ((pipe->polled || pipe->hybrid) && !pipe->sys.no_queue) {
-		SPS_DBG(dev,
-			"sps:%s; BAM: %pa; pipe index:%d; polled is %d; hybrid is %d.\n",
-			__func__, BAM_ID(dev), pipe_index,
-			pipe->polled, pipe->hybrid);
-		pipe_handler_eot(dev, pipe);
-	}
-
 	/* Is there a completed descriptor? */
 	if (pipe->sys.no_queue)
 		read_offset =
@@ -2224,7 +2339,7 @@ int sps_bam_pipe_get_iovec(struct sps_bam *dev, u32 pipe_index,
 		SPS_DBG(dev,
 			"sps:%s; BAM: %pa; pipe index:%d; no iovec to process.\n",
 			__func__, BAM_ID(dev), pipe_index);
-		return 0;
+		return false;
 	}
 
 	/* Fetch next descriptor */
@@ -2245,6 +2360,103 @@ int sps_bam_pipe_get_iovec(struct sps_bam *dev, u32 pipe_index,
 		__func__, pipe->pipe_index, (void *)(long)desc->addr,
 		desc->size, desc->flags, pipe->sys.acked_offset);
 
+	return true;
+}
+
+/**
+ * Validate a pipe for get_iovec use and poll it for completed descriptors
+ */
+static int pipe_poll_iovecs(struct sps_bam *dev, struct sps_pipe *pipe)
+{
+	/* Is this a valid pipe configured for get_iovec use? */
+	if (!pipe->sys.ack_xfers ||
+	    (pipe->state & BAM_STATE_BAM2BAM) != 0 ||
+	    (pipe->state & BAM_STATE_REMOTE)) {
+		return SPS_ERROR;
+	}
+
+	/* If pipe is polled and queue is enabled, perform polling operation */
+	if ((pipe->polled || pipe->hybrid) && !pipe->sys.no_queue) {
+		SPS_DBG(dev,
+			"sps:%s; BAM: %pa; pipe index:%d; polled is %d; hybrid is %d.\n",
+			__func__, BAM_ID(dev), pipe->pipe_index,
+			pipe->polled, pipe->hybrid);
+		pipe_handler_eot(dev, pipe);
+	}
+
+	return 0;
+}
+
+/**
+ * Get processed I/O vector
+ */
+int sps_bam_pipe_get_iovec(struct sps_bam *dev, u32 pipe_index,
+			   struct sps_iovec *iovec)
+{
+	struct sps_pipe *pipe = dev->pipes[pipe_index];
+	int result;
+
+	result = pipe_poll_iovecs(dev, pipe);
+	if (result)
+		return result;
+
+	pipe_fetch_iovec(dev, pipe, iovec);
+
+	return 0;
+}
+
+/**
+ * Get a batch of processed I/O vectors
+ */
+int sps_bam_pipe_get_iovecs(struct sps_bam *dev, u32 pipe_index,
+			    struct sps_iovec *iovec, u32 max_cnt, u32 *cnt)
+{
+	struct sps_pipe *pipe = dev->pipes[pipe_index];
+	int result;
+	u32 n;
+
+	*cnt = 0;
+	result = pipe_poll_iovecs(dev, pipe);
+	if (result)
+		return result;
+
+	for (n = 0; n < max_cnt; n++)
+		if (!pipe_fetch_iovec(dev, pipe, &iovec[n]))
+			break;
+
+	*cnt = n;
+
+	return 0;
+}
+
+/**
+ * Set BAM pipe interrupt moderation
+ */
+int sps_bam_pipe_set_irq_mod(struct sps_bam *dev, u32 pipe_index,
+			     u32 desc_cnt, u32 usec)
+{
+	struct sps_pipe *pipe = dev->pipes[pipe_index];
+	unsigned long flags;
+
+	if ((pipe->state & (BAM_STATE_BAM2BAM | BAM_STATE_MTI)) && usec) {
+		SPS_ERR(dev,
+			"sps:IRQ moderation is not supported: BAM %pa pipe %d\n",
+			BAM_ID(dev), pipe_index);
+		return SPS_ERROR;
+	}
+
+	/*
+	 * An armed timer keeps running; it unmasks the interrupt when it
+	 * expires, so disabling moderation here never loses completions.
+	 */
+	spin_lock_irqsave(&dev->isr_lock, flags);
+	pipe->irq_mod_cnt = desc_cnt;
+	pipe->irq_mod_usec = usec;
+	spin_unlock_irqrestore(&dev->isr_lock, flags);
+
+	SPS_DBG2(dev, "sps:BAM %pa pipe %d irq moderation cnt:%d usec:%d\n",
+		BAM_ID(dev), pipe_index, desc_cnt, usec);
+
 	return 0;
 }
 
@@ -20,6 +20,7 @@
 
 #include <linux/types.h>
 #include <linux/completion.h>
+#include <linux/hrtimer.h>
 #include <linux/list.h>
 #include <linux/mutex.h>
 #include <linux/spinlock.h>
@@ -186,6 +187,13 @@ struct sps_pipe {
 	u32 desc_size; /* Size (bytes) of descriptor FIFO */
 	int wake_up_is_one_shot; /* Whether WAKEUP event is a one-shot or not */
 
+	/* Interrupt moderation */
+	u32 irq_mod_cnt;	/* Completed descriptors to service at once */
+	u32 irq_mod_usec;	/* Maximal interrupt holdoff, 0 disables */
+	bool irq_mod_armed;
+	struct hrtimer irq_mod_timer;
+	u32 irq_mod_deferred;
+
 	/* System mode control */
 	struct sps_bam_sys_mode sys;
 
@@ -495,6 +503,47 @@ int sps_bam_pipe_get_event(struct sps_bam *dev, u32 pipe_index,
 int sps_bam_pipe_get_iovec(struct sps_bam *dev, u32 pipe_index,
 			   struct sps_iovec *iovec);
 
+/**
+ * Get a batch of processed I/O vectors
+ *
+ * This function fetches up to max_cnt processed I/O vectors, polling the
+ * pipe for completed descriptors only once.
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe_index - pipe index
+ *
+ * @iovec - Array of at least max_cnt I/O vector structs (output)
+ *
+ * @max_cnt - Maximal number of I/O vectors to fetch
+ *
+ * @cnt - Number of I/O vectors fetched (output)
+ *
+ * @return 0 on success, negative value on error
+ */
+int sps_bam_pipe_get_iovecs(struct sps_bam *dev, u32 pipe_index,
+			    struct sps_iovec *iovec, u32 max_cnt, u32 *cnt);
+
+/**
+ * Set BAM pipe interrupt moderation
+ *
+ * This function configures how long a pipe's EOT/descriptor done interrupt
+ * may be held off to batch completions.
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe_index - pipe index
+ *
+ * @desc_cnt - Number of completed descriptors which are serviced right
+ *   away. 0 means always hold off for usec.
+ *
+ * @usec - Maximal interrupt holdoff in microseconds. 0 disables moderation.
+ *
+ * @return 0 on success, negative value on error
+ */
+int sps_bam_pipe_set_irq_mod(struct sps_bam *dev, u32 pipe_index,
+			     u32 desc_cnt, u32 usec);
+
 /**
  * Determine whether a BAM pipe descriptor FIFO is empty
  *
@@ -0,0 +1,197 @@
+/* Copyright (c) 2018 The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/jiffies.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/timer.h>
+#include "batt-tick.h"
+
+/*
+ * The charger, fuel gauge and step/JEITA code each recheck the battery
+ * every few seconds. Their due times are rounded to whole seconds and a
+ * client due within BATT_TICK_SLACK_MS of a tick runs with it, so they
+ * share one wakeup. The tick itself is deferrable and only fires with
+ * the CPU already awake; BATT_TICK_MAX_DEFER_MS bounds how late that can
+ * make a client, since step and JEITA checks must not stall indefinitely.
+ */
+#define BATT_TICK_SLACK_MS	1000
+#define BATT_TICK_MAX_DEFER_MS	5000
+
+static LIST_HEAD(batt_tick_clients);
+static DEFINE_SPINLOCK(batt_tick_lock);
+static u64 batt_tick_wakeups;
+static struct dentry *batt_tick_debugfs;
+
+static void batt_tick_fn(struct work_struct *work);
+static DECLARE_DEFERRABLE_WORK(batt_tick_work, batt_tick_fn);
+static void batt_tick_backstop_fn(unsigned long data);
+static DEFINE_TIMER(batt_tick_backstop, batt_tick_backstop_fn, 0, 0);
+
+/* Must be called with batt_tick_lock held */
+static void batt_tick_arm(void)
+{
+	struct batt_tick_client *client;
+	unsigned long next = 0, now = jiffies;
+	bool found = false;
+
+	list_for_each_entry(client, &batt_tick_clients, node) {
+		if (!client->pending)
+			continue;
+		if (!found || time_before(client->due, next))
+			next = client->due;
+		found = true;
+	}
+
+	if (!found) {
+		cancel_delayed_work(&batt_tick_work);
+		del_timer(&batt_tick_backstop);
+		return;
+	}
+
+	mod_delayed_work(system_power_efficient_wq, &batt_tick_work,
+			time_after(next, now) ? next - now : 0);
+	mod_timer(&batt_tick_backstop,
+			next + msecs_to_jiffies(BATT_TICK_MAX_DEFER_MS));
+}
+
+static void batt_tick_fn(struct work_struct *work)
+{
+	struct batt_tick_client *client;
+	unsigned long horizon = jiffies + msecs_to_jiffies(BATT_TICK_SLACK_MS);
+	int count = 0;
+
+	spin_lock_irq(&batt_tick_lock);
+	list_for_each_entry(client, &batt_tick_clients, node)
+		if (client->pending && time_before_eq(client->due, horizon))
+			count++;
+
+	if (count)
+		batt_tick_wakeups++;
+
+	list_for_each_entry(client, &batt_tick_clients, node) {
+		if (!client->pending || time_after(client->due, horizon))
+			continue;
+		client->pending = false;
+		client->runs++;
+		if (count > 1)
+			client->shared++;
+		schedule_delayed_work(client->work, 0);
+	}
+
+	batt_tick_arm();
+	spin_unlock_irq(&batt_tick_lock);
+}
+
+static void batt_tick_backstop_fn(unsigned long data)
+{
+	mod_delayed_work(system_power_efficient_wq, &batt_tick_work, 0);
+}
+
+/**
+ * batt_tick_schedule(): Queue a client's work after at least delay_ms
+ *
+ * @client:   The registered client
+ * @delay_ms: Minimum delay, rounded up to the shared tick
+ *
+ * Use it for periodic rechecks that can tolerate being aligned; work that
+ * must run now should still be queued directly.
+ */
+void batt_tick_schedule(struct batt_tick_client *client,
+			unsigned int delay_ms)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&batt_tick_lock, flags);
+	client->due = round_jiffies_up(jiffies + msecs_to_jiffies(delay_ms));
+	client->pending = true;
+	batt_tick_arm();
+	spin_unlock_irqrestore(&batt_tick_lock, flags);
+}
+
+void batt_tick_cancel(struct batt_tick_client *client)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&batt_tick_lock, flags);
+	client->pending = false;
+	batt_tick_arm();
+	spin_unlock_irqrestore(&batt_tick_lock, flags);
+}
+
+static int batt_tick_show(struct seq_file *m, void *v)
+{
+	struct batt_tick_client *client;
+
+	spin_lock_irq(&batt_tick_lock);
+	seq_printf(m, "wakeups: %llu\n", batt_tick_wakeups);
+	list_for_each_entry(client, &batt_tick_clients, node)
+		seq_printf(m, "%-16s runs: %llu shared: %llu\n", client->name,
+				client->runs, client->shared);
+	spin_unlock_irq(&batt_tick_lock);
+
+	return 0;
+}
+
+static int batt_tick_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, batt_tick_show, NULL);
+}
+
+static const struct file_operations batt_tick_fops = {
+	.open		= batt_tick_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+void batt_tick_register(struct batt_tick_client *client, const char *name,
+			struct delayed_work *work)
+{
+	unsigned long flags;
+
+	client->name = name;
+	client->work = work;
+	client->pending = false;
+	client->runs = 0;
+	client->shared = 0;
+
+	spin_lock_irqsave(&batt_tick_lock, flags);
+	list_add_tail(&client->node, &batt_tick_clients);
+	spin_unlock_irqrestore(&batt_tick_lock, flags);
+
+	if (!batt_tick_debugfs) {
+		batt_tick_debugfs = debugfs_create_file("batt_tick", 0444,
+					NULL, NULL, &batt_tick_fops);
+		if (IS_ERR(batt_tick_debugfs))
+			batt_tick_debugfs = NULL;
+	}
+}
+
+/* The caller still cancels its own work once it is unregistered */
+void batt_tick_unregister(struct batt_tick_client *client)
+{
+	unsigned long flags;
+	bool empty;
+
+	spin_lock_irqsave(&batt_tick_lock, flags);
+	list_del(&client->node);
+	batt_tick_arm();
+	empty = list_empty(&batt_tick_clients);
+	spin_unlock_irqrestore(&batt_tick_lock, flags);
+
+	if (empty) {
+		debugfs_remove(batt_tick_debugfs);
+		batt_tick_debugfs = NULL;
+	}
+}
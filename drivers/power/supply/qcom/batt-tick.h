@@ -0,0 +1,45 @@
+/* Copyright (c) 2018 The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __BATT_TICK_H
+#define __BATT_TICK_H
+#include <linux/list.h>
+#include <linux/workqueue.h>
+
+/**
+ * A periodic work queued from the shared battery management tick.
+ *
+ * @name:    Name shown in the wakeup statistics.
+ * @work:    Work queued on system_wq once the client is due.
+ * @due:     Jiffies at which the client is due, valid while @pending.
+ * @pending: True while the client waits for the tick.
+ * @runs:    Number of times @work was queued from the tick.
+ * @shared:  Number of those runs that shared the wakeup with another client.
+ * @node:    Entry in the list of registered clients.
+ */
+struct batt_tick_client {
+	const char		*name;
+	struct delayed_work	*work;
+	unsigned long		due;
+	bool			pending;
+	u64			runs;
+	u64			shared;
+	struct list_head	node;
+};
+
+void batt_tick_register(struct batt_tick_client *client, const char *name,
+			struct delayed_work *work);
+void batt_tick_unregister(struct batt_tick_client *client);
+void batt_tick_schedule(struct batt_tick_client *client,
+			unsigned int delay_ms);
+void batt_tick_cancel(struct batt_tick_client *client);
+#endif
@@ -1119,7 +1119,7 @@ static void ttf_work(struct work_struct *work)
 	}
 
 	/* recurse every 10 seconds */
-	schedule_delayed_work(&ttf->ttf_work, msecs_to_jiffies(ttf->period_ms));
+	batt_tick_schedule(&ttf->tick, ttf->period_ms);
 end_work:
 	ttf->awake_voter(ttf->data, false);
 	mutex_unlock(&ttf->lock);
@@ -1231,6 +1231,7 @@ void ttf_update(struct ttf *ttf, bool input_present)
 		delay_ms = 5000;
 
 	ttf->awake_voter(ttf->data, true);
+	batt_tick_cancel(&ttf->tick);
 	cancel_delayed_work_sync(&ttf->ttf_work);
 	mutex_lock(&ttf->lock);
 	ttf_circ_buf_clr(&ttf->ibatt);
@@ -1266,6 +1267,7 @@ int ttf_tte_init(struct ttf *ttf)
 
 	mutex_init(&ttf->lock);
 	INIT_DELAYED_WORK(&ttf->ttf_work, ttf_work);
+	batt_tick_register(&ttf->tick, "ttf", &ttf->ttf_work);
 
 	return 0;
 }
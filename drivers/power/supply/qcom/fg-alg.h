@@ -13,6 +13,8 @@
 #ifndef __FG_ALG_H__
 #define __FG_ALG_H__
 
+#include "batt-tick.h"
+
 #define BUCKET_COUNT		8
 #define BUCKET_SOC_PCT		(256 / BUCKET_COUNT)
 #define MAX_CC_STEPS		20
@@ -108,6 +110,7 @@ struct ttf {
 	int			period_ms;
 	s64			last_ms;
 	struct delayed_work	ttf_work;
+	struct batt_tick_client	tick;
 	int (*get_ttf_param)(void *data, enum ttf_param, int *val);
 	int (*awake_voter)(void *data, bool vote);
 };
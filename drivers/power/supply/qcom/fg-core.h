@@ -33,6 +33,7 @@
 #include <linux/types.h>
 #include <linux/uaccess.h>
 #include <linux/pmic-voter.h>
+#include "batt-tick.h"
 
 #define fg_dbg(chip, reason, fmt, ...)			\
 	do {							\
@@ -76,6 +77,7 @@
 #define NUM_PARTITIONS			3
 #define FG_SRAM_ADDRESS_MAX		255
 #define FG_SRAM_LEN			504
+#define FG_SRAM_SNAPSHOT_LEN		64
 #define PROFILE_LEN			224
 #define PROFILE_COMP_LEN		148
 #define BUCKET_COUNT			8
@@ -459,6 +461,11 @@ struct fg_chip {
 	struct ttf		ttf;
 	struct mutex		bus_lock;
 	struct mutex		sram_rw_lock;
+	/* SRAM words served from memory by fg_sram_read(), sram_rw_lock */
+	u8			snap_buf[FG_SRAM_SNAPSHOT_LEN];
+	u16			snap_addr;
+	int			snap_len;
+	int			snap_users;
 	struct mutex		charge_full_lock;
 	struct mutex		qnovo_esr_ctrl_lock;
 	spinlock_t		awake_lock;
@@ -512,6 +519,7 @@ struct fg_chip {
 	struct work_struct	status_change_work;
 	struct work_struct	esr_sw_work;
 	struct delayed_work	ttf_work;
+	struct batt_tick_client	ttf_tick;
 	struct delayed_work	sram_dump_work;
 	struct delayed_work	pl_enable_work;
 	struct work_struct	esr_filter_work;
@@ -552,6 +560,9 @@ extern int fg_sram_write(struct fg_chip *chip, u16 address, u8 offset,
 			u8 *val, int len, int flags);
 extern int fg_sram_read(struct fg_chip *chip, u16 address, u8 offset,
 			u8 *val, int len, int flags);
+extern int fg_sram_snapshot_begin(struct fg_chip *chip, u16 address,
+			int len);
+extern void fg_sram_snapshot_end(struct fg_chip *chip);
 extern int fg_sram_masked_write(struct fg_chip *chip, u16 address, u8 offset,
 			u8 mask, u8 val, int flags);
 extern int fg_interleaved_mem_read(struct fg_chip *chip, u16 address,
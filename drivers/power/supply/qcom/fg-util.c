@@ -330,6 +330,12 @@ int fg_sram_write(struct fg_chip *chip, u16 address, u8 offset,
 		pr_err("Error in writing SRAM address 0x%x[%d], rc=%d\n",
 			address, offset, rc);
 
+	/* Drop a snapshot the write overlaps, later reads go to SRAM */
+	if (chip->snap_len &&
+	    address * 4 + offset < chip->snap_addr * 4 + chip->snap_len &&
+	    chip->snap_addr * 4 < address * 4 + offset + len)
+		chip->snap_len = 0;
+
 out:
 	if (atomic_access)
 		disable_irq_nosync(chip->irqs[SOC_UPDATE_IRQ].irq);
@@ -359,6 +365,15 @@ int fg_sram_read(struct fg_chip *chip, u16 address, u8 offset,
 
 	mutex_lock(&chip->sram_rw_lock);
 
+	if (chip->snap_len && address >= chip->snap_addr &&
+	    (address - chip->snap_addr) * 4 + offset + len <= chip->snap_len) {
+		memcpy(val, &chip->snap_buf[(address - chip->snap_addr) * 4 +
+			offset], len);
+		fg_dbg(chip, FG_SRAM_READ, "address %d[%d] len %d from snapshot\n",
+			address, offset, len);
+		goto out;
+	}
+
 	if (chip->use_dma)
 		rc = fg_direct_mem_read(chip, address, offset, val, len);
 	else
@@ -368,12 +383,67 @@ int fg_sram_read(struct fg_chip *chip, u16 address, u8 offset,
 		pr_err("Error in reading SRAM address 0x%x[%d], rc=%d\n",
 			address, offset, rc);
 
+out:
 	mutex_unlock(&chip->sram_rw_lock);
 	if (!(flags & FG_IMA_NO_WLOCK))
 		vote(chip->awake_votable, SRAM_READ, false, 0);
 	return rc;
 }
 
+/*
+ * Read len bytes of SRAM starting at word address in one DMA or IMA burst
+ * transaction and serve fg_sram_read() calls that fall inside them from
+ * memory until the matching fg_sram_snapshot_end(). Calls nest; only the
+ * outermost one reads SRAM. A write overlapping the snapshot drops it.
+ * Must be paired with fg_sram_snapshot_end() whatever it returns; on
+ * failure reads simply keep going to SRAM.
+ */
+int fg_sram_snapshot_begin(struct fg_chip *chip, u16 address, int len)
+{
+	int rc = 0;
+
+	vote(chip->awake_votable, SRAM_READ, true, 0);
+	mutex_lock(&chip->sram_rw_lock);
+	if (chip->snap_users++)
+		goto out;
+
+	if (len > FG_SRAM_SNAPSHOT_LEN || !fg_sram_address_valid(address, len)) {
+		rc = -EINVAL;
+		goto out;
+	}
+
+	if (chip->battery_missing) {
+		rc = -ENODATA;
+		goto out;
+	}
+
+	if (chip->use_dma)
+		rc = fg_direct_mem_read(chip, address, 0, chip->snap_buf, len);
+	else
+		rc = fg_interleaved_mem_read(chip, address, 0, chip->snap_buf,
+				len);
+	if (rc < 0) {
+		pr_err("Error in reading SRAM snapshot 0x%x, rc=%d\n",
+			address, rc);
+		goto out;
+	}
+
+	chip->snap_addr = address;
+	chip->snap_len = len;
+out:
+	mutex_unlock(&chip->sram_rw_lock);
+	vote(chip->awake_votable, SRAM_READ, false, 0);
+	return rc;
+}
+
+void fg_sram_snapshot_end(struct fg_chip *chip)
+{
+	mutex_lock(&chip->sram_rw_lock);
+	if (chip->snap_users && !--chip->snap_users)
+		chip->snap_len = 0;
+	mutex_unlock(&chip->sram_rw_lock);
+}
+
 int fg_sram_masked_write(struct fg_chip *chip, u16 address, u8 offset,
 			u8 mask, u8 val, int flags)
 {
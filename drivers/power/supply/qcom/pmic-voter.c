@@ -37,6 +37,7 @@ struct votable {
 	const char		*name;
 	struct list_head	list;
 	struct client_vote	votes[NUM_MAX_CLIENTS];
+	unsigned long		enabled_mask;
 	int			num_clients;
 	int			type;
 	int			effective_client_id;
@@ -49,6 +50,8 @@ struct votable {
 						const char *effective_client);
 	char			*client_strs[NUM_MAX_CLIENTS];
 	bool			voted_on;
+	u64			num_votes;
+	u64			num_changes;
 	struct dentry		*root;
 	struct dentry		*status_ent;
 	u32			force_val;
@@ -74,14 +77,56 @@ struct votable {
 static void vote_set_any(struct votable *votable, int client_id,
 				int *eff_res, int *eff_id)
 {
-	int i;
+	*eff_res = !!votable->enabled_mask;
+	*eff_id = client_id;
+}
 
-	*eff_res = 0;
+/* sign is 1 for MAX and -1 for MIN */
+static inline bool vote_beats(int sign, int a, int b)
+{
+	return sign > 0 ? a > b : a < b;
+}
 
-	for (i = 0; i < votable->num_clients && votable->client_strs[i]; i++)
-		*eff_res |= votable->votes[i].enabled;
+/* Full election over the enabled clients, lowest client id wins a tie */
+static void vote_scan(struct votable *votable, int sign,
+				int *eff_res, int *eff_id)
+{
+	int i;
 
-	*eff_id = client_id;
+	*eff_res = -EINVAL;
+	*eff_id = -EINVAL;
+	for_each_set_bit(i, &votable->enabled_mask, votable->num_clients) {
+		if (*eff_id == -EINVAL ||
+			vote_beats(sign, votable->votes[i].value, *eff_res)) {
+			*eff_res = votable->votes[i].value;
+			*eff_id = i;
+		}
+	}
+}
+
+/*
+ * Only the latest vote changed, so the previous winner stands unless that
+ * vote beats it or the winner itself backed off; only the latter needs a
+ * full election.
+ */
+static void vote_extreme(struct votable *votable, int client_id, int sign,
+				int *eff_res, int *eff_id)
+{
+	struct client_vote *v = &votable->votes[client_id];
+	int cur_id = votable->effective_client_id;
+	int cur_res = votable->effective_result;
+
+	if (v->enabled && (cur_id == -EINVAL ||
+			vote_beats(sign, v->value, cur_res) ||
+			(v->value == cur_res && client_id < cur_id))) {
+		*eff_res = v->value;
+		*eff_id = client_id;
+	} else if (client_id == cur_id) {
+		vote_scan(votable, sign, eff_res, eff_id);
+	} else {
+		*eff_res = cur_res;
+		*eff_id = cur_id;
+	}
 }
 
 /**
@@ -89,7 +134,7 @@ static void vote_set_any(struct votable *votable, int client_id,
  * @votable:	votable object
  * @client_id:	client number of the latest voter
  * @eff_res:	sets this to the min. of all the values amongst enabled voters.
- *		If there is no enabled client, this is set to INT_MAX
+ *		If there is no enabled client, this is set to -EINVAL
  * @eff_id:	sets this to the client id that has the min value amongst all
  *		the enabled clients. If there is no enabled client, sets this
  *		to -EINVAL
@@ -100,19 +145,7 @@ static void vote_set_any(struct votable *votable, int client_id,
 static void vote_min(struct votable *votable, int client_id,
 				int *eff_res, int *eff_id)
 {
-	int i;
-
-	*eff_res = INT_MAX;
-	*eff_id = -EINVAL;
-	for (i = 0; i < votable->num_clients && votable->client_strs[i]; i++) {
-		if (votable->votes[i].enabled
-			&& *eff_res > votable->votes[i].value) {
-			*eff_res = votable->votes[i].value;
-			*eff_id = i;
-		}
-	}
-	if (*eff_id == -EINVAL)
-		*eff_res = -EINVAL;
+	vote_extreme(votable, client_id, -1, eff_res, eff_id);
 }
 
 /**
@@ -131,19 +164,7 @@ static void vote_min(struct votable *votable, int client_id,
 static void vote_max(struct votable *votable, int client_id,
 				int *eff_res, int *eff_id)
 {
-	int i;
-
-	*eff_res = INT_MIN;
-	*eff_id = -EINVAL;
-	for (i = 0; i < votable->num_clients && votable->client_strs[i]; i++) {
-		if (votable->votes[i].enabled &&
-				*eff_res < votable->votes[i].value) {
-			*eff_res = votable->votes[i].value;
-			*eff_id = i;
-		}
-	}
-	if (*eff_id == -EINVAL)
-		*eff_res = -EINVAL;
+	vote_extreme(votable, client_id, 1, eff_res, eff_id);
 }
 
 static int get_client_id(struct votable *votable, const char *client_str)
@@ -385,6 +406,11 @@ int vote(struct votable *votable, const char *client_str, bool enabled, int val)
 
 	votable->votes[client_id].enabled = enabled;
 	votable->votes[client_id].value = val;
+	if (enabled)
+		__set_bit(client_id, &votable->enabled_mask);
+	else
+		__clear_bit(client_id, &votable->enabled_mask);
+	votable->num_votes++;
 
 	if (similar_vote && votable->voted_on) {
 		pr_debug("%s: %s,%d Ignoring similar vote %s of val=%d\n",
@@ -408,7 +434,8 @@ int vote(struct votable *votable, const char *client_str, bool enabled, int val)
 				&effective_result, &effective_id);
 		break;
 	default:
-		return -EINVAL;
+		rc = -EINVAL;
+		goto out;
 	}
 
 	/*
@@ -419,6 +446,7 @@ int vote(struct votable *votable, const char *client_str, bool enabled, int val)
 			|| (effective_result != votable->effective_result)) {
 		votable->effective_client_id = effective_id;
 		votable->effective_result = effective_result;
+		votable->num_changes++;
 		pr_debug("%s: effective vote is now %d voted by %s,%d\n",
 			votable->name, effective_result,
 			get_client_str(votable, effective_id),
@@ -549,6 +577,9 @@ static int show_votable_clients(struct seq_file *m, void *data)
 			effective_client_str ? effective_client_str : "none",
 			type_str,
 			get_effective_result_locked(votable));
+	seq_printf(m, "%s: votes=%llu changes=%llu\n",
+			votable->name, votable->num_votes,
+			votable->num_changes);
 	unlock_votable(votable);
 
 	return 0;
@@ -373,6 +373,13 @@ static int qg_parse_battery_profile(struct qg_battery_data *battery)
 						be32_to_cpup(data++);
 		}
 
+		rc = profile_table_cache_init(&battery->profile[i]);
+		if (rc < 0) {
+			pr_err("Failed to set up lookups for table %s rc=%d\n",
+					table[i].table_name, rc);
+			goto cleanup;
+		}
+
 		pr_debug("Profile table %s parsed rows=%d cols=%d\n",
 			battery->profile[i].name, battery->profile[i].rows,
 			battery->profile[i].cols);
@@ -381,7 +388,8 @@ static int qg_parse_battery_profile(struct qg_battery_data *battery)
 	return 0;
 
 cleanup:
-	for (; i >= 0; i++) {
+	for (; i >= 0; i--) {
+		profile_table_cache_free(&battery->profile[i]);
 		kfree(battery->profile[i].name);
 		kfree(battery->profile[i].row_entries);
 		kfree(battery->profile[i].col_entries);
@@ -504,6 +512,7 @@ void qg_batterydata_exit(void)
 
 		/* delete all the battery profile memory */
 		for (i = 0; i < TABLE_MAX; i++) {
+			profile_table_cache_free(&the_battery->profile[i]);
 			kfree(the_battery->profile[i].name);
 			kfree(the_battery->profile[i].row_entries);
 			kfree(the_battery->profile[i].col_entries);
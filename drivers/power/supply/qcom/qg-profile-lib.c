@@ -13,6 +13,8 @@
 #include <linux/module.h>
 #include <linux/printk.h>
 #include <linux/ratelimit.h>
+#include <linux/slab.h>
+#include <linux/string.h>
 #include "qg-profile-lib.h"
 #include "qg-defs.h"
 
@@ -26,6 +28,190 @@ static int linear_interpolate(int y0, int x0, int y1, int x1, int x)
 	return y0 + ((y1 - y0) * (x - x0) / (x1 - x0));
 }
 
+/**
+ * profile_table_cache_init(): Prepare the lookup cache of a parsed table
+ *
+ * @lut: Table with its legends and data already filled in
+ *
+ * The temperature legend is scaled once here. If the legends or the data
+ * columns are non-increasing the row lookups bisect instead of scanning,
+ * and the rows interpolated at the last temperature are kept, since the
+ * battery temperature rarely moves between two lookups.
+ */
+int profile_table_cache_init(struct profile_table_data *lut)
+{
+	int i, j;
+
+	mutex_init(&lut->lock);
+	lut->col_temps = kcalloc(lut->cols, sizeof(*lut->col_temps),
+					GFP_KERNEL);
+	lut->temp_col = kcalloc(lut->rows, sizeof(*lut->temp_col),
+					GFP_KERNEL);
+	lut->temp_col_gen = kcalloc(lut->rows, sizeof(*lut->temp_col_gen),
+					GFP_KERNEL);
+	if (!lut->col_temps || !lut->temp_col || !lut->temp_col_gen) {
+		profile_table_cache_free(lut);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < lut->cols; i++)
+		lut->col_temps[i] = lut->col_entries[i] * DEGC_SCALE;
+
+	lut->rows_desc = !!lut->row_entries;
+	for (i = 1; lut->rows_desc && i < lut->rows; i++)
+		if (lut->row_entries[i] > lut->row_entries[i - 1])
+			lut->rows_desc = false;
+
+	lut->data_desc = true;
+	for (j = 0; j < lut->cols; j++)
+		for (i = 1; lut->data_desc && i < lut->rows; i++)
+			if (lut->data[i][j] > lut->data[i - 1][j])
+				lut->data_desc = false;
+
+	lut->temp_gen = 0;
+
+	return 0;
+}
+
+void profile_table_cache_free(struct profile_table_data *lut)
+{
+	kfree(lut->col_temps);
+	lut->col_temps = NULL;
+	kfree(lut->temp_col);
+	lut->temp_col = NULL;
+	kfree(lut->temp_col_gen);
+	lut->temp_col_gen = NULL;
+}
+
+/* First row whose legend entry is <= val, rows if there is none */
+static int lut_first_entry_le(struct profile_table_data *lut, int val)
+{
+	int lo = 0, hi = lut->rows, mid;
+
+	if (!lut->rows_desc) {
+		for (lo = 0; lo < lut->rows; lo++)
+			if (lut->row_entries[lo] <= val)
+				break;
+		return lo;
+	}
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (lut->row_entries[mid] <= val)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return lo;
+}
+
+/* First row whose entry in column col is <= val, rows if there is none */
+static int lut_first_row_le(struct profile_table_data *lut, int col, int val)
+{
+	int lo = 0, hi = lut->rows, mid;
+
+	if (!lut->data_desc) {
+		for (lo = 0; lo < lut->rows; lo++)
+			if (lut->data[lo][col] <= val)
+				break;
+		return lo;
+	}
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (lut->data[mid][col] <= val)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return lo;
+}
+
+/* First column at or above batt_temp, which is within the legend */
+static int lut_temp_index(struct profile_table_data *lut, int batt_temp)
+{
+	int i;
+
+	for (i = 0; i < lut->cols - 1; i++)
+		if (batt_temp <= lut->col_temps[i])
+			break;
+
+	return i;
+}
+
+/* Must be called with lut->lock held */
+static void lut_set_temp(struct profile_table_data *lut, int batt_temp)
+{
+	batt_temp = clamp(batt_temp, lut->col_temps[0],
+				lut->col_temps[lut->cols - 1]);
+	if (lut->temp_gen && batt_temp == lut->temp_key)
+		return;
+
+	lut->temp_key = batt_temp;
+	lut->temp_idx = lut_temp_index(lut, batt_temp);
+	if (++lut->temp_gen == 0) {
+		memset(lut->temp_col_gen, 0,
+			lut->rows * sizeof(*lut->temp_col_gen));
+		lut->temp_gen = 1;
+	}
+}
+
+/* Row interpolated at the temperature set by lut_set_temp() */
+static int lut_temp_row(struct profile_table_data *lut, int row)
+{
+	int i = lut->temp_idx;
+
+	if (lut->temp_col_gen[row] == lut->temp_gen)
+		return lut->temp_col[row];
+
+	if (lut->temp_key == lut->col_temps[i])
+		lut->temp_col[row] = lut->data[row][i];
+	else
+		lut->temp_col[row] = linear_interpolate(
+			lut->data[row][i - 1],
+			lut->col_temps[i - 1],
+			lut->data[row][i],
+			lut->col_temps[i],
+			lut->temp_key);
+	lut->temp_col_gen[row] = lut->temp_gen;
+
+	return lut->temp_col[row];
+}
+
+/*
+ * SOC at ocv from the first row pair of column col bracketing it, or 0 if
+ * there is none. Like the row scan this replaces, an interpolated 0 keeps
+ * looking further down the column.
+ */
+static int lut_soc_in_col(struct profile_table_data *lut, int col, int ocv)
+{
+	int i = 0, soc;
+
+	if (lut->data_desc) {
+		i = lut_first_row_le(lut, col, ocv);
+		if (i == lut->rows || (i == 0 && lut->data[0][col] != ocv))
+			return 0;
+		i = max(i - 1, 0);
+	}
+
+	for (; i < lut->rows - 1; i++) {
+		if (!is_between(lut->data[i][col], lut->data[i + 1][col], ocv))
+			continue;
+		soc = linear_interpolate(
+			lut->row_entries[i],
+			lut->data[i][col],
+			lut->row_entries[i + 1],
+			lut->data[i + 1][col],
+			ocv);
+		if (soc)
+			return soc;
+	}
+
+	return 0;
+}
+
 int interpolate_single_row_lut(struct profile_table_data *lut,
 						int x, int scale)
 {
@@ -66,43 +252,37 @@ int interpolate_single_row_lut(struct profile_table_data *lut,
 int interpolate_soc(struct profile_table_data *lut,
 				int batt_temp, int ocv)
 {
-	int i, j, soc_high, soc_low, soc;
+	int i, j, soc_high, soc_low;
 	int rows = lut->rows;
 	int cols = lut->cols;
 
-	if (batt_temp < lut->col_entries[0] * DEGC_SCALE) {
+	if (batt_temp < lut->col_temps[0]) {
 		pr_debug("batt_temp %d < known temp range\n", batt_temp);
-		batt_temp = lut->col_entries[0] * DEGC_SCALE;
+		batt_temp = lut->col_temps[0];
 	}
 
-	if (batt_temp > lut->col_entries[cols - 1] * DEGC_SCALE) {
+	if (batt_temp > lut->col_temps[cols - 1]) {
 		pr_debug("batt_temp %d > known temp range\n", batt_temp);
-		batt_temp = lut->col_entries[cols - 1] * DEGC_SCALE;
+		batt_temp = lut->col_temps[cols - 1];
 	}
 
-	for (j = 0; j < cols; j++)
-		if (batt_temp <= lut->col_entries[j] * DEGC_SCALE)
-			break;
+	j = lut_temp_index(lut, batt_temp);
 
-	if (batt_temp == lut->col_entries[j] * DEGC_SCALE) {
+	if (batt_temp == lut->col_temps[j]) {
 		/* found an exact match for temp in the table */
 		if (ocv >= lut->data[0][j])
 			return lut->row_entries[0];
 		if (ocv <= lut->data[rows - 1][j])
 			return lut->row_entries[rows - 1];
-		for (i = 0; i < rows; i++) {
-			if (ocv >= lut->data[i][j]) {
-				if (ocv == lut->data[i][j])
-					return lut->row_entries[i];
-				soc = linear_interpolate(
-					lut->row_entries[i],
-					lut->data[i][j],
-					lut->row_entries[i - 1],
-					lut->data[i - 1][j],
-					ocv);
-				return soc;
-			}
-		}
+		i = lut_first_row_le(lut, j, ocv);
+		if (ocv == lut->data[i][j])
+			return lut->row_entries[i];
+		return linear_interpolate(
+				lut->row_entries[i],
+				lut->data[i][j],
+				lut->row_entries[i - 1],
+				lut->data[i - 1][j],
+				ocv);
 	}
 
 	/* batt_temp is within temperature for column j-1 and j */
@@ -111,38 +291,16 @@ int interpolate_soc(struct profile_table_data *lut,
 	if (ocv <= lut->data[rows - 1][j - 1])
 		return lut->row_entries[rows - 1];
 
-	soc_low = soc_high = 0;
-	for (i = 0; i < rows-1; i++) {
-		if (soc_high == 0 && is_between(lut->data[i][j],
-				lut->data[i+1][j], ocv)) {
-			soc_high = linear_interpolate(
-				lut->row_entries[i],
-				lut->data[i][j],
-				lut->row_entries[i + 1],
-				lut->data[i+1][j],
-				ocv);
-		}
+	soc_high = lut_soc_in_col(lut, j, ocv);
+	soc_low = lut_soc_in_col(lut, j - 1, ocv);
 
-		if (soc_low == 0 && is_between(lut->data[i][j-1],
-				lut->data[i+1][j-1], ocv)) {
-			soc_low = linear_interpolate(
-				lut->row_entries[i],
-				lut->data[i][j-1],
-				lut->row_entries[i + 1],
-				lut->data[i+1][j-1],
-				ocv);
-		}
-
-		if (soc_high && soc_low) {
-			soc = linear_interpolate(
+	if (soc_high && soc_low)
+		return linear_interpolate(
 				soc_low,
-				lut->col_entries[j-1] * DEGC_SCALE,
+				lut->col_temps[j - 1],
 				soc_high,
-				lut->col_entries[j] * DEGC_SCALE,
+				lut->col_temps[j],
 				batt_temp);
-			return soc;
-		}
-	}
 
 	if (soc_high)
 		return soc_high;
@@ -158,12 +316,11 @@ int interpolate_soc(struct profile_table_data *lut,
 int interpolate_var(struct profile_table_data *lut,
 				int batt_temp, int soc)
 {
-	int i, var1, var2, var, rows, cols;
+	int i, var1, var2, rows;
 	int row1 = 0;
 	int row2 = 0;
 
 	rows = lut->rows;
-	cols = lut->cols;
 	if (soc > lut->row_entries[0]) {
 		pr_debug("soc %d greater than known soc ranges for %s lut\n",
 							soc, lut->name);
@@ -175,73 +332,33 @@ int interpolate_var(struct profile_table_data *lut,
 		row1 = rows - 1;
 		row2 = rows - 1;
 	} else {
-		for (i = 0; i < rows; i++) {
-			if (soc == lut->row_entries[i]) {
-				row1 = i;
-				row2 = i;
-				break;
-			}
-			if (soc > lut->row_entries[i]) {
-				row1 = i - 1;
-				row2 = i;
-				break;
-			}
-		}
+		i = lut_first_entry_le(lut, soc);
+		row1 = (soc == lut->row_entries[i]) ? i : i - 1;
+		row2 = i;
 	}
 
-	if (batt_temp < lut->col_entries[0] * DEGC_SCALE)
-		batt_temp = lut->col_entries[0] * DEGC_SCALE;
-	if (batt_temp > lut->col_entries[cols - 1] * DEGC_SCALE)
-		batt_temp = lut->col_entries[cols - 1] * DEGC_SCALE;
-
-	for (i = 0; i < cols; i++)
-		if (batt_temp <= lut->col_entries[i] * DEGC_SCALE)
-			break;
-
-	if (batt_temp == lut->col_entries[i] * DEGC_SCALE) {
-		var = linear_interpolate(
-				lut->data[row1][i],
-				lut->row_entries[row1],
-				lut->data[row2][i],
-				lut->row_entries[row2],
-				soc);
-		return var;
-	}
-
-	var1 = linear_interpolate(
-				lut->data[row1][i - 1],
-				lut->col_entries[i - 1] * DEGC_SCALE,
-				lut->data[row1][i],
-				lut->col_entries[i] * DEGC_SCALE,
-				batt_temp);
-
-	var2 = linear_interpolate(
-				lut->data[row2][i - 1],
-				lut->col_entries[i - 1] * DEGC_SCALE,
-				lut->data[row2][i],
-				lut->col_entries[i] * DEGC_SCALE,
-				batt_temp);
+	mutex_lock(&lut->lock);
+	lut_set_temp(lut, batt_temp);
+	var1 = lut_temp_row(lut, row1);
+	var2 = lut_temp_row(lut, row2);
+	mutex_unlock(&lut->lock);
 
-	var = linear_interpolate(
+	return linear_interpolate(
 				var1,
 				lut->row_entries[row1],
 				var2,
 				lut->row_entries[row2],
 				soc);
-
-	return var;
 }
-
 int interpolate_slope(struct profile_table_data *lut,
 					int batt_temp, int soc)
 {
-	int i, ocvrow1, ocvrow2, rows, cols;
+	int ocvrow1, ocvrow2, rows;
 	int row1 = 0;
 	int row2 = 0;
 	int slope;
 
 	rows = lut->rows;
-	cols = lut->cols;
 	if (soc >= lut->row_entries[0]) {
 		pr_debug("soc %d >= max soc range - use the slope at soc=%d for lut %s\n",
 					soc, lut->row_entries[0], lut->name);
@@ -253,50 +370,15 @@ int interpolate_slope(struct profile_table_data *lut,
 		row1 = rows - 2;
 		row2 = rows - 1;
 	} else {
-		for (i = 0; i < rows; i++) {
-			if (soc >= lut->row_entries[i]) {
-				row1 = i - 1;
-				row2 = i;
-				break;
-			}
-		}
+		row2 = lut_first_entry_le(lut, soc);
+		row1 = row2 - 1;
 	}
 
-	if (batt_temp < lut->col_entries[0] * DEGC_SCALE)
-		batt_temp = lut->col_entries[0] * DEGC_SCALE;
-	if (batt_temp > lut->col_entries[cols - 1] * DEGC_SCALE)
-		batt_temp = lut->col_entries[cols - 1] * DEGC_SCALE;
-
-	for (i = 0; i < cols; i++) {
-		if (batt_temp <= lut->col_entries[i] * DEGC_SCALE)
-			break;
-	}
-
-	if (batt_temp == lut->col_entries[i] * DEGC_SCALE) {
-		slope = (lut->data[row1][i] - lut->data[row2][i]);
-		if (slope <= 0) {
-			pr_warn_ratelimited("Slope=%d for soc=%d, using 1\n",
-							slope, soc);
-			slope = 1;
-		}
-		slope *= 10000;
-		slope /= (lut->row_entries[row1] -
-			lut->row_entries[row2]);
-		return slope;
-	}
-	ocvrow1 = linear_interpolate(
-			lut->data[row1][i - 1],
-			lut->col_entries[i - 1] * DEGC_SCALE,
-			lut->data[row1][i],
-			lut->col_entries[i] * DEGC_SCALE,
-			batt_temp);
-
-	ocvrow2 = linear_interpolate(
-			lut->data[row2][i - 1],
-			lut->col_entries[i - 1] * DEGC_SCALE,
-			lut->data[row2][i],
-			lut->col_entries[i] * DEGC_SCALE,
-			batt_temp);
+	mutex_lock(&lut->lock);
+	lut_set_temp(lut, batt_temp);
+	ocvrow1 = lut_temp_row(lut, row1);
+	ocvrow2 = lut_temp_row(lut, row2);
+	mutex_unlock(&lut->lock);
 
 	slope = (ocvrow1 - ocvrow2);
 	if (slope <= 0) {
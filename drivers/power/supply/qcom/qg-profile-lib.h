@@ -13,6 +13,8 @@
 #ifndef __QG_PROFILE_LIB_H__
 #define __QG_PROFILE_LIB_H__
 
+#include <linux/mutex.h>
+
 struct profile_table_data {
 	char		*name;
 	int		rows;
@@ -20,8 +22,22 @@ struct profile_table_data {
 	int		*row_entries;
 	int		*col_entries;
 	int		**data;
+
+	/* lookup cache, set up by profile_table_cache_init() */
+	struct mutex	lock;
+	int		*col_temps;
+	int		*temp_col;
+	u32		*temp_col_gen;
+	u32		temp_gen;
+	int		temp_key;
+	int		temp_idx;
+	bool		rows_desc;
+	bool		data_desc;
 };
 
+int profile_table_cache_init(struct profile_table_data *lut);
+void profile_table_cache_free(struct profile_table_data *lut);
+
 int interpolate_single_row_lut(struct profile_table_data *lut,
 						int x, int scale);
 int interpolate_soc(struct profile_table_data *lut,
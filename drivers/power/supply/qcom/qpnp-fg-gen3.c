@@ -127,6 +127,10 @@
 #define ALG_FLAGS_WORD			120
 #define ALG_FLAGS_OFFSET		1
 
+/* FG algorithm outputs read in every update cycle, fetched in one burst */
+#define OUTPUT_SNAPSHOT_WORD		BATT_SOC_WORD
+#define OUTPUT_SNAPSHOT_LEN		((RSLOW_WORD - BATT_SOC_WORD + 1) * 4)
+
 /* v2 SRAM address and offset in ascending order */
 #define KI_COEFF_LOW_DISCHG_v2_WORD	9
 #define KI_COEFF_LOW_DISCHG_v2_OFFSET	3
@@ -2624,6 +2628,7 @@ static void fg_ttf_update(struct fg_chip *chip)
 		delay_ms = 5000;
 
 	vote(chip->awake_votable, TTF_PRIMING, true, 0);
+	batt_tick_cancel(&chip->ttf_tick);
 	cancel_delayed_work_sync(&chip->ttf_work);
 	mutex_lock(&chip->ttf.lock);
 	fg_circ_buf_clr(&chip->ttf.ibatt);
@@ -2975,6 +2980,7 @@ static void status_change_work(struct work_struct *work)
 	}
 
 	chip->charge_done = prop.intval;
+	fg_sram_snapshot_begin(chip, OUTPUT_SNAPSHOT_WORD, OUTPUT_SNAPSHOT_LEN);
 	fg_cycle_counter_update(chip);
 	fg_cap_learning_update(chip);
 
@@ -3012,6 +3018,7 @@ static void status_change_work(struct work_struct *work)
 	}
 
 	fg_ttf_update(chip);
+	fg_sram_snapshot_end(chip);
 	chip->prev_charge_status = chip->charge_status;
 out:
 	fg_dbg(chip, FG_STATUS, "charge_status:%d charge_type:%d charge_done:%d\n",
@@ -3981,7 +3988,7 @@ static void ttf_work(struct work_struct *work)
 	}
 
 	/* recurse every 10 seconds */
-	schedule_delayed_work(&chip->ttf_work, msecs_to_jiffies(10000));
+	batt_tick_schedule(&chip->ttf_tick, 10000);
 end_work:
 	vote(chip->awake_votable, TTF_PRIMING, false, 0);
 	mutex_unlock(&chip->ttf.lock);
@@ -4872,6 +4879,7 @@ static irqreturn_t fg_delta_msoc_irq_handler(int irq, void *data)
 	int rc;
 
 	fg_dbg(chip, FG_IRQ, "irq %d triggered\n", irq);
+	fg_sram_snapshot_begin(chip, OUTPUT_SNAPSHOT_WORD, OUTPUT_SNAPSHOT_LEN);
 	fg_cycle_counter_update(chip);
 
 	if (chip->cl.active)
@@ -4897,6 +4905,7 @@ static irqreturn_t fg_delta_msoc_irq_handler(int irq, void *data)
 	if (rc < 0)
 		pr_err("Error in adjusting timebase, rc=%d\n", rc);
 
+	fg_sram_snapshot_end(chip);
 	if (batt_psy_initialized(chip))
 		power_supply_changed(chip->batt_psy);
 
@@ -5629,6 +5638,7 @@ static void fg_cleanup(struct fg_chip *chip)
 
 	power_supply_unreg_notifier(&chip->nb);
 	qpnp_misc_twm_notifier_unregister(&chip->twm_nb);
+	batt_tick_unregister(&chip->ttf_tick);
 	cancel_delayed_work_sync(&chip->ttf_work);
 	cancel_delayed_work_sync(&chip->sram_dump_work);
 	if (chip->dt.use_esr_sw)
@@ -5788,6 +5798,7 @@ static int fg_gen3_probe(struct platform_device *pdev)
 	INIT_WORK(&chip->status_change_work, status_change_work);
 	INIT_WORK(&chip->esr_sw_work, fg_esr_sw_work);
 	INIT_DELAYED_WORK(&chip->ttf_work, ttf_work);
+	batt_tick_register(&chip->ttf_tick, "fg_ttf", &chip->ttf_work);
 	INIT_DELAYED_WORK(&chip->sram_dump_work, sram_dump_work);
 	INIT_WORK(&chip->esr_filter_work, esr_filter_work);
 	alarm_init(&chip->esr_filter_alarm, ALARM_BOOTTIME,
@@ -5922,6 +5933,7 @@ static int fg_gen3_suspend(struct device *dev)
 	if (rc < 0)
 		pr_err("Error in configuring ESR timer, rc=%d\n", rc);
 
+	batt_tick_cancel(&chip->ttf_tick);
 	cancel_delayed_work_sync(&chip->ttf_work);
 	if (fg_sram_dump)
 		cancel_delayed_work_sync(&chip->sram_dump_work);
@@ -6022,6 +6034,7 @@ static struct platform_driver fg_gen3_driver = {
 		.owner = THIS_MODULE,
 		.of_match_table = fg_gen3_match_table,
 		.pm		= &fg_gen3_pm_ops,
+		.probe_type	= PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.probe		= fg_gen3_probe,
 	.remove		= fg_gen3_remove,
@@ -3542,6 +3542,7 @@ static int process_suspend(struct qpnp_qg *chip)
 	if (!chip->profile_loaded)
 		return 0;
 
+	batt_tick_cancel(&chip->ttf->tick);
 	cancel_delayed_work_sync(&chip->ttf->ttf_work);
 
 	chip->suspend_data = false;
@@ -3994,6 +3995,7 @@ static struct platform_driver qpnp_qg_driver = {
 		.owner		= THIS_MODULE,
 		.of_match_table	= match_table,
 		.pm		= &qpnp_qg_pm_ops,
+		.probe_type	= PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.probe		= qpnp_qg_probe,
 	.remove		= qpnp_qg_remove,
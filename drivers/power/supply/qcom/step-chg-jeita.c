@@ -19,6 +19,7 @@
 #include <linux/slab.h>
 #include <linux/pmic-voter.h>
 #include "step-chg-jeita.h"
+#include "batt-tick.h"
 
 #define MAX_STEP_CHG_ENTRIES	8
 #define STEP_CHG_VOTER		"STEP_CHG_VOTER"
@@ -86,6 +87,7 @@ struct step_chg_info {
 	struct power_supply	*main_psy;
 	struct power_supply	*usb_psy;
 	struct delayed_work	status_change_work;
+	struct batt_tick_client	status_tick;
 	struct delayed_work	get_config_work;
 	struct notifier_block	nb;
 };
@@ -690,8 +692,8 @@ static void status_change_work(struct work_struct *work)
 	if (reschedule_us == 0)
 		goto exit_work;
 	else
-		schedule_delayed_work(&chip->status_change_work,
-				usecs_to_jiffies(reschedule_us));
+		batt_tick_schedule(&chip->status_tick,
+				reschedule_us / USEC_PER_MSEC);
 	return;
 
 exit_work:
@@ -788,10 +790,13 @@ int qcom_step_chg_init(struct device *dev,
 
 	INIT_DELAYED_WORK(&chip->status_change_work, status_change_work);
 	INIT_DELAYED_WORK(&chip->get_config_work, get_config_work);
+	batt_tick_register(&chip->status_tick, "step_chg_jeita",
+			&chip->status_change_work);
 
 	rc = step_chg_register_notifier(chip);
 	if (rc < 0) {
 		pr_err("Couldn't register psy notifier rc = %d\n", rc);
+		batt_tick_unregister(&chip->status_tick);
 		goto release_wakeup_source;
 	}
 
@@ -814,6 +819,7 @@ void qcom_step_chg_deinit(void)
 	if (!chip)
 		return;
 
+	batt_tick_unregister(&chip->status_tick);
 	cancel_delayed_work_sync(&chip->status_change_work);
 	cancel_delayed_work_sync(&chip->get_config_work);
 	power_supply_unreg_notifier(&chip->nb);
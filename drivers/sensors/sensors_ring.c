@@ -0,0 +1,358 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Shared memory ring for high rate sensor streams.
+ *
+ * The sensors DSP writes sample batches straight into a ring in SMEM and
+ * raises an SMP2P doorbell once the unread data reaches the watermark
+ * set by the reader. The samples never pass through glink, IPC router
+ * or a socket; this driver only wakes the reader of /dev/sensors_ring and
+ * copies the batch out of SMEM once.
+ */
+
+#include <linux/fs.h>
+#include <linux/interrupt.h>
+#include <linux/io.h>
+#include <linux/kernel.h>
+#include <linux/log2.h>
+#include <linux/miscdevice.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/poll.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/wait.h>
+
+#include <soc/qcom/smem.h>
+
+#define SNS_RING_MAGIC		0x534e5352	/* "SNSR" */
+#define SNS_RING_VERSION	1
+#define SNS_RING_DEF_SIZE	SZ_64K
+#define SNS_RING_DEF_WATERMARK	SZ_4K
+
+/*
+ * Shared header, followed by the data area. The indices are free running
+ * byte counts: the DSP only advances write_idx and the apps processor only
+ * advances read_idx, so neither side needs a lock. When the ring is full
+ * the DSP drops the batch and counts it in overflow.
+ */
+struct sns_ring_hdr {
+	__le32 magic;
+	__le32 version;
+	__le32 size;
+	__le32 write_idx;
+	__le32 read_idx;
+	__le32 watermark;
+	__le32 overflow;
+	__le32 reserved;
+};
+
+struct sns_ring {
+	struct device		*dev;
+	struct miscdevice	misc;
+	struct sns_ring_hdr __iomem *hdr;
+	u8 __iomem		*data;
+	u32			size;
+	wait_queue_head_t	wait;
+	struct mutex		read_lock;
+	unsigned long		in_use;
+	u64			doorbells;
+	u64			bytes_read;
+	void			*bounce;
+};
+
+#define SNS_RING_HDR_RD(r, f)		readl_relaxed(&(r)->hdr->f)
+#define SNS_RING_HDR_WR(r, f, v)	writel_relaxed((v), &(r)->hdr->f)
+
+/* Unread bytes; more than the ring size means the indices are corrupt */
+static u32 sns_ring_avail(struct sns_ring *ring)
+{
+	return SNS_RING_HDR_RD(ring, write_idx) -
+		SNS_RING_HDR_RD(ring, read_idx);
+}
+
+static irqreturn_t sns_ring_doorbell(int irq, void *data)
+{
+	struct sns_ring *ring = data;
+
+	ring->doorbells++;
+	wake_up_interruptible(&ring->wait);
+
+	return IRQ_HANDLED;
+}
+
+static int sns_ring_open(struct inode *inode, struct file *file)
+{
+	struct sns_ring *ring = container_of(file->private_data,
+					     struct sns_ring, misc);
+
+	if (test_and_set_bit(0, &ring->in_use))
+		return -EBUSY;
+
+	file->private_data = ring;
+
+	return nonseekable_open(inode, file);
+}
+
+static int sns_ring_release(struct inode *inode, struct file *file)
+{
+	struct sns_ring *ring = file->private_data;
+
+	clear_bit(0, &ring->in_use);
+
+	return 0;
+}
+
+static ssize_t sns_ring_read(struct file *file, char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	struct sns_ring *ring = file->private_data;
+	u32 avail, rd, off, chunk;
+	size_t done = 0;
+	int rc = 0;
+
+	if (!count)
+		return 0;
+
+	mutex_lock(&ring->read_lock);
+	while (!(avail = sns_ring_avail(ring))) {
+		mutex_unlock(&ring->read_lock);
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		rc = wait_event_interruptible(ring->wait,
+					      sns_ring_avail(ring));
+		if (rc)
+			return rc;
+		mutex_lock(&ring->read_lock);
+	}
+
+	if (avail > ring->size) {
+		dev_warn_ratelimited(ring->dev, "Ring indices corrupt, resyncing\n");
+		SNS_RING_HDR_WR(ring, read_idx,
+				SNS_RING_HDR_RD(ring, write_idx));
+		mutex_unlock(&ring->read_lock);
+		return -EIO;
+	}
+
+	/* Read the data only after seeing write_idx move past it */
+	rmb();
+
+	count = min_t(size_t, count, avail);
+	rd = SNS_RING_HDR_RD(ring, read_idx);
+	while (done < count) {
+		off = (rd + done) & (ring->size - 1);
+		chunk = min_t(size_t, count - done, ring->size - off);
+		chunk = min_t(u32, chunk, PAGE_SIZE);
+		memcpy_fromio(ring->bounce, ring->data + off, chunk);
+		if (copy_to_user(buf + done, ring->bounce, chunk)) {
+			rc = -EFAULT;
+			break;
+		}
+		done += chunk;
+	}
+
+	if (done) {
+		/* Finish reading before handing the space back to the DSP */
+		mb();
+		SNS_RING_HDR_WR(ring, read_idx, rd + done);
+		ring->bytes_read += done;
+	}
+	mutex_unlock(&ring->read_lock);
+
+	return done ? done : rc;
+}
+
+static unsigned int sns_ring_poll(struct file *file, poll_table *wait)
+{
+	struct sns_ring *ring = file->private_data;
+
+	poll_wait(file, &ring->wait, wait);
+
+	return sns_ring_avail(ring) ? POLLIN | POLLRDNORM : 0;
+}
+
+static const struct file_operations sns_ring_fops = {
+	.owner		= THIS_MODULE,
+	.open		= sns_ring_open,
+	.release	= sns_ring_release,
+	.read		= sns_ring_read,
+	.poll		= sns_ring_poll,
+	.llseek		= no_llseek,
+};
+
+static struct sns_ring *dev_to_sns_ring(struct device *dev)
+{
+	struct miscdevice *misc = dev_get_drvdata(dev);
+
+	return container_of(misc, struct sns_ring, misc);
+}
+
+static ssize_t watermark_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	struct sns_ring *ring = dev_to_sns_ring(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n",
+			 SNS_RING_HDR_RD(ring, watermark));
+}
+
+static ssize_t watermark_store(struct device *dev,
+			       struct device_attribute *attr,
+			       const char *buf, size_t count)
+{
+	struct sns_ring *ring = dev_to_sns_ring(dev);
+	u32 val;
+
+	if (kstrtou32(buf, 0, &val) || !val || val > ring->size)
+		return -EINVAL;
+
+	SNS_RING_HDR_WR(ring, watermark, val);
+
+	return count;
+}
+static DEVICE_ATTR_RW(watermark);
+
+static ssize_t stats_show(struct device *dev,
+			  struct device_attribute *attr, char *buf)
+{
+	struct sns_ring *ring = dev_to_sns_ring(dev);
+
+	return scnprintf(buf, PAGE_SIZE,
+			 "doorbells: %llu\nbytes_read: %llu\noverflow: %u\nunread: %u\n",
+			 ring->doorbells, ring->bytes_read,
+			 SNS_RING_HDR_RD(ring, overflow), sns_ring_avail(ring));
+}
+static DEVICE_ATTR_RO(stats);
+
+static struct attribute *sns_ring_attrs[] = {
+	&dev_attr_watermark.attr,
+	&dev_attr_stats.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(sns_ring);
+
+static int sns_ring_probe(struct platform_device *pdev)
+{
+	struct device_node *node = pdev->dev.of_node;
+	struct sns_ring *ring;
+	u32 smem_id, host = SMEM_DSPS, size = SNS_RING_DEF_SIZE;
+	void *smem;
+	int irq, rc;
+
+	rc = of_property_read_u32(node, "qcom,smem-id", &smem_id);
+	if (rc < 0) {
+		dev_err(&pdev->dev, "qcom,smem-id missing rc=%d\n", rc);
+		return rc;
+	}
+	of_property_read_u32(node, "qcom,smem-host", &host);
+	of_property_read_u32(node, "qcom,ring-size", &size);
+	if (!is_power_of_2(size) || size < PAGE_SIZE) {
+		dev_err(&pdev->dev, "Invalid ring size %u\n", size);
+		return -EINVAL;
+	}
+
+	irq = platform_get_irq(pdev, 0);
+	if (irq < 0)
+		return irq;
+
+	ring = devm_kzalloc(&pdev->dev, sizeof(*ring), GFP_KERNEL);
+	if (!ring)
+		return -ENOMEM;
+
+	ring->bounce = devm_kmalloc(&pdev->dev, PAGE_SIZE, GFP_KERNEL);
+	if (!ring->bounce)
+		return -ENOMEM;
+
+	smem = smem_alloc(smem_id, sizeof(struct sns_ring_hdr) + size, host, 0);
+	if (IS_ERR(smem))
+		return PTR_ERR(smem);
+	if (!smem) {
+		dev_err(&pdev->dev, "smem item %u unavailable\n", smem_id);
+		return -ENOMEM;
+	}
+
+	ring->dev = &pdev->dev;
+	ring->hdr = (struct sns_ring_hdr __iomem *)smem;
+	ring->data = (u8 __iomem *)smem + sizeof(struct sns_ring_hdr);
+	ring->size = size;
+	init_waitqueue_head(&ring->wait);
+	mutex_init(&ring->read_lock);
+
+	/* The DSP keeps a ring it already set up across an apps restart */
+	if (SNS_RING_HDR_RD(ring, magic) != SNS_RING_MAGIC ||
+	    SNS_RING_HDR_RD(ring, size) != size) {
+		SNS_RING_HDR_WR(ring, version, SNS_RING_VERSION);
+		SNS_RING_HDR_WR(ring, size, size);
+		SNS_RING_HDR_WR(ring, write_idx, 0);
+		SNS_RING_HDR_WR(ring, read_idx, 0);
+		SNS_RING_HDR_WR(ring, watermark, SNS_RING_DEF_WATERMARK);
+		SNS_RING_HDR_WR(ring, overflow, 0);
+		/* Publish the header before the DSP can see the magic */
+		wmb();
+		SNS_RING_HDR_WR(ring, magic, SNS_RING_MAGIC);
+	}
+
+	rc = devm_request_irq(&pdev->dev, irq, sns_ring_doorbell,
+			      IRQF_TRIGGER_RISING, "sensors_ring", ring);
+	if (rc < 0) {
+		dev_err(&pdev->dev, "Failed to request doorbell irq rc=%d\n",
+			rc);
+		return rc;
+	}
+
+	ring->misc.minor = MISC_DYNAMIC_MINOR;
+	ring->misc.name = "sensors_ring";
+	ring->misc.fops = &sns_ring_fops;
+	ring->misc.groups = sns_ring_groups;
+	rc = misc_register(&ring->misc);
+	if (rc < 0) {
+		dev_err(&pdev->dev, "Failed to register misc device rc=%d\n",
+			rc);
+		return rc;
+	}
+
+	platform_set_drvdata(pdev, ring);
+
+	return 0;
+}
+
+static int sns_ring_remove(struct platform_device *pdev)
+{
+	struct sns_ring *ring = platform_get_drvdata(pdev);
+
+	misc_deregister(&ring->misc);
+
+	return 0;
+}
+
+static const struct of_device_id sns_ring_match_table[] = {
+	{ .compatible = "qcom,sensors-ring" },
+	{ }
+};
+MODULE_DEVICE_TABLE(of, sns_ring_match_table);
+
+static struct platform_driver sns_ring_driver = {
+	.driver = {
+		.name = "sensors-ring",
+		.of_match_table = sns_ring_match_table,
+	},
+	.probe = sns_ring_probe,
+	.remove = sns_ring_remove,
+};
+module_platform_driver(sns_ring_driver);
+
+MODULE_DESCRIPTION("Sensors DSP shared memory ring");
+MODULE_LICENSE("GPL v2");
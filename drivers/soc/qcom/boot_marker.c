@@ -22,10 +22,12 @@
 #include <linux/delay.h>
 #include <linux/slab.h>
 #include <linux/list.h>
+#include <linux/math64.h>
 #include <linux/export.h>
 #include <linux/types.h>
 #include <linux/spinlock.h>
 #include <linux/mm.h>
+#include <linux/moduleparam.h>
 #include <soc/qcom/boot_stats.h>
 
 #define MAX_STRING_LEN 256
@@ -40,6 +42,11 @@ struct boot_marker {
 
 static struct dentry *dent_bkpi, *dent_bkpi_status, *dent_mpm_timer;
 static struct boot_marker boot_marker_list;
+static bool boot_marker_ready;
+
+/* Probes quicker than this are not worth a marker of their own */
+static unsigned int probe_marker_min_ms = 10;
+module_param(probe_marker_min_ms, uint, 0644);
 
 static void _create_boot_marker(const char *name,
 		unsigned long long int timer_value)
@@ -86,6 +93,29 @@ void place_marker(const char *name)
 }
 EXPORT_SYMBOL(place_marker);
 
+/**
+ * place_probe_marker() - record how long a driver took to probe a device
+ * @drv_name: name of the driver
+ * @duration: time spent in the probe
+ *
+ * Called by the driver core for every probe, but only probes of at least
+ * probe_marker_min_ms get a "D - Probe" duration marker, so that a driver
+ * slowing down the boot shows up in kpi_values. Probes running before the
+ * marker list is set up are not recorded.
+ */
+void place_probe_marker(const char *drv_name, ktime_t duration)
+{
+	char name[BOOT_MARKER_MAX_LEN];
+	s64 us = ktime_to_us(duration);
+
+	if (!READ_ONCE(boot_marker_ready) ||
+			us < (s64)probe_marker_min_ms * USEC_PER_MSEC)
+		return;
+
+	snprintf(name, sizeof(name), "D - Probe %s - ", drv_name);
+	_create_boot_marker(name, div_u64(us * TIMER_KHZ, USEC_PER_SEC));
+}
+
 static ssize_t bootkpi_reader(struct file *fp, char __user *user_buffer,
 		size_t count, loff_t *position)
 {
@@ -213,6 +243,7 @@ static int __init init_bootkpi(void)
 	INIT_LIST_HEAD(&boot_marker_list.list);
 	spin_lock_init(&boot_marker_list.slock);
 	set_bootloader_stats();
+	smp_store_release(&boot_marker_ready, true);
 	return 0;
 }
 subsys_initcall(init_bootkpi);
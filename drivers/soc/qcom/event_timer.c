@@ -21,6 +21,9 @@
 #include <linux/irq.h>
 #include <linux/interrupt.h>
 #include <linux/cpu.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
 #include <soc/qcom/event_timer.h>
 
 /**
@@ -500,3 +503,247 @@ ktime_t get_next_event_time(int cpu)
 
 	return next_event;
 }
+
+/*
+ * Periodic work is coalesced on a single event timer. The timer is set for
+ * the earliest time a periodic event can be run without exceeding its slack,
+ * and every event whose period has expired by then is run from that one
+ * wakeup. Being an event timer, lpm-levels sees the coalesced wakeup through
+ * get_next_event_time().
+ */
+
+/**
+ * struct event_timer_periodic - periodic work registered for coalescing
+ * @list: entry in periodic_list
+ * @name: client name
+ * @work: client work queued on expiry
+ * @period: period of the work
+ * @slack: how late the work may be run
+ * @expires: time the current period expires
+ * @active: true if started
+ * @runs: expirations, each a wakeup if the client used its own timer
+ * @wakeups: coalesced wakeups whose time was set by this event
+ */
+struct event_timer_periodic {
+	struct list_head list;
+	const char *name;
+	struct work_struct *work;
+	ktime_t period;
+	ktime_t slack;
+	ktime_t expires;
+	bool active;
+	unsigned long runs;
+	unsigned long wakeups;
+};
+
+static LIST_HEAD(periodic_list);
+static DEFINE_MUTEX(periodic_lock);
+static struct event_timer_info *periodic_event;
+static ktime_t periodic_fire;
+static unsigned long periodic_wakeups;
+
+static void periodic_work_fn(struct work_struct *work);
+static DECLARE_WORK(periodic_work, periodic_work_fn);
+
+/* Called from the event hrtimer, the events are run from process context */
+static void periodic_event_expired(void *data)
+{
+	queue_work(system_power_efficient_wq, &periodic_work);
+}
+
+static ktime_t periodic_deadline(struct event_timer_periodic *periodic)
+{
+	return ktime_add(periodic->expires, periodic->slack);
+}
+
+/* Return the active event that has to be run first, with periodic_lock held */
+static struct event_timer_periodic *periodic_first(void)
+{
+	struct event_timer_periodic *periodic, *first = NULL;
+
+	list_for_each_entry(periodic, &periodic_list, list) {
+		if (!periodic->active)
+			continue;
+		if (!first || ktime_before(periodic_deadline(periodic),
+					periodic_deadline(first)))
+			first = periodic;
+	}
+
+	return first;
+}
+
+/* Set the event timer for the first deadline, with periodic_lock held */
+static void periodic_rearm(void)
+{
+	struct event_timer_periodic *first = periodic_first();
+	ktime_t fire;
+
+	if (!first) {
+		if (ktime_to_ns(periodic_fire)) {
+			deactivate_event_timer(periodic_event);
+			periodic_fire = ns_to_ktime(0);
+		}
+		return;
+	}
+
+	fire = periodic_deadline(first);
+	if (ktime_compare(fire, periodic_fire)) {
+		periodic_fire = fire;
+		activate_event_timer(periodic_event, fire);
+	}
+}
+
+static void periodic_work_fn(struct work_struct *work)
+{
+	struct event_timer_periodic *periodic, *first;
+	ktime_t now = ktime_get();
+
+	mutex_lock(&periodic_lock);
+	first = periodic_first();
+	if (first && !ktime_after(periodic_deadline(first), now)) {
+		first->wakeups++;
+		periodic_wakeups++;
+	}
+
+	/* Run everything whose period has expired along with the first one */
+	list_for_each_entry(periodic, &periodic_list, list) {
+		if (!periodic->active || ktime_after(periodic->expires, now))
+			continue;
+
+		queue_work(system_power_efficient_wq, periodic->work);
+		periodic->runs++;
+		periodic->expires = ktime_add(now, periodic->period);
+	}
+
+	periodic_fire = ns_to_ktime(0);
+	periodic_rearm();
+	mutex_unlock(&periodic_lock);
+}
+
+/**
+ * add_periodic_event_timer() : Register periodic work whose expirations can
+ *                              be coalesced with other periodic work.
+ * @name : client name.
+ * @work : work queued each time the period expires.
+ * @period_ms : period of the work.
+ * @slack_ms : how late the work may run to share a wakeup with others.
+ */
+struct event_timer_periodic *add_periodic_event_timer(const char *name,
+		struct work_struct *work, unsigned int period_ms,
+		unsigned int slack_ms)
+{
+	struct event_timer_periodic *periodic;
+
+	if (!work || !period_ms)
+		return NULL;
+
+	periodic = kzalloc(sizeof(*periodic), GFP_KERNEL);
+	if (!periodic)
+		return NULL;
+
+	periodic->name = name;
+	periodic->work = work;
+	periodic->period = ms_to_ktime(period_ms);
+	periodic->slack = ms_to_ktime(slack_ms);
+
+	mutex_lock(&periodic_lock);
+	if (!periodic_event) {
+		periodic_event = add_event_timer(0, periodic_event_expired,
+						NULL);
+		if (!periodic_event) {
+			mutex_unlock(&periodic_lock);
+			kfree(periodic);
+			return NULL;
+		}
+	}
+	list_add_tail(&periodic->list, &periodic_list);
+	mutex_unlock(&periodic_lock);
+
+	return periodic;
+}
+EXPORT_SYMBOL(add_periodic_event_timer);
+
+/**
+ * start_periodic_event_timer() : Start queueing the work every period.
+ * @periodic : periodic event handle.
+ */
+void start_periodic_event_timer(struct event_timer_periodic *periodic)
+{
+	if (!periodic)
+		return;
+
+	mutex_lock(&periodic_lock);
+	periodic->expires = ktime_add(ktime_get(), periodic->period);
+	periodic->active = true;
+	periodic_rearm();
+	mutex_unlock(&periodic_lock);
+}
+EXPORT_SYMBOL(start_periodic_event_timer);
+
+/**
+ * stop_periodic_event_timer() : Stop queueing the work. Work already queued
+ *                               is left to the client to cancel.
+ * @periodic : periodic event handle.
+ */
+void stop_periodic_event_timer(struct event_timer_periodic *periodic)
+{
+	if (!periodic)
+		return;
+
+	mutex_lock(&periodic_lock);
+	periodic->active = false;
+	periodic_rearm();
+	mutex_unlock(&periodic_lock);
+}
+EXPORT_SYMBOL(stop_periodic_event_timer);
+
+/**
+ * destroy_periodic_event_timer() : Stop and free a periodic event.
+ * @periodic : periodic event handle.
+ */
+void destroy_periodic_event_timer(struct event_timer_periodic *periodic)
+{
+	if (!periodic)
+		return;
+
+	mutex_lock(&periodic_lock);
+	periodic->active = false;
+	list_del(&periodic->list);
+	periodic_rearm();
+	mutex_unlock(&periodic_lock);
+	kfree(periodic);
+}
+EXPORT_SYMBOL(destroy_periodic_event_timer);
+
+/*
+ * Runs are the wakeups each client would cause on its own timer, wakeups
+ * are the coalesced ones it actually caused.
+ */
+static int get_periodic_stats(char *buf, const struct kernel_param *kp)
+{
+	struct event_timer_periodic *periodic;
+	unsigned long runs = 0;
+	int cnt = 0;
+
+	mutex_lock(&periodic_lock);
+	cnt += snprintf(buf + cnt, PAGE_SIZE - cnt,
+			"name period_ms slack_ms runs wakeups\n");
+	list_for_each_entry(periodic, &periodic_list, list) {
+		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt,
+				"%s %lld %lld %lu %lu\n", periodic->name,
+				ktime_to_ms(periodic->period),
+				ktime_to_ms(periodic->slack),
+				periodic->runs, periodic->wakeups);
+		runs += periodic->runs;
+	}
+	cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "total - - %lu %lu\n",
+			runs, periodic_wakeups);
+	mutex_unlock(&periodic_lock);
+
+	return cnt;
+}
+
+static const struct kernel_param_ops param_ops_periodic_stats = {
+	.get = get_periodic_stats,
+};
+module_param_cb(periodic_stats, &param_ops_periodic_stats, NULL, 0444);
@@ -233,6 +233,9 @@ static DEFINE_MUTEX(edge_list_lock_lhd0);
  * @tx_cnt:				Packets to be picked by tx scheduler.
  * @rt_vote_on:				Number of times RT vote on is called.
  * @rt_vote_off:			Number of times RT vote off is called.
+ * @rx_intent_prequeue_cnt:		RX intents to keep queued for remote.
+ * @rx_intent_prequeue_size:		Size of each pre-queued RX intent.
+ * @rx_intent_prequeue_work:		Work item topping up pre-queued intents.
  */
 struct channel_ctx {
 	struct rwref_lock ch_state_lhb2;
@@ -316,6 +319,10 @@ struct channel_ctx {
 
 	uint32_t rt_vote_on;
 	uint32_t rt_vote_off;
+
+	unsigned int rx_intent_prequeue_cnt;
+	size_t rx_intent_prequeue_size;
+	struct work_struct rx_intent_prequeue_work;
 };
 
 static struct glink_core_if core_impl;
@@ -414,6 +421,9 @@ static void ch_add_rcid(struct glink_core_xprt_ctx *xprt_ctx,
 static bool ch_is_fully_opened(struct channel_ctx *ctx);
 static bool ch_is_fully_closed(struct channel_ctx *ctx);
 
+static void glink_rx_intent_prequeue_worker(struct work_struct *work);
+static void glink_rx_intent_prequeue(struct channel_ctx *ctx);
+
 struct glink_core_tx_pkt *ch_get_tx_pending_remote_done(struct channel_ctx *ctx,
 							uint32_t riid);
 
@@ -1937,6 +1947,8 @@ static struct channel_ctx *ch_name_to_ch_ctx_create(
 	spin_lock_init(&ctx->tx_pending_rmt_done_lock_lhc4);
 	INIT_LIST_HEAD(&ctx->tx_pending_remote_done);
 	spin_lock_init(&ctx->tx_lists_lock_lhc3);
+	INIT_WORK(&ctx->rx_intent_prequeue_work,
+		  glink_rx_intent_prequeue_worker);
 
 check_ctx:
 	rwref_write_get(&xprt_ctx->xprt_state_lhb0);
@@ -2703,6 +2715,9 @@ void *glink_open(const struct glink_open_config *cfg)
 	ctx->notify_tx_abort = cfg->notify_tx_abort;
 	ctx->notify_rx_tracer_pkt = cfg->notify_rx_tracer_pkt;
 	ctx->notify_remote_rx_intent = cfg->notify_remote_rx_intent;
+	ctx->rx_intent_prequeue_size = cfg->rx_intent_prequeue_size;
+	ctx->rx_intent_prequeue_cnt = cfg->rx_intent_prequeue_size ?
+					cfg->rx_intent_prequeue_cnt : 0;
 
 	if (!ctx->notify_rx_intent_req)
 		ctx->notify_rx_intent_req = glink_dummy_notify_rx_intent_req;
@@ -3306,11 +3321,64 @@ int glink_rx_done(void *handle, const void *ptr, bool reuse)
 	/* send rx done */
 	ctx->transport_ptr->ops->tx_cmd_local_rx_done(ctx->transport_ptr->ops,
 			ctx->lcid, id, reuse);
+	if (!reuse)
+		glink_rx_intent_prequeue(ctx);
 	glink_put_ch_ctx(ctx);
 	return ret;
 }
 EXPORT_SYMBOL(glink_rx_done);
 
+/**
+ * glink_rx_intent_prequeue_worker() - Top up a channel's pre-queued intents
+ * @work:	rx_intent_prequeue_work of the channel.
+ *
+ * Queues intents of rx_intent_prequeue_size until rx_intent_prequeue_cnt
+ * intents are available to the remote side, so the remote does not have to
+ * send an intent request and wait for the client to answer it.  Drops the
+ * channel reference taken by glink_rx_intent_prequeue().
+ */
+static void glink_rx_intent_prequeue_worker(struct work_struct *work)
+{
+	struct channel_ctx *ctx = container_of(work, struct channel_ctx,
+						rx_intent_prequeue_work);
+	struct glink_core_rx_intent *intent;
+	unsigned int queued = 0;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ctx->local_rx_intent_lst_lock_lhc1, flags);
+	list_for_each_entry(intent, &ctx->local_rx_intent_list, list)
+		queued++;
+	spin_unlock_irqrestore(&ctx->local_rx_intent_lst_lock_lhc1, flags);
+
+	while (queued < ctx->rx_intent_prequeue_cnt &&
+	       ch_is_fully_opened(ctx)) {
+		if (glink_queue_rx_intent(ctx, NULL,
+					  ctx->rx_intent_prequeue_size))
+			break;
+		queued++;
+	}
+
+	glink_put_ch_ctx(ctx);
+}
+
+/**
+ * glink_rx_intent_prequeue() - Schedule a top-up of pre-queued intents
+ * @ctx:	Local channel context
+ *
+ * Intents are allocated in process context, so this is safe to call from
+ * the atomic RX paths.
+ */
+static void glink_rx_intent_prequeue(struct channel_ctx *ctx)
+{
+	if (!ctx->rx_intent_prequeue_cnt ||
+	    (ctx->transport_ptr->capabilities & GCAP_INTENTLESS))
+		return;
+
+	glink_get_ch_ctx(ctx);
+	if (!schedule_work(&ctx->rx_intent_prequeue_work))
+		glink_put_ch_ctx(ctx);
+}
+
 /**
  * glink_txv() - Transmit a packet in vector form.
  *
@@ -4864,6 +4932,9 @@ static bool ch_migrate(struct channel_ctx *l_ctx, struct channel_ctx *r_ctx)
 	spin_lock_init(&ctx_clone->tx_pending_rmt_done_lock_lhc4);
 	INIT_LIST_HEAD(&ctx_clone->tx_pending_remote_done);
 	spin_lock_init(&ctx_clone->tx_lists_lock_lhc3);
+	ctx_clone->rx_intent_prequeue_cnt = 0;
+	INIT_WORK(&ctx_clone->rx_intent_prequeue_work,
+		  glink_rx_intent_prequeue_worker);
 	spin_lock_irqsave(&l_ctx->transport_ptr->xprt_ctx_lock_lhb1, flags);
 	list_add_tail(&ctx_clone->port_list_node,
 					&l_ctx->transport_ptr->channels);
@@ -5016,8 +5087,10 @@ static void glink_core_rx_cmd_ch_remote_open(struct glink_transport_if *if_ptr,
 			__func__, req_xprt, xprt_resp);
 
 	if_ptr->tx_cmd_ch_remote_open_ack(if_ptr, rcid, xprt_resp);
-	if (!do_migrate && ch_is_fully_opened(ctx))
+	if (!do_migrate && ch_is_fully_opened(ctx)) {
 		ctx->notify_state(ctx, ctx->user_priv, GLINK_CONNECTED);
+		glink_rx_intent_prequeue(ctx);
+	}
 
 
 	if (do_migrate)
@@ -5070,6 +5143,7 @@ static void glink_core_rx_cmd_ch_open_ack(struct glink_transport_if *if_ptr,
 			GLINK_INFO_PERF_CH(ctx,
 					"%s: notify state: GLINK_CONNECTED\n",
 					__func__);
+			glink_rx_intent_prequeue(ctx);
 		}
 	}
 	rwref_put(&ctx->ch_state_lhb2);
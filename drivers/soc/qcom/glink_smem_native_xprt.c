@@ -23,6 +23,7 @@
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/of.h>
+#include <linux/bitmap.h>
 #include <linux/of_irq.h>
 #include <linux/platform_device.h>
 #include <linux/printk.h>
@@ -52,6 +53,9 @@
 #define RPM_MAX_TOC_ENTRIES 20
 #define RPM_FIFO_ADDR_ALIGN_BYTES 3
 #define TRACER_PKT_FEATURE BIT(2)
+#define ZERO_COPY_FEATURE BIT(3)
+#define ZC_SLOT_SIZE SZ_1K
+#define ZC_DEFAULT_THRESHOLD SZ_2K
 #define DEFERRED_CMDS_THRESHOLD 25
 #define NUM_LOG_PAGES	4
 
@@ -67,7 +71,8 @@
  * @RX_INTENT_REQ_CMD:		Request to have RX intent queued
  * @RX_INTENT_REQ_ACK_CMD:	Response for @RX_INTENT_REQ_CMD
  * @TX_DATA_CMD:		Start of a data transfer
- * @ZERO_COPY_TX_DATA_CMD:	Start of a data transfer with zero copy
+ * @ZERO_COPY_TX_DATA_CMD:	Complete data transfer through the shared buffer
+ *				pool; only the location goes over the fifo
  * @CLOSE_ACK_CMD:		Response for @CLOSE_CMD
  * @TX_DATA_CONT_CMD:		Continuation or end of a data transfer
  * @READ_NOTIF_CMD:		Request for a notification when this cmd is read
@@ -191,6 +196,16 @@ struct mailbox_config_info {
  *				index position represents a power state.
  * @mailbox:			Mailbox transport channel description reference.
  * @log_ctx:			Pointer to log context.
+ * @zero_copy:			Zero copy mode was negotiated with the remote.
+ * @zc_tx_pool:			Shared buffer pool for large packets to remote.
+ * @zc_rx_pool:			Shared buffer pool for large packets from
+ *				remote.
+ * @zc_pool_size:		Size, in bytes, of each of the two pools.
+ * @zc_threshold:		Smallest packet sent through the pool.
+ * @zc_slots:			Number of ZC_SLOT_SIZE slots in @zc_tx_pool.
+ * @zc_tx_map:			Allocation bitmap of @zc_tx_pool.
+ * @zc_lock:			Lock for @zc_tx_map and @zc_tx_bufs.
+ * @zc_tx_bufs:			Pool buffers waiting for the remote rx done.
  */
 struct edge_info {
 	struct glink_transport_if xprt_if;
@@ -232,6 +247,34 @@ struct edge_info {
 	unsigned long *ramp_time_us;
 	struct mailbox_config_info *mailbox;
 	void *log_ctx;
+	bool zero_copy;
+	void __iomem *zc_tx_pool;
+	void __iomem *zc_rx_pool;
+	uint32_t zc_pool_size;
+	uint32_t zc_threshold;
+	uint32_t zc_slots;
+	unsigned long *zc_tx_map;
+	spinlock_t zc_lock;
+	struct list_head zc_tx_bufs;
+};
+
+/**
+ * struct zc_tx_buf - shared pool space in use by an outstanding zero copy tx
+ * @list_node:	Used to put this buffer on the edge's list.
+ * @rcid:	Remote channel the packet was sent to.
+ * @riid:	Remote intent the packet was sent to.
+ * @slot:	First ZC_SLOT_SIZE slot of the buffer in the tx pool.
+ * @nr_slots:	Number of slots used.
+ *
+ * The space is returned to the pool when the remote side reports it is done
+ * with the intent.
+ */
+struct zc_tx_buf {
+	struct list_head list_node;
+	uint32_t rcid;
+	uint32_t riid;
+	uint32_t slot;
+	uint32_t nr_slots;
 };
 
 /**
@@ -261,7 +304,7 @@ static void register_debugfs_info(struct edge_info *einfo);
 static struct edge_info *edge_infos[NUM_SMEM_SUBSYSTEMS];
 static DEFINE_MUTEX(probe_lock);
 static struct glink_core_version versions[] = {
-	{1, TRACER_PKT_FEATURE, negotiate_features_v1},
+	{1, TRACER_PKT_FEATURE | ZERO_COPY_FEATURE, negotiate_features_v1},
 };
 
 #define SMEM_IPC_LOG(einfo, str, id, param1, param2) do { \
@@ -824,6 +867,98 @@ static void process_rx_data(struct edge_info *einfo, uint16_t cmd_id,
 								false : true);
 }
 
+/**
+ * process_rx_zero_copy() - process a zero copy data packet from the remote
+ * @einfo:	Edge the packet arrived on.
+ * @rcid:	Remote channel the packet is for.
+ * @intent_id:	Local intent the packet is for.
+ *
+ * The whole packet sits in the remote side's half of the shared buffer pool;
+ * only its location is read from the fifo.
+ */
+static void process_rx_zero_copy(struct edge_info *einfo, uint32_t rcid,
+				 uint32_t intent_id)
+{
+	struct command {
+		uint32_t size;
+		uint32_t offset;
+	};
+	struct command cmd;
+	struct glink_core_rx_intent *intent;
+
+	fifo_read(einfo, &cmd, sizeof(cmd));
+
+	if (!einfo->zc_rx_pool || cmd.offset > einfo->zc_pool_size ||
+	    cmd.size > einfo->zc_pool_size - cmd.offset) {
+		GLINK_ERR("%s: bad pool buffer %u:%u for ch %d liid %d\n",
+			  __func__, cmd.offset, cmd.size, rcid, intent_id);
+		return;
+	}
+
+	intent = einfo->xprt_if.glink_core_if_ptr->rx_get_pkt_ctx(
+					&einfo->xprt_if, rcid, intent_id);
+	if (intent == NULL || intent->data == NULL || intent->write_offset ||
+	    cmd.size > intent->intent_size) {
+		GLINK_ERR("%s: no usable intent for ch %d liid %d size %u\n",
+			  __func__, rcid, intent_id, cmd.size);
+		return;
+	}
+
+	einfo->read_from_fifo(intent->data, einfo->zc_rx_pool + cmd.offset,
+			      cmd.size);
+	intent->write_offset = cmd.size;
+	intent->pkt_size = cmd.size;
+
+	einfo->xprt_if.glink_core_if_ptr->rx_put_pkt_ctx(&einfo->xprt_if,
+							rcid, intent, true);
+}
+
+/**
+ * zc_release_tx_buf() - return pool space once the remote is done with it
+ * @einfo:	Edge the packet was sent on.
+ * @rcid:	Remote channel the packet was sent to.
+ * @riid:	Remote intent the packet was sent to.
+ */
+static void zc_release_tx_buf(struct edge_info *einfo, uint32_t rcid,
+			      uint32_t riid)
+{
+	struct zc_tx_buf *buf;
+	unsigned long flags;
+
+	spin_lock_irqsave(&einfo->zc_lock, flags);
+	list_for_each_entry(buf, &einfo->zc_tx_bufs, list_node) {
+		if (buf->rcid == rcid && buf->riid == riid) {
+			bitmap_clear(einfo->zc_tx_map, buf->slot,
+				     buf->nr_slots);
+			list_del(&buf->list_node);
+			kfree(buf);
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&einfo->zc_lock, flags);
+}
+
+/**
+ * zc_reset_tx_pool() - drop all outstanding pool buffers of an edge
+ * @einfo:	Edge to reset.
+ */
+static void zc_reset_tx_pool(struct edge_info *einfo)
+{
+	struct zc_tx_buf *buf, *tmp;
+	unsigned long flags;
+
+	if (!einfo->zc_tx_map)
+		return;
+
+	spin_lock_irqsave(&einfo->zc_lock, flags);
+	list_for_each_entry_safe(buf, tmp, &einfo->zc_tx_bufs, list_node) {
+		list_del(&buf->list_node);
+		kfree(buf);
+	}
+	bitmap_zero(einfo->zc_tx_map, einfo->zc_slots);
+	spin_unlock_irqrestore(&einfo->zc_lock, flags);
+}
+
 /**
  * queue_cmd() - queue a deferred command for later processing
  * @einfo:	Edge to queue commands on.
@@ -1180,6 +1315,9 @@ static void __rx_worker(struct edge_info *einfo, bool atomic_ctx)
 			spin_lock_irqsave(&einfo->rx_lock, flags);
 			break;
 		case RX_DONE_CMD:
+			if (einfo->zero_copy)
+				zc_release_tx_buf(einfo, cmd.param1,
+						  cmd.param2);
 			if (atomic_ctx) {
 				queue_cmd(einfo, &cmd, NULL);
 				break;
@@ -1227,6 +1365,9 @@ static void __rx_worker(struct edge_info *einfo, bool atomic_ctx)
 		case TRACER_PKT_CONT_CMD:
 			process_rx_data(einfo, cmd.id, cmd.param1, cmd.param2);
 			break;
+		case ZERO_COPY_TX_DATA_CMD:
+			process_rx_zero_copy(einfo, cmd.param1, cmd.param2);
+			break;
 		case CLOSE_ACK_CMD:
 			if (atomic_ctx) {
 				queue_cmd(einfo, &cmd, NULL);
@@ -1254,6 +1395,9 @@ static void __rx_worker(struct edge_info *einfo, bool atomic_ctx)
 			spin_lock_irqsave(&einfo->rx_lock, flags);
 			break;
 		case RX_DONE_W_REUSE_CMD:
+			if (einfo->zero_copy)
+				zc_release_tx_buf(einfo, cmd.param1,
+						  cmd.param2);
 			if (atomic_ctx) {
 				queue_cmd(einfo, &cmd, NULL);
 				break;
@@ -1329,6 +1473,8 @@ static void tx_cmd_version(struct glink_transport_if *if_ptr, uint32_t version,
 	cmd.id = VERSION_CMD;
 	cmd.version = version;
 	cmd.features = features;
+	if (!einfo->zc_tx_pool)
+		cmd.features &= ~ZERO_COPY_FEATURE;
 
 	SMEM_IPC_LOG(einfo, __func__, cmd.id, cmd.version, cmd.features);
 	fifo_tx(einfo, &cmd, sizeof(cmd));
@@ -1365,6 +1511,8 @@ static void tx_cmd_version_ack(struct glink_transport_if *if_ptr,
 	cmd.id = VERSION_ACK_CMD;
 	cmd.version = version;
 	cmd.features = features;
+	if (!einfo->zc_tx_pool)
+		cmd.features &= ~ZERO_COPY_FEATURE;
 
 	SMEM_IPC_LOG(einfo, __func__, cmd.id, cmd.version, cmd.features);
 	fifo_tx(einfo, &cmd, sizeof(cmd));
@@ -1400,6 +1548,9 @@ static uint32_t set_version(struct glink_transport_if *if_ptr, uint32_t version,
 	if (features & TRACER_PKT_FEATURE)
 		ret |= GCAP_TRACER_PKT;
 
+	einfo->zero_copy = einfo->zc_tx_pool && !einfo->intentless &&
+				(features & ZERO_COPY_FEATURE);
+
 	srcu_read_unlock(&einfo->use_ref, rcu_id);
 	return ret;
 }
@@ -1623,6 +1774,8 @@ static int ssr(struct glink_transport_if *if_ptr)
 		kfree(cmd);
 	}
 
+	einfo->zero_copy = false;
+	zc_reset_tx_pool(einfo);
 	einfo->tx_resume_needed = false;
 	einfo->tx_blocked_signal_sent = false;
 	einfo->rx_fifo = NULL;
@@ -2063,6 +2216,16 @@ static int tx_data(struct glink_transport_if *if_ptr, uint16_t cmd_id,
 		return -EINVAL;
 	}
 
+	if (einfo->zero_copy && cmd_id == TX_DATA_CMD &&
+	    pctx->size_remaining == pctx->size &&
+	    pctx->size >= einfo->zc_threshold) {
+		ret = tx_data_zero_copy(einfo, lcid, pctx);
+		if (ret != -ENOSPC) {
+			srcu_read_unlock(&einfo->use_ref, rcu_id);
+			return ret;
+		}
+	}
+
 	if (cmd_id == TX_DATA_CMD) {
 		if (pctx->size_remaining == pctx->size)
 			cmd.id = TX_DATA_CMD;
@@ -2140,6 +2303,109 @@ static int tx_data(struct glink_transport_if *if_ptr, uint16_t cmd_id,
 	return cmd.size;
 }
 
+/**
+ * tx_data_zero_copy() - transmit a complete packet through the shared pool
+ * @einfo:	The edge to transmit on.
+ * @lcid:	The local channel id to encode.
+ * @pctx:	The data to encode.
+ *
+ * The packet is copied once into the local side's half of the shared buffer
+ * pool and only a descriptor is written to the fifo, so a large packet does
+ * not have to be streamed through the fifo in fragments and read back out by
+ * the remote side.  Called with @einfo->use_ref held.
+ *
+ * Return: Number of bytes written, -ENOSPC if the pool is full and the
+ *         packet should be sent through the fifo instead, or standard Linux
+ *         error code.
+ */
+static int tx_data_zero_copy(struct edge_info *einfo, uint32_t lcid,
+			     struct glink_core_tx_pkt *pctx)
+{
+	struct command {
+		uint16_t id;
+		uint16_t lcid;
+		uint32_t riid;
+		uint32_t size;
+		uint32_t offset;
+	};
+	struct command cmd;
+	struct zc_tx_buf *buf;
+	const void *data_start;
+	unsigned long flags;
+	size_t copied = 0;
+	size_t tx_size;
+	void __iomem *dest;
+	int ret;
+
+	buf = kmalloc(sizeof(*buf), GFP_ATOMIC);
+	if (!buf)
+		return -ENOSPC;
+
+	buf->rcid = pctx->rcid;
+	buf->riid = pctx->riid;
+	buf->nr_slots = DIV_ROUND_UP(pctx->size, ZC_SLOT_SIZE);
+
+	spin_lock_irqsave(&einfo->zc_lock, flags);
+	buf->slot = bitmap_find_next_zero_area(einfo->zc_tx_map,
+					       einfo->zc_slots, 0,
+					       buf->nr_slots, 0);
+	if (buf->slot >= einfo->zc_slots) {
+		spin_unlock_irqrestore(&einfo->zc_lock, flags);
+		kfree(buf);
+		return -ENOSPC;
+	}
+	bitmap_set(einfo->zc_tx_map, buf->slot, buf->nr_slots);
+	list_add_tail(&buf->list_node, &einfo->zc_tx_bufs);
+	spin_unlock_irqrestore(&einfo->zc_lock, flags);
+
+	dest = einfo->zc_tx_pool + buf->slot * ZC_SLOT_SIZE;
+	while (copied < pctx->size) {
+		data_start = get_tx_vaddr(pctx, copied, &tx_size);
+		if (!data_start) {
+			GLINK_ERR("%s: invalid data_start\n", __func__);
+			ret = -EINVAL;
+			goto release;
+		}
+		tx_size = min_t(size_t, tx_size, pctx->size - copied);
+		einfo->write_to_fifo(dest + copied, data_start, tx_size);
+		copied += tx_size;
+	}
+
+	cmd.id = ZERO_COPY_TX_DATA_CMD;
+	cmd.lcid = lcid;
+	cmd.riid = pctx->riid;
+	cmd.size = pctx->size;
+	cmd.offset = buf->slot * ZC_SLOT_SIZE;
+
+	spin_lock_irqsave(&einfo->write_lock, flags);
+	if (fifo_write_avail(einfo) <= sizeof(cmd) ||
+	    einfo->tx_blocked_signal_sent) {
+		einfo->tx_resume_needed = true;
+		send_tx_blocked_signal(einfo);
+		spin_unlock_irqrestore(&einfo->write_lock, flags);
+		ret = -EAGAIN;
+		goto release;
+	}
+
+	ret = fifo_write(einfo, &cmd, sizeof(cmd));
+	if (ret < 0) {
+		spin_unlock_irqrestore(&einfo->write_lock, flags);
+		goto release;
+	}
+	pctx->size_remaining = 0;
+
+	SMEM_IPC_LOG(einfo, __func__, cmd.id, cmd.lcid, cmd.riid);
+	GLINK_DBG("%s %s: lcid[%u] riid[%u] size[%u] offset[%u]\n",
+		"<SMEM>", __func__, cmd.lcid, cmd.riid, cmd.size, cmd.offset);
+	spin_unlock_irqrestore(&einfo->write_lock, flags);
+
+	return cmd.size;
+
+release:
+	zc_release_tx_buf(einfo, buf->rcid, buf->riid);
+	return ret;
+}
+
 /**
  * tx() - convert a data transmit cmd to wire format and transmit
  * @if_ptr:	The transport to transmit on.
@@ -2271,7 +2537,13 @@ static uint32_t negotiate_features_v1(struct glink_transport_if *if_ptr,
 				      const struct glink_core_version *version,
 				      uint32_t features)
 {
-	return features & version->features;
+	struct edge_info *einfo;
+
+	einfo = container_of(if_ptr, struct edge_info, xprt_if);
+	features &= version->features;
+	if (!einfo->zc_tx_pool)
+		features &= ~ZERO_COPY_FEATURE;
+	return features;
 }
 
 /**
@@ -2430,6 +2702,49 @@ static void glink_set_affinity(struct edge_info *einfo, u32 *arr, size_t size)
 		pr_err("%s: Failed to set tx cpu affinity\n", __func__);
 }
 
+/**
+ * glink_smem_init_zc_pool() - set up the shared buffer pool of an edge
+ * @einfo:	The edge to set the pool up for.
+ * @node:	Device tree node of the edge.
+ *
+ * One SMEM item holds both directions: the local side's tx pool followed by
+ * the remote side's tx pool, each @einfo->zc_pool_size bytes.  Failure is
+ * not fatal; the edge simply does not offer ZERO_COPY_FEATURE.
+ */
+static void glink_smem_init_zc_pool(struct edge_info *einfo,
+				    struct device_node *node)
+{
+	void *pool;
+
+	einfo->zc_pool_size = round_down(einfo->zc_pool_size, ZC_SLOT_SIZE);
+	if (!einfo->zc_pool_size)
+		return;
+
+	einfo->zc_threshold = ZC_DEFAULT_THRESHOLD;
+	of_property_read_u32(node, "qcom,zero-copy-threshold",
+			     &einfo->zc_threshold);
+
+	einfo->zc_slots = einfo->zc_pool_size / ZC_SLOT_SIZE;
+	einfo->zc_tx_map = kcalloc(BITS_TO_LONGS(einfo->zc_slots),
+				   sizeof(unsigned long), GFP_KERNEL);
+	if (!einfo->zc_tx_map)
+		return;
+
+	pool = smem_alloc(SMEM_GLINK_NATIVE_XPRT_ZC_POOL,
+			  einfo->zc_pool_size * 2, einfo->remote_proc_id, 0);
+	if (IS_ERR_OR_NULL(pool)) {
+		pr_err("%s: smem alloc of zero copy pool failed\n", __func__);
+		kfree(einfo->zc_tx_map);
+		einfo->zc_tx_map = NULL;
+		return;
+	}
+
+	spin_lock_init(&einfo->zc_lock);
+	INIT_LIST_HEAD(&einfo->zc_tx_bufs);
+	einfo->zc_rx_pool = pool + einfo->zc_pool_size;
+	einfo->zc_tx_pool = pool;
+}
+
 static int glink_smem_native_probe(struct platform_device *pdev)
 {
 	struct device_node *node;
@@ -2558,6 +2873,10 @@ static int glink_smem_native_probe(struct platform_device *pdev)
 		goto smem_alloc_fail;
 	}
 
+	key = "qcom,zero-copy-pool-size";
+	if (!of_property_read_u32(node, key, &einfo->zc_pool_size))
+		glink_smem_init_zc_pool(einfo, node);
+
 	key = "qcom,qos-config";
 	phandle_node = of_parse_phandle(node, key, 0);
 	if (phandle_node && !(of_get_glink_core_qos_cfg(phandle_node,
@@ -2624,6 +2943,7 @@ static int glink_smem_native_probe(struct platform_device *pdev)
 	kthread_flush_worker(&einfo->kworker);
 	kthread_stop(einfo->task);
 	einfo->task = NULL;
+	kfree(einfo->zc_tx_map);
 kthread_fail:
 	iounmap(einfo->out_irq_reg);
 ioremap_fail:
@@ -25,6 +25,7 @@
 #include <linux/err.h>
 #include <linux/mfd/syscon.h>
 #include <linux/regmap.h>
+#include <linux/workqueue.h>
 #include <linux/soc/qcom/llcc-qcom.h>
 
 #define ACTIVATE                      0x1
@@ -54,12 +55,47 @@
 #define LLCC_TRP_ATTR0_CFGn(n) (0x21000 + 0x8 * n)
 #define LLCC_TRP_ATTR1_CFGn(n) (0x21004 + 0x8 * n)
 
+#define LLCC_TRP_STATUS_CUR_CAP_MASK  0x3fff0000
+#define LLCC_TRP_STATUS_CUR_CAP_SHIFT 0x10
+
+/* Default bandwidth vote that makes the policy activate a slice */
+#define LLCC_POLICY_BW_MBPS	100
+/* Default time a slice stays active after its clients went idle */
+#define LLCC_POLICY_IDLE_MS	100
+
+/**
+ * struct llcc_slice_policy - Policy state of one slice
+ * @bw_mbps: Sum of the bandwidth votes of the clients
+ * @busy: Number of clients that reported activity
+ * @managed: The policy activated the slice and will deactivate it
+ * @idle: The clients went idle and the slice is waiting to be deactivated
+ * @idle_since: jiffies when @idle was set
+ * @active_since: jiffies when the policy activated the slice
+ * @activations: Number of activations done by the policy
+ * @active_ms: Time the policy held the slice active, up to the last
+ * deactivation
+ */
+struct llcc_slice_policy {
+	u32 bw_mbps;
+	u32 busy;
+	bool managed;
+	bool idle;
+	unsigned long idle_since;
+	unsigned long active_since;
+	u64 activations;
+	u64 active_ms;
+};
+
 /**
  * Driver data for llcc
  * @llcc_virt_base: base address for llcc controller
  * @slice_data: pointer to llcc slice config data
  * @sz: Size of the config data table
  * @llcc_slice_map: Bit map to track the active slice ids
+ * @policy: Policy state indexed by slice id, protected by slice_mutex
+ * @policy_work: Deactivates the slices whose clients are idle
+ * @policy_bw_mbps: Bandwidth vote that activates a slice
+ * @policy_idle_ms: Time an idle slice stays active
  */
 struct llcc_drv_data {
 	struct regmap *llcc_map;
@@ -70,6 +106,10 @@ struct llcc_drv_data {
 	u32 b_off;
 	u32 no_banks;
 	unsigned long *llcc_slice_map;
+	struct llcc_slice_policy *policy;
+	struct delayed_work policy_work;
+	u32 policy_bw_mbps;
+	u32 policy_idle_ms;
 };
 
 /* Get the slice entry by index */
@@ -170,6 +210,10 @@ EXPORT_SYMBOL(llcc_slice_getd);
  */
 void llcc_slice_putd(struct llcc_slice_desc *desc)
 {
+	if (desc && (desc->bw_mbps || desc->busy)) {
+		llcc_slice_vote_bw(desc, 0);
+		llcc_slice_notify(desc, false);
+	}
 	kfree(desc);
 }
 EXPORT_SYMBOL(llcc_slice_putd);
@@ -204,6 +248,55 @@ static int llcc_update_act_ctrl(struct llcc_drv_data *drv, u32 sid,
 	return -ETIMEDOUT;
 }
 
+static int __llcc_slice_activate(struct llcc_drv_data *drv, u32 sid)
+{
+	u32 act_ctrl_val;
+	int rc;
+
+	if (test_bit(sid, drv->llcc_slice_map))
+		return 0;
+
+	act_ctrl_val = ACT_CTRL_OPCODE_ACTIVATE << ACT_CTRL_OPCODE_SHIFT;
+	act_ctrl_val |= ACT_CTRL_ACT_TRIG;
+
+	rc = llcc_update_act_ctrl(drv, sid, act_ctrl_val, DEACTIVATE);
+
+	__set_bit(sid, drv->llcc_slice_map);
+
+	return rc;
+}
+
+static int __llcc_slice_deactivate(struct llcc_drv_data *drv, u32 sid)
+{
+	u32 act_ctrl_val;
+	int rc;
+
+	if (!test_bit(sid, drv->llcc_slice_map))
+		return 0;
+
+	act_ctrl_val = ACT_CTRL_OPCODE_DEACTIVATE << ACT_CTRL_OPCODE_SHIFT;
+	act_ctrl_val |= ACT_CTRL_ACT_TRIG;
+
+	rc = llcc_update_act_ctrl(drv, sid, act_ctrl_val, ACTIVATE);
+
+	__clear_bit(sid, drv->llcc_slice_map);
+
+	return rc;
+}
+
+/* Stop the policy managing a slice and account its active time */
+static void llcc_policy_release(struct llcc_drv_data *drv, u32 sid)
+{
+	struct llcc_slice_policy *policy = &drv->policy[sid];
+
+	if (!policy->managed)
+		return;
+
+	policy->active_ms += jiffies_to_msecs(jiffies - policy->active_since);
+	policy->managed = false;
+	policy->idle = false;
+}
+
 /**
  * llcc_slice_activate - Activate the llcc slice
  * @desc: Pointer to llcc slice descriptor
@@ -214,7 +307,6 @@ static int llcc_update_act_ctrl(struct llcc_drv_data *drv, u32 sid,
 int llcc_slice_activate(struct llcc_slice_desc *desc)
 {
 	int rc = -EINVAL;
-	u32 act_ctrl_val;
 	struct llcc_drv_data *drv;
 
 	if (desc == NULL) {
@@ -229,18 +321,10 @@ int llcc_slice_activate(struct llcc_slice_desc *desc)
 	}
 
 	mutex_lock(&drv->slice_mutex);
-	if (test_bit(desc->llcc_slice_id, drv->llcc_slice_map)) {
-		mutex_unlock(&drv->slice_mutex);
-		return 0;
-	}
-
-	act_ctrl_val = ACT_CTRL_OPCODE_ACTIVATE << ACT_CTRL_OPCODE_SHIFT;
-	act_ctrl_val |= ACT_CTRL_ACT_TRIG;
-
-	rc = llcc_update_act_ctrl(drv, desc->llcc_slice_id, act_ctrl_val,
-				  DEACTIVATE);
-
-	__set_bit(desc->llcc_slice_id, drv->llcc_slice_map);
+	/* An explicit activate takes the slice back from the policy */
+	if (drv->policy && desc->llcc_slice_id < drv->max_slices)
+		llcc_policy_release(drv, desc->llcc_slice_id);
+	rc = __llcc_slice_activate(drv, desc->llcc_slice_id);
 	mutex_unlock(&drv->slice_mutex);
 
 	return rc;
@@ -256,7 +340,6 @@ EXPORT_SYMBOL(llcc_slice_activate);
  */
 int llcc_slice_deactivate(struct llcc_slice_desc *desc)
 {
-	u32 act_ctrl_val;
 	int rc = -EINVAL;
 	struct llcc_drv_data *drv;
 
@@ -272,22 +355,161 @@ int llcc_slice_deactivate(struct llcc_slice_desc *desc)
 	}
 
 	mutex_lock(&drv->slice_mutex);
-	if (!test_bit(desc->llcc_slice_id, drv->llcc_slice_map)) {
-		mutex_unlock(&drv->slice_mutex);
-		return 0;
+	/* An explicit deactivate takes the slice back from the policy */
+	if (drv->policy && desc->llcc_slice_id < drv->max_slices)
+		llcc_policy_release(drv, desc->llcc_slice_id);
+	rc = __llcc_slice_deactivate(drv, desc->llcc_slice_id);
+	mutex_unlock(&drv->slice_mutex);
+
+	return rc;
+}
+EXPORT_SYMBOL(llcc_slice_deactivate);
+
+static struct llcc_drv_data *llcc_policy_drv(struct llcc_slice_desc *desc)
+{
+	struct llcc_drv_data *drv;
+
+	if (desc == NULL) {
+		pr_err("Input descriptor supplied is invalid\n");
+		return NULL;
 	}
-	act_ctrl_val = ACT_CTRL_OPCODE_DEACTIVATE << ACT_CTRL_OPCODE_SHIFT;
-	act_ctrl_val |= ACT_CTRL_ACT_TRIG;
 
-	rc = llcc_update_act_ctrl(drv, desc->llcc_slice_id, act_ctrl_val,
-				  ACTIVATE);
+	drv = dev_get_drvdata(desc->dev);
+	if (!drv || !drv->policy || desc->llcc_slice_id < 0 ||
+	    desc->llcc_slice_id >= drv->max_slices) {
+		pr_err("Invalid device pointer in the desc\n");
+		return NULL;
+	}
+
+	return drv;
+}
+
+/* Activate or schedule the deactivation of a slice, slice_mutex held */
+static void llcc_policy_update(struct llcc_drv_data *drv, u32 sid)
+{
+	struct llcc_slice_policy *policy = &drv->policy[sid];
+
+	if (policy->busy || policy->bw_mbps >= drv->policy_bw_mbps) {
+		policy->idle = false;
+		if (test_bit(sid, drv->llcc_slice_map))
+			return;
+
+		if (__llcc_slice_activate(drv, sid)) {
+			pr_err("activate slice id: %d timed out\n", sid);
+			return;
+		}
+
+		policy->managed = true;
+		policy->active_since = jiffies;
+		policy->activations++;
+		return;
+	}
+
+	if (!policy->managed || policy->idle)
+		return;
+
+	policy->idle = true;
+	policy->idle_since = jiffies;
+	mod_delayed_work(system_wq, &drv->policy_work,
+			 msecs_to_jiffies(drv->policy_idle_ms));
+}
+
+static void llcc_policy_work(struct work_struct *work)
+{
+	struct llcc_drv_data *drv = container_of(to_delayed_work(work),
+					struct llcc_drv_data, policy_work);
+	unsigned long idle = msecs_to_jiffies(drv->policy_idle_ms);
+	unsigned long next = 0;
+	struct llcc_slice_policy *policy;
+	u32 sid;
+
+	mutex_lock(&drv->slice_mutex);
+	for (sid = 0; sid < drv->max_slices; sid++) {
+		policy = &drv->policy[sid];
+		if (!policy->managed || !policy->idle)
+			continue;
+
+		if (time_before(jiffies, policy->idle_since + idle)) {
+			if (!next || time_before(policy->idle_since + idle,
+						 next))
+				next = policy->idle_since + idle;
+			continue;
+		}
+
+		llcc_policy_release(drv, sid);
+		if (__llcc_slice_deactivate(drv, sid))
+			pr_err("deactivate slice id: %d timed out\n", sid);
+	}
 
-	__clear_bit(desc->llcc_slice_id, drv->llcc_slice_map);
+	if (next)
+		mod_delayed_work(system_wq, &drv->policy_work,
+				 time_after(next, jiffies) ? next - jiffies : 0);
 	mutex_unlock(&drv->slice_mutex);
+}
 
-	return rc;
+/**
+ * llcc_slice_vote_bw - vote the bandwidth a client moves through its slice
+ * @desc: Pointer to llcc slice descriptor
+ * @mbps: Bandwidth in MB/s, zero to drop the vote
+ *
+ * The slice is activated while the sum of the votes of its clients is at
+ * or above the policy threshold, and deactivated once it has been below the
+ * threshold with no busy client for the policy idle time. Slices that were
+ * activated with llcc_slice_activate() are never deactivated by the policy.
+ *
+ * A value zero will be returned on success and a negative errno will
+ * be returned in error cases
+ */
+int llcc_slice_vote_bw(struct llcc_slice_desc *desc, u32 mbps)
+{
+	struct llcc_drv_data *drv = llcc_policy_drv(desc);
+
+	if (!drv)
+		return -EINVAL;
+
+	mutex_lock(&drv->slice_mutex);
+	drv->policy[desc->llcc_slice_id].bw_mbps -= desc->bw_mbps;
+	drv->policy[desc->llcc_slice_id].bw_mbps += mbps;
+	desc->bw_mbps = mbps;
+	llcc_policy_update(drv, desc->llcc_slice_id);
+	mutex_unlock(&drv->slice_mutex);
+
+	return 0;
 }
-EXPORT_SYMBOL(llcc_slice_deactivate);
+EXPORT_SYMBOL(llcc_slice_vote_bw);
+
+/**
+ * llcc_slice_notify - tell the policy whether a client is using its slice
+ * @desc: Pointer to llcc slice descriptor
+ * @busy: True when the client starts working, false when it goes idle
+ *
+ * The slice is kept active while any of its clients is busy, whatever
+ * their bandwidth votes are.
+ *
+ * A value zero will be returned on success and a negative errno will
+ * be returned in error cases
+ */
+int llcc_slice_notify(struct llcc_slice_desc *desc, bool busy)
+{
+	struct llcc_drv_data *drv = llcc_policy_drv(desc);
+
+	if (!drv)
+		return -EINVAL;
+
+	mutex_lock(&drv->slice_mutex);
+	if (desc->busy != busy) {
+		desc->busy = busy;
+		if (busy)
+			drv->policy[desc->llcc_slice_id].busy++;
+		else
+			drv->policy[desc->llcc_slice_id].busy--;
+		llcc_policy_update(drv, desc->llcc_slice_id);
+	}
+	mutex_unlock(&drv->slice_mutex);
+
+	return 0;
+}
+EXPORT_SYMBOL(llcc_slice_notify);
 
 /**
  * llcc_get_slice_id - return the slice id
@@ -321,6 +543,117 @@ size_t llcc_get_slice_size(struct llcc_slice_desc *desc)
 }
 EXPORT_SYMBOL(llcc_get_slice_size);
 
+static ssize_t slice_policy_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct llcc_drv_data *drv = dev_get_drvdata(dev);
+	const struct llcc_slice_config *cfg;
+	struct llcc_slice_policy *policy;
+	u32 i, status, cap;
+	u64 active_ms;
+	ssize_t cnt;
+
+	cnt = scnprintf(buf, PAGE_SIZE, "%-12s %4s %8s %4s %8s %8s %11s %12s\n",
+			"NAME", "SCID", "MBPS", "BUSY", "STATE", "CAP_KB",
+			"ACTIVATIONS", "ACTIVE_MS");
+
+	mutex_lock(&drv->slice_mutex);
+	for (i = 0; i < drv->llcc_config_data_sz; i++) {
+		cfg = &drv->slice_data[i];
+		policy = &drv->policy[cfg->slice_id];
+
+		regmap_read(drv->llcc_map,
+			    drv->b_off + LLCC_TRP_STATUSn(cfg->slice_id),
+			    &status);
+		cap = (status & LLCC_TRP_STATUS_CUR_CAP_MASK) >>
+			LLCC_TRP_STATUS_CUR_CAP_SHIFT;
+		/* The status reports the cache lines held in one bank */
+		cap = ((cap << CACHE_LINE_SIZE_SHIFT) * drv->no_banks) >> 10;
+
+		active_ms = policy->active_ms;
+		if (policy->managed)
+			active_ms += jiffies_to_msecs(jiffies -
+						      policy->active_since);
+
+		cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt,
+				 "%-12s %4d %8u %4u %8s %8u %11llu %12llu\n",
+				 cfg->name, cfg->slice_id, policy->bw_mbps,
+				 policy->busy,
+				 !test_bit(cfg->slice_id, drv->llcc_slice_map) ?
+				 "inactive" : policy->managed ? "policy" :
+				 "client", cap, policy->activations, active_ms);
+	}
+	mutex_unlock(&drv->slice_mutex);
+
+	return cnt;
+}
+
+static ssize_t policy_bw_mbps_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct llcc_drv_data *drv = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", drv->policy_bw_mbps);
+}
+
+static ssize_t policy_bw_mbps_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct llcc_drv_data *drv = dev_get_drvdata(dev);
+	u32 val, sid;
+
+	if (kstrtou32(buf, 0, &val) || !val)
+		return -EINVAL;
+
+	mutex_lock(&drv->slice_mutex);
+	drv->policy_bw_mbps = val;
+	for (sid = 0; sid < drv->max_slices; sid++)
+		if (drv->policy[sid].bw_mbps || drv->policy[sid].managed)
+			llcc_policy_update(drv, sid);
+	mutex_unlock(&drv->slice_mutex);
+
+	return count;
+}
+
+static ssize_t policy_idle_ms_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct llcc_drv_data *drv = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", drv->policy_idle_ms);
+}
+
+static ssize_t policy_idle_ms_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct llcc_drv_data *drv = dev_get_drvdata(dev);
+	u32 val;
+
+	if (kstrtou32(buf, 0, &val))
+		return -EINVAL;
+
+	mutex_lock(&drv->slice_mutex);
+	drv->policy_idle_ms = val;
+	mutex_unlock(&drv->slice_mutex);
+
+	return count;
+}
+
+static DEVICE_ATTR_RO(slice_policy);
+static DEVICE_ATTR_RW(policy_bw_mbps);
+static DEVICE_ATTR_RW(policy_idle_ms);
+
+static struct attribute *llcc_policy_attrs[] = {
+	&dev_attr_slice_policy.attr,
+	&dev_attr_policy_bw_mbps.attr,
+	&dev_attr_policy_idle_ms.attr,
+	NULL,
+};
+
+static struct attribute_group llcc_policy_group = {
+	.attrs	= llcc_policy_attrs,
+};
+
 static void qcom_llcc_cfg_program(struct platform_device *pdev)
 {
 	int i;
@@ -429,6 +762,19 @@ int qcom_llcc_probe(struct platform_device *pdev,
 	}
 
 	bitmap_zero(drv_data->llcc_slice_map, drv_data->max_slices);
+
+	drv_data->policy = devm_kcalloc(dev, drv_data->max_slices,
+					sizeof(*drv_data->policy), GFP_KERNEL);
+	if (!drv_data->policy) {
+		kfree(drv_data->llcc_slice_map);
+		devm_kfree(&pdev->dev, drv_data);
+		return -ENOMEM;
+	}
+
+	drv_data->policy_bw_mbps = LLCC_POLICY_BW_MBPS;
+	drv_data->policy_idle_ms = LLCC_POLICY_IDLE_MS;
+	INIT_DELAYED_WORK(&drv_data->policy_work, llcc_policy_work);
+
 	drv_data->slice_data = llcc_cfg;
 	drv_data->llcc_config_data_sz = sz;
 	mutex_init(&drv_data->slice_mutex);
@@ -436,6 +782,9 @@ int qcom_llcc_probe(struct platform_device *pdev,
 
 	qcom_llcc_cfg_program(pdev);
 
+	if (sysfs_create_group(&pdev->dev.kobj, &llcc_policy_group))
+		dev_err(&pdev->dev, "Unable to create policy sysfs group\n");
+
 	return rc;
 }
 EXPORT_SYMBOL(qcom_llcc_probe);
@@ -446,6 +795,8 @@ int qcom_llcc_remove(struct platform_device *pdev)
 
 	drv_data = platform_get_drvdata(pdev);
 
+	sysfs_remove_group(&pdev->dev.kobj, &llcc_policy_group);
+	cancel_delayed_work_sync(&drv_data->policy_work);
 	mutex_destroy(&drv_data->slice_mutex);
 	kfree(drv_data->llcc_slice_map);
 	devm_kfree(&pdev->dev, drv_data);
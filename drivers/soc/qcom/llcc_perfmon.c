@@ -22,6 +22,8 @@
 #include <linux/io.h>
 #include <linux/err.h>
 #include <linux/hrtimer.h>
+#include <linux/delay.h>
+#include <linux/math64.h>
 #include <linux/mfd/syscon.h>
 #include <linux/regmap.h>
 #include <linux/soc/qcom/llcc-qcom.h>
@@ -35,6 +37,7 @@
 #define NUM_CHANNELS			16
 #define MAX_STRING_SIZE			20
 #define DELIM_CHAR			" "
+#define HIT_RATE_SAMPLE_MS		20
 
 /**
  * struct llcc_perfmon_counter_map	- llcc perfmon counter map info
@@ -607,6 +610,82 @@ static ssize_t perfmon_scid_status_show(struct device *dev,
 	return cnt;
 }
 
+static unsigned long long perfmon_counter_total(
+		struct llcc_perfmon_private *llcc_priv, unsigned int counter)
+{
+	unsigned long long total = 0;
+	unsigned int j;
+	uint32_t val;
+
+	for (j = 0; j < llcc_priv->num_banks; j++) {
+		regmap_read(llcc_priv->llcc_map, llcc_priv->bank_off[j] +
+				LLCC_COUNTER_n_VALUE(counter), &val);
+		total += val;
+	}
+
+	return total;
+}
+
+/*
+ * Sample the TRP accesses and hits of every active SCID in turn, each for
+ * HIT_RATE_SAMPLE_MS. Hits are reads and writes that did not go to DDR, so
+ * hits per second shows which slices actually save DDR traffic. The
+ * counters are borrowed, so this fails while perfmon_configure is in use.
+ */
+static ssize_t perfmon_slice_hit_rate_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct llcc_perfmon_private *llcc_priv = dev_get_drvdata(dev);
+	struct event_port_ops *port_ops = llcc_priv->port_ops[EVENT_PORT_TRP];
+	unsigned long long access, hit;
+	uint32_t val, mask;
+	unsigned int i;
+	ssize_t cnt;
+
+	mutex_lock(&llcc_priv->mutex);
+	if (llcc_priv->configured_counters) {
+		pr_err("Counters configured already, remove & try again\n");
+		mutex_unlock(&llcc_priv->mutex);
+		return -EBUSY;
+	}
+
+	llcc_priv->filtered_ports |= 1 << EVENT_PORT_TRP;
+	port_ops->event_config(llcc_priv, TRP_ANY_ACCESS, 0, true);
+	port_ops->event_config(llcc_priv, TRP_ANY_HIT, 1, true);
+
+	cnt = scnprintf(buf, PAGE_SIZE, "SCID %12s %12s %4s\n",
+			"ACCESS/S", "HIT/S", "HIT%");
+	mask = PERFMON_MODE_MONITOR_MODE_MASK | PERFMON_MODE_MONITOR_EN_MASK;
+	for (i = 0; i < SCID_MAX; i++) {
+		llcc_bcast_read(llcc_priv, TRP_SCID_n_STATUS(i), &val);
+		if (!(val & TRP_SCID_STATUS_ACTIVE_MASK))
+			continue;
+
+		port_ops->event_filter_config(llcc_priv, SCID, i, true);
+		llcc_bcast_modify(llcc_priv, PERFMON_MODE,
+				MANUAL_MODE | MONITOR_EN, mask);
+		msleep(HIT_RATE_SAMPLE_MS);
+		llcc_bcast_write(llcc_priv, PERFMON_DUMP, MONITOR_DUMP);
+		llcc_bcast_modify(llcc_priv, PERFMON_MODE, 0, mask);
+
+		access = perfmon_counter_total(llcc_priv, 0);
+		hit = perfmon_counter_total(llcc_priv, 1);
+		cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt,
+				"%4d %12llu %12llu %4llu\n", i,
+				access * MSEC_PER_SEC / HIT_RATE_SAMPLE_MS,
+				hit * MSEC_PER_SEC / HIT_RATE_SAMPLE_MS,
+				access ? div64_u64(hit * 100, access) : 0);
+	}
+
+	port_ops->event_filter_config(llcc_priv, SCID, 0, false);
+	port_ops->event_config(llcc_priv, TRP_ANY_HIT, 1, false);
+	port_ops->event_config(llcc_priv, TRP_ANY_ACCESS, 0, false);
+	llcc_priv->filtered_ports &= ~(1 << EVENT_PORT_TRP);
+	mutex_unlock(&llcc_priv->mutex);
+
+	return cnt;
+}
+
 static DEVICE_ATTR_RO(perfmon_counter_dump);
 static DEVICE_ATTR_WO(perfmon_configure);
 static DEVICE_ATTR_WO(perfmon_remove);
@@ -615,6 +694,7 @@ static DEVICE_ATTR_WO(perfmon_filter_remove);
 static DEVICE_ATTR_WO(perfmon_start);
 static DEVICE_ATTR_RO(perfmon_scid_status);
 static DEVICE_ATTR_WO(perfmon_ns_periodic_dump);
+static DEVICE_ATTR_RO(perfmon_slice_hit_rate);
 
 static struct attribute *llcc_perfmon_attrs[] = {
 	&dev_attr_perfmon_counter_dump.attr,
@@ -625,6 +705,7 @@ static struct attribute *llcc_perfmon_attrs[] = {
 	&dev_attr_perfmon_start.attr,
 	&dev_attr_perfmon_scid_status.attr,
 	&dev_attr_perfmon_ns_periodic_dump.attr,
+	&dev_attr_perfmon_slice_hit_rate.attr,
 	NULL,
 };
 
@@ -14,6 +14,7 @@
 #include <linux/module.h>
 #include <linux/kernel.h>
 #include <linux/init.h>
+#include <linux/math64.h>
 #include <linux/spinlock.h>
 #include <linux/uaccess.h>
 #include <linux/proc_fs.h>
@@ -23,14 +24,25 @@
 #include <linux/slab.h>
 #include <linux/smp.h>
 #include <linux/suspend.h>
+#include <linux/log2.h>
+#include <linux/interrupt.h>
 #include <soc/qcom/spm.h>
 #include <soc/qcom/pm.h>
 #include <soc/qcom/lpm-stats.h>
+#include <trace/events/irq.h>
+#include <trace/events/timer.h>
 
 #define MAX_STR_LEN 256
 #define MAX_TIME_LEN 20
+/* Residency histogram bucket i counts sleeps of [2^i, 2^(i+1)) us */
+#define LPM_RESIDENCY_BUCKETS 25
+#define LPM_WAKE_SOURCES 16
 const char *lpm_stats_reset = "reset";
 const char *lpm_stats_suspend = "suspend";
+static const char * const lpm_pred_names[LPM_PRED_NR] = {
+	[LPM_PRED_HEURISTIC] = "heuristic",
+	[LPM_PRED_HISTOGRAM] = "histogram",
+};
 
 struct lpm_sleep_time {
 	struct kobj_attribute ts_attr;
@@ -48,11 +60,41 @@ struct level_stats {
 	int failed_count;
 	uint64_t total_time;
 	uint64_t enter_time;
+	uint32_t residency[LPM_RESIDENCY_BUCKETS];
+};
+
+/*
+ * What ended a cpu's sleep: the first irq handled after the exit, unless an
+ * hrtimer expired from it. When that hrtimer is the tick, the first
+ * timer_list callback run from the following timer softirq names it better.
+ */
+enum lpm_wake_type {
+	LPM_WAKE_NONE,
+	LPM_WAKE_PENDING,
+	LPM_WAKE_IRQ,
+	LPM_WAKE_HRTIMER,
+	LPM_WAKE_TIMER,
+};
+
+struct lpm_wake_source {
+	enum lpm_wake_type type;
+	unsigned long id;
+	uint32_t count;
+};
+
+/* Only written from its own cpu, read locklessly through debugfs */
+struct lpm_wake_stats {
+	enum lpm_wake_type state;
+	unsigned long id;
+	struct lpm_wake_source source[LPM_WAKE_SOURCES];
+	uint32_t unknown;
+	uint32_t other;
 };
 
 static struct level_stats suspend_time_stats;
 
 static DEFINE_PER_CPU_SHARED_ALIGNED(struct lpm_stats, cpu_stats);
+static DEFINE_PER_CPU(struct lpm_wake_stats, wake_stats);
 
 static uint64_t get_total_sleep_time(unsigned int cpu_id)
 {
@@ -79,6 +121,12 @@ static void update_level_stats(struct level_stats *stats, uint64_t t,
 
 	stats->success_count++;
 	stats->total_time += t;
+
+	bt = t;
+	do_div(bt, NSEC_PER_USEC);
+	i = bt ? ilog2(bt) : 0;
+	stats->residency[min(i, LPM_RESIDENCY_BUCKETS - 1)]++;
+
 	bt = t;
 	do_div(bt, stats->first_bucket_time);
 
@@ -188,6 +236,7 @@ static void level_stats_reset(struct level_stats *stats)
 	memset(stats->bucket, 0, sizeof(stats->bucket));
 	memset(stats->min_time, 0, sizeof(stats->min_time));
 	memset(stats->max_time, 0, sizeof(stats->max_time));
+	memset(stats->residency, 0, sizeof(stats->residency));
 	stats->success_count = 0;
 	stats->failed_count = 0;
 	stats->total_time = 0;
@@ -263,6 +312,8 @@ static void reset_cpu_stats(void *info)
 
 	for (i = 0; i < stats->num_levels; i++)
 		level_stats_reset(&stats->time_stats[i]);
+	memset(stats->pred, 0, sizeof(stats->pred));
+	memset(this_cpu_ptr(&wake_stats), 0, sizeof(struct lpm_wake_stats));
 }
 
 static ssize_t lpm_stats_file_write(struct file *file,
@@ -296,6 +347,136 @@ static ssize_t lpm_stats_file_write(struct file *file,
 	return count;
 }
 
+static int pred_stats_file_show(struct seq_file *m, void *v)
+{
+	struct lpm_stats *stats = (struct lpm_stats *)m->private;
+	struct lpm_pred_stats *pred;
+	uint64_t total, pct;
+	int i;
+
+	if (!m->private)
+		return -EINVAL;
+
+	for (i = 0; i < LPM_PRED_NR; i++) {
+		pred = &stats->pred[i];
+		total = (uint64_t)pred->hit + pred->too_shallow +
+			pred->too_deep;
+		pct = total ? div64_u64((uint64_t)pred->hit * 100, total) : 0;
+		seq_printf(m,
+			"[%s] %s:\n"
+			"  hit: %u (%llu%%)\n"
+			"  too shallow: %u\n"
+			"  too deep: %u\n",
+			stats->name, lpm_pred_names[i], pred->hit, pct,
+			pred->too_shallow, pred->too_deep);
+	}
+
+	return 0;
+}
+
+static int pred_stats_file_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pred_stats_file_show, inode->i_private);
+}
+
+static ssize_t pred_stats_file_write(struct file *file,
+	const char __user *buffer, size_t count, loff_t *off)
+{
+	char buf[MAX_STR_LEN] = {0};
+	struct inode *in = file->f_inode;
+	struct lpm_stats *stats = (struct lpm_stats *)in->i_private;
+	size_t len = strnlen(lpm_stats_reset, MAX_STR_LEN);
+
+	if (!stats)
+		return -EINVAL;
+
+	if (count != len+1)
+		return -EINVAL;
+
+	if (copy_from_user(buf, buffer, len))
+		return -EFAULT;
+
+	if (strcmp(buf, lpm_stats_reset))
+		return -EINVAL;
+
+	memset(stats->pred, 0, sizeof(stats->pred));
+
+	return count;
+}
+
+static int residency_stats_file_show(struct seq_file *m, void *v)
+{
+	struct lpm_stats *stats = (struct lpm_stats *)m->private;
+	struct level_stats *level;
+	int i, j;
+
+	if (!m->private)
+		return -EINVAL;
+
+	for (i = 0; i < stats->num_levels; i++) {
+		level = &stats->time_stats[i];
+		seq_printf(m, "[%s] %s:\n", stats->name, level->name);
+		for (j = 0; j < LPM_RESIDENCY_BUCKETS - 1; j++) {
+			if (level->residency[j])
+				seq_printf(m, "  <%8lu us: %u\n", 2UL << j,
+					level->residency[j]);
+		}
+		if (level->residency[j])
+			seq_printf(m, "  >=%7lu us: %u\n", 1UL << j,
+				level->residency[j]);
+	}
+
+	return 0;
+}
+
+static int residency_stats_file_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, residency_stats_file_show, inode->i_private);
+}
+
+static int wake_stats_file_show(struct seq_file *m, void *v)
+{
+	struct lpm_stats *stats = (struct lpm_stats *)m->private;
+	struct lpm_wake_stats *wake;
+	struct lpm_wake_source *src;
+	int cpu, i;
+
+	if (!m->private)
+		return -EINVAL;
+
+	cpu = cpumask_first(&stats->mask);
+	wake = &per_cpu(wake_stats, cpu);
+
+	seq_printf(m, "[%s] wakeups:\n", stats->name);
+	for (i = 0; i < LPM_WAKE_SOURCES; i++) {
+		src = &wake->source[i];
+		switch (READ_ONCE(src->type)) {
+		case LPM_WAKE_IRQ:
+			seq_printf(m, "  irq %lu: %u\n", src->id, src->count);
+			break;
+		case LPM_WAKE_HRTIMER:
+			seq_printf(m, "  hrtimer %pf: %u\n", (void *)src->id,
+				src->count);
+			break;
+		case LPM_WAKE_TIMER:
+			seq_printf(m, "  timer %pf: %u\n", (void *)src->id,
+				src->count);
+			break;
+		default:
+			break;
+		}
+	}
+	seq_printf(m, "  unknown: %u\n  other: %u\n", wake->unknown,
+		wake->other);
+
+	return 0;
+}
+
+static int wake_stats_file_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wake_stats_file_show, inode->i_private);
+}
+
 int lifo_stats_file_show(struct seq_file *m, void *v)
 {
 	struct lpm_stats *stats = NULL;
@@ -325,6 +506,19 @@ int lifo_stats_file_show(struct seq_file *m, void *v)
 			pos->lifo.first_out);
 		seq_puts(m, seqs);
 	}
+
+	snprintf(seqs, MAX_STR_LEN,
+		"%s prediction:\n"
+		"\tShared estimate:%u\n"
+		"\tCPU scan:%u\n"
+		"\tTimer armed:%u\n"
+		"\tTimer avoided:%u\n",
+		stats->name,
+		stats->cluster_pred[LPM_CLUSTER_PRED_SHARED],
+		stats->cluster_pred[LPM_CLUSTER_PRED_SCAN],
+		stats->cluster_pred[LPM_CLUSTER_PRED_TIMER_ARMED],
+		stats->cluster_pred[LPM_CLUSTER_PRED_TIMER_AVOIDED]);
+	seq_puts(m, seqs);
 	return 0;
 }
 
@@ -368,6 +562,7 @@ static ssize_t lifo_stats_file_write(struct file *file,
 		return -EINVAL;
 
 	lifo_stats_reset_all(stats);
+	memset(stats->cluster_pred, 0, sizeof(stats->cluster_pred));
 
 	return count;
 }
@@ -399,6 +594,31 @@ static const struct file_operations lifo_stats_fops = {
 	.write	  = lifo_stats_file_write,
 };
 
+static const struct file_operations residency_stats_fops = {
+	.owner	  = THIS_MODULE,
+	.open	  = residency_stats_file_open,
+	.read	  = seq_read,
+	.release  = single_release,
+	.llseek   = no_llseek,
+};
+
+static const struct file_operations wake_stats_fops = {
+	.owner	  = THIS_MODULE,
+	.open	  = wake_stats_file_open,
+	.read	  = seq_read,
+	.release  = single_release,
+	.llseek   = no_llseek,
+};
+
+static const struct file_operations pred_stats_fops = {
+	.owner	  = THIS_MODULE,
+	.open	  = pred_stats_file_open,
+	.read	  = seq_read,
+	.release  = single_release,
+	.llseek   = no_llseek,
+	.write	  = pred_stats_file_write,
+};
+
 static void update_last_in_stats(struct lpm_stats *stats)
 {
 	struct list_head *centry = NULL;
@@ -508,6 +728,11 @@ static int config_level(const char *name, const char **levels,
 		return -EPERM;
 	}
 
+	if (!debugfs_create_file("residency", 0444, stats->directory,
+		(void *)stats, &residency_stats_fops))
+		pr_err("%s: Unable to create %s residency stats file\n",
+			__func__, stats->name);
+
 	return 0;
 }
 
@@ -628,6 +853,16 @@ static struct lpm_stats *config_cpu_level(const char *name,
 			return ERR_PTR(ret);
 		}
 
+		if (!debugfs_create_file("prediction", 0444, stats->directory,
+			(void *)stats, &pred_stats_fops))
+			pr_err("%s: Unable to create %s prediction stats file\n",
+				__func__, cpu_name);
+
+		if (!debugfs_create_file("wakeup", 0444, stats->directory,
+			(void *)stats, &wake_stats_fops))
+			pr_err("%s: Unable to create %s wakeup stats file\n",
+				__func__, cpu_name);
+
 		ret = create_sysfs_node(cpu, stats);
 
 		if (ret) {
@@ -728,6 +963,138 @@ static void lpm_stats_cleanup(struct lpm_stats *stats)
 	cleanup_stats(pstats);
 }
 
+/* Count what ended the last sleep of this cpu and close its attribution */
+static void account_wake_source(struct lpm_wake_stats *wake)
+{
+	struct lpm_wake_source *src;
+	int i;
+
+	if (wake->state == LPM_WAKE_NONE)
+		return;
+
+	if (wake->state == LPM_WAKE_PENDING) {
+		/* Woken by something that isn't an irq handler, e.g. an IPI */
+		wake->unknown++;
+		goto out;
+	}
+
+	for (i = 0; i < LPM_WAKE_SOURCES; i++) {
+		src = &wake->source[i];
+		if (src->type == LPM_WAKE_NONE) {
+			src->id = wake->id;
+			smp_wmb();
+			WRITE_ONCE(src->type, wake->state);
+		}
+		if (src->type == wake->state && src->id == wake->id) {
+			src->count++;
+			goto out;
+		}
+	}
+	wake->other++;
+out:
+	wake->state = LPM_WAKE_NONE;
+}
+
+static void wake_irq_entry_probe(void *data, int irq,
+				struct irqaction *action)
+{
+	struct lpm_wake_stats *wake = this_cpu_ptr(&wake_stats);
+
+	if (wake->state != LPM_WAKE_PENDING)
+		return;
+
+	wake->state = LPM_WAKE_IRQ;
+	wake->id = irq;
+}
+
+/*
+ * With no hrtimer run from it the waking irq is the wakeup source, and an
+ * hrtimer is unless it raised the timer softirq.
+ */
+static void wake_irq_exit_probe(void *data, int irq,
+				struct irqaction *action, int ret)
+{
+	struct lpm_wake_stats *wake = this_cpu_ptr(&wake_stats);
+
+	if ((wake->state == LPM_WAKE_IRQ && wake->id == irq) ||
+		(wake->state == LPM_WAKE_HRTIMER &&
+		!(local_softirq_pending() & BIT(TIMER_SOFTIRQ))))
+		account_wake_source(wake);
+}
+
+static void wake_hrtimer_probe(void *data, struct hrtimer *hrtimer,
+				ktime_t *now)
+{
+	struct lpm_wake_stats *wake = this_cpu_ptr(&wake_stats);
+
+	if (wake->state != LPM_WAKE_PENDING && wake->state != LPM_WAKE_IRQ)
+		return;
+
+	wake->state = LPM_WAKE_HRTIMER;
+	wake->id = (unsigned long)hrtimer->function;
+}
+
+/* The first timer_list callback run after the tick names the wakeup */
+static void wake_timer_probe(void *data, struct timer_list *timer)
+{
+	struct lpm_wake_stats *wake = this_cpu_ptr(&wake_stats);
+
+	if (wake->state != LPM_WAKE_HRTIMER)
+		return;
+
+	wake->state = LPM_WAKE_TIMER;
+	wake->id = (unsigned long)timer->function;
+	account_wake_source(wake);
+}
+
+static void wake_softirq_exit_probe(void *data, unsigned int vec_nr)
+{
+	struct lpm_wake_stats *wake = this_cpu_ptr(&wake_stats);
+
+	if (vec_nr == TIMER_SOFTIRQ && wake->state == LPM_WAKE_HRTIMER)
+		account_wake_source(wake);
+}
+
+static int __init lpm_stats_wake_init(void)
+{
+	int ret;
+
+	ret = register_trace_irq_handler_entry(wake_irq_entry_probe, NULL);
+	if (ret)
+		goto failed;
+
+	ret = register_trace_irq_handler_exit(wake_irq_exit_probe, NULL);
+	if (ret)
+		goto irq_exit_failed;
+
+	ret = register_trace_hrtimer_expire_entry(wake_hrtimer_probe, NULL);
+	if (ret)
+		goto hrtimer_failed;
+
+	ret = register_trace_timer_expire_entry(wake_timer_probe, NULL);
+	if (ret)
+		goto timer_failed;
+
+	ret = register_trace_softirq_exit(wake_softirq_exit_probe, NULL);
+	if (ret)
+		goto softirq_failed;
+
+	return 0;
+
+softirq_failed:
+	unregister_trace_timer_expire_entry(wake_timer_probe, NULL);
+timer_failed:
+	unregister_trace_hrtimer_expire_entry(wake_hrtimer_probe, NULL);
+hrtimer_failed:
+	unregister_trace_irq_handler_exit(wake_irq_exit_probe, NULL);
+irq_exit_failed:
+	unregister_trace_irq_handler_entry(wake_irq_entry_probe, NULL);
+failed:
+	pr_err("%s: Unable to attribute wakeups, ret: %d\n", __func__, ret);
+	return ret;
+}
+late_initcall(lpm_stats_wake_init);
+
 /**
  * lpm_stats_config_level() - API to configure levels stats.
  *
@@ -831,6 +1198,7 @@ void lpm_stats_cpu_enter(uint32_t index, uint64_t time)
 	if (!stats->time_stats)
 		return;
 
+	account_wake_source(this_cpu_ptr(&wake_stats));
 }
 EXPORT_SYMBOL(lpm_stats_cpu_enter);
 
@@ -852,9 +1220,54 @@ void lpm_stats_cpu_exit(uint32_t index, uint64_t time, bool success)
 	stats->sleep_time = time - stats->sleep_time;
 
 	update_exit_stats(stats, index, success);
+
+	if (success)
+		this_cpu_ptr(&wake_stats)->state = LPM_WAKE_PENDING;
 }
 EXPORT_SYMBOL(lpm_stats_cpu_exit);
 
+/**
+ * lpm_stats_cpu_predict() - API to score an idle state prediction.
+ *
+ * @type:	Predictor that made the choice.
+ * @level:	cpu's lpm level index the predictor chose.
+ * @ideal:	cpu's lpm level index the actual residency called for.
+ *
+ * Function to compare idle predictors on the running cpu.
+ */
+void lpm_stats_cpu_predict(enum lpm_pred_type type, int level, int ideal)
+{
+	struct lpm_stats *stats = &(*this_cpu_ptr(&(cpu_stats)));
+
+	if (!stats->time_stats || type >= LPM_PRED_NR)
+		return;
+
+	if (level == ideal)
+		stats->pred[type].hit++;
+	else if (level < ideal)
+		stats->pred[type].too_shallow++;
+	else
+		stats->pred[type].too_deep++;
+}
+EXPORT_SYMBOL(lpm_stats_cpu_predict);
+
+/**
+ * lpm_stats_cluster_pred() - API to count cluster prediction events.
+ *
+ * @stats:	Pointer to the cluster's lpm_stats object.
+ * @event:	Where the last cpu got the cluster's wakeup estimate from, or
+ *		whether it armed the cluster prediction timer.
+ */
+void lpm_stats_cluster_pred(struct lpm_stats *stats,
+			    enum lpm_cluster_pred_event event)
+{
+	if (IS_ERR_OR_NULL(stats) || event >= LPM_CLUSTER_PRED_NR)
+		return;
+
+	stats->cluster_pred[event]++;
+}
+EXPORT_SYMBOL(lpm_stats_cluster_pred);
+
 /**
  * lpm_stats_suspend_enter() - API to communicate system entering suspend.
  *
@@ -0,0 +1,528 @@
+/* Copyright (c) 2026, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#define pr_fmt(fmt) "mem_pool: " fmt
+
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/highmem.h>
+#include <linux/swap.h>
+#include <linux/shrinker.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <asm/cacheflush.h>
+#include <soc/qcom/mem_pool.h>
+
+/**
+ * struct mem_pool_order - Free pages of one order
+ * @lock: Protects the lists and counts
+ * @high_items: Highmem pages
+ * @low_items: Lowmem pages
+ * @high_count: Number of entries in @high_items
+ * @low_count: Number of entries in @low_items
+ * @reserved: Sum of all client reservations for this order, the shrinker
+ * never takes the pool below this many entries
+ */
+struct mem_pool_order {
+	spinlock_t lock;
+	struct list_head high_items;
+	struct list_head low_items;
+	int high_count;
+	int low_count;
+	unsigned int reserved;
+};
+
+/**
+ * struct mem_pool_client - A subsystem allocating from the shared pool
+ * @node: Entry in the list of registered clients
+ * @name: Name used in the statistics
+ * @id: Small integer stored in the pages the client donates
+ * @reserved: Number of entries of each order reserved by the client
+ * @hits: Allocations served from the pool
+ * @misses: Allocations that found the pool empty
+ * @borrowed: Hits on pages that another client gave back
+ * @donated: Pages given back to the pool by this client
+ */
+struct mem_pool_client {
+	struct list_head node;
+	const char *name;
+	unsigned long id;
+	unsigned int reserved[MAX_ORDER];
+	atomic_long_t hits;
+	atomic_long_t misses;
+	atomic_long_t borrowed;
+	atomic_long_t donated;
+};
+
+static struct mem_pool_order mem_pool_orders[MAX_ORDER];
+static LIST_HEAD(mem_pool_clients);
+static DEFINE_MUTEX(mem_pool_clients_lock);
+static unsigned long mem_pool_next_id = 1;
+static atomic_long_t mem_pool_total = ATOMIC_LONG_INIT(0);
+
+/* Upper bound on the number of 4K pages cached, 0 means no limit */
+static unsigned long max_pages;
+module_param(max_pages, ulong, 0644);
+
+static void mem_pool_zero_page(struct page *page, unsigned int order)
+{
+	int i;
+
+	for (i = 0; i < (1 << order); i++) {
+		void *addr = kmap_atomic(nth_page(page, i));
+
+		memset(addr, 0, PAGE_SIZE);
+		dmac_flush_range(addr, addr + PAGE_SIZE);
+		kunmap_atomic(addr);
+	}
+}
+
+/* The caller must hold the order lock */
+static void __mem_pool_add(struct mem_pool_order *po, struct page *page,
+		unsigned int order)
+{
+	if (PageHighMem(page)) {
+		list_add_tail(&page->lru, &po->high_items);
+		po->high_count++;
+	} else {
+		list_add_tail(&page->lru, &po->low_items);
+		po->low_count++;
+	}
+
+	mod_node_page_state(page_pgdat(page), NR_INDIRECTLY_RECLAIMABLE_BYTES,
+			(1 << (PAGE_SHIFT + order)));
+	atomic_long_add(1 << order, &mem_pool_total);
+}
+
+/* The caller must hold the order lock */
+static struct page *__mem_pool_remove(struct mem_pool_order *po,
+		unsigned int order, bool high)
+{
+	struct page *page;
+
+	if (high && po->high_count) {
+		page = list_first_entry(&po->high_items, struct page, lru);
+		po->high_count--;
+	} else if (po->low_count) {
+		page = list_first_entry(&po->low_items, struct page, lru);
+		po->low_count--;
+	} else {
+		return NULL;
+	}
+
+	list_del(&page->lru);
+	mod_node_page_state(page_pgdat(page), NR_INDIRECTLY_RECLAIMABLE_BYTES,
+			-(1 << (PAGE_SHIFT + order)));
+	atomic_long_sub(1 << order, &mem_pool_total);
+
+	return page;
+}
+
+/**
+ * mem_pool_get_list() - Take up to @nr pages of @order from the pool
+ * @client: The client allocating the pages
+ * @order: Page order
+ * @pages: List the pages are appended to, linked through page->lru
+ * @nr: Maximum number of pages to take
+ *
+ * Return the number of pages added to @pages
+ */
+int mem_pool_get_list(struct mem_pool_client *client, unsigned int order,
+		struct list_head *pages, int nr)
+{
+	struct mem_pool_order *po;
+	int count = 0, borrowed = 0;
+
+	if (client == NULL || order >= MAX_ORDER || nr <= 0)
+		return 0;
+
+	po = &mem_pool_orders[order];
+
+	spin_lock(&po->lock);
+	while (count < nr) {
+		struct page *page = __mem_pool_remove(po, order, true);
+
+		if (page == NULL)
+			break;
+
+		if (page_private(page) != client->id)
+			borrowed++;
+		set_page_private(page, 0);
+
+		list_add_tail(&page->lru, pages);
+		count++;
+	}
+	spin_unlock(&po->lock);
+
+	atomic_long_add(count, &client->hits);
+	atomic_long_add(borrowed, &client->borrowed);
+	if (count < nr)
+		atomic_long_inc(&client->misses);
+
+	return count;
+}
+EXPORT_SYMBOL(mem_pool_get_list);
+
+/**
+ * mem_pool_put_list() - Give pages of @order back to the pool
+ * @client: The client freeing the pages
+ * @order: Page order
+ * @pages: List of zeroed pages linked through page->lru, emptied on return
+ * @nr: Number of pages on @pages
+ *
+ * Pages above the max_pages limit are returned to the system instead.
+ */
+void mem_pool_put_list(struct mem_pool_client *client, unsigned int order,
+		struct list_head *pages, int nr)
+{
+	struct mem_pool_order *po;
+	struct page *page, *tmp;
+	LIST_HEAD(excess);
+
+	if (client == NULL || order >= MAX_ORDER)
+		return;
+
+	po = &mem_pool_orders[order];
+
+	spin_lock(&po->lock);
+	list_for_each_entry_safe(page, tmp, pages, lru) {
+		list_del(&page->lru);
+
+		if (max_pages &&
+			atomic_long_read(&mem_pool_total) >= max_pages) {
+			list_add(&page->lru, &excess);
+			continue;
+		}
+
+		set_page_private(page, client->id);
+		__mem_pool_add(po, page, order);
+	}
+	spin_unlock(&po->lock);
+
+	atomic_long_add(nr, &client->donated);
+
+	list_for_each_entry_safe(page, tmp, &excess, lru) {
+		list_del(&page->lru);
+		__free_pages(page, order);
+	}
+}
+EXPORT_SYMBOL(mem_pool_put_list);
+
+/**
+ * mem_pool_alloc() - Take one page of @order from the pool
+ * @client: The client allocating the page
+ * @order: Page order
+ *
+ * Return a zeroed page or NULL if the pool has none of this order
+ */
+struct page *mem_pool_alloc(struct mem_pool_client *client,
+		unsigned int order)
+{
+	LIST_HEAD(pages);
+
+	if (!mem_pool_get_list(client, order, &pages, 1))
+		return NULL;
+
+	return list_first_entry(&pages, struct page, lru);
+}
+EXPORT_SYMBOL(mem_pool_alloc);
+
+/**
+ * mem_pool_free() - Give one zeroed page of @order back to the pool
+ * @client: The client freeing the page
+ * @page: The page
+ * @order: Page order
+ */
+void mem_pool_free(struct mem_pool_client *client, struct page *page,
+		unsigned int order)
+{
+	LIST_HEAD(pages);
+
+	list_add(&page->lru, &pages);
+	mem_pool_put_list(client, order, &pages, 1);
+}
+EXPORT_SYMBOL(mem_pool_free);
+
+/**
+ * mem_pool_count() - Number of entries of @order in the pool
+ * @order: Page order
+ *
+ * The value is read without the lock, so it is only a hint.
+ */
+int mem_pool_count(unsigned int order)
+{
+	struct mem_pool_order *po;
+
+	if (order >= MAX_ORDER)
+		return 0;
+
+	po = &mem_pool_orders[order];
+	return READ_ONCE(po->high_count) + READ_ONCE(po->low_count);
+}
+EXPORT_SYMBOL(mem_pool_count);
+
+/**
+ * mem_pool_reserve() - Reserve and pre-allocate pages for a client
+ * @client: The client
+ * @order: Page order
+ * @count: Number of entries of @order to reserve
+ * @gfp_mask: Flags for allocating the reserved pages
+ *
+ * The reserved entries are allocated right away. The shrinker keeps at
+ * least as many entries of each order as all clients have reserved.
+ *
+ * Return 0 on success or -ENOMEM if not all @count pages could be allocated,
+ * in which case the pages that were allocated stay reserved
+ */
+int mem_pool_reserve(struct mem_pool_client *client, unsigned int order,
+		unsigned int count, gfp_t gfp_mask)
+{
+	struct mem_pool_order *po;
+	unsigned int i;
+
+	if (client == NULL || order >= MAX_ORDER)
+		return -EINVAL;
+
+	po = &mem_pool_orders[order];
+
+	if (order)
+		gfp_mask |= __GFP_COMP;
+
+	for (i = 0; i < count; i++) {
+		struct page *page = alloc_pages(gfp_mask, order);
+
+		if (page == NULL)
+			break;
+
+		mem_pool_zero_page(page, order);
+
+		spin_lock(&po->lock);
+		set_page_private(page, client->id);
+		__mem_pool_add(po, page, order);
+		po->reserved++;
+		spin_unlock(&po->lock);
+
+		client->reserved[order]++;
+	}
+
+	return i == count ? 0 : -ENOMEM;
+}
+EXPORT_SYMBOL(mem_pool_reserve);
+
+/**
+ * mem_pool_client_register() - Register a user of the shared pool
+ * @name: Name of the client, must stay valid until unregistration
+ *
+ * Return a client handle or NULL on failure
+ */
+struct mem_pool_client *mem_pool_client_register(const char *name)
+{
+	struct mem_pool_client *client;
+
+	client = kzalloc(sizeof(*client), GFP_KERNEL);
+	if (client == NULL)
+		return NULL;
+
+	client->name = name;
+	atomic_long_set(&client->hits, 0);
+	atomic_long_set(&client->misses, 0);
+	atomic_long_set(&client->borrowed, 0);
+	atomic_long_set(&client->donated, 0);
+
+	mutex_lock(&mem_pool_clients_lock);
+	client->id = mem_pool_next_id++;
+	list_add_tail(&client->node, &mem_pool_clients);
+	mutex_unlock(&mem_pool_clients_lock);
+
+	return client;
+}
+EXPORT_SYMBOL(mem_pool_client_register);
+
+/**
+ * mem_pool_client_unregister() - Unregister a user of the shared pool
+ * @client: The client handle
+ *
+ * The reservations of the client are dropped. Pages the client gave back
+ * stay in the pool until the shrinker frees them.
+ */
+void mem_pool_client_unregister(struct mem_pool_client *client)
+{
+	int order;
+
+	if (client == NULL)
+		return;
+
+	for (order = 0; order < MAX_ORDER; order++) {
+		struct mem_pool_order *po = &mem_pool_orders[order];
+
+		spin_lock(&po->lock);
+		po->reserved -= client->reserved[order];
+		spin_unlock(&po->lock);
+	}
+
+	mutex_lock(&mem_pool_clients_lock);
+	list_del(&client->node);
+	mutex_unlock(&mem_pool_clients_lock);
+
+	kfree(client);
+}
+EXPORT_SYMBOL(mem_pool_client_unregister);
+
+/* Returns the number of entries the shrinker may free from @po */
+static int mem_pool_order_shrinkable(struct mem_pool_order *po, bool high)
+{
+	int count = READ_ONCE(po->low_count);
+
+	if (high)
+		count += READ_ONCE(po->high_count);
+
+	return max_t(int, count - (int)READ_ONCE(po->reserved), 0);
+}
+
+static bool mem_pool_shrink_high(struct shrink_control *sc)
+{
+	return current_is_kswapd() || (sc->gfp_mask & __GFP_HIGHMEM);
+}
+
+static unsigned long mem_pool_shrink_count(struct shrinker *shrinker,
+		struct shrink_control *sc)
+{
+	bool high = mem_pool_shrink_high(sc);
+	unsigned long total = 0;
+	int order;
+
+	for (order = 0; order < MAX_ORDER; order++)
+		total += (unsigned long)mem_pool_order_shrinkable(
+				&mem_pool_orders[order], high) << order;
+
+	return total;
+}
+
+/* Free the largest pages first since they are the hardest to get back */
+static unsigned long mem_pool_shrink_scan(struct shrinker *shrinker,
+		struct shrink_control *sc)
+{
+	bool high = mem_pool_shrink_high(sc);
+	unsigned long freed = 0;
+	int order;
+
+	for (order = MAX_ORDER - 1; order >= 0; order--) {
+		struct mem_pool_order *po = &mem_pool_orders[order];
+
+		while (freed < sc->nr_to_scan) {
+			struct page *page = NULL;
+
+			spin_lock(&po->lock);
+			if (mem_pool_order_shrinkable(po, high)) {
+				/* Prefer lowmem, that is what is short */
+				page = __mem_pool_remove(po, order, false);
+				if (page == NULL && high)
+					page = __mem_pool_remove(po, order,
+							true);
+			}
+			spin_unlock(&po->lock);
+
+			if (page == NULL)
+				break;
+
+			set_page_private(page, 0);
+			__free_pages(page, order);
+			freed += 1 << order;
+		}
+	}
+
+	return freed ? freed : SHRINK_STOP;
+}
+
+static struct shrinker mem_pool_shrinker = {
+	.count_objects = mem_pool_shrink_count,
+	.scan_objects = mem_pool_shrink_scan,
+	.seeks = DEFAULT_SEEKS,
+	.batch = 0,
+};
+
+static int mem_pool_stats_show(struct seq_file *s, void *unused)
+{
+	struct mem_pool_client *client;
+	int order;
+
+	seq_printf(s, "total pages: %ld\n", atomic_long_read(&mem_pool_total));
+
+	for (order = 0; order < MAX_ORDER; order++) {
+		struct mem_pool_order *po = &mem_pool_orders[order];
+
+		if (!mem_pool_count(order) && !READ_ONCE(po->reserved))
+			continue;
+
+		seq_printf(s, "order %d: high %d low %d reserved %u\n", order,
+			READ_ONCE(po->high_count), READ_ONCE(po->low_count),
+			READ_ONCE(po->reserved));
+	}
+
+	mutex_lock(&mem_pool_clients_lock);
+	list_for_each_entry(client, &mem_pool_clients, node) {
+		seq_printf(s,
+			"%s: hits %ld misses %ld borrowed %ld donated %ld\n",
+			client->name, atomic_long_read(&client->hits),
+			atomic_long_read(&client->misses),
+			atomic_long_read(&client->borrowed),
+			atomic_long_read(&client->donated));
+
+		for (order = 0; order < MAX_ORDER; order++)
+			if (client->reserved[order])
+				seq_printf(s, "  order %d reserved %u\n",
+					order, client->reserved[order]);
+	}
+	mutex_unlock(&mem_pool_clients_lock);
+
+	return 0;
+}
+
+static int mem_pool_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mem_pool_stats_show, NULL);
+}
+
+static const struct file_operations mem_pool_stats_fops = {
+	.open = mem_pool_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init mem_pool_init(void)
+{
+	struct dentry *dir;
+	int order;
+
+	for (order = 0; order < MAX_ORDER; order++) {
+		struct mem_pool_order *po = &mem_pool_orders[order];
+
+		spin_lock_init(&po->lock);
+		INIT_LIST_HEAD(&po->high_items);
+		INIT_LIST_HEAD(&po->low_items);
+	}
+
+	register_shrinker(&mem_pool_shrinker);
+
+	dir = debugfs_create_dir("mem_pool", NULL);
+	if (!IS_ERR_OR_NULL(dir))
+		debugfs_create_file("stats", 0444, dir, NULL,
+				&mem_pool_stats_fops);
+
+	return 0;
+}
+core_initcall(mem_pool_init);
@@ -13,6 +13,9 @@
  */
 #include <linux/err.h>
 #include <linux/slab.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/dma-mapping.h>
 #include <linux/mutex.h>
@@ -42,6 +45,17 @@ static uint64_t bootup_request;
 static bool ramdump_event;
 static void *memshare_ramdump_dev[MAX_CLIENTS];
 static struct device *memshare_dev[MAX_CLIENTS];
+static struct dentry *memshare_debugfs;
+
+/*
+ * Clients with a reservation whose block needs to be reserved again, retried
+ * every refill_delay_ms while memory can't be allocated without reclaim.
+ */
+static unsigned long memshare_refill_mask;
+static unsigned int memshare_refill_delay_ms = 5000;
+module_param_named(refill_delay_ms, memshare_refill_delay_ms, uint, 0644);
+static void memshare_refill_worker(struct work_struct *work);
+static DECLARE_DELAYED_WORK(memshare_refill_work, memshare_refill_worker);
 
 /* Memshare Driver Structure */
 struct memshare_driver {
@@ -215,6 +229,7 @@ static void free_client(int id)
 	memblock[id].guarantee = 0;
 	memblock[id].sequence_id = -1;
 	memblock[id].memory_type = MEMORY_CMA;
+	memblock[id].alloc_size = 0;
 
 }
 
@@ -254,6 +269,10 @@ static void initialize_client(void)
 		memblock[i].free_memory = 0;
 		memblock[i].hyp_mapping = 0;
 		memblock[i].file_created = 0;
+		memblock[i].reserve = 0;
+		memblock[i].pool_virtual_addr = NULL;
+		memblock[i].pool_phy_addr = 0;
+		memblock[i].pool_size = 0;
 	}
 	attrs |= DMA_ATTR_NO_KERNEL_MAPPING;
 }
@@ -353,7 +372,7 @@ static int mem_share_do_ramdump(void)
 static int modem_notifier_cb(struct notifier_block *this, unsigned long code,
 					void *_cmd)
 {
-	int i, ret, size = 0;
+	int i, ret;
 	u32 source_vmlist[1] = {VMID_MSS_MSA};
 	int dest_vmids[1] = {VMID_HLOS};
 	int dest_perms[1] = {PERM_READ|PERM_WRITE|PERM_EXEC};
@@ -365,8 +384,14 @@ static int modem_notifier_cb(struct notifier_block *this, unsigned long code,
 
 	case SUBSYS_BEFORE_SHUTDOWN:
 		bootup_request++;
-		for (i = 0; i < MAX_CLIENTS; i++)
+		for (i = 0; i < MAX_CLIENTS; i++) {
 			memblock[i].alloc_request = 0;
+			/* Have a block ready for the request after powerup */
+			if (memblock[i].reserve)
+				set_bit(i, &memshare_refill_mask);
+		}
+		if (memshare_refill_mask)
+			schedule_delayed_work(&memshare_refill_work, 0);
 		break;
 
 	case SUBSYS_RAMDUMP_NOTIFICATION:
@@ -394,7 +419,6 @@ static int modem_notifier_cb(struct notifier_block *this, unsigned long code,
 	case SUBSYS_AFTER_POWERUP:
 		pr_debug("memshare: Modem has booted up\n");
 		for (i = 0; i < MAX_CLIENTS; i++) {
-			size = memblock[i].size;
 			if (memblock[i].free_memory > 0 &&
 					bootup_request >= 2) {
 				memblock[i].free_memory -= 1;
@@ -433,18 +457,9 @@ static int modem_notifier_cb(struct notifier_block *this, unsigned long code,
 						memblock[i].hyp_mapping = 0;
 					}
 				}
-				if (memblock[i].client_id == 1) {
-					/*
-					 *	Check if the client id
-					 *	is of diag so that free
-					 *	the memory region of
-					 *	client's size + guard
-					 *	bytes of 4K.
-					 */
-					size += MEMSHARE_GUARD_BYTES;
-				}
 				dma_free_attrs(memsh_drv->dev,
-					size, memblock[i].virtual_addr,
+					memblock[i].alloc_size,
+					memblock[i].virtual_addr,
 					memblock[i].phy_addr,
 					attrs);
 				free_client(i);
@@ -490,6 +505,104 @@ static void shared_hyp_mapping(int client_id)
 	memblock[client_id].hyp_mapping = 1;
 }
 
+/*
+ * memshare_reserve() allocates the block an allocation request of client @id
+ * is served from, sized for the largest request the client can make.
+ */
+static int memshare_reserve(int id, gfp_t gfp)
+{
+	struct mem_blocks *pblk = &memblock[id];
+	uint32_t size = pblk->init_size;
+
+	if (pblk->client_id == 1)
+		size += MEMSHARE_GUARD_BYTES;
+
+	pblk->pool_virtual_addr = dma_alloc_attrs(memsh_drv->dev, size,
+					&pblk->pool_phy_addr, gfp, attrs);
+	if (!pblk->pool_virtual_addr) {
+		pblk->pool_phy_addr = 0;
+		return -ENOMEM;
+	}
+	pblk->pool_size = size;
+
+	return 0;
+}
+
+static void memshare_release_pool(int id)
+{
+	struct mem_blocks *pblk = &memblock[id];
+
+	if (!pblk->pool_virtual_addr)
+		return;
+
+	dma_free_attrs(memsh_drv->dev, pblk->pool_size,
+			pblk->pool_virtual_addr, pblk->pool_phy_addr, attrs);
+	pblk->pool_virtual_addr = NULL;
+	pblk->pool_phy_addr = 0;
+	pblk->pool_size = 0;
+}
+
+/*
+ * Reserve again the blocks of clients in memshare_refill_mask that hold no
+ * memory, but only while it can be done without reclaim or compaction, so
+ * it doesn't stall the rest of the system.
+ */
+static void memshare_refill_worker(struct work_struct *work)
+{
+	int i;
+
+	mutex_lock(&memsh_drv->mem_share);
+	for (i = 0; i < num_clients; i++) {
+		if (!test_bit(i, &memshare_refill_mask))
+			continue;
+
+		if (memblock[i].allotted || memblock[i].pool_virtual_addr ||
+			!memblock[i].init_size ||
+			!memshare_reserve(i, GFP_KERNEL | __GFP_NORETRY |
+							__GFP_NOWARN))
+			clear_bit(i, &memshare_refill_mask);
+	}
+	mutex_unlock(&memsh_drv->mem_share);
+
+	if (memshare_refill_mask)
+		schedule_delayed_work(&memshare_refill_work,
+				msecs_to_jiffies(memshare_refill_delay_ms));
+}
+
+/*
+ * memshare_client_alloc() allocates @size bytes for client @id, from its
+ * reserved block when it has one and otherwise from the system.
+ */
+static int memshare_client_alloc(int id, uint32_t size)
+{
+	struct mem_blocks *pblk = &memblock[id];
+	ktime_t start = ktime_get();
+	uint32_t time_us;
+	int rc = 0;
+
+	pblk->alloc_count++;
+	if (pblk->pool_virtual_addr && pblk->pool_size >= size) {
+		pblk->virtual_addr = pblk->pool_virtual_addr;
+		pblk->phy_addr = pblk->pool_phy_addr;
+		pblk->alloc_size = pblk->pool_size;
+		pblk->pool_virtual_addr = NULL;
+		pblk->pool_phy_addr = 0;
+		pblk->pool_size = 0;
+		pblk->pool_hit++;
+	} else {
+		memshare_release_pool(id);
+		rc = memshare_alloc(memsh_drv->dev, size, pblk);
+		if (rc)
+			pblk->alloc_fail++;
+	}
+
+	time_us = ktime_us_delta(ktime_get(), start);
+	pblk->alloc_time_total_us += time_us;
+	pblk->alloc_time_max_us = max(pblk->alloc_time_max_us, time_us);
+
+	return rc;
+}
+
 static int handle_alloc_req(void *req_h, void *req, void *conn_h)
 {
 	struct mem_alloc_req_msg_v01 *alloc_req;
@@ -573,8 +686,7 @@ static int handle_alloc_generic_req(void *req_h, void *req, void *conn_h)
 			size = alloc_req->num_bytes + MEMSHARE_GUARD_BYTES;
 		else
 			size = alloc_req->num_bytes;
-		rc = memshare_alloc(memsh_drv->dev, size,
-					&memblock[client_id]);
+		rc = memshare_client_alloc(client_id, size);
 		if (rc) {
 			pr_err("memshare: %s,Unable to allocate memory for requested client\n",
 							__func__);
@@ -650,7 +762,7 @@ static int handle_free_generic_req(void *req_h, void *req, void *conn_h)
 {
 	struct mem_free_generic_req_msg_v01 *free_req;
 	struct mem_free_generic_resp_msg_v01 free_resp;
-	int rc, flag = 0, ret = 0, size = 0;
+	int rc, flag = 0, ret = 0;
 	uint32_t client_id;
 	u32 source_vmlist[1] = {VMID_MSS_MSA};
 	int dest_vmids[1] = {VMID_HLOS};
@@ -685,18 +797,7 @@ static int handle_free_generic_req(void *req_h, void *req, void *conn_h)
 			pr_err("memshare: %s, failed to unmap the region for client id:%d\n",
 				__func__, client_id);
 		}
-		size = memblock[client_id].size;
-		if (memblock[client_id].client_id == 1) {
-			/*
-			 *	Check if the client id
-			 *	is of diag so that free
-			 *	the memory region of
-			 *	client's size + guard
-			 *	bytes of 4K.
-			 */
-			size += MEMSHARE_GUARD_BYTES;
-		}
-		dma_free_attrs(memsh_drv->dev, size,
+		dma_free_attrs(memsh_drv->dev, memblock[client_id].alloc_size,
 			memblock[client_id].virtual_addr,
 			memblock[client_id].phy_addr,
 			attrs);
@@ -930,6 +1031,7 @@ int memshare_alloc(struct device *dev,
 						attrs);
 	if (pblk->virtual_addr == NULL)
 		return -ENOMEM;
+	pblk->alloc_size = block_size;
 
 	return 0;
 }
@@ -1002,6 +1104,10 @@ static int memshare_child_probe(struct platform_device *pdev)
 							pdev->dev.of_node,
 							"qcom,allocate-on-request");
 
+	memblock[num_clients].reserve = of_property_read_bool(
+							pdev->dev.of_node,
+							"qcom,reserve-boot-time");
+
 	rc = of_property_read_string(pdev->dev.of_node, "label",
 						&name);
 	if (rc) {
@@ -1037,6 +1143,18 @@ static int memshare_child_probe(struct platform_device *pdev)
 		memblock[num_clients].size = size;
 		memblock[num_clients].allotted = 1;
 		shared_hyp_mapping(num_clients);
+	} else if (memblock[num_clients].reserve && size > 0) {
+		/*
+		 * Reserve the block the client's first request is served
+		 * from, retried later if memory is too fragmented now
+		 */
+		if (memshare_reserve(num_clients, GFP_KERNEL)) {
+			pr_debug("memshare: %s, reservation deferred for client id: %d\n",
+					__func__, client_id);
+			set_bit(num_clients, &memshare_refill_mask);
+			schedule_delayed_work(&memshare_refill_work,
+				msecs_to_jiffies(memshare_refill_delay_ms));
+		}
 	}
 
 	/*
@@ -1061,6 +1179,39 @@ static int memshare_child_probe(struct platform_device *pdev)
 	return 0;
 }
 
+static int memshare_stats_show(struct seq_file *s, void *unused)
+{
+	struct mem_blocks *pblk;
+	int i;
+
+	mutex_lock(&memsh_drv->mem_share);
+	seq_puts(s, "client_id size reserved allocs pool_hits failures avg_us max_us\n");
+	for (i = 0; i < num_clients; i++) {
+		pblk = &memblock[i];
+		seq_printf(s, "%u %u %u %u %u %u %llu %u\n",
+			pblk->client_id, pblk->init_size, pblk->pool_size,
+			pblk->alloc_count, pblk->pool_hit, pblk->alloc_fail,
+			pblk->alloc_count ? div_u64(pblk->alloc_time_total_us,
+					pblk->alloc_count) : 0,
+			pblk->alloc_time_max_us);
+	}
+	mutex_unlock(&memsh_drv->mem_share);
+
+	return 0;
+}
+
+static int memshare_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, memshare_stats_show, inode->i_private);
+}
+
+static const struct file_operations memshare_stats_fops = {
+	.open = memshare_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int memshare_probe(struct platform_device *pdev)
 {
 	int rc;
@@ -1095,6 +1246,11 @@ static int memshare_probe(struct platform_device *pdev)
 	}
 
 	subsys_notif_register_notifier("modem", &nb);
+
+	memshare_debugfs = debugfs_create_dir("memshare", NULL);
+	if (!IS_ERR_OR_NULL(memshare_debugfs))
+		debugfs_create_file("stats", 0444, memshare_debugfs, NULL,
+					&memshare_stats_fops);
 	pr_debug("memshare: %s, Memshare inited\n", __func__);
 
 	return 0;
@@ -1105,6 +1261,8 @@ static int memshare_remove(struct platform_device *pdev)
 	if (!memsh_drv)
 		return 0;
 
+	debugfs_remove_recursive(memshare_debugfs);
+	cancel_delayed_work_sync(&memshare_refill_work);
 	qmi_svc_unregister(mem_share_svc_handle);
 	flush_workqueue(mem_share_svc_workqueue);
 	qmi_handle_destroy(mem_share_svc_handle);
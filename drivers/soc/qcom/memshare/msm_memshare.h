@@ -61,7 +61,20 @@ struct mem_blocks {
 	uint8_t hyp_mapping;
 	/* Status flag which checks if ramdump file is created*/
 	int file_created;
-
+	/* Size of the block backing the allocation, guard bytes included */
+	uint32_t alloc_size;
+	/* Keep a block reserved for the client while it holds none */
+	uint8_t reserve;
+	/* Block reserved for the next allocation request of the client */
+	void *pool_virtual_addr;
+	phys_addr_t pool_phy_addr;
+	uint32_t pool_size;
+	/* Allocation request statistics */
+	uint32_t alloc_count;
+	uint32_t alloc_fail;
+	uint32_t pool_hit;
+	uint64_t alloc_time_total_us;
+	uint32_t alloc_time_max_us;
 };
 
 int memshare_alloc(struct device *dev,
@@ -15,6 +15,8 @@
 #include <linux/module.h>
 #include <linux/slab.h>
 #include <linux/rtmutex.h>
+#include <linux/rcupdate.h>
+#include <linux/workqueue.h>
 #include <linux/clk.h>
 #include <linux/msm-bus.h>
 #include "msm_bus_core.h"
@@ -42,6 +44,19 @@ static LIST_HEAD(commit_list);
 
 DEFINE_RT_MUTEX(msm_bus_adhoc_lock);
 
+/*
+ * Votes that only lower the aggregate bandwidth are held back for up to
+ * commit_delay_us so that the burst of updates clients make around a frame
+ * goes out as one set of RPM requests. Anything that raises a node commits
+ * right away, together with whatever was held back.
+ */
+static unsigned int commit_delay_us = 2000;
+module_param(commit_delay_us, uint, 0644);
+
+static bool commit_urgent;
+static void commit_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(commit_work, commit_work_fn);
+
 static bool chk_bl_list(struct list_head *black_list, unsigned int id)
 {
 	struct msm_bus_node_device_type *bus_node = NULL;
@@ -657,6 +672,33 @@ static void commit_data(void)
 	INIT_LIST_HEAD(&input_list);
 	INIT_LIST_HEAD(&apply_list);
 	INIT_LIST_HEAD(&commit_list);
+	commit_urgent = false;
+}
+
+static void commit_work_fn(struct work_struct *work)
+{
+	rt_mutex_lock(&msm_bus_adhoc_lock);
+	if (!list_empty(&commit_list))
+		commit_data();
+	rt_mutex_unlock(&msm_bus_adhoc_lock);
+}
+
+/*
+ * Commit the nodes touched by update_path(), or leave them on the commit
+ * list for commit_work if none of them went up. Called with
+ * msm_bus_adhoc_lock held.
+ */
+static void commit_or_defer(void)
+{
+	if (list_empty(&commit_list))
+		return;
+
+	if (commit_urgent || !commit_delay_us) {
+		commit_data();
+		return;
+	}
+
+	schedule_delayed_work(&commit_work, usecs_to_jiffies(commit_delay_us));
 }
 
 static void add_node_to_clist(struct msm_bus_node_device_type *node)
@@ -704,6 +746,7 @@ static int update_path(struct device *src_dev, int dest, uint64_t act_req_ib,
 	curr_idx = src_idx;
 
 	while (next_dev) {
+		bool changed;
 		int i;
 
 		dev_info = to_msm_bus_node(next_dev);
@@ -727,9 +770,23 @@ static int update_path(struct device *src_dev, int dest, uint64_t act_req_ib,
 		lnode->lnode_ib[DUAL_CTX] = slp_req_ib;
 		lnode->lnode_ab[DUAL_CTX] = slp_req_bw;
 
-		for (i = 0; i < NUM_CTX; i++)
-			dev_info->node_bw[i].cur_clk_hz =
-					aggregate_bus_req(dev_info, i);
+		changed = dev_info->node_info->defer_qos;
+		for (i = 0; i < NUM_CTX; i++) {
+			struct nodebw old = dev_info->node_bw[i];
+			struct nodebw *bw = &dev_info->node_bw[i];
+
+			bw->cur_clk_hz = aggregate_bus_req(dev_info, i);
+			if (bw->cur_clk_hz > old.cur_clk_hz ||
+			    bw->sum_ab > old.sum_ab || bw->max_ib > old.max_ib)
+				commit_urgent = true;
+			if (bw->cur_clk_hz != old.cur_clk_hz ||
+			    bw->sum_ab != old.sum_ab || bw->max_ib != old.max_ib)
+				changed = true;
+		}
+
+		/* Another client still sets the aggregate, nothing to send */
+		if (!changed)
+			goto next_node;
 
 		add_node_to_clist(dev_info);
 
@@ -746,6 +803,7 @@ static int update_path(struct device *src_dev, int dest, uint64_t act_req_ib,
 			}
 		}
 
+next_node:
 		next_dev = lnode->next_dev;
 		curr_idx = lnode->next;
 	}
@@ -891,10 +949,15 @@ static void unregister_client_adhoc(uint32_t cl)
 	}
 	commit_data();
 	msm_bus_dbg_client_data(client->pdata, MSM_BUS_DBG_UNREGISTER, cl);
+	handle_list.cl_list[cl] = NULL;
+	rt_mutex_unlock(&msm_bus_adhoc_lock);
+
+	synchronize_rcu();
 	kfree(client->src_pnode);
 	kfree(client->src_devs);
 	kfree(client);
-	handle_list.cl_list[cl] = NULL;
+	return;
+
 exit_unregister_client:
 	rt_mutex_unlock(&msm_bus_adhoc_lock);
 }
@@ -913,11 +976,17 @@ static int alloc_handle_lst(int size)
 								__func__);
 			goto exit_alloc_handle_lst;
 		}
-		handle_list.cl_list = t_cl_list;
+		rcu_assign_pointer(handle_list.cl_list, t_cl_list);
+		smp_wmb();
 		handle_list.num_entries += NUM_CL_HANDLES;
 	} else {
-		t_cl_list = krealloc(handle_list.cl_list,
-				sizeof(struct msm_bus_client *) *
+		struct msm_bus_client **old_cl_list = handle_list.cl_list;
+
+		/*
+		 * Not krealloc(), request_unchanged() may still be looking
+		 * at the old list.
+		 */
+		t_cl_list = kzalloc(sizeof(struct msm_bus_client *) *
 				(handle_list.num_entries + NUM_CL_HANDLES),
 				GFP_KERNEL);
 		if (ZERO_OR_NULL_PTR(t_cl_list)) {
@@ -927,10 +996,13 @@ static int alloc_handle_lst(int size)
 			goto exit_alloc_handle_lst;
 		}
 
-		handle_list.cl_list = t_cl_list;
-		memset(&handle_list.cl_list[handle_list.num_entries], 0,
-			NUM_CL_HANDLES * sizeof(struct msm_bus_client *));
+		memcpy(t_cl_list, old_cl_list, handle_list.num_entries *
+			sizeof(struct msm_bus_client *));
+		rcu_assign_pointer(handle_list.cl_list, t_cl_list);
+		smp_wmb();
 		handle_list.num_entries += NUM_CL_HANDLES;
+		synchronize_rcu();
+		kfree(old_cl_list);
 	}
 exit_alloc_handle_lst:
 	return ret;
@@ -1104,7 +1176,7 @@ static int update_client_paths(struct msm_bus_client *client, bool log_trns,
 		if (log_trns)
 			getpath_debug(src, lnode, pdata->active_only);
 	}
-	commit_data();
+	commit_or_defer();
 exit_update_client_paths:
 	return ret;
 }
@@ -1164,6 +1236,33 @@ static int update_context(uint32_t cl, bool active_only,
 	return ret;
 }
 
+/*
+ * Most updates repeat the usecase the client already has. Catch those
+ * without msm_bus_adhoc_lock: the handle list is only ever replaced and
+ * clients only freed after an RCU grace period, and curr is written under
+ * the lock before the new vote is applied.
+ */
+static bool request_unchanged(uint32_t cl, unsigned int index)
+{
+	struct msm_bus_client **cl_list;
+	struct msm_bus_client *client;
+	bool unchanged = false;
+	int num_entries;
+
+	rcu_read_lock();
+	/* Pairs with the smp_wmb() in alloc_handle_lst() */
+	num_entries = READ_ONCE(handle_list.num_entries);
+	smp_rmb();
+	cl_list = rcu_dereference(handle_list.cl_list);
+	if (cl && cl_list && cl < num_entries) {
+		client = READ_ONCE(cl_list[cl]);
+		unchanged = client && READ_ONCE(client->curr) == index;
+	}
+	rcu_read_unlock();
+
+	return unchanged;
+}
+
 static int update_request_adhoc(uint32_t cl, unsigned int index)
 {
 	int ret = 0;
@@ -1172,6 +1271,12 @@ static int update_request_adhoc(uint32_t cl, unsigned int index)
 	const char *test_cl = "Null";
 	bool log_transaction = false;
 
+	if (request_unchanged(cl, index)) {
+		MSM_BUS_DBG("%s: Not updating client request idx %d unchanged",
+				__func__, index);
+		return 0;
+	}
+
 	rt_mutex_lock(&msm_bus_adhoc_lock);
 
 	if (!cl) {
@@ -1243,6 +1348,14 @@ static int update_bw_adhoc(struct msm_bus_client_handle *cl, u64 ab, u64 ib)
 	bool log_transaction = false;
 	u64 slp_ib, slp_ab;
 
+	/* The handle belongs to the caller, its current vote is stable */
+	if (cl && READ_ONCE(cl->cur_act_ib) == ib &&
+	    READ_ONCE(cl->cur_act_ab) == ab) {
+		msm_bus_dbg_rec_transaction(cl, ab, ib);
+		MSM_BUS_DBG("%s:no change in request", cl->name);
+		return 0;
+	}
+
 	rt_mutex_lock(&msm_bus_adhoc_lock);
 
 	if (!cl) {
@@ -1278,7 +1391,7 @@ static int update_bw_adhoc(struct msm_bus_client_handle *cl, u64 ab, u64 ib)
 		goto exit_update_request;
 	}
 
-	commit_data();
+	commit_or_defer();
 	cl->cur_act_ib = ib;
 	cl->cur_act_ab = ab;
 	cl->cur_dual_ib = slp_ib;
@@ -1324,7 +1437,7 @@ static int update_bw_context(struct msm_bus_client_handle *cl, u64 act_ab,
 				__func__, ret, cl->active_only);
 		goto exit_change_context;
 	}
-	commit_data();
+	commit_or_defer();
 	cl->cur_act_ib = act_ib;
 	cl->cur_act_ab = act_ab;
 	cl->cur_dual_ib = slp_ib;
@@ -267,7 +267,7 @@ static int send_rpm_msg(struct msm_bus_node_device_type *ndev, int ctx)
 
 	if (ndev->node_info->mas_rpm_id != -1) {
 		rsc_type = RPM_BUS_MASTER_REQ;
-		ret = msm_rpm_send_message(rpm_ctx, rsc_type,
+		ret = msm_rpm_send_message_async(rpm_ctx, rsc_type,
 			ndev->node_info->mas_rpm_id, &rpm_kvp, 1);
 		if (ret) {
 			MSM_BUS_ERR("%s: Failed to send RPM message:",
@@ -284,7 +284,7 @@ static int send_rpm_msg(struct msm_bus_node_device_type *ndev, int ctx)
 
 	if (ndev->node_info->slv_rpm_id != -1) {
 		rsc_type = RPM_BUS_SLAVE_REQ;
-		ret = msm_rpm_send_message(rpm_ctx, rsc_type,
+		ret = msm_rpm_send_message_async(rpm_ctx, rsc_type,
 			ndev->node_info->slv_rpm_id, &rpm_kvp, 1);
 		if (ret) {
 			MSM_BUS_ERR("%s: Failed to send RPM message:",
@@ -465,6 +465,10 @@ int msm_bus_commit_data(struct list_head *clist)
 		node->dirty = false;
 		list_del_init(&node->link);
 	}
+
+	/* Send the RPM votes of the whole commit as one burst */
+	if (msm_rpm_flush_async())
+		MSM_BUS_ERR("%s: Error sending RPM votes", __func__);
 	return ret;
 }
 
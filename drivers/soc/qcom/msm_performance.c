@@ -25,15 +25,34 @@
 #include <linux/module.h>
 #include <linux/input.h>
 #include <linux/kthread.h>
+#include <linux/ctype.h>
+#include <linux/mutex.h>
+#include <linux/string.h>
 
 
+/*
+ * Frequency limits are requested by several userspace clients, each by name.
+ * A client's requests are kept per cluster, indexed by the first cpu of the
+ * cluster, and the cluster limit is the highest min and the lowest max
+ * requested by any client. Writes without a client name use
+ * PERF_DEFAULT_CLIENT.
+ */
+#define PERF_MAX_CLIENTS	8
+#define PERF_CLIENT_NAME_LEN	16
+#define PERF_DEFAULT_CLIENT	"default"
+
 /* To handle cpufreq min/max request */
 struct cpu_status {
 	unsigned int min;
 	unsigned int max;
+	unsigned int req_min[PERF_MAX_CLIENTS];
+	unsigned int req_max[PERF_MAX_CLIENTS];
 };
 static DEFINE_PER_CPU(struct cpu_status, cpu_stats);
 
+static char perf_clients[PERF_MAX_CLIENTS][PERF_CLIENT_NAME_LEN];
+static DEFINE_MUTEX(perf_req_lock);
+
 struct events {
 	spinlock_t cpu_hotplug_lock;
 	bool cpu_hotplug;
@@ -42,20 +61,108 @@ struct events {
 static struct events events_group;
 static struct task_struct *events_notify_thread;
 
+/* Return the first cpu of the cluster @cpu is in */
+static unsigned int perf_cluster_cpu(unsigned int cpu)
+{
+	struct cpufreq_policy *policy = cpufreq_cpu_get(cpu);
+	unsigned int first = cpu;
+
+	if (policy) {
+		first = cpumask_first(policy->related_cpus);
+		cpufreq_cpu_put(policy);
+	}
+
+	return first;
+}
+
+/* Find the slot of client @name, allocating one if it doesn't have one */
+static int perf_client_get(const char *name)
+{
+	int i, free = -ENOSPC;
+
+	for (i = 0; i < PERF_MAX_CLIENTS; i++) {
+		if (!perf_clients[i][0]) {
+			if (free < 0)
+				free = i;
+		} else if (!strcmp(perf_clients[i], name)) {
+			return i;
+		}
+	}
+
+	if (free >= 0) {
+		unsigned int cpu;
+
+		strlcpy(perf_clients[free], name, PERF_CLIENT_NAME_LEN);
+		for_each_possible_cpu(cpu) {
+			per_cpu(cpu_stats, cpu).req_min[free] = 0;
+			per_cpu(cpu_stats, cpu).req_max[free] = UINT_MAX;
+		}
+	}
+
+	return free;
+}
+
+/* Release the slot of a client that has withdrawn all of its requests */
+static void perf_client_put(int client)
+{
+	struct cpu_status *st;
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu) {
+		st = &per_cpu(cpu_stats, cpu);
+		if (st->req_min[client] || st->req_max[client] != UINT_MAX)
+			return;
+	}
+
+	perf_clients[client][0] = '\0';
+}
+
+/* Aggregate the requests of a cluster, returns true if the limit changed */
+static bool perf_cluster_update(struct cpu_status *st)
+{
+	unsigned int min = 0, max = UINT_MAX;
+	int i;
+
+	for (i = 0; i < PERF_MAX_CLIENTS; i++) {
+		if (!perf_clients[i][0])
+			continue;
+		min = max(min, st->req_min[i]);
+		max = min(max, st->req_max[i]);
+	}
+
+	if (min == st->min && max == st->max)
+		return false;
+
+	st->min = min;
+	st->max = max;
+	return true;
+}
+
 /**************************sysfs start********************************/
 /*
- * Userspace sends cpu#:min_freq_value to vote for min_freq_value as the new
- * scaling_min. To withdraw its vote it needs to enter cpu#:0
+ * Userspace sends [client] cpu#:freq_value ... to request the new
+ * scaling_min, or scaling_max if @is_max. To withdraw its request it needs to
+ * enter cpu#:0 for the min and cpu#:UINT_MAX for the max.
  */
-static int set_cpu_min_freq(const char *buf, const struct kernel_param *kp)
+static int set_cpu_freq_req(const char *buf, bool is_max)
 {
-	int i, j, ntokens = 0;
-	unsigned int val, cpu;
+	char name[PERF_CLIENT_NAME_LEN] = PERF_DEFAULT_CLIENT;
+	int i, client, ntokens = 0, ret = 0;
+	unsigned int val, cpu, first;
 	const char *cp = buf;
-	struct cpu_status *i_cpu_stats;
-	struct cpufreq_policy policy;
-	cpumask_var_t limit_mask;
-	int ret;
+	struct cpu_status *st;
+	struct cpumask changed;
+
+	/* A leading token without a ':' names the client */
+	if (!isdigit(*cp)) {
+		if (sscanf(cp, "%15s", name) != 1 || strchr(name, ':'))
+			return -EINVAL;
+		cp = strchr(cp, ' ');
+		if (!cp)
+			return -EINVAL;
+		cp = skip_spaces(cp);
+	}
+	buf = cp;
 
 	while ((cp = strpbrk(cp + 1, " :")))
 		ntokens++;
@@ -64,48 +171,65 @@ static int set_cpu_min_freq(const char *buf, const struct kernel_param *kp)
 	if (!(ntokens % 2))
 		return -EINVAL;
 
+	mutex_lock(&perf_req_lock);
+	client = perf_client_get(name);
+	if (client < 0) {
+		ret = client;
+		goto out;
+	}
+
 	cp = buf;
-	cpumask_clear(limit_mask);
+	cpumask_clear(&changed);
 	for (i = 0; i < ntokens; i += 2) {
-		if (sscanf(cp, "%u:%u", &cpu, &val) != 2)
-			return -EINVAL;
-		if (cpu > (num_present_cpus() - 1))
-			return -EINVAL;
+		if (sscanf(cp, "%u:%u", &cpu, &val) != 2 ||
+			cpu > (num_present_cpus() - 1)) {
+			ret = -EINVAL;
+			break;
+		}
 
-		i_cpu_stats = &per_cpu(cpu_stats, cpu);
+		first = perf_cluster_cpu(cpu);
+		st = &per_cpu(cpu_stats, first);
+		if (is_max)
+			st->req_max[client] = val;
+		else
+			st->req_min[client] = val;
 
-		i_cpu_stats->min = val;
-		cpumask_set_cpu(cpu, limit_mask);
+		if (perf_cluster_update(st))
+			cpumask_set_cpu(first, &changed);
 
 		cp = strnchr(cp, strlen(cp), ' ');
 		cp++;
 	}
+	perf_client_put(client);
 
 	/*
 	 * Since on synchronous systems policy is shared amongst multiple
 	 * CPUs only one CPU needs to be updated for the limit to be
-	 * reflected for the entire cluster. We can avoid updating the policy
-	 * of other CPUs in the cluster once it is done for at least one CPU
-	 * in the cluster
+	 * reflected for the entire cluster, and only clusters whose limit
+	 * changed need an update.
 	 */
 	get_online_cpus();
-	for_each_cpu(i, limit_mask) {
-		i_cpu_stats = &per_cpu(cpu_stats, i);
+	for_each_cpu(first, &changed) {
+		struct cpufreq_policy *policy = cpufreq_cpu_get(first);
 
-		if (cpufreq_get_policy(&policy, i))
+		if (!policy)
 			continue;
+		cpu = cpumask_any_and(policy->related_cpus, cpu_online_mask);
+		cpufreq_cpu_put(policy);
 
-		if (cpu_online(i) && (policy.min != i_cpu_stats->min)) {
-			ret = cpufreq_update_policy(i);
-			if (ret)
-				continue;
-		}
-		for_each_cpu(j, policy.related_cpus)
-			cpumask_clear_cpu(j, limit_mask);
+		if (cpu < nr_cpu_ids)
+			cpufreq_update_policy(cpu);
 	}
 	put_online_cpus();
 
-	return 0;
+out:
+	mutex_unlock(&perf_req_lock);
+	return ret;
+}
+
+static int set_cpu_min_freq(const char *buf, const struct kernel_param *kp)
+{
+	return set_cpu_freq_req(buf, false);
 }
 
 static int get_cpu_min_freq(char *buf, const struct kernel_param *kp)
@@ -113,8 +237,8 @@ static int get_cpu_min_freq(char *buf, const struct kernel_param *kp)
 	int cnt = 0, cpu;
 
 	for_each_present_cpu(cpu) {
-		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt,
-				"%d:%u ", cpu, per_cpu(cpu_stats, cpu).min);
+		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "%d:%u ", cpu,
+			per_cpu(cpu_stats, perf_cluster_cpu(cpu)).min);
 	}
 	cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "\n");
 	return cnt;
@@ -126,61 +250,9 @@ static const struct kernel_param_ops param_ops_cpu_min_freq = {
 };
 module_param_cb(cpu_min_freq, &param_ops_cpu_min_freq, NULL, 0644);
 
-/*
- * Userspace sends cpu#:max_freq_value to vote for max_freq_value as the new
- * scaling_max. To withdraw its vote it needs to enter cpu#:UINT_MAX
- */
 static int set_cpu_max_freq(const char *buf, const struct kernel_param *kp)
 {
-	int i, j, ntokens = 0;
-	unsigned int val, cpu;
-	const char *cp = buf;
-	struct cpu_status *i_cpu_stats;
-	struct cpufreq_policy policy;
-	cpumask_var_t limit_mask;
-	int ret;
-
-	while ((cp = strpbrk(cp + 1, " :")))
-		ntokens++;
-
-	/* CPU:value pair */
-	if (!(ntokens % 2))
-		return -EINVAL;
-
-	cp = buf;
-	cpumask_clear(limit_mask);
-	for (i = 0; i < ntokens; i += 2) {
-		if (sscanf(cp, "%u:%u", &cpu, &val) != 2)
-			return -EINVAL;
-		if (cpu > (num_present_cpus() - 1))
-			return -EINVAL;
-
-		i_cpu_stats = &per_cpu(cpu_stats, cpu);
-
-		i_cpu_stats->max = val;
-		cpumask_set_cpu(cpu, limit_mask);
-
-		cp = strnchr(cp, strlen(cp), ' ');
-		cp++;
-	}
-
-	get_online_cpus();
-	for_each_cpu(i, limit_mask) {
-		i_cpu_stats = &per_cpu(cpu_stats, i);
-		if (cpufreq_get_policy(&policy, i))
-			continue;
-
-		if (cpu_online(i) && (policy.max != i_cpu_stats->max)) {
-			ret = cpufreq_update_policy(i);
-			if (ret)
-				continue;
-		}
-		for_each_cpu(j, policy.related_cpus)
-			cpumask_clear_cpu(j, limit_mask);
-	}
-	put_online_cpus();
-
-	return 0;
+	return set_cpu_freq_req(buf, true);
 }
 
 static int get_cpu_max_freq(char *buf, const struct kernel_param *kp)
@@ -188,8 +260,8 @@ static int get_cpu_max_freq(char *buf, const struct kernel_param *kp)
 	int cnt = 0, cpu;
 
 	for_each_present_cpu(cpu) {
-		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt,
-				"%d:%u ", cpu, per_cpu(cpu_stats, cpu).max);
+		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "%d:%u ", cpu,
+			per_cpu(cpu_stats, perf_cluster_cpu(cpu)).max);
 	}
 	cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "\n");
 	return cnt;
@@ -201,8 +273,38 @@ static const struct kernel_param_ops param_ops_cpu_max_freq = {
 };
 module_param_cb(cpu_max_freq, &param_ops_cpu_max_freq, NULL, 0644);
 
+/* One line per client with its cpu#:min:max request for each cluster */
+static int get_cpu_freq_requests(char *buf, const struct kernel_param *kp)
+{
+	struct cpu_status *st;
+	int i, cnt = 0, cpu;
 
+	mutex_lock(&perf_req_lock);
+	for (i = 0; i < PERF_MAX_CLIENTS; i++) {
+		if (!perf_clients[i][0])
+			continue;
 
+		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "%s:",
+				perf_clients[i]);
+		for_each_present_cpu(cpu) {
+			st = &per_cpu(cpu_stats, cpu);
+			if (!st->req_min[i] && st->req_max[i] == UINT_MAX)
+				continue;
+			cnt += snprintf(buf + cnt, PAGE_SIZE - cnt,
+					" %d:%u:%u", cpu, st->req_min[i],
+					st->req_max[i]);
+		}
+		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "\n");
+	}
+	mutex_unlock(&perf_req_lock);
+
+	return cnt;
+}
+
+static const struct kernel_param_ops param_ops_cpu_freq_requests = {
+	.get = get_cpu_freq_requests,
+};
+module_param_cb(cpu_freq_requests, &param_ops_cpu_freq_requests, NULL, 0444);
 
 /* CPU Hotplug */
 static struct kobject *events_kobj;
@@ -231,7 +333,8 @@ static int perf_adjust_notify(struct notifier_block *nb, unsigned long val,
 {
 	struct cpufreq_policy *policy = data;
 	unsigned int cpu = policy->cpu;
-	struct cpu_status *cpu_st = &per_cpu(cpu_stats, cpu);
+	struct cpu_status *cpu_st =
+		&per_cpu(cpu_stats, cpumask_first(policy->related_cpus));
 	unsigned int min = cpu_st->min, max = cpu_st->max;
 
 
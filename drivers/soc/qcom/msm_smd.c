@@ -1087,70 +1087,49 @@ static int ch_is_open(struct smd_channel *ch)
 		&& (ch->half_ch->get_state(ch->send) == SMD_SS_OPENED);
 }
 
-/* provide a pointer and length to readable data in the fifo */
-static unsigned int ch_read_buffer(struct smd_channel *ch, void **ptr)
-{
-	unsigned int head = ch->half_ch->get_head(ch->recv);
-	unsigned int tail = ch->half_ch->get_tail(ch->recv);
-	unsigned int fifo_size = ch->fifo_size;
-
-	WARN_ON(fifo_size >= SZ_1M);
-	WARN_ON(head >= fifo_size);
-	WARN_ON(tail >= fifo_size);
-	WARN_ON(OVERFLOW_ADD_UNSIGNED(uintptr_t, (uintptr_t)ch->recv_data,
-								tail));
-	*ptr = (void *) (ch->recv_data + tail);
-	if (tail <= head)
-		return head - tail;
-	else
-		return fifo_size - tail;
-}
-
 static int read_intr_blocked(struct smd_channel *ch)
 {
 	return ch->half_ch->get_fBLOCKREADINTR(ch->recv);
 }
 
-/* advance the fifo read pointer after data from ch_read_buffer is consumed */
-static void ch_read_done(struct smd_channel *ch, unsigned int count)
-{
-	unsigned int tail = ch->half_ch->get_tail(ch->recv);
-	unsigned int fifo_size = ch->fifo_size;
-
-	WARN_ON(count > smd_stream_read_avail(ch));
-
-	tail += count;
-	if (tail >= fifo_size)
-		tail -= fifo_size;
-	ch->half_ch->set_tail(ch->recv, tail);
-	wmb(); /* Make sure memory is visible before setting signal */
-	ch->half_ch->set_fTAIL(ch->send,  1);
-}
-
-/* basic read interface to ch_read_{buffer,done} used
- * by smd_*_read() and update_packet_state()
+/* basic read interface used by smd_*_read() and update_packet_state()
  * will read-and-discard if the _data pointer is null
+ *
+ * The indices live in uncached shared memory, so they are read once up
+ * front and the read pointer is published once after all segments (at most
+ * two, around the end of the fifo) have been copied.
  */
 static int ch_read(struct smd_channel *ch, void *_data, int len)
 {
-	void *ptr;
-	unsigned int n;
+	unsigned int head = ch->half_ch->get_head(ch->recv);
+	unsigned int tail = ch->half_ch->get_tail(ch->recv);
+	unsigned int fifo_size = ch->fifo_size;
 	unsigned char *data = _data;
+	unsigned int n;
 	int orig_len = len;
 
-	while (len > 0) {
-		n = ch_read_buffer(ch, &ptr);
-		if (n == 0)
-			break;
+	WARN_ON(fifo_size >= SZ_1M);
+	if (WARN_ON(head >= fifo_size || tail >= fifo_size))
+		return 0;
 
+	while (len > 0 && tail != head) {
+		n = (tail <= head ? head : fifo_size) - tail;
 		if (n > len)
 			n = len;
 		if (_data)
-			ch->read_from_fifo(data, ptr, n);
+			ch->read_from_fifo(data, ch->recv_data + tail, n);
 
 		data += n;
 		len -= n;
-		ch_read_done(ch, n);
+		tail += n;
+		if (tail >= fifo_size)
+			tail -= fifo_size;
+	}
+
+	if (len != orig_len) {
+		ch->half_ch->set_tail(ch->recv, tail);
+		wmb(); /* Make sure memory is visible before setting signal */
+		ch->half_ch->set_fTAIL(ch->send,  1);
 	}
 
 	return orig_len - len;
@@ -1199,6 +1178,8 @@ static void update_packet_state(struct smd_channel *ch)
  * ch_write_buffer() - Provide a pointer and length for the next segment of
  * free space in the FIFO.
  * @ch: channel
+ * @head: Local copy of the write index
+ * @tail: Local copy of the read index
  * @ptr: Address to pointer for the next segment write
  * @returns: Maximum size that can be written until the FIFO is either full
  *           or the end of the FIFO has been reached.
@@ -1207,15 +1188,11 @@ static void update_packet_state(struct smd_channel *ch)
  * defined as either the space available between the read index (tail) and the
  * write index (head) or the space available to the end of the FIFO.
  */
-static unsigned int ch_write_buffer(struct smd_channel *ch, void **ptr)
+static unsigned int ch_write_buffer(struct smd_channel *ch, unsigned int head,
+				    unsigned int tail, void **ptr)
 {
-	unsigned int head = ch->half_ch->get_head(ch->send);
-	unsigned int tail = ch->half_ch->get_tail(ch->send);
 	unsigned int fifo_size = ch->fifo_size;
 
-	WARN_ON(fifo_size >= SZ_1M);
-	WARN_ON(head >= fifo_size);
-	WARN_ON(tail >= fifo_size);
 	WARN_ON(OVERFLOW_ADD_UNSIGNED(uintptr_t, (uintptr_t)ch->send_data,
 								head));
 
@@ -1231,18 +1208,11 @@ static unsigned int ch_write_buffer(struct smd_channel *ch, void **ptr)
 
 }
 
-/* advace the fifo write pointer after freespace
+/* publish the fifo write pointer after freespace
  * from ch_write_buffer is filled
  */
-static void ch_write_done(struct smd_channel *ch, unsigned int count)
+static void ch_write_done(struct smd_channel *ch, unsigned int head)
 {
-	unsigned int head = ch->half_ch->get_head(ch->send);
-	unsigned int fifo_size = ch->fifo_size;
-
-	WARN_ON(count > smd_stream_write_avail(ch));
-	head += count;
-	if (head >= fifo_size)
-		head -= fifo_size;
 	ch->half_ch->set_head(ch->send, head);
 	wmb();  /* Make sure memory is visible before setting signal */
 	ch->half_ch->set_fHEAD(ch->send, 1);
@@ -1521,7 +1491,8 @@ static int smd_stream_write(smd_channel_t *ch, const void *_data, int len,
 {
 	void *ptr;
 	const unsigned char *buf = _data;
-	unsigned int xfer;
+	unsigned int head, tail, xfer;
+	unsigned int fifo_size = ch->fifo_size;
 	int orig_len = len;
 
 	SMD_DBG("smd_stream_write() %d -> ch%d\n", len, ch->n);
@@ -1530,22 +1501,33 @@ static int smd_stream_write(smd_channel_t *ch, const void *_data, int len,
 	else if (len == 0)
 		return 0;
 
-	while ((xfer = ch_write_buffer(ch, &ptr)) != 0) {
-		if (!ch_is_open(ch)) {
-			len = orig_len;
-			break;
-		}
+	if (!ch_is_open(ch))
+		return 0;
+
+	/* Only we move head and tail only frees space, so read both once */
+	head = ch->half_ch->get_head(ch->send);
+	tail = ch->half_ch->get_tail(ch->send);
+	WARN_ON(fifo_size >= SZ_1M);
+	if (WARN_ON(head >= fifo_size || tail >= fifo_size))
+		return 0;
+
+	while ((xfer = ch_write_buffer(ch, head, tail, &ptr)) != 0) {
 		if (xfer > len)
 			xfer = len;
 
 		ch->write_to_fifo(ptr, buf, xfer);
-		ch_write_done(ch, xfer);
+		head += xfer;
+		if (head >= fifo_size)
+			head -= fifo_size;
 		len -= xfer;
 		buf += xfer;
 		if (len == 0)
 			break;
 	}
 
+	if (orig_len - len)
+		ch_write_done(ch, head);
+
 	if (orig_len - len && intr_ntfy)
 		ch->notify_other_cpu(ch);
 
@@ -2146,6 +2128,35 @@ int smd_write(smd_channel_t *ch, const void *data, int len)
 }
 EXPORT_SYMBOL(smd_write);
 
+int smd_writev(smd_channel_t *ch, const struct kvec *vec, int count)
+{
+	bool notify = false;
+	int i, ret = 0;
+
+	if (!ch) {
+		pr_err("%s: Invalid channel specified\n", __func__);
+		return -ENODEV;
+	}
+
+	if (ch->pending_pkt_sz)
+		return -EBUSY;
+
+	for (i = 0; i < count; i++) {
+		ret = ch->write(ch, vec[i].iov_base, vec[i].iov_len, false);
+		if (ret > 0)
+			notify = true;
+		if (ret != vec[i].iov_len)
+			break;
+	}
+
+	/* One interrupt for the whole burst */
+	if (notify)
+		ch->notify_other_cpu(ch);
+
+	return (i || ret >= 0) ? i : ret;
+}
+EXPORT_SYMBOL(smd_writev);
+
 int smd_read_avail(smd_channel_t *ch)
 {
 	if (!ch) {
@@ -23,6 +23,8 @@
 #include <linux/sysfs.h>
 #include <linux/workqueue.h>
 #include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/err.h>
 #include <linux/list.h>
 #include <linux/list_sort.h>
@@ -50,6 +52,8 @@
 	dev_err(desc->dev, "%s: " fmt, desc->name, ##__VA_ARGS__)
 #define pil_info(desc, fmt, ...)					\
 	dev_info(desc->dev, "%s: " fmt, desc->name, ##__VA_ARGS__)
+#define pil_dbg(desc, fmt, ...)						\
+	dev_dbg(desc->dev, "%s: " fmt, desc->name, ##__VA_ARGS__)
 
 #if defined(CONFIG_ARM)
 #define pil_memset_io(d, c, count) memset(d, c, count)
@@ -93,6 +97,7 @@ struct pil_mdt {
  * @filesz: size of segment on disk
  * @num: segment number
  * @relocated: true if segment is relocated, false otherwise
+ * @load_us: time it took to read and zero-fill the segment
  *
  * Loosely based on an elf program header. Contains all necessary information
  * to load and initialize a segment of the image in memory.
@@ -104,6 +109,7 @@ struct pil_seg {
 	int num;
 	struct list_head list;
 	bool relocated;
+	s64 load_us;
 };
 
 /**
@@ -833,6 +839,7 @@ static int pil_load_seg(struct pil_desc *desc, struct pil_seg *seg)
 		.dev = desc->dev,
 	};
 	void *map_data = desc->map_data ? desc->map_data : &map_fw_info;
+	ktime_t start = ktime_get();
 
 	if (seg->filesz) {
 		snprintf(fw_name, ARRAY_SIZE(fw_name), "%s.b%02d",
@@ -885,12 +892,30 @@ static int pil_load_seg(struct pil_desc *desc, struct pil_seg *seg)
 		paddr += size;
 	}
 
-	if (desc->ops->verify_blob) {
-		ret = desc->ops->verify_blob(desc, seg->paddr, seg->sz);
-		if (ret)
-			pil_err(desc, "Blob%u failed verification(rc:%d)\n",
-								num, ret);
-	}
+	seg->load_us = ktime_us_delta(ktime_get(), start);
+	pil_dbg(desc, "Blob%u: %lu bytes in %lld us (%llu KB/s)\n", num,
+		seg->filesz, seg->load_us,
+		seg->load_us ? div64_u64((u64)seg->filesz * USEC_PER_SEC,
+					 (u64)seg->load_us * SZ_1K) : 0);
+
+	return 0;
+}
+
+/*
+ * Hand a loaded segment to the authenticator. The MBA extends a single
+ * code length register, so segments have to be passed in address order.
+ */
+static int pil_verify_seg(struct pil_desc *desc, struct pil_seg *seg)
+{
+	int ret;
+
+	if (!desc->ops->verify_blob)
+		return 0;
+
+	ret = desc->ops->verify_blob(desc, seg->paddr, seg->sz);
+	if (ret)
+		pil_err(desc, "Blob%u failed verification(rc:%d)\n",
+							seg->num, ret);
 
 	return ret;
 }
@@ -1009,7 +1034,11 @@ static int pil_load_segs(struct pil_desc *desc)
 
 	bitmap_zero(err_map, priv->num_segs);
 
-	/* Wait for the parallel loads to finish */
+	/*
+	 * Wait for the parallel loads to finish. The segments are sorted by
+	 * address, so each one is verified as soon as it and all segments
+	 * below it are in memory, while the ones above are still loading.
+	 */
 	seg_id = 0;
 	list_for_each_entry(seg, &desc->priv->segs, list) {
 		flush_work(&pil_seg_data[seg_id].load_seg_work);
@@ -1023,6 +1052,9 @@ static int pil_load_segs(struct pil_desc *desc)
 				"Failed to load the segment[%d]. ret = %d\n",
 				seg_id, pil_seg_data[seg_id].retval);
 			__set_bit(seg_id, err_map);
+		} else if (bitmap_empty(err_map, priv->num_segs) &&
+			   pil_verify_seg(desc, seg)) {
+			__set_bit(seg_id, err_map);
 		}
 
 		seg_id++;
@@ -1056,6 +1088,7 @@ int pil_boot(struct pil_desc *desc)
 	struct pil_priv *priv = desc->priv;
 	bool mem_protect = false;
 	bool hyp_assign = false;
+	ktime_t start, t_vote, t_load;
 
 	ret = pil_notify_aop(desc, "on");
 	if (ret < 0) {
@@ -1109,11 +1142,13 @@ int pil_boot(struct pil_desc *desc)
 		goto release_fw;
 
 	desc->priv->unvoted_flag = 0;
+	start = ktime_get();
 	ret = pil_proxy_vote(desc);
 	if (ret) {
 		pil_err(desc, "Failed to proxy vote(rc:%d)\n", ret);
 		goto release_fw;
 	}
+	t_vote = ktime_get();
 
 	trace_pil_event("before_init_image", desc);
 	if (desc->ops->init_image)
@@ -1164,6 +1199,8 @@ int pil_boot(struct pil_desc *desc)
 	if (desc->sequential_load) {
 		list_for_each_entry(seg, &desc->priv->segs, list) {
 			ret = pil_load_seg(desc, seg);
+			if (!ret)
+				ret = pil_verify_seg(desc, seg);
 			if (ret)
 				goto err_deinit_image;
 		}
@@ -1187,13 +1224,16 @@ int pil_boot(struct pil_desc *desc)
 	}
 
 	trace_pil_event("before_auth_reset", desc);
+	t_load = ktime_get();
 	ret = desc->ops->auth_and_reset(desc);
 	if (ret) {
 		pil_err(desc, "Failed to bring out of reset(rc:%d)\n", ret);
 		goto err_auth_and_reset;
 	}
 	trace_pil_event("reset_done", desc);
-	pil_info(desc, "Brought out of reset\n");
+	pil_info(desc, "Brought out of reset (vote %lld ms, load %lld ms, auth %lld ms)\n",
+		 ktime_ms_delta(t_vote, start), ktime_ms_delta(t_load, t_vote),
+		 ktime_ms_delta(ktime_get(), t_load));
 	place_marker("M - Modem out of reset");
 	desc->modem_ssr = false;
 err_auth_and_reset:
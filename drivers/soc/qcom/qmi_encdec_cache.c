@@ -0,0 +1,793 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Cache of compiled QMI message descriptors.
+ *
+ * qmi_kernel_encode() and qmi_kernel_decode() interpret the elem_info
+ * table of a message on every call: the way to the next TLV is found by
+ * walking the table, every incoming TLV is looked up by scanning it and
+ * arrays are copied one element at a time. The first time an elem_info
+ * table is used it is compiled here into an array of ops with all of that
+ * worked out, and later messages of that type run over the ops.
+ *
+ * The compiled code must give exactly what the library gives. The first
+ * messages of each type are therefore run through both and compared, and
+ * a type whose results ever differ is left to the library from then on.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/mutex.h>
+#include <linux/rculist.h>
+#include <linux/hashtable.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/qmi_encdec.h>
+
+#include "qmi_interface_priv.h"
+
+#define QMI_TLV_HDR_SIZE	(sizeof(uint8_t) + sizeof(uint16_t))
+#define QMI_OPT_TLV_START	0x10
+#define QMI_TLV_NONE		0xFFFF
+#define QMI_PROG_MAX_DEPTH	8
+#define QMI_PROG_HASH_BITS	6
+
+static bool enable = true;
+module_param(enable, bool, 0644);
+MODULE_PARM_DESC(enable, "Use the compiled QMI message descriptors");
+
+static unsigned int verify = 8;
+module_param(verify, uint, 0644);
+MODULE_PARM_DESC(verify,
+		 "Messages of each type compared with the QMI library first");
+
+struct qmi_prog;
+
+/**
+ * struct qmi_op - One compiled elem_info entry
+ * @type: Data type of the element, enum elem_type
+ * @array: Array type of the element, enum array_type
+ * @tlv_type: TLV type of the element
+ * @skip: Op to continue at when the element is left out of the message
+ * @size: Size of a single instance of the element
+ * @len: Array length of the element, the maximum for a variable one
+ * @offset: Offset of the element in the C structure
+ * @sub: Compiled nested structure of a QMI_STRUCT element
+ */
+struct qmi_op {
+	u8 type;
+	u8 array;
+	u8 tlv_type;
+	u16 skip;
+	u32 size;
+	u32 len;
+	u32 offset;
+	struct qmi_prog *sub;
+};
+
+/**
+ * struct qmi_prog - A compiled message or nested structure
+ * @node: Entry in qmi_prog_hash, messages only
+ * @free_node: Entry in the list of programs to free on a module unload
+ * @ei: The elem_info table the program was compiled from
+ * @msg_id: Message ID of the first descriptor seen with @ei
+ * @tlv_op: First op of each TLV type, messages only
+ * @c_size: Bytes of the C structure the elements span
+ * @verify: Messages left to compare with the library
+ * @hits: Messages encoded or decoded by the program
+ * @bad: Set once the program failed to compile or a comparison failed
+ * @nr_ops: Number of ops, the last one is the QMI_EOTI one
+ * @ops: The ops, one per elem_info entry
+ */
+struct qmi_prog {
+	struct hlist_node node;
+	struct list_head free_node;
+	struct elem_info *ei;
+	uint16_t msg_id;
+	u16 *tlv_op;
+	u32 c_size;
+	atomic_t verify;
+	atomic_t hits;
+	bool bad;
+	unsigned int nr_ops;
+	struct qmi_op ops[];
+};
+
+/* Keyed by the elem_info table, a msg_desc may live on the stack */
+static DEFINE_HASHTABLE(qmi_prog_hash, QMI_PROG_HASH_BITS);
+static DEFINE_MUTEX(qmi_prog_lock);
+
+static void qmi_prog_free(struct qmi_prog *prog)
+{
+	unsigned int i;
+
+	if (!prog)
+		return;
+
+	for (i = 0; i < prog->nr_ops; i++)
+		qmi_prog_free(prog->ops[i].sub);
+	kfree(prog->tlv_op);
+	kfree(prog);
+}
+
+static u32 qmi_op_count(struct qmi_op *op)
+{
+	return op->array == NO_ARRAY ? 1 : op->len;
+}
+
+static struct qmi_prog *qmi_prog_compile(struct elem_info *ei_array,
+					 int level)
+{
+	struct qmi_prog *prog;
+	struct elem_info *ei;
+	struct qmi_op *op;
+	unsigned int n, i, j;
+	u32 end;
+	int rc;
+
+	if (!ei_array || level > QMI_PROG_MAX_DEPTH)
+		return ERR_PTR(-EINVAL);
+
+	for (n = 0; ei_array[n].data_type != QMI_EOTI; n++)
+		if (n >= QMI_TLV_NONE - 1)
+			return ERR_PTR(-E2BIG);
+	n++;
+
+	prog = kzalloc(sizeof(*prog) + n * sizeof(*op), GFP_KERNEL);
+	if (!prog)
+		return ERR_PTR(-ENOMEM);
+	prog->ei = ei_array;
+	prog->nr_ops = n;
+
+	for (i = 0; i < n; i++) {
+		ei = &ei_array[i];
+		op = &prog->ops[i];
+		op->type = ei->data_type;
+		op->array = ei->is_array;
+		op->tlv_type = ei->tlv_type;
+		op->size = ei->elem_size;
+		op->len = ei->elem_len;
+		op->offset = ei->offset;
+
+		switch (ei->data_type) {
+		case QMI_EOTI:
+			end = 0;
+			break;
+
+		case QMI_DATA_LEN:
+			/* The library stores the decoded length as a u32 */
+			end = op->offset + max_t(u32, op->size, sizeof(u32));
+			break;
+
+		case QMI_OPT_FLAG:
+		case QMI_UNSIGNED_1_BYTE:
+		case QMI_UNSIGNED_2_BYTE:
+		case QMI_UNSIGNED_4_BYTE:
+		case QMI_UNSIGNED_8_BYTE:
+		case QMI_SIGNED_2_BYTE_ENUM:
+		case QMI_SIGNED_4_BYTE_ENUM:
+			end = op->offset + op->size * qmi_op_count(op);
+			break;
+
+		case QMI_STRUCT:
+			op->sub = qmi_prog_compile(ei->ei_array, level + 1);
+			if (IS_ERR(op->sub)) {
+				rc = PTR_ERR(op->sub);
+				op->sub = NULL;
+				goto compile_err;
+			}
+			end = op->offset + op->size * qmi_op_count(op);
+			break;
+
+		case QMI_STRING:
+			end = op->offset + op->size * (op->len + 1);
+			break;
+
+		default:
+			rc = -EINVAL;
+			goto compile_err;
+		}
+		prog->c_size = max(prog->c_size, end);
+
+		/* Where skip_to_next_elem() would go from this element */
+		if (level > 1) {
+			op->skip = i + 1;
+		} else {
+			for (j = i; j + 1 < n &&
+			     ei_array[j].tlv_type == ei_array[j + 1].tlv_type;
+			     j++)
+				;
+			op->skip = j + 1;
+		}
+	}
+
+	if (level == 1) {
+		prog->tlv_op = kmalloc_array(U8_MAX + 1, sizeof(u16),
+					     GFP_KERNEL);
+		if (!prog->tlv_op) {
+			rc = -ENOMEM;
+			goto compile_err;
+		}
+		memset(prog->tlv_op, 0xFF, (U8_MAX + 1) * sizeof(u16));
+		/* An incoming TLV goes to the first element of its type */
+		for (i = n - 1; i-- > 0;)
+			prog->tlv_op[prog->ops[i].tlv_type] = i;
+	}
+
+	return prog;
+
+compile_err:
+	qmi_prog_free(prog);
+	return ERR_PTR(rc);
+}
+
+static int qmi_prog_encode(struct qmi_prog *prog, u8 *out, const u8 *in,
+			   u32 out_len, int level);
+
+static int qmi_prog_encode_struct(struct qmi_op *op, u8 *dst, const u8 *src,
+				  u32 count, u32 out_len, int level)
+{
+	u32 i, encoded = 0;
+	int rc;
+
+	for (i = 0; i < count; i++) {
+		rc = qmi_prog_encode(op->sub, dst, src, out_len - encoded,
+				     level);
+		if (rc < 0)
+			return rc;
+		dst += rc;
+		src += op->size;
+		encoded += rc;
+	}
+
+	return encoded;
+}
+
+static int qmi_prog_encode_string(struct qmi_op *op, u8 *dst, const u8 *src,
+				  u32 out_len, int level)
+{
+	u32 len, len_sz = 0;
+
+	len = strnlen((const char *)src, op->len + 1);
+	if (len > op->len)
+		return -EINVAL;
+
+	if (level == 1) {
+		if (len + QMI_TLV_HDR_SIZE > out_len)
+			return -ETOOSMALL;
+	} else {
+		len_sz = op->len <= U8_MAX ? sizeof(uint8_t) : sizeof(uint16_t);
+		if (len + len_sz > out_len)
+			return -ETOOSMALL;
+		memcpy(dst, &len, len_sz);
+	}
+	memcpy(dst + len_sz, src, len * op->size);
+
+	return len_sz + len * op->size;
+}
+
+static int qmi_prog_encode(struct qmi_prog *prog, u8 *out, const u8 *in,
+			   u32 out_len, int level)
+{
+	struct qmi_op *op = prog->ops;
+	u8 *dst = out, *tlv_ptr = out;
+	u32 data_len = 0, encoded = 0, tlv_len = 0, n;
+	const u8 *src;
+	u16 tlv_len16;
+	u8 tlv_type;
+	int rc;
+
+	if (level == 1)
+		dst += QMI_TLV_HDR_SIZE;
+
+	while (op->type != QMI_EOTI) {
+		src = in + op->offset;
+		tlv_type = op->tlv_type;
+
+		if (op->array == NO_ARRAY)
+			data_len = 1;
+		else if (op->array == STATIC_ARRAY)
+			data_len = op->len;
+		else if (!data_len || op->len < data_len)
+			return -EINVAL;
+
+		switch (op->type) {
+		case QMI_OPT_FLAG:
+			op = *src ? op + 1 : prog->ops + op->skip;
+			continue;
+
+		case QMI_DATA_LEN:
+			n = op->size == sizeof(uint8_t) ? sizeof(uint8_t) :
+							  sizeof(uint16_t);
+			if (n + encoded + QMI_TLV_HDR_SIZE > out_len)
+				return -ETOOSMALL;
+			data_len = 0;
+			memcpy(&data_len, src, min_t(u32, op->size,
+						     sizeof(data_len)));
+			memcpy(dst, &data_len, n);
+			dst += n;
+			encoded += n;
+			tlv_len += n;
+			op++;
+			if (data_len)
+				continue;
+			/* An empty array ends its TLV after the length */
+			op = prog->ops + op->skip;
+			break;
+
+		case QMI_UNSIGNED_1_BYTE:
+		case QMI_UNSIGNED_2_BYTE:
+		case QMI_UNSIGNED_4_BYTE:
+		case QMI_UNSIGNED_8_BYTE:
+		case QMI_SIGNED_2_BYTE_ENUM:
+		case QMI_SIGNED_4_BYTE_ENUM:
+			n = data_len * op->size;
+			if (n + encoded + QMI_TLV_HDR_SIZE > out_len)
+				return -ETOOSMALL;
+			memcpy(dst, src, n);
+			dst += n;
+			encoded += n;
+			tlv_len += n;
+			op++;
+			break;
+
+		case QMI_STRUCT:
+			rc = qmi_prog_encode_struct(op, dst, src, data_len,
+						    out_len - encoded,
+						    level + 1);
+			if (rc < 0)
+				return rc;
+			dst += rc;
+			encoded += rc;
+			tlv_len += rc;
+			op++;
+			break;
+
+		case QMI_STRING:
+			rc = qmi_prog_encode_string(op, dst, src,
+						    out_len - encoded, level);
+			if (rc < 0)
+				return rc;
+			dst += rc;
+			encoded += rc;
+			tlv_len += rc;
+			op++;
+			break;
+
+		default:
+			return -EINVAL;
+		}
+
+		if (level == 1) {
+			tlv_len16 = tlv_len;
+			tlv_ptr[0] = tlv_type;
+			memcpy(tlv_ptr + 1, &tlv_len16, sizeof(tlv_len16));
+			encoded += QMI_TLV_HDR_SIZE;
+			tlv_ptr = dst;
+			tlv_len = 0;
+			dst += QMI_TLV_HDR_SIZE;
+		}
+	}
+
+	return encoded;
+}
+
+static int qmi_prog_decode(struct qmi_prog *prog, u8 *out, const u8 *in,
+			   u32 in_len, int level);
+
+static int qmi_prog_decode_struct(struct qmi_op *op, u8 *dst, const u8 *src,
+				  u32 count, u32 tlv_len, int level)
+{
+	u32 i, decoded = 0;
+	int rc;
+
+	for (i = 0; i < count && decoded < tlv_len; i++) {
+		rc = qmi_prog_decode(op->sub, dst, src, tlv_len - decoded,
+				     level);
+		if (rc < 0)
+			return rc;
+		src += rc;
+		dst += op->size;
+		decoded += rc;
+	}
+
+	if ((level <= 2 && decoded != tlv_len) ||
+	    (level > 2 && (i < count || decoded > tlv_len)))
+		return -EFAULT;
+
+	return decoded;
+}
+
+static int qmi_prog_decode_string(struct qmi_op *op, u8 *dst, const u8 *src,
+				  u32 tlv_len, int level)
+{
+	u32 len = 0, len_sz = 0;
+
+	if (level == 1) {
+		len = tlv_len;
+	} else {
+		len_sz = op->len <= U8_MAX ? sizeof(uint8_t) : sizeof(uint16_t);
+		if (len_sz > tlv_len)
+			return -EFAULT;
+		memcpy(&len, src, len_sz);
+	}
+
+	if (len > op->len)
+		return -ETOOSMALL;
+	if (len_sz + len * op->size > tlv_len)
+		return -EFAULT;
+
+	memcpy(dst, src + len_sz, len * op->size);
+	dst[len] = '\0';
+
+	return len_sz + len * op->size;
+}
+
+static int qmi_prog_decode(struct qmi_prog *prog, u8 *out, const u8 *in,
+			   u32 in_len, int level)
+{
+	struct qmi_op *op = prog->ops;
+	u32 data_len = 0, decoded = 0, tlv_len = 0, n;
+	u16 tlv_len16;
+	u8 *dst;
+	int rc;
+
+	while (decoded < in_len) {
+		if (level >= 2 && op->type == QMI_EOTI)
+			return decoded;
+
+		if (level == 1) {
+			if (QMI_TLV_HDR_SIZE > in_len - decoded)
+				return -EFAULT;
+			memcpy(&tlv_len16, in + 1, sizeof(tlv_len16));
+			tlv_len = tlv_len16;
+			n = prog->tlv_op[in[0]];
+			if (n == QMI_TLV_NONE && in[0] < QMI_OPT_TLV_START)
+				return -EINVAL;
+			in += QMI_TLV_HDR_SIZE;
+			decoded += QMI_TLV_HDR_SIZE;
+			if (tlv_len > in_len - decoded)
+				return -EFAULT;
+			if (n == QMI_TLV_NONE) {
+				/* Unknown optional TLVs are skipped */
+				in += tlv_len;
+				decoded += tlv_len;
+				continue;
+			}
+			op = prog->ops + n;
+		} else {
+			tlv_len = in_len - decoded;
+		}
+
+		dst = out + op->offset;
+		if (op->type == QMI_OPT_FLAG) {
+			*dst = 1;
+			op++;
+			dst = out + op->offset;
+		}
+
+		if (op->type == QMI_DATA_LEN) {
+			n = op->size == sizeof(uint8_t) ? sizeof(uint8_t) :
+							  sizeof(uint16_t);
+			if (n > tlv_len)
+				return -EFAULT;
+			data_len = 0;
+			memcpy(&data_len, in, n);
+			memcpy(dst, &data_len, sizeof(u32));
+			op++;
+			dst = out + op->offset;
+			tlv_len -= n;
+			in += n;
+			decoded += n;
+		}
+
+		if (op->array == NO_ARRAY)
+			data_len = 1;
+		else if (op->array == STATIC_ARRAY)
+			data_len = op->len;
+		else if (data_len > op->len)
+			return -ETOOSMALL;
+
+		switch (op->type) {
+		case QMI_UNSIGNED_1_BYTE:
+		case QMI_UNSIGNED_2_BYTE:
+		case QMI_UNSIGNED_4_BYTE:
+		case QMI_UNSIGNED_8_BYTE:
+		case QMI_SIGNED_2_BYTE_ENUM:
+		case QMI_SIGNED_4_BYTE_ENUM:
+			rc = data_len * op->size;
+			if (rc > tlv_len)
+				return -EFAULT;
+			memcpy(dst, in, rc);
+			break;
+
+		case QMI_STRUCT:
+			rc = qmi_prog_decode_struct(op, dst, in, data_len,
+						    tlv_len, level + 1);
+			break;
+
+		case QMI_STRING:
+			rc = qmi_prog_decode_string(op, dst, in, tlv_len,
+						    level);
+			break;
+
+		default:
+			return -EINVAL;
+		}
+		if (rc < 0)
+			return rc;
+
+		in += rc;
+		decoded += rc;
+		op++;
+	}
+
+	return decoded;
+}
+
+static struct qmi_prog *qmi_prog_find(struct elem_info *ei)
+{
+	struct qmi_prog *prog;
+
+	hash_for_each_possible_rcu(qmi_prog_hash, prog, node,
+				   (unsigned long)ei) {
+		if (prog->ei == ei)
+			return prog;
+	}
+
+	return NULL;
+}
+
+static struct qmi_prog *qmi_prog_add(struct msg_desc *desc)
+{
+	struct qmi_prog *prog;
+
+	mutex_lock(&qmi_prog_lock);
+	prog = qmi_prog_find(desc->ei_array);
+	if (prog)
+		goto out;
+
+	prog = qmi_prog_compile(desc->ei_array, 1);
+	if (IS_ERR(prog)) {
+		pr_err("%s: msg_id 0x%x not compiled %ld\n", __func__,
+		       desc->msg_id, PTR_ERR(prog));
+		/* Remember the failure so that it is not tried again */
+		prog = kzalloc(sizeof(*prog), GFP_KERNEL);
+		if (!prog)
+			goto out;
+		prog->ei = desc->ei_array;
+		prog->bad = true;
+	}
+	prog->msg_id = desc->msg_id;
+	atomic_set(&prog->verify, verify);
+	hash_add_rcu(qmi_prog_hash, &prog->node, (unsigned long)prog->ei);
+out:
+	mutex_unlock(&qmi_prog_lock);
+	return prog;
+}
+
+/*
+ * The program is used after the RCU read side is left. It is only freed
+ * when the module that owns the elem_info table goes away, and by then
+ * nothing encodes or decodes that message any more.
+ */
+static struct qmi_prog *qmi_prog_get(struct msg_desc *desc)
+{
+	struct qmi_prog *prog;
+
+	if (!enable || !desc || !desc->ei_array)
+		return NULL;
+
+	rcu_read_lock();
+	prog = qmi_prog_find(desc->ei_array);
+	rcu_read_unlock();
+	if (!prog)
+		prog = qmi_prog_add(desc);
+
+	if (!prog || READ_ONCE(prog->bad))
+		return NULL;
+
+	return prog;
+}
+
+static void qmi_prog_mismatch(struct qmi_prog *prog, const char *what,
+			      int lib_rc, int rc)
+{
+	pr_err("%s: %s of msg_id 0x%x differs from the library %d/%d\n",
+	       __func__, what, prog->msg_id, lib_rc, rc);
+	WRITE_ONCE(prog->bad, true);
+}
+
+static int qmi_prog_verify_encode(struct qmi_prog *prog,
+				  struct msg_desc *desc, void *out_buf,
+				  uint32_t out_buf_len, void *in_c_struct)
+{
+	int lib_rc, rc;
+	u8 *buf;
+
+	lib_rc = qmi_kernel_encode(desc, out_buf, out_buf_len, in_c_struct);
+	buf = kmalloc(out_buf_len, GFP_KERNEL);
+	if (!buf)
+		return lib_rc;
+
+	rc = qmi_prog_encode(prog, buf, in_c_struct, out_buf_len, 1);
+	if (rc != lib_rc || (rc > 0 && memcmp(buf, out_buf, rc)))
+		qmi_prog_mismatch(prog, "encode", lib_rc, rc);
+	else
+		atomic_dec(&prog->verify);
+	kfree(buf);
+
+	return lib_rc;
+}
+
+static int qmi_prog_verify_decode(struct qmi_prog *prog,
+				  struct msg_desc *desc, void *out_c_struct,
+				  void *in_buf, uint32_t in_buf_len)
+{
+	int lib_rc, rc;
+	u8 *copy;
+
+	/* Both start from what the caller left in the structure */
+	copy = kmemdup(out_c_struct, prog->c_size, GFP_KERNEL);
+	lib_rc = qmi_kernel_decode(desc, out_c_struct, in_buf, in_buf_len);
+	if (!copy)
+		return lib_rc;
+
+	rc = qmi_prog_decode(prog, copy, in_buf, in_buf_len, 1);
+	if (rc > 0)
+		rc = 0;
+	if (rc != lib_rc ||
+	    (!rc && memcmp(copy, out_c_struct, prog->c_size)))
+		qmi_prog_mismatch(prog, "decode", lib_rc, rc);
+	else
+		atomic_dec(&prog->verify);
+	kfree(copy);
+
+	return lib_rc;
+}
+
+int qmi_cached_encode(struct msg_desc *desc, void *out_buf,
+		      uint32_t out_buf_len, void *in_c_struct)
+{
+	struct qmi_prog *prog;
+
+	/* Leave the corner cases and their error reporting to the library */
+	if (!in_c_struct || !out_buf || !desc ||
+	    desc->max_msg_len > out_buf_len)
+		return qmi_kernel_encode(desc, out_buf, out_buf_len,
+					 in_c_struct);
+
+	prog = qmi_prog_get(desc);
+	if (!prog)
+		return qmi_kernel_encode(desc, out_buf, out_buf_len,
+					 in_c_struct);
+
+	if (atomic_read(&prog->verify) > 0)
+		return qmi_prog_verify_encode(prog, desc, out_buf,
+					      out_buf_len, in_c_struct);
+
+	atomic_inc(&prog->hits);
+	return qmi_prog_encode(prog, out_buf, in_c_struct, out_buf_len, 1);
+}
+
+int qmi_cached_decode(struct msg_desc *desc, void *out_c_struct,
+		      void *in_buf, uint32_t in_buf_len)
+{
+	struct qmi_prog *prog;
+	int rc;
+
+	if (!out_c_struct || !in_buf || !in_buf_len)
+		return qmi_kernel_decode(desc, out_c_struct, in_buf,
+					 in_buf_len);
+
+	prog = qmi_prog_get(desc);
+	if (!prog)
+		return qmi_kernel_decode(desc, out_c_struct, in_buf,
+					 in_buf_len);
+
+	if (atomic_read(&prog->verify) > 0)
+		return qmi_prog_verify_decode(prog, desc, out_c_struct,
+					      in_buf, in_buf_len);
+
+	atomic_inc(&prog->hits);
+	rc = qmi_prog_decode(prog, out_c_struct, in_buf, in_buf_len, 1);
+	return rc < 0 ? rc : 0;
+}
+
+static bool qmi_prog_in_module(struct qmi_prog *prog, struct module *mod)
+{
+	unsigned int i;
+
+	if (within_module((unsigned long)prog->ei, mod))
+		return true;
+
+	for (i = 0; i < prog->nr_ops; i++)
+		if (prog->ops[i].sub &&
+		    qmi_prog_in_module(prog->ops[i].sub, mod))
+			return true;
+
+	return false;
+}
+
+static int qmi_prog_module_notify(struct notifier_block *nb,
+				  unsigned long action, void *data)
+{
+	struct qmi_prog *prog, *temp;
+	struct hlist_node *tmp;
+	LIST_HEAD(free_list);
+	int bkt;
+
+	if (action != MODULE_STATE_GOING)
+		return NOTIFY_DONE;
+
+	mutex_lock(&qmi_prog_lock);
+	hash_for_each_safe(qmi_prog_hash, bkt, tmp, prog, node) {
+		if (!qmi_prog_in_module(prog, data))
+			continue;
+		hash_del_rcu(&prog->node);
+		list_add(&prog->free_node, &free_list);
+	}
+	mutex_unlock(&qmi_prog_lock);
+
+	if (list_empty(&free_list))
+		return NOTIFY_OK;
+
+	synchronize_rcu();
+	list_for_each_entry_safe(prog, temp, &free_list, free_node)
+		qmi_prog_free(prog);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block qmi_prog_module_nb = {
+	.notifier_call = qmi_prog_module_notify,
+};
+
+static int qmi_prog_show(struct seq_file *m, void *v)
+{
+	struct qmi_prog *prog;
+	int bkt;
+
+	seq_puts(m, "msg_id ops c_size verify hits state\n");
+	mutex_lock(&qmi_prog_lock);
+	hash_for_each(qmi_prog_hash, bkt, prog, node)
+		seq_printf(m, "0x%04x %3u %6u %6d %u %s\n", prog->msg_id,
+			   prog->nr_ops, prog->c_size,
+			   max(atomic_read(&prog->verify), 0),
+			   atomic_read(&prog->hits),
+			   prog->bad ? "library" : "compiled");
+	mutex_unlock(&qmi_prog_lock);
+
+	return 0;
+}
+
+static int qmi_prog_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, qmi_prog_show, NULL);
+}
+
+static const struct file_operations qmi_prog_fops = {
+	.open		= qmi_prog_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+void qmi_encdec_cache_init(void)
+{
+	register_module_notifier(&qmi_prog_module_nb);
+	debugfs_create_file("qmi_encdec_cache", 0400, NULL, NULL,
+			    &qmi_prog_fops);
+}
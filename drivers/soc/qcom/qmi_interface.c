@@ -30,6 +30,11 @@
 #include <linux/hashtable.h>
 #include <linux/ipc_router.h>
 #include <linux/ipc_logging.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/percpu.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
 
 #include <soc/qcom/msm_qmi_interface.h>
 
@@ -143,6 +148,171 @@ static void clean_txn_info(struct qmi_handle *handle);
 static void *qmi_req_resp_log_ctx;
 static void *qmi_ind_log_ctx;
 
+/*
+ * Client transaction latency, per service. A slot is claimed for a
+ * service on its first transaction and never given back; services beyond
+ * QMI_LAT_MAX_SVC are not tracked. The histograms are per CPU so that
+ * recording a sample takes no lock and touches no shared cache line.
+ */
+#define QMI_LAT_MAX_SVC		32
+#define QMI_LAT_BUCKETS		20	/* log2 of us, the last one is open */
+
+enum qmi_lat_stage {
+	QMI_LAT_QUEUE,		/* request to handing it to IPC Router */
+	QMI_LAT_SEND,		/* IPC Router and transport send */
+	QMI_LAT_RESP,		/* sent to response received */
+	QMI_LAT_TOTAL,		/* request to response received */
+	QMI_LAT_STAGES,
+};
+
+static const char * const qmi_lat_stage_names[QMI_LAT_STAGES] = {
+	"queue", "send", "response", "total",
+};
+
+struct qmi_lat_hist {
+	u32 bucket[QMI_LAT_BUCKETS];
+	u64 sum_us;
+	u32 max_us;
+};
+
+/* service id + 1, 0 marks a free slot */
+static u32 qmi_lat_svc[QMI_LAT_MAX_SVC];
+static DEFINE_PER_CPU(struct qmi_lat_hist [QMI_LAT_MAX_SVC][QMI_LAT_STAGES],
+		      qmi_lat_hist);
+
+static int qmi_lat_slot(u32 service_id)
+{
+	u32 key = service_id + 1, old;
+	int i;
+
+	for (i = 0; i < QMI_LAT_MAX_SVC; i++) {
+		old = READ_ONCE(qmi_lat_svc[i]);
+		if (!old)
+			old = cmpxchg(&qmi_lat_svc[i], 0, key) ?: key;
+		if (old == key)
+			return i;
+	}
+
+	return -ENOSPC;
+}
+
+static void qmi_lat_add(int slot, enum qmi_lat_stage stage, ktime_t start,
+			ktime_t end)
+{
+	struct qmi_lat_hist *h;
+	s64 us = ktime_us_delta(end, start);
+	u32 val = us < 0 ? 0 : min_t(s64, us, U32_MAX);
+	unsigned int idx = val < 2 ? 0 : ilog2(val);
+
+	h = &get_cpu_var(qmi_lat_hist)[slot][stage];
+	h->bucket[min_t(unsigned int, idx, QMI_LAT_BUCKETS - 1)]++;
+	h->sum_us += val;
+	if (val > h->max_us)
+		h->max_us = val;
+	put_cpu_var(qmi_lat_hist);
+}
+
+/* Called with the request handed to IPC Router at send_start */
+static void qmi_lat_sent(struct qmi_handle *handle, struct qmi_txn *txn,
+			 ktime_t send_start)
+{
+	int slot = qmi_lat_slot(handle->dest_service_id);
+
+	txn->sent_time = ktime_get();
+	if (slot < 0)
+		return;
+
+	qmi_lat_add(slot, QMI_LAT_QUEUE, txn->req_time, send_start);
+	qmi_lat_add(slot, QMI_LAT_SEND, send_start, txn->sent_time);
+}
+
+static void qmi_lat_resp(struct qmi_handle *handle, struct qmi_txn *txn)
+{
+	ktime_t now = ktime_get();
+	int slot;
+
+	if (!ktime_to_ns(txn->sent_time))
+		return;
+
+	slot = qmi_lat_slot(handle->dest_service_id);
+	if (slot < 0)
+		return;
+
+	qmi_lat_add(slot, QMI_LAT_RESP, txn->sent_time, now);
+	qmi_lat_add(slot, QMI_LAT_TOTAL, txn->req_time, now);
+}
+
+static int qmi_lat_show(struct seq_file *m, void *v)
+{
+	struct qmi_lat_hist sum, *h;
+	u32 key, count;
+	int i, j, cpu, s;
+
+	for (i = 0; i < QMI_LAT_MAX_SVC; i++) {
+		key = READ_ONCE(qmi_lat_svc[i]);
+		if (!key)
+			break;
+
+		seq_printf(m, "service 0x%x\n", key - 1);
+		for (s = 0; s < QMI_LAT_STAGES; s++) {
+			memset(&sum, 0, sizeof(sum));
+			for_each_possible_cpu(cpu) {
+				h = &per_cpu(qmi_lat_hist, cpu)[i][s];
+				for (j = 0; j < QMI_LAT_BUCKETS; j++)
+					sum.bucket[j] += h->bucket[j];
+				sum.sum_us += h->sum_us;
+				sum.max_us = max(sum.max_us, h->max_us);
+			}
+
+			count = 0;
+			for (j = 0; j < QMI_LAT_BUCKETS; j++)
+				count += sum.bucket[j];
+			seq_printf(m, "  %-8s samples %u avg_us %llu max_us %u\n",
+				   qmi_lat_stage_names[s], count,
+				   count ? div_u64(sum.sum_us, count) : 0,
+				   sum.max_us);
+			for (j = 0; j < QMI_LAT_BUCKETS; j++) {
+				if (!sum.bucket[j])
+					continue;
+				if (j == QMI_LAT_BUCKETS - 1)
+					seq_printf(m, "    >=%7u us: %u\n",
+						   1U << j, sum.bucket[j]);
+				else
+					seq_printf(m, "    <%8u us: %u\n",
+						   2U << j, sum.bucket[j]);
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int qmi_lat_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, qmi_lat_show, NULL);
+}
+
+/* Any write clears the histograms, the service slots stay */
+static ssize_t qmi_lat_write(struct file *file, const char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(&qmi_lat_hist, cpu), 0,
+		       sizeof(qmi_lat_hist));
+
+	return count;
+}
+
+static const struct file_operations qmi_lat_fops = {
+	.open		= qmi_lat_open,
+	.read		= seq_read,
+	.write		= qmi_lat_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 /**
  * qmi_log() - Pass log data to IPC logging framework
  * @handle:	The pointer to the qmi_handle
@@ -506,6 +676,23 @@ static void qmi_notify_event_worker(struct work_struct *work)
 	kfree(notify_work);
 }
 
+/*
+ * A client transaction is in the handle's txn_hash for as long as it sits
+ * in the txn_list waiting for its response, so that a response is matched
+ * without walking all the outstanding transactions.
+ */
+static void qmi_txn_track(struct qmi_handle *handle, struct qmi_txn *txn)
+{
+	list_add_tail(&txn->list, &handle->txn_list);
+	hash_add(handle->txn_hash, &txn->hash_node, txn->txn_id);
+}
+
+static void qmi_txn_untrack(struct qmi_txn *txn)
+{
+	list_del(&txn->list);
+	hash_del(&txn->hash_node);
+}
+
 /**
  * clnt_resume_tx_worker() - Handle the Resume_Tx event
  * @work : Pointer to the work strcuture.
@@ -522,6 +709,7 @@ static void clnt_resume_tx_worker(struct work_struct *work)
 	struct qmi_txn *pend_txn, *temp_txn;
 	int ret;
 	uint16_t msg_id;
+	ktime_t send_start;
 
 	mutex_lock(&handle->handle_lock);
 	if (handle->handle_reset)
@@ -529,6 +717,7 @@ static void clnt_resume_tx_worker(struct work_struct *work)
 
 	list_for_each_entry_safe(pend_txn, temp_txn,
 				&handle->pending_txn_list, list) {
+		send_start = ktime_get();
 		ret = msm_ipc_router_send_msg(
 				(struct msm_ipc_port *)handle->src_port,
 				(struct msm_ipc_addr *)handle->dest_info,
@@ -555,8 +744,9 @@ static void clnt_resume_tx_worker(struct work_struct *work)
 				wake_up(&pend_txn->wait_q);
 			}
 		} else {
+			qmi_lat_sent(handle, pend_txn, send_start);
 			list_del(&pend_txn->list);
-			list_add_tail(&pend_txn->list, &handle->txn_list);
+			qmi_txn_track(handle, pend_txn);
 		}
 	}
 out_clnt_handle_rtx:
@@ -713,10 +903,10 @@ static void handle_ctl_msg(struct work_struct *work)
 	mutex_unlock(&handle->handle_lock);
 }
 
-struct qmi_handle *qmi_handle_create(
+static struct qmi_handle *__qmi_handle_create(
 	void (*notify)(struct qmi_handle *handle,
 		       enum qmi_event_type event, void *notify_priv),
-	void *notify_priv)
+	void *notify_priv, unsigned int wq_flags)
 {
 	struct qmi_handle *temp_handle;
 	struct msm_ipc_port *port_ptr, *ctl_port_ptr;
@@ -730,7 +920,9 @@ struct qmi_handle *qmi_handle_create(
 	handle_count++;
 	scnprintf(wq_name, MAX_WQ_NAME_LEN, "qmi_hndl%08x", handle_count);
 	hash_add(handle_hash_tbl, &temp_handle->handle_hash, 0);
-	temp_handle->handle_wq = create_singlethread_workqueue(wq_name);
+	/* Ordered, the handle events must be processed in arrival order */
+	temp_handle->handle_wq = alloc_ordered_workqueue("%s",
+				WQ_MEM_RECLAIM | wq_flags, wq_name);
 	mutex_unlock(&handle_hash_tbl_lock);
 	if (!temp_handle->handle_wq) {
 		pr_err("%s: Couldn't create workqueue for handle\n", __func__);
@@ -750,6 +942,7 @@ struct qmi_handle *qmi_handle_create(
 
 	/* Initialize client specific elements */
 	INIT_LIST_HEAD(&temp_handle->txn_list);
+	hash_init(temp_handle->txn_hash);
 	INIT_LIST_HEAD(&temp_handle->pending_txn_list);
 
 	/* Initialize service specific elements */
@@ -785,8 +978,25 @@ struct qmi_handle *qmi_handle_create(
 	kfree(temp_handle);
 	return NULL;
 }
+
+struct qmi_handle *qmi_handle_create(
+	void (*notify)(struct qmi_handle *handle,
+		       enum qmi_event_type event, void *notify_priv),
+	void *notify_priv)
+{
+	return __qmi_handle_create(notify, notify_priv, 0);
+}
 EXPORT_SYMBOL(qmi_handle_create);
 
+struct qmi_handle *qmi_handle_create_highpri(
+	void (*notify)(struct qmi_handle *handle,
+		       enum qmi_event_type event, void *notify_priv),
+	void *notify_priv)
+{
+	return __qmi_handle_create(notify, notify_priv, WQ_HIGHPRI);
+}
+EXPORT_SYMBOL(qmi_handle_create_highpri);
+
 static void clean_txn_info(struct qmi_handle *handle)
 {
 	struct qmi_txn *txn_handle, *temp_txn_handle, *pend_txn;
@@ -810,7 +1020,7 @@ static void clean_txn_info(struct qmi_handle *handle)
 	list_for_each_entry_safe(txn_handle, temp_txn_handle,
 				 &handle->txn_list, list) {
 		if (txn_handle->type == QMI_ASYNC_TXN) {
-			list_del(&txn_handle->list);
+			qmi_txn_untrack(txn_handle);
 			kfree(txn_handle);
 		} else if (txn_handle->type == QMI_SYNC_TXN) {
 			wake_up(&txn_handle->wait_q);
@@ -889,6 +1099,7 @@ static int qmi_encode_and_send_req(struct qmi_txn **ret_txn_handle,
 	struct qmi_txn *txn_handle;
 	int rc, encoded_req_len;
 	void *encoded_req;
+	ktime_t send_start;
 
 	if (!handle || !handle->dest_info ||
 	    !req_desc || !resp_desc || !resp)
@@ -910,6 +1121,7 @@ static int qmi_encode_and_send_req(struct qmi_txn **ret_txn_handle,
 		return -ENOMEM;
 	}
 	txn_handle->type = type;
+	txn_handle->req_time = ktime_get();
 	INIT_LIST_HEAD(&txn_handle->list);
 	init_waitqueue_head(&txn_handle->wait_q);
 
@@ -931,7 +1143,7 @@ static int qmi_encode_and_send_req(struct qmi_txn **ret_txn_handle,
 		rc = -ENOMEM;
 		goto encode_and_send_req_err1;
 	}
-	rc = qmi_kernel_encode(req_desc,
+	rc = qmi_cached_encode(req_desc,
 		(void *)(encoded_req + QMI_HEADER_SIZE),
 		req_desc->max_msg_len, req);
 	if (rc < 0) {
@@ -960,19 +1172,22 @@ static int qmi_encode_and_send_req(struct qmi_txn **ret_txn_handle,
 		goto append_pend_txn;
 	}
 
-	list_add_tail(&txn_handle->list, &handle->txn_list);
+	qmi_txn_track(handle, txn_handle);
 	qmi_log(handle, QMI_REQUEST_CONTROL_FLAG, txn_handle->txn_id,
 			req_desc->msg_id, encoded_req_len);
 	/* Send the request */
+	send_start = ktime_get();
 	rc = msm_ipc_router_send_msg((struct msm_ipc_port *)(handle->src_port),
 		(struct msm_ipc_addr *)handle->dest_info,
 		encoded_req, encoded_req_len);
+	if (rc >= 0)
+		qmi_lat_sent(handle, txn_handle, send_start);
 append_pend_txn:
 	if (rc == -EAGAIN) {
 		txn_handle->enc_data = encoded_req;
 		txn_handle->enc_data_len = encoded_req_len;
 		if (list_empty(&handle->pending_txn_list))
-			list_del(&txn_handle->list);
+			qmi_txn_untrack(txn_handle);
 		list_add_tail(&txn_handle->list, &handle->pending_txn_list);
 		if (ret_txn_handle)
 			*ret_txn_handle = txn_handle;
@@ -991,7 +1206,7 @@ static int qmi_encode_and_send_req(struct qmi_txn **ret_txn_handle,
 	return 0;
 
 encode_and_send_req_err3:
-	list_del(&txn_handle->list);
+	qmi_txn_untrack(txn_handle);
 encode_and_send_req_err2:
 	kfree(encoded_req);
 encode_and_send_req_err1:
@@ -1050,7 +1265,7 @@ int qmi_send_req_wait(struct qmi_handle *handle,
 	rc = 0;
 
 send_req_wait_err:
-	list_del(&txn_handle->list);
+	qmi_txn_untrack(txn_handle);
 	kfree(txn_handle);
 	wake_up(&handle->reset_waitq);
 	mutex_unlock(&handle->handle_lock);
@@ -1133,7 +1348,7 @@ static int qmi_encode_and_send_resp(struct qmi_handle *handle,
 		rc = -ENOMEM;
 		goto encode_and_send_resp_err1;
 	}
-	rc = qmi_kernel_encode(resp_desc,
+	rc = qmi_cached_encode(resp_desc,
 		(void *)(encoded_resp + QMI_HEADER_SIZE),
 		resp_desc->max_msg_len, resp);
 	if (rc < 0) {
@@ -1408,7 +1623,7 @@ static int send_err_resp(struct qmi_handle *handle,
 		rc = -ENOMEM;
 		goto encode_and_send_err_resp_err0;
 	}
-	rc = qmi_kernel_encode(&err_resp_desc,
+	rc = qmi_cached_encode(&err_resp_desc,
 		(void *)(encoded_resp + QMI_HEADER_SIZE),
 		err_resp_desc.max_msg_len, &err_resp);
 	if (rc < 0) {
@@ -1531,7 +1746,7 @@ static int handle_qmi_request(struct qmi_handle *handle,
 		goto out_handle_req;
 	}
 
-	rc = qmi_kernel_decode(req_desc, req_struct,
+	rc = qmi_cached_decode(req_desc, req_struct,
 				(void *)(req_msg + QMI_HEADER_SIZE), msg_len);
 	if (rc < 0) {
 		pr_err("%s: Error decoding msg_id %d\n", __func__, msg_id);
@@ -1569,7 +1784,8 @@ static struct qmi_txn *find_txn_handle(struct qmi_handle *handle,
 {
 	struct qmi_txn *txn_handle;
 
-	list_for_each_entry(txn_handle, &handle->txn_list, list) {
+	hash_for_each_possible(handle->txn_hash, txn_handle, hash_node,
+			       txn_id) {
 		if (txn_handle->txn_id == txn_id)
 			return txn_handle;
 	}
@@ -1590,16 +1806,17 @@ static int handle_qmi_response(struct qmi_handle *handle,
 			__func__, txn_id);
 		return 0;
 	}
+	qmi_lat_resp(handle, txn_handle);
 
 	/* Decode the message */
-	rc = qmi_kernel_decode(txn_handle->resp_desc, txn_handle->resp,
+	rc = qmi_cached_decode(txn_handle->resp_desc, txn_handle->resp,
 			       (void *)(resp_msg + QMI_HEADER_SIZE), msg_len);
 	if (rc < 0) {
 		pr_err("%s: Response Decode Failure <%d: %d: %d> rc: %d\n",
 			__func__, txn_id, msg_id, msg_len, rc);
 		wake_up(&txn_handle->wait_q);
 		if (txn_handle->type == QMI_ASYNC_TXN) {
-			list_del(&txn_handle->list);
+			qmi_txn_untrack(txn_handle);
 			kfree(txn_handle);
 		}
 		return rc;
@@ -1618,7 +1835,7 @@ static int handle_qmi_response(struct qmi_handle *handle,
 			txn_handle->resp_cb(txn_handle->handle, msg_id,
 					    txn_handle->resp,
 					    txn_handle->resp_cb_data, 0);
-		list_del(&txn_handle->list);
+		qmi_txn_untrack(txn_handle);
 		kfree(txn_handle);
 		rc = 0;
 		break;
@@ -2225,6 +2442,8 @@ EXPORT_SYMBOL(qmi_svc_unregister);
 static int __init qmi_interface_init(void)
 {
 	qmi_log_init();
+	qmi_encdec_cache_init();
+	debugfs_create_file("qmi_latency", 0600, NULL, NULL, &qmi_lat_fops);
 	return 0;
 }
 module_init(qmi_interface_init);
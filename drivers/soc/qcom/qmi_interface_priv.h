@@ -19,6 +19,7 @@
 #include <linux/list.h>
 #include <linux/socket.h>
 #include <linux/gfp.h>
+#include <linux/ktime.h>
 #include <linux/platform_device.h>
 #include <linux/qmi_encdec.h>
 
@@ -39,6 +40,7 @@ enum handle_type {
 
 struct qmi_txn {
 	struct list_head list;
+	struct hlist_node hash_node;
 	uint16_t txn_id;
 	enum txn_type type;
 	struct qmi_handle *handle;
@@ -53,6 +55,8 @@ struct qmi_txn {
 			void *msg, void *resp_cb_data, int stat);
 	void *resp_cb_data;
 	wait_queue_head_t wait_q;
+	ktime_t req_time;
+	ktime_t sent_time;
 };
 
 /**
@@ -120,4 +124,11 @@ struct qmi_svc_clnt_conn {
 	struct mutex pending_txn_lock;
 };
 
+/* qmi_kernel_encode()/qmi_kernel_decode() through compiled descriptors */
+int qmi_cached_encode(struct msg_desc *desc, void *out_buf,
+		      uint32_t out_buf_len, void *in_c_struct);
+int qmi_cached_decode(struct msg_desc *desc, void *out_c_struct,
+		      void *in_buf, uint32_t in_buf_len);
+void qmi_encdec_cache_init(void);
+
 #endif
@@ -27,6 +27,8 @@
 #include <soc/qcom/ramdump.h>
 #include <linux/dma-mapping.h>
 #include <linux/of.h>
+#include <linux/lz4.h>
+#include <linux/vmalloc.h>
 
 
 #define RAMDUMP_NUM_DEVICES	256
@@ -41,6 +43,27 @@ static bool ramdump_devnode_inited;
 #define MAX_STRTBL_SIZE 512
 #define MAX_NAME_LENGTH 16
 
+/*
+ * With compress set, read() returns the dump as a sequence of blocks, each
+ * a struct ramdump_lz4_block followed by comp_size bytes of LZ4 data, or
+ * of raw data if comp_size equals raw_size. The file position still counts
+ * uncompressed bytes.
+ */
+static bool compress;
+#ifdef CONFIG_MSM_RAMDUMP_COMPRESS
+module_param(compress, bool, 0644);
+#endif
+
+static inline bool ramdump_compress(void)
+{
+	return IS_ENABLED(CONFIG_MSM_RAMDUMP_COMPRESS) && compress;
+}
+
+struct ramdump_lz4_block {
+	__le32 raw_size;
+	__le32 comp_size;
+};
+
 struct ramdump_device {
 	char name[256];
 
@@ -59,6 +82,10 @@ struct ramdump_device {
 	char *elfcore_buf;
 	unsigned long attrs;
 	bool complete_ramdump;
+
+	struct address_space *mapping;
+	void *lz4_wrkmem;
+	char *lz4_buf;
 };
 
 static int ramdump_open(struct inode *inode, struct file *filep)
@@ -67,6 +94,7 @@ static int ramdump_open(struct inode *inode, struct file *filep)
 					struct ramdump_device, cdev);
 	rd_dev->consumer_present = 1;
 	rd_dev->ramdump_status = 0;
+	rd_dev->mapping = filep->f_mapping;
 	filep->private_data = rd_dev;
 	return 0;
 }
@@ -78,6 +106,8 @@ static int ramdump_release(struct inode *inode, struct file *filep)
 					struct ramdump_device, cdev);
 	rd_dev->consumer_present = 0;
 	rd_dev->data_ready = 0;
+	/* Not mapped anymore, the file stays open while a mapping exists */
+	rd_dev->mapping = NULL;
 	complete(&rd_dev->ramdump_complete);
 	return 0;
 }
@@ -116,6 +146,60 @@ static unsigned long offset_translate(loff_t user_offset,
 
 #define MAX_IOREMAP_SIZE SZ_1M
 
+/* Largest raw block whose worst case LZ4 output still fits in count bytes */
+static size_t ramdump_lz4_raw_size(size_t count)
+{
+	if (count <= sizeof(struct ramdump_lz4_block) + 16)
+		return 0;
+
+	count -= sizeof(struct ramdump_lz4_block) + 16;
+
+	return min_t(size_t, count - count / 256, MAX_IOREMAP_SIZE);
+}
+
+/* Returns the number of bytes written to buf, or -errno */
+static ssize_t ramdump_copy_out(struct ramdump_device *rd_dev,
+		char __user *buf, const char *data, size_t size)
+{
+	struct ramdump_lz4_block blk;
+	const char *out = data;
+	int len = 0;
+
+	if (!ramdump_compress())
+		return copy_to_user(buf, data, size) ? -EFAULT : size;
+
+	if (!rd_dev->lz4_buf) {
+		rd_dev->lz4_wrkmem = vmalloc(LZ4_MEM_COMPRESS);
+		rd_dev->lz4_buf = vmalloc(LZ4_COMPRESSBOUND(MAX_IOREMAP_SIZE));
+		if (!rd_dev->lz4_wrkmem || !rd_dev->lz4_buf)
+			return -ENOMEM;
+	}
+
+	len = LZ4_compress_default(data, rd_dev->lz4_buf, size,
+				   LZ4_COMPRESSBOUND(MAX_IOREMAP_SIZE),
+				   rd_dev->lz4_wrkmem);
+	if (len > 0 && (size_t)len < size)
+		out = rd_dev->lz4_buf;
+	else
+		len = size;
+
+	blk.raw_size = cpu_to_le32(size);
+	blk.comp_size = cpu_to_le32(len);
+	if (copy_to_user(buf, &blk, sizeof(blk)) ||
+	    copy_to_user(buf + sizeof(blk), out, len))
+		return -EFAULT;
+
+	return sizeof(blk) + len;
+}
+
+static void ramdump_lz4_free(struct ramdump_device *rd_dev)
+{
+	vfree(rd_dev->lz4_wrkmem);
+	vfree(rd_dev->lz4_buf);
+	rd_dev->lz4_wrkmem = NULL;
+	rd_dev->lz4_buf = NULL;
+}
+
 static ssize_t ramdump_read(struct file *filep, char __user *buf, size_t count,
 			loff_t *pos)
 {
@@ -125,8 +209,9 @@ static ssize_t ramdump_read(struct file *filep, char __user *buf, size_t count,
 	unsigned long addr = 0;
 	size_t copy_size = 0, alignsize;
 	unsigned char *alignbuf = NULL, *finalbuf = NULL;
-	int ret = 0;
+	ssize_t ret = 0;
 	loff_t orig_pos = *pos;
+	size_t max_size = MAX_IOREMAP_SIZE;
 
 	if ((filep->f_flags & O_NONBLOCK) && !rd_dev->data_ready)
 		return -EAGAIN;
@@ -135,6 +220,23 @@ static ssize_t ramdump_read(struct file *filep, char __user *buf, size_t count,
 	if (ret)
 		return ret;
 
+	if (ramdump_compress()) {
+		max_size = ramdump_lz4_raw_size(count);
+		if (!max_size)
+			return -EINVAL;
+	}
+
+	if (ramdump_compress() && *pos < rd_dev->elfcore_size) {
+		copy_size = min_t(size_t, rd_dev->elfcore_size - *pos,
+				  max_size);
+		ret = ramdump_copy_out(rd_dev, buf,
+				rd_dev->elfcore_buf + *pos, copy_size);
+		if (ret < 0)
+			goto ramdump_done;
+		*pos += copy_size;
+		return ret;
+	}
+
 	if (*pos < rd_dev->elfcore_size) {
 		copy_size = rd_dev->elfcore_size - *pos;
 		copy_size = min(copy_size, count);
@@ -162,7 +264,7 @@ static ssize_t ramdump_read(struct file *filep, char __user *buf, size_t count,
 		goto ramdump_done;
 	}
 
-	copy_size = min_t(size_t, count, (size_t)MAX_IOREMAP_SIZE);
+	copy_size = min_t(size_t, count, max_size);
 	copy_size = min_t(unsigned long, (unsigned long)copy_size, data_left);
 
 	rd_dev->attrs = 0;
@@ -209,11 +311,11 @@ static ssize_t ramdump_read(struct file *filep, char __user *buf, size_t count,
 	} else
 		memcpy(alignbuf, device_mem, alignsize);
 
-	if (copy_to_user(buf, finalbuf, copy_size)) {
+	ret = ramdump_copy_out(rd_dev, buf, finalbuf, copy_size);
+	if (ret < 0) {
 		pr_err("Ramdump(%s): Couldn't copy all data to user.",
 			rd_dev->name);
 		rd_dev->ramdump_status = -1;
-		ret = -EFAULT;
 		goto ramdump_done;
 	}
 
@@ -226,7 +328,7 @@ static ssize_t ramdump_read(struct file *filep, char __user *buf, size_t count,
 	pr_debug("Ramdump(%s): Read %zd bytes from address %lx.",
 			rd_dev->name, copy_size, addr);
 
-	return *pos - orig_pos;
+	return ramdump_compress() ? ret : *pos - orig_pos;
 
 ramdump_done:
 	if (!vaddr && origdevice_mem)
@@ -252,13 +354,62 @@ static unsigned int ramdump_poll(struct file *filep,
 	return mask;
 }
 
+/*
+ * Map dump memory without copying it. The page offset is the physical
+ * page of the memory, as given by the ELF program or section headers, and
+ * the range has to lie within a single segment. The mappings are torn
+ * down once the dump is over; a collector using only mmap() marks the
+ * dump complete by reading at or past its end with pread().
+ */
+static int ramdump_mmap(struct file *filep, struct vm_area_struct *vma)
+{
+	struct ramdump_device *rd_dev = filep->private_data;
+	phys_addr_t start = (phys_addr_t)vma->vm_pgoff << PAGE_SHIFT;
+	size_t size = vma->vm_end - vma->vm_start;
+	struct ramdump_segment *seg;
+	int i;
+
+	if (!rd_dev->data_ready)
+		return -EAGAIN;
+
+	if (vma->vm_flags & (VM_WRITE | VM_EXEC))
+		return -EPERM;
+
+	for (i = 0; i < rd_dev->nsegments; i++) {
+		seg = &rd_dev->segments[i];
+		if (seg->v_address)
+			continue;
+		if (start >= seg->address &&
+		    start + size <= PAGE_ALIGN(seg->address + seg->size))
+			break;
+	}
+	if (i == rd_dev->nsegments)
+		return -EINVAL;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+	if (!pfn_valid(vma->vm_pgoff))
+		vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+
+	return remap_pfn_range(vma, vma->vm_start, vma->vm_pgoff, size,
+			       vma->vm_page_prot);
+}
+
 static const struct file_operations ramdump_file_ops = {
 	.open = ramdump_open,
 	.release = ramdump_release,
 	.read = ramdump_read,
+	.mmap = ramdump_mmap,
 	.poll = ramdump_poll
 };
 
+/* Drop the dump memory from all collector mappings */
+static void ramdump_dump_done(struct ramdump_device *rd_dev)
+{
+	if (rd_dev->mapping)
+		unmap_mapping_range(rd_dev->mapping, 0, 0, 1);
+	ramdump_lz4_free(rd_dev);
+}
+
 static int ramdump_devnode_init(void)
 {
 	int ret;
@@ -447,6 +598,7 @@ static int _do_ramdump(void *handle, struct ramdump_segment *segments,
 		ret = (rd_dev->ramdump_status == 0) ? 0 : -EPIPE;
 
 	rd_dev->data_ready = 0;
+	ramdump_dump_done(rd_dev);
 	rd_dev->elfcore_size = 0;
 	kfree(rd_dev->elfcore_buf);
 	rd_dev->elfcore_buf = NULL;
@@ -558,6 +710,7 @@ static int _do_minidump(void *handle, struct ramdump_segment *segments,
 	}
 
 	rd_dev->data_ready = 0;
+	ramdump_dump_done(rd_dev);
 	rd_dev->elfcore_size = 0;
 	kfree(rd_dev->elfcore_buf);
 	rd_dev->elfcore_buf = NULL;
@@ -35,6 +35,7 @@
 #include <linux/of.h>
 #include <linux/of_platform.h>
 #include <linux/rbtree.h>
+#include <linux/workqueue.h>
 #include <soc/qcom/rpm-notifier.h>
 #include <soc/qcom/rpm-smd.h>
 #include <soc/qcom/smd.h>
@@ -197,6 +198,9 @@ struct slp_buf {
 	char ubuf[MAX_SLEEP_BUFFER];
 	char *buf;
 	bool valid;
+	/* KVPs RPM was last given for this resource's sleep set */
+	char sent[MAX_SLEEP_BUFFER];
+	uint32_t sent_len;
 };
 
 enum rpm_msg_fmts {
@@ -815,10 +819,17 @@ static int msm_rpm_flush_requests(bool print)
 		struct slp_buf *s = rb_entry(t, struct slp_buf, node);
 		unsigned int type = get_rsc_type(s->buf);
 		unsigned int id = get_rsc_id(s->buf);
+		uint32_t data_len = get_data_len(s->buf);
 
 		if (!s->valid)
 			continue;
 
+		/* Changed and then changed back since the last flush */
+		s->valid = false;
+		if (s->sent_len == data_len &&
+		    !memcmp(s->sent, get_first_kvp(s->buf), data_len))
+			continue;
+
 		set_msg_id(s->buf, msm_rpm_get_next_msg_id());
 
 		if (!glink_enabled)
@@ -831,7 +842,10 @@ static int msm_rpm_flush_requests(bool print)
 		WARN_ON(ret != get_buf_len(s->buf));
 		trace_rpm_smd_send_sleep_set(get_msg_id(s->buf), type, id);
 
-		s->valid = false;
+		if (data_len <= sizeof(s->sent)) {
+			memcpy(s->sent, get_first_kvp(s->buf), data_len);
+			s->sent_len = data_len;
+		}
 		count++;
 
 		/*
@@ -1806,6 +1820,139 @@ int msm_rpm_send_message_noirq(enum msm_rpm_set set, uint32_t rsc_type,
 }
 EXPORT_SYMBOL(msm_rpm_send_message_noirq);
 
+/*
+ * Requests queued with msm_rpm_send_message_async() are merged per resource
+ * and set, and go out together from msm_rpm_async_work or the next
+ * msm_rpm_flush_async(). A later value for a key replaces the queued one.
+ */
+#define MSM_RPM_ASYNC_MAX_KVPS 8
+
+struct msm_rpm_async_req {
+	struct list_head list;
+	struct msm_rpm_request *req;
+	enum msm_rpm_set set;
+	uint32_t rsc_type;
+	uint32_t rsc_id;
+	uint32_t msg_id;
+};
+
+static LIST_HEAD(msm_rpm_async_list);
+static DEFINE_MUTEX(msm_rpm_async_lock);
+
+static int __msm_rpm_flush_async(void)
+{
+	struct msm_rpm_async_req *areq, *tmp;
+	int rc, ret = 0;
+
+	/* Send everything first, then collect the acks in the same order */
+	list_for_each_entry(areq, &msm_rpm_async_list, list)
+		areq->msg_id = msm_rpm_send_request(areq->req);
+
+	list_for_each_entry_safe(areq, tmp, &msm_rpm_async_list, list) {
+		rc = msm_rpm_wait_for_ack(areq->msg_id);
+		if (rc) {
+			pr_err("rsc 0x%x id %u set %d failed: %d\n",
+				areq->rsc_type, areq->rsc_id, areq->set, rc);
+			if (!ret)
+				ret = rc;
+		}
+		list_del(&areq->list);
+		msm_rpm_free_request(areq->req);
+		kfree(areq);
+	}
+
+	return ret;
+}
+
+static void msm_rpm_async_work_fn(struct work_struct *work)
+{
+	msm_rpm_flush_async();
+}
+static DECLARE_WORK(msm_rpm_async_work, msm_rpm_async_work_fn);
+
+static struct msm_rpm_async_req *msm_rpm_async_get(enum msm_rpm_set set,
+		uint32_t rsc_type, uint32_t rsc_id)
+{
+	struct msm_rpm_async_req *areq;
+
+	list_for_each_entry(areq, &msm_rpm_async_list, list)
+		if (areq->set == set && areq->rsc_type == rsc_type &&
+		    areq->rsc_id == rsc_id)
+			return areq;
+
+	areq = kzalloc(sizeof(*areq), GFP_KERNEL);
+	if (!areq)
+		return ERR_PTR(-ENOMEM);
+
+	areq->req = msm_rpm_create_request(set, rsc_type, rsc_id,
+			MSM_RPM_ASYNC_MAX_KVPS);
+	if (IS_ERR_OR_NULL(areq->req)) {
+		int rc = areq->req ? PTR_ERR(areq->req) : -ENOMEM;
+
+		kfree(areq);
+		return ERR_PTR(rc);
+	}
+	areq->set = set;
+	areq->rsc_type = rsc_type;
+	areq->rsc_id = rsc_id;
+	list_add_tail(&areq->list, &msm_rpm_async_list);
+
+	return areq;
+}
+
+int msm_rpm_send_message_async(enum msm_rpm_set set, uint32_t rsc_type,
+		uint32_t rsc_id, struct msm_rpm_kvp *kvp, int nelems)
+{
+	struct msm_rpm_async_req *areq;
+	int i, rc = 0;
+
+	if (nelems > MSM_RPM_ASYNC_MAX_KVPS)
+		return msm_rpm_send_message(set, rsc_type, rsc_id, kvp,
+				nelems);
+
+	mutex_lock(&msm_rpm_async_lock);
+	areq = msm_rpm_async_get(set, rsc_type, rsc_id);
+	if (IS_ERR(areq)) {
+		rc = PTR_ERR(areq);
+		goto out;
+	}
+
+	if (areq->req->write_idx + nelems > MSM_RPM_ASYNC_MAX_KVPS) {
+		/* Too many distinct keys, push out what is queued */
+		__msm_rpm_flush_async();
+		areq = msm_rpm_async_get(set, rsc_type, rsc_id);
+		if (IS_ERR(areq)) {
+			rc = PTR_ERR(areq);
+			goto out;
+		}
+	}
+
+	for (i = 0; i < nelems; i++) {
+		rc = msm_rpm_add_kvp_data(areq->req, kvp[i].key,
+				kvp[i].data, kvp[i].length);
+		if (rc)
+			goto out;
+	}
+
+	schedule_work(&msm_rpm_async_work);
+out:
+	mutex_unlock(&msm_rpm_async_lock);
+	return rc;
+}
+EXPORT_SYMBOL(msm_rpm_send_message_async);
+
+int msm_rpm_flush_async(void)
+{
+	int ret;
+
+	mutex_lock(&msm_rpm_async_lock);
+	ret = __msm_rpm_flush_async();
+	mutex_unlock(&msm_rpm_async_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL(msm_rpm_flush_async);
+
 /**
  * During power collapse, the rpm driver disables the SMD interrupts to make
  * sure that the interrupt doesn't wakes us from sleep.
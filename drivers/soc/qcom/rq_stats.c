@@ -29,6 +29,7 @@
 #include <linux/tick.h>
 #include <asm/smp_plat.h>
 #include <linux/suspend.h>
+#include <linux/string.h>
 
 #define MAX_LONG_SIZE 24
 #define DEFAULT_RQ_POLL_JIFFIES 1
@@ -47,6 +48,9 @@ struct cpu_load_data {
 	unsigned int policy_max;
 	cpumask_var_t related_cpus;
 	struct mutex cpu_load_mutex;
+	/* Separate window for cpu_load_thresholds sampling */
+	cputime64_t notify_prev_idle;
+	cputime64_t notify_prev_wall;
 };
 
 static DEFINE_PER_CPU(struct cpu_load_data, cpuload);
@@ -115,6 +119,39 @@ static unsigned int report_load_at_max_freq(void)
 	return total_load;
 }
 
+/* Normalized load since the previous call, without touching the user window */
+static unsigned int sample_load_at_max_freq(void)
+{
+	struct cpu_load_data *pcpu;
+	cputime64_t cur_wall_time, cur_idle_time;
+	unsigned int idle_time, wall_time;
+	unsigned int total_load = 0;
+	static DEFINE_MUTEX(notify_load_mutex);
+	int cpu;
+
+	mutex_lock(&notify_load_mutex);
+	for_each_online_cpu(cpu) {
+		pcpu = &per_cpu(cpuload, cpu);
+		cur_idle_time = get_cpu_idle_time(cpu, &cur_wall_time, 0);
+
+		wall_time = (unsigned int)
+			(cur_wall_time - pcpu->notify_prev_wall);
+		idle_time = (unsigned int)
+			(cur_idle_time - pcpu->notify_prev_idle);
+		pcpu->notify_prev_wall = cur_wall_time;
+		pcpu->notify_prev_idle = cur_idle_time;
+
+		if (unlikely(!wall_time || wall_time < idle_time ||
+			     !pcpu->policy_max))
+			continue;
+
+		total_load += 100 * (wall_time - idle_time) / wall_time *
+			      pcpu->cur_freq / pcpu->policy_max;
+	}
+	mutex_unlock(&notify_load_mutex);
+	return total_load;
+}
+
 static int cpufreq_transition_handler(struct notifier_block *nb,
 			unsigned long val, void *data)
 {
@@ -200,8 +237,34 @@ static struct kobj_attribute hotplug_disabled_attr = __ATTR_RO(hotplug_disable);
 
 static void def_work_fn(struct work_struct *work)
 {
-	/* Notify polling threads on change of value */
-	sysfs_notify(rq_info.kobj, NULL, "def_timer_ms");
+	unsigned int load, level;
+	unsigned long flags;
+	bool notify_load = false;
+
+	if (!rq_info.rq_nr_thresholds && !rq_info.load_nr_thresholds) {
+		/* Notify polling threads on change of value */
+		sysfs_notify(rq_info.kobj, NULL, "def_timer_ms");
+		return;
+	}
+
+	if (test_and_clear_bit(RQ_NOTIFY_RUN_QUEUE, &rq_info.notify_pending))
+		sysfs_notify(rq_info.kobj, NULL, "run_queue_thresholds");
+
+	if (!rq_info.load_nr_thresholds)
+		return;
+
+	load = sample_load_at_max_freq();
+	spin_lock_irqsave(&rq_lock, flags);
+	level = rq_stats_level(rq_info.load_thresholds,
+			       rq_info.load_nr_thresholds, load);
+	if (level != rq_info.load_level) {
+		rq_info.load_level = level;
+		notify_load = true;
+	}
+	spin_unlock_irqrestore(&rq_lock, flags);
+
+	if (notify_load)
+		sysfs_notify(rq_info.kobj, NULL, "cpu_load_thresholds");
 }
 
 static ssize_t run_queue_avg_show(struct kobject *kobj,
@@ -302,12 +365,149 @@ static struct kobj_attribute cpu_normalized_load_attr =
 	__ATTR(cpu_normalized_load, S_IWUSR | S_IRUSR, show_cpu_normalized_load,
 			NULL);
 
+/*
+ * Thresholds are written as an ascending list, an empty write goes back
+ * to the periodic def_timer_ms notification. Reading returns the
+ * thresholds followed by the current level, i.e. the number of
+ * thresholds at or below the current value.
+ */
+static ssize_t show_thresholds(char *buf, const unsigned int *thresholds,
+			       unsigned int nr, unsigned int level, bool tenths)
+{
+	unsigned long flags;
+	ssize_t ret = 0;
+	unsigned int i;
+
+	spin_lock_irqsave(&rq_lock, flags);
+	for (i = 0; i < nr; i++) {
+		if (tenths)
+			ret += scnprintf(buf + ret, PAGE_SIZE - ret, "%u.%u ",
+					 thresholds[i] / 10,
+					 thresholds[i] % 10);
+		else
+			ret += scnprintf(buf + ret, PAGE_SIZE - ret, "%u ",
+					 thresholds[i]);
+	}
+	ret += scnprintf(buf + ret, PAGE_SIZE - ret, "level %u\n", level);
+	spin_unlock_irqrestore(&rq_lock, flags);
+
+	return ret;
+}
+
+/* Parse "n" or "n.d" into tenths when tenths is set */
+static int parse_threshold(char *tok, bool tenths, unsigned int *val)
+{
+	char *frac = tenths ? strchr(tok, '.') : NULL;
+	unsigned int whole, dec = 0;
+
+	if (frac) {
+		*frac++ = '\0';
+		if (strlen(frac) != 1 || kstrtouint(frac, 10, &dec))
+			return -EINVAL;
+	}
+	if (kstrtouint(tok, 10, &whole))
+		return -EINVAL;
+	if (whole > UINT_MAX / 10 - 1)
+		return -EINVAL;
+
+	*val = tenths ? whole * 10 + dec : whole;
+	return 0;
+}
+
+static ssize_t store_thresholds(const char *buf, size_t count,
+				unsigned int *thresholds, unsigned int *nr,
+				unsigned int *level, bool tenths)
+{
+	unsigned int vals[RQ_MAX_THRESHOLDS];
+	unsigned int n = 0;
+	unsigned long flags;
+	char *str, *s, *tok;
+	int ret = 0;
+
+	str = kstrndup(buf, count, GFP_KERNEL);
+	if (!str)
+		return -ENOMEM;
+
+	s = strim(str);
+	while ((tok = strsep(&s, " ,")) != NULL) {
+		if (!*tok)
+			continue;
+		if (n == RQ_MAX_THRESHOLDS) {
+			ret = -EINVAL;
+			break;
+		}
+		ret = parse_threshold(tok, tenths, &vals[n]);
+		if (ret)
+			break;
+		if (n && vals[n] <= vals[n - 1]) {
+			ret = -EINVAL;
+			break;
+		}
+		n++;
+	}
+	kfree(str);
+	if (ret)
+		return ret;
+
+	spin_lock_irqsave(&rq_lock, flags);
+	memcpy(thresholds, vals, n * sizeof(*vals));
+	*nr = n;
+	*level = 0;
+	spin_unlock_irqrestore(&rq_lock, flags);
+
+	return count;
+}
+
+static ssize_t show_run_queue_thresholds(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	return show_thresholds(buf, rq_info.rq_thresholds,
+			       rq_info.rq_nr_thresholds, rq_info.rq_level,
+			       true);
+}
+
+static ssize_t store_run_queue_thresholds(struct kobject *kobj,
+		struct kobj_attribute *attr, const char *buf, size_t count)
+{
+	return store_thresholds(buf, count, rq_info.rq_thresholds,
+				&rq_info.rq_nr_thresholds, &rq_info.rq_level,
+				true);
+}
+
+static struct kobj_attribute run_queue_thresholds_attr =
+	__ATTR(run_queue_thresholds, S_IWUSR | S_IRUSR,
+			show_run_queue_thresholds, store_run_queue_thresholds);
+
+static ssize_t show_cpu_load_thresholds(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	return show_thresholds(buf, rq_info.load_thresholds,
+			       rq_info.load_nr_thresholds, rq_info.load_level,
+			       false);
+}
+
+static ssize_t store_cpu_load_thresholds(struct kobject *kobj,
+		struct kobj_attribute *attr, const char *buf, size_t count)
+{
+	/* Start the load window now rather than at the last sample */
+	sample_load_at_max_freq();
+	return store_thresholds(buf, count, rq_info.load_thresholds,
+				&rq_info.load_nr_thresholds,
+				&rq_info.load_level, false);
+}
+
+static struct kobj_attribute cpu_load_thresholds_attr =
+	__ATTR(cpu_load_thresholds, S_IWUSR | S_IRUSR,
+			show_cpu_load_thresholds, store_cpu_load_thresholds);
+
 static struct attribute *rq_attrs[] = {
 	&cpu_normalized_load_attr.attr,
 	&def_timer_ms_attr.attr,
 	&run_queue_avg_attr.attr,
 	&run_queue_poll_ms_attr.attr,
 	&hotplug_disabled_attr.attr,
+	&run_queue_thresholds_attr.attr,
+	&cpu_load_thresholds_attr.attr,
 	NULL,
 };
 
@@ -18,6 +18,11 @@
 #include <linux/err.h>
 #include <linux/init.h>
 #include <linux/delay.h>
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
 
 #include <asm/cacheflush.h>
 #include <asm/compiler.h>
@@ -48,6 +53,41 @@ DEFINE_MUTEX(scm_lmh_lock);
 #define SCM_EBUSY_WAIT_MS 30
 #define SCM_EBUSY_MAX_RETRY 67
 
+/*
+ * Time spent in the secure world per function ID, for scm_call2() and
+ * scm_call2_noretry(). Updated with scm_lock held; IDs beyond
+ * SCM_STATS_MAX_FN are folded into the last slot.
+ */
+#define SCM_STATS_MAX_FN	64
+
+struct scm_fn_stats {
+	u32 fn_id;
+	u32 calls;
+	u32 busy;
+	u64 total_ns;
+	u64 max_ns;
+};
+
+static struct scm_fn_stats scm_stats[SCM_STATS_MAX_FN];
+static unsigned int scm_stats_nr;
+
+/*
+ * Answers of the read-only queries below never change while the system
+ * is up; TZ can not restart without taking down the HLOS with it. Only
+ * successful answers are cached.
+ */
+#define SCM_QUERY_CACHE_SIZE	32
+
+struct scm_query {
+	u32 cmd;
+	u32 arg;
+	int val;
+};
+
+static struct scm_query scm_query_cache[SCM_QUERY_CACHE_SIZE];
+static unsigned int scm_query_nr;
+static DEFINE_SPINLOCK(scm_query_lock);
+
 #define N_EXT_SCM_ARGS 7
 #define FIRST_EXT_ARG_IDX 3
 #define SMC_ATOMIC_SYSCALL 31
@@ -635,10 +675,77 @@ static int allocate_extra_arg_buffer(struct scm_desc *desc, gfp_t flags)
 	return 0;
 }
 
+/* Called with scm_lock held */
+static void scm_account(u32 fn_id, ktime_t start, int ret)
+{
+	struct scm_fn_stats *st;
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	unsigned int i;
+
+	for (i = 0; i < scm_stats_nr; i++)
+		if (scm_stats[i].fn_id == fn_id)
+			break;
+
+	if (i == scm_stats_nr) {
+		if (scm_stats_nr < SCM_STATS_MAX_FN)
+			scm_stats_nr++;
+		else
+			i = SCM_STATS_MAX_FN - 1;
+		scm_stats[i].fn_id = fn_id;
+	}
+
+	st = &scm_stats[i];
+	st->calls++;
+	if (ret == SCM_V2_EBUSY)
+		st->busy++;
+	st->total_ns += ns;
+	if (ns > st->max_ns)
+		st->max_ns = ns;
+}
+
+static bool scm_query_lookup(u32 cmd, u32 arg, int *val)
+{
+	unsigned long flags;
+	unsigned int i;
+	bool found = false;
+
+	spin_lock_irqsave(&scm_query_lock, flags);
+	for (i = 0; i < scm_query_nr; i++) {
+		if (scm_query_cache[i].cmd == cmd &&
+		    scm_query_cache[i].arg == arg) {
+			*val = scm_query_cache[i].val;
+			found = true;
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&scm_query_lock, flags);
+
+	return found;
+}
+
+static void scm_query_store(u32 cmd, u32 arg, int val)
+{
+	unsigned long flags;
+	int old;
+
+	if (scm_query_lookup(cmd, arg, &old))
+		return;
+
+	spin_lock_irqsave(&scm_query_lock, flags);
+	if (scm_query_nr < SCM_QUERY_CACHE_SIZE) {
+		scm_query_cache[scm_query_nr].cmd = cmd;
+		scm_query_cache[scm_query_nr].arg = arg;
+		scm_query_cache[scm_query_nr].val = val;
+		scm_query_nr++;
+	}
+	spin_unlock_irqrestore(&scm_query_lock, flags);
+}
+
 static int __scm_call2(u32 fn_id, struct scm_desc *desc, bool retry)
 {
 	int arglen = desc->arginfo & 0xf;
 	int ret, retry_count = 0;
+	ktime_t start;
 	u64 x0;
 
 	if (unlikely(!is_scm_armv8()))
@@ -658,6 +765,7 @@ static int __scm_call2(u32 fn_id, struct scm_desc *desc, bool retry)
 		desc->ret[0] = desc->ret[1] = desc->ret[2] = 0;
 
 		trace_scm_call_start(x0, desc);
+		start = ktime_get();
 
 		if (scm_version == SCM_ARMV8_64)
 			ret = __scm_call_armv8_64(x0, desc->arginfo,
@@ -672,6 +780,7 @@ static int __scm_call2(u32 fn_id, struct scm_desc *desc, bool retry)
 						  &desc->ret[0], &desc->ret[1],
 						  &desc->ret[2]);
 
+		scm_account(fn_id, start, ret);
 		trace_scm_call_end(desc);
 
 		if (SCM_SVC_ID(fn_id) == SCM_SVC_LMH)
@@ -1139,6 +1248,10 @@ int scm_is_call_available(u32 svc_id, u32 cmd_id)
 {
 	int ret;
 	struct scm_desc desc = {0};
+	u32 key = SCM_SIP_FNID(svc_id, cmd_id);
+
+	if (scm_query_lookup(IS_CALL_AVAIL_CMD, key, &ret))
+		return ret;
 
 	if (!is_scm_armv8()) {
 		u32 ret_val = 0;
@@ -1149,6 +1262,7 @@ int scm_is_call_available(u32 svc_id, u32 cmd_id)
 		if (ret)
 			return ret;
 
+		scm_query_store(IS_CALL_AVAIL_CMD, key, ret_val);
 		return ret_val;
 	}
 	desc.arginfo = SCM_ARGS(1);
@@ -1157,6 +1271,7 @@ int scm_is_call_available(u32 svc_id, u32 cmd_id)
 	if (ret)
 		return ret;
 
+	scm_query_store(IS_CALL_AVAIL_CMD, key, desc.ret[0]);
 	return desc.ret[0];
 }
 EXPORT_SYMBOL(scm_is_call_available);
@@ -1167,12 +1282,18 @@ int scm_get_feat_version(u32 feat)
 	struct scm_desc desc = {0};
 	int ret;
 
+	if (scm_query_lookup(GET_FEAT_VERSION_CMD, feat, &ret))
+		return ret;
+
 	if (!is_scm_armv8()) {
 		if (scm_is_call_available(SCM_SVC_INFO, GET_FEAT_VERSION_CMD)) {
 			u32 version;
 			if (!scm_call(SCM_SVC_INFO, GET_FEAT_VERSION_CMD, &feat,
-				      sizeof(feat), &version, sizeof(version)))
+				      sizeof(feat), &version, sizeof(version))) {
+				scm_query_store(GET_FEAT_VERSION_CMD, feat,
+						version);
 				return version;
+			}
 		}
 		return 0;
 	}
@@ -1185,8 +1306,10 @@ int scm_get_feat_version(u32 feat)
 	desc.arginfo = SCM_ARGS(1);
 	ret = scm_call2(SCM_SIP_FNID(SCM_SVC_INFO, GET_FEAT_VERSION_CMD),
 			&desc);
-	if (!ret)
+	if (!ret) {
+		scm_query_store(GET_FEAT_VERSION_CMD, feat, desc.ret[0]);
 		return desc.ret[0];
+	}
 
 	return 0;
 }
@@ -1237,6 +1360,9 @@ bool scm_is_secure_device(void)
 	struct scm_desc desc = {0};
 	int ret = 0, resp;
 
+	if (scm_query_lookup(TZ_INFO_GET_SECURE_STATE, 0, &resp))
+		goto out;
+
 	desc.args[0] = 0;
 	desc.arginfo = 0;
 	if (!is_scm_armv8()) {
@@ -1253,10 +1379,50 @@ bool scm_is_secure_device(void)
 		pr_err("%s: SCM call failed\n", __func__);
 		return false;
 	}
-
+	scm_query_store(TZ_INFO_GET_SECURE_STATE, 0, resp);
+out:
 	if ((resp & BIT(0)) || (resp & BIT(2)))
 		return true;
 	else
 		return false;
 }
 EXPORT_SYMBOL(scm_is_secure_device);
+
+static int scm_stats_show(struct seq_file *m, void *v)
+{
+	struct scm_fn_stats st;
+	unsigned int i;
+
+	seq_puts(m, "fn_id       calls     busy  avg_us  max_us\n");
+	mutex_lock(&scm_lock);
+	for (i = 0; i < scm_stats_nr; i++) {
+		st = scm_stats[i];
+		seq_printf(m, "%#010x %8u %8u %7llu %7llu\n", st.fn_id,
+			   st.calls, st.busy,
+			   div_u64(div_u64(st.total_ns, st.calls),
+				   NSEC_PER_USEC),
+			   div_u64(st.max_ns, NSEC_PER_USEC));
+	}
+	mutex_unlock(&scm_lock);
+
+	return 0;
+}
+
+static int scm_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, scm_stats_show, NULL);
+}
+
+static const struct file_operations scm_stats_fops = {
+	.open		= scm_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init scm_debugfs_init(void)
+{
+	debugfs_create_file("scm_stats", 0400, NULL, NULL, &scm_stats_fops);
+	return 0;
+}
+late_initcall(scm_debugfs_init);
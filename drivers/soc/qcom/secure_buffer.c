@@ -20,6 +20,7 @@
 #include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/dma-mapping.h>
+#include <linux/workqueue.h>
 #include <soc/qcom/scm.h>
 #include <soc/qcom/secure_buffer.h>
 
@@ -215,36 +216,66 @@ populate_dest_info(int *dest_vmids, int nelements, int *dest_perms,
 	return dest_info;
 }
 
-/* Must hold secure_buffer_mutex while allocated buffer is in use */
+/* Position in a list of scatterlists, see get_batches_from_sgl() */
+struct hyp_assign_cursor {
+	struct sg_table **tables;
+	int ntables;
+	int table;
+	struct scatterlist *sgl;
+	unsigned int left;
+};
+
+/* Step to the next entry, skipping empty tables; sgl is NULL at the end */
+static void hyp_assign_cursor_next(struct hyp_assign_cursor *cur)
+{
+	if (cur->left && --cur->left) {
+		cur->sgl = sg_next(cur->sgl);
+		return;
+	}
+
+	while (++cur->table < cur->ntables) {
+		cur->left = cur->tables[cur->table]->nents;
+		if (cur->left) {
+			cur->sgl = cur->tables[cur->table]->sgl;
+			return;
+		}
+	}
+	cur->sgl = NULL;
+}
+
+/*
+ * Must hold secure_buffer_mutex while allocated buffer is in use. A batch
+ * may span the end of one scatterlist and the start of the next.
+ */
 static unsigned int get_batches_from_sgl(struct mem_prot_info *sg_table_copy,
-					 struct scatterlist *sgl,
-					 struct scatterlist **next_sgl)
+					 struct hyp_assign_cursor *cur)
 {
 	u64 batch_size = 0;
 	unsigned int i = 0;
-	struct scatterlist *curr_sgl = sgl;
 
 	/* Ensure no zero size batches */
 	do {
-		sg_table_copy[i].addr = page_to_phys(sg_page(curr_sgl));
-		sg_table_copy[i].size = curr_sgl->length;
+		sg_table_copy[i].addr = page_to_phys(sg_page(cur->sgl));
+		sg_table_copy[i].size = cur->sgl->length;
 		batch_size += sg_table_copy[i].size;
-		curr_sgl = sg_next(curr_sgl);
+		hyp_assign_cursor_next(cur);
 		i++;
-	} while (curr_sgl && i < BATCH_MAX_SECTIONS &&
-		 curr_sgl->length + batch_size < BATCH_MAX_SIZE);
+	} while (cur->sgl && i < BATCH_MAX_SECTIONS &&
+		 cur->sgl->length + batch_size < BATCH_MAX_SIZE);
 
-	*next_sgl = curr_sgl;
 	return i;
 }
 
-static int batched_hyp_assign(struct sg_table *table, struct scm_desc *desc)
+static int batched_hyp_assign(struct sg_table **tables, int ntables,
+			      struct scm_desc *desc)
 {
 	unsigned int entries_size;
-	unsigned int batch_start = 0;
 	unsigned int batches_processed;
-	struct scatterlist *curr_sgl = table->sgl;
-	struct scatterlist *next_sgl;
+	struct hyp_assign_cursor cur = {
+		.tables = tables,
+		.ntables = ntables,
+		.table = -1,
+	};
 	int ret = 0;
 	struct mem_prot_info *sg_table_copy = kcalloc(BATCH_MAX_SECTIONS,
 						      sizeof(*sg_table_copy),
@@ -253,10 +284,10 @@ static int batched_hyp_assign(struct sg_table *table, struct scm_desc *desc)
 	if (!sg_table_copy)
 		return -ENOMEM;
 
-	while (batch_start < table->nents) {
-		batches_processed = get_batches_from_sgl(sg_table_copy,
-							 curr_sgl, &next_sgl);
-		curr_sgl = next_sgl;
+	hyp_assign_cursor_next(&cur);
+
+	while (cur.sgl) {
+		batches_processed = get_batches_from_sgl(sg_table_copy, &cur);
 		entries_size = batches_processed * sizeof(*sg_table_copy);
 		dmac_flush_range(sg_table_copy,
 				 (void *)sg_table_copy + entries_size);
@@ -270,15 +301,23 @@ static int batched_hyp_assign(struct sg_table *table, struct scm_desc *desc)
 				__func__, ret);
 			break;
 		}
-
-		batch_start += batches_processed;
 	}
 
 	kfree(sg_table_copy);
 	return ret;
 }
 
-int hyp_assign_table(struct sg_table *table,
+/**
+ * hyp_assign_tables() - Reassign the memory of several scatterlists
+ * @tables:	scatterlists to assign, all with the same source and
+ *		destination VMs
+ * @ntables:	number of entries in @tables
+ *
+ * Same as hyp_assign_table(), but the entries of all tables are packed
+ * into as few SCM calls as the batch limits allow, instead of at least one
+ * call per table. On failure some of the tables may have been assigned.
+ */
+int hyp_assign_tables(struct sg_table **tables, int ntables,
 			u32 *source_vm_list, int source_nelems,
 			int *dest_vmids, int *dest_perms,
 			int dest_nelems)
@@ -289,11 +328,16 @@ int hyp_assign_table(struct sg_table *table,
 	size_t source_vm_copy_size;
 	struct dest_vm_and_perm_info *dest_vm_copy;
 	size_t dest_vm_copy_size;
+	int i;
 
-	if (!table || !table->sgl || !source_vm_list || !source_nelems ||
+	if (!tables || ntables <= 0 || !source_vm_list || !source_nelems ||
 	    !dest_vmids || !dest_perms || !dest_nelems)
 		return -EINVAL;
 
+	for (i = 0; i < ntables; i++)
+		if (!tables[i] || !tables[i]->sgl)
+			return -EINVAL;
+
 	/*
 	 * We can only pass cache-aligned sizes to hypervisor, so we need
 	 * to kmalloc and memcpy the source_vm_list here.
@@ -329,7 +373,7 @@ int hyp_assign_table(struct sg_table *table,
 	dmac_flush_range(dest_vm_copy,
 			 (void *)dest_vm_copy + dest_vm_copy_size);
 
-	ret = batched_hyp_assign(table, &desc);
+	ret = batched_hyp_assign(tables, ntables, &desc);
 
 	mutex_unlock(&secure_buffer_mutex);
 	kfree(dest_vm_copy);
@@ -337,8 +381,46 @@ int hyp_assign_table(struct sg_table *table,
 	kfree(source_vm_copy);
 	return ret;
 }
+EXPORT_SYMBOL(hyp_assign_tables);
+
+int hyp_assign_table(struct sg_table *table,
+			u32 *source_vm_list, int source_nelems,
+			int *dest_vmids, int *dest_perms,
+			int dest_nelems)
+{
+	return hyp_assign_tables(&table, 1, source_vm_list, source_nelems,
+				 dest_vmids, dest_perms, dest_nelems);
+}
 EXPORT_SYMBOL(hyp_assign_table);
 
+static void hyp_assign_work_fn(struct work_struct *work)
+{
+	struct hyp_assign_req *req = container_of(work, struct hyp_assign_req,
+						  work);
+	int ret;
+
+	ret = hyp_assign_tables(req->tables, req->ntables,
+				req->source_vm_list, req->source_nelems,
+				req->dest_vmids, req->dest_perms,
+				req->dest_nelems);
+	req->complete(req, ret);
+}
+
+/**
+ * hyp_assign_tables_async() - Queue a hyp_assign_tables() call
+ * @req:	the request; it and everything it points to must stay valid
+ *		until @req->complete has been called
+ *
+ * The caller can prepare its next buffers while the hypervisor works on
+ * these. @req->complete is called from a workqueue with the result.
+ */
+void hyp_assign_tables_async(struct hyp_assign_req *req)
+{
+	INIT_WORK(&req->work, hyp_assign_work_fn);
+	queue_work(system_unbound_wq, &req->work);
+}
+EXPORT_SYMBOL(hyp_assign_tables_async);
+
 int hyp_assign_phys(phys_addr_t addr, u64 size, u32 *source_vm_list,
 			int source_nelems, int *dest_vmids,
 			int *dest_perms, int dest_nelems)
@@ -64,6 +64,52 @@ int qcom_smem_state_update_bits(struct qcom_smem_state *state,
 }
 EXPORT_SYMBOL_GPL(qcom_smem_state_update_bits);
 
+/**
+ * qcom_smem_state_update_bits_nokick() - update the masked bits, don't notify
+ * @state:	state handle acquired by calling qcom_smem_state_get()
+ * @mask:	bit mask for the change
+ * @value:	new value for the masked bits
+ *
+ * Used to change several states, possibly of different entries on the same
+ * edge, before signaling the remote side once with qcom_smem_state_kick().
+ * Implementations without deferred signaling notify right away.
+ *
+ * Returns 0 on success, otherwise negative errno.
+ */
+int qcom_smem_state_update_bits_nokick(struct qcom_smem_state *state,
+				       u32 mask,
+				       u32 value)
+{
+	if (state->orphan)
+		return -ENXIO;
+
+	if (!state->ops.update_bits_nokick)
+		return qcom_smem_state_update_bits(state, mask, value);
+
+	return state->ops.update_bits_nokick(state->priv, mask, value);
+}
+EXPORT_SYMBOL_GPL(qcom_smem_state_update_bits_nokick);
+
+/**
+ * qcom_smem_state_kick() - signal updates made with the nokick variant
+ * @state:	state handle acquired by calling qcom_smem_state_get()
+ *
+ * The remote side is only interrupted if a deferred update changed a value.
+ *
+ * Returns 0 on success, otherwise negative errno.
+ */
+int qcom_smem_state_kick(struct qcom_smem_state *state)
+{
+	if (state->orphan)
+		return -ENXIO;
+
+	if (!state->ops.kick)
+		return 0;
+
+	return state->ops.kick(state->priv);
+}
+EXPORT_SYMBOL_GPL(qcom_smem_state_kick);
+
 static struct qcom_smem_state *of_node_to_state(struct device_node *np)
 {
 	struct qcom_smem_state *state;
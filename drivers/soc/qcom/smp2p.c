@@ -12,6 +12,7 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/debugfs.h>
 #include <linux/interrupt.h>
 #include <linux/list.h>
 #include <linux/io.h>
@@ -24,6 +25,7 @@
 #include <linux/regmap.h>
 #include <linux/soc/qcom/smem.h>
 #include <linux/soc/qcom/smem_state.h>
+#include <linux/seq_file.h>
 #include <linux/spinlock.h>
 
 /*
@@ -128,6 +130,9 @@ struct smp2p_entry {
  * @ipc_bit:	bit in regmap@offset to kick to signal remote processor
  * @inbound:	list of inbound entries
  * @outbound:	list of outbound entries
+ * @kick_pending: a deferred outbound update is waiting for a kick
+ * @stats:	interrupt and bit change counters of both directions
+ * @debugfs:	debugfs file exposing @stats
  */
 struct qcom_smp2p {
 	struct device *dev;
@@ -148,10 +153,27 @@ struct qcom_smp2p {
 
 	struct list_head inbound;
 	struct list_head outbound;
+
+	atomic_t kick_pending;
+
+	struct {
+		atomic_t out_irqs;
+		atomic_t out_bits;
+		u32 in_irqs;
+		u32 in_bits;
+		u32 in_dispatched;
+	} stats;
+
+	struct dentry *debugfs;
 };
 
+static struct dentry *smp2p_debugfs_root;
+
 static void qcom_smp2p_kick(struct qcom_smp2p *smp2p)
 {
+	atomic_set(&smp2p->kick_pending, 0);
+	atomic_inc(&smp2p->stats.out_irqs);
+
 	/* Make sure any updated data is written before the kick */
 	wmb();
 	regmap_write(smp2p->ipc_regmap, smp2p->ipc_offset, BIT(smp2p->ipc_bit));
@@ -176,10 +198,12 @@ static irqreturn_t qcom_smp2p_intr(int irq, void *data)
 	int irq_pin;
 	u32 status;
 	char buf[SMP2P_MAX_ENTRY_NAME];
+	unsigned long pending;
 	u32 val;
 	int i;
 
 	in = smp2p->in;
+	smp2p->stats.in_irqs++;
 
 	/* Acquire smem item, if not already found */
 	if (!in) {
@@ -220,15 +244,17 @@ static irqreturn_t qcom_smp2p_intr(int irq, void *data)
 		if (!status)
 			continue;
 
-		for_each_set_bit(i, entry->irq_enabled, 32) {
-			if (!(status & BIT(i)))
-				continue;
+		smp2p->stats.in_bits += hweight32(status);
 
-			if ((val & BIT(i) && test_bit(i, entry->irq_rising)) ||
-			    (!(val & BIT(i)) && test_bit(i, entry->irq_falling))) {
-				irq_pin = irq_find_mapping(entry->domain, i);
-				handle_nested_irq(irq_pin);
-			}
+		/* Only visit the changed bits that someone listens to */
+		pending = status & entry->irq_enabled[0] &
+			  ((val & entry->irq_rising[0]) |
+			   (~val & entry->irq_falling[0]));
+
+		for_each_set_bit(i, &pending, 32) {
+			irq_pin = irq_find_mapping(entry->domain, i);
+			handle_nested_irq(irq_pin);
+			smp2p->stats.in_dispatched++;
 		}
 	}
 
@@ -311,9 +337,9 @@ static int qcom_smp2p_inbound_entry(struct qcom_smp2p *smp2p,
 	return 0;
 }
 
-static int smp2p_update_bits(void *data, u32 mask, u32 value)
+/* Returns true if the value changed */
+static bool __smp2p_update_bits(struct smp2p_entry *entry, u32 mask, u32 value)
 {
-	struct smp2p_entry *entry = data;
 	unsigned long flags;
 	u32 orig;
 	u32 val;
@@ -325,7 +351,37 @@ static int smp2p_update_bits(void *data, u32 mask, u32 value)
 	writel(val, entry->value);
 	spin_unlock_irqrestore(&entry->lock, flags);
 
-	if (val != orig)
+	atomic_add(hweight32(val ^ orig), &entry->smp2p->stats.out_bits);
+
+	return val != orig;
+}
+
+static int smp2p_update_bits(void *data, u32 mask, u32 value)
+{
+	struct smp2p_entry *entry = data;
+
+	if (__smp2p_update_bits(entry, mask, value) ||
+	    atomic_read(&entry->smp2p->kick_pending))
+		qcom_smp2p_kick(entry->smp2p);
+
+	return 0;
+}
+
+static int smp2p_update_bits_nokick(void *data, u32 mask, u32 value)
+{
+	struct smp2p_entry *entry = data;
+
+	if (__smp2p_update_bits(entry, mask, value))
+		atomic_set(&entry->smp2p->kick_pending, 1);
+
+	return 0;
+}
+
+static int smp2p_kick(void *data)
+{
+	struct smp2p_entry *entry = data;
+
+	if (atomic_read(&entry->smp2p->kick_pending))
 		qcom_smp2p_kick(entry->smp2p);
 
 	return 0;
@@ -333,6 +389,34 @@ static int smp2p_update_bits(void *data, u32 mask, u32 value)
 
 static const struct qcom_smem_state_ops smp2p_state_ops = {
 	.update_bits = smp2p_update_bits,
+	.update_bits_nokick = smp2p_update_bits_nokick,
+	.kick = smp2p_kick,
+};
+
+static int smp2p_stats_show(struct seq_file *s, void *unused)
+{
+	struct qcom_smp2p *smp2p = s->private;
+
+	seq_printf(s, "out_irqs: %d\nout_bit_changes: %d\n",
+		   atomic_read(&smp2p->stats.out_irqs),
+		   atomic_read(&smp2p->stats.out_bits));
+	seq_printf(s, "in_irqs: %u\nin_bit_changes: %u\nin_dispatched: %u\n",
+		   smp2p->stats.in_irqs, smp2p->stats.in_bits,
+		   smp2p->stats.in_dispatched);
+
+	return 0;
+}
+
+static int smp2p_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, smp2p_stats_show, inode->i_private);
+}
+
+static const struct file_operations smp2p_stats_fops = {
+	.open		= smp2p_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
 };
 
 static int qcom_smp2p_outbound_entry(struct qcom_smp2p *smp2p,
@@ -530,6 +614,10 @@ static int qcom_smp2p_probe(struct platform_device *pdev)
 		goto unwind_interfaces;
 	}
 
+	if (!IS_ERR_OR_NULL(smp2p_debugfs_root))
+		smp2p->debugfs = debugfs_create_file(dev_name(&pdev->dev),
+					0400, smp2p_debugfs_root, smp2p,
+					&smp2p_stats_fops);
 
 	return 0;
 
@@ -550,6 +638,8 @@ static int qcom_smp2p_remove(struct platform_device *pdev)
 	struct qcom_smp2p *smp2p = platform_get_drvdata(pdev);
 	struct smp2p_entry *entry;
 
+	debugfs_remove(smp2p->debugfs);
+
 	list_for_each_entry(entry, &smp2p->inbound, node)
 		irq_domain_remove(entry->domain);
 
@@ -575,7 +665,21 @@ static struct platform_driver qcom_smp2p_driver = {
 		.of_match_table = qcom_smp2p_of_match,
 	},
 };
-module_platform_driver(qcom_smp2p_driver);
+
+static int __init qcom_smp2p_init(void)
+{
+	smp2p_debugfs_root = debugfs_create_dir("qcom_smp2p", NULL);
+
+	return platform_driver_register(&qcom_smp2p_driver);
+}
+module_init(qcom_smp2p_init);
+
+static void __exit qcom_smp2p_exit(void)
+{
+	platform_driver_unregister(&qcom_smp2p_driver);
+	debugfs_remove_recursive(smp2p_debugfs_root);
+}
+module_exit(qcom_smp2p_exit);
 
 MODULE_DESCRIPTION("Qualcomm Shared Memory Point to Point driver");
 MODULE_LICENSE("GPL v2");
@@ -77,6 +77,7 @@ struct smsm_host;
  * @subscription: pointer to local processor's row in subscription matrix
  * @state:	smem state handle
  * @lock:	spinlock for read-modify-write of the outgoing state
+ * @pending_changes: bits changed by deferred updates, not yet signaled
  * @entries:	context for each of the entries
  * @hosts:	context for each of the hosts
  */
@@ -93,6 +94,7 @@ struct qcom_smsm {
 	struct qcom_smem_state *state;
 
 	spinlock_t lock;
+	u32 pending_changes;
 
 	struct smsm_entry *entries;
 	struct smsm_host *hosts;
@@ -144,13 +146,15 @@ struct smsm_host {
  * Used to set and clear the bits in the outgoing/local entry and inform
  * subscribers about the change.
  */
-static int smsm_update_bits(void *data, u32 mask, u32 value)
+/*
+ * Update the local state and return the bits changed since the remote
+ * hosts were last signaled; with defer set they are kept for a later kick.
+ */
+static u32 __smsm_update_bits(struct qcom_smsm *smsm, u32 mask, u32 value,
+			      bool defer)
 {
-	struct qcom_smsm *smsm = data;
-	struct smsm_host *hostp;
 	unsigned long flags;
 	u32 changes;
-	u32 host;
 	u32 orig;
 	u32 val;
 
@@ -161,17 +165,27 @@ static int smsm_update_bits(void *data, u32 mask, u32 value)
 	val &= ~mask;
 	val |= value;
 
-	/* Don't signal if we didn't change the value */
-	changes = val ^ orig;
-	if (!changes) {
-		spin_unlock_irqrestore(&smsm->lock, flags);
-		goto done;
-	}
-
 	/* Write out the new value */
-	writel(val, smsm->local_state);
+	if (val != orig)
+		writel(val, smsm->local_state);
+
+	changes = smsm->pending_changes | (val ^ orig);
+	smsm->pending_changes = defer ? changes : 0;
 	spin_unlock_irqrestore(&smsm->lock, flags);
 
+	return defer ? 0 : changes;
+}
+
+static void smsm_kick_hosts(struct qcom_smsm *smsm, u32 changes)
+{
+	struct smsm_host *hostp;
+	u32 host;
+	u32 val;
+
+	/* Don't signal if we didn't change the value */
+	if (!changes)
+		return;
+
 	/* Make sure the value update is ordered before any kicks */
 	wmb();
 
@@ -186,13 +200,37 @@ static int smsm_update_bits(void *data, u32 mask, u32 value)
 				     BIT(hostp->ipc_bit));
 		}
 	}
+}
+
+static int smsm_update_bits(void *data, u32 mask, u32 value)
+{
+	struct qcom_smsm *smsm = data;
+
+	smsm_kick_hosts(smsm, __smsm_update_bits(smsm, mask, value, false));
+
+	return 0;
+}
+
+static int smsm_update_bits_nokick(void *data, u32 mask, u32 value)
+{
+	__smsm_update_bits(data, mask, value, true);
+
+	return 0;
+}
+
+static int smsm_kick(void *data)
+{
+	struct qcom_smsm *smsm = data;
+
+	smsm_kick_hosts(smsm, __smsm_update_bits(smsm, 0, 0, false));
 
-done:
 	return 0;
 }
 
 static const struct qcom_smem_state_ops smsm_state_ops = {
 	.update_bits = smsm_update_bits,
+	.update_bits_nokick = smsm_update_bits_nokick,
+	.kick = smsm_kick,
 };
 
 /**
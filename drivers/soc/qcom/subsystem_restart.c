@@ -12,7 +12,9 @@
 
 #define pr_fmt(fmt) "subsys-restart: %s(): " fmt, __func__
 
+#include <linux/async.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/uaccess.h>
 #include <linux/module.h>
@@ -183,6 +185,8 @@ struct restart_log {
  * @err_ready: completion variable to record error ready from subsystem
  * @crashed: indicates if subsystem has crashed
  * @notif_state: current state of subsystem in terms of subsys notifications
+ * @powerup_ret: result of an asynchronous subsystem_powerup()
+ * @timing: duration of the last boot and restart phases, in ms
  */
 struct subsys_device {
 	struct subsys_desc *desc;
@@ -206,9 +210,22 @@ struct subsys_device {
 	struct completion err_ready;
 	enum crash_status crashed;
 	int notif_state;
+	int powerup_ret;
+	struct {
+		s64 powerup;
+		s64 err_ready;
+		s64 shutdown;
+		s64 ramdump;
+		s64 restart;
+	} timing;
 	struct list_head list;
 };
 
+static s64 subsys_ms_since(ktime_t start)
+{
+	return ktime_ms_delta(ktime_get(), start);
+}
+
 static struct subsys_device *to_subsys(struct device *d)
 {
 	return container_of(d, struct subsys_device, dev);
@@ -335,6 +352,18 @@ static ssize_t system_debug_store(struct device *dev,
 	return orig_count;
 }
 
+static ssize_t timing_show(struct device *dev, struct device_attribute *attr,
+			   char *buf)
+{
+	struct subsys_device *subsys = to_subsys(dev);
+
+	return snprintf(buf, PAGE_SIZE,
+		"powerup_ms: %lld\nerr_ready_ms: %lld\nshutdown_ms: %lld\nramdump_ms: %lld\nrestart_ms: %lld\n",
+		subsys->timing.powerup, subsys->timing.err_ready,
+		subsys->timing.shutdown, subsys->timing.ramdump,
+		subsys->timing.restart);
+}
+
 int subsys_get_restart_level(struct subsys_device *dev)
 {
 	return dev->restart_level;
@@ -377,6 +406,7 @@ static struct device_attribute subsys_attrs[] = {
 	__ATTR(restart_level, 0644, restart_level_show, restart_level_store),
 	__ATTR(firmware_name, 0644, firmware_name_show, firmware_name_store),
 	__ATTR(system_debug, 0644, system_debug_show, system_debug_store),
+	__ATTR_RO(timing),
 	__ATTR_NULL,
 };
 
@@ -713,11 +743,13 @@ static int wait_for_err_ready(struct subsys_device *subsys)
 static int subsystem_shutdown(struct subsys_device *dev, void *data)
 {
 	const char *name = dev->desc->name;
+	ktime_t start = ktime_get();
 	int ret;
 
 	pr_info("[%s:%d]: Shutting down %s\n",
 			current->comm, current->pid, name);
 	ret = dev->desc->shutdown(dev->desc, true);
+	dev->timing.shutdown = subsys_ms_since(start);
 	if (ret < 0) {
 		if (!dev->desc->ignore_ssr_failure) {
 			panic("subsys-restart: [%s:%d]: Failed to shutdown %s!",
@@ -737,12 +769,14 @@ static int subsystem_shutdown(struct subsys_device *dev, void *data)
 static int subsystem_ramdump(struct subsys_device *dev, void *data)
 {
 	const char *name = dev->desc->name;
+	ktime_t start = ktime_get();
 
 	if (dev->desc->ramdump)
 		if (dev->desc->ramdump(is_ramdump_enabled(dev), dev->desc) < 0)
 			pr_warn("%s[%s:%d]: Ramdump failed.\n",
 				name, current->comm, current->pid);
 	dev->do_ramdump_on_put = false;
+	dev->timing.ramdump = subsys_ms_since(start);
 	return 0;
 }
 
@@ -756,12 +790,15 @@ static int subsystem_free_memory(struct subsys_device *dev, void *data)
 static int subsystem_powerup(struct subsys_device *dev, void *data)
 {
 	const char *name = dev->desc->name;
+	ktime_t start;
 	int ret;
 
 	pr_info("[%s:%d]: Powering up %s\n", current->comm, current->pid, name);
 	init_completion(&dev->err_ready);
 
+	start = ktime_get();
 	ret = dev->desc->powerup(dev->desc);
+	dev->timing.powerup = subsys_ms_since(start);
 	if (ret < 0) {
 		notify_each_subsys_device(&dev, 1, SUBSYS_POWERUP_FAILURE,
 								NULL);
@@ -778,7 +815,9 @@ static int subsystem_powerup(struct subsys_device *dev, void *data)
 	}
 	enable_all_irqs(dev);
 
+	start = ktime_get();
 	ret = wait_for_err_ready(dev);
+	dev->timing.err_ready = subsys_ms_since(start);
 	if (ret) {
 		notify_each_subsys_device(&dev, 1, SUBSYS_POWERUP_FAILURE,
 								NULL);
@@ -794,6 +833,81 @@ static int subsystem_powerup(struct subsys_device *dev, void *data)
 	return 0;
 }
 
+static void subsystem_powerup_async(void *data, async_cookie_t cookie)
+{
+	struct subsys_device *dev = data;
+
+	dev->powerup_ret = subsystem_powerup(dev, NULL);
+}
+
+/* Is the subsystem that list[i] depends on in the list and not up yet? */
+static bool subsys_waits_on_pending(struct subsys_device **list,
+			unsigned int count, unsigned int i, unsigned long done)
+{
+	const char *dep = list[i]->desc->depends_on;
+	unsigned int j;
+
+	if (!dep)
+		return false;
+
+	for (j = 0; j < count; j++)
+		if (j != i && !(done & BIT(j)) &&
+				!strcmp(list[j]->desc->name, dep))
+			return true;
+
+	return false;
+}
+
+/*
+ * Power up the subsystems of a restart order. Loading and authenticating
+ * an image takes up to seconds per subsystem, so every subsystem whose
+ * qcom,depends-on peer is not part of the order, or already up, is
+ * powered up concurrently with the others, in waves.
+ */
+static int powerup_each_subsys_device(struct subsys_device **list,
+		unsigned int count)
+{
+	ASYNC_DOMAIN_EXCLUSIVE(domain);
+	unsigned long done = 0, wave;
+	unsigned int i;
+	int ret = 0;
+
+	if (count == 1 || count > BITS_PER_LONG)
+		return for_each_subsys_device(list, count, NULL,
+						subsystem_powerup);
+
+	for (i = 0; i < count; i++)
+		if (!list[i])
+			done |= BIT(i);
+
+	while (!ret && done != GENMASK(count - 1, 0)) {
+		wave = 0;
+		for (i = 0; i < count; i++)
+			if (!(done & BIT(i)) &&
+			    !subsys_waits_on_pending(list, count, i, done))
+				wave |= BIT(i);
+
+		/* A dependency cycle, go on in list order */
+		if (!wave)
+			wave = BIT(ffz(done));
+
+		if (hweight_long(wave) == 1) {
+			ret = subsystem_powerup(list[__ffs(wave)], NULL);
+		} else {
+			for_each_set_bit(i, &wave, count)
+				async_schedule_domain(subsystem_powerup_async,
+						      list[i], &domain);
+			async_synchronize_full_domain(&domain);
+			for_each_set_bit(i, &wave, count)
+				if (list[i]->powerup_ret)
+					ret = list[i]->powerup_ret;
+		}
+		done |= wave;
+	}
+
+	return ret;
+}
+
 static int __find_subsys(struct device *dev, void *data)
 {
 	struct subsys_device *subsys = to_subsys(dev);
@@ -815,13 +929,16 @@ static struct subsys_device *find_subsys(const char *str)
 
 static int subsys_start(struct subsys_device *subsys)
 {
+	ktime_t start;
 	int ret;
 
 	notify_each_subsys_device(&subsys, 1, SUBSYS_BEFORE_POWERUP,
 								NULL);
 
 	init_completion(&subsys->err_ready);
+	start = ktime_get();
 	ret = subsys->desc->powerup(subsys->desc);
+	subsys->timing.powerup = subsys_ms_since(start);
 	if (ret) {
 		notify_each_subsys_device(&subsys, 1, SUBSYS_POWERUP_FAILURE,
 									NULL);
@@ -834,7 +951,9 @@ static int subsys_start(struct subsys_device *subsys)
 		return 0;
 	}
 
+	start = ktime_get();
 	ret = wait_for_err_ready(subsys);
+	subsys->timing.err_ready = subsys_ms_since(start);
 	if (ret) {
 		/* pil-boot succeeded but we need to shutdown
 		 * the device because error ready timed out.
@@ -1054,6 +1173,7 @@ static void subsystem_restart_wq_func(struct work_struct *work)
 	struct subsys_desc *desc = dev->desc;
 	struct subsys_soc_restart_order *order = dev->restart_order;
 	struct subsys_tracking *track;
+	ktime_t start = ktime_get();
 	unsigned int count;
 	unsigned long flags;
 	int ret;
@@ -1122,13 +1242,15 @@ static void subsystem_restart_wq_func(struct work_struct *work)
 	for_each_subsys_device(list, count, NULL, subsystem_free_memory);
 
 	notify_each_subsys_device(list, count, SUBSYS_BEFORE_POWERUP, NULL);
-	ret = for_each_subsys_device(list, count, NULL, subsystem_powerup);
+	ret = powerup_each_subsys_device(list, count);
 	if (ret)
 		goto err;
 	notify_each_subsys_device(list, count, SUBSYS_AFTER_POWERUP, NULL);
 
-	pr_info("[%s:%d]: Restart sequence for %s completed.\n",
-			current->comm, current->pid, desc->name);
+	dev->timing.restart = subsys_ms_since(start);
+	pr_info("[%s:%d]: Restart sequence for %s completed in %lld ms.\n",
+			current->comm, current->pid, desc->name,
+			dev->timing.restart);
 
 err:
 	/* Reset subsys count */
@@ -56,6 +56,8 @@
 static struct msm_watchdog_data *wdog_data;
 
 static int cpu_idle_pc_state[NR_CPUS];
+/* sched_clock() of the last time each cpu was seen responsive */
+static DEFINE_PER_CPU(unsigned long long, wdog_alive_ns);
 
 /*
  * user_pet_enable:
@@ -94,6 +96,8 @@ struct msm_watchdog_data {
 	bool timer_expired;
 	bool user_pet_complete;
 	unsigned int scandump_size;
+	unsigned long ipi_sent;
+	unsigned long ipi_skipped;
 };
 
 /*
@@ -130,6 +134,25 @@ module_param(WDT_HZ, long, 0);
 static int ipi_en = IPI_CORES_IN_LPM;
 module_param(ipi_en, int, 0444);
 
+/*
+ * Watchdog alive stamp optimization:
+ * Each cpu records when it last entered or left a low power mode, and
+ * also when it answered a ping. At pet time only cpus whose stamp is older
+ * than the pet time are pinged. A cpu that hangs can not refresh its
+ * stamp, so it is pinged at the latest on the pet after the one that
+ * skipped it, and the bark still fires within bark_time of the last pet.
+ *
+ * On the kernel command line specify
+ * watchdog_v2.alive_stamp=1 to enable this optimization.
+ */
+static int alive_stamp;
+module_param(alive_stamp, int, 0444);
+
+static inline bool wdog_cpu_pm_needed(void)
+{
+	return !ipi_en || alive_stamp;
+}
+
 static void dump_cpu_alive_mask(struct msm_watchdog_data *wdog_dd)
 {
 	static char alive_mask_buf[MASK_SIZE];
@@ -347,6 +370,17 @@ static ssize_t wdog_pet_time_get(struct device *dev,
 
 static DEVICE_ATTR(pet_time, S_IRUSR, wdog_pet_time_get, NULL);
 
+static ssize_t wdog_ipi_stats_get(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct msm_watchdog_data *wdog_dd = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "sent %lu skipped %lu\n",
+			wdog_dd->ipi_sent, wdog_dd->ipi_skipped);
+}
+
+static DEVICE_ATTR(ipi_stats, S_IRUSR, wdog_ipi_stats_get, NULL);
+
 static void pet_watchdog(struct msm_watchdog_data *wdog_dd)
 {
 	int slack, i, count, prev_count = 0;
@@ -378,10 +412,21 @@ static void keep_alive_response(void *info)
 	struct msm_watchdog_data *wdog_dd = (struct msm_watchdog_data *)info;
 
 	cpumask_set_cpu(cpu, &wdog_dd->alive_mask);
+	this_cpu_write(wdog_alive_ns, sched_clock());
 	/* Make sure alive mask is cleared and set in order */
 	smp_mb();
 }
 
+/* True if @cpu was seen responsive within the last pet time */
+static bool wdog_cpu_alive_recently(struct msm_watchdog_data *wdog_dd,
+				int cpu, unsigned long long now)
+{
+	unsigned long long stamp = READ_ONCE(per_cpu(wdog_alive_ns, cpu));
+
+	return alive_stamp && stamp &&
+		now - stamp < wdog_dd->pet_time * 1000000ULL;
+}
+
 /*
  * If this function does not return, it implies one of the
  * other cpu's is not responsive.
@@ -389,14 +434,22 @@ static void keep_alive_response(void *info)
 static void ping_other_cpus(struct msm_watchdog_data *wdog_dd)
 {
 	int cpu;
+	unsigned long long now = sched_clock();
 
 	cpumask_clear(&wdog_dd->alive_mask);
 	/* Make sure alive mask is cleared and set in order */
 	smp_mb();
 	for_each_cpu(cpu, cpu_online_mask) {
-		if (!cpu_idle_pc_state[cpu] && !cpu_isolated(cpu))
-			smp_call_function_single(cpu, keep_alive_response,
-						 wdog_dd, 1);
+		if (cpu_idle_pc_state[cpu] || cpu_isolated(cpu))
+			continue;
+		if (wdog_cpu_alive_recently(wdog_dd, cpu, now)) {
+			cpumask_set_cpu(cpu, &wdog_dd->alive_mask);
+			wdog_dd->ipi_skipped++;
+			continue;
+		}
+		smp_call_function_single(cpu, keep_alive_response,
+					 wdog_dd, 1);
+		wdog_dd->ipi_sent++;
 	}
 }
 
@@ -452,6 +505,13 @@ static int wdog_cpu_pm_notify(struct notifier_block *self,
 
 	cpu = raw_smp_processor_id();
 
+	if (alive_stamp)
+		__this_cpu_write(wdog_alive_ns, sched_clock());
+
+	/* Cores in low power mode are only skipped with ipi_en unset */
+	if (ipi_en)
+		return NOTIFY_OK;
+
 	switch (action) {
 	case CPU_PM_ENTER:
 		cpu_idle_pc_state[cpu] = 1;
@@ -474,7 +534,7 @@ static int msm_watchdog_remove(struct platform_device *pdev)
 	struct msm_watchdog_data *wdog_dd =
 			(struct msm_watchdog_data *)platform_get_drvdata(pdev);
 
-	if (!ipi_en)
+	if (wdog_cpu_pm_needed())
 		cpu_pm_unregister_notifier(&wdog_cpu_pm_nb);
 
 	mutex_lock(&wdog_dd->disable_lock);
@@ -669,6 +729,8 @@ static int init_watchdog_sysfs(struct msm_watchdog_data *wdog_dd)
 	int error = 0;
 
 	error |= device_create_file(wdog_dd->dev, &dev_attr_disable);
+	if (alive_stamp)
+		error |= device_create_file(wdog_dd->dev, &dev_attr_ipi_stats);
 
 	if (of_property_read_bool(wdog_dd->dev->of_node,
 					"qcom,userspace-watchdog")) {
@@ -757,7 +819,7 @@ static void init_watchdog_data(struct msm_watchdog_data *wdog_dd)
 
 	if (wdog_dd->irq_ppi)
 		enable_percpu_irq(wdog_dd->bark_irq, 0);
-	if (!ipi_en)
+	if (wdog_cpu_pm_needed())
 		cpu_pm_register_notifier(&wdog_cpu_pm_nb);
 	dev_info(wdog_dd->dev, "MSM Watchdog Initialized\n");
 }
@@ -32,6 +32,11 @@
 #include <linux/bitops.h>
 #include <linux/mutex.h>
 #include <linux/shmem_fs.h>
+#include <linux/interval_tree.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
+#include <linux/wait.h>
 #include "ashmem.h"
 
 #define ASHMEM_NAME_PREFIX "dev/ashmem/"
@@ -41,101 +46,169 @@
 /**
  * struct ashmem_area - The anonymous shared memory area
  * @name:		The optional name in /proc/pid/maps
- * @unpinned_list:	The list of all ashmem areas
+ * @unpinned:		The interval tree of this area's unpinned ranges
  * @file:		The shmem-based backing file
  * @size:		The size of the mapping, in bytes
  * @prot_mask:		The allowed protection bits, as vm_flags
+ * @mutex:		Protects all of the above
+ * @locked_at:		When @mutex was taken, for the lock statistics
+ * @purge_inflight:	Ranges taken off the LRU whose pages are still being
+ *			punched out by the shrinker
  *
  * The lifecycle of this structure is from our parent file's open() until
- * its release(). It is also protected by 'ashmem_mutex'
+ * its release().
  *
  * Warning: Mappings do NOT pin this structure; It dies on close()
  */
 struct ashmem_area {
 	char name[ASHMEM_FULL_NAME_LEN];
-	struct list_head unpinned_list;
+	struct rb_root unpinned;
 	struct file *file;
 	size_t size;
 	unsigned long prot_mask;
+	struct mutex mutex;
+	u64 locked_at;
+	atomic_t purge_inflight;
 };
 
 /**
  * struct ashmem_range - A range of unpinned/evictable pages
  * @lru:	         The entry in the LRU list
- * @unpinned:	         The entry in its area's unpinned list
+ * @node:	         The entry in its area's interval tree, keyed by the
+ *			 starting and ending page (both inclusive)
  * @asma:	         The associated anonymous shared memory area.
- * @pgstart:	         The starting page (inclusive)
- * @pgend:	         The ending page (inclusive)
  * @purged:	         The purge status (ASHMEM_NOT or ASHMEM_WAS_PURGED)
  *
- * The lifecycle of this structure is from unpin to pin.
- * It is protected by 'ashmem_mutex'
+ * The lifecycle of this structure is from unpin to pin. It is protected by
+ * its area's mutex, and @lru and @purged also by 'ashmem_lru_lock'.
  */
 struct ashmem_range {
 	struct list_head lru;
-	struct list_head unpinned;
+	struct interval_tree_node node;
 	struct ashmem_area *asma;
-	size_t pgstart;
-	size_t pgend;
 	unsigned int purged;
 };
 
-/* LRU list of unpinned pages, protected by ashmem_mutex */
+/* LRU list of unpinned pages, protected by ashmem_lru_lock */
 static LIST_HEAD(ashmem_lru_list);
 
 /*
  * long lru_count - The count of pages on our LRU list.
  *
- * This is protected by ashmem_mutex.
+ * This is protected by ashmem_lru_lock.
  */
 static unsigned long lru_count;
 
 /*
- * ashmem_mutex - protects the list of and each individual ashmem_area
+ * ashmem_lru_lock - protects the LRU list and the purge status of each range
  *
- * Lock Ordering: ashmex_mutex -> i_mutex -> i_alloc_sem
+ * Lock Ordering: asma->mutex -> ashmem_lru_lock
+ *		  asma->mutex -> i_mutex -> i_alloc_sem
  */
-static DEFINE_MUTEX(ashmem_mutex);
+static DEFINE_SPINLOCK(ashmem_lru_lock);
+static u64 lru_locked_at;
+
+/* Woken up each time an area's last in-flight purge completes */
+static DECLARE_WAIT_QUEUE_HEAD(ashmem_purge_wait);
 
 static struct kmem_cache *ashmem_area_cachep __read_mostly;
 static struct kmem_cache *ashmem_range_cachep __read_mostly;
 
+/* Ranges the shrinker takes off the LRU for each ashmem_lru_lock hold */
+#define ASHMEM_PURGE_BATCH	8
+
+/**
+ * struct ashmem_lock_stat - Hold time statistics, reported in debugfs
+ * @count:	Number of times the lock was released
+ * @total_ns:	Sum of the hold times
+ * @max_ns:	Longest hold time
+ */
+struct ashmem_lock_stat {
+	atomic64_t count;
+	atomic64_t total_ns;
+	atomic64_t max_ns;
+};
+
+static struct ashmem_lock_stat area_lock_stat;
+static struct ashmem_lock_stat lru_lock_stat;
+static atomic64_t purge_batches;
+static atomic64_t purge_ranges;
+
+#define range_start(range)	((range)->node.start)
+#define range_end(range)	((range)->node.last)
+
 #define range_size(range) \
-	((range)->pgend - (range)->pgstart + 1)
+	(range_end(range) - range_start(range) + 1)
 
 #define range_on_lru(range) \
 	((range)->purged == ASHMEM_NOT_PURGED)
 
+#define to_ashmem_range(n) \
+	container_of(n, struct ashmem_range, node)
+
 static inline int page_range_subsumes_range(struct ashmem_range *range,
 					    size_t start, size_t end)
 {
-	return (((range)->pgstart >= (start)) && ((range)->pgend <= (end)));
+	return ((range_start(range) >= (start)) && (range_end(range) <= (end)));
 }
 
 static inline int page_range_subsumed_by_range(struct ashmem_range *range,
 					       size_t start, size_t end)
 {
-	return (((range)->pgstart <= (start)) && ((range)->pgend >= (end)));
+	return ((range_start(range) <= (start)) && (range_end(range) >= (end)));
+}
+
+/* The first unpinned range of @asma that overlaps [@start, @end] */
+static inline struct ashmem_range *range_find(struct ashmem_area *asma,
+					      size_t start, size_t end)
+{
+	struct interval_tree_node *node;
+
+	node = interval_tree_iter_first(&asma->unpinned, start, end);
+	return node ? to_ashmem_range(node) : NULL;
 }
 
-static inline int page_in_range(struct ashmem_range *range, size_t page)
+#define PROT_MASK		(PROT_EXEC | PROT_READ | PROT_WRITE)
+
+static void lock_stat_add(struct ashmem_lock_stat *stat, u64 since)
 {
-	return (((range)->pgstart <= (page)) && ((range)->pgend >= (page)));
+	u64 ns = ktime_get_ns() - since;
+	u64 max = atomic64_read(&stat->max_ns);
+
+	atomic64_inc(&stat->count);
+	atomic64_add(ns, &stat->total_ns);
+	while (ns > max) {
+		u64 old = atomic64_cmpxchg(&stat->max_ns, max, ns);
+
+		if (old == max)
+			break;
+		max = old;
+	}
 }
 
-static inline int page_range_in_range(struct ashmem_range *range,
-				      size_t start, size_t end)
+static void ashmem_area_lock(struct ashmem_area *asma)
 {
-	return (page_in_range(range, start) || page_in_range(range, end) ||
-		page_range_subsumes_range(range, start, end));
+	mutex_lock(&asma->mutex);
+	asma->locked_at = ktime_get_ns();
 }
 
-static inline int range_before_page(struct ashmem_range *range, size_t page)
+static void ashmem_area_unlock(struct ashmem_area *asma)
 {
-	return ((range)->pgend < (page));
+	lock_stat_add(&area_lock_stat, asma->locked_at);
+	mutex_unlock(&asma->mutex);
 }
 
-#define PROT_MASK		(PROT_EXEC | PROT_READ | PROT_WRITE)
+static void ashmem_lru_lock_acquire(void)
+{
+	spin_lock(&ashmem_lru_lock);
+	lru_locked_at = ktime_get_ns();
+}
+
+static void ashmem_lru_lock_release(void)
+{
+	lock_stat_add(&lru_lock_stat, lru_locked_at);
+	spin_unlock(&ashmem_lru_lock);
+}
 
 /**
  * lru_add() - Adds a range of memory to the LRU list
@@ -143,6 +216,8 @@ static inline int range_before_page(struct ashmem_range *range, size_t page)
  *
  * The range is first added to the end (tail) of the LRU list.
  * After this, the size of the range is added to @lru_count
+ *
+ * Caller must hold ashmem_lru_lock.
  */
 static inline void lru_add(struct ashmem_range *range)
 {
@@ -156,6 +231,8 @@ static inline void lru_add(struct ashmem_range *range)
  *
  * The range is first deleted from the LRU list.
  * After this, the size of the range is removed from @lru_count
+ *
+ * Caller must hold ashmem_lru_lock.
  */
 static inline void lru_del(struct ashmem_range *range)
 {
@@ -164,33 +241,34 @@ static inline void lru_del(struct ashmem_range *range)
 }
 
 /**
- * range_alloc() - Allocates and initializes a new ashmem_range structure
+ * range_alloc() - Initializes a new ashmem_range structure
  * @asma:	   The associated ashmem_area
- * @prev_range:	   The previous ashmem_range in the sorted asma->unpinned list
+ * @new_range:	   The range allocated before ashmem_lru_lock was taken, it is
+ *		   consumed and set to NULL
  * @purged:	   Initial purge status (ASMEM_NOT_PURGED or ASHMEM_WAS_PURGED)
  * @start:	   The starting page (inclusive)
  * @end:	   The ending page (inclusive)
  *
- * This function is protected by ashmem_mutex.
+ * Caller must hold the area's mutex and ashmem_lru_lock.
  *
- * Return: 0 if successful, or -ENOMEM if there is an error
+ * Return: 0 if successful, or -ENOMEM if there is no range to use
  */
 static int range_alloc(struct ashmem_area *asma,
-		       struct ashmem_range *prev_range, unsigned int purged,
+		       struct ashmem_range **new_range, unsigned int purged,
 		       size_t start, size_t end)
 {
-	struct ashmem_range *range;
+	struct ashmem_range *range = *new_range;
 
-	range = kmem_cache_zalloc(ashmem_range_cachep, GFP_KERNEL);
 	if (unlikely(!range))
 		return -ENOMEM;
+	*new_range = NULL;
 
 	range->asma = asma;
-	range->pgstart = start;
-	range->pgend = end;
+	range_start(range) = start;
+	range_end(range) = end;
 	range->purged = purged;
 
-	list_add_tail(&range->unpinned, &prev_range->unpinned);
+	interval_tree_insert(&range->node, &asma->unpinned);
 
 	if (range_on_lru(range))
 		lru_add(range);
@@ -201,10 +279,12 @@ static int range_alloc(struct ashmem_area *asma,
 /**
  * range_del() - Deletes and dealloctes an ashmem_range structure
  * @range:	 The associated ashmem_range that has previously been allocated
+ *
+ * Caller must hold the area's mutex and ashmem_lru_lock.
  */
 static void range_del(struct ashmem_range *range)
 {
-	list_del(&range->unpinned);
+	interval_tree_remove(&range->node, &range->asma->unpinned);
 	if (range_on_lru(range))
 		lru_del(range);
 	kmem_cache_free(ashmem_range_cachep, range);
@@ -221,14 +301,19 @@ static void range_del(struct ashmem_range *range)
  *
  * Theoretically, with a little tweaking, this could eventually be changed
  * to range_resize, and expand the lru_count if the new range is larger.
+ *
+ * Caller must hold the area's mutex and ashmem_lru_lock.
  */
 static inline void range_shrink(struct ashmem_range *range,
 				size_t start, size_t end)
 {
 	size_t pre = range_size(range);
 
-	range->pgstart = start;
-	range->pgend = end;
+	/* The interval tree is keyed by both ends, so re-insert the node */
+	interval_tree_remove(&range->node, &range->asma->unpinned);
+	range_start(range) = start;
+	range_end(range) = end;
+	interval_tree_insert(&range->node, &range->asma->unpinned);
 
 	if (range_on_lru(range))
 		lru_count -= pre - range_size(range);
@@ -257,7 +342,9 @@ static int ashmem_open(struct inode *inode, struct file *file)
 	if (unlikely(!asma))
 		return -ENOMEM;
 
-	INIT_LIST_HEAD(&asma->unpinned_list);
+	asma->unpinned = RB_ROOT;
+	mutex_init(&asma->mutex);
+	atomic_set(&asma->purge_inflight, 0);
 	memcpy(asma->name, ASHMEM_NAME_PREFIX, ASHMEM_NAME_PREFIX_LEN);
 	asma->prot_mask = PROT_MASK;
 	file->private_data = asma;
@@ -276,12 +363,17 @@ static int ashmem_open(struct inode *inode, struct file *file)
 static int ashmem_release(struct inode *ignored, struct file *file)
 {
 	struct ashmem_area *asma = file->private_data;
-	struct ashmem_range *range, *next;
+	struct ashmem_range *range;
 
-	mutex_lock(&ashmem_mutex);
-	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned)
+	ashmem_area_lock(asma);
+	ashmem_lru_lock_acquire();
+	while ((range = range_find(asma, 0, ULONG_MAX)))
 		range_del(range);
-	mutex_unlock(&ashmem_mutex);
+	ashmem_lru_lock_release();
+	ashmem_area_unlock(asma);
+
+	/* The shrinker may still be punching holes on behalf of this area */
+	wait_event(ashmem_purge_wait, !atomic_read(&asma->purge_inflight));
 
 	if (asma->file)
 		fput(asma->file);
@@ -305,7 +397,7 @@ static ssize_t ashmem_read(struct file *file, char __user *buf,
 	struct ashmem_area *asma = file->private_data;
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	ashmem_area_lock(asma);
 
 	/* If size is not set, or set to 0, always return EOF. */
 	if (asma->size == 0)
@@ -316,7 +408,7 @@ static ssize_t ashmem_read(struct file *file, char __user *buf,
 		goto out_unlock;
 	}
 
-	mutex_unlock(&ashmem_mutex);
+	ashmem_area_unlock(asma);
 
 	/*
 	 * asma and asma->file are used outside the lock here.  We assume
@@ -331,7 +423,7 @@ static ssize_t ashmem_read(struct file *file, char __user *buf,
 	return ret;
 
 out_unlock:
-	mutex_unlock(&ashmem_mutex);
+	ashmem_area_unlock(asma);
 	return ret;
 }
 
@@ -340,19 +432,19 @@ static loff_t ashmem_llseek(struct file *file, loff_t offset, int origin)
 	struct ashmem_area *asma = file->private_data;
 	int ret;
 
-	mutex_lock(&ashmem_mutex);
+	ashmem_area_lock(asma);
 
 	if (asma->size == 0) {
-		mutex_unlock(&ashmem_mutex);
+		ashmem_area_unlock(asma);
 		return -EINVAL;
 	}
 
 	if (!asma->file) {
-		mutex_unlock(&ashmem_mutex);
+		ashmem_area_unlock(asma);
 		return -EBADF;
 	}
 
-	mutex_unlock(&ashmem_mutex);
+	ashmem_area_unlock(asma);
 
 	ret = vfs_llseek(asma->file, offset, origin);
 	if (ret < 0)
@@ -390,7 +482,7 @@ static int ashmem_mmap(struct file *file, struct vm_area_struct *vma)
 	struct ashmem_area *asma = file->private_data;
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	ashmem_area_lock(asma);
 
 	/* user needs to SET_SIZE before mapping */
 	if (unlikely(!asma->size)) {
@@ -452,7 +544,7 @@ static int ashmem_mmap(struct file *file, struct vm_area_struct *vma)
 	}
 
 out:
-	mutex_unlock(&ashmem_mutex);
+	ashmem_area_unlock(asma);
 	return ret;
 }
 
@@ -463,41 +555,72 @@ static int ashmem_mmap(struct file *file, struct vm_area_struct *vma)
  *
  * 'gfp_mask' is the mask of the allocation that got us into this mess.
  *
- * Return value is the number of objects freed or -1 if we cannot
+ * Return value is the number of objects freed or SHRINK_STOP if we cannot
  * proceed without risk of deadlock (due to gfp_mask).
  *
  * We approximate LRU via least-recently-unpinned, jettisoning unpinned partial
- * chunks of ashmem regions LRU-wise one-at-a-time until we hit 'nr_to_scan'
- * pages freed.
+ * chunks of ashmem regions LRU-wise until we hit 'nr_to_scan' pages freed.
+ * Ranges are taken off the LRU in batches of ASHMEM_PURGE_BATCH and their
+ * pages are punched out with no lock held. Each area counts its ranges in
+ * flight so that pin and release can wait for the holes to be punched.
  */
 static unsigned long
 ashmem_shrink_scan(struct shrinker *shrink, struct shrink_control *sc)
 {
-	struct ashmem_range *range, *next;
+	struct {
+		struct ashmem_area *asma;
+		struct file *file;
+		loff_t start;
+		loff_t len;
+	} batch[ASHMEM_PURGE_BATCH];
+	struct ashmem_range *range;
 	unsigned long freed = 0;
+	int i, n;
 
 	/* We might recurse into filesystem code, so bail out if necessary */
 	if (!(sc->gfp_mask & __GFP_FS))
 		return SHRINK_STOP;
 
-	if (!mutex_trylock(&ashmem_mutex))
-		return -1;
+	while (sc->nr_to_scan) {
+		n = 0;
+		ashmem_lru_lock_acquire();
+		while (n < ASHMEM_PURGE_BATCH && !list_empty(&ashmem_lru_list)) {
+			range = list_first_entry(&ashmem_lru_list,
+						 struct ashmem_range, lru);
+			batch[n].asma = range->asma;
+			batch[n].file = range->asma->file;
+			batch[n].start = range_start(range) * PAGE_SIZE;
+			batch[n].len = range_size(range) * PAGE_SIZE;
+			get_file(batch[n].file);
+			atomic_inc(&range->asma->purge_inflight);
+			n++;
+
+			range->purged = ASHMEM_WAS_PURGED;
+			lru_del(range);
+
+			freed += range_size(range);
+			if (--sc->nr_to_scan <= 0)
+				break;
+		}
+		ashmem_lru_lock_release();
 
-	list_for_each_entry_safe(range, next, &ashmem_lru_list, lru) {
-		loff_t start = range->pgstart * PAGE_SIZE;
-		loff_t end = (range->pgend + 1) * PAGE_SIZE;
+		if (!n)
+			break;
 
-		range->asma->file->f_op->fallocate(range->asma->file,
+		for (i = 0; i < n; i++) {
+			batch[i].file->f_op->fallocate(batch[i].file,
 				FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
-				start, end - start);
-		range->purged = ASHMEM_WAS_PURGED;
-		lru_del(range);
+				batch[i].start, batch[i].len);
+			fput(batch[i].file);
+			/* The area may be freed as soon as this drops to 0 */
+			if (atomic_dec_and_test(&batch[i].asma->purge_inflight))
+				wake_up_all(&ashmem_purge_wait);
+		}
 
-		freed += range_size(range);
-		if (--sc->nr_to_scan <= 0)
-			break;
+		atomic64_inc(&purge_batches);
+		atomic64_add(n, &purge_ranges);
 	}
-	mutex_unlock(&ashmem_mutex);
+
 	return freed;
 }
 
@@ -526,7 +649,7 @@ static int set_prot_mask(struct ashmem_area *asma, unsigned long prot)
 {
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	ashmem_area_lock(asma);
 
 	/* the user can only remove, not add, protection bits */
 	if (unlikely((asma->prot_mask & prot) != prot)) {
@@ -541,7 +664,7 @@ static int set_prot_mask(struct ashmem_area *asma, unsigned long prot)
 	asma->prot_mask = prot;
 
 out:
-	mutex_unlock(&ashmem_mutex);
+	ashmem_area_unlock(asma);
 	return ret;
 }
 
@@ -552,10 +675,10 @@ static int set_name(struct ashmem_area *asma, void __user *name)
 	char local_name[ASHMEM_NAME_LEN];
 
 	/*
-	 * Holding the ashmem_mutex while doing a copy_from_user might cause
+	 * Holding the area's mutex while doing a copy_from_user might cause
 	 * an data abort which would try to access mmap_sem. If another
 	 * thread has invoked ashmem_mmap then it will be holding the
-	 * semaphore and will be waiting for ashmem_mutex, there by leading to
+	 * semaphore and will be waiting for the mutex, there by leading to
 	 * deadlock. We'll release the mutex  and take the name to a local
 	 * variable that does not need protection and later copy the local
 	 * variable to the structure member with lock held.
@@ -565,14 +688,14 @@ static int set_name(struct ashmem_area *asma, void __user *name)
 		return len;
 	if (len == ASHMEM_NAME_LEN)
 		local_name[ASHMEM_NAME_LEN - 1] = '\0';
-	mutex_lock(&ashmem_mutex);
+	ashmem_area_lock(asma);
 	/* cannot change an existing mapping's name */
 	if (unlikely(asma->file))
 		ret = -EINVAL;
 	else
 		strcpy(asma->name + ASHMEM_NAME_PREFIX_LEN, local_name);
 
-	mutex_unlock(&ashmem_mutex);
+	ashmem_area_unlock(asma);
 	return ret;
 }
 
@@ -588,7 +711,7 @@ static int get_name(struct ashmem_area *asma, void __user *name)
 	 */
 	char local_name[ASHMEM_NAME_LEN];
 
-	mutex_lock(&ashmem_mutex);
+	ashmem_area_lock(asma);
 	if (asma->name[ASHMEM_NAME_PREFIX_LEN] != '\0') {
 		/*
 		 * Copying only `len', instead of ASHMEM_NAME_LEN, bytes
@@ -600,7 +723,7 @@ static int get_name(struct ashmem_area *asma, void __user *name)
 		len = sizeof(ASHMEM_NAME_DEF);
 		memcpy(local_name, ASHMEM_NAME_DEF, len);
 	}
-	mutex_unlock(&ashmem_mutex);
+	ashmem_area_unlock(asma);
 
 	/*
 	 * Now we are just copying from the stack variable to userland
@@ -615,18 +738,15 @@ static int get_name(struct ashmem_area *asma, void __user *name)
  * ashmem_pin - pin the given ashmem region, returning whether it was
  * previously purged (ASHMEM_WAS_PURGED) or not (ASHMEM_NOT_PURGED).
  *
- * Caller must hold ashmem_mutex.
+ * Caller must hold the area's mutex and ashmem_lru_lock.
  */
-static int ashmem_pin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
+static int ashmem_pin(struct ashmem_area *asma, size_t pgstart, size_t pgend,
+		      struct ashmem_range **new_range)
 {
-	struct ashmem_range *range, *next;
+	struct ashmem_range *range;
 	int ret = ASHMEM_NOT_PURGED;
 
-	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned) {
-		/* moved past last applicable page; we can short circuit */
-		if (range_before_page(range, pgstart))
-			break;
-
+	while ((range = range_find(asma, pgstart, pgend))) {
 		/*
 		 * The user can ask us to pin pages that span multiple ranges,
 		 * or to pin pages that aren't even unpinned, so this is messy.
@@ -641,39 +761,39 @@ static int ashmem_pin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
 		 * 4. The requested range punches a hole in an existing range,
 		 *    so we have to update one side of the range and then
 		 *    create a new range for the other side.
+		 *
+		 * Ranges handled by cases 1-3 no longer overlap the request,
+		 * so we simply look up the next overlapping one.
 		 */
-		if (page_range_in_range(range, pgstart, pgend)) {
-			ret |= range->purged;
-
-			/* Case #1: Easy. Just nuke the whole thing. */
-			if (page_range_subsumes_range(range, pgstart, pgend)) {
-				range_del(range);
-				continue;
-			}
-
-			/* Case #2: We overlap from the start, so adjust it */
-			if (range->pgstart >= pgstart) {
-				range_shrink(range, pgend + 1, range->pgend);
-				continue;
-			}
-
-			/* Case #3: We overlap from the rear, so adjust it */
-			if (range->pgend <= pgend) {
-				range_shrink(range, range->pgstart,
-					     pgstart - 1);
-				continue;
-			}
-
-			/*
-			 * Case #4: We eat a chunk out of the middle. A bit
-			 * more complicated, we allocate a new range for the
-			 * second half and adjust the first chunk's endpoint.
-			 */
-			range_alloc(asma, range, range->purged,
-				    pgend + 1, range->pgend);
-			range_shrink(range, range->pgstart, pgstart - 1);
-			break;
+		ret |= range->purged;
+
+		/* Case #1: Easy. Just nuke the whole thing. */
+		if (page_range_subsumes_range(range, pgstart, pgend)) {
+			range_del(range);
+			continue;
+		}
+
+		/* Case #2: We overlap from the start, so adjust it */
+		if (range_start(range) >= pgstart) {
+			range_shrink(range, pgend + 1, range_end(range));
+			continue;
+		}
+
+		/* Case #3: We overlap from the rear, so adjust it */
+		if (range_end(range) <= pgend) {
+			range_shrink(range, range_start(range), pgstart - 1);
+			continue;
 		}
+
+		/*
+		 * Case #4: We eat a chunk out of the middle. A bit more
+		 * complicated, we use the preallocated range for the second
+		 * half and adjust the first chunk's endpoint.
+		 */
+		range_alloc(asma, new_range, range->purged,
+			    pgend + 1, range_end(range));
+		range_shrink(range, range_start(range), pgstart - 1);
+		break;
 	}
 
 	return ret;
@@ -682,64 +802,50 @@ static int ashmem_pin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
 /*
  * ashmem_unpin - unpin the given range of pages. Returns zero on success.
  *
- * Caller must hold ashmem_mutex.
+ * Caller must hold the area's mutex and ashmem_lru_lock.
  */
-static int ashmem_unpin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
+static int ashmem_unpin(struct ashmem_area *asma, size_t pgstart, size_t pgend,
+			struct ashmem_range **new_range)
 {
-	struct ashmem_range *range, *next;
+	struct ashmem_range *range;
 	unsigned int purged = ASHMEM_NOT_PURGED;
 
-restart:
-	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned) {
-		/* short circuit: this is our insertion point */
-		if (range_before_page(range, pgstart))
-			break;
-
+	while ((range = range_find(asma, pgstart, pgend))) {
 		/*
 		 * The user can ask us to unpin pages that are already entirely
 		 * or partially pinned. We handle those two cases here.
 		 */
 		if (page_range_subsumed_by_range(range, pgstart, pgend))
 			return 0;
-		if (page_range_in_range(range, pgstart, pgend)) {
-			pgstart = min(range->pgstart, pgstart);
-			pgend = max(range->pgend, pgend);
-			purged |= range->purged;
-			range_del(range);
-			goto restart;
-		}
+
+		pgstart = min_t(size_t, range_start(range), pgstart);
+		pgend = max_t(size_t, range_end(range), pgend);
+		purged |= range->purged;
+		range_del(range);
 	}
 
-	return range_alloc(asma, range, purged, pgstart, pgend);
+	return range_alloc(asma, new_range, purged, pgstart, pgend);
 }
 
 /*
  * ashmem_get_pin_status - Returns ASHMEM_IS_UNPINNED if _any_ pages in the
  * given interval are unpinned and ASHMEM_IS_PINNED otherwise.
  *
- * Caller must hold ashmem_mutex.
+ * Caller must hold the area's mutex.
  */
 static int ashmem_get_pin_status(struct ashmem_area *asma, size_t pgstart,
 				 size_t pgend)
 {
-	struct ashmem_range *range;
-	int ret = ASHMEM_IS_PINNED;
-
-	list_for_each_entry(range, &asma->unpinned_list, unpinned) {
-		if (range_before_page(range, pgstart))
-			break;
-		if (page_range_in_range(range, pgstart, pgend)) {
-			ret = ASHMEM_IS_UNPINNED;
-			break;
-		}
-	}
+	if (range_find(asma, pgstart, pgend))
+		return ASHMEM_IS_UNPINNED;
 
-	return ret;
+	return ASHMEM_IS_PINNED;
 }
 
 static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
 			    void __user *p)
 {
+	struct ashmem_range *new_range = NULL;
 	struct ashmem_pin pin;
 	size_t pgstart, pgend;
 	int ret = -EINVAL;
@@ -747,7 +853,17 @@ static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
 	if (unlikely(copy_from_user(&pin, p, sizeof(pin))))
 		return -EFAULT;
 
-	mutex_lock(&ashmem_mutex);
+	/*
+	 * Pin and unpin may need one new range. It is allocated up front as
+	 * they run under ashmem_lru_lock.
+	 */
+	if (cmd == ASHMEM_PIN || cmd == ASHMEM_UNPIN) {
+		new_range = kmem_cache_zalloc(ashmem_range_cachep, GFP_KERNEL);
+		if (unlikely(!new_range))
+			return -ENOMEM;
+	}
+
+	ashmem_area_lock(asma);
 
 	if (unlikely(!asma->file))
 		goto out_unlock;
@@ -770,10 +886,18 @@ static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
 
 	switch (cmd) {
 	case ASHMEM_PIN:
-		ret = ashmem_pin(asma, pgstart, pgend);
+		ashmem_lru_lock_acquire();
+		ret = ashmem_pin(asma, pgstart, pgend, &new_range);
+		ashmem_lru_lock_release();
+		/* Don't let userspace refill pages that are being punched */
+		if (ret == ASHMEM_WAS_PURGED)
+			wait_event(ashmem_purge_wait,
+				   !atomic_read(&asma->purge_inflight));
 		break;
 	case ASHMEM_UNPIN:
-		ret = ashmem_unpin(asma, pgstart, pgend);
+		ashmem_lru_lock_acquire();
+		ret = ashmem_unpin(asma, pgstart, pgend, &new_range);
+		ashmem_lru_lock_release();
 		break;
 	case ASHMEM_GET_PIN_STATUS:
 		ret = ashmem_get_pin_status(asma, pgstart, pgend);
@@ -781,7 +905,10 @@ static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
 	}
 
 out_unlock:
-	mutex_unlock(&ashmem_mutex);
+	ashmem_area_unlock(asma);
+
+	if (new_range)
+		kmem_cache_free(ashmem_range_cachep, new_range);
 
 	return ret;
 }
@@ -800,12 +927,12 @@ static long ashmem_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		break;
 	case ASHMEM_SET_SIZE:
 		ret = -EINVAL;
-		mutex_lock(&ashmem_mutex);
+		ashmem_area_lock(asma);
 		if (!asma->file) {
 			ret = 0;
 			asma->size = (size_t)arg;
 		}
-		mutex_unlock(&ashmem_mutex);
+		ashmem_area_unlock(asma);
 		break;
 	case ASHMEM_GET_SIZE:
 		ret = asma->size;
@@ -867,6 +994,42 @@ static const struct file_operations ashmem_fops = {
 #endif
 };
 
+static void lock_stat_show(struct seq_file *s, const char *name,
+			   struct ashmem_lock_stat *stat)
+{
+	u64 count = atomic64_read(&stat->count);
+	u64 total = atomic64_read(&stat->total_ns);
+
+	seq_printf(s, "%-8s %12llu %14llu %10llu %10llu\n", name, count, total,
+		   count ? div64_u64(total, count) : 0,
+		   (u64)atomic64_read(&stat->max_ns));
+}
+
+static int ashmem_lock_stats_show(struct seq_file *s, void *unused)
+{
+	seq_printf(s, "%-8s %12s %14s %10s %10s\n", "lock", "count",
+		   "total_ns", "avg_ns", "max_ns");
+	lock_stat_show(s, "area", &area_lock_stat);
+	lock_stat_show(s, "lru", &lru_lock_stat);
+	seq_printf(s, "\npurge batches: %llu ranges: %llu lru pages: %lu\n",
+		   (u64)atomic64_read(&purge_batches),
+		   (u64)atomic64_read(&purge_ranges), lru_count);
+
+	return 0;
+}
+
+static int ashmem_lock_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ashmem_lock_stats_show, inode->i_private);
+}
+
+static const struct file_operations ashmem_lock_stats_fops = {
+	.open = ashmem_lock_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static struct miscdevice ashmem_misc = {
 	.minor = MISC_DYNAMIC_MINOR,
 	.name = "ashmem",
@@ -901,6 +1064,9 @@ static int __init ashmem_init(void)
 
 	register_shrinker(&ashmem_shrinker);
 
+	debugfs_create_file("ashmem_lock_stats", 0444, NULL, NULL,
+			    &ashmem_lock_stats_fops);
+
 	pr_info("initialized\n");
 
 	return 0;
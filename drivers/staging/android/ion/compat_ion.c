@@ -30,6 +30,15 @@ struct compat_ion_allocation_data {
 	compat_int_t handle;
 };
 
+struct compat_ion_batch_allocation_data {
+	compat_size_t len;
+	compat_size_t align;
+	compat_uint_t heap_id_mask;
+	compat_uint_t flags;
+	compat_uint_t count;
+	compat_uptr_t fds;
+};
+
 struct compat_ion_custom_data {
 	compat_uint_t cmd;
 	compat_ulong_t arg;
@@ -45,6 +54,8 @@ struct compat_ion_handle_data {
 				      struct compat_ion_handle_data)
 #define COMPAT_ION_IOC_CUSTOM	_IOWR(ION_IOC_MAGIC, 6, \
 				      struct compat_ion_custom_data)
+#define COMPAT_ION_IOC_ALLOC_BATCH	_IOWR(ION_IOC_MAGIC, 8, \
+				struct compat_ion_batch_allocation_data)
 
 static int compat_get_ion_allocation_data(
 			struct compat_ion_allocation_data __user *data32,
@@ -69,6 +80,31 @@ static int compat_get_ion_allocation_data(
 	return err;
 }
 
+static int compat_get_ion_batch_allocation_data(
+			struct compat_ion_batch_allocation_data __user *data32,
+			struct ion_batch_allocation_data __user *data)
+{
+	compat_size_t s;
+	compat_uint_t u;
+	compat_uptr_t p;
+	int err;
+
+	err = get_user(s, &data32->len);
+	err |= put_user(s, &data->len);
+	err |= get_user(s, &data32->align);
+	err |= put_user(s, &data->align);
+	err |= get_user(u, &data32->heap_id_mask);
+	err |= put_user(u, &data->heap_id_mask);
+	err |= get_user(u, &data32->flags);
+	err |= put_user(u, &data->flags);
+	err |= get_user(u, &data32->count);
+	err |= put_user(u, &data->count);
+	err |= get_user(p, &data32->fds);
+	err |= put_user((unsigned long)compat_ptr(p), &data->fds);
+
+	return err;
+}
+
 static int compat_get_ion_handle_data(
 			struct compat_ion_handle_data __user *data32,
 			struct ion_handle_data __user *data)
@@ -148,6 +184,24 @@ long compat_ion_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		err = compat_put_ion_allocation_data(data32, data);
 		return ret ? ret : err;
 	}
+	case COMPAT_ION_IOC_ALLOC_BATCH:
+	{
+		struct compat_ion_batch_allocation_data __user *data32;
+		struct ion_batch_allocation_data __user *data;
+		int err;
+
+		data32 = compat_ptr(arg);
+		data = compat_alloc_user_space(sizeof(*data));
+		if (!data)
+			return -EFAULT;
+
+		err = compat_get_ion_batch_allocation_data(data32, data);
+		if (err)
+			return err;
+
+		return filp->f_op->unlocked_ioctl(filp, ION_IOC_ALLOC_BATCH,
+							(unsigned long)data);
+	}
 	case COMPAT_ION_IOC_FREE:
 	{
 		struct compat_ion_handle_data __user *data32;
@@ -182,6 +182,35 @@ static void ion_buffer_add(struct ion_device *dev,
 }
 
 /* this function should only be called while dev->lock is held */
+/*
+ * Charge the buffer to the allocating process, so the low memory killer
+ * counts it as memory that killing the process would free. Buffers that
+ * kernel threads allocate are not charged.
+ */
+static void ion_buffer_charge_mm(struct ion_buffer *buffer)
+{
+	struct mm_struct *mm = current->mm;
+
+	if (!mm || (current->flags & PF_KTHREAD))
+		return;
+
+	atomic_inc(&mm->mm_count);
+	buffer->mm = mm;
+	add_mm_counter(mm, MM_UNRECLAIMABLE, PAGE_ALIGN(buffer->size) >>
+			PAGE_SHIFT);
+}
+
+static void ion_buffer_uncharge_mm(struct ion_buffer *buffer)
+{
+	if (!buffer->mm)
+		return;
+
+	add_mm_counter(buffer->mm, MM_UNRECLAIMABLE,
+			-(long)(PAGE_ALIGN(buffer->size) >> PAGE_SHIFT));
+	mmdrop(buffer->mm);
+	buffer->mm = NULL;
+}
+
 static struct ion_buffer *ion_buffer_create(struct ion_heap *heap,
 				     struct ion_device *dev,
 				     unsigned long len,
@@ -207,6 +236,7 @@ static struct ion_buffer *ion_buffer_create(struct ion_heap *heap,
 		if (!(heap->flags & ION_HEAP_FLAG_DEFER_FREE))
 			goto err2;
 
+		ion_heap_freelist_pressure(heap);
 		ion_heap_freelist_drain(heap, 0);
 		ret = heap->ops->allocate(heap, buffer, len, align,
 					  flags);
@@ -267,6 +297,7 @@ static struct ion_buffer *ion_buffer_create(struct ion_heap *heap,
 	ion_buffer_add(dev, buffer);
 	mutex_unlock(&dev->buffer_lock);
 	atomic_long_add(len, &heap->total_allocated);
+	ion_buffer_charge_mm(buffer);
 	return buffer;
 
 err:
@@ -288,6 +319,7 @@ void ion_buffer_destroy(struct ion_buffer *buffer)
 	buffer->heap->ops->unmap_dma(buffer->heap, buffer);
 
 	atomic_long_sub(buffer->size, &buffer->heap->total_allocated);
+	ion_buffer_uncharge_mm(buffer);
 	buffer->heap->ops->free(buffer);
 	vfree(buffer->pages);
 	kfree(buffer);
@@ -1393,6 +1425,34 @@ static int ion_dma_buf_end_cpu_access(struct dma_buf *dmabuf,
 	return 0;
 }
 
+static int ion_dma_buf_begin_cpu_access_partial(struct dma_buf *dmabuf,
+					enum dma_data_direction direction,
+					unsigned int offset, unsigned int len)
+{
+	struct ion_buffer *buffer = dmabuf->priv;
+
+	/* The cpu is only going to write, nothing to invalidate */
+	if (direction == DMA_TO_DEVICE)
+		return 0;
+
+	return msm_ion_buffer_cache_op(buffer, offset, len,
+				       ION_IOC_INV_CACHES);
+}
+
+static int ion_dma_buf_end_cpu_access_partial(struct dma_buf *dmabuf,
+					enum dma_data_direction direction,
+					unsigned int offset, unsigned int len)
+{
+	struct ion_buffer *buffer = dmabuf->priv;
+
+	/* The cpu only read, there are no dirty lines to clean */
+	if (direction == DMA_FROM_DEVICE)
+		return 0;
+
+	return msm_ion_buffer_cache_op(buffer, offset, len,
+				       ION_IOC_CLEAN_CACHES);
+}
+
 static struct dma_buf_ops dma_buf_ops = {
 	.map_dma_buf = ion_map_dma_buf,
 	.unmap_dma_buf = ion_unmap_dma_buf,
@@ -1400,17 +1460,31 @@ static struct dma_buf_ops dma_buf_ops = {
 	.release = ion_dma_buf_release,
 	.begin_cpu_access = ion_dma_buf_begin_cpu_access,
 	.end_cpu_access = ion_dma_buf_end_cpu_access,
+	.begin_cpu_access_partial = ion_dma_buf_begin_cpu_access_partial,
+	.end_cpu_access_partial = ion_dma_buf_end_cpu_access_partial,
 	.kmap_atomic = ion_dma_buf_kmap,
 	.kunmap_atomic = ion_dma_buf_kunmap,
 	.kmap = ion_dma_buf_kmap,
 	.kunmap = ion_dma_buf_kunmap,
 };
 
+/* Export a buffer as a dma-buf, the dma-buf takes over a buffer reference */
+static struct dma_buf *ion_buffer_export(struct ion_buffer *buffer)
+{
+	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
+
+	exp_info.ops = &dma_buf_ops;
+	exp_info.size = buffer->size;
+	exp_info.flags = O_RDWR;
+	exp_info.priv = buffer;
+
+	return dma_buf_export(&exp_info);
+}
+
 static struct dma_buf *__ion_share_dma_buf(struct ion_client *client,
 					   struct ion_handle *handle,
 					   bool lock_client)
 {
-	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
 	struct ion_buffer *buffer;
 	struct dma_buf *dmabuf;
 	bool valid_handle;
@@ -1429,12 +1503,7 @@ static struct dma_buf *__ion_share_dma_buf(struct ion_client *client,
 	if (lock_client)
 		mutex_unlock(&client->lock);
 
-	exp_info.ops = &dma_buf_ops;
-	exp_info.size = buffer->size;
-	exp_info.flags = O_RDWR;
-	exp_info.priv = buffer;
-
-	dmabuf = dma_buf_export(&exp_info);
+	dmabuf = ion_buffer_export(buffer);
 	if (IS_ERR(dmabuf)) {
 		ion_buffer_put(buffer);
 		return dmabuf;
@@ -1589,6 +1658,107 @@ static int ion_sync_for_device(struct ion_client *client, int fd)
 	return 0;
 }
 
+/*
+ * Allocate a set of same sized buffers and hand them straight to userspace
+ * as dma-buf fds. The heap that satisfied the previous buffer is tried first,
+ * so the heap walk is only repeated if it fails, and since no handles are
+ * created client->lock is never taken. Nothing is installed in the fd table
+ * until every buffer has been allocated and the fds are copied out.
+ */
+static int ion_alloc_batch(struct ion_client *client,
+			   struct ion_batch_allocation_data *data)
+{
+	struct ion_device *dev = client->dev;
+	struct ion_heap *heap, *last = NULL;
+	unsigned int flags = data->flags | ION_FLAG_CACHED_NEEDS_SYNC;
+	size_t len = PAGE_ALIGN(data->len);
+	struct dma_buf **dmabufs;
+	unsigned int i, n;
+	int *fds;
+	int ret = 0;
+
+	if (!len || !data->count || data->count > ION_BATCH_ALLOC_MAX)
+		return -EINVAL;
+
+	dmabufs = kcalloc(data->count, sizeof(*dmabufs), GFP_KERNEL);
+	fds = kcalloc(data->count, sizeof(*fds), GFP_KERNEL);
+	if (!dmabufs || !fds) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	down_read(&dev->lock);
+	for (n = 0; n < data->count; n++) {
+		struct ion_buffer *buffer = ERR_PTR(-ENODEV);
+
+		if (last)
+			buffer = ion_buffer_create(last, dev, len, data->align,
+						   flags);
+
+		if (IS_ERR(buffer)) {
+			plist_for_each_entry(heap, &dev->heaps, node) {
+				if (heap == last ||
+				    !((1 << heap->id) & data->heap_id_mask))
+					continue;
+				buffer = ion_buffer_create(heap, dev, len,
+							   data->align, flags);
+				if (!IS_ERR(buffer)) {
+					last = heap;
+					break;
+				}
+			}
+		}
+
+		if (IS_ERR(buffer)) {
+			ret = PTR_ERR(buffer);
+			break;
+		}
+
+		dmabufs[n] = ion_buffer_export(buffer);
+		if (IS_ERR(dmabufs[n])) {
+			ret = PTR_ERR(dmabufs[n]);
+			ion_buffer_put(buffer);
+			break;
+		}
+	}
+	up_read(&dev->lock);
+
+	if (ret) {
+		pr_debug("ION is unable to allocate %u x 0x%zx bytes for client %s\n",
+			 data->count, len, client->name);
+		goto err_put;
+	}
+
+	for (i = 0; i < data->count; i++) {
+		fds[i] = get_unused_fd_flags(O_CLOEXEC);
+		if (fds[i] < 0) {
+			ret = fds[i];
+			goto err_fds;
+		}
+	}
+
+	if (copy_to_user((void __user *)data->fds, fds,
+			 data->count * sizeof(*fds))) {
+		ret = -EFAULT;
+		goto err_fds;
+	}
+
+	for (i = 0; i < data->count; i++)
+		fd_install(fds[i], dmabufs[i]->file);
+	goto out;
+
+err_fds:
+	while (i--)
+		put_unused_fd(fds[i]);
+err_put:
+	for (i = 0; i < n; i++)
+		dma_buf_put(dmabufs[i]);
+out:
+	kfree(fds);
+	kfree(dmabufs);
+	return ret;
+}
+
 /* fix up the cases where the ioctl direction bits are incorrect */
 static unsigned int ion_ioctl_dir(unsigned int cmd)
 {
@@ -1613,6 +1783,7 @@ static long ion_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	union {
 		struct ion_fd_data fd;
 		struct ion_allocation_data allocation;
+		struct ion_batch_allocation_data batch;
 		struct ion_handle_data handle;
 		struct ion_custom_data custom;
 	} data;
@@ -1643,6 +1814,11 @@ static long ion_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		pass_to_user(handle);
 		break;
 	}
+	case ION_IOC_ALLOC_BATCH:
+	{
+		ret = ion_alloc_batch(client, &data.batch);
+		break;
+	}
 	case ION_IOC_FREE:
 	{
 		struct ion_handle *handle;
@@ -1945,8 +2121,7 @@ static int ion_debug_heap_show(struct seq_file *s, void *unused)
 		   total_orphaned_size);
 	seq_printf(s, "%16s %16zu\n", "total ", total_size);
 	if (heap->flags & ION_HEAP_FLAG_DEFER_FREE)
-		seq_printf(s, "%16s %16zu\n", "deferred free",
-				heap->free_list_size);
+		ion_heap_freelist_debug_show(heap, s);
 	seq_puts(s, "----------------------------------------------------\n");
 
 	if (heap->debug_show)
@@ -2036,7 +2211,7 @@ void ion_device_add_heap(struct ion_device *dev, struct ion_heap *heap)
 		       __func__);
 
 	spin_lock_init(&heap->free_lock);
-	heap->free_list_size = 0;
+	atomic_long_set(&heap->free_list_size, 0);
 
 	if (heap->flags & ION_HEAP_FLAG_DEFER_FREE)
 		ion_heap_init_deferred_free(heap);
@@ -18,27 +18,215 @@
 #include <linux/err.h>
 #include <linux/genalloc.h>
 #include <linux/io.h>
+#include <linux/log2.h>
 #include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/of.h>
 #include <linux/scatterlist.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
 #include "ion.h"
 #include "ion_priv.h"
 
+/* Largest buddy block is 2^(ION_CARVEOUT_NR_ORDERS - 1) pages */
+#define ION_CARVEOUT_NR_ORDERS	20
+
+/**
+ * struct ion_carveout_class - blocks of one size set aside for that size
+ * @size:	size of each block, in bytes
+ * @count:	number of blocks reserved
+ * @nr_free:	number of entries in @free
+ * @free:	page offsets of the free blocks
+ */
+struct ion_carveout_class {
+	unsigned long size;
+	unsigned int count;
+	unsigned int nr_free;
+	unsigned long *free;
+};
+
+/**
+ * struct ion_carveout_buddy - buddy allocator over the pages of a carveout
+ * @lock:	protects all of the below
+ * @npages:	number of pages in the carveout
+ * @nr_orders:	number of orders in use, limited by @npages
+ * @map:	for each order, a bit per aligned block that is set if the
+ *		block is free and not part of a larger free block
+ * @nr_free:	number of bits set in each @map
+ * @reserved:	a bit per page that is set for the first page of each block
+ *		owned by a size class
+ * @classes:	the size classes from DT
+ * @nr_classes:	number of entries in @classes
+ *
+ * The carveout may not be accessible to the kernel, so the state is kept
+ * in bitmaps rather than in the free blocks themselves.
+ */
+struct ion_carveout_buddy {
+	struct mutex lock;
+	unsigned long npages;
+	unsigned int nr_orders;
+	unsigned long *map[ION_CARVEOUT_NR_ORDERS];
+	unsigned long nr_free[ION_CARVEOUT_NR_ORDERS];
+	unsigned long *reserved;
+	struct ion_carveout_class *classes;
+	int nr_classes;
+};
+
 struct ion_carveout_heap {
 	struct ion_heap heap;
 	struct gen_pool *pool;
+	struct ion_carveout_buddy *buddy;
 	ion_phys_addr_t base;
 };
 
+static void ion_carveout_buddy_free_block(struct ion_carveout_buddy *buddy,
+					  unsigned long pgoff,
+					  unsigned int order)
+{
+	unsigned long idx = pgoff >> order;
+
+	while (order + 1 < buddy->nr_orders) {
+		unsigned long sibling = idx ^ 1;
+
+		if (sibling >= buddy->npages >> order ||
+		    !test_bit(sibling, buddy->map[order]))
+			break;
+
+		clear_bit(sibling, buddy->map[order]);
+		buddy->nr_free[order]--;
+		idx >>= 1;
+		order++;
+	}
+
+	set_bit(idx, buddy->map[order]);
+	buddy->nr_free[order]++;
+}
+
+/* Free any run of pages as the largest aligned blocks that make it up */
+static void ion_carveout_buddy_free_range(struct ion_carveout_buddy *buddy,
+					  unsigned long pgoff,
+					  unsigned long npages)
+{
+	unsigned int order;
+
+	while (npages) {
+		order = min_t(unsigned int, ilog2(npages),
+			      buddy->nr_orders - 1);
+		if (pgoff)
+			order = min_t(unsigned int, order, __ffs(pgoff));
+
+		ion_carveout_buddy_free_block(buddy, pgoff, order);
+		pgoff += 1UL << order;
+		npages -= 1UL << order;
+	}
+}
+
+/*
+ * Split the smallest free block that fits and give the pages past @npages
+ * back, so that only the pages asked for are used.
+ */
+static long ion_carveout_buddy_alloc(struct ion_carveout_buddy *buddy,
+				     unsigned long npages)
+{
+	unsigned int order = order_base_2(npages);
+	unsigned int k;
+	unsigned long idx;
+
+	for (k = order; k < buddy->nr_orders; k++)
+		if (buddy->nr_free[k])
+			break;
+	if (k >= buddy->nr_orders)
+		return -ENOMEM;
+
+	idx = find_first_bit(buddy->map[k], buddy->npages >> k);
+	clear_bit(idx, buddy->map[k]);
+	buddy->nr_free[k]--;
+
+	while (k > order) {
+		k--;
+		idx <<= 1;
+		set_bit(idx + 1, buddy->map[k]);
+		buddy->nr_free[k]++;
+	}
+
+	if ((1UL << order) > npages)
+		ion_carveout_buddy_free_range(buddy, (idx << order) + npages,
+					      (1UL << order) - npages);
+
+	return idx << order;
+}
+
+static struct ion_carveout_class *
+ion_carveout_find_class(struct ion_carveout_buddy *buddy, unsigned long size)
+{
+	int i;
+
+	for (i = 0; i < buddy->nr_classes; i++)
+		if (buddy->classes[i].size == size)
+			return &buddy->classes[i];
+
+	return NULL;
+}
+
+static ion_phys_addr_t
+ion_carveout_buddy_allocate(struct ion_carveout_heap *carveout_heap,
+			    unsigned long size)
+{
+	struct ion_carveout_buddy *buddy = carveout_heap->buddy;
+	struct ion_carveout_class *class;
+	long pgoff;
+
+	size = PAGE_ALIGN(size);
+
+	mutex_lock(&buddy->lock);
+	class = ion_carveout_find_class(buddy, size);
+	if (class && class->nr_free)
+		pgoff = class->free[--class->nr_free];
+	else
+		pgoff = ion_carveout_buddy_alloc(buddy, size >> PAGE_SHIFT);
+	mutex_unlock(&buddy->lock);
+
+	if (pgoff < 0)
+		return ION_CARVEOUT_ALLOCATE_FAIL;
+
+	return carveout_heap->base + ((ion_phys_addr_t)pgoff << PAGE_SHIFT);
+}
+
+static void ion_carveout_buddy_release(struct ion_carveout_heap *carveout_heap,
+				       ion_phys_addr_t addr,
+				       unsigned long size)
+{
+	struct ion_carveout_buddy *buddy = carveout_heap->buddy;
+	unsigned long pgoff = (addr - carveout_heap->base) >> PAGE_SHIFT;
+	struct ion_carveout_class *class;
+
+	size = PAGE_ALIGN(size);
+
+	mutex_lock(&buddy->lock);
+	if (test_bit(pgoff, buddy->reserved)) {
+		class = ion_carveout_find_class(buddy, size);
+		if (!WARN_ON(!class || class->nr_free >= class->count))
+			class->free[class->nr_free++] = pgoff;
+	} else {
+		ion_carveout_buddy_free_range(buddy, pgoff,
+					      size >> PAGE_SHIFT);
+	}
+	mutex_unlock(&buddy->lock);
+}
+
 ion_phys_addr_t ion_carveout_allocate(struct ion_heap *heap,
 				      unsigned long size,
 				      unsigned long align)
 {
 	struct ion_carveout_heap *carveout_heap =
 		container_of(heap, struct ion_carveout_heap, heap);
-	unsigned long offset = gen_pool_alloc(carveout_heap->pool, size);
+	unsigned long offset;
+
+	if (carveout_heap->buddy)
+		return ion_carveout_buddy_allocate(carveout_heap, size);
 
+	offset = gen_pool_alloc(carveout_heap->pool, size);
 	if (!offset)
 		return ION_CARVEOUT_ALLOCATE_FAIL;
 
@@ -53,7 +241,165 @@ void ion_carveout_free(struct ion_heap *heap, ion_phys_addr_t addr,
 
 	if (addr == ION_CARVEOUT_ALLOCATE_FAIL)
 		return;
-	gen_pool_free(carveout_heap->pool, addr, size);
+
+	if (carveout_heap->buddy)
+		ion_carveout_buddy_release(carveout_heap, addr, size);
+	else
+		gen_pool_free(carveout_heap->pool, addr, size);
+}
+
+static void ion_carveout_buddy_destroy(struct ion_carveout_buddy *buddy)
+{
+	int i;
+
+	if (!buddy)
+		return;
+
+	for (i = 0; i < buddy->nr_classes; i++)
+		kfree(buddy->classes[i].free);
+	kfree(buddy->classes);
+	for (i = 0; i < ION_CARVEOUT_NR_ORDERS; i++)
+		kfree(buddy->map[i]);
+	kfree(buddy->reserved);
+	kfree(buddy);
+}
+
+/*
+ * "qcom,carveout-buddy-reserve" is a list of <size count> pairs. Each pair
+ * takes count blocks of size bytes out of the buddy allocator at boot, and
+ * allocations of exactly that size are served from them first.
+ */
+static int ion_carveout_buddy_reserve(struct ion_carveout_buddy *buddy,
+				      struct device_node *np)
+{
+	struct ion_carveout_class *class;
+	int i, j, nr;
+	u32 size, count;
+	long pgoff;
+
+	nr = of_property_count_u32_elems(np, "qcom,carveout-buddy-reserve");
+	if (nr <= 0)
+		return 0;
+	if (nr % 2)
+		return -EINVAL;
+
+	buddy->classes = kcalloc(nr / 2, sizeof(*buddy->classes), GFP_KERNEL);
+	if (!buddy->classes)
+		return -ENOMEM;
+
+	for (i = 0; i < nr / 2; i++) {
+		of_property_read_u32_index(np, "qcom,carveout-buddy-reserve",
+					   2 * i, &size);
+		of_property_read_u32_index(np, "qcom,carveout-buddy-reserve",
+					   2 * i + 1, &count);
+		if (!size || !count)
+			return -EINVAL;
+
+		class = &buddy->classes[buddy->nr_classes++];
+		class->size = PAGE_ALIGN(size);
+		class->free = kcalloc(count, sizeof(*class->free), GFP_KERNEL);
+		if (!class->free)
+			return -ENOMEM;
+
+		for (j = 0; j < count; j++) {
+			pgoff = ion_carveout_buddy_alloc(buddy,
+						class->size >> PAGE_SHIFT);
+			if (pgoff < 0)
+				return -ENOMEM;
+			set_bit(pgoff, buddy->reserved);
+			class->free[class->nr_free++] = pgoff;
+		}
+		class->count = count;
+	}
+
+	return 0;
+}
+
+static struct ion_carveout_buddy *
+ion_carveout_buddy_create(struct device_node *np, size_t size)
+{
+	struct ion_carveout_buddy *buddy;
+	unsigned int i;
+	int ret;
+
+	buddy = kzalloc(sizeof(*buddy), GFP_KERNEL);
+	if (!buddy)
+		return ERR_PTR(-ENOMEM);
+
+	mutex_init(&buddy->lock);
+	buddy->npages = size >> PAGE_SHIFT;
+	if (!buddy->npages) {
+		ret = -EINVAL;
+		goto err;
+	}
+	buddy->nr_orders = min_t(unsigned int, ilog2(buddy->npages) + 1,
+				 ION_CARVEOUT_NR_ORDERS);
+
+	ret = -ENOMEM;
+	for (i = 0; i < buddy->nr_orders; i++) {
+		buddy->map[i] = kcalloc(BITS_TO_LONGS(buddy->npages >> i),
+					sizeof(long), GFP_KERNEL);
+		if (!buddy->map[i])
+			goto err;
+	}
+	buddy->reserved = kcalloc(BITS_TO_LONGS(buddy->npages), sizeof(long),
+				  GFP_KERNEL);
+	if (!buddy->reserved)
+		goto err;
+
+	ion_carveout_buddy_free_range(buddy, 0, buddy->npages);
+
+	ret = ion_carveout_buddy_reserve(buddy, np);
+	if (ret)
+		goto err;
+
+	return buddy;
+
+err:
+	ion_carveout_buddy_destroy(buddy);
+	return ERR_PTR(ret);
+}
+
+static int ion_carveout_heap_debug_show(struct ion_heap *heap,
+					struct seq_file *s, void *unused)
+{
+	struct ion_carveout_heap *carveout_heap =
+		container_of(heap, struct ion_carveout_heap, heap);
+	struct ion_carveout_buddy *buddy = carveout_heap->buddy;
+	struct ion_carveout_class *class;
+	unsigned long free = 0;
+	int largest = -1;
+	int i;
+
+	if (!s)
+		return 0;
+
+	if (!buddy) {
+		seq_printf(s, "carveout: %zu of %zu bytes free\n",
+			   gen_pool_avail(carveout_heap->pool),
+			   gen_pool_size(carveout_heap->pool));
+		return 0;
+	}
+
+	mutex_lock(&buddy->lock);
+	for (i = 0; i < buddy->nr_orders; i++) {
+		seq_printf(s, "order %d: %lu free blocks\n", i,
+			   buddy->nr_free[i]);
+		free += buddy->nr_free[i] << i;
+		if (buddy->nr_free[i])
+			largest = i;
+	}
+	seq_printf(s, "carveout: %lu of %lu bytes free, largest free block %lu bytes\n",
+		   free << PAGE_SHIFT, buddy->npages << PAGE_SHIFT,
+		   largest < 0 ? 0 : PAGE_SIZE << largest);
+	for (i = 0; i < buddy->nr_classes; i++) {
+		class = &buddy->classes[i];
+		seq_printf(s, "reserve %lu bytes: %u of %u blocks free\n",
+			   class->size, class->nr_free, class->count);
+	}
+	mutex_unlock(&buddy->lock);
+
+	return 0;
 }
 
 static int ion_carveout_heap_phys(struct ion_heap *heap,
@@ -160,9 +506,14 @@ static struct ion_heap_ops carveout_heap_ops = {
 	.unmap_kernel = ion_heap_unmap_kernel,
 };
 
+/*
+ * Carveouts whose DT node has "qcom,carveout-buddy" are managed by a buddy
+ * allocator instead of a first-fit gen_pool, which keeps large blocks
+ * available in carveouts that serve many fixed size buffers.
+ */
 static struct ion_heap *__ion_carveout_heap_create(
 					struct ion_platform_heap *heap_data,
-					bool sync)
+					struct device_node *np, bool sync)
 {
 	struct ion_carveout_heap *carveout_heap;
 	int ret;
@@ -185,24 +536,38 @@ static struct ion_heap *__ion_carveout_heap_create(
 	if (!carveout_heap)
 		return ERR_PTR(-ENOMEM);
 
-	carveout_heap->pool = gen_pool_create(PAGE_SHIFT, -1);
-	if (!carveout_heap->pool) {
-		kfree(carveout_heap);
-		return ERR_PTR(-ENOMEM);
-	}
 	carveout_heap->base = heap_data->base;
-	gen_pool_add(carveout_heap->pool, carveout_heap->base, heap_data->size,
-		     -1);
+	if (np && of_property_read_bool(np, "qcom,carveout-buddy")) {
+		carveout_heap->buddy = ion_carveout_buddy_create(np,
+							heap_data->size);
+		if (IS_ERR(carveout_heap->buddy)) {
+			ret = PTR_ERR(carveout_heap->buddy);
+			kfree(carveout_heap);
+			return ERR_PTR(ret);
+		}
+	} else {
+		carveout_heap->pool = gen_pool_create(PAGE_SHIFT, -1);
+		if (!carveout_heap->pool) {
+			kfree(carveout_heap);
+			return ERR_PTR(-ENOMEM);
+		}
+		gen_pool_add(carveout_heap->pool, carveout_heap->base,
+			     heap_data->size, -1);
+	}
 	carveout_heap->heap.ops = &carveout_heap_ops;
 	carveout_heap->heap.type = ION_HEAP_TYPE_CARVEOUT;
 	carveout_heap->heap.flags = ION_HEAP_FLAG_DEFER_FREE;
+	carveout_heap->heap.debug_show = ion_carveout_heap_debug_show;
 
 	return &carveout_heap->heap;
 }
 
 struct ion_heap *ion_carveout_heap_create(struct ion_platform_heap *heap_data)
 {
-	return __ion_carveout_heap_create(heap_data, true);
+	struct device *dev = heap_data->priv;
+
+	return __ion_carveout_heap_create(heap_data,
+					  dev ? dev->of_node : NULL, true);
 }
 
 void ion_carveout_heap_destroy(struct ion_heap *heap)
@@ -210,7 +575,9 @@ void ion_carveout_heap_destroy(struct ion_heap *heap)
 	struct ion_carveout_heap *carveout_heap =
 	     container_of(heap, struct  ion_carveout_heap, heap);
 
-	gen_pool_destroy(carveout_heap->pool);
+	if (carveout_heap->pool)
+		gen_pool_destroy(carveout_heap->pool);
+	ion_carveout_buddy_destroy(carveout_heap->buddy);
 	kfree(carveout_heap);
 	carveout_heap = NULL;
 }
@@ -281,6 +648,22 @@ static void ion_sc_heap_free(struct ion_buffer *buffer)
 	kfree(table);
 }
 
+static int ion_sc_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
+				  void *unused)
+{
+	struct ion_sc_heap *manager =
+		container_of(heap, struct ion_sc_heap, heap);
+	struct ion_sc_entry *entry;
+
+	list_for_each_entry(entry, &manager->children, list) {
+		if (s)
+			seq_printf(s, "token 0x%x:\n", entry->token);
+		ion_carveout_heap_debug_show(entry->heap, s, unused);
+	}
+
+	return 0;
+}
+
 static struct ion_heap_ops ion_sc_heap_ops = {
 	.allocate = ion_sc_heap_allocate,
 	.free = ion_sc_heap_free,
@@ -370,7 +753,7 @@ static int ion_sc_add_child(struct ion_sc_heap *manager,
 	heap_data.size = size;
 
 	/* This will zero memory initially */
-	entry->heap = __ion_carveout_heap_create(&heap_data, false);
+	entry->heap = __ion_carveout_heap_create(&heap_data, np, false);
 	if (IS_ERR(entry->heap))
 		goto out_free;
 
@@ -428,6 +811,7 @@ struct ion_heap *ion_secure_carveout_heap_create(
 	}
 
 	manager->heap.ops = &ion_sc_heap_ops;
+	manager->heap.debug_show = ion_sc_heap_debug_show;
 	manager->heap.type = (enum ion_heap_type)ION_HEAP_TYPE_SECURE_CARVEOUT;
 	return &manager->heap;
 
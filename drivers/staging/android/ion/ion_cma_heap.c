@@ -24,6 +24,7 @@
 #include <linux/dma-mapping.h>
 #include <linux/msm_ion.h>
 #include <linux/of.h>
+#include <linux/workqueue.h>
 
 #include <asm/cacheflush.h>
 #include <soc/qcom/secure_buffer.h>
@@ -38,8 +39,33 @@ struct ion_cma_buffer_info {
 	dma_addr_t handle;
 	struct sg_table *table;
 	bool is_cached;
+	size_t len;
 };
 
+/**
+ * struct ion_cma_heap - CMA heap with an optional ready chunk
+ * @heap:		the ion heap
+ * @ready_lock:		protects @ready
+ * @ready:		uncached chunk allocated ahead of time, whose movable
+ *			pages have already been migrated out of the region
+ * @ready_len:		size @ready should have, 0 when no use case wants it
+ * @default_ready_len:	size used when a prefetch hint gives none, from the
+ *			"qcom,cma-ready-size" DT property
+ * @ready_work:		allocates, resizes or frees @ready to match @ready_len
+ * @lat:		allocation latency histogram
+ */
+struct ion_cma_heap {
+	struct ion_heap heap;
+	struct mutex ready_lock;
+	struct ion_cma_buffer_info *ready;
+	size_t ready_len;
+	size_t default_ready_len;
+	struct work_struct ready_work;
+	struct ion_alloc_lat lat;
+};
+
+#define to_cma_heap(x) container_of(x, struct ion_cma_heap, heap)
+
 static int cma_heap_has_outer_cache;
 /*
  * Create scatter-list for the already allocated DMA buffer.
@@ -73,23 +99,15 @@ static bool ion_cma_has_kernel_mapping(struct ion_heap *heap)
 	return !of_property_read_bool(mem_region, "no-map");
 }
 
-/* ION CMA heap operations functions */
-static int ion_cma_allocate(struct ion_heap *heap, struct ion_buffer *buffer,
-			    unsigned long len, unsigned long align,
-			    unsigned long flags)
+static struct ion_cma_buffer_info *ion_cma_alloc_info(struct device *dev,
+						      unsigned long len,
+						      unsigned long flags)
 {
-	struct device *dev = heap->priv;
 	struct ion_cma_buffer_info *info;
 
 	info = kzalloc(sizeof(struct ion_cma_buffer_info), GFP_KERNEL);
 	if (!info)
-		return ION_CMA_ALLOCATE_FAILED;
-
-	/* Override flags if cached-mappings are not supported */
-	if (!ion_cma_has_kernel_mapping(heap)) {
-		flags &= ~((unsigned long)ION_FLAG_CACHED);
-		buffer->flags = flags;
-	}
+		return NULL;
 
 	if (!ION_IS_CACHED(flags))
 		info->cpu_addr = dma_alloc_writecombine(dev, len,
@@ -110,6 +128,7 @@ static int ion_cma_allocate(struct ion_heap *heap, struct ion_buffer *buffer,
 		goto free_mem;
 
 	info->is_cached = ION_IS_CACHED(flags);
+	info->len = len;
 
 	ion_cma_get_sgtable(dev,
 			    info->table, info->cpu_addr, info->handle, len);
@@ -119,9 +138,7 @@ static int ion_cma_allocate(struct ion_heap *heap, struct ion_buffer *buffer,
 		dma_sync_sg_for_device(dev, info->table->sgl,
 				       info->table->nents, DMA_BIDIRECTIONAL);
 
-	/* keep this for memory release */
-	buffer->priv_virt = info;
-	return 0;
+	return info;
 
 free_mem:
 	if (!ION_IS_CACHED(flags))
@@ -132,25 +149,132 @@ static int ion_cma_allocate(struct ion_heap *heap, struct ion_buffer *buffer,
 
 err:
 	kfree(info);
-	return ION_CMA_ALLOCATE_FAILED;
+	return NULL;
 }
 
-static void ion_cma_free(struct ion_buffer *buffer)
+static void ion_cma_free_info(struct device *dev,
+			      struct ion_cma_buffer_info *info)
 {
-	struct device *dev = buffer->heap->priv;
-	struct ion_cma_buffer_info *info = buffer->priv_virt;
 	unsigned long attrs = 0;
 
 	/* release memory */
 	if (info->is_cached)
 		attrs |= DMA_ATTR_FORCE_COHERENT;
-	dma_free_attrs(dev, buffer->size, info->cpu_addr, info->handle, attrs);
+	dma_free_attrs(dev, info->len, info->cpu_addr, info->handle, attrs);
 	sg_free_table(info->table);
 	/* release sg table */
 	kfree(info->table);
 	kfree(info);
 }
 
+static void ion_cma_ready_work(struct work_struct *work)
+{
+	struct ion_cma_heap *cma_heap =
+		container_of(work, struct ion_cma_heap, ready_work);
+	struct device *dev = cma_heap->heap.priv;
+	size_t len = READ_ONCE(cma_heap->ready_len);
+
+	mutex_lock(&cma_heap->ready_lock);
+	if (cma_heap->ready && cma_heap->ready->len != len) {
+		ion_cma_free_info(dev, cma_heap->ready);
+		cma_heap->ready = NULL;
+	}
+	/* This is where the movable pages get migrated, off the alloc path */
+	if (!cma_heap->ready && len)
+		cma_heap->ready = ion_cma_alloc_info(dev, len, 0);
+	mutex_unlock(&cma_heap->ready_lock);
+}
+
+/*
+ * Hand out the ready chunk if the buffer is uncached and fits in it without
+ * wasting more than half of it, then ask for it to be replaced. A refill in
+ * progress holds ready_lock, in which case the buffer is allocated normally.
+ */
+static struct ion_cma_buffer_info *
+ion_cma_take_ready(struct ion_cma_heap *cma_heap, unsigned long len,
+		   unsigned long flags)
+{
+	struct ion_cma_buffer_info *info = NULL;
+
+	if (ION_IS_CACHED(flags) || !mutex_trylock(&cma_heap->ready_lock))
+		return NULL;
+
+	if (cma_heap->ready && len <= cma_heap->ready->len &&
+	    len > cma_heap->ready->len / 2) {
+		info = cma_heap->ready;
+		cma_heap->ready = NULL;
+	}
+	mutex_unlock(&cma_heap->ready_lock);
+
+	if (info) {
+		sg_set_page(info->table->sgl, sg_page(info->table->sgl),
+			    PAGE_ALIGN(len), 0);
+		schedule_work(&cma_heap->ready_work);
+	}
+
+	return info;
+}
+
+/* ION CMA heap operations functions */
+static int ion_cma_allocate(struct ion_heap *heap, struct ion_buffer *buffer,
+			    unsigned long len, unsigned long align,
+			    unsigned long flags)
+{
+	struct ion_cma_heap *cma_heap = to_cma_heap(heap);
+	struct device *dev = heap->priv;
+	struct ion_cma_buffer_info *info;
+	ktime_t start = ktime_get();
+
+	/* Override flags if cached-mappings are not supported */
+	if (!ion_cma_has_kernel_mapping(heap)) {
+		flags &= ~((unsigned long)ION_FLAG_CACHED);
+		buffer->flags = flags;
+	}
+
+	info = ion_cma_take_ready(cma_heap, len, flags);
+	if (!info)
+		info = ion_cma_alloc_info(dev, len, flags);
+	if (!info)
+		return ION_CMA_ALLOCATE_FAILED;
+
+	ion_alloc_lat_record(&cma_heap->lat, start);
+
+	/* keep this for memory release */
+	buffer->priv_virt = info;
+	return 0;
+}
+
+static void ion_cma_free(struct ion_buffer *buffer)
+{
+	ion_cma_free_info(buffer->heap->priv, buffer->priv_virt);
+}
+
+/*
+ * A use case is about to start, migrate the movable pages out of a chunk of
+ * the CMA region now so that its buffer doesn't have to wait for it.
+ */
+int ion_cma_prefetch(struct ion_heap *heap, void *data)
+{
+	struct ion_cma_heap *cma_heap = to_cma_heap(heap);
+	unsigned long len = (unsigned long)data;
+
+	if (!len)
+		len = cma_heap->default_ready_len;
+
+	WRITE_ONCE(cma_heap->ready_len, PAGE_ALIGN(len));
+	schedule_work(&cma_heap->ready_work);
+	return 0;
+}
+
+int ion_cma_drain(struct ion_heap *heap, void *unused)
+{
+	struct ion_cma_heap *cma_heap = to_cma_heap(heap);
+
+	WRITE_ONCE(cma_heap->ready_len, 0);
+	schedule_work(&cma_heap->ready_work);
+	return 0;
+}
+
 /* return physical address in addr */
 static int ion_cma_phys(struct ion_heap *heap, struct ion_buffer *buffer,
 			ion_phys_addr_t *addr, size_t *len)
@@ -211,6 +335,8 @@ static void ion_cma_unmap_kernel(struct ion_heap *heap,
 static int ion_cma_print_debug(struct ion_heap *heap, struct seq_file *s,
 			       const struct list_head *mem_map)
 {
+	struct ion_cma_heap *cma_heap = to_cma_heap(heap);
+
 	if (mem_map) {
 		struct mem_map_data *data;
 
@@ -231,9 +357,57 @@ static int ion_cma_print_debug(struct ion_heap *heap, struct seq_file *s,
 				   data->size, data->size);
 		}
 	}
+
+	mutex_lock(&cma_heap->ready_lock);
+	seq_printf(s, "\n%16s %16zu\n", "ready chunk",
+		   cma_heap->ready ? cma_heap->ready->len : 0);
+	mutex_unlock(&cma_heap->ready_lock);
+	seq_printf(s, "%16s %16zu\n", "ready wanted",
+		   READ_ONCE(cma_heap->ready_len));
+	ion_alloc_lat_show(&cma_heap->lat, s);
 	return 0;
 }
 
+static struct ion_heap *__ion_cma_heap_create(struct ion_platform_heap *data,
+					      struct ion_heap_ops *ops,
+					      enum ion_heap_type type)
+{
+	struct ion_cma_heap *cma_heap;
+	struct device *dev = data->priv;
+	u32 val;
+
+	cma_heap = kzalloc(sizeof(*cma_heap), GFP_KERNEL);
+
+	if (!cma_heap)
+		return ERR_PTR(-ENOMEM);
+
+	mutex_init(&cma_heap->ready_lock);
+	INIT_WORK(&cma_heap->ready_work, ion_cma_ready_work);
+	if (dev && !of_property_read_u32(dev->of_node, "qcom,cma-ready-size",
+					 &val))
+		cma_heap->default_ready_len = PAGE_ALIGN(val);
+
+	cma_heap->heap.ops = ops;
+	/*
+	 * set device as private heaps data, later it will be
+	 * used to make the link with reserved CMA memory
+	 */
+	cma_heap->heap.priv = data->priv;
+	cma_heap->heap.type = type;
+	cma_heap_has_outer_cache = data->has_outer_cache;
+	return &cma_heap->heap;
+}
+
+static void __ion_cma_heap_destroy(struct ion_heap *heap)
+{
+	struct ion_cma_heap *cma_heap = to_cma_heap(heap);
+
+	cancel_work_sync(&cma_heap->ready_work);
+	if (cma_heap->ready)
+		ion_cma_free_info(heap->priv, cma_heap->ready);
+	kfree(cma_heap);
+}
+
 static struct ion_heap_ops ion_cma_ops = {
 	.allocate = ion_cma_allocate,
 	.free = ion_cma_free,
@@ -248,27 +422,13 @@ static struct ion_heap_ops ion_cma_ops = {
 
 struct ion_heap *ion_cma_heap_create(struct ion_platform_heap *data)
 {
-	struct ion_heap *heap;
-
-	heap = kzalloc(sizeof(*heap), GFP_KERNEL);
-
-	if (!heap)
-		return ERR_PTR(-ENOMEM);
-
-	heap->ops = &ion_cma_ops;
-	/*
-	 * set device as private heaps data, later it will be
-	 * used to make the link with reserved CMA memory
-	 */
-	heap->priv = data->priv;
-	heap->type = (enum ion_heap_type)ION_HEAP_TYPE_DMA;
-	cma_heap_has_outer_cache = data->has_outer_cache;
-	return heap;
+	return __ion_cma_heap_create(data, &ion_cma_ops,
+				     (enum ion_heap_type)ION_HEAP_TYPE_DMA);
 }
 
 void ion_cma_heap_destroy(struct ion_heap *heap)
 {
-	kfree(heap);
+	__ion_cma_heap_destroy(heap);
 }
 
 static void ion_secure_cma_free(struct ion_buffer *buffer)
@@ -430,25 +590,11 @@ static struct ion_heap_ops ion_secure_cma_ops = {
 
 struct ion_heap *ion_cma_secure_heap_create(struct ion_platform_heap *data)
 {
-	struct ion_heap *heap;
-
-	heap = kzalloc(sizeof(*heap), GFP_KERNEL);
-
-	if (!heap)
-		return ERR_PTR(-ENOMEM);
-
-	heap->ops = &ion_secure_cma_ops;
-	/*
-	 *  set device as private heaps data, later it will be
-	 * used to make the link with reserved CMA memory
-	 */
-	heap->priv = data->priv;
-	heap->type = (enum ion_heap_type)ION_HEAP_TYPE_HYP_CMA;
-	cma_heap_has_outer_cache = data->has_outer_cache;
-	return heap;
+	return __ion_cma_heap_create(data, &ion_secure_cma_ops,
+				     (enum ion_heap_type)ION_HEAP_TYPE_HYP_CMA);
 }
 
 void ion_cma_secure_heap_destroy(struct ion_heap *heap)
 {
-	kfree(heap);
+	__ion_cma_heap_destroy(heap);
 }
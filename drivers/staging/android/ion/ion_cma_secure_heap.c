@@ -100,6 +100,7 @@ struct ion_cma_secure_heap {
 	atomic_t total_leaked;
 	unsigned long heap_size;
 	unsigned long default_prefetch_size;
+	struct ion_alloc_lat lat;
 };
 
 static void ion_secure_pool_pages(struct work_struct *work);
@@ -674,6 +675,7 @@ static int ion_secure_cma_allocate(struct ion_heap *heap,
 	unsigned long allow_non_contig = flags & ION_FLAG_ALLOW_NON_CONTIG;
 	struct ion_cma_secure_heap *sheap =
 			container_of(heap, struct ion_cma_secure_heap, heap);
+	ktime_t start = ktime_get();
 
 	if (!secure_allocation &&
 	    !ion_heap_allow_secure_allocation(heap->type)) {
@@ -704,6 +706,8 @@ static int ion_secure_cma_allocate(struct ion_heap *heap,
 		buf = __ion_secure_cma_allocate_non_contig(heap, buffer, len,
 							   align, flags);
 	trace_ion_secure_cma_allocate_end(heap->name, len, align, flags);
+	if (buf)
+		ion_alloc_lat_record(&sheap->lat, start);
 	if (buf) {
 		int ret;
 
@@ -840,6 +844,7 @@ static int ion_secure_cma_print_debug(struct ion_heap *heap, struct seq_file *s,
 		   atomic_read(&sheap->total_pool_size));
 	seq_printf(s, "Total memory leaked due to unlock failures: 0x%x\n",
 		   atomic_read(&sheap->total_leaked));
+	ion_alloc_lat_show(&sheap->lat, s);
 
 	return 0;
 }
@@ -18,6 +18,8 @@
 #include <linux/err.h>
 #include <linux/freezer.h>
 #include <linux/kthread.h>
+#include <linux/math64.h>
+#include <linux/module.h>
 #include <linux/mm.h>
 #include <linux/rtmutex.h>
 #include <linux/sched.h>
@@ -164,24 +166,96 @@ int ion_heap_pages_zero(struct page *page, size_t size, pgprot_t pgprot)
 	return ion_heap_sglist_zero(&sg, 1, pgprot);
 }
 
+/*
+ * The deferred free thread frees queued buffers in batches of this many,
+ * rescheduling between batches.
+ */
+static unsigned int defer_free_batch = 16;
+module_param(defer_free_batch, uint, 0644);
+
+/*
+ * Buffers are freed directly instead of being queued when the system has
+ * less free memory than this, so their pages return to the pools at once.
+ */
+static unsigned int defer_free_min_free_kb = 32768;
+module_param(defer_free_min_free_kb, uint, 0644);
+
+/* How long deferred free is bypassed after an allocation had to drain */
+#define ION_HEAP_FREE_PRESSURE_MS	100
+
+static bool ion_heap_free_bypass(struct ion_heap *heap)
+{
+	unsigned long min_free = defer_free_min_free_kb >> (PAGE_SHIFT - 10);
+
+	if (time_before(jiffies, READ_ONCE(heap->free_pressure)))
+		return true;
+
+	return global_page_state(NR_FREE_PAGES) < min_free;
+}
+
+void ion_heap_freelist_pressure(struct ion_heap *heap)
+{
+	WRITE_ONCE(heap->free_pressure,
+		jiffies + msecs_to_jiffies(ION_HEAP_FREE_PRESSURE_MS));
+}
+
 void ion_heap_freelist_add(struct ion_heap *heap, struct ion_buffer *buffer)
 {
-	spin_lock(&heap->free_lock);
-	list_add(&buffer->list, &heap->free_list);
-	heap->free_list_size += buffer->size;
-	spin_unlock(&heap->free_lock);
-	wake_up(&heap->waitqueue);
+	unsigned int count;
+
+	if (ion_heap_free_bypass(heap)) {
+		spin_lock(&heap->free_lock);
+		heap->free_stats.bypassed++;
+		spin_unlock(&heap->free_lock);
+		ion_buffer_destroy(buffer);
+		return;
+	}
+
+	buffer->free_time = ktime_get();
+	atomic_long_add(buffer->size, &heap->free_list_size);
+	count = atomic_inc_return(&heap->free_list_count);
+	if (count > READ_ONCE(heap->free_stats.max_count))
+		WRITE_ONCE(heap->free_stats.max_count, count);
+
+	/* Only an empty queue can have a sleeping drain thread */
+	if (llist_add(&buffer->free_node, &heap->free_llist))
+		wake_up(&heap->waitqueue);
 }
 
 size_t ion_heap_freelist_size(struct ion_heap *heap)
 {
-	size_t size;
+	return atomic_long_read(&heap->free_list_size);
+}
 
-	spin_lock(&heap->free_lock);
-	size = heap->free_list_size;
-	spin_unlock(&heap->free_lock);
+/*
+ * Move everything queued on the lockless list over to the free list, oldest
+ * first. Must be called with free_lock held.
+ */
+static void ion_heap_freelist_collect(struct ion_heap *heap)
+{
+	struct llist_node *node = llist_del_all(&heap->free_llist);
+	struct ion_buffer *buffer, *tmp;
 
-	return size;
+	node = llist_reverse_order(node);
+	llist_for_each_entry_safe(buffer, tmp, node, free_node)
+		list_add_tail(&buffer->list, &heap->free_list);
+}
+
+/* Take a buffer off the free list. Must be called with free_lock held. */
+static void ion_heap_freelist_del(struct ion_heap *heap,
+				struct ion_buffer *buffer)
+{
+	struct ion_heap_free_stats *stats = &heap->free_stats;
+	u64 lat = max_t(s64, ktime_us_delta(ktime_get(), buffer->free_time), 0);
+
+	list_del(&buffer->list);
+	atomic_long_sub(buffer->size, &heap->free_list_size);
+	atomic_dec(&heap->free_list_count);
+
+	stats->drained++;
+	stats->total_lat_us += lat;
+	if (lat > stats->max_lat_us)
+		stats->max_lat_us = lat;
 }
 
 static size_t _ion_heap_freelist_drain(struct ion_heap *heap, size_t size,
@@ -194,16 +268,16 @@ static size_t _ion_heap_freelist_drain(struct ion_heap *heap, size_t size,
 		return 0;
 
 	spin_lock(&heap->free_lock);
+	ion_heap_freelist_collect(heap);
 	if (size == 0)
-		size = heap->free_list_size;
+		size = ion_heap_freelist_size(heap);
 
 	while (!list_empty(&heap->free_list)) {
 		if (total_drained >= size)
 			break;
 		buffer = list_first_entry(&heap->free_list, struct ion_buffer,
 					  list);
-		list_del(&buffer->list);
-		heap->free_list_size -= buffer->size;
+		ion_heap_freelist_del(heap, buffer);
 		if (skip_pools)
 			buffer->private_flags |= ION_PRIV_FLAG_SHRINKER_FREE;
 		total_drained += buffer->size;
@@ -231,22 +305,30 @@ static int ion_heap_deferred_free(void *data)
 	struct ion_heap *heap = data;
 
 	while (true) {
-		struct ion_buffer *buffer;
+		struct ion_buffer *buffer, *tmp;
+		unsigned int batch = max(READ_ONCE(defer_free_batch), 1U);
+		unsigned int i;
+		LIST_HEAD(batch_list);
 
 		wait_event_freezable(heap->waitqueue,
 				     ion_heap_freelist_size(heap) > 0);
 
 		spin_lock(&heap->free_lock);
-		if (list_empty(&heap->free_list)) {
-			spin_unlock(&heap->free_lock);
-			continue;
+		ion_heap_freelist_collect(heap);
+		for (i = 0; i < batch && !list_empty(&heap->free_list); i++) {
+			buffer = list_first_entry(&heap->free_list,
+						  struct ion_buffer, list);
+			ion_heap_freelist_del(heap, buffer);
+			list_add_tail(&buffer->list, &batch_list);
 		}
-		buffer = list_first_entry(&heap->free_list, struct ion_buffer,
-					  list);
-		list_del(&buffer->list);
-		heap->free_list_size -= buffer->size;
+		if (i)
+			heap->free_stats.batches++;
 		spin_unlock(&heap->free_lock);
-		ion_buffer_destroy(buffer);
+
+		list_for_each_entry_safe(buffer, tmp, &batch_list, list)
+			ion_buffer_destroy(buffer);
+
+		cond_resched();
 	}
 
 	return 0;
@@ -256,7 +338,10 @@ int ion_heap_init_deferred_free(struct ion_heap *heap)
 {
 	struct sched_param param = { .sched_priority = 0 };
 
+	init_llist_head(&heap->free_llist);
 	INIT_LIST_HEAD(&heap->free_list);
+	atomic_set(&heap->free_list_count, 0);
+	heap->free_pressure = jiffies;
 	init_waitqueue_head(&heap->waitqueue);
 	heap->task = kthread_run(ion_heap_deferred_free, heap,
 				 "%s", heap->name);
@@ -269,6 +354,65 @@ int ion_heap_init_deferred_free(struct ion_heap *heap)
 	return 0;
 }
 
+void ion_heap_freelist_debug_show(struct ion_heap *heap, struct seq_file *s)
+{
+	struct ion_heap_free_stats stats;
+
+	spin_lock(&heap->free_lock);
+	stats = heap->free_stats;
+	spin_unlock(&heap->free_lock);
+
+	seq_printf(s, "%16s %16zu\n", "deferred free",
+		   ion_heap_freelist_size(heap));
+	seq_printf(s, "%16s %16d\n", "free queue",
+		   atomic_read(&heap->free_list_count));
+	seq_printf(s, "%16s %16u\n", "free queue max", stats.max_count);
+	seq_printf(s, "%16s %16llu\n", "free drained", stats.drained);
+	seq_printf(s, "%16s %16llu\n", "free bypassed", stats.bypassed);
+	seq_printf(s, "%16s %16llu\n", "free batches", stats.batches);
+	seq_printf(s, "%16s %16llu\n", "free lat avg us",
+		   stats.drained ?
+		   div64_u64(stats.total_lat_us, stats.drained) : 0);
+	seq_printf(s, "%16s %16llu\n", "free lat max us", stats.max_lat_us);
+}
+
+void ion_alloc_lat_record(struct ion_alloc_lat *lat, ktime_t start)
+{
+	u64 us = ktime_us_delta(ktime_get(), start);
+	u64 max = atomic64_read(&lat->max_us);
+	unsigned int i = 0;
+
+	while (i < ION_ALLOC_LAT_BUCKETS - 1 && us >= (USEC_PER_MSEC << i))
+		i++;
+	atomic_inc(&lat->buckets[i]);
+
+	while (us > max) {
+		u64 old = atomic64_cmpxchg(&lat->max_us, max, us);
+
+		if (old == max)
+			break;
+		max = old;
+	}
+}
+
+void ion_alloc_lat_show(struct ion_alloc_lat *lat, struct seq_file *s)
+{
+	char label[16];
+	int i;
+
+	for (i = 0; i < ION_ALLOC_LAT_BUCKETS; i++) {
+		if (i < ION_ALLOC_LAT_BUCKETS - 1)
+			snprintf(label, sizeof(label), "alloc < %ums", 1U << i);
+		else
+			snprintf(label, sizeof(label), "alloc >= %ums",
+				 1U << (i - 1));
+		seq_printf(s, "%16s %16d\n", label,
+			   atomic_read(&lat->buckets[i]));
+	}
+	seq_printf(s, "%16s %16llu\n", "alloc max us",
+		   (u64)atomic64_read(&lat->max_us));
+}
+
 static unsigned long ion_heap_shrink_count(struct shrinker *shrinker,
 						struct shrink_control *sc)
 {
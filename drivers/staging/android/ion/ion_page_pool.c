@@ -24,6 +24,8 @@
 #include <linux/slab.h>
 #include <linux/swap.h>
 #include <linux/vmalloc.h>
+#include <linux/ktime.h>
+#include <soc/qcom/mem_pool.h>
 #include "ion_priv.h"
 
 static void *ion_page_pool_alloc_pages(struct ion_page_pool *pool)
@@ -57,6 +59,11 @@ static void ion_page_pool_free_pages(struct ion_page_pool *pool,
 
 static int ion_page_pool_add(struct ion_page_pool *pool, struct page *page)
 {
+	if (pool->shared) {
+		mem_pool_free(pool->shared, page, pool->order);
+		return 0;
+	}
+
 	mutex_lock(&pool->mutex);
 	if (PageHighMem(page)) {
 		list_add_tail(&page->lru, &pool->high_items);
@@ -100,7 +107,9 @@ void *ion_page_pool_alloc(struct ion_page_pool *pool, bool *from_pool)
 
 	*from_pool = true;
 
-	if (mutex_trylock(&pool->mutex)) {
+	if (pool->shared) {
+		page = mem_pool_alloc(pool->shared, pool->order);
+	} else if (mutex_trylock(&pool->mutex)) {
 		if (pool->high_count)
 			page = ion_page_pool_remove(pool, true);
 		else if (pool->low_count)
@@ -108,6 +117,8 @@ void *ion_page_pool_alloc(struct ion_page_pool *pool, bool *from_pool)
 		mutex_unlock(&pool->mutex);
 	}
 	if (!page) {
+		if (pool->watermark)
+			atomic_inc(&pool->watermark_miss);
 		page = ion_page_pool_alloc_pages(pool);
 		*from_pool = false;
 	}
@@ -117,6 +128,26 @@ void *ion_page_pool_alloc(struct ion_page_pool *pool, bool *from_pool)
 /*
  * Tries to allocate from only the specified Pool and returns NULL otherwise
  */
+/**
+ * ion_page_pool_set_shared - back the pool with the shared page pool
+ * @pool:		the pool, must be empty
+ * @client:		shared pool client the pages are accounted to
+ *
+ * The shared pool requires compound pages, so the pool allocates them from
+ * now on. Does nothing when the shared pool is not available.
+ */
+void ion_page_pool_set_shared(struct ion_page_pool *pool,
+			      struct mem_pool_client *client)
+{
+	if (!client)
+		return;
+
+	WARN_ON(pool->high_count || pool->low_count);
+	if (pool->order)
+		pool->gfp_mask |= __GFP_COMP;
+	pool->shared = client;
+}
+
 void *ion_page_pool_alloc_pool_only(struct ion_page_pool *pool)
 {
 	struct page *page = NULL;
@@ -124,6 +155,9 @@ void *ion_page_pool_alloc_pool_only(struct ion_page_pool *pool)
 	if (!pool)
 		return NULL;
 
+	if (pool->shared)
+		return mem_pool_alloc(pool->shared, pool->order);
+
 	if (mutex_trylock(&pool->mutex)) {
 		if (pool->high_count)
 			page = ion_page_pool_remove(pool, true);
@@ -159,12 +193,88 @@ int ion_page_pool_total(struct ion_page_pool *pool, bool high)
 	return count << pool->order;
 }
 
+/*
+ * Since no lock is held, the result is only a hint for waking up the
+ * background refill.
+ */
+bool ion_page_pool_below_watermark(struct ion_page_pool *pool)
+{
+	int count;
+
+	if (!pool->watermark)
+		return false;
+
+	if (pool->shared)
+		count = mem_pool_count(pool->order);
+	else
+		count = READ_ONCE(pool->high_count) + READ_ONCE(pool->low_count);
+
+	return count < pool->watermark;
+}
+
+/**
+ * ion_page_pool_refill - top up the pool to its watermark
+ * @pool:		the pool
+ * @abort:		called before each allocation, stops the refill when
+ *			it returns true
+ * @data:		argument passed to @abort
+ *
+ * Pages added here are zeroed and flushed just like pages returned to the
+ * pool on free, so they can be handed out without further maintenance.
+ * The allocations never enter direct reclaim.
+ *
+ * returns the number of pages added
+ */
+int ion_page_pool_refill(struct ion_page_pool *pool, bool (*abort)(void *),
+			 void *data)
+{
+	gfp_t gfp_mask = (pool->gfp_mask | __GFP_NORETRY | __GFP_NOWARN) &
+			 ~(__GFP_ZERO | __GFP_RECLAIM);
+	ktime_t start = ktime_get();
+	int added = 0;
+	u64 elapsed;
+
+	while (ion_page_pool_below_watermark(pool)) {
+		struct page *page;
+
+		if (abort && abort(data))
+			break;
+
+		page = alloc_pages(gfp_mask, pool->order);
+		if (!page)
+			break;
+
+		if (msm_ion_heap_high_order_page_zero(pool->dev, page,
+						      pool->order)) {
+			__free_pages(page, pool->order);
+			break;
+		}
+
+		ion_page_pool_alloc_set_cache_policy(pool, page);
+		ion_page_pool_add(pool, page);
+		added += 1 << pool->order;
+	}
+
+	if (added) {
+		elapsed = ktime_us_delta(ktime_get(), start);
+		pool->refill_last_us = elapsed;
+		if (elapsed > pool->refill_max_us)
+			pool->refill_max_us = elapsed;
+	}
+
+	return added;
+}
+
 int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
 				int nr_to_scan)
 {
 	int freed = 0;
 	bool high;
 
+	/* The shared pool has its own shrinker */
+	if (pool->shared)
+		return 0;
+
 	if (current_is_kswapd())
 		high = true;
 	else
@@ -207,6 +317,11 @@ struct ion_page_pool *ion_page_pool_create(struct device *dev, gfp_t gfp_mask,
 	INIT_LIST_HEAD(&pool->high_items);
 	pool->gfp_mask = gfp_mask;
 	pool->order = order;
+	pool->watermark = 0;
+	atomic_set(&pool->watermark_miss, 0);
+	pool->refill_last_us = 0;
+	pool->refill_max_us = 0;
+	pool->shared = NULL;
 	mutex_init(&pool->mutex);
 	plist_node_init(&pool->list, order);
 
@@ -21,6 +21,8 @@
 #include <linux/device.h>
 #include <linux/dma-direction.h>
 #include <linux/kref.h>
+#include <linux/ktime.h>
+#include <linux/llist.h>
 #include <linux/mm_types.h>
 #include <linux/mutex.h>
 #include <linux/rbtree.h>
@@ -85,12 +87,15 @@ struct mem_map_data {
  *			handle, used for debugging
  * @pid:		pid of last client to reference this buffer in a
  *			handle, used for debugging
+ * @mm:			mm of the allocating process, charged with the size
+ *			of the buffer until it is freed
 */
 struct ion_buffer {
 	struct kref ref;
 	union {
 		struct rb_node node;
 		struct list_head list;
+		struct llist_node free_node;
 	};
 	struct ion_device *dev;
 	struct ion_heap *heap;
@@ -111,6 +116,9 @@ struct ion_buffer {
 	int handle_count;
 	char task_comm[TASK_COMM_LEN];
 	pid_t pid;
+	/* time the buffer was queued for deferred free */
+	ktime_t free_time;
+	struct mm_struct *mm;
 };
 void ion_buffer_destroy(struct ion_buffer *buffer);
 
@@ -174,6 +182,37 @@ struct ion_heap_ops {
  */
 #define ION_PRIV_FLAG_SHRINKER_FREE (1 << 0)
 
+/**
+ * struct ion_heap_free_stats - deferred free statistics for a heap
+ * @max_count:		high watermark of the deferred free queue depth
+ * @drained:		number of buffers freed from the deferred free queue
+ * @bypassed:		number of buffers freed directly under memory pressure
+ * @batches:		number of batches drained by the deferred free thread
+ * @total_lat_us:	sum of queue to free latencies of drained buffers
+ * @max_lat_us:		longest queue to free latency seen
+ */
+struct ion_heap_free_stats {
+	unsigned int max_count;
+	u64 drained;
+	u64 bypassed;
+	u64 batches;
+	u64 total_lat_us;
+	u64 max_lat_us;
+};
+
+/* Bucket i counts allocations under 2^i ms, the last one the rest */
+#define ION_ALLOC_LAT_BUCKETS	11
+
+/**
+ * struct ion_alloc_lat - allocation latency histogram
+ * @buckets:		allocation counts, on a log2 scale of milliseconds
+ * @max_us:		longest allocation seen
+ */
+struct ion_alloc_lat {
+	atomic_t buckets[ION_ALLOC_LAT_BUCKETS];
+	atomic64_t max_us;
+};
+
 /**
  * struct ion_heap - represents a heap in the system
  * @node:		rb node to put the heap on the device's tree of heaps
@@ -187,9 +226,13 @@ struct ion_heap_ops {
  * @name:		used for debugging
  * @shrinker:		a shrinker for the heap
  * @priv:		private heap data
- * @free_list:		free list head if deferred free is used
- * @free_list_size	size of the deferred free list in bytes
- * @lock:		protects the free list
+ * @free_llist:	lockless list buffers are queued on for deferred free
+ * @free_list:		buffers pulled off @free_llist waiting to be drained
+ * @free_list_size	size of the deferred free queue in bytes
+ * @free_list_count	number of buffers on the deferred free queue
+ * @free_pressure:	jiffies until which deferred free is bypassed
+ * @free_stats:		deferred free statistics
+ * @lock:		protects @free_list and @free_stats
  * @waitqueue:		queue to wait on from deferred free thread
  * @task:		task struct of deferred free thread
  * @debug_show:		called when heap debug file is read to add any
@@ -210,8 +253,12 @@ struct ion_heap {
 	const char *name;
 	struct shrinker shrinker;
 	void *priv;
+	struct llist_head free_llist;
 	struct list_head free_list;
-	size_t free_list_size;
+	atomic_long_t free_list_size;
+	atomic_t free_list_count;
+	unsigned long free_pressure;
+	struct ion_heap_free_stats free_stats;
 	spinlock_t free_lock;
 	wait_queue_head_t waitqueue;
 	struct task_struct *task;
@@ -388,6 +435,37 @@ size_t ion_heap_freelist_drain_from_shrinker(struct ion_heap *heap,
  */
 size_t ion_heap_freelist_size(struct ion_heap *heap);
 
+/**
+ * ion_heap_freelist_pressure - note allocation pressure on a heap
+ * @heap:		the heap
+ *
+ * Called when an allocation from a deferred free heap had to fall back to
+ * draining the free list. For a short while afterwards buffers are freed
+ * directly instead of being queued so their memory can be reused at once.
+ */
+void ion_heap_freelist_pressure(struct ion_heap *heap);
+
+/**
+ * ion_heap_freelist_debug_show - print deferred free queue statistics
+ * @heap:		the heap
+ * @s:			seq_file to print to
+ */
+void ion_heap_freelist_debug_show(struct ion_heap *heap, struct seq_file *s);
+
+/**
+ * ion_alloc_lat_record - add an allocation to a latency histogram
+ * @lat:		the histogram
+ * @start:		when the allocation started
+ */
+void ion_alloc_lat_record(struct ion_alloc_lat *lat, ktime_t start);
+
+/**
+ * ion_alloc_lat_show - print a latency histogram
+ * @lat:		the histogram
+ * @s:			seq_file to print to
+ */
+void ion_alloc_lat_show(struct ion_alloc_lat *lat, struct seq_file *s);
+
 
 /**
  * functions for creating and destroying the built in ion heaps.
@@ -448,6 +526,8 @@ void ion_carveout_free(struct ion_heap *heap, ion_phys_addr_t addr,
  * many systems
  */
 
+struct mem_pool_client;
+
 /**
  * struct ion_page_pool - pagepool struct
  * @high_count:		number of highmem items in the pool
@@ -459,6 +539,14 @@ void ion_carveout_free(struct ion_heap *heap, ion_phys_addr_t addr,
  * @gfp_mask:		gfp_mask to use from alloc
  * @order:		order of pages in the pool
  * @list:		plist node for list of pools
+ * @watermark:		number of items the background refill keeps in the
+ *			pool, 0 disables refilling
+ * @watermark_miss:	allocations that found the pool empty although a
+ *			watermark is configured
+ * @refill_last_us:	duration of the last background refill
+ * @refill_max_us:	longest background refill seen so far
+ * @shared:		client of the shared page pool backing this pool, the
+ *			local lists and counts are unused when set
  *
  * Allows you to keep a pool of pre allocated pages to use from your heap.
  * Keeping a pool of pages that is ready for dma, ie any cached mapping have
@@ -475,6 +563,11 @@ struct ion_page_pool {
 	gfp_t gfp_mask;
 	unsigned int order;
 	struct plist_node list;
+	unsigned int watermark;
+	atomic_t watermark_miss;
+	u64 refill_last_us;
+	u64 refill_max_us;
+	struct mem_pool_client *shared;
 };
 
 struct ion_page_pool *ion_page_pool_create(struct device *dev, gfp_t gfp_mask,
@@ -485,6 +578,11 @@ void *ion_page_pool_alloc_pool_only(struct ion_page_pool *a);
 void ion_page_pool_free(struct ion_page_pool *a, struct page *b);
 void ion_page_pool_free_immediate(struct ion_page_pool *, struct page *);
 int ion_page_pool_total(struct ion_page_pool *pool, bool high);
+bool ion_page_pool_below_watermark(struct ion_page_pool *pool);
+void ion_page_pool_set_shared(struct ion_page_pool *pool,
+			      struct mem_pool_client *client);
+int ion_page_pool_refill(struct ion_page_pool *pool, bool (*abort)(void *),
+			 void *data);
 size_t ion_system_heap_secure_page_pool_total(struct ion_heap *heap, int vmid);
 
 #ifdef CONFIG_ION_POOL_CACHE_POLICY
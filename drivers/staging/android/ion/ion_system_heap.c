@@ -19,7 +19,11 @@
 #include <linux/dma-mapping.h>
 #include <linux/err.h>
 #include <linux/highmem.h>
+#include <linux/freezer.h>
+#include <linux/kthread.h>
 #include <linux/mm.h>
+#include <linux/moduleparam.h>
+#include <linux/sizes.h>
 #include <linux/msm_ion.h>
 #include <linux/scatterlist.h>
 #include <linux/seq_file.h>
@@ -30,6 +34,7 @@
 #include <linux/dma-mapping.h>
 #include <trace/events/kmem.h>
 #include <soc/qcom/secure_buffer.h>
+#include <soc/qcom/mem_pool.h>
 
 static gfp_t high_order_gfp_flags = (GFP_HIGHUSER | __GFP_NOWARN |
 				     __GFP_NORETRY) & ~__GFP_RECLAIM;
@@ -46,6 +51,14 @@ static const unsigned int orders[] = {0};
 #endif
 
 static const int num_orders = ARRAY_SIZE(orders);
+
+/*
+ * Amount of memory, per order, that the background refill keeps in each of
+ * the uncached and cached pools. 0 disables the background refill.
+ */
+static unsigned int pool_refill_kb;
+module_param(pool_refill_kb, uint, 0644);
+
 static int order_to_index(unsigned int order)
 {
 	int i;
@@ -68,6 +81,11 @@ struct ion_system_heap {
 	struct ion_page_pool **secure_pools[VMID_LAST];
 	/* Prevents unnecessary page splitting */
 	struct mutex split_page_mutex;
+	struct task_struct *refill_task;
+	wait_queue_head_t refill_wq;
+	atomic_t refill_pending;
+	unsigned long refill_backoff;
+	struct mem_pool_client *shared;
 };
 
 struct page_info {
@@ -107,6 +125,24 @@ static int ion_heap_is_system_heap_type(enum ion_heap_type type)
 	return type == ((enum ion_heap_type)ION_HEAP_TYPE_SYSTEM);
 }
 
+static void ion_system_heap_kick_refill(struct ion_system_heap *heap,
+					struct ion_page_pool *pool)
+{
+	unsigned int watermark;
+
+	if (!heap->refill_task)
+		return;
+
+	watermark = ((unsigned long)pool_refill_kb * SZ_1K) >>
+			(PAGE_SHIFT + pool->order);
+	if (pool->watermark != watermark)
+		WRITE_ONCE(pool->watermark, watermark);
+
+	if (ion_page_pool_below_watermark(pool) &&
+	    !atomic_xchg(&heap->refill_pending, 1))
+		wake_up(&heap->refill_wq);
+}
+
 static struct page *alloc_buffer_page(struct ion_system_heap *heap,
 				      struct ion_buffer *buffer,
 				      unsigned long order,
@@ -127,6 +163,8 @@ static struct page *alloc_buffer_page(struct ion_system_heap *heap,
 			pool = heap->cached_pools[order_to_index(order)];
 
 		page = ion_page_pool_alloc(pool, from_pool);
+		if (vmid <= 0)
+			ion_system_heap_kick_refill(heap, pool);
 	} else {
 		gfp_t gfp_mask = low_order_gfp_flags;
 
@@ -629,6 +667,9 @@ static int ion_system_heap_shrink(struct ion_heap *heap, gfp_t gfp_mask,
 
 	if (!nr_to_scan)
 		only_scan = 1;
+	else
+		/* Memory is getting tight, stop refilling the pools for now */
+		WRITE_ONCE(sys_heap->refill_backoff, jiffies + HZ);
 
 	for (i = 0; i < num_orders; i++) {
 		nr_freed = 0;
@@ -657,6 +698,60 @@ static int ion_system_heap_shrink(struct ion_heap *heap, gfp_t gfp_mask,
 	return nr_total;
 }
 
+static bool ion_system_heap_refill_abort(void *data)
+{
+	struct ion_system_heap *sys_heap = data;
+
+	return kthread_should_stop() ||
+		time_before(jiffies, READ_ONCE(sys_heap->refill_backoff));
+}
+
+static int ion_system_heap_refill(void *data)
+{
+	struct ion_system_heap *sys_heap = data;
+	int i;
+
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(sys_heap->refill_wq,
+				     atomic_read(&sys_heap->refill_pending) ||
+				     kthread_should_stop());
+
+		atomic_set(&sys_heap->refill_pending, 0);
+
+		for (i = 0; i < num_orders; i++) {
+			ion_page_pool_refill(sys_heap->uncached_pools[i],
+					     ion_system_heap_refill_abort,
+					     sys_heap);
+			ion_page_pool_refill(sys_heap->cached_pools[i],
+					     ion_system_heap_refill_abort,
+					     sys_heap);
+		}
+	}
+
+	return 0;
+}
+
+static void ion_system_heap_init_refill(struct ion_system_heap *sys_heap)
+{
+	struct sched_param param = { .sched_priority = 0 };
+
+	init_waitqueue_head(&sys_heap->refill_wq);
+	atomic_set(&sys_heap->refill_pending, 0);
+	sys_heap->refill_backoff = jiffies;
+
+	sys_heap->refill_task = kthread_run(ion_system_heap_refill, sys_heap,
+					    "ion_pool_refill");
+	if (IS_ERR(sys_heap->refill_task)) {
+		pr_err("%s: creating thread for pool refill failed\n",
+		       __func__);
+		sys_heap->refill_task = NULL;
+		return;
+	}
+	sched_setscheduler(sys_heap->refill_task, SCHED_IDLE, &param);
+}
+
 static struct ion_heap_ops system_heap_ops = {
 	.allocate = ion_system_heap_allocate,
 	.free = ion_system_heap_free,
@@ -750,6 +845,25 @@ static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 	}
 
 	if (use_seq) {
+		seq_printf(s, "pool refill watermark = %u KB per pool\n",
+			   pool_refill_kb);
+		if (sys_heap->shared)
+			seq_puts(s,
+				 "uncached and cached pools use the shared page pool\n");
+		for (i = 0; i < num_orders; i++) {
+			pool = sys_heap->uncached_pools[i];
+			seq_printf(s,
+				   "order %u uncached pool: watermark misses %d last refill %llu us max refill %llu us\n",
+				   pool->order,
+				   atomic_read(&pool->watermark_miss),
+				   pool->refill_last_us, pool->refill_max_us);
+			pool = sys_heap->cached_pools[i];
+			seq_printf(s,
+				   "order %u cached pool: watermark misses %d last refill %llu us max refill %llu us\n",
+				   pool->order,
+				   atomic_read(&pool->watermark_miss),
+				   pool->refill_last_us, pool->refill_max_us);
+		}
 		seq_puts(s, "--------------------------------------------\n");
 		seq_printf(s, "uncached pool = %lu cached pool = %lu secure pool = %lu\n",
 			   uncached_total, cached_total, secure_total);
@@ -845,8 +959,24 @@ struct ion_heap *ion_system_heap_create(struct ion_platform_heap *data)
 	if (ion_system_heap_create_pools(dev, heap->cached_pools))
 		goto err_create_cached_pools;
 
+#ifndef CONFIG_ION_POOL_CACHE_POLICY
+	/*
+	 * Uncached and cached pool pages are both zeroed and clean, so they
+	 * can live in the page pool shared with other subsystems. Pages of
+	 * the uncached pools have a different kernel mapping attribute with
+	 * CONFIG_ION_POOL_CACHE_POLICY and can't be shared.
+	 */
+	heap->shared = mem_pool_client_register("ion_system");
+	for (i = 0; i < num_orders; i++) {
+		ion_page_pool_set_shared(heap->uncached_pools[i], heap->shared);
+		ion_page_pool_set_shared(heap->cached_pools[i], heap->shared);
+	}
+#endif
+
 	mutex_init(&heap->split_page_mutex);
 
+	ion_system_heap_init_refill(heap);
+
 	heap->heap.debug_show = ion_system_heap_debug_show;
 	return &heap->heap;
 
@@ -875,6 +1005,9 @@ void ion_system_heap_destroy(struct ion_heap *heap)
 							heap);
 	int i, j;
 
+	if (sys_heap->refill_task)
+		kthread_stop(sys_heap->refill_task);
+
 	for (i = 0; i < VMID_LAST; i++) {
 		if (!is_secure_vmid_valid(i))
 			continue;
@@ -885,6 +1018,7 @@ void ion_system_heap_destroy(struct ion_heap *heap)
 	}
 	ion_system_heap_destroy_pools(sys_heap->uncached_pools);
 	ion_system_heap_destroy_pools(sys_heap->cached_pools);
+	mem_pool_client_unregister(sys_heap->shared);
 	kfree(sys_heap->uncached_pools);
 	kfree(sys_heap->cached_pools);
 	kfree(sys_heap);
@@ -13,6 +13,7 @@
  *
  */
 
+#include <linux/completion.h>
 #include <linux/slab.h>
 #include <linux/msm_ion.h>
 #include <soc/qcom/secure_buffer.h>
@@ -134,41 +135,112 @@ static int ion_system_secure_heap_allocate(
 	return ret;
 }
 
-static void process_one_prefetch(struct ion_heap *sys_heap,
-				 struct prefetch_info *info)
+/*
+ * Prefetch buffers for one VMID, assigned with a single hyp_assign_tables()
+ * call. While the hypervisor works on one batch the worker already fills
+ * the next one.
+ */
+#define PREFETCH_BATCH_MAX	16
+
+struct prefetch_batch {
+	struct ion_heap *sys_heap;
+	int vmid;
+	int nr;
+	struct ion_buffer buffers[PREFETCH_BATCH_MAX];
+	struct sg_table *tables[PREFETCH_BATCH_MAX];
+
+	u32 source_vmid;
+	int dest_vmid;
+	int dest_perms;
+	struct hyp_assign_req req;
+	struct completion done;
+	int ret;
+};
+
+static int prefetch_batch_add(struct prefetch_batch *batch,
+			      struct prefetch_info *info)
 {
-	struct ion_buffer buffer;
+	struct ion_heap *sys_heap = batch->sys_heap;
+	struct ion_buffer *buffer = &batch->buffers[batch->nr];
 	struct sg_table *sg_table;
 	int ret;
 
-	buffer.heap = sys_heap;
-	buffer.flags = 0;
+	buffer->heap = sys_heap;
+	buffer->flags = 0;
 
-	ret = sys_heap->ops->allocate(sys_heap, &buffer, info->size,
-						PAGE_SIZE, buffer.flags);
+	ret = sys_heap->ops->allocate(sys_heap, buffer, info->size,
+						PAGE_SIZE, buffer->flags);
 	if (ret) {
 		pr_debug("%s: Failed to prefetch 0x%zx, ret = %d\n",
 			 __func__, info->size, ret);
-		return;
+		return ret;
 	}
 
-	sg_table = sys_heap->ops->map_dma(sys_heap, &buffer);
-	if (IS_ERR_OR_NULL(sg_table))
-		goto out;
+	sg_table = sys_heap->ops->map_dma(sys_heap, buffer);
+	if (IS_ERR_OR_NULL(sg_table)) {
+		sys_heap->ops->free(buffer);
+		return -ENOMEM;
+	}
 
-	ret = ion_system_secure_heap_assign_sg(sg_table,
-					       get_secure_vmid(info->vmid));
-	if (ret)
-		goto unmap;
+	batch->tables[batch->nr++] = sg_table;
+	return 0;
+}
 
-	/* Now free it to the secure heap */
-	buffer.heap = sys_heap;
-	buffer.flags = info->vmid;
+static void prefetch_batch_assigned(struct hyp_assign_req *req, int ret)
+{
+	struct prefetch_batch *batch = container_of(req, struct prefetch_batch,
+						    req);
 
-unmap:
-	sys_heap->ops->unmap_dma(sys_heap, &buffer);
-out:
-	sys_heap->ops->free(&buffer);
+	batch->ret = ret;
+	complete(&batch->done);
+}
+
+static void prefetch_batch_submit(struct prefetch_batch *batch)
+{
+	batch->source_vmid = VMID_HLOS;
+	batch->dest_vmid = get_secure_vmid(batch->vmid);
+	batch->dest_perms = PERM_READ | PERM_WRITE;
+
+	batch->req.tables = batch->tables;
+	batch->req.ntables = batch->nr;
+	batch->req.source_vm_list = &batch->source_vmid;
+	batch->req.source_nelems = 1;
+	batch->req.dest_vmids = &batch->dest_vmid;
+	batch->req.dest_perms = &batch->dest_perms;
+	batch->req.dest_nelems = 1;
+	batch->req.complete = prefetch_batch_assigned;
+	init_completion(&batch->done);
+
+	hyp_assign_tables_async(&batch->req);
+}
+
+/* Wait for the assign and hand the buffers to the secure page pool */
+static void prefetch_batch_finish(struct prefetch_batch *batch)
+{
+	struct ion_heap *sys_heap = batch->sys_heap;
+	struct scatterlist *sg;
+	int i, j;
+
+	wait_for_completion(&batch->done);
+	if (batch->ret)
+		pr_err("%s: Assign call failed. VMID %d\n", __func__,
+		       batch->dest_vmid);
+
+	for (i = 0; i < batch->nr; i++) {
+		struct ion_buffer *buffer = &batch->buffers[i];
+
+		if (!batch->ret) {
+			for_each_sg(batch->tables[i]->sgl, sg,
+				    batch->tables[i]->nents, j)
+				SetPagePrivate(sg_page(sg));
+			/* Now free it to the secure heap */
+			buffer->flags = batch->vmid;
+		}
+		buffer->heap = sys_heap;
+		sys_heap->ops->unmap_dma(sys_heap, buffer);
+		sys_heap->ops->free(buffer);
+	}
+	kfree(batch);
 }
 
 static void process_one_shrink(struct ion_system_secure_heap *secure_heap,
@@ -205,6 +277,7 @@ static void ion_system_secure_heap_prefetch_work(struct work_struct *work)
 						prefetch_work.work);
 	struct ion_heap *sys_heap = secure_heap->sys_heap;
 	struct prefetch_info *info, *tmp;
+	struct prefetch_batch *batch = NULL, *inflight = NULL;
 	unsigned long flags;
 
 	spin_lock_irqsave(&secure_heap->work_lock, flags);
@@ -213,15 +286,50 @@ static void ion_system_secure_heap_prefetch_work(struct work_struct *work)
 		list_del(&info->list);
 		spin_unlock_irqrestore(&secure_heap->work_lock, flags);
 
-		if (info->shrink)
+		if (batch && (info->shrink || info->vmid != batch->vmid ||
+			      batch->nr == PREFETCH_BATCH_MAX)) {
+			if (inflight)
+				prefetch_batch_finish(inflight);
+			inflight = NULL;
+			if (batch->nr) {
+				prefetch_batch_submit(batch);
+				inflight = batch;
+			} else {
+				kfree(batch);
+			}
+			batch = NULL;
+		}
+
+		if (info->shrink) {
+			if (inflight)
+				prefetch_batch_finish(inflight);
+			inflight = NULL;
 			process_one_shrink(secure_heap, sys_heap, info);
-		else
-			process_one_prefetch(sys_heap, info);
+		} else {
+			if (!batch) {
+				batch = kzalloc(sizeof(*batch), GFP_KERNEL);
+				if (batch) {
+					batch->sys_heap = sys_heap;
+					batch->vmid = info->vmid;
+				}
+			}
+			if (batch)
+				prefetch_batch_add(batch, info);
+		}
 
 		kfree(info);
 		spin_lock_irqsave(&secure_heap->work_lock, flags);
 	}
 	spin_unlock_irqrestore(&secure_heap->work_lock, flags);
+
+	if (inflight)
+		prefetch_batch_finish(inflight);
+	if (batch && batch->nr) {
+		prefetch_batch_submit(batch);
+		prefetch_batch_finish(batch);
+	} else {
+		kfree(batch);
+	}
 }
 
 static int alloc_prefetch_info(
@@ -278,20 +278,16 @@ static void __do_cache_ops(struct page *page, unsigned int offset,
 	return;
 }
 
-static int ion_pages_cache_ops(
-			struct ion_client *client,
-			struct ion_handle *handle,
-			void *vaddr, unsigned int offset, unsigned int length,
-			unsigned int cmd)
+static int ion_pages_cache_ops(struct ion_buffer *buffer,
+			       unsigned int offset, unsigned int length,
+			       unsigned int cmd)
 {
 	struct sg_table *table = NULL;
 	struct scatterlist *sg;
 	int i;
 	unsigned int len = 0;
 	void (*op)(const void *, size_t);
-	struct ion_buffer *buffer;
 
-	buffer = get_buffer(handle);
 	table = buffer->sg_table;
 	if (IS_ERR_OR_NULL(table))
 		return PTR_ERR(table);
@@ -368,8 +364,7 @@ static int ion_do_cache_op(struct ion_client *client, struct ion_handle *handle,
 	page = sg_page(table->sgl);
 
 	if (page)
-		ret = ion_pages_cache_ops(client, handle, uaddr,
-					  offset, len, cmd);
+		ret = ion_pages_cache_ops(buffer, offset, len, cmd);
 	else
 		ret = ion_no_pages_cache_ops(client, handle, uaddr,
 					     offset, len, cmd);
@@ -405,6 +400,30 @@ int msm_ion_do_cache_offset_op(
 }
 EXPORT_SYMBOL(msm_ion_do_cache_offset_op);
 
+int msm_ion_buffer_cache_op(struct ion_buffer *buffer, unsigned long offset,
+			    unsigned long len, unsigned int cmd)
+{
+	struct sg_table *table = buffer->sg_table;
+
+	if (!ION_IS_CACHED(buffer->flags))
+		return 0;
+
+	if (!is_buffer_hlos_assigned(buffer))
+		return 0;
+
+	if (IS_ERR_OR_NULL(table))
+		return -EINVAL;
+
+	if (!len || offset >= buffer->size || len > buffer->size - offset)
+		return -EINVAL;
+
+	/* Ranges only make sense for buffers backed by struct pages */
+	if (!sg_page(table->sgl))
+		return -EOPNOTSUPP;
+
+	return ion_pages_cache_ops(buffer, offset, len, cmd);
+}
+
 static void msm_ion_allocate(struct ion_platform_heap *heap)
 {
 	if (!heap->base && heap->extra_data) {
@@ -887,6 +906,21 @@ long msm_ion_custom_ioctl(struct ion_client *client,
 				     ion_system_secure_heap_prefetch);
 		if (ret)
 			return ret;
+
+		ret = ion_walk_heaps(client, data.prefetch_data.heap_id,
+				     ION_HEAP_TYPE_DMA,
+				     (void *)data.prefetch_data.len,
+				     ion_cma_prefetch);
+		if (ret)
+			return ret;
+
+		ret = ion_walk_heaps(client, data.prefetch_data.heap_id,
+				     (enum ion_heap_type)
+				     ION_HEAP_TYPE_HYP_CMA,
+				     (void *)data.prefetch_data.len,
+				     ion_cma_prefetch);
+		if (ret)
+			return ret;
 		break;
 	}
 	case ION_IOC_DRAIN:
@@ -907,6 +941,18 @@ long msm_ion_custom_ioctl(struct ion_client *client,
 				     (void *)&data.prefetch_data,
 				     ion_system_secure_heap_drain);
 
+		if (ret)
+			return ret;
+
+		ret = ion_walk_heaps(client, data.prefetch_data.heap_id,
+				     ION_HEAP_TYPE_DMA, NULL, ion_cma_drain);
+		if (ret)
+			return ret;
+
+		ret = ion_walk_heaps(client, data.prefetch_data.heap_id,
+				     (enum ion_heap_type)
+				     ION_HEAP_TYPE_HYP_CMA, NULL,
+				     ion_cma_drain);
 		if (ret)
 			return ret;
 		break;
@@ -176,6 +176,22 @@ int msm_ion_do_cache_offset_op(
 
 bool is_buffer_hlos_assigned(struct ion_buffer *buffer);
 
+/**
+ * msm_ion_buffer_cache_op - do cache maintenance on part of a buffer
+ *
+ * @buffer - buffer to operate on
+ * @offset - offset into the buffer to start at
+ * @len - Length of data to do cache operation on
+ * @cmd - Cache operation to perform:
+ *		ION_IOC_CLEAN_CACHES
+ *		ION_IOC_INV_CACHES
+ *		ION_IOC_CLEAN_INV_CACHES
+ *
+ * Returns 0 on success, -EOPNOTSUPP if the buffer is not backed by pages
+ */
+int msm_ion_buffer_cache_op(struct ion_buffer *buffer, unsigned long offset,
+			    unsigned long len, unsigned int cmd);
+
 #else
 static inline struct ion_client *msm_ion_client_create(const char *name)
 {
@@ -208,6 +224,13 @@ static bool is_buffer_hlos_assigned(struct ion_buffer *buffer)
 {
 	return true;
 }
+
+static inline int msm_ion_buffer_cache_op(struct ion_buffer *buffer,
+					  unsigned long offset,
+					  unsigned long len, unsigned int cmd)
+{
+	return -EOPNOTSUPP;
+}
 #endif /* CONFIG_ION */
 
 #endif
@@ -49,6 +49,9 @@
 #include <linux/cpuset.h>
 #include <linux/vmpressure.h>
 #include <linux/freezer.h>
+#include <linux/hashtable.h>
+#include <linux/kthread.h>
+#include <linux/lowmemorykiller.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/almk.h>
@@ -122,16 +125,37 @@ struct lmk_event {
 	short oom_score_adj;
 	short min_score_adj;
 	unsigned long long start_time;
+	/* kill to memory freed, in us, or -1 if it was not measured */
+	long reap_latency_us;
 	struct list_head list;
 };
 
-void handle_lmk_event(struct task_struct *selected, int selected_tasksize,
-		      short min_score_adj)
+static void lmk_event_fill(struct lmk_event *event,
+			   struct task_struct *selected, int selected_tasksize,
+			   short min_score_adj)
+{
+	strncpy(event->taskname, selected->comm, MAX_TASKNAME);
+
+	event->pid = selected->pid;
+	event->uid = from_kuid_munged(current_user_ns(), task_uid(selected));
+	if (selected->group_leader)
+		event->group_leader_pid = selected->group_leader->pid;
+	else
+		event->group_leader_pid = -1;
+	event->min_flt = selected->min_flt;
+	event->maj_flt = selected->maj_flt;
+	event->oom_score_adj = selected->signal->oom_score_adj;
+	event->start_time = nsec_to_clock_t(selected->real_start_time);
+	event->rss_in_pages = selected_tasksize;
+	event->min_score_adj = min_score_adj;
+	event->reap_latency_us = -1;
+}
+
+static void lmk_event_post(const struct lmk_event *src)
 {
 	int head;
 	int tail;
 	struct lmk_event *events;
-	struct lmk_event *event;
 
 	spin_lock(&lmk_event_lock);
 
@@ -145,22 +169,7 @@ void handle_lmk_event(struct task_struct *selected, int selected_tasksize,
 	}
 
 	events = (struct lmk_event *) event_buffer.buf;
-	event = &events[head];
-
-	strncpy(event->taskname, selected->comm, MAX_TASKNAME);
-
-	event->pid = selected->pid;
-	event->uid = from_kuid_munged(current_user_ns(), task_uid(selected));
-	if (selected->group_leader)
-		event->group_leader_pid = selected->group_leader->pid;
-	else
-		event->group_leader_pid = -1;
-	event->min_flt = selected->min_flt;
-	event->maj_flt = selected->maj_flt;
-	event->oom_score_adj = selected->signal->oom_score_adj;
-	event->start_time = nsec_to_clock_t(selected->real_start_time);
-	event->rss_in_pages = selected_tasksize;
-	event->min_score_adj = min_score_adj;
+	events[head] = *src;
 
 	event_buffer.head = (head + 1) & (MAX_BUFFERED_EVENTS - 1);
 
@@ -169,6 +178,15 @@ void handle_lmk_event(struct task_struct *selected, int selected_tasksize,
 	wake_up_interruptible(&event_wait);
 }
 
+void handle_lmk_event(struct task_struct *selected, int selected_tasksize,
+		      short min_score_adj)
+{
+	struct lmk_event event;
+
+	lmk_event_fill(&event, selected, selected_tasksize, min_score_adj);
+	lmk_event_post(&event);
+}
+
 static int lmk_event_show(struct seq_file *s, void *unused)
 {
 	struct lmk_event *events = (struct lmk_event *) event_buffer.buf;
@@ -188,11 +206,12 @@ static int lmk_event_show(struct seq_file *s, void *unused)
 
 	event = &events[tail];
 
-	seq_printf(s, "%lu %lu %lu %lu %lu %lu %hd %hd %llu\n%s\n",
+	seq_printf(s, "%lu %lu %lu %lu %lu %lu %hd %hd %llu %ld\n%s\n",
 		(unsigned long) event->pid, (unsigned long) event->uid,
 		(unsigned long) event->group_leader_pid, event->min_flt,
 		event->maj_flt, event->rss_in_pages, event->oom_score_adj,
-		event->min_score_adj, event->start_time, event->taskname);
+		event->min_score_adj, event->start_time,
+		event->reap_latency_us, event->taskname);
 
 	event_buffer.tail = (tail + 1) & (MAX_BUFFERED_EVENTS - 1);
 
@@ -272,6 +291,27 @@ module_param_named(vmpressure_file_min, vmpressure_file_min, int, 0644);
 static int oom_reaper;
 module_param_named(oom_reaper, oom_reaper, int, 0644);
 
+/*
+ * Kill from the lowmemorykiller thread, woken by vmpressure at or above
+ * lmk_kthread_pressure, instead of from the shrinker.
+ */
+static int lmk_kthread;
+module_param_named(lmk_kthread, lmk_kthread, int, 0644);
+
+static int lmk_kthread_pressure = 60;
+module_param_named(lmk_kthread_pressure, lmk_kthread_pressure, int, 0644);
+
+/*
+ * Up to this many victims are killed in one round, as long as the pages
+ * of the ones picked so far don't cover the deficit below minfree.
+ */
+#define LMK_MAX_VICTIMS	8
+static int lmk_max_victims = 1;
+module_param_named(lmk_max_victims, lmk_max_victims, int, 0644);
+
+static DECLARE_WAIT_QUEUE_HEAD(lmk_kthread_wait);
+static atomic_t lmk_kthread_pending = ATOMIC_INIT(0);
+
 enum {
 	VMPRESSURE_NO_ADJUST = 0,
 	VMPRESSURE_ADJUST_ENCROACH,
@@ -305,6 +345,11 @@ static int lmk_vmpressure_notifier(struct notifier_block *nb,
 	unsigned long pressure = action;
 	int array_size = ARRAY_SIZE(lowmem_adj);
 
+	if (lmk_kthread && pressure >= lmk_kthread_pressure) {
+		atomic_set(&lmk_kthread_pending, 1);
+		wake_up(&lmk_kthread_wait);
+	}
+
 	if (!enable_adaptive_lmk)
 		return 0;
 
@@ -616,44 +661,37 @@ static int get_free_ram(int *other_free, int *other_file,
 }
 #endif
 
-static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
+/*
+ * Work out the free and file page counts and from them the lowest
+ * oom_score_adj that may be killed, or OOM_SCORE_ADJ_MAX + 1 if memory
+ * is not low enough for any kill.
+ */
+static short lowmem_min_score_adj(struct shrink_control *sc, int *other_free,
+				  int *other_file, int *minfree)
 {
-	struct task_struct *tsk;
-	struct task_struct *selected = NULL;
-	unsigned long rem = 0;
-	int tasksize;
-	int i;
-	int ret = 0;
 	short min_score_adj = OOM_SCORE_ADJ_MAX + 1;
-	int minfree = 0;
-	int selected_tasksize = 0;
-	short selected_oom_score_adj;
 	int array_size = ARRAY_SIZE(lowmem_adj);
-	int other_free;
-	int other_file;
-
-	if (!mutex_trylock(&scan_mutex))
-		return 0;
+	int i;
 
 #ifdef CONFIG_ANDROID_LMK_NOTIFY_TRIGGER
 	lowmem_notif_sc.gfp_mask = sc->gfp_mask;
 
-	if (get_free_ram(&other_free, &other_file, sc))
+	if (get_free_ram(other_free, other_file, sc))
 		lowmem_notify_killzone_approach();
 #else
-	other_free = global_page_state(NR_FREE_PAGES) - totalreserve_pages;
+	*other_free = global_page_state(NR_FREE_PAGES) - totalreserve_pages;
 
 	if (global_node_page_state(NR_SHMEM) + total_swapcache_pages() +
 			global_node_page_state(NR_UNEVICTABLE) <
 			global_node_page_state(NR_FILE_PAGES))
-		other_file = global_node_page_state(NR_FILE_PAGES) -
+		*other_file = global_node_page_state(NR_FILE_PAGES) -
 					global_node_page_state(NR_SHMEM) -
 					global_node_page_state(NR_UNEVICTABLE) -
 					total_swapcache_pages();
 	else
-		other_file = 0;
+		*other_file = 0;
 
-	tune_lmk_param(&other_free, &other_file, sc);
+	tune_lmk_param(other_free, other_file, sc);
 #endif
 
 	if (lowmem_adj_size < array_size)
@@ -661,13 +699,228 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 	if (lowmem_minfree_size < array_size)
 		array_size = lowmem_minfree_size;
 	for (i = 0; i < array_size; i++) {
-		minfree = lowmem_minfree[i];
-		if (other_free < minfree && other_file < minfree) {
+		*minfree = lowmem_minfree[i];
+		if (*other_free < *minfree && *other_file < *minfree) {
 			min_score_adj = lowmem_adj[i];
 			break;
 		}
 	}
 
+	return min_score_adj;
+}
+
+struct lmk_victim {
+	struct task_struct *task;
+	int tasksize;
+	short oom_score_adj;
+};
+
+/*
+ * Pages a kill would give back: the RSS plus driver memory such as GPU
+ * buffers that the drivers charge to the mm and free when the task dies.
+ */
+static int lowmem_task_size(struct mm_struct *mm)
+{
+	return get_mm_rss(mm) + get_mm_counter(mm, MM_UNRECLAIMABLE);
+}
+
+static int lmk_nr_victims(void)
+{
+	return clamp(READ_ONCE(lmk_max_victims), 1, LMK_MAX_VICTIMS);
+}
+
+/*
+ * Insert a candidate into @victims, which is kept sorted by oom_score_adj
+ * and then size, both descending, and holds at most @max entries. Returns
+ * the new number of entries.
+ */
+static int lmk_victim_add(struct lmk_victim *victims, int nr, int max,
+			  struct task_struct *p, int tasksize,
+			  short oom_score_adj)
+{
+	int i;
+
+	for (i = nr; i > 0; i--) {
+		struct lmk_victim *v = &victims[i - 1];
+
+		if (v->oom_score_adj > oom_score_adj ||
+		    (v->oom_score_adj == oom_score_adj &&
+		     v->tasksize >= tasksize))
+			break;
+		if (i < max)
+			victims[i] = *v;
+	}
+	if (i >= max)
+		return nr;
+
+	victims[i].task = p;
+	victims[i].tasksize = tasksize;
+	victims[i].oom_score_adj = oom_score_adj;
+
+	return min(nr + 1, max);
+}
+
+/*
+ * How long it takes from the kill until the victim's memory is actually
+ * freed is measured by polling the rss of its mm, which is kept around
+ * with a mm_count reference. The lmk event is only posted once that is
+ * known.
+ */
+#define LMK_REAP_POLL_MS	5
+#define LMK_REAP_TIMEOUT_MS	2000
+
+struct lmk_reap {
+	struct delayed_work work;
+	struct mm_struct *mm;
+	ktime_t kill_time;
+	struct lmk_event event;
+};
+
+static void lmk_reap_work(struct work_struct *work)
+{
+	struct lmk_reap *r = container_of(to_delayed_work(work),
+					  struct lmk_reap, work);
+	s64 elapsed = ktime_us_delta(ktime_get(), r->kill_time);
+	unsigned long rss = get_mm_rss(r->mm);
+
+	if (rss && elapsed < LMK_REAP_TIMEOUT_MS * USEC_PER_MSEC) {
+		queue_delayed_work(system_unbound_wq, &r->work,
+				   msecs_to_jiffies(LMK_REAP_POLL_MS));
+		return;
+	}
+
+	if (!rss) {
+		r->event.reap_latency_us = elapsed;
+		lowmem_print(2, "'%s' (%d) freed %lukB in %lldus\n",
+			     r->event.taskname, r->event.pid,
+			     r->event.rss_in_pages * (PAGE_SIZE / 1024),
+			     (long long)elapsed);
+	}
+
+	mmdrop(r->mm);
+	lmk_event_post(&r->event);
+	kfree(r);
+}
+
+/* Post the lmk event for @selected once its memory has been freed */
+static void lmk_reap_start(struct task_struct *selected, int selected_tasksize,
+			   short min_score_adj, ktime_t kill_time)
+{
+	struct lmk_reap *r;
+
+	r = kzalloc(sizeof(*r), GFP_NOWAIT | __GFP_NOWARN);
+	if (!r) {
+		handle_lmk_event(selected, selected_tasksize, min_score_adj);
+		return;
+	}
+
+	lmk_event_fill(&r->event, selected, selected_tasksize, min_score_adj);
+	r->kill_time = kill_time;
+
+	task_lock(selected);
+	r->mm = selected->mm;
+	if (r->mm)
+		atomic_inc(&r->mm->mm_count);
+	task_unlock(selected);
+
+	if (!r->mm) {
+		/* already gone through exit_mm() */
+		r->event.reap_latency_us = ktime_us_delta(ktime_get(),
+							  kill_time);
+		lmk_event_post(&r->event);
+		kfree(r);
+		return;
+	}
+
+	INIT_DELAYED_WORK(&r->work, lmk_reap_work);
+	queue_delayed_work(system_unbound_wq, &r->work,
+			   msecs_to_jiffies(LMK_REAP_POLL_MS));
+}
+
+/*
+ * Kill @selected, which the caller holds a reference on. Called with the
+ * rcu read lock held when the victim was found by walking the task list.
+ */
+static void lowmem_kill(struct task_struct *selected, int selected_tasksize,
+			short selected_oom_score_adj, short min_score_adj,
+			int other_free, int other_file, int minfree,
+			gfp_t gfp_mask)
+{
+	long cache_size = other_file * (long)(PAGE_SIZE / 1024);
+	long cache_limit = minfree * (long)(PAGE_SIZE / 1024);
+	long free = other_free * (long)(PAGE_SIZE / 1024);
+
+	task_lock(selected);
+	send_sig(SIGKILL, selected, 0);
+	if (selected->mm) {
+		task_set_lmk_waiting(selected);
+		if (!test_bit(MMF_OOM_SKIP, &selected->mm->flags) &&
+		    oom_reaper) {
+			mark_lmk_victim(selected);
+			wake_oom_reaper(selected);
+		}
+	}
+	task_unlock(selected);
+	trace_lowmemory_kill(selected, cache_size, cache_limit, free);
+	lowmem_print(1, "Killing '%s' (%d) (tgid %d), adj %hd,\n"
+		"to free %ldkB on behalf of '%s' (%d) because\n"
+		"cache %ldkB is below limit %ldkB for oom score %hd\n"
+		"Free memory is %ldkB above reserved.\n"
+		"Free CMA is %ldkB\n"
+		"Total reserve is %ldkB\n"
+		"Total free pages is %ldkB\n"
+		"Total file cache is %ldkB\n"
+		"GFP mask is 0x%x\n",
+		selected->comm, selected->pid, selected->tgid,
+		selected_oom_score_adj,
+		selected_tasksize * (long)(PAGE_SIZE / 1024),
+		current->comm, current->pid,
+		cache_size, cache_limit,
+		min_score_adj,
+		free,
+		global_page_state(NR_FREE_CMA_PAGES) *
+		(long)(PAGE_SIZE / 1024),
+		totalreserve_pages * (long)(PAGE_SIZE / 1024),
+		global_page_state(NR_FREE_PAGES) *
+		(long)(PAGE_SIZE / 1024),
+		global_node_page_state(NR_FILE_PAGES) *
+		(long)(PAGE_SIZE / 1024),
+		gfp_mask);
+
+	if (lowmem_debug_level >= 2 && selected_oom_score_adj == 0) {
+		show_mem(SHOW_MEM_FILTER_NODES);
+		show_mem_call_notifiers();
+		dump_tasks(NULL, NULL);
+	}
+
+	lowmem_deathpending_timeout = jiffies + HZ;
+}
+
+static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
+{
+	struct task_struct *tsk;
+	struct lmk_victim victims[LMK_MAX_VICTIMS];
+	int max_victims = lmk_nr_victims();
+	int nr_victims = 0, nr_killed = 0;
+	ktime_t kill_time;
+	unsigned long rem = 0;
+	int tasksize;
+	int ret = 0;
+	short min_score_adj;
+	int minfree = 0;
+	int other_free;
+	int other_file;
+	int i;
+
+	if (lmk_kthread)
+		return 0;
+
+	if (!mutex_trylock(&scan_mutex))
+		return 0;
+
+	min_score_adj = lowmem_min_score_adj(sc, &other_free, &other_file,
+					     &minfree);
+
 	ret = adjust_minadj(&min_score_adj);
 
 	lowmem_print(3, "lowmem_scan %lu, %x, ofree %d %d, ma %hd\n",
@@ -682,8 +935,6 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 		return 0;
 	}
 
-	selected_oom_score_adj = min_score_adj;
-
 	rcu_read_lock();
 	for_each_process(tsk) {
 		struct task_struct *p;
@@ -732,27 +983,16 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 			task_unlock(p);
 			continue;
 		}
-		tasksize = get_mm_rss(p->mm);
+		tasksize = lowmem_task_size(p->mm);
 		task_unlock(p);
 		if (tasksize <= 0)
 			continue;
-		if (selected) {
-			if (oom_score_adj < selected_oom_score_adj)
-				continue;
-			if (oom_score_adj == selected_oom_score_adj &&
-			    tasksize <= selected_tasksize)
-				continue;
-		}
-		selected = p;
-		selected_tasksize = tasksize;
-		selected_oom_score_adj = oom_score_adj;
-		lowmem_print(3, "select '%s' (%d), adj %hd, size %d, to kill\n",
-			     p->comm, p->pid, oom_score_adj, tasksize);
+		nr_victims = lmk_victim_add(victims, nr_victims, max_victims,
+					    p, tasksize, oom_score_adj);
 	}
-	if (selected) {
-		long cache_size = other_file * (long)(PAGE_SIZE / 1024);
-		long cache_limit = minfree * (long)(PAGE_SIZE / 1024);
-		long free = other_free * (long)(PAGE_SIZE / 1024);
+	if (nr_victims) {
+		struct task_struct *selected = victims[0].task;
+		long deficit = minfree - other_free;
 
 		if (test_task_lmk_waiting(selected) &&
 		    (test_task_state(selected, TASK_UNINTERRUPTIBLE))) {
@@ -764,58 +1004,29 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 			return 0;
 		}
 
-		task_lock(selected);
-		get_task_struct(selected);
-		send_sig(SIGKILL, selected, 0);
-		if (selected->mm) {
-			task_set_lmk_waiting(selected);
-			if (!test_bit(MMF_OOM_SKIP, &selected->mm->flags) &&
-			    oom_reaper) {
-				mark_lmk_victim(selected);
-				wake_oom_reaper(selected);
-			}
-		}
-		task_unlock(selected);
-		trace_lowmemory_kill(selected, cache_size, cache_limit, free);
-		lowmem_print(1, "Killing '%s' (%d) (tgid %d), adj %hd,\n"
-			"to free %ldkB on behalf of '%s' (%d) because\n"
-			"cache %ldkB is below limit %ldkB for oom score %hd\n"
-			"Free memory is %ldkB above reserved.\n"
-			"Free CMA is %ldkB\n"
-			"Total reserve is %ldkB\n"
-			"Total free pages is %ldkB\n"
-			"Total file cache is %ldkB\n"
-			"GFP mask is 0x%x\n",
-			selected->comm, selected->pid, selected->tgid,
-			selected_oom_score_adj,
-			selected_tasksize * (long)(PAGE_SIZE / 1024),
-			current->comm, current->pid,
-			cache_size, cache_limit,
-			min_score_adj,
-			free,
-			global_page_state(NR_FREE_CMA_PAGES) *
-			(long)(PAGE_SIZE / 1024),
-			totalreserve_pages * (long)(PAGE_SIZE / 1024),
-			global_page_state(NR_FREE_PAGES) *
-			(long)(PAGE_SIZE / 1024),
-			global_node_page_state(NR_FILE_PAGES) *
-			(long)(PAGE_SIZE / 1024),
-			sc->gfp_mask);
-
-		if (lowmem_debug_level >= 2 && selected_oom_score_adj == 0) {
-			show_mem(SHOW_MEM_FILTER_NODES);
-			show_mem_call_notifiers();
-			dump_tasks(NULL, NULL);
-		}
+		kill_time = ktime_get();
+		for (i = 0; i < nr_victims; i++) {
+			struct lmk_victim *v = &victims[i];
 
-		lowmem_deathpending_timeout = jiffies + HZ;
-		rem += selected_tasksize;
+			/* one victim per round unless it doesn't cover it */
+			if (i && (long)rem >= deficit)
+				break;
+
+			lowmem_print(3, "select '%s' (%d), adj %hd, size %d, to kill\n",
+				     v->task->comm, v->task->pid,
+				     v->oom_score_adj, v->tasksize);
+			get_task_struct(v->task);
+			lowmem_kill(v->task, v->tasksize, v->oom_score_adj,
+				    min_score_adj, other_free, other_file,
+				    minfree, sc->gfp_mask);
+			rem += v->tasksize;
+		}
+		nr_killed = i;
 		rcu_read_unlock();
 		/* give the system time to free up the memory */
 		msleep_interruptible(20);
-		trace_almk_shrink(selected_tasksize, ret,
-				  other_free, other_file,
-				  selected_oom_score_adj);
+		trace_almk_shrink(rem, ret, other_free, other_file,
+				  victims[0].oom_score_adj);
 	} else {
 		trace_almk_shrink(1, ret, other_free, other_file, 0);
 		rcu_read_unlock();
@@ -825,9 +1036,10 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 		     sc->nr_to_scan, sc->gfp_mask, rem);
 	mutex_unlock(&scan_mutex);
 
-	if (selected) {
-		handle_lmk_event(selected, selected_tasksize, min_score_adj);
-		put_task_struct(selected);
+	for (i = 0; i < nr_killed; i++) {
+		lmk_reap_start(victims[i].task, victims[i].tasksize,
+			       min_score_adj, kill_time);
+		put_task_struct(victims[i].task);
 	}
 
 	return rem;
@@ -839,6 +1051,297 @@ static struct shrinker lowmem_shrinker = {
 	.seeks = DEFAULT_SEEKS * 16
 };
 
+/*
+ * Candidate index for the kill thread. Every process with a killable
+ * oom_score_adj is kept on the list for its adj, updated when the adj is
+ * written and when the process exits, and a bitmap tracks which lists are
+ * non-empty. The highest adj with candidates is then found without walking
+ * the task list. Bit 0 corresponds to OOM_SCORE_ADJ_MAX.
+ */
+#define LMK_NR_ADJ		(OOM_SCORE_ADJ_MAX - OOM_SCORE_ADJ_MIN + 1)
+#define lmk_adj_to_bit(adj)	(OOM_SCORE_ADJ_MAX - (adj))
+
+struct lmk_candidate {
+	struct hlist_node hnode;
+	struct list_head node;
+	struct task_struct *task;
+	short adj;
+};
+
+static DEFINE_SPINLOCK(lmk_cand_lock);
+static DEFINE_HASHTABLE(lmk_cand_hash, 8);
+static struct list_head lmk_cand_list[LMK_NR_ADJ];
+static DECLARE_BITMAP(lmk_cand_map, LMK_NR_ADJ);
+static struct kmem_cache *lmk_cand_cache;
+
+static struct lmk_candidate *lmk_cand_find(struct task_struct *task)
+{
+	struct lmk_candidate *c;
+
+	hash_for_each_possible(lmk_cand_hash, c, hnode, (unsigned long)task)
+		if (c->task == task)
+			return c;
+
+	return NULL;
+}
+
+static void lmk_cand_unlink(struct lmk_candidate *c)
+{
+	int bit = lmk_adj_to_bit(c->adj);
+
+	list_del(&c->node);
+	if (list_empty(&lmk_cand_list[bit]))
+		__clear_bit(bit, lmk_cand_map);
+}
+
+static void lmk_cand_free(struct lmk_candidate *c)
+{
+	put_task_struct(c->task);
+	kmem_cache_free(lmk_cand_cache, c);
+}
+
+/* Called with the rcu read lock or a reference on @task held */
+void lowmem_adj_changed(struct task_struct *task)
+{
+	struct task_struct *leader = task->group_leader;
+	short adj = task->signal->oom_score_adj;
+	struct lmk_candidate *c, *new = NULL, *old = NULL;
+	int bit = lmk_adj_to_bit(adj);
+
+	if (!lmk_cand_cache || (leader->flags & PF_KTHREAD))
+		return;
+
+	if (adj > OOM_SCORE_ADJ_MIN)
+		new = kmem_cache_alloc(lmk_cand_cache,
+				       GFP_ATOMIC | __GFP_NOWARN);
+
+	spin_lock(&lmk_cand_lock);
+	c = lmk_cand_find(leader);
+	if (c) {
+		lmk_cand_unlink(c);
+		if (adj == OOM_SCORE_ADJ_MIN) {
+			/* can never be killed, stop tracking it */
+			hash_del(&c->hnode);
+			old = c;
+			c = NULL;
+		}
+	} else if (new && !(leader->flags & PF_EXITING)) {
+		c = new;
+		new = NULL;
+		get_task_struct(leader);
+		c->task = leader;
+		hash_add(lmk_cand_hash, &c->hnode, (unsigned long)leader);
+	}
+
+	if (c) {
+		c->adj = adj;
+		list_add_tail(&c->node, &lmk_cand_list[bit]);
+		__set_bit(bit, lmk_cand_map);
+	}
+	spin_unlock(&lmk_cand_lock);
+
+	if (old)
+		lmk_cand_free(old);
+	if (new)
+		kmem_cache_free(lmk_cand_cache, new);
+}
+
+static int lmk_task_exit_notify(struct notifier_block *nb,
+				unsigned long action, void *data)
+{
+	struct task_struct *task = data;
+	struct lmk_candidate *c;
+
+	if (task != task->group_leader || !lmk_cand_cache)
+		return NOTIFY_OK;
+
+	spin_lock(&lmk_cand_lock);
+	c = lmk_cand_find(task);
+	if (c) {
+		lmk_cand_unlink(c);
+		hash_del(&c->hnode);
+	}
+	spin_unlock(&lmk_cand_lock);
+
+	if (c)
+		lmk_cand_free(c);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block lmk_task_exit_nb = {
+	.notifier_call = lmk_task_exit_notify,
+};
+
+/*
+ * Fill @victims with the biggest processes from the highest adj lists at
+ * or above @min_score_adj, with a reference held on each. Returns their
+ * number, or -EBUSY if a previous victim is still dying. Entries for
+ * processes that are exiting are dropped on the way.
+ */
+static int lmk_pick_candidates(short min_score_adj, struct lmk_victim *victims,
+			       int max)
+{
+	struct lmk_candidate *c, *tmp;
+	LIST_HEAD(stale);
+	int bit, i, nr = 0;
+
+	rcu_read_lock();
+	spin_lock(&lmk_cand_lock);
+	for_each_set_bit(bit, lmk_cand_map, lmk_adj_to_bit(min_score_adj) + 1) {
+		list_for_each_entry_safe(c, tmp, &lmk_cand_list[bit], node) {
+			struct task_struct *p;
+			int tasksize;
+
+			p = find_lock_task_mm(c->task);
+			if (!p) {
+				if (c->task->flags & PF_EXITING) {
+					lmk_cand_unlink(c);
+					hash_del(&c->hnode);
+					list_add(&c->node, &stale);
+				}
+				continue;
+			}
+
+			if (task_lmk_waiting(p)) {
+				task_unlock(p);
+				if (time_before_eq(jiffies,
+						   lowmem_deathpending_timeout)) {
+					nr = -EBUSY;
+					goto out;
+				}
+				continue;
+			}
+
+			tasksize = lowmem_task_size(p->mm);
+			task_unlock(p);
+			if (tasksize <= 0)
+				continue;
+
+			nr = lmk_victim_add(victims, nr, max, p, tasksize,
+					    c->adj);
+		}
+		/* lower adj lists can't beat a full set from this one */
+		if (nr == max)
+			break;
+	}
+	for (i = 0; i < nr; i++)
+		get_task_struct(victims[i].task);
+out:
+	spin_unlock(&lmk_cand_lock);
+	rcu_read_unlock();
+
+	list_for_each_entry_safe(c, tmp, &stale, node)
+		lmk_cand_free(c);
+
+	return nr;
+}
+
+static void lmk_kthread_kill(void)
+{
+	struct shrink_control sc = {
+		.gfp_mask = GFP_KERNEL,
+	};
+	struct lmk_victim victims[LMK_MAX_VICTIMS];
+	ktime_t kill_time;
+	short min_score_adj;
+	int other_free, other_file;
+	int minfree = 0;
+	long deficit, freed = 0;
+	int i, nr, nr_killed, ret;
+
+	mutex_lock(&scan_mutex);
+	min_score_adj = lowmem_min_score_adj(&sc, &other_free, &other_file,
+					     &minfree);
+	ret = adjust_minadj(&min_score_adj);
+	if (min_score_adj == OOM_SCORE_ADJ_MAX + 1) {
+		trace_almk_shrink(0, ret, other_free, other_file, 0);
+		mutex_unlock(&scan_mutex);
+		return;
+	}
+
+	nr = lmk_pick_candidates(min_score_adj, victims, lmk_nr_victims());
+	if (nr <= 0) {
+		if (!nr)
+			trace_almk_shrink(1, ret, other_free, other_file, 0);
+		mutex_unlock(&scan_mutex);
+		return;
+	}
+
+	deficit = minfree - other_free;
+	kill_time = ktime_get();
+	for (i = 0; i < nr; i++) {
+		struct lmk_victim *v = &victims[i];
+
+		/* one victim per round unless it doesn't cover it */
+		if (i && freed >= deficit)
+			break;
+
+		lowmem_print(3, "select '%s' (%d), adj %hd, size %d, to kill\n",
+			     v->task->comm, v->task->pid, v->oom_score_adj,
+			     v->tasksize);
+		lowmem_kill(v->task, v->tasksize, v->oom_score_adj,
+			    min_score_adj, other_free, other_file, minfree,
+			    sc.gfp_mask);
+		freed += v->tasksize;
+	}
+	nr_killed = i;
+	trace_almk_shrink(freed, ret, other_free, other_file,
+			  victims[0].oom_score_adj);
+	mutex_unlock(&scan_mutex);
+
+	for (i = 0; i < nr; i++) {
+		if (i < nr_killed)
+			lmk_reap_start(victims[i].task, victims[i].tasksize,
+				       min_score_adj, kill_time);
+		put_task_struct(victims[i].task);
+	}
+
+	/* give the system time to free up the memory */
+	msleep_interruptible(20);
+}
+
+static int lmk_kthread_fn(void *unused)
+{
+	set_freezable();
+	set_user_nice(current, MIN_NICE);
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(lmk_kthread_wait,
+				     atomic_read(&lmk_kthread_pending) ||
+				     kthread_should_stop());
+		if (kthread_should_stop())
+			break;
+
+		atomic_set(&lmk_kthread_pending, 0);
+		if (lmk_kthread)
+			lmk_kthread_kill();
+	}
+
+	return 0;
+}
+
+static void lmk_kthread_init(void)
+{
+	struct task_struct *tsk;
+	int i;
+
+	for (i = 0; i < LMK_NR_ADJ; i++)
+		INIT_LIST_HEAD(&lmk_cand_list[i]);
+
+	lmk_cand_cache = KMEM_CACHE(lmk_candidate, 0);
+	if (!lmk_cand_cache) {
+		pr_err("failed to create candidate cache\n");
+		return;
+	}
+
+	profile_event_register(PROFILE_TASK_EXIT, &lmk_task_exit_nb);
+
+	tsk = kthread_run(lmk_kthread_fn, NULL, "lowmemorykiller");
+	if (IS_ERR(tsk))
+		pr_err("failed to start kill thread\n");
+}
+
 #ifdef CONFIG_ANDROID_LMK_NOTIFY_TRIGGER
 static void lowmem_notify_killzone_approach(void)
 {
@@ -910,6 +1413,7 @@ static int __init lowmem_init(void)
 	register_shrinker(&lowmem_shrinker);
 	vmpressure_notifier_register(&lmk_vmpr_nb);
 	lmk_event_init();
+	lmk_kthread_init();
 	return 0;
 }
 device_initcall(lowmem_init);
@@ -134,6 +134,31 @@ struct ion_custom_data {
 	unsigned long arg;
 };
 
+/* Maximum number of buffers a single ION_IOC_ALLOC_BATCH can allocate */
+#define ION_BATCH_ALLOC_MAX	32
+
+/**
+ * struct ion_batch_allocation_data - metadata for a batched allocation
+ * @len:		size of each allocation
+ * @align:		required alignment of each allocation
+ * @heap_id_mask:	mask of heap ids to allocate from
+ * @flags:		flags passed to heap
+ * @count:		number of buffers to allocate, at most
+ *			ION_BATCH_ALLOC_MAX
+ * @fds:		user pointer to an array of @count ints that will be
+ *			populated with a dma-buf fd for each buffer
+ *
+ * Provided by userspace as an argument to the ioctl
+ */
+struct ion_batch_allocation_data {
+	size_t len;
+	size_t align;
+	unsigned int heap_id_mask;
+	unsigned int flags;
+	unsigned int count;
+	unsigned long fds;
+};
+
 #define ION_IOC_MAGIC		'I'
 
 /**
@@ -200,4 +225,14 @@ struct ion_custom_data {
  */
 #define ION_IOC_CUSTOM		_IOWR(ION_IOC_MAGIC, 6, struct ion_custom_data)
 
+/**
+ * DOC: ION_IOC_ALLOC_BATCH - allocate several buffers of the same size
+ *
+ * Takes an ion_batch_allocation_data struct and allocates count buffers,
+ * returning a dma-buf fd for each of them in the fds array. Either all of
+ * the buffers are allocated or none are.
+ */
+#define ION_IOC_ALLOC_BATCH	_IOWR(ION_IOC_MAGIC, 8, \
+				      struct ion_batch_allocation_data)
+
 #endif /* _UAPI_LINUX_ION_H */
@@ -754,6 +754,11 @@ int dwc3_core_init(struct dwc3 *dwc)
 	 if (!dwc->imod_interval && (dwc->revision == DWC3_REVISION_300A))
 		dwc->imod_interval = 1;
 
+	if (dwc->imod_interval && !dwc3_has_imod(dwc)) {
+		dev_warn(dwc->dev, "core has no interrupt moderation\n");
+		dwc->imod_interval = 0;
+	}
+
 	/* issue device SoftReset too */
 	ret = dwc3_core_reset(dwc);
 	if (ret)
@@ -1228,6 +1233,11 @@ static int dwc3_probe(struct platform_device *pdev)
 
 	device_property_read_u32(dev, "snps,xhci-imod-value",
 			&dwc->xhci_imod_value);
+	device_property_read_u16(dev, "snps,gadget-imod-interval",
+			&dwc->imod_interval);
+	device_property_read_u8(dev, "snps,trb-ioc-interval",
+			&dwc->trb_ioc_interval);
+	device_property_read_u8(dev, "snps,kick-batch", &dwc->kick_batch);
 
 	dwc->core_id = -1;
 	device_property_read_u32(dev, "usb-core-id", &dwc->core_id);
@@ -583,6 +583,41 @@ struct dwc3_ep_events {
 	unsigned int	total;
 };
 
+/**
+ * struct dwc3_ep_xfer_stats - data moved by a non-control endpoint
+ * @requests: requests given back successfully
+ * @bytes: sum of their actual lengths
+ * @kicks: Start/Update Transfer commands issued
+ * @deferred_kicks: queued requests left for the next completion to kick
+ * @trbs_no_ioc: TRBs prepared without Interrupt On Completion
+ */
+struct dwc3_ep_xfer_stats {
+	u64		requests;
+	u64		bytes;
+	u64		kicks;
+	u64		deferred_kicks;
+	u64		trbs_no_ioc;
+};
+
+/**
+ * struct dwc3_ep_gsi_stats - GSI path operations on a GSI capable endpoint
+ * @startxfers: Start Transfer commands for the GSI ring
+ * @updatexfers: Update Transfer commands for the GSI ring
+ * @endxfers: End Transfer commands
+ * @db_rings: GSI doorbells rung with the link TRB at channel start
+ * @db_updates: doorbells written by the driver when a normal interrupter
+ *		handles the events
+ * @path_switches: moves between the GSI and the normal request path
+ */
+struct dwc3_ep_gsi_stats {
+	u64		startxfers;
+	u64		updatexfers;
+	u64		endxfers;
+	u64		db_rings;
+	u64		db_updates;
+	u64		path_switches;
+};
+
 #define DWC3_EP_FLAG_STALLED	(1 << 0)
 #define DWC3_EP_FLAG_WEDGED	(1 << 1)
 
@@ -616,9 +651,16 @@ struct dwc3_ep_events {
  * @name: a human readable name e.g. ep1out-bulk
  * @direction: true for TX, false for RX
  * @stream_capable: true when streams are enabled
+ * @gsi_capable: reserved for GSI; may still run the normal request path
  * @dbg_ep_events: different events counter for endpoint
  * @dbg_ep_events_diff: differential events counter for endpoint
  * @dbg_ep_events_ts: timestamp for previous event counters
+ * @ioc_skipped: requests prepared without IOC since the last one with it
+ * @xfer_stats: throughput and moderation counters
+ * @xfer_stats_prev: @xfer_stats at the previous debugfs read
+ * @xfer_events_prev: transfer events at the previous debugfs read
+ * @xfer_stats_ts: time of the previous debugfs read
+ * @gsi_stats: GSI path counters
  * @fifo_depth: allocated TXFIFO depth
  * @ep_cfg_init_params: Used by GSI EP to save EP_CFG init_cmd params
  * @gsi_db_reg_addr: Address of GSI DB register mapped to this EP
@@ -673,9 +715,16 @@ struct dwc3_ep {
 
 	unsigned		direction:1;
 	unsigned		stream_capable:1;
+	unsigned		gsi_capable:1;
 	struct dwc3_ep_events	dbg_ep_events;
 	struct dwc3_ep_events	dbg_ep_events_diff;
 	struct timespec		dbg_ep_events_ts;
+	u8			ioc_skipped;
+	struct dwc3_ep_xfer_stats xfer_stats;
+	struct dwc3_ep_xfer_stats xfer_stats_prev;
+	unsigned int		xfer_events_prev;
+	ktime_t			xfer_stats_ts;
+	struct dwc3_ep_gsi_stats gsi_stats;
 	int			fifo_depth;
 	struct dwc3_gadget_ep_cmd_params ep_cfg_init_params;
 	void __iomem		*gsi_db_reg_addr;
@@ -866,6 +915,7 @@ struct dwc3_scratchpad_array {
 #define DWC3_GSI_EVT_BUF_CLEAR			13
 #define DWC3_GSI_EVT_BUF_FREE			14
 #define DWC3_CONTROLLER_NOTIFY_CLEAR_DB		15
+#define DWC3_CONTROLLER_NOTIFY_XFER_BURST	16
 
 #define MAX_INTR_STATS				10
 
@@ -989,6 +1039,16 @@ struct dwc3_scratchpad_array {
  * @last_fifo_depth: total TXFIFO depth of all enabled USB IN/INT endpoints
  * @imod_interval: set the interrupt moderation interval in 250ns
  *			increments or 0 to disable.
+ * @trb_ioc_interval: on bulk endpoints, request an interrupt only for every
+ *			Nth request and for the last one queued; 0 or 1 keeps
+ *			one interrupt per request.
+ * @kick_batch: while a bulk endpoint is busy, gather up to this many queued
+ *			requests before issuing Update Transfer; 0 or 1 kicks
+ *			on every queue.
+ * @xfer_burst_bytes: raise DWC3_CONTROLLER_NOTIFY_XFER_BURST once this many
+ *			bytes were given back on non-control endpoints; 0 is off.
+ *			Set by the glue driver.
+ * @xfer_burst_acc: bytes given back since the glue last reset it
  * @create_reg_debugfs: create debugfs entry to allow dwc3 register dump
  * @xhci_imod_value: imod value to use with xhci
  * @core_id: usb core id to differentiate different controller
@@ -1168,6 +1228,11 @@ struct dwc3 {
 	unsigned int		vbus_draw;
 
 	u16			imod_interval;
+	u8			trb_ioc_interval;
+	u8			kick_batch;
+
+	u32			xfer_burst_bytes;
+	u32			xfer_burst_acc;
 
 	struct workqueue_struct	*dwc_wq;
 	struct work_struct	bh_work;
@@ -25,6 +25,8 @@
 #include <linux/seq_file.h>
 #include <linux/delay.h>
 #include <linux/uaccess.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 
 #include <linux/usb/ch9.h>
 
@@ -820,6 +822,78 @@ static int dwc3_ep_trb_ring_show(struct seq_file *s, void *unused)
 	return 0;
 }
 
+/*
+ * Totals since the endpoint was created, and rates over the time since the
+ * previous read of this file.
+ */
+static int dwc3_ep_xfer_stats_show(struct seq_file *s, void *unused)
+{
+	struct dwc3_ep		*dep = s->private;
+	struct dwc3		*dwc = dep->dwc;
+	struct dwc3_ep_xfer_stats st, prev;
+	unsigned int		events, prev_events;
+	unsigned long		flags;
+	ktime_t			now = ktime_get();
+	s64			delta_us;
+	u64			mb;
+
+	spin_lock_irqsave(&dwc->lock, flags);
+	st = dep->xfer_stats;
+	prev = dep->xfer_stats_prev;
+	events = dep->dbg_ep_events.xferinprogress +
+		dep->dbg_ep_events.xfercomplete;
+	prev_events = dep->xfer_events_prev;
+	delta_us = ktime_us_delta(now, dep->xfer_stats_ts);
+	dep->xfer_stats_prev = st;
+	dep->xfer_events_prev = events;
+	dep->xfer_stats_ts = now;
+	spin_unlock_irqrestore(&dwc->lock, flags);
+
+	seq_printf(s, "requests: %llu\nbytes: %llu\nkicks: %llu\n",
+		   st.requests, st.bytes, st.kicks);
+	seq_printf(s, "deferred_kicks: %llu\ntrbs_no_ioc: %llu\n",
+		   st.deferred_kicks, st.trbs_no_ioc);
+	seq_printf(s, "xfer_events: %u\n", events);
+
+	mb = (st.bytes - prev.bytes) >> 20;
+	if (delta_us > 0)
+		seq_printf(s, "throughput_kbps: %llu\n",
+			   div64_u64((st.bytes - prev.bytes) * 8000,
+				     delta_us));
+	if (mb)
+		seq_printf(s, "events_per_mb: %llu\nkicks_per_mb: %llu\n",
+			   div64_u64(events - prev_events, mb),
+			   div64_u64(st.kicks - prev.kicks, mb));
+
+	return 0;
+}
+
+static int dwc3_ep_gsi_stats_show(struct seq_file *s, void *unused)
+{
+	struct dwc3_ep		*dep = s->private;
+	struct dwc3		*dwc = dep->dwc;
+	struct dwc3_ep_gsi_stats st;
+	const char		*path;
+	unsigned long		flags;
+
+	spin_lock_irqsave(&dwc->lock, flags);
+	st = dep->gsi_stats;
+	if (dep->endpoint.ep_type == EP_TYPE_GSI)
+		path = "gsi";
+	else
+		path = dep->gsi_capable ? "normal (fallback)" : "normal";
+	spin_unlock_irqrestore(&dwc->lock, flags);
+
+	/* The normal path is accounted in xfer_stats */
+	seq_printf(s, "path: %s\n", path);
+	seq_printf(s, "startxfers: %llu\nupdatexfers: %llu\nendxfers: %llu\n",
+		   st.startxfers, st.updatexfers, st.endxfers);
+	seq_printf(s, "db_rings: %llu\ndb_updates: %llu\npath_switches: %llu\n",
+		   st.db_rings, st.db_updates, st.path_switches);
+
+	return 0;
+}
+
 static struct dwc3_ep_file_map map[] = {
 	{ "tx_fifo_queue", dwc3_tx_fifo_queue_show, },
 	{ "rx_fifo_queue", dwc3_rx_fifo_queue_show, },
@@ -830,6 +904,8 @@ static struct dwc3_ep_file_map map[] = {
 	{ "event_queue", dwc3_event_queue_show, },
 	{ "transfer_type", dwc3_ep_transfer_type_show, },
 	{ "trb_ring", dwc3_ep_trb_ring_show, },
+	{ "xfer_stats", dwc3_ep_xfer_stats_show, },
+	{ "gsi_stats", dwc3_ep_gsi_stats_show, },
 };
 
 static int dwc3_endpoint_open(struct inode *inode, struct file *file)
@@ -1144,6 +1220,10 @@ int dwc3_debugfs_init(struct dwc3 *dwc)
 			ret = -ENOMEM;
 			goto err1;
 		}
+
+		debugfs_create_u8("trb_ioc_interval", 0644, root,
+				&dwc->trb_ioc_interval);
+		debugfs_create_u8("kick_batch", 0644, root, &dwc->kick_batch);
 	}
 
 	return 0;
@@ -15,6 +15,7 @@
 #include <linux/kernel.h>
 #include <linux/slab.h>
 #include <linux/cpu.h>
+#include <linux/cpufreq.h>
 #include <linux/platform_device.h>
 #include <linux/dma-mapping.h>
 #include <linux/dmapool.h>
@@ -29,6 +30,8 @@
 #include <linux/module.h>
 #include <linux/types.h>
 #include <linux/delay.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/of.h>
 #include <linux/of_platform.h>
 #include <linux/of_gpio.h>
@@ -223,7 +226,7 @@ static const char * const gsi_op_strings[] = {
 	"ENABLE_GSI", "UPDATE_XFER", "RING_DB",
 	"END_XFER", "GET_CH_INFO", "GET_XFER_IDX", "PREPARE_TRBS",
 	"FREE_TRBS", "SET_CLR_BLOCK_DBL", "CHECK_FOR_SUSP",
-	"EP_DISABLE", "EP_UPDATE_DB" };
+	"EP_DISABLE", "EP_UPDATE_DB", "SET_NORMAL_PATH" };
 
 /* Input bits to state machine (mdwc->inputs) */
 
@@ -235,6 +238,26 @@ static const char * const gsi_op_strings[] = {
 #define PM_QOS_SAMPLE_SEC	2
 #define PM_QOS_THRESHOLD	400
 
+/*
+ * Performance levels picked from the measured throughput. IDLE keeps the
+ * lowest connected bus vote; NOMINAL adds the PM QoS latency vote (the old
+ * "perf mode"); BOOST adds the CPU frequency floor. Bus usecase 1 + level
+ * is voted, capped at the last usecase of the table.
+ */
+enum dwc3_msm_perf_level {
+	DWC3_PERF_IDLE,
+	DWC3_PERF_NOMINAL,
+	DWC3_PERF_BOOST,
+	DWC3_PERF_LEVELS,
+};
+
+#define PERF_NOMINAL_KBPS	2048
+#define PERF_BOOST_KBPS		40960
+/* Samples below half the level's threshold before stepping down */
+#define PERF_DOWN_SAMPLES	3
+/* Burst that triggers an early sample: 100ms worth of the next level */
+#define PERF_BURST_DIV		10
+
 struct dwc3_msm {
 	struct device *dev;
 	void __iomem *base;
@@ -324,6 +347,15 @@ struct dwc3_msm {
 	int pm_qos_latency;
 	struct pm_qos_request pm_qos_req_dma;
 	struct delayed_work perf_vote_work;
+	enum dwc3_msm_perf_level perf_level;
+	u32			perf_kbps[DWC3_PERF_LEVELS];
+	unsigned int		perf_low_samples;
+	u64			perf_last_bytes;
+	unsigned long		perf_last_irq_cnt;
+	ktime_t			perf_last_ts;
+	u32			boost_cpu_min_freq;
+	bool			cpu_floor_active;
+	struct notifier_block	cpufreq_nb;
 	struct delayed_work sdp_check;
 	bool usb_compliance_mode;
 	struct mutex suspend_resume_mutex;
@@ -981,6 +1013,7 @@ static int gsi_startxfer_for_ep(struct usb_ep *ep)
 	cmd = DWC3_DEPCMD_STARTTRANSFER;
 	cmd |= DWC3_DEPCMD_PARAM(0);
 	ret = dwc3_send_gadget_ep_cmd(dep, cmd, &params);
+	dep->gsi_stats.startxfers++;
 
 	if (ret < 0)
 		dev_dbg(dwc->dev, "Fail StrtXfr on GSI EP#%d\n", dep->number);
@@ -1058,6 +1091,7 @@ static void dwc3_msm_gsi_db_update(struct dwc3_ep *dep, dma_addr_t offset)
 	}
 
 	writel_relaxed(offset, dep->gsi_db_reg_addr);
+	dep->gsi_stats.db_updates++;
 	dev_dbg(mdwc->dev, "Writing TRB addr: %pa to %pK\n",
 		&offset, dep->gsi_db_reg_addr);
 }
@@ -1108,6 +1142,7 @@ static void gsi_ring_db(struct usb_ep *ep, struct usb_gsi_request *request)
 	readl_relaxed(gsi_dbl_address_lsb);
 	writel_relaxed(0, gsi_dbl_address_msb);
 	readl_relaxed(gsi_dbl_address_msb);
+	dep->gsi_stats.db_rings++;
 }
 
 /*
@@ -1140,6 +1175,7 @@ static int gsi_updatexfer_for_ep(struct usb_ep *ep,
 	cmd |= DWC3_DEPCMD_PARAM(dep->resource_index);
 	ret = dwc3_send_gadget_ep_cmd(dep, cmd, &params);
 	dep->flags |= DWC3_EP_BUSY;
+	dep->gsi_stats.updatexfers++;
 	if (ret < 0)
 		dev_dbg(dwc->dev, "UpdateXfr fail on GSI EP#%d\n", dep->number);
 	return ret;
@@ -1156,6 +1192,7 @@ static void gsi_endxfer_for_ep(struct usb_ep *ep)
 	struct dwc3	*dwc = dep->dwc;
 
 	dwc3_stop_active_transfer(dwc, dep->number, true);
+	dep->gsi_stats.endxfers++;
 }
 
 /*
@@ -1183,6 +1220,18 @@ static int gsi_prepare_trbs(struct usb_ep *ep, struct usb_gsi_request *req)
 		return -ESHUTDOWN;
 	}
 
+	/*
+	 * Drop the ring a GSI EP has for the normal path; it is allocated
+	 * again if the function falls back to it.
+	 */
+	if (dep->gsi_capable && dep->trb_pool) {
+		dma_free_coherent(dwc->sysdev,
+			dep->num_trbs * sizeof(struct dwc3_trb),
+			dep->trb_pool, dep->trb_pool_dma);
+		dep->trb_pool = NULL;
+		dep->trb_pool_dma = 0;
+	}
+
 	dep->trb_pool = dma_zalloc_coherent(dwc->sysdev,
 				num_trbs * sizeof(struct dwc3_trb),
 				&dep->trb_pool_dma, GFP_KERNEL);
@@ -1549,6 +1598,54 @@ static bool gsi_check_ready_to_suspend(struct dwc3_msm *mdwc)
 	return true;
 }
 
+/*
+* Switches a GSI EP between the GSI path and the normal request path, so a
+* function can keep using the EPs it claimed when the IPA channel cannot be
+* set up and move the data through usb_ep_queue() instead. The EP must be
+* disabled, and any GSI ring freed with GSI_EP_OP_FREE_TRBS.
+*
+* @usb_ep - pointer to usb_ep instance.
+* @normal - true for the normal path, false to go back to GSI.
+*
+* @return int - 0 on success
+*/
+static int gsi_set_normal_path(struct usb_ep *ep, bool normal)
+{
+	struct dwc3_ep *dep = to_dwc3_ep(ep);
+	struct dwc3 *dwc = dep->dwc;
+	int ret;
+
+	if (!dep->gsi_capable)
+		return -EINVAL;
+
+	if (dep->flags & DWC3_EP_ENABLED)
+		return -EBUSY;
+
+	if (normal == (ep->ep_type == EP_TYPE_NORMAL))
+		return 0;
+
+	if (normal) {
+		if (dep->trb_pool && dep->num_trbs != DWC3_TRB_NUM) {
+			dev_err(dwc->dev, "%s: GSI ring still in use\n",
+				dep->name);
+			return -EBUSY;
+		}
+
+		ret = dwc3_alloc_trb_pool(dep);
+		if (ret)
+			return ret;
+
+		ep->ep_type = EP_TYPE_NORMAL;
+	} else {
+		ep->ep_type = EP_TYPE_GSI;
+	}
+
+	dep->gsi_stats.path_switches++;
+	dbg_log_string("ep:%s %s path\n", ep->name, normal ? "normal" : "gsi");
+
+	return 0;
+}
+
 static inline const char *gsi_op_to_string(unsigned int op)
 {
 	if (op < ARRAY_SIZE(gsi_op_strings))
@@ -1576,7 +1673,7 @@ static int dwc3_msm_gsi_ep_op(struct usb_ep *ep,
 	struct dwc3_msm *mdwc = dev_get_drvdata(dwc->dev->parent);
 	struct usb_gsi_request *request;
 	struct gsi_channel_info *ch_info;
-	bool block_db;
+	bool block_db, normal;
 	unsigned long flags;
 	dma_addr_t offset;
 
@@ -1648,6 +1745,10 @@ static int dwc3_msm_gsi_ep_op(struct usb_ep *ep,
 		offset = *(dma_addr_t *)op_data;
 		dwc3_msm_gsi_db_update(dep, offset);
 		break;
+	case GSI_EP_OP_SET_NORMAL_PATH:
+		normal = *((bool *)op_data);
+		ret = gsi_set_normal_path(ep, normal);
+		break;
 	default:
 		dev_err(mdwc->dev, "%s: Invalid opcode GSI EP\n", __func__);
 	}
@@ -2268,6 +2369,10 @@ static void dwc3_msm_notify_event(struct dwc3 *dwc, unsigned int event,
 		dwc3_msm_write_reg_field(mdwc->base,
 			GSI_GENERAL_CFG_REG, BLOCK_GSI_WR_GO_MASK, true);
 		break;
+	case DWC3_CONTROLLER_NOTIFY_XFER_BURST:
+		/* Sample now rather than at the end of the period */
+		mod_delayed_work(system_wq, &mdwc->perf_vote_work, 0);
+		break;
 	default:
 		dev_dbg(mdwc->dev, "unknown dwc3 event\n");
 		break;
@@ -2422,8 +2527,7 @@ static void dwc3_set_phy_speed_flags(struct dwc3_msm *mdwc)
 	}
 }
 
-static void msm_dwc3_perf_vote_update(struct dwc3_msm *mdwc,
-						bool perf_mode);
+static void msm_dwc3_perf_stop(struct dwc3_msm *mdwc);
 
 static void configure_usb_wakeup_interrupt(struct dwc3_msm *mdwc,
 	struct usb_irq *uirq, unsigned int polarity, bool enable)
@@ -2519,8 +2623,7 @@ static int dwc3_msm_suspend(struct dwc3_msm *mdwc, bool hibernation)
 		return 0;
 	}
 
-	cancel_delayed_work_sync(&mdwc->perf_vote_work);
-	msm_dwc3_perf_vote_update(mdwc, false);
+	msm_dwc3_perf_stop(mdwc);
 
 	if (!mdwc->in_host_mode) {
 		evt = dwc->ev_buf;
@@ -3982,6 +4085,14 @@ static int dwc3_msm_probe(struct platform_device *pdev)
 	of_property_read_u32(node, "qcom,gadget-imod-val",
 					&dwc3_gadget_imod_val);
 
+	mdwc->perf_kbps[DWC3_PERF_NOMINAL] = PERF_NOMINAL_KBPS;
+	mdwc->perf_kbps[DWC3_PERF_BOOST] = PERF_BOOST_KBPS;
+	of_property_read_u32_array(node, "qcom,perf-thresholds-kbps",
+				&mdwc->perf_kbps[DWC3_PERF_NOMINAL],
+				DWC3_PERF_LEVELS - 1);
+	of_property_read_u32(node, "qcom,boost-cpu-min-freq",
+				&mdwc->boost_cpu_min_freq);
+
 	mdwc->no_vbus_vote_type_c = of_property_read_bool(node,
 					"qcom,no-vbus-vote-with-type-C");
 
@@ -4037,6 +4148,12 @@ static int dwc3_msm_probe(struct platform_device *pdev)
 	device_create_file(&pdev->dev, &dev_attr_xhci_link_compliance);
 	device_create_file(&pdev->dev, &dev_attr_usb_data_enabled);
 
+	if (mdwc->boost_cpu_min_freq) {
+		mdwc->cpufreq_nb.notifier_call = dwc3_msm_cpufreq_notifier;
+		cpufreq_register_notifier(&mdwc->cpufreq_nb,
+					CPUFREQ_POLICY_NOTIFIER);
+	}
+
 	host_mode = usb_get_dr_mode(&mdwc->dwc3->dev) == USB_DR_MODE_HOST;
 	if (!dwc->is_drd && host_mode) {
 		dev_dbg(&pdev->dev, "DWC3 in host only mode\n");
@@ -4107,6 +4224,10 @@ static int dwc3_msm_remove(struct platform_device *pdev)
 	cancel_delayed_work_sync(&mdwc->perf_vote_work);
 	cancel_delayed_work_sync(&mdwc->sm_work);
 
+	if (mdwc->boost_cpu_min_freq)
+		cpufreq_unregister_notifier(&mdwc->cpufreq_nb,
+					CPUFREQ_POLICY_NOTIFIER);
+
 	if (mdwc->hs_phy)
 		mdwc->hs_phy->flags &= ~PHY_HOST_MODE;
 	platform_device_put(mdwc->dwc3);
@@ -4226,38 +4347,186 @@ static int dwc3_msm_host_notifier(struct notifier_block *nb,
 	return NOTIFY_DONE;
 }
 
-static void msm_dwc3_perf_vote_update(struct dwc3_msm *mdwc, bool perf_mode)
+static int dwc3_msm_cpufreq_notifier(struct notifier_block *nb,
+				     unsigned long val, void *data)
+{
+	struct dwc3_msm *mdwc = container_of(nb, struct dwc3_msm, cpufreq_nb);
+	struct cpufreq_policy *policy = data;
+
+	if (val != CPUFREQ_ADJUST || !mdwc->cpu_floor_active)
+		return NOTIFY_DONE;
+
+	cpufreq_verify_within_limits(policy, mdwc->boost_cpu_min_freq,
+				     policy->cpuinfo.max_freq);
+
+	return NOTIFY_OK;
+}
+
+static void msm_dwc3_perf_cpu_floor(struct dwc3_msm *mdwc, bool enable)
 {
-	static bool curr_perf_mode;
+	unsigned int cpu;
+
+	if (!mdwc->boost_cpu_min_freq || mdwc->cpu_floor_active == enable)
+		return;
+
+	mdwc->cpu_floor_active = enable;
+	get_online_cpus();
+	for_each_online_cpu(cpu)
+		cpufreq_update_policy(cpu);
+	put_online_cpus();
+}
+
+/* Ask the core for an early sample once a burst towards the next level */
+static void msm_dwc3_perf_arm_burst(struct dwc3_msm *mdwc)
+{
+	struct dwc3 *dwc = platform_get_drvdata(mdwc->dwc3);
+	unsigned long flags;
+	u32 burst = 0;
+
+	if (mdwc->in_device_mode && mdwc->perf_level < DWC3_PERF_BOOST)
+		burst = mdwc->perf_kbps[mdwc->perf_level + 1] * 1024 /
+			PERF_BURST_DIV;
+
+	spin_lock_irqsave(&dwc->lock, flags);
+	dwc->xfer_burst_bytes = burst;
+	dwc->xfer_burst_acc = 0;
+	spin_unlock_irqrestore(&dwc->lock, flags);
+}
+
+static void msm_dwc3_perf_set_level(struct dwc3_msm *mdwc,
+				    enum dwc3_msm_perf_level level)
+{
+	enum dwc3_msm_perf_level old = mdwc->perf_level;
 	int latency = mdwc->pm_qos_latency;
+	int max_usecase, old_usecase, usecase, ret;
 
-	if ((curr_perf_mode == perf_mode) || !latency)
+	if (level == old)
 		return;
 
-	if (perf_mode)
-		pm_qos_update_request(&mdwc->pm_qos_req_dma, latency);
-	else
+	mdwc->perf_level = level;
+	dbg_event(0xFF, "perf_lvl", level);
+
+	if (latency && pm_qos_request_active(&mdwc->pm_qos_req_dma) &&
+	    (old >= DWC3_PERF_NOMINAL) != (level >= DWC3_PERF_NOMINAL))
 		pm_qos_update_request(&mdwc->pm_qos_req_dma,
-						PM_QOS_DEFAULT_VALUE);
+				level >= DWC3_PERF_NOMINAL ?
+				latency : PM_QOS_DEFAULT_VALUE);
+
+	if (mdwc->bus_perf_client) {
+		max_usecase = mdwc->bus_scale_table->num_usecases - 1;
+		old_usecase = min_t(int, 1 + old, max_usecase);
+		usecase = min_t(int, 1 + level, max_usecase);
+		if (usecase != old_usecase) {
+			ret = msm_bus_scale_client_update_request(
+					mdwc->bus_perf_client, usecase);
+			if (ret)
+				dev_err(mdwc->dev, "bus bw voting failed %d\n",
+					ret);
+		}
+	}
 
-	curr_perf_mode = perf_mode;
-	pr_debug("%s: latency updated to: %d\n", __func__,
-			perf_mode ? latency : PM_QOS_DEFAULT_VALUE);
+	msm_dwc3_perf_cpu_floor(mdwc, level == DWC3_PERF_BOOST);
+
+	dev_dbg(mdwc->dev, "%s: perf level %d -> %d\n", __func__, old, level);
 }
 
+static u64 msm_dwc3_gadget_xfer_bytes(struct dwc3 *dwc)
+{
+	unsigned long flags;
+	u64 bytes = 0;
+	int i;
+
+	spin_lock_irqsave(&dwc->lock, flags);
+	for (i = 2; i < DWC3_ENDPOINTS_NUM; i++)
+		if (dwc->eps[i])
+			bytes += dwc->eps[i]->xfer_stats.bytes;
+	spin_unlock_irqrestore(&dwc->lock, flags);
+
+	return bytes;
+}
+
+static void msm_dwc3_perf_start(struct dwc3_msm *mdwc)
+{
+	struct dwc3 *dwc = platform_get_drvdata(mdwc->dwc3);
+
+	mdwc->perf_low_samples = 0;
+	mdwc->perf_last_irq_cnt = dwc->irq_cnt;
+	mdwc->perf_last_bytes = msm_dwc3_gadget_xfer_bytes(dwc);
+	mdwc->perf_last_ts = ktime_get();
+
+	/* start in perf mode for better performance initially */
+	msm_dwc3_perf_set_level(mdwc, DWC3_PERF_NOMINAL);
+	msm_dwc3_perf_arm_burst(mdwc);
+	schedule_delayed_work(&mdwc->perf_vote_work,
+			msecs_to_jiffies(1000 * PM_QOS_SAMPLE_SEC));
+}
+
+static void msm_dwc3_perf_stop(struct dwc3_msm *mdwc)
+{
+	struct dwc3 *dwc = platform_get_drvdata(mdwc->dwc3);
+	unsigned long flags;
+
+	/* No more early samples from the event path */
+	spin_lock_irqsave(&dwc->lock, flags);
+	dwc->xfer_burst_bytes = 0;
+	spin_unlock_irqrestore(&dwc->lock, flags);
+
+	cancel_delayed_work_sync(&mdwc->perf_vote_work);
+	msm_dwc3_perf_set_level(mdwc, DWC3_PERF_IDLE);
+}
+
+/*
+ * Pick the level from the bytes given back on the gadget endpoints since
+ * the previous sample; the interrupt rate still selects at least NOMINAL,
+ * which is all host mode has to go on. Step up at once, to the level the
+ * throughput calls for, but only step down one level at a time, after
+ * PERF_DOWN_SAMPLES samples well below the current level.
+ */
 static void msm_dwc3_perf_vote_work(struct work_struct *w)
 {
 	struct dwc3_msm *mdwc = container_of(w, struct dwc3_msm,
 						perf_vote_work.work);
 	struct dwc3 *dwc = platform_get_drvdata(mdwc->dwc3);
-	static unsigned long	last_irq_cnt;
-	bool in_perf_mode = false;
-
-	if (dwc->irq_cnt - last_irq_cnt >= PM_QOS_THRESHOLD)
-		in_perf_mode = true;
+	enum dwc3_msm_perf_level level = mdwc->perf_level;
+	enum dwc3_msm_perf_level target = DWC3_PERF_IDLE;
+	ktime_t now = ktime_get();
+	s64 elapsed_ms = ktime_ms_delta(now, mdwc->perf_last_ts);
+	bool below = true;
+	u64 bytes, kbps = 0;
+
+	if (dwc->irq_cnt - mdwc->perf_last_irq_cnt >= PM_QOS_THRESHOLD)
+		target = DWC3_PERF_NOMINAL;
+
+	if (mdwc->in_device_mode) {
+		bytes = msm_dwc3_gadget_xfer_bytes(dwc);
+		if (elapsed_ms > 0)
+			kbps = div64_u64((bytes - mdwc->perf_last_bytes) * 1000,
+					 (u64)elapsed_ms * 1024);
+		mdwc->perf_last_bytes = bytes;
+
+		if (kbps >= mdwc->perf_kbps[DWC3_PERF_BOOST])
+			target = DWC3_PERF_BOOST;
+		else if (kbps >= mdwc->perf_kbps[DWC3_PERF_NOMINAL])
+			target = DWC3_PERF_NOMINAL;
+		below = kbps < mdwc->perf_kbps[level] / 2;
+	}
+
+	mdwc->perf_last_irq_cnt = dwc->irq_cnt;
+	mdwc->perf_last_ts = now;
+
+	if (target > level) {
+		msm_dwc3_perf_set_level(mdwc, target);
+		mdwc->perf_low_samples = 0;
+	} else if (target < level && below) {
+		if (++mdwc->perf_low_samples >= PERF_DOWN_SAMPLES) {
+			msm_dwc3_perf_set_level(mdwc, level - 1);
+			mdwc->perf_low_samples = 0;
+		}
+	} else {
+		mdwc->perf_low_samples = 0;
+	}
 
-	last_irq_cnt = dwc->irq_cnt;
-	msm_dwc3_perf_vote_update(mdwc, in_perf_mode);
+	msm_dwc3_perf_arm_burst(mdwc);
 	schedule_delayed_work(&mdwc->perf_vote_work,
 			msecs_to_jiffies(1000 * PM_QOS_SAMPLE_SEC));
 }
@@ -4386,10 +4655,7 @@ static int dwc3_otg_start_host(struct dwc3_msm *mdwc, int on)
 #endif
 		pm_qos_add_request(&mdwc->pm_qos_req_dma,
 				PM_QOS_CPU_DMA_LATENCY, PM_QOS_DEFAULT_VALUE);
-		/* start in perf mode for better performance initially */
-		msm_dwc3_perf_vote_update(mdwc, true);
-		schedule_delayed_work(&mdwc->perf_vote_work,
-				msecs_to_jiffies(1000 * PM_QOS_SAMPLE_SEC));
+		msm_dwc3_perf_start(mdwc);
 	} else {
 		dev_dbg(mdwc->dev, "%s: turn off host\n", __func__);
 
@@ -4401,8 +4667,7 @@ static int dwc3_otg_start_host(struct dwc3_msm *mdwc, int on)
 			return ret;
 		}
 
-		cancel_delayed_work_sync(&mdwc->perf_vote_work);
-		msm_dwc3_perf_vote_update(mdwc, false);
+		msm_dwc3_perf_stop(mdwc);
 		pm_qos_remove_request(&mdwc->pm_qos_req_dma);
 
 		pm_runtime_get_sync(mdwc->dev);
@@ -4488,10 +4753,7 @@ static int dwc3_otg_start_peripheral(struct dwc3_msm *mdwc, int on)
 #endif
 		pm_qos_add_request(&mdwc->pm_qos_req_dma,
 				PM_QOS_CPU_DMA_LATENCY, PM_QOS_DEFAULT_VALUE);
-		/* start in perf mode for better performance initially */
-		msm_dwc3_perf_vote_update(mdwc, true);
-		schedule_delayed_work(&mdwc->perf_vote_work,
-				msecs_to_jiffies(1000 * PM_QOS_SAMPLE_SEC));
+		msm_dwc3_perf_start(mdwc);
 		if (dwc3_gadget_imod_val > 0) {
 			dwc3_msm_write_reg(mdwc->base, USEC_CNT, 0x7D);
 			dwc3_msm_write_reg_field(mdwc->base, IMOD(0),
@@ -4508,8 +4770,7 @@ static int dwc3_otg_start_peripheral(struct dwc3_msm *mdwc, int on)
 		dwc3_msm_write_reg_field(mdwc->base, IMOD(0),
 					 IMOD_EE_CNT_MASK, 0x0);
 		dwc3_msm_write_reg(mdwc->base, USEC_CNT, 0x0);
-		cancel_delayed_work_sync(&mdwc->perf_vote_work);
-		msm_dwc3_perf_vote_update(mdwc, false);
+		msm_dwc3_perf_stop(mdwc);
 		pm_qos_remove_request(&mdwc->pm_qos_req_dma);
 
 		mdwc->in_device_mode = false;
@@ -272,6 +272,20 @@ void dwc3_gadget_giveback(struct dwc3_ep *dep, struct dwc3_request *req,
 	if (req->request.status == -EINPROGRESS)
 		req->request.status = status;
 
+	if (dep->number > 1 && !req->request.status) {
+		dep->xfer_stats.requests++;
+		dep->xfer_stats.bytes += req->request.actual;
+
+		if (dwc->xfer_burst_bytes) {
+			dwc->xfer_burst_acc += req->request.actual;
+			if (dwc->xfer_burst_acc >= dwc->xfer_burst_bytes) {
+				dwc->xfer_burst_acc = 0;
+				dwc3_notify_event(dwc,
+					DWC3_CONTROLLER_NOTIFY_XFER_BURST, 0);
+			}
+		}
+	}
+
 	/*
 	 * NOTICE we don't want to unmap before calling ->complete() if we're
 	 * dealing with a bounced ep0 request. If we unmap it here, we would end
@@ -455,7 +469,7 @@ static int dwc3_send_clear_stall_ep_cmd(struct dwc3_ep *dep)
 	return dwc3_send_gadget_ep_cmd(dep, cmd, &params);
 }
 
-static int dwc3_alloc_trb_pool(struct dwc3_ep *dep)
+int dwc3_alloc_trb_pool(struct dwc3_ep *dep)
 {
 	struct dwc3		*dwc = dep->dwc;
 	u32			num_trbs = DWC3_TRB_NUM;
@@ -725,6 +739,7 @@ static int __dwc3_gadget_ep_enable(struct dwc3_ep *dep,
 		/* Initialize the TRB ring */
 		dep->trb_dequeue = 0;
 		dep->trb_enqueue = 0;
+		dep->ioc_skipped = 0;
 		memset(dep->trb_pool, 0,
 		       sizeof(struct dwc3_trb) * DWC3_TRB_NUM);
 
@@ -940,6 +955,44 @@ static void dwc3_gadget_ep_free_request(struct usb_ep *ep,
 
 static u32 dwc3_calc_trbs_left(struct dwc3_ep *dep);
 
+static bool dwc3_gadget_moderated(struct dwc3_ep *dep)
+{
+	struct dwc3 *dwc = dep->dwc;
+
+	return usb_endpoint_xfer_bulk(dep->endpoint.desc) &&
+		(dwc->trb_ioc_interval > 1 || dwc->kick_batch > 1);
+}
+
+/*
+ * Decide whether the last TRB of @req interrupts on completion. With
+ * moderation only every trb_ioc_interval-th request does, plus the last
+ * one queued so far: the hardware then always owns a TRB that will raise
+ * XferInProgress, which gives back all requests finished before it and
+ * kicks whatever was queued meanwhile.
+ */
+static bool dwc3_gadget_want_ioc(struct dwc3_ep *dep, struct dwc3_request *req)
+{
+	struct dwc3 *dwc = dep->dwc;
+
+	if (!dwc3_gadget_moderated(dep))
+		return !req->request.no_interrupt;
+
+	if (list_empty(&dep->pending_list)) {
+		dep->ioc_skipped = 0;
+		return true;
+	}
+
+	if (req->request.no_interrupt)
+		return false;
+
+	if (++dep->ioc_skipped >= dwc->trb_ioc_interval) {
+		dep->ioc_skipped = 0;
+		return true;
+	}
+
+	return false;
+}
+
 /**
  * dwc3_prepare_one_trb - setup one TRB from one request
  * @dep: endpoint for which this request is prepared
@@ -953,6 +1006,7 @@ static void dwc3_prepare_one_trb(struct dwc3_ep *dep,
 	struct dwc3		*dwc = dep->dwc;
 	struct usb_gadget	*gadget = &dwc->gadget;
 	enum usb_device_speed	speed = gadget->speed;
+	bool			ioc;
 
 	dwc3_trace(trace_dwc3_gadget, "%s: req %pK dma %08llx length %d%s",
 			dep->name, req, (unsigned long long) dma,
@@ -1040,17 +1094,26 @@ static void dwc3_prepare_one_trb(struct dwc3_ep *dep,
 		BUG();
 	}
 
+	ioc = (!chain && dwc3_gadget_want_ioc(dep, req)) ||
+		(dwc3_calc_trbs_left(dep) == 0);
+
 	/* always enable Continue on Short Packet */
 	if (usb_endpoint_dir_out(dep->endpoint.desc)) {
 		trb->ctrl |= DWC3_TRB_CTRL_CSP;
 
-		if (req->request.short_not_ok)
+		/*
+		 * A short packet ends an OUT request early; if its TRB does
+		 * not interrupt, the data could sit until the next IOC.
+		 */
+		if (req->request.short_not_ok ||
+		    (!ioc && !chain && dwc3_gadget_moderated(dep)))
 			trb->ctrl |= DWC3_TRB_CTRL_ISP_IMI;
 	}
 
-	if ((!req->request.no_interrupt && !chain) ||
-			(dwc3_calc_trbs_left(dep) == 0))
+	if (ioc)
 		trb->ctrl |= DWC3_TRB_CTRL_IOC;
+	else if (!chain)
+		dep->xfer_stats.trbs_no_ioc++;
 
 	if (chain)
 		trb->ctrl |= DWC3_TRB_CTRL_CHN;
@@ -1263,6 +1326,7 @@ static int __dwc3_gadget_kick_transfer(struct dwc3_ep *dep, u16 cmd_param)
 	}
 
 	dep->flags |= DWC3_EP_BUSY;
+	dep->xfer_stats.kicks++;
 
 	if (starting) {
 		dep->resource_index = dwc3_gadget_ep_get_transfer_index(dep);
@@ -1316,6 +1380,34 @@ static void dwc3_gadget_start_isoc(struct dwc3 *dwc,
 	__dwc3_gadget_start_isoc(dwc, dep, cur_uf);
 }
 
+/*
+ * While a moderated bulk endpoint is busy, leave new requests on the
+ * pending list until kick_batch of them are waiting, so that one Update
+ * Transfer hands them all to the controller. The completion of the TRB
+ * with IOC that the hardware still owns kicks them in any case; keep two
+ * requests in flight so the bus does not idle while the batch fills.
+ */
+static bool dwc3_gadget_defer_kick(struct dwc3_ep *dep)
+{
+	struct dwc3		*dwc = dep->dwc;
+	struct dwc3_request	*req;
+	unsigned int		pending = 0;
+
+	if (dwc->kick_batch <= 1 || !(dep->flags & DWC3_EP_BUSY) ||
+	    !usb_endpoint_xfer_bulk(dep->endpoint.desc))
+		return false;
+
+	if (list_empty(&dep->started_list) ||
+	    list_is_singular(&dep->started_list))
+		return false;
+
+	list_for_each_entry(req, &dep->pending_list, list)
+		if (++pending >= dwc->kick_batch)
+			return false;
+
+	return true;
+}
+
 static int __dwc3_gadget_ep_queue(struct dwc3_ep *dep, struct dwc3_request *req)
 {
 	struct dwc3		*dwc = dep->dwc;
@@ -1395,6 +1487,11 @@ static int __dwc3_gadget_ep_queue(struct dwc3_ep *dep, struct dwc3_request *req)
 	if (!dwc3_calc_trbs_left(dep))
 		return 0;
 
+	if (dwc3_gadget_defer_kick(dep)) {
+		dep->xfer_stats.deferred_kicks++;
+		return 0;
+	}
+
 	ret = __dwc3_gadget_kick_transfer(dep, 0);
 	if (ret && ret != -EBUSY)
 		dwc3_trace(trace_dwc3_gadget,
@@ -2479,6 +2576,7 @@ static int dwc3_gadget_init_hw_endpoints(struct dwc3 *dwc,
 			    (epnum & 1) ? "gsi-epin" : "gsi-epout", epnum >> 1);
 			/* Set ep type as GSI */
 			dep->endpoint.ep_type = EP_TYPE_GSI;
+			dep->gsi_capable = true;
 		} else {
 			snprintf(dep->name, sizeof(dep->name), "ep%d%s",
 				epnum >> 1, (epnum & 1) ? "in" : "out");
@@ -2206,10 +2206,19 @@ static ssize_t mdp3_show_twm(struct device *dev,
 static DEVICE_ATTR(twm_enable, 0664,
 		mdp3_show_twm, mdp3_store_twm);
 
+static ssize_t mdp3_show_ppp_stats(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	return mdp3_ppp_show_stats(buf, PAGE_SIZE);
+}
+
+static DEVICE_ATTR(ppp_stats, 0444, mdp3_show_ppp_stats, NULL);
+
 static struct attribute *mdp3_fs_attrs[] = {
 	&dev_attr_caps.attr,
 	&dev_attr_smart_blit.attr,
 	&dev_attr_twm_enable.attr,
+	&dev_attr_ppp_stats.attr,
 	NULL
 };
 
@@ -113,6 +113,23 @@ struct ppp_status {
 	bool bw_update;
 	bool bw_on;
 	u32 mdp_clk;
+
+	/*
+	 * A blit is left running when it is kicked off and only waited for
+	 * before the registers are programmed for the next one, so the next
+	 * blit is validated and set up while the PPP works on this one.
+	 */
+	bool ppp_busy;
+	u64 kick_ns;
+	u64 done_ns;
+
+	/* Statistics, protected by config_ppp_mutex */
+	u64 blit_count;
+	u64 busy_ns;
+	u64 active_ns;
+	u64 gap_count;
+	u64 gap_ns;
+	u64 gap_max_ns;
 };
 
 static struct ppp_status *ppp_stat;
@@ -355,6 +372,7 @@ uint32_t mdp3_calc_tpval(struct ppp_img_desc *img, uint32_t old_tp)
 
 static void mdp3_ppp_intr_handler(int type, void *arg)
 {
+	ppp_stat->done_ns = ktime_get_ns();
 	complete(&ppp_stat->ppp_comp);
 }
 
@@ -372,13 +390,41 @@ static int mdp3_ppp_callback_setup(void)
 
 void mdp3_ppp_kickoff(void)
 {
+	u64 now = ktime_get_ns();
+
+	/* Account the time the PPP sat idle since the last blit finished */
+	if (ppp_stat->done_ns) {
+		u64 gap = now - ppp_stat->done_ns;
+
+		ppp_stat->gap_count++;
+		ppp_stat->gap_ns += gap;
+		ppp_stat->gap_max_ns = max(ppp_stat->gap_max_ns, gap);
+		ppp_stat->done_ns = 0;
+	}
+
 	init_completion(&ppp_stat->ppp_comp);
 	mdp3_irq_enable(MDP3_PPP_DONE);
+	ppp_stat->kick_ns = now;
+	ppp_stat->ppp_busy = true;
 	ppp_enable();
+}
+
+/* Wait for the blit left running by mdp3_ppp_kickoff() to finish */
+void mdp3_ppp_idle(void)
+{
+	if (!ppp_stat->ppp_busy)
+		return;
+
 	ATRACE_BEGIN("mdp3_wait_for_ppp_comp");
-	mdp3_ppp_pipe_wait();
+	if (mdp3_ppp_pipe_wait())
+		ppp_stat->busy_ns += ppp_stat->done_ns - ppp_stat->kick_ns;
+	else
+		ppp_stat->done_ns = 0;
 	ATRACE_END("mdp3_wait_for_ppp_comp");
 	mdp3_irq_disable(MDP3_PPP_DONE);
+
+	ppp_stat->ppp_busy = false;
+	ppp_stat->blit_count++;
 }
 
 struct bpp_info {
@@ -699,6 +745,8 @@ int mdp3_ppp_turnon(struct msm_fb_data_type *mfd, int on_off)
 		pr_err("%s: scale_set_quota failed\n", __func__);
 		return rc;
 	}
+	if (on_off)
+		ppp_scale_tables_reset();
 	ppp_stat->bw_on = on_off;
 	ppp_stat->mdp_clk = MDP_CORE_CLK_RATE_SVS;
 	ppp_stat->bw_update = false;
@@ -708,6 +756,7 @@ int mdp3_ppp_turnon(struct msm_fb_data_type *mfd, int on_off)
 void mdp3_start_ppp(struct ppp_blit_op *blit_op)
 {
 	/* Wait for the pipe to clear */
+	mdp3_ppp_idle();
 	if (MDP3_REG_READ(MDP3_REG_DISPLAY_STATUS) &
 			MDP3_PPP_ACTIVE) {
 		pr_err("ppp core is hung up on previous request\n");
@@ -1517,6 +1566,8 @@ static void mdp3_ppp_blit_handler(struct kthread_work *work)
 	int i, rc = 0;
 	bool smart_blit = false;
 	int smart_blit_fg_index = -1;
+	unsigned long src_put, dst_put;
+	u64 start;
 
 	mutex_lock(&ppp_stat->config_ppp_mutex);
 	req = mdp3_ppp_next_req(&ppp_stat->req_q);
@@ -1533,6 +1584,9 @@ static void mdp3_ppp_blit_handler(struct kthread_work *work)
 			return;
 		}
 	}
+
+	start = ktime_get_ns();
+	ppp_stat->done_ns = 0;
 	while (req) {
 		mdp3_ppp_wait_for_fence(req);
 		mdp3_calc_ppp_res(mfd, req);
@@ -1551,6 +1605,8 @@ static void mdp3_ppp_blit_handler(struct kthread_work *work)
 			ppp_stat->bw_update = false;
 		}
 		ATRACE_BEGIN("mpd3_ppp_start");
+		/* Buffers are unmapped once the last blit of the list is done */
+		src_put = dst_put = 0;
 		for (i = 0; i < req->count; i++) {
 			smart_blit = is_blit_optimization_possible(req, i);
 			if (smart_blit)
@@ -1568,21 +1624,22 @@ static void mdp3_ppp_blit_handler(struct kthread_work *work)
 						&req->dst_data[i]);
 				}
 				/* Unmap blit source buffer */
-				if (smart_blit == false) {
-					mdp3_put_img(&req->src_data[i],
-						MDP3_CLIENT_PPP);
-				}
+				if (smart_blit == false)
+					set_bit(i, &src_put);
 				if (smart_blit_fg_index == i) {
 					/* Unmap smart blit BG buffer */
-					mdp3_put_img(&req->src_data[i - 1],
-						MDP3_CLIENT_PPP);
+					set_bit(i - 1, &src_put);
 					smart_blit_fg_index = -1;
 				}
-				mdp3_put_img(&req->dst_data[i],
-					MDP3_CLIENT_PPP);
+				set_bit(i, &dst_put);
 				smart_blit = false;
 			}
 		}
+		mdp3_ppp_idle();
+		for_each_set_bit(i, &src_put, req->count)
+			mdp3_put_img(&req->src_data[i], MDP3_CLIENT_PPP);
+		for_each_set_bit(i, &dst_put, req->count)
+			mdp3_put_img(&req->dst_data[i], MDP3_CLIENT_PPP);
 		ATRACE_END("mdp3_ppp_start");
 		/* Signal to release fence */
 		mutex_lock(&ppp_stat->req_mutex);
@@ -1593,6 +1650,8 @@ static void mdp3_ppp_blit_handler(struct kthread_work *work)
 			complete(&ppp_stat->pop_q_comp);
 		mutex_unlock(&ppp_stat->req_mutex);
 	}
+	ppp_stat->active_ns += ktime_get_ns() - start;
+	ppp_stat->done_ns = 0;
 	mod_timer(&ppp_stat->free_bw_timer, jiffies +
 		msecs_to_jiffies(MDP_RELEASE_BW_TIMEOUT));
 	mutex_unlock(&ppp_stat->config_ppp_mutex);
@@ -1700,6 +1759,34 @@ int mdp3_ppp_parse_req(void __user *p,
 	return rc;
 }
 
+ssize_t mdp3_ppp_show_stats(char *buf, size_t size)
+{
+	u64 rate = 0, gap_avg = 0;
+	ssize_t ret;
+
+	if (!ppp_stat)
+		return -ENODEV;
+
+	mutex_lock(&ppp_stat->config_ppp_mutex);
+	if (ppp_stat->active_ns)
+		rate = div64_u64(ppp_stat->blit_count * NSEC_PER_SEC,
+			ppp_stat->active_ns);
+	if (ppp_stat->gap_count)
+		gap_avg = div64_u64(ppp_stat->gap_ns, ppp_stat->gap_count);
+
+	ret = scnprintf(buf, size,
+		"blits: %llu blits/s: %llu busy: %llu us active: %llu us\n"
+		"idle gaps: %llu avg: %llu us max: %llu us\n",
+		ppp_stat->blit_count, rate,
+		div_u64(ppp_stat->busy_ns, NSEC_PER_USEC),
+		div_u64(ppp_stat->active_ns, NSEC_PER_USEC),
+		ppp_stat->gap_count, div_u64(gap_avg, NSEC_PER_USEC),
+		div_u64(ppp_stat->gap_max_ns, NSEC_PER_USEC));
+	mutex_unlock(&ppp_stat->config_ppp_mutex);
+
+	return ret;
+}
+
 int mdp3_ppp_res_init(struct msm_fb_data_type *mfd)
 {
 	int rc;
@@ -418,6 +418,7 @@ void ppp_load_up_lut(void);
 void ppp_load_gaussian_lut(void);
 void ppp_load_x_scale_table(int idx);
 void ppp_load_y_scale_table(int idx);
+void ppp_scale_tables_reset(void);
 
 int mdp3_ppp_res_init(struct msm_fb_data_type *mfd);
 int mdp3_ppp_init(void);
@@ -426,5 +427,6 @@ void ppp_enable(void);
 int mdp3_ppp_parse_req(void __user *p,
 	struct mdp_async_blit_req_list *req_list_header,
 	int async);
+ssize_t mdp3_ppp_show_stats(char *buf, size_t size);
 
 #endif
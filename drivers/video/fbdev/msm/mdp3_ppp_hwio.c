@@ -940,6 +940,45 @@ int config_ppp_lut(uint32_t *pppop_reg_ptr, int lut_c0_en,
 	return 0;
 }
 
+/*
+ * Scaling coefficients last loaded into the PPP. The tables share the
+ * coefficient RAM so they are tracked as one set, blits that scale the
+ * same way in a row skip reloading them.
+ */
+static struct ppp_scale_tables {
+	bool valid;
+	bool up;
+	bool blur;
+	int x_idx;
+	int y_idx;
+} ppp_scale_loaded;
+
+void ppp_scale_tables_reset(void)
+{
+	ppp_scale_loaded.valid = false;
+}
+
+static void ppp_load_scale_tables(struct ppp_scale_tables *tables)
+{
+	if (ppp_scale_loaded.valid &&
+		ppp_scale_loaded.up == tables->up &&
+		ppp_scale_loaded.blur == tables->blur &&
+		ppp_scale_loaded.x_idx == tables->x_idx &&
+		ppp_scale_loaded.y_idx == tables->y_idx)
+		return;
+
+	if (tables->up)
+		ppp_load_up_lut();
+	if (tables->blur)
+		ppp_load_gaussian_lut();
+	if (tables->x_idx >= 0)
+		ppp_load_x_scale_table(tables->x_idx);
+	if (tables->y_idx >= 0)
+		ppp_load_y_scale_table(tables->y_idx);
+
+	ppp_scale_loaded = *tables;
+}
+
 int config_ppp_scale(struct ppp_blit_op *blit_op, uint32_t *pppop_reg_ptr)
 {
 	struct ppp_img_desc *src = &blit_op->src;
@@ -948,7 +987,11 @@ int config_ppp_scale(struct ppp_blit_op *blit_op, uint32_t *pppop_reg_ptr)
 	uint32_t x_fac, y_fac;
 	uint32_t mdp_blur = 0;
 	uint32_t phase_init_x, phase_init_y, phase_step_x, phase_step_y;
-	int x_idx, y_idx;
+	struct ppp_scale_tables tables = {
+		.valid = true,
+		.x_idx = -1,
+		.y_idx = -1,
+	};
 
 	if (blit_op->mdp_op & MDPOP_ASCALE) {
 		if (blit_op->mdp_op & MDPOP_ROT90) {
@@ -987,22 +1030,22 @@ int config_ppp_scale(struct ppp_blit_op *blit_op, uint32_t *pppop_reg_ptr)
 
 
 			if (dstW > src->roi.width || dstH > src->roi.height)
-				ppp_load_up_lut();
+				tables.up = true;
 
 			if (mdp_blur)
-				ppp_load_gaussian_lut();
+				tables.blur = true;
 
 			if (dstW <= src->roi.width) {
 				x_fac = (dstW * 100) / src->roi.width;
-				x_idx = scale_idx(x_fac);
-				ppp_load_x_scale_table(x_idx);
+				tables.x_idx = scale_idx(x_fac);
 			}
 			if (dstH <= src->roi.height) {
 				y_fac = (dstH * 100) / src->roi.height;
-				y_idx = scale_idx(y_fac);
-				ppp_load_y_scale_table(y_idx);
+				tables.y_idx = scale_idx(y_fac);
 			}
 
+			ppp_load_scale_tables(&tables);
+
 		} else {
 			blit_op->mdp_op &= ~(MDPOP_ASCALE);
 		}
@@ -1357,6 +1400,7 @@ void ppp_enable(void)
 
 int mdp3_ppp_init(void)
 {
+	ppp_scale_tables_reset();
 	load_ppp_lut(LUT_PRE_TABLE, ppp_default_pre_lut());
 	load_ppp_lut(LUT_POST_TABLE, ppp_default_post_lut());
 	load_csc_matrix(CSC_PRIMARY_MATRIX, ppp_csc_rgb2yuv());
@@ -416,10 +416,14 @@ struct mdss_data_type {
 	u32 enable_gate;
 	u32 enable_bw_release;
 	u32 enable_rotator_bw_release;
+	bool enable_idle_bw_decay;
 	u32 enable_cdp;
 	u32 serialize_wait4pp;
 	u32 wait4autorefresh;
 	u32 lines_before_active;
+	/* commits whose bandwidth solution was reused from the last one */
+	u32 perf_cache_hits;
+	u32 perf_cache_misses;
 
 	struct mdss_hw_settings *hw_settings;
 
@@ -471,6 +475,10 @@ struct mdss_data_type {
 	u32 ad_debugen;
 	bool mem_retain;
 
+	/* DSPP LUT config writes dropped as unchanged, and entries saved */
+	u32 pp_lut_skip_cnt;
+	u64 pp_lut_writes_avoided;
+
 	struct mdss_intr hist_intr;
 
 	struct ion_client *iclient;
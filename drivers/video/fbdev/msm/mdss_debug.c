@@ -1246,6 +1246,9 @@ static int mdss_debugfs_perf_init(struct mdss_debug_data *mdd,
 	debugfs_create_bool("enable_rotator_bw_release", 0644, mdd->perf,
 		(bool *)&mdata->enable_rotator_bw_release);
 
+	debugfs_create_bool("enable_idle_bw_decay", 0644, mdd->perf,
+		&mdata->enable_idle_bw_decay);
+
 	debugfs_create_file("ab_factor", 0644, mdd->perf,
 		&mdata->ab_factor, &mdss_factor_fops);
 
@@ -1281,6 +1284,12 @@ static int mdss_debugfs_perf_init(struct mdss_debug_data *mdd,
 	debugfs_create_u32("lines_before_active", 0644, mdd->perf,
 		(u32 *)&mdata->lines_before_active);
 
+	debugfs_create_u32("validate_cache_hits", 0444, mdd->perf,
+		(u32 *)&mdata->perf_cache_hits);
+
+	debugfs_create_u32("validate_cache_misses", 0444, mdd->perf,
+		(u32 *)&mdata->perf_cache_misses);
+
 	return 0;
 }
 
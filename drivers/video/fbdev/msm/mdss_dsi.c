@@ -1288,6 +1288,16 @@ static int mdss_dsi_debugfs_setup(struct mdss_panel_data *pdata,
 		&dfs_ctrl->cmd_sync_wait_broadcast);
 	debugfs_create_bool("cmd_sync_wait_trigger", 0644, dfs->root,
 		&dfs_ctrl->cmd_sync_wait_trigger);
+	debugfs_create_bool("cmd_dma_batch", 0644, dfs->root,
+		&ctrl_pdata->cmd_dma_batch);
+	debugfs_create_u32("on_cmds_us", 0444, dfs->root,
+		&ctrl_pdata->on_latency.last_us);
+	debugfs_create_u32("on_cmds_max_us", 0444, dfs->root,
+		&ctrl_pdata->on_latency.max_us);
+	debugfs_create_u32("off_cmds_us", 0444, dfs->root,
+		&ctrl_pdata->off_latency.last_us);
+	debugfs_create_u32("off_cmds_max_us", 0444, dfs->root,
+		&ctrl_pdata->off_latency.max_us);
 
 	debugfs_create_file("dsi_on_cmd_state", 0644, dfs->root,
 		&dfs_ctrl->on_cmds.link_state, &mdss_dsi_cmd_state_fop);
@@ -4382,6 +4392,9 @@ static int mdss_dsi_parse_ctrl_params(struct platform_device *ctrl_pdev,
 				ctrl_pdata->cmd_sync_wait_broadcast,
 				ctrl_pdata->cmd_sync_wait_trigger);
 
+	ctrl_pdata->cmd_dma_batch = of_property_read_bool(
+		pan_node, "qcom,mdss-dsi-cmd-dma-batch");
+
 	mdss_dsi_parse_lane_swap(ctrl_pdev->dev.of_node,
 			&(ctrl_pdata->dlane_swap));
 
@@ -407,6 +407,12 @@ struct dsi_err_container {
 #define MDSS_DSI_COMMAND_COMPRESSION_MODE_CTRL3	0x02b0
 #define MSM_DBA_CHIP_NAME_MAX_LEN				20
 
+/* Time it took to send a panel command set, in microseconds */
+struct dsi_cmd_latency {
+	u32 last_us;
+	u32 max_us;
+};
+
 struct mdss_dsi_ctrl_pdata {
 	int ndx;	/* panel_num */
 	int (*on)(struct mdss_panel_data *pdata);
@@ -468,6 +474,9 @@ struct mdss_dsi_ctrl_pdata {
 
 	bool cmd_sync_wait_broadcast;
 	bool cmd_sync_wait_trigger;
+	bool cmd_dma_batch;
+	struct dsi_cmd_latency on_latency;
+	struct dsi_cmd_latency off_latency;
 
 	struct mdss_rect roi;
 	struct pwm_device *pwm_bl;
@@ -1837,13 +1837,58 @@ static int mdss_dsi_cmd_dma_tpg_tx(struct mdss_dsi_ctrl_pdata *ctrl,
 	return ret;
 }
 
+/*
+ * Kick off the packets queued in @tp, @cm being the last of them, and
+ * honour its wait. Returns false if the transfer failed.
+ */
+static bool mdss_dsi_cmds2buf_kickoff(struct mdss_dsi_ctrl_pdata *ctrl,
+			struct dsi_buf *tp, struct dsi_cmd_desc *cm,
+			int use_dma_tpg)
+{
+	struct dsi_ctrl_hdr *dchdr = &cm->dchdr;
+	int len, wait;
+
+	tp->data = tp->start; /* begin of buf */
+
+	wait = mdss_dsi_wait4video_eng_busy(ctrl);
+
+	mdss_dsi_enable_irq(ctrl, DSI_CMD_TERM);
+	if (use_dma_tpg)
+		len = mdss_dsi_cmd_dma_tpg_tx(ctrl, tp);
+	else
+		len = mdss_dsi_cmd_dma_tx(ctrl, tp);
+	if (IS_ERR_VALUE((unsigned long)len)) {
+		mdss_dsi_disable_irq(ctrl, DSI_CMD_TERM);
+		pr_err("%s: failed to call cmd_dma_tx for cmd = 0x%x\n",
+			__func__,  cm->payload[0]);
+		return false;
+	}
+	pr_debug("%s: cmd_dma_tx for cmd = 0x%x, len = %d\n",
+			__func__,  cm->payload[0], len);
+
+	if (!wait || dchdr->wait > VSYNC_PERIOD)
+		usleep_range((dchdr->wait * 1000),
+			     (dchdr->wait * 1000) + 10);
+
+	mdss_dsi_buf_init(tp);
+	return true;
+}
+
+/*
+ * Commands are normally sent in the groups the panel's command set ends
+ * with a "last" flag. With cmd_dma_batch, as many commands as fit in the
+ * tx buffer go out in one DMA transfer instead, only breaking the batch
+ * after a command that has to be followed by a wait or an ack.
+ */
 static int mdss_dsi_cmds2buf_tx(struct mdss_dsi_ctrl_pdata *ctrl,
 			struct dsi_cmd_desc *cmds, int cnt, int use_dma_tpg)
 {
 	struct dsi_buf *tp;
 	struct dsi_cmd_desc *cm;
 	struct dsi_ctrl_hdr *dchdr;
-	int len, wait, tot = 0;
+	int len, tot = 0;
+	bool batch = ctrl->cmd_dma_batch && !use_dma_tpg;
+	bool last;
 
 	tp = &ctrl->tx_buf;
 	mdss_dsi_buf_init(tp);
@@ -1851,6 +1896,15 @@ static int mdss_dsi_cmds2buf_tx(struct mdss_dsi_ctrl_pdata *ctrl,
 	len = 0;
 	while (cnt--) {
 		dchdr = &cm->dchdr;
+		/* Header plus payload padded to a word, see cmd_dma_add */
+		if (batch && len && (tp->data + len + DSI_HOST_HDR_SIZE +
+				ALIGN(dchdr->dlen, 4) > tp->end)) {
+			*tp->hdr |= DSI_HDR_LAST;
+			if (!mdss_dsi_cmds2buf_kickoff(ctrl, tp, cm - 1,
+						       use_dma_tpg))
+				return 0;
+			len = 0;
+		}
 		mdss_dsi_buf_reserve(tp, len);
 		len = mdss_dsi_cmd_dma_add(tp, cm);
 		if (!len) {
@@ -1859,30 +1913,18 @@ static int mdss_dsi_cmds2buf_tx(struct mdss_dsi_ctrl_pdata *ctrl,
 			return 0;
 		}
 		tot += len;
-		if (dchdr->last) {
-			tp->data = tp->start; /* begin of buf */
-
-			wait = mdss_dsi_wait4video_eng_busy(ctrl);
-
-			mdss_dsi_enable_irq(ctrl, DSI_CMD_TERM);
-			if (use_dma_tpg)
-				len = mdss_dsi_cmd_dma_tpg_tx(ctrl, tp);
+		last = dchdr->last;
+		if (batch) {
+			last = !cnt || dchdr->wait || dchdr->ack;
+			if (last)
+				*tp->hdr |= DSI_HDR_LAST;
 			else
-				len = mdss_dsi_cmd_dma_tx(ctrl, tp);
-			if (IS_ERR_VALUE((unsigned long)len)) {
-				mdss_dsi_disable_irq(ctrl, DSI_CMD_TERM);
-				pr_err("%s: failed to call cmd_dma_tx for cmd = 0x%x\n",
-					__func__,  cm->payload[0]);
+				*tp->hdr &= ~DSI_HDR_LAST;
+		}
+		if (last) {
+			if (!mdss_dsi_cmds2buf_kickoff(ctrl, tp, cm,
+						       use_dma_tpg))
 				return 0;
-			}
-			pr_debug("%s: cmd_dma_tx for cmd = 0x%x, len = %d\n",
-					__func__,  cm->payload[0], len);
-
-			if (!wait || dchdr->wait > VSYNC_PERIOD)
-				usleep_range((dchdr->wait * 1000),
-					     (dchdr->wait * 1000) + 10);
-
-			mdss_dsi_buf_init(tp);
 			len = 0;
 		}
 		cm++;
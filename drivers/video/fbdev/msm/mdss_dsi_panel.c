@@ -922,6 +922,18 @@ static void mdss_dsi_panel_on_hdmi(struct mdss_dsi_ctrl_pdata *ctrl,
 }
 #endif
 
+static void mdss_dsi_panel_cmds_send_timed(struct mdss_dsi_ctrl_pdata *ctrl,
+			struct dsi_panel_cmds *pcmds,
+			struct dsi_cmd_latency *latency)
+{
+	ktime_t start = ktime_get();
+
+	mdss_dsi_panel_cmds_send(ctrl, pcmds, CMD_REQ_COMMIT);
+
+	latency->last_us = ktime_us_delta(ktime_get(), start);
+	latency->max_us = max(latency->max_us, latency->last_us);
+}
+
 static int mdss_dsi_panel_on(struct mdss_panel_data *pdata)
 {
 	struct mdss_dsi_ctrl_pdata *ctrl = NULL;
@@ -977,7 +989,8 @@ static int mdss_dsi_panel_on(struct mdss_panel_data *pdata)
 				ctrl->ndx, on_cmds->cmd_cnt);
 
 	if (on_cmds->cmd_cnt)
-		mdss_dsi_panel_cmds_send(ctrl, on_cmds, CMD_REQ_COMMIT);
+		mdss_dsi_panel_cmds_send_timed(ctrl, on_cmds,
+					       &ctrl->on_latency);
 
 
 	if (!change_par_ctrl){
@@ -1209,7 +1222,8 @@ static int mdss_dsi_panel_off(struct mdss_panel_data *pdata)
 	}
 
 	if (ctrl->off_cmds.cmd_cnt)
-		mdss_dsi_panel_cmds_send(ctrl, &ctrl->off_cmds, CMD_REQ_COMMIT);
+		mdss_dsi_panel_cmds_send_timed(ctrl, &ctrl->off_cmds,
+					       &ctrl->off_latency);
 
 	mdss_dsi_panel_off_hdmi(ctrl, pinfo);
 
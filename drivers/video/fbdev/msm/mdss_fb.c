@@ -45,6 +45,7 @@
 #include <linux/file.h>
 #include <linux/kthread.h>
 #include <linux/dma-buf.h>
+#include <linux/cpufreq.h>
 #include "mdss_fb.h"
 #include "mdss_mdp_splash_logo.h"
 #define CREATE_TRACE_POINTS
@@ -129,6 +130,8 @@ static int __mdss_fb_sync_buf_done_callback(struct notifier_block *p,
 
 static int __mdss_fb_display_thread(void *data);
 static int mdss_fb_pan_idle(struct msm_fb_data_type *mfd);
+static int mdss_fb_immediate_mode_switch(struct msm_fb_data_type *mfd,
+	u32 mode);
 static int mdss_fb_send_panel_event(struct msm_fb_data_type *mfd,
 					int event, void *arg);
 static void mdss_fb_set_mdp_sync_pt_threshold(struct msm_fb_data_type *mfd,
@@ -574,6 +577,18 @@ static void __mdss_fb_idle_notify_work(struct work_struct *work)
 	if (mfd->idle_time)
 		sysfs_notify(&mfd->fbi->dev->kobj, NULL, "idle_notify");
 	mfd->idle_state = MDSS_FB_IDLE;
+
+	if (mfd->mdp.idle_notify_fnc)
+		mfd->mdp.idle_notify_fnc(mfd);
+
+	/*
+	 * Ask for the switch to panel self refresh now, the refresh frame
+	 * the idle notification usually triggers will carry it out.
+	 */
+	if (mfd->auto_self_refresh && mfd->panel.type == MIPI_VIDEO_PANEL &&
+	    mfd->switch_state == MDSS_MDP_NO_UPDATE_REQUESTED &&
+	    !mdss_fb_immediate_mode_switch(mfd, 1))
+		mfd->self_refresh_active = true;
 }
 
 
@@ -624,6 +639,76 @@ static ssize_t mdss_fb_set_idle_time(struct device *dev,
 	return count;
 }
 
+static ssize_t mdss_fb_get_auto_self_refresh(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = fbi->par;
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", mfd->auto_self_refresh);
+}
+
+static ssize_t mdss_fb_set_auto_self_refresh(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = fbi->par;
+	bool enable;
+	int rc;
+
+	rc = kstrtobool(buf, &enable);
+	if (rc) {
+		pr_err("kstrtobool failed. rc=%d\n", rc);
+		return rc;
+	}
+
+	if (enable && mfd->panel_info->mipi.dms_mode !=
+			DYNAMIC_MODE_SWITCH_IMMEDIATE) {
+		pr_err("panel does not support immediate mode switch\n");
+		return -EINVAL;
+	}
+
+	mfd->auto_self_refresh = enable;
+
+	return count;
+}
+
+static ssize_t mdss_fb_get_commit_stats(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = fbi->par;
+	struct msm_fb_commit_stats stats;
+
+	spin_lock(&mfd->commit_stats_lock);
+	stats = mfd->commit_stats;
+	spin_unlock(&mfd->commit_stats_lock);
+
+	return scnprintf(buf, PAGE_SIZE,
+		"pending=%d max_pending=%u\n"
+		"commits=%u latency_us last=%llu max=%llu avg=%llu\n"
+		"waits=%u wait_us max=%llu avg=%llu\n",
+		atomic_read(&mfd->commits_pending), stats.max_pending,
+		stats.count, stats.last_latency_us, stats.max_latency_us,
+		stats.count ? div_u64(stats.total_latency_us, stats.count) : 0,
+		stats.wait_count, stats.max_wait_us,
+		stats.wait_count ?
+			div_u64(stats.total_wait_us, stats.wait_count) : 0);
+}
+
+static ssize_t mdss_fb_reset_commit_stats(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = fbi->par;
+
+	spin_lock(&mfd->commit_stats_lock);
+	memset(&mfd->commit_stats, 0, sizeof(mfd->commit_stats));
+	spin_unlock(&mfd->commit_stats_lock);
+
+	return count;
+}
+
 static ssize_t mdss_fb_get_idle_notify(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -1153,6 +1238,10 @@ static DEVICE_ATTR(show_blank_event, 0444, mdss_mdp_show_blank_event, NULL);
 static DEVICE_ATTR(idle_time, 0644,
 	mdss_fb_get_idle_time, mdss_fb_set_idle_time);
 static DEVICE_ATTR(idle_notify, 0444, mdss_fb_get_idle_notify, NULL);
+static DEVICE_ATTR(commit_stats, 0644,
+	mdss_fb_get_commit_stats, mdss_fb_reset_commit_stats);
+static DEVICE_ATTR(auto_self_refresh, 0644,
+	mdss_fb_get_auto_self_refresh, mdss_fb_set_auto_self_refresh);
 static DEVICE_ATTR(msm_fb_panel_info, 0444, mdss_fb_get_panel_info, NULL);
 static DEVICE_ATTR(msm_fb_src_split_info, 0444, mdss_fb_get_src_split_info,
 	NULL);
@@ -1185,6 +1274,8 @@ static struct attribute *mdss_fb_attrs[] = {
 	&dev_attr_msm_fb_split.attr,
 	&dev_attr_show_blank_event.attr,
 	&dev_attr_idle_time.attr,
+	&dev_attr_auto_self_refresh.attr,
+	&dev_attr_commit_stats.attr,
 	&dev_attr_idle_notify.attr,
 	&dev_attr_msm_fb_panel_info.attr,
 	&dev_attr_msm_fb_src_split_info.attr,
@@ -3114,6 +3205,7 @@ static int mdss_fb_register(struct msm_fb_data_type *mfd)
 	init_waitqueue_head(&mfd->ioctl_q);
 	init_waitqueue_head(&mfd->kickoff_wait_q);
 	init_waitqueue_head(&mfd->resume_wait_q);
+	spin_lock_init(&mfd->commit_stats_lock);
 
 	ret = fb_alloc_cmap(&fbi->cmap, 256, 0);
 	if (ret)
@@ -3547,6 +3639,49 @@ static int __mdss_fb_sync_buf_done_callback(struct notifier_block *p,
 	return ret;
 }
 
+/*
+ * Called with the sync mutex held when a commit is handed to the display
+ * thread, commits_pending already accounts for it.
+ */
+static void mdss_fb_commit_queued(struct msm_fb_data_type *mfd)
+{
+	u32 pending = atomic_read(&mfd->commits_pending);
+
+	mfd->msm_fb_backup.queue_time = ktime_get();
+
+	spin_lock(&mfd->commit_stats_lock);
+	mfd->commit_stats.max_pending =
+		max(mfd->commit_stats.max_pending, pending);
+	spin_unlock(&mfd->commit_stats_lock);
+}
+
+static void mdss_fb_commit_kicked_off(struct msm_fb_data_type *mfd,
+		ktime_t queue_time)
+{
+	struct msm_fb_commit_stats *stats = &mfd->commit_stats;
+	u64 latency = ktime_us_delta(ktime_get(), queue_time);
+
+	spin_lock(&mfd->commit_stats_lock);
+	stats->count++;
+	stats->last_latency_us = latency;
+	stats->max_latency_us = max(stats->max_latency_us, latency);
+	stats->total_latency_us += latency;
+	spin_unlock(&mfd->commit_stats_lock);
+}
+
+static void mdss_fb_kickoff_waited(struct msm_fb_data_type *mfd,
+		ktime_t start)
+{
+	struct msm_fb_commit_stats *stats = &mfd->commit_stats;
+	u64 wait = ktime_us_delta(ktime_get(), start);
+
+	spin_lock(&mfd->commit_stats_lock);
+	stats->wait_count++;
+	stats->max_wait_us = max(stats->max_wait_us, wait);
+	stats->total_wait_us += wait;
+	spin_unlock(&mfd->commit_stats_lock);
+}
+
 /**
  * mdss_fb_pan_idle() - wait for panel programming to be idle
  * @mfd:	Framebuffer data structure for display
@@ -3582,10 +3717,14 @@ static int mdss_fb_pan_idle(struct msm_fb_data_type *mfd)
 
 static int mdss_fb_wait_for_kickoff(struct msm_fb_data_type *mfd)
 {
+	ktime_t start = ktime_get();
 	int ret = 0;
 
-	if (!mfd->wait_for_kickoff)
-		return mdss_fb_pan_idle(mfd);
+	if (!mfd->wait_for_kickoff) {
+		ret = mdss_fb_pan_idle(mfd);
+		mdss_fb_kickoff_waited(mfd, start);
+		return ret;
+	}
 
 	ret = wait_event_timeout(mfd->kickoff_wait_q,
 			(!atomic_read(&mfd->kickoff_pending) ||
@@ -3605,6 +3744,7 @@ static int mdss_fb_wait_for_kickoff(struct msm_fb_data_type *mfd)
 	} else {
 		ret = 0;
 	}
+	mdss_fb_kickoff_waited(mfd, start);
 
 	return ret;
 }
@@ -3660,6 +3800,7 @@ static int mdss_fb_pan_display_ex(struct fb_info *info,
 
 	atomic_inc(&mfd->commits_pending);
 	atomic_inc(&mfd->kickoff_pending);
+	mdss_fb_commit_queued(mfd);
 	wake_up_all(&mfd->commit_wait_q);
 	mutex_unlock(&mfd->mdp_sync_pt_data.sync_mutex);
 	if (wait_for_finish) {
@@ -3724,6 +3865,39 @@ static int __ioctl_transition_dyn_mode_state(struct msm_fb_data_type *mfd,
 	return 0;
 }
 
+/*
+ * mdss_fb_auto_self_refresh() - move static content to panel self refresh
+ * @mfd:	Framebuffer data structure for display
+ * @commit:	Commit version-1 structure for display
+ *
+ * A video mode interface fetches the whole frame from memory on every
+ * vsync whether or not it changed, so there is nothing to skip there. On
+ * panels supporting immediate dynamic mode switch, switch to command mode
+ * once a commit doesn't change anything, letting the panel refresh itself
+ * from its own memory, and go back to video mode on the next real update.
+ */
+static void mdss_fb_auto_self_refresh(struct msm_fb_data_type *mfd,
+		struct mdp_layer_commit_v1 *commit)
+{
+	bool dirty;
+
+	if (!mfd->auto_self_refresh || !mfd->mdp.frame_dirty)
+		return;
+
+	dirty = mfd->mdp.frame_dirty(mfd, commit);
+	if (mfd->switch_state != MDSS_MDP_NO_UPDATE_REQUESTED)
+		return;
+
+	if (mfd->panel.type == MIPI_VIDEO_PANEL && !dirty) {
+		if (!mdss_fb_immediate_mode_switch(mfd, 1))
+			mfd->self_refresh_active = true;
+	} else if (mfd->panel.type == MIPI_CMD_PANEL &&
+			mfd->self_refresh_active && dirty) {
+		if (!mdss_fb_immediate_mode_switch(mfd, 0))
+			mfd->self_refresh_active = false;
+	}
+}
+
 static inline bool mdss_fb_is_wb_config_same(struct msm_fb_data_type *mfd,
 		struct mdp_output_layer *output_layer)
 {
@@ -3809,6 +3983,7 @@ int mdss_fb_atomic_commit(struct fb_info *info,
 		if (ret) {
 			pr_err("wait for kickoff failed\n");
 		} else {
+			mdss_fb_auto_self_refresh(mfd, commit_v1);
 			__ioctl_transition_dyn_mode_state(mfd,
 				MSMFB_ATOMIC_COMMIT, true, false);
 			if (mfd->panel.type == WRITEBACK_PANEL) {
@@ -3849,6 +4024,7 @@ int mdss_fb_atomic_commit(struct fb_info *info,
 			pr_err("atomic pre commit failed\n");
 			goto end;
 		}
+		cpufreq_interactive_boost_trigger(CPUFREQ_BOOST_FB_COMMIT);
 	}
 
 	wait_for_finish = commit_v1->flags & MDP_COMMIT_WAIT_FOR_FINISH;
@@ -3869,6 +4045,7 @@ int mdss_fb_atomic_commit(struct fb_info *info,
 	atomic_inc(&mfd->mdp_sync_pt_data.commit_cnt);
 	atomic_inc(&mfd->commits_pending);
 	atomic_inc(&mfd->kickoff_pending);
+	mdss_fb_commit_queued(mfd);
 	wake_up_all(&mfd->commit_wait_q);
 	mutex_unlock(&mfd->mdp_sync_pt_data.sync_mutex);
 
@@ -4147,6 +4324,7 @@ static int __mdss_fb_display_thread(void *data)
 	struct msm_fb_data_type *mfd = data;
 	int ret;
 	struct sched_param param;
+	ktime_t queue_time;
 
 	/*
 	 * this priority was found during empiric testing to have appropriate
@@ -4167,9 +4345,13 @@ static int __mdss_fb_display_thread(void *data)
 		if (kthread_should_stop())
 			break;
 
+		/* the next commit may be queued as soon as this one kicks off */
+		queue_time = mfd->msm_fb_backup.queue_time;
+
 		MDSS_XLOG(mfd->index, XLOG_FUNC_ENTRY);
 		ret = __mdss_fb_perform_commit(mfd);
 		MDSS_XLOG(mfd->index, XLOG_FUNC_EXIT);
+		mdss_fb_commit_kicked_off(mfd, queue_time);
 
 		atomic_dec(&mfd->commits_pending);
 		wake_up_all(&mfd->idle_wait_q);
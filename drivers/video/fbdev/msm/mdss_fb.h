@@ -209,6 +209,8 @@ struct msm_mdp_interface {
 					struct mdp_display_commit *data);
 	int (*atomic_validate)(struct msm_fb_data_type *mfd, struct file *file,
 				struct mdp_layer_commit_v1 *commit);
+	bool (*frame_dirty)(struct msm_fb_data_type *mfd,
+				struct mdp_layer_commit_v1 *commit);
 	bool (*is_config_same)(struct msm_fb_data_type *mfd,
 				struct mdp_output_layer *layer);
 	int (*pre_commit)(struct msm_fb_data_type *mfd, struct file *file,
@@ -236,6 +238,7 @@ struct msm_mdp_interface {
 	int (*pp_release_fnc)(struct msm_fb_data_type *mfd);
 	void (*signal_retire_fence)(struct msm_fb_data_type *mfd,
 					int retire_cnt);
+	void (*idle_notify_fnc)(struct msm_fb_data_type *mfd);
 	bool (*is_twm_en)(void);
 	void *private1;
 };
@@ -259,6 +262,29 @@ struct msm_fb_backup_type {
 	struct fb_info info;
 	struct mdp_display_commit disp_commit;
 	bool   atomic_commit;
+	ktime_t queue_time;
+};
+
+/*
+ * struct msm_fb_commit_stats - commit pacing statistics
+ * @count:		commits handed to the display thread
+ * @max_pending:	most commits seen pending at once
+ * @last_latency_us:	queue to kickoff time of the last commit
+ * @max_latency_us:	worst queue to kickoff time
+ * @total_latency_us:	sum of queue to kickoff times
+ * @wait_count:		number of waits for the previous kickoff
+ * @max_wait_us:	longest time a caller blocked on the previous kickoff
+ * @total_wait_us:	sum of the time callers blocked on previous kickoffs
+ */
+struct msm_fb_commit_stats {
+	u32 count;
+	u32 max_pending;
+	u64 last_latency_us;
+	u64 max_latency_us;
+	u64 total_latency_us;
+	u32 wait_count;
+	u64 max_wait_us;
+	u64 total_wait_us;
 };
 
 struct msm_fb_fps_info {
@@ -285,6 +311,9 @@ struct msm_fb_data_type {
 
 	int idle_time;
 	u32 idle_state;
+	/* park video panels in command mode while the screen is static */
+	bool auto_self_refresh;
+	bool self_refresh_active;
 	struct msm_fb_fps_info fps_info;
 	struct delayed_work idle_notify_work;
 
@@ -355,6 +384,8 @@ struct msm_fb_data_type {
 	atomic_t ioctl_ref_cnt;
 
 	struct msm_fb_backup_type msm_fb_backup;
+	struct msm_fb_commit_stats commit_stats;
+	spinlock_t commit_stats_lock;
 	struct completion power_set_comp;
 	u32 is_power_setting;
 
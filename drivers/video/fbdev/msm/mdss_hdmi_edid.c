@@ -62,6 +62,10 @@
 #define EDID_VENDOR_ID_SIZE     4
 #define EDID_IEEE_REG_ID        0x0c03
 
+/* Manufacturer, product code and serial number in block 0 */
+#define EDID_ID_OFFSET		0x08
+#define EDID_ID_SIZE		10
+
 enum edid_sink_mode {
 	SINK_MODE_DVI,
 	SINK_MODE_HDMI
@@ -114,6 +118,18 @@ struct hdmi_edid_sink_caps {
 	bool ind_view_support;
 };
 
+/*
+ * Sink a parsed EDID belongs to, identified by the checksum of each block
+ * and the product id, so that a sink plugged in again or found on resume
+ * isn't parsed again.
+ */
+struct hdmi_edid_cache {
+	bool valid;
+	u8 blks;
+	u8 checksum[MAX_EDID_BLOCKS];
+	u8 id[EDID_ID_SIZE];
+};
+
 struct hdmi_edid_override_data {
 	int scramble;
 	int sink_mode;
@@ -142,11 +158,15 @@ struct hdmi_edid_ctrl {
 	char vendor_id[EDID_VENDOR_ID_SIZE];
 	bool keep_resv_timings;
 	bool edid_override;
+	bool cache_hit;
+	u32 parse_count;
+	u32 cache_hit_count;
 
 	struct hdmi_edid_sink_data sink_data;
 	struct hdmi_edid_init_data init_data;
 	struct hdmi_edid_sink_caps sink_caps;
 	struct hdmi_edid_override_data override_data;
+	struct hdmi_edid_cache cache;
 };
 
 static bool hdmi_edid_is_mode_supported(struct hdmi_edid_ctrl *edid_ctrl,
@@ -770,14 +790,35 @@ static ssize_t hdmi_edid_sysfs_wta_add_resolution(struct device *dev,
 	}
 
 	edid_ctrl->keep_resv_timings = true;
+	edid_ctrl->cache.valid = false;
 	return ret;
 
 err:
 	edid_ctrl->keep_resv_timings = false;
+	edid_ctrl->cache.valid = false;
 	return -EFAULT;
 }
 static DEVICE_ATTR(add_res, 0200, NULL, hdmi_edid_sysfs_wta_add_resolution);
 
+static ssize_t hdmi_edid_sysfs_rda_cache(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	ssize_t ret;
+	struct hdmi_edid_ctrl *edid_ctrl = hdmi_edid_get_ctrl(dev);
+
+	if (!edid_ctrl) {
+		DEV_ERR("%s: invalid input\n", __func__);
+		return -EINVAL;
+	}
+
+	ret = scnprintf(buf, PAGE_SIZE, "parsed: %u\ncached: %u\nlast: %s\n",
+		edid_ctrl->parse_count, edid_ctrl->cache_hit_count,
+		edid_ctrl->cache_hit ? "cached" : "parsed");
+
+	return ret;
+} /* hdmi_edid_sysfs_rda_cache */
+static DEVICE_ATTR(edid_cache, 0444, hdmi_edid_sysfs_rda_cache, NULL);
+
 static struct attribute *hdmi_edid_fs_attrs[] = {
 	&dev_attr_edid_modes.attr,
 	&dev_attr_pa.attr,
@@ -791,6 +832,7 @@ static struct attribute *hdmi_edid_fs_attrs[] = {
 	&dev_attr_res_info.attr,
 	&dev_attr_res_info_data.attr,
 	&dev_attr_add_res.attr,
+	&dev_attr_edid_cache.attr,
 	NULL,
 };
 
@@ -2139,6 +2181,36 @@ u32 hdmi_edid_get_raw_data(void *input, u8 *buf, u32 size)
 	return ret;
 }
 
+static void hdmi_edid_cache_key(struct hdmi_edid_ctrl *edid_ctrl,
+	struct hdmi_edid_cache *key)
+{
+	u8 *edid_buf = edid_ctrl->edid_buf;
+	u32 i;
+
+	memset(key, 0, sizeof(*key));
+
+	key->blks = min_t(u8, edid_buf[EDID_BLOCK_SIZE - 2],
+		MAX_EDID_BLOCKS - 1);
+	for (i = 0; i <= key->blks; i++)
+		key->checksum[i] = edid_buf[(i + 1) * EDID_BLOCK_SIZE - 1];
+	memcpy(key->id, edid_buf + EDID_ID_OFFSET, EDID_ID_SIZE);
+}
+
+/* Return true if the EDID in edid_buf is the one parsed last time */
+static bool hdmi_edid_cache_match(struct hdmi_edid_ctrl *edid_ctrl)
+{
+	struct hdmi_edid_cache key;
+
+	if (!edid_ctrl->cache.valid ||
+		!hdmi_edid_check_header(edid_ctrl->edid_buf))
+		return false;
+
+	hdmi_edid_cache_key(edid_ctrl, &key);
+	key.valid = true;
+
+	return !memcmp(&key, &edid_ctrl->cache, sizeof(key));
+}
+
 static void hdmi_edid_add_resv_timings(struct hdmi_edid_ctrl *edid_ctrl)
 {
 	int i = HDMI_VFRMT_RESERVE1;
@@ -2167,6 +2239,19 @@ int hdmi_edid_parser(void *input)
 		goto err_invalid_data;
 	}
 
+	edid_ctrl->parse_count++;
+
+	/* the same sink again, keep what was parsed from it last time */
+	if (hdmi_edid_cache_match(edid_ctrl)) {
+		DEV_DBG("%s: EDID unchanged, skipping parse\n", __func__);
+		edid_ctrl->page_id = MSM_HDMI_INIT_RES_PAGE;
+		edid_ctrl->video_resolution = edid_ctrl->default_vic;
+		edid_ctrl->cache_hit = true;
+		edid_ctrl->cache_hit_count++;
+		return 0;
+	}
+	edid_ctrl->cache_hit = false;
+
 	/* reset edid data for new hdmi connection */
 	hdmi_edid_reset_parser(edid_ctrl);
 
@@ -2242,6 +2327,9 @@ int hdmi_edid_parser(void *input)
 	if (edid_ctrl->keep_resv_timings)
 		hdmi_edid_add_resv_timings(edid_ctrl);
 
+	hdmi_edid_cache_key(edid_ctrl, &edid_ctrl->cache);
+	edid_ctrl->cache.valid = true;
+
 	return 0;
 
 err_invalid_header:
@@ -2437,6 +2525,8 @@ void hdmi_edid_set_video_resolution(void *input, u32 resolution, bool reset)
 	edid_ctrl->video_resolution = resolution;
 
 	if (reset) {
+		/* the sink data is replaced, it has to be parsed again */
+		edid_ctrl->cache.valid = false;
 		edid_ctrl->default_vic = resolution;
 		edid_ctrl->sink_data.num_of_elements = 1;
 		edid_ctrl->sink_data.disp_mode_list[0].video_format =
@@ -2445,6 +2535,22 @@ void hdmi_edid_set_video_resolution(void *input, u32 resolution, bool reset)
 	}
 } /* hdmi_edid_set_video_resolution */
 
+/*
+ * hdmi_edid_is_cached() - returns true if the last hdmi_edid_parser() call
+ * found the EDID unchanged and reused the previous parse
+ */
+bool hdmi_edid_is_cached(void *input)
+{
+	struct hdmi_edid_ctrl *edid_ctrl = (struct hdmi_edid_ctrl *)input;
+
+	if (!edid_ctrl) {
+		DEV_ERR("%s: invalid input\n", __func__);
+		return false;
+	}
+
+	return edid_ctrl->cache_hit;
+}
+
 void hdmi_edid_deinit(void *input)
 {
 	struct hdmi_edid_ctrl *edid_ctrl = (struct hdmi_edid_ctrl *)input;
@@ -29,6 +29,7 @@ struct hdmi_edid_init_data {
 };
 
 int hdmi_edid_parser(void *edid_ctrl);
+bool hdmi_edid_is_cached(void *edid_ctrl);
 u32 hdmi_edid_get_raw_data(void *edid_ctrl, u8 *buf, u32 size);
 u8 hdmi_edid_get_sink_scaninfo(void *edid_ctrl, u32 resolution);
 u32 hdmi_edid_get_sink_mode(void *edid_ctrl);
@@ -16,6 +16,7 @@
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/iopoll.h>
+#include <linux/ktime.h>
 #include <linux/of_address.h>
 #include <linux/of_gpio.h>
 #include <linux/of_platform.h>
@@ -1259,6 +1260,72 @@ static ssize_t hdmi_tx_sysfs_wta_5v(struct device *dev,
 	return ret;
 }
 
+static ssize_t hdmi_tx_sysfs_rda_hdcp_overlap(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	ssize_t ret;
+	struct hdmi_tx_ctrl *hdmi_ctrl =
+		hdmi_tx_get_drvdata_from_sysfs_dev(dev);
+
+	if (!hdmi_ctrl) {
+		DEV_ERR("%s: invalid input\n", __func__);
+		return -EINVAL;
+	}
+
+	mutex_lock(&hdmi_ctrl->tx_lock);
+	ret = snprintf(buf, PAGE_SIZE, "%d\n", hdmi_ctrl->hdcp_overlap);
+	mutex_unlock(&hdmi_ctrl->tx_lock);
+
+	return ret;
+}
+
+static ssize_t hdmi_tx_sysfs_wta_hdcp_overlap(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t count)
+{
+	int overlap, rc;
+	struct hdmi_tx_ctrl *hdmi_ctrl =
+		hdmi_tx_get_drvdata_from_sysfs_dev(dev);
+
+	if (!hdmi_ctrl) {
+		DEV_ERR("%s: invalid input\n", __func__);
+		return -EINVAL;
+	}
+
+	rc = kstrtoint(buf, 10, &overlap);
+	if (rc) {
+		DEV_ERR("%s: kstrtoint failed. rc=%d\n", __func__, rc);
+		return rc;
+	}
+
+	mutex_lock(&hdmi_ctrl->tx_lock);
+	hdmi_ctrl->hdcp_overlap = !!overlap;
+	mutex_unlock(&hdmi_ctrl->tx_lock);
+
+	return count;
+}
+
+static ssize_t hdmi_tx_sysfs_rda_connect_latency(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	ssize_t ret;
+	struct hdmi_tx_ctrl *hdmi_ctrl =
+		hdmi_tx_get_drvdata_from_sysfs_dev(dev);
+
+	if (!hdmi_ctrl) {
+		DEV_ERR("%s: invalid input\n", __func__);
+		return -EINVAL;
+	}
+
+	mutex_lock(&hdmi_ctrl->tx_lock);
+	ret = snprintf(buf, PAGE_SIZE,
+		"edid_us: %u\nfirst_frame_us: %u\nedid_cached: %d\n",
+		hdmi_ctrl->connect_edid_us, hdmi_ctrl->connect_frame_us,
+		hdmi_edid_is_cached(hdmi_tx_get_fd(HDMI_TX_FEAT_EDID)));
+	mutex_unlock(&hdmi_ctrl->tx_lock);
+
+	return ret;
+}
+
 static DEVICE_ATTR(connected, 0444, hdmi_tx_sysfs_rda_connected, NULL);
 static DEVICE_ATTR(hdmi_audio_cb, 0200, NULL, hdmi_tx_sysfs_wta_audio_cb);
 static DEVICE_ATTR(hot_plug, 0200, NULL, hdmi_tx_sysfs_wta_hot_plug);
@@ -1279,6 +1346,10 @@ static DEVICE_ATTR(avi_cn0_1, 0200, NULL, hdmi_tx_sysfs_wta_avi_cn_bits);
 static DEVICE_ATTR(s3d_mode, 0644, hdmi_tx_sysfs_rda_s3d_mode,
 	hdmi_tx_sysfs_wta_s3d_mode);
 static DEVICE_ATTR(5v, 0200, NULL, hdmi_tx_sysfs_wta_5v);
+static DEVICE_ATTR(hdcp_overlap, 0644, hdmi_tx_sysfs_rda_hdcp_overlap,
+	hdmi_tx_sysfs_wta_hdcp_overlap);
+static DEVICE_ATTR(connect_latency, 0444, hdmi_tx_sysfs_rda_connect_latency,
+	NULL);
 
 static struct attribute *hdmi_tx_fs_attrs[] = {
 	&dev_attr_connected.attr,
@@ -1294,6 +1365,8 @@ static struct attribute *hdmi_tx_fs_attrs[] = {
 	&dev_attr_avi_cn0_1.attr,
 	&dev_attr_s3d_mode.attr,
 	&dev_attr_5v.attr,
+	&dev_attr_hdcp_overlap.attr,
+	&dev_attr_connect_latency.attr,
 	NULL,
 };
 static struct attribute_group hdmi_tx_fs_attrs_group = {
@@ -1442,6 +1515,16 @@ static inline bool hdmi_tx_is_stream_shareable(struct hdmi_tx_ctrl *hdmi_ctrl)
 	return ret;
 }
 
+/*
+ * Content that didn't ask for encryption can be shown while HDCP
+ * authenticates instead of waiting behind AV mute, if allowed.
+ */
+static inline bool hdmi_tx_is_auth_overlap(struct hdmi_tx_ctrl *hdmi_ctrl)
+{
+	return hdmi_ctrl->hdcp_overlap &&
+		hdmi_ctrl->enc_lvl == HDCP_STATE_AUTH_ENC_NONE;
+}
+
 static void hdmi_tx_hdcp_cb_work(struct work_struct *work)
 {
 	struct hdmi_tx_ctrl *hdmi_ctrl = NULL;
@@ -1480,8 +1563,9 @@ static void hdmi_tx_hdcp_cb_work(struct work_struct *work)
 		if (hdmi_tx_is_panel_on(hdmi_ctrl)) {
 			DEV_DBG("%s: Reauthenticating\n", __func__);
 
-			if (hdmi_tx_is_encryption_set(hdmi_ctrl) ||
-				!hdmi_tx_is_stream_shareable(hdmi_ctrl)) {
+			if ((hdmi_tx_is_encryption_set(hdmi_ctrl) ||
+				!hdmi_tx_is_stream_shareable(hdmi_ctrl)) &&
+				!hdmi_tx_is_auth_overlap(hdmi_ctrl)) {
 				hdmi_tx_set_audio_switch_node(hdmi_ctrl, 0);
 				rc = hdmi_tx_config_avmute(hdmi_ctrl, true);
 			}
@@ -2134,6 +2218,10 @@ static void hdmi_tx_hpd_int_work(struct work_struct *work)
 		if (!retry && rc)
 			pr_warn_ratelimited("%s: EDID read failed\n", __func__);
 
+		if (ktime_to_ns(hdmi_ctrl->connect_time))
+			hdmi_ctrl->connect_edid_us = ktime_us_delta(ktime_get(),
+				hdmi_ctrl->connect_time);
+
 		if (hdmi_tx_enable_power(hdmi_ctrl, HDMI_TX_DDC_PM, false))
 			DEV_ERR("%s: Failed to disable ddc power\n", __func__);
 
@@ -3270,6 +3358,9 @@ static irqreturn_t hdmi_tx_isr(int irq, void *data)
 		 */
 		DSS_REG_W(io, HDMI_HPD_INT_CTRL, BIT(0));
 
+		if (hdmi_ctrl->hpd_state)
+			hdmi_ctrl->connect_time = ktime_get();
+
 		queue_work(hdmi_ctrl->workq, &hdmi_ctrl->hpd_int_work);
 	}
 
@@ -3357,6 +3448,7 @@ static int hdmi_tx_dev_init(struct hdmi_tx_ctrl *hdmi_ctrl)
 	hdmi_ctrl->hpd_state = false;
 	hdmi_ctrl->hpd_initialized = false;
 	hdmi_ctrl->hpd_off_pending = false;
+	hdmi_ctrl->hdcp_overlap = true;
 	init_completion(&hdmi_ctrl->hpd_int_done);
 
 	INIT_WORK(&hdmi_ctrl->hpd_int_work, hdmi_tx_hpd_int_work);
@@ -3389,7 +3481,8 @@ static int hdmi_tx_start_hdcp(struct hdmi_tx_ctrl *hdmi_ctrl)
 		!hdmi_tx_is_hdcp_enabled(hdmi_ctrl))
 		return 0;
 
-	if (hdmi_tx_is_encryption_set(hdmi_ctrl))
+	if (hdmi_tx_is_encryption_set(hdmi_ctrl) &&
+		!hdmi_tx_is_auth_overlap(hdmi_ctrl))
 		hdmi_tx_config_avmute(hdmi_ctrl, true);
 
 	rc = hdmi_ctrl->hdcp_ops->hdmi_hdcp_authenticate(hdmi_ctrl->hdcp_data);
@@ -3630,6 +3723,9 @@ static int hdmi_tx_evt_handle_resume(struct hdmi_tx_ctrl *hdmi_ctrl)
 	if (!hdmi_ctrl->hpd_feature_on)
 		goto end;
 
+	if (hdmi_ctrl->hpd_state)
+		hdmi_ctrl->connect_time = ktime_get();
+
 	rc = hdmi_tx_hpd_on(hdmi_ctrl);
 	if (rc) {
 		DEV_ERR("%s: hpd_on failed. rc=%d\n", __func__, rc);
@@ -3697,6 +3793,15 @@ static int hdmi_tx_evt_handle_panel_on(struct hdmi_tx_ctrl *hdmi_ctrl)
 
 	hdmi_ctrl->timing_gen_on = true;
 
+	/* the first frame goes out once the timing generator is on */
+	if (ktime_to_ns(hdmi_ctrl->connect_time)) {
+		hdmi_ctrl->connect_frame_us = ktime_us_delta(ktime_get(),
+			hdmi_ctrl->connect_time);
+		hdmi_ctrl->connect_time = ktime_set(0, 0);
+		DEV_DBG("%s: connect to first frame %u us\n", __func__,
+			hdmi_ctrl->connect_frame_us);
+	}
+
 	if (hdmi_ctrl->panel_suspend) {
 		DEV_DBG("%s: panel suspend has triggered\n", __func__);
 
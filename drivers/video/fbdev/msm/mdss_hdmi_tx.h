@@ -91,6 +91,11 @@ struct hdmi_tx_ctrl {
 
 	spinlock_t hpd_state_lock;
 
+	/* connect or resume time, cleared once the first frame is out */
+	ktime_t connect_time;
+	u32 connect_edid_us;
+	u32 connect_frame_us;
+
 	u32 panel_power_on;
 	u32 panel_suspend;
 	u32 vic;
@@ -123,6 +128,7 @@ struct hdmi_tx_ctrl {
 	bool custom_edid;
 	bool sim_mode;
 	bool hdcp22_present;
+	bool hdcp_overlap;
 	bool power_data_enable[HDMI_TX_MAX_PM];
 
 	void (*hdmi_tx_hpd_done)(void *data);
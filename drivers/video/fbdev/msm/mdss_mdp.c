@@ -19,6 +19,7 @@
 #include <linux/clk.h>
 #include <linux/debugfs.h>
 #include <linux/delay.h>
+#include <linux/devfreq.h>
 #include <linux/hrtimer.h>
 #include <linux/kernel.h>
 #include <linux/init.h>
@@ -37,6 +38,7 @@
 #include <linux/sched.h>
 #include <linux/time.h>
 #include <linux/spinlock.h>
+#include <linux/sizes.h>
 #include <linux/semaphore.h>
 #include <linux/uaccess.h>
 #include <linux/clk/msm-clk.h>
@@ -714,6 +716,8 @@ int mdss_bus_scale_set_quota(int client, u64 ab_quota, u64 ib_quota)
 
 	rc = mdss_mdp_bus_scale_set_quota(total_ab_rt, total_ab_nrt,
 			total_ib_rt, total_ib_nrt);
+	devfreq_mem_vote_hint(DEVFREQ_MEM_VOTE_DISPLAY,
+			DIV_ROUND_UP_ULL(total_ab_rt + total_ab_nrt, SZ_1M));
 
 	mutex_unlock(&mdss_res->bus_lock);
 
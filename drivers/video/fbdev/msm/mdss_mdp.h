@@ -584,7 +584,11 @@ struct mdss_mdp_ctl {
 	struct mdss_mdp_perf_params new_perf;
 	u32 perf_transaction_status;
 	bool perf_release_ctl_bw;
+	bool perf_idle;
 	u64 bw_pending;
+	/* layer stack of the last bw check and the bandwidth it needed */
+	u32 perf_cache_key;
+	u64 perf_cache_bw;
 	bool disable_prefill;
 
 	bool traffic_shaper_enabled;
@@ -975,6 +979,20 @@ struct mdss_mdp_writeback_arg {
 
 struct mdss_mdp_wfd;
 
+/* input layer state used to tell whether a commit changes the screen */
+struct mdss_mdp_layer_snap {
+	struct file *buf;
+	struct mdp_rect src_rect;
+	struct mdp_rect dst_rect;
+	u32 flags;
+	u32 pipe_ndx;
+	u32 z_order;
+	u32 alpha;
+	u32 width;
+	u32 height;
+	u32 format;
+};
+
 struct mdss_overlay_private {
 	ktime_t vsync_time;
 	ktime_t lineptr_time;
@@ -1036,6 +1054,11 @@ struct mdss_overlay_private {
 	struct task_struct *thread;
 
 	bool cache_null_commit; /* Cache if preceding commit was NULL */
+
+	/* layers of the last validated commit and what changed since */
+	struct mdss_mdp_layer_snap layer_snap[MAX_LAYER_COUNT];
+	u32 layer_snap_cnt;
+	struct mdss_rect dirty_roi;
 };
 
 struct mdss_mdp_set_ot_params {
@@ -1645,6 +1668,8 @@ int mdss_mdp_layer_atomic_validate(struct msm_fb_data_type *mfd,
 	struct file *file, struct mdp_layer_commit_v1 *ov_commit);
 int mdss_mdp_layer_pre_commit(struct msm_fb_data_type *mfd,
 	struct file *file, struct mdp_layer_commit_v1 *ov_commit);
+bool mdss_mdp_layer_frame_dirty(struct msm_fb_data_type *mfd,
+	struct mdp_layer_commit_v1 *ov_commit);
 
 int mdss_mdp_layer_atomic_validate_wfd(struct msm_fb_data_type *mfd,
 	struct file *file, struct mdp_layer_commit_v1 *ov_commit);
@@ -1717,7 +1742,8 @@ int mdss_mdp_ctl_intf_event(struct mdss_mdp_ctl *ctl, int event, void *arg,
 int mdss_mdp_get_prefetch_lines(struct mdss_panel_info *pinfo, bool is_fixed);
 int mdss_mdp_perf_bw_check(struct mdss_mdp_ctl *ctl,
 		struct mdss_mdp_pipe **left_plist, int left_cnt,
-		struct mdss_mdp_pipe **right_plist, int right_cnt);
+		struct mdss_mdp_pipe **right_plist, int right_cnt,
+		u32 cache_key);
 int mdss_mdp_perf_bw_check_pipe(struct mdss_mdp_perf_params *perf,
 		struct mdss_mdp_pipe *pipe);
 int mdss_mdp_get_pipe_overlap_bw(struct mdss_mdp_pipe *pipe,
@@ -1751,6 +1777,7 @@ int mdss_mdp_mixer_handoff(struct mdss_mdp_ctl *ctl, u32 num,
 void mdss_mdp_ctl_perf_set_transaction_status(struct mdss_mdp_ctl *ctl,
 	enum mdss_mdp_perf_state_type component, bool new_status);
 void mdss_mdp_ctl_perf_release_bw(struct mdss_mdp_ctl *ctl);
+void mdss_mdp_ctl_perf_idle(struct mdss_mdp_ctl *ctl);
 int mdss_mdp_async_ctl_flush(struct msm_fb_data_type *mfd,
 		u32 flush_bits);
 int mdss_mdp_get_pipe_flush_bits(struct mdss_mdp_pipe *pipe);
@@ -1935,6 +1962,8 @@ int mdss_mdp_wait_for_xin_halt(u32 xin_id, bool is_vbif_nrt);
 void mdss_mdp_set_ot_limit(struct mdss_mdp_set_ot_params *params);
 int mdss_mdp_cmd_set_autorefresh_mode(struct mdss_mdp_ctl *ctl, int frame_cnt);
 int mdss_mdp_cmd_get_autorefresh_mode(struct mdss_mdp_ctl *ctl);
+int mdss_mdp_cmd_get_idle_stats(struct mdss_mdp_ctl *ctl, char *buf,
+	size_t len);
 int mdss_mdp_ctl_cmd_set_autorefresh(struct mdss_mdp_ctl *ctl, int frame_cnt);
 int mdss_mdp_ctl_cmd_get_autorefresh(struct mdss_mdp_ctl *ctl);
 void mdss_mdp_ctl_event_timer(void *data);
@@ -1706,9 +1706,21 @@ static int mdss_mdp_set_threshold_max_bandwidth(struct mdss_mdp_ctl *ctl)
 	return max;
 }
 
+/*
+ * mdss_mdp_perf_bw_check() - check that a pipe configuration fits the bus
+ * @ctl:	ctl the pipes are going to be staged on
+ * @left_plist:	pipes staged on the left mixer
+ * @right_plist: pipes staged on the right mixer
+ * @cache_key:	non-zero key identifying the layer stack, 0 if it is new
+ *
+ * The per pipe bandwidth calculation is skipped when the caller passes the
+ * same key as for the previous check, only the totals across interfaces
+ * and the thresholds are evaluated again.
+ */
 int mdss_mdp_perf_bw_check(struct mdss_mdp_ctl *ctl,
 		struct mdss_mdp_pipe **left_plist, int left_cnt,
-		struct mdss_mdp_pipe **right_plist, int right_cnt)
+		struct mdss_mdp_pipe **right_plist, int right_cnt,
+		u32 cache_key)
 {
 	struct mdss_data_type *mdata = ctl->mdata;
 	struct mdss_mdp_perf_params perf;
@@ -1720,10 +1732,18 @@ int mdss_mdp_perf_bw_check(struct mdss_mdp_ctl *ctl,
 	if (ctl->intf_type == MDSS_MDP_NO_INTF)
 		return 0;
 
-	__mdss_mdp_perf_calc_ctl_helper(ctl, &perf,
-			left_plist, left_cnt, right_plist, right_cnt,
-			PERF_CALC_PIPE_CALC_SMP_SIZE);
-	ctl->bw_pending = perf.bw_ctl;
+	if (cache_key && cache_key == ctl->perf_cache_key) {
+		ctl->bw_pending = ctl->perf_cache_bw;
+		mdata->perf_cache_hits++;
+	} else {
+		__mdss_mdp_perf_calc_ctl_helper(ctl, &perf,
+				left_plist, left_cnt, right_plist, right_cnt,
+				PERF_CALC_PIPE_CALC_SMP_SIZE);
+		ctl->bw_pending = perf.bw_ctl;
+		ctl->perf_cache_key = cache_key;
+		ctl->perf_cache_bw = perf.bw_ctl;
+		mdata->perf_cache_misses++;
+	}
 
 	for (i = 0; i < mdata->nctl; i++) {
 		struct mdss_mdp_ctl *temp = mdata->ctl_off + i;
@@ -1756,6 +1776,7 @@ int mdss_mdp_perf_bw_check(struct mdss_mdp_ctl *ctl,
 
 	if (bw > threshold) {
 		ctl->bw_pending = 0;
+		ctl->perf_cache_key = 0;
 		pr_debug("exceeds bandwidth: %ukb > %ukb\n", bw, threshold);
 		return -E2BIG;
 	}
@@ -2024,7 +2045,8 @@ static void mdss_mdp_ctl_perf_update_traffic_shaper_bw(struct mdss_mdp_ctl *ctl,
 }
 
 static u64 mdss_mdp_ctl_calc_client_vote(struct mdss_data_type *mdata,
-	struct mdss_mdp_perf_params *perf, bool nrt_client, u32 mdp_clk)
+	struct mdss_mdp_perf_params *perf, bool nrt_client, u32 mdp_clk,
+	bool *idle)
 {
 	u64 bw_sum_of_intfs = 0;
 	int i;
@@ -2033,6 +2055,7 @@ static u64 mdss_mdp_ctl_calc_client_vote(struct mdss_data_type *mdata,
 	struct mdss_mdp_perf_params perf_temp;
 
 	bitmap_zero(perf_temp.bw_vote_mode, MDSS_MDP_BW_MODE_MAX);
+	*idle = !nrt_client;
 
 	for (i = 0; i < mdata->nctl; i++) {
 		ctl = mdata->ctl_off + i;
@@ -2072,6 +2095,7 @@ static u64 mdss_mdp_ctl_calc_client_vote(struct mdss_data_type *mdata,
 				ctl->cur_perf.max_per_pipe_ib);
 
 			bw_sum_of_intfs += ctl->cur_perf.bw_ctl;
+			*idle &= ctl->perf_idle;
 
 			pr_debug("ctl_num=%d bw=%llu mode=0x%lx\n", ctl->num,
 				ctl->cur_perf.bw_ctl,
@@ -2117,16 +2141,21 @@ static inline u64 __calc_bus_ib_quota(struct mdss_data_type *mdata,
 }
 
 static void mdss_mdp_ctl_update_client_vote(struct mdss_data_type *mdata,
-	struct mdss_mdp_perf_params *perf, bool nrt_client, u64 bw_vote)
+	struct mdss_mdp_perf_params *perf, bool nrt_client, u64 bw_vote,
+	bool idle)
 {
 	u64 bus_ab_quota, bus_ib_quota;
 
 	bus_ab_quota = max(bw_vote, mdata->perf_tune.min_bus_vote);
 	bus_ib_quota = __calc_bus_ib_quota(mdata, perf, nrt_client, bw_vote);
 
-
-	bus_ab_quota = apply_fudge_factor(bus_ab_quota, &mdss_res->ab_factor);
+	/* idle interfaces only scan out, vote the plain fetch rate */
+	if (!idle)
+		bus_ab_quota = apply_fudge_factor(bus_ab_quota,
+			&mdss_res->ab_factor);
 	ATRACE_INT("bus_quota", bus_ib_quota);
+	trace_mdp_perf_bus_vote(nrt_client, bw_vote, bus_ab_quota,
+		bus_ib_quota, idle);
 
 	mdss_bus_scale_set_quota(nrt_client ? MDSS_MDP_NRT : MDSS_MDP_RT,
 		bus_ab_quota, bus_ib_quota);
@@ -2139,6 +2168,7 @@ static void mdss_mdp_ctl_perf_update_bus(struct mdss_data_type *mdata,
 {
 	u64 bw_sum_of_rt_intfs = 0, bw_sum_of_nrt_intfs = 0;
 	struct mdss_mdp_perf_params perf = {0};
+	bool idle;
 
 	ATRACE_BEGIN(__func__);
 
@@ -2150,9 +2180,9 @@ static void mdss_mdp_ctl_perf_update_bus(struct mdss_data_type *mdata,
 	if (mdss_mdp_is_nrt_ctl_path(ctl)) {
 		bitmap_zero(perf.bw_vote_mode, MDSS_MDP_BW_MODE_MAX);
 		bw_sum_of_nrt_intfs = mdss_mdp_ctl_calc_client_vote(mdata,
-			&perf, true, mdp_clk);
+			&perf, true, mdp_clk, &idle);
 		mdss_mdp_ctl_update_client_vote(mdata, &perf, true,
-			bw_sum_of_nrt_intfs);
+			bw_sum_of_nrt_intfs, idle);
 	}
 
 	/*
@@ -2164,9 +2194,9 @@ static void mdss_mdp_ctl_perf_update_bus(struct mdss_data_type *mdata,
 		(ctl->intf_num ==  MDSS_MDP_NO_INTF)) {
 		bitmap_zero(perf.bw_vote_mode, MDSS_MDP_BW_MODE_MAX);
 		bw_sum_of_rt_intfs = mdss_mdp_ctl_calc_client_vote(mdata,
-			&perf, false, mdp_clk);
+			&perf, false, mdp_clk, &idle);
 		mdss_mdp_ctl_update_client_vote(mdata, &perf, false,
-			bw_sum_of_rt_intfs);
+			bw_sum_of_rt_intfs, idle);
 	}
 
 	ATRACE_END(__func__);
@@ -2228,6 +2258,33 @@ void mdss_mdp_ctl_perf_release_bw(struct mdss_mdp_ctl *ctl)
 	mutex_unlock(&mdss_mdp_ctl_lock);
 }
 
+/**
+ * @mdss_mdp_ctl_perf_idle() - trim the bandwidth vote of an idle display
+ * @ctl - pointer to a ctl
+ *
+ * A video interface keeps scanning out the last frame while the display
+ * is idle, so its bandwidth can't be released like on command panels.
+ * When enabled, vote the plain fetch rate without the ab fudge factor
+ * until the next frame update. The ib vote is left untouched.
+ */
+void mdss_mdp_ctl_perf_idle(struct mdss_mdp_ctl *ctl)
+{
+	struct mdss_data_type *mdata;
+
+	if (!ctl || !ctl->mdata || !ctl->mdata->enable_idle_bw_decay)
+		return;
+
+	mutex_lock(&mdss_mdp_ctl_lock);
+	mdata = ctl->mdata;
+	if (mdss_mdp_ctl_is_power_on(ctl) && !ctl->perf_idle) {
+		ctl->perf_idle = true;
+		pr_debug("Idle BW ctl=%d\n", ctl->num);
+		mdss_mdp_ctl_perf_update_bus(mdata, ctl,
+			mdss_mdp_get_mdp_clk_rate(mdata));
+	}
+	mutex_unlock(&mdss_mdp_ctl_lock);
+}
+
 static int mdss_mdp_select_clk_lvl(struct mdss_data_type *mdata,
 			u32 clk_rate)
 {
@@ -2361,6 +2418,12 @@ static void mdss_mdp_ctl_perf_update(struct mdss_mdp_ctl *ctl,
 		if (ctl->mixer_left && ctl->mixer_left->rotator_mode)
 			goto end;
 
+		/* a new frame is coming, restore the full vote first */
+		if (ctl->perf_idle) {
+			ctl->perf_idle = false;
+			update_bus = 1;
+		}
+
 		if (ctl->perf_release_ctl_bw &&
 			mdata->enable_rotator_bw_release)
 			mdss_mdp_perf_release_ctl_bw(ctl, new);
@@ -2402,6 +2465,7 @@ static void mdss_mdp_ctl_perf_update(struct mdss_mdp_ctl *ctl,
 	} else {
 		memset(old, 0, sizeof(*old));
 		memset(new, 0, sizeof(*new));
+		ctl->perf_idle = false;
 		update_bus = 1;
 		update_clk = 1;
 	}
@@ -4264,8 +4328,10 @@ int mdss_mdp_ctl_start(struct mdss_mdp_ctl *ctl, bool handoff)
 
 	mutex_lock(&ctl->lock);
 
-	if (mdss_mdp_ctl_is_power_off(ctl))
+	if (mdss_mdp_ctl_is_power_off(ctl)) {
 		memset(&ctl->cur_perf, 0, sizeof(ctl->cur_perf));
+		ctl->perf_cache_key = 0;
+	}
 
 	/*
 	 * keep power_on false during handoff to avoid unexpected
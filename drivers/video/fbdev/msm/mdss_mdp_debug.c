@@ -1519,6 +1519,10 @@ int mdss_mdp_debugfs_init(struct mdss_data_type *mdata)
 		(u32 *)&mdata->bcolor2);
 	debugfs_create_u32("ad_debugen", 0644, mdd->postproc,
 		(u32 *)&mdata->ad_debugen);
+	debugfs_create_u32("lut_skip_cnt", 0444, mdd->postproc,
+		&mdata->pp_lut_skip_cnt);
+	debugfs_create_u64("lut_writes_avoided", 0444, mdd->postproc,
+		&mdata->pp_lut_writes_avoided);
 
 	return 0;
 }
@@ -34,6 +34,16 @@
 #define INPUT_EVENT_HANDLER_DELAY_USECS (16000 * 4)
 #define AUTOREFRESH_MAX_FRAME_CNT 6
 
+/*
+ * Commits further apart than this reset the cadence predictor, predicted
+ * idle periods shorter than CMD_PREDICT_COLLAPSE_US only gate the clocks and
+ * the early wake up is done CMD_PREDICT_WAKE_MARGIN_US ahead of the wake
+ * latency.
+ */
+#define CMD_PREDICT_MAX_INTERVAL_US (1000 * USEC_PER_MSEC)
+#define CMD_PREDICT_COLLAPSE_US (20 * USEC_PER_MSEC)
+#define CMD_PREDICT_WAKE_MARGIN_US 2000
+
 static DEFINE_MUTEX(cmd_clk_mtx);
 
 static DEFINE_MUTEX(cmd_off_mtx);
@@ -45,6 +55,13 @@ enum mdss_mdp_cmd_autorefresh_state {
 	MDP_AUTOREFRESH_OFF_REQUESTED
 };
 
+enum {
+	MDP_RSRC_CTL_STATE_OFF,
+	MDP_RSRC_CTL_STATE_ON,
+	MDP_RSRC_CTL_STATE_GATE,
+	MDP_RSRC_CTL_STATE_MAX,
+};
+
 struct mdss_mdp_cmd_ctx {
 	struct mdss_mdp_ctl *ctl;
 
@@ -84,6 +101,7 @@ struct mdss_mdp_cmd_ctx {
 	struct work_struct pp_done_work;
 	struct workqueue_struct *early_wakeup_clk_wq;
 	struct work_struct early_wakeup_clk_work;
+	struct delayed_work predict_wakeup_work;
 	atomic_t pp_done_cnt;
 	struct completion rdptr_done;
 
@@ -108,6 +126,26 @@ struct mdss_mdp_cmd_ctx {
 	struct mdss_mdp_cmd_ctx *sync_ctx; /* for partial update */
 	u32 pp_timeout_report_cnt;
 	bool pingpong_split_slave;
+
+	/*
+	 * Commit cadence predictor and idle statistics, protected by idle_lock.
+	 * The kickoff interval and its jitter are running averages.
+	 */
+	spinlock_t idle_lock;
+	ktime_t last_koff;
+	s64 koff_interval_us;
+	s64 koff_jitter_us;
+	ktime_t last_te;
+	s64 wake_latency_us;
+	bool predict_woke;
+	ktime_t rsrc_state_time;
+	u64 rsrc_residency_us[MDP_RSRC_CTL_STATE_MAX];
+	u32 koff_wakes;
+	u64 koff_wake_total_us;
+	s64 koff_wake_max_us;
+	u32 predict_collapses;
+	u32 predict_wakes;
+	u32 predict_hits;
 };
 
 struct mdss_mdp_cmd_ctx mdss_mdp_cmd_ctx_list[MAX_SESSIONS];
@@ -603,11 +641,151 @@ enum mdp_rsrc_ctl_events {
 	MDP_RSRC_CTL_EVENT_EARLY_WAKE_UP
 };
 
-enum {
-	MDP_RSRC_CTL_STATE_OFF,
-	MDP_RSRC_CTL_STATE_ON,
-	MDP_RSRC_CTL_STATE_GATE,
-};
+/*
+ * Change the resource state of the commands interface, charging the time
+ * spent in the previous state to its residency.
+ */
+static void mdss_mdp_cmd_set_rsrc_state(struct mdss_mdp_cmd_ctx *ctx,
+	struct mdss_overlay_private *mdp5_data, u32 state)
+{
+	ktime_t now = ktime_get();
+	u32 cur = mdp5_data->resources_state;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ctx->idle_lock, flags);
+	if (cur < MDP_RSRC_CTL_STATE_MAX && ktime_to_us(ctx->rsrc_state_time))
+		ctx->rsrc_residency_us[cur] +=
+			ktime_us_delta(now, ctx->rsrc_state_time);
+	ctx->rsrc_state_time = now;
+	spin_unlock_irqrestore(&ctx->idle_lock, flags);
+
+	mdp5_data->resources_state = state;
+}
+
+/* Account the time it took to bring the resources back from OFF */
+static void mdss_mdp_cmd_wake_latency(struct mdss_mdp_cmd_ctx *ctx,
+	ktime_t start, bool koff)
+{
+	s64 latency = ktime_us_delta(ktime_get(), start);
+	unsigned long flags;
+
+	spin_lock_irqsave(&ctx->idle_lock, flags);
+	if (!ctx->wake_latency_us)
+		ctx->wake_latency_us = latency;
+	else
+		ctx->wake_latency_us += (latency - ctx->wake_latency_us) / 4;
+
+	if (koff) {
+		ctx->koff_wakes++;
+		ctx->koff_wake_total_us += latency;
+		ctx->koff_wake_max_us = max(ctx->koff_wake_max_us, latency);
+	}
+	spin_unlock_irqrestore(&ctx->idle_lock, flags);
+}
+
+/* Update the running averages of the kickoff interval on a kickoff */
+static void mdss_mdp_cmd_update_cadence(struct mdss_mdp_cmd_ctx *ctx)
+{
+	ktime_t now = ktime_get();
+	unsigned long flags;
+	s64 interval;
+
+	spin_lock_irqsave(&ctx->idle_lock, flags);
+	interval = ktime_us_delta(now, ctx->last_koff);
+	ctx->last_koff = now;
+
+	if (ctx->predict_woke) {
+		ctx->predict_hits++;
+		ctx->predict_woke = false;
+	}
+
+	if (interval <= 0 || interval > CMD_PREDICT_MAX_INTERVAL_US) {
+		ctx->koff_interval_us = 0;
+	} else if (!ctx->koff_interval_us) {
+		ctx->koff_interval_us = interval;
+		ctx->koff_jitter_us = interval / 2;
+	} else {
+		s64 dev = abs(interval - ctx->koff_interval_us);
+
+		ctx->koff_interval_us += (interval - ctx->koff_interval_us) / 8;
+		ctx->koff_jitter_us += (dev - ctx->koff_jitter_us) / 4;
+	}
+	spin_unlock_irqrestore(&ctx->idle_lock, flags);
+}
+
+/*
+ * Return the time in us from @now to the expected next kickoff, or -1 if the
+ * kickoffs don't come at a steady enough rate to tell. Called with idle_lock
+ * held.
+ */
+static s64 mdss_mdp_cmd_predict_idle(struct mdss_mdp_cmd_ctx *ctx,
+	ktime_t now)
+{
+	s64 idle;
+
+	if (!ctx->koff_interval_us ||
+		(ctx->koff_jitter_us * 4) > ctx->koff_interval_us)
+		return -1;
+
+	idle = ktime_us_delta(ktime_add_us(ctx->last_koff,
+		ctx->koff_interval_us), now);
+
+	return idle > 0 ? idle : -1;
+}
+
+/*
+ * Move a wake up @wake_us from @now back to the panel TE at or before it, so
+ * the resources are up at the start of the TE window the kickoff will use.
+ * Called with idle_lock held.
+ */
+static s64 mdss_mdp_cmd_align_te(struct mdss_mdp_cmd_ctx *ctx, ktime_t now,
+	s64 wake_us)
+{
+	struct mdss_panel_info *pinfo = &ctx->ctl->panel_data->panel_info;
+	u32 fps = mdss_panel_get_framerate(pinfo, FPS_RESOLUTION_HZ);
+	s32 rem;
+
+	if (!fps || !ktime_to_us(ctx->last_te))
+		return wake_us;
+
+	div_s64_rem(ktime_us_delta(now, ctx->last_te) + wake_us,
+		USEC_PER_SEC / fps, &rem);
+
+	return max_t(s64, wake_us - rem, 0);
+}
+
+/*
+ * Called when the interface goes idle after a pp done, returns the delay
+ * before the resources are turned off. When the cadence predicts an idle
+ * period long enough, the resources go off right away and an early wake up is
+ * queued ahead of the expected kickoff, otherwise the clocks are only gated
+ * until CMD_MODE_IDLE_TIMEOUT as before.
+ */
+static unsigned long mdss_mdp_cmd_plan_idle(struct mdss_mdp_cmd_ctx *ctx)
+{
+	ktime_t now = ktime_get();
+	unsigned long flags;
+	s64 idle, wake;
+
+	spin_lock_irqsave(&ctx->idle_lock, flags);
+	idle = mdss_mdp_cmd_predict_idle(ctx, now);
+	wake = idle - ctx->wake_latency_us - CMD_PREDICT_WAKE_MARGIN_US;
+	if (idle < CMD_PREDICT_COLLAPSE_US || wake <= 0) {
+		spin_unlock_irqrestore(&ctx->idle_lock, flags);
+		return CMD_MODE_IDLE_TIMEOUT;
+	}
+
+	wake = mdss_mdp_cmd_align_te(ctx, now, wake);
+	ctx->predict_collapses++;
+	spin_unlock_irqrestore(&ctx->idle_lock, flags);
+
+	/* Round down so a coarse tick doesn't make the wake up late */
+	queue_delayed_work(ctx->early_wakeup_clk_wq,
+		&ctx->predict_wakeup_work,
+		(unsigned long) div_u64(wake * HZ, USEC_PER_SEC));
+
+	return 0;
+}
 
 /* helper functions for debugging */
 static char *get_sw_event_name(u32 sw_event)
@@ -739,6 +917,8 @@ int mdss_mdp_resource_control(struct mdss_mdp_ctl *ctl, u32 sw_event)
 	u32 status;
 	int rc = 0;
 	bool schedule_off = false;
+	unsigned long off_delay;
+	ktime_t wake_start;
 
 	if (!ctl) {
 		pr_err("%s invalid ctl\n", __func__);
@@ -790,6 +970,10 @@ int mdss_mdp_resource_control(struct mdss_mdp_ctl *ctl, u32 sw_event)
 		/* update the active only vote */
 		mdata->ao_bw_uc_idx = mdata->curr_bw_uc_idx;
 
+		/* The kickoff is here, no need for the predicted wake up */
+		cancel_delayed_work(&ctx->predict_wakeup_work);
+		mdss_mdp_cmd_update_cadence(ctx);
+
 		/* Cancel GATE Work Item */
 		if (cancel_work_sync(&ctx->gate_clk_work)) {
 			pr_debug("%s gate work canceled\n", __func__);
@@ -812,6 +996,7 @@ int mdss_mdp_resource_control(struct mdss_mdp_ctl *ctl, u32 sw_event)
 
 		mutex_lock(&ctl->rsrc_lock);
 		MDSS_XLOG(ctl->num, mdp5_data->resources_state, sw_event, 0x11);
+		wake_start = ktime_get();
 		/* Transition OFF->ON || GATE->ON (enable clocks) */
 		if ((mdp5_data->resources_state == MDP_RSRC_CTL_STATE_OFF) ||
 			(mdp5_data->resources_state ==
@@ -838,8 +1023,8 @@ int mdss_mdp_resource_control(struct mdss_mdp_ctl *ctl, u32 sw_event)
 
 			if (mdp5_data->resources_state ==
 					MDP_RSRC_CTL_STATE_GATE)
-				mdp5_data->resources_state =
-					MDP_RSRC_CTL_STATE_ON;
+				mdss_mdp_cmd_set_rsrc_state(ctx, mdp5_data,
+					MDP_RSRC_CTL_STATE_ON);
 		}
 
 		/* Transition OFF->ON (enable resources)*/
@@ -854,7 +1039,9 @@ int mdss_mdp_resource_control(struct mdss_mdp_ctl *ctl, u32 sw_event)
 			if (sctx)
 				mdss_mdp_cmd_clk_on(sctx);
 
-			mdp5_data->resources_state = MDP_RSRC_CTL_STATE_ON;
+			mdss_mdp_cmd_set_rsrc_state(ctx, mdp5_data,
+				MDP_RSRC_CTL_STATE_ON);
+			mdss_mdp_cmd_wake_latency(ctx, wake_start, true);
 		}
 
 		if (mdp5_data->resources_state != MDP_RSRC_CTL_STATE_ON) {
@@ -901,14 +1088,16 @@ int mdss_mdp_resource_control(struct mdss_mdp_ctl *ctl, u32 sw_event)
 			MDSS_XLOG(ctl->num, mdp5_data->resources_state,
 				sw_event, 0x22);
 
-			/* start work item to gate */
-			if (mdata->enable_gate)
+			off_delay = mdss_mdp_cmd_plan_idle(ctx);
+
+			/* start work item to gate, unless going straight off */
+			if (mdata->enable_gate && off_delay)
 				schedule_work(&ctx->gate_clk_work);
 
 			/* start work item to shut down after delay */
 			schedule_delayed_work(
 					&ctx->delayed_off_clk_work,
-					CMD_MODE_IDLE_TIMEOUT);
+					off_delay);
 		}
 
 		break;
@@ -917,6 +1106,9 @@ int mdss_mdp_resource_control(struct mdss_mdp_ctl *ctl, u32 sw_event)
 		/* Cancel early wakeup Work Item */
 		if (cancel_work_sync(&ctx->early_wakeup_clk_work))
 			pr_debug("early wakeup work canceled\n");
+		if (cancel_delayed_work_sync(&ctx->predict_wakeup_work))
+			pr_debug("predicted wakeup work canceled\n");
+		ctx->koff_interval_us = 0;
 
 		/* If we are already OFF, just return */
 		if (mdp5_data->resources_state ==
@@ -991,7 +1183,8 @@ int mdss_mdp_resource_control(struct mdss_mdp_ctl *ctl, u32 sw_event)
 			mdss_mdp_clk_ctrl(MDP_BLOCK_POWER_OFF);
 
 			/* update the state, now we are in off */
-			mdp5_data->resources_state = MDP_RSRC_CTL_STATE_OFF;
+			mdss_mdp_cmd_set_rsrc_state(ctx, mdp5_data,
+				MDP_RSRC_CTL_STATE_OFF);
 		}
 		mutex_unlock(&ctl->rsrc_lock);
 		break;
@@ -1031,6 +1224,7 @@ int mdss_mdp_resource_control(struct mdss_mdp_ctl *ctl, u32 sw_event)
 		if (mdp5_data->resources_state == MDP_RSRC_CTL_STATE_OFF) {
 			u32 flags = CTL_INTF_EVENT_FLAG_SKIP_BROADCAST;
 
+			wake_start = ktime_get();
 			mdss_mdp_clk_ctrl(MDP_BLOCK_POWER_ON);
 			clk_ctrl.state = MDSS_DSI_CLK_ON;
 			clk_ctrl.client = DSI_CLK_REQ_MDP_CLIENT;
@@ -1051,7 +1245,9 @@ int mdss_mdp_resource_control(struct mdss_mdp_ctl *ctl, u32 sw_event)
 			if (sctx)
 				mdss_mdp_cmd_clk_on(sctx);
 
-			mdp5_data->resources_state = MDP_RSRC_CTL_STATE_ON;
+			mdss_mdp_cmd_set_rsrc_state(ctx, mdp5_data,
+				MDP_RSRC_CTL_STATE_ON);
+			mdss_mdp_cmd_wake_latency(ctx, wake_start, false);
 			schedule_off = true;
 		}
 
@@ -1170,6 +1366,9 @@ static void mdss_mdp_cmd_readptr_done(void *arg)
 
 	vsync_time = ktime_get();
 	ctl->vsync_cnt++;
+	spin_lock(&ctx->idle_lock);
+	ctx->last_te = vsync_time;
+	spin_unlock(&ctx->idle_lock);
 	MDSS_XLOG(ctl->num, atomic_read(&ctx->koff_cnt));
 	trace_mdp_cmd_readptr_done(ctl->num, atomic_read(&ctx->koff_cnt));
 	complete_all(&ctx->rdptr_done);
@@ -1729,7 +1928,7 @@ static void clk_ctrl_delayed_off_work(struct work_struct *work)
 	mdss_mdp_clk_ctrl(MDP_BLOCK_POWER_OFF);
 
 	/* update state machine that power off transition is done */
-	mdp5_data->resources_state = MDP_RSRC_CTL_STATE_OFF;
+	mdss_mdp_cmd_set_rsrc_state(ctx, mdp5_data, MDP_RSRC_CTL_STATE_OFF);
 
 exit:
 	/* do this at the end, so we can also protect the global power state*/
@@ -1845,7 +2044,7 @@ static void clk_ctrl_gate_work(struct work_struct *work)
 	mdss_mdp_clk_ctrl(MDP_BLOCK_POWER_OFF);
 
 	/* update state machine that gate transition is done */
-	mdp5_data->resources_state = MDP_RSRC_CTL_STATE_GATE;
+	mdss_mdp_cmd_set_rsrc_state(ctx, mdp5_data, MDP_RSRC_CTL_STATE_GATE);
 
 exit:
 	/* unlock mutex needed for split display */
@@ -3485,6 +3684,66 @@ static void early_wakeup_work(struct work_struct *work)
 	ATRACE_END(__func__);
 }
 
+static void predict_wakeup_work(struct work_struct *work)
+{
+	struct delayed_work *dw = to_delayed_work(work);
+	struct mdss_mdp_cmd_ctx *ctx = container_of(dw,
+		struct mdss_mdp_cmd_ctx, predict_wakeup_work);
+	unsigned long flags;
+
+	if (!ctx->ctl || ctx->intf_stopped)
+		return;
+
+	ATRACE_BEGIN(__func__);
+	spin_lock_irqsave(&ctx->idle_lock, flags);
+	ctx->predict_wakes++;
+	ctx->predict_woke = true;
+	spin_unlock_irqrestore(&ctx->idle_lock, flags);
+
+	if (mdss_mdp_resource_control(ctx->ctl,
+			MDP_RSRC_CTL_EVENT_EARLY_WAKE_UP))
+		pr_err("%s: failed to control resources\n", __func__);
+	ATRACE_END(__func__);
+}
+
+int mdss_mdp_cmd_get_idle_stats(struct mdss_mdp_ctl *ctl, char *buf,
+	size_t len)
+{
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(ctl->mfd);
+	struct mdss_mdp_cmd_ctx *ctx = ctl->intf_ctx[MASTER_CTX];
+	u64 residency[MDP_RSRC_CTL_STATE_MAX];
+	u32 cur = mdp5_data->resources_state;
+	unsigned long flags;
+	int ret;
+
+	if (!ctx)
+		return -ENODEV;
+
+	spin_lock_irqsave(&ctx->idle_lock, flags);
+	memcpy(residency, ctx->rsrc_residency_us, sizeof(residency));
+	if (cur < MDP_RSRC_CTL_STATE_MAX && ktime_to_us(ctx->rsrc_state_time))
+		residency[cur] += ktime_us_delta(ktime_get(),
+			ctx->rsrc_state_time);
+
+	ret = scnprintf(buf, len,
+		"residency: on: %llu ms gate: %llu ms off: %llu ms\n"
+		"kickoff wakes: %u avg: %llu us max: %lld us\n"
+		"cadence: %lld us jitter: %lld us wake latency: %lld us\n"
+		"predicted: collapses: %u wakes: %u hits: %u\n",
+		div_u64(residency[MDP_RSRC_CTL_STATE_ON], USEC_PER_MSEC),
+		div_u64(residency[MDP_RSRC_CTL_STATE_GATE], USEC_PER_MSEC),
+		div_u64(residency[MDP_RSRC_CTL_STATE_OFF], USEC_PER_MSEC),
+		ctx->koff_wakes, ctx->koff_wakes ?
+			div_u64(ctx->koff_wake_total_us, ctx->koff_wakes) : 0,
+		ctx->koff_wake_max_us, ctx->koff_interval_us,
+		ctx->koff_jitter_us, ctx->wake_latency_us,
+		ctx->predict_collapses, ctx->predict_wakes,
+		ctx->predict_hits);
+	spin_unlock_irqrestore(&ctx->idle_lock, flags);
+
+	return ret;
+}
+
 static int mdss_mdp_cmd_early_wake_up(struct mdss_mdp_ctl *ctl)
 {
 	u64 curr_time;
@@ -3541,6 +3800,7 @@ static int mdss_mdp_cmd_ctx_setup(struct mdss_mdp_ctl *ctl,
 	spin_lock_init(&ctx->clk_lock);
 	spin_lock_init(&ctx->koff_lock);
 	spin_lock_init(&ctx->ctlstart_lock);
+	spin_lock_init(&ctx->idle_lock);
 	mutex_init(&ctx->clk_mtx);
 	mutex_init(&ctx->mdp_rdptr_lock);
 	mutex_init(&ctx->mdp_wrptr_lock);
@@ -3549,6 +3809,7 @@ static int mdss_mdp_cmd_ctx_setup(struct mdss_mdp_ctl *ctl,
 		clk_ctrl_delayed_off_work);
 	INIT_WORK(&ctx->pp_done_work, pingpong_done_work);
 	INIT_WORK(&ctx->early_wakeup_clk_work, early_wakeup_work);
+	INIT_DELAYED_WORK(&ctx->predict_wakeup_work, predict_wakeup_work);
 	atomic_set(&ctx->pp_done_cnt, 0);
 	ctx->autorefresh_state = MDP_AUTOREFRESH_OFF;
 	ctx->autorefresh_frame_cnt = 0;
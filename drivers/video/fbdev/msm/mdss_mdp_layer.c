@@ -22,6 +22,7 @@
 #include <linux/msm_mdp.h>
 #include <linux/memblock.h>
 #include <linux/file.h>
+#include <linux/jhash.h>
 
 #include <soc/qcom/event_timer.h>
 #include "mdss.h"
@@ -1003,6 +1004,34 @@ static struct mdss_mdp_pipe *__find_layer_in_validate_q(
 	return found ? pipe : NULL;
 }
 
+/*
+ * __layer_stack_key() - hash of everything the bandwidth solution depends on
+ *
+ * Only meaningful when every layer matched its pipe in the validate queue,
+ * the per pipe parameters are then known to be unchanged and the key just
+ * has to tell the set of pipes and the panel timing apart. Never returns 0.
+ */
+static u32 __layer_stack_key(struct msm_fb_data_type *mfd,
+	struct mdss_mdp_validate_info_t *validate_info_list, int layer_count)
+{
+	struct mdss_panel_info *pinfo = mfd->panel_info;
+	struct mdp_input_layer *layer;
+	u32 key;
+	int i;
+
+	key = jhash_3words(pinfo->clk_rate, pinfo->current_fps,
+			mfd_to_ctl(mfd)->is_video_mode, layer_count);
+
+	for (i = 0; i < layer_count; i++) {
+		layer = validate_info_list[i].layer;
+		key = jhash_3words(layer->pipe_ndx,
+			validate_info_list[i].multirect.num,
+			layer->dst_rect.x, key);
+	}
+
+	return key ? key : 1;
+}
+
 static bool __find_pipe_in_list(struct list_head *head,
 	int pipe_ndx, struct mdss_mdp_pipe **out_pipe,
 	enum mdss_mdp_pipe_rect rect_num)
@@ -1678,7 +1707,7 @@ static int __validate_layers(struct msm_fb_data_type *mfd,
 	struct mdss_mdp_mixer *mixer = NULL;
 	struct mdp_input_layer *layer, *prev_layer, *layer_list;
 	struct mdss_mdp_validate_info_t *validate_info_list = NULL;
-	bool is_single_layer = false, force_validate;
+	bool is_single_layer = false, force_validate, stack_cached;
 	enum layer_pipe_q pipe_q_type;
 	enum layer_zorder_used zorder_used[MDSS_MDP_MAX_STAGE] = {0};
 	enum mdss_mdp_pipe_rect rect_num;
@@ -1745,6 +1774,7 @@ static int __validate_layers(struct msm_fb_data_type *mfd,
 	mutex_lock(&mfd->switch_lock);
 	force_validate = (mfd->switch_state != MDSS_MDP_NO_UPDATE_REQUESTED);
 	mutex_unlock(&mfd->switch_lock);
+	stack_cached = !force_validate;
 
 	for (i = 0; i < layer_count; i++) {
 		enum layer_zorder_used z = LAYER_ZORDER_NONE;
@@ -1853,6 +1883,7 @@ static int __validate_layers(struct msm_fb_data_type *mfd,
 			continue;
 		}
 
+		stack_cached = false;
 		mixer = mdss_mdp_mixer_get(mdp5_data->ctl, mixer_mux);
 		if (!mixer) {
 			pr_err("unable to get %s mixer\n",
@@ -1938,7 +1969,8 @@ static int __validate_layers(struct msm_fb_data_type *mfd,
 	}
 
 	ret = mdss_mdp_perf_bw_check(mdp5_data->ctl, left_plist, left_cnt,
-		right_plist, right_cnt);
+		right_plist, right_cnt, stack_cached ?
+		__layer_stack_key(mfd, validate_info_list, layer_count) : 0);
 	if (ret) {
 		pr_err("bw validation check failed: %d\n", ret);
 		goto validate_exit;
@@ -2195,6 +2227,114 @@ int mdss_mdp_layer_atomic_validate(struct msm_fb_data_type *mfd,
 	return __validate_layers(mfd, file, commit);
 }
 
+static void __layer_snap_fill(struct mdp_input_layer *layer,
+	struct mdss_mdp_layer_snap *snap)
+{
+	struct file *file;
+
+	memset(snap, 0, sizeof(*snap));
+
+	/*
+	 * Only the identity of the buffer matters here, so the reference is
+	 * dropped right away. A stale match just costs a needless switch,
+	 * the commit itself still reaches the panel either way.
+	 */
+	file = fget(layer->buffer.planes[0].fd);
+	if (file) {
+		snap->buf = file;
+		fput(file);
+	}
+
+	snap->src_rect = layer->src_rect;
+	snap->dst_rect = layer->dst_rect;
+	snap->flags = layer->flags;
+	snap->pipe_ndx = layer->pipe_ndx;
+	snap->z_order = layer->z_order;
+	snap->alpha = layer->alpha;
+	snap->width = layer->buffer.width;
+	snap->height = layer->buffer.height;
+	snap->format = layer->buffer.format;
+}
+
+static void __layer_roi_add(struct mdss_rect *roi, struct mdp_rect *rect)
+{
+	u32 x2, y2;
+
+	if (!rect->w || !rect->h)
+		return;
+
+	if (!roi->w || !roi->h) {
+		rect_copy_mdp_to_mdss(rect, roi);
+		return;
+	}
+
+	x2 = max_t(u32, roi->x + roi->w, rect->x + rect->w);
+	y2 = max_t(u32, roi->y + roi->h, rect->y + rect->h);
+	roi->x = min_t(u32, roi->x, rect->x);
+	roi->y = min_t(u32, roi->y, rect->y);
+	roi->w = x2 - roi->x;
+	roi->h = y2 - roi->y;
+}
+
+/*
+ * mdss_mdp_layer_frame_dirty() - check whether a commit changes the screen
+ * @mfd:	Framebuffer data structure for display
+ * @commit:	Commit version-1 structure for display
+ *
+ * Compares the input layers against the ones of the previous commit and
+ * collects the union of the destination rectangles that changed in
+ * dirty_roi. Returns true if anything on screen may change.
+ */
+bool mdss_mdp_layer_frame_dirty(struct msm_fb_data_type *mfd,
+	struct mdp_layer_commit_v1 *commit)
+{
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	struct mdss_mdp_layer_snap snap, *old;
+	struct mdp_input_layer *layer;
+	bool dirty = false;
+	u32 i;
+
+	if (!mdp5_data || !commit)
+		return true;
+
+	memset(&mdp5_data->dirty_roi, 0, sizeof(mdp5_data->dirty_roi));
+
+	if (commit->input_layer_cnt > MAX_LAYER_COUNT) {
+		mdp5_data->layer_snap_cnt = 0;
+		return true;
+	}
+
+	for (i = 0; i < commit->input_layer_cnt; i++) {
+		layer = &commit->input_layers[i];
+		old = &mdp5_data->layer_snap[i];
+
+		__layer_snap_fill(layer, &snap);
+		if (i < mdp5_data->layer_snap_cnt &&
+		    !memcmp(&snap, old, sizeof(snap)))
+			continue;
+
+		dirty = true;
+		__layer_roi_add(&mdp5_data->dirty_roi, &layer->dst_rect);
+		if (i < mdp5_data->layer_snap_cnt)
+			__layer_roi_add(&mdp5_data->dirty_roi, &old->dst_rect);
+		*old = snap;
+	}
+
+	/* layers that went away uncover what was below them */
+	for (; i < mdp5_data->layer_snap_cnt; i++) {
+		dirty = true;
+		__layer_roi_add(&mdp5_data->dirty_roi,
+				&mdp5_data->layer_snap[i].dst_rect);
+	}
+	mdp5_data->layer_snap_cnt = commit->input_layer_cnt;
+
+	pr_debug("fb%d: dirty=%d roi=%d,%d,%d,%d\n", mfd->index, dirty,
+		mdp5_data->dirty_roi.x, mdp5_data->dirty_roi.y,
+		mdp5_data->dirty_roi.w, mdp5_data->dirty_roi.h);
+
+	return dirty;
+}
+
 int mdss_mdp_layer_pre_commit_wfd(struct msm_fb_data_type *mfd,
 	struct file *file, struct mdp_layer_commit_v1 *commit)
 {
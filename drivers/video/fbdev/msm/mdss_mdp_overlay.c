@@ -619,8 +619,12 @@ int mdss_mdp_overlay_pipe_setup(struct msm_fb_data_type *mfd,
 	if (mdp5_data->ctl == NULL)
 		return -ENODEV;
 
+	/*
+	 * SSPPs have no rotation line buffers, so 90 degree rotation is only
+	 * available through the offline rotator. Flips are done at fetch.
+	 */
 	if (req->flags & MDP_ROT_90) {
-		pr_err("unsupported inline rotation\n");
+		pr_debug("inline rotation unsupported, use the rotator\n");
 		return -EOPNOTSUPP;
 	}
 
@@ -4265,6 +4269,30 @@ static ssize_t mdss_mdp_cmd_autorefresh_store(struct device *dev,
 	return len;
 }
 
+static ssize_t mdss_mdp_cmd_idle_stats_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)fbi->par;
+	struct mdss_mdp_ctl *ctl;
+
+	if (!mfd) {
+		pr_err("Invalid mfd structure\n");
+		return -EINVAL;
+	}
+
+	ctl = mfd_to_ctl(mfd);
+	if (!ctl) {
+		pr_err("Invalid ctl structure\n");
+		return -EINVAL;
+	}
+
+	if (mfd->panel_info->type != MIPI_CMD_PANEL)
+		return -EINVAL;
+
+	return mdss_mdp_cmd_get_idle_stats(ctl, buf, PAGE_SIZE);
+}
+
 
 /* Print the last CRC Value read for batch mode */
 static ssize_t mdss_mdp_misr_show(struct device *dev,
@@ -4373,6 +4401,8 @@ static DEVICE_ATTR(msm_misr_en, 0644,
 	mdss_mdp_misr_show, mdss_mdp_misr_store);
 static DEVICE_ATTR(msm_cmd_autorefresh_en, 0644,
 	mdss_mdp_cmd_autorefresh_show, mdss_mdp_cmd_autorefresh_store);
+static DEVICE_ATTR(msm_cmd_idle_stats, 0444, mdss_mdp_cmd_idle_stats_show,
+	NULL);
 static DEVICE_ATTR(vsync_event, 0444, mdss_mdp_vsync_show_event, NULL);
 static DEVICE_ATTR(lineptr_event, 0444, mdss_mdp_lineptr_show_event, NULL);
 static DEVICE_ATTR(lineptr_value, 0664,
@@ -4394,6 +4424,7 @@ static struct attribute *mdp_overlay_sysfs_attrs[] = {
 	&dev_attr_dyn_pu.attr,
 	&dev_attr_msm_misr_en.attr,
 	&dev_attr_msm_cmd_autorefresh_en.attr,
+	&dev_attr_msm_cmd_idle_stats.attr,
 	&dev_attr_hist_event.attr,
 	&dev_attr_bl_event.attr,
 	&dev_attr_ad_event.attr,
@@ -5531,7 +5562,7 @@ static int __handle_overlay_prepare(struct msm_fb_data_type *mfd,
 	}
 
 	ret = mdss_mdp_perf_bw_check(mdp5_data->ctl, left_plist, left_cnt,
-			right_plist, right_cnt);
+			right_plist, right_cnt, 0);
 
 validate_exit:
 	if (sort_needed)
@@ -6566,6 +6597,15 @@ static void mdss_mdp_signal_retire_fence(struct msm_fb_data_type *mfd,
 	pr_debug("Signaled (%d) pending retire fence\n", retire_cnt);
 }
 
+static void mdss_mdp_overlay_idle_notify(struct msm_fb_data_type *mfd)
+{
+	struct mdss_mdp_ctl *ctl = mfd_to_ctl(mfd);
+
+	/* command mode panels release their bandwidth on their own */
+	if (ctl && ctl->is_video_mode)
+		mdss_mdp_ctl_perf_idle(ctl);
+}
+
 static bool mdss_mdp_is_twm_en(void)
 {
 	struct mdss_data_type *mdata = mdss_mdp_get_mdata();
@@ -6620,6 +6660,7 @@ int mdss_mdp_overlay_init(struct msm_fb_data_type *mfd)
 	mdp5_interface->configure_panel = mdss_mdp_update_panel_info;
 	mdp5_interface->input_event_handler = mdss_mdp_input_event_handler;
 	mdp5_interface->signal_retire_fence = mdss_mdp_signal_retire_fence;
+	mdp5_interface->idle_notify_fnc = mdss_mdp_overlay_idle_notify;
 	mdp5_interface->is_twm_en = mdss_mdp_is_twm_en;
 
 	if (mfd->panel_info->type == WRITEBACK_PANEL) {
@@ -6631,6 +6672,7 @@ int mdss_mdp_overlay_init(struct msm_fb_data_type *mfd)
 		mdp5_interface->atomic_validate =
 			mdss_mdp_layer_atomic_validate;
 		mdp5_interface->pre_commit = mdss_mdp_layer_pre_commit;
+		mdp5_interface->frame_dirty = mdss_mdp_layer_frame_dirty;
 	}
 
 	INIT_LIST_HEAD(&mdp5_data->pipes_used);
@@ -18,6 +18,7 @@
 #include "mdss_mdp_pp.h"
 #include <linux/uaccess.h>
 #include <linux/spinlock.h>
+#include <linux/jhash.h>
 #include <linux/delay.h>
 #include <linux/msm-bus.h>
 #include <linux/msm-bus-board.h>
@@ -441,6 +442,26 @@ static u32 igc_limited[IGC_LUT_ENTRIES] = {
 #define IS_SIX_ZONE_DIRTY(d, pa)	(((d) & PP_FLAGS_DIRTY_PA) && \
 		((pa) & MDP_PP_PA_SIX_ZONE_ENABLE))
 
+enum pp_lut_type {
+	PP_LUT_IGC,
+	PP_LUT_PGC,
+	PP_LUT_GAMUT,
+	PP_LUT_PA,
+	PP_LUT_MAX,
+};
+
+/*
+ * Hash of the DSPP LUT config last programmed for a display. Config writes
+ * that hash the same do not mark the feature dirty, so clients resending
+ * unchanged tables every frame don't cost a full LUT reprogram.
+ */
+struct pp_lut_sig {
+	u32 hash;
+	bool valid;
+};
+
+static struct pp_lut_sig pp_lut_sig[MDSS_BLOCK_DISP_NUM][PP_LUT_MAX];
+
 #define PP_SSPP		0
 #define PP_DSPP		1
 
@@ -2297,6 +2318,187 @@ static void pp_dspp_opmode_config(struct mdss_mdp_ctl *ctl, u32 num,
 		*opmode |= MDSS_MDP_DSPP_OP_ARGC_LUT_EN;
 }
 
+static u32 pp_igc_lut_hash(u32 disp_num, u32 *words)
+{
+	struct mdss_pp_res_type_v1_7 *res_v17 = mdss_pp_res->pp_data_v1_7;
+	struct mdp_igc_lut_data *cfg = &mdss_pp_res->igc_disp_cfg[disp_num];
+	struct mdp_igc_lut_data_v1_7 *v17;
+	u32 hash, len;
+
+	hash = jhash_2words(cfg->ops, cfg->version, 0);
+	if (pp_ops[IGC].pp_set_config && res_v17) {
+		v17 = &res_v17->igc_v17_data[disp_num];
+		len = min_t(u32, v17->len, IGC_LUT_ENTRIES);
+		hash = jhash_2words(v17->table_fmt, len, hash);
+		hash = jhash2(res_v17->igc_table_c0_c1[disp_num], len, hash);
+		hash = jhash2(res_v17->igc_table_c2[disp_num], len, hash);
+	} else {
+		len = min_t(u32, cfg->len, IGC_LUT_ENTRIES);
+		hash = jhash_1word(len, hash);
+		hash = jhash2(mdss_pp_res->igc_lut_c0c1[disp_num], len, hash);
+		hash = jhash2(mdss_pp_res->igc_lut_c2[disp_num], len, hash);
+	}
+	*words = len * 3;
+
+	return hash;
+}
+
+static u32 pp_pgc_lut_hash(u32 disp_num, u32 *words)
+{
+	struct mdss_pp_res_type_v1_7 *res_v17 = mdss_pp_res->pp_data_v1_7;
+	struct mdp_pgc_lut_data *cfg = &mdss_pp_res->pgc_disp_cfg[disp_num];
+	u32 hash, len;
+
+	hash = jhash_2words(cfg->flags, cfg->version, 0);
+	if (pp_ops[GC].pp_set_config && res_v17) {
+		len = min_t(u32, res_v17->pgc_dspp_v17_data[disp_num].len,
+			    PGC_LUT_ENTRIES);
+		hash = jhash_1word(len, hash);
+		hash = jhash2(res_v17->pgc_table_c0[disp_num], len, hash);
+		hash = jhash2(res_v17->pgc_table_c1[disp_num], len, hash);
+		hash = jhash2(res_v17->pgc_table_c2[disp_num], len, hash);
+		*words = len * 3;
+	} else {
+		hash = jhash_3words(cfg->num_r_stages, cfg->num_g_stages,
+				    cfg->num_b_stages, hash);
+		hash = jhash(mdss_pp_res->gc_lut_r[disp_num],
+			     sizeof(mdss_pp_res->gc_lut_r[disp_num]), hash);
+		hash = jhash(mdss_pp_res->gc_lut_g[disp_num],
+			     sizeof(mdss_pp_res->gc_lut_g[disp_num]), hash);
+		hash = jhash(mdss_pp_res->gc_lut_b[disp_num],
+			     sizeof(mdss_pp_res->gc_lut_b[disp_num]), hash);
+		/* x_start, slope and offset per stage */
+		*words = (cfg->num_r_stages + cfg->num_g_stages +
+			  cfg->num_b_stages) * 3;
+	}
+
+	return hash;
+}
+
+static u32 pp_gamut_lut_hash(u32 disp_num, u32 *words)
+{
+	struct mdss_pp_res_type_v1_7 *res_v17 = mdss_pp_res->pp_data_v1_7;
+	struct mdp_gamut_cfg_data *cfg = &mdss_pp_res->gamut_disp_cfg[disp_num];
+	struct mdp_gamut_data_v1_7 *v17;
+	u32 hash, len = 0;
+	int i;
+
+	hash = jhash_3words(cfg->flags, cfg->version, cfg->gamut_first, 0);
+	if (pp_ops[GAMUT].pp_set_config && res_v17) {
+		v17 = &res_v17->gamut_v17_data[disp_num];
+		hash = jhash_2words(v17->mode, v17->map_en, hash);
+		for (i = 0; i < MDP_GAMUT_TABLE_NUM_V1_7; i++) {
+			if (!v17->c0_data[i] || !v17->c1_c2_data[i])
+				continue;
+			hash = jhash2(v17->c0_data[i], v17->tbl_size[i], hash);
+			hash = jhash2(v17->c1_c2_data[i], v17->tbl_size[i],
+				      hash);
+			len += v17->tbl_size[i] * 2;
+		}
+		for (i = 0; i < MDP_GAMUT_SCALE_OFF_TABLE_NUM; i++) {
+			if (!v17->scale_off_data[i])
+				continue;
+			hash = jhash2(v17->scale_off_data[i],
+				      v17->tbl_scale_off_sz[i], hash);
+			len += v17->tbl_scale_off_sz[i];
+		}
+	} else {
+		for (i = 0; i < MDP_GAMUT_TABLE_NUM; i++)
+			len += cfg->tbl_size[i];
+		len = min_t(u32, len * 3, GAMUT_TOTAL_TABLE_SIZE * 3);
+		hash = jhash(mdss_pp_res->gamut_tbl[disp_num],
+			     len * sizeof(uint16_t), hash);
+	}
+	*words = len;
+
+	return hash;
+}
+
+static u32 pp_pa_lut_hash(u32 disp_num, u32 *words)
+{
+	struct mdss_pp_res_type_v1_7 *res_v17 = mdss_pp_res->pp_data_v1_7;
+	struct mdp_pa_v2_cfg_data *cfg = &mdss_pp_res->pa_v2_disp_cfg[disp_num];
+	struct mdp_pa_data_v1_7 *v17;
+	u32 hash;
+
+	hash = jhash_2words(cfg->flags, cfg->version, 0);
+	if (pp_ops[PA].pp_set_config && res_v17) {
+		v17 = &res_v17->pa_v17_data[disp_num];
+		/* The scalar adjustments all precede the curve pointers */
+		hash = jhash(v17, offsetof(struct mdp_pa_data_v1_7,
+					   six_zone_curve_p0), hash);
+		hash = jhash2(res_v17->six_zone_lut_p0[disp_num],
+			      MDP_SIX_ZONE_LUT_SIZE, hash);
+		hash = jhash2(res_v17->six_zone_lut_p1[disp_num],
+			      MDP_SIX_ZONE_LUT_SIZE, hash);
+	} else {
+		hash = jhash(&cfg->pa_v2_data, offsetof(struct mdp_pa_v2_data,
+						six_zone_curve_p0), hash);
+		hash = jhash2(mdss_pp_res->six_zone_lut_curve_p0[disp_num],
+			      MDP_SIX_ZONE_LUT_SIZE, hash);
+		hash = jhash2(mdss_pp_res->six_zone_lut_curve_p1[disp_num],
+			      MDP_SIX_ZONE_LUT_SIZE, hash);
+	}
+	*words = MDP_SIX_ZONE_LUT_SIZE;
+
+	return hash;
+}
+
+/*
+ * Hash the cached config of @type for @disp_num: its flags, any scalar
+ * settings and the tables. @words is set to the number of LUT entries,
+ * close to the number of register writes it takes to program them.
+ */
+static u32 pp_lut_hash(enum pp_lut_type type, u32 disp_num, u32 *words)
+{
+	switch (type) {
+	case PP_LUT_IGC:
+		return pp_igc_lut_hash(disp_num, words);
+	case PP_LUT_PGC:
+		return pp_pgc_lut_hash(disp_num, words);
+	case PP_LUT_GAMUT:
+		return pp_gamut_lut_hash(disp_num, words);
+	case PP_LUT_PA:
+		return pp_pa_lut_hash(disp_num, words);
+	default:
+		*words = 0;
+		return 0;
+	}
+}
+
+/* Record what is about to be written to the DSPP of @disp_num */
+static void pp_lut_sig_update(enum pp_lut_type type, u32 disp_num)
+{
+	struct pp_lut_sig *sig = &pp_lut_sig[disp_num][type];
+	u32 words;
+
+	sig->hash = pp_lut_hash(type, disp_num, &words);
+	sig->valid = true;
+}
+
+/*
+ * Called with mdss_pp_mutex held once a config write has been cached.
+ * Returns true when the cache matches what the hardware already holds,
+ * so the feature doesn't need to be marked dirty.
+ */
+static bool pp_lut_unchanged(enum pp_lut_type type, u32 disp_num)
+{
+	struct mdss_data_type *mdata = mdss_mdp_get_mdata();
+	struct pp_lut_sig *sig = &pp_lut_sig[disp_num][type];
+	u32 words;
+
+	if (!sig->valid ||
+	    pp_lut_hash(type, disp_num, &words) != sig->hash)
+		return false;
+
+	mdata->pp_lut_skip_cnt++;
+	mdata->pp_lut_writes_avoided += words;
+	pr_debug("disp %d lut %d unchanged, skipping %d writes\n",
+		 disp_num, type, words);
+
+	return true;
+}
+
 static int pp_dspp_setup(u32 disp_num, struct mdss_mdp_mixer *mixer)
 {
 	u32 ad_flags, flags, dspp_num, opmode = 0, ad_bypass;
@@ -2367,6 +2569,7 @@ static int pp_dspp_setup(u32 disp_num, struct mdss_mdp_mixer *mixer)
 		goto dspp_exit;
 
 	if (flags & PP_FLAGS_DIRTY_PA) {
+		pp_lut_sig_update(PP_LUT_PA, disp_num);
 		if (!pp_ops[PA].pp_set_config) {
 			if (mdata->mdp_rev >= MDSS_MDP_HW_REV_103) {
 				pa_v2_cfg_data =
@@ -2405,6 +2608,7 @@ static int pp_dspp_setup(u32 disp_num, struct mdss_mdp_mixer *mixer)
 	}
 
 	if (flags & PP_FLAGS_DIRTY_IGC) {
+		pp_lut_sig_update(PP_LUT_IGC, disp_num);
 		if (!pp_ops[IGC].pp_set_config) {
 			pp_igc_config(flags,
 			      mdata->mdp_base + MDSS_MDP_REG_IGC_DSPP_BASE,
@@ -2455,6 +2659,7 @@ static int pp_dspp_setup(u32 disp_num, struct mdss_mdp_mixer *mixer)
 		}
 	}
 	if (flags & PP_FLAGS_DIRTY_GAMUT) {
+		pp_lut_sig_update(PP_LUT_GAMUT, disp_num);
 		if (!pp_ops[GAMUT].pp_set_config) {
 			pp_gamut_config(&mdss_pp_res->gamut_disp_cfg[disp_num],
 					 base, pp_sts);
@@ -2472,6 +2677,7 @@ static int pp_dspp_setup(u32 disp_num, struct mdss_mdp_mixer *mixer)
 	}
 
 	if (flags & PP_FLAGS_DIRTY_PGC) {
+		pp_lut_sig_update(PP_LUT_PGC, disp_num);
 		pgc_config = &mdss_pp_res->pgc_disp_cfg[disp_num];
 		if (pp_ops[GC].pp_set_config) {
 			if (mdata->pp_block_off.dspp_pgc_off == U32_MAX) {
@@ -2690,6 +2896,8 @@ int mdss_mdp_pp_resume(struct msm_fb_data_type *mfd)
 
 	disp_num = mfd->index;
 	pp_sts = mdss_pp_res->pp_disp_sts[disp_num];
+	/* The hardware lost its tables, so nothing can be skipped */
+	memset(pp_lut_sig[disp_num], 0, sizeof(pp_lut_sig[disp_num]));
 
 	if (pp_sts.pa_sts & PP_STS_ENABLE) {
 		flags |= PP_FLAGS_DIRTY_PA;
@@ -3352,6 +3560,8 @@ int mdss_mdp_pa_v2_config(struct msm_fb_data_type *mfd,
 			pa_v2_cache->pa_v2_data.six_zone_curve_p1 =
 				mdss_pp_res->six_zone_lut_curve_p1[disp_num];
 		}
+		if (pp_lut_unchanged(PP_LUT_PA, disp_num))
+			goto pa_config_exit;
 		mdss_pp_res->pp_disp_flags[disp_num] |= PP_FLAGS_DIRTY_PA;
 	}
 
@@ -3941,6 +4151,8 @@ int mdss_mdp_igc_lut_config(struct msm_fb_data_type *mfd,
 		mdss_pp_res->igc_disp_cfg[disp_num].c2_data =
 			&mdss_pp_res->igc_lut_c2[disp_num][0];
 igc_set_dirty:
+		if (pp_lut_unchanged(PP_LUT_IGC, disp_num))
+			goto igc_config_exit;
 		mdss_pp_res->pp_disp_flags[disp_num] |= PP_FLAGS_DIRTY_IGC;
 	}
 
@@ -4290,6 +4502,9 @@ int mdss_mdp_argc_config(struct msm_fb_data_type *mfd,
 			pgc_ptr->b_data =
 				&mdss_pp_res->gc_lut_b[disp_num][0];
 		}
+		if (dirty_flag == PP_FLAGS_DIRTY_PGC &&
+		    pp_lut_unchanged(PP_LUT_PGC, disp_num))
+			goto argc_config_exit;
 		mdss_pp_res->pp_disp_flags[disp_num] |= dirty_flag;
 	}
 argc_config_exit:
@@ -4732,6 +4947,8 @@ int mdss_mdp_gamut_config(struct msm_fb_data_type *mfd,
 		}
 		mdss_pp_res->gamut_disp_cfg[disp_num] = local_cfg;
 gamut_set_dirty:
+		if (pp_lut_unchanged(PP_LUT_GAMUT, disp_num))
+			goto gamut_config_exit;
 		mdss_pp_res->pp_disp_flags[disp_num] |= PP_FLAGS_DIRTY_GAMUT;
 	}
 gamut_config_exit:
@@ -295,6 +295,32 @@ TRACE_EVENT(mdp_perf_update_bus,
 			__entry->ib_quota)
 );
 
+TRACE_EVENT(mdp_perf_bus_vote,
+	TP_PROTO(int client, unsigned long long fetch_bw,
+	unsigned long long ab_quota, unsigned long long ib_quota, bool idle),
+	TP_ARGS(client, fetch_bw, ab_quota, ib_quota, idle),
+	TP_STRUCT__entry(
+			__field(int, client)
+			__field(u64, fetch_bw)
+			__field(u64, ab_quota)
+			__field(u64, ib_quota)
+			__field(bool, idle)
+	),
+	TP_fast_assign(
+			__entry->client = client;
+			__entry->fetch_bw = fetch_bw;
+			__entry->ab_quota = ab_quota;
+			__entry->ib_quota = ib_quota;
+			__entry->idle = idle;
+	),
+	TP_printk("client:%d fetch=%llu ab=%llu ib=%llu idle=%d",
+			__entry->client,
+			__entry->fetch_bw,
+			__entry->ab_quota,
+			__entry->ib_quota,
+			__entry->idle)
+);
+
 TRACE_EVENT(mdp_compare_bw,
 	TP_PROTO(unsigned long long new_ab, unsigned long long new_ib,
 		unsigned long long new_wb,
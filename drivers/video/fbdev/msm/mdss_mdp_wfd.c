@@ -17,6 +17,7 @@
 #include <linux/delay.h>
 #include <linux/file.h>
 #include <linux/uaccess.h>
+#include <linux/dma-buf.h>
 
 #include "mdss_mdp_wfd.h"
 
@@ -26,6 +27,29 @@
  */
 #define WFD_TIMEOUT_IN_MS 150
 
+/*
+ * number of retired output buffers to keep imported, enough to cover the
+ * input queue of an encoder session
+ */
+#define WFD_CACHE_SIZE 8
+
+static void mdss_mdp_wfd_cache_flush(struct mdss_mdp_wfd *wfd)
+{
+	struct mdss_mdp_wfd_data *node, *temp;
+	LIST_HEAD(flush);
+
+	mutex_lock(&wfd->lock);
+	list_splice_init(&wfd->cache, &flush);
+	wfd->cache_cnt = 0;
+	mutex_unlock(&wfd->lock);
+
+	list_for_each_entry_safe(node, temp, &flush, next) {
+		list_del(&node->next);
+		mdss_mdp_data_free(&node->data, true, DMA_FROM_DEVICE);
+		kfree(node);
+	}
+}
+
 struct mdss_mdp_wfd *mdss_mdp_wfd_init(struct device *device,
 	struct mdss_mdp_ctl *ctl)
 {
@@ -37,6 +61,7 @@ struct mdss_mdp_wfd *mdss_mdp_wfd_init(struct device *device,
 
 	mutex_init(&wfd->lock);
 	INIT_LIST_HEAD(&wfd->data_queue);
+	INIT_LIST_HEAD(&wfd->cache);
 	init_completion(&wfd->comp);
 	wfd->ctl = ctl;
 	wfd->device = device;
@@ -51,6 +76,7 @@ void mdss_mdp_wfd_deinit(struct mdss_mdp_wfd *wfd)
 	list_for_each_entry_safe(node, temp, &wfd->data_queue, next)
 	mdss_mdp_wfd_remove_data(wfd, node);
 
+	mdss_mdp_wfd_cache_flush(wfd);
 	kfree(wfd);
 }
 
@@ -81,6 +107,8 @@ void mdss_mdp_wfd_destroy(struct mdss_mdp_wfd *wfd)
 {
 	struct mdss_mdp_ctl *ctl = wfd->ctl;
 
+	mdss_mdp_wfd_cache_flush(wfd);
+
 	if (!ctl)
 		return;
 
@@ -318,6 +346,103 @@ static int mdss_mdp_wfd_import_data(struct device *device,
 	return ret;
 }
 
+static bool mdss_mdp_wfd_data_match(struct mdss_mdp_wfd_data *wfd_data,
+	struct mdp_output_layer *layer)
+{
+	struct mdp_layer_buffer *old = &wfd_data->layer.buffer;
+	struct mdp_layer_buffer *new = &layer->buffer;
+	struct dma_buf *dma_buf;
+	bool match;
+	int i;
+
+	if ((wfd_data->layer.flags != layer->flags) ||
+	    (old->width != new->width) || (old->height != new->height) ||
+	    (old->format != new->format) ||
+	    (old->plane_count != new->plane_count))
+		return false;
+
+	for (i = 0; i < new->plane_count; i++) {
+		if ((old->planes[i].offset != new->planes[i].offset) ||
+		    (old->planes[i].stride != new->planes[i].stride))
+			return false;
+
+		dma_buf = dma_buf_get(new->planes[i].fd);
+		if (IS_ERR(dma_buf))
+			return false;
+		match = (dma_buf == wfd_data->data.p[i].srcp_dma_buf);
+		dma_buf_put(dma_buf);
+
+		if (!match)
+			return false;
+	}
+
+	return true;
+}
+
+static struct mdss_mdp_wfd_data *mdss_mdp_wfd_cache_get(
+	struct mdss_mdp_wfd *wfd, struct mdp_output_layer *layer)
+{
+	struct mdss_mdp_wfd_data *wfd_data;
+
+	if (layer->buffer.plane_count > MAX_PLANES)
+		return NULL;
+
+	mutex_lock(&wfd->lock);
+	list_for_each_entry(wfd_data, &wfd->cache, next) {
+		if (mdss_mdp_wfd_data_match(wfd_data, layer)) {
+			list_del_init(&wfd_data->next);
+			wfd->cache_cnt--;
+			mutex_unlock(&wfd->lock);
+			return wfd_data;
+		}
+	}
+	mutex_unlock(&wfd->lock);
+
+	return NULL;
+}
+
+/*
+ * Keep the buffer imported and mapped once the frame is written out. The
+ * encoder hands the same buffers back frame after frame, so the next
+ * commit can skip the dma-buf attach and map done by the import.
+ */
+static void mdss_mdp_wfd_retire_data(struct mdss_mdp_wfd *wfd,
+	struct mdss_mdp_wfd_data *wfd_data)
+{
+	struct mdss_mdp_wfd_data *evict = NULL;
+	int i;
+
+	if (wfd_data->layer.flags & MDP_LAYER_SECURE_SESSION)
+		goto free;
+
+	for (i = 0; i < wfd_data->data.num_planes; i++)
+		if (!wfd_data->data.p[i].srcp_dma_buf ||
+		    !wfd_data->data.p[i].mapped)
+			goto free;
+
+	mutex_lock(&wfd->lock);
+	list_del_init(&wfd_data->next);
+	if (list_empty(&wfd->data_queue))
+		complete(&wfd->comp);
+	list_add(&wfd_data->next, &wfd->cache);
+	if (++wfd->cache_cnt > WFD_CACHE_SIZE) {
+		evict = list_last_entry(&wfd->cache,
+				struct mdss_mdp_wfd_data, next);
+		list_del(&evict->next);
+		wfd->cache_cnt--;
+	}
+	mutex_unlock(&wfd->lock);
+
+	if (evict) {
+		mdss_mdp_data_free(&evict->data, true, DMA_FROM_DEVICE);
+		kfree(evict);
+	}
+	return;
+
+free:
+	mdss_mdp_wfd_remove_data(wfd, wfd_data);
+}
+
 struct mdss_mdp_wfd_data *mdss_mdp_wfd_add_data(
 	struct mdss_mdp_wfd *wfd,
 	struct mdp_output_layer *layer)
@@ -330,6 +455,12 @@ struct mdss_mdp_wfd_data *mdss_mdp_wfd_add_data(
 		return ERR_PTR(-EINVAL);
 	}
 
+	wfd_data = mdss_mdp_wfd_cache_get(wfd, layer);
+	if (wfd_data) {
+		wfd_data->layer = *layer;
+		goto queue;
+	}
+
 	wfd_data = kzalloc(sizeof(struct mdss_mdp_wfd_data), GFP_KERNEL);
 	if (!wfd_data)
 		return ERR_PTR(-ENOMEM);
@@ -343,6 +474,7 @@ struct mdss_mdp_wfd_data *mdss_mdp_wfd_add_data(
 		return ERR_PTR(ret);
 	}
 
+queue:
 	mutex_lock(&wfd->lock);
 	list_add_tail(&wfd_data->next, &wfd->data_queue);
 	mutex_unlock(&wfd->lock);
@@ -476,7 +608,7 @@ int mdss_mdp_wfd_commit_done(struct mdss_mdp_wfd *wfd)
 				struct mdss_mdp_wfd_data, next);
 	mutex_unlock(&wfd->lock);
 
-	mdss_mdp_wfd_remove_data(wfd, wfd_data);
+	mdss_mdp_wfd_retire_data(wfd, wfd_data);
 
 	return 0;
 }
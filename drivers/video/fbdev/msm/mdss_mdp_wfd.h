@@ -30,6 +30,9 @@ struct mdss_mdp_wfd_data {
 struct mdss_mdp_wfd {
 	struct mutex lock;
 	struct list_head data_queue;
+	/* retired output buffers kept imported and mapped for reuse */
+	struct list_head cache;
+	u32 cache_cnt;
 	struct mdss_mdp_ctl *ctl;
 	struct device *device;
 	struct completion comp;
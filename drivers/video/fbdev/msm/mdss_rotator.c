@@ -226,6 +226,11 @@ static void mdss_rotator_set_clk_rate(struct mdss_rot_mgr *mgr,
 
 	if (clk) {
 		mutex_lock(&mgr->clk_lock);
+		/* every request lands here, mostly with the same rate */
+		if (rate == mgr->rot_clk_rate[clk_idx]) {
+			mutex_unlock(&mgr->clk_lock);
+			return;
+		}
 		clk_rate = clk_round_rate(clk, rate);
 		if (IS_ERR_VALUE(clk_rate)) {
 			pr_err("unable to round rate err=%ld\n", clk_rate);
@@ -236,7 +241,10 @@ static void mdss_rotator_set_clk_rate(struct mdss_rot_mgr *mgr,
 			} else {
 				pr_debug("rotator clk rate=%lu\n", clk_rate);
 				MDSS_XLOG(clk_rate);
+				mgr->rot_clk_rate[clk_idx] = rate;
 			}
+		} else {
+			mgr->rot_clk_rate[clk_idx] = rate;
 		}
 		mutex_unlock(&mgr->clk_lock);
 	} else {
@@ -298,6 +306,8 @@ static int mdss_rotator_clk_ctrl(struct mdss_rot_mgr *mgr, int enable)
 				}
 			} else {
 				clk_disable_unprepare(clk);
+				/* recheck the hw rate on the next request */
+				mgr->rot_clk_rate[i] = 0;
 			}
 		}
 		mutex_lock(&mgr->bus_lock);
@@ -2102,6 +2112,12 @@ static int mdss_rotator_config_session(struct mdss_rot_mgr *mgr,
 
 	ATRACE_BEGIN(__func__);
 	mutex_lock(&private->perf_lock);
+	/* the bw and clk votes only depend on the session config */
+	if (!memcmp(&perf->config, &config, sizeof(config))) {
+		mutex_unlock(&private->perf_lock);
+		pr_debug("session id=%u config unchanged\n", config.session_id);
+		goto done;
+	}
 	perf->config = config;
 	ret = mdss_rotator_calc_perf(perf);
 	mutex_unlock(&private->perf_lock);
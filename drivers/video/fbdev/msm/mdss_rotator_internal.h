@@ -178,6 +178,8 @@ struct mdss_rot_mgr {
 	struct mutex clk_lock;
 	int res_ref_cnt;
 	struct clk *rot_clk[MDSS_CLK_ROTATOR_END_IDX];
+	/* last rate requested per clock, to skip unchanged requests */
+	unsigned long rot_clk_rate[MDSS_CLK_ROTATOR_END_IDX];
 	int rot_enable_clk_cnt;
 
 	bool has_downscale;
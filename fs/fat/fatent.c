@@ -588,7 +588,7 @@ int fat_free_clusters(struct inode *inode, int cluster)
 				sb_issue_discard(sb,
 					fat_clus_to_blknr(sbi, first_cl),
 					nr_clus * sbi->sec_per_clus,
-					GFP_NOFS, 0);
+					GFP_NOFS, BLKDEV_DISCARD_ASYNC);
 
 				first_cl = cluster;
 			}
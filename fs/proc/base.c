@@ -80,6 +80,7 @@
 #include <linux/poll.h>
 #include <linux/nsproxy.h>
 #include <linux/oom.h>
+#include <linux/lowmemorykiller.h>
 #include <linux/elf.h>
 #include <linux/pid_namespace.h>
 #include <linux/user_namespace.h>
@@ -1120,12 +1121,15 @@ static int __set_oom_adj(struct file *file, int oom_adj, bool legacy)
 	if (!legacy && has_capability_noaudit(current, CAP_SYS_RESOURCE))
 		task->signal->oom_score_adj_min = (short)oom_adj;
 	trace_oom_score_adj_update(task);
+	lowmem_adj_changed(task);
 
 	if (mm) {
 		struct task_struct *p;
 
 		rcu_read_lock();
 		for_each_process(p) {
+			bool shared = false;
+
 			if (same_thread_group(task, p))
 				continue;
 
@@ -1138,8 +1142,11 @@ static int __set_oom_adj(struct file *file, int oom_adj, bool legacy)
 				p->signal->oom_score_adj = oom_adj;
 				if (!legacy && has_capability_noaudit(current, CAP_SYS_RESOURCE))
 					p->signal->oom_score_adj_min = (short)oom_adj;
+				shared = true;
 			}
 			task_unlock(p);
+			if (shared)
+				lowmem_adj_changed(p);
 		}
 		rcu_read_unlock();
 		mmdrop(mm);
@@ -56,6 +56,27 @@ struct blkcg {
 #endif
 };
 
+enum blkg_lat_op {
+	BLKG_LAT_READ,
+	BLKG_LAT_WRITE,
+	BLKG_LAT_DISCARD,
+	BLKG_LAT_FLUSH,
+
+	BLKG_LAT_NR_OPS,
+};
+
+/*
+ * Completion latency histogram, kept per cpu so that the completion path
+ * only does an unlocked increment.  Bucket i counts requests that took
+ * [2^i, 2^(i+1)) usecs from allocation to completion, bucket 0 also
+ * takes anything under a usec and the last one everything slower.
+ */
+#define BLKG_LAT_BUCKETS	24
+
+struct blkg_lat_stat {
+	u64				bucket[BLKG_LAT_NR_OPS][BLKG_LAT_BUCKETS];
+};
+
 /*
  * blkg_[rw]stat->aux_cnt is excluded for local stats but included for
  * recursive.  Used to carry stats of dead children, and, for blkg_rwstat,
@@ -130,6 +151,8 @@ struct blkcg_gq {
 	struct blkg_rwstat		stat_bytes;
 	struct blkg_rwstat		stat_ios;
 
+	struct blkg_lat_stat __percpu	*lat_stat;
+
 	struct blkg_policy_data		*pd[BLKCG_MAX_POLS];
 
 	struct rcu_head			rcu_head;
@@ -481,6 +504,47 @@ static inline struct request_list *blk_rq_rl(struct request *rq)
 	return rq->rl;
 }
 
+/**
+ * blkg_account_io_latency - account a completed request to its blkg
+ * @rq: request being completed
+ *
+ * Add the time since @rq was allocated to the latency histogram of the
+ * blkg @rq's request_list belongs to.
+ */
+static inline void blkg_account_io_latency(struct request *rq)
+{
+	struct blkcg_gq *blkg;
+	u64 now, us;
+	int op, idx;
+
+	if (rq->cmd_type != REQ_TYPE_FS || (rq->cmd_flags & REQ_FLUSH_SEQ) ||
+	    !rq->rl)
+		return;
+	blkg = rq->rl->blkg;
+	if (!blkg || !blkg->lat_stat)
+		return;
+
+	switch (req_op(rq)) {
+	case REQ_OP_DISCARD:
+	case REQ_OP_SECURE_ERASE:
+		op = BLKG_LAT_DISCARD;
+		break;
+	case REQ_OP_FLUSH:
+		op = BLKG_LAT_FLUSH;
+		break;
+	default:
+		op = rq_data_dir(rq) == WRITE ? BLKG_LAT_WRITE : BLKG_LAT_READ;
+		break;
+	}
+
+	now = sched_clock();
+	us = time_after64(now, rq_start_time_ns(rq)) ?
+		div_u64(now - rq_start_time_ns(rq), NSEC_PER_USEC) : 0;
+	idx = us ? min_t(int, fls64(us) - 1, BLKG_LAT_BUCKETS - 1) : 0;
+
+	this_cpu_inc(blkg->lat_stat->bucket[op][idx]);
+}
+
 struct request_list *__blk_queue_next_rl(struct request_list *rl,
 					 struct request_queue *q);
 /**
@@ -766,6 +830,7 @@ static inline struct request_list *blk_get_rl(struct request_queue *q,
 static inline void blk_put_rl(struct request_list *rl) { }
 static inline void blk_rq_set_rl(struct request *rq, struct request_list *rl) { }
 static inline struct request_list *blk_rq_rl(struct request *rq) { return &rq->q->root_rl; }
+static inline void blkg_account_io_latency(struct request *rq) { }
 
 static inline bool blkcg_bio_issue_check(struct request_queue *q,
 					 struct bio *bio) { return true; }
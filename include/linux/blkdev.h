@@ -36,6 +36,7 @@ struct sg_io_hdr;
 struct bsg_job;
 struct blkcg_gq;
 struct blk_flush_queue;
+struct blk_discard_queue;
 struct pr_ops;
 
 #define BLKDEV_MIN_RQ	4
@@ -464,6 +465,8 @@ struct request_queue {
 	 * for flush operations
 	 */
 	struct blk_flush_queue	*fq;
+	struct blk_plug_stat __percpu	*plug_stat;
+	struct blk_discard_queue	*discard_q;
 
 	struct list_head	requeue_list;
 	spinlock_t		requeue_lock;
@@ -1104,6 +1107,20 @@ static inline void blk_post_runtime_resume(struct request_queue *q, int err) {}
 static inline void blk_set_runtime_active(struct request_queue *q) {}
 #endif
 
+/*
+ * Per-cpu plug flush accounting of a legacy request_queue: how many plug
+ * flushes reached it, how many requests they carried and how many of
+ * those merged with queued requests on insertion instead of being added.
+ * lookups_skipped counts plugged bios that didn't search the elevator
+ * under the queue lock because the plug flush merges them anyway.
+ */
+struct blk_plug_stat {
+	unsigned long		flushes;
+	unsigned long		requests;
+	unsigned long		merged;
+	unsigned long		lookups_skipped;
+};
+
 /*
  * blk_plug permits building a queue of related requests by holding the I/O
  * fragments for a short period. This allows merging of sequential requests
@@ -1186,6 +1203,7 @@ static inline struct request *blk_map_queue_find_tag(struct blk_queue_tag *bqt,
 
 #define BLKDEV_DISCARD_SECURE	(1 << 0)	/* issue a secure erase */
 #define BLKDEV_DISCARD_ZERO	(1 << 1)	/* must reliably zero data */
+#define BLKDEV_DISCARD_ASYNC	(1 << 2)	/* may be deferred until idle */
 
 extern int blkdev_issue_flush(struct block_device *, gfp_t, sector_t *);
 extern int blkdev_issue_discard(struct block_device *bdev, sector_t sector,
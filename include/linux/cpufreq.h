@@ -600,6 +600,22 @@ extern struct cpufreq_governor cpufreq_gov_sched;
 #define CPUFREQ_DEFAULT_GOVERNOR	(&cpufreq_gov_sched)
 #endif
 
+/* Events that can fire the interactive governor's boost profiles */
+enum cpufreq_boost_trigger {
+	CPUFREQ_BOOST_TOUCH,		/* touch down, from the input core */
+	CPUFREQ_BOOST_FLING,		/* scroll fling, hinted by userspace */
+	CPUFREQ_BOOST_LAUNCH,		/* app launch, hinted by userspace */
+	CPUFREQ_BOOST_FB_COMMIT,	/* display frame commit */
+	CPUFREQ_BOOST_NR_TRIGGERS,
+};
+
+#if IS_REACHABLE(CONFIG_CPU_FREQ_GOV_INTERACTIVE)
+void cpufreq_interactive_boost_trigger(enum cpufreq_boost_trigger trigger);
+#else
+static inline void
+cpufreq_interactive_boost_trigger(enum cpufreq_boost_trigger trigger) { }
+#endif
+
 /*********************************************************************
  *                     FREQUENCY TABLE HELPERS                       *
  *********************************************************************/
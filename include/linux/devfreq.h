@@ -148,6 +148,10 @@ struct devfreq_governor {
  *		touch this.
  * @min_freq:	Limit minimum frequency requested by user (0: none)
  * @max_freq:	Limit maximum frequency requested by user (0: none)
+ * @boost_freq:	Floor applied for boost_ms after a touch (0: none)
+ * @boost_ms:	Duration of the touch boost
+ * @boost_expiry:	End of the current touch boost in jiffies
+ * @boost_end:	delayed work dropping the floor once the boost expires
  * @stop_polling:	 devfreq polling status of a device.
  * @total_trans:	Number of devfreq transitions
  * @trans_table:	Statistics of devfreq transitions
@@ -182,6 +186,10 @@ struct devfreq {
 
 	unsigned long min_freq;
 	unsigned long max_freq;
+	unsigned long boost_freq;
+	unsigned int boost_ms;
+	unsigned long boost_expiry;
+	struct delayed_work boost_end;
 	bool stop_polling;
 
 	/* information for device frequency transition */
@@ -242,6 +250,7 @@ extern void devm_devfreq_unregister_notifier(struct device *dev,
 				unsigned int list);
 extern struct devfreq *devfreq_get_devfreq_by_phandle(struct device *dev,
 						int index);
+extern void devfreq_boost_kick(void);
 
 /**
  * devfreq_update_stats() - update the last_status pointer in struct devfreq
@@ -414,10 +423,30 @@ static inline struct devfreq *devfreq_get_devfreq_by_phandle(struct device *dev,
 	return ERR_PTR(-ENODEV);
 }
 
+static inline void devfreq_boost_kick(void)
+{
+}
+
 static inline int devfreq_update_stats(struct devfreq *df)
 {
 	return -EINVAL;
 }
 #endif /* CONFIG_PM_DEVFREQ */
 
+enum devfreq_mem_vote_hint {
+	DEVFREQ_MEM_VOTE_GPU,
+	DEVFREQ_MEM_VOTE_DISPLAY,
+	DEVFREQ_MEM_VOTE_CAMERA,
+	DEVFREQ_MEM_VOTE_NR,
+};
+
+#if IS_REACHABLE(CONFIG_DEVFREQ_GOV_QCOM_BW_HWMON)
+void devfreq_mem_vote_hint(enum devfreq_mem_vote_hint src, unsigned long mbps);
+#else
+static inline void devfreq_mem_vote_hint(enum devfreq_mem_vote_hint src,
+					 unsigned long mbps)
+{
+}
+#endif
+
 #endif /* __LINUX_DEVFREQ_H__ */
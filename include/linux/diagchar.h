@@ -68,6 +68,31 @@
 #define DIAG_IOCTL_HDLC_TOGGLE	38
 #define DIAG_IOCTL_QUERY_PD_LOGGING	39
 #define DIAG_IOCTL_QUERY_MD_PID	41
+#define DIAG_IOCTL_MD_RING_ALLOC	42
+
+/*
+ * Memory device ring, set up with DIAG_IOCTL_MD_RING_ALLOC (argument is the
+ * data size in bytes) and mapped with mmap() on the diag fd. The first page
+ * holds struct diag_md_ring_ctl, data starts at the second page. Each packet
+ * is a struct diag_md_ring_rec followed by len bytes padded to 4. A record
+ * with len DIAG_MD_RING_PAD, or less than a record header left before the
+ * end, means the next record starts at offset 0. The client consumes data by
+ * advancing tail and poll() reports POLLIN once watermark bytes are queued.
+ */
+#define DIAG_MD_RING_PAD	0xFFFFFFFF
+
+struct diag_md_ring_ctl {
+	uint32_t head;
+	uint32_t tail;
+	uint32_t size;
+	uint32_t watermark;
+	uint32_t dropped;
+};
+
+struct diag_md_ring_rec {
+	uint32_t proc;
+	uint32_t len;
+};
 
 /* PC Tools IDs */
 #define APQ8060_TOOLS_ID	4062
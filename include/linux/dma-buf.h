@@ -56,6 +56,10 @@ struct dma_buf_attachment;
  * 		      caches and allocate backing storage (if not yet done)
  * 		      respectively pin the object into memory.
  * @end_cpu_access: [optional] called after cpu access to flush caches.
+ * @begin_cpu_access_partial: [optional] like begin_cpu_access, but only
+ *			      for the given byte range of the buffer.
+ * @end_cpu_access_partial: [optional] like end_cpu_access, but only for the
+ *			    given byte range of the buffer.
  * @kmap_atomic: maps a page from the buffer into kernel address
  * 		 space, users may not block until the subsequent unmap call.
  * 		 This callback must not sleep.
@@ -95,6 +99,12 @@ struct dma_buf_ops {
 
 	int (*begin_cpu_access)(struct dma_buf *, enum dma_data_direction);
 	int (*end_cpu_access)(struct dma_buf *, enum dma_data_direction);
+	int (*begin_cpu_access_partial)(struct dma_buf *,
+					enum dma_data_direction,
+					unsigned int offset, unsigned int len);
+	int (*end_cpu_access_partial)(struct dma_buf *,
+				      enum dma_data_direction,
+				      unsigned int offset, unsigned int len);
 	void *(*kmap_atomic)(struct dma_buf *, unsigned long);
 	void (*kunmap_atomic)(struct dma_buf *, unsigned long, void *);
 	void *(*kmap)(struct dma_buf *, unsigned long);
@@ -233,6 +243,12 @@ int dma_buf_begin_cpu_access(struct dma_buf *dma_buf,
 			     enum dma_data_direction dir);
 int dma_buf_end_cpu_access(struct dma_buf *dma_buf,
 			   enum dma_data_direction dir);
+int dma_buf_begin_cpu_access_partial(struct dma_buf *dma_buf,
+				     enum dma_data_direction dir,
+				     unsigned int offset, unsigned int len);
+int dma_buf_end_cpu_access_partial(struct dma_buf *dma_buf,
+				   enum dma_data_direction dir,
+				   unsigned int offset, unsigned int len);
 void *dma_buf_kmap_atomic(struct dma_buf *, unsigned long);
 void dma_buf_kunmap_atomic(struct dma_buf *, unsigned long, void *);
 void *dma_buf_kmap(struct dma_buf *, unsigned long);
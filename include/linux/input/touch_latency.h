@@ -0,0 +1,89 @@
+#ifndef _INPUT_TOUCH_LATENCY_H
+#define _INPUT_TOUCH_LATENCY_H
+
+/*
+ * Touchscreen latency and report-rate statistics
+ *
+ * Copyright (c) 2018, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ */
+
+#include <linux/ktime.h>
+#include <linux/spinlock.h>
+
+/* log2 buckets in us: [0] < 2us, [n] covers [2^n, 2^(n+1)), last is open */
+#define TOUCH_LATENCY_BUCKETS	16
+
+struct dentry;
+
+/**
+ * struct touch_latency_hist - log2 histogram of one interval, in us
+ * @bucket: sample count per power-of-two bucket
+ * @count: total number of samples
+ * @sum_us: sum of all samples, for the average
+ * @max_us: largest sample seen
+ */
+struct touch_latency_hist {
+	u32 bucket[TOUCH_LATENCY_BUCKETS];
+	u32 count;
+	u64 sum_us;
+	u32 max_us;
+};
+
+/**
+ * struct touch_latency - per-device touch timing state
+ * @irq_time: timestamp of the last touch interrupt
+ * @bus_start: timestamp taken before the touch frame is read
+ * @last_report: timestamp of the previous input_sync()
+ * @irq_to_report: interrupt to input_sync() latency
+ * @interval: time between consecutive input_sync() calls
+ * @bus: duration of the touch frame bus transfer
+ * @lock: protects the histograms against the debugfs reader
+ * @dir: debugfs directory of this device
+ */
+struct touch_latency {
+	ktime_t irq_time;
+	ktime_t bus_start;
+	ktime_t last_report;
+	struct touch_latency_hist irq_to_report;
+	struct touch_latency_hist interval;
+	struct touch_latency_hist bus;
+	spinlock_t lock;
+	struct dentry *dir;
+};
+
+#ifdef CONFIG_TOUCHSCREEN_LATENCY_STATS
+
+void touch_latency_init(struct touch_latency *tl, const char *name);
+void touch_latency_release(struct touch_latency *tl);
+void touch_latency_bus_done(struct touch_latency *tl);
+void touch_latency_report(struct touch_latency *tl);
+
+/* May be called from the hard irq handler */
+static inline void touch_latency_irq(struct touch_latency *tl)
+{
+	tl->irq_time = ktime_get();
+}
+
+static inline void touch_latency_bus_start(struct touch_latency *tl)
+{
+	tl->bus_start = ktime_get();
+}
+
+#else
+
+static inline void touch_latency_init(struct touch_latency *tl,
+				      const char *name) { }
+
+static inline void touch_latency_release(struct touch_latency *tl) { }
+static inline void touch_latency_irq(struct touch_latency *tl) { }
+static inline void touch_latency_bus_start(struct touch_latency *tl) { }
+static inline void touch_latency_bus_done(struct touch_latency *tl) { }
+static inline void touch_latency_report(struct touch_latency *tl) { }
+
+#endif
+
+#endif
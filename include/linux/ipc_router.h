@@ -107,7 +107,11 @@ enum ipc_rtr_af_event_type {
  * @num_rx: Number of packets received.
  * @num_tx_bytes: Number of bytes transmitted.
  * @num_rx_bytes: Number of bytes received.
+ * @rx_lat_cnt: Number of packets read out of the rx queue.
+ * @rx_lat_total_us: Total time, in us, packets spent in the rx queue.
+ * @rx_lat_max_us: Longest time, in us, a packet spent in the rx queue.
  * @priv: Private information registered by the port owner.
+ * @rcu: Used to defer freeing of the port past lockless lookups.
  */
 struct msm_ipc_port {
 	struct list_head list;
@@ -145,7 +149,11 @@ struct msm_ipc_port {
 	unsigned long num_tx_bytes;
 	unsigned long num_rx_bytes;
 	uint32_t last_served_svc_id;
+	uint64_t rx_lat_cnt;
+	uint64_t rx_lat_total_us;
+	uint64_t rx_lat_max_us;
 	void *priv;
+	struct rcu_head rcu;
 };
 
 #ifdef CONFIG_IPC_ROUTER
@@ -21,6 +21,7 @@
 #include <linux/msm_ipc.h>
 #include <linux/ipc_router.h>
 #include <linux/kref.h>
+#include <linux/ktime.h>
 
 #define IPC_ROUTER_XPRT_EVENT_DATA  1
 #define IPC_ROUTER_XPRT_EVENT_OPEN  2
@@ -101,6 +102,7 @@ struct rr_opt_hdr {
  * @length: Length of data in the chain of SKBs
  * @ref: Reference count for the packet.
  * @ws_need: Flag to check wakeup soruce need
+ * @rx_ts: Time at which the packet was queued to a local port.
  */
 struct rr_packet {
 	struct list_head list;
@@ -110,6 +112,7 @@ struct rr_packet {
 	uint32_t length;
 	struct kref ref;
 	bool ws_need;
+	ktime_t rx_ts;
 };
 
 /**
@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2018, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __LINUX_LOWMEMORYKILLER_H
+#define __LINUX_LOWMEMORYKILLER_H
+
+struct task_struct;
+
+#ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER
+void lowmem_adj_changed(struct task_struct *task);
+#else
+static inline void lowmem_adj_changed(struct task_struct *task)
+{
+}
+#endif
+
+#endif /* __LINUX_LOWMEMORYKILLER_H */
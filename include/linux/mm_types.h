@@ -392,6 +392,7 @@ enum {
 	MM_ANONPAGES,	/* Resident anonymous pages */
 	MM_SWAPENTS,	/* Anonymous swap entries */
 	MM_SHMEMPAGES,	/* Resident shared memory pages */
+	MM_UNRECLAIMABLE,	/* Driver memory (GPU, ION) held for the mm */
 	NR_MM_COUNTERS
 };
 
@@ -303,6 +303,25 @@ struct mmc_cmdq_context_info {
 	struct rw_semaphore err_rwsem;
 };
 
+/**
+ * mmc_prep_stats - time spent preparing data requests for the host
+ * @hidden_cnt		preparations done while another data request was
+ *			in flight, so their cost was overlapped with a transfer
+ * @hidden_ns		time spent in those preparations
+ * @exposed_cnt		preparations done with no data request in flight
+ * @exposed_ns		time spent in those preparations
+ *
+ * Preparation is ->pre_req() (DMA mapping) in legacy mode and the cmdq
+ * ->request() (ICE config, descriptors, DMA mapping) in CQ mode. Only the
+ * issuing context updates these.
+ */
+struct mmc_prep_stats {
+	u64	hidden_cnt;
+	u64	hidden_ns;
+	u64	exposed_cnt;
+	u64	exposed_ns;
+};
+
 /**
  * mmc_context_info - synchronization details for mmc context
  * @is_done_rcv		wake up reason was done request
@@ -643,6 +662,7 @@ struct mmc_host {
 	struct mmc_trace_buffer trace_buf;
 	enum dev_state dev_status;
 	bool			wakeup_on_idle;
+	struct mmc_prep_stats	prep_stats;
 	struct mmc_cmdq_context_info	cmdq_ctx;
 	int num_cq_slots;
 	int dcmd_cq_slot;
@@ -1038,6 +1038,47 @@ int sps_get_event(struct sps_pipe *h, struct sps_event_notify *event);
  */
 int sps_get_iovec(struct sps_pipe *h, struct sps_iovec *iovec);
 
+/**
+ * Get a batch of processed I/O vectors (completed transfers)
+ *
+ * This function fetches up to max_cnt processed I/O vectors, polling the
+ * pipe for completed descriptors once. It lets clients drain completions in
+ * batches from NAPI or thread context.
+ *
+ * @h - client context for SPS connection end point
+ *
+ * @iovec - Array of at least max_cnt I/O vector structs (output).
+ *
+ * @max_cnt - Maximal number of I/O vectors to fetch
+ *
+ * @cnt - Number of I/O vectors fetched (output)
+ *
+ * @return 0 on success, negative value on error
+ *
+ */
+int sps_get_iovecs(struct sps_pipe *h, struct sps_iovec *iovec, u32 max_cnt,
+		   u32 *cnt);
+
+/**
+ * Configure interrupt moderation of an SPS connection end point
+ *
+ * When an EOT or descriptor done interrupt of the pipe arrives with fewer
+ * than desc_cnt completed descriptors pending, the interrupt is masked and
+ * the completions are serviced after at most usec microseconds instead.
+ * Not supported on BAM-to-BAM or MTI pipes.
+ *
+ * @h - client context for SPS connection end point
+ *
+ * @desc_cnt - Completed descriptors that are serviced right away. 0 holds
+ *   off every interrupt for usec.
+ *
+ * @usec - Maximal interrupt holdoff in microseconds. 0 disables moderation.
+ *
+ * @return 0 on success, negative value on error
+ *
+ */
+int sps_set_irq_moderation(struct sps_pipe *h, u32 desc_cnt, u32 usec);
+
 /**
  * Enable an SPS connection end point
  *
@@ -1509,6 +1550,18 @@ static inline int sps_get_iovec(struct sps_pipe *h, struct sps_iovec *iovec)
 	return -EPERM;
 }
 
+static inline int sps_get_iovecs(struct sps_pipe *h, struct sps_iovec *iovec,
+				 u32 max_cnt, u32 *cnt)
+{
+	return -EPERM;
+}
+
+static inline int sps_set_irq_moderation(struct sps_pipe *h, u32 desc_cnt,
+					 u32 usec)
+{
+	return -EPERM;
+}
+
 static inline int sps_flow_on(struct sps_pipe *h)
 {
 	return -EPERM;
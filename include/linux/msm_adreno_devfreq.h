@@ -20,6 +20,7 @@
 #define ADRENO_DEVFREQ_NOTIFY_SUBMIT	1
 #define ADRENO_DEVFREQ_NOTIFY_RETIRE	2
 #define ADRENO_DEVFREQ_NOTIFY_IDLE	3
+#define ADRENO_DEVFREQ_NOTIFY_FRAME	4
 
 #define DEVFREQ_FLAG_WAKEUP_MAXFREQ	0x2
 #define DEVFREQ_FLAG_FAST_HINT		0x4
@@ -33,13 +34,40 @@ int kgsl_devfreq_add_notifier(struct device *device,
 int kgsl_devfreq_del_notifier(struct device *device,
 	struct notifier_block *block);
 
+/**
+ * struct msm_adreno_frame_stats - GPU workload since the last read
+ * @total_time: Wall time covered by the sample in usec
+ * @busy_time: GPU busy time in usec
+ * @alu_time: Time the shader ALUs were active in usec
+ * @ram_time: DDR beats moved by VBIF/GBIF
+ * @ram_wait: Cycles VBIF/GBIF was stalled waiting on DDR
+ * @frames: Number of end of frame markers retired
+ */
+struct msm_adreno_frame_stats {
+	u64 total_time;
+	u64 busy_time;
+	u64 alu_time;
+	u64 ram_time;
+	u64 ram_wait;
+	u32 frames;
+};
+
+int kgsl_devfreq_get_frame_stats(struct device *device,
+	struct msm_adreno_frame_stats *stats);
+
 /* same as KGSL_MAX_PWRLEVELS */
 #define MSM_ADRENO_MAX_PWRLEVELS 10
 
+/*
+ * frame_ram_time and frame_time are the DDR beats of the last retired frame
+ * and the time in usec it had to move them, both 0 if no frame is recent.
+ */
 struct xstats {
 	u64 ram_time;
 	u64 ram_wait;
 	int mod;
+	u64 frame_ram_time;
+	u64 frame_time;
 };
 
 struct devfreq_msm_adreno_tz_data {
@@ -84,6 +112,7 @@ struct msm_adreno_extended_profile {
 
 struct msm_busmon_extended_profile {
 	u32 flag;
+	bool frame_mode;
 	unsigned long percent_ab;
 	unsigned long ab_mbytes;
 	struct devfreq_msm_adreno_tz_data *private_data;
@@ -353,6 +353,14 @@ enum gsi_chan_use_db_eng {
  * @err_cb:          error notification callback
  * @chan_user_data:  cookie used for notifications
  * @common_evt_ring: Boolean indicating common event ring.
+ * @poll_cb:         optional NAPI style notification. when set on a channel
+ *                   with an exclusive event ring, an IEOB interrupt masks the
+ *                   interrupt, moves the channel to GSI_CHAN_MODE_POLL and
+ *                   calls poll_cb instead of xfer_cb. the client drains the
+ *                   completions with gsi_poll_n_channel and re-arms the
+ *                   interrupt with gsi_config_channel_mode
+ *                   (GSI_CHAN_MODE_CALLBACK), polling once more afterwards
+ *                   to pick up events which raced with the mode switch
  * All the callbacks are in interrupt context
  *
  */
@@ -374,6 +382,7 @@ struct gsi_chan_props {
 	void (*err_cb)(struct gsi_chan_err_notify *notify);
 	void *chan_user_data;
 	bool common_evt_ring;
+	void (*poll_cb)(void *chan_user_data);
 };
 
 enum gsi_xfer_flag {
@@ -1021,6 +1030,27 @@ int gsi_set_channel_cfg(unsigned long chan_hdl, struct gsi_chan_props *props,
 int gsi_poll_channel(unsigned long chan_hdl,
 		struct gsi_chan_xfer_notify *notify);
 
+/**
+ * gsi_poll_n_channel - Peripheral should call this function to query for
+ * up to expected_num completed transfer descriptors at once.
+ *
+ * @chan_hdl:     Client handle previously obtained from
+ *                gsi_alloc_channel
+ * @notify:       Array of at least expected_num entries filled with the
+ *                information about the completed transfers
+ * @expected_num: Maximal number of completions to return (poll budget)
+ * @actual_num:   [out] Number of entries filled in @notify
+ *
+ * The consumed event ring elements are returned to HW with a single
+ * doorbell.
+ *
+ * @Return gsi_status (GSI_STATUS_POLL_EMPTY is returned if no transfers
+ * completed)
+ */
+int gsi_poll_n_channel(unsigned long chan_hdl,
+		struct gsi_chan_xfer_notify *notify,
+		int expected_num, int *actual_num);
+
 /**
  * gsi_config_channel_mode - Peripheral should call this function
  * to configure the channel mode.
@@ -1127,8 +1157,8 @@ int gsi_halt_channel_ee(unsigned int chan_idx, unsigned int ee, int *code);
  * gsi_read_channel_scratch
  * gsi_start_channel
  * gsi_queue_xfer/gsi_start_xfer
- * gsi_config_channel_mode/gsi_poll_channel (if clients wants to poll on
- * xfer completions)
+ * gsi_config_channel_mode/gsi_poll_channel/gsi_poll_n_channel (if clients
+ * wants to poll on xfer completions)
  * gsi_stop_db_channel/gsi_stop_channel
  *
  * gsi_dealloc_channel
@@ -1263,6 +1293,13 @@ static inline int gsi_poll_channel(unsigned long chan_hdl,
 	return -GSI_STATUS_UNSUPPORTED_OP;
 }
 
+static inline int gsi_poll_n_channel(unsigned long chan_hdl,
+		struct gsi_chan_xfer_notify *notify,
+		int expected_num, int *actual_num)
+{
+	return -GSI_STATUS_UNSUPPORTED_OP;
+}
+
 static inline int gsi_config_channel_mode(unsigned long chan_hdl,
 		enum gsi_chan_mode mode)
 {
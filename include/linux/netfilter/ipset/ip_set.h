@@ -47,6 +47,10 @@ enum ip_set_feature {
 	 * this settype must be dumped last */
 	IPSET_DUMP_LAST_FLAG = 8,
 	IPSET_DUMP_LAST = (1 << IPSET_DUMP_LAST_FLAG),
+	/* Not a feature either: test results depend on the packet's
+	 * addresses and ports only, so they can be cached per CPU */
+	IPSET_TYPE_TEST_CACHE_FLAG = 9,
+	IPSET_TYPE_TEST_CACHE = (1 << IPSET_TYPE_TEST_CACHE_FLAG),
 };
 
 /* Set extensions */
@@ -252,6 +256,8 @@ struct ip_set {
 	u8 flags;
 	/* Default timeout value, if enabled */
 	u32 timeout;
+	/* Changed on every add/del/flush, invalidates cached test results */
+	u32 gen;
 	/* Element data size */
 	size_t dsize;
 	/* Offsets to extensions in elements */
@@ -30,6 +30,10 @@ int ipt_register_table(struct net *net, const struct xt_table *table,
 void ipt_unregister_table(struct net *net, struct xt_table *table,
 			  const struct nf_hook_ops *ops);
 
+struct notifier_block;
+int ipt_register_table_notifier(struct notifier_block *nb);
+int ipt_unregister_table_notifier(struct notifier_block *nb);
+
 /* Standard entry. */
 struct ipt_standard {
 	struct ipt_entry entry;
@@ -109,6 +109,7 @@ int tspp_release_buffer(u32 dev, u32 channel_id, u32 descriptor_id);
 int tspp_allocate_buffers(u32 dev, u32 channel_id, u32 count,
 	u32 size, u32 int_freq, tspp_allocator *alloc,
 	tspp_memfree *memfree, void *user);
+u32 tspp_get_bulk_buffer_size(enum tspp_mode mode);
 
 int tspp_get_tts_source(u32 dev, int *tts_source);
 int tspp_get_lpass_time_counter(u32 dev, enum tspp_source source,
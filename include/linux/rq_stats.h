@@ -11,6 +11,11 @@
  *
  */
 
+#define RQ_MAX_THRESHOLDS 8
+
+/* rq_data.notify_pending bits */
+#define RQ_NOTIFY_RUN_QUEUE 0
+
 struct rq_data {
 	unsigned int rq_avg;
 	unsigned long rq_poll_jiffies;
@@ -24,8 +29,33 @@ struct rq_data {
 	struct kobject *kobj;
 	struct work_struct def_timer_work;
 	int init;
+	/*
+	 * With thresholds set userspace is only woken up when the run queue
+	 * average or the normalized load moves across one of them, instead
+	 * of every def_timer_ms. Thresholds are ascending, rq ones in tenths
+	 * of a task like rq_avg.
+	 */
+	unsigned int rq_thresholds[RQ_MAX_THRESHOLDS];
+	unsigned int rq_nr_thresholds;
+	unsigned int rq_level;
+	unsigned int load_thresholds[RQ_MAX_THRESHOLDS];
+	unsigned int load_nr_thresholds;
+	unsigned int load_level;
+	unsigned long notify_pending;
 };
 
+/* Number of thresholds at or below val */
+static inline unsigned int rq_stats_level(const unsigned int *thresholds,
+					  unsigned int nr, unsigned int val)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr; i++)
+		if (val < thresholds[i])
+			break;
+	return i;
+}
+
 extern spinlock_t rq_lock;
 extern struct rq_data rq_info;
 extern struct workqueue_struct *rq_wq;
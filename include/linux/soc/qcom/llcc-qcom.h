@@ -18,11 +18,15 @@
  * @llcc_slice_id: llcc slice id
  * @llcc_slice_size: Size allocated for the llcc slice
  * @dev: pointer to llcc device
+ * @bw_mbps: bandwidth voted with llcc_slice_vote_bw()
+ * @busy: activity reported with llcc_slice_notify()
  */
 struct llcc_slice_desc {
 	int llcc_slice_id;
 	size_t llcc_slice_size;
 	struct device *dev;
+	u32 bw_mbps;
+	bool busy;
 };
 
 /**
@@ -95,6 +99,20 @@ int llcc_slice_activate(struct llcc_slice_desc *desc);
  */
 int llcc_slice_deactivate(struct llcc_slice_desc *desc);
 
+/**
+ * llcc_slice_vote_bw - vote the bandwidth going through the llcc slice
+ * @desc: Pointer to llcc slice descriptor
+ * @mbps: Bandwidth in MB/s
+ */
+int llcc_slice_vote_bw(struct llcc_slice_desc *desc, u32 mbps);
+
+/**
+ * llcc_slice_notify - report client activity on the llcc slice
+ * @desc: Pointer to llcc slice descriptor
+ * @busy: Whether the client is busy
+ */
+int llcc_slice_notify(struct llcc_slice_desc *desc, bool busy);
+
 /**
  * qcom_llcc_probe - program the sct table
  * @pdev: platform device pointer
@@ -137,6 +155,16 @@ static inline int llcc_slice_deactivate(struct llcc_slice_desc *desc)
 {
 	return -EINVAL;
 }
+
+static inline int llcc_slice_vote_bw(struct llcc_slice_desc *desc, u32 mbps)
+{
+	return -EINVAL;
+}
+
+static inline int llcc_slice_notify(struct llcc_slice_desc *desc, bool busy)
+{
+	return -EINVAL;
+}
 static inline int qcom_llcc_probe(struct platform_device *pdev,
 		      const struct llcc_slice_config *table, u32 sz)
 {
@@ -8,6 +8,8 @@ struct qcom_smem_state;
 
 struct qcom_smem_state_ops {
 	int (*update_bits)(void *, u32, u32);
+	int (*update_bits_nokick)(void *, u32, u32);
+	int (*kick)(void *);
 };
 
 #ifdef CONFIG_QCOM_SMEM_STATE
@@ -16,6 +18,8 @@ struct qcom_smem_state *qcom_smem_state_get(struct device *dev, const char *con_
 void qcom_smem_state_put(struct qcom_smem_state *);
 
 int qcom_smem_state_update_bits(struct qcom_smem_state *state, u32 mask, u32 value);
+int qcom_smem_state_update_bits_nokick(struct qcom_smem_state *state, u32 mask, u32 value);
+int qcom_smem_state_kick(struct qcom_smem_state *state);
 
 struct qcom_smem_state *qcom_smem_state_register(struct device_node *of_node, const struct qcom_smem_state_ops *ops, void *data);
 void qcom_smem_state_unregister(struct qcom_smem_state *state);
@@ -38,6 +42,17 @@ static inline int qcom_smem_state_update_bits(struct qcom_smem_state *state,
 	return -EINVAL;
 }
 
+static inline int qcom_smem_state_update_bits_nokick(struct qcom_smem_state *state,
+	u32 mask, u32 value)
+{
+	return -EINVAL;
+}
+
+static inline int qcom_smem_state_kick(struct qcom_smem_state *state)
+{
+	return -EINVAL;
+}
+
 static inline struct qcom_smem_state *qcom_smem_state_register(struct device_node *of_node,
 	const struct qcom_smem_state_ops *ops, void *data)
 {
@@ -26,7 +26,8 @@
  * @file:		file representing this fence
  * @kref:		reference count on fence.
  * @name:		name of sync_file.  Useful for debugging
- * @sync_file_list:	membership in global file list
+ * @sync_file_list:	membership in a per-cpu file list
+ * @debug_cpu:		cpu whose list holds the file, -1 if untracked
  * @wq:			wait queue for fence signaling
  * @fence:		fence with the fences in the sync_file
  * @cb:			fence callback information
@@ -37,6 +38,7 @@ struct sync_file {
 	char			name[32];
 #ifdef CONFIG_DEBUG_FS
 	struct list_head	sync_file_list;
+	int			debug_cpu;
 #endif
 
 	wait_queue_head_t	wq;
@@ -68,6 +68,7 @@ enum gsi_ep_op {
 	GSI_EP_OP_CHECK_FOR_SUSPEND,
 	GSI_EP_OP_DISABLE,
 	GSI_EP_OP_UPDATE_DB,
+	GSI_EP_OP_SET_NORMAL_PATH,
 };
 
 /*
@@ -10,6 +10,8 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/ktime.h>
+
 #ifdef CONFIG_MSM_BOOT_STATS
 
 #define TIMER_KHZ 32768
@@ -44,7 +46,10 @@ static inline phys_addr_t msm_timer_get_pa(void) { return 0; }
 #ifdef CONFIG_MSM_BOOT_TIME_MARKER
 static inline int boot_marker_enabled(void) { return 1; }
 void place_marker(const char *name);
+void place_probe_marker(const char *drv_name, ktime_t duration);
 #else
-static inline void place_marker(char *name) { };
+static inline void place_marker(const char *name) { };
+static inline void place_probe_marker(const char *drv_name,
+				      ktime_t duration) { };
 static inline int boot_marker_enabled(void) { return 0; }
 #endif
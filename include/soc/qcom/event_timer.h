@@ -15,8 +15,10 @@
 #define __ARCH_ARM_MACH_MSM_EVENT_TIMER_H
 
 #include <linux/hrtimer.h>
+#include <linux/workqueue.h>
 
 struct event_timer_info;
+struct event_timer_periodic;
 
 #ifdef CONFIG_MSM_EVENT_TIMER
 /**
@@ -58,6 +60,39 @@ void destroy_event_timer(struct event_timer_info *event);
  *                          expiring event.
  */
 ktime_t get_next_event_time(int cpu);
+
+/**
+ * add_periodic_event_timer() : Register periodic work whose expirations can
+ *                              be coalesced with other periodic work.
+ *                              Returns a handle, or NULL in which case the
+ *                              client should use its own timer.
+ * @name : Client name, reported in the periodic_stats parameter.
+ * @work : Work queued each time the period expires.
+ * @period_ms : Period of the work.
+ * @slack_ms : How late the work may run to share a wakeup with others.
+ */
+struct event_timer_periodic *add_periodic_event_timer(const char *name,
+		struct work_struct *work, unsigned int period_ms,
+		unsigned int slack_ms);
+
+/**
+ * start_periodic_event_timer() : Start queueing the work every period,
+ *                                the first one a period from now. May sleep.
+ * @periodic : Periodic event handle.
+ */
+void start_periodic_event_timer(struct event_timer_periodic *periodic);
+
+/**
+ * stop_periodic_event_timer() : Stop queueing the work. May sleep.
+ * @periodic : Periodic event handle.
+ */
+void stop_periodic_event_timer(struct event_timer_periodic *periodic);
+
+/**
+ * destroy_periodic_event_timer() : Stop and free a periodic event. May sleep.
+ * @periodic : Periodic event handle.
+ */
+void destroy_periodic_event_timer(struct event_timer_periodic *periodic);
 #else
 static inline void *add_event_timer(uint32_t irq, void (*function)(void *),
 						void *data)
@@ -76,5 +111,21 @@ static inline ktime_t get_next_event_time(int cpu)
 	return ns_to_ktime(0);
 }
 
+static inline struct event_timer_periodic *add_periodic_event_timer(
+		const char *name, struct work_struct *work,
+		unsigned int period_ms, unsigned int slack_ms)
+{
+	return NULL;
+}
+
+static inline void start_periodic_event_timer(
+		struct event_timer_periodic *periodic) {}
+
+static inline void stop_periodic_event_timer(
+		struct event_timer_periodic *periodic) {}
+
+static inline void destroy_periodic_event_timer(
+		struct event_timer_periodic *periodic) {}
+
 #endif /* CONFIG_MSM_EVENT_TIMER_MANAGER */
 #endif /* __ARCH_ARM_MACH_MSM_EVENT_TIMER_H */
@@ -56,6 +56,9 @@ enum {
  * notify_sig:			Signal-change notification (optional)
  * notify_rx_tracer_pkt:	Receive notification for tracer packet
  * notify_remote_rx_intent:	Receive notification for remote-queued RX intent
+ * rx_intent_prequeue_cnt:	Number of RX intents the core keeps queued on
+ *			the client's behalf; 0 disables pre-queuing
+ * rx_intent_prequeue_size:	Size of each pre-queued RX intent
  *
  * This structure is passed into the glink_open() call to setup
  * configuration handles.  All unused fields should be set to 0.
@@ -95,6 +98,8 @@ struct glink_open_config {
 			const void *pkt_priv, const void *ptr, size_t size);
 	void (*notify_remote_rx_intent)(void *handle, const void *priv,
 					size_t size);
+	unsigned int rx_intent_prequeue_cnt;
+	size_t rx_intent_prequeue_size;
 };
 
 enum glink_link_state {
@@ -24,6 +24,27 @@ struct lifo_stats {
 	uint32_t first_out;
 };
 
+enum lpm_pred_type {
+	LPM_PRED_HEURISTIC,
+	LPM_PRED_HISTOGRAM,
+	LPM_PRED_NR,
+};
+
+enum lpm_cluster_pred_event {
+	LPM_CLUSTER_PRED_SHARED,
+	LPM_CLUSTER_PRED_SCAN,
+	LPM_CLUSTER_PRED_TIMER_ARMED,
+	LPM_CLUSTER_PRED_TIMER_AVOIDED,
+	LPM_CLUSTER_PRED_NR,
+};
+
+/* How the level a predictor chose compares to what the residency needed */
+struct lpm_pred_stats {
+	uint32_t hit;
+	uint32_t too_shallow;
+	uint32_t too_deep;
+};
+
 struct lpm_stats {
 	char name[MAX_STR_LEN];
 	struct level_stats *time_stats;
@@ -36,6 +57,8 @@ struct lpm_stats {
 	struct dentry *directory;
 	int64_t sleep_time;
 	bool is_cpu;
+	struct lpm_pred_stats pred[LPM_PRED_NR];
+	uint32_t cluster_pred[LPM_CLUSTER_PRED_NR];
 };
 
 
@@ -49,6 +72,9 @@ void lpm_stats_cluster_exit(struct lpm_stats *stats, uint32_t index,
 				bool success);
 void lpm_stats_cpu_enter(uint32_t index, uint64_t time);
 void lpm_stats_cpu_exit(uint32_t index, uint64_t time, bool success);
+void lpm_stats_cpu_predict(enum lpm_pred_type type, int level, int ideal);
+void lpm_stats_cluster_pred(struct lpm_stats *stats,
+			    enum lpm_cluster_pred_event event);
 void lpm_stats_suspend_enter(void);
 void lpm_stats_suspend_exit(void);
 #else
@@ -74,6 +100,14 @@ static inline void lpm_stats_cpu_exit(uint32_t index, bool success,
 							uint64_t time)
 { }
 
+static inline void lpm_stats_cpu_predict(enum lpm_pred_type type,
+					 int level, int ideal)
+{ }
+
+static inline void lpm_stats_cluster_pred(struct lpm_stats *stats,
+					  enum lpm_cluster_pred_event event)
+{ }
+
 static inline void lpm_stats_suspend_enter(void)
 { }
 
@@ -0,0 +1,97 @@
+/* Copyright (c) 2026, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __SOC_QCOM_MEM_POOL_H__
+#define __SOC_QCOM_MEM_POOL_H__
+
+#include <linux/errno.h>
+#include <linux/gfp.h>
+#include <linux/list.h>
+#include <linux/mm_types.h>
+
+struct mem_pool_client;
+
+#ifdef CONFIG_QCOM_MEM_POOL
+
+/*
+ * Pages handed to the shared pool must be zeroed and clean to the point of
+ * coherency, and higher order pages must be compound pages. Pages handed
+ * out by the pool are in the same state, so any client can reuse memory
+ * freed by another one without further maintenance.
+ */
+
+struct mem_pool_client *mem_pool_client_register(const char *name);
+void mem_pool_client_unregister(struct mem_pool_client *client);
+
+int mem_pool_reserve(struct mem_pool_client *client, unsigned int order,
+		unsigned int count, gfp_t gfp_mask);
+
+int mem_pool_get_list(struct mem_pool_client *client, unsigned int order,
+		struct list_head *pages, int nr);
+void mem_pool_put_list(struct mem_pool_client *client, unsigned int order,
+		struct list_head *pages, int nr);
+
+struct page *mem_pool_alloc(struct mem_pool_client *client,
+		unsigned int order);
+void mem_pool_free(struct mem_pool_client *client, struct page *page,
+		unsigned int order);
+
+int mem_pool_count(unsigned int order);
+
+#else
+
+static inline struct mem_pool_client *mem_pool_client_register(
+		const char *name)
+{
+	return NULL;
+}
+
+static inline void mem_pool_client_unregister(struct mem_pool_client *client)
+{
+}
+
+static inline int mem_pool_reserve(struct mem_pool_client *client,
+		unsigned int order, unsigned int count, gfp_t gfp_mask)
+{
+	return -ENODEV;
+}
+
+static inline int mem_pool_get_list(struct mem_pool_client *client,
+		unsigned int order, struct list_head *pages, int nr)
+{
+	return 0;
+}
+
+static inline void mem_pool_put_list(struct mem_pool_client *client,
+		unsigned int order, struct list_head *pages, int nr)
+{
+}
+
+static inline struct page *mem_pool_alloc(struct mem_pool_client *client,
+		unsigned int order)
+{
+	return NULL;
+}
+
+static inline void mem_pool_free(struct mem_pool_client *client,
+		struct page *page, unsigned int order)
+{
+}
+
+static inline int mem_pool_count(unsigned int order)
+{
+	return 0;
+}
+
+#endif /* CONFIG_QCOM_MEM_POOL */
+
+#endif /* __SOC_QCOM_MEM_POOL_H__ */
@@ -21,8 +21,10 @@
 #include <linux/gfp.h>
 #include <linux/qmi_encdec.h>
 #include <linux/workqueue.h>
+#include <linux/hashtable.h>
 
 #define QMI_COMMON_TLV_TYPE 0
+#define QMI_TXN_HASH_BITS 4
 
 enum qmi_event_type {
 	QMI_RECV_MSG = 1,
@@ -48,6 +50,7 @@ enum qmi_event_type {
  * @dest_info: Destination to which this handle is connected to.
  * @dest_service_id: service id of the service that client connected to.
  * @txn_list: List of transactions waiting for the response.
+ * @txn_hash: The transactions in @txn_list, hashed by their txn_id.
  * @ind_cb: Function to notify the handle owner of an indication message.
  * @ind_cb_priv: Private info to be passed during an indication notification.
  * @resume_tx_work: Work to resume the tx when the transport is not busy.
@@ -75,6 +78,7 @@ struct qmi_handle {
 	void *dest_info;
 	uint32_t dest_service_id;
 	struct list_head txn_list;
+	DECLARE_HASHTABLE(txn_hash, QMI_TXN_HASH_BITS);
 	void (*ind_cb)(struct qmi_handle *handle,
 			unsigned int msg_id, void *msg,
 			unsigned int msg_len, void *ind_cb_priv);
@@ -165,6 +169,23 @@ struct qmi_handle *qmi_handle_create(
 		       enum qmi_event_type event, void *notify_priv),
 	void *notify_priv);
 
+/**
+ * qmi_handle_create_highpri() - Create a QMI handle with a high priority
+ *				 worker
+ * @notify: Callback to notify events on the handle created.
+ * @notify_priv: Private information to be passed along with the notification.
+ *
+ * Same as qmi_handle_create(), but the events of the handle are processed
+ * by a high priority worker so that responses and indications are not held
+ * up behind normal priority work on a busy system.
+ *
+ * @return: Valid QMI handle on success, NULL on error.
+ */
+struct qmi_handle *qmi_handle_create_highpri(
+	void (*notify)(struct qmi_handle *handle,
+		       enum qmi_event_type event, void *notify_priv),
+	void *notify_priv);
+
 /**
  * qmi_handle_destroy() - Destroy the QMI handle
  * @handle: QMI handle to be destroyed.
@@ -382,6 +403,14 @@ static inline struct qmi_handle *qmi_handle_create(
 	return NULL;
 }
 
+static inline struct qmi_handle *qmi_handle_create_highpri(
+	void (*notify)(struct qmi_handle *handle,
+		       enum qmi_event_type event, void *notify_priv),
+	void *notify_priv)
+{
+	return NULL;
+}
+
 static inline int qmi_handle_destroy(struct qmi_handle *handle)
 {
 	return -ENODEV;
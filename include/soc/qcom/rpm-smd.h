@@ -214,6 +214,33 @@ void *msm_rpm_send_message_noack(enum msm_rpm_set set, uint32_t rsc_type,
 int msm_rpm_send_message_noirq(enum msm_rpm_set set, uint32_t rsc_type,
 		uint32_t rsc_id, struct msm_rpm_kvp *kvp, int nelems);
 
+/**
+ * msm_rpm_send_message_async() -Queue key value pairs for a resource without
+ * sending them. Requests for the same resource and set are merged and all
+ * queued requests are sent together shortly after, or by
+ * msm_rpm_flush_async(). Cannot be called from atomic context.
+ *
+ * @set: if the device is setting the active/sleep set parameter
+ * for the resource
+ * @rsc_type: unsigned 32 bit integer that identifies the type of the resource
+ * @rsc_id: unsigned 32 bit that uniquely identifies a resource within a type
+ * @kvp: array of KVP data.
+ * @nelem: number of KVPs pairs associated with the message.
+ *
+ * returns  0 on success and errno on failure.
+ */
+int msm_rpm_send_message_async(enum msm_rpm_set set, uint32_t rsc_type,
+		uint32_t rsc_id, struct msm_rpm_kvp *kvp, int nelems);
+
+/**
+ * msm_rpm_flush_async() - Send all requests queued by
+ * msm_rpm_send_message_async() back to back and wait for their acks in
+ * order.
+ *
+ * returns 0 on success and the first errno on failure.
+ */
+int msm_rpm_flush_async(void);
+
 #else
 
 static inline struct msm_rpm_request *msm_rpm_create_request(
@@ -282,6 +309,18 @@ static inline void *msm_rpm_send_message_noack(enum msm_rpm_set set,
 	return NULL;
 }
 
+static inline int msm_rpm_send_message_async(enum msm_rpm_set set,
+		uint32_t rsc_type, uint32_t rsc_id, struct msm_rpm_kvp *kvp,
+		int nelems)
+{
+	return 0;
+}
+
+static inline int msm_rpm_flush_async(void)
+{
+	return 0;
+}
+
 static inline int msm_rpm_wait_for_ack(uint32_t msg_id)
 {
 	return 0;
@@ -16,6 +16,7 @@
 #define __QCOM_SECURE_BUFFER_H__
 
 #include <linux/scatterlist.h>
+#include <linux/workqueue.h>
 
 /*
  * if you add a secure VMID here make sure you update
@@ -50,6 +51,30 @@ enum vmid {
 #define PERM_WRITE                      0x2
 #define PERM_EXEC			0x1
 
+/**
+ * struct hyp_assign_req - asynchronous hyp_assign_tables() request
+ * @tables:	scatterlists to assign
+ * @ntables:	number of entries in @tables
+ * @source_vm_list: current owners of the memory
+ * @source_nelems: number of entries in @source_vm_list
+ * @dest_vmids:	new owners of the memory
+ * @dest_perms:	permissions of each of the new owners
+ * @dest_nelems: number of entries in @dest_vmids and @dest_perms
+ * @complete:	called with the result once the call is done
+ * @work:	internal
+ */
+struct hyp_assign_req {
+	struct sg_table **tables;
+	int ntables;
+	u32 *source_vm_list;
+	int source_nelems;
+	int *dest_vmids;
+	int *dest_perms;
+	int dest_nelems;
+	void (*complete)(struct hyp_assign_req *req, int ret);
+	struct work_struct work;
+};
+
 #ifdef CONFIG_QCOM_SECURE_BUFFER
 int msm_secure_table(struct sg_table *table);
 int msm_unsecure_table(struct sg_table *table);
@@ -57,6 +82,11 @@ int hyp_assign_table(struct sg_table *table,
 			u32 *source_vm_list, int source_nelems,
 			int *dest_vmids, int *dest_perms,
 			int dest_nelems);
+int hyp_assign_tables(struct sg_table **tables, int ntables,
+			u32 *source_vm_list, int source_nelems,
+			int *dest_vmids, int *dest_perms,
+			int dest_nelems);
+void hyp_assign_tables_async(struct hyp_assign_req *req);
 extern int hyp_assign_phys(phys_addr_t addr, u64 size,
 			u32 *source_vmlist, int source_nelems,
 			int *dest_vmids, int *dest_perms, int dest_nelems);
@@ -81,6 +111,19 @@ static inline int hyp_assign_table(struct sg_table *table,
 	return -EINVAL;
 }
 
+static inline int hyp_assign_tables(struct sg_table **tables, int ntables,
+			u32 *source_vm_list, int source_nelems,
+			int *dest_vmids, int *dest_perms,
+			int dest_nelems)
+{
+	return -EINVAL;
+}
+
+static inline void hyp_assign_tables_async(struct hyp_assign_req *req)
+{
+	req->complete(req, -EINVAL);
+}
+
 static inline int hyp_assign_phys(phys_addr_t addr, u64 size,
 			u32 *source_vmlist, int source_nelems,
 			int *dest_vmids, int *dest_perms, int dest_nelems)
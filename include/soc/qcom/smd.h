@@ -19,6 +19,7 @@
 #define __ASM_ARCH_MSM_SMD_H
 
 #include <linux/io.h>
+#include <linux/uio.h>
 
 #include <soc/qcom/smem.h>
 
@@ -92,6 +93,13 @@ int smd_read_from_cb(smd_channel_t *ch, void *data, int len);
  */
 int smd_write(smd_channel_t *ch, const void *data, int len);
 
+/* Write each buffer as if by smd_write() but interrupt the remote processor
+ * only once at the end. Stops at the first buffer that doesn't fit entirely
+ * and returns the number of buffers fully written, or an error if the first
+ * one failed.
+ */
+int smd_writev(smd_channel_t *ch, const struct kvec *vec, int count);
+
 int smd_write_avail(smd_channel_t *ch);
 int smd_read_avail(smd_channel_t *ch);
 
@@ -273,6 +281,12 @@ static inline int smd_write(smd_channel_t *ch, const void *data, int len)
 	return -ENODEV;
 }
 
+static inline int smd_writev(smd_channel_t *ch, const struct kvec *vec,
+			     int count)
+{
+	return -ENODEV;
+}
+
 static inline int smd_write_avail(smd_channel_t *ch)
 {
 	return -ENODEV;
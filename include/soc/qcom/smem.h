@@ -169,7 +169,8 @@ enum {
 	SMEM_SMP2P_SENSOR_BASE, /* 481 */
 	SMEM_SMP2P_TZ_BASE = SMEM_SMP2P_SENSOR_BASE + 8, /* 489 */
 	SMEM_IPA_FILTER_TABLE = SMEM_SMP2P_TZ_BASE + 8, /* 497 */
-	SMEM_NUM_ITEMS, /* 498 */
+	SMEM_GLINK_NATIVE_XPRT_ZC_POOL, /* 498 */
+	SMEM_NUM_ITEMS, /* 499 */
 };
 
 #ifdef CONFIG_MSM_SMEM
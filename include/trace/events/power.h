@@ -690,6 +690,38 @@ TRACE_EVENT(bw_hwmon_update,
 		__entry->down_thres)
 );
 
+TRACE_EVENT(bw_hwmon_predict,
+
+	TP_PROTO(const char *name, unsigned long pred_mbps,
+		 unsigned long meas_mbps, unsigned long floor_mbps,
+		 unsigned int hold),
+
+	TP_ARGS(name, pred_mbps, meas_mbps, floor_mbps, hold),
+
+	TP_STRUCT__entry(
+		__string(	name,			name		)
+		__field(	unsigned long,		pred_mbps	)
+		__field(	unsigned long,		meas_mbps	)
+		__field(	unsigned long,		floor_mbps	)
+		__field(	unsigned int,		hold		)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->pred_mbps = pred_mbps;
+		__entry->meas_mbps = meas_mbps;
+		__entry->floor_mbps = floor_mbps;
+		__entry->hold = hold;
+	),
+
+	TP_printk("dev: %s, pred = %lu, meas = %lu, floor = %lu, hold = %u",
+		__get_str(name),
+		__entry->pred_mbps,
+		__entry->meas_mbps,
+		__entry->floor_mbps,
+		__entry->hold)
+);
+
 TRACE_EVENT(cache_hwmon_meas,
 	TP_PROTO(const char *name, unsigned long high_mrps,
 		 unsigned long med_mrps, unsigned long low_mrps,
@@ -733,6 +765,49 @@ TRACE_EVENT(cache_hwmon_update,
 	TP_printk("dev=%s freq=%lu", __get_str(name), __entry->freq)
 );
 
+TRACE_EVENT(mem_vote_update,
+
+	TP_PROTO(const char *name, unsigned long bw_freq,
+		 unsigned long lat_freq, unsigned long gpu_mbps,
+		 unsigned long disp_mbps, unsigned long target,
+		 unsigned long vote, unsigned int hold),
+
+	TP_ARGS(name, bw_freq, lat_freq, gpu_mbps, disp_mbps, target, vote,
+		hold),
+
+	TP_STRUCT__entry(
+		__string(name, name)
+		__field(unsigned long, bw_freq)
+		__field(unsigned long, lat_freq)
+		__field(unsigned long, gpu_mbps)
+		__field(unsigned long, disp_mbps)
+		__field(unsigned long, target)
+		__field(unsigned long, vote)
+		__field(unsigned int, hold)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->bw_freq = bw_freq;
+		__entry->lat_freq = lat_freq;
+		__entry->gpu_mbps = gpu_mbps;
+		__entry->disp_mbps = disp_mbps;
+		__entry->target = target;
+		__entry->vote = vote;
+		__entry->hold = hold;
+	),
+
+	TP_printk("dev: %s, bw=%lu, lat=%lu, gpu=%lu, disp=%lu, target=%lu, vote=%lu, hold=%u",
+		__get_str(name),
+		__entry->bw_freq,
+		__entry->lat_freq,
+		__entry->gpu_mbps,
+		__entry->disp_mbps,
+		__entry->target,
+		__entry->vote,
+		__entry->hold)
+);
+
 TRACE_EVENT(memlat_dev_meas,
 
 	TP_PROTO(const char *name, unsigned int dev_id, unsigned long inst,
@@ -34,7 +34,29 @@ struct dma_buf_sync {
 #define DMA_BUF_SYNC_VALID_FLAGS_MASK \
 	(DMA_BUF_SYNC_RW | DMA_BUF_SYNC_END)
 
+/* A byte range of a dma-buf, for partial cpu access */
+struct dma_buf_sync_range {
+	__u64 offset;
+	__u64 length;
+};
+
+/*
+ * begin/end cpu access for only part of a buffer. ranges points to an array
+ * of nr_ranges struct dma_buf_sync_range, flags are the same as for
+ * struct dma_buf_sync.
+ */
+struct dma_buf_sync_partial {
+	__u64 flags;
+	__u64 ranges;
+	__u32 nr_ranges;
+	__u32 reserved;
+};
+
+#define DMA_BUF_SYNC_RANGES_MAX	64
+
 #define DMA_BUF_BASE		'b'
 #define DMA_BUF_IOCTL_SYNC	_IOW(DMA_BUF_BASE, 0, struct dma_buf_sync)
+#define DMA_BUF_IOCTL_SYNC_PARTIAL	_IOW(DMA_BUF_BASE, 1, \
+					     struct dma_buf_sync_partial)
 
 #endif
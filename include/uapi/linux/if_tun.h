@@ -57,6 +57,13 @@
 #define TUNSETVNETBE _IOW('T', 222, int)
 #define TUNGETVNETBE _IOR('T', 223, int)
 
+/* TUNSETBATCH switches read()/write() on one queue between a single packet
+ * and a packet array. In batch mode each packet is preceded by a
+ * struct tun_batch_hdr and padded to TUN_BATCH_ALIGN bytes, so one system
+ * call moves as many packets as fit into the buffer.
+ */
+#define TUNSETBATCH  _IOW('T', 240, int)
+
 /* TUNSETIFF ifr flags */
 #define IFF_TUN		0x0001
 #define IFF_TAP		0x0002
@@ -89,6 +96,12 @@ struct tun_pi {
 	__be16 proto;
 };
 
+/* Packet array element header (used with TUNSETBATCH) */
+#define TUN_BATCH_ALIGN	4
+struct tun_batch_hdr {
+	__u32 len;	/* bytes following, without the padding */
+};
+
 /*
  * Filter spec (used for SETXXFILTER ioctls)
  * This stuff is applicable only to the TAP (Ethernet) devices.
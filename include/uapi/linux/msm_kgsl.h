@@ -113,6 +113,11 @@
 /* Flags for GPU command memory objects */
 #define KGSL_OBJLIST_MEMOBJ  0x00000008U
 #define KGSL_OBJLIST_PROFILE 0x00000010U
+/*
+ * A KGSL_OBJLIST_DEADLINE memory object only carries the target completion
+ * time for the command, in nanoseconds of CLOCK_MONOTONIC, in its offset
+ */
+#define KGSL_OBJLIST_DEADLINE 0x00000020U
 
 /* Flags for GPU command sync points */
 #define KGSL_CMD_SYNCPOINT_TYPE_TIMESTAMP 0
@@ -449,6 +454,51 @@ struct kgsl_cmdbatch_profiling_buffer {
 	uint64_t gpu_ticks_retired;
 };
 
+/* Counters in each struct kgsl_gpu_sample, indexes into @counters */
+#define KGSL_GPU_SAMPLE_TICKS 0    /* Always on ticks (19.2MHz) */
+#define KGSL_GPU_SAMPLE_BUSY 1     /* CP busy cycles */
+#define KGSL_GPU_SAMPLE_ALU 2      /* SP ALU active cycles */
+#define KGSL_GPU_SAMPLE_TEX 3      /* TP busy cycles */
+#define KGSL_GPU_SAMPLE_RAM_RD 4   /* VBIF total or GBIF read beats */
+#define KGSL_GPU_SAMPLE_RAM_WR 5   /* GBIF write beats, 0 on VBIF */
+#define KGSL_GPU_SAMPLE_MAX 6
+
+/**
+ * struct kgsl_gpu_sample - Counter deltas for one retired command obj
+ * @context_id: Context that submitted the command obj
+ * @timestamp: Context timestamp of the command obj
+ * @pid: Process that owns the context
+ * @__pad: Reserved
+ * @retired_ns: CLOCK_MONOTONIC time the command obj was retired
+ * @counters: Counter deltas from the start to the end of the IBs
+ */
+struct kgsl_gpu_sample {
+	unsigned int context_id;
+	unsigned int timestamp;
+	int pid;
+	unsigned int __pad;
+	uint64_t retired_ns;
+	uint64_t counters[KGSL_GPU_SAMPLE_MAX];
+};
+
+/**
+ * struct kgsl_gpu_sample_ring - Header of the gpu_samples sysfs mapping
+ * @head: Number of samples ever written. Sample n is at index n % @count
+ * @count: Number of sample slots following the header
+ * @sample_size: sizeof(struct kgsl_gpu_sample) used by the kernel
+ * @__pad: Reserved
+ *
+ * The header is followed by @count slots. A reader copies the samples
+ * between its last position and @head, then reads @head again. Any copied
+ * sample n with n + @count <= the new @head may have been overwritten.
+ */
+struct kgsl_gpu_sample_ring {
+	unsigned int head;
+	unsigned int count;
+	unsigned int sample_size;
+	unsigned int __pad;
+};
+
 /* ioctls */
 #define KGSL_IOC_TYPE 0x09
 
@@ -1622,4 +1672,28 @@ struct kgsl_gpu_sparse_command {
 #define IOCTL_KGSL_GPU_SPARSE_COMMAND \
 	_IOWR(KGSL_IOC_TYPE, 0x55, struct kgsl_gpu_sparse_command)
 
+/**
+ * struct kgsl_gpu_command_batch - Argument for IOCTL_KGSL_GPU_COMMAND_BATCH
+ * @cmdlist: List of kgsl_gpu_command structures to submit
+ * @cmdsize: Size of kgsl_gpu_command structure
+ * @count: Number of elements in cmdlist, returns the number queued
+ * @flags: Reserved for future use, must be zero
+ *
+ * Each kgsl_gpu_command in the list is handled as if it had been submitted
+ * with IOCTL_KGSL_GPU_COMMAND and gets its timestamp written back into the
+ * list. Submissions are queued in order; if one fails the submissions before
+ * it stay queued and count returns how many of them there were. The error
+ * is only returned if nothing could be queued.
+ */
+struct kgsl_gpu_command_batch {
+	uint64_t __user cmdlist;
+	unsigned int cmdsize;
+	unsigned int count;
+	unsigned int flags;
+	unsigned int __pad;
+};
+
+#define IOCTL_KGSL_GPU_COMMAND_BATCH \
+	_IOWR(KGSL_IOC_TYPE, 0x56, struct kgsl_gpu_command_batch)
+
 #endif /* _UAPI_MSM_KGSL_H */
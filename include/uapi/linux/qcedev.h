@@ -164,13 +164,11 @@ struct	qcedev_pmem_info {
 * space buffer (data_src/dta_dst) and process accordingly and copy data back
 * to the user space buffer
 *
-* If use_pmem is set to 1, the driver assumes that memory was allocated via
-* PMEM.
-* The kernel driver will use the fd_src to determine the kernel virtual address
-* base that maps to the user space virtual address base for the  buffer
-* allocated in user space.
-* The final input/src and output/dst buffer pointer will be determined
-* by adding the offsets to the kernel virtual addr.
+* If use_pmem is set to 1, fd_src is an ION buffer already registered with
+* QCEDEV_IOCTL_MAP_BUF_REQ and the src offsets are offsets into it.
+* The operation must be in place (in_place_op set, dst is ignored) and
+* byteoffset must be 0. The crypto engine works directly on the pages of
+* the buffer, so nothing is copied between user and kernel space.
 *
 * If use of hardware key is supported in the target, user can configure the
 * key parameters (encklen, enckey) to use the hardware key.
@@ -218,6 +216,21 @@ struct	qcedev_sha_op_req {
 	enum qcedev_sha_alg_enum	alg;
 };
 
+/**
+* struct qcedev_sha_reg_op_req - Hashing request over a registered buffer
+* @fd (IN):			ION buffer registered with
+*				QCEDEV_IOCTL_MAP_BUF_REQ
+* @req (IN/OUT):		Hashing request, the data[].offset entries
+*				are offsets into @fd
+*
+* The buffer is hashed in place for SHA1/SHA256 and their HMAC variants
+* after QCEDEV_IOCTL_SHA_INIT_REQ, QCEDEV_IOCTL_SHA_FINAL_REQ completes it.
+*/
+struct	qcedev_sha_reg_op_req {
+	int32_t				fd;
+	struct qcedev_sha_op_req	req;
+};
+
 /**
 * struct qfips_verify_t - Holds data for FIPS Integrity test
 * @kernel_size  (IN):		Size of kernel Image
@@ -281,4 +294,6 @@ struct file;
 	_IOWR(QCEDEV_IOC_MAGIC, 10, struct qcedev_map_buf_req)
 #define QCEDEV_IOCTL_UNMAP_BUF_REQ	\
 	_IOWR(QCEDEV_IOC_MAGIC, 11, struct qcedev_unmap_buf_req)
+#define QCEDEV_IOCTL_SHA_UPDATE_REG_REQ	\
+	_IOWR(QCEDEV_IOC_MAGIC, 12, struct qcedev_sha_reg_op_req)
 #endif /* _UAPI_QCEDEV__H */
@@ -66,6 +66,32 @@ struct sync_file_info {
 	__u64	sync_fence_info;
 };
 
+/**
+ * struct sync_wait_data - data passed to the wait ioctl
+ * @fds:	pointer to an array of sync_file fds to wait on
+ * @num_fds:	number of fds in the array, at most 256
+ * @flags:	SYNC_WAIT_ANY to return once any fence signals, otherwise the
+ *		ioctl waits for all of them
+ * @timeout_ms:	timeout in milliseconds, 0 only checks, negative waits
+ *		forever
+ * @index:	returns the index of the signaled fd with SYNC_WAIT_ANY,
+ *		-1 otherwise
+ * @status:	returns the status of that fence, or with all the first
+ *		error found: 1 signaled, <0 error
+ * @pad:	padding for 64-bit alignment, should always be zero
+ */
+struct sync_wait_data {
+	__u64	fds;
+	__u32	num_fds;
+	__u32	flags;
+	__s32	timeout_ms;
+	__s32	index;
+	__s32	status;
+	__u32	pad;
+};
+
+#define SYNC_WAIT_ANY		(1 << 0)
+
 #define SYNC_IOC_MAGIC		'>'
 
 /**
@@ -94,4 +120,14 @@ struct sync_file_info {
  */
 #define SYNC_IOC_FILE_INFO	_IOWR(SYNC_IOC_MAGIC, 4, struct sync_file_info)
 
+/**
+ * DOC: SYNC_IOC_WAIT - wait for any or all of a set of sync_files
+ *
+ * Takes a struct sync_wait_data and can be issued on any sync_file; the
+ * calling fd is not waited on unless it is in the array. Fences that are
+ * already signaled are checked without installing callbacks. Returns 0
+ * once the condition holds, or -ETIME when the timeout expires first.
+ */
+#define SYNC_IOC_WAIT		_IOWR(SYNC_IOC_MAGIC, 5, struct sync_wait_data)
+
 #endif /* _UAPI_LINUX_SYNC_H */
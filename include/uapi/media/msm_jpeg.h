@@ -70,6 +70,7 @@ struct msm_jpeg_ctrl_cmd {
 };
 
 #define MSM_JPEG_EVT_RESET 0
+/* len of a SESSION_DONE event is the START to frame done time in us */
 #define MSM_JPEG_EVT_SESSION_DONE	1
 #define MSM_JPEG_EVT_ERR 2
 
@@ -18,6 +18,8 @@
 /* msm jpeg dma control ID's */
 #define V4L2_CID_JPEG_DMA_SPEED (V4L2_CID_PRIVATE_BASE)
 #define V4L2_CID_JPEG_DMA_MAX_DOWN_SCALE (V4L2_CID_PRIVATE_BASE + 1)
+/* Read only, device run to done time of the last frame in us */
+#define V4L2_CID_JPEG_DMA_LAST_FRAME_US (V4L2_CID_PRIVATE_BASE + 2)
 
 /* msm_jpeg_dma_buf */
 struct msm_jpeg_dma_buff {
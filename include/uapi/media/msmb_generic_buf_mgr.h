@@ -34,8 +34,26 @@ struct msm_buf_mngr_main_cont_info {
 	int32_t cont_fd;
 };
 
+/*
+ * Kernel handoff of done buffers: with handoff enabled on a stream, buffers
+ * the ISP is done with are kept by the kernel instead of being dequeued to
+ * userspace. A CPP or JPEG client claims one by index with
+ * GET_HANDOFF_BUF and returns it with VIDIOC_MSM_BUF_MNGR_BUF_DONE.
+ * SET_HANDOFF reports the handoff to BUF_DONE latency of claimed buffers.
+ */
+struct msm_buf_mngr_handoff_info {
+	uint32_t session_id;
+	uint32_t stream_id;
+	uint32_t enable;
+	uint32_t count;
+	uint32_t avg_us;
+	uint32_t max_us;
+};
+
 #define MSM_CAMERA_BUF_MNGR_IOCTL_ID_BASE 0
 #define MSM_CAMERA_BUF_MNGR_IOCTL_ID_GET_BUF_BY_IDX 1
+#define MSM_CAMERA_BUF_MNGR_IOCTL_ID_GET_HANDOFF_BUF 2
+#define MSM_CAMERA_BUF_MNGR_IOCTL_ID_SET_HANDOFF 3
 
 #define VIDIOC_MSM_BUF_MNGR_GET_BUF \
 	_IOWR('V', BASE_VIDIOC_PRIVATE + 33, struct msm_buf_mngr_info)
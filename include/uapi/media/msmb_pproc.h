@@ -17,6 +17,7 @@
 #define MSM_CPP_MAX_FW_NAME_LEN 32
 #define MAX_FREQ_TBL 10
 #define MSM_OUTPUT_BUF_CNT 8
+#define MSM_CPP_MAX_BATCH_FRAMES 4
 
 enum msm_cpp_frame_type {
 	MSM_CPP_OFFLINE_FRAME,
@@ -104,6 +105,22 @@ struct msm_cpp_frame_info_t {
 	struct msm_cpp_batch_info_t  batch_info;
 };
 
+/*
+ * Frames generated from one input buffer, submitted with a single
+ * VIDIOC_MSM_CPP_CFG_BATCH. All frames must belong to the same instance.
+ * One V4L2_EVENT_CPP_FRAME_DONE is raised for the whole batch, its data
+ * holds a msm_cpp_frame_done_event_t with the number of event payloads
+ * to fetch with VIDIOC_MSM_CPP_GET_EVENTPAYLOAD.
+ */
+struct msm_cpp_frame_batch_t {
+	uint32_t num_frames;
+	struct msm_cpp_frame_info_t *frame_info[MSM_CPP_MAX_BATCH_FRAMES];
+};
+
+struct msm_cpp_frame_done_event_t {
+	uint32_t num_frames;
+};
+
 struct msm_cpp_pop_stream_info_t {
 	int32_t frame_id;
 	uint32_t identity;
@@ -240,6 +257,9 @@ struct msm_cpp_clock_settings_t {
 #define VIDIOC_MSM_CPP_DELETE_STREAM_BUFF\
 	_IOWR('V', BASE_VIDIOC_PRIVATE + 20, struct msm_camera_v4l2_ioctl_t)
 
+#define VIDIOC_MSM_CPP_CFG_BATCH \
+	_IOWR('V', BASE_VIDIOC_PRIVATE + 21, struct msm_camera_v4l2_ioctl_t)
+
 
 #define V4L2_EVENT_CPP_FRAME_DONE  (V4L2_EVENT_PRIVATE_START + 0)
 #define V4L2_EVENT_VPE_FRAME_DONE  (V4L2_EVENT_PRIVATE_START + 1)
@@ -3731,6 +3731,7 @@ u64 perf_event_read_local(struct perf_event *event)
 
 	return val;
 }
+EXPORT_SYMBOL_GPL(perf_event_read_local);
 
 static int perf_event_read(struct perf_event *event, bool group)
 {
@@ -1220,11 +1220,54 @@ static void update_rq_stats(void)
 		spin_unlock_irqrestore(&rq_lock, flags);
 	}
 }
+
+/*
+ * In threshold mode the run queue level is checked on every tick and the
+ * normalized load is only sampled every def_timer_jiffies by the work, so
+ * nothing runs while the CPU is idle and userspace is only woken up if a
+ * threshold is crossed.
+ */
+static bool wakeup_user_threshold(unsigned long jiffy_gap)
+{
+	unsigned int level;
+	bool queue = false;
+
+	spin_lock(&rq_lock);
+	if (!rq_info.rq_nr_thresholds && !rq_info.load_nr_thresholds) {
+		spin_unlock(&rq_lock);
+		return false;
+	}
+
+	if (rq_info.rq_nr_thresholds) {
+		level = rq_stats_level(rq_info.rq_thresholds,
+				       rq_info.rq_nr_thresholds,
+				       rq_info.rq_avg);
+		if (level != rq_info.rq_level) {
+			rq_info.rq_level = level;
+			set_bit(RQ_NOTIFY_RUN_QUEUE, &rq_info.notify_pending);
+			queue = true;
+		}
+	}
+	if (rq_info.load_nr_thresholds &&
+	    jiffy_gap >= rq_info.def_timer_jiffies) {
+		rq_info.def_timer_last_jiffy = jiffies;
+		queue = true;
+	}
+	spin_unlock(&rq_lock);
+
+	if (queue)
+		queue_work(rq_wq, &rq_info.def_timer_work);
+	return true;
+}
+
 static void wakeup_user(void)
 {
 	unsigned long jiffy_gap;
 
 	jiffy_gap = jiffies - rq_info.def_timer_last_jiffy;
+	if (wakeup_user_threshold(jiffy_gap))
+		return;
+
 	if (jiffy_gap >= rq_info.def_timer_jiffies) {
 		rq_info.def_timer_last_jiffy = jiffies;
 		queue_work(rq_wq, &rq_info.def_timer_work);
@@ -26,6 +26,9 @@
 #include <linux/uaccess.h>
 #include <linux/debugfs.h>
 #include <linux/rwsem.h>
+#include <linux/rculist.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/ipc_logging.h>
 #include <linux/uaccess.h>
 #include <linux/ipc_router.h>
@@ -71,6 +74,11 @@ if (msm_ipc_router_debug_mask & RTR_DBG) \
 static LIST_HEAD(control_ports);
 static DECLARE_RWSEM(control_ports_lock_lha5);
 
+/* Local ports and the routing table are looked up on every message that
+ * is delivered. The lookups walk the hash buckets under RCU, while the
+ * rwsems still serialize additions, removals and the slower walkers that
+ * need a stable view of the table (debugfs dumps, server list sync).
+ */
 #define LP_HASH_SIZE 32
 static struct list_head local_ports[LP_HASH_SIZE];
 static DECLARE_RWSEM(local_ports_lock_lhc2);
@@ -166,6 +174,7 @@ struct msm_ipc_routing_table_entry {
 	struct rw_semaphore lock_lha4;
 	unsigned long num_tx_bytes;
 	unsigned long num_rx_bytes;
+	struct rcu_head rcu;
 };
 
 #define LOG_CTX_NAME_LEN 32
@@ -452,14 +461,16 @@ static void ipc_router_log_msg(void *log_ctx, u32 xchng_type,
 	}
 }
 
-/* Must be called with routing_table_lock_lha3 locked. */
+/* Must be called with routing_table_lock_lha3 locked or under
+ * rcu_read_lock().
+ */
 static struct msm_ipc_routing_table_entry *lookup_routing_table(
 	u32 node_id)
 {
 	u32 key = (node_id % RT_HASH_SIZE);
 	struct msm_ipc_routing_table_entry *rt_entry;
 
-	list_for_each_entry(rt_entry, &routing_table[key], list) {
+	list_for_each_entry_rcu(rt_entry, &routing_table[key], list) {
 		if (rt_entry->node_id == node_id)
 			return rt_entry;
 	}
@@ -502,7 +513,7 @@ static struct msm_ipc_routing_table_entry *create_routing_table_entry(
 		rt_entry->neighbor_node_id = xprt_info->remote_node_id;
 
 	key = (node_id % RT_HASH_SIZE);
-	list_add_tail(&rt_entry->list, &routing_table[key]);
+	list_add_tail_rcu(&rt_entry->list, &routing_table[key]);
 out_create_rtentry1:
 	kref_get(&rt_entry->ref);
 out_create_rtentry2:
@@ -524,11 +535,11 @@ static struct msm_ipc_routing_table_entry *ipc_router_get_rtentry_ref(
 {
 	struct msm_ipc_routing_table_entry *rt_entry;
 
-	down_read(&routing_table_lock_lha3);
+	rcu_read_lock();
 	rt_entry = lookup_routing_table(node_id);
-	if (rt_entry)
-		kref_get(&rt_entry->ref);
-	up_read(&routing_table_lock_lha3);
+	if (rt_entry && !kref_get_unless_zero(&rt_entry->ref))
+		rt_entry = NULL;
+	rcu_read_unlock();
 	return rt_entry;
 }
 
@@ -546,9 +557,10 @@ void ipc_router_release_rtentry(struct kref *ref)
 
 	/* All references to a routing entry will be put only under SSR.
 	 * As part of SSR, all the internals of the routing table entry
-	 * are cleaned. So just free the routing table entry.
+	 * are cleaned. So just free the routing table entry once the
+	 * lockless readers are done with it.
 	 */
-	kfree(rt_entry);
+	kfree_rcu(rt_entry, rcu);
 }
 
 struct rr_packet *rr_read(struct msm_ipc_router_xprt_info *xprt_info)
@@ -1220,6 +1232,7 @@ static int post_pkt_to_port(struct msm_ipc_port *port_ptr,
 	mutex_lock(&port_ptr->port_rx_q_lock_lhc3);
 	if (pkt->ws_need)
 		__pm_stay_awake(port_ptr->port_rx_ws);
+	temp_pkt->rx_ts = ktime_get();
 	list_add_tail(&temp_pkt->list, &port_ptr->port_rx_q);
 	wake_up(&port_ptr->port_rx_wait_q);
 	notify = port_ptr->notify;
@@ -1332,7 +1345,7 @@ void msm_ipc_router_add_local_port(struct msm_ipc_port *port_ptr)
 
 	key = (port_ptr->this_port.port_id & (LP_HASH_SIZE - 1));
 	down_write(&local_ports_lock_lhc2);
-	list_add_tail(&port_ptr->list, &local_ports[key]);
+	list_add_tail_rcu(&port_ptr->list, &local_ports[key]);
 	up_write(&local_ports_lock_lhc2);
 }
 
@@ -1411,15 +1424,15 @@ static struct msm_ipc_port *ipc_router_get_port_ref(u32 port_id)
 	int key = (port_id & (LP_HASH_SIZE - 1));
 	struct msm_ipc_port *port_ptr;
 
-	down_read(&local_ports_lock_lhc2);
-	list_for_each_entry(port_ptr, &local_ports[key], list) {
-		if (port_ptr->this_port.port_id == port_id) {
-			kref_get(&port_ptr->ref);
-			up_read(&local_ports_lock_lhc2);
+	rcu_read_lock();
+	list_for_each_entry_rcu(port_ptr, &local_ports[key], list) {
+		if (port_ptr->this_port.port_id == port_id &&
+		    kref_get_unless_zero(&port_ptr->ref)) {
+			rcu_read_unlock();
 			return port_ptr;
 		}
 	}
-	up_read(&local_ports_lock_lhc2);
+	rcu_read_unlock();
 	return NULL;
 }
 
@@ -1444,7 +1457,7 @@ void ipc_router_release_port(struct kref *ref)
 	wakeup_source_unregister(port_ptr->port_rx_ws);
 	if (port_ptr->endpoint)
 		sock_put(ipc_port_sk(port_ptr->endpoint));
-	kfree(port_ptr);
+	kfree_rcu(port_ptr, rcu);
 }
 
 /**
@@ -2303,7 +2316,7 @@ static void msm_ipc_cleanup_routing_table(
 			cleanup_rmt_ports(xprt_info, rt_entry);
 			rt_entry->xprt_info = NULL;
 			up_write(&rt_entry->lock_lha4);
-			list_del(&rt_entry->list);
+			list_del_rcu(&rt_entry->list);
 			kref_put(&rt_entry->ref, ipc_router_release_rtentry);
 		}
 	}
@@ -3362,6 +3375,24 @@ static int msm_ipc_router_send_resume_tx(void *data)
 	return ret;
 }
 
+/**
+ * ipc_router_update_rx_latency() - Account the queueing latency of a packet
+ * @port_ptr: Local port from which the packet is being read.
+ * @pkt: Packet dequeued from the port's rx queue.
+ *
+ * Must be called with port_rx_q_lock_lhc3 locked.
+ */
+static void ipc_router_update_rx_latency(struct msm_ipc_port *port_ptr,
+					 struct rr_packet *pkt)
+{
+	u64 lat_us = ktime_us_delta(ktime_get(), pkt->rx_ts);
+
+	port_ptr->rx_lat_cnt++;
+	port_ptr->rx_lat_total_us += lat_us;
+	if (lat_us > port_ptr->rx_lat_max_us)
+		port_ptr->rx_lat_max_us = lat_us;
+}
+
 int msm_ipc_router_read(struct msm_ipc_port *port_ptr,
 			struct rr_packet **read_pkt,
 			size_t buf_len)
@@ -3385,6 +3416,7 @@ int msm_ipc_router_read(struct msm_ipc_port *port_ptr,
 	list_del(&pkt->list);
 	if (list_empty(&port_ptr->port_rx_q))
 		__pm_relax(port_ptr->port_rx_ws);
+	ipc_router_update_rx_latency(port_ptr, pkt);
 	*read_pkt = pkt;
 	mutex_unlock(&port_ptr->port_rx_q_lock_lhc3);
 	if (pkt->hdr.control_flag & CONTROL_FLAG_CONFIRM_RX)
@@ -3573,7 +3605,7 @@ int msm_ipc_router_close_port(struct msm_ipc_port *port_ptr)
 
 	if (port_ptr->type == SERVER_PORT || port_ptr->type == CLIENT_PORT) {
 		down_write(&local_ports_lock_lhc2);
-		list_del(&port_ptr->list);
+		list_del_rcu(&port_ptr->list);
 		up_write(&local_ports_lock_lhc2);
 
 		mutex_lock(&port_ptr->port_lock_lhc3);
@@ -3598,7 +3630,7 @@ int msm_ipc_router_close_port(struct msm_ipc_port *port_ptr)
 		up_write(&control_ports_lock_lha5);
 	} else if (port_ptr->type == IRSC_PORT) {
 		down_write(&local_ports_lock_lhc2);
-		list_del(&port_ptr->list);
+		list_del_rcu(&port_ptr->list);
 		up_write(&local_ports_lock_lhc2);
 		signal_irsc_completion();
 	}
@@ -3666,8 +3698,12 @@ int msm_ipc_router_bind_control_port(struct msm_ipc_port *port_ptr)
 		return -EINVAL;
 
 	down_write(&local_ports_lock_lhc2);
-	list_del(&port_ptr->list);
+	list_del_rcu(&port_ptr->list);
 	up_write(&local_ports_lock_lhc2);
+	/* Lockless readers may still be walking through this entry. Let them
+	 * finish before the list node is linked into the control port list.
+	 */
+	synchronize_rcu();
 	port_ptr->type = CONTROL_PORT;
 	down_write(&control_ports_lock_lha5);
 	list_add_tail(&port_ptr->list, &control_ports);
@@ -3939,20 +3975,29 @@ static void dump_local_ports(struct seq_file *s)
 {
 	int j;
 	struct msm_ipc_port *port_ptr;
+	u64 cnt, avg_us;
 
-	seq_printf(s, "%-11s|%-11s|%-32s|%-11s|\n",
-		   "Node_id", "Port_id", "Wakelock", "Last SVCID");
+	seq_printf(s, "%-11s|%-11s|%-32s|%-11s|%-11s|%-11s|%-11s|\n",
+		   "Node_id", "Port_id", "Wakelock", "Last SVCID",
+		   "Rx msgs", "Avg lat us", "Max lat us");
 	seq_puts(s, "------------------------------------------------------------\n");
 	down_read(&local_ports_lock_lhc2);
 	for (j = 0; j < LP_HASH_SIZE; j++) {
 		list_for_each_entry(port_ptr, &local_ports[j], list) {
 			mutex_lock(&port_ptr->port_lock_lhc3);
-			seq_printf(s, "0x%08x |0x%08x |%-32s|0x%08x |\n",
+			seq_printf(s, "0x%08x |0x%08x |%-32s|0x%08x |",
 				   port_ptr->this_port.node_id,
 				   port_ptr->this_port.port_id,
 				   port_ptr->rx_ws_name,
 				   port_ptr->last_served_svc_id);
 			mutex_unlock(&port_ptr->port_lock_lhc3);
+			mutex_lock(&port_ptr->port_rx_q_lock_lhc3);
+			cnt = port_ptr->rx_lat_cnt;
+			avg_us = cnt ? div64_u64(port_ptr->rx_lat_total_us,
+						 cnt) : 0;
+			seq_printf(s, "%-11llu|%-11llu|%-11llu|\n", cnt, avg_us,
+				   port_ptr->rx_lat_max_us);
+			mutex_unlock(&port_ptr->port_rx_q_lock_lhc3);
 		}
 	}
 	up_read(&local_ports_lock_lhc2);
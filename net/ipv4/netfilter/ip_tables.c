@@ -25,6 +25,7 @@
 #include <linux/proc_fs.h>
 #include <linux/err.h>
 #include <linux/cpumask.h>
+#include <linux/notifier.h>
 
 #include <linux/netfilter/x_tables.h>
 #include <linux/netfilter_ipv4/ip_tables.h>
@@ -35,6 +36,21 @@ MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Netfilter Core Team <coreteam@netfilter.org>");
 MODULE_DESCRIPTION("IPv4 packet filter");
 
+/* Told about rule changes, with the new rules already in place */
+static BLOCKING_NOTIFIER_HEAD(ipt_table_notifier);
+
+int ipt_register_table_notifier(struct notifier_block *nb)
+{
+	return blocking_notifier_chain_register(&ipt_table_notifier, nb);
+}
+EXPORT_SYMBOL_GPL(ipt_register_table_notifier);
+
+int ipt_unregister_table_notifier(struct notifier_block *nb)
+{
+	return blocking_notifier_chain_unregister(&ipt_table_notifier, nb);
+}
+EXPORT_SYMBOL_GPL(ipt_unregister_table_notifier);
+
 #ifdef CONFIG_NETFILTER_DEBUG
 #define IP_NF_ASSERT(x)		WARN_ON(!(x))
 #else
@@ -1103,6 +1119,7 @@ __do_replace(struct net *net, const char *name, unsigned int valid_hooks,
 	}
 	vfree(counters);
 	xt_table_unlock(t);
+	blocking_notifier_call_chain(&ipt_table_notifier, 0, net);
 	return ret;
 
  put_module:
@@ -1814,6 +1831,7 @@ void ipt_unregister_table(struct net *net, struct xt_table *table,
 {
 	nf_unregister_net_hooks(net, ops, hweight32(table->valid_hooks));
 	__ipt_unregister_table(net, table);
+	blocking_notifier_call_chain(&ipt_table_notifier, 0, net);
 }
 
 /* Returns 1 if the type and code is matched by the range, 0 otherwise */
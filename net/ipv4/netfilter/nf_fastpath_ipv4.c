@@ -0,0 +1,602 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Software fast path for forwarded IPv4 flows, such as tethered traffic
+ * between rmnet_data and the tethering interface that the hardware does
+ * not offload.
+ *
+ * A FORWARD hook that runs after the filter table learns a flow from
+ * every packet of an established, NATed, helper-less TCP or UDP
+ * conntrack: the tuple as it arrives, the address/port rewrite NAT
+ * applies to it and the route it takes. Later packets with the same
+ * tuple are caught in PRE_ROUTING before conntrack and forwarded from
+ * there. They bypass the iptables traversal, conntrack and routing
+ * lookups. Only the header rewrite, the TTL decrement and the neighbour
+ * output remain.
+ *
+ * Conntrack still owns the connection. A flow holds a reference and
+ * keeps it alive while it sees traffic. Its packet and byte counts are
+ * added to the conntrack accounting every second. Anything the fast path
+ * is not sure about goes back to the normal path, which can then decide
+ * to tear the flow down:
+ * - TCP SYN, FIN and RST
+ * - IP options and fragments
+ * - the last hop before TTL expiry
+ * - packets over the MTU
+ * - stale routes
+ * - dying conntracks
+ * Flows are flushed when iptables rules change and when interfaces go
+ * down.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/jhash.h>
+#include <linux/module.h>
+#include <linux/netdevice.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter_ipv4.h>
+#include <linux/netfilter_ipv4/ip_tables.h>
+#include <linux/notifier.h>
+#include <linux/random.h>
+#include <linux/rculist.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/tcp.h>
+#include <linux/udp.h>
+#include <linux/workqueue.h>
+#include <net/arp.h>
+#include <net/checksum.h>
+#include <net/dst.h>
+#include <net/ip.h>
+#include <net/neighbour.h>
+#include <net/route.h>
+#include <net/netfilter/nf_conntrack.h>
+#include <net/netfilter/nf_conntrack_acct.h>
+#include <net/netfilter/nf_conntrack_helper.h>
+
+#define NF_FP_HASH_BITS		10
+#define NF_FP_HASH_SIZE		(1 << NF_FP_HASH_BITS)
+#define NF_FP_MAX_FLOWS		8192
+#define NF_FP_GC_INTERVAL	HZ
+/* An idle flow goes, and conntrack times the connection out as usual */
+#define NF_FP_IDLE_TIMEOUT	(30 * HZ)
+
+static bool nf_fp_enable = true;
+module_param_named(enable, nf_fp_enable, bool, 0644);
+MODULE_PARM_DESC(enable, "Forward established NAT flows on the fast path");
+
+static unsigned int nf_fp_count;
+module_param_named(flows, nf_fp_count, uint, 0444);
+MODULE_PARM_DESC(flows, "Flows currently on the fast path");
+
+struct nf_fp_key {
+	__be32 saddr;
+	__be32 daddr;
+	__be16 sport;
+	__be16 dport;
+	u8 proto;
+	int iif;
+};
+
+struct nf_fp_flow {
+	struct hlist_node node;
+	struct rcu_head rcu;
+	struct nf_fp_key key;
+	__be32 new_saddr;
+	__be32 new_daddr;
+	__be16 new_sport;
+	__be16 new_dport;
+	possible_net_t net;
+	struct nf_conn *ct;
+	enum ip_conntrack_dir dir;
+	struct dst_entry *dst;
+	/* timeout conntrack gave the connection, renewed while in use */
+	u32 ct_timeout;
+	unsigned long last_used;
+	atomic64_t packets;
+	atomic64_t bytes;
+	bool dead;
+};
+
+static struct hlist_head nf_fp_hash[NF_FP_HASH_SIZE];
+static DEFINE_SPINLOCK(nf_fp_lock);
+static u32 nf_fp_seed __read_mostly;
+
+static void nf_fp_gc_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(nf_fp_gc_work, nf_fp_gc_fn);
+
+static u32 nf_fp_hashfn(const struct nf_fp_key *key)
+{
+	return jhash_3words((__force u32)key->saddr, (__force u32)key->daddr,
+			    ((__force u32)key->sport << 16 |
+			     (__force u32)key->dport) ^ key->proto,
+			    nf_fp_seed ^ key->iif) & (NF_FP_HASH_SIZE - 1);
+}
+
+static bool nf_fp_key_eq(const struct nf_fp_key *a, const struct nf_fp_key *b)
+{
+	return a->saddr == b->saddr && a->daddr == b->daddr &&
+	       a->sport == b->sport && a->dport == b->dport &&
+	       a->proto == b->proto && a->iif == b->iif;
+}
+
+/* Called under rcu_read_lock or nf_fp_lock */
+static struct nf_fp_flow *nf_fp_lookup(struct net *net,
+				       const struct nf_fp_key *key)
+{
+	struct nf_fp_flow *flow;
+
+	hlist_for_each_entry_rcu(flow, &nf_fp_hash[nf_fp_hashfn(key)], node)
+		if (nf_fp_key_eq(&flow->key, key) &&
+		    net_eq(read_pnet(&flow->net), net))
+			return flow;
+
+	return NULL;
+}
+
+static void nf_fp_flow_acct(struct nf_fp_flow *flow)
+{
+	struct nf_conn_acct *acct = nf_conn_acct_find(flow->ct);
+	u64 packets = atomic64_xchg(&flow->packets, 0);
+	u64 bytes = atomic64_xchg(&flow->bytes, 0);
+
+	if (acct && packets) {
+		atomic64_add(packets, &acct->counter[flow->dir].packets);
+		atomic64_add(bytes, &acct->counter[flow->dir].bytes);
+	}
+}
+
+static void nf_fp_flow_free_rcu(struct rcu_head *head)
+{
+	struct nf_fp_flow *flow = container_of(head, struct nf_fp_flow, rcu);
+
+	/* no packet can still be counting on it */
+	nf_fp_flow_acct(flow);
+	dst_release(flow->dst);
+	nf_ct_put(flow->ct);
+	kfree(flow);
+}
+
+/* Must be called with nf_fp_lock held */
+static void __nf_fp_flow_del(struct nf_fp_flow *flow)
+{
+	if (flow->dead)
+		return;
+
+	flow->dead = true;
+	hlist_del_rcu(&flow->node);
+	nf_fp_count--;
+	call_rcu(&flow->rcu, nf_fp_flow_free_rcu);
+}
+
+static void nf_fp_flow_del(struct nf_fp_flow *flow)
+{
+	spin_lock_bh(&nf_fp_lock);
+	__nf_fp_flow_del(flow);
+	spin_unlock_bh(&nf_fp_lock);
+}
+
+/* Drop the flows of @net, or of every namespace if NULL, or only those
+ * using @dev if it is given.
+ */
+static void nf_fp_flush(struct net *net, const struct net_device *dev)
+{
+	struct nf_fp_flow *flow;
+	struct hlist_node *tmp;
+	int i;
+
+	spin_lock_bh(&nf_fp_lock);
+	for (i = 0; i < NF_FP_HASH_SIZE; i++) {
+		hlist_for_each_entry_safe(flow, tmp, &nf_fp_hash[i], node) {
+			if (net && !net_eq(read_pnet(&flow->net), net))
+				continue;
+			if (dev && flow->key.iif != dev->ifindex &&
+			    flow->dst->dev != dev)
+				continue;
+			__nf_fp_flow_del(flow);
+		}
+	}
+	spin_unlock_bh(&nf_fp_lock);
+}
+
+static void nf_fp_gc_fn(struct work_struct *work)
+{
+	struct nf_fp_flow *flow;
+	struct hlist_node *tmp;
+	int i;
+
+	spin_lock_bh(&nf_fp_lock);
+	for (i = 0; i < NF_FP_HASH_SIZE; i++) {
+		hlist_for_each_entry_safe(flow, tmp, &nf_fp_hash[i], node) {
+			if (!nf_fp_enable || nf_ct_is_dying(flow->ct) ||
+			    time_after(jiffies,
+				       flow->last_used + NF_FP_IDLE_TIMEOUT)) {
+				__nf_fp_flow_del(flow);
+				continue;
+			}
+			if (atomic64_read(&flow->packets)) {
+				nf_fp_flow_acct(flow);
+				nf_ct_refresh(flow->ct, NULL, flow->ct_timeout);
+			}
+		}
+	}
+	spin_unlock_bh(&nf_fp_lock);
+
+	queue_delayed_work(system_power_efficient_wq, &nf_fp_gc_work,
+			   NF_FP_GC_INTERVAL);
+}
+
+static bool nf_fp_ct_eligible(struct nf_conn *ct)
+{
+	if (!nf_ct_is_confirmed(ct) || nf_ct_is_dying(ct) ||
+	    nf_ct_l3num(ct) != NFPROTO_IPV4)
+		return false;
+
+	/* both NAT bindings set up, nothing else touching the payload */
+	if (!(ct->status & IPS_NAT_MASK) ||
+	    (ct->status & IPS_NAT_DONE_MASK) != IPS_NAT_DONE_MASK ||
+	    test_bit(IPS_SEQ_ADJUST_BIT, &ct->status) || nfct_help(ct))
+		return false;
+
+	switch (nf_ct_protonum(ct)) {
+	case IPPROTO_TCP:
+		return ct->proto.tcp.state == TCP_CONNTRACK_ESTABLISHED;
+	case IPPROTO_UDP:
+		return test_bit(IPS_ASSURED_BIT, &ct->status);
+	default:
+		return false;
+	}
+}
+
+static void nf_fp_flow_add(struct net *net, struct nf_conn *ct,
+			   enum ip_conntrack_dir dir,
+			   const struct net_device *in, struct dst_entry *dst)
+{
+	const struct nf_conntrack_tuple *orig = &ct->tuplehash[dir].tuple;
+	const struct nf_conntrack_tuple *repl = &ct->tuplehash[!dir].tuple;
+	struct nf_fp_flow *flow;
+	struct nf_fp_key key = {
+		.saddr	= orig->src.u3.ip,
+		.daddr	= orig->dst.u3.ip,
+		.sport	= orig->src.u.all,
+		.dport	= orig->dst.u.all,
+		.proto	= orig->dst.protonum,
+		.iif	= in->ifindex,
+	};
+
+	if (nf_fp_lookup(net, &key) ||
+	    READ_ONCE(nf_fp_count) >= NF_FP_MAX_FLOWS)
+		return;
+
+	flow = kzalloc(sizeof(*flow), GFP_ATOMIC);
+	if (!flow)
+		return;
+
+	/* the packet leaves as the reverse of the reply tuple */
+	flow->key = key;
+	flow->new_saddr = repl->dst.u3.ip;
+	flow->new_daddr = repl->src.u3.ip;
+	flow->new_sport = repl->dst.u.all;
+	flow->new_dport = repl->src.u.all;
+	write_pnet(&flow->net, net);
+	flow->dir = dir;
+	flow->ct_timeout = nf_ct_expires(ct);
+	flow->last_used = jiffies;
+	atomic64_set(&flow->packets, 0);
+	atomic64_set(&flow->bytes, 0);
+
+	nf_conntrack_get(&ct->ct_general);
+	flow->ct = ct;
+	dst_hold(dst);
+	flow->dst = dst;
+
+	/* conntrack no longer sees every segment, so window checks go */
+	if (nf_ct_protonum(ct) == IPPROTO_TCP) {
+		spin_lock_bh(&ct->lock);
+		ct->proto.tcp.seen[0].flags |= IP_CT_TCP_FLAG_BE_LIBERAL;
+		ct->proto.tcp.seen[1].flags |= IP_CT_TCP_FLAG_BE_LIBERAL;
+		spin_unlock_bh(&ct->lock);
+	}
+
+	spin_lock_bh(&nf_fp_lock);
+	if (nf_fp_lookup(net, &key)) {
+		spin_unlock_bh(&nf_fp_lock);
+		dst_release(dst);
+		nf_ct_put(ct);
+		kfree(flow);
+		return;
+	}
+	hlist_add_head_rcu(&flow->node, &nf_fp_hash[nf_fp_hashfn(&key)]);
+	nf_fp_count++;
+	spin_unlock_bh(&nf_fp_lock);
+}
+
+static unsigned int nf_fp_forward(void *priv, struct sk_buff *skb,
+				  const struct nf_hook_state *state)
+{
+	enum ip_conntrack_info ctinfo;
+	struct dst_entry *dst = skb_dst(skb);
+	const struct iphdr *iph = ip_hdr(skb);
+	struct nf_conn *ct;
+
+	if (!nf_fp_enable || !dst || dst_xfrm(dst) || iph->ihl != 5 ||
+	    ip_is_fragment(iph))
+		return NF_ACCEPT;
+
+	ct = nf_ct_get(skb, &ctinfo);
+	if (!ct || nf_ct_is_untracked(ct) ||
+	    (ctinfo != IP_CT_ESTABLISHED && ctinfo != IP_CT_ESTABLISHED_REPLY))
+		return NF_ACCEPT;
+
+	if (nf_fp_ct_eligible(ct))
+		nf_fp_flow_add(state->net, ct, CTINFO2DIR(ctinfo), state->in,
+			       dst);
+
+	return NF_ACCEPT;
+}
+
+static void nf_fp_rewrite(struct sk_buff *skb, const struct nf_fp_flow *flow,
+			  unsigned int thoff)
+{
+	struct iphdr *iph = ip_hdr(skb);
+	__be16 *ports = (__be16 *)(skb_network_header(skb) + thoff);
+	__sum16 *check = NULL;
+	bool udp = iph->protocol == IPPROTO_UDP;
+
+	if (!udp)
+		check = &((struct tcphdr *)ports)->check;
+	else if (((struct udphdr *)ports)->check ||
+		 skb->ip_summed == CHECKSUM_PARTIAL)
+		check = &((struct udphdr *)ports)->check;
+
+	if (iph->saddr != flow->new_saddr) {
+		if (check)
+			inet_proto_csum_replace4(check, skb, iph->saddr,
+						 flow->new_saddr, true);
+		csum_replace4(&iph->check, iph->saddr, flow->new_saddr);
+		iph->saddr = flow->new_saddr;
+	}
+	if (iph->daddr != flow->new_daddr) {
+		if (check)
+			inet_proto_csum_replace4(check, skb, iph->daddr,
+						 flow->new_daddr, true);
+		csum_replace4(&iph->check, iph->daddr, flow->new_daddr);
+		iph->daddr = flow->new_daddr;
+	}
+	if (ports[0] != flow->new_sport) {
+		if (check)
+			inet_proto_csum_replace2(check, skb, ports[0],
+						 flow->new_sport, false);
+		ports[0] = flow->new_sport;
+	}
+	if (ports[1] != flow->new_dport) {
+		if (check)
+			inet_proto_csum_replace2(check, skb, ports[1],
+						 flow->new_dport, false);
+		ports[1] = flow->new_dport;
+	}
+	if (udp && check && !*check)
+		*check = CSUM_MANGLED_0;
+}
+
+/* As ip_finish_output2(), for a route that is known to be unicast */
+static int nf_fp_output(struct sk_buff *skb, struct rtable *rt)
+{
+	struct net_device *dev = rt->dst.dev;
+	struct neighbour *neigh;
+	u32 nexthop;
+	int ret = -EINVAL;
+
+	skb->dev = dev;
+	skb->protocol = htons(ETH_P_IP);
+
+	rcu_read_lock_bh();
+	nexthop = (__force u32)rt_nexthop(rt, ip_hdr(skb)->daddr);
+	neigh = __ipv4_neigh_lookup_noref(dev, nexthop);
+	if (unlikely(!neigh))
+		neigh = __neigh_create(&arp_tbl, &nexthop, dev, false);
+	if (!IS_ERR(neigh))
+		ret = dst_neigh_output(&rt->dst, neigh, skb);
+	else
+		kfree_skb(skb);
+	rcu_read_unlock_bh();
+
+	return ret;
+}
+
+static unsigned int nf_fp_in(void *priv, struct sk_buff *skb,
+			     const struct nf_hook_state *state)
+{
+	struct nf_fp_flow *flow;
+	struct nf_fp_key key;
+	struct dst_entry *dst;
+	struct iphdr *iph;
+	__be16 *ports;
+	unsigned int thoff, hdrsize, hh_len;
+
+	if (!nf_fp_enable || skb->nfct || skb->pkt_type != PACKET_HOST)
+		return NF_ACCEPT;
+
+	iph = ip_hdr(skb);
+	if (iph->ihl != 5 || ip_is_fragment(iph))
+		return NF_ACCEPT;
+
+	switch (iph->protocol) {
+	case IPPROTO_TCP:
+		hdrsize = sizeof(struct tcphdr);
+		break;
+	case IPPROTO_UDP:
+		hdrsize = sizeof(struct udphdr);
+		break;
+	default:
+		return NF_ACCEPT;
+	}
+
+	thoff = sizeof(*iph);
+	if (!pskb_may_pull(skb, thoff + hdrsize))
+		return NF_ACCEPT;
+
+	iph = ip_hdr(skb);
+	ports = (__be16 *)(skb_network_header(skb) + thoff);
+	key.saddr = iph->saddr;
+	key.daddr = iph->daddr;
+	key.sport = ports[0];
+	key.dport = ports[1];
+	key.proto = iph->protocol;
+	key.iif = state->in->ifindex;
+
+	flow = nf_fp_lookup(state->net, &key);
+	if (!flow)
+		return NF_ACCEPT;
+
+	/* connection state changes are for conntrack to see */
+	if (key.proto == IPPROTO_TCP) {
+		const struct tcphdr *th = (const struct tcphdr *)ports;
+
+		if (unlikely(th->syn || th->fin || th->rst)) {
+			nf_fp_flow_del(flow);
+			return NF_ACCEPT;
+		}
+	}
+
+	dst = flow->dst;
+	if (unlikely(nf_ct_is_dying(flow->ct) ||
+		     (dst->obsolete && !dst->ops->check(dst, 0)))) {
+		nf_fp_flow_del(flow);
+		return NF_ACCEPT;
+	}
+
+	/* the normal path sends the ICMP errors */
+	if (iph->ttl <= 1)
+		return NF_ACCEPT;
+	if (skb->len > dst_mtu(dst) &&
+	    (!skb_is_gso(skb) || !skb_gso_validate_mtu(skb, dst_mtu(dst))))
+		return NF_ACCEPT;
+
+	hh_len = LL_RESERVED_SPACE(dst->dev);
+	if (skb_try_make_writable(skb, thoff + hdrsize) ||
+	    (skb_headroom(skb) < hh_len && dst->dev->header_ops &&
+	     skb_cow_head(skb, hh_len)))
+		return NF_ACCEPT;
+
+	skb_forward_csum(skb);
+	nf_fp_rewrite(skb, flow, thoff);
+	iph = ip_hdr(skb);
+	ip_decrease_ttl(iph);
+	skb->priority = rt_tos2priority(iph->tos);
+
+	flow->last_used = jiffies;
+	atomic64_inc(&flow->packets);
+	atomic64_add(skb->len, &flow->bytes);
+
+	/* the hook runs under rcu_read_lock, which keeps the flow's dst */
+	skb_dst_drop(skb);
+	skb_dst_set_noref(skb, dst);
+	nf_fp_output(skb, (struct rtable *)dst);
+
+	return NF_STOLEN;
+}
+
+static struct nf_hook_ops nf_fp_ops[] __read_mostly = {
+	{
+		.hook		= nf_fp_in,
+		.pf		= NFPROTO_IPV4,
+		.hooknum	= NF_INET_PRE_ROUTING,
+		.priority	= NF_IP_PRI_CONNTRACK_DEFRAG + 1,
+	},
+	{
+		.hook		= nf_fp_forward,
+		.pf		= NFPROTO_IPV4,
+		.hooknum	= NF_INET_FORWARD,
+		.priority	= NF_IP_PRI_LAST,
+	},
+};
+
+static int nf_fp_table_event(struct notifier_block *nb, unsigned long event,
+			     void *ptr)
+{
+	nf_fp_flush(ptr, NULL);
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block nf_fp_table_nb = {
+	.notifier_call = nf_fp_table_event,
+};
+
+static int nf_fp_netdev_event(struct notifier_block *nb, unsigned long event,
+			      void *ptr)
+{
+	struct net_device *dev = netdev_notifier_info_to_dev(ptr);
+
+	switch (event) {
+	case NETDEV_DOWN:
+	case NETDEV_CHANGEMTU:
+	case NETDEV_UNREGISTER:
+		nf_fp_flush(dev_net(dev), dev);
+		break;
+	}
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block nf_fp_netdev_nb = {
+	.notifier_call = nf_fp_netdev_event,
+};
+
+static int __init nf_fp_init(void)
+{
+	int ret;
+
+	get_random_bytes(&nf_fp_seed, sizeof(nf_fp_seed));
+
+	ret = ipt_register_table_notifier(&nf_fp_table_nb);
+	if (ret)
+		return ret;
+
+	ret = register_netdevice_notifier(&nf_fp_netdev_nb);
+	if (ret)
+		goto err_table;
+
+	ret = nf_register_hooks(nf_fp_ops, ARRAY_SIZE(nf_fp_ops));
+	if (ret)
+		goto err_netdev;
+
+	queue_delayed_work(system_power_efficient_wq, &nf_fp_gc_work,
+			   NF_FP_GC_INTERVAL);
+
+	return 0;
+
+err_netdev:
+	unregister_netdevice_notifier(&nf_fp_netdev_nb);
+err_table:
+	ipt_unregister_table_notifier(&nf_fp_table_nb);
+	return ret;
+}
+
+static void __exit nf_fp_exit(void)
+{
+	nf_unregister_hooks(nf_fp_ops, ARRAY_SIZE(nf_fp_ops));
+	unregister_netdevice_notifier(&nf_fp_netdev_nb);
+	ipt_unregister_table_notifier(&nf_fp_table_nb);
+	cancel_delayed_work_sync(&nf_fp_gc_work);
+	nf_fp_flush(NULL, NULL);
+	rcu_barrier();
+}
+
+module_init(nf_fp_init);
+module_exit(nf_fp_exit);
+
+MODULE_DESCRIPTION("Software fast path for established IPv4 NAT flows");
+MODULE_LICENSE("GPL v2");
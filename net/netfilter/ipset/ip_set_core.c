@@ -13,9 +13,13 @@
 #include <linux/module.h>
 #include <linux/moduleparam.h>
 #include <linux/ip.h>
+#include <linux/ipv6.h>
+#include <linux/percpu.h>
 #include <linux/skbuff.h>
 #include <linux/spinlock.h>
 #include <linux/rculist.h>
+#include <net/ip.h>
+#include <net/ipv6.h>
 #include <net/netlink.h>
 #include <net/net_namespace.h>
 #include <net/netns/generic.h>
@@ -46,6 +50,46 @@ static inline struct ip_set_net *ip_set_pernet(struct net *net)
 #define IP_SET_INC	64
 #define STRNCMP(a, b)	(strncmp(a, b, IPSET_MAXNAMELEN) == 0)
 
+/* Elements of one batched add/del handled per set lock hold */
+#define IP_SET_BATCH_LOCKED	64
+
+/* Recent test results, per CPU and slotted by set index, so the chains
+ * testing several sets for each packet of a burst only walk the hash
+ * buckets once per set. An entry is valid while the set's gen matches.
+ */
+#define IP_SET_TEST_CACHE_SIZE	16
+
+struct ip_set_test_key {
+	union nf_inet_addr addr[2];
+	__be16 port[2];
+	u8 proto;
+	u8 dim;
+	u8 flags;
+	u8 pad;
+};
+
+struct ip_set_test_cache {
+	const struct ip_set *set;
+	u32 gen;
+	int ret;
+	struct ip_set_test_key key;
+};
+
+struct ip_set_test_cpu {
+	struct ip_set_test_cache slot[IP_SET_TEST_CACHE_SIZE];
+};
+
+static DEFINE_PER_CPU(struct ip_set_test_cpu, ip_set_test_cpu);
+
+/* Global, so a new set reusing a freed one's memory never matches */
+static atomic_t ip_set_gen = ATOMIC_INIT(0);
+
+static inline void
+ip_set_gen_bump(struct ip_set *set)
+{
+	WRITE_ONCE(set->gen, atomic_inc_return(&ip_set_gen));
+}
+
 static unsigned int max_sets;
 
 module_param(max_sets, int, 0600);
@@ -539,11 +583,88 @@ ip_set_rcu_get(struct net *net, ip_set_id_t index)
 	return set;
 }
 
+/* Fill @key from the packet, false if the result can't be cached */
+static bool
+ip_set_test_key(const struct sk_buff *skb, const struct ip_set *set,
+		const struct ip_set_adt_opt *opt, struct ip_set_test_key *key)
+{
+	bool ports = set->type->features & IPSET_TYPE_PORT;
+	const __be16 *pptr;
+	__be16 _ports[2];
+	unsigned int thoff;
+	bool frag;
+
+	memset(key, 0, sizeof(*key));
+	key->dim = opt->dim;
+	key->flags = opt->flags;
+
+	switch (opt->family) {
+	case NFPROTO_IPV4: {
+		const struct iphdr *iph = ip_hdr(skb);
+
+		key->addr[0].ip = iph->saddr;
+		key->addr[1].ip = iph->daddr;
+		if (!ports)
+			return true;
+		key->proto = iph->protocol;
+		frag = ntohs(iph->frag_off) & IP_OFFSET;
+		thoff = skb_network_offset(skb) + ip_hdrlen(skb);
+		break;
+	}
+#if IS_ENABLED(CONFIG_IPV6)
+	case NFPROTO_IPV6: {
+		const struct ipv6hdr *ip6h = ipv6_hdr(skb);
+		__be16 frag_off;
+		int off;
+
+		key->addr[0].in6 = ip6h->saddr;
+		key->addr[1].in6 = ip6h->daddr;
+		if (!ports)
+			return true;
+		key->proto = ip6h->nexthdr;
+		off = ipv6_skip_exthdr(skb, skb_network_offset(skb) +
+				       sizeof(*ip6h), &key->proto, &frag_off);
+		if (off < 0)
+			return false;
+		frag = frag_off & htons(IP6_OFFSET);
+		thoff = off;
+		break;
+	}
+#endif
+	default:
+		return false;
+	}
+
+	/* other protocols have no ports, or the type uses ICMP type/code */
+	switch (key->proto) {
+	case IPPROTO_TCP:
+	case IPPROTO_UDP:
+	case IPPROTO_UDPLITE:
+	case IPPROTO_SCTP:
+		break;
+	default:
+		return false;
+	}
+	if (frag)
+		return false;
+
+	pptr = skb_header_pointer(skb, thoff, sizeof(_ports), _ports);
+	if (!pptr)
+		return false;
+	key->port[0] = pptr[0];
+	key->port[1] = pptr[1];
+
+	return true;
+}
+
 int
 ip_set_test(ip_set_id_t index, const struct sk_buff *skb,
 	    const struct xt_action_param *par, struct ip_set_adt_opt *opt)
 {
 	struct ip_set *set = ip_set_rcu_get(par->net, index);
+	struct ip_set_test_cache *cache = NULL;
+	struct ip_set_test_key key;
+	u32 gen = 0;
 	int ret = 0;
 
 	BUG_ON(!set);
@@ -554,14 +675,35 @@ ip_set_test(ip_set_id_t index, const struct sk_buff *skb,
 		return 0;
 
 	rcu_read_lock_bh();
+	/* counters, timeouts and skbinfo need the element itself */
+	if ((set->type->features & IPSET_TYPE_TEST_CACHE) && !set->extensions &&
+	    ip_set_test_key(skb, set, opt, &key)) {
+		cache = &this_cpu_ptr(&ip_set_test_cpu)->slot[index &
+					(IP_SET_TEST_CACHE_SIZE - 1)];
+		gen = READ_ONCE(set->gen);
+		if (cache->set == set && cache->gen == gen &&
+		    !memcmp(&cache->key, &key, sizeof(key))) {
+			ret = cache->ret;
+			rcu_read_unlock_bh();
+			goto out;
+		}
+	}
 	ret = set->variant->kadt(set, skb, par, IPSET_TEST, opt);
+	if (cache && ret != -EAGAIN) {
+		cache->set = set;
+		cache->gen = gen;
+		cache->ret = ret;
+		cache->key = key;
+	}
 	rcu_read_unlock_bh();
 
+out:
 	if (ret == -EAGAIN) {
 		/* Type requests element to be completed */
 		pr_debug("element must be completed, ADD is triggered\n");
 		spin_lock_bh(&set->lock);
 		set->variant->kadt(set, skb, par, IPSET_ADD, opt);
+		ip_set_gen_bump(set);
 		spin_unlock_bh(&set->lock);
 		ret = 1;
 	} else {
@@ -593,6 +735,7 @@ ip_set_add(ip_set_id_t index, const struct sk_buff *skb,
 
 	spin_lock_bh(&set->lock);
 	ret = set->variant->kadt(set, skb, par, IPSET_ADD, opt);
+	ip_set_gen_bump(set);
 	spin_unlock_bh(&set->lock);
 
 	return ret;
@@ -615,6 +758,7 @@ ip_set_del(ip_set_id_t index, const struct sk_buff *skb,
 
 	spin_lock_bh(&set->lock);
 	ret = set->variant->kadt(set, skb, par, IPSET_DEL, opt);
+	ip_set_gen_bump(set);
 	spin_unlock_bh(&set->lock);
 
 	return ret;
@@ -890,6 +1034,7 @@ static int ip_set_create(struct net *net, struct sock *ctnl,
 	if (!set)
 		return -ENOMEM;
 	spin_lock_init(&set->lock);
+	ip_set_gen_bump(set);
 	strlcpy(set->name, name, IPSET_MAXNAMELEN);
 	set->family = family;
 	set->revision = revision;
@@ -1070,6 +1215,7 @@ ip_set_flush_set(struct ip_set *set)
 
 	spin_lock_bh(&set->lock);
 	set->variant->flush(set);
+	ip_set_gen_bump(set);
 	spin_unlock_bh(&set->lock);
 }
 
@@ -1188,8 +1334,10 @@ static int ip_set_swap(struct net *net, struct sock *ctnl, struct sk_buff *skb,
 	/* Features must not change.
 	 * Not an artifical restriction anymore, as we must prevent
 	 * possible loops created by swapping in setlist type of sets.
+	 * Whether results are cached is not one of them.
 	 */
-	if (!(from->type->features == to->type->features &&
+	if (!(((from->type->features ^ to->type->features) &
+	       ~IPSET_TYPE_TEST_CACHE) == 0 &&
 	      from->family == to->family))
 		return -IPSET_ERR_TYPE_MISMATCH;
 
@@ -1461,26 +1609,34 @@ static const struct nla_policy ip_set_adt_policy[IPSET_ATTR_CMD_MAX + 1] = {
 	[IPSET_ATTR_ADT]	= { .type = NLA_NESTED },
 };
 
+/* Called with set->lock held, which is dropped while the set is resized */
 static int
-call_ad(struct sock *ctnl, struct sk_buff *skb, struct ip_set *set,
-	struct nlattr *tb[], enum ipset_adt adt,
-	u32 flags, bool use_lineno)
+call_ad_locked(struct ip_set *set, struct nlattr *tb[], enum ipset_adt adt,
+	       u32 *lineno, u32 flags)
 {
+	bool retried = false;
 	int ret;
-	u32 lineno = 0;
-	bool eexist = flags & IPSET_FLAG_EXIST, retried = false;
 
-	do {
-		spin_lock_bh(&set->lock);
-		ret = set->variant->uadt(set, tb, adt, &lineno, flags, retried);
+	for (;;) {
+		ret = set->variant->uadt(set, tb, adt, lineno, flags, retried);
+		ip_set_gen_bump(set);
+		if (ret != -EAGAIN || !set->variant->resize)
+			break;
 		spin_unlock_bh(&set->lock);
+		ret = set->variant->resize(set, true);
+		spin_lock_bh(&set->lock);
+		if (ret)
+			break;
 		retried = true;
-	} while (ret == -EAGAIN &&
-		 set->variant->resize &&
-		 (ret = set->variant->resize(set, retried)) == 0);
+	}
 
-	if (!ret || (ret == -IPSET_ERR_EXIST && eexist))
-		return 0;
+	return ret;
+}
+
+static int
+ad_error(struct sock *ctnl, struct sk_buff *skb, int ret, u32 lineno,
+	 bool use_lineno)
+{
 	if (lineno && use_lineno) {
 		/* Error in restore/batch mode: send back lineno */
 		struct nlmsghdr *rep, *nlh = nlmsg_hdr(skb);
@@ -1520,6 +1676,64 @@ call_ad(struct sock *ctnl, struct sk_buff *skb, struct ip_set *set,
 	return ret;
 }
 
+static int
+call_ad(struct sock *ctnl, struct sk_buff *skb, struct ip_set *set,
+	struct nlattr *tb[], enum ipset_adt adt,
+	u32 flags, bool use_lineno)
+{
+	int ret;
+	u32 lineno = 0;
+	bool eexist = flags & IPSET_FLAG_EXIST;
+
+	spin_lock_bh(&set->lock);
+	ret = call_ad_locked(set, tb, adt, &lineno, flags);
+	spin_unlock_bh(&set->lock);
+
+	if (!ret || (ret == -IPSET_ERR_EXIST && eexist))
+		return 0;
+
+	return ad_error(ctnl, skb, ret, lineno, use_lineno);
+}
+
+/* The elements of an IPSET_ATTR_ADT list, up to IP_SET_BATCH_LOCKED of
+ * them per set lock hold rather than locking the set for each one.
+ */
+static int
+call_ad_batch(struct sock *ctnl, struct sk_buff *skb, struct ip_set *set,
+	      const struct nlattr *adt_attr, enum ipset_adt adt,
+	      u32 flags, bool use_lineno)
+{
+	struct nlattr *tb[IPSET_ATTR_ADT_MAX + 1];
+	bool eexist = flags & IPSET_FLAG_EXIST;
+	const struct nlattr *nla;
+	int nla_rem, n = 0, ret = 0;
+	u32 lineno = 0;
+
+	spin_lock_bh(&set->lock);
+	nla_for_each_nested(nla, adt_attr, nla_rem) {
+		memset(tb, 0, sizeof(tb));
+		if (nla_type(nla) != IPSET_ATTR_DATA ||
+		    !flag_nested(nla) ||
+		    nla_parse_nested(tb, IPSET_ATTR_ADT_MAX, nla,
+				     set->type->adt_policy)) {
+			spin_unlock_bh(&set->lock);
+			return -IPSET_ERR_PROTOCOL;
+		}
+		ret = call_ad_locked(set, tb, adt, &lineno, flags);
+		if (ret && !(ret == -IPSET_ERR_EXIST && eexist))
+			break;
+		ret = 0;
+		if (++n % IP_SET_BATCH_LOCKED == 0) {
+			spin_unlock_bh(&set->lock);
+			cond_resched();
+			spin_lock_bh(&set->lock);
+		}
+	}
+	spin_unlock_bh(&set->lock);
+
+	return ret ? ad_error(ctnl, skb, ret, lineno, use_lineno) : 0;
+}
+
 static int ip_set_uadd(struct net *net, struct sock *ctnl, struct sk_buff *skb,
 		       const struct nlmsghdr *nlh,
 		       const struct nlattr * const attr[])
@@ -1527,7 +1741,6 @@ static int ip_set_uadd(struct net *net, struct sock *ctnl, struct sk_buff *skb,
 	struct ip_set_net *inst = ip_set_pernet(net);
 	struct ip_set *set;
 	struct nlattr *tb[IPSET_ATTR_ADT_MAX + 1] = {};
-	const struct nlattr *nla;
 	u32 flags = flag_exist(nlh);
 	bool use_lineno;
 	int ret = 0;
@@ -1556,20 +1769,8 @@ static int ip_set_uadd(struct net *net, struct sock *ctnl, struct sk_buff *skb,
 		ret = call_ad(ctnl, skb, set, tb, IPSET_ADD, flags,
 			      use_lineno);
 	} else {
-		int nla_rem;
-
-		nla_for_each_nested(nla, attr[IPSET_ATTR_ADT], nla_rem) {
-			memset(tb, 0, sizeof(tb));
-			if (nla_type(nla) != IPSET_ATTR_DATA ||
-			    !flag_nested(nla) ||
-			    nla_parse_nested(tb, IPSET_ATTR_ADT_MAX, nla,
-					     set->type->adt_policy))
-				return -IPSET_ERR_PROTOCOL;
-			ret = call_ad(ctnl, skb, set, tb, IPSET_ADD,
-				      flags, use_lineno);
-			if (ret < 0)
-				return ret;
-		}
+		ret = call_ad_batch(ctnl, skb, set, attr[IPSET_ATTR_ADT],
+				    IPSET_ADD, flags, use_lineno);
 	}
 	return ret;
 }
@@ -1581,7 +1782,6 @@ static int ip_set_udel(struct net *net, struct sock *ctnl, struct sk_buff *skb,
 	struct ip_set_net *inst = ip_set_pernet(net);
 	struct ip_set *set;
 	struct nlattr *tb[IPSET_ATTR_ADT_MAX + 1] = {};
-	const struct nlattr *nla;
 	u32 flags = flag_exist(nlh);
 	bool use_lineno;
 	int ret = 0;
@@ -1610,20 +1810,8 @@ static int ip_set_udel(struct net *net, struct sock *ctnl, struct sk_buff *skb,
 		ret = call_ad(ctnl, skb, set, tb, IPSET_DEL, flags,
 			      use_lineno);
 	} else {
-		int nla_rem;
-
-		nla_for_each_nested(nla, attr[IPSET_ATTR_ADT], nla_rem) {
-			memset(tb, 0, sizeof(*tb));
-			if (nla_type(nla) != IPSET_ATTR_DATA ||
-			    !flag_nested(nla) ||
-			    nla_parse_nested(tb, IPSET_ATTR_ADT_MAX, nla,
-					     set->type->adt_policy))
-				return -IPSET_ERR_PROTOCOL;
-			ret = call_ad(ctnl, skb, set, tb, IPSET_DEL,
-				      flags, use_lineno);
-			if (ret < 0)
-				return ret;
-		}
+		ret = call_ad_batch(ctnl, skb, set, attr[IPSET_ATTR_ADT],
+				    IPSET_DEL, flags, use_lineno);
 	}
 	return ret;
 }
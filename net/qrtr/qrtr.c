@@ -72,7 +72,7 @@ static LIST_HEAD(qrtr_all_nodes);
 /* lock for qrtr_nodes, qrtr_all_nodes and node reference */
 static DEFINE_MUTEX(qrtr_node_lock);
 
-/* local port allocation management */
+/* local port allocation management, lookups only need rcu_read_lock */
 static DEFINE_IDR(qrtr_ports);
 static DEFINE_MUTEX(qrtr_port_lock);
 
@@ -84,6 +84,8 @@ static DEFINE_MUTEX(qrtr_port_lock);
  * @nid: node id
  * @rx_queue: receive queue
  * @work: scheduled work struct for recv work
+ * @tx_queue: packets waiting for the endpoint to be free
+ * @tx_work: work struct handing @tx_queue to the endpoint
  * @item: list item for broadcast list
  */
 struct qrtr_node {
@@ -94,6 +96,8 @@ struct qrtr_node {
 
 	struct sk_buff_head rx_queue;
 	struct work_struct work;
+	struct sk_buff_head tx_queue;
+	struct work_struct tx_work;
 	struct list_head item;
 };
 
@@ -113,7 +117,9 @@ static void __qrtr_node_release(struct kref *kref)
 	mutex_unlock(&qrtr_node_lock);
 
 	cancel_work_sync(&node->work);
+	cancel_work_sync(&node->tx_work);
 	skb_queue_purge(&node->rx_queue);
+	skb_queue_purge(&node->tx_queue);
 	kfree(node);
 }
 
@@ -133,17 +139,55 @@ static void qrtr_node_release(struct qrtr_node *node)
 	kref_put_mutex(&node->ref, __qrtr_node_release, &qrtr_node_lock);
 }
 
-/* Pass an outgoing packet socket buffer to the endpoint driver. */
-static int qrtr_node_enqueue(struct qrtr_node *node, struct sk_buff *skb)
+/* Hand the queued outgoing packets to the endpoint driver, in order. */
+static void qrtr_node_tx_work(struct work_struct *work)
 {
-	int rc = -ENODEV;
+	struct qrtr_node *node = container_of(work, struct qrtr_node, tx_work);
+	struct sk_buff *skb;
 
 	mutex_lock(&node->ep_lock);
-	if (node->ep)
-		rc = node->ep->xmit(node->ep, skb);
-	else
-		kfree_skb(skb);
+	while ((skb = skb_dequeue(&node->tx_queue)) != NULL) {
+		if (node->ep)
+			node->ep->xmit(node->ep, skb);
+		else
+			kfree_skb(skb);
+	}
 	mutex_unlock(&node->ep_lock);
+}
+
+/* Pass an outgoing packet socket buffer to the endpoint driver.
+ *
+ * The endpoint may sleep in xmit, e.g. while its FIFO is full. Rather than
+ * have every sender to the node wait for the one in xmit, a packet that
+ * finds the endpoint busy is queued for the tx worker and the sender goes
+ * on; the socket send buffer bounds how much a socket can have queued.
+ * Packets only leave tx_queue under ep_lock, so sending directly when it
+ * is empty keeps them in order.
+ */
+static int qrtr_node_enqueue(struct qrtr_node *node, struct sk_buff *skb)
+{
+	int rc = 0;
+
+	if (!READ_ONCE(node->ep)) {
+		kfree_skb(skb);
+		return -ENODEV;
+	}
+
+	if (mutex_trylock(&node->ep_lock)) {
+		if (skb_queue_empty(&node->tx_queue)) {
+			rc = -ENODEV;
+			if (node->ep)
+				rc = node->ep->xmit(node->ep, skb);
+			else
+				kfree_skb(skb);
+			mutex_unlock(&node->ep_lock);
+			return rc;
+		}
+		mutex_unlock(&node->ep_lock);
+	}
+
+	skb_queue_tail(&node->tx_queue, skb);
+	schedule_work(&node->tx_work);
 
 	return rc;
 }
@@ -180,19 +224,9 @@ static void qrtr_node_assign(struct qrtr_node *node, unsigned int nid)
 	mutex_unlock(&qrtr_node_lock);
 }
 
-/**
- * qrtr_endpoint_post() - post incoming data
- * @ep: endpoint handle
- * @data: data pointer
- * @len: size of data in bytes
- *
- * Return: 0 on success; negative error code on failure
- */
-int qrtr_endpoint_post(struct qrtr_endpoint *ep, const void *data, size_t len)
+/* Check the header of an incoming packet of len bytes. */
+static int qrtr_check_hdr(const struct qrtr_hdr *phdr, size_t len)
 {
-	struct qrtr_node *node = ep->node;
-	const struct qrtr_hdr *phdr = data;
-	struct sk_buff *skb;
 	unsigned int psize;
 	unsigned int size;
 	unsigned int type;
@@ -218,6 +252,30 @@ int qrtr_endpoint_post(struct qrtr_endpoint *ep, const void *data, size_t len)
 	if (dst != QRTR_PORT_CTRL && type != QRTR_TYPE_DATA)
 		return -EINVAL;
 
+	return 0;
+}
+
+/**
+ * qrtr_endpoint_post() - post incoming data
+ * @ep: endpoint handle
+ * @data: data pointer
+ * @len: size of data in bytes
+ *
+ * The data is copied, see qrtr_endpoint_post_skb() for passing a buffer the
+ * endpoint owns.
+ *
+ * Return: 0 on success; negative error code on failure
+ */
+int qrtr_endpoint_post(struct qrtr_endpoint *ep, const void *data, size_t len)
+{
+	struct qrtr_node *node = ep->node;
+	struct sk_buff *skb;
+	int rc;
+
+	rc = qrtr_check_hdr(data, len);
+	if (rc)
+		return rc;
+
 	skb = __netdev_alloc_skb(NULL, len, GFP_ATOMIC | __GFP_NOWARN);
 	if (!skb)
 		return -ENOMEM;
@@ -232,6 +290,40 @@ int qrtr_endpoint_post(struct qrtr_endpoint *ep, const void *data, size_t len)
 }
 EXPORT_SYMBOL_GPL(qrtr_endpoint_post);
 
+/**
+ * qrtr_endpoint_post_skb() - post an incoming packet without copying it
+ * @ep: endpoint handle
+ * @skb: packet, header included, e.g. with the transport's pages as frags
+ *
+ * The skb is consumed whether or not the packet is accepted.
+ *
+ * Return: 0 on success; negative error code on failure
+ */
+int qrtr_endpoint_post_skb(struct qrtr_endpoint *ep, struct sk_buff *skb)
+{
+	struct qrtr_node *node = ep->node;
+	int rc = -EINVAL;
+
+	if (!pskb_may_pull(skb, QRTR_HDR_SIZE))
+		goto err;
+
+	rc = qrtr_check_hdr((const struct qrtr_hdr *)skb->data, skb->len);
+	if (rc)
+		goto err;
+
+	skb_orphan(skb);
+	skb_reset_transport_header(skb);
+	skb_queue_tail(&node->rx_queue, skb);
+	schedule_work(&node->work);
+
+	return 0;
+
+err:
+	kfree_skb(skb);
+	return rc;
+}
+EXPORT_SYMBOL_GPL(qrtr_endpoint_post_skb);
+
 /* Allocate and construct a resume-tx packet. */
 static struct sk_buff *qrtr_alloc_resume_tx(u32 src_node,
 					    u32 dst_node, u32 port)
@@ -332,9 +424,11 @@ int qrtr_endpoint_register(struct qrtr_endpoint *ep, unsigned int nid)
 		return -ENOMEM;
 
 	INIT_WORK(&node->work, qrtr_node_rx_work);
+	INIT_WORK(&node->tx_work, qrtr_node_tx_work);
 	kref_init(&node->ref);
 	mutex_init(&node->ep_lock);
 	skb_queue_head_init(&node->rx_queue);
+	skb_queue_head_init(&node->tx_queue);
 	node->nid = QRTR_EP_NID_AUTO;
 	node->ep = ep;
 
@@ -367,6 +461,9 @@ void qrtr_endpoint_unregister(struct qrtr_endpoint *ep)
 EXPORT_SYMBOL_GPL(qrtr_endpoint_unregister);
 
 /* Lookup socket by port.
+ *
+ * Sockets are freed after an RCU grace period, so one found here is still
+ * there to take a reference on unless it is already being released.
  *
  * Callers must release with qrtr_port_put()
  */
@@ -377,11 +474,11 @@ static struct qrtr_sock *qrtr_port_lookup(int port)
 	if (port == QRTR_PORT_CTRL)
 		port = 0;
 
-	mutex_lock(&qrtr_port_lock);
+	rcu_read_lock();
 	ipc = idr_find(&qrtr_ports, port);
-	if (ipc)
-		sock_hold(&ipc->sk);
-	mutex_unlock(&qrtr_port_lock);
+	if (ipc && !atomic_inc_not_zero(&ipc->sk.sk_refcnt))
+		ipc = NULL;
+	rcu_read_unlock();
 
 	return ipc;
 }
@@ -924,6 +1021,7 @@ static int qrtr_create(struct net *net, struct socket *sock,
 		return -ENOMEM;
 
 	sock_set_flag(sk, SOCK_ZAPPED);
+	sock_set_flag(sk, SOCK_RCU_FREE);
 
 	sock_init_data(sock, sk);
 	sock->ops = &qrtr_proto_ops;
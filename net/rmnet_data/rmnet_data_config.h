@@ -23,6 +23,21 @@
 
 #define RMNET_DATA_MAX_LOGICAL_EP 256
 
+/**
+ * struct rmnet_gro_flush_state - Dynamic GRO flush bookkeeping
+ *
+ * @last_flush_time: Wall clock time of the last forced GRO flush
+ * @curr_time_limit: Current flush interval (ns)
+ * @flush_byte_count: Bytes passed to GRO since the last flush
+ * @curr_byte_threshold: Current byte threshold for relaxing the flush interval
+ */
+struct rmnet_gro_flush_state {
+	struct timespec last_flush_time;
+	long curr_time_limit;
+	unsigned int flush_byte_count;
+	unsigned int curr_byte_threshold;
+};
+
 /**
  * struct rmnet_logical_ep_conf_s - Logical end-point configuration
  *
@@ -33,13 +48,11 @@
  * @mux_id: Virtual channel ID used by MAP protocol
  * @egress_dev: Next device to deliver the packet to. Exact usage of this
  *            parmeter depends on the rmnet_mode
+ * @gro_flush: GRO flush state used when packets are delivered inline
  */
 struct rmnet_logical_ep_conf_s {
 	struct net_device *egress_dev;
-	struct timespec last_flush_time;
-	long curr_time_limit;
-	unsigned int flush_byte_count;
-	unsigned int curr_byte_threshold;
+	struct rmnet_gro_flush_state gro_flush;
 	u8 refcount;
 	u8 rmnet_mode;
 	u8 mux_id;
@@ -64,6 +77,11 @@ struct rmnet_logical_ep_conf_s {
  * @tail_spacing: Guaranteed padding (bytes) when de-aggregating ingress frames
  * @agg_time: Wall clock time when aggregated frame was created
  * @agg_last: Last time the aggregation routing was invoked
+ * @agg_rate_start: Start of the current TX rate sampling window
+ * @agg_rate_bytes: Bytes offered for aggregation in the current window
+ * @agg_rate: Smoothed TX rate (bytes per second)
+ * @agg_cur_time_limit: Adaptive aggregation time limit (ns)
+ * @agg_cur_size: Adaptive aggregation size limit (bytes)
  */
 struct rmnet_phys_ep_config {
 	struct net_device *dev;
@@ -87,6 +105,12 @@ struct rmnet_phys_ep_config {
 	struct timespec agg_time;
 	struct timespec agg_last;
 	struct hrtimer hrtimer;
+	/* Adaptive aggregation state, also protected by agg_lock */
+	struct timespec agg_rate_start;
+	u32 agg_rate_bytes;
+	u64 agg_rate;
+	long agg_cur_time_limit;
+	u16 agg_cur_size;
 };
 
 int rmnet_config_init(void);
@@ -20,6 +20,9 @@
 #include <linux/netdev_features.h>
 #include <linux/ip.h>
 #include <linux/ipv6.h>
+#include <linux/jhash.h>
+#include <linux/percpu.h>
+#include <linux/smp.h>
 #include <net/rmnet_config.h>
 #include "rmnet_data_private.h"
 #include "rmnet_data_config.h"
@@ -72,6 +75,25 @@ MODULE_PARM_DESC(upper_byte_limit, "Max byte count for flushing GRO");
 #define RMNET_DATA_GRO_RCV_FAIL 0
 #define RMNET_DATA_GRO_RCV_PASS 1
 
+/**
+ * struct rmnet_rps_cpu - Per-CPU backlog for flow steered MAP packets
+ * @queue:       Deaggregated packets waiting to be delivered on this CPU
+ * @napi:        NAPI context the backlog is drained and GRO'd in
+ * @csd:         Cross-CPU call used to schedule @napi from the RX CPU
+ * @ipi_pending: Set while @csd is in flight
+ * @gro_flush:   GRO flush state for packets delivered on this CPU
+ */
+struct rmnet_rps_cpu {
+	struct sk_buff_head queue;
+	struct napi_struct napi;
+	struct call_single_data csd;
+	unsigned long ipi_pending;
+	struct rmnet_gro_flush_state gro_flush;
+};
+
+static DEFINE_PER_CPU(struct rmnet_rps_cpu, rmnet_rps_cpus);
+static struct net_device rmnet_rps_dummy_dev;
+
 /* Helper Functions */
 
 /* __rmnet_data_set_skb_proto() - Set skb->protocol field
@@ -257,61 +279,61 @@ static int rmnet_check_skb_can_gro(struct sk_buff *skb)
  * ratio.
  */
 static void rmnet_optional_gro_flush(struct napi_struct *napi,
-				     struct rmnet_logical_ep_conf_s *ep,
-					 unsigned int skb_size)
+				     struct rmnet_gro_flush_state *fs,
+				     unsigned int skb_size)
 {
 	struct timespec curr_time, diff;
 
 	if (!gro_flush_logic_on)
 		return;
 
-	if (unlikely(ep->last_flush_time.tv_sec == 0)) {
-		getnstimeofday(&ep->last_flush_time);
-		ep->flush_byte_count = 0;
-		ep->curr_time_limit = lower_flush_time;
-		ep->curr_byte_threshold = lower_byte_limit;
+	if (unlikely(fs->last_flush_time.tv_sec == 0)) {
+		getnstimeofday(&fs->last_flush_time);
+		fs->flush_byte_count = 0;
+		fs->curr_time_limit = lower_flush_time;
+		fs->curr_byte_threshold = lower_byte_limit;
 	} else {
 		getnstimeofday(&(curr_time));
-		diff = timespec_sub(curr_time, ep->last_flush_time);
-		ep->flush_byte_count += skb_size;
+		diff = timespec_sub(curr_time, fs->last_flush_time);
+		fs->flush_byte_count += skb_size;
 
 		if (dynamic_gro_on) {
 			if ((!(diff.tv_sec > 0) || diff.tv_nsec <=
-					ep->curr_time_limit) &&
-					ep->flush_byte_count >=
-					ep->curr_byte_threshold) {
+					fs->curr_time_limit) &&
+					fs->flush_byte_count >=
+					fs->curr_byte_threshold) {
 				/* Processed many bytes in a small time window.
 				 * No longer need to flush so often and we can
 				 * increase our byte limit
 				 */
-				ep->curr_time_limit = upper_flush_time;
-				ep->curr_byte_threshold = upper_byte_limit;
+				fs->curr_time_limit = upper_flush_time;
+				fs->curr_byte_threshold = upper_byte_limit;
 			} else if ((diff.tv_sec > 0 ||
-					diff.tv_nsec > ep->curr_time_limit) &&
-					ep->flush_byte_count <
-					ep->curr_byte_threshold) {
+					diff.tv_nsec > fs->curr_time_limit) &&
+					fs->flush_byte_count <
+					fs->curr_byte_threshold) {
 				/* We have not hit our time limit and we are not
 				 * receive many bytes. Demote ourselves to the
 				 * lowest limits and flush
 				 */
 				napi_gro_flush(napi, false);
-				ep->last_flush_time = curr_time;
-				ep->flush_byte_count = 0;
-				ep->curr_time_limit = lower_flush_time;
-				ep->curr_byte_threshold = lower_byte_limit;
+				fs->last_flush_time = curr_time;
+				fs->flush_byte_count = 0;
+				fs->curr_time_limit = lower_flush_time;
+				fs->curr_byte_threshold = lower_byte_limit;
 			} else if ((diff.tv_sec > 0 ||
-					diff.tv_nsec > ep->curr_time_limit) &&
-					ep->flush_byte_count >=
-					ep->curr_byte_threshold) {
+					diff.tv_nsec > fs->curr_time_limit) &&
+					fs->flush_byte_count >=
+					fs->curr_byte_threshold) {
 				/* Above byte and time limt, therefore we can
 				 * move/maintain our limits to be the max
 				 * and flush
 				 */
 				napi_gro_flush(napi, false);
-				ep->last_flush_time = curr_time;
-				ep->flush_byte_count = 0;
-				ep->curr_time_limit = upper_flush_time;
-				ep->curr_byte_threshold = upper_byte_limit;
+				fs->last_flush_time = curr_time;
+				fs->flush_byte_count = 0;
+				fs->curr_time_limit = upper_flush_time;
+				fs->curr_byte_threshold = upper_byte_limit;
 			}
 			/* else, below time limit and below
 			 * byte thresh, so change nothing
@@ -319,12 +341,45 @@ static void rmnet_optional_gro_flush(struct napi_struct *napi,
 		} else if (diff.tv_sec > 0 ||
 				diff.tv_nsec >= lower_flush_time) {
 			napi_gro_flush(napi, false);
-			ep->last_flush_time = curr_time;
-			ep->flush_byte_count = 0;
+			fs->last_flush_time = curr_time;
+			fs->flush_byte_count = 0;
 		}
 	}
 }
 
+/* rmnet_deliver_vnd_skb() - Hand a packet for a VND to the network stack
+ * @skb:      Packet with skb->dev set to the virtual network device
+ * @napi:     NAPI context the packet is being received in
+ * @fs:       GRO flush state to account the packet against
+ *
+ * TCP packets are passed through GRO when the VND has it enabled; everything
+ * else goes straight to netif_receive_skb().
+ */
+static void rmnet_deliver_vnd_skb(struct sk_buff *skb,
+				  struct napi_struct *napi,
+				  struct rmnet_gro_flush_state *fs)
+{
+	gro_result_t gro_res;
+	unsigned int skb_size;
+
+	skb_reset_transport_header(skb);
+	skb_reset_network_header(skb);
+
+	skb->pkt_type = PACKET_HOST;
+	skb_set_mac_header(skb, 0);
+
+	if (rmnet_check_skb_can_gro(skb) &&
+	    (skb->dev->features & NETIF_F_GRO)) {
+		skb_size = skb->len;
+		skb_get_hash(skb);
+		gro_res = napi_gro_receive(napi, skb);
+		trace_rmnet_gro_downlink(gro_res);
+		rmnet_optional_gro_flush(napi, fs, skb_size);
+	} else {
+		netif_receive_skb(skb);
+	}
+}
+
 /* __rmnet_deliver_skb() - Deliver skb
  *
  * Determines where to deliver skb. Options are: consume by network stack,
@@ -337,32 +392,12 @@ static void rmnet_optional_gro_flush(struct napi_struct *napi,
 static rx_handler_result_t __rmnet_deliver_skb
 	(struct sk_buff *skb, struct rmnet_logical_ep_conf_s *ep)
 {
-	struct napi_struct *napi = NULL;
-	gro_result_t gro_res;
-	unsigned int skb_size;
-
 	trace___rmnet_deliver_skb(skb);
 	switch (ep->rmnet_mode) {
 	case RMNET_EPMODE_VND:
-		skb_reset_transport_header(skb);
-		skb_reset_network_header(skb);
 		rmnet_vnd_rx_fixup(skb, skb->dev);
-
-		skb->pkt_type = PACKET_HOST;
-		skb_set_mac_header(skb, 0);
-
-		if (rmnet_check_skb_can_gro(skb) &&
-		    (skb->dev->features & NETIF_F_GRO)) {
-			napi = get_current_napi_context();
-
-			skb_size = skb->len;
-			skb_get_hash(skb);
-			gro_res = napi_gro_receive(napi, skb);
-			trace_rmnet_gro_downlink(gro_res);
-			rmnet_optional_gro_flush(napi, ep, skb_size);
-		} else{
-			netif_receive_skb(skb);
-		}
+		rmnet_deliver_vnd_skb(skb, get_current_napi_context(),
+				      &ep->gro_flush);
 		return RX_HANDLER_CONSUMED;
 
 	case RMNET_EPMODE_NONE:
@@ -378,6 +413,144 @@ static rx_handler_result_t __rmnet_deliver_skb
 	}
 }
 
+/* RPS style flow steering */
+
+/* rmnet_rps_poll() - Drain the per-CPU backlog
+ * @napi:     Per-CPU NAPI context
+ * @budget:   Maximum number of packets to deliver
+ *
+ * Packets are delivered in the order they were queued, so the ordering of
+ * each flow steered to this CPU is preserved.
+ *
+ * Return: Number of packets delivered
+ */
+static int rmnet_rps_poll(struct napi_struct *napi, int budget)
+{
+	struct rmnet_rps_cpu *rcpu;
+	struct sk_buff *skb;
+	int work = 0;
+
+	rcpu = container_of(napi, struct rmnet_rps_cpu, napi);
+
+	while (work < budget && (skb = skb_dequeue(&rcpu->queue))) {
+		trace___rmnet_deliver_skb(skb);
+		rmnet_deliver_vnd_skb(skb, napi, &rcpu->gro_flush);
+		work++;
+	}
+
+	if (work < budget) {
+		napi_complete_done(napi, work);
+		/* A packet may have been queued after the last dequeue while
+		 * NAPI was still scheduled; pick it up rather than strand it.
+		 */
+		if (!skb_queue_empty(&rcpu->queue))
+			napi_schedule(napi);
+	}
+
+	return work;
+}
+
+/* rmnet_rps_trigger() - Cross-CPU call to schedule the backlog NAPI */
+static void rmnet_rps_trigger(void *data)
+{
+	struct rmnet_rps_cpu *rcpu = data;
+
+	clear_bit(0, &rcpu->ipi_pending);
+	napi_schedule(&rcpu->napi);
+}
+
+/* rmnet_rps_select_cpu() - Pick the CPU a flow is steered to
+ * @skb:      Packet with its network header set
+ * @mux_id:   MAP mux ID the packet arrived on
+ *
+ * The flow hash of the inner 5-tuple is mixed with the mux ID so that the
+ * same tuple on different PDNs does not collapse onto one CPU. A given flow
+ * always lands on the same CPU while the set of online CPUs is unchanged.
+ *
+ * Return: Target CPU
+ */
+static int rmnet_rps_select_cpu(struct sk_buff *skb, u8 mux_id)
+{
+	u32 idx;
+	int cpu;
+
+	idx = reciprocal_scale(jhash_1word(skb_get_hash(skb), mux_id),
+			       num_online_cpus());
+
+	for_each_online_cpu(cpu)
+		if (!idx--)
+			return cpu;
+
+	return smp_processor_id();
+}
+
+/* rmnet_rps_steer_skb() - Queue a packet to its flow's backlog CPU
+ * @skb:      Packet with MAP header removed and skb->dev set to the VND
+ * @mux_id:   MAP mux ID the packet arrived on
+ *
+ * Return:
+ *      - RX_HANDLER_CONSUMED always
+ */
+static rx_handler_result_t rmnet_rps_steer_skb(struct sk_buff *skb,
+					       u8 mux_id)
+{
+	struct rmnet_rps_cpu *rcpu;
+	int cpu;
+
+	skb_reset_network_header(skb);
+	cpu = rmnet_rps_select_cpu(skb, mux_id);
+	rcpu = &per_cpu(rmnet_rps_cpus, cpu);
+
+	if (skb_queue_len(&rcpu->queue) >= netdev_max_backlog) {
+		rmnet_kfree_skb(skb, RMNET_STATS_SKBFREE_RPS_BACKLOG_FULL);
+		return RX_HANDLER_CONSUMED;
+	}
+
+	/* Device stats are only touched on the RX CPU */
+	rmnet_vnd_rx_fixup(skb, skb->dev);
+	skb_queue_tail(&rcpu->queue, skb);
+
+	if (cpu == smp_processor_id())
+		napi_schedule(&rcpu->napi);
+	else if (!test_and_set_bit(0, &rcpu->ipi_pending))
+		smp_call_function_single_async(cpu, &rcpu->csd);
+
+	return RX_HANDLER_CONSUMED;
+}
+
+/* rmnet_rps_init() - Set up the per-CPU steering backlogs */
+void rmnet_rps_init(void)
+{
+	struct rmnet_rps_cpu *rcpu;
+	int cpu;
+
+	init_dummy_netdev(&rmnet_rps_dummy_dev);
+
+	for_each_possible_cpu(cpu) {
+		rcpu = &per_cpu(rmnet_rps_cpus, cpu);
+		skb_queue_head_init(&rcpu->queue);
+		rcpu->csd.func = rmnet_rps_trigger;
+		rcpu->csd.info = rcpu;
+		netif_napi_add(&rmnet_rps_dummy_dev, &rcpu->napi,
+			       rmnet_rps_poll, NAPI_POLL_WEIGHT);
+		napi_enable(&rcpu->napi);
+	}
+}
+
+/* rmnet_rps_exit() - Tear down the per-CPU steering backlogs */
+void rmnet_rps_exit(void)
+{
+	struct rmnet_rps_cpu *rcpu;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		rcpu = &per_cpu(rmnet_rps_cpus, cpu);
+		napi_disable(&rcpu->napi);
+		netif_napi_del(&rcpu->napi);
+		skb_queue_purge(&rcpu->queue);
+	}
+}
+
 /* rmnet_ingress_deliver_packet() - Ingress handler for raw IP and bridged
  *                                  MAP packets.
  * @skb:     Packet needing a destination.
@@ -486,8 +659,13 @@ static rx_handler_result_t _rmnet_map_ingress_handler
 
 	/* Subtract MAP header */
 	skb_pull(skb, sizeof(struct rmnet_map_header_s));
-	skb_trim(skb, len);
+	pskb_trim(skb, len);
 	__rmnet_data_set_skb_proto(skb);
+
+	if ((config->ingress_data_format & RMNET_INGRESS_FORMAT_MAP_RPS) &&
+	    ep->rmnet_mode == RMNET_EPMODE_VND)
+		return rmnet_rps_steer_skb(skb, mux_id);
+
 	return __rmnet_deliver_skb(skb, ep);
 }
 
@@ -612,7 +790,7 @@ static int rmnet_map_egress_handler(struct sk_buff *skb,
 			if (unlikely(__skb_linearize(skb)))
 				return RMNET_MAP_SUCCESS;
 
-		rmnet_map_aggregate(skb, config);
+		rmnet_map_aggregate(skb, config, required_headroom);
 		return RMNET_MAP_CONSUMED;
 	}
 
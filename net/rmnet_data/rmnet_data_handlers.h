@@ -20,4 +20,7 @@ void rmnet_egress_handler(struct sk_buff *skb,
 
 rx_handler_result_t rmnet_rx_handler(struct sk_buff **pskb);
 
+void rmnet_rps_init(void);
+void rmnet_rps_exit(void);
+
 #endif /* _RMNET_DATA_HANDLERS_H_ */
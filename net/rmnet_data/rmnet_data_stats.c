@@ -17,6 +17,7 @@
 #include <linux/kernel.h>
 #include <linux/export.h>
 #include <linux/skbuff.h>
+#include <linux/math64.h>
 #include <linux/spinlock.h>
 #include <linux/netdevice.h>
 #include <net/rmnet_config.h>
@@ -46,6 +47,27 @@ unsigned long int agg_count[RMNET_STATS_AGG_MAX];
 module_param_array(agg_count, ulong, 0, 0444);
 MODULE_PARM_DESC(agg_count, "SKBs Aggregated");
 
+static DEFINE_SPINLOCK(rmnet_agg_hist_lock);
+unsigned long int agg_fill_hist[RMNET_STATS_AGG_FILL_BUCKETS];
+module_param_array(agg_fill_hist, ulong, 0, 0444);
+MODULE_PARM_DESC(agg_fill_hist, "UL aggregate fill ratio in 10% buckets");
+
+unsigned long int agg_latency_hist[RMNET_STATS_AGG_LATENCY_BUCKETS];
+module_param_array(agg_latency_hist, ulong, 0, 0444);
+MODULE_PARM_DESC(agg_latency_hist,
+		 "UL aggregation delay <50,100,250,500us,1,2,4,>=4ms");
+
+/* Upper bounds (us) of all but the last agg_latency_hist bucket */
+static const unsigned int
+rmnet_agg_latency_bounds[RMNET_STATS_AGG_LATENCY_BUCKETS - 1] = {
+	50, 100, 250, 500, 1000, 2000, 4000
+};
+
+static DEFINE_SPINLOCK(rmnet_deagg_copy_lock);
+unsigned long int deagg_copy[RMNET_STATS_DEAGG_COPY_MAX];
+module_param_array(deagg_copy, ulong, 0, 0444);
+MODULE_PARM_DESC(deagg_copy, "Deaggregated SKBs built copy-free / by copy");
+
 static DEFINE_SPINLOCK(rmnet_checksum_dl_stats);
 unsigned long int checksum_dl_stats[RMNET_MAP_CHECKSUM_ENUM_LENGTH];
 module_param_array(checksum_dl_stats, ulong, 0, 0444);
@@ -94,6 +116,41 @@ void rmnet_stats_agg_pkts(int aggcount)
 	spin_unlock_irqrestore(&rmnet_agg_count, flags);
 }
 
+void rmnet_stats_agg_flush(unsigned int len, unsigned int max_len,
+			   s64 latency_ns)
+{
+	unsigned long flags;
+	unsigned int fill = 0;
+	unsigned int lat;
+	s64 latency_us;
+
+	if (max_len)
+		fill = min_t(unsigned int, len * RMNET_STATS_AGG_FILL_BUCKETS /
+			     max_len, RMNET_STATS_AGG_FILL_BUCKETS - 1);
+
+	latency_us = div_s64(latency_ns, NSEC_PER_USEC);
+	for (lat = 0; lat < RMNET_STATS_AGG_LATENCY_BUCKETS - 1; lat++)
+		if (latency_us < rmnet_agg_latency_bounds[lat])
+			break;
+
+	spin_lock_irqsave(&rmnet_agg_hist_lock, flags);
+	agg_fill_hist[fill]++;
+	agg_latency_hist[lat]++;
+	spin_unlock_irqrestore(&rmnet_agg_hist_lock, flags);
+}
+
+void rmnet_stats_deagg_copy(unsigned int type)
+{
+	unsigned long flags;
+
+	if (type >= RMNET_STATS_DEAGG_COPY_MAX)
+		return;
+
+	spin_lock_irqsave(&rmnet_deagg_copy_lock, flags);
+	deagg_copy[type]++;
+	spin_unlock_irqrestore(&rmnet_deagg_copy_lock, flags);
+}
+
 void rmnet_stats_dl_checksum(unsigned int rc)
 {
 	unsigned long flags;
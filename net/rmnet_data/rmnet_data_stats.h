@@ -40,6 +40,7 @@ enum rmnet_skb_free_e {
 	RMNET_STATS_SKBFREE_INGRESS_BAD_MAP_CKSUM,
 	RMNET_STATS_SKBFREE_MAPC_UNSUPPORTED,
 	RMNET_STATS_SKBFREE_MAPINGRESS_MUX_NO_EP,
+	RMNET_STATS_SKBFREE_RPS_BACKLOG_FULL,
 	RMNET_STATS_SKBFREE_MAX
 };
 
@@ -50,13 +51,26 @@ enum rmnet_queue_xmit_e {
 	RMNET_STATS_QUEUE_XMIT_AGG_TIMEOUT,
 	RMNET_STATS_QUEUE_XMIT_AGG_CPY_EXP_FAIL,
 	RMNET_STATS_QUEUE_XMIT_AGG_SKIP,
+	RMNET_STATS_QUEUE_XMIT_AGG_FLOW_FLUSH,
 	RMNET_STATS_QUEUE_XMIT_MAX
 };
 
+enum rmnet_deagg_copy_e {
+	RMNET_STATS_DEAGG_COPY_FREE,
+	RMNET_STATS_DEAGG_COPY_FALLBACK,
+	RMNET_STATS_DEAGG_COPY_MAX
+};
+
+#define RMNET_STATS_AGG_FILL_BUCKETS 10
+#define RMNET_STATS_AGG_LATENCY_BUCKETS 8
+
 void rmnet_kfree_skb(struct sk_buff *skb, unsigned int reason);
 void rmnet_stats_queue_xmit(int rc, unsigned int reason);
 void rmnet_stats_deagg_pkts(int aggcount);
+void rmnet_stats_deagg_copy(unsigned int type);
 void rmnet_stats_agg_pkts(int aggcount);
+void rmnet_stats_agg_flush(unsigned int len, unsigned int max_len,
+			   s64 latency_ns);
 void rmnet_stats_dl_checksum(unsigned int rc);
 void rmnet_stats_ul_checksum(unsigned int rc);
 #endif /* _RMNET_DATA_STATS_H_ */
@@ -21,7 +21,9 @@
 #include <linux/spinlock.h>
 #include <net/pkt_sched.h>
 #include <linux/atomic.h>
+#include <linux/moduleparam.h>
 #include <linux/net_map.h>
+#include <linux/rcupdate.h>
 #include "rmnet_data_config.h"
 #include "rmnet_data_handlers.h"
 #include "rmnet_data_private.h"
@@ -57,6 +59,10 @@ struct rmnet_vnd_private_s {
 	u32 qos_version;
 	struct rmnet_logical_ep_conf_s local_ep;
 
+	/* Serializes BQL completions, which come from any CPU */
+	spinlock_t bql_lock;
+	int id;
+
 	rwlock_t flow_map_lock;
 	struct list_head flow_head;
 	struct rmnet_map_flow_mapping_s root_flow;
@@ -66,6 +72,25 @@ struct rmnet_vnd_private_s {
 #define RMNET_VND_FC_NOT_ENABLED 1
 #define RMNET_VND_FC_KMALLOC_ERR 2
 
+#define RMNET_VND_MAX_TXQS       8
+
+/* Uplink packets in flight are described in skb_shinfo()->destructor_arg:
+ * the byte count, the VND id and the Tx queue index.
+ */
+#define RMNET_VND_BQL_LEN_MASK   0x00FFFFFF
+#define RMNET_VND_BQL_ID_SHIFT   24
+#define RMNET_VND_BQL_ID_MASK    0x1F
+#define RMNET_VND_BQL_TXQ_SHIFT  29
+#define RMNET_VND_BQL_TXQ_MASK   0x07
+
+/* Tx queues of new VNDs. Queue 0 carries the default flow (mark 0); each
+ * QoS flow is hashed to one of the others, so MAP flow control can stop a
+ * single flow and mq + fq_codel can schedule the queues independently.
+ */
+static unsigned int rmnet_vnd_txqs = 1;
+module_param(rmnet_vnd_txqs, uint, 0644);
+MODULE_PARM_DESC(rmnet_vnd_txqs, "Tx queues per VND (1 to 8)");
+
 /* Helper Functions */
 
 /* rmnet_vnd_add_qos_header() - Adds QoS header to front of skb->data
@@ -101,6 +126,84 @@ static void rmnet_vnd_add_qos_header(struct sk_buff *skb,
 	}
 }
 
+/* rmnet_vnd_flow_to_txq() - Tx queue carrying a MAP/QoS flow
+ * @dev:        Virtual network device
+ * @flow_id:    QoS flow ID, as set in skb->mark
+ */
+static u16 rmnet_vnd_flow_to_txq(struct net_device *dev, u32 flow_id)
+{
+	if (dev->real_num_tx_queues == 1 || !flow_id)
+		return 0;
+
+	return 1 + flow_id % (dev->real_num_tx_queues - 1);
+}
+
+/* rmnet_vnd_bql_complete() - Uplink skb destructor
+ * @skb:        Socket buffer freed by the physical device or egress path
+ *
+ * Reports the bytes of @skb as completed to BQL of the VND queue it was
+ * sent on. The completion is clamped to the bytes still outstanding, so
+ * a packet of a VND that has since been replaced cannot underflow the new
+ * one's counters.
+ */
+static void rmnet_vnd_bql_complete(struct sk_buff *skb)
+{
+	unsigned long arg = (unsigned long)skb_shinfo(skb)->destructor_arg;
+	struct rmnet_vnd_private_s *dev_conf;
+	struct netdev_queue *txq;
+	struct net_device *dev;
+	unsigned int len, inflight;
+	unsigned long flags;
+	u16 q;
+
+	rcu_read_lock();
+	dev = READ_ONCE(rmnet_devices[(arg >> RMNET_VND_BQL_ID_SHIFT) &
+				      RMNET_VND_BQL_ID_MASK]);
+	q = (arg >> RMNET_VND_BQL_TXQ_SHIFT) & RMNET_VND_BQL_TXQ_MASK;
+	if (!dev || q >= dev->real_num_tx_queues)
+		goto out;
+
+	dev_conf = (struct rmnet_vnd_private_s *)netdev_priv(dev);
+	txq = netdev_get_tx_queue(dev, q);
+
+	spin_lock_irqsave(&dev_conf->bql_lock, flags);
+	len = arg & RMNET_VND_BQL_LEN_MASK;
+#ifdef CONFIG_BQL
+	inflight = READ_ONCE(txq->dql.num_queued) - txq->dql.num_completed;
+	len = min(len, inflight);
+#endif
+	if (len)
+		netdev_tx_completed_queue(txq, 1, len);
+	spin_unlock_irqrestore(&dev_conf->bql_lock, flags);
+out:
+	rcu_read_unlock();
+}
+
+/* rmnet_vnd_bql_sent() - Account an uplink skb to BQL
+ * @skb:        Packet about to be given to the egress handler
+ * @dev:        Virtual network device
+ *
+ * The physical device frees the skb once the modem took it, which is the
+ * point BQL should consider it done. Zerocopy skbs already use
+ * destructor_arg and are not accounted.
+ */
+static void rmnet_vnd_bql_sent(struct sk_buff *skb, struct net_device *dev)
+{
+	struct rmnet_vnd_private_s *dev_conf = netdev_priv(dev);
+	u16 q = skb_get_queue_mapping(skb);
+
+	if (skb->len > RMNET_VND_BQL_LEN_MASK ||
+	    (skb_shinfo(skb)->tx_flags & SKBTX_DEV_ZEROCOPY))
+		return;
+
+	skb_shinfo(skb)->destructor_arg = (void *)(unsigned long)
+		(skb->len |
+		 ((unsigned long)dev_conf->id << RMNET_VND_BQL_ID_SHIFT) |
+		 ((unsigned long)q << RMNET_VND_BQL_TXQ_SHIFT));
+	skb->destructor = rmnet_vnd_bql_complete;
+	netdev_tx_sent_queue(netdev_get_tx_queue(dev, q), skb->len);
+}
+
 /* Network Device Operations */
 
 /* rmnet_vnd_start_xmit() - Transmit NDO callback
@@ -128,6 +231,7 @@ static netdev_tx_t rmnet_vnd_start_xmit(struct sk_buff *skb,
 						 dev,
 						 dev_conf->qos_version);
 		skb_orphan(skb);
+		rmnet_vnd_bql_sent(skb, dev);
 		rmnet_egress_handler(skb, &dev_conf->local_ep);
 	} else {
 		dev->stats.tx_dropped++;
@@ -136,6 +240,20 @@ static netdev_tx_t rmnet_vnd_start_xmit(struct sk_buff *skb,
 	return NETDEV_TX_OK;
 }
 
+/* rmnet_vnd_select_queue() - Select Tx queue NDO callback
+ * @dev:        Virtual network device
+ * @skb:        Socket buffer being sent
+ *
+ * Keeps every packet of a QoS flow on the queue MAP flow control for that
+ * flow acts on.
+ */
+static u16 rmnet_vnd_select_queue(struct net_device *dev, struct sk_buff *skb,
+				  void *accel_priv,
+				  select_queue_fallback_t fallback)
+{
+	return rmnet_vnd_flow_to_txq(dev, skb->mark);
+}
+
 /* rmnet_vnd_change_mtu() - Change MTU NDO callback
  * @dev:         Virtual network device
  * @new_mtu:     New MTU value to set (in bytes)
@@ -420,6 +538,7 @@ static int rmnet_vnd_ioctl(struct net_device *dev, struct ifreq *ifr, int cmd)
 static const struct net_device_ops rmnet_data_vnd_ops = {
 	.ndo_init = 0,
 	.ndo_start_xmit = rmnet_vnd_start_xmit,
+	.ndo_select_queue = rmnet_vnd_select_queue,
 	.ndo_do_ioctl = rmnet_vnd_ioctl,
 	.ndo_change_mtu = rmnet_vnd_change_mtu,
 	.ndo_set_mac_address = 0,
@@ -457,6 +576,7 @@ static void rmnet_vnd_setup(struct net_device *dev)
 	/* Flow control */
 	rwlock_init(&dev_conf->flow_map_lock);
 	INIT_LIST_HEAD(&dev_conf->flow_head);
+	spin_lock_init(&dev_conf->bql_lock);
 }
 
 /* rmnet_vnd_setup() - net_device initialization helper function
@@ -521,6 +641,7 @@ int rmnet_vnd_create_dev(int id, struct net_device **new_device,
 {
 	struct net_device *dev;
 	char dev_prefix[IFNAMSIZ];
+	unsigned int txqs;
 	int p, rc = 0;
 
 	if (id < 0 || id >= RMNET_DATA_MAX_VND) {
@@ -548,15 +669,17 @@ int rmnet_vnd_create_dev(int id, struct net_device **new_device,
 		return RMNET_CONFIG_BAD_ARGUMENTS;
 	}
 
-	dev = alloc_netdev(sizeof(struct rmnet_vnd_private_s),
-			   dev_prefix,
-			   use_name ? NET_NAME_UNKNOWN : NET_NAME_ENUM,
-			   rmnet_vnd_setup);
+	txqs = clamp_t(unsigned int, rmnet_vnd_txqs, 1, RMNET_VND_MAX_TXQS);
+	dev = alloc_netdev_mqs(sizeof(struct rmnet_vnd_private_s),
+			       dev_prefix,
+			       use_name ? NET_NAME_UNKNOWN : NET_NAME_ENUM,
+			       rmnet_vnd_setup, txqs, 1);
 	if (!dev) {
 		LOGE("Failed to to allocate netdev for id %d", id);
 		*new_device = 0;
 		return RMNET_CONFIG_NOMEM;
 	}
+	((struct rmnet_vnd_private_s *)netdev_priv(dev))->id = id;
 
 	if (!prefix) {
 		/* Configuring DL checksum offload on rmnet_data interfaces */
@@ -976,6 +1099,7 @@ int rmnet_vnd_do_flow_control(struct net_device *dev,
 {
 	struct rmnet_vnd_private_s *dev_conf;
 	struct rmnet_map_flow_mapping_s *itm;
+	struct netdev_queue *txq;
 	int do_fc, error, i;
 
 	error = 0;
@@ -998,6 +1122,18 @@ int rmnet_vnd_do_flow_control(struct net_device *dev,
 		goto nolookup;
 	}
 
+	/* With several Tx queues the flow has one of its own to stop */
+	if (dev->real_num_tx_queues > 1) {
+		txq = netdev_get_tx_queue(dev,
+					  rmnet_vnd_flow_to_txq(dev,
+								map_flow_id));
+		if (enable)
+			netif_tx_wake_queue(txq);
+		else
+			netif_tx_stop_queue(txq);
+		trace_rmnet_fc_map(map_flow_id, 0, enable);
+	}
+
 	itm = _rmnet_vnd_get_flow_map(dev_conf, map_flow_id);
 
 	if (!itm) {
@@ -1016,9 +1152,9 @@ int rmnet_vnd_do_flow_control(struct net_device *dev,
 			 * latency sensitive than enable
 			 */
 			if (unlikely(enable))
-				netif_wake_queue(dev);
+				netif_tx_wake_all_queues(dev);
 			else
-				netif_stop_queue(dev);
+				netif_tx_stop_all_queues(dev);
 			trace_rmnet_fc_map(0xFFFFFFFF, 0, enable);
 			goto fcdone;
 		}
@@ -123,6 +123,12 @@ enum rmnet_map_agg_state_e {
 	RMNET_MAP_TXFER_SCHEDULED
 };
 
+enum rmnet_map_ul_flow_class_e {
+	RMNET_MAP_UL_FLOW_BULK,
+	RMNET_MAP_UL_FLOW_ACK,
+	RMNET_MAP_UL_FLOW_INTERACTIVE
+};
+
 #define RMNET_MAP_COMMAND_REQUEST     0
 #define RMNET_MAP_COMMAND_ACK         1
 #define RMNET_MAP_COMMAND_UNSUPPORTED 2
@@ -140,7 +146,7 @@ struct rmnet_map_header_s *rmnet_map_add_map_header(struct sk_buff *skb,
 rx_handler_result_t rmnet_map_command(struct sk_buff *skb,
 				      struct rmnet_phys_ep_config *config);
 void rmnet_map_aggregate(struct sk_buff *skb,
-			 struct rmnet_phys_ep_config *config);
+			 struct rmnet_phys_ep_config *config, int offset);
 
 int rmnet_map_checksum_downlink_packet(struct sk_buff *skb);
 int rmnet_map_checksum_uplink_packet(struct sk_buff *skb,
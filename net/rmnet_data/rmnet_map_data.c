@@ -20,6 +20,7 @@
 #include <linux/spinlock.h>
 #include <linux/workqueue.h>
 #include <linux/time.h>
+#include <linux/math64.h>
 #include <linux/net_map.h>
 #include <linux/ip.h>
 #include <linux/ipv6.h>
@@ -48,14 +49,38 @@ long agg_bypass_time __read_mostly = 10000000L;
 module_param(agg_bypass_time, long, 0644);
 MODULE_PARM_DESC(agg_bypass_time, "Skip agg when apart spaced more than this");
 
+static bool agg_adaptive __read_mostly = 1;
+module_param(agg_adaptive, bool, 0644);
+MODULE_PARM_DESC(agg_adaptive, "Adapt UL aggregation to flow class / TX rate");
+
+long agg_time_min __read_mostly = 100000L;
+module_param(agg_time_min, long, 0644);
+MODULE_PARM_DESC(agg_time_min, "Minimum adaptive aggregation time limit");
+
+unsigned int agg_interactive_size __read_mostly = 256;
+module_param(agg_interactive_size, uint, 0644);
+MODULE_PARM_DESC(agg_interactive_size, "Max IP length of interactive packets");
+
+static bool deaggr_zero_copy __read_mostly = 1;
+module_param(deaggr_zero_copy, bool, 0644);
+MODULE_PARM_DESC(deaggr_zero_copy, "Build deaggregated skbs as page frags");
+
 struct agg_work {
 	struct work_struct work;
 	struct rmnet_phys_ep_config *config;
 };
 
+/* Length of the window the adaptive aggregation TX rate is sampled over */
+#define RMNET_MAP_AGG_RATE_WINDOW_NS 10000000LL
+
 #define RMNET_MAP_DEAGGR_SPACING  64
 #define RMNET_MAP_DEAGGR_HEADROOM (RMNET_MAP_DEAGGR_SPACING / 2)
 
+/* Bytes copied into the linear area of a frag based deaggregated skb. Covers
+ * the MAP header plus maximum length IPv4 and TCP headers.
+ */
+#define RMNET_MAP_DEAGGR_COPYBREAK 128
+
 /* rmnet_map_add_map_header() - Adds MAP header to front of skb->data
  * @skb:        Socket buffer ("packet") to modify
  * @hdrlen:     Number of bytes of header data which should not be included in
@@ -110,14 +135,56 @@ struct rmnet_map_header_s *rmnet_map_add_map_header(struct sk_buff *skb,
 	return map_header;
 }
 
+/* rmnet_map_deaggregate_frag() - Build a deaggregated skb without copying
+ * @skb:        Source socket buffer containing multiple MAP frames
+ * @packet_len: Length of the MAP frame at skb->data
+ *
+ * Only the first RMNET_MAP_DEAGGR_COPYBREAK bytes are copied into the new
+ * skb's linear area; the rest is attached as a page fragment pointing into
+ * the page backing the source skb's head.
+ *
+ * Return:
+ *     - Pointer to new skb
+ *     - 0 (null) if the skb could not be allocated
+ */
+static struct sk_buff *rmnet_map_deaggregate_frag(struct sk_buff *skb,
+						  u32 packet_len)
+{
+	struct sk_buff *skbn;
+	struct page *page;
+	unsigned int offset;
+	u32 frag_len;
+
+	skbn = alloc_skb(RMNET_MAP_DEAGGR_HEADROOM + RMNET_MAP_DEAGGR_COPYBREAK,
+			 GFP_ATOMIC);
+	if (!skbn)
+		return 0;
+
+	skb_reserve(skbn, RMNET_MAP_DEAGGR_HEADROOM);
+	memcpy(skb_put(skbn, RMNET_MAP_DEAGGR_COPYBREAK), skb->data,
+	       RMNET_MAP_DEAGGR_COPYBREAK);
+
+	page = virt_to_head_page(skb->head);
+	offset = skb->data + RMNET_MAP_DEAGGR_COPYBREAK -
+		 (unsigned char *)page_address(page);
+	frag_len = packet_len - RMNET_MAP_DEAGGR_COPYBREAK;
+
+	get_page(page);
+	skb_add_rx_frag(skbn, 0, page, offset, frag_len, frag_len);
+
+	return skbn;
+}
+
 /* rmnet_map_deaggregate() - Deaggregates a single packet
  * @skb:        Source socket buffer containing multiple MAP frames
  * @config:     Physical endpoint configuration of the ingress device
  *
- * A whole new buffer is allocated for each portion of an aggregated frame.
- * Caller should keep calling deaggregate() on the source skb until 0 is
- * returned, indicating that there are no more packets to deaggregate. Caller
- * is responsible for freeing the original skb.
+ * A new skb is created for each portion of an aggregated frame. Data frames
+ * larger than RMNET_MAP_DEAGGR_COPYBREAK in a page backed source are built
+ * as fragments of the source pages; everything else is copied into a whole
+ * new buffer. Caller should keep calling deaggregate() on the source skb
+ * until 0 is returned, indicating that there are no more packets to
+ * deaggregate. Caller is responsible for freeing the original skb.
  *
  * Return:
  *     - Pointer to new skb
@@ -145,14 +212,27 @@ struct sk_buff *rmnet_map_deaggregate(struct sk_buff *skb,
 		return 0;
 	}
 
-	skbn = alloc_skb(packet_len + RMNET_MAP_DEAGGR_SPACING, GFP_ATOMIC);
-	if (!skbn)
-		return 0;
+	if (deaggr_zero_copy && skb->head_frag && !maph->cd_bit &&
+	    packet_len > RMNET_MAP_DEAGGR_COPYBREAK &&
+	    skb_headlen(skb) >= packet_len) {
+		skbn = rmnet_map_deaggregate_frag(skb, packet_len);
+		if (!skbn)
+			return 0;
+
+		rmnet_stats_deagg_copy(RMNET_STATS_DEAGG_COPY_FREE);
+	} else {
+		skbn = alloc_skb(packet_len + RMNET_MAP_DEAGGR_SPACING,
+				 GFP_ATOMIC);
+		if (!skbn)
+			return 0;
+
+		skb_reserve(skbn, RMNET_MAP_DEAGGR_HEADROOM);
+		skb_put(skbn, packet_len);
+		memcpy(skbn->data, skb->data, packet_len);
+		rmnet_stats_deagg_copy(RMNET_STATS_DEAGG_COPY_FALLBACK);
+	}
 
 	skbn->dev = skb->dev;
-	skb_reserve(skbn, RMNET_MAP_DEAGGR_HEADROOM);
-	skb_put(skbn, packet_len);
-	memcpy(skbn->data, skb->data, packet_len);
 	skb_pull(skb, packet_len);
 
 	/* Some hardware can send us empty frames. Catch them */
@@ -165,6 +245,21 @@ struct sk_buff *rmnet_map_deaggregate(struct sk_buff *skb,
 	return skbn;
 }
 
+/* rmnet_map_agg_flush_stats() - Account an aggregate about to be sent
+ * @config:     Physical endpoint configuration holding the aggregate
+ *
+ * Must be called with agg_lock held and before agg_time is cleared.
+ */
+static void rmnet_map_agg_flush_stats(struct rmnet_phys_ep_config *config)
+{
+	struct timespec now, diff;
+
+	getnstimeofday(&now);
+	diff = timespec_sub(now, config->agg_time);
+	rmnet_stats_agg_flush(config->agg_skb->len, config->egress_agg_size,
+			      timespec_to_ns(&diff));
+}
+
 static void rmnet_map_flush_packet_work(struct work_struct *work)
 {
 	struct rmnet_phys_ep_config *config;
@@ -182,6 +277,7 @@ static void rmnet_map_flush_packet_work(struct work_struct *work)
 	if (likely(config->agg_state == RMNET_MAP_TXFER_SCHEDULED)) {
 		/* Buffer may have already been shipped out */
 		if (likely(config->agg_skb)) {
+			rmnet_map_agg_flush_stats(config);
 			rmnet_stats_agg_pkts(config->agg_count);
 			if (config->agg_count > 1)
 				LOGL("Agg count: %d", config->agg_count);
@@ -231,31 +327,154 @@ enum hrtimer_restart rmnet_map_flush_packet_queue(struct hrtimer *t)
 	return HRTIMER_NORESTART;
 }
 
+/* rmnet_map_ul_flow_class() - Classify an uplink packet for aggregation
+ * @skb:        Linear packet with MAP headers
+ * @offset:     Offset of the IP header from skb->data
+ *
+ * Return:
+ *      - RMNET_MAP_UL_FLOW_ACK for TCP packets carrying only an ACK
+ *      - RMNET_MAP_UL_FLOW_INTERACTIVE for other short packets
+ *      - RMNET_MAP_UL_FLOW_BULK for everything else
+ */
+static int rmnet_map_ul_flow_class(struct sk_buff *skb, int offset)
+{
+	unsigned char *packet_start = skb->data + offset;
+	unsigned int ip_len = skb->len - offset;
+	unsigned int hdr_len, payload_len = 0;
+	struct tcphdr *th = NULL;
+
+	if (ip_len < sizeof(struct iphdr))
+		return RMNET_MAP_UL_FLOW_INTERACTIVE;
+
+	if ((packet_start[0] >> 4) == 0x04) {
+		struct iphdr *ip4h = (struct iphdr *)packet_start;
+
+		hdr_len = ip4h->ihl * 4;
+		if (ip4h->protocol == IPPROTO_TCP &&
+		    !(ip4h->frag_off & htons(IP_MF | IP_OFFSET)) &&
+		    ip_len >= hdr_len + sizeof(struct tcphdr)) {
+			th = (struct tcphdr *)(packet_start + hdr_len);
+			payload_len = ntohs(ip4h->tot_len) - hdr_len;
+		}
+	} else if ((packet_start[0] >> 4) == 0x06) {
+		struct ipv6hdr *ip6h = (struct ipv6hdr *)packet_start;
+
+		hdr_len = sizeof(struct ipv6hdr);
+		if (ip6h->nexthdr == IPPROTO_TCP &&
+		    ip_len >= hdr_len + sizeof(struct tcphdr)) {
+			th = (struct tcphdr *)(packet_start + hdr_len);
+			payload_len = ntohs(ip6h->payload_len);
+		}
+	}
+
+	if (th && th->ack && !th->syn && !th->fin && !th->rst &&
+	    payload_len == th->doff * 4)
+		return RMNET_MAP_UL_FLOW_ACK;
+
+	if (ip_len <= agg_interactive_size)
+		return RMNET_MAP_UL_FLOW_INTERACTIVE;
+
+	return RMNET_MAP_UL_FLOW_BULK;
+}
+
+/* rmnet_map_agg_update_limits() - Adapt aggregation limits to the TX rate
+ * @config:     Physical endpoint configuration
+ * @len:        Length of the packet being offered for aggregation
+ *
+ * The TX rate is sampled over RMNET_MAP_AGG_RATE_WINDOW_NS and smoothed. The
+ * time limit is set to how long it takes to fill an aggregate at that rate,
+ * bounded by agg_time_min and agg_time_limit. The size limit is set to what
+ * is expected to arrive within that time, so slow uploads are not held for
+ * the whole time limit waiting on an aggregate that will never fill.
+ * Must be called with agg_lock held, after agg_last has been updated.
+ */
+static void rmnet_map_agg_update_limits(struct rmnet_phys_ep_config *config,
+					unsigned int len)
+{
+	struct timespec diff;
+	u64 rate, size;
+	s64 elapsed;
+
+	if (unlikely(!config->agg_cur_time_limit)) {
+		config->agg_rate_start = config->agg_last;
+		config->agg_rate_bytes = 0;
+		config->agg_cur_time_limit = agg_time_limit;
+		config->agg_cur_size = config->egress_agg_size;
+	}
+
+	config->agg_rate_bytes += len;
+	diff = timespec_sub(config->agg_last, config->agg_rate_start);
+	elapsed = timespec_to_ns(&diff);
+	if (elapsed < RMNET_MAP_AGG_RATE_WINDOW_NS)
+		return;
+
+	rate = div64_u64((u64)config->agg_rate_bytes * NSEC_PER_SEC, elapsed);
+	if (config->agg_rate)
+		config->agg_rate = (config->agg_rate * 3 + rate) >> 2;
+	else
+		config->agg_rate = rate;
+
+	config->agg_rate_start = config->agg_last;
+	config->agg_rate_bytes = 0;
+
+	rate = max_t(u64, config->agg_rate, 1);
+	config->agg_cur_time_limit = clamp_t(s64,
+		div64_u64((u64)config->egress_agg_size * NSEC_PER_SEC, rate),
+		agg_time_min, agg_time_limit);
+
+	size = div64_u64(rate * config->agg_cur_time_limit, NSEC_PER_SEC);
+	config->agg_cur_size = clamp_t(u64, size, config->egress_agg_size / 4,
+				       config->egress_agg_size);
+}
+
 /* rmnet_map_aggregate() - Software aggregates multiple packets.
  * @skb:        current packet being transmitted
  * @config:     Physical endpoint configuration of the ingress device
+ * @offset:     Offset of the IP header from skb->data
  *
  * Aggregates multiple SKBs into a single large SKB for transmission. MAP
  * protocol is used to separate the packets in the buffer. This function
  * consumes the argument SKB and should not be further processed by any other
  * function.
+ *
+ * With agg_adaptive set, pure TCP ACKs and short interactive packets are
+ * never held: they are appended to any pending aggregate, which is then sent
+ * immediately. Bulk packets are aggregated against the rate adapted limits
+ * from rmnet_map_agg_update_limits().
  */
 void rmnet_map_aggregate(struct sk_buff *skb,
-			 struct rmnet_phys_ep_config *config) {
+			 struct rmnet_phys_ep_config *config, int offset) {
 	u8 *dest_buff;
 	unsigned long flags;
 	struct sk_buff *agg_skb;
 	struct timespec diff, last;
 	int size, rc, agg_count = 0;
+	long time_limit = agg_time_limit;
+	unsigned int size_limit, rate_len;
+	bool flush_now = false;
 
 	if (!skb || !config)
 		return;
 
+	if (agg_adaptive)
+		flush_now = rmnet_map_ul_flow_class(skb, offset) !=
+			    RMNET_MAP_UL_FLOW_BULK;
+	rate_len = skb->len;
+
 new_packet:
 	spin_lock_irqsave(&config->agg_lock, flags);
 	memcpy(&last, &config->agg_last, sizeof(struct timespec));
 	getnstimeofday(&config->agg_last);
 
+	size_limit = config->egress_agg_size;
+	if (agg_adaptive) {
+		/* Only count the packet once if it is retried below */
+		rmnet_map_agg_update_limits(config, rate_len);
+		rate_len = 0;
+		time_limit = config->agg_cur_time_limit;
+		size_limit = config->agg_cur_size;
+	}
+
 	if (!config->agg_skb) {
 		/* Check to see if we should agg first. If the traffic is very
 		 * sparse, don't aggregate. We will need to tune this later
@@ -264,7 +483,7 @@ void rmnet_map_aggregate(struct sk_buff *skb,
 		size = config->egress_agg_size - skb->len;
 
 		if ((diff.tv_sec > 0) || (diff.tv_nsec > agg_bypass_time) ||
-		    (size <= 0)) {
+		    (size <= 0) || flush_now) {
 			spin_unlock_irqrestore(&config->agg_lock, flags);
 			LOGL("delta t: %ld.%09lu\tcount: bypass", diff.tv_sec,
 			     diff.tv_nsec);
@@ -298,9 +517,10 @@ void rmnet_map_aggregate(struct sk_buff *skb,
 	}
 	diff = timespec_sub(config->agg_last, config->agg_time);
 
-	if (skb->len > (config->egress_agg_size - config->agg_skb->len) ||
+	if (config->agg_skb->len + skb->len > size_limit ||
 	    (config->agg_count >= config->egress_agg_count) ||
-	    (diff.tv_sec > 0) || (diff.tv_nsec > agg_time_limit)) {
+	    (diff.tv_sec > 0) || (diff.tv_nsec > time_limit)) {
+		rmnet_map_agg_flush_stats(config);
 		rmnet_stats_agg_pkts(config->agg_count);
 		agg_skb = config->agg_skb;
 		agg_count = config->agg_count;
@@ -324,10 +544,30 @@ void rmnet_map_aggregate(struct sk_buff *skb,
 	config->agg_count++;
 	dev_kfree_skb_any(skb);
 
+	if (flush_now) {
+		/* Latency sensitive packet; do not hold it for the timer */
+		rmnet_map_agg_flush_stats(config);
+		rmnet_stats_agg_pkts(config->agg_count);
+		agg_skb = config->agg_skb;
+		agg_count = config->agg_count;
+		config->agg_skb = 0;
+		config->agg_count = 0;
+		memset(&config->agg_time, 0, sizeof(struct timespec));
+		config->agg_state = RMNET_MAP_AGG_IDLE;
+		spin_unlock_irqrestore(&config->agg_lock, flags);
+		hrtimer_cancel(&config->hrtimer);
+		trace_rmnet_map_aggregate(agg_skb, agg_count);
+		rc = dev_queue_xmit(agg_skb);
+		rmnet_stats_queue_xmit(rc,
+				       RMNET_STATS_QUEUE_XMIT_AGG_FLOW_FLUSH);
+		return;
+	}
+
 schedule:
 	if (config->agg_state != RMNET_MAP_TXFER_SCHEDULED) {
 		config->agg_state = RMNET_MAP_TXFER_SCHEDULED;
-		hrtimer_start(&config->hrtimer, ns_to_ktime(3000000),
+		hrtimer_start(&config->hrtimer,
+			      ns_to_ktime(agg_adaptive ? time_limit : 3000000),
 			      HRTIMER_MODE_REL);
 	}
 	spin_unlock_irqrestore(&config->agg_lock, flags);
@@ -581,7 +821,7 @@ static int rmnet_map_validate_ipv6_packet_checksum
  */
 int rmnet_map_checksum_downlink_packet(struct sk_buff *skb)
 {
-	struct rmnet_map_dl_checksum_trailer_s *cksum_trailer;
+	struct rmnet_map_dl_checksum_trailer_s *cksum_trailer, trailer_buf;
 	unsigned int data_len;
 	unsigned char *map_payload;
 	unsigned char ip_version;
@@ -592,9 +832,10 @@ int rmnet_map_checksum_downlink_packet(struct sk_buff *skb)
 	    sizeof(struct rmnet_map_dl_checksum_trailer_s))))
 		return RMNET_MAP_CHECKSUM_ERR_BAD_BUFFER;
 
-	cksum_trailer = (struct rmnet_map_dl_checksum_trailer_s *)
-			(skb->data + data_len
-			+ sizeof(struct rmnet_map_header_s));
+	/* The trailer sits in a page fragment for copy-free deaggregated skbs */
+	cksum_trailer = skb_header_pointer(skb, data_len +
+					   sizeof(struct rmnet_map_header_s),
+					   sizeof(trailer_buf), &trailer_buf);
 
 	if (unlikely(!ntohs(cksum_trailer->valid)))
 		return RMNET_MAP_CHECKSUM_VALID_FLAG_NOT_SET;
@@ -1173,6 +1173,33 @@ static inline void dst_cache_reset_now(struct dst_cache *dst_cache)
 #endif
 #endif
 
+#if LINUX_VERSION_CODE < KERNEL_VERSION(4, 11, 0) && LINUX_VERSION_CODE >= KERNEL_VERSION(4, 8, 0)
+#include <linux/ptr_ring.h>
+static inline int ptr_ring_consume_batched_bh(struct ptr_ring *r, void **array, int n)
+{
+	void *ptr;
+	int i;
+
+	spin_lock_bh(&r->consumer_lock);
+	for (i = 0; i < n; ++i) {
+		ptr = __ptr_ring_consume(r);
+		if (!ptr)
+			break;
+		array[i] = ptr;
+	}
+	spin_unlock_bh(&r->consumer_lock);
+	return i;
+}
+#endif
+
+#if defined(CONFIG_ARM64) && !defined(CONFIG_ARCH_SUPPORTS_INT128) && defined(__SIZEOF_INT128__)
+/* Older arm64 kernels never select this, even though the compiler's 128-bit
+ * multiplies map onto mul/umulh, which leaves Curve25519 and Poly1305 on the
+ * much slower 32-bit code.
+ */
+#define CONFIG_ARCH_SUPPORTS_INT128
+#endif
+
 /* https://github.com/ClangBuiltLinux/linux/issues/7 */
 #if defined( __clang__) && (!defined(CONFIG_CLANG_VERSION) || CONFIG_CLANG_VERSION < 80000)
 #include <linux/bug.h>
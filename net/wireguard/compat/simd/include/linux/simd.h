@@ -7,6 +7,7 @@
 #define _WG_SIMD_H
 
 #include <linux/sched.h>
+#include <linux/version.h>
 #include <asm/simd.h>
 #if defined(CONFIG_X86_64)
 #include <asm/fpu/api.h>
@@ -22,9 +23,23 @@ typedef enum {
 
 #define DONT_USE_SIMD ((simd_context_t []){ HAVE_NO_SIMD })
 
+static inline bool simd_may_use(void)
+{
+#if defined(CONFIG_ARM64) && defined(CONFIG_KERNEL_MODE_NEON) && LINUX_VERSION_CODE < KERNEL_VERSION(4, 15, 0)
+	/* These kernels fall back to the generic may_use_simd(), which refuses
+	 * anything in_interrupt(), even though kernel_neon_begin() keeps a
+	 * separate per-cpu save area for softirq context. Allow softirq so
+	 * that the NAPI and BH-disabled crypto paths still get NEON.
+	 */
+	return !in_irq() && !in_nmi();
+#else
+	return may_use_simd();
+#endif
+}
+
 static inline void simd_get(simd_context_t *ctx)
 {
-	*ctx = !IS_ENABLED(CONFIG_PREEMPT_RT) && !IS_ENABLED(CONFIG_PREEMPT_RT_BASE) && may_use_simd() ? HAVE_FULL_SIMD : HAVE_NO_SIMD;
+	*ctx = !IS_ENABLED(CONFIG_PREEMPT_RT) && !IS_ENABLED(CONFIG_PREEMPT_RT_BASE) && simd_may_use() ? HAVE_FULL_SIMD : HAVE_NO_SIMD;
 }
 
 static inline void simd_put(simd_context_t *ctx)
@@ -19,6 +19,9 @@
 #include <linux/if_arp.h>
 #include <linux/icmp.h>
 #include <linux/suspend.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/math64.h>
 #include <net/dst_metadata.h>
 #include <net/icmp.h>
 #include <net/rtnetlink.h>
@@ -253,6 +256,7 @@ static void wg_destruct(struct net_device *dev)
 	rcu_barrier(); /* Wait for all the peers to be actually freed. */
 	wg_ratelimiter_uninit();
 	memzero_explicit(&wg->static_identity, sizeof(wg->static_identity));
+	free_percpu(wg->queue_latency);
 	free_percpu(dev->tstats);
 	kvfree(wg->index_hashtable);
 	kvfree(wg->peer_hashtable);
@@ -332,10 +336,14 @@ static int wg_newlink(struct net *src_net, struct net_device *dev,
 	if (!dev->tstats)
 		goto err_free_index_hashtable;
 
+	wg->queue_latency = alloc_percpu(struct wg_queue_latency);
+	if (!wg->queue_latency)
+		goto err_free_tstats;
+
 	wg->handshake_receive_wq = alloc_workqueue("wg-kex-%s",
 			WQ_CPU_INTENSIVE | WQ_FREEZABLE, 0, dev->name);
 	if (!wg->handshake_receive_wq)
-		goto err_free_tstats;
+		goto err_free_queue_latency;
 
 	wg->handshake_send_wq = alloc_workqueue("wg-kex-%s",
 			WQ_UNBOUND | WQ_FREEZABLE, 0, dev->name);
@@ -394,6 +402,8 @@ static int wg_newlink(struct net *src_net, struct net_device *dev,
 	destroy_workqueue(wg->handshake_send_wq);
 err_destroy_handshake_receive:
 	destroy_workqueue(wg->handshake_receive_wq);
+err_free_queue_latency:
+	free_percpu(wg->queue_latency);
 err_free_tstats:
 	free_percpu(dev->tstats);
 err_free_index_hashtable:
@@ -435,6 +445,77 @@ static struct pernet_operations pernet_ops = {
 	.pre_exit = wg_netns_pre_exit
 };
 
+#ifdef CONFIG_DEBUG_FS
+static const char * const wg_queue_stage_names[WG_QUEUE_STAGE_COUNT] = {
+	[WG_QUEUE_ENCRYPT] = "encrypt",
+	[WG_QUEUE_TX] = "tx",
+	[WG_QUEUE_DECRYPT] = "decrypt",
+	[WG_QUEUE_RX] = "rx"
+};
+
+static struct dentry *wg_debugfs_dir;
+
+static int wg_queue_latency_show(struct seq_file *s, void *unused)
+{
+	struct wg_device *wg;
+	int stage, cpu;
+
+	rtnl_lock();
+	list_for_each_entry(wg, &device_list, device_list) {
+		seq_printf(s, "%s:\n", wg->dev->name);
+		for (stage = 0; stage < WG_QUEUE_STAGE_COUNT; ++stage) {
+			u64 total = 0, max = 0, count = 0;
+
+			for_each_possible_cpu(cpu) {
+				struct wg_queue_latency *lat =
+					per_cpu_ptr(wg->queue_latency, cpu);
+
+				total += lat->stage[stage].total_ns;
+				count += lat->stage[stage].count;
+				max = max_t(u64, max, lat->stage[stage].max_ns);
+			}
+			seq_printf(s, "  %-8s count %llu avg %llu ns max %llu ns\n",
+				   wg_queue_stage_names[stage], count,
+				   count ? div64_u64(total, count) : 0, max);
+		}
+	}
+	rtnl_unlock();
+	return 0;
+}
+
+static int wg_queue_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wg_queue_latency_show, NULL);
+}
+
+static const struct file_operations wg_queue_latency_fops = {
+	.open		= wg_queue_latency_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void wg_debugfs_init(void)
+{
+	wg_debugfs_dir = debugfs_create_dir(KBUILD_MODNAME, NULL);
+	if (IS_ERR_OR_NULL(wg_debugfs_dir)) {
+		wg_debugfs_dir = NULL;
+		return;
+	}
+	debugfs_create_file("queue_latency", 0400, wg_debugfs_dir, NULL,
+			    &wg_queue_latency_fops);
+}
+
+static void wg_debugfs_uninit(void)
+{
+	debugfs_remove_recursive(wg_debugfs_dir);
+	wg_debugfs_dir = NULL;
+}
+#else
+static inline void wg_debugfs_init(void) { }
+static inline void wg_debugfs_uninit(void) { }
+#endif
+
 int __init wg_device_init(void)
 {
 	int ret;
@@ -453,6 +534,7 @@ int __init wg_device_init(void)
 	if (ret)
 		goto error_pernet;
 
+	wg_debugfs_init();
 	return 0;
 
 error_pernet:
@@ -466,6 +548,7 @@ int __init wg_device_init(void)
 
 void wg_device_uninit(void)
 {
+	wg_debugfs_uninit();
 	rtnl_link_unregister(&link_ops);
 	unregister_pernet_device(&pernet_ops);
 #ifdef CONFIG_PM_SLEEP
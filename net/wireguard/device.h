@@ -37,6 +37,20 @@ struct prev_queue {
 	atomic_t count;
 };
 
+enum wg_queue_stage {
+	WG_QUEUE_ENCRYPT, /* Waiting in the device encrypt queue. */
+	WG_QUEUE_TX, /* Encrypted, waiting for in-order transmission. */
+	WG_QUEUE_DECRYPT, /* Waiting in the device decrypt queue. */
+	WG_QUEUE_RX, /* Decrypted, waiting for in-order reception. */
+	WG_QUEUE_STAGE_COUNT
+};
+
+struct wg_queue_latency {
+	struct {
+		u64 total_ns, max_ns, count;
+	} stage[WG_QUEUE_STAGE_COUNT];
+};
+
 struct wg_device {
 	struct net_device *dev;
 	struct crypt_queue encrypt_queue, decrypt_queue, handshake_queue;
@@ -48,6 +62,7 @@ struct wg_device {
 	struct pubkey_hashtable *peer_hashtable;
 	struct index_hashtable *index_hashtable;
 	struct allowedips peer_allowedips;
+	struct wg_queue_latency __percpu *queue_latency;
 	struct mutex device_update_lock, socket_update_lock;
 	struct list_head device_list, peer_list;
 	atomic_t handshake_queue_len;
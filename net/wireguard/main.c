@@ -33,7 +33,7 @@ static int __init wg_mod_init(void)
 #ifdef DEBUG
 	ret = -ENOTRECOVERABLE;
 	if (!wg_allowedips_selftest() || !wg_packet_counter_selftest() ||
-	    !wg_ratelimiter_selftest())
+	    !wg_ratelimiter_selftest() || !wg_crypto_selftest())
 		goto err_peer;
 #endif
 	wg_noise_init();
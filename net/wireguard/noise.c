@@ -828,3 +828,5 @@ bool wg_noise_handshake_begin_session(struct noise_handshake *handshake,
 	up_write(&handshake->lock);
 	return ret;
 }
+
+#include "selftest/crypto.c"
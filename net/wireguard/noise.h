@@ -132,4 +132,8 @@ wg_noise_handshake_consume_response(struct message_handshake_response *src,
 bool wg_noise_handshake_begin_session(struct noise_handshake *handshake,
 				      struct noise_keypairs *keypairs);
 
+#ifdef DEBUG
+bool wg_crypto_selftest(void);
+#endif
+
 #endif /* _WG_NOISE_H */
@@ -5,6 +5,36 @@
 
 #include "queueing.h"
 #include <linux/skb_array.h>
+#include <linux/moduleparam.h>
+
+struct cpumask wg_crypt_cpus;
+
+static int crypt_cpus_set(const char *val, const struct kernel_param *kp)
+{
+	cpumask_var_t mask;
+	int ret;
+
+	if (!alloc_cpumask_var(&mask, GFP_KERNEL))
+		return -ENOMEM;
+	ret = cpulist_parse(val, mask);
+	if (!ret)
+		cpumask_copy(&wg_crypt_cpus, mask);
+	free_cpumask_var(mask);
+	return ret;
+}
+
+static int crypt_cpus_get(char *buffer, const struct kernel_param *kp)
+{
+	return scnprintf(buffer, PAGE_SIZE, "%*pbl\n",
+			 cpumask_pr_args(&wg_crypt_cpus));
+}
+
+static const struct kernel_param_ops crypt_cpus_ops = {
+	.set = crypt_cpus_set,
+	.get = crypt_cpus_get,
+};
+module_param_cb(crypt_cpus, &crypt_cpus_ops, NULL, 0644);
+MODULE_PARM_DESC(crypt_cpus, "CPU list for the encryption and decryption workers (empty: all online CPUs)");
 
 struct multicore_worker __percpu *
 wg_packet_percpu_multicore_worker_alloc(work_func_t function, void *ptr)
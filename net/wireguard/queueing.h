@@ -11,6 +11,8 @@
 #include <linux/skbuff.h>
 #include <linux/ip.h>
 #include <linux/ipv6.h>
+#include <linux/cpumask.h>
+#include <linux/ktime.h>
 #include <net/ip_tunnels.h>
 
 struct wg_device;
@@ -58,6 +60,7 @@ enum packet_state {
 
 struct packet_cb {
 	u64 nonce;
+	u64 stamp_ns;
 	struct noise_keypair *keypair;
 	atomic_t state;
 	u32 mtu;
@@ -122,6 +125,25 @@ static inline int wg_cpumask_choose_online(int *stored_cpu, unsigned int id)
 	return cpu;
 }
 
+/* Accounts the time since the packet was stamped to the given queueing stage
+ * and stamps it again for the next one.
+ */
+static inline void wg_queue_latency_account(struct wg_device *wg,
+					    struct sk_buff *skb,
+					    enum wg_queue_stage stage)
+{
+	struct wg_queue_latency *latency;
+	u64 now = ktime_get_ns(), delta = now - PACKET_CB(skb)->stamp_ns;
+
+	latency = get_cpu_ptr(wg->queue_latency);
+	latency->stage[stage].total_ns += delta;
+	if (delta > latency->stage[stage].max_ns)
+		latency->stage[stage].max_ns = delta;
+	++latency->stage[stage].count;
+	put_cpu_ptr(wg->queue_latency);
+	PACKET_CB(skb)->stamp_ns = now;
+}
+
 /* This function is racy, in the sense that next is unlocked, so it could return
  * the same CPU twice. A race-free version of this would be to instead store an
  * atomic sequence number, do an increment-and-return, and then iterate through
@@ -139,6 +161,33 @@ static inline int wg_cpumask_next_online(int *next)
 	return cpu;
 }
 
+/* CPUs allowed to run the encryption and decryption workers, as set with the
+ * crypt_cpus module parameter. An empty mask means every online CPU. The mask
+ * may be rewritten while it is read, which can only make a pick below fall
+ * back to the full online mask.
+ */
+extern struct cpumask wg_crypt_cpus;
+
+/* Like wg_cpumask_next_online, but round-robins over wg_crypt_cpus, so that on
+ * asymmetric systems the crypto can be kept off the CPUs that run the NIC's
+ * NAPI polling, or on the big cores.
+ */
+static inline int wg_cpumask_next_crypt(int *next)
+{
+	int cpu;
+
+	if (cpumask_empty(&wg_crypt_cpus))
+		return wg_cpumask_next_online(next);
+
+	cpu = cpumask_next_and(*next - 1, &wg_crypt_cpus, cpu_online_mask);
+	if (cpu >= nr_cpu_ids)
+		cpu = cpumask_first_and(&wg_crypt_cpus, cpu_online_mask);
+	if (unlikely(cpu >= nr_cpu_ids))
+		return wg_cpumask_next_online(next);
+	*next = (cpu + 1) % nr_cpumask_bits;
+	return cpu;
+}
+
 void wg_prev_queue_init(struct prev_queue *queue);
 
 /* Multi producer */
@@ -169,6 +218,7 @@ static inline int wg_queue_enqueue_per_device_and_peer(
 	int cpu;
 
 	atomic_set_release(&PACKET_CB(skb)->state, PACKET_STATE_UNCRYPTED);
+	PACKET_CB(skb)->stamp_ns = ktime_get_ns();
 	/* We first queue this up for the peer ingestion, but the consumer
 	 * will wait for the state to change to CRYPTED or DEAD before.
 	 */
@@ -178,7 +228,7 @@ static inline int wg_queue_enqueue_per_device_and_peer(
 	/* Then we queue it up in the device queue, which consumes the
 	 * packet as soon as it can.
 	 */
-	cpu = wg_cpumask_next_online(next_cpu);
+	cpu = wg_cpumask_next_crypt(next_cpu);
 	if (unlikely(ptr_ring_produce_bh(&device_queue->ring, skb)))
 		return -EPIPE;
 	queue_work_on(cpu, wq, &per_cpu_ptr(device_queue->worker, cpu)->work);
@@ -247,14 +247,8 @@ static void keep_key_fresh(struct wg_peer *peer)
 	}
 }
 
-static bool decrypt_packet(struct sk_buff *skb, struct noise_keypair *keypair,
-			   simd_context_t *simd_context)
+static bool keypair_can_receive(struct noise_keypair *keypair)
 {
-	struct scatterlist sg[MAX_SKB_FRAGS + 8];
-	struct sk_buff *trailer;
-	unsigned int offset;
-	int num_frags;
-
 	if (unlikely(!keypair))
 		return false;
 
@@ -264,6 +258,17 @@ static bool decrypt_packet(struct sk_buff *skb, struct noise_keypair *keypair,
 		WRITE_ONCE(keypair->receiving.is_valid, false);
 		return false;
 	}
+	return true;
+}
+
+/* The keypair must have been checked with keypair_can_receive. */
+static bool decrypt_packet(struct sk_buff *skb, struct noise_keypair *keypair,
+			   simd_context_t *simd_context)
+{
+	struct scatterlist sg[MAX_SKB_FRAGS + 8];
+	struct sk_buff *trailer;
+	unsigned int offset;
+	int num_frags;
 
 	PACKET_CB(skb)->nonce =
 		le64_to_cpu(((struct message_data *)skb->data)->counter);
@@ -466,6 +471,7 @@ int wg_packet_rx_poll(struct napi_struct *napi, int budget)
 		wg_prev_queue_drop_peeked(&peer->rx_queue);
 		keypair = PACKET_CB(skb)->keypair;
 		free = true;
+		wg_queue_latency_account(peer->device, skb, WG_QUEUE_RX);
 
 		if (unlikely(state != PACKET_STATE_CRYPTED))
 			goto next;
@@ -502,21 +508,59 @@ int wg_packet_rx_poll(struct napi_struct *napi, int budget)
 	return work_done;
 }
 
+#define DECRYPT_BATCH 16
+
 void wg_packet_decrypt_worker(struct work_struct *work)
 {
 	struct crypt_queue *queue = container_of(work, struct multicore_worker,
 						 work)->ptr;
+	struct wg_device *wg = container_of(queue, struct wg_device, decrypt_queue);
+	struct sk_buff *batch[DECRYPT_BATCH];
+	struct noise_keypair *keypair;
+	struct wg_peer *peer;
 	simd_context_t simd_context;
-	struct sk_buff *skb;
+	enum packet_state state;
+	bool can_receive = false;
+	int i, n;
 
 	simd_get(&simd_context);
-	while ((skb = ptr_ring_consume_bh(&queue->ring)) != NULL) {
-		enum packet_state state =
-			likely(decrypt_packet(skb, PACKET_CB(skb)->keypair,
-					      &simd_context)) ?
+	while ((n = ptr_ring_consume_batched_bh(&queue->ring, (void **)batch,
+						ARRAY_SIZE(batch))) > 0) {
+		keypair = NULL;
+		peer = NULL;
+		for (i = 0; i < n; ++i) {
+			struct sk_buff *skb = batch[i];
+
+			wg_queue_latency_account(wg, skb, WG_QUEUE_DECRYPT);
+
+			/* Runs of packets from the same keypair are the common
+			 * case, so only validate the keypair once per run and
+			 * only kick the peer's NAPI once the run is over.
+			 */
+			if (PACKET_CB(skb)->keypair != keypair) {
+				keypair = PACKET_CB(skb)->keypair;
+				can_receive = keypair_can_receive(keypair);
+			}
+			if (PACKET_PEER(skb) != peer) {
+				if (peer) {
+					napi_schedule(&peer->napi);
+					wg_peer_put(peer);
+				}
+				/* We take a reference, because as soon as we
+				 * call atomic_set, the peer can be freed from
+				 * below us.
+				 */
+				peer = wg_peer_get(PACKET_PEER(skb));
+			}
+			state = likely(can_receive &&
+				       decrypt_packet(skb, keypair, &simd_context)) ?
 				PACKET_STATE_CRYPTED : PACKET_STATE_DEAD;
-		wg_queue_enqueue_per_peer_rx(skb, state);
-		simd_relax(&simd_context);
+			PACKET_CB(skb)->stamp_ns = ktime_get_ns();
+			atomic_set_release(&PACKET_CB(skb)->state, state);
+			simd_relax(&simd_context);
+		}
+		napi_schedule(&peer->napi);
+		wg_peer_put(peer);
 	}
 
 	simd_put(&simd_context);
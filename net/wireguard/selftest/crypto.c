@@ -0,0 +1,178 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (C) 2015-2019 Jason A. Donenfeld <Jason@zx2c4.com>. All Rights Reserved.
+ */
+
+#ifdef DEBUG
+
+#include <linux/cpufreq.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/moduleparam.h>
+#include <linux/random.h>
+
+static bool crypto_bench __initdata;
+module_param(crypto_bench, bool, 0);
+MODULE_PARM_DESC(crypto_bench, "Print cycles per byte of the scalar and SIMD crypto at load");
+
+static const size_t crypto_selftest_lens[] __initconst = { 64, 576, 1420 };
+
+enum { CRYPTO_BENCH_BYTES = 1 << 20, CRYPTO_BENCH_DH_OPS = 64 };
+
+/* get_cycles() is the architected timer on arm64 and ticks far slower than
+ * the core, so derive cycles from the wall time and the current frequency.
+ */
+static u64 __init crypto_bench_cycles(u64 ns)
+{
+	unsigned int khz = cpufreq_quick_get(raw_smp_processor_id());
+
+	return khz ? div_u64(ns * khz, 1000000) : 0;
+}
+
+static void __init crypto_bench_report(const char *name, const char *impl,
+				       size_t len, u64 ns, u64 bytes)
+{
+	u64 cycles = crypto_bench_cycles(ns), hundredths;
+
+	if (!cycles) {
+		pr_info("%s bench %s %zu: %llu ns/MiB\n", name, impl, len,
+			div64_u64(ns << 20, bytes));
+		return;
+	}
+	hundredths = div64_u64(cycles * 100, bytes);
+	pr_info("%s bench %s %zu: %llu.%02llu cycles/byte\n", name, impl, len,
+		hundredths / 100, hundredths % 100);
+}
+
+static u64 __init crypto_bench_aead(u8 *buf, size_t len, const u8 *key,
+				    bool use_simd, u64 *bytes)
+{
+	simd_context_t simd_context;
+	struct scatterlist sg;
+	u64 start, nonce = 0;
+	size_t done;
+
+	sg_init_one(&sg, buf, len + CHACHA20POLY1305_AUTHTAG_SIZE);
+	if (use_simd)
+		simd_get(&simd_context);
+	else
+		simd_context = HAVE_NO_SIMD;
+	start = ktime_get_ns();
+	for (done = 0; done < CRYPTO_BENCH_BYTES; done += len) {
+		if (!chacha20poly1305_encrypt_sg_inplace(&sg, len, NULL, 0,
+							 nonce++, key,
+							 &simd_context))
+			break;
+		simd_relax(&simd_context);
+	}
+	simd_put(&simd_context);
+	*bytes = done;
+	return ktime_get_ns() - start;
+}
+
+static void __init crypto_bench_dh(void)
+{
+	u8 secret[CURVE25519_KEY_SIZE], pub[CURVE25519_KEY_SIZE];
+	u64 start, ns, cycles;
+	unsigned int i;
+
+	curve25519_generate_secret(secret);
+	start = ktime_get_ns();
+	for (i = 0; i < CRYPTO_BENCH_DH_OPS; ++i) {
+		if (!curve25519_generate_public(pub, secret))
+			break;
+		secret[1] ^= pub[1];
+	}
+	ns = ktime_get_ns() - start;
+	memzero_explicit(secret, sizeof(secret));
+	if (!i)
+		return;
+	cycles = crypto_bench_cycles(ns);
+	if (cycles)
+		pr_info("curve25519 bench: %llu cycles/op\n", div_u64(cycles, i));
+	else
+		pr_info("curve25519 bench: %llu ns/op\n", div_u64(ns, i));
+}
+
+/* The SIMD and scalar paths are only selected by the simd_context_t handed to
+ * the AEAD, so encrypt the same data both ways, make sure that they agree and
+ * that the result decrypts back to the plaintext.
+ */
+bool __init wg_crypto_selftest(void)
+{
+	const size_t max_len = 1420 + CHACHA20POLY1305_AUTHTAG_SIZE;
+	u8 key[CHACHA20POLY1305_KEY_SIZE];
+	simd_context_t simd_context;
+	u8 *plain, *scalar, *simd;
+	struct scatterlist sg;
+	bool success = true;
+	u64 ns, bytes;
+	unsigned int i;
+
+	plain = kmalloc(max_len * 3, GFP_KERNEL);
+	if (unlikely(!plain)) {
+		pr_err("crypto self-test malloc: FAIL\n");
+		return false;
+	}
+	scalar = plain + max_len;
+	simd = scalar + max_len;
+	get_random_bytes(key, sizeof(key));
+	get_random_bytes(plain, max_len);
+
+	for (i = 0; i < ARRAY_SIZE(crypto_selftest_lens); ++i) {
+		size_t len = crypto_selftest_lens[i];
+
+		memcpy(scalar, plain, len);
+		sg_init_one(&sg, scalar, len + CHACHA20POLY1305_AUTHTAG_SIZE);
+		success &= chacha20poly1305_encrypt_sg_inplace(&sg, len, NULL, 0,
+							       i, key,
+							       DONT_USE_SIMD);
+
+		memcpy(simd, plain, len);
+		sg_init_one(&sg, simd, len + CHACHA20POLY1305_AUTHTAG_SIZE);
+		simd_get(&simd_context);
+		success &= chacha20poly1305_encrypt_sg_inplace(&sg, len, NULL, 0,
+							       i, key,
+							       &simd_context);
+		simd_put(&simd_context);
+
+		if (memcmp(scalar, simd, len + CHACHA20POLY1305_AUTHTAG_SIZE)) {
+			pr_err("crypto self-test %zu: FAIL\n", len);
+			success = false;
+			continue;
+		}
+
+		simd_get(&simd_context);
+		success &= chacha20poly1305_decrypt_sg_inplace(
+			&sg, len + CHACHA20POLY1305_AUTHTAG_SIZE, NULL, 0, i,
+			key, &simd_context);
+		simd_put(&simd_context);
+		if (memcmp(simd, plain, len)) {
+			pr_err("crypto self-test %zu decrypt: FAIL\n", len);
+			success = false;
+		}
+	}
+	if (success)
+		pr_info("crypto self-tests: pass\n");
+
+	if (success && crypto_bench) {
+		for (i = 0; i < ARRAY_SIZE(crypto_selftest_lens); ++i) {
+			size_t len = crypto_selftest_lens[i];
+
+			ns = crypto_bench_aead(scalar, len, key, false, &bytes);
+			if (bytes)
+				crypto_bench_report("chacha20poly1305", "scalar",
+						    len, ns, bytes);
+			ns = crypto_bench_aead(simd, len, key, true, &bytes);
+			if (bytes)
+				crypto_bench_report("chacha20poly1305", "simd",
+						    len, ns, bytes);
+		}
+		crypto_bench_dh();
+	}
+
+	memzero_explicit(key, sizeof(key));
+	kfree(plain);
+	return success;
+}
+#endif
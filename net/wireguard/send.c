@@ -274,6 +274,7 @@ void wg_packet_tx_worker(struct work_struct *work)
 		       PACKET_STATE_UNCRYPTED) {
 		wg_prev_queue_drop_peeked(&peer->tx_queue);
 		keypair = PACKET_CB(first)->keypair;
+		wg_queue_latency_account(peer->device, first, WG_QUEUE_TX);
 
 		if (likely(state == PACKET_STATE_CRYPTED))
 			wg_packet_create_data_done(peer, first);
@@ -291,6 +292,7 @@ void wg_packet_encrypt_worker(struct work_struct *work)
 {
 	struct crypt_queue *queue = container_of(work, struct multicore_worker,
 						 work)->ptr;
+	struct wg_device *wg = container_of(queue, struct wg_device, encrypt_queue);
 	struct sk_buff *first, *skb, *next;
 	simd_context_t simd_context;
 
@@ -298,6 +300,7 @@ void wg_packet_encrypt_worker(struct work_struct *work)
 	while ((first = ptr_ring_consume_bh(&queue->ring)) != NULL) {
 		enum packet_state state = PACKET_STATE_CRYPTED;
 
+		wg_queue_latency_account(wg, first, WG_QUEUE_ENCRYPT);
 		skb_list_walk_safe(first, skb, next) {
 			if (likely(encrypt_packet(skb,
 						  PACKET_CB(first)->keypair,
@@ -308,6 +311,7 @@ void wg_packet_encrypt_worker(struct work_struct *work)
 				break;
 			}
 		}
+		PACKET_CB(first)->stamp_ns = ktime_get_ns();
 		wg_queue_enqueue_per_peer_tx(first, state);
 
 		simd_relax(&simd_context);
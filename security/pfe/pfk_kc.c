@@ -21,6 +21,8 @@
  * cache eviction are simple, linear and based on last usage timestamp, i.e
  * the node that will be evicted is the one with the oldest timestamp.
  * Empty entries always have the oldest timestamp.
+ * The timestamp is a sequence number bumped on every use rather than jiffies,
+ * so that the order stays exact for keys used within the same tick.
  */
 
 #include <linux/module.h>
@@ -33,6 +35,9 @@
 #include <linux/slab.h>
 #include <linux/printk.h>
 #include <linux/sched.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "pfk_kc.h"
 #include "pfk_ice.h"
@@ -54,10 +59,39 @@
 #define PFK_MAX_SALT_SIZE PFK_KC_SALT_SIZE
 #define PFK_UFS "ufs"
 
+/** Number of log2 microsecond buckets in the key load latency histogram */
+#define PFK_KC_LAT_BUCKETS 16
+
 static DEFINE_SPINLOCK(kc_lock);
 static unsigned long flags;
 static bool kc_ready;
 static char *s_type = "sdcc";
+static u64 kc_lru_clock;
+
+/**
+ * struct kc_stats - key cache statistics, protected by kc_lock
+ *
+ * @hits:	lookups that found the key already loaded in ICE
+ * @misses:	lookups that had to load the key to ICE
+ * @evictions:	misses that replaced another, inactive, key
+ * @deferred:	misses from atomic context, retried by the caller
+ * @busy:	misses that found every entry in use
+ * @scm_errors:	key loads that failed in QSEE
+ * @lat_hist:	key load latency, bucket i counts loads below 2^i us
+ * @lat_max_us:	slowest key load
+ */
+static struct kc_stats {
+	u64 hits;
+	u64 misses;
+	u64 evictions;
+	u64 deferred;
+	u64 busy;
+	u64 scm_errors;
+	u64 lat_hist[PFK_KC_LAT_BUCKETS];
+	u64 lat_max_us;
+} kc_stats;
+
+static struct dentry *kc_debugfs;
 
 /**
  * enum pfk_kc_entry_state - state of the entry inside kc table
@@ -360,7 +394,7 @@ static void kc_update_timestamp(struct kc_entry *entry)
 	if (!entry)
 		return;
 
-	entry->time_stamp = get_jiffies_64();
+	entry->time_stamp = ++kc_lru_clock;
 }
 
 /**
@@ -409,8 +443,12 @@ static int kc_update_entry(struct kc_entry *entry, const unsigned char *key,
 	size_t key_size, const unsigned char *salt, size_t salt_size,
 	unsigned int data_unit, int ice_rev)
 {
+	ktime_t start;
+	u64 lat_us;
 	int ret;
 
+	if (entry->state == INACTIVE)
+		kc_stats.evictions++;
 	kc_clear_entry(entry);
 
 	memcpy(entry->key, key, key_size);
@@ -423,10 +461,18 @@ static int kc_update_entry(struct kc_entry *entry, const unsigned char *key,
 	entry->state = ACTIVE_ICE_PRELOAD;
 	kc_spin_unlock();
 
+	start = ktime_get();
 	ret = qti_pfk_ice_set_key(entry->key_index, entry->key,
 			entry->salt, s_type, data_unit, ice_rev);
+	lat_us = ktime_us_delta(ktime_get(), start);
 
 	kc_spin_lock();
+	kc_stats.lat_hist[min_t(int, fls64(lat_us),
+				PFK_KC_LAT_BUCKETS - 1)]++;
+	if (lat_us > kc_stats.lat_max_us)
+		kc_stats.lat_max_us = lat_us;
+	if (ret)
+		kc_stats.scm_errors++;
 	return ret;
 }
 
@@ -520,6 +566,7 @@ int pfk_kc_load_key_start(const unsigned char *key, size_t key_size,
 	if (!entry) {
 		if (async) {
 			pr_debug("%s task will populate entry\n", __func__);
+			kc_stats.deferred++;
 			kc_spin_unlock();
 			return -EAGAIN;
 		}
@@ -530,11 +577,16 @@ int pfk_kc_load_key_start(const unsigned char *key, size_t key_size,
 			 * return EBUSY to upper layers so that the
 			 * request will be rescheduled
 			 */
+			kc_stats.busy++;
 			kc_spin_unlock();
 			return -EBUSY;
 		}
+		kc_stats.misses++;
 	} else {
 		entry_exists = true;
+		if (entry->state == INACTIVE ||
+		    entry->state == ACTIVE_ICE_LOADED)
+			kc_stats.hits++;
 	}
 
 	pr_debug("entry with index %d is in state %d\n",
@@ -885,6 +937,41 @@ void pfk_kc_clear_on_reset(void)
 	kc_spin_unlock();
 }
 
+static int pfk_kc_stats_show(struct seq_file *s, void *unused)
+{
+	struct kc_stats stats;
+	int i;
+
+	kc_spin_lock();
+	stats = kc_stats;
+	kc_spin_unlock();
+
+	seq_printf(s, "hits: %llu\nmisses: %llu\nevictions: %llu\n",
+		   stats.hits, stats.misses, stats.evictions);
+	seq_printf(s, "deferred: %llu\nbusy: %llu\nscm_errors: %llu\n",
+		   stats.deferred, stats.busy, stats.scm_errors);
+	seq_printf(s, "load_max_us: %llu\n", stats.lat_max_us);
+	for (i = 0; i < PFK_KC_LAT_BUCKETS - 1; i++)
+		seq_printf(s, "load_us <%lu: %llu\n", 1UL << i,
+			   stats.lat_hist[i]);
+	seq_printf(s, "load_us >=%lu: %llu\n", 1UL << (i - 1),
+		   stats.lat_hist[i]);
+
+	return 0;
+}
+
+static int pfk_kc_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pfk_kc_stats_show, NULL);
+}
+
+static const struct file_operations pfk_kc_stats_fops = {
+	.open = pfk_kc_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int pfk_kc_find_storage_type(char **device)
 {
 	char boot[20] = {'\0'};
@@ -904,11 +991,17 @@ static int pfk_kc_find_storage_type(char **device)
 
 static int __init pfk_kc_pre_init(void)
 {
+	kc_debugfs = debugfs_create_dir("pfk_kc", NULL);
+	if (!IS_ERR_OR_NULL(kc_debugfs))
+		debugfs_create_file("stats", 0400, kc_debugfs, NULL,
+				    &pfk_kc_stats_fops);
+
 	return pfk_kc_find_storage_type(&s_type);
 }
 
 static void __exit pfk_kc_exit(void)
 {
+	debugfs_remove_recursive(kc_debugfs);
 	s_type = NULL;
 }
 
@@ -374,6 +374,12 @@ struct wcd9xxx {
 	u8 prev_pg;
 	u8 avoid_cdc_rstlow;
 	struct wcd9xxx_power_region *wcd9xxx_pwr[WCD9XXX_MAX_PWR_REGIONS];
+
+	/* SLIMbus write accounting for the last device up */
+	u32 single_writes;
+	u32 bulk_writes;
+	u32 bulk_regs;
+	s64 power_up_us;
 };
 
 struct wcd9xxx_reg_val {
@@ -382,6 +388,12 @@ struct wcd9xxx_reg_val {
 	int bytes;          /* number of bytes to be written */
 };
 
+struct wcd9xxx_reg_mask_val {
+	u16 reg;
+	u8 mask;
+	u8 val;
+};
+
 int wcd9xxx_interface_reg_read(struct wcd9xxx *wcd9xxx, unsigned short reg);
 int wcd9xxx_interface_reg_write(struct wcd9xxx *wcd9xxx, unsigned short reg,
 		u8 val);
@@ -400,6 +412,9 @@ int wcd9xxx_page_write(struct wcd9xxx *wcd9xxx, unsigned short *reg);
 int wcd9xxx_slim_bulk_write(struct wcd9xxx *wcd9xxx,
 			    struct wcd9xxx_reg_val *bulk_reg,
 			    unsigned int size, bool interface);
+int wcd9xxx_update_bits_batch(struct wcd9xxx *wcd9xxx,
+			      const struct wcd9xxx_reg_mask_val *regs,
+			      unsigned int num_regs);
 
 extern int wcd9xxx_core_res_init(
 	struct wcd9xxx_core_resource *wcd9xxx_core_res,
@@ -12350,7 +12350,7 @@ static const struct tasha_reg_mask_val tasha_reg_update_reset_val_1_1[] = {
 	{WCD9335_FLYBACK_VNEG_DAC_CTRL_4, 0xFF, 0x60},
 };
 
-static const struct tasha_reg_mask_val tasha_codec_reg_init_val_1_1[] = {
+static const struct wcd9xxx_reg_mask_val tasha_codec_reg_init_val_1_1[] = {
 	{WCD9335_FLYBACK_VNEG_DAC_CTRL_1, 0xFF, 0x65},
 	{WCD9335_FLYBACK_VNEG_DAC_CTRL_2, 0xFF, 0x52},
 	{WCD9335_FLYBACK_VNEG_DAC_CTRL_3, 0xFF, 0xAF},
@@ -12363,13 +12363,13 @@ static const struct tasha_reg_mask_val tasha_codec_reg_init_val_1_1[] = {
 	{WCD9335_CDC_RX1_RX_PATH_SEC0, 0xF8, 0xF8},
 };
 
-static const struct tasha_reg_mask_val tasha_codec_reg_init_val_1_0[] = {
+static const struct wcd9xxx_reg_mask_val tasha_codec_reg_init_val_1_0[] = {
 	{WCD9335_FLYBACK_VNEG_CTRL_3, 0xFF, 0x54},
 	{WCD9335_CDC_RX2_RX_PATH_SEC0, 0xFC, 0xFC},
 	{WCD9335_CDC_RX1_RX_PATH_SEC0, 0xFC, 0xFC},
 };
 
-static const struct tasha_reg_mask_val tasha_codec_reg_init_val_2_0[] = {
+static const struct wcd9xxx_reg_mask_val tasha_codec_reg_init_val_2_0[] = {
 	{WCD9335_RCO_CTRL_2, 0x0F, 0x08},
 	{WCD9335_RX_BIAS_FLYB_MID_RST, 0xF0, 0x10},
 	{WCD9335_FLYBACK_CTRL_1, 0x20, 0x20},
@@ -12394,13 +12394,13 @@ static const struct tasha_reg_mask_val tasha_codec_reg_init_val_2_0[] = {
 	{WCD9335_CDC_RX6_RX_PATH_SEC0, 0xFC, 0xF8},
 };
 
-static const struct tasha_reg_mask_val tasha_codec_reg_defaults[] = {
+static const struct wcd9xxx_reg_mask_val tasha_codec_reg_defaults[] = {
 	{WCD9335_CODEC_RPM_CLK_GATE, 0x03, 0x00},
 	{WCD9335_CODEC_RPM_CLK_MCLK_CFG, 0x03, 0x01},
 	{WCD9335_CODEC_RPM_CLK_MCLK_CFG, 0x04, 0x04},
 };
 
-static const struct tasha_reg_mask_val tasha_codec_reg_i2c_defaults[] = {
+static const struct wcd9xxx_reg_mask_val tasha_codec_reg_i2c_defaults[] = {
 	{WCD9335_ANA_CLK_TOP, 0x20, 0x20},
 	{WCD9335_CODEC_RPM_CLK_GATE, 0x03, 0x01},
 	{WCD9335_CODEC_RPM_CLK_MCLK_CFG, 0x03, 0x00},
@@ -12415,7 +12415,7 @@ static const struct tasha_reg_mask_val tasha_codec_reg_i2c_defaults[] = {
 	{WCD9335_DATA_HUB_DATA_HUB_TX_I2S_SD1_R_CFG, 0x05, 0x05},
 };
 
-static const struct tasha_reg_mask_val tasha_codec_reg_init_common_val[] = {
+static const struct wcd9xxx_reg_mask_val tasha_codec_reg_init_common_val[] = {
 	/* Rbuckfly/R_EAR(32) */
 	{WCD9335_CDC_CLSH_K2_MSB, 0x0F, 0x00},
 	{WCD9335_CDC_CLSH_K2_LSB, 0xFF, 0x60},
@@ -12459,7 +12459,7 @@ static const struct tasha_reg_mask_val tasha_codec_reg_init_common_val[] = {
 	{WCD9335_VBADC_IBIAS_FE, 0x0C, 0x08},
 };
 
-static const struct tasha_reg_mask_val tasha_codec_reg_init_1_x_val[] = {
+static const struct wcd9xxx_reg_mask_val tasha_codec_reg_init_1_x_val[] = {
 	/* Enable TX HPF Filter & Linear Phase */
 	{WCD9335_CDC_TX0_TX_PATH_CFG0, 0x11, 0x11},
 	{WCD9335_CDC_TX1_TX_PATH_CFG0, 0x11, 0x11},
@@ -12538,64 +12538,45 @@ static void tasha_update_reg_reset_values(struct snd_soc_codec *codec)
 
 static void tasha_codec_init_reg(struct snd_soc_codec *codec)
 {
-	u32 i;
 	struct wcd9xxx *wcd9xxx = dev_get_drvdata(codec->dev->parent);
 
-	for (i = 0; i < ARRAY_SIZE(tasha_codec_reg_init_common_val); i++)
-		snd_soc_update_bits(codec,
-				tasha_codec_reg_init_common_val[i].reg,
-				tasha_codec_reg_init_common_val[i].mask,
-				tasha_codec_reg_init_common_val[i].val);
+	wcd9xxx_update_bits_batch(wcd9xxx, tasha_codec_reg_init_common_val,
+				  ARRAY_SIZE(tasha_codec_reg_init_common_val));
 
 	if (TASHA_IS_1_1(wcd9xxx) ||
 	    TASHA_IS_1_0(wcd9xxx))
-		for (i = 0; i < ARRAY_SIZE(tasha_codec_reg_init_1_x_val); i++)
-			snd_soc_update_bits(codec,
-					tasha_codec_reg_init_1_x_val[i].reg,
-					tasha_codec_reg_init_1_x_val[i].mask,
-					tasha_codec_reg_init_1_x_val[i].val);
+		wcd9xxx_update_bits_batch(wcd9xxx,
+				tasha_codec_reg_init_1_x_val,
+				ARRAY_SIZE(tasha_codec_reg_init_1_x_val));
 
 	if (TASHA_IS_1_1(wcd9xxx)) {
-		for (i = 0; i < ARRAY_SIZE(tasha_codec_reg_init_val_1_1); i++)
-			snd_soc_update_bits(codec,
-					tasha_codec_reg_init_val_1_1[i].reg,
-					tasha_codec_reg_init_val_1_1[i].mask,
-					tasha_codec_reg_init_val_1_1[i].val);
+		wcd9xxx_update_bits_batch(wcd9xxx,
+				tasha_codec_reg_init_val_1_1,
+				ARRAY_SIZE(tasha_codec_reg_init_val_1_1));
 	} else if (TASHA_IS_1_0(wcd9xxx)) {
-		for (i = 0; i < ARRAY_SIZE(tasha_codec_reg_init_val_1_0); i++)
-			snd_soc_update_bits(codec,
-					tasha_codec_reg_init_val_1_0[i].reg,
-					tasha_codec_reg_init_val_1_0[i].mask,
-					tasha_codec_reg_init_val_1_0[i].val);
+		wcd9xxx_update_bits_batch(wcd9xxx,
+				tasha_codec_reg_init_val_1_0,
+				ARRAY_SIZE(tasha_codec_reg_init_val_1_0));
 	} else if (TASHA_IS_2_0(wcd9xxx)) {
-		for (i = 0; i < ARRAY_SIZE(tasha_codec_reg_init_val_2_0); i++)
-			snd_soc_update_bits(codec,
-					tasha_codec_reg_init_val_2_0[i].reg,
-					tasha_codec_reg_init_val_2_0[i].mask,
-					tasha_codec_reg_init_val_2_0[i].val);
+		wcd9xxx_update_bits_batch(wcd9xxx,
+				tasha_codec_reg_init_val_2_0,
+				ARRAY_SIZE(tasha_codec_reg_init_val_2_0));
 	}
 }
 
 static void tasha_update_reg_defaults(struct tasha_priv *tasha)
 {
-	u32 i;
 	struct wcd9xxx *wcd9xxx;
 
 	wcd9xxx = tasha->wcd9xxx;
-	for (i = 0; i < ARRAY_SIZE(tasha_codec_reg_defaults); i++)
-		regmap_update_bits(wcd9xxx->regmap,
-				   tasha_codec_reg_defaults[i].reg,
-				   tasha_codec_reg_defaults[i].mask,
-				   tasha_codec_reg_defaults[i].val);
+	wcd9xxx_update_bits_batch(wcd9xxx, tasha_codec_reg_defaults,
+				  ARRAY_SIZE(tasha_codec_reg_defaults));
 
 	tasha->intf_type = wcd9xxx_get_intf_type();
 	if (tasha->intf_type == WCD9XXX_INTERFACE_TYPE_I2C)
-		for (i = 0; i < ARRAY_SIZE(tasha_codec_reg_i2c_defaults); i++)
-			regmap_update_bits(wcd9xxx->regmap,
-					   tasha_codec_reg_i2c_defaults[i].reg,
-					   tasha_codec_reg_i2c_defaults[i].mask,
-					   tasha_codec_reg_i2c_defaults[i].val);
-
+		wcd9xxx_update_bits_batch(wcd9xxx,
+				tasha_codec_reg_i2c_defaults,
+				ARRAY_SIZE(tasha_codec_reg_i2c_defaults));
 }
 
 static void tasha_slim_interface_init_reg(struct snd_soc_codec *codec)
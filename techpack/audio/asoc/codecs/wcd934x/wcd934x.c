@@ -9346,7 +9346,7 @@ static const struct tavil_reg_mask_val tavil_codec_mclk2_1_0_defaults[] = {
 	{WCD934X_CLK_SYS_INT_DIG_LOCK_DET_CFG, 0xFF, 0x32},
 };
 
-static const struct tavil_reg_mask_val tavil_codec_reg_defaults[] = {
+static const struct wcd9xxx_reg_mask_val tavil_codec_reg_defaults[] = {
 	{WCD934X_BIAS_VBG_FINE_ADJ, 0xFF, 0x75},
 	{WCD934X_CODEC_CPR_SVS_CX_VDD, 0xFF, 0x7C}, /* value in svs mode */
 	{WCD934X_CODEC_CPR_SVS2_CX_VDD, 0xFF, 0x58}, /* value in svs2 mode */
@@ -9385,7 +9385,7 @@ static const struct tavil_reg_mask_val tavil_codec_reg_defaults[] = {
 	{WCD934X_CODEC_RPM_CLK_MCLK_CFG, 0x04, 0x04},
 };
 
-static const struct tavil_reg_mask_val tavil_codec_reg_init_1_1_val[] = {
+static const struct wcd9xxx_reg_mask_val tavil_codec_reg_init_1_1_val[] = {
 	{WCD934X_CDC_COMPANDER1_CTL7, 0x1E, 0x06},
 	{WCD934X_CDC_COMPANDER2_CTL7, 0x1E, 0x06},
 	{WCD934X_HPH_NEW_INT_RDAC_HD2_CTL_L, 0xFF, 0x84},
@@ -9413,7 +9413,7 @@ static const struct tavil_cpr_reg_defaults cpr_defaults[] = {
 	{ 0x4002002B, 0x00000090 },
 };
 
-static const struct tavil_reg_mask_val tavil_codec_reg_init_common_val[] = {
+static const struct wcd9xxx_reg_mask_val tavil_codec_reg_init_common_val[] = {
 	{WCD934X_CDC_CLSH_K2_MSB, 0x0F, 0x00},
 	{WCD934X_CDC_CLSH_K2_LSB, 0xFF, 0x60},
 	{WCD934X_CPE_SS_DMIC_CFG, 0x80, 0x00},
@@ -9446,25 +9446,17 @@ static const struct tavil_reg_mask_val tavil_codec_reg_init_common_val[] = {
 
 static void tavil_codec_init_reg(struct tavil_priv *priv)
 {
-	struct snd_soc_codec *codec = priv->codec;
-	u32 i;
-
-	for (i = 0; i < ARRAY_SIZE(tavil_codec_reg_init_common_val); i++)
-		snd_soc_update_bits(codec,
-				    tavil_codec_reg_init_common_val[i].reg,
-				    tavil_codec_reg_init_common_val[i].mask,
-				    tavil_codec_reg_init_common_val[i].val);
+	wcd9xxx_update_bits_batch(priv->wcd9xxx,
+				  tavil_codec_reg_init_common_val,
+				  ARRAY_SIZE(tavil_codec_reg_init_common_val));
 
-	if (TAVIL_IS_1_1(priv->wcd9xxx)) {
-		for (i = 0; i < ARRAY_SIZE(tavil_codec_reg_init_1_1_val); i++)
-			snd_soc_update_bits(codec,
-					tavil_codec_reg_init_1_1_val[i].reg,
-					tavil_codec_reg_init_1_1_val[i].mask,
-					tavil_codec_reg_init_1_1_val[i].val);
-	}
+	if (TAVIL_IS_1_1(priv->wcd9xxx))
+		wcd9xxx_update_bits_batch(priv->wcd9xxx,
+				tavil_codec_reg_init_1_1_val,
+				ARRAY_SIZE(tavil_codec_reg_init_1_1_val));
 }
 
-static const struct tavil_reg_mask_val tavil_codec_reg_i2c_defaults[] = {
+static const struct wcd9xxx_reg_mask_val tavil_codec_reg_i2c_defaults[] = {
 	{WCD934X_CLK_SYS_MCLK_PRG, 0x40, 0x00},
 	{WCD934X_CODEC_RPM_CLK_GATE, 0x03, 0x01},
 	{WCD934X_CODEC_RPM_CLK_MCLK_CFG, 0x03, 0x00},
@@ -9482,24 +9474,16 @@ static const struct tavil_reg_mask_val tavil_codec_reg_i2c_defaults[] = {
 
 static void tavil_update_reg_defaults(struct tavil_priv *tavil)
 {
-	u32 i;
 	struct wcd9xxx *wcd9xxx;
 
 	wcd9xxx = tavil->wcd9xxx;
-	for (i = 0; i < ARRAY_SIZE(tavil_codec_reg_defaults); i++)
-		regmap_update_bits(wcd9xxx->regmap,
-				   tavil_codec_reg_defaults[i].reg,
-				   tavil_codec_reg_defaults[i].mask,
-				   tavil_codec_reg_defaults[i].val);
+	wcd9xxx_update_bits_batch(wcd9xxx, tavil_codec_reg_defaults,
+				  ARRAY_SIZE(tavil_codec_reg_defaults));
 
-	if (tavil->intf_type == WCD9XXX_INTERFACE_TYPE_I2C) {
-		for (i = 0; i < ARRAY_SIZE(tavil_codec_reg_i2c_defaults); i++) {
-			regmap_update_bits(wcd9xxx->regmap,
-					   tavil_codec_reg_i2c_defaults[i].reg,
-					   tavil_codec_reg_i2c_defaults[i].mask,
-					   tavil_codec_reg_i2c_defaults[i].val);
-		}
-	}
+	if (tavil->intf_type == WCD9XXX_INTERFACE_TYPE_I2C)
+		wcd9xxx_update_bits_batch(wcd9xxx,
+				tavil_codec_reg_i2c_defaults,
+				ARRAY_SIZE(tavil_codec_reg_i2c_defaults));
 }
 
 static void tavil_update_cpr_defaults(struct tavil_priv *tavil)
@@ -20,6 +20,7 @@
 #include <linux/gpio.h>
 #include <linux/debugfs.h>
 #include <linux/i2c.h>
+#include <linux/ktime.h>
 #include <linux/regmap.h>
 #include <linux/mfd/wcd9xxx/wcd9xxx_registers.h>
 #include <sound/soc.h>
@@ -138,9 +139,12 @@ static int wcd9xxx_slim_multi_reg_write(struct wcd9xxx *wcd9xxx,
 	page_num = WCD9XXX_PAGE_NUM(reg);
 	for (i = 0, n = 0; n < num_regs; i++, n++) {
 		reg = *(u16 *)buf;
-		if (page_num != WCD9XXX_PAGE_NUM(reg)) {
+		if (page_num != WCD9XXX_PAGE_NUM(reg) ||
+		    i == WCD9XXX_PAGE_SIZE) {
 			ret = wcd9xxx_slim_bulk_write(wcd9xxx, bulk_reg,
 						      i, false);
+			if (ret)
+				goto done;
 			page_num = WCD9XXX_PAGE_NUM(reg);
 			i = 0;
 		}
@@ -153,6 +157,7 @@ static int wcd9xxx_slim_multi_reg_write(struct wcd9xxx *wcd9xxx,
 	}
 	ret = wcd9xxx_slim_bulk_write(wcd9xxx, bulk_reg,
 				      i, false);
+done:
 	if (ret)
 		dev_err(dev, "%s: error writing bulk regs\n",
 			__func__);
@@ -275,6 +280,7 @@ static int wcd9xxx_slim_write_device(struct wcd9xxx *wcd9xxx,
 		return 0;
 	}
 
+	wcd9xxx->single_writes++;
 	while (1) {
 		mutex_lock(&wcd9xxx->xfer_lock);
 		ret = slim_change_val_element(interface ?
@@ -455,6 +461,8 @@ int wcd9xxx_slim_bulk_write(struct wcd9xxx *wcd9xxx,
 		goto err;
 	}
 
+	wcd9xxx->bulk_writes++;
+	wcd9xxx->bulk_regs += size;
 	ret = slim_bulk_msg_write(is_interface ?
 				  wcd9xxx->slim_slave : wcd9xxx->slim,
 				  SLIM_MSG_MT_CORE,
@@ -473,6 +481,66 @@ int wcd9xxx_slim_bulk_write(struct wcd9xxx *wcd9xxx,
 }
 EXPORT_SYMBOL(wcd9xxx_slim_bulk_write);
 
+/*
+ * wcd9xxx_update_bits_batch: Apply a table of masked register updates
+ * @wcd9xxx: Handle to the wcd9xxx core
+ * @regs: register, mask and value triplets, applied in order
+ * @num_regs: number of entries in @regs
+ *
+ * Works like calling regmap_update_bits() for each entry, but collects the
+ * resulting values and hands them to regmap_multi_reg_write() at once, so
+ * that on SLIMbus every run of registers within a page goes out as one
+ * bulk value element message instead of one message per register.
+ * Registers that already hold the requested value are not written.
+ *
+ * Returns 0 on success or a negative error code.
+ */
+int wcd9xxx_update_bits_batch(struct wcd9xxx *wcd9xxx,
+			      const struct wcd9xxx_reg_mask_val *regs,
+			      unsigned int num_regs)
+{
+	struct reg_sequence *seq;
+	unsigned int i, old, new;
+	int j, n = 0, ret = 0;
+
+	if (!wcd9xxx || !regs || !num_regs)
+		return -EINVAL;
+
+	seq = kcalloc(num_regs, sizeof(*seq), GFP_KERNEL);
+	if (!seq)
+		return -ENOMEM;
+
+	for (i = 0; i < num_regs; i++) {
+		/* a register may appear more than once, chain the updates */
+		for (j = n - 1; j >= 0; j--)
+			if (seq[j].reg == regs[i].reg)
+				break;
+		if (j >= 0) {
+			old = seq[j].def;
+		} else {
+			ret = regmap_read(wcd9xxx->regmap, regs[i].reg, &old);
+			if (ret)
+				goto done;
+		}
+		new = (old & ~regs[i].mask) | (regs[i].val & regs[i].mask);
+		if (new == old)
+			continue;
+		seq[n].reg = regs[i].reg;
+		seq[n].def = new;
+		n++;
+	}
+
+	if (n)
+		ret = regmap_multi_reg_write(wcd9xxx->regmap, seq, n);
+done:
+	if (ret)
+		dev_err(wcd9xxx->dev, "%s: batch of %u regs failed: %d\n",
+			__func__, num_regs, ret);
+	kfree(seq);
+	return ret;
+}
+EXPORT_SYMBOL(wcd9xxx_update_bits_batch);
+
 static int wcd9xxx_num_irq_regs(const struct wcd9xxx *wcd9xxx)
 {
 	return (wcd9xxx->codec_type->num_irqs / 8) +
@@ -614,6 +682,7 @@ static struct dentry *debugfs_peek;
 static struct dentry *debugfs_poke;
 static struct dentry *debugfs_power_state;
 static struct dentry *debugfs_reg_dump;
+static struct dentry *debugfs_power_up_stats;
 
 static unsigned char read_data;
 
@@ -690,6 +759,18 @@ static ssize_t codec_debug_read(struct file *file, char __user *ubuf,
 					       strnlen(lbuf, 7));
 	} else if (!strcmp(access_str, "slimslave_reg_dump")) {
 		ret_cnt = wcd9xxx_slimslave_reg_show(ubuf, count, ppos);
+	} else if (!strcmp(access_str, "power_up_stats")) {
+		char sbuf[128];
+		int len;
+
+		len = snprintf(sbuf, sizeof(sbuf),
+			       "power_up_us: %lld\nsingle_writes: %u\nbulk_writes: %u\nbulk_regs: %u\n",
+			       debugCodec->power_up_us,
+			       debugCodec->single_writes,
+			       debugCodec->bulk_writes,
+			       debugCodec->bulk_regs);
+		ret_cnt = simple_read_from_buffer(ubuf, count, ppos, sbuf,
+						  len);
 	} else {
 		pr_err("%s: %s not permitted to read\n", __func__, access_str);
 		ret_cnt = -EPERM;
@@ -1432,6 +1513,10 @@ static int wcd9xxx_slim_probe(struct slim_device *slim)
 		debugfs_reg_dump = debugfs_create_file("slimslave_reg_dump",
 		S_IFREG | 0444, debugfs_wcd9xxx_dent,
 		(void *) "slimslave_reg_dump", &codec_debug_ops);
+
+		debugfs_power_up_stats = debugfs_create_file("power_up_stats",
+		S_IFREG | 0444, debugfs_wcd9xxx_dent,
+		(void *) "power_up_stats", &codec_debug_ops);
 	}
 #endif
 
@@ -1515,6 +1600,7 @@ static int wcd9xxx_slim_device_reset(struct slim_device *sldev)
 static int wcd9xxx_slim_device_up(struct slim_device *sldev)
 {
 	struct wcd9xxx *wcd9xxx = slim_get_devicedata(sldev);
+	ktime_t start;
 	int ret = 0;
 
 	if (!wcd9xxx) {
@@ -1529,8 +1615,16 @@ static int wcd9xxx_slim_device_up(struct slim_device *sldev)
 	wcd9xxx->dev_up = true;
 
 	mutex_lock(&wcd9xxx->reset_lock);
+	start = ktime_get();
+	wcd9xxx->single_writes = 0;
+	wcd9xxx->bulk_writes = 0;
+	wcd9xxx->bulk_regs = 0;
 	ret = wcd9xxx_device_up(wcd9xxx);
+	wcd9xxx->power_up_us = ktime_us_delta(ktime_get(), start);
 	mutex_unlock(&wcd9xxx->reset_lock);
+	dev_dbg(wcd9xxx->dev, "%s: up in %lld us, %u single, %u bulk (%u regs)\n",
+		__func__, wcd9xxx->power_up_us, wcd9xxx->single_writes,
+		wcd9xxx->bulk_writes, wcd9xxx->bulk_regs);
 
 	return ret;
 }
@@ -12,6 +12,7 @@
 
 #include <linux/slab.h>
 #include <linux/ratelimit.h>
+#include <linux/workqueue.h>
 #include <sound/compress_params.h>
 #include <sound/devdep_params.h>
 #include <dsp/apr_audio-v2.h>
@@ -40,6 +41,159 @@ do {                                                                    \
 } while (0)
 
 
+/* Must be called with batch->lock held */
+static int msm_audio_effects_batch_send(struct msm_audio_effects_batch *batch)
+{
+	int rc = 0;
+
+	if (batch->len)
+		rc = q6asm_send_audio_effects_params(batch->ac,
+						     (char *)batch->params,
+						     batch->len);
+	batch->len = 0;
+	return rc;
+}
+
+static void msm_audio_effects_batch_work(struct work_struct *work)
+{
+	struct msm_audio_effects_batch *batch =
+		container_of(work, struct msm_audio_effects_batch, work.work);
+
+	mutex_lock(&batch->lock);
+	msm_audio_effects_batch_send(batch);
+	mutex_unlock(&batch->lock);
+}
+
+/*
+ * Merge one module/param/size/payload entry into the staged block.
+ * Returns -ENOSPC when it neither matches a staged entry nor fits.
+ */
+static int msm_audio_effects_batch_merge(struct msm_audio_effects_batch *batch,
+					 const uint32_t *entry)
+{
+	uint32_t size = COMMAND_PAYLOAD_SZ + entry[2];
+	uint32_t off = 0, cur;
+
+	while (off < batch->len) {
+		const uint32_t *staged = &batch->params[off / sizeof(uint32_t)];
+
+		cur = COMMAND_PAYLOAD_SZ + staged[2];
+		if (staged[0] == entry[0] && staged[1] == entry[1] &&
+		    staged[2] == entry[2]) {
+			memcpy(&batch->params[off / sizeof(uint32_t)], entry,
+			       size);
+			return 0;
+		}
+		off += cur;
+	}
+
+	if (batch->len + size > MAX_INBAND_PARAM_SZ)
+		return -ENOSPC;
+	memcpy(&batch->params[batch->len / sizeof(uint32_t)], entry, size);
+	batch->len += size;
+	return 0;
+}
+
+static int msm_audio_effects_send_params(struct audio_client *ac,
+					 char *params, uint32_t params_length)
+{
+	struct msm_audio_effects_batch *batch = ac->effects_batch;
+	uint32_t off = 0, size;
+	const uint32_t *entry;
+	int rc = 0;
+
+	if (!batch)
+		return q6asm_send_audio_effects_params(ac, params,
+						       params_length);
+
+	mutex_lock(&batch->lock);
+	while (off + COMMAND_PAYLOAD_SZ <= params_length) {
+		entry = (const uint32_t *)(params + off);
+		if (entry[2] > params_length - off - COMMAND_PAYLOAD_SZ ||
+		    (entry[2] % sizeof(uint32_t))) {
+			pr_err_ratelimited("%s: malformed param at %u\n",
+					   __func__, off);
+			rc = -EINVAL;
+			break;
+		}
+		size = COMMAND_PAYLOAD_SZ + entry[2];
+		if (msm_audio_effects_batch_merge(batch, entry) == -ENOSPC) {
+			rc = msm_audio_effects_batch_send(batch);
+			msm_audio_effects_batch_merge(batch, entry);
+		}
+		off += size;
+	}
+	if (batch->len && !delayed_work_pending(&batch->work))
+		schedule_delayed_work(&batch->work, batch->delay);
+	mutex_unlock(&batch->lock);
+	return rc;
+}
+
+/**
+ * msm_audio_effects_batch_init -
+ *        Coalesce effect params of an audio client
+ *
+ * @batch: staging area, usually part of the stream's private data
+ * @ac: audio client the params are sent to
+ * @period_ms: how long updates are collected before they are sent
+ *
+ * Once attached, the effect handlers below stage their params in @batch
+ * instead of sending one set-param per control write.
+ */
+void msm_audio_effects_batch_init(struct msm_audio_effects_batch *batch,
+				  struct audio_client *ac,
+				  unsigned int period_ms)
+{
+	mutex_init(&batch->lock);
+	INIT_DELAYED_WORK(&batch->work, msm_audio_effects_batch_work);
+	batch->ac = ac;
+	batch->delay = msecs_to_jiffies(period_ms);
+	batch->len = 0;
+	ac->effects_batch = batch;
+}
+EXPORT_SYMBOL(msm_audio_effects_batch_init);
+
+/**
+ * msm_audio_effects_batch_flush -
+ *        Send staged effect params right away
+ *
+ * @batch: staging area
+ *
+ * Return 0 on success or error on failure
+ */
+int msm_audio_effects_batch_flush(struct msm_audio_effects_batch *batch)
+{
+	int rc;
+
+	cancel_delayed_work_sync(&batch->work);
+	mutex_lock(&batch->lock);
+	rc = msm_audio_effects_batch_send(batch);
+	mutex_unlock(&batch->lock);
+	return rc;
+}
+EXPORT_SYMBOL(msm_audio_effects_batch_flush);
+
+/**
+ * msm_audio_effects_batch_release -
+ *        Detach the staging area and drop what is left in it
+ *
+ * @batch: staging area
+ *
+ * Must be called before the audio client is freed.
+ */
+void msm_audio_effects_batch_release(struct msm_audio_effects_batch *batch)
+{
+	cancel_delayed_work_sync(&batch->work);
+	mutex_lock(&batch->lock);
+	batch->len = 0;
+	if (batch->ac)
+		batch->ac->effects_batch = NULL;
+	batch->ac = NULL;
+	mutex_unlock(&batch->lock);
+	mutex_destroy(&batch->lock);
+}
+EXPORT_SYMBOL(msm_audio_effects_batch_release);
+
 /**
  * msm_audio_effects_is_effmodule_supp_in_top -
  *        Checks if given topology and module in effects
@@ -86,7 +240,7 @@ int msm_audio_effects_enable_extn(struct audio_client *ac,
 	updt_params[3] = flag;
 	params_length += COMMAND_PAYLOAD_SZ + VIRTUALIZER_ENABLE_PARAM_SZ;
 	if (effects->virtualizer.enable_flag)
-		q6asm_send_audio_effects_params(ac, (char *)&updt_params[0],
+		msm_audio_effects_send_params(ac, (char *)&updt_params[0],
 					params_length);
 	memset(updt_params, 0, sizeof(updt_params));
 	params_length = 0;
@@ -96,7 +250,7 @@ int msm_audio_effects_enable_extn(struct audio_client *ac,
 	updt_params[3] = flag;
 	params_length += COMMAND_PAYLOAD_SZ + BASS_BOOST_ENABLE_PARAM_SZ;
 	if (effects->bass_boost.enable_flag)
-		q6asm_send_audio_effects_params(ac, (char *)&updt_params[0],
+		msm_audio_effects_send_params(ac, (char *)&updt_params[0],
 					params_length);
 	memset(updt_params, 0, sizeof(updt_params));
 	params_length = 0;
@@ -106,7 +260,7 @@ int msm_audio_effects_enable_extn(struct audio_client *ac,
 	updt_params[3] = flag;
 	params_length += COMMAND_PAYLOAD_SZ + EQ_ENABLE_PARAM_SZ;
 	if (effects->equalizer.enable_flag)
-		q6asm_send_audio_effects_params(ac, (char *)&updt_params[0],
+		msm_audio_effects_send_params(ac, (char *)&updt_params[0],
 					params_length);
 	return rc;
 }
@@ -275,7 +429,7 @@ int msm_audio_effects_virtualizer_handler(struct audio_client *ac,
 		}
 	}
 	if (params_length && (rc == 0))
-		q6asm_send_audio_effects_params(ac, params,
+		msm_audio_effects_send_params(ac, params,
 						params_length);
 	else
 		pr_debug("%s: did not send pp params\n", __func__);
@@ -757,7 +911,7 @@ int msm_audio_effects_reverb_handler(struct audio_client *ac,
 		}
 	}
 	if (params_length && (rc == 0))
-		q6asm_send_audio_effects_params(ac, params,
+		msm_audio_effects_send_params(ac, params,
 						params_length);
 	else
 		pr_debug("%s: did not send pp params\n", __func__);
@@ -904,7 +1058,7 @@ int msm_audio_effects_bass_boost_handler(struct audio_client *ac,
 		}
 	}
 	if (params_length && (rc == 0))
-		q6asm_send_audio_effects_params(ac, params,
+		msm_audio_effects_send_params(ac, params,
 						params_length);
 	else
 		pr_debug("%s: did not send pp params\n", __func__);
@@ -1025,7 +1179,7 @@ int msm_audio_effects_pbe_handler(struct audio_client *ac,
 		}
 	}
 	if (params_length && (rc == 0))
-		q6asm_send_audio_effects_params(ac, params,
+		msm_audio_effects_send_params(ac, params,
 						params_length);
 invalid_config:
 	kfree(params);
@@ -1267,7 +1421,7 @@ int msm_audio_effects_popless_eq_handler(struct audio_client *ac,
 		}
 	}
 	if (params_length && (rc == 0))
-		q6asm_send_audio_effects_params(ac, params,
+		msm_audio_effects_send_params(ac, params,
 						params_length);
 	else
 		pr_debug("%s: did not send pp params\n", __func__);
@@ -1424,7 +1578,7 @@ static int __msm_audio_effects_volume_handler(struct audio_client *ac,
 		}
 	}
 	if (params_length && (rc == 0))
-		q6asm_send_audio_effects_params(ac, params,
+		msm_audio_effects_send_params(ac, params,
 						params_length);
 invalid_config:
 	kfree(params);
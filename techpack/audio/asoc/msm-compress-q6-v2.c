@@ -21,6 +21,9 @@
 #include <linux/mutex.h>
 #include <linux/platform_device.h>
 #include <linux/slab.h>
+#include <linux/debugfs.h>
+#include <linux/jiffies.h>
+#include <linux/seq_file.h>
 #include <sound/core.h>
 #include <sound/soc.h>
 #include <sound/soc-dapm.h>
@@ -49,6 +52,8 @@
 
 #define DSP_PP_BUFFERING_IN_MSEC	25
 #define PARTIAL_DRAIN_ACK_EARLY_BY_MSEC	150
+/* offload has no PCM period, merge effect updates over one UI frame */
+#define MSM_COMPR_EFFECTS_BATCH_MS	16
 #define MP3_OUTPUT_FRAME_SZ		1152
 #define AAC_OUTPUT_FRAME_SZ		1024
 #define AC3_OUTPUT_FRAME_SZ		1536
@@ -69,6 +74,15 @@
 #define COMPR_PLAYBACK_MIN_NUM_FRAGMENTS (4)
 #define COMPR_PLAYBACK_MAX_NUM_FRAGMENTS (16 * 4)
 
+/*
+ * In low power mode a playback write carries up to this much data, or half
+ * the ring, so the DSP and the apps CPU wake up once per write instead of
+ * once per fragment. The first writes after start, seek or a gapless
+ * switch stay at one fragment to keep those transitions quick.
+ */
+#define COMPR_LP_MAX_WRITE_SIZE		(512 * 1024)
+#define COMPR_LP_WARMUP_WRITES		2
+
 #define COMPRESSED_LR_VOL_MAX_STEPS	0x2000
 const DECLARE_TLV_DB_LINEAR(msm_compr_vol_gain, 0,
 				COMPRESSED_LR_VOL_MAX_STEPS);
@@ -105,7 +119,11 @@ struct msm_compr_pdata {
 	struct msm_compr_dec_params *dec_params[MSM_FRONTEND_DAI_MAX];
 	struct msm_compr_ch_map *ch_map[MSM_FRONTEND_DAI_MAX];
 	bool is_in_use[MSM_FRONTEND_DAI_MAX];
+	bool low_power_mode;
 	struct mutex lock;
+#ifdef CONFIG_DEBUG_FS
+	struct dentry *debugfs;
+#endif
 };
 
 struct msm_compr_audio {
@@ -161,6 +179,11 @@ struct msm_compr_audio {
 
 	uint64_t marker_timestamp;
 
+	/* low power write sizing and DSP wakeup accounting */
+	uint32_t lp_warmup;
+	uint64_t write_done_cnt;
+	unsigned long stats_start;
+
 	struct msm_compr_gapless_state gapless_state;
 
 	atomic_t start;
@@ -199,6 +222,7 @@ struct msm_compr_audio_effects {
 	struct eq_params equalizer;
 	struct soft_volume_params volume;
 	struct query_audio_effect query;
+	struct msm_audio_effects_batch batch;
 };
 
 struct msm_compr_dec_params {
@@ -426,6 +450,28 @@ static int msm_compr_send_ddp_cfg(struct audio_client *ac,
 	return 0;
 }
 
+static uint32_t msm_compr_write_size(struct msm_compr_audio *prtd,
+				     uint64_t bytes_available)
+{
+	struct snd_soc_pcm_runtime *rtd = prtd->cstream->private_data;
+	struct msm_compr_pdata *pdata =
+		snd_soc_platform_get_drvdata(rtd->platform);
+	uint32_t frag = prtd->codec_param.buffer.fragment_size;
+	uint64_t size;
+
+	if (!pdata->low_power_mode || prtd->ts_header_offset ||
+	    prtd->lp_warmup || prtd->last_buffer || prtd->next_stream ||
+	    atomic_read(&prtd->drain) ||
+	    prtd->gapless_state.gapless_transition)
+		return frag;
+
+	size = min_t(uint64_t, bytes_available,
+		     min_t(uint32_t, prtd->buffer_size / 2,
+			   COMPR_LP_MAX_WRITE_SIZE));
+	size = div_u64(size, frag) * frag;
+	return max_t(uint32_t, size, frag);
+}
+
 static int msm_compr_send_buffer(struct msm_compr_audio *prtd)
 {
 	int buffer_length;
@@ -453,9 +499,12 @@ static int msm_compr_send_buffer(struct msm_compr_audio *prtd)
 				prtd->gapless_state.initial_samples_drop,
 				prtd->gapless_state.trailing_samples_drop);
 
-	buffer_length = prtd->codec_param.buffer.fragment_size;
+	if (prtd->first_buffer)
+		prtd->lp_warmup = COMPR_LP_WARMUP_WRITES;
+
 	bytes_available = prtd->bytes_received - prtd->copied_total;
-	if (bytes_available < prtd->codec_param.buffer.fragment_size)
+	buffer_length = msm_compr_write_size(prtd, bytes_available);
+	if (bytes_available < buffer_length)
 		buffer_length = bytes_available;
 
 	if (prtd->byte_offset + buffer_length > prtd->buffer_size) {
@@ -499,6 +548,8 @@ static int msm_compr_send_buffer(struct msm_compr_audio *prtd)
 		prtd->bytes_sent += buffer_length;
 		if (prtd->first_buffer)
 			prtd->first_buffer = 0;
+		if (prtd->lp_warmup)
+			prtd->lp_warmup--;
 	}
 
 	return 0;
@@ -590,6 +641,7 @@ static void compr_event_handler(uint32_t opcode,
 	switch (opcode) {
 	case ASM_DATA_EVENT_WRITE_DONE_V2:
 		spin_lock_irqsave(&prtd->lock, flags);
+		prtd->write_done_cnt++;
 
 		if (payload[3]) {
 			pr_err("%s: WRITE FAILED w/ err 0x%x !, paddr 0x%x, byte_offset=%d,copied_total=%llu,token=%d\n",
@@ -1611,6 +1663,7 @@ static int msm_compr_playback_open(struct snd_compr_stream *cstream)
 	prtd->first_buffer = 1;
 	prtd->partial_drain_delay = 0;
 	prtd->next_stream = 0;
+	prtd->stats_start = jiffies;
 	memset(&prtd->gapless_state, 0, sizeof(struct msm_compr_gapless_state));
 	/*
 	 * Update the use_dsp_gapless_mode from gapless struture with the value
@@ -1653,6 +1706,9 @@ static int msm_compr_playback_open(struct snd_compr_stream *cstream)
 	pr_debug("%s: session ID %d\n", __func__, prtd->audio_client->session);
 	prtd->audio_client->perf_mode = false;
 	prtd->session_id = prtd->audio_client->session;
+	msm_audio_effects_batch_init(
+			&pdata->audio_effects[rtd->dai_link->id]->batch,
+			prtd->audio_client, MSM_COMPR_EFFECTS_BATCH_MS);
 	msm_adsp_init_mixer_ctl_pp_event_queue(rtd);
 	pdata->is_in_use[rtd->dai_link->id] = true;
 	return 0;
@@ -1809,6 +1865,9 @@ static int msm_compr_playback_free(struct snd_compr_stream *cstream)
 
 	q6asm_audio_client_buf_free_contiguous(dir, ac);
 
+	if (pdata->audio_effects[soc_prtd->dai_link->id] != NULL)
+		msm_audio_effects_batch_release(
+			&pdata->audio_effects[soc_prtd->dai_link->id]->batch);
 	q6asm_audio_client_free(ac);
 	msm_adsp_clean_mixer_ctl_pp_event_queue(soc_prtd);
 	if (pdata->audio_effects[soc_prtd->dai_link->id] != NULL) {
@@ -3905,13 +3964,85 @@ static int msm_compr_gapless_get(struct snd_kcontrol *kcontrol,
 	return 0;
 }
 
+static int msm_compr_low_power_put(struct snd_kcontrol *kcontrol,
+				   struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *comp = snd_kcontrol_chip(kcontrol);
+	struct msm_compr_pdata *pdata = (struct msm_compr_pdata *)
+		snd_soc_component_get_drvdata(comp);
+
+	pdata->low_power_mode = !!ucontrol->value.integer.value[0];
+	pr_debug("%s: value: %ld\n", __func__,
+		ucontrol->value.integer.value[0]);
+
+	return 0;
+}
+
+static int msm_compr_low_power_get(struct snd_kcontrol *kcontrol,
+				   struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *comp = snd_kcontrol_chip(kcontrol);
+	struct msm_compr_pdata *pdata =
+		snd_soc_component_get_drvdata(comp);
+
+	ucontrol->value.integer.value[0] = pdata->low_power_mode;
+
+	return 0;
+}
+
 static const struct snd_kcontrol_new msm_compr_gapless_controls[] = {
 	SOC_SINGLE_EXT("Compress Gapless Playback",
 			0, 0, 1, 0,
 			msm_compr_gapless_get,
 			msm_compr_gapless_put),
+	SOC_SINGLE_EXT("Compress Low Power Playback",
+			0, 0, 1, 0,
+			msm_compr_low_power_get,
+			msm_compr_low_power_put),
 };
 
+#ifdef CONFIG_DEBUG_FS
+static int msm_compr_wakeups_show(struct seq_file *m, void *unused)
+{
+	struct msm_compr_pdata *pdata = m->private;
+	struct msm_compr_audio *prtd;
+	unsigned long elapsed;
+	uint64_t per_min;
+	int i;
+
+	seq_printf(m, "low_power_mode: %d\n", pdata->low_power_mode);
+	mutex_lock(&pdata->lock);
+	for (i = 0; i < MSM_FRONTEND_DAI_MAX; i++) {
+		if (!pdata->cstream[i] || !pdata->cstream[i]->runtime)
+			continue;
+		prtd = pdata->cstream[i]->runtime->private_data;
+		if (!prtd || pdata->cstream[i]->direction !=
+						SND_COMPRESS_PLAYBACK)
+			continue;
+		elapsed = jiffies - prtd->stats_start;
+		per_min = elapsed ?
+			div_u64(prtd->write_done_cnt * 60 * HZ, elapsed) : 0;
+		seq_printf(m, "fe %d: %llu writes in %u ms, %llu per min, fragment %u\n",
+			   i, prtd->write_done_cnt, jiffies_to_msecs(elapsed),
+			   per_min, prtd->codec_param.buffer.fragment_size);
+	}
+	mutex_unlock(&pdata->lock);
+	return 0;
+}
+
+static int msm_compr_wakeups_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_compr_wakeups_show, inode->i_private);
+}
+
+static const struct file_operations msm_compr_wakeups_fops = {
+	.open = msm_compr_wakeups_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+#endif
+
 static int msm_compr_probe(struct snd_soc_platform *platform)
 {
 	struct msm_compr_pdata *pdata;
@@ -3941,6 +4072,13 @@ static int msm_compr_probe(struct snd_soc_platform *platform)
 	snd_soc_add_platform_controls(platform, msm_compr_gapless_controls,
 				      ARRAY_SIZE(msm_compr_gapless_controls));
 
+#ifdef CONFIG_DEBUG_FS
+	pdata->debugfs = debugfs_create_dir("msm_compr", NULL);
+	if (!IS_ERR_OR_NULL(pdata->debugfs))
+		debugfs_create_file("wakeups", 0444, pdata->debugfs, pdata,
+				    &msm_compr_wakeups_fops);
+#endif
+
 	rc =  of_property_read_string(platform->dev->of_node,
 		"qcom,adsp-version", &qdsp_version);
 	if (!rc) {
@@ -3983,6 +4121,9 @@ static int msm_compr_remove(struct snd_soc_platform *platform)
 		return -ENOMEM;
 	}
 
+#ifdef CONFIG_DEBUG_FS
+	debugfs_remove_recursive(pdata->debugfs);
+#endif
 	mutex_destroy(&pdata->lock);
 	kfree(pdata);
 
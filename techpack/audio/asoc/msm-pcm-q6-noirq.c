@@ -89,6 +89,7 @@ static struct snd_pcm_hardware msm_pcm_hardware_playback = {
 				SNDRV_PCM_INFO_MMAP_VALID |
 				SNDRV_PCM_INFO_INTERLEAVED |
 				SNDRV_PCM_INFO_NO_PERIOD_WAKEUP |
+				SNDRV_PCM_INFO_HAS_LINK_ABSOLUTE_ATIME |
 				SNDRV_PCM_INFO_PAUSE | SNDRV_PCM_INFO_RESUME),
 	.formats =              (SNDRV_PCM_FMTBIT_S16_LE |
 				SNDRV_PCM_FMTBIT_S24_LE |
@@ -113,6 +114,7 @@ static struct snd_pcm_hardware msm_pcm_hardware_capture = {
 				SNDRV_PCM_INFO_MMAP_VALID |
 				SNDRV_PCM_INFO_INTERLEAVED |
 				SNDRV_PCM_INFO_NO_PERIOD_WAKEUP |
+				SNDRV_PCM_INFO_HAS_LINK_ABSOLUTE_ATIME |
 				SNDRV_PCM_INFO_PAUSE | SNDRV_PCM_INFO_RESUME),
 	.formats =              (SNDRV_PCM_FMTBIT_S16_LE |
 				SNDRV_PCM_FMTBIT_S24_LE |
@@ -305,6 +307,14 @@ static int msm_pcm_hw_params(struct snd_pcm_substream *substream,
 					perf_mode :
 					LOW_LATENCY_PCM_MODE;
 
+	/*
+	 * ULL clients poll the pointer instead of waiting for periods, so
+	 * give them the DSP index itself rather than the last period
+	 * boundary; with small periods the rounding is most of the latency.
+	 */
+	prtd->exact_pos = (perf_mode == ULTRA_LOW_LATENCY_PCM_MODE ||
+			   perf_mode == ULL_POST_PROCESSING_PCM_MODE);
+
 	/* rate and channels are sent to audio driver */
 	prtd->samp_rate = params_rate(params);
 	prtd->channel_mode = params_channels(params);
@@ -520,6 +530,7 @@ static snd_pcm_uframes_t msm_pcm_pointer(struct snd_pcm_substream *substream)
 
 	hw_ptr = bytes_to_frames(substream->runtime,
 				 read_index);
+	prtd->pos_wall_clk_us = ((uint64_t)wall_clk_msw << 32) | wall_clk_lsw;
 
 	if (runtime->control->appl_ptr == 0) {
 		pr_debug("ptr(%s): appl(0), hw = %lu read_index = %u\n",
@@ -527,9 +538,40 @@ static snd_pcm_uframes_t msm_pcm_pointer(struct snd_pcm_substream *substream)
 			 "P" : "C",
 			 hw_ptr, read_index);
 	}
+	if (prtd->exact_pos)
+		return hw_ptr;
 	return (hw_ptr/period_size) * period_size;
 }
 
+/*
+ * Called by the core right after msm_pcm_pointer(), so the wall clock
+ * read there belongs to the position just reported: audio_ts is the DSP
+ * AV timer time at which the DSP last moved its index.
+ */
+static int msm_pcm_get_time_info(struct snd_pcm_substream *substream,
+			struct timespec *system_ts, struct timespec *audio_ts,
+			struct snd_pcm_audio_tstamp_config *audio_tstamp_config,
+			struct snd_pcm_audio_tstamp_report *audio_tstamp_report)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct msm_audio *prtd = runtime->private_data;
+
+	if (!prtd->exact_pos || !prtd->pos_wall_clk_us ||
+	    audio_tstamp_config->type_requested !=
+				SNDRV_PCM_AUDIO_TSTAMP_TYPE_LINK_ABSOLUTE) {
+		audio_tstamp_report->actual_type =
+				SNDRV_PCM_AUDIO_TSTAMP_TYPE_DEFAULT;
+		return 0;
+	}
+
+	snd_pcm_gettime(runtime, system_ts);
+	*audio_ts = ns_to_timespec(prtd->pos_wall_clk_us * NSEC_PER_USEC);
+	audio_tstamp_report->actual_type =
+				SNDRV_PCM_AUDIO_TSTAMP_TYPE_LINK_ABSOLUTE;
+	audio_tstamp_report->accuracy_report = 0;
+	return 0;
+}
+
 static int msm_pcm_copy(struct snd_pcm_substream *substream, int a,
 	 snd_pcm_uframes_t hwoff, void __user *buf, snd_pcm_uframes_t frames)
 {
@@ -1264,6 +1306,7 @@ static const struct snd_pcm_ops msm_pcm_ops = {
 #endif
 	.trigger        = msm_pcm_trigger,
 	.pointer        = msm_pcm_pointer,
+	.get_time_info  = msm_pcm_get_time_info,
 	.mmap           = msm_pcm_mmap,
 	.close          = msm_pcm_close,
 };
@@ -110,6 +110,9 @@ struct msm_audio {
 	bool meta_data_mode;
 	uint32_t volume;
 	bool compress_enable;
+	/* ULL mmap: report the DSP position unrounded, with its timestamp */
+	bool exact_pos;
+	uint64_t pos_wall_clk_us;
 	/* array of frame info */
 	struct msm_audio_in_frame_info in_frame_info[CAPTURE_MAX_NUM_PERIODS];
 };
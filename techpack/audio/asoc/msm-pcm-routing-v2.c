@@ -84,6 +84,22 @@ static bool is_ds2_on;
 static bool swap_ch;
 static int msm_ec_ref_port_id;
 
+/*
+ * While a routing transaction is open, mixer toggles still open and close
+ * COPPs right away but only note which FE sessions need a new matrix map;
+ * the maps are sent once per touched session when the transaction commits.
+ */
+struct msm_pcm_routing_pending_map {
+	bool pending;
+	int path_type;
+	int perf_mode;
+	uint32_t passthr_mode;
+};
+
+static bool routing_txn_open;
+static struct msm_pcm_routing_pending_map
+	routing_pending_map[MSM_FRONTEND_DAI_MAX][MAX_SESSION_TYPES];
+
 #define WEIGHT_0_DB 0x4000
 /* all the FEs which can support channel mixer */
 static struct msm_pcm_channel_mixer channel_mixer[MSM_FRONTEND_DAI_MM_SIZE];
@@ -1165,6 +1181,50 @@ static void msm_pcm_routing_build_matrix(int fedai_id, int sess_type,
 	}
 }
 
+/* Must be called with routing_lock held */
+static void msm_pcm_routing_update_matrix(int fedai_id, int sess_type,
+					  int path_type, int perf_mode,
+					  uint32_t passthr_mode)
+{
+	struct msm_pcm_routing_pending_map *map;
+
+	if (!routing_txn_open) {
+		msm_pcm_routing_build_matrix(fedai_id, sess_type, path_type,
+					     perf_mode, passthr_mode);
+		return;
+	}
+
+	/* the map is rebuilt from the final state, keep the latest path */
+	map = &routing_pending_map[fedai_id][sess_type];
+	map->pending = true;
+	map->path_type = path_type;
+	map->perf_mode = perf_mode;
+	map->passthr_mode = passthr_mode;
+}
+
+/* Must be called with routing_lock held */
+static void msm_pcm_routing_commit_matrix(void)
+{
+	struct msm_pcm_routing_pending_map *map;
+	int i, j;
+
+	for (i = 0; i < MSM_FRONTEND_DAI_MAX; i++) {
+		for (j = 0; j < MAX_SESSION_TYPES; j++) {
+			map = &routing_pending_map[i][j];
+			if (!map->pending)
+				continue;
+			map->pending = false;
+			if (fe_dai_map[i][j].strm_id == INVALID_SESSION)
+				continue;
+			pr_debug("%s: fe %d type %d path %d\n",
+				 __func__, i, j, map->path_type);
+			msm_pcm_routing_build_matrix(i, j, map->path_type,
+						     map->perf_mode,
+						     map->passthr_mode);
+		}
+	}
+}
+
 void msm_pcm_routing_reg_psthr_stream(int fedai_id, int dspst_id,
 				      int stream_type)
 {
@@ -1849,10 +1909,10 @@ static void msm_pcm_routing_process_audio(u16 reg, u16 val, int set)
 					MSM_PCM_RT_EVT_DEVSWITCH,
 					fdai->event_info.priv_data);
 
-			msm_pcm_routing_build_matrix(val, session_type,
-						     path_type,
-						     fdai->perf_mode,
-						     passthr_mode);
+			msm_pcm_routing_update_matrix(val, session_type,
+						      path_type,
+						      fdai->perf_mode,
+						      passthr_mode);
 			if ((fdai->perf_mode == LEGACY_PCM_MODE) &&
 				(passthr_mode == LEGACY_PCM))
 				msm_pcm_routing_cfg_pp(port_id, copp_idx,
@@ -1889,10 +1949,10 @@ static void msm_pcm_routing_process_audio(u16 reg, u16 val, int set)
 			    (fdai->perf_mode == LEGACY_PCM_MODE) &&
 			    (passthr_mode == LEGACY_PCM))
 				msm_pcm_routing_deinit_pp(port_id, topology);
-			msm_pcm_routing_build_matrix(val, session_type,
-						     path_type,
-						     fdai->perf_mode,
-						     passthr_mode);
+			msm_pcm_routing_update_matrix(val, session_type,
+						      path_type,
+						      fdai->perf_mode,
+						      passthr_mode);
 		}
 	}
 	if ((msm_bedais[reg].port_id == VOICE_RECORD_RX)
@@ -21166,6 +21226,40 @@ static int msm_routing_stereo_channel_reverse_control_put(
 	return ret;
 }
 
+static int msm_routing_txn_control_get(struct snd_kcontrol *kcontrol,
+				       struct snd_ctl_elem_value *ucontrol)
+{
+	ucontrol->value.integer.value[0] = routing_txn_open;
+	return 0;
+}
+
+/*
+ * Writing 1 opens a routing transaction, writing 0 commits it and sends
+ * one matrix map for each FE session whose routing changed meanwhile.
+ */
+static int msm_routing_txn_control_put(struct snd_kcontrol *kcontrol,
+				       struct snd_ctl_elem_value *ucontrol)
+{
+	bool open = !!ucontrol->value.integer.value[0];
+
+	mutex_lock(&routing_lock);
+	if (open != routing_txn_open) {
+		routing_txn_open = open;
+		if (!open)
+			msm_pcm_routing_commit_matrix();
+	}
+	mutex_unlock(&routing_lock);
+	pr_debug("%s: routing transaction %s\n", __func__,
+		 open ? "open" : "committed");
+	return 0;
+}
+
+static const struct snd_kcontrol_new routing_txn_control[] = {
+	SOC_SINGLE_EXT("Routing Transaction", SND_SOC_NOPM, 0,
+	1, 0, msm_routing_txn_control_get,
+	msm_routing_txn_control_put),
+};
+
 static const struct snd_kcontrol_new stereo_channel_reverse_control[] = {
 	SOC_SINGLE_EXT("Swap channel", SND_SOC_NOPM, 0,
 	1, 0, msm_routing_stereo_channel_reverse_control_get,
@@ -21243,6 +21337,8 @@ static int msm_routing_probe(struct snd_soc_platform *platform)
 					ARRAY_SIZE(aptx_dec_license_controls));
 	snd_soc_add_platform_controls(platform, stereo_channel_reverse_control,
 				ARRAY_SIZE(stereo_channel_reverse_control));
+	snd_soc_add_platform_controls(platform, routing_txn_control,
+				ARRAY_SIZE(routing_txn_control));
 	snd_soc_add_platform_controls(platform,
 			port_multi_channel_map_mixer_controls,
 			ARRAY_SIZE(port_multi_channel_map_mixer_controls));
@@ -14,10 +14,34 @@
 #ifndef _MSM_AUDIO_EFFECTS_H
 #define _MSM_AUDIO_EFFECTS_H
 
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
 #include <sound/audio_effects.h>
 
 #define MAX_PP_PARAMS_SZ   128
 
+/*
+ * Per stream staging area for effect parameters. Updates that arrive
+ * within one period are merged, a repeated module/param pair overwrites
+ * its earlier value, and the result goes to the DSP as one set-param.
+ */
+struct msm_audio_effects_batch {
+	struct audio_client *ac;
+	struct mutex lock;
+	struct delayed_work work;
+	unsigned long delay;
+	uint32_t len;
+	uint32_t params[MAX_INBAND_PARAM_SZ / sizeof(uint32_t)];
+};
+
+void msm_audio_effects_batch_init(struct msm_audio_effects_batch *batch,
+				  struct audio_client *ac,
+				  unsigned int period_ms);
+
+int msm_audio_effects_batch_flush(struct msm_audio_effects_batch *batch);
+
+void msm_audio_effects_batch_release(struct msm_audio_effects_batch *batch);
+
 bool msm_audio_effects_is_effmodule_supp_in_top(int effect_module,
 						int topology);
 
@@ -214,6 +214,8 @@ struct shared_io_config {
 	uint32_t bufcnt;
 };
 
+struct msm_audio_effects_batch;
+
 struct audio_client {
 	int                    session;
 	app_cb		       cb;
@@ -249,6 +251,8 @@ struct audio_client {
 	/* shared io */
 	struct audio_buffer shared_pos_buf;
 	struct shared_io_config config;
+	/* coalesces effect params when set, see msm-audio-effects-q6-v2 */
+	struct msm_audio_effects_batch *effects_batch;
 };
 
 struct q6asm_cal_info {
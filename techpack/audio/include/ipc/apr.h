@@ -14,6 +14,7 @@
 #define __APR_H_
 
 #include <linux/mutex.h>
+#include <linux/wait.h>
 #include <soc/qcom/subsystem_notif.h>
 
 enum apr_subsys_state {
@@ -121,6 +122,8 @@ struct apr_client_data {
 
 typedef int32_t (*apr_fn)(struct apr_client_data *data, void *priv);
 
+struct apr_batch;
+
 struct apr_svc {
 	uint16_t id;
 	uint16_t dest_id;
@@ -137,6 +140,29 @@ struct apr_svc {
 	struct mutex m_lock;
 	spinlock_t w_lock;
 	uint8_t pkt_owner;
+	struct apr_batch *batch;
+};
+
+/*
+ * A batch pipelines commands to one service without waiting for each
+ * APR_BASIC_RSP_RESULT: apr_batch_send() tags the token and keeps up to
+ * APR_BATCH_WINDOW commands outstanding, apr_core swallows their acks and
+ * apr_batch_end() waits for all of them at once.  The service callback
+ * never sees these acks, so only batch commands whose sole response is
+ * the basic result.
+ */
+#define APR_BATCH_TOKEN		0xBA7C0000
+#define APR_BATCH_TOKEN_MASK	0xFFFF0000
+#define APR_BATCH_WINDOW	16
+
+struct apr_batch {
+	struct apr_svc *svc;
+	wait_queue_head_t wait;
+	atomic_t pending;
+	uint16_t seq;
+	uint32_t status;	/* first DSP error, 0 if none */
+	uint32_t failed_opcode;
+	uint32_t sent;
 };
 
 struct apr_client {
@@ -171,6 +197,9 @@ inline int apr_fill_hdr(void *handle, uint32_t *buf, uint16_t src_port,
 			uint32_t token, uint32_t opcode, uint16_t len);
 
 int apr_send_pkt(void *handle, uint32_t *buf);
+int apr_batch_begin(void *handle, struct apr_batch *batch);
+int apr_batch_send(struct apr_batch *batch, uint32_t *buf);
+int apr_batch_end(struct apr_batch *batch, unsigned long timeout);
 int apr_deregister(void *handle);
 void subsys_notif_register(char *client_name, int domain,
 			   struct notifier_block *nb);
@@ -438,6 +438,131 @@ int apr_send_pkt(void *handle, uint32_t *buf)
 }
 EXPORT_SYMBOL(apr_send_pkt);
 
+/**
+ * apr_batch_begin - start pipelining commands to a service
+ * @handle: service the commands go to
+ * @batch: caller owned batch state, valid until apr_batch_end()
+ *
+ * Returns -EBUSY if the service already has a batch open.
+ */
+int apr_batch_begin(void *handle, struct apr_batch *batch)
+{
+	struct apr_svc *svc = handle;
+	unsigned long flags;
+	int rc = 0;
+
+	if (!svc || !batch)
+		return -EINVAL;
+
+	memset(batch, 0, sizeof(*batch));
+	batch->svc = svc;
+	init_waitqueue_head(&batch->wait);
+	atomic_set(&batch->pending, 0);
+
+	spin_lock_irqsave(&svc->w_lock, flags);
+	if (svc->batch)
+		rc = -EBUSY;
+	else
+		svc->batch = batch;
+	spin_unlock_irqrestore(&svc->w_lock, flags);
+
+	return rc;
+}
+EXPORT_SYMBOL(apr_batch_begin);
+
+/**
+ * apr_batch_send - send one command as part of a batch
+ * @batch: batch opened with apr_batch_begin()
+ * @buf: APR packet, its token is overwritten
+ *
+ * Only blocks while APR_BATCH_WINDOW commands are waiting for their ack.
+ */
+int apr_batch_send(struct apr_batch *batch, uint32_t *buf)
+{
+	struct apr_hdr *hdr = (struct apr_hdr *)buf;
+	int rc;
+
+	if (!batch || !batch->svc || !buf)
+		return -EINVAL;
+
+	if (!wait_event_timeout(batch->wait,
+			atomic_read(&batch->pending) < APR_BATCH_WINDOW,
+			msecs_to_jiffies(1000))) {
+		pr_err("%s: no acks from svc %d\n", __func__, batch->svc->id);
+		return -ETIMEDOUT;
+	}
+
+	hdr->token = APR_BATCH_TOKEN | batch->seq++;
+	atomic_inc(&batch->pending);
+	rc = apr_send_pkt(batch->svc, buf);
+	if (rc < 0) {
+		atomic_dec(&batch->pending);
+		return rc;
+	}
+	batch->sent++;
+	return 0;
+}
+EXPORT_SYMBOL(apr_batch_send);
+
+/**
+ * apr_batch_end - wait for every ack of a batch and close it
+ * @batch: batch opened with apr_batch_begin()
+ * @timeout: jiffies to wait for the outstanding acks
+ *
+ * Returns -ETIMEDOUT if acks are missing, -EIO if the DSP failed any of
+ * the commands, else 0.
+ */
+int apr_batch_end(struct apr_batch *batch, unsigned long timeout)
+{
+	struct apr_svc *svc;
+	unsigned long flags;
+	long left;
+
+	if (!batch || !batch->svc)
+		return -EINVAL;
+	svc = batch->svc;
+
+	left = wait_event_timeout(batch->wait,
+				  !atomic_read(&batch->pending), timeout);
+
+	spin_lock_irqsave(&svc->w_lock, flags);
+	svc->batch = NULL;
+	spin_unlock_irqrestore(&svc->w_lock, flags);
+
+	if (!left) {
+		pr_err("%s: svc %d: %d of %u acks missing\n", __func__,
+		       svc->id, atomic_read(&batch->pending), batch->sent);
+		return -ETIMEDOUT;
+	}
+	if (batch->status) {
+		pr_err("%s: svc %d: opcode 0x%x failed, DSP error 0x%x\n",
+		       __func__, svc->id, batch->failed_opcode, batch->status);
+		return -EIO;
+	}
+	return 0;
+}
+EXPORT_SYMBOL(apr_batch_end);
+
+static void apr_batch_ack(struct apr_svc *svc, struct apr_client_data *data)
+{
+	uint32_t *payload = data->payload;
+	struct apr_batch *batch;
+	unsigned long flags;
+
+	spin_lock_irqsave(&svc->w_lock, flags);
+	batch = svc->batch;
+	if (batch && atomic_read(&batch->pending)) {
+		if (payload && data->payload_size >= 2 * sizeof(uint32_t) &&
+		    payload[1] && !batch->status) {
+			batch->failed_opcode = payload[0];
+			batch->status = payload[1];
+		}
+		atomic_dec(&batch->pending);
+		wake_up(&batch->wait);
+	}
+	spin_unlock_irqrestore(&svc->w_lock, flags);
+}
+
 int apr_pkt_config(void *handle, struct apr_pkt_cfg *cfg)
 {
 	struct apr_svc *svc = (struct apr_svc *)handle;
@@ -744,6 +869,13 @@ void apr_cb_func(void *buf, int len, void *priv)
 		}
 	}
 
+	/* acks of batched commands, late ones included, stop here */
+	if (hdr->opcode == APR_BASIC_RSP_RESULT &&
+	    (hdr->token & APR_BATCH_TOKEN_MASK) == APR_BATCH_TOKEN) {
+		apr_batch_ack(c_svc, &data);
+		return;
+	}
+
 	temp_port = ((data.dest_port >> 8) * 8) + (data.dest_port & 0xFF);
 	if (((temp_port >= 0) && (temp_port < APR_MAX_PORTS))
 		&& (c_svc->port_cnt && c_svc->port_fn[temp_port]))
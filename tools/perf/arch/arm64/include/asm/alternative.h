@@ -0,0 +1,15 @@
+#ifndef _PERF_ASM_ALTERNATIVE_H_
+#define _PERF_ASM_ALTERNATIVE_H_
+
+/*
+ * Nothing patches the code in userspace, so alternative_if blocks are
+ * always assembled as enabled and the wrapper decides which entry point
+ * a benchmark calls.
+ */
+	.macro	alternative_if cap
+	.endm
+
+	.macro	alternative_else_nop_endif
+	.endm
+
+#endif	/* _PERF_ASM_ALTERNATIVE_H_ */
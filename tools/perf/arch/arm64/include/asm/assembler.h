@@ -0,0 +1,7 @@
+#ifndef _PERF_ASM_ASSEMBLER_H_
+#define _PERF_ASM_ASSEMBLER_H_
+
+/* There is no position independent alias to provide in userspace */
+#define ENDPIPROC(name)		ENDPROC(name)
+
+#endif	/* _PERF_ASM_ASSEMBLER_H_ */
@@ -0,0 +1,7 @@
+#ifndef _PERF_ASM_CACHE_H_
+#define _PERF_ASM_CACHE_H_
+
+#define L1_CACHE_SHIFT		7
+#define L1_CACHE_BYTES		(1 << L1_CACHE_SHIFT)
+
+#endif	/* _PERF_ASM_CACHE_H_ */
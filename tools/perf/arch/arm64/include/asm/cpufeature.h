@@ -0,0 +1,6 @@
+#ifndef _PERF_ASM_CPUFEATURE_H_
+#define _PERF_ASM_CPUFEATURE_H_
+
+/* Capabilities are only named by alternative_if, see asm/alternative.h */
+
+#endif	/* _PERF_ASM_CPUFEATURE_H_ */
@@ -0,0 +1,19 @@
+#ifndef _PERF_LINUX_LINKAGE_H_
+#define _PERF_LINUX_LINKAGE_H_
+
+/* linkage.h ... for including arch/arm64/lib/*.S */
+
+#define ENTRY(name)				\
+	.globl name;				\
+	.p2align 2;				\
+	name:
+
+#define WEAK(name)				\
+	.weak name;				\
+	name:
+
+#define ENDPROC(name)				\
+	.type name, %function;			\
+	.size name, . - name
+
+#endif	/* _PERF_LINUX_LINKAGE_H_ */
@@ -277,6 +277,12 @@ struct function memcpy_functions[] = {
 # define MEMCPY_FN(_fn, _name, _desc) {.name = _name, .desc = _desc, .fn.memcpy = _fn},
 # include "mem-memcpy-x86-64-asm-def.h"
 # undef MEMCPY_FN
+#endif
+
+#ifdef HAVE_ARCH_ARM64_SUPPORT
+# define MEMCPY_FN(_fn, _name, _desc) {.name = _name, .desc = _desc, .fn.memcpy = _fn},
+# include "mem-memcpy-arm64-asm-def.h"
+# undef MEMCPY_FN
 #endif
 
 	{ .name = NULL, }
@@ -370,6 +376,12 @@ static const struct function memset_functions[] = {
 # define MEMSET_FN(_fn, _name, _desc) { .name = _name, .desc = _desc, .fn.memset = _fn },
 # include "mem-memset-x86-64-asm-def.h"
 # undef MEMSET_FN
+#endif
+
+#ifdef HAVE_ARCH_ARM64_SUPPORT
+# define MEMSET_FN(_fn, _name, _desc) { .name = _name, .desc = _desc, .fn.memset = _fn },
+# include "mem-memset-arm64-asm-def.h"
+# undef MEMSET_FN
 #endif
 
 	{ .name = NULL, }
@@ -0,0 +1,8 @@
+
+MEMCPY_FN(__memcpy_ldp,
+	"arm64-ldp",
+	"ldp/stp based memcpy() in arch/arm64/lib/memcpy.S")
+
+MEMCPY_FN(__memcpy,
+	"arm64-a53",
+	"memcpy() with the Cortex-A53 large copy loop in arch/arm64/lib/memcpy.S")
@@ -0,0 +1,4 @@
+
+MEMSET_FN(__memset,
+	"arm64",
+	"dc zva based memset() in arch/arm64/lib/memset.S")
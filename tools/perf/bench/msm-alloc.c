@@ -0,0 +1,360 @@
+/*
+ * msm-alloc: allocate, map and free buffers through the ION and KGSL
+ * ioctls in a loop.
+ *
+ * Each loop allocates one buffer, mmaps it, touches every page, unmaps it
+ * and frees it. The time of each step is recorded so that the latency
+ * percentiles show pool refills and page zeroing that an average hides.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/compiler.h>
+#include <linux/kernel.h>
+#include <linux/types.h>
+
+#include <subcmd/parse-options.h>
+#include "../util/util.h"
+#include "bench.h"
+
+#include "../../../drivers/staging/android/uapi/ion.h"
+#include "../../../include/uapi/linux/msm_kgsl.h"
+
+#include <err.h>
+
+/* ION_SYSTEM_HEAP_ID in drivers/staging/android/uapi/msm_ion.h */
+#define ION_SYSTEM_HEAP_ID	25
+
+enum {
+	STEP_ALLOC,
+	STEP_MAP,
+	STEP_FREE,
+	NR_STEPS,
+};
+
+static const char * const step_names[NR_STEPS] = {
+	[STEP_ALLOC]	= "alloc",
+	[STEP_MAP]	= "map",
+	[STEP_FREE]	= "free",
+};
+
+static const char	*size_str	= "64KB";
+static unsigned int	nr_loops	= 10000;
+static unsigned int	heap_mask	= 1U << ION_SYSTEM_HEAP_ID;
+static bool		cached;
+static bool		no_touch;
+
+static const struct option ion_options[] = {
+	OPT_STRING('s', "size", &size_str, "64KB",
+		   "Specify the size of each buffer (e.g. 4KB, 1MB)"),
+	OPT_UINTEGER('l', "nr_loops", &nr_loops,
+		     "Specify the number of buffers to allocate"),
+	OPT_UINTEGER('H', "heap-mask", &heap_mask,
+		     "Specify the ION heap id mask (default: system heap)"),
+	OPT_BOOLEAN('c', "cached", &cached, "Allocate cached buffers"),
+	OPT_BOOLEAN('n', "no-touch", &no_touch,
+		    "Do not write to the buffer after mapping it"),
+	OPT_END()
+};
+
+static const struct option kgsl_options[] = {
+	OPT_STRING('s', "size", &size_str, "64KB",
+		   "Specify the size of each buffer (e.g. 4KB, 1MB)"),
+	OPT_UINTEGER('l', "nr_loops", &nr_loops,
+		     "Specify the number of buffers to allocate"),
+	OPT_BOOLEAN('c', "cached", &cached, "Allocate write-back buffers"),
+	OPT_BOOLEAN('n', "no-touch", &no_touch,
+		    "Do not write to the buffer after mapping it"),
+	OPT_END()
+};
+
+static const char * const bench_ion_alloc_usage[] = {
+	"perf bench ion alloc <options>",
+	NULL
+};
+
+static const char * const bench_kgsl_alloc_usage[] = {
+	"perf bench kgsl alloc <options>",
+	NULL
+};
+
+/* Latency of each step of each loop, in nanoseconds */
+static u64 *lat[NR_STEPS];
+
+static u64 now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void touch(void *addr, size_t size)
+{
+	size_t off, page = sysconf(_SC_PAGESIZE);
+
+	if (no_touch)
+		return;
+
+	for (off = 0; off < size; off += page)
+		((volatile char *)addr)[off] = 1;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static u64 percentile(const u64 *sorted, unsigned int pct)
+{
+	return sorted[(u64)(nr_loops - 1) * pct / 100];
+}
+
+static void print_results(const char *name, size_t size, u64 runtime)
+{
+	static const unsigned int pcts[] = { 50, 90, 99 };
+	double ops = (double)nr_loops * 1000000000ULL / runtime;
+	unsigned int i, j;
+
+	for (i = 0; i < NR_STEPS; i++)
+		qsort(lat[i], nr_loops, sizeof(u64), cmp_u64);
+
+	if (bench_format == BENCH_FORMAT_SIMPLE) {
+		printf("%lf", ops);
+		for (i = 0; i < NR_STEPS; i++) {
+			for (j = 0; j < ARRAY_SIZE(pcts); j++)
+				printf(" %" PRIu64, percentile(lat[i], pcts[j]));
+			printf(" %" PRIu64, lat[i][nr_loops - 1]);
+		}
+		printf("\n");
+		return;
+	}
+
+	printf("# %u %s buffers of %zu bytes%s\n\n", nr_loops, name, size,
+	       no_touch ? "" : ", every page touched");
+	printf(" %14.0lf ops/sec\n\n", ops);
+	printf(" %8s %10s %10s %10s %10s  (usecs)\n",
+	       "", "p50", "p90", "p99", "max");
+	for (i = 0; i < NR_STEPS; i++) {
+		printf(" %8s", step_names[i]);
+		for (j = 0; j < ARRAY_SIZE(pcts); j++)
+			printf(" %10.1lf", percentile(lat[i], pcts[j]) / 1000.0);
+		printf(" %10.1lf\n", lat[i][nr_loops - 1] / 1000.0);
+	}
+}
+
+static int alloc_lat(void)
+{
+	unsigned int i;
+
+	if (!nr_loops) {
+		fprintf(stderr, "Invalid number of loops\n");
+		return -1;
+	}
+
+	for (i = 0; i < NR_STEPS; i++) {
+		lat[i] = calloc(nr_loops, sizeof(u64));
+		if (!lat[i])
+			err(EXIT_FAILURE, "calloc");
+	}
+
+	return 0;
+}
+
+static void free_lat(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < NR_STEPS; i++)
+		zfree(&lat[i]);
+}
+
+static size_t parse_size(void)
+{
+	s64 size = perf_atoll((char *)size_str);
+
+	if (size <= 0) {
+		fprintf(stderr, "Invalid size:%s\n", size_str);
+		return 0;
+	}
+
+	return size;
+}
+
+static int ion_loop(int fd, size_t size)
+{
+	struct ion_allocation_data alloc = {
+		.len		= size,
+		.align		= 0,
+		.heap_id_mask	= heap_mask,
+		.flags		= cached ? ION_FLAG_CACHED : 0,
+	};
+	struct ion_handle_data handle;
+	struct ion_fd_data map;
+	u64 t0, t1, t2, t3;
+	unsigned int i;
+	void *addr;
+
+	for (i = 0; i < nr_loops; i++) {
+		t0 = now_ns();
+		if (ioctl(fd, ION_IOC_ALLOC, &alloc)) {
+			warn("ION_IOC_ALLOC");
+			return -1;
+		}
+
+		t1 = now_ns();
+		map.handle = alloc.handle;
+		if (ioctl(fd, ION_IOC_MAP, &map)) {
+			warn("ION_IOC_MAP");
+			return -1;
+		}
+		addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			    map.fd, 0);
+		if (addr == MAP_FAILED) {
+			warn("mmap");
+			return -1;
+		}
+		touch(addr, size);
+
+		t2 = now_ns();
+		munmap(addr, size);
+		close(map.fd);
+		handle.handle = alloc.handle;
+		if (ioctl(fd, ION_IOC_FREE, &handle)) {
+			warn("ION_IOC_FREE");
+			return -1;
+		}
+		t3 = now_ns();
+
+		lat[STEP_ALLOC][i] = t1 - t0;
+		lat[STEP_MAP][i] = t2 - t1;
+		lat[STEP_FREE][i] = t3 - t2;
+	}
+
+	return 0;
+}
+
+int bench_ion_alloc(int argc, const char **argv,
+		    const char *prefix __maybe_unused)
+{
+	size_t size;
+	u64 start;
+	int fd, ret;
+
+	argc = parse_options(argc, argv, ion_options, bench_ion_alloc_usage, 0);
+	if (argc) {
+		usage_with_options(bench_ion_alloc_usage, ion_options);
+		exit(EXIT_FAILURE);
+	}
+
+	size = parse_size();
+	if (!size || alloc_lat())
+		return 1;
+
+	fd = open("/dev/ion", O_RDONLY);
+	if (fd < 0)
+		err(EXIT_FAILURE, "open /dev/ion");
+
+	start = now_ns();
+	ret = ion_loop(fd, size);
+	if (!ret)
+		print_results("ION", size, now_ns() - start);
+
+	close(fd);
+	free_lat();
+
+	return ret ? 1 : 0;
+}
+
+static int kgsl_loop(int fd, size_t size)
+{
+	struct kgsl_gpumem_alloc_id alloc;
+	struct kgsl_gpumem_free_id id;
+	u64 t0, t1, t2, t3;
+	unsigned int i;
+	void *addr;
+
+	for (i = 0; i < nr_loops; i++) {
+		memset(&alloc, 0, sizeof(alloc));
+		alloc.size = size;
+		if (cached)
+			alloc.flags = KGSL_CACHEMODE_WRITEBACK <<
+				KGSL_CACHEMODE_SHIFT;
+
+		t0 = now_ns();
+		if (ioctl(fd, IOCTL_KGSL_GPUMEM_ALLOC_ID, &alloc)) {
+			warn("IOCTL_KGSL_GPUMEM_ALLOC_ID");
+			return -1;
+		}
+
+		/* Allocations are mapped by id, at id pages into the fd */
+		t1 = now_ns();
+		addr = mmap(NULL, alloc.mmapsize, PROT_READ | PROT_WRITE,
+			    MAP_SHARED, fd,
+			    (off_t)alloc.id * sysconf(_SC_PAGESIZE));
+		if (addr == MAP_FAILED) {
+			warn("mmap");
+			return -1;
+		}
+		touch(addr, size);
+
+		t2 = now_ns();
+		munmap(addr, alloc.mmapsize);
+		id.id = alloc.id;
+		id.__pad = 0;
+		if (ioctl(fd, IOCTL_KGSL_GPUMEM_FREE_ID, &id)) {
+			warn("IOCTL_KGSL_GPUMEM_FREE_ID");
+			return -1;
+		}
+		t3 = now_ns();
+
+		lat[STEP_ALLOC][i] = t1 - t0;
+		lat[STEP_MAP][i] = t2 - t1;
+		lat[STEP_FREE][i] = t3 - t2;
+	}
+
+	return 0;
+}
+
+int bench_kgsl_alloc(int argc, const char **argv,
+		     const char *prefix __maybe_unused)
+{
+	size_t size;
+	u64 start;
+	int fd, ret;
+
+	argc = parse_options(argc, argv, kgsl_options,
+			     bench_kgsl_alloc_usage, 0);
+	if (argc) {
+		usage_with_options(bench_kgsl_alloc_usage, kgsl_options);
+		exit(EXIT_FAILURE);
+	}
+
+	size = parse_size();
+	if (!size || alloc_lat())
+		return 1;
+
+	fd = open("/dev/kgsl-3d0", O_RDWR);
+	if (fd < 0)
+		err(EXIT_FAILURE, "open /dev/kgsl-3d0");
+
+	start = now_ns();
+	ret = kgsl_loop(fd, size);
+	if (!ret)
+		print_results("KGSL", size, now_ns() - start);
+
+	close(fd);
+	free_lat();
+
+	return ret ? 1 : 0;
+}
@@ -13,6 +13,8 @@
  *  mem   ... memory access performance
  *  numa  ... NUMA scheduling and MM performance
  *  futex ... Futex performance
+ *  ion   ... ION buffer allocation performance
+ *  kgsl  ... KGSL buffer allocation performance
  */
 #include "perf.h"
 #include "util/util.h"
@@ -66,6 +68,18 @@ static struct bench futex_benchmarks[] = {
 	{ NULL,		NULL,						NULL			}
 };
 
+static struct bench ion_benchmarks[] = {
+	{ "alloc",	"Benchmark for ION alloc, map and free calls",	bench_ion_alloc		},
+	{ "all",	"Run all ION benchmarks",			NULL			},
+	{ NULL,		NULL,						NULL			}
+};
+
+static struct bench kgsl_benchmarks[] = {
+	{ "alloc",	"Benchmark for KGSL alloc, map and free calls",	bench_kgsl_alloc	},
+	{ "all",	"Run all KGSL benchmarks",			NULL			},
+	{ NULL,		NULL,						NULL			}
+};
+
 struct collection {
 	const char	*name;
 	const char	*summary;
@@ -79,6 +93,8 @@ static struct collection collections[] = {
 	{ "numa",	"NUMA scheduling and MM benchmarks",		numa_benchmarks		},
 #endif
 	{"futex",       "Futex stressing benchmarks",                   futex_benchmarks        },
+	{ "ion",	"ION buffer allocation benchmarks",		ion_benchmarks		},
+	{ "kgsl",	"KGSL buffer allocation benchmarks",		kgsl_benchmarks		},
 	{ "all",	"All benchmarks",				NULL			},
 	{ NULL,		NULL,						NULL			}
 };
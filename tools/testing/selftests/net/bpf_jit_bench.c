@@ -0,0 +1,176 @@
+/*
+ * Socket filter attach latency and per-packet filter cost.
+ *
+ * attach: a traffic accounting style classic BPF filter is attached to a
+ *         fresh UDP socket over and over, the way netd re-attaches its
+ *         filters. With the JIT image cache only the first attach builds
+ *         an image, so compare the first attach with the average.
+ * packet: UDP datagrams are sent over loopback to a socket with and
+ *         without the filter and the difference is the filter cost.
+ *
+ * Usage: bpf_jit_bench [-a attaches] [-n packets]
+ * Run with net.core.bpf_jit_enable set to 0 and 1 to compare.
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <error.h>
+#include <linux/filter.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+static int cfg_attaches = 10000;
+static int cfg_packets = 200000;
+
+/* Accept IPv4/UDP to a few ports, as an accounting filter would */
+static struct sock_filter filter[] = {
+	BPF_STMT(BPF_LD | BPF_B | BPF_ABS, SKF_NET_OFF + 0),
+	BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 4),
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 4, 0, 11),
+	BPF_STMT(BPF_LD | BPF_B | BPF_ABS, SKF_NET_OFF + 9),
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, 9),
+	BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, SKF_NET_OFF + 0),
+	BPF_STMT(BPF_LD | BPF_H | BPF_IND, SKF_NET_OFF + 2),
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 53, 5, 0),
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 123, 4, 0),
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 443, 3, 0),
+	BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, 0x8000, 2, 0),
+	BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+	BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K, 0, 0, 1),
+	BPF_STMT(BPF_RET | BPF_K, 0xffff),
+	BPF_STMT(BPF_RET | BPF_K, 0xffff),
+};
+
+static struct sock_fprog fprog = {
+	.len = sizeof(filter) / sizeof(filter[0]),
+	.filter = filter,
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void attach(int fd)
+{
+	if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog,
+		       sizeof(fprog)))
+		error(1, errno, "SO_ATTACH_FILTER");
+}
+
+static void bench_attach(void)
+{
+	double start, first = 0, total = 0;
+	int i, fd;
+
+	for (i = 0; i < cfg_attaches; i++) {
+		fd = socket(AF_INET, SOCK_DGRAM, 0);
+		if (fd < 0)
+			error(1, errno, "socket");
+
+		start = now();
+		attach(fd);
+		if (!i)
+			first = now() - start;
+		total += now() - start;
+
+		close(fd);
+	}
+
+	fprintf(stderr, "attach: first %.1f us, average %.1f us\n",
+		first * 1e6, total * 1e6 / cfg_attaches);
+}
+
+/* Send and receive cfg_packets datagrams, returns the seconds taken */
+static double run_packets(int filtered)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t len = sizeof(addr);
+	char payload[64] = { 0 };
+	int rfd, sfd, i;
+	double start;
+
+	rfd = socket(AF_INET, SOCK_DGRAM, 0);
+	sfd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (rfd < 0 || sfd < 0)
+		error(1, errno, "socket");
+	if (bind(rfd, (struct sockaddr *)&addr, sizeof(addr)))
+		error(1, errno, "bind");
+	if (getsockname(rfd, (struct sockaddr *)&addr, &len))
+		error(1, errno, "getsockname");
+	if (connect(sfd, (struct sockaddr *)&addr, sizeof(addr)))
+		error(1, errno, "connect");
+	if (filtered)
+		attach(rfd);
+
+	start = now();
+	for (i = 0; i < cfg_packets; i++) {
+		if (send(sfd, payload, sizeof(payload), 0) < 0)
+			error(1, errno, "send");
+		if (recv(rfd, payload, sizeof(payload), 0) < 0)
+			error(1, errno, "recv");
+	}
+	start = now() - start;
+
+	close(sfd);
+	close(rfd);
+
+	return start;
+}
+
+static void bench_packets(void)
+{
+	double plain, filtered;
+
+	plain = run_packets(0);
+	filtered = run_packets(1);
+
+	fprintf(stderr, "packet: %.0f ns plain, %.0f ns filtered, %.1f ns filter\n",
+		plain * 1e9 / cfg_packets, filtered * 1e9 / cfg_packets,
+		(filtered - plain) * 1e9 / cfg_packets);
+}
+
+static void parse_opts(int argc, char **argv)
+{
+	int c;
+
+	while ((c = getopt(argc, argv, "a:n:")) != -1) {
+		switch (c) {
+		case 'a':
+			cfg_attaches = atoi(optarg);
+			break;
+		case 'n':
+			cfg_packets = atoi(optarg);
+			break;
+		default:
+			error(1, 0, "usage: %s [-a attaches] [-n packets]",
+			      argv[0]);
+		}
+	}
+
+	if (cfg_attaches < 1 || cfg_packets < 1)
+		error(1, 0, "counts must be positive");
+}
+
+int main(int argc, char **argv)
+{
+	parse_opts(argc, argv);
+
+	bench_attach();
+	bench_packets();
+
+	return 0;
+}
@@ -0,0 +1,305 @@
+/*
+ * Packets per second through a tun device, one packet per system call
+ * versus TUNSETBATCH packet arrays.
+ *
+ * The program creates a tun device with 198.18.0.1/24 and measures both
+ * directions the way a userspace VPN sees them:
+ *
+ *  read:  UDP datagrams sent to 198.18.0.2 are routed into the device and
+ *         read back from the tun fd.
+ *  write: IPv4/UDP packets from 198.18.0.2 are written to the tun fd and
+ *         delivered to a local UDP socket, which is left undrained so the
+ *         stack drops them once its receive buffer fills.
+ *
+ * Usage: tun_bench [-b batch] [-n packets] [-s payload bytes]
+ * A batch of 1 uses plain read()/write(). Needs CAP_NET_ADMIN.
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <error.h>
+#include <fcntl.h>
+#include <linux/if.h>
+#include <linux/if_tun.h>
+#include <linux/ip.h>
+#include <linux/udp.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOCAL_ADDR	"198.18.0.1"
+#define PEER_ADDR	"198.18.0.2"
+#define BENCH_PORT	9
+#define MAX_BATCH	256
+#define MAX_PAYLOAD	1472
+#define PKT_ALIGN(x)	(((x) + TUN_BATCH_ALIGN - 1) & ~(TUN_BATCH_ALIGN - 1))
+#define SLOT_SIZE	PKT_ALIGN(sizeof(struct tun_batch_hdr) + 1500)
+
+static int cfg_batch = 32;
+static int cfg_packets = 1000000;
+static int cfg_payload = 64;
+
+static char buf[MAX_BATCH * SLOT_SIZE];
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int tun_open(char *name)
+{
+	struct sockaddr_in *sin;
+	struct ifreq ifr;
+	int fd, sfd;
+
+	fd = open("/dev/net/tun", O_RDWR);
+	if (fd < 0)
+		error(1, errno, "open /dev/net/tun");
+
+	memset(&ifr, 0, sizeof(ifr));
+	ifr.ifr_flags = IFF_TUN | IFF_NO_PI;
+	strcpy(ifr.ifr_name, "tunbench%d");
+	if (ioctl(fd, TUNSETIFF, &ifr))
+		error(1, errno, "TUNSETIFF");
+	strcpy(name, ifr.ifr_name);
+
+	sfd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sfd < 0)
+		error(1, errno, "socket");
+
+	sin = (struct sockaddr_in *)&ifr.ifr_addr;
+	sin->sin_family = AF_INET;
+	inet_pton(AF_INET, LOCAL_ADDR, &sin->sin_addr);
+	if (ioctl(sfd, SIOCSIFADDR, &ifr))
+		error(1, errno, "SIOCSIFADDR");
+	inet_pton(AF_INET, "255.255.255.0", &sin->sin_addr);
+	if (ioctl(sfd, SIOCSIFNETMASK, &ifr))
+		error(1, errno, "SIOCSIFNETMASK");
+
+	if (ioctl(sfd, SIOCGIFFLAGS, &ifr))
+		error(1, errno, "SIOCGIFFLAGS");
+	ifr.ifr_flags |= IFF_UP;
+	if (ioctl(sfd, SIOCSIFFLAGS, &ifr))
+		error(1, errno, "SIOCSIFFLAGS");
+	close(sfd);
+
+	return fd;
+}
+
+static void set_batch(int fd, int on)
+{
+	if (ioctl(fd, TUNSETBATCH, &on))
+		error(1, errno, "TUNSETBATCH");
+}
+
+static uint16_t ip_csum(const void *data, int len)
+{
+	const uint16_t *p = data;
+	uint32_t sum = 0;
+
+	while (len > 1) {
+		sum += *p++;
+		len -= 2;
+	}
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	return ~sum;
+}
+
+static int build_pkt(char *pkt)
+{
+	struct iphdr *iph = (struct iphdr *)pkt;
+	struct udphdr *udph = (struct udphdr *)(iph + 1);
+	int len = sizeof(*iph) + sizeof(*udph) + cfg_payload;
+
+	memset(pkt, 0, len);
+	iph->version = 4;
+	iph->ihl = 5;
+	iph->tot_len = htons(len);
+	iph->ttl = 64;
+	iph->protocol = IPPROTO_UDP;
+	inet_pton(AF_INET, PEER_ADDR, &iph->saddr);
+	inet_pton(AF_INET, LOCAL_ADDR, &iph->daddr);
+	iph->check = ip_csum(iph, sizeof(*iph));
+	udph->source = htons(BENCH_PORT);
+	udph->dest = htons(BENCH_PORT);
+	udph->len = htons(len - sizeof(*iph));
+
+	return len;
+}
+
+/* Queue up to @n datagrams towards the tun device */
+static int send_burst(int sfd, int n)
+{
+	static char payload[MAX_PAYLOAD];
+	struct sockaddr_in peer = {
+		.sin_family = AF_INET,
+		.sin_port = htons(BENCH_PORT),
+	};
+	int i;
+
+	inet_pton(AF_INET, PEER_ADDR, &peer.sin_addr);
+	for (i = 0; i < n; i++)
+		if (sendto(sfd, payload, cfg_payload, 0,
+			   (struct sockaddr *)&peer, sizeof(peer)) < 0)
+			error(1, errno, "sendto");
+
+	return n;
+}
+
+static int read_burst(int fd, int n)
+{
+	struct tun_batch_hdr *hdr;
+	int got = 0, off;
+	ssize_t ret;
+
+	while (got < n) {
+		if (cfg_batch == 1) {
+			ret = read(fd, buf, SLOT_SIZE);
+			if (ret < 0)
+				break;
+			got++;
+			continue;
+		}
+
+		ret = read(fd, buf, (n - got) * SLOT_SIZE);
+		if (ret < 0)
+			break;
+		for (off = 0; off < ret;
+		     off += PKT_ALIGN(sizeof(*hdr) + hdr->len)) {
+			hdr = (struct tun_batch_hdr *)(buf + off);
+			got++;
+		}
+	}
+	if (got < n && errno != EAGAIN)
+		error(1, errno, "read");
+
+	return got;
+}
+
+static void bench_read(int fd)
+{
+	int sfd, done = 0, burst;
+	double start;
+
+	sfd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sfd < 0)
+		error(1, errno, "socket");
+
+	start = now();
+	while (done < cfg_packets) {
+		burst = send_burst(sfd, cfg_batch > 1 ? cfg_batch : 64);
+		done += read_burst(fd, burst);
+	}
+	fprintf(stderr, "read  batch %3d: %.0f pps (sender included)\n",
+		cfg_batch, done / (now() - start));
+
+	close(sfd);
+}
+
+static void bench_write(int fd)
+{
+	struct sockaddr_in local = {
+		.sin_family = AF_INET,
+		.sin_port = htons(BENCH_PORT),
+	};
+	struct tun_batch_hdr *hdr;
+	int sfd, len, slot, i, done = 0;
+	double start;
+
+	sfd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sfd < 0)
+		error(1, errno, "socket");
+	inet_pton(AF_INET, LOCAL_ADDR, &local.sin_addr);
+	if (bind(sfd, (struct sockaddr *)&local, sizeof(local)))
+		error(1, errno, "bind");
+
+	if (cfg_batch == 1) {
+		len = build_pkt(buf);
+		start = now();
+		for (; done < cfg_packets; done++)
+			if (write(fd, buf, len) != len)
+				error(1, errno, "write");
+	} else {
+		len = build_pkt(buf + sizeof(*hdr));
+		slot = PKT_ALIGN(sizeof(*hdr) + len);
+		for (i = 0; i < cfg_batch; i++) {
+			if (i)
+				memcpy(buf + i * slot, buf, slot);
+			hdr = (struct tun_batch_hdr *)(buf + i * slot);
+			hdr->len = len;
+		}
+
+		start = now();
+		while (done < cfg_packets) {
+			if (write(fd, buf, cfg_batch * slot) != cfg_batch * slot)
+				error(1, errno, "write");
+			done += cfg_batch;
+		}
+	}
+	fprintf(stderr, "write batch %3d: %.0f pps\n",
+		cfg_batch, done / (now() - start));
+
+	close(sfd);
+}
+
+static void parse_opts(int argc, char **argv)
+{
+	int c;
+
+	while ((c = getopt(argc, argv, "b:n:s:")) != -1) {
+		switch (c) {
+		case 'b':
+			cfg_batch = atoi(optarg);
+			break;
+		case 'n':
+			cfg_packets = atoi(optarg);
+			break;
+		case 's':
+			cfg_payload = atoi(optarg);
+			break;
+		default:
+			error(1, 0, "usage: %s [-b batch] [-n packets] [-s payload]",
+			      argv[0]);
+		}
+	}
+
+	if (cfg_batch < 1 || cfg_batch > MAX_BATCH)
+		error(1, 0, "batch must be 1..%d", MAX_BATCH);
+	if (cfg_payload < 0 || cfg_payload > MAX_PAYLOAD)
+		error(1, 0, "payload must be 0..%d", MAX_PAYLOAD);
+}
+
+int main(int argc, char **argv)
+{
+	char name[IFNAMSIZ];
+	int fd;
+
+	parse_opts(argc, argv);
+
+	fd = tun_open(name);
+	fprintf(stderr, "%s: %d byte payloads\n", name, cfg_payload);
+
+	if (cfg_batch > 1)
+		set_batch(fd, 1);
+	bench_write(fd);
+
+	if (fcntl(fd, F_SETFL, O_NONBLOCK))
+		error(1, errno, "fcntl");
+	bench_read(fd);
+
+	close(fd);
+	return 0;
+}